@@ -11,6 +11,7 @@
 #ifndef HTTP_CONNECTION_MANAGER_HPP
 #define HTTP_CONNECTION_MANAGER_HPP
 
+#include <mutex>
 #include <set>
 #include "connection.hpp"
 
@@ -38,6 +39,9 @@ public:
   void stop_all();
 
 private:
+  /// Guards connections_, as connections may be served by several threads.
+  std::mutex mutex_;
+
   /// The managed connections.
   std::set<connection_ptr> connections_;
 };
@@ -57,6 +57,14 @@ server::addRoute(const std::string& routeName, routeHandler callback)
     mRoutes[routeName] = callback;
 }
 
+void
+server::addRoute(const std::string& routeName, routeHandler callback,
+                 const std::string& contentType)
+{
+    addRoute(routeName, callback);
+    mContentTypes[routeName] = contentType;
+}
+
 void
 server::do_accept()
 {
@@ -120,7 +128,9 @@ server::handle_request(const request& req, reply& rep)
         rep.headers[0].name = "Content-Length";
         rep.headers[0].value = std::to_string(rep.content.size());
         rep.headers[1].name = "Content-Type";
-        rep.headers[1].value = "application/json";
+        auto type = mContentTypes.find(command);
+        rep.headers[1].value =
+            type != mContentTypes.end() ? type->second : "application/json";
     }
     else
     {
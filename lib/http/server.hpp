@@ -42,6 +42,9 @@ public:
     ~server();
 
     void addRoute(const std::string& routeName, routeHandler callback);
+    // Like addRoute, for routes that reply with something other than JSON
+    void addRoute(const std::string& routeName, routeHandler callback,
+                  const std::string& contentType);
     void add404(routeHandler callback);
 
     void handle_request(const request& req, reply& rep);
@@ -72,6 +75,7 @@ private:
     asio::ip::tcp::socket socket_;
 
     std::map<std::string, routeHandler> mRoutes;
+    std::map<std::string, std::string> mContentTypes;
 };
 
 } // namespace server
@@ -179,35 +179,198 @@ bitset_resize(bitset_t* bitset, size_t newarraysize, bool padwithzeroes)
     return true; // success!
 }
 
-size_t
-bitset_count(const bitset_t* bitset)
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define BITSET_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+/* Below this many words, AVX2 gains nothing over POPCNT */
+#define BITSET_AVX2_MIN_WORDS 16
+
+static BITSET_ALWAYS_INLINE uint64_t
+bitset_combine(uint64_t a, uint64_t b, bitset_popcount_op_t op)
+{
+    switch (op)
+    {
+    case BITSET_POPCOUNT_AND:
+        return a & b;
+    case BITSET_POPCOUNT_OR:
+        return a | b;
+    case BITSET_POPCOUNT_ANDNOT:
+        return a & ~b;
+    case BITSET_POPCOUNT_XOR:
+        return a ^ b;
+    default:
+        return a;
+    }
+}
+
+/* Inlined with a constant op into each kernel, so that the loop has no
+ * branches left on it; compiled for the kernel's target */
+static BITSET_ALWAYS_INLINE size_t
+bitset_popcount_loop(const uint64_t* a, const uint64_t* b, size_t n,
+                     bitset_popcount_op_t op)
 {
-    size_t card = 0;
+    size_t answer = 0;
     size_t k = 0;
-    // assumes that long long is 8 bytes
-    for (; k + 7 < bitset->arraysize; k += 8)
+    for (; k + 3 < n; k += 4)
     {
-        card += bitset_popcountll(bitset->array[k]);
-        card += bitset_popcountll(bitset->array[k + 1]);
-        card += bitset_popcountll(bitset->array[k + 2]);
-        card += bitset_popcountll(bitset->array[k + 3]);
-        card += bitset_popcountll(bitset->array[k + 4]);
-        card += bitset_popcountll(bitset->array[k + 5]);
-        card += bitset_popcountll(bitset->array[k + 6]);
-        card += bitset_popcountll(bitset->array[k + 7]);
+        uint64_t b0 = op == BITSET_POPCOUNT_A ? 0 : b[k];
+        uint64_t b1 = op == BITSET_POPCOUNT_A ? 0 : b[k + 1];
+        uint64_t b2 = op == BITSET_POPCOUNT_A ? 0 : b[k + 2];
+        uint64_t b3 = op == BITSET_POPCOUNT_A ? 0 : b[k + 3];
+        answer += bitset_popcountll(bitset_combine(a[k], b0, op));
+        answer += bitset_popcountll(bitset_combine(a[k + 1], b1, op));
+        answer += bitset_popcountll(bitset_combine(a[k + 2], b2, op));
+        answer += bitset_popcountll(bitset_combine(a[k + 3], b3, op));
     }
-    for (; k + 3 < bitset->arraysize; k += 4)
+    for (; k < n; ++k)
     {
-        card += bitset_popcountll(bitset->array[k]);
-        card += bitset_popcountll(bitset->array[k + 1]);
-        card += bitset_popcountll(bitset->array[k + 2]);
-        card += bitset_popcountll(bitset->array[k + 3]);
+        uint64_t bk = op == BITSET_POPCOUNT_A ? 0 : b[k];
+        answer += bitset_popcountll(bitset_combine(a[k], bk, op));
     }
-    for (; k < bitset->arraysize; k++)
+    return answer;
+}
+
+#define BITSET_POPCOUNT_BY_OP(loop, a, b, n, op)                               \
+    switch (op)                                                                \
+    {                                                                          \
+    case BITSET_POPCOUNT_AND:                                                  \
+        return loop(a, b, n, BITSET_POPCOUNT_AND);                             \
+    case BITSET_POPCOUNT_OR:                                                   \
+        return loop(a, b, n, BITSET_POPCOUNT_OR);                              \
+    case BITSET_POPCOUNT_ANDNOT:                                               \
+        return loop(a, b, n, BITSET_POPCOUNT_ANDNOT);                          \
+    case BITSET_POPCOUNT_XOR:                                                  \
+        return loop(a, b, n, BITSET_POPCOUNT_XOR);                             \
+    default:                                                                   \
+        return loop(a, b, n, BITSET_POPCOUNT_A);                               \
+    }
+
+static size_t
+bitset_popcount_portable(const uint64_t* a, const uint64_t* b, size_t n,
+                         bitset_popcount_op_t op)
+{
+    BITSET_POPCOUNT_BY_OP(bitset_popcount_loop, a, b, n, op)
+}
+
+#ifdef BITSET_X86_DISPATCH
+__attribute__((target("popcnt"))) static size_t
+bitset_popcount_popcnt(const uint64_t* a, const uint64_t* b, size_t n,
+                       bitset_popcount_op_t op)
+{
+    BITSET_POPCOUNT_BY_OP(bitset_popcount_loop, a, b, n, op)
+}
+
+/* Counts the bits of each 64-bit lane with nibble lookups (Mula's method) */
+__attribute__((target("avx2"))) static inline __m256i
+bitset_popcount256(__m256i v)
+{
+    const __m256i lookup =
+        _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1,
+                         1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i lowMask = _mm256_set1_epi8(0x0f);
+    __m256i lo = _mm256_and_si256(v, lowMask);
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), lowMask);
+    __m256i bytes = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo),
+                                    _mm256_shuffle_epi8(lookup, hi));
+    return _mm256_sad_epu8(bytes, _mm256_setzero_si256());
+}
+
+__attribute__((target("avx2"))) static BITSET_ALWAYS_INLINE __m256i
+bitset_combine256(__m256i a, __m256i b, bitset_popcount_op_t op)
+{
+    switch (op)
+    {
+    case BITSET_POPCOUNT_AND:
+        return _mm256_and_si256(a, b);
+    case BITSET_POPCOUNT_OR:
+        return _mm256_or_si256(a, b);
+    case BITSET_POPCOUNT_ANDNOT:
+        return _mm256_andnot_si256(b, a);
+    case BITSET_POPCOUNT_XOR:
+        return _mm256_xor_si256(a, b);
+    default:
+        return a;
+    }
+}
+
+__attribute__((target("avx2,popcnt"))) static BITSET_ALWAYS_INLINE size_t
+bitset_popcount_avx2_loop(const uint64_t* a, const uint64_t* b, size_t n,
+                          bitset_popcount_op_t op)
+{
+    __m256i sums = _mm256_setzero_si256();
+    size_t k = 0;
+    for (; k + 4 <= n; k += 4)
+    {
+        __m256i va = _mm256_loadu_si256((const __m256i*)(a + k));
+        __m256i vb = op == BITSET_POPCOUNT_A
+                         ? va
+                         : _mm256_loadu_si256((const __m256i*)(b + k));
+        sums = _mm256_add_epi64(
+            sums, bitset_popcount256(bitset_combine256(va, vb, op)));
+    }
+    uint64_t lanes[4];
+    _mm256_storeu_si256((__m256i*)lanes, sums);
+    size_t answer = (size_t)(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+    return answer + bitset_popcount_loop(a + k, b ? b + k : NULL, n - k, op);
+}
+
+__attribute__((target("avx2,popcnt"))) static size_t
+bitset_popcount_avx2(const uint64_t* a, const uint64_t* b, size_t n,
+                     bitset_popcount_op_t op)
+{
+    BITSET_POPCOUNT_BY_OP(bitset_popcount_avx2_loop, a, b, n, op)
+}
+#endif
+
+bitset_kernel_t
+bitset_best_kernel(void)
+{
+#ifdef BITSET_X86_DISPATCH
+    if (__builtin_cpu_supports("popcnt"))
+    {
+        return __builtin_cpu_supports("avx2") ? BITSET_KERNEL_AVX2
+                                              : BITSET_KERNEL_POPCNT;
+    }
+#endif
+    return BITSET_KERNEL_PORTABLE;
+}
+
+size_t
+bitset_popcount_words(bitset_kernel_t kernel, const uint64_t* a,
+                      const uint64_t* b, size_t n, bitset_popcount_op_t op)
+{
+    bitset_kernel_t best = bitset_best_kernel();
+    if (kernel > best)
+    {
+        kernel = best;
+    }
+#ifdef BITSET_X86_DISPATCH
+    if (kernel == BITSET_KERNEL_AVX2 && n >= BITSET_AVX2_MIN_WORDS)
     {
-        card += bitset_popcountll(bitset->array[k]);
+        return bitset_popcount_avx2(a, b, n, op);
     }
-    return card;
+    if (kernel != BITSET_KERNEL_PORTABLE)
+    {
+        return bitset_popcount_popcnt(a, b, n, op);
+    }
+#endif
+    return bitset_popcount_portable(a, b, n, op);
+}
+
+static inline size_t
+bitset_popcount(const uint64_t* a, const uint64_t* b, size_t n,
+                bitset_popcount_op_t op)
+{
+    return bitset_popcount_words(BITSET_KERNEL_AVX2, a, b, n, op);
+}
+
+size_t
+bitset_count(const bitset_t* bitset)
+{
+    return bitset_popcount(bitset->array, NULL, bitset->arraysize,
+                           BITSET_POPCOUNT_A);
 }
 
 bool
@@ -261,52 +424,22 @@ bitset_maximum(const bitset_t* bitset)
 size_t
 bitset_union_count(const bitset_t* b1, const bitset_t* b2)
 {
-    size_t answer = 0;
     size_t minlength =
         b1->arraysize < b2->arraysize ? b1->arraysize : b2->arraysize;
-    size_t k = 0;
-    for (; k + 3 < minlength; k += 4)
-    {
-        answer += bitset_popcountll(b1->array[k] | b2->array[k]);
-        answer += bitset_popcountll(b1->array[k + 1] | b2->array[k + 1]);
-        answer += bitset_popcountll(b1->array[k + 2] | b2->array[k + 2]);
-        answer += bitset_popcountll(b1->array[k + 3] | b2->array[k + 3]);
-    }
-    for (; k < minlength; ++k)
-    {
-        answer += bitset_popcountll(b1->array[k] | b2->array[k]);
-    }
-    if (b2->arraysize > b1->arraysize)
-    {
-        // k = b1->arraysize;
-        for (; k + 3 < b2->arraysize; k += 4)
-        {
-            answer += bitset_popcountll(b2->array[k]);
-            answer += bitset_popcountll(b2->array[k + 1]);
-            answer += bitset_popcountll(b2->array[k + 2]);
-            answer += bitset_popcountll(b2->array[k + 3]);
-        }
-        for (; k < b2->arraysize; ++k)
-        {
-            answer += bitset_popcountll(b2->array[k]);
-        }
-    }
-    else
-    {
-        // k = b2->arraysize;
-        for (; k + 3 < b1->arraysize; k += 4)
-        {
-            answer += bitset_popcountll(b1->array[k]);
-            answer += bitset_popcountll(b1->array[k + 1]);
-            answer += bitset_popcountll(b1->array[k + 2]);
-            answer += bitset_popcountll(b1->array[k + 3]);
-        }
-        for (; k < b1->arraysize; ++k)
-        {
-            answer += bitset_popcountll(b1->array[k]);
-        }
-    }
-    return answer;
+    const bitset_t* longer = b1->arraysize < b2->arraysize ? b2 : b1;
+    return bitset_popcount(b1->array, b2->array, minlength,
+                           BITSET_POPCOUNT_OR) +
+           bitset_popcount(longer->array + minlength, NULL,
+                           longer->arraysize - minlength, BITSET_POPCOUNT_A);
+}
+
+size_t
+bitset_intersection_count(const bitset_t* b1, const bitset_t* b2)
+{
+    size_t minlength =
+        b1->arraysize < b2->arraysize ? b1->arraysize : b2->arraysize;
+    return bitset_popcount(b1->array, b2->array, minlength,
+                           BITSET_POPCOUNT_AND);
 }
 
 void
@@ -342,17 +475,10 @@ bitset_difference_count(const bitset_t* b1, const bitset_t* b2)
 {
     size_t minlength =
         b1->arraysize < b2->arraysize ? b1->arraysize : b2->arraysize;
-    size_t k = 0;
-    size_t answer = 0;
-    for (; k < minlength; ++k)
-    {
-        answer += bitset_popcountll(b1->array[k] & ~(b2->array[k]));
-    }
-    for (; k < b1->arraysize; ++k)
-    {
-        answer += bitset_popcountll(b1->array[k]);
-    }
-    return answer;
+    return bitset_popcount(b1->array, b2->array, minlength,
+                           BITSET_POPCOUNT_ANDNOT) +
+           bitset_popcount(b1->array + minlength, NULL,
+                           b1->arraysize - minlength, BITSET_POPCOUNT_A);
 }
 
 bool
@@ -381,27 +507,11 @@ bitset_symmetric_difference_count(const bitset_t* b1, const bitset_t* b2)
 {
     size_t minlength =
         b1->arraysize < b2->arraysize ? b1->arraysize : b2->arraysize;
-    size_t k = 0;
-    size_t answer = 0;
-    for (; k < minlength; ++k)
-    {
-        answer += bitset_popcountll(b1->array[k] ^ b2->array[k]);
-    }
-    if (b2->arraysize > b1->arraysize)
-    {
-        for (; k < b2->arraysize; ++k)
-        {
-            answer += bitset_popcountll(b2->array[k]);
-        }
-    }
-    else
-    {
-        for (; k < b1->arraysize; ++k)
-        {
-            answer += bitset_popcountll(b1->array[k]);
-        }
-    }
-    return answer;
+    const bitset_t* longer = b1->arraysize < b2->arraysize ? b2 : b1;
+    return bitset_popcount(b1->array, b2->array, minlength,
+                           BITSET_POPCOUNT_XOR) +
+           bitset_popcount(longer->array + minlength, NULL,
+                           longer->arraysize - minlength, BITSET_POPCOUNT_A);
 }
 
 bool
@@ -165,17 +165,7 @@ size_t bitset_union_count(const bitset_t* b1, const bitset_t* b2);
 void bitset_inplace_intersection(bitset_t* b1, const bitset_t* b2);
 
 /* report the size of the intersection (without materializing it) */
-static inline size_t
-bitset_intersection_count(const bitset_t* b1, const bitset_t* b2)
-{
-    size_t answer = 0;
-    size_t minlength = b1->arraysize < b2->arraysize ? b1->arraysize : b2->arraysize;
-    for (size_t k = 0; k < minlength; ++k)
-    {
-        answer += bitset_popcountll(b1->array[k] & b2->array[k]);
-    }
-    return answer;
-}
+size_t bitset_intersection_count(const bitset_t* b1, const bitset_t* b2);
 
 /* compute the difference in-place (to b1), to generate a new bitset first call
  * bitset_copy */
@@ -192,6 +182,37 @@ bool bitset_inplace_symmetric_difference(bitset_t* b1, const bitset_t* b2);
 size_t bitset_symmetric_difference_count(const bitset_t* b1,
                                          const bitset_t* b2);
 
+/* The counting functions above share a population count kernel, picked at
+ * runtime: with hardware POPCNT, and with AVX2 for long enough arrays, on x86
+ * where the compiler can target them; elsewhere the compiler's own popcount
+ * (which is vectorized on AArch64) is used. */
+typedef enum
+{
+    BITSET_KERNEL_PORTABLE,
+    BITSET_KERNEL_POPCNT,
+    BITSET_KERNEL_AVX2
+} bitset_kernel_t;
+
+typedef enum
+{
+    /* b is not read */
+    BITSET_POPCOUNT_A,
+    BITSET_POPCOUNT_AND,
+    BITSET_POPCOUNT_OR,
+    BITSET_POPCOUNT_ANDNOT,
+    BITSET_POPCOUNT_XOR
+} bitset_popcount_op_t;
+
+/* the best kernel this CPU supports */
+bitset_kernel_t bitset_best_kernel(void);
+
+/* count the bits set in (a op b) over n words with the given kernel, falling
+ * back to the best one the CPU supports; exposed for tests and benchmarks to
+ * compare kernels */
+size_t bitset_popcount_words(bitset_kernel_t kernel, const uint64_t* a,
+                             const uint64_t* b, size_t n,
+                             bitset_popcount_op_t op);
+
 /* compute whether b1 == b2 */
 bool bitset_equal(const bitset_t* b1, const bitset_t* b2);
 
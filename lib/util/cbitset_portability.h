@@ -84,7 +84,10 @@ bitset_unreachable()
 {
     __assume(0);
 }
+
+#define BITSET_ALWAYS_INLINE __forceinline
 #else
+#define BITSET_ALWAYS_INLINE inline __attribute__((always_inline))
 #define bitset_clz __builtin_clz
 #define bitset_clzll __builtin_clzll
 #define bitset_ctzll __builtin_ctzll
@@ -0,0 +1,136 @@
+#pragma once
+
+// Adapted from https://github.com/wangyi-fudan/wyhash (final version 4)
+// Released into the public domain under The Unlicense
+// http://unlicense.org/
+
+#include <cstddef>
+#include <cstdint>
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#pragma intrinsic(_umul128)
+#endif
+
+namespace wyhash
+{
+
+// The default secret of the reference implementation; callers randomize the
+// hash through the seed.
+static constexpr uint64_t SECRET[4] = {
+    0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL, 0x4b33a62ed433d4a3ULL,
+    0x4d5a2da51de1aa47ULL};
+
+// Full 64x64->128 bit multiply, *a getting the low and *b the high half
+inline void
+mum(uint64_t* a, uint64_t* b)
+{
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = *a;
+    r *= *b;
+    *a = static_cast<uint64_t>(r);
+    *b = static_cast<uint64_t>(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    *a = _umul128(*a, *b, b);
+#else
+    uint64_t ha = *a >> 32, hb = *b >> 32;
+    uint64_t la = static_cast<uint32_t>(*a), lb = static_cast<uint32_t>(*b);
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32);
+    uint64_t c = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    *a = lo;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+inline uint64_t
+mix(uint64_t a, uint64_t b)
+{
+    mum(&a, &b);
+    return a ^ b;
+}
+
+// Little-endian reads, as in siphash.h
+inline uint64_t
+read8(uint8_t const* p)
+{
+    return (static_cast<uint64_t>(p[0])) | (static_cast<uint64_t>(p[1]) << 8) |
+           (static_cast<uint64_t>(p[2]) << 16) |
+           (static_cast<uint64_t>(p[3]) << 24) |
+           (static_cast<uint64_t>(p[4]) << 32) |
+           (static_cast<uint64_t>(p[5]) << 40) |
+           (static_cast<uint64_t>(p[6]) << 48) |
+           (static_cast<uint64_t>(p[7]) << 56);
+}
+
+inline uint64_t
+read4(uint8_t const* p)
+{
+    return (static_cast<uint64_t>(p[0])) | (static_cast<uint64_t>(p[1]) << 8) |
+           (static_cast<uint64_t>(p[2]) << 16) |
+           (static_cast<uint64_t>(p[3]) << 24);
+}
+
+inline uint64_t
+read3(uint8_t const* p, size_t k)
+{
+    return (static_cast<uint64_t>(p[0]) << 16) |
+           (static_cast<uint64_t>(p[k >> 1]) << 8) | p[k - 1];
+}
+
+inline uint64_t
+hash(void const* key, size_t len, uint64_t seed)
+{
+    auto p = static_cast<uint8_t const*>(key);
+    seed ^= mix(seed ^ SECRET[0], SECRET[1]);
+    uint64_t a, b;
+    if (len <= 16)
+    {
+        if (len >= 4)
+        {
+            a = (read4(p) << 32) | read4(p + ((len >> 3) << 2));
+            b = (read4(p + len - 4) << 32) |
+                read4(p + len - 4 - ((len >> 3) << 2));
+        }
+        else if (len > 0)
+        {
+            a = read3(p, len);
+            b = 0;
+        }
+        else
+        {
+            a = b = 0;
+        }
+    }
+    else
+    {
+        size_t i = len;
+        if (i > 48)
+        {
+            uint64_t see1 = seed, see2 = seed;
+            do
+            {
+                seed = mix(read8(p) ^ SECRET[1], read8(p + 8) ^ seed);
+                see1 = mix(read8(p + 16) ^ SECRET[2], read8(p + 24) ^ see1);
+                see2 = mix(read8(p + 32) ^ SECRET[3], read8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16)
+        {
+            seed = mix(read8(p) ^ SECRET[1], read8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = read8(p + i - 16);
+        b = read8(p + i - 8);
+    }
+    a ^= SECRET[1];
+    b ^= seed;
+    mum(&a, &b);
+    return mix(a ^ SECRET[0] ^ len, b ^ SECRET[1]);
+}
+}
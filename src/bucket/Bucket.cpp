@@ -14,6 +14,7 @@
 #include "bucket/BucketOutputIterator.h"
 #include "bucket/LedgerCmp.h"
 #include "bucket/MergeKey.h"
+#include "bucket/RawBucketEntry.h"
 #include "crypto/Hex.h"
 #include "crypto/Random.h"
 #include "database/Database.h"
@@ -24,6 +25,7 @@
 #include "util/Fs.h"
 #include "util/GlobalChecks.h"
 #include "util/Logging.h"
+#include "util/MemoryArenas.h"
 #include "util/XDRStream.h"
 #include "util/types.h"
 #include <Tracy.hpp>
@@ -48,6 +50,12 @@ Bucket::isIndexed() const
     return static_cast<bool>(mIndex);
 }
 
+size_t
+Bucket::getIndexMemoryUsage() const
+{
+    return mIndex ? mIndex->getMemoryUsage() : 0;
+}
+
 std::optional<std::pair<std::streamoff, std::streamoff>>
 Bucket::getOfferRange() const
 {
@@ -61,9 +69,53 @@ Bucket::setIndex(std::unique_ptr<BucketIndex const>&& index)
     mIndex = std::move(index);
 }
 
+size_t
+InMemoryBucketEntries::indexAt(std::streamoff offset) const
+{
+    return std::lower_bound(mOffsets.begin(), mOffsets.end(), offset) -
+           mOffsets.begin();
+}
+
+std::streamoff
+InMemoryBucketEntries::offsetAt(size_t index) const
+{
+    return index < mOffsets.size() ? mOffsets[index]
+                                   : static_cast<std::streamoff>(mFileSize);
+}
+
+bool
+InMemoryBucketEntries::find(LedgerKey const& k, std::streamoff pos,
+                            size_t pageSize, BucketEntry& be) const
+{
+    auto pageEnd = pos + static_cast<std::streamoff>(pageSize);
+    for (auto i = indexAt(pos); i < mEntries.size(); ++i)
+    {
+        if (pageSize == 0)
+        {
+            be = mEntries[i];
+            return true;
+        }
+        if (mOffsets[i] >= pageEnd)
+        {
+            break;
+        }
+        if (mEntries[i].type() != METAENTRY &&
+            getBucketLedgerKey(mEntries[i]) == k)
+        {
+            be = mEntries[i];
+            return true;
+        }
+    }
+    return false;
+}
+
 Bucket::Bucket(std::string const& filename, Hash const& hash,
-               std::unique_ptr<BucketIndex const>&& index)
-    : mFilename(filename), mHash(hash), mIndex(std::move(index))
+               std::unique_ptr<BucketIndex const>&& index,
+               std::shared_ptr<InMemoryBucketEntries const> inMemoryEntries)
+    : mFilename(filename)
+    , mHash(hash)
+    , mIndex(std::move(index))
+    , mInMemoryEntries(std::move(inMemoryEntries))
 {
     releaseAssert(filename.empty() || fs::exists(filename));
     if (!filename.empty())
@@ -78,6 +130,12 @@ Bucket::Bucket()
 {
 }
 
+std::shared_ptr<InMemoryBucketEntries const> const&
+Bucket::getInMemoryEntries() const
+{
+    return mInMemoryEntries;
+}
+
 Hash const&
 Bucket::getHash() const
 {
@@ -220,6 +278,84 @@ Bucket::randomBucketIndexName(std::string const& tmpDir)
     return randomFileName(tmpDir, ".index");
 }
 
+namespace
+{
+LedgerEntry::_data_t const&
+entryId(LedgerEntry const& e)
+{
+    return e.data;
+}
+
+LedgerKey const&
+entryId(LedgerKey const& k)
+{
+    return k;
+}
+
+// True if no entry in v has an identity less than or equal to its predecessor
+template <typename T>
+bool
+isStrictlySortedById(std::vector<T> const& v)
+{
+    LedgerEntryIdCmp cmp;
+    return std::adjacent_find(v.begin(), v.end(),
+                              [&cmp](T const& lhs, T const& rhs) {
+                                  return !cmp(entryId(lhs), entryId(rhs));
+                              }) == v.end();
+}
+
+// Writes the union of the sorted inputs to out in key order. The same key
+// appearing in more than one input is a logic error.
+void
+putSortedEntries(BucketOutputIterator& out, bool useInit,
+                 std::vector<LedgerEntry> const& initEntries,
+                 std::vector<LedgerEntry> const& liveEntries,
+                 std::vector<LedgerKey> const& deadEntries)
+{
+    ZoneScoped;
+    LedgerEntryIdCmp cmp;
+    auto init = initEntries.begin();
+    auto live = liveEntries.begin();
+    auto dead = deadEntries.begin();
+    auto less = [&cmp](auto const& lhs, auto const& rhs) {
+        return cmp(entryId(lhs), entryId(rhs));
+    };
+
+    BucketEntry be;
+    while (init != initEntries.end() || live != liveEntries.end() ||
+           dead != deadEntries.end())
+    {
+        bool initFirst =
+            init != initEntries.end() &&
+            (live == liveEntries.end() || less(*init, *live)) &&
+            (dead == deadEntries.end() || less(*init, *dead));
+        bool liveFirst =
+            !initFirst && live != liveEntries.end() &&
+            (init == initEntries.end() || less(*live, *init)) &&
+            (dead == deadEntries.end() || less(*live, *dead));
+        if (initFirst)
+        {
+            be.type(useInit ? INITENTRY : LIVEENTRY);
+            be.liveEntry() = *init++;
+        }
+        else if (liveFirst)
+        {
+            be.type(LIVEENTRY);
+            be.liveEntry() = *live++;
+        }
+        else
+        {
+            releaseAssert(dead != deadEntries.end() &&
+                          (init == initEntries.end() || less(*dead, *init)) &&
+                          (live == liveEntries.end() || less(*dead, *live)));
+            be.type(DEADENTRY);
+            be.deadEntry() = *dead++;
+        }
+        out.put(be);
+    }
+}
+}
+
 std::shared_ptr<Bucket>
 Bucket::fresh(BucketManager& bucketManager, uint32_t protocolVersion,
               std::vector<LedgerEntry> const& initEntries,
@@ -236,15 +372,27 @@ Bucket::fresh(BucketManager& bucketManager, uint32_t protocolVersion,
 
     BucketMetadata meta;
     meta.ledgerVersion = protocolVersion;
-    auto entries =
-        convertToBucketEntry(useInit, initEntries, liveEntries, deadEntries);
 
     MergeCounters mc;
     BucketOutputIterator out(bucketManager.getTmpDir(), true, meta, mc, ctx,
                              doFsync);
-    for (auto const& e : entries)
+    if (auto cutoff = bucketManager.getConfig().BUCKET_IN_MEMORY_CUTOFF)
     {
-        out.put(e);
+        out.keepInMemory(cutoff * 1024 * 1024);
+    }
+    if (isStrictlySortedById(initEntries) &&
+        isStrictlySortedById(liveEntries) && isStrictlySortedById(deadEntries))
+    {
+        putSortedEntries(out, useInit, initEntries, liveEntries, deadEntries);
+    }
+    else
+    {
+        auto entries = convertToBucketEntry(useInit, initEntries, liveEntries,
+                                            deadEntries);
+        for (auto const& e : entries)
+        {
+            out.put(e);
+        }
     }
 
     if (countMergeEvents)
@@ -366,9 +514,9 @@ maybePut(BucketOutputIterator& out, BucketEntry const& entry,
 }
 
 static void
-countOldEntryType(MergeCounters& mc, BucketEntry const& e)
+countOldEntryType(MergeCounters& mc, BucketEntryType t)
 {
-    switch (e.type())
+    switch (t)
     {
     case METAENTRY:
         ++mc.mOldMetaEntries;
@@ -386,9 +534,9 @@ countOldEntryType(MergeCounters& mc, BucketEntry const& e)
 }
 
 static void
-countNewEntryType(MergeCounters& mc, BucketEntry const& e)
+countNewEntryType(MergeCounters& mc, BucketEntryType t)
 {
-    switch (e.type())
+    switch (t)
     {
     case METAENTRY:
         ++mc.mNewMetaEntries;
@@ -527,7 +675,7 @@ mergeCasesWithDefaultAcceptance(
         // In both cases: take old entry.
         ++mc.mOldEntriesDefaultAccepted;
         Bucket::checkProtocolLegality(*oi, protocolVersion);
-        countOldEntryType(mc, *oi);
+        countOldEntryType(mc, (*oi).type());
         maybePut(out, *oi, shadowIterators, keepShadowedLifecycleEntries, mc);
         ++oi;
         return true;
@@ -542,7 +690,7 @@ mergeCasesWithDefaultAcceptance(
         // In both cases: take new entry.
         ++mc.mNewEntriesDefaultAccepted;
         Bucket::checkProtocolLegality(*ni, protocolVersion);
-        countNewEntryType(mc, *ni);
+        countNewEntryType(mc, (*ni).type());
         maybePut(out, *ni, shadowIterators, keepShadowedLifecycleEntries, mc);
         ++ni;
         return true;
@@ -557,7 +705,8 @@ mergeCasesWithEqualKeys(MergeCounters& mc, BucketInputIterator& oi,
                         BucketInputIterator& ni, BucketOutputIterator& out,
                         std::vector<BucketInputIterator>& shadowIterators,
                         uint32_t protocolVersion,
-                        bool keepShadowedLifecycleEntries)
+                        bool keepShadowedLifecycleEntries,
+                        BucketEntry& scratch)
 {
     // Old and new are for the same key and neither is INIT, take the new
     // key. If either key is INIT, we have to make some adjustments:
@@ -626,8 +775,8 @@ mergeCasesWithEqualKeys(MergeCounters& mc, BucketInputIterator& oi,
     BucketEntry const& newEntry = *ni;
     Bucket::checkProtocolLegality(oldEntry, protocolVersion);
     Bucket::checkProtocolLegality(newEntry, protocolVersion);
-    countOldEntryType(mc, oldEntry);
-    countNewEntryType(mc, newEntry);
+    countOldEntryType(mc, oldEntry.type());
+    countNewEntryType(mc, newEntry.type());
 
     if (newEntry.type() == INITENTRY)
     {
@@ -638,11 +787,10 @@ mergeCasesWithEqualKeys(MergeCounters& mc, BucketInputIterator& oi,
             throw std::runtime_error(
                 "Malformed bucket: old non-DEAD + new INIT.");
         }
-        BucketEntry newLive;
-        newLive.type(LIVEENTRY);
-        newLive.liveEntry() = newEntry.liveEntry();
+        scratch.type(LIVEENTRY);
+        scratch.liveEntry() = newEntry.liveEntry();
         ++mc.mNewInitEntriesMergedWithOldDead;
-        maybePut(out, newLive, shadowIterators, keepShadowedLifecycleEntries,
+        maybePut(out, scratch, shadowIterators, keepShadowedLifecycleEntries,
                  mc);
     }
     else if (oldEntry.type() == INITENTRY)
@@ -651,11 +799,10 @@ mergeCasesWithEqualKeys(MergeCounters& mc, BucketInputIterator& oi,
         if (newEntry.type() == LIVEENTRY)
         {
             // Merge a create+update to a fresher create.
-            BucketEntry newInit;
-            newInit.type(INITENTRY);
-            newInit.liveEntry() = newEntry.liveEntry();
+            scratch.type(INITENTRY);
+            scratch.liveEntry() = newEntry.liveEntry();
             ++mc.mOldInitEntriesMergedWithNewLive;
-            maybePut(out, newInit, shadowIterators,
+            maybePut(out, scratch, shadowIterators,
                      keepShadowedLifecycleEntries, mc);
         }
         else
@@ -768,6 +915,141 @@ Bucket::scanForEvictionLegacy(AbstractLedgerTxn& ltx, EvictionIterator& iter,
     return false;
 }
 
+// Decoding merge, required while shadows may be present
+static void
+mergeWithShadows(BucketManager& bucketManager, MergeCounters& mc,
+                 BucketInputIterator& oi, BucketInputIterator& ni,
+                 BucketOutputIterator& out,
+                 std::vector<BucketInputIterator>& shadowIterators,
+                 uint32_t protocolVersion, bool keepShadowedLifecycleEntries)
+{
+    BucketEntryIdCmp cmp;
+    size_t iter = 0;
+
+    // Reused for every INIT/LIVE conversion of equal keys. LIVEENTRY and
+    // INITENTRY share the liveEntry arm, so assigning into the same object
+    // reuses the storage of previously converted entries instead of
+    // allocating a new LedgerEntry per conversion.
+    BucketEntry scratch;
+
+    while (oi || ni)
+    {
+        // Check if the merge should be stopped every few entries
+        if (++iter >= 1000)
+        {
+            iter = 0;
+            if (bucketManager.isShutdown())
+            {
+                // Stop merging, as BucketManager is now shutdown
+                // This is safe as temp file has not been adopted yet,
+                // so it will be removed with the tmp dir
+                throw std::runtime_error(
+                    "Incomplete bucket merge due to BucketManager shutdown");
+            }
+        }
+
+        if (!mergeCasesWithDefaultAcceptance(cmp, mc, oi, ni, out,
+                                             shadowIterators, protocolVersion,
+                                             keepShadowedLifecycleEntries))
+        {
+            mergeCasesWithEqualKeys(mc, oi, ni, out, shadowIterators,
+                                    protocolVersion,
+                                    keepShadowedLifecycleEntries, scratch);
+        }
+    }
+}
+
+// Merge used once shadows are removed. Without shadows, an entry's fate only
+// depends on its key and type and on the entry with the same key in the other
+// bucket, if any. Entries are ordered and copied through as raw XDR, and
+// INIT/LIVE conversions only rewrite the type discriminant, so entry bodies are
+// never decoded or re-encoded. Produces output identical to mergeWithShadows.
+static void
+mergeRawWithoutShadows(BucketManager& bucketManager, MergeCounters& mc,
+                       std::shared_ptr<Bucket> const& oldBucket,
+                       std::shared_ptr<Bucket> const& newBucket,
+                       BucketOutputIterator& out, bool streamingIO)
+{
+    ZoneScoped;
+    RawBucketInputIterator oi(oldBucket, streamingIO);
+    RawBucketInputIterator ni(newBucket, streamingIO);
+    LedgerEntryIdCmp cmp;
+    size_t iter = 0;
+
+    while (oi || ni)
+    {
+        // Check if the merge should be stopped every few entries
+        if (++iter >= 1000)
+        {
+            iter = 0;
+            if (bucketManager.isShutdown())
+            {
+                // Stop merging, as BucketManager is now shutdown
+                // This is safe as temp file has not been adopted yet,
+                // so it will be removed with the tmp dir
+                throw std::runtime_error(
+                    "Incomplete bucket merge due to BucketManager shutdown");
+            }
+        }
+
+        if (!ni || (oi && cmp((*oi).key, (*ni).key)))
+        {
+            ++mc.mOldEntriesDefaultAccepted;
+            countOldEntryType(mc, (*oi).type);
+            out.putRaw(*oi);
+            ++oi;
+            continue;
+        }
+
+        if (!oi || cmp((*ni).key, (*oi).key))
+        {
+            ++mc.mNewEntriesDefaultAccepted;
+            countNewEntryType(mc, (*ni).type);
+            out.putRaw(*ni);
+            ++ni;
+            continue;
+        }
+
+        // Equal keys, see mergeCasesWithEqualKeys for the lifecycle rules
+        auto& oldEntry = *oi;
+        auto& newEntry = *ni;
+        countOldEntryType(mc, oldEntry.type);
+        countNewEntryType(mc, newEntry.type);
+
+        if (newEntry.type == INITENTRY)
+        {
+            if (oldEntry.type != DEADENTRY)
+            {
+                throw std::runtime_error(
+                    "Malformed bucket: old non-DEAD + new INIT.");
+            }
+            newEntry.setLiveOrInitType(LIVEENTRY);
+            ++mc.mNewInitEntriesMergedWithOldDead;
+            out.putRaw(newEntry);
+        }
+        else if (oldEntry.type == INITENTRY)
+        {
+            if (newEntry.type == LIVEENTRY)
+            {
+                newEntry.setLiveOrInitType(INITENTRY);
+                ++mc.mOldInitEntriesMergedWithNewLive;
+                out.putRaw(newEntry);
+            }
+            else
+            {
+                ++mc.mOldInitEntriesMergedWithNewDead;
+            }
+        }
+        else
+        {
+            ++mc.mNewEntriesMergedWithOldNeitherInit;
+            out.putRaw(newEntry);
+        }
+        ++oi;
+        ++ni;
+    }
+}
+
 std::shared_ptr<Bucket>
 Bucket::merge(BucketManager& bucketManager, uint32_t maxProtocolVersion,
               std::shared_ptr<Bucket> const& oldBucket,
@@ -783,10 +1065,20 @@ Bucket::merge(BucketManager& bucketManager, uint32_t maxProtocolVersion,
 
     releaseAssert(oldBucket);
     releaseAssert(newBucket);
+    MemoryArenaScope arenaScope(MemoryArena::BUCKET_MERGE);
+
+    // Large merges stream their inputs and output, rather than letting them
+    // crowd the page cache
+    auto streamingThreshold =
+        bucketManager.getConfig().BUCKET_MERGE_STREAMING_IO_THRESHOLD *
+        1024 * 1024;
+    bool streamingIO =
+        streamingThreshold != 0 &&
+        oldBucket->getSize() + newBucket->getSize() >= streamingThreshold;
 
     MergeCounters mc;
-    BucketInputIterator oi(oldBucket);
-    BucketInputIterator ni(newBucket);
+    BucketInputIterator oi(oldBucket, streamingIO);
+    BucketInputIterator ni(newBucket, streamingIO);
     std::vector<BucketInputIterator> shadowIterators(shadows.begin(),
                                                      shadows.end());
 
@@ -801,35 +1093,42 @@ Bucket::merge(BucketManager& bucketManager, uint32_t maxProtocolVersion,
     meta.ledgerVersion = protocolVersion;
     BucketOutputIterator out(bucketManager.getTmpDir(), keepDeadEntries, meta,
                              mc, ctx, doFsync);
+    if (streamingIO)
+    {
+        out.useStreamingIO();
+    }
+    if (auto cutoff = bucketManager.getConfig().BUCKET_IN_MEMORY_CUTOFF)
+    {
+        out.keepInMemory(cutoff * 1024 * 1024);
+    }
 
-    BucketEntryIdCmp cmp;
-    size_t iter = 0;
-
-    while (oi || ni)
+    // The output is never larger than the two inputs combined, so their sum is
+    // a safe estimate for the index built while merging
+    if (bucketManager.getConfig().isUsingBucketListDB())
     {
-        // Check if the merge should be stopped every few entries
-        if (++iter >= 1000)
-        {
-            iter = 0;
-            if (bucketManager.isShutdown())
-            {
-                // Stop merging, as BucketManager is now shutdown
-                // This is safe as temp file has not been adopted yet,
-                // so it will be removed with the tmp dir
-                throw std::runtime_error(
-                    "Incomplete bucket merge due to BucketManager shutdown");
-            }
-        }
+        out.indexWhileWriting(bucketManager,
+                              oldBucket->getSize() + newBucket->getSize());
+    }
 
-        if (!mergeCasesWithDefaultAcceptance(cmp, mc, oi, ni, out,
-                                             shadowIterators, protocolVersion,
-                                             keepShadowedLifecycleEntries))
-        {
-            mergeCasesWithEqualKeys(mc, oi, ni, out, shadowIterators,
-                                    protocolVersion,
-                                    keepShadowedLifecycleEntries);
-        }
+    // Inputs kept in memory are already decoded, so there is nothing for a
+    // raw merge to save on them
+    auto inMemory = [](std::shared_ptr<Bucket> const& b) {
+        return b->isEmpty() || b->getInMemoryEntries();
+    };
+    if (shadowIterators.empty() &&
+        protocolVersionStartsFrom(protocolVersion,
+                                  Bucket::FIRST_PROTOCOL_SHADOWS_REMOVED) &&
+        !(inMemory(oldBucket) && inMemory(newBucket)))
+    {
+        mergeRawWithoutShadows(bucketManager, mc, oldBucket, newBucket, out,
+                               streamingIO);
     }
+    else
+    {
+        mergeWithShadows(bucketManager, mc, oi, ni, out, shadowIterators,
+                         protocolVersion, keepShadowedLifecycleEntries);
+    }
+
     if (countMergeEvents)
     {
         bucketManager.incrMergeCounters(mc);
@@ -11,6 +11,7 @@
 #include <list>
 #include <optional>
 #include <string>
+#include <vector>
 
 namespace asio
 {
@@ -44,6 +45,28 @@ class SearchableBucketListSnapshot;
 struct EvictionResultEntry;
 class EvictionStatistics;
 
+// The entries of a small bucket file kept in memory along with their file
+// offsets, so that the merges and lookups of the shallow levels, which are
+// rewritten every few ledgers, don't need to read the file back.
+struct InMemoryBucketEntries
+{
+    // Every entry in the file, including the METAENTRY
+    std::vector<BucketEntry> mEntries;
+    std::vector<std::streamoff> mOffsets;
+    size_t mFileSize{0};
+
+    // Index of the first entry starting at or after offset
+    size_t indexAt(std::streamoff offset) const;
+
+    // File offset of the entry at index, or the file size past the last one
+    std::streamoff offsetAt(size_t index) const;
+
+    // Like reading the entry at pos if pageSize is 0, or searching the page
+    // of pageSize bytes at pos for k otherwise
+    bool find(LedgerKey const& k, std::streamoff pos, size_t pageSize,
+              BucketEntry& be) const;
+};
+
 class Bucket : public std::enable_shared_from_this<Bucket>,
                public NonMovableOrCopyable
 {
@@ -52,6 +75,7 @@ class Bucket : public std::enable_shared_from_this<Bucket>,
     size_t mSize{0};
 
     std::unique_ptr<BucketIndex const> mIndex{};
+    std::shared_ptr<InMemoryBucketEntries const> const mInMemoryEntries;
 
     // Returns index, throws if index not yet initialized
     BucketIndex const& getIndex() const;
@@ -66,9 +90,12 @@ class Bucket : public std::enable_shared_from_this<Bucket>,
 
     // Construct a bucket with a given filename and hash. Asserts that the file
     // exists, but does not check that the hash is the bucket's hash. Caller
-    // needs to ensure that.
+    // needs to ensure that, and that inMemoryEntries, if any, are the
+    // contents of the file.
     Bucket(std::string const& filename, Hash const& hash,
-           std::unique_ptr<BucketIndex const>&& index);
+           std::unique_ptr<BucketIndex const>&& index,
+           std::shared_ptr<InMemoryBucketEntries const> inMemoryEntries =
+               nullptr);
 
     Hash const& getHash() const;
     std::filesystem::path const& getFilename() const;
@@ -80,12 +107,20 @@ class Bucket : public std::enable_shared_from_this<Bucket>,
 
     bool isEmpty() const;
 
+    // Entries of the bucket if it was small enough to keep them in memory
+    // when it was written, nullptr otherwise
+    std::shared_ptr<InMemoryBucketEntries const> const&
+    getInMemoryEntries() const;
+
     // Delete index and close file stream
     void freeIndex();
 
     // Returns true if bucket is indexed, false otherwise
     bool isIndexed() const;
 
+    // Approximate memory held by the index, 0 if not indexed
+    size_t getIndexMemoryUsage() const;
+
     // Returns [lowerBound, upperBound) of file offsets for all offers in the
     // bucket, or std::nullopt if no offers exist
     std::optional<std::pair<std::streamoff, std::streamoff>>
@@ -149,7 +184,10 @@ class Bucket : public std::enable_shared_from_this<Bucket>,
 
     // Create a fresh bucket from given vectors of init (created) and live
     // (updated) LedgerEntries, and dead LedgerEntryKeys. The bucket will
-    // be sorted, hashed, and adopted in the provided BucketManager.
+    // be sorted, hashed, and adopted in the provided BucketManager. If each
+    // vector is already sorted by key, as AbstractLedgerTxn::getAllEntries
+    // returns them, the vectors are merged straight into the bucket file
+    // without sorting a copy of all entries first.
     static std::shared_ptr<Bucket>
     fresh(BucketManager& bucketManager, uint32_t protocolVersion,
           std::vector<LedgerEntry> const& initEntries,
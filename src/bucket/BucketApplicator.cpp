@@ -40,8 +40,13 @@ BucketApplicator::BucketApplicator(Application& app,
             protocolVersion, mMaxProtocolVersion));
     }
 
-    // Only apply offers if BucketListDB is enabled
-    if (mApp.getConfig().isUsingBucketListDB() && !bucket->isEmpty())
+    // Only apply offers if BucketListDB is enabled, and nothing at all if
+    // offers are in BucketListDB too
+    if (mApp.getConfig().isUsingBucketListDB() && !mEntryTypeFilter(OFFER))
+    {
+        mOffersRemaining = false;
+    }
+    else if (mApp.getConfig().isUsingBucketListDB() && !bucket->isEmpty())
     {
         auto offsetOp = bucket->getOfferRange();
         if (offsetOp)
@@ -116,7 +121,11 @@ BucketApplicator::advance(BucketApplicator::Counters& counters)
     }
     else
     {
-        innerLtx = std::make_unique<LedgerTxn>(root, false);
+        innerLtx = std::make_unique<LedgerTxn>(
+            root, false,
+            mApp.getConfig().EXPERIMENTAL_BUCKET_APPLY_WITH_COPY
+                ? TransactionMode::BULK_LOAD_WITH_SQL_TXN
+                : TransactionMode::READ_WRITE_WITH_SQL_TXN);
         ltx = innerLtx.get();
         ltx->prepareNewObjects(LEDGER_ENTRY_BATCH_COMMIT_SIZE);
     }
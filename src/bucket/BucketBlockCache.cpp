@@ -0,0 +1,116 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "bucket/BucketBlockCache.h"
+#include "util/GlobalChecks.h"
+
+#include "medida/meter.h"
+#include <Tracy.hpp>
+
+namespace stellar
+{
+
+size_t
+BucketBlockCache::KeyHash::operator()(Key const& k) const noexcept
+{
+    // Bucket hashes are already uniformly distributed, just mix in the offset
+    size_t res = std::hash<Hash>()(k.bucketHash);
+    res ^= std::hash<std::streamoff>()(k.offset) + 0x9e3779b9 + (res << 6) +
+           (res >> 2);
+    return res;
+}
+
+BucketBlockCache::BucketBlockCache(size_t maxBytes, medida::Meter& hitMeter,
+                                   medida::Meter& missMeter)
+    : mMaxBytesPerShard(maxBytes / NUM_SHARDS)
+    , mHitMeter(hitMeter)
+    , mMissMeter(missMeter)
+{
+    releaseAssert(mMaxBytesPerShard > 0);
+}
+
+BucketBlockCache::Shard&
+BucketBlockCache::getShard(Key const& k)
+{
+    return mShards[KeyHash()(k) % NUM_SHARDS];
+}
+
+BucketBlockCache::Page
+BucketBlockCache::get(Hash const& bucketHash, std::streamoff offset)
+{
+    ZoneScoped;
+    Key k{bucketHash, offset};
+    auto& shard = getShard(k);
+    std::lock_guard<std::mutex> lock(shard.mMutex);
+    auto iter = shard.mMap.find(k);
+    if (iter == shard.mMap.end())
+    {
+        mMissMeter.Mark();
+        return nullptr;
+    }
+
+    mHitMeter.Mark();
+    shard.mLRU.splice(shard.mLRU.begin(), shard.mLRU, iter->second);
+    return iter->second->second;
+}
+
+void
+BucketBlockCache::put(Hash const& bucketHash, std::streamoff offset, Page page)
+{
+    ZoneScoped;
+    releaseAssert(page);
+    if (page->size() > mMaxBytesPerShard)
+    {
+        return;
+    }
+
+    Key k{bucketHash, offset};
+    auto& shard = getShard(k);
+    std::lock_guard<std::mutex> lock(shard.mMutex);
+
+    // Another thread may have raced us loading the same page
+    if (shard.mMap.find(k) != shard.mMap.end())
+    {
+        return;
+    }
+
+    shard.mBytes += page->size();
+    shard.mLRU.emplace_front(k, std::move(page));
+    shard.mMap.emplace(k, shard.mLRU.begin());
+
+    while (shard.mBytes > mMaxBytesPerShard)
+    {
+        auto& victim = shard.mLRU.back();
+        shard.mBytes -= victim.second->size();
+        shard.mMap.erase(victim.first);
+        shard.mLRU.pop_back();
+    }
+}
+
+size_t
+BucketBlockCache::getTotalBytes()
+{
+    size_t total = 0;
+    for (auto& shard : mShards)
+    {
+        std::lock_guard<std::mutex> lock(shard.mMutex);
+        total += shard.mBytes;
+    }
+    return total;
+}
+
+#ifdef BUILD_TESTS
+void
+BucketBlockCache::clear()
+{
+    for (auto& shard : mShards)
+    {
+        std::lock_guard<std::mutex> lock(shard.mMutex);
+        shard.mMap.clear();
+        shard.mLRU.clear();
+        shard.mBytes = 0;
+    }
+}
+#endif
+}
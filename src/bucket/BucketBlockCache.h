@@ -0,0 +1,96 @@
+#pragma once
+
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/HashOfHash.h"
+#include "util/NonCopyable.h"
+#include "xdr/Stellar-types.h"
+
+#include <array>
+#include <ios>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace medida
+{
+class Meter;
+}
+
+namespace stellar
+{
+
+// Thread-safe, size-bounded LRU cache of raw bucket file pages used by
+// BucketListDB range index lookups. Pages are keyed by (bucket hash, page file
+// offset). Since buckets are immutable, a cached page never goes stale; it is
+// simply evicted once it becomes least recently used. The cache is split into
+// independently locked shards so concurrent readers (main thread, eviction
+// scan, query server) do not serialize on a single mutex.
+class BucketBlockCache : public NonMovableOrCopyable
+{
+  public:
+    using Page = std::shared_ptr<std::vector<char> const>;
+
+  private:
+    struct Key
+    {
+        Hash bucketHash;
+        std::streamoff offset;
+
+        bool
+        operator==(Key const& other) const
+        {
+            return offset == other.offset && bucketHash == other.bucketHash;
+        }
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(Key const& k) const noexcept;
+    };
+
+    struct Shard
+    {
+        std::mutex mMutex;
+
+        // Most recently used pages are at the front
+        std::list<std::pair<Key, Page>> mLRU;
+        std::unordered_map<Key, std::list<std::pair<Key, Page>>::iterator,
+                           KeyHash>
+            mMap;
+        size_t mBytes{0};
+    };
+
+    static constexpr size_t NUM_SHARDS = 16;
+
+    std::array<Shard, NUM_SHARDS> mShards;
+    size_t const mMaxBytesPerShard;
+
+    medida::Meter& mHitMeter;
+    medida::Meter& mMissMeter;
+
+    Shard& getShard(Key const& k);
+
+  public:
+    BucketBlockCache(size_t maxBytes, medida::Meter& hitMeter,
+                     medida::Meter& missMeter);
+
+    // Returns cached page, or nullptr if not present
+    Page get(Hash const& bucketHash, std::streamoff offset);
+
+    // Inserts page, evicting least recently used pages of the same shard if
+    // the shard is over capacity. Pages larger than a shard's capacity are
+    // not cached.
+    void put(Hash const& bucketHash, std::streamoff offset, Page page);
+
+    size_t getTotalBytes();
+
+#ifdef BUILD_TESTS
+    void clear();
+#endif
+};
+}
@@ -7,6 +7,7 @@
 #include "util/GlobalChecks.h"
 #include "util/NonCopyable.h"
 #include "util/XDROperators.h" // IWYU pragma: keep
+#include "util/types.h"
 #include "xdr/Stellar-ledger-entries.h"
 #include <filesystem>
 #include <memory>
@@ -32,7 +33,9 @@ namespace stellar
  * the individual index vs range index.
  */
 
+class BucketIndexBuilder;
 class BucketManager;
+class Config;
 
 // BucketIndex abstract interface
 class BucketIndex : public NonMovableOrCopyable
@@ -74,7 +77,7 @@ class BucketIndex : public NonMovableOrCopyable
                                   IndividualIndex::const_iterator>;
 
     inline static const std::string DB_BACKEND_STATE = "bl";
-    inline static const uint32_t BUCKET_INDEX_VERSION = 2;
+    inline static const uint32_t BUCKET_INDEX_VERSION = 5;
 
     // Returns true if LedgerEntryType not supported by BucketListDB
     static bool typeNotSupported(LedgerEntryType t);
@@ -87,6 +90,18 @@ class BucketIndex : public NonMovableOrCopyable
     createIndex(BucketManager& bm, std::filesystem::path const& filename,
                 Hash const& hash);
 
+    // Returns a builder that indexes a bucket file incrementally while it is
+    // being written, avoiding the second pass over the file of createIndex.
+    // estimatedFileSize should be an upper bound on the final file size. It
+    // determines the index type and the bloom filter size.
+    static std::unique_ptr<BucketIndexBuilder>
+    createBuilder(BucketManager& bm, size_t estimatedFileSize);
+
+    // Returns a rough estimate, in bytes, of the memory used by the index of a
+    // bucket file of bucketFileSize bytes under the given config
+    static size_t estimateMemoryUsage(Config const& cfg,
+                                      size_t bucketFileSize);
+
     // Loads index from given file. If file does not exist or if saved
     // index does not have same parameters as current config, return null
     static std::unique_ptr<BucketIndex const>
@@ -107,6 +122,14 @@ class BucketIndex : public NonMovableOrCopyable
     virtual std::pair<std::optional<std::streamoff>, Iterator>
     scan(Iterator start, LedgerKey const& k) const = 0;
 
+    // Looks up every key in keys with a single forward (galloping) pass over
+    // the index. Returns a vector parallel to the iteration order of keys,
+    // holding the file offset for each key or std::nullopt if the key is not
+    // in the bucket. Since keys are sorted in bucket order, the returned
+    // offsets of found keys are non-decreasing.
+    virtual std::vector<std::optional<std::streamoff>>
+    lookupBatch(LedgerKeySet const& keys) const = 0;
+
     // Returns lower bound and upper bound for poolshare trustline entry
     // positions associated with the given accountID. If no trustlines found,
     // returns nullopt
@@ -126,6 +149,24 @@ class BucketIndex : public NonMovableOrCopyable
     // Returns page size for index. InidividualIndex returns 0 for page size
     virtual std::streamoff getPageSize() const = 0;
 
+    // Returns the file offsets, in increasing order, of every entry with a
+    // TEMPORARY CONTRACT_DATA key. These are the only entries the eviction
+    // scan can evict, so it visits them directly instead of reading the whole
+    // bucket. Includes DEADENTRY offsets, which the scan skips.
+    virtual std::vector<std::streamoff> const&
+    getEvictionCandidateOffsets() const = 0;
+
+    // Returns the largest offset of an indexed position not greater than pos,
+    // or 0 if there is none. Indexed positions are the start of every entry
+    // for individual indexes and the start of every page for range indexes,
+    // so reading forward from the result reaches the entry containing pos.
+    virtual std::streamoff
+    getIndexedOffsetAtOrBefore(std::streamoff pos) const = 0;
+
+    // Approximate number of bytes of memory the index holds: its key to
+    // offset mapping, bloom filter and auxiliary indexes
+    virtual size_t getMemoryUsage() const = 0;
+
     virtual Iterator begin() const = 0;
 
     virtual Iterator end() const = 0;
@@ -137,4 +178,28 @@ class BucketIndex : public NonMovableOrCopyable
     virtual bool operator==(BucketIndex const& inRaw) const = 0;
 #endif
 };
+
+// Incrementally builds a BucketIndex from entries as they are written to a new
+// bucket file. Entries must be added in file order.
+class BucketIndexBuilder : public NonMovableOrCopyable
+{
+  public:
+    virtual ~BucketIndexBuilder() = default;
+
+    // Adds be, written at file offset pos
+    virtual void add(BucketEntry const& be, std::streamoff pos) = 0;
+
+    // Adds the entry with the given key, written at file offset pos. Must
+    // only be used for entries other than INITENTRY LIQUIDITY_POOL, which
+    // need the full entry for the asset to pool ID index.
+    virtual void addKey(LedgerKey const& key, std::streamoff pos) = 0;
+
+    // Returns the finished index for the complete bucket file, or null if the
+    // index type chosen from the estimated file size does not match the type
+    // config requires for the actual fileSize. In that case the caller should
+    // fall back to BucketIndex::createIndex. Persists the index to disk if
+    // configured to do so. Must be called at most once.
+    virtual std::unique_ptr<BucketIndex const> finish(Hash const& hash,
+                                                      size_t fileSize) = 0;
+};
 }
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include "bucket/Bucket.h"
 #include "bucket/BucketManager.h"
 #include "crypto/ShortHash.h"
+#include "ledger/LedgerTypeUtils.h"
 #include "main/Config.h"
 #include "util/Fs.h"
 #include "util/LogSlowExecution.h"
@@ -22,6 +23,7 @@
 #include <fmt/chrono.h>
 #include <fmt/format.h>
 
+#include <climits>
 #include <thread>
 
 namespace stellar
@@ -64,61 +66,166 @@ BucketIndex::typeNotSupported(LedgerEntryType t)
 
 template <class IndexT>
 BucketIndexImpl<IndexT>::BucketIndexImpl(BucketManager& bm,
-                                         std::filesystem::path const& filename,
                                          std::streamoff pageSize,
-                                         Hash const& hash)
+                                         size_t estimatedFileSize)
     : mBloomMissMeter(bm.getBloomMissMeter())
     , mBloomLookupMeter(bm.getBloomLookupMeter())
 {
     ZoneScoped;
-    releaseAssert(!filename.empty());
-
-    {
-        auto timer = LogSlowExecution("Indexing bucket");
-        mData.pageSize = pageSize;
+    mData.pageSize = pageSize;
 
-        size_t const estimatedLedgerEntrySize =
-            xdr::xdr_traits<BucketEntry>::serial_size(BucketEntry{});
-        auto fileSize = fs::size(filename.string());
-        auto estimatedNumElems = fileSize / estimatedLedgerEntrySize;
+    size_t const estimatedLedgerEntrySize =
+        xdr::xdr_traits<BucketEntry>::serial_size(BucketEntry{});
+    auto estimatedNumElems = estimatedFileSize / estimatedLedgerEntrySize;
 
-        // Initialize bloom filter for range index
-        if constexpr (std::is_same<IndexT, RangeIndex>::value)
+    // Initialize bloom filter for range index
+    if constexpr (std::is_same<IndexT, RangeIndex>::value)
+    {
+        ZoneNamedN(bloomInit, "bloomInit", true);
+        bloom_parameters params;
+        params.projected_element_count = estimatedNumElems;
+
+        // Our target false positive rate is 0.1% even though we set the
+        // bloom filter false positive rate to 0.05%. We do this because our
+        // entry count estimation can be an underestimation (we assume every
+        // BucketEntry is an account LiveEntry, but TTL and DEADENTRY are
+        // smaller). If we gave a larger entry count estimate, the size of
+        // our bloom filter would significantly increase. Instead, by
+        // setting the desired false positive rate to 0.05%, the bloom
+        // filter size stays approximately the same and we give ourselves an
+        // additional 10% of wiggle room on the estimation.
+        params.false_positive_probability = 0.0005; // 0.05%
+
+        params.random_seed = shortHash::getShortHashInitKey();
+        if (bm.getConfig().BUCKETLIST_DB_BLOCKED_BLOOM_FILTER)
+        {
+            // The blocked filter is sized with the same bits per key as
+            // the classic filter, so it uses the same amount of memory
+            // and lands at roughly the 0.1% target rate.
+            mData.blockedFilter = std::make_unique<BlockedBloomFilter>(
+                params.projected_element_count,
+                params.false_positive_probability, params.random_seed);
+            CLOG_DEBUG(Bucket,
+                       "Blocked bloom filter initialized with params: "
+                       "projected element count {} false positive "
+                       "probability: {}, table size: {}",
+                       params.projected_element_count,
+                       params.false_positive_probability,
+                       mData.blockedFilter->size());
+        }
+        else
         {
-            ZoneNamedN(bloomInit, "bloomInit", true);
-            bloom_parameters params;
-            params.projected_element_count = estimatedNumElems;
-
-            // Our target false positive rate is 0.1% even though we set the
-            // bloom filter false positive rate to 0.05%. We do this because our
-            // entry count estimation can be an underestimation (we assume every
-            // BucketEntry is an account LiveEntry, but TTL and DEADENTRY are
-            // smaller). If we gave a larger entry count estimate, the size of
-            // our bloom filter would significantly increase. Instead, by
-            // setting the desired false positive rate to 0.05%, the bloom
-            // filter size stays approximately the same and we give ourselves an
-            // additional 10% of wiggle room on the estimation.
-            params.false_positive_probability = 0.0005; // 0.05%
-
-            params.random_seed = shortHash::getShortHashInitKey();
             params.compute_optimal_parameters();
             mData.filter = std::make_unique<bloom_filter>(params);
-            auto estimatedIndexEntries = fileSize / mData.pageSize;
-            CLOG_DEBUG(
-                Bucket,
-                "Bloom filter initialized with params: projected element count "
-                "{} false positive probability: {}, number of hashes: {}, "
-                "table size: {}",
-                params.projected_element_count,
-                params.false_positive_probability,
-                params.optimal_parameters.number_of_hashes,
-                params.optimal_parameters.table_size);
+            CLOG_DEBUG(Bucket,
+                       "Bloom filter initialized with params: projected "
+                       "element count {} false positive probability: {}, "
+                       "number of hashes: {}, table size: {}",
+                       params.projected_element_count,
+                       params.false_positive_probability,
+                       params.optimal_parameters.number_of_hashes,
+                       params.optimal_parameters.table_size);
+        }
+
+        auto estimatedIndexEntries = estimatedFileSize / mData.pageSize;
+
+        // We don't have a good way of estimating IndividualIndex size, so
+        // only reserve range indexes
+        mData.keysToOffset.reserve(estimatedIndexEntries);
+    }
+}
+
+template <class IndexT>
+void
+BucketIndexImpl<IndexT>::addEntry(BucketEntry const& be, std::streamoff pos,
+                                  std::streamoff& pageUpperBound)
+{
+    if (be.type() == METAENTRY)
+    {
+        return;
+    }
+
+    LedgerKey key = getBucketLedgerKey(be);
+
+    // We need an asset to poolID mapping for
+    // loadPoolshareTrustlineByAccountAndAsset queries. For this
+    // query, we only need to index INIT entries because:
+    // 1. PoolID is the hash of the Assets it refers to, so this
+    //    index cannot be invalidated by newer LIVEENTRY updates
+    // 2. We do a join over all bucket indexes so we avoid storing
+    //    multiple redundant index entries (i.e. LIVEENTRY updates)
+    // 3. We only use this index to collect the possible set of
+    //    Trustline keys, then we load those keys. This means that
+    //    we don't need to keep track of DEADENTRY. Even if a given
+    //    INITENTRY has been deleted by a newer DEADENTRY, the
+    //    trustline load will not return deleted trustlines, so the
+    //    load result is still correct even if the index has a few
+    //    deleted mappings.
+    if (be.type() == INITENTRY && key.type() == LIQUIDITY_POOL)
+    {
+        auto const& poolParams =
+            be.liveEntry().data.liquidityPool().body.constantProduct().params;
+        mData.assetToPoolID[poolParams.assetA].emplace_back(
+            key.liquidityPool().liquidityPoolID);
+        mData.assetToPoolID[poolParams.assetB].emplace_back(
+            key.liquidityPool().liquidityPoolID);
+    }
+
+    addKey(key, pos, pageUpperBound);
+}
+
+template <class IndexT>
+void
+BucketIndexImpl<IndexT>::addKey(LedgerKey const& key, std::streamoff pos,
+                                std::streamoff& pageUpperBound)
+{
+    if (isTemporaryEntry(key))
+    {
+        mData.evictionCandidates.emplace_back(pos);
+    }
 
-            // We don't have a good way of estimating IndividualIndex size, so
-            // only reserve range indexes
-            mData.keysToOffset.reserve(estimatedIndexEntries);
+    if constexpr (std::is_same<IndexT, RangeIndex>::value)
+    {
+        if (pos >= pageUpperBound)
+        {
+            pageUpperBound = roundDown(pos, mData.pageSize) + mData.pageSize;
+            mData.keysToOffset.emplace_back(RangeEntry(key, key), pos);
+        }
+        else
+        {
+            auto& rangeEntry = mData.keysToOffset.back().first;
+            releaseAssert(rangeEntry.upperBound < key);
+            rangeEntry.upperBound = key;
         }
 
+        auto keybuf = xdr::xdr_to_opaque(key);
+        if (mData.blockedFilter)
+        {
+            mData.blockedFilter->insert(keybuf.data(), keybuf.size());
+        }
+        else
+        {
+            mData.filter->insert(keybuf.data(), keybuf.size());
+        }
+    }
+    else
+    {
+        mData.keysToOffset.emplace_back(key, pos);
+    }
+}
+
+template <class IndexT>
+BucketIndexImpl<IndexT>::BucketIndexImpl(BucketManager& bm,
+                                         std::filesystem::path const& filename,
+                                         std::streamoff pageSize,
+                                         Hash const& hash)
+    : BucketIndexImpl(bm, pageSize, fs::size(filename.string()))
+{
+    ZoneScoped;
+    releaseAssert(!filename.empty());
+
+    {
+        auto timer = LogSlowExecution("Indexing bucket");
         XDRInputFileStream in;
         in.open(filename.string());
         std::streamoff pos = 0;
@@ -143,59 +250,9 @@ BucketIndexImpl<IndexT>::BucketIndexImpl(BucketManager& bm,
             if (be.type() != METAENTRY)
             {
                 ++count;
-                LedgerKey key = getBucketLedgerKey(be);
-
-                // We need an asset to poolID mapping for
-                // loadPoolshareTrustlineByAccountAndAsset queries. For this
-                // query, we only need to index INIT entries because:
-                // 1. PoolID is the hash of the Assets it refers to, so this
-                //    index cannot be invalidated by newer LIVEENTRY updates
-                // 2. We do a join over all bucket indexes so we avoid storing
-                //    multiple redundant index entries (i.e. LIVEENTRY updates)
-                // 3. We only use this index to collect the possible set of
-                //    Trustline keys, then we load those keys. This means that
-                //    we don't need to keep track of DEADENTRY. Even if a given
-                //    INITENTRY has been deleted by a newer DEADENTRY, the
-                //    trustline load will not return deleted trustlines, so the
-                //    load result is still correct even if the index has a few
-                //    deleted mappings.
-                if (be.type() == INITENTRY && key.type() == LIQUIDITY_POOL)
-                {
-                    auto const& poolParams = be.liveEntry()
-                                                 .data.liquidityPool()
-                                                 .body.constantProduct()
-                                                 .params;
-                    mData.assetToPoolID[poolParams.assetA].emplace_back(
-                        key.liquidityPool().liquidityPoolID);
-                    mData.assetToPoolID[poolParams.assetB].emplace_back(
-                        key.liquidityPool().liquidityPoolID);
-                }
-
-                if constexpr (std::is_same<IndexT, RangeIndex>::value)
-                {
-                    if (pos >= pageUpperBound)
-                    {
-                        pageUpperBound =
-                            roundDown(pos, mData.pageSize) + mData.pageSize;
-                        mData.keysToOffset.emplace_back(RangeEntry(key, key),
-                                                        pos);
-                    }
-                    else
-                    {
-                        auto& rangeEntry = mData.keysToOffset.back().first;
-                        releaseAssert(rangeEntry.upperBound < key);
-                        rangeEntry.upperBound = key;
-                    }
-
-                    auto keybuf = xdr::xdr_to_opaque(key);
-                    mData.filter->insert(keybuf.data(), keybuf.size());
-                }
-                else
-                {
-                    mData.keysToOffset.emplace_back(key, pos);
-                }
             }
 
+            addEntry(be, pos, pageUpperBound);
             pos = in.pos();
         }
 
@@ -239,8 +296,14 @@ BucketIndexImpl<BucketIndex::RangeIndex>::saveToDisk(BucketManager& bm,
         std::ofstream out;
         out.exceptions(std::ios::failbit | std::ios::badbit);
         out.open(tmpFilename, std::ios_base::binary | std::ios_base::trunc);
-        cereal::BinaryOutputArchive ar(out);
-        ar(mData);
+        {
+            cereal::BinaryOutputArchive ar(out);
+            ar(mData);
+        }
+        if (mData.blockedFilter)
+        {
+            mData.blockedFilter->writeTable(out);
+        }
     }
 
     std::filesystem::path canonicalName = bm.bucketIndexFilename(hash);
@@ -329,6 +392,29 @@ upper_bound_pred(LedgerKey const& key, IndexEntryT const& indexEntry)
     }
 }
 
+// Equivalent to std::lower_bound(begin, end, key, lower_bound_pred), but
+// gallops forward from begin in exponentially increasing steps before binary
+// searching. When successive keys are close together in the index, as they are
+// for sorted batch lookups, this is O(log d) in the distance d to the result
+// rather than O(log n) in the size of the remaining index.
+template <class IteratorT>
+static IteratorT
+gallopLowerBound(IteratorT begin, IteratorT end, LedgerKey const& key)
+{
+    using IndexEntryT = typename std::iterator_traits<IteratorT>::value_type;
+    auto lo = begin;
+    auto hi = begin;
+    typename std::iterator_traits<IteratorT>::difference_type step = 1;
+    while (hi != end && lower_bound_pred<IndexEntryT>(*hi, key))
+    {
+        lo = std::next(hi);
+        hi += std::min(step, std::distance(hi, end));
+        step *= 2;
+    }
+
+    return std::lower_bound(lo, hi, key, lower_bound_pred<IndexEntryT>);
+}
+
 std::unique_ptr<BucketIndex const>
 BucketIndex::createIndex(BucketManager& bm,
                          std::filesystem::path const& filename,
@@ -370,6 +456,99 @@ BucketIndex::createIndex(BucketManager& bm,
     }
 }
 
+template <class IndexT>
+class BucketIndexBuilderImpl : public BucketIndexBuilder
+{
+    BucketManager& mBm;
+    std::unique_ptr<BucketIndexImpl<IndexT>> mIndex;
+    std::streamoff mPageUpperBound{0};
+
+  public:
+    BucketIndexBuilderImpl(BucketManager& bm, std::streamoff pageSize,
+                           size_t estimatedFileSize)
+        : mBm(bm)
+        , mIndex(new BucketIndexImpl<IndexT>(bm, pageSize, estimatedFileSize))
+    {
+    }
+
+    void
+    add(BucketEntry const& be, std::streamoff pos) override
+    {
+        releaseAssert(mIndex);
+        mIndex->addEntry(be, pos, mPageUpperBound);
+    }
+
+    void
+    addKey(LedgerKey const& key, std::streamoff pos) override
+    {
+        releaseAssert(mIndex);
+        mIndex->addKey(key, pos, mPageUpperBound);
+    }
+
+    std::unique_ptr<BucketIndex const>
+    finish(Hash const& hash, size_t fileSize) override
+    {
+        ZoneScoped;
+        releaseAssert(mIndex);
+
+        // The index type was chosen from the estimated size. If the actual
+        // file lands on the other side of the cutoff, this index would not
+        // match what createIndex or load expect for this bucket.
+        if (effectivePageSize(mBm.getConfig(), fileSize) !=
+            mIndex->getPageSize())
+        {
+            mIndex.reset();
+            return {};
+        }
+
+        CLOG_DEBUG(Bucket, "Built index for bucket {} during write",
+                   hexAbbrev(hash));
+        if (mBm.getConfig().isPersistingBucketListDBIndexes())
+        {
+            mIndex->saveToDisk(mBm, hash);
+        }
+
+        return std::move(mIndex);
+    }
+};
+
+size_t
+BucketIndex::estimateMemoryUsage(Config const& cfg, size_t bucketFileSize)
+{
+    size_t const estimatedLedgerEntrySize =
+        xdr::xdr_traits<BucketEntry>::serial_size(BucketEntry{});
+    auto estimatedNumElems = bucketFileSize / estimatedLedgerEntrySize;
+
+    auto pageSize = effectivePageSize(cfg, bucketFileSize);
+    if (pageSize == 0)
+    {
+        return estimatedNumElems * sizeof(IndividualIndex::value_type);
+    }
+
+    // A bloom filter at our target false positive rate needs roughly 2 bytes
+    // per key, plus one range entry per page
+    auto numPages = bucketFileSize / pageSize + 1;
+    return estimatedNumElems * 2 + numPages * sizeof(RangeIndex::value_type);
+}
+
+std::unique_ptr<BucketIndexBuilder>
+BucketIndex::createBuilder(BucketManager& bm, size_t estimatedFileSize)
+{
+    auto const& cfg = bm.getConfig();
+    releaseAssertOrThrow(cfg.isUsingBucketListDB());
+    auto pageSize = effectivePageSize(cfg, estimatedFileSize);
+    if (pageSize == 0)
+    {
+        return std::make_unique<BucketIndexBuilderImpl<IndividualIndex>>(
+            bm, 0, estimatedFileSize);
+    }
+    else
+    {
+        return std::make_unique<BucketIndexBuilderImpl<RangeIndex>>(
+            bm, pageSize, estimatedFileSize);
+    }
+}
+
 std::unique_ptr<BucketIndex const>
 BucketIndex::load(BucketManager const& bm,
                   std::filesystem::path const& filename, size_t bucketFileSize)
@@ -383,6 +562,7 @@ BucketIndex::load(BucketManager const& bm,
 
     std::streamoff pageSize;
     uint32_t version;
+    bool useBlockedFilter;
     cereal::BinaryInputArchive ar(in);
     ar(version, pageSize);
 
@@ -394,6 +574,15 @@ BucketIndex::load(BucketManager const& bm,
         return {};
     }
 
+    // Only range indexes have a filter, so the filter type only needs to
+    // match config for them
+    ar(useBlockedFilter);
+    if (pageSize != 0 &&
+        useBlockedFilter != bm.getConfig().BUCKETLIST_DB_BLOCKED_BLOOM_FILTER)
+    {
+        return {};
+    }
+
     if (pageSize == 0)
     {
         return std::unique_ptr<BucketIndexImpl<IndividualIndex> const>(
@@ -401,9 +590,44 @@ BucketIndex::load(BucketManager const& bm,
     }
     else
     {
-        return std::unique_ptr<BucketIndexImpl<RangeIndex> const>(
+        std::unique_ptr<BucketIndexImpl<RangeIndex>> index(
             new BucketIndexImpl<RangeIndex>(bm, ar, pageSize));
+
+        // The blocked filter table follows the archive and is used in place,
+        // so that the bulk of a range index is not read at startup
+        if (index->mData.blockedFilter)
+        {
+            try
+            {
+                index->mData.blockedFilter->attachTable(filename.string(),
+                                                        in.tellg());
+            }
+            catch (std::runtime_error&)
+            {
+                // A truncated file is outdated like any other mismatch
+                return {};
+            }
+        }
+        return index;
+    }
+}
+
+template <class IndexT>
+bool
+BucketIndexImpl<IndexT>::filterMayContain(LedgerKey const& k) const
+{
+    if (!mData.filter && !mData.blockedFilter)
+    {
+        return true;
+    }
+
+    auto keybuf = xdr::xdr_to_opaque(k);
+    if (mData.blockedFilter)
+    {
+        return mData.blockedFilter->contains(keybuf.data(), keybuf.size());
     }
+
+    return mData.filter->contains(keybuf.data(), keybuf.size());
 }
 
 template <class IndexT>
@@ -433,10 +657,7 @@ BucketIndexImpl<IndexT>::scan(Iterator start, LedgerKey const& k) const
     // If the key is not in the bloom filter or in the lower bounded index
     // entry, return nullopt
     markBloomLookup();
-    auto keybuf = xdr::xdr_to_opaque(k);
-    if ((mData.filter &&
-         !mData.filter->contains(keybuf.data(), keybuf.size())) ||
-        keyIter == mData.keysToOffset.end() ||
+    if (!filterMayContain(k) || keyIter == mData.keysToOffset.end() ||
         keyNotInIndexEntry(k, keyIter->first))
     {
         return {std::nullopt, keyIter};
@@ -447,6 +668,47 @@ BucketIndexImpl<IndexT>::scan(Iterator start, LedgerKey const& k) const
     }
 }
 
+template <class IndexT>
+std::vector<std::optional<std::streamoff>>
+BucketIndexImpl<IndexT>::lookupBatch(LedgerKeySet const& keys) const
+{
+    ZoneScoped;
+    ZoneValue(static_cast<int64_t>(keys.size()));
+
+    std::vector<std::optional<std::streamoff>> result;
+    result.reserve(keys.size());
+
+    auto indexIter = mData.keysToOffset.begin();
+    auto const indexEnd = mData.keysToOffset.end();
+    for (auto const& k : keys)
+    {
+        indexIter = gallopLowerBound(indexIter, indexEnd, k);
+        if (indexIter == indexEnd)
+        {
+            // All remaining keys are larger than any key in the index
+            break;
+        }
+
+        markBloomLookup();
+        if (keyNotInIndexEntry(k, indexIter->first))
+        {
+            result.emplace_back(std::nullopt);
+            continue;
+        }
+
+        if (!filterMayContain(k))
+        {
+            result.emplace_back(std::nullopt);
+            continue;
+        }
+
+        result.emplace_back(indexIter->second);
+    }
+
+    result.resize(keys.size());
+    return result;
+}
+
 template <class IndexT>
 std::optional<std::pair<std::streamoff, std::streamoff>>
 BucketIndexImpl<IndexT>::getOffsetBounds(LedgerKey const& lowerBound,
@@ -526,6 +788,49 @@ BucketIndexImpl<IndexT>::getOfferRange() const
     return getOffsetBounds(lowerBound, upperBound);
 }
 
+template <class IndexT>
+std::streamoff
+BucketIndexImpl<IndexT>::getIndexedOffsetAtOrBefore(std::streamoff pos) const
+{
+    // Entries are indexed in file order, so offsets are sorted
+    auto iter = std::upper_bound(
+        mData.keysToOffset.begin(), mData.keysToOffset.end(), pos,
+        [](std::streamoff pos, typename IndexT::value_type const& indexEntry) {
+            return pos < indexEntry.second;
+        });
+    if (iter == mData.keysToOffset.begin())
+    {
+        return 0;
+    }
+
+    return std::prev(iter)->second;
+}
+
+template <class IndexT>
+size_t
+BucketIndexImpl<IndexT>::getMemoryUsage() const
+{
+    // Keys own no heap memory, except the SCVals of contract data keys,
+    // which this ignores
+    size_t res = sizeof(*this) + mData.keysToOffset.capacity() *
+                                     sizeof(typename IndexT::value_type);
+    if (mData.filter)
+    {
+        res += mData.filter->size() / CHAR_BIT;
+    }
+    // A mapped table is in the page cache rather than on the heap
+    if (mData.blockedFilter && !mData.blockedFilter->isMapped())
+    {
+        res += mData.blockedFilter->size();
+    }
+    for (auto const& [asset, pools] : mData.assetToPoolID)
+    {
+        res += sizeof(asset) + pools.capacity() * sizeof(PoolID);
+    }
+    res += mData.evictionCandidates.capacity() * sizeof(std::streamoff);
+    return res;
+}
+
 #ifdef BUILD_TESTS
 template <class IndexT>
 bool
@@ -542,19 +847,44 @@ BucketIndexImpl<IndexT>::operator==(BucketIndex const& inRaw) const
         return false;
     }
 
+    if (mData.evictionCandidates != in.mData.evictionCandidates)
+    {
+        return false;
+    }
+
     if constexpr (std::is_same<IndexT, RangeIndex>::value)
     {
-        releaseAssert(mData.filter);
-        releaseAssert(in.mData.filter);
-        if (*(mData.filter) != *(in.mData.filter))
+        if (static_cast<bool>(mData.blockedFilter) !=
+            static_cast<bool>(in.mData.blockedFilter))
         {
             return false;
         }
+
+        if (mData.blockedFilter)
+        {
+            releaseAssert(!mData.filter);
+            releaseAssert(!in.mData.filter);
+            if (*(mData.blockedFilter) != *(in.mData.blockedFilter))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            releaseAssert(mData.filter);
+            releaseAssert(in.mData.filter);
+            if (*(mData.filter) != *(in.mData.filter))
+            {
+                return false;
+            }
+        }
     }
     else
     {
         releaseAssert(!mData.filter);
         releaseAssert(!in.mData.filter);
+        releaseAssert(!mData.blockedFilter);
+        releaseAssert(!in.mData.blockedFilter);
     }
 
     for (size_t i = 0; i < mData.keysToOffset.size(); ++i)
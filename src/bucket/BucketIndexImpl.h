@@ -6,6 +6,7 @@
 
 #include "bucket/BucketIndex.h"
 #include "medida/meter.h"
+#include "util/BlockedBloomFilter.h"
 
 #include <cereal/types/map.hpp>
 #include <map>
@@ -31,25 +32,33 @@ template <class IndexT> class BucketIndexImpl : public BucketIndex
         IndexT keysToOffset{};
         std::streamoff pageSize{};
         std::unique_ptr<bloom_filter> filter{};
+
+        // Set instead of filter when BUCKETLIST_DB_BLOCKED_BLOOM_FILTER is
+        // enabled. At most one of filter and blockedFilter is non-null.
+        std::unique_ptr<BlockedBloomFilter> blockedFilter{};
         std::map<Asset, std::vector<PoolID>> assetToPoolID{};
+        std::vector<std::streamoff> evictionCandidates{};
 
         template <class Archive>
         void
         save(Archive& ar) const
         {
             auto version = BUCKET_INDEX_VERSION;
-            ar(version, pageSize, assetToPoolID, keysToOffset, filter);
+            bool useBlockedFilter = static_cast<bool>(blockedFilter);
+            ar(version, pageSize, useBlockedFilter, assetToPoolID,
+               keysToOffset, filter, blockedFilter, evictionCandidates);
         }
 
-        // Note: version and pageSize must be loaded before this function is
-        // called. pageSize determines template type, so pageSize should be
-        // loaded, checked, and then call this function with the appropriate
-        // template type
+        // Note: version, pageSize, and useBlockedFilter must be loaded before
+        // this function is called. pageSize determines template type, so
+        // pageSize should be loaded, checked, and then call this function
+        // with the appropriate template type
         template <class Archive>
         void
         load(Archive& ar)
         {
-            ar(assetToPoolID, keysToOffset, filter);
+            ar(assetToPoolID, keysToOffset, filter, blockedFilter,
+               evictionCandidates);
         }
     } mData;
 
@@ -59,10 +68,30 @@ template <class IndexT> class BucketIndexImpl : public BucketIndex
     BucketIndexImpl(BucketManager& bm, std::filesystem::path const& filename,
                     std::streamoff pageSize, Hash const& hash);
 
+    // Initializes an empty index for a bucket file of approximately
+    // estimatedFileSize bytes. Entries are then added via addEntry.
+    BucketIndexImpl(BucketManager& bm, std::streamoff pageSize,
+                    size_t estimatedFileSize);
+
     template <class Archive>
     BucketIndexImpl(BucketManager const& bm, Archive& ar,
                     std::streamoff pageSize);
 
+    // Adds be, located at file offset pos, to the index. Entries must be added
+    // in file order. pageUpperBound tracks the end of the current range index
+    // page and must be 0 for the first entry.
+    void addEntry(BucketEntry const& be, std::streamoff pos,
+                  std::streamoff& pageUpperBound);
+
+    // Same as addEntry, for an entry whose only indexed property is its key,
+    // i.e. any entry other than an INITENTRY LIQUIDITY_POOL
+    void addKey(LedgerKey const& key, std::streamoff pos,
+                std::streamoff& pageUpperBound);
+
+    // Returns false if the configured filter proves k is not in the bucket.
+    // Returns true if k may be in the bucket or if there is no filter.
+    bool filterMayContain(LedgerKey const& k) const;
+
     // Saves index to disk, overwriting any preexisting file for this index
     void saveToDisk(BucketManager& bm, Hash const& hash) const;
 
@@ -73,6 +102,7 @@ template <class IndexT> class BucketIndexImpl : public BucketIndex
                     LedgerKey const& upperBound) const;
 
     friend BucketIndex;
+    template <class T> friend class BucketIndexBuilderImpl;
 
   public:
     virtual std::optional<std::streamoff>
@@ -81,6 +111,9 @@ template <class IndexT> class BucketIndexImpl : public BucketIndex
     virtual std::pair<std::optional<std::streamoff>, Iterator>
     scan(Iterator start, LedgerKey const& k) const override;
 
+    virtual std::vector<std::optional<std::streamoff>>
+    lookupBatch(LedgerKeySet const& keys) const override;
+
     virtual std::optional<std::pair<std::streamoff, std::streamoff>>
     getPoolshareTrustlineRange(AccountID const& accountID) const override;
 
@@ -96,6 +129,17 @@ template <class IndexT> class BucketIndexImpl : public BucketIndex
         return mData.pageSize;
     }
 
+    virtual std::vector<std::streamoff> const&
+    getEvictionCandidateOffsets() const override
+    {
+        return mData.evictionCandidates;
+    }
+
+    virtual std::streamoff
+    getIndexedOffsetAtOrBefore(std::streamoff pos) const override;
+
+    virtual size_t getMemoryUsage() const override;
+
     virtual Iterator
     begin() const override
     {
@@ -12,14 +12,24 @@ namespace stellar
  * Helper class that reads from the file underlying a bucket, keeping the bucket
  * alive for the duration of its existence.
  */
+BucketEntry const*
+BucketInputIterator::readNext()
+{
+    if (mInMemoryEntries)
+    {
+        auto const& entries = mInMemoryEntries->mEntries;
+        return mNextEntry < entries.size() ? &entries[mNextEntry++] : nullptr;
+    }
+    return mIn.readOne(mEntry) ? &mEntry : nullptr;
+}
+
 void
 BucketInputIterator::loadEntry()
 {
     ZoneScoped;
-    if (mIn.readOne(mEntry))
+    if ((mEntryPtr = readNext()))
     {
-        mEntryPtr = &mEntry;
-        if (mEntry.type() == METAENTRY)
+        if (mEntryPtr->type() == METAENTRY)
         {
             // There should only be one METAENTRY in the input stream
             // and it should be the first record.
@@ -33,7 +43,7 @@ BucketInputIterator::loadEntry()
                 throw std::runtime_error(
                     "Malformed bucket: META after other entries.");
             }
-            mMetadata = mEntry.metaEntry();
+            mMetadata = mEntryPtr->metaEntry();
             mSeenMetadata = true;
             loadEntry();
         }
@@ -42,25 +52,30 @@ BucketInputIterator::loadEntry()
             mSeenOtherEntries = true;
             if (mSeenMetadata)
             {
-                Bucket::checkProtocolLegality(mEntry, mMetadata.ledgerVersion);
+                Bucket::checkProtocolLegality(*mEntryPtr,
+                                              mMetadata.ledgerVersion);
             }
         }
     }
-    else
-    {
-        mEntryPtr = nullptr;
-    }
 }
 
 std::streamoff
 BucketInputIterator::pos()
 {
+    if (mInMemoryEntries)
+    {
+        return mInMemoryEntries->offsetAt(mNextEntry);
+    }
     return mIn.pos();
 }
 
 size_t
 BucketInputIterator::size() const
 {
+    if (mInMemoryEntries)
+    {
+        return mInMemoryEntries->mFileSize;
+    }
     return mIn.size();
 }
 
@@ -87,7 +102,8 @@ BucketInputIterator::getMetadata() const
     return mMetadata;
 }
 
-BucketInputIterator::BucketInputIterator(std::shared_ptr<Bucket const> bucket)
+BucketInputIterator::BucketInputIterator(std::shared_ptr<Bucket const> bucket,
+                                         bool streamingIO)
     : mBucket(bucket), mEntryPtr(nullptr), mSeenMetadata(false)
 {
     // In absence of metadata, we treat every bucket as though it is from ledger
@@ -97,11 +113,16 @@ BucketInputIterator::BucketInputIterator(std::shared_ptr<Bucket const> bucket)
     // protocol of a pre-protocol-11 bucket, and we have to use as conservative
     // a default as possible to avoid spurious attempted-downgrade errors.
     mMetadata.ledgerVersion = 0;
-    if (!mBucket->getFilename().empty())
+    if ((mInMemoryEntries = mBucket->getInMemoryEntries()))
+    {
+        loadEntry();
+    }
+    else if (!mBucket->getFilename().empty())
     {
         CLOG_TRACE(Bucket, "BucketInputIterator opening file to read: {}",
                    mBucket->getFilename());
-        mIn.open(mBucket->getFilename().string());
+        mIn.open(mBucket->getFilename().string(),
+                 streamingIO ? fs::streamingBufsz() : 0);
         loadEntry();
     }
 }
@@ -114,7 +135,7 @@ BucketInputIterator::~BucketInputIterator()
 BucketInputIterator&
 BucketInputIterator::operator++()
 {
-    if (mIn)
+    if (mInMemoryEntries || mIn)
     {
         loadEntry();
     }
@@ -128,7 +149,14 @@ BucketInputIterator::operator++()
 void
 BucketInputIterator::seek(std::streamoff offset)
 {
-    mIn.seek(offset);
+    if (mInMemoryEntries)
+    {
+        mNextEntry = mInMemoryEntries->indexAt(offset);
+    }
+    else
+    {
+        mIn.seek(offset);
+    }
     loadEntry();
 }
 }
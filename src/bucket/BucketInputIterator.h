@@ -13,11 +13,16 @@ namespace stellar
 {
 
 class Bucket;
+struct InMemoryBucketEntries;
 
-// Helper class that reads through the entries in a bucket.
+// Helper class that reads through the entries in a bucket, from memory if the
+// bucket keeps them there, from its file otherwise.
 class BucketInputIterator
 {
     std::shared_ptr<Bucket const> mBucket;
+    std::shared_ptr<InMemoryBucketEntries const> mInMemoryEntries;
+    // Index of the next in-memory entry to read
+    size_t mNextEntry{0};
 
     // Validity and current-value of the iterator is funneled into a
     // pointer. If
@@ -28,6 +33,7 @@ class BucketInputIterator
     bool mSeenMetadata{false};
     bool mSeenOtherEntries{false};
     BucketMetadata mMetadata;
+    BucketEntry const* readNext();
     void loadEntry();
 
   public:
@@ -45,7 +51,10 @@ class BucketInputIterator
 
     BucketEntry const& operator*();
 
-    BucketInputIterator(std::shared_ptr<Bucket const> bucket);
+    // If streamingIO is set, the file is read through a large buffer suited
+    // to reading the whole bucket in one pass, such as in a big merge.
+    BucketInputIterator(std::shared_ptr<Bucket const> bucket,
+                        bool streamingIO = false);
 
     ~BucketInputIterator();
 
@@ -17,6 +17,9 @@
 #include "util/types.h"
 
 #include "medida/counter.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
 
 #include <Tracy.hpp>
 #include <fmt/format.h>
@@ -34,10 +37,14 @@ BucketLevel::BucketLevel(uint32_t i)
 uint256
 BucketLevel::getHash() const
 {
-    SHA256 hsh;
-    hsh.add(mCurr->getHash());
-    hsh.add(mSnap->getHash());
-    return hsh.finish();
+    if (!mHash)
+    {
+        SHA256 hsh;
+        hsh.add(mCurr->getHash());
+        hsh.add(mSnap->getHash());
+        mHash = hsh.finish();
+    }
+    return *mHash;
 }
 
 FutureBucket const&
@@ -77,6 +84,7 @@ BucketLevel::setCurr(std::shared_ptr<Bucket> b)
     releaseAssert(threadIsMain());
     mNextCurr.clear();
     mCurr = b;
+    mHash.reset();
 }
 
 bool
@@ -111,6 +119,7 @@ BucketLevel::setSnap(std::shared_ptr<Bucket> b)
 {
     releaseAssert(threadIsMain());
     mSnap = b;
+    mHash.reset();
 }
 
 void
@@ -186,6 +195,7 @@ BucketLevel::snap()
 {
     mSnap = mCurr;
     mCurr = std::make_shared<Bucket>();
+    mHash.reset();
     return mSnap;
 }
 
@@ -509,6 +519,29 @@ BucketList::getSize() const
     return sum;
 }
 
+// Commits a spilling level, recording a deadline miss when its merge is still
+// running, i.e. when ledger close has to block in FutureBucket::resolve.
+static void
+commitLevel(Application& app, BucketLevel& level, uint32_t i)
+{
+    auto const& next = level.getNext();
+    if (next.isMerging() && !next.mergeComplete())
+    {
+        auto lvl = "level-" + std::to_string(i);
+        app.getMetrics()
+            .NewMeter({"bucket", "merge-deadline-miss", lvl}, "merge")
+            .Mark();
+        auto& timer =
+            app.getMetrics().NewTimer({"bucket", "merge-blocked", lvl});
+        auto timeScope = timer.TimeScope();
+        level.commit();
+    }
+    else
+    {
+        level.commit();
+    }
+}
+
 void
 BucketList::addBatch(Application& app, uint32_t currLedger,
                      uint32_t currLedgerProtocol,
@@ -596,7 +629,7 @@ BucketList::addBatch(Application& app, uint32_t currLedger,
              */
 
             auto snap = mLevels[i - 1].snap();
-            mLevels[i].commit();
+            commitLevel(app, mLevels[i], i);
             mLevels[i].prepare(app, currLedger, currLedgerProtocol, snap,
                                shadows, /*countMergeEvents=*/true);
         }
@@ -361,6 +361,10 @@ class BucketLevel
     std::shared_ptr<Bucket> mCurr;
     std::shared_ptr<Bucket> mSnap;
 
+    // Hash of mCurr and mSnap, computed on first use and reset whenever
+    // either bucket is replaced
+    mutable std::optional<uint256> mHash;
+
   public:
     BucketLevel(uint32_t i);
     uint256 getHash() const;
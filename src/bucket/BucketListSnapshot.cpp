@@ -9,10 +9,18 @@
 
 #include "medida/timer.h"
 
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <iterator>
+
 namespace stellar
 {
 
-BucketListSnapshot::BucketListSnapshot(BucketList const& bl, uint32_t ledgerSeq)
+BucketListSnapshot::BucketListSnapshot(BucketList const& bl, uint32_t ledgerSeq,
+                                       bool useMappedReads,
+                                       BucketBlockCache* blockCache,
+                                       BucketLevelMetrics const* levelMetrics)
     : mLedgerSeq(ledgerSeq)
 {
     releaseAssert(threadIsMain());
@@ -20,7 +28,9 @@ BucketListSnapshot::BucketListSnapshot(BucketList const& bl, uint32_t ledgerSeq)
     for (uint32_t i = 0; i < BucketList::kNumLevels; ++i)
     {
         auto const& level = bl.getLevel(i);
-        mLevels.emplace_back(BucketLevelSnapshot(level));
+        mLevels.emplace_back(BucketLevelSnapshot(
+            level, useMappedReads, blockCache,
+            levelMetrics ? &levelMetrics[i] : nullptr));
     }
 }
 
@@ -89,15 +99,27 @@ SearchableBucketListSnapshot::scanForEviction(
     auto startIter = evictionIter;
     auto scanSize = sas.evictionScanSize;
 
+    // Scan regions only depend on bucket sizes, so first walk the BucketList
+    // to find the region of every bucket covered by this scan, then collect
+    // their entries
+    std::vector<EvictionScanRegion> regions;
     for (;;)
     {
         auto const& b = getBucketFromIter(evictionIter);
         BucketList::checkIfEvictionScanIsStuck(
             evictionIter, sas.evictionScanSize, b.getRawBucket(), counters);
 
+        auto regionStart = evictionIter;
+        auto endOfRegion = b.advanceEvictionScan(evictionIter, scanSize);
+        if (evictionIter.bucketFileOffset > regionStart.bucketFileOffset)
+        {
+            regions.push_back(
+                {&b, regionStart,
+                 static_cast<std::streamoff>(evictionIter.bucketFileOffset)});
+        }
+
         // If we scan scanSize before hitting bucket EOF, exit early
-        if (b.scanForEviction(evictionIter, scanSize, ledgerSeq,
-                              result.eligibleKeys, *this))
+        if (endOfRegion)
         {
             break;
         }
@@ -111,11 +133,98 @@ SearchableBucketListSnapshot::scanForEviction(
         }
     }
 
+    // Regions are concatenated in scan order, so the result is the same no
+    // matter how many threads collected them
+    auto regionKeys = collectEvictableEntries(regions, ledgerSeq);
+    for (auto& keys : regionKeys)
+    {
+        result.eligibleKeys.splice(result.eligibleKeys.end(), keys);
+    }
+
     result.endOfRegionIterator = evictionIter;
     result.initialLedger = ledgerSeq;
     return result;
 }
 
+std::vector<std::list<EvictionResultEntry>>
+SearchableBucketListSnapshot::collectEvictableEntries(
+    std::vector<EvictionScanRegion> const& regions, uint32_t ledgerSeq)
+{
+    ZoneScoped;
+    std::vector<std::list<EvictionResultEntry>> regionKeys(regions.size());
+    auto collect = [&](size_t i, SearchableBucketListSnapshot& bl) {
+        auto const& r = regions.at(i);
+        r.bucket->collectEvictableEntries(r.start, r.end, ledgerSeq,
+                                          regionKeys.at(i), bl);
+    };
+
+    auto numThreads =
+        std::min(mSnapshotManager.getEvictionScanThreads(), regions.size());
+    if (numThreads <= 1)
+    {
+        for (size_t i = 0; i < regions.size(); ++i)
+        {
+            collect(i, *this);
+        }
+        return regionKeys;
+    }
+
+    // Every thread claims the next unclaimed region until none are left. The
+    // calling thread participates, so helpers that start late simply find no
+    // work. Helpers load TTLs through their own snapshot so that BucketSnapshot
+    // streams are never shared between threads.
+    std::atomic<size_t> nextRegion{0};
+    auto worker = [&](SearchableBucketListSnapshot& bl) {
+        for (auto i = nextRegion++; i < regions.size(); i = nextRegion++)
+        {
+            collect(i, bl);
+        }
+    };
+
+    using task_t = std::packaged_task<void()>;
+    std::vector<std::future<void>> futures;
+    for (size_t i = 1; i < numThreads; ++i)
+    {
+        auto task = std::make_shared<task_t>([&worker, this] {
+            auto bl = mSnapshotManager.getSearchableBucketListSnapshot();
+            worker(*bl);
+        });
+        futures.emplace_back(task->get_future());
+        mSnapshotManager.postOnEvictionBackgroundThread(
+            bind(&task_t::operator(), task),
+            "SearchableBucketListSnapshot: eviction scan region");
+    }
+
+    std::exception_ptr inlineError;
+    try
+    {
+        worker(*this);
+    }
+    catch (...)
+    {
+        inlineError = std::current_exception();
+    }
+
+    // Helpers reference this frame, so wait for all of them before returning,
+    // even on error
+    for (auto& f : futures)
+    {
+        f.wait();
+    }
+
+    if (inlineError)
+    {
+        std::rethrow_exception(inlineError);
+    }
+
+    for (auto& f : futures)
+    {
+        f.get();
+    }
+
+    return regionKeys;
+}
+
 std::shared_ptr<LedgerEntry>
 SearchableBucketListSnapshot::getLedgerEntry(LedgerKey const& k)
 {
@@ -136,6 +245,13 @@ SearchableBucketListSnapshot::getLedgerEntry(LedgerKey const& k)
     }
 }
 
+uint32_t
+SearchableBucketListSnapshot::getLedgerSeq() const
+{
+    releaseAssert(mSnapshot);
+    return mSnapshot->getLedgerSeq();
+}
+
 std::pair<std::shared_ptr<LedgerEntry>, bool>
 SearchableBucketListSnapshot::getLedgerEntryInternal(LedgerKey const& k)
 {
@@ -168,6 +284,12 @@ std::vector<LedgerEntry>
 SearchableBucketListSnapshot::loadKeysInternal(
     std::set<LedgerKey, LedgerEntryIdCmp> const& inKeys)
 {
+    auto threshold = mSnapshotManager.getParallelLoadThreshold();
+    if (threshold != 0 && inKeys.size() >= threshold && threadIsMain())
+    {
+        return loadKeysParallel(inKeys);
+    }
+
     std::vector<LedgerEntry> entries;
 
     // Make a copy of the key set, this loop is destructive
@@ -181,6 +303,107 @@ SearchableBucketListSnapshot::loadKeysInternal(
     return entries;
 }
 
+std::vector<LedgerEntry>
+SearchableBucketListSnapshot::loadKeysParallel(
+    std::set<LedgerKey, LedgerEntryIdCmp> const& inKeys)
+{
+    ZoneScoped;
+    releaseAssert(threadIsMain());
+
+    std::vector<BucketSnapshot const*> buckets;
+    loopAllBuckets([&](BucketSnapshot const& b) {
+        buckets.emplace_back(&b);
+        return false;
+    });
+
+    if (buckets.empty() || inKeys.empty())
+    {
+        return {};
+    }
+
+    // Keys still in remaining after a probe were not found in that bucket
+    struct ProbeResult
+    {
+        LedgerKeySet remaining;
+        std::vector<LedgerEntry> entries;
+    };
+
+    auto probe = [&inKeys](BucketSnapshot const* b) {
+        ProbeResult r{inKeys, {}};
+        b->loadKeys(r.remaining, r.entries);
+        return r;
+    };
+
+    // Each task only touches its own BucketSnapshot, so the per-snapshot file
+    // streams are never shared between threads
+    using task_t = std::packaged_task<ProbeResult()>;
+    std::vector<std::future<ProbeResult>> futures;
+    for (size_t i = 1; i < buckets.size(); ++i)
+    {
+        auto task = std::make_shared<task_t>(
+            [probe, b = buckets.at(i)] { return probe(b); });
+        futures.emplace_back(task->get_future());
+        mSnapshotManager.postOnBackgroundThread(
+            bind(&task_t::operator(), task),
+            "SearchableBucketListSnapshot: parallel load");
+    }
+
+    std::vector<ProbeResult> results;
+    results.reserve(buckets.size());
+    std::exception_ptr inlineError;
+    try
+    {
+        results.emplace_back(probe(buckets.front()));
+    }
+    catch (...)
+    {
+        inlineError = std::current_exception();
+    }
+
+    // Tasks reference inKeys and this snapshot, so wait for all of them
+    // before returning, even on error
+    for (auto& f : futures)
+    {
+        f.wait();
+    }
+
+    if (inlineError)
+    {
+        std::rethrow_exception(inlineError);
+    }
+
+    for (auto& f : futures)
+    {
+        results.emplace_back(f.get());
+    }
+
+    // Resolve newest bucket first: a key found (live or dead) in a bucket
+    // shadows that key in all older buckets
+    std::vector<LedgerEntry> entries;
+    LedgerKeySet resolved;
+    for (auto const& r : results)
+    {
+        for (auto const& le : r.entries)
+        {
+            if (resolved.find(LedgerEntryKey(le)) == resolved.end())
+            {
+                entries.emplace_back(le);
+            }
+        }
+
+        std::set_difference(inKeys.begin(), inKeys.end(),
+                            r.remaining.begin(), r.remaining.end(),
+                            std::inserter(resolved, resolved.end()),
+                            LedgerEntryIdCmp{});
+        if (resolved.size() == inKeys.size())
+        {
+            break;
+        }
+    }
+
+    return entries;
+}
+
 std::vector<LedgerEntry>
 SearchableBucketListSnapshot::loadKeys(
     std::set<LedgerKey, LedgerEntryIdCmp> const& inKeys)
@@ -332,8 +555,63 @@ SearchableBucketListSnapshot::loadInflationWinners(size_t maxWinners,
     return winners;
 }
 
-BucketLevelSnapshot::BucketLevelSnapshot(BucketLevel const& level)
-    : curr(level.getCurr()), snap(level.getSnap())
+std::vector<LedgerEntry>
+SearchableBucketListSnapshot::loadAllOffers()
+{
+    ZoneScoped;
+    auto timer = mSnapshotManager.recordBulkLoadMetrics("offers", 0)
+                     .TimeScope();
+    releaseAssert(threadIsMain());
+    mSnapshotManager.maybeUpdateSnapshot(mSnapshot);
+
+    std::vector<LedgerEntry> offers;
+    UnorderedSet<int64_t> seen;
+    auto loadOffersInBucket = [&](BucketSnapshot const& b) {
+        if (b.isEmpty())
+        {
+            return false;
+        }
+        auto bucket = b.getRawBucket();
+        auto range = bucket->getOfferRange();
+        if (!range)
+        {
+            return false;
+        }
+
+        // As in BucketApplicator, pos() is the offset at the end of the
+        // current entry, so the last offer ends exactly at the upper bound
+        BucketInputIterator in(bucket);
+        for (in.seek(range->first); in && in.pos() <= range->second; ++in)
+        {
+            BucketEntry const& be = *in;
+            if (be.type() == DEADENTRY)
+            {
+                if (be.deadEntry().type() == OFFER)
+                {
+                    seen.insert(be.deadEntry().offer().offerID);
+                }
+            }
+            else if (be.liveEntry().data.type() == OFFER &&
+                     seen.insert(be.liveEntry().data.offer().offerID).second)
+            {
+                // Offer IDs are unique across sellers, and the newest
+                // version of each offer is in the first bucket having it
+                offers.emplace_back(be.liveEntry());
+            }
+        }
+        return false;
+    };
+
+    loopAllBuckets(loadOffersInBucket);
+    return offers;
+}
+
+BucketLevelSnapshot::BucketLevelSnapshot(BucketLevel const& level,
+                                         bool useMappedReads,
+                                         BucketBlockCache* blockCache,
+                                         BucketLevelMetrics const* metrics)
+    : curr(level.getCurr(), useMappedReads, blockCache, metrics)
+    , snap(level.getSnap(), useMappedReads, blockCache, metrics)
 {
 }
 
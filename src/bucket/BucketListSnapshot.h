@@ -22,7 +22,9 @@ struct BucketLevelSnapshot
     BucketSnapshot curr;
     BucketSnapshot snap;
 
-    BucketLevelSnapshot(BucketLevel const& level);
+    BucketLevelSnapshot(BucketLevel const& level, bool useMappedReads,
+                        BucketBlockCache* blockCache,
+                        BucketLevelMetrics const* metrics);
 };
 
 class BucketListSnapshot : public NonMovable
@@ -34,7 +36,13 @@ class BucketListSnapshot : public NonMovable
     uint32_t mLedgerSeq;
 
   public:
-    BucketListSnapshot(BucketList const& bl, uint32_t ledgerSeq);
+    // If useMappedReads is set, lookups on this snapshot (and any copies of
+    // it) read from memory mapped bucket files. If blockCache is not null,
+    // range index page reads go through the given cache. If levelMetrics is
+    // not null, it holds the lookup metrics of each of the kNumLevels levels.
+    BucketListSnapshot(BucketList const& bl, uint32_t ledgerSeq,
+                       bool useMappedReads, BucketBlockCache* blockCache,
+                       BucketLevelMetrics const* levelMetrics);
 
     // Only allow copies via constructor
     BucketListSnapshot(BucketListSnapshot const& snapshot);
@@ -68,6 +76,31 @@ class SearchableBucketListSnapshot : public NonMovableOrCopyable
     std::vector<LedgerEntry>
     loadKeysInternal(std::set<LedgerKey, LedgerEntryIdCmp> const& inKeys);
 
+    // Probes every bucket for inKeys concurrently, with the first bucket
+    // probed on the calling thread and the rest on the worker thread pool.
+    // Results are resolved newest bucket first, so the returned entries are
+    // identical to a sequential loadKeysInternal. Must be called by the main
+    // thread, as the worker threads must never block on the thread waiting on
+    // them.
+    std::vector<LedgerEntry>
+    loadKeysParallel(std::set<LedgerKey, LedgerEntryIdCmp> const& inKeys);
+
+    // Entries starting in [start.bucketFileOffset, end) of bucket are in a
+    // single eviction scan
+    struct EvictionScanRegion
+    {
+        BucketSnapshot const* bucket;
+        EvictionIterator start;
+        std::streamoff end;
+    };
+
+    // Collects the evictable entries of each region, returning a list per
+    // region. Regions are split across the eviction threads if there are
+    // several, otherwise they are collected on the calling thread.
+    std::vector<std::list<EvictionResultEntry>>
+    collectEvictableEntries(std::vector<EvictionScanRegion> const& regions,
+                            uint32_t ledgerSeq);
+
     // Loads bucket entry for LedgerKey k. Returns <LedgerEntry, bloomMiss>,
     // where bloomMiss is true if a bloom miss occurred during the load.
     std::pair<std::shared_ptr<LedgerEntry>, bool>
@@ -89,8 +122,16 @@ class SearchableBucketListSnapshot : public NonMovableOrCopyable
     std::vector<InflationWinner> loadInflationWinners(size_t maxWinners,
                                                       int64_t minBalance);
 
+    // Every live offer, by scanning the offer range of each bucket. For
+    // building an order book at startup, not for the ledger close path.
+    std::vector<LedgerEntry> loadAllOffers();
+
     std::shared_ptr<LedgerEntry> getLedgerEntry(LedgerKey const& k);
 
+    // Ledger of the underlying snapshot. Queries refresh the snapshot before
+    // they run, so after a query this is the ledger it was answered from.
+    uint32_t getLedgerSeq() const;
+
     EvictionResult scanForEviction(uint32_t ledgerSeq,
                                    EvictionCounters& counters,
                                    EvictionIterator evictionIter,
@@ -215,10 +215,14 @@ class BucketManager : NonMovableOrCopyable
     // This method is mostly-threadsafe -- assuming you don't destruct the
     // BucketManager mid-call -- and is intended to be called from both main and
     // worker threads. Very carefully.
+    //
+    // `inMemoryEntries`, if set, are the contents of `filename` and are kept
+    // by the new bucket; buckets that already exist are left as they are.
     virtual std::shared_ptr<Bucket>
-    adoptFileAsBucket(std::string const& filename, uint256 const& hash,
-                      MergeKey* mergeKey,
-                      std::unique_ptr<BucketIndex const> index) = 0;
+    adoptFileAsBucket(
+        std::string const& filename, uint256 const& hash, MergeKey* mergeKey,
+        std::unique_ptr<BucketIndex const> index,
+        std::shared_ptr<InMemoryBucketEntries const> inMemoryEntries) = 0;
 
     // Companion method to `adoptFileAsBucket` also called from the
     // `BucketOutputIterator::getBucket` merge-completion path. This method
@@ -375,6 +379,24 @@ class BucketManager : NonMovableOrCopyable
         std::function<bool(LedgerEntry const&)> const& filterEntry,
         std::function<bool(LedgerEntry const&)> const& acceptEntry) = 0;
 
+    // Visits every fresh alive entry of the bucket list described by `has`,
+    // like `visitLedgerEntries` without a filter, but reading the buckets on
+    // `numThreads` threads: a first pass collects the keys of each bucket, a
+    // second one visits the entries not shadowed by a newer bucket. Large
+    // buckets are split into ranges at index page boundaries, so that they
+    // are read in parallel too.
+    //
+    // `acceptEntry` is called concurrently, with the index of the calling
+    // thread in [0, numThreads), and in no particular order. If it returns
+    // `false` the iteration finishes once the other threads are done with the
+    // range they are reading, calling `acceptEntry` until then.
+    // Like `visitLedgerEntries`, this holds the keys of the whole bucket list
+    // in memory.
+    virtual void visitLedgerEntriesInParallel(
+        HistoryArchiveState const& has, size_t numThreads,
+        std::function<bool(size_t, LedgerEntry const&)> const&
+            acceptEntry) = 0;
+
     // Schedule a Work class that verifies the hashes of all referenced buckets
     // on background threads.
     virtual std::shared_ptr<BasicWork>
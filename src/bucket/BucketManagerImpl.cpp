@@ -11,7 +11,7 @@
 #include "bucket/BucketSnapshotManager.h"
 #include "crypto/Hex.h"
 #include "history/HistoryManager.h"
-#include "historywork/VerifyBucketWork.h"
+#include "historywork/VerifyBucketsWork.h"
 #include "ledger/LedgerManager.h"
 #include "ledger/LedgerTxn.h"
 #include "ledger/LedgerTypeUtils.h"
@@ -24,6 +24,7 @@
 #include "util/TmpDir.h"
 #include "util/types.h"
 #include "xdr/Stellar-ledger.h"
+#include <atomic>
 #include <filesystem>
 #include <fmt/chrono.h>
 #include <fmt/format.h>
@@ -123,10 +124,26 @@ BucketManagerImpl::initialize()
     {
         mBucketList = std::make_unique<BucketList>();
 
+        // Restore merges finished before the last shutdown whose outputs are
+        // still on disk. Restarted FutureBuckets reattach to these through
+        // getMergeFuture.
+        try
+        {
+            mFinishedMerges.load(d + "/" + kMergeMapFilename,
+                                 [this](Hash const& output) {
+                                     return fs::exists(bucketFilename(output));
+                                 });
+        }
+        catch (std::exception const& e)
+        {
+            CLOG_WARNING(Bucket, "Ignoring unreadable merge map: {}",
+                         e.what());
+        }
+
         if (mApp.getConfig().isUsingBucketListDB())
         {
             mSnapshotManager = std::make_unique<BucketSnapshotManager>(
-                mApp, std::make_unique<BucketListSnapshot>(*mBucketList, 0));
+                mApp, *mBucketList);
         }
     }
 }
@@ -178,6 +195,8 @@ BucketManagerImpl::BucketManagerImpl(Application& app)
           {"bucketlistDB", "bloom", "lookups"}, "bloom"))
     , mBucketListSizeCounter(
           app.getMetrics().NewCounter({"bucketlist", "size", "bytes"}))
+    , mBucketIndexBytesCounter(
+          app.getMetrics().NewCounter({"bucket", "memory", "index-bytes"}))
     , mBucketListEvictionCounters(app)
     , mEvictionStatistics(std::make_shared<EvictionStatistics>())
     // Minimal DB is stored in the buckets dir, so delete it only when
@@ -188,6 +207,7 @@ BucketManagerImpl::BucketManagerImpl(Application& app)
 }
 
 const std::string BucketManagerImpl::kLockFilename = "stellar-core.lock";
+const std::string BucketManagerImpl::kMergeMapFilename = "merge-map.json";
 
 namespace
 {
@@ -456,9 +476,10 @@ BucketManagerImpl::renameBucketDirFile(std::filesystem::path const& src,
 }
 
 std::shared_ptr<Bucket>
-BucketManagerImpl::adoptFileAsBucket(std::string const& filename,
-                                     uint256 const& hash, MergeKey* mergeKey,
-                                     std::unique_ptr<BucketIndex const> index)
+BucketManagerImpl::adoptFileAsBucket(
+    std::string const& filename, uint256 const& hash, MergeKey* mergeKey,
+    std::unique_ptr<BucketIndex const> index,
+    std::shared_ptr<InMemoryBucketEntries const> inMemoryEntries)
 {
     ZoneScoped;
     releaseAssertOrThrow(mApp.getConfig().MODE_ENABLES_BUCKETLIST);
@@ -516,7 +537,8 @@ BucketManagerImpl::adoptFileAsBucket(std::string const& filename,
             }
         }
 
-        b = std::make_shared<Bucket>(canonicalName, hash, std::move(index));
+        b = std::make_shared<Bucket>(canonicalName, hash, std::move(index),
+                                     std::move(inMemoryEntries));
         {
             mSharedBuckets.emplace(hash, b);
             mSharedBucketsSize.set_count(mSharedBuckets.size());
@@ -528,10 +550,39 @@ BucketManagerImpl::adoptFileAsBucket(std::string const& filename,
         // Second half of the mergeKey record-keeping, above: if we successfully
         // adopted (no throw), then (weakly) record the preimage of the hash.
         mFinishedMerges.recordMerge(*mergeKey, hash);
+        saveFinishedMerges();
     }
     return b;
 }
 
+void
+BucketManagerImpl::saveFinishedMerges()
+{
+    ZoneScoped;
+    std::lock_guard<std::recursive_mutex> lock(mBucketMutex);
+
+    // The merge map only saves redundant work, so failing to persist it is
+    // not fatal
+    try
+    {
+        auto tmpFilename = getTmpDir() + "/" + kMergeMapFilename;
+        mFinishedMerges.save(tmpFilename, [this](Hash const& output) {
+            return mSharedBuckets.find(output) != mSharedBuckets.end() ||
+                   fs::exists(bucketFilename(output));
+        });
+        if (!renameBucketDirFile(tmpFilename,
+                                 getBucketDir() + "/" + kMergeMapFilename))
+        {
+            CLOG_WARNING(Bucket, "Failed to rename merge map: {}",
+                         strerror(errno));
+        }
+    }
+    catch (std::exception const& e)
+    {
+        CLOG_WARNING(Bucket, "Failed to save merge map: {}", e.what());
+    }
+}
+
 void
 BucketManagerImpl::noteEmptyMergeOutput(MergeKey const& mergeKey)
 {
@@ -723,10 +774,16 @@ BucketManagerImpl::getAllReferencedBuckets() const
     auto lclBuckets = lclHas.allBuckets();
     for (auto const& h : lclBuckets)
     {
-        auto rit = referenced.emplace(hexToBin256(h));
+        auto rhash = hexToBin256(h);
+        auto rit = referenced.emplace(rhash);
         if (rit.second)
         {
             CLOG_TRACE(Bucket, "{} referenced by LCL", h);
+
+            // Retain outputs of finished merges of LCL buckets, which include
+            // merges that were still in progress when the LCL was recorded. A
+            // restart from the LCL can then reattach to them.
+            mFinishedMerges.getOutputsUsingInput(rhash, referenced);
         }
     }
 
@@ -902,11 +959,21 @@ BucketManagerImpl::addBatch(Application& app, uint32_t currLedger,
     mBucketList->addBatch(app, currLedger, currLedgerProtocol, initEntries,
                           liveEntries, deadEntries);
     mBucketListSizeCounter.set_count(mBucketList->getSize());
+    {
+        // Indexes of all buckets still referenced, merge outputs and
+        // snapshots included
+        std::lock_guard<std::recursive_mutex> lock(mBucketMutex);
+        size_t indexBytes = 0;
+        for (auto const& [hash, bucket] : mSharedBuckets)
+        {
+            indexBytes += bucket->getIndexMemoryUsage();
+        }
+        mBucketIndexBytesCounter.set_count(static_cast<int64_t>(indexBytes));
+    }
 
     if (app.getConfig().isUsingBucketListDB())
     {
-        mSnapshotManager->updateCurrentSnapshot(
-            std::make_unique<BucketListSnapshot>(*mBucketList, currLedger));
+        mSnapshotManager->updateCurrentSnapshot(*mBucketList, currLedger);
     }
 }
 
@@ -1006,9 +1073,9 @@ BucketManagerImpl::startBackgroundEvictionScan(uint32_t ledgerSeq)
         });
 
     mEvictionFuture = task->get_future();
-    mApp.postOnEvictionBackgroundThread(
-        bind(&task_t::operator(), task),
-        "SearchableBucketListSnapshot: eviction scan");
+    mApp.postOnBackgroundThread(bind(&task_t::operator(), task),
+                                "SearchableBucketListSnapshot: eviction scan",
+                                WorkerPriority::CRITICAL);
 }
 
 void
@@ -1194,9 +1261,8 @@ BucketManagerImpl::assumeState(HistoryArchiveState const& has,
 
     if (mApp.getConfig().isUsingBucketListDB())
     {
-        mSnapshotManager->updateCurrentSnapshot(
-            std::make_unique<BucketListSnapshot>(*mBucketList,
-                                                 has.currentLedger));
+        mSnapshotManager->updateCurrentSnapshot(*mBucketList,
+                                                has.currentLedger);
     }
     cleanupStaleFiles();
 }
@@ -1329,7 +1395,6 @@ visitEntriesInBucket(std::shared_ptr<Bucket const> b, std::string const& name,
     using namespace std::chrono;
     medida::Timer timer;
 
-    UnorderedMap<LedgerKey, LedgerEntry> bucketEntries;
     bool stopIteration = false;
     timer.Time([&]() {
         for (BucketInputIterator in(b); in; ++in)
@@ -1337,6 +1402,14 @@ visitEntriesInBucket(std::shared_ptr<Bucket const> b, std::string const& name,
             BucketEntry const& e = *in;
             if (e.type() == LIVEENTRY || e.type() == INITENTRY)
             {
+                // Keys are unique within a bucket, so an entry is fresh iff
+                // no newer bucket had its key. Entries the filter rejects
+                // still shadow older versions, which may well match it.
+                if (!processedEntries.insert(LedgerEntryKey(e.liveEntry()))
+                         .second)
+                {
+                    continue;
+                }
                 if (minLedger &&
                     e.liveEntry().lastModifiedLedgerSeq < *minLedger)
                 {
@@ -1347,12 +1420,11 @@ visitEntriesInBucket(std::shared_ptr<Bucket const> b, std::string const& name,
                 {
                     continue;
                 }
-                auto key = LedgerEntryKey(e.liveEntry());
-                if (processedEntries.find(key) != processedEntries.end())
+                if (!acceptEntry(e.liveEntry()))
                 {
-                    continue;
+                    stopIteration = true;
+                    break;
                 }
-                bucketEntries[key] = e.liveEntry();
             }
             else
             {
@@ -1363,19 +1435,9 @@ visitEntriesInBucket(std::shared_ptr<Bucket const> b, std::string const& name,
                     CLOG_ERROR(Bucket, "{}", err);
                     throw std::runtime_error(err);
                 }
-                bucketEntries.erase(e.deadEntry());
                 processedEntries.insert(e.deadEntry());
             }
         }
-        for (auto const& [key, entry] : bucketEntries)
-        {
-            processedEntries.insert(key);
-            if (!acceptEntry(entry))
-            {
-                stopIteration = true;
-                break;
-            }
-        }
     });
     nanoseconds ns =
         timer.duration_unit() * static_cast<nanoseconds::rep>(timer.max());
@@ -1431,11 +1493,233 @@ BucketManagerImpl::visitLedgerEntries(
               std::chrono::duration_cast<std::chrono::milliseconds>(ns));
 }
 
+namespace
+{
+// Ranges of a bucket file read by one job of visitLedgerEntriesInParallel
+std::streamoff const PARALLEL_SCAN_RANGE_BYTES = 64 * 1024 * 1024;
+
+struct BucketRange
+{
+    size_t mBucket;
+    // Offset of the first entry in the range, or 0 for the start of the file
+    std::streamoff mBegin;
+    std::streamoff mEnd;
+};
+
+// Runs job(thread, i) for every i in [0, n) on numThreads threads, each
+// taking the next i until there are none left or a job returns false.
+// Rethrows the first exception a job threw.
+void
+runInParallel(size_t n, size_t numThreads,
+              std::function<bool(size_t, size_t)> const& job)
+{
+    std::atomic<size_t> next{0};
+    std::atomic<bool> stop{false};
+    std::vector<std::exception_ptr> errors(numThreads);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < numThreads; ++t)
+    {
+        threads.emplace_back([&, t]() {
+            try
+            {
+                size_t i;
+                while (!stop && (i = next++) < n)
+                {
+                    if (!job(t, i))
+                    {
+                        stop = true;
+                    }
+                }
+            }
+            catch (...)
+            {
+                errors[t] = std::current_exception();
+                stop = true;
+            }
+        });
+    }
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+    for (auto const& e : errors)
+    {
+        if (e)
+        {
+            std::rethrow_exception(e);
+        }
+    }
+}
+
+// Calls f on every entry starting in [range.mBegin, range.mEnd) until it
+// returns false
+template <typename F>
+void
+forEachEntryInRange(std::shared_ptr<Bucket const> const& b,
+                    BucketRange const& range, F f)
+{
+    BucketInputIterator in(b, /*streamingIO=*/true);
+    if (range.mBegin != 0)
+    {
+        in.seek(range.mBegin);
+    }
+    // Entry positions are only known through the stream position after
+    // reading them: what the condition checks is where the current entry
+    // starts.
+    for (auto start = range.mBegin; in && start < range.mEnd; ++in)
+    {
+        start = in.pos();
+        BucketEntry const& e = *in;
+        if (e.type() != LIVEENTRY && e.type() != INITENTRY &&
+            e.type() != DEADENTRY)
+        {
+            throw std::runtime_error(
+                "Malformed bucket: unexpected non-INIT/LIVE/DEAD entry.");
+        }
+        if (!f(e))
+        {
+            break;
+        }
+    }
+}
+}
+
+void
+BucketManagerImpl::visitLedgerEntriesInParallel(
+    HistoryArchiveState const& has, size_t numThreads,
+    std::function<bool(size_t, LedgerEntry const&)> const& acceptEntry)
+{
+    ZoneScoped;
+    releaseAssert(numThreads > 0);
+    auto start = std::chrono::steady_clock::now();
+
+    // Buckets newest first, split into ranges starting at indexed offsets,
+    // which are entry boundaries
+    std::vector<std::shared_ptr<Bucket const>> buckets;
+    std::vector<BucketRange> ranges;
+    for (uint32_t i = 0; i < BucketList::kNumLevels; ++i)
+    {
+        HistoryStateBucket const& hsb = has.currentBuckets.at(i);
+        for (auto const& hash : {hsb.curr, hsb.snap})
+        {
+            auto h = hexToBin256(hash);
+            if (isZero(h))
+            {
+                continue;
+            }
+            auto b = getBucketByHash(h);
+            if (!b)
+            {
+                throw std::runtime_error(std::string("missing bucket: ") +
+                                         binToHex(h));
+            }
+            if (b->isEmpty())
+            {
+                continue;
+            }
+            auto size = static_cast<std::streamoff>(b->getSize());
+            std::streamoff begin = 0;
+            if (b->isIndexed())
+            {
+                for (auto pos = PARALLEL_SCAN_RANGE_BYTES; pos < size;
+                     pos += PARALLEL_SCAN_RANGE_BYTES)
+                {
+                    auto end = b->getIndex().getIndexedOffsetAtOrBefore(pos);
+                    if (end > begin)
+                    {
+                        ranges.push_back({buckets.size(), begin, end});
+                        begin = end;
+                    }
+                }
+            }
+            ranges.push_back({buckets.size(), begin, size});
+            buckets.emplace_back(b);
+        }
+    }
+    if (buckets.empty())
+    {
+        return;
+    }
+
+    // First pass: the keys of every bucket but the oldest, which shadows
+    // nothing, per range then merged per bucket.
+    size_t numKeyedRanges = 0;
+    while (numKeyedRanges < ranges.size() &&
+           ranges[numKeyedRanges].mBucket + 1 < buckets.size())
+    {
+        ++numKeyedRanges;
+    }
+    std::vector<UnorderedSet<LedgerKey>> rangeKeys(numKeyedRanges);
+    runInParallel(numKeyedRanges, numThreads, [&](size_t, size_t r) {
+        auto& keys = rangeKeys[r];
+        forEachEntryInRange(
+            buckets[ranges[r].mBucket], ranges[r], [&](BucketEntry const& e) {
+                keys.emplace(e.type() == DEADENTRY
+                                 ? e.deadEntry()
+                                 : LedgerEntryKey(e.liveEntry()));
+                return true;
+            });
+        return true;
+    });
+    std::vector<UnorderedSet<LedgerKey>> bucketKeys(buckets.size() - 1);
+    runInParallel(bucketKeys.size(), numThreads, [&](size_t, size_t i) {
+        for (size_t r = 0; r < numKeyedRanges; ++r)
+        {
+            if (ranges[r].mBucket != i)
+            {
+                continue;
+            }
+            if (bucketKeys[i].empty())
+            {
+                bucketKeys[i] = std::move(rangeKeys[r]);
+            }
+            else
+            {
+                bucketKeys[i].insert(rangeKeys[r].begin(), rangeKeys[r].end());
+                UnorderedSet<LedgerKey>().swap(rangeKeys[r]);
+            }
+        }
+        return true;
+    });
+    CLOG_INFO(Bucket, "Collected keys of {} buckets ({} ranges) in {}",
+              bucketKeys.size(), numKeyedRanges,
+              std::chrono::duration_cast<std::chrono::milliseconds>(
+                  std::chrono::steady_clock::now() - start));
+
+    // Second pass: the live entries that no newer bucket shadows
+    runInParallel(ranges.size(), numThreads, [&](size_t thread, size_t r) {
+        auto const& range = ranges[r];
+        bool keepGoing = true;
+        forEachEntryInRange(
+            buckets[range.mBucket], range, [&](BucketEntry const& e) {
+                if (e.type() == DEADENTRY)
+                {
+                    return true;
+                }
+                auto key = LedgerEntryKey(e.liveEntry());
+                for (size_t i = 0; i < range.mBucket; ++i)
+                {
+                    if (bucketKeys[i].find(key) != bucketKeys[i].end())
+                    {
+                        return true;
+                    }
+                }
+                keepGoing = acceptEntry(thread, e.liveEntry());
+                return keepGoing;
+            });
+        return keepGoing;
+    });
+    CLOG_INFO(Bucket, "Total parallel ledger processing time: {}",
+              std::chrono::duration_cast<std::chrono::milliseconds>(
+                  std::chrono::steady_clock::now() - start));
+}
+
 std::shared_ptr<BasicWork>
 BucketManagerImpl::scheduleVerifyReferencedBucketsWork()
 {
     std::set<Hash> hashes = getAllReferencedBuckets();
-    std::vector<std::shared_ptr<BasicWork>> seq;
+    std::vector<std::pair<std::string, uint256>> buckets;
+    size_t totalSize = 0;
     for (auto const& h : hashes)
     {
         if (isZero(h))
@@ -1448,11 +1732,15 @@ BucketManagerImpl::scheduleVerifyReferencedBucketsWork()
             throw std::runtime_error(fmt::format(
                 FMT_STRING("Missing referenced bucket {}"), binToHex(h)));
         }
-        seq.emplace_back(std::make_shared<VerifyBucketWork>(
-            mApp, b->getFilename().string(), b->getHash(), nullptr));
+        buckets.emplace_back(b->getFilename().string(), b->getHash());
+        totalSize += b->getSize();
     }
-    return mApp.getWorkScheduler().scheduleWork<WorkSequence>(
-        "verify-referenced-buckets", seq);
+    auto const& cfg = mApp.getConfig();
+    CLOG_INFO(Bucket, "Verifying {} referenced buckets ({} bytes)",
+              buckets.size(), totalSize);
+    return mApp.getWorkScheduler().scheduleWork<VerifyBucketsWork>(
+        buckets, cfg.SELF_CHECK_MAX_CONCURRENT_BUCKETS,
+        cfg.SELF_CHECK_MAX_READ_BYTES_PER_SECOND);
 }
 
 Config const&
@@ -36,6 +36,7 @@ struct HistoryArchiveState;
 class BucketManagerImpl : public BucketManager
 {
     static std::string const kLockFilename;
+    static std::string const kMergeMapFilename;
 
     Application& mApp;
     std::unique_ptr<BucketList> mBucketList;
@@ -56,6 +57,7 @@ class BucketManagerImpl : public BucketManager
     medida::Meter& mBucketListDBBloomMisses;
     medida::Meter& mBucketListDBBloomLookups;
     medida::Counter& mBucketListSizeCounter;
+    medida::Counter& mBucketIndexBytesCounter;
     EvictionCounters mBucketListEvictionCounters;
     MergeCounters mMergeCounters;
     std::shared_ptr<EvictionStatistics> mEvictionStatistics{};
@@ -82,6 +84,10 @@ class BucketManagerImpl : public BucketManager
     std::atomic<bool> mIsShutdown{false};
 
     void cleanupStaleFiles();
+
+    // Persists mFinishedMerges under the bucket dir, so that merges finished
+    // before a restart can be reattached to instead of being redone
+    void saveFinishedMerges();
     void deleteTmpDirAndUnlockBucketDir();
     void deleteEntireBucketDir();
 
@@ -116,10 +122,10 @@ class BucketManagerImpl : public BucketManager
     TmpDirManager& getTmpDirManager() override;
     bool renameBucketDirFile(std::filesystem::path const& src,
                              std::filesystem::path const& dst) override;
-    std::shared_ptr<Bucket>
-    adoptFileAsBucket(std::string const& filename, uint256 const& hash,
-                      MergeKey* mergeKey,
-                      std::unique_ptr<BucketIndex const> index) override;
+    std::shared_ptr<Bucket> adoptFileAsBucket(
+        std::string const& filename, uint256 const& hash, MergeKey* mergeKey,
+        std::unique_ptr<BucketIndex const> index,
+        std::shared_ptr<InMemoryBucketEntries const> inMemoryEntries) override;
     void noteEmptyMergeOutput(MergeKey const& mergeKey) override;
     std::shared_ptr<Bucket> getBucketIfExists(uint256 const& hash) override;
     std::shared_ptr<Bucket> getBucketByHash(uint256 const& hash) override;
@@ -184,6 +190,11 @@ class BucketManagerImpl : public BucketManager
         std::function<bool(LedgerEntry const&)> const& filterEntry,
         std::function<bool(LedgerEntry const&)> const& acceptEntry) override;
 
+    void visitLedgerEntriesInParallel(
+        HistoryArchiveState const& has, size_t numThreads,
+        std::function<bool(size_t, LedgerEntry const&)> const& acceptEntry)
+        override;
+
     std::shared_ptr<BasicWork> scheduleVerifyReferencedBucketsWork() override;
 
     Config const& getConfig() const override;
@@ -7,9 +7,34 @@
 #include "util/GlobalChecks.h"
 #include "util/Logging.h"
 #include <Tracy.hpp>
+#include <cereal/archives/json.hpp>
+#include <cereal/types/string.hpp>
+#include <cereal/types/vector.hpp>
+#include <fmt/format.h>
+#include <fstream>
 
 namespace
 {
+// Persisted form of a single merge, with hashes in hex
+struct PersistedMerge
+{
+    bool keepDeadEntries{};
+    std::string curr;
+    std::string snap;
+    std::vector<std::string> shadows;
+    std::string output;
+
+    template <class Archive>
+    void
+    serialize(Archive& ar)
+    {
+        ar(CEREAL_NVP(keepDeadEntries), CEREAL_NVP(curr), CEREAL_NVP(snap),
+           CEREAL_NVP(shadows), CEREAL_NVP(output));
+    }
+};
+
+uint32_t const MERGE_MAP_VERSION = 1;
+
 stellar::UnorderedSet<stellar::Hash>
 getMergeKeyHashes(stellar::MergeKey const& key)
 {
@@ -116,6 +141,88 @@ BucketMergeMap::findMergeFor(MergeKey const& input, Hash& output)
     return false;
 }
 
+void
+BucketMergeMap::save(std::string const& filename,
+                     std::function<bool(Hash const&)> const& keep) const
+{
+    ZoneScoped;
+    std::vector<PersistedMerge> merges;
+    for (auto const& [key, output] : mMergeKeyToOutput)
+    {
+        if (!keep(output))
+        {
+            continue;
+        }
+
+        PersistedMerge m;
+        m.keepDeadEntries = key.mKeepDeadEntries;
+        m.curr = binToHex(key.mInputCurrBucket);
+        m.snap = binToHex(key.mInputSnapBucket);
+        for (auto const& s : key.mInputShadowBuckets)
+        {
+            m.shadows.emplace_back(binToHex(s));
+        }
+        m.output = binToHex(output);
+        merges.emplace_back(std::move(m));
+    }
+
+    std::ofstream out;
+    out.exceptions(std::ios::failbit | std::ios::badbit);
+    out.open(filename);
+    cereal::JSONOutputArchive ar(out);
+    auto version = MERGE_MAP_VERSION;
+    ar(CEREAL_NVP(version), CEREAL_NVP(merges));
+}
+
+void
+BucketMergeMap::load(std::string const& filename,
+                     std::function<bool(Hash const&)> const& keep)
+{
+    ZoneScoped;
+    std::ifstream in(filename);
+    if (!in)
+    {
+        return;
+    }
+
+    in.exceptions(std::ios::badbit);
+    uint32_t version{};
+    std::vector<PersistedMerge> merges;
+    {
+        cereal::JSONInputArchive ar(in);
+        ar(CEREAL_NVP(version));
+        if (version != MERGE_MAP_VERSION)
+        {
+            throw std::runtime_error(
+                fmt::format(FMT_STRING("Unexpected merge map version {} in {}"),
+                            version, filename));
+        }
+        ar(CEREAL_NVP(merges));
+    }
+
+    for (auto const& m : merges)
+    {
+        auto output = hexToBin256(m.output);
+        if (!keep(output))
+        {
+            continue;
+        }
+
+        std::vector<Hash> shadows;
+        for (auto const& s : m.shadows)
+        {
+            shadows.emplace_back(hexToBin256(s));
+        }
+        MergeKey key(m.keepDeadEntries, hexToBin256(m.curr),
+                     hexToBin256(m.snap), shadows);
+        Hash existing;
+        if (!findMergeFor(key, existing))
+        {
+            recordMerge(key, output);
+        }
+    }
+}
+
 void
 BucketMergeMap::getOutputsUsingInput(Hash const& input,
                                      std::set<Hash>& outputs) const
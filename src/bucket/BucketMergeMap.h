@@ -5,7 +5,9 @@
 #include "util/UnorderedMap.h"
 #include "util/UnorderedSet.h"
 #include "xdr/Stellar-types.h"
+#include <functional>
 #include <set>
+#include <string>
 
 // Copyright 2019 Stellar Development Foundation and contributors. Licensed
 // under the Apache License, Version 2.0. See the COPYING file at the root
@@ -45,5 +47,15 @@ class BucketMergeMap
     UnorderedSet<MergeKey> forgetAllMergesProducing(Hash const& output);
     bool findMergeFor(MergeKey const& input, Hash& output);
     void getOutputsUsingInput(Hash const& input, std::set<Hash>& outputs) const;
+
+    // Writes every recorded merge whose output satisfies keep to filename,
+    // so the map can be restored after a restart
+    void save(std::string const& filename,
+              std::function<bool(Hash const&)> const& keep) const;
+
+    // Records every merge saved in filename whose output satisfies keep. A
+    // missing file is treated as empty.
+    void load(std::string const& filename,
+              std::function<bool(Hash const&)> const& keep);
 };
 }
@@ -6,6 +6,7 @@
 #include "bucket/Bucket.h"
 #include "bucket/BucketIndex.h"
 #include "bucket/BucketManager.h"
+#include "bucket/RawBucketEntry.h"
 #include "util/GlobalChecks.h"
 #include <Tracy.hpp>
 #include <filesystem>
@@ -47,6 +48,67 @@ BucketOutputIterator::BucketOutputIterator(std::string const& tmpDir,
     }
 }
 
+BucketOutputIterator::~BucketOutputIterator()
+{
+}
+
+void
+BucketOutputIterator::indexWhileWriting(BucketManager& bm,
+                                        size_t estimatedFileSize)
+{
+    releaseAssert(!mIndexBuilder);
+    releaseAssert(mObjectsPut == 0);
+    mIndexBuilder = BucketIndex::createBuilder(bm, estimatedFileSize);
+}
+
+void
+BucketOutputIterator::useStreamingIO()
+{
+    // 64 MB between drops keeps the dirty backlog small while still letting
+    // the kernel write back in large, contiguous chunks
+    mOut.dropCacheWhileWriting(64 * 1024 * 1024);
+}
+
+void
+BucketOutputIterator::keepInMemory(size_t maxFileSize)
+{
+    releaseAssert(!mInMemoryEntries);
+    releaseAssert(mObjectsPut == 0);
+    mInMemoryEntries = std::make_shared<InMemoryBucketEntries>();
+    mInMemoryMaxSize = maxFileSize;
+}
+
+void
+BucketOutputIterator::keepWrittenEntry(BucketEntry const& e,
+                                       std::streamoff pos)
+{
+    if (!mInMemoryEntries)
+    {
+        return;
+    }
+    if (mBytesPut > mInMemoryMaxSize)
+    {
+        mInMemoryEntries.reset();
+        return;
+    }
+    mInMemoryEntries->mEntries.emplace_back(e);
+    mInMemoryEntries->mOffsets.emplace_back(pos);
+}
+
+void
+BucketOutputIterator::writeBufferedEntry()
+{
+    releaseAssert(mBuf);
+    auto pos = static_cast<std::streamoff>(mBytesPut);
+    mOut.writeOne(*mBuf, &mHasher, &mBytesPut);
+    mObjectsPut++;
+    if (mIndexBuilder)
+    {
+        mIndexBuilder->add(*mBuf, pos);
+    }
+    keepWrittenEntry(*mBuf, pos);
+}
+
 void
 BucketOutputIterator::put(BucketEntry const& e)
 {
@@ -79,8 +141,7 @@ BucketOutputIterator::put(BucketEntry const& e)
         if (mCmp(*mBuf, e))
         {
             ++mMergeCounters.mOutputIteratorActualWrites;
-            mOut.writeOne(*mBuf, &mHasher, &mBytesPut);
-            mObjectsPut++;
+            writeBufferedEntry();
         }
     }
     else
@@ -93,6 +154,52 @@ BucketOutputIterator::put(BucketEntry const& e)
     *mBuf = e;
 }
 
+void
+BucketOutputIterator::putRaw(RawBucketEntry const& e)
+{
+    ZoneScoped;
+    releaseAssert(e.type != METAENTRY);
+    if (!mKeepDeadEntries && e.type == DEADENTRY)
+    {
+        ++mMergeCounters.mOutputIteratorTombstoneElisions;
+        return;
+    }
+
+    // The only entry that can be buffered is the initial METAENTRY
+    if (mBuf)
+    {
+        releaseAssert(mBuf->type() == METAENTRY);
+        writeBufferedEntry();
+        mBuf.reset();
+    }
+
+    ++mMergeCounters.mOutputIteratorBufferUpdates;
+    ++mMergeCounters.mOutputIteratorActualWrites;
+    auto pos = static_cast<std::streamoff>(mBytesPut);
+    mOut.writeRaw(e.bytes.data(), e.bytes.size(), &mHasher, &mBytesPut);
+    mObjectsPut++;
+
+    if (mIndexBuilder)
+    {
+        if (e.type == INITENTRY && e.key.type() == LIQUIDITY_POOL)
+        {
+            BucketEntry be;
+            e.decode(be);
+            mIndexBuilder->add(be, pos);
+        }
+        else
+        {
+            mIndexBuilder->addKey(e.key, pos);
+        }
+    }
+    if (mInMemoryEntries)
+    {
+        BucketEntry be;
+        e.decode(be);
+        keepWrittenEntry(be, pos);
+    }
+}
+
 std::shared_ptr<Bucket>
 BucketOutputIterator::getBucket(BucketManager& bucketManager,
                                 bool shouldSynchronouslyIndex,
@@ -101,8 +208,7 @@ BucketOutputIterator::getBucket(BucketManager& bucketManager,
     ZoneScoped;
     if (mBuf)
     {
-        mOut.writeOne(*mBuf, &mHasher, &mBytesPut);
-        mObjectsPut++;
+        writeBufferedEntry();
         mBuf.reset();
     }
 
@@ -122,6 +228,10 @@ BucketOutputIterator::getBucket(BucketManager& bucketManager,
 
     auto hash = mHasher.finish();
     std::unique_ptr<BucketIndex const> index{};
+    if (mInMemoryEntries)
+    {
+        mInMemoryEntries->mFileSize = mBytesPut;
+    }
 
     // If this bucket needs to be indexed and is not already indexed
     if (shouldSynchronouslyIndex)
@@ -131,11 +241,34 @@ BucketOutputIterator::getBucket(BucketManager& bucketManager,
         if (auto b = bucketManager.getBucketIfExists(hash);
             !b || !b->isIndexed())
         {
-            index = BucketIndex::createIndex(bucketManager, mFilename, hash);
+            // Entries kept in memory can be indexed without reading the
+            // file back
+            if (!mIndexBuilder && mInMemoryEntries)
+            {
+                mIndexBuilder =
+                    BucketIndex::createBuilder(bucketManager, mBytesPut);
+                auto const& entries = mInMemoryEntries->mEntries;
+                for (size_t i = 0; i < entries.size(); ++i)
+                {
+                    mIndexBuilder->add(entries[i],
+                                       mInMemoryEntries->mOffsets[i]);
+                }
+            }
+            if (mIndexBuilder)
+            {
+                index = mIndexBuilder->finish(hash, mBytesPut);
+            }
+
+            if (!index)
+            {
+                index =
+                    BucketIndex::createIndex(bucketManager, mFilename, hash);
+            }
         }
     }
 
     return bucketManager.adoptFileAsBucket(mFilename.string(), hash, mergeKey,
-                                           std::move(index));
+                                           std::move(index),
+                                           std::move(mInMemoryEntries));
 }
 }
@@ -16,6 +16,9 @@ namespace stellar
 {
 
 class Bucket;
+class BucketIndexBuilder;
+struct InMemoryBucketEntries;
+struct RawBucketEntry;
 class BucketManager;
 
 // Helper class that writes new elements to a file and returns a bucket
@@ -34,6 +37,12 @@ class BucketOutputIterator
     BucketMetadata mMeta;
     bool mPutMeta{false};
     MergeCounters& mMergeCounters;
+    std::unique_ptr<BucketIndexBuilder> mIndexBuilder{};
+    std::shared_ptr<InMemoryBucketEntries> mInMemoryEntries{};
+    size_t mInMemoryMaxSize{0};
+
+    void writeBufferedEntry();
+    void keepWrittenEntry(BucketEntry const& e, std::streamoff pos);
 
   public:
     // BucketOutputIterators must _always_ be constructed with BucketMetadata,
@@ -47,8 +56,32 @@ class BucketOutputIterator
                          BucketMetadata const& meta, MergeCounters& mc,
                          asio::io_context& ctx, bool doFsync);
 
+    ~BucketOutputIterator();
+
+    // Builds the index of the output bucket as entries are written, so that
+    // getBucket does not need a second pass over the file. estimatedFileSize
+    // should be an upper bound on the output file size. Must be called before
+    // any entry is put.
+    void indexWhileWriting(BucketManager& bm, size_t estimatedFileSize);
+
+    // Drops the output file from the page cache as it is written, see
+    // XDROutputFileStream::dropCacheWhileWriting. Used for large merges whose
+    // output would otherwise push hotter bucket pages out of the cache.
+    void useStreamingIO();
+
+    // Keeps the entries written in memory, for the bucket to read them from
+    // there rather than from its file, unless the file grows past maxFileSize
+    // bytes. Must be called before any entry is put.
+    void keepInMemory(size_t maxFileSize);
+
     void put(BucketEntry const& e);
 
+    // Writes e as is, without decoding or re-encoding it. Unlike put, entries
+    // are not buffered, so each call must have a strictly greater key than the
+    // previous call. Must not be mixed with put, other than the METAENTRY
+    // written on construction.
+    void putRaw(RawBucketEntry const& e);
+
     std::shared_ptr<Bucket> getBucket(BucketManager& bucketManager,
                                       bool shouldSynchronouslyIndex,
                                       MergeKey* mergeKey = nullptr);
@@ -4,25 +4,71 @@
 
 #include "bucket/BucketSnapshot.h"
 #include "bucket/Bucket.h"
+#include "bucket/BucketBlockCache.h"
 #include "bucket/BucketListSnapshot.h"
 #include "ledger/LedgerTxn.h"
 #include "ledger/LedgerTypeUtils.h"
 #include "util/XDRStream.h"
 
+#include "medida/histogram.h"
+#include "medida/meter.h"
+#include "medida/timer.h"
+
+#include <algorithm>
+#include <chrono>
+
 namespace stellar
 {
-BucketSnapshot::BucketSnapshot(std::shared_ptr<Bucket const> const b)
+void
+BucketLevelMetrics::markFound(LedgerKey const& k) const
+{
+    auto it = mFoundLevel.find(k.type());
+    if (it != mFoundLevel.end())
+    {
+        it->second.Update(mLevel);
+    }
+}
+
+BucketSnapshot::BucketSnapshot(std::shared_ptr<Bucket const> const b,
+                               bool useMappedReads,
+                               BucketBlockCache* blockCache,
+                               BucketLevelMetrics const* metrics)
     : mBucket(b)
+    , mUseMappedReads(useMappedReads)
+    , mBlockCache(blockCache)
+    , mMetrics(metrics)
 {
     releaseAssert(mBucket);
 }
 
 BucketSnapshot::BucketSnapshot(BucketSnapshot const& b)
-    : mBucket(b.mBucket), mStream(nullptr)
+    : mBucket(b.mBucket)
+    , mUseMappedReads(b.mUseMappedReads)
+    , mBlockCache(b.mBlockCache)
+    , mMetrics(b.mMetrics)
+    , mStream(nullptr)
+    , mMappedFile(nullptr)
 {
     releaseAssert(mBucket);
 }
 
+// Reads the entry at file offset pos if pageSize == 0, otherwise scans the page
+// starting at pos for k. Works for both XDRInputFileStream and
+// XDRInputMappedFile.
+template <typename StreamT>
+static bool
+readEntryAtOffset(StreamT& stream, LedgerKey const& k, std::streamoff pos,
+                  size_t pageSize, BucketEntry& be)
+{
+    stream.seek(pos);
+    if (pageSize == 0)
+    {
+        return stream.readOne(be);
+    }
+
+    return stream.readPage(be, k, pageSize);
+}
+
 bool
 BucketSnapshot::isEmpty() const
 {
@@ -40,24 +86,75 @@ BucketSnapshot::getEntryAtOffset(LedgerKey const& k, std::streamoff pos,
         return {std::nullopt, false};
     }
 
-    auto& stream = getStream();
-    stream.seek(pos);
+    if (mMetrics)
+    {
+        mMetrics->mBloomPasses.Mark();
+    }
+
+    // Bytes read from the bucket file, which is a whole page on the range
+    // index paths and just the entry on the individual index paths
+    size_t bytesRead = 0;
+    auto readTimeStart = std::chrono::steady_clock::now();
 
     BucketEntry be;
-    if (pageSize == 0)
+    bool found;
+    if (auto const& inMemory = mBucket->getInMemoryEntries())
+    {
+        found = inMemory->find(k, pos, pageSize, be);
+    }
+    else if (mUseMappedReads)
+    {
+        found = readEntryAtOffset(getMappedFile(), k, pos, pageSize, be);
+        bytesRead = pageSize;
+    }
+    else if (mBlockCache && pageSize != 0)
     {
-        if (stream.readOne(be))
+        auto page = mBlockCache->get(mBucket->getHash(), pos);
+        if (!page)
         {
-            return {std::make_optional(be), false};
+            bytesRead = pageSize;
+            auto& stream = getStream();
+            stream.seek(pos);
+            auto buf = std::make_shared<std::vector<char>>();
+            stream.readPageBytes(*buf, pageSize);
+            page = buf;
+            mBlockCache->put(mBucket->getHash(), pos, page);
         }
+
+        found = XDRInputFileStream::findInPage(*page, 0, pageSize, k, be);
+    }
+    else
+    {
+        found = readEntryAtOffset(getStream(), k, pos, pageSize, be);
+        bytesRead = pageSize;
     }
-    else if (stream.readPage(be, k, pageSize))
+
+    if (mMetrics)
     {
+        if (pageSize == 0 && found && !mBucket->getInMemoryEntries())
+        {
+            bytesRead = xdr::xdr_size(be) + 4;
+        }
+        mMetrics->mReadTime.Update(std::chrono::steady_clock::now() -
+                                   readTimeStart);
+        mMetrics->mBytesRead.Mark(bytesRead);
+    }
+
+    if (found)
+    {
+        if (mMetrics)
+        {
+            mMetrics->markFound(k);
+        }
         return {std::make_optional(be), false};
     }
 
     // Mark entry miss for metrics
     mBucket->getIndex().markBloomMiss();
+    if (mMetrics)
+    {
+        mMetrics->mBloomMisses.Mark();
+    }
     return {std::nullopt, true};
 }
 
@@ -70,6 +167,11 @@ BucketSnapshot::getBucketEntry(LedgerKey const& k) const
         return {std::nullopt, false};
     }
 
+    if (mMetrics)
+    {
+        mMetrics->mLookups.Mark();
+    }
+
     auto pos = mBucket->getIndex().lookup(k);
     if (pos.has_value())
     {
@@ -81,10 +183,13 @@ BucketSnapshot::getBucketEntry(LedgerKey const& k) const
 }
 
 // When searching for an entry, BucketList calls this function on every bucket.
-// Since the input is sorted, we do a binary search for the first key in keys.
-// If we find the entry, we remove the found key from keys so that later buckets
-// do not load shadowed entries. If we don't find the entry, we do not remove it
-// from keys so that it will be searched for again at a lower level.
+// All keys are first resolved to file offsets with a single pass over the
+// index. Since the input is sorted, offsets are non-decreasing, so the bucket
+// file is then read front to back, with keys on the same or adjacent pages
+// served from a single read. If we find the entry, we remove the found key from
+// keys so that later buckets do not load shadowed entries. If we don't find the
+// entry, we do not remove it from keys so that it will be searched for again
+// at a lower level.
 void
 BucketSnapshot::loadKeys(std::set<LedgerKey, LedgerEntryIdCmp>& keys,
                          std::vector<LedgerEntry>& result) const
@@ -95,30 +200,110 @@ BucketSnapshot::loadKeys(std::set<LedgerKey, LedgerEntryIdCmp>& keys,
         return;
     }
 
-    auto currKeyIt = keys.begin();
     auto const& index = mBucket->getIndex();
-    auto indexIter = index.begin();
-    while (currKeyIt != keys.end() && indexIter != index.end())
+    auto const pageSize = index.getPageSize();
+    auto offsets = index.lookupBatch(keys);
+    if (mMetrics)
     {
-        auto [offOp, newIndexIter] = index.scan(indexIter, *currKeyIt);
-        indexIter = newIndexIter;
-        if (offOp)
+        mMetrics->mLookups.Mark(keys.size());
+    }
+
+    // Candidate keys that passed the index and bloom filter, in offset order
+    using KeyIter = std::set<LedgerKey, LedgerEntryIdCmp>::iterator;
+    std::vector<std::pair<std::streamoff, KeyIter>> candidates;
+    size_t i = 0;
+    for (auto keyIt = keys.begin(); keyIt != keys.end(); ++keyIt, ++i)
+    {
+        if (offsets[i])
+        {
+            candidates.emplace_back(*offsets[i], keyIt);
+        }
+    }
+
+    auto onEntryFound = [&](BucketEntry const& be, KeyIter keyIt) {
+        if (mMetrics)
+        {
+            mMetrics->markFound(*keyIt);
+        }
+        if (be.type() != DEADENTRY)
         {
-            auto [entryOp, bloomMiss] = getEntryAtOffset(
-                *currKeyIt, *offOp, mBucket->getIndex().getPageSize());
+            result.push_back(be.liveEntry());
+        }
+        keys.erase(keyIt);
+    };
+
+    // Individual index offsets point directly at entries, and the mapped,
+    // cached and in-memory read paths already avoid redundant IO, so just load
+    // each entry
+    if (pageSize == 0 || mUseMappedReads || mBlockCache ||
+        mBucket->getInMemoryEntries())
+    {
+        for (auto const& [offset, keyIt] : candidates)
+        {
+            auto [entryOp, bloomMiss] =
+                getEntryAtOffset(*keyIt, offset, pageSize);
             if (entryOp)
             {
-                if (entryOp->type() != DEADENTRY)
+                onEntryFound(*entryOp, keyIt);
+            }
+        }
+        return;
+    }
+
+    // Coalesce runs of candidates on the same or adjacent pages into a single
+    // read of at most fs::bufsz() bytes
+    auto& stream = getStream();
+    std::vector<char> buf;
+    size_t runBegin = 0;
+    while (runBegin < candidates.size())
+    {
+        std::streamoff const readStart = candidates[runBegin].first;
+        std::streamoff readEnd = readStart + pageSize;
+        size_t runEnd = runBegin + 1;
+        while (runEnd < candidates.size() &&
+               candidates[runEnd].first <= readEnd &&
+               candidates[runEnd].first + pageSize - readStart <=
+                   static_cast<std::streamoff>(fs::bufsz()))
+        {
+            readEnd = candidates[runEnd].first + pageSize;
+            ++runEnd;
+        }
+
+        if (mMetrics)
+        {
+            auto timer = mMetrics->mReadTime.TimeScope();
+            stream.seek(readStart);
+            stream.readPageBytes(buf, readEnd - readStart);
+            mMetrics->mBloomPasses.Mark(runEnd - runBegin);
+            mMetrics->mBytesRead.Mark(readEnd - readStart);
+        }
+        else
+        {
+            stream.seek(readStart);
+            stream.readPageBytes(buf, readEnd - readStart);
+        }
+
+        for (size_t j = runBegin; j < runEnd; ++j)
+        {
+            auto const& [offset, keyIt] = candidates[j];
+            BucketEntry be;
+            if (XDRInputFileStream::findInPage(buf, offset - readStart,
+                                               pageSize, *keyIt, be))
+            {
+                onEntryFound(be, keyIt);
+            }
+            else
+            {
+                // Mark entry miss for metrics
+                index.markBloomMiss();
+                if (mMetrics)
                 {
-                    result.push_back(entryOp->liveEntry());
+                    mMetrics->mBloomMisses.Mark();
                 }
-
-                currKeyIt = keys.erase(currKeyIt);
-                continue;
             }
         }
 
-        ++currKeyIt;
+        runBegin = runEnd;
     }
 }
 
@@ -135,10 +320,8 @@ BucketSnapshot::getPoolIDsByAsset(Asset const& asset) const
 }
 
 bool
-BucketSnapshot::scanForEviction(EvictionIterator& iter, uint32_t& bytesToScan,
-                                uint32_t ledgerSeq,
-                                std::list<EvictionResultEntry>& evictableKeys,
-                                SearchableBucketListSnapshot& bl) const
+BucketSnapshot::advanceEvictionScan(EvictionIterator& iter,
+                                    uint32_t& bytesToScan) const
 {
     ZoneScoped;
     if (isEmpty() || protocolVersionIsBefore(Bucket::getBucketVersion(mBucket),
@@ -154,76 +337,133 @@ BucketSnapshot::scanForEviction(EvictionIterator& iter, uint32_t& bytesToScan,
         return true;
     }
 
+    // The scan region covers every entry starting in
+    // [iter.bucketFileOffset, regionEnd). It ends with the first entry that
+    // reaches bytesToScan, or at EOF if the rest of the bucket is smaller.
+    std::streamoff regionStart = iter.bucketFileOffset;
+    std::streamoff fileSize = mBucket->getSize();
+    std::streamoff target = regionStart + bytesToScan;
+    if (target > fileSize)
+    {
+        // Hit eof
+        iter.bucketFileOffset = fileSize;
+        bytesToScan -= static_cast<uint32_t>(fileSize - regionStart);
+        return false;
+    }
+
+    // Find the end of the entry containing the last byte of the scan budget.
+    // Reading forward from the nearest indexed position reads at most one
+    // page.
+    XDRInputFileStream stream{};
+    stream.open(mBucket->getFilename());
+    auto readPos = std::max(
+        regionStart, mBucket->getIndex().getIndexedOffsetAtOrBefore(target - 1));
+    stream.seek(readPos);
+    BucketEntry be;
+    while (readPos < target && stream.readOne(be))
+    {
+        readPos = stream.pos();
+    }
+
+    // Reached end of scan region
+    iter.bucketFileOffset = readPos;
+    bytesToScan = 0;
+    return true;
+}
+
+void
+BucketSnapshot::collectEvictableEntries(
+    EvictionIterator const& regionStart, std::streamoff regionEnd,
+    uint32_t ledgerSeq, std::list<EvictionResultEntry>& evictableKeys,
+    SearchableBucketListSnapshot& bl) const
+{
+    ZoneScoped;
+    if (isEmpty() ||
+        static_cast<std::streamoff>(regionStart.bucketFileOffset) >= regionEnd)
+    {
+        return;
+    }
+
     std::list<EvictionResultEntry> maybeEvictQueue;
     LedgerKeySet keysToSearch;
 
-    auto processQueue = [&]() {
-        auto loadResult =
-            populateLoadedEntries(keysToSearch, bl.loadKeys(keysToSearch));
-        for (auto& e : maybeEvictQueue)
-        {
-            // If TTL entry has not yet been deleted
-            if (auto ttl = loadResult.find(getTTLKey(e.key))->second;
-                ttl != nullptr)
-            {
-                // If TTL of entry is expired
-                if (!isLive(*ttl, ledgerSeq))
-                {
-                    // If entry is expired but not yet deleted, add it to
-                    // evictable keys
-                    e.liveUntilLedger = ttl->data.ttl().liveUntilLedgerSeq;
-                    evictableKeys.emplace_back(e);
-                }
-            }
-        }
-    };
-
     // Open new stream for eviction scan to not interfere with BucketListDB load
     // streams
     XDRInputFileStream stream{};
     stream.open(mBucket->getFilename());
-    stream.seek(iter.bucketFileOffset);
     BucketEntry be;
 
-    // First, scan the bucket region and record all temp entry keys in
-    // maybeEvictQueue. After scanning, we will load all the TTL keys for these
-    // entries in a single bulk load to determine
+    // First, visit every eviction candidate in the region and record its key in
+    // maybeEvictQueue. Other entries can never be evicted, so they are not
+    // read. After scanning, we will load all the TTL keys for these entries in
+    // a single bulk load to determine
     //   1. If the entry is expired
     //   2. If the entry has already been deleted/evicted
-    while (stream.readOne(be))
+    auto const& candidates = mBucket->getIndex().getEvictionCandidateOffsets();
+    for (auto it = std::lower_bound(
+             candidates.begin(), candidates.end(),
+             static_cast<std::streamoff>(regionStart.bucketFileOffset));
+         it != candidates.end() && *it < regionEnd; ++it)
     {
-        auto newPos = stream.pos();
-        auto bytesRead = newPos - iter.bucketFileOffset;
-        iter.bucketFileOffset = newPos;
+        stream.seek(*it);
+        if (!stream.readOne(be))
+        {
+            throw std::runtime_error("Malformed bucket: eviction candidate "
+                                     "offset past end of file.");
+        }
 
         if (be.type() == INITENTRY || be.type() == LIVEENTRY)
         {
             auto const& le = be.liveEntry();
-            if (isTemporaryEntry(le.data))
-            {
-                keysToSearch.emplace(getTTLKey(le));
+            releaseAssertOrThrow(isTemporaryEntry(le.data));
+            keysToSearch.emplace(getTTLKey(le));
 
-                // Set lifetime to 0 as default, will be updated after TTL keys
-                // loaded
-                maybeEvictQueue.emplace_back(
-                    EvictionResultEntry(LedgerEntryKey(le), iter, 0));
-            }
+            // Set lifetime to 0 as default, will be updated after TTL keys
+            // loaded. The iterator records the position following the entry,
+            // as if the bucket had been scanned up to it.
+            auto entryIter = regionStart;
+            entryIter.bucketFileOffset = stream.pos();
+            maybeEvictQueue.emplace_back(
+                EvictionResultEntry(LedgerEntryKey(le), entryIter, 0));
         }
+    }
+
+    if (keysToSearch.empty())
+    {
+        return;
+    }
 
-        if (bytesRead >= bytesToScan)
+    auto loadResult =
+        populateLoadedEntries(keysToSearch, bl.loadKeys(keysToSearch));
+    for (auto& e : maybeEvictQueue)
+    {
+        // If TTL entry has not yet been deleted
+        if (auto ttl = loadResult.find(getTTLKey(e.key))->second;
+            ttl != nullptr)
         {
-            // Reached end of scan region
-            bytesToScan = 0;
-            processQueue();
-            return true;
+            // If TTL of entry is expired
+            if (!isLive(*ttl, ledgerSeq))
+            {
+                // If entry is expired but not yet deleted, add it to
+                // evictable keys
+                e.liveUntilLedger = ttl->data.ttl().liveUntilLedgerSeq;
+                evictableKeys.emplace_back(e);
+            }
         }
-
-        bytesToScan -= bytesRead;
     }
+}
 
-    // Hit eof
-    processQueue();
-    return false;
+bool
+BucketSnapshot::scanForEviction(EvictionIterator& iter, uint32_t& bytesToScan,
+                                uint32_t ledgerSeq,
+                                std::list<EvictionResultEntry>& evictableKeys,
+                                SearchableBucketListSnapshot& bl) const
+{
+    auto regionStart = iter;
+    auto res = advanceEvictionScan(iter, bytesToScan);
+    collectEvictableEntries(regionStart, iter.bucketFileOffset, ledgerSeq,
+                            evictableKeys, bl);
+    return res;
 }
 
 XDRInputFileStream&
@@ -238,6 +478,18 @@ BucketSnapshot::getStream() const
     return *mStream;
 }
 
+XDRInputMappedFile&
+BucketSnapshot::getMappedFile() const
+{
+    releaseAssertOrThrow(!isEmpty());
+    if (!mMappedFile)
+    {
+        mMappedFile = std::make_unique<XDRInputMappedFile>();
+        mMappedFile->open(mBucket->getFilename());
+    }
+    return *mMappedFile;
+}
+
 std::shared_ptr<Bucket const>
 BucketSnapshot::getRawBucket() const
 {
@@ -6,32 +6,88 @@
 
 #include "bucket/LedgerCmp.h"
 #include "util/NonCopyable.h"
+#include "util/UnorderedMap.h"
 #include <list>
 #include <set>
 
 #include <optional>
 
+namespace medida
+{
+class Histogram;
+class Meter;
+class Timer;
+}
+
 namespace stellar
 {
 
 class Bucket;
+class BucketBlockCache;
 class XDRInputFileStream;
+class XDRInputMappedFile;
 class SearchableBucketListSnapshot;
 struct EvictionResultEntry;
 
+// Lookup counters for the buckets of one BucketList level. Owned by
+// BucketSnapshotManager and updated concurrently by every thread doing
+// BucketListDB lookups, so only thread safe medida metrics live here.
+struct BucketLevelMetrics
+{
+    uint32_t const mLevel;
+
+    // Keys looked up in the level's buckets
+    medida::Meter& mLookups;
+
+    // Lookups the index could not rule out, so the bucket file was read
+    medida::Meter& mBloomPasses;
+
+    // Bloom passes whose key was not in the bucket after all
+    medida::Meter& mBloomMisses;
+
+    // Bytes read from bucket files, not counting block cache hits
+    medida::Meter& mBytesRead;
+
+    // Time spent reading bucket files
+    medida::Timer& mReadTime;
+
+    // Level at which lookups found their key, per entry type. Shared by all
+    // levels, so each histogram shows how deep lookups of that type go.
+    UnorderedMap<LedgerEntryType, medida::Histogram&> const& mFoundLevel;
+
+    void markFound(LedgerKey const& k) const;
+};
+
 // A lightweight wrapper around Bucket for thread safe BucketListDB lookups
 class BucketSnapshot : public NonMovable
 {
     std::shared_ptr<Bucket const> const mBucket;
 
+    // If true, point and bulk loads read from a memory mapping of the bucket
+    // file instead of mStream.
+    bool const mUseMappedReads;
+
+    // Shared page cache for range index lookups, or null if disabled. Not
+    // used when mUseMappedReads is set, since mapped pages are already cached
+    // by the OS.
+    BucketBlockCache* const mBlockCache;
+
+    // Metrics of the level this bucket is in, or null if not tracked
+    BucketLevelMetrics const* const mMetrics;
+
     // Lazily-constructed and retained for read path.
     mutable std::unique_ptr<XDRInputFileStream> mStream{};
+    mutable std::unique_ptr<XDRInputMappedFile> mMappedFile{};
 
     // Returns (lazily-constructed) file stream for bucket file. Note
     // this might be in some random position left over from a previous read --
     // must be seek()'ed before use.
     XDRInputFileStream& getStream() const;
 
+    // Returns (lazily-constructed) memory mapped view of the bucket file. Same
+    // positioning caveats as getStream().
+    XDRInputMappedFile& getMappedFile() const;
+
     // Loads the bucket entry for LedgerKey k. Starts at file offset pos and
     // reads until key is found or the end of the page. Returns <BucketEntry,
     // bloomMiss>, where bloomMiss is true if a bloomMiss occurred during the
@@ -40,7 +96,9 @@ class BucketSnapshot : public NonMovable
     getEntryAtOffset(LedgerKey const& k, std::streamoff pos,
                      size_t pageSize) const;
 
-    BucketSnapshot(std::shared_ptr<Bucket const> const b);
+    BucketSnapshot(std::shared_ptr<Bucket const> const b, bool useMappedReads,
+                   BucketBlockCache* blockCache,
+                   BucketLevelMetrics const* metrics);
 
     // Only allow copy constructor, is threadsafe
     BucketSnapshot(BucketSnapshot const& b);
@@ -64,11 +122,30 @@ class BucketSnapshot : public NonMovable
     // pool
     std::vector<PoolID> const& getPoolIDsByAsset(Asset const& asset) const;
 
+    // Scans the eviction region starting at iter, adding expired entries to
+    // evictableKeys, and advances iter past the region. Returns true if the
+    // region ended before the end of the bucket, i.e. bytesToScan ran out.
+    // Equivalent to advanceEvictionScan followed by collectEvictableEntries.
     bool scanForEviction(EvictionIterator& iter, uint32_t& bytesToScan,
                          uint32_t ledgerSeq,
                          std::list<EvictionResultEntry>& evictableKeys,
                          SearchableBucketListSnapshot& bl) const;
 
+    // Advances iter past the eviction region starting at iter without reading
+    // the entries in it, consuming bytesToScan. Returns the same value as
+    // scanForEviction. Regions only depend on bucket sizes, so they can be
+    // planned up front and their entries collected in any order.
+    bool advanceEvictionScan(EvictionIterator& iter,
+                             uint32_t& bytesToScan) const;
+
+    // Adds expired entries starting in [regionStart.bucketFileOffset,
+    // regionEnd) to evictableKeys, loading TTLs via bl.
+    void
+    collectEvictableEntries(EvictionIterator const& regionStart,
+                            std::streamoff regionEnd, uint32_t ledgerSeq,
+                            std::list<EvictionResultEntry>& evictableKeys,
+                            SearchableBucketListSnapshot& bl) const;
+
     friend struct BucketLevelSnapshot;
 };
 }
\ No newline at end of file
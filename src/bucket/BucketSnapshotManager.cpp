@@ -3,28 +3,89 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "bucket/BucketSnapshotManager.h"
+#include "bucket/BucketBlockCache.h"
+#include "bucket/BucketList.h"
 #include "bucket/BucketListSnapshot.h"
 #include "main/Application.h"
+#include "main/Config.h"
 #include "util/XDRStream.h" // IWYU pragma: keep
 
+#include "medida/histogram.h"
 #include "medida/meter.h"
 #include "medida/metrics_registry.h"
+#include <fmt/format.h>
 
 namespace stellar
 {
 
-BucketSnapshotManager::BucketSnapshotManager(
-    Application& app, std::unique_ptr<BucketListSnapshot const>&& snapshot)
+BucketSnapshotManager::BucketSnapshotManager(Application& app,
+                                             BucketList const& bl)
     : mApp(app)
-    , mCurrentSnapshot(std::move(snapshot))
     , mBulkLoadMeter(app.getMetrics().NewMeter(
           {"bucketlistDB", "query", "loads"}, "query"))
     , mBloomMisses(app.getMetrics().NewMeter(
           {"bucketlistDB", "bloom", "misses"}, "bloom"))
     , mBloomLookups(app.getMetrics().NewMeter(
           {"bucketlistDB", "bloom", "lookups"}, "bloom"))
+    , mBlockCacheHits(app.getMetrics().NewMeter(
+          {"bucketlistDB", "cache", "hits"}, "cache"))
+    , mBlockCacheMisses(app.getMetrics().NewMeter(
+          {"bucketlistDB", "cache", "misses"}, "cache"))
+    , mParallelLoadThreshold(
+          app.getConfig().BUCKETLIST_DB_PARALLEL_LOAD_THRESHOLD)
+    , mEvictionScanThreads(
+          app.getConfig().EXPERIMENTAL_BACKGROUND_EVICTION_SCAN
+              ? app.getConfig().EXPERIMENTAL_BACKGROUND_EVICTION_SCAN_THREADS
+              : 1)
 {
     releaseAssert(threadIsMain());
+
+    auto& metrics = app.getMetrics();
+    for (auto let : xdr::xdr_traits<LedgerEntryType>::enum_values())
+    {
+        auto t = static_cast<LedgerEntryType>(let);
+        auto const& label = xdr::xdr_traits<LedgerEntryType>::enum_name(t);
+        mFoundLevel.emplace(t, metrics.NewHistogram(
+                                   {"bucketlistDB", "found-level", label}));
+    }
+
+    // Reserve up front, snapshots hold pointers into mLevelMetrics
+    mLevelMetrics.reserve(BucketList::kNumLevels);
+    for (uint32_t i = 0; i < BucketList::kNumLevels; ++i)
+    {
+        auto level = fmt::format(FMT_STRING("level-{}"), i);
+        mLevelMetrics.push_back(BucketLevelMetrics{
+            i, metrics.NewMeter({"bucketlistDB", level, "lookups"}, "key"),
+            metrics.NewMeter({"bucketlistDB", level, "bloom-passes"}, "key"),
+            metrics.NewMeter({"bucketlistDB", level, "bloom-misses"}, "key"),
+            metrics.NewMeter({"bucketlistDB", level, "bytes-read"}, "byte"),
+            metrics.NewTimer({"bucketlistDB", level, "read"}), mFoundLevel});
+    }
+
+    // Convert cfg param from MB to bytes
+    if (auto cacheSize = app.getConfig().BUCKETLIST_DB_BLOCK_CACHE_SIZE;
+        cacheSize != 0)
+    {
+        mBlockCache = std::make_unique<BucketBlockCache>(
+            cacheSize * 1000000, mBlockCacheHits, mBlockCacheMisses);
+    }
+
+    std::atomic_store(&mCurrentSnapshot,
+                      std::shared_ptr<BucketListSnapshot const>(
+                          makeSnapshot(bl, 0)));
+}
+
+BucketSnapshotManager::~BucketSnapshotManager()
+{
+}
+
+std::unique_ptr<BucketListSnapshot const>
+BucketSnapshotManager::makeSnapshot(BucketList const& bl,
+                                    uint32_t ledgerSeq) const
+{
+    return std::make_unique<BucketListSnapshot>(
+        bl, ledgerSeq, mApp.getConfig().BUCKETLIST_DB_MMAP_READS,
+        mBlockCache.get(), mLevelMetrics.data());
 }
 
 std::shared_ptr<SearchableBucketListSnapshot>
@@ -59,31 +120,66 @@ BucketSnapshotManager::recordBulkLoadMetrics(std::string const& label,
     return iter->second;
 }
 
+void
+BucketSnapshotManager::postOnBackgroundThread(std::function<void()>&& f,
+                                              std::string jobName) const
+{
+    mApp.postOnBackgroundThread(std::move(f), std::move(jobName),
+                                WorkerPriority::CRITICAL);
+}
+
+void
+BucketSnapshotManager::postOnEvictionBackgroundThread(
+    std::function<void()>&& f, std::string jobName) const
+{
+    releaseAssert(mEvictionScanThreads > 1);
+    mApp.postOnBackgroundThread(std::move(f), std::move(jobName),
+                                WorkerPriority::CRITICAL);
+}
+
 void
 BucketSnapshotManager::maybeUpdateSnapshot(
     std::unique_ptr<BucketListSnapshot const>& snapshot) const
 {
-    std::lock_guard<std::recursive_mutex> lock(mSnapshotMutex);
-    if (!snapshot ||
-        snapshot->getLedgerSeq() != mCurrentSnapshot->getLedgerSeq())
+    // Fast path, nothing has been published since snapshot was taken
+    if (snapshot && snapshot->getLedgerSeq() ==
+                        mCurrentLedgerSeq.load(std::memory_order_acquire))
+    {
+        return;
+    }
+
+    // mCurrentLedgerSeq is stored after mCurrentSnapshot, so current may
+    // already be newer than the ledger read above, but never older
+    auto current = std::atomic_load(&mCurrentSnapshot);
+    if (!snapshot || snapshot->getLedgerSeq() != current->getLedgerSeq())
     {
         // Should only update with a newer snapshot
-        releaseAssert(!snapshot || snapshot->getLedgerSeq() <
-                                       mCurrentSnapshot->getLedgerSeq());
-        snapshot = std::make_unique<BucketListSnapshot>(*mCurrentSnapshot);
+        releaseAssert(!snapshot ||
+                      snapshot->getLedgerSeq() < current->getLedgerSeq());
+
+        // Published snapshots are immutable, so copying one does not need to
+        // synchronize with the main thread
+        snapshot = std::make_unique<BucketListSnapshot>(*current);
     }
 }
 
 void
-BucketSnapshotManager::updateCurrentSnapshot(
-    std::unique_ptr<BucketListSnapshot const>&& newSnapshot)
+BucketSnapshotManager::updateCurrentSnapshot(BucketList const& bl,
+                                             uint32_t ledgerSeq)
 {
-    releaseAssert(newSnapshot);
     releaseAssert(threadIsMain());
-    std::lock_guard<std::recursive_mutex> lock(mSnapshotMutex);
-    releaseAssert(!mCurrentSnapshot || newSnapshot->getLedgerSeq() >=
-                                           mCurrentSnapshot->getLedgerSeq());
-    mCurrentSnapshot.swap(newSnapshot);
+    std::shared_ptr<BucketListSnapshot const> newSnapshot =
+        makeSnapshot(bl, ledgerSeq);
+
+    // Only the main thread publishes, so reading mCurrentSnapshot here cannot
+    // race with another store
+    releaseAssert(newSnapshot->getLedgerSeq() >=
+                  mCurrentSnapshot->getLedgerSeq());
+
+    // Readers holding the previous snapshot keep it alive until they finish
+    // copying it
+    std::atomic_store(&mCurrentSnapshot, newSnapshot);
+    mCurrentLedgerSeq.store(ledgerSeq, std::memory_order_release);
 }
 
 void
@@ -5,14 +5,17 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "bucket/BucketManagerImpl.h"
+#include "bucket/BucketSnapshot.h"
 #include "util/NonCopyable.h"
 #include "util/UnorderedMap.h"
 
+#include <atomic>
+#include <functional>
 #include <memory>
-#include <mutex>
 
 namespace medida
 {
+class Histogram;
 class Meter;
 class MetricsRegistry;
 class Timer;
@@ -22,6 +25,7 @@ namespace stellar
 {
 
 class Application;
+class BucketBlockCache;
 class BucketList;
 class BucketListSnapshot;
 
@@ -33,13 +37,20 @@ class BucketSnapshotManager : NonMovableOrCopyable
   private:
     Application& mApp;
 
+    // Page cache shared by all snapshots for range index lookups, null if
+    // BUCKETLIST_DB_BLOCK_CACHE_SIZE == 0
+    std::unique_ptr<BucketBlockCache> mBlockCache{};
+
     // Snapshot that is maintained and periodically updated by BucketManager on
     // the main thread. When background threads need to generate or refresh a
-    // snapshot, they will copy this snapshot.
-    std::unique_ptr<BucketListSnapshot const> mCurrentSnapshot{};
+    // snapshot, they will copy this snapshot. A published snapshot is never
+    // modified, so it is replaced as a whole and must only be accessed through
+    // std::atomic_load and std::atomic_store.
+    std::shared_ptr<BucketListSnapshot const> mCurrentSnapshot{};
 
-    // Lock must be held when accessing mCurrentSnapshot
-    mutable std::recursive_mutex mSnapshotMutex;
+    // Ledger of mCurrentSnapshot, stored after each publication so that readers
+    // that are already up to date can return after a single atomic load
+    std::atomic<uint32_t> mCurrentLedgerSeq{0};
 
     mutable UnorderedMap<LedgerEntryType, medida::Timer&> mPointTimers{};
     mutable UnorderedMap<std::string, medida::Timer&> mBulkTimers{};
@@ -47,13 +58,30 @@ class BucketSnapshotManager : NonMovableOrCopyable
     medida::Meter& mBulkLoadMeter;
     medida::Meter& mBloomMisses;
     medida::Meter& mBloomLookups;
+    medida::Meter& mBlockCacheHits;
+    medida::Meter& mBlockCacheMisses;
+
+    // Lookup metrics shared by all snapshots, see BucketLevelMetrics. Both
+    // are filled in on construction and never modified afterwards, so
+    // snapshots on any thread can use them.
+    UnorderedMap<LedgerEntryType, medida::Histogram&> mFoundLevel;
+    std::vector<BucketLevelMetrics> mLevelMetrics;
 
     mutable std::optional<VirtualClock::time_point> mTimerStart;
 
+    // Copy of BUCKETLIST_DB_PARALLEL_LOAD_THRESHOLD so snapshots don't need
+    // to access Config
+    size_t const mParallelLoadThreshold;
+
+    // Number of eviction threads available to a background eviction scan
+    size_t const mEvictionScanThreads;
+
+    std::unique_ptr<BucketListSnapshot const>
+    makeSnapshot(BucketList const& bl, uint32_t ledgerSeq) const;
+
     // Called by main thread to update mCurrentSnapshot whenever the BucketList
     // is updated
-    void updateCurrentSnapshot(
-        std::unique_ptr<BucketListSnapshot const>&& newSnapshot);
+    void updateCurrentSnapshot(BucketList const& bl, uint32_t ledgerSeq);
 
     friend void
     BucketManagerImpl::addBatch(Application& app, uint32_t currLedger,
@@ -66,8 +94,9 @@ class BucketSnapshotManager : NonMovableOrCopyable
                                                bool restartMerges);
 
   public:
-    BucketSnapshotManager(Application& app,
-                          std::unique_ptr<BucketListSnapshot const>&& snapshot);
+    // Initializes mCurrentSnapshot from bl at ledger 0
+    BucketSnapshotManager(Application& app, BucketList const& bl);
+    ~BucketSnapshotManager();
 
     std::shared_ptr<SearchableBucketListSnapshot>
     getSearchableBucketListSnapshot() const;
@@ -77,6 +106,31 @@ class BucketSnapshotManager : NonMovableOrCopyable
     void maybeUpdateSnapshot(
         std::unique_ptr<BucketListSnapshot const>& snapshot) const;
 
+    // Minimum number of keys for a bulk load to probe buckets in parallel, 0
+    // if parallel loads are disabled
+    size_t
+    getParallelLoadThreshold() const
+    {
+        return mParallelLoadThreshold;
+    }
+
+    // Posts f to the worker thread pool as a CRITICAL job, since its callers
+    // wait for it
+    void postOnBackgroundThread(std::function<void()>&& f,
+                                std::string jobName) const;
+
+    // Number of threads a background eviction scan may split its work across
+    size_t
+    getEvictionScanThreads() const
+    {
+        return mEvictionScanThreads;
+    }
+
+    // Posts a part of an eviction scan to the worker thread pool as a
+    // CRITICAL job. Must only be called if getEvictionScanThreads() > 1.
+    void postOnEvictionBackgroundThread(std::function<void()>&& f,
+                                        std::string jobName) const;
+
     // All metric recording functions must only be called by the main thread
     void startPointLoadTimer() const;
     void endPointLoadTimer(LedgerEntryType t, bool bloomMiss) const;
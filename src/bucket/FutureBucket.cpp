@@ -396,8 +396,10 @@ FutureBucket::startMerge(Application& app, uint32_t maxProtocolVersion,
 
     mOutputBucketFuture = task->get_future().share();
     bm.putMergeFuture(mk, mOutputBucketFuture);
-    app.postOnBackgroundThread(bind(&task_t::operator(), task),
-                               "FutureBucket: merge");
+    // Shallower levels are resolved sooner by BucketList::addBatch (see
+    // getAvailableTimeForMerge), so the level doubles as merge priority.
+    app.postOnMergeBackgroundThread(bind(&task_t::operator(), task),
+                                    "FutureBucket: merge", level);
     checkState();
 }
 
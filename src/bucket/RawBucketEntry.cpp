@@ -0,0 +1,148 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "bucket/RawBucketEntry.h"
+#include "bucket/Bucket.h"
+#include "util/GlobalChecks.h"
+#include <Tracy.hpp>
+
+namespace stellar
+{
+
+void
+RawBucketEntry::decodeKey()
+{
+    ZoneScoped;
+    xdr::xdr_get g(bytes.data(), bytes.data() + bytes.size());
+    xdr::xdr_argpack_archive(g, type);
+
+    switch (type)
+    {
+    case METAENTRY:
+        return;
+    case DEADENTRY:
+        xdr::xdr_argpack_archive(g, key);
+        return;
+    case LIVEENTRY:
+    case INITENTRY:
+        break;
+    default:
+        throw std::runtime_error("Malformed bucket: unknown entry type");
+    }
+
+    // A LedgerEntry starts with lastModifiedLedgerSeq and the entry type,
+    // followed by the entry body. The key fields of every entry type lead its
+    // body, so only that prefix of the entry needs to be decoded.
+    uint32_t lastModifiedLedgerSeq;
+    LedgerEntryType entryType;
+    xdr::xdr_argpack_archive(g, lastModifiedLedgerSeq);
+    xdr::xdr_argpack_archive(g, entryType);
+    key.type(entryType);
+
+    switch (entryType)
+    {
+    case ACCOUNT:
+        xdr::xdr_argpack_archive(g, key.account().accountID);
+        break;
+    case TRUSTLINE:
+        xdr::xdr_argpack_archive(g, key.trustLine().accountID);
+        xdr::xdr_argpack_archive(g, key.trustLine().asset);
+        break;
+    case OFFER:
+        xdr::xdr_argpack_archive(g, key.offer().sellerID);
+        xdr::xdr_argpack_archive(g, key.offer().offerID);
+        break;
+    case DATA:
+        xdr::xdr_argpack_archive(g, key.data().accountID);
+        xdr::xdr_argpack_archive(g, key.data().dataName);
+        break;
+    case CLAIMABLE_BALANCE:
+        xdr::xdr_argpack_archive(g, key.claimableBalance().balanceID);
+        break;
+    case LIQUIDITY_POOL:
+        xdr::xdr_argpack_archive(g, key.liquidityPool().liquidityPoolID);
+        break;
+    case CONTRACT_DATA:
+    {
+        ExtensionPoint ext;
+        xdr::xdr_argpack_archive(g, ext);
+        xdr::xdr_argpack_archive(g, key.contractData().contract);
+        xdr::xdr_argpack_archive(g, key.contractData().key);
+        xdr::xdr_argpack_archive(g, key.contractData().durability);
+        break;
+    }
+    case CONTRACT_CODE:
+    {
+        decltype(ContractCodeEntry::ext) ext;
+        xdr::xdr_argpack_archive(g, ext);
+        xdr::xdr_argpack_archive(g, key.contractCode().hash);
+        break;
+    }
+    case CONFIG_SETTING:
+        xdr::xdr_argpack_archive(g, key.configSetting().configSettingID);
+        break;
+    case TTL:
+        xdr::xdr_argpack_archive(g, key.ttl().keyHash);
+        break;
+    default:
+        throw std::runtime_error("Malformed bucket: unknown ledger entry type");
+    }
+}
+
+void
+RawBucketEntry::setLiveOrInitType(BucketEntryType newType)
+{
+    releaseAssert(type == LIVEENTRY || type == INITENTRY);
+    releaseAssert(newType == LIVEENTRY || newType == INITENTRY);
+    releaseAssert(bytes.size() >= 4);
+    xdr::xdr_put p(bytes.data(), bytes.data() + 4);
+    xdr::xdr_argpack_archive(p, newType);
+    type = newType;
+}
+
+void
+RawBucketEntry::decode(BucketEntry& out) const
+{
+    xdr::xdr_get g(bytes.data(), bytes.data() + bytes.size());
+    xdr::xdr_argpack_archive(g, out);
+}
+
+RawBucketInputIterator::RawBucketInputIterator(
+    std::shared_ptr<Bucket const> bucket, bool streamingIO)
+    : mBucket(bucket)
+{
+    if (!mBucket->getFilename().empty())
+    {
+        mIn.open(mBucket->getFilename().string(),
+                 streamingIO ? fs::streamingBufsz() : 0);
+        loadEntry();
+    }
+}
+
+void
+RawBucketInputIterator::loadEntry()
+{
+    ZoneScoped;
+    mValid = false;
+    while (mIn.readOneRaw(mEntry.bytes))
+    {
+        mEntry.decodeKey();
+
+        // BucketInputIterator validates METAENTRY placement, the raw iterator
+        // only skips it
+        if (mEntry.type != METAENTRY)
+        {
+            mValid = true;
+            return;
+        }
+    }
+}
+
+RawBucketInputIterator&
+RawBucketInputIterator::operator++()
+{
+    loadEntry();
+    return *this;
+}
+}
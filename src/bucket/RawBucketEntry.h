@@ -0,0 +1,71 @@
+#pragma once
+
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/XDRStream.h"
+#include "xdr/Stellar-ledger.h"
+
+#include <memory>
+#include <vector>
+
+namespace stellar
+{
+
+class Bucket;
+
+// A BucketEntry kept in its serialized XDR form, with only its type and key
+// decoded. This lets merges order and copy entries without decoding or
+// re-encoding the entry bodies.
+struct RawBucketEntry
+{
+    BucketEntryType type{LIVEENTRY};
+
+    // Key of the entry. Not set for METAENTRY.
+    LedgerKey key;
+
+    // XDR encoding of the BucketEntry, without the record mark
+    std::vector<char> bytes;
+
+    // Decodes type and key from bytes
+    void decodeKey();
+
+    // Changes the type of a LIVEENTRY or INITENTRY to a LIVEENTRY or INITENTRY,
+    // in place. Both types share the liveEntry arm, so only the leading
+    // discriminant changes.
+    void setLiveOrInitType(BucketEntryType newType);
+
+    // Fully decodes the entry
+    void decode(BucketEntry& out) const;
+};
+
+// Reads the non-META entries of a bucket in order as RawBucketEntry's
+class RawBucketInputIterator
+{
+    std::shared_ptr<Bucket const> mBucket;
+    XDRInputFileStream mIn;
+    RawBucketEntry mEntry;
+    bool mValid{false};
+
+    void loadEntry();
+
+  public:
+    // streamingIO has the same meaning as for BucketInputIterator
+    explicit RawBucketInputIterator(std::shared_ptr<Bucket const> bucket,
+                                    bool streamingIO = false);
+
+    operator bool() const
+    {
+        return mValid;
+    }
+
+    RawBucketEntry&
+    operator*()
+    {
+        return mEntry;
+    }
+
+    RawBucketInputIterator& operator++();
+};
+}
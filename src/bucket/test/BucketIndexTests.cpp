@@ -6,10 +6,12 @@
 // concerning key-value lookup based on the BucketList.
 
 #include "bucket/BucketIndexImpl.h"
+#include "bucket/BucketInputIterator.h"
 #include "bucket/BucketList.h"
 #include "bucket/BucketListSnapshot.h"
 #include "bucket/BucketManager.h"
 #include "bucket/test/BucketTestUtils.h"
+#include "ledger/LedgerTypeUtils.h"
 #include "ledger/test/LedgerTestUtils.h"
 #include "lib/catch.hpp"
 #include "main/Application.h"
@@ -17,8 +19,11 @@
 #include "test/test.h"
 
 #include "lib/bloom_filter.hpp"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
 
 #include "util/XDRCereal.h"
+#include "util/XDRStream.h"
 
 using namespace stellar;
 using namespace BucketTestUtils;
@@ -90,6 +95,12 @@ class BucketIndexTest
         return mApp->getBucketManager();
     }
 
+    Application&
+    getApp() const
+    {
+        return *mApp;
+    }
+
     virtual void
     buildGeneralTest()
     {
@@ -260,6 +271,41 @@ class BucketIndexTest
         }
     }
 
+    // Check that batched index lookups agree with individual lookups on every
+    // bucket in the BucketList
+    void
+    testLookupBatch()
+    {
+        auto keys = mKeysToSearch;
+        auto addKeys =
+            LedgerTestUtils::generateValidLedgerEntryKeysWithExclusions(
+                {CONFIG_SETTING}, 10);
+        keys.insert(addKeys.begin(), addKeys.end());
+
+        auto& bl = getBM().getBucketList();
+        for (uint32_t i = 0; i < BucketList::kNumLevels; ++i)
+        {
+            for (auto const& b :
+                 {bl.getLevel(i).getCurr(), bl.getLevel(i).getSnap()})
+            {
+                if (b->isEmpty())
+                {
+                    continue;
+                }
+
+                auto const& index = b->getIndexForTesting();
+                auto offsets = index.lookupBatch(keys);
+                REQUIRE(offsets.size() == keys.size());
+
+                size_t j = 0;
+                for (auto const& k : keys)
+                {
+                    REQUIRE(offsets[j++] == index.lookup(k));
+                }
+            }
+        }
+    }
+
     void
     testInvalidKeys()
     {
@@ -477,6 +523,42 @@ testAllIndexTypes(std::function<void(Config&)> f)
         cfg.BUCKETLIST_DB_INDEX_CUTOFF = 0;
         f(cfg);
     }
+
+    SECTION("individual and range index with mmap reads")
+    {
+        Config cfg(getTestConfig());
+        cfg.DEPRECATED_SQL_LEDGER_STATE = false;
+        cfg.BUCKETLIST_DB_INDEX_CUTOFF = 1;
+        cfg.BUCKETLIST_DB_MMAP_READS = true;
+        f(cfg);
+    }
+
+    SECTION("range index with block cache")
+    {
+        Config cfg(getTestConfig());
+        cfg.DEPRECATED_SQL_LEDGER_STATE = false;
+        cfg.BUCKETLIST_DB_INDEX_CUTOFF = 0;
+        cfg.BUCKETLIST_DB_BLOCK_CACHE_SIZE = 1;
+        f(cfg);
+    }
+
+    SECTION("range index with blocked bloom filter")
+    {
+        Config cfg(getTestConfig());
+        cfg.DEPRECATED_SQL_LEDGER_STATE = false;
+        cfg.BUCKETLIST_DB_INDEX_CUTOFF = 0;
+        cfg.BUCKETLIST_DB_BLOCKED_BLOOM_FILTER = true;
+        f(cfg);
+    }
+
+    SECTION("individual and range index with parallel loads")
+    {
+        Config cfg(getTestConfig());
+        cfg.DEPRECATED_SQL_LEDGER_STATE = false;
+        cfg.BUCKETLIST_DB_INDEX_CUTOFF = 1;
+        cfg.BUCKETLIST_DB_PARALLEL_LOAD_THRESHOLD = 1;
+        f(cfg);
+    }
 }
 
 TEST_CASE("key-value lookup", "[bucket][bucketindex]")
@@ -486,6 +568,7 @@ TEST_CASE("key-value lookup", "[bucket][bucketindex]")
         test.buildGeneralTest();
         test.run();
         test.testInvalidKeys();
+        test.testLookupBatch();
     };
 
     testAllIndexTypes(f);
@@ -538,6 +621,108 @@ TEST_CASE("ContractData key with same ScVal", "[bucket][bucketindex]")
     testAllIndexTypes(f);
 }
 
+TEST_CASE("block cache serves repeated page reads", "[bucket][bucketindex]")
+{
+    Config cfg(getTestConfig());
+    cfg.DEPRECATED_SQL_LEDGER_STATE = false;
+    cfg.BUCKETLIST_DB_INDEX_CUTOFF = 0;
+    cfg.BUCKETLIST_DB_BLOCK_CACHE_SIZE = 1;
+
+    auto test = BucketIndexTest(cfg);
+    test.buildGeneralTest();
+
+    auto& hits = test.getApp().getMetrics().NewMeter(
+        {"bucketlistDB", "cache", "hits"}, "cache");
+
+    // First run populates the cache, second run should be served from it
+    test.run();
+    auto hitsAfterFirstRun = hits.count();
+    test.run();
+    REQUIRE(hits.count() > hitsAfterFirstRun);
+}
+
+TEST_CASE("indexes built during merge match full file indexes",
+          "[bucket][bucketindex]")
+{
+    auto f = [&](Config& cfg) {
+        auto test = BucketIndexTest(cfg);
+        test.buildGeneralTest();
+
+        for (auto const& bucketHash :
+             test.getBM().getBucketListReferencedBuckets())
+        {
+            if (isZero(bucketHash))
+            {
+                continue;
+            }
+
+            auto b = test.getBM().getBucketByHash(bucketHash);
+            REQUIRE(b->isIndexed());
+            auto const& mergeIndex = b->getIndexForTesting();
+            auto fileIndex = BucketIndex::createIndex(
+                test.getBM(), b->getFilename(), bucketHash);
+            REQUIRE(fileIndex);
+            REQUIRE(mergeIndex.getPageSize() == fileIndex->getPageSize());
+
+            for (BucketInputIterator in(b); in; ++in)
+            {
+                auto k = getBucketLedgerKey(*in);
+                auto offset = mergeIndex.lookup(k);
+                REQUIRE(offset);
+                REQUIRE(offset == fileIndex->lookup(k));
+            }
+        }
+    };
+
+    testAllIndexTypes(f);
+}
+
+TEST_CASE("index tracks eviction candidate offsets", "[bucket][bucketindex]")
+{
+    auto f = [&](Config& cfg) {
+        auto test = BucketIndexTest(cfg);
+        test.buildGeneralTest();
+
+        for (auto const& bucketHash :
+             test.getBM().getBucketListReferencedBuckets())
+        {
+            if (isZero(bucketHash))
+            {
+                continue;
+            }
+
+            auto b = test.getBM().getBucketByHash(bucketHash);
+            auto const& index = b->getIndexForTesting();
+
+            std::vector<std::streamoff> expected;
+            XDRInputFileStream in;
+            in.open(b->getFilename().string());
+            std::streamoff pos = 0;
+            BucketEntry be;
+            while (in.readOne(be))
+            {
+                if (be.type() != METAENTRY &&
+                    isTemporaryEntry(getBucketLedgerKey(be)))
+                {
+                    expected.push_back(pos);
+                }
+
+                auto indexed = index.getIndexedOffsetAtOrBefore(pos);
+                REQUIRE(indexed <= pos);
+                if (index.getPageSize() == 0 && be.type() != METAENTRY)
+                {
+                    REQUIRE(indexed == pos);
+                }
+                pos = in.pos();
+            }
+
+            REQUIRE(index.getEvictionCandidateOffsets() == expected);
+        }
+    };
+
+    testAllIndexTypes(f);
+}
+
 TEST_CASE("serialize bucket indexes", "[bucket][bucketindex][!hide]")
 {
     Config cfg(getTestConfig(0, Config::TESTDB_ON_DISK_SQLITE));
@@ -605,5 +790,66 @@ TEST_CASE("serialize bucket indexes", "[bucket][bucketindex][!hide]")
             BucketIndex::load(test.getBM(), indexFilename, b->getSize());
         REQUIRE((inMemoryIndex == *onDiskIndex));
     }
+
+    // Switching the filter type must also invalidate persisted indexes
+    cfg.BUCKETLIST_DB_BLOCKED_BLOOM_FILTER = true;
+    test.restartWithConfig(cfg);
+
+    for (auto const& bucketHash : buckets)
+    {
+        if (isZero(bucketHash))
+        {
+            continue;
+        }
+
+        auto b = test.getBM().getBucketByHash(bucketHash);
+        REQUIRE(b->isIndexed());
+
+        auto indexFilename = test.getBM().bucketIndexFilename(bucketHash);
+        auto onDiskIndex =
+            BucketIndex::load(test.getBM(), indexFilename, b->getSize());
+        REQUIRE(onDiskIndex);
+        REQUIRE((b->getIndexForTesting() == *onDiskIndex));
+#ifndef _WIN32
+        // The loaded filter table is used in place from the index file
+        REQUIRE(onDiskIndex->getMemoryUsage() <
+                b->getIndexForTesting().getMemoryUsage());
+#endif
+    }
+}
+
+TEST_CASE("index buckets on startup under memory limit",
+          "[bucket][bucketindex][!hide]")
+{
+    Config cfg(getTestConfig(0, Config::TESTDB_ON_DISK_SQLITE));
+    cfg.BUCKETLIST_DB_INDEX_CUTOFF = 0;
+    cfg.DEPRECATED_SQL_LEDGER_STATE = false;
+
+    // Don't persist indexes so that every bucket is reindexed on restart
+    cfg.BUCKETLIST_DB_PERSIST_INDEX = false;
+    cfg.NODE_IS_VALIDATOR = false;
+    cfg.FORCE_SCP = false;
+
+    auto test = BucketIndexTest(cfg);
+    test.buildGeneralTest();
+    auto buckets = test.getBM().getBucketListReferencedBuckets();
+
+    // A 1 MB budget is smaller than the combined indexes, so index work must
+    // be throttled to make progress one bucket at a time
+    cfg.BUCKETLIST_DB_INDEX_BUILD_MEMORY_LIMIT = 1;
+    test.restartWithConfig(cfg);
+
+    for (auto const& bucketHash : buckets)
+    {
+        if (isZero(bucketHash))
+        {
+            continue;
+        }
+
+        auto b = test.getBM().getBucketByHash(bucketHash);
+        REQUIRE(b->isIndexed());
+    }
+
+    test.run();
 }
 }
\ No newline at end of file
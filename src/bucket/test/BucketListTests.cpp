@@ -17,13 +17,19 @@
 #include "bucket/BucketManager.h"
 #include "bucket/BucketOutputIterator.h"
 #include "bucket/test/BucketTestUtils.h"
+#include "bucket/test/SyntheticBucketList.h"
 #include "crypto/Hex.h"
+#include "crypto/SHA.h"
 #include "ledger/LedgerTypeUtils.h"
 #include "ledger/test/LedgerTestUtils.h"
 #include "lib/catch.hpp"
 #include "lib/util/stdrandom.h"
 #include "main/Application.h"
 #include "main/Config.h"
+#include "medida/histogram.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include "test/TestAccount.h"
 #include "test/TestUtils.h"
 #include "test/test.h"
 #include "util/Math.h"
@@ -31,8 +37,11 @@
 #include "util/Timer.h"
 #include "xdrpp/autocheck.h"
 
+#include <atomic>
 #include <deque>
+#include <fmt/format.h>
 #include <sstream>
+#include <thread>
 
 using namespace stellar;
 using namespace BucketTestUtils;
@@ -158,6 +167,12 @@ TEST_CASE_VERSIONS("bucket list", "[bucket][bucketlist]")
                     auto snapSz = countEntries(lev.getSnap());
                     CHECK(currSz <= BucketList::levelHalf(j) * 100);
                     CHECK(snapSz <= BucketList::levelHalf(j) * 100);
+
+                    // Cached level hash tracks curr and snap
+                    SHA256 hsh;
+                    hsh.add(lev.getCurr()->getHash());
+                    hsh.add(lev.getSnap()->getHash());
+                    CHECK(lev.getHash() == hsh.finish());
                 }
             }
         });
@@ -170,6 +185,31 @@ TEST_CASE_VERSIONS("bucket list", "[bucket][bucketlist]")
     }
 }
 
+TEST_CASE("bucket list with dedicated merge threads", "[bucket][bucketlist]")
+{
+    VirtualClock clock;
+    Config cfg = getTestConfig(0);
+    Config mergeCfg = getTestConfig(1);
+    mergeCfg.BUCKET_MERGE_THREADS = 2;
+
+    Application::pointer app = createTestApplication(clock, cfg);
+    Application::pointer mergeApp = createTestApplication(clock, mergeCfg);
+    BucketList bl;
+    BucketList mergeBl;
+    for (uint32_t i = 1; !app->getClock().getIOContext().stopped() && i < 130;
+         ++i)
+    {
+        app->getClock().crank(false);
+        auto live = LedgerTestUtils::generateValidUniqueLedgerEntries(8);
+        auto dead = LedgerTestUtils::generateValidLedgerEntryKeysWithExclusions(
+            {CONFIG_SETTING}, 5);
+        bl.addBatch(*app, i, getAppLedgerVersion(app), {}, live, dead);
+        mergeBl.addBatch(*mergeApp, i, getAppLedgerVersion(mergeApp), {}, live,
+                         dead);
+        REQUIRE(bl.getHash() == mergeBl.getHash());
+    }
+}
+
 TEST_CASE("bucketUpdatePeriod arithmetic", "[bucket][bucketlist]")
 {
     std::map<uint32_t, uint32_t> currCalculatedUpdatePeriods;
@@ -1226,6 +1266,11 @@ TEST_CASE_VERSIONS("eviction scan", "[bucketlist]")
     {
         test(/*backgroundScan=*/true);
     }
+    SECTION("multi-threaded background scan")
+    {
+        cfg.EXPERIMENTAL_BACKGROUND_EVICTION_SCAN_THREADS = 3;
+        test(/*backgroundScan=*/true);
+    }
 }
 
 TEST_CASE_VERSIONS("Searchable BucketListDB snapshots", "[bucketlist]")
@@ -1265,6 +1310,77 @@ TEST_CASE_VERSIONS("Searchable BucketListDB snapshots", "[bucketlist]")
         auto loadedEntry = searchableBL->getLedgerEntry(LedgerEntryKey(entry));
         REQUIRE((loadedEntry && *loadedEntry == entry));
     }
+
+    // Every lookup above found its entry at some level
+    auto& foundLevel = app->getMetrics().NewHistogram(
+        {"bucketlistDB", "found-level", "CLAIMABLE_BALANCE"});
+    REQUIRE(foundLevel.count() >= 100);
+
+    uint64_t lookups = 0;
+    uint64_t bloomPasses = 0;
+    for (uint32_t i = 0; i < BucketList::kNumLevels; ++i)
+    {
+        auto level = fmt::format("level-{}", i);
+        lookups += app->getMetrics()
+                       .NewMeter({"bucketlistDB", level, "lookups"}, "key")
+                       .count();
+        bloomPasses +=
+            app->getMetrics()
+                .NewMeter({"bucketlistDB", level, "bloom-passes"}, "key")
+                .count();
+    }
+    REQUIRE(bloomPasses >= 100);
+    REQUIRE(lookups >= bloomPasses);
+}
+
+TEST_CASE("BucketListDB snapshots refresh while ledgers close",
+          "[bucketlist]")
+{
+    VirtualClock clock;
+    Config cfg(getTestConfig(0, Config::TESTDB_IN_MEMORY_SQLITE));
+    cfg.DEPRECATED_SQL_LEDGER_STATE = false;
+
+    auto app = createTestApplication<BucketTestApplication>(clock, cfg);
+    LedgerManagerForBucketTests& lm = app->getLedgerManager();
+    auto& bm = app->getBucketManager();
+
+    auto entry =
+        LedgerTestUtils::generateValidLedgerEntryOfType(CLAIMABLE_BALANCE);
+    entry.data.claimableBalance().amount = 0;
+    lm.setNextLedgerEntryBatchForBucketTesting({}, {entry}, {});
+    closeLedger(*app);
+
+    // A reader thread keeps refreshing its own snapshot while the main thread
+    // publishes new ones. It must only ever observe snapshots moving forward.
+    std::atomic<bool> done{false};
+    bool readerOk = true;
+    auto searchableBL =
+        bm.getBucketSnapshotManager().getSearchableBucketListSnapshot();
+    std::thread reader([&] {
+        int64_t lastAmount = 0;
+        while (!done)
+        {
+            auto loaded = searchableBL->getLedgerEntry(LedgerEntryKey(entry));
+            if (!loaded ||
+                loaded->data.claimableBalance().amount < lastAmount)
+            {
+                readerOk = false;
+                return;
+            }
+            lastAmount = loaded->data.claimableBalance().amount;
+        }
+    });
+
+    for (auto ledgerSeq = 0; ledgerSeq < 50; ++ledgerSeq)
+    {
+        ++entry.data.claimableBalance().amount;
+        lm.setNextLedgerEntryBatchForBucketTesting({}, {entry}, {});
+        closeLedger(*app);
+    }
+
+    done = true;
+    reader.join();
+    REQUIRE(readerOk);
 }
 
 static std::string
@@ -1308,6 +1424,81 @@ formatLedgerList(std::vector<uint32_t> const& ledgers)
     return oss.str();
 }
 
+TEST_CASE("synthetic BucketList", "[bucketlist]")
+{
+    VirtualClock clock;
+    Config cfg(getTestConfig(0, Config::TESTDB_ON_DISK_SQLITE));
+    cfg.DEPRECATED_SQL_LEDGER_STATE = false;
+
+    SyntheticBucketListConfig blCfg;
+    blCfg.mLedger = 1000;
+    blCfg.mEntriesPerLedger = 5;
+    blCfg.mMaxBucketEntries = 1000;
+
+    SECTION("bad entry mix")
+    {
+        REQUIRE_THROWS_AS(blCfg.parseEntryMix("account=1,bogus=2"),
+                          std::invalid_argument);
+        REQUIRE_THROWS_AS(blCfg.parseEntryMix("account=0"),
+                          std::invalid_argument);
+    }
+
+    SECTION("generate and restart")
+    {
+        blCfg.parseEntryMix("account=5,trustline=2,persistent=2,temporary=1");
+        Hash blHash;
+        {
+            auto app = createTestApplication(clock, cfg);
+            auto root = TestAccount::createRoot(*app);
+            auto has = generateSyntheticBucketList(*app, blCfg);
+            REQUIRE(has.containsValidBuckets(*app));
+
+            auto& bl = app->getBucketManager().getBucketList();
+            blHash = bl.getHash();
+            auto const& lcl =
+                app->getLedgerManager().getLastClosedLedgerHeader().header;
+            REQUIRE(lcl.ledgerSeq == blCfg.mLedger);
+            REQUIRE(lcl.bucketListHash == blHash);
+
+            size_t ttls = 0;
+            size_t contractData = 0;
+            for (uint32_t i = 0; i < BucketList::kNumLevels; ++i)
+            {
+                auto const& level = bl.getLevel(i);
+                for (auto b : {level.getCurr(), level.getSnap()})
+                {
+                    REQUIRE(countEntries(b) <= 2 * blCfg.mMaxBucketEntries);
+                    for (BucketInputIterator in(b); in; ++in)
+                    {
+                        if ((*in).type() == DEADENTRY)
+                        {
+                            continue;
+                        }
+                        auto t = (*in).liveEntry().data.type();
+                        ttls += t == TTL;
+                        contractData += t == CONTRACT_DATA;
+                    }
+                }
+                REQUIRE(level.getCurr()->isEmpty() ==
+                        (BucketList::sizeOfCurr(blCfg.mLedger, i) == 0));
+            }
+            REQUIRE(contractData > 0);
+            REQUIRE(ttls == contractData);
+
+            // Genesis entries are still there, and readable through
+            // BucketListDB
+            REQUIRE(root.exists());
+        }
+
+        // The node restarts on the generated state
+        auto app = createTestApplication(clock, cfg, /* newDB */ false);
+        auto const& lcl =
+            app->getLedgerManager().getLastClosedLedgerHeader().header;
+        REQUIRE(lcl.ledgerSeq == blCfg.mLedger);
+        REQUIRE(app->getBucketManager().getBucketList().getHash() == blHash);
+    }
+}
+
 TEST_CASE("BucketList number dump", "[bucket][bucketlist][count][!hide]")
 {
     for (uint32_t level = 0; level < BucketList::kNumLevels; ++level)
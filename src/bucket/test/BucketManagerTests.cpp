@@ -14,7 +14,9 @@
 #include "bucket/BucketInputIterator.h"
 #include "bucket/BucketManager.h"
 #include "bucket/BucketManagerImpl.h"
+#include "bucket/BucketMergeMap.h"
 #include "bucket/test/BucketTestUtils.h"
+#include "crypto/SecretKey.h"
 #include "history/HistoryArchiveManager.h"
 #include "history/test/HistoryTestsUtils.h"
 #include "ledger/LedgerTxn.h"
@@ -27,8 +29,11 @@
 #include "test/test.h"
 #include "util/Math.h"
 #include "util/Timer.h"
+#include "util/TmpDir.h"
+#include "util/UnorderedMap.h"
 
 #include <cstdio>
+#include <mutex>
 #include <optional>
 #include <thread>
 
@@ -389,6 +394,45 @@ TEST_CASE_VERSIONS("bucketmanager reattach to finished merge",
     });
 }
 
+TEST_CASE("bucket merge map save and load", "[bucket][bucketmanager]")
+{
+    VirtualClock clock;
+    Config cfg(getTestConfig());
+    Application::pointer app = createTestApplication(clock, cfg);
+    auto tmpDir = app->getTmpDirManager().tmpDir("merge-map-test");
+    auto filename = tmpDir.getName() + "/merge-map.json";
+
+    auto randomHash = [] { return HashUtils::pseudoRandomForTesting(); };
+    MergeKey kept(true, randomHash(), randomHash(), {randomHash()});
+    MergeKey dropped(false, randomHash(), randomHash(), {});
+    auto keptOutput = randomHash();
+    auto droppedOutput = randomHash();
+
+    BucketMergeMap map;
+    map.recordMerge(kept, keptOutput);
+    map.recordMerge(dropped, droppedOutput);
+    map.save(filename, [](Hash const&) { return true; });
+
+    BucketMergeMap loaded;
+    loaded.load(filename, [&](Hash const& output) {
+        return output == keptOutput;
+    });
+
+    Hash out;
+    REQUIRE(loaded.findMergeFor(kept, out));
+    REQUIRE(out == keptOutput);
+    REQUIRE(!loaded.findMergeFor(dropped, out));
+
+    std::set<Hash> outputs;
+    loaded.getOutputsUsingInput(kept.mInputShadowBuckets.front(), outputs);
+    REQUIRE(outputs == std::set<Hash>{keptOutput});
+
+    // Loading a missing file leaves the map unchanged
+    loaded.load(tmpDir.getName() + "/missing.json",
+                [](Hash const&) { return true; });
+    REQUIRE(loaded.findMergeFor(kept, out));
+}
+
 TEST_CASE_VERSIONS("bucketmanager reattach to running merge",
                    "[bucket][bucketmanager]")
 {
@@ -1478,3 +1522,101 @@ TEST_CASE_VERSIONS("bucket persistence over app restart",
         }
     });
 }
+
+TEST_CASE("bucketmanager visit ledger entries", "[bucket][bucketmanager]")
+{
+    VirtualClock clock;
+    Config cfg(getTestConfig());
+    Application::pointer app = createTestApplication(clock, cfg);
+    BucketManager& bm = app->getBucketManager();
+    BucketList& bl = bm.getBucketList();
+    auto vers = getAppLedgerVersion(app);
+
+    // Entries are created, then some of them updated or deleted in later
+    // ledgers, so that newer buckets shadow older versions of entries
+    UnorderedMap<LedgerKey, LedgerEntry> expected;
+    uint32_t ledger = 1;
+    for (; ledger < 300; ++ledger)
+    {
+        std::vector<LedgerEntry> init;
+        std::vector<LedgerEntry> live;
+        std::vector<LedgerKey> dead;
+        for (auto& e : LedgerTestUtils::generateValidUniqueLedgerEntries(5))
+        {
+            auto key = LedgerEntryKey(e);
+            if (expected.find(key) == expected.end())
+            {
+                e.lastModifiedLedgerSeq = ledger;
+                expected.emplace(key, e);
+                init.emplace_back(e);
+            }
+        }
+        if (ledger % 3 == 0)
+        {
+            auto it = std::next(expected.begin(), ledger % expected.size());
+            if (it->second.lastModifiedLedgerSeq != ledger)
+            {
+                it->second.lastModifiedLedgerSeq = ledger;
+                live.emplace_back(it->second);
+            }
+        }
+        if (ledger % 7 == 0)
+        {
+            auto it =
+                std::next(expected.begin(), (ledger / 7) % expected.size());
+            if (it->second.lastModifiedLedgerSeq != ledger)
+            {
+                dead.emplace_back(it->first);
+                expected.erase(it);
+            }
+        }
+        bl.addBatch(*app, ledger, vers, init, live, dead);
+    }
+    HistoryArchiveState has(ledger - 1, bl,
+                            app->getConfig().NETWORK_PASSPHRASE);
+
+    SECTION("sequential")
+    {
+        UnorderedMap<LedgerKey, LedgerEntry> visited;
+        bm.visitLedgerEntries(
+            has, std::nullopt, [](LedgerEntry const&) { return true; },
+            [&](LedgerEntry const& e) {
+                REQUIRE(visited.emplace(LedgerEntryKey(e), e).second);
+                return true;
+            });
+        REQUIRE(visited == expected);
+    }
+
+    SECTION("filtered entries shadow older versions")
+    {
+        bm.visitLedgerEntries(
+            has, std::nullopt,
+            [](LedgerEntry const& e) {
+                return e.lastModifiedLedgerSeq % 2 == 0;
+            },
+            [&](LedgerEntry const& e) {
+                REQUIRE(e.lastModifiedLedgerSeq % 2 == 0);
+                REQUIRE(expected.at(LedgerEntryKey(e)) == e);
+                return true;
+            });
+    }
+
+    SECTION("parallel")
+    {
+        std::mutex mutex;
+        UnorderedMap<LedgerKey, LedgerEntry> visited;
+        size_t errors = 0;
+        bm.visitLedgerEntriesInParallel(
+            has, 4, [&](size_t thread, LedgerEntry const& e) {
+                std::lock_guard<std::mutex> guard(mutex);
+                auto inserted = visited.emplace(LedgerEntryKey(e), e).second;
+                if (thread >= 4 || !inserted)
+                {
+                    ++errors;
+                }
+                return true;
+            });
+        REQUIRE(errors == 0);
+        REQUIRE(visited == expected);
+    }
+}
@@ -15,6 +15,7 @@
 #include "bucket/BucketInputIterator.h"
 #include "bucket/BucketManager.h"
 #include "bucket/BucketOutputIterator.h"
+#include "bucket/LedgerCmp.h"
 #include "bucket/test/BucketTestUtils.h"
 #include "ledger/LedgerTxn.h"
 #include "ledger/test/LedgerTestUtils.h"
@@ -99,6 +100,102 @@ TEST_CASE_VERSIONS("file backed buckets", "[bucket][bucketbench]")
     });
 }
 
+TEST_CASE_VERSIONS("fresh bucket does not depend on input order", "[bucket]")
+{
+    VirtualClock clock;
+    Config const& cfg = getTestConfig();
+    for_versions_with_differing_initentry_logic(cfg, [&](Config const& cfg) {
+        Application::pointer app = createTestApplication(clock, cfg);
+        auto entries = LedgerTestUtils::generateValidUniqueLedgerEntries(300);
+        std::vector<LedgerEntry> init(entries.begin(), entries.begin() + 100);
+        std::vector<LedgerEntry> live(entries.begin() + 100,
+                                      entries.begin() + 200);
+        std::vector<LedgerKey> dead;
+        for (auto it = entries.begin() + 200; it != entries.end(); ++it)
+        {
+            dead.emplace_back(LedgerEntryKey(*it));
+        }
+
+        auto fresh = [&]() {
+            return Bucket::fresh(app->getBucketManager(),
+                                 getAppLedgerVersion(app), init, live, dead,
+                                 /*countMergeEvents=*/true,
+                                 clock.getIOContext(), /*doFsync=*/true);
+        };
+        auto unsortedHash = fresh()->getHash();
+
+        LedgerEntryIdCmp cmp;
+        auto entryCmp = [&cmp](LedgerEntry const& a, LedgerEntry const& b) {
+            return cmp(a.data, b.data);
+        };
+        std::sort(init.begin(), init.end(), entryCmp);
+        std::sort(live.begin(), live.end(), entryCmp);
+        std::sort(dead.begin(), dead.end(), cmp);
+        REQUIRE(fresh()->getHash() == unsortedHash);
+    });
+}
+
+TEST_CASE("small buckets keep their entries in memory", "[bucket]")
+{
+    VirtualClock clock;
+    Config cfg = getTestConfig(0);
+    Config diskCfg = getTestConfig(1);
+    diskCfg.BUCKET_IN_MEMORY_CUTOFF = 0;
+    Application::pointer app = createTestApplication(clock, cfg);
+    Application::pointer diskApp = createTestApplication(clock, diskCfg);
+
+    auto live1 = LedgerTestUtils::generateValidUniqueLedgerEntries(200);
+    auto live2 = LedgerTestUtils::generateValidUniqueLedgerEntries(200);
+    auto dead = LedgerTestUtils::generateValidLedgerEntryKeysWithExclusions(
+        {CONFIG_SETTING}, 50);
+
+    auto mergeOn = [&](Application& a) {
+        auto& bm = a.getBucketManager();
+        auto vers = getAppLedgerVersion(a);
+        auto b1 = Bucket::fresh(bm, vers, {}, live1, dead,
+                                /*countMergeEvents=*/true,
+                                clock.getIOContext(), /*doFsync=*/true);
+        auto b2 = Bucket::fresh(bm, vers, {}, live2, {},
+                                /*countMergeEvents=*/true,
+                                clock.getIOContext(), /*doFsync=*/true);
+        REQUIRE(!!b1->getInMemoryEntries() ==
+                (a.getConfig().BUCKET_IN_MEMORY_CUTOFF != 0));
+        return Bucket::merge(bm, vers, b1, b2, /*shadows=*/{},
+                             /*keepDeadEntries=*/true,
+                             /*countMergeEvents=*/true, clock.getIOContext(),
+                             /*doFsync=*/true);
+    };
+
+    auto merged = mergeOn(*app);
+    auto diskMerged = mergeOn(*diskApp);
+    REQUIRE(merged->getHash() == diskMerged->getHash());
+
+    auto inMemory = merged->getInMemoryEntries();
+    REQUIRE(inMemory);
+    REQUIRE(!diskMerged->getInMemoryEntries());
+    REQUIRE(inMemory->mFileSize == merged->getSize());
+
+    // The in-memory entries and offsets match the file's contents
+    XDRInputFileStream in;
+    in.open(merged->getFilename().string());
+    BucketEntry be;
+    for (size_t i = 0; i < inMemory->mEntries.size(); ++i)
+    {
+        REQUIRE(inMemory->mOffsets[i] == in.pos());
+        REQUIRE(in.readOne(be));
+        REQUIRE(inMemory->mEntries[i] == be);
+    }
+    REQUIRE(!in.readOne(be));
+
+    // And iterating the bucket yields them, past its METAENTRY
+    size_t i = inMemory->mEntries.front().type() == METAENTRY ? 1 : 0;
+    for (BucketInputIterator iter(merged); iter; ++iter, ++i)
+    {
+        REQUIRE(*iter == inMemory->mEntries.at(i));
+    }
+    REQUIRE(i == inMemory->mEntries.size());
+}
+
 TEST_CASE_VERSIONS("merging bucket entries", "[bucket]")
 {
     VirtualClock clock;
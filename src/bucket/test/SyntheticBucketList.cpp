@@ -0,0 +1,507 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "bucket/test/SyntheticBucketList.h"
+#include "bucket/Bucket.h"
+#include "bucket/BucketInputIterator.h"
+#include "bucket/BucketList.h"
+#include "bucket/BucketManager.h"
+#include "crypto/SHA.h"
+#include "ledger/LedgerManager.h"
+#include "ledger/LedgerTypeUtils.h"
+#include "ledger/test/LedgerTestUtils.h"
+#include "main/Application.h"
+#include "util/GlobalChecks.h"
+#include "util/Logging.h"
+#include "util/Math.h"
+#include "util/ProtocolVersion.h"
+#include "util/types.h"
+#include <Tracy.hpp>
+#include <algorithm>
+#include <cmath>
+#include <fmt/format.h>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace stellar
+{
+
+namespace
+{
+// Entries generated before they are written out as a bucket; larger buckets
+// are written in chunks of this many, which are then merged
+size_t const CHUNK_ENTRIES = 1 << 19;
+
+std::array<char const*, SyntheticBucketListConfig::NUM_ENTRY_TYPES> const
+    ENTRY_TYPE_NAMES = {"account",    "trustline", "offer", "data",
+                        "persistent", "temporary", "code"};
+
+uint64_t
+splitMix64(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// Generates the entries of a synthetic BucketList, oldest bucket first. Each
+// entry is identified by an index, from which its key (but not its value) is
+// derived, so that updates and deletions of older entries only need to pick
+// an index below those of the entries created so far.
+class SyntheticEntryGenerator
+{
+    Application& mApp;
+    SyntheticBucketListConfig const& mCfg;
+    uint32_t const mProtocolVersion;
+    uint32_t mTotalWeight{0};
+    AccountID mIssuer;
+    uint64_t mNextIndex{0};
+
+    struct Batch
+    {
+        std::vector<LedgerEntry> mInit;
+        std::vector<LedgerEntry> mLive;
+        std::vector<LedgerKey> mDead;
+
+        size_t
+        size() const
+        {
+            return mInit.size() + mLive.size() + mDead.size();
+        }
+    };
+
+    Hash
+    hashOf(uint64_t index, char const* tag) const
+    {
+        return sha256(fmt::format("synthetic {} {}", tag, index));
+    }
+
+    AccountID
+    accountOf(uint64_t index) const
+    {
+        AccountID res;
+        res.ed25519() = hashOf(index, "account");
+        return res;
+    }
+
+    SyntheticBucketListConfig::EntryType
+    typeOf(uint64_t index) const
+    {
+        auto w = splitMix64(index) % mTotalWeight;
+        size_t t = 0;
+        for (; t + 1 < mCfg.mEntryMix.size() && w >= mCfg.mEntryMix[t]; ++t)
+        {
+            w -= mCfg.mEntryMix[t];
+        }
+        return static_cast<SyntheticBucketListConfig::EntryType>(t);
+    }
+
+    LedgerEntry
+    makeEntry(uint64_t index, uint32_t lastModified) const
+    {
+        using Type = SyntheticBucketListConfig;
+        LedgerEntry e;
+        e.lastModifiedLedgerSeq = lastModified;
+        switch (typeOf(index))
+        {
+        case Type::ACCOUNT:
+            e.data.type(ACCOUNT);
+            e.data.account() = LedgerTestUtils::generateValidAccountEntry();
+            e.data.account().accountID = accountOf(index);
+            break;
+        case Type::TRUSTLINE:
+        {
+            e.data.type(TRUSTLINE);
+            auto& tl = e.data.trustLine();
+            tl = LedgerTestUtils::generateValidTrustLineEntry();
+            tl.accountID = accountOf(index);
+            tl.asset.type(ASSET_TYPE_CREDIT_ALPHANUM4);
+            strToAssetCode(tl.asset.alphaNum4().assetCode, "SYNT");
+            tl.asset.alphaNum4().issuer = mIssuer;
+            break;
+        }
+        case Type::OFFER:
+            e.data.type(OFFER);
+            e.data.offer() = LedgerTestUtils::generateValidOfferEntry();
+            e.data.offer().sellerID = accountOf(index);
+            e.data.offer().offerID = static_cast<int64_t>(index) + 1;
+            break;
+        case Type::DATA:
+            e.data.type(DATA);
+            e.data.data() = LedgerTestUtils::generateValidDataEntry();
+            e.data.data().accountID = accountOf(index);
+            e.data.data().dataName = "synthetic";
+            break;
+        case Type::PERSISTENT_CONTRACT_DATA:
+        case Type::TEMPORARY_CONTRACT_DATA:
+        {
+            e.data.type(CONTRACT_DATA);
+            auto& cd = e.data.contractData();
+            cd = LedgerTestUtils::generateValidContractDataEntry();
+            cd.contract.type(SC_ADDRESS_TYPE_CONTRACT);
+            cd.contract.contractId() = hashOf(index, "contract");
+            cd.key.type(SCV_U64);
+            cd.key.u64() = index;
+            cd.durability = typeOf(index) == Type::PERSISTENT_CONTRACT_DATA
+                                ? ContractDataDurability::PERSISTENT
+                                : ContractDataDurability::TEMPORARY;
+            break;
+        }
+        case Type::CONTRACT_CODE:
+            e.data.type(CONTRACT_CODE);
+            e.data.contractCode() =
+                LedgerTestUtils::generateValidContractCodeEntry();
+            e.data.contractCode().hash = hashOf(index, "code");
+            break;
+        default:
+            releaseAssert(false);
+        }
+        return e;
+    }
+
+    LedgerEntry
+    makeTTL(LedgerEntry const& e) const
+    {
+        LedgerEntry ttl;
+        ttl.lastModifiedLedgerSeq = e.lastModifiedLedgerSeq;
+        ttl.data.type(TTL);
+        ttl.data.ttl().keyHash = getTTLKey(e).ttl().keyHash;
+        if (e.lastModifiedLedgerSeq < mCfg.mLedger &&
+            rand_uniform<uint32_t>(0, 99) < mCfg.mExpiredPercent)
+        {
+            ttl.data.ttl().liveUntilLedgerSeq = rand_uniform<uint32_t>(
+                e.lastModifiedLedgerSeq, mCfg.mLedger - 1);
+        }
+        else
+        {
+            ttl.data.ttl().liveUntilLedgerSeq =
+                mCfg.mLedger + rand_uniform<uint32_t>(1, 1 << 20);
+        }
+        return ttl;
+    }
+
+    void
+    put(uint64_t index, uint32_t lastModified, std::vector<LedgerEntry>& out)
+    {
+        out.emplace_back(makeEntry(index, lastModified));
+        if (isSorobanEntry(out.back().data))
+        {
+            auto ttl = makeTTL(out.back());
+            out.emplace_back(ttl);
+        }
+    }
+
+    void
+    erase(uint64_t index, std::vector<LedgerKey>& out)
+    {
+        out.emplace_back(LedgerEntryKey(makeEntry(index, 0)));
+        if (isSorobanEntry(out.back()))
+        {
+            auto ttlKey = getTTLKey(out.back());
+            out.emplace_back(ttlKey);
+        }
+    }
+
+    // One of the entries created before base, favoring recent ones as much
+    // as mRecencyBias asks for
+    uint64_t
+    pickOlderIndex(uint64_t base) const
+    {
+        auto offset = static_cast<uint64_t>(
+            static_cast<double>(base) *
+            std::pow(rand_fraction(), mCfg.mRecencyBias));
+        return base - 1 - std::min(offset, base - 1);
+    }
+
+    std::shared_ptr<Bucket>
+    write(Batch& batch)
+    {
+        auto b = Bucket::fresh(mApp.getBucketManager(), mProtocolVersion,
+                               batch.mInit, batch.mLive, batch.mDead,
+                               /* countMergeEvents */ false,
+                               mApp.getClock().getIOContext(),
+                               /* doFsync */ false);
+        batch = Batch{};
+        return b;
+    }
+
+    // Merges chunks of one bucket, oldest first, pairwise so that every
+    // entry is only rewritten log(chunks) times
+    std::shared_ptr<Bucket>
+    mergeChunks(std::vector<std::shared_ptr<Bucket>> chunks,
+                bool keepDeadEntries)
+    {
+        while (chunks.size() > 1)
+        {
+            std::vector<std::shared_ptr<Bucket>> merged;
+            for (size_t i = 0; i < chunks.size(); i += 2)
+            {
+                if (i + 1 == chunks.size())
+                {
+                    merged.emplace_back(chunks[i]);
+                    continue;
+                }
+                merged.emplace_back(Bucket::merge(
+                    mApp.getBucketManager(), mProtocolVersion, chunks[i],
+                    chunks[i + 1], /* shadows */ {}, keepDeadEntries,
+                    /* countMergeEvents */ false,
+                    mApp.getClock().getIOContext(), /* doFsync */ false));
+            }
+            chunks = std::move(merged);
+        }
+        return chunks.front();
+    }
+
+  public:
+    SyntheticEntryGenerator(Application& app,
+                            SyntheticBucketListConfig const& cfg,
+                            uint32_t protocolVersion)
+        : mApp(app), mCfg(cfg), mProtocolVersion(protocolVersion)
+    {
+        for (auto w : mCfg.mEntryMix)
+        {
+            mTotalWeight += w;
+        }
+        releaseAssert(mTotalWeight > 0);
+        mIssuer.ed25519() = sha256("synthetic issuer");
+    }
+
+    // The bucket covering `ledgers` ledgers from oldestLedger on level
+    // `level`, with `extraEntries` (if any) as additional new entries
+    std::shared_ptr<Bucket>
+    makeBucket(uint32_t level, uint32_t oldestLedger, uint32_t ledgers,
+               std::vector<LedgerEntry> extraEntries)
+    {
+        uint64_t n = static_cast<uint64_t>(ledgers) * mCfg.mEntriesPerLedger;
+        if (mCfg.mMaxBucketEntries != 0)
+        {
+            n = std::min(n, mCfg.mMaxBucketEntries);
+        }
+        bool keepDeadEntries = BucketList::keepDeadEntries(level);
+        auto base = mNextIndex;
+
+        std::vector<std::shared_ptr<Bucket>> chunks;
+        Batch batch;
+        batch.mInit = std::move(extraEntries);
+        // Older entries already changed in this chunk
+        std::unordered_set<uint64_t> changed;
+        for (uint64_t i = 0; i < n; ++i)
+        {
+            auto lastModified =
+                oldestLedger + rand_uniform<uint32_t>(0, ledgers - 1);
+            auto r = rand_uniform<uint32_t>(0, 99);
+            if (base > 0 && r < mCfg.mUpdatePercent + mCfg.mDeletePercent)
+            {
+                auto index = pickOlderIndex(base);
+                if (!changed.insert(index).second)
+                {
+                    continue;
+                }
+                if (keepDeadEntries && r < mCfg.mDeletePercent)
+                {
+                    erase(index, batch.mDead);
+                }
+                else
+                {
+                    put(index, lastModified, batch.mLive);
+                }
+            }
+            else
+            {
+                put(mNextIndex++, lastModified, batch.mInit);
+            }
+
+            if (batch.size() >= CHUNK_ENTRIES)
+            {
+                chunks.emplace_back(write(batch));
+                changed.clear();
+            }
+        }
+        if (batch.size() > 0 || chunks.empty())
+        {
+            chunks.emplace_back(write(batch));
+        }
+        return mergeChunks(std::move(chunks), keepDeadEntries);
+    }
+};
+}
+
+void
+SyntheticBucketListConfig::parseEntryMix(std::string const& mix)
+{
+    std::array<uint32_t, NUM_ENTRY_TYPES> res{};
+    size_t pos = 0;
+    while (pos < mix.size())
+    {
+        auto end = mix.find(',', pos);
+        if (end == std::string::npos)
+        {
+            end = mix.size();
+        }
+        auto item = mix.substr(pos, end - pos);
+        pos = end + 1;
+
+        auto eq = item.find('=');
+        auto name = item.substr(0, eq);
+        auto it =
+            std::find(ENTRY_TYPE_NAMES.begin(), ENTRY_TYPE_NAMES.end(), name);
+        if (eq == std::string::npos || it == ENTRY_TYPE_NAMES.end())
+        {
+            throw std::invalid_argument(
+                fmt::format("Bad entry mix item '{}', expected TYPE=WEIGHT "
+                            "with TYPE one of account, trustline, offer, "
+                            "data, persistent, temporary or code",
+                            item));
+        }
+        try
+        {
+            res[it - ENTRY_TYPE_NAMES.begin()] =
+                static_cast<uint32_t>(std::stoul(item.substr(eq + 1)));
+        }
+        catch (std::logic_error const&)
+        {
+            throw std::invalid_argument(
+                fmt::format("Bad weight in entry mix item '{}'", item));
+        }
+    }
+    uint64_t total = 0;
+    for (auto w : res)
+    {
+        total += w;
+    }
+    if (total == 0 || total > UINT32_MAX)
+    {
+        throw std::invalid_argument(
+            fmt::format("Entry mix '{}' must have a positive total weight "
+                        "that fits in 32 bits",
+                        mix));
+    }
+    mEntryMix = res;
+}
+
+HistoryArchiveState
+generateSyntheticBucketList(Application& app,
+                            SyntheticBucketListConfig const& cfg)
+{
+    ZoneScoped;
+    auto& lm = app.getLedgerManager();
+    auto& bm = app.getBucketManager();
+    auto lcl = lm.getLastClosedLedgerHeader();
+    auto version = lcl.header.ledgerVersion;
+
+    if (lcl.header.ledgerSeq != LedgerManager::GENESIS_LEDGER_SEQ)
+    {
+        throw std::runtime_error(
+            "Synthetic BucketLists must be generated from genesis");
+    }
+    if (!app.getConfig().isUsingBucketListDB())
+    {
+        throw std::runtime_error(
+            "Synthetic BucketLists are only generated for BucketListDB");
+    }
+    if (cfg.mLedger <= lcl.header.ledgerSeq)
+    {
+        throw std::invalid_argument(fmt::format(
+            "Ledger {} must be after genesis for a synthetic BucketList",
+            cfg.mLedger));
+    }
+    if (cfg.mEntriesPerLedger == 0 ||
+        cfg.mUpdatePercent + cfg.mDeletePercent > 100 ||
+        cfg.mExpiredPercent > 100 || cfg.mRecencyBias <= 0)
+    {
+        throw std::invalid_argument(
+            "Synthetic BucketList needs a positive number of entries per "
+            "ledger and recency bias, and percentages that add up to at "
+            "most 100");
+    }
+    // Restarting merges on a BucketList without any in progress needs this
+    if (protocolVersionIsBefore(version,
+                                Bucket::FIRST_PROTOCOL_SHADOWS_REMOVED))
+    {
+        throw std::runtime_error(fmt::format(
+            "Synthetic BucketLists need protocol {} or later, genesis is {}",
+            static_cast<uint32_t>(Bucket::FIRST_PROTOCOL_SHADOWS_REMOVED),
+            version));
+    }
+    using Type = SyntheticBucketListConfig;
+    bool hasSoroban = cfg.mEntryMix[Type::PERSISTENT_CONTRACT_DATA] != 0 ||
+                      cfg.mEntryMix[Type::TEMPORARY_CONTRACT_DATA] != 0 ||
+                      cfg.mEntryMix[Type::CONTRACT_CODE] != 0;
+    if (hasSoroban &&
+        protocolVersionIsBefore(version, SOROBAN_PROTOCOL_VERSION))
+    {
+        throw std::runtime_error(fmt::format(
+            "Contract entries need protocol {} or later, genesis is {}",
+            static_cast<uint32_t>(SOROBAN_PROTOCOL_VERSION), version));
+    }
+
+    std::vector<LedgerEntry> genesisEntries;
+    auto& genesisBL = bm.getBucketList();
+    for (uint32_t i = 0; i < BucketList::kNumLevels; ++i)
+    {
+        for (auto const& b : {genesisBL.getLevel(i).getCurr(),
+                              genesisBL.getLevel(i).getSnap()})
+        {
+            for (BucketInputIterator in(b); in; ++in)
+            {
+                if ((*in).type() == LIVEENTRY || (*in).type() == INITENTRY)
+                {
+                    genesisEntries.emplace_back((*in).liveEntry());
+                }
+            }
+        }
+    }
+
+    SyntheticEntryGenerator gen(app, cfg, version);
+    BucketList bl;
+    for (uint32_t i = BucketList::kNumLevels; i-- > 0;)
+    {
+        // Snap is older than curr
+        for (bool isCurr : {false, true})
+        {
+            auto ledgers = isCurr ? BucketList::sizeOfCurr(cfg.mLedger, i)
+                                  : BucketList::sizeOfSnap(cfg.mLedger, i);
+            if (ledgers == 0)
+            {
+                continue;
+            }
+            auto oldest = isCurr
+                              ? BucketList::oldestLedgerInCurr(cfg.mLedger, i)
+                              : BucketList::oldestLedgerInSnap(cfg.mLedger, i);
+            auto b =
+                gen.makeBucket(i, oldest, ledgers, std::move(genesisEntries));
+            genesisEntries.clear();
+            CLOG_INFO(Bucket,
+                      "Generated {} of level {}: ledgers {}-{}, {} bytes",
+                      isCurr ? "curr" : "snap", i, oldest,
+                      oldest + ledgers - 1, b->getSize());
+            if (isCurr)
+            {
+                bl.getLevel(i).setCurr(b);
+            }
+            else
+            {
+                bl.getLevel(i).setSnap(b);
+            }
+        }
+    }
+
+    HistoryArchiveState has(cfg.mLedger, bl,
+                            app.getConfig().NETWORK_PASSPHRASE);
+    bm.assumeState(has, version, /* restartMerges */ false);
+
+    LedgerHeaderHistoryEntry lhhe;
+    lhhe.header = lcl.header;
+    lhhe.header.ledgerSeq = cfg.mLedger;
+    lhhe.header.previousLedgerHash = lcl.hash;
+    lhhe.header.bucketListHash = bl.getHash();
+    lhhe.hash = xdrSha256(lhhe.header);
+    lm.setLastClosedLedger(lhhe, /* storeInDB */ true);
+
+    // Drop the chunks that were merged into the buckets
+    bm.forgetUnreferencedBuckets();
+    return has;
+}
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "history/HistoryArchive.h"
+#include <array>
+#include <cstdint>
+#include <string>
+
+namespace stellar
+{
+
+class Application;
+
+// Shape of a synthetic BucketList, for benchmarks of BucketListDB lookups,
+// merges, eviction and startup that need a realistically large BucketList
+// without catching up to a real network.
+//
+// Every bucket holds entries for the ledgers that BucketList::sizeOfCurr and
+// sizeOfSnap say it covers as of mLedger: mEntriesPerLedger for each of
+// them, capped at mMaxBucketEntries (if non-zero) to model the updates that
+// merges collapse in deeper levels. Of those, mUpdatePercent are updates and
+// mDeletePercent deletions of entries created in older buckets, and the rest
+// are new entries. Contract data and code also get the TTL entries that go
+// with them, mExpiredPercent of which have expired by mLedger.
+struct SyntheticBucketListConfig
+{
+    enum EntryType
+    {
+        ACCOUNT,
+        TRUSTLINE,
+        OFFER,
+        DATA,
+        PERSISTENT_CONTRACT_DATA,
+        TEMPORARY_CONTRACT_DATA,
+        CONTRACT_CODE,
+        NUM_ENTRY_TYPES
+    };
+
+    uint32_t mLedger{1'000'000};
+    uint32_t mEntriesPerLedger{10};
+    uint64_t mMaxBucketEntries{0};
+
+    // Relative weights of the types of new entries, indexed by EntryType
+    std::array<uint32_t, NUM_ENTRY_TYPES> mEntryMix{40, 25, 5, 2, 20, 6, 2};
+
+    uint32_t mUpdatePercent{60};
+    uint32_t mDeletePercent{5};
+
+    // How updates and deletions pick the entries they change: 1 picks
+    // uniformly among all older entries, larger values favor recently
+    // created ones.
+    double mRecencyBias{1.0};
+
+    uint32_t mExpiredPercent{10};
+
+    // Parses a mix like "account=40,trustline=25,persistent=20" into
+    // mEntryMix, types not mentioned getting weight 0. Types are account,
+    // trustline, offer, data, persistent, temporary (contract data) and code.
+    // Throws std::invalid_argument on unknown types or an all-0 mix.
+    void parseEntryMix(std::string const& mix);
+};
+
+// Replaces the BucketList of app, which must be at genesis and use
+// BucketListDB, with a synthetic one as of cfg.mLedger, and makes that ledger
+// the LCL so that the node can be restarted on it. The genesis entries are
+// kept in the oldest bucket. No merges are left in progress; they restart,
+// as after any restart, when the node next starts. Returns the HAS of the
+// new BucketList.
+HistoryArchiveState
+generateSyntheticBucketList(Application& app,
+                            SyntheticBucketListConfig const& cfg);
+}
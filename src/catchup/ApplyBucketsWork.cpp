@@ -192,7 +192,11 @@ ApplyBucketsWork::doReset()
         size_t const totalLECount = mTotalSize / estimatedLedgerEntrySize;
         CLOG_INFO(History, "ApplyBuckets estimated {} ledger entries",
                   totalLECount);
-        mApp.getLedgerTxnRoot().prepareNewObjects(totalLECount);
+        // Entries are not created one by one with a compact in-memory index
+        if (!mApp.getConfig().EXPERIMENTAL_IN_MEMORY_LEDGER_INDEX)
+        {
+            mApp.getLedgerTxnRoot().prepareNewObjects(totalLECount);
+        }
     }
 
     mLevel = startingLevel();
@@ -326,6 +330,16 @@ ApplyBucketsWork::doWork()
             }
         }
 
+        if (mApp.getConfig().EXPERIMENTAL_IN_MEMORY_LEDGER_INDEX)
+        {
+            seedInMemoryLedger();
+            CLOG_INFO(History, "ApplyBuckets : done, assuming state");
+            mAssumeStateWork =
+                addWork<AssumeStateWork>(mApplyState, mMaxProtocolVersion,
+                                         /* restartMerges */ true);
+            return checkChildrenStatus();
+        }
+
         // Check if we're at the beginning of the new level
         if (isLevelComplete())
         {
@@ -395,6 +409,25 @@ ApplyBucketsWork::doWork()
     return checkChildrenStatus();
 }
 
+// In-memory mode with a compact index reads every bucket once, newest first,
+// into the index, so there is no need to go level by level
+void
+ApplyBucketsWork::seedInMemoryLedger()
+{
+    ZoneScoped;
+    std::vector<std::shared_ptr<Bucket const>> buckets;
+    for (auto const& hsb : mApplyState.currentBuckets)
+    {
+        buckets.emplace_back(getBucket(hsb.curr));
+        buckets.emplace_back(getBucket(hsb.snap));
+    }
+    mApp.seedInMemoryLedgerState(buckets);
+    mApp.getCatchupManager().bucketsApplied(
+        static_cast<uint32_t>(mTotalBuckets));
+    mAppliedBuckets = mTotalBuckets;
+    mAppliedSize = mTotalSize;
+}
+
 void
 ApplyBucketsWork::advance(std::string const& bucketName,
                           BucketApplicator& applicator)
@@ -52,6 +52,7 @@ class ApplyBucketsWork : public Work
     std::shared_ptr<Bucket> getBucket(std::string const& bucketHash);
     BucketLevel& getBucketLevel(uint32_t level);
     void startLevel();
+    void seedInMemoryLedger();
     bool isLevelComplete();
 
     bool mDelayChecked{false};
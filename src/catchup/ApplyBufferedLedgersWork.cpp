@@ -25,6 +25,16 @@ ApplyBufferedLedgersWork::onReset()
     mConditionalWork.reset();
 }
 
+bool
+ApplyBufferedLedgersWork::mergesResolvedForNextLedger(Application& app)
+{
+    auto& bl = app.getBucketManager().getBucketList();
+    auto& lm = app.getLedgerManager();
+    bl.resolveAnyReadyFutures();
+    return bl.futuresAllResolved(
+        bl.getMaxMergeLevel(lm.getLastClosedLedgerNum() + 1));
+}
+
 BasicWork::State
 ApplyBufferedLedgersWork::onRun()
 {
@@ -38,13 +48,35 @@ ApplyBufferedLedgersWork::onRun()
         }
     }
 
-    std::optional<LedgerCloseData> maybeLcd =
-        mApp.getCatchupManager().maybeGetNextBufferedLedgerToApply();
-
-    if (!maybeLcd)
+    // Fast-forward through the ledgers that can be applied without waiting.
+    // Each is still a full close of its own, with its own meta and commit.
+    auto const deadline = mApp.getClock().now() + MAX_CRANK_TIME;
+    std::optional<LedgerCloseData> maybeLcd;
+    for (size_t applied = 0;; ++applied)
     {
-        CLOG_INFO(History, "No more buffered ledgers to apply");
-        return State::WORK_SUCCESS;
+        maybeLcd = mApp.getCatchupManager().maybeGetNextBufferedLedgerToApply();
+        if (!maybeLcd)
+        {
+            CLOG_INFO(History, "No more buffered ledgers to apply");
+            return State::WORK_SUCCESS;
+        }
+        if (applied == MAX_LEDGERS_PER_CRANK ||
+            mApp.getClock().now() >= deadline ||
+            !mergesResolvedForNextLedger(mApp))
+        {
+            break;
+        }
+
+        auto const& lcd = maybeLcd.value();
+        CLOG_INFO(History,
+                  "Applying buffered ledger-close: [seq={}, prev={}, txs={}, "
+                  "ops={}, sv: {}]",
+                  lcd.getLedgerSeq(),
+                  hexAbbrev(lcd.getTxSet()->previousLedgerHash()),
+                  lcd.getTxSet()->sizeTxTotal(),
+                  lcd.getTxSet()->sizeOpTotalForLogging(),
+                  stellarValueToString(mApp.getConfig(), lcd.getValue()));
+        mApp.getLedgerManager().closeLedger(lcd);
     }
     auto const& lcd = maybeLcd.value();
 
@@ -58,20 +90,13 @@ ApplyBufferedLedgersWork::onRun()
 
     auto applyLedger = std::make_shared<ApplyLedgerWork>(mApp, lcd);
 
-    auto predicate = [](Application& app) {
-        auto& bl = app.getBucketManager().getBucketList();
-        auto& lm = app.getLedgerManager();
-        bl.resolveAnyReadyFutures();
-        return bl.futuresAllResolved(
-            bl.getMaxMergeLevel(lm.getLastClosedLedgerNum() + 1));
-    };
-
     mConditionalWork = std::make_shared<ConditionalWork>(
         mApp,
         fmt::format(
             FMT_STRING("apply-buffered-ledger-conditional ledger({:d})"),
             lcd.getLedgerSeq()),
-        predicate, applyLedger, std::chrono::milliseconds(500));
+        mergesResolvedForNextLedger, applyLedger,
+        std::chrono::milliseconds(500));
 
     mConditionalWork->startWork(wakeSelfUpCallback());
 
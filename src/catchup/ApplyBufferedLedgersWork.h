@@ -11,11 +11,21 @@
 namespace stellar
 {
 
+// Applies the ledgers buffered while catching up, until none are left. A run
+// of ledgers whose bucket merges are already resolved is applied in a single
+// crank, up to MAX_LEDGERS_PER_CRANK of them or for MAX_CRANK_TIME, so that a
+// node a few ledgers behind doesn't take a scheduling round-trip per ledger;
+// otherwise the next ledger waits for its merges in a ConditionalWork.
 class ApplyBufferedLedgersWork : public BasicWork
 {
     std::shared_ptr<ConditionalWork> mConditionalWork;
 
+    static bool mergesResolvedForNextLedger(Application& app);
+
   public:
+    static constexpr size_t MAX_LEDGERS_PER_CRANK = 16;
+    static constexpr std::chrono::milliseconds MAX_CRANK_TIME{500};
+
     ApplyBufferedLedgersWork(Application& app);
 
     std::string getStatus() const override;
@@ -8,6 +8,7 @@
 #include "catchup/IndexBucketsWork.h"
 #include "crypto/Hex.h"
 #include "history/HistoryArchive.h"
+#include "ledger/LedgerTxn.h"
 #include "work/WorkSequence.h"
 #include "work/WorkWithCallback.h"
 
@@ -76,6 +77,12 @@ AssumeStateWork::doWork()
             app.getBucketManager().assumeState(has, maxProtocolVersion,
                                                restartMerges);
 
+            // An order book loaded from the BucketList before is stale now
+            if (app.getConfig().isUsingBucketListDBForType(OFFER))
+            {
+                app.getLedgerTxnRoot().dropOffers(false);
+            }
+
             // Drop bucket references once assume state complete since buckets
             // now referenced by BucketList
             buckets.clear();
@@ -4,6 +4,7 @@
 
 #include "catchup/CatchupConfiguration.h"
 
+#include <algorithm>
 #include <cassert>
 #include <fmt/format.h>
 
@@ -101,4 +102,59 @@ parseLedgerCount(std::string const& str)
 
     return result;
 }
+
+std::vector<CatchupConfiguration>
+splitCatchupConfiguration(CatchupConfiguration const& cfg, uint32_t parts,
+                          uint32_t checkpointFrequency)
+{
+    releaseAssert(parts > 0);
+    releaseAssert(cfg.offline());
+    if (cfg.toLedger() == CatchupConfiguration::CURRENT)
+    {
+        throw std::runtime_error(
+            "a catchup can only be split up to a given ledger");
+    }
+
+    // The checkpoint the whole catchup applies buckets at, as CatchupRange
+    // computes it, or 0 when it replays from genesis
+    uint32_t const toLedger = cfg.toLedger();
+    uint32_t const f = checkpointFrequency;
+    uint32_t start = 0;
+    if (cfg.count() < toLedger - 1)
+    {
+        uint32_t targetStart = toLedger - cfg.count() + 1;
+        start = targetStart < f ? 0 : (targetStart / f) * f - 1;
+    }
+    if (start >= toLedger)
+    {
+        // Buckets only, nothing to replay
+        return {cfg};
+    }
+
+    // Checkpoints k * f - 1 that can end a part are those from the one after
+    // start to the last one before toLedger
+    uint32_t const firstIndex = (start + 1) / f + 1;
+    uint32_t const lastIndex = toLedger / f;
+    uint32_t const boundaries =
+        lastIndex >= firstIndex ? lastIndex - firstIndex + 1 : 0;
+    parts = std::min(parts, boundaries + 1);
+
+    std::vector<CatchupConfiguration> res;
+    uint32_t prev = start;
+    for (uint32_t i = 1; i < parts; ++i)
+    {
+        uint32_t index =
+            firstIndex - 1 +
+            static_cast<uint32_t>(uint64_t(i) * (boundaries + 1) / parts);
+        uint32_t end = index * f - 1;
+        uint32_t count =
+            prev == 0 ? std::numeric_limits<uint32_t>::max() : end - prev;
+        res.emplace_back(end, count, cfg.mode());
+        prev = end;
+    }
+    uint32_t lastCount = prev == 0 ? cfg.count() : toLedger - prev;
+    res.emplace_back(LedgerNumHashPair{toLedger, cfg.hash()}, lastCount,
+                     cfg.mode());
+    return res;
+}
 }
@@ -9,6 +9,7 @@
 #include <cstdint>
 #include <optional>
 #include <string>
+#include <vector>
 
 namespace stellar
 {
@@ -132,4 +133,15 @@ class CatchupConfiguration
 
 uint32_t parseLedger(std::string const& str);
 uint32_t parseLedgerCount(std::string const& str);
+
+// Splits an offline catchup from genesis into at most `parts` catchups of
+// about as many checkpoints each, that can run side by side on separate
+// nodes and together replay the same ledgers. Every part but the first
+// applies the buckets of the checkpoint the part before it ends at, and
+// replaying that part checks its final state against the archived header
+// of that checkpoint, so a chain of successful parts vouches for the state
+// each one started from. Only the last part keeps cfg's trusted hash.
+std::vector<CatchupConfiguration>
+splitCatchupConfiguration(CatchupConfiguration const& cfg, uint32_t parts,
+                          uint32_t checkpointFrequency);
 }
@@ -68,6 +68,10 @@ class CatchupManager
     // Return status of catchup for or empty string, if no catchup in progress
     virtual std::string getStatus() const = 0;
 
+    // Return CatchupWork::getReport of the current catchup along with the
+    // catchup metrics counted since it started, or null if there is none
+    virtual Json::Value getCatchupReport() const = 0;
+
     // Return state of the CatchupWork object
     virtual BasicWork::State getCatchupWorkState() const = 0;
     virtual bool catchupWorkIsDone() const = 0;
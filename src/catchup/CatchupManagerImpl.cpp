@@ -10,6 +10,7 @@
 #include "catchup/CatchupConfiguration.h"
 #include "history/FileTransferInfo.h"
 #include "ledger/LedgerManager.h"
+#include "lib/json/json.h"
 #include "main/Application.h"
 #include "medida/meter.h"
 #include "medida/metrics_registry.h"
@@ -266,6 +267,7 @@ CatchupManagerImpl::startCatchup(
 
     // NB: if WorkScheduler is aborting this returns nullptr,
     // which means we don't "really" start catchup.
+    mMetricsAtCatchupStart = mMetrics;
     mCatchupWork = mApp.getWorkScheduler().scheduleWork<CatchupWork>(
         configuration, bucketsToRetain, archive);
 }
@@ -276,6 +278,32 @@ CatchupManagerImpl::getStatus() const
     return mCatchupWork ? mCatchupWork->getStatus() : std::string{};
 }
 
+Json::Value
+CatchupManagerImpl::getCatchupReport() const
+{
+    if (!mCatchupWork)
+    {
+        return Json::Value{};
+    }
+    auto report = mCatchupWork->getReport();
+    auto m = mMetrics - mMetricsAtCatchupStart;
+    auto& counts = report["counts"];
+    counts["history_archive_states_downloaded"] =
+        static_cast<Json::UInt64>(m.mHistoryArchiveStatesDownloaded);
+    counts["checkpoints_downloaded"] =
+        static_cast<Json::UInt64>(m.mCheckpointsDownloaded);
+    counts["ledgers_verified"] = static_cast<Json::UInt64>(m.mLedgersVerified);
+    counts["ledger_chains_verification_failed"] =
+        static_cast<Json::UInt64>(m.mLedgerChainsVerificationFailed);
+    counts["buckets_downloaded"] =
+        static_cast<Json::UInt64>(m.mBucketsDownloaded);
+    counts["buckets_applied"] = static_cast<Json::UInt64>(m.mBucketsApplied);
+    counts["tx_sets_downloaded"] =
+        static_cast<Json::UInt64>(m.mTxSetsDownloaded);
+    counts["tx_sets_applied"] = static_cast<Json::UInt64>(m.mTxSetsApplied);
+    return report;
+}
+
 BasicWork::State
 CatchupManagerImpl::getCatchupWorkState() const
 {
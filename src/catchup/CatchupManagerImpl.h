@@ -51,6 +51,8 @@ class CatchupManagerImpl : public CatchupManager
     uint32_t getCatchupCount();
     uint32_t mLargestLedgerSeqHeard;
     CatchupMetrics mMetrics;
+    // mMetrics when mCatchupWork started, for getCatchupReport
+    CatchupMetrics mMetricsAtCatchupStart;
 
     // Check if catchup can't be performed due to local version incompatibility
     // or state corruption. Once this flag is set, core won't attempt catchup as
@@ -68,6 +70,7 @@ class CatchupManagerImpl : public CatchupManager
                  std::set<std::shared_ptr<Bucket>> bucketsToRetain) override;
 
     std::string getStatus() const override;
+    Json::Value getCatchupReport() const override;
 
     BasicWork::State getCatchupWorkState() const override;
     bool catchupWorkIsDone() const override;
@@ -22,8 +22,11 @@
 #include "historywork/GetHistoryArchiveStateWork.h"
 #include "historywork/VerifyBucketWork.h"
 #include "ledger/LedgerManager.h"
+#include "lib/json/json.h"
 #include "main/Application.h"
 #include "main/PersistentState.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
 #include "util/GlobalChecks.h"
 #include "util/Logging.h"
 #include "work/WorkWithCallback.h"
@@ -85,6 +88,8 @@ CatchupWork::CatchupWork(Application& app,
           mApp.getTmpDirManager().tmpDir(getName()))}
     , mCatchupConfiguration{catchupConfiguration}
     , mArchive{archive}
+    , mDownloadedBytes{app.getMetrics().NewMeter(
+          {"history", "get", "throughput"}, "bytes")}
     , mRetainedBuckets{bucketsToRetain}
 {
     if (mArchive)
@@ -150,6 +155,42 @@ CatchupWork::doReset()
     mHAS.reset();
     mBucketHAS.reset();
     mRetainedBuckets.clear();
+    mStages.clear();
+    mDownloadedBytesAtStart = mDownloadedBytes.count();
+}
+
+Json::Value
+CatchupWork::getReport() const
+{
+    auto toMs = [](std::chrono::nanoseconds d) {
+        return static_cast<Json::UInt64>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(d).count());
+    };
+
+    Json::Value report;
+    auto duration = getRunningDuration();
+    report["state"] = getStateName();
+    report["duration_ms"] = toMs(duration);
+
+    auto bytes = mDownloadedBytes.count() - mDownloadedBytesAtStart;
+    auto seconds = std::chrono::duration<double>(duration).count();
+    report["downloaded_bytes"] = static_cast<Json::UInt64>(bytes);
+    report["download_bytes_per_second"] =
+        seconds > 0 ? static_cast<Json::UInt64>(bytes / seconds) : 0;
+
+    auto& stages = report["stages"];
+    stages = Json::arrayValue;
+    for (auto const& stage : mStages)
+    {
+        Json::Value s;
+        s["name"] = stage.first;
+        s["state"] = stage.second->getStateName();
+        s["duration_ms"] = toMs(stage.second->getRunningDuration());
+        s["retries"] =
+            static_cast<Json::UInt64>(stage.second->getNumRetries());
+        stages.append(s);
+    }
+    return report;
 }
 
 void
@@ -178,6 +219,8 @@ CatchupWork::downloadVerifyLedgerChain(CatchupRange const& catchupRange,
     mVerifyLedgers = std::make_shared<VerifyLedgerChainWork>(
         mApp, *mDownloadDir, verifyRange, mLastClosedLedgerHashPair,
         mRangeEndFuture, std::move(fatalFailurePromise));
+    mStages.emplace_back("download-ledgers", getLedgers);
+    mStages.emplace_back("verify-ledger-chain", mVerifyLedgers);
 
     // Never retry the sequence: downloads already have retries, and there's no
     // point retrying verification
@@ -195,6 +238,7 @@ CatchupWork::downloadVerifyTxResults(CatchupRange const& catchupRange)
     auto checkpointRange = CheckpointRange{range, mApp.getHistoryManager()};
     mVerifyTxResults = std::make_shared<DownloadVerifyTxResultsWork>(
         mApp, checkpointRange, *mDownloadDir);
+    mStages.emplace_back("download-verify-tx-results", mVerifyTxResults);
 }
 
 bool
@@ -230,6 +274,7 @@ CatchupWork::downloadApplyBuckets()
         auto getBuckets = std::make_shared<DownloadBucketsWork>(
             mApp, mBuckets, hashes, *mDownloadDir, mArchive);
         seq.push_back(getBuckets);
+        mStages.emplace_back("download-verify-buckets", getBuckets);
 
         auto verifyHASCallback = [has = *mBucketHAS](Application& app) {
             if (!has.containsValidBuckets(app))
@@ -250,9 +295,12 @@ CatchupWork::downloadApplyBuckets()
     {
         // Only apply unsupported BucketListDB types to SQL DB when BucketList
         // lookup is enabled
+        auto const& cfg = mApp.getConfig();
         applyBuckets = std::make_shared<ApplyBucketsWork>(
             mApp, mBuckets, *mBucketHAS, version,
-            BucketIndex::typeNotSupported);
+            [&cfg](LedgerEntryType t) {
+                return !cfg.isUsingBucketListDBForType(t);
+            });
     }
     else
     {
@@ -260,6 +308,7 @@ CatchupWork::downloadApplyBuckets()
                                                           *mBucketHAS, version);
     }
     seq.push_back(applyBuckets);
+    mStages.emplace_back("apply-buckets", applyBuckets);
     return std::make_shared<WorkSequence>(mApp, "download-verify-apply-buckets",
                                           seq, RETRY_NEVER);
 }
@@ -306,6 +355,8 @@ CatchupWork::downloadApplyTransactions(CatchupRange const& catchupRange)
     auto range = catchupRange.getReplayRange();
     mTransactionsVerifyApplySeq = std::make_shared<DownloadApplyTxsWork>(
         mApp, *mDownloadDir, range, mLastApplied, waitForPublish, mArchive);
+    mStages.emplace_back("download-apply-ledgers",
+                         mTransactionsVerifyApplySeq);
 }
 
 BasicWork::State
@@ -347,6 +398,8 @@ CatchupWork::getAndMaybeSetHistoryArchiveState()
             mGetHistoryArchiveStateWork = addWork<GetHistoryArchiveStateWork>(
                 toCheckpoint, mArchive, true, 10);
             mCurrentWork = mGetHistoryArchiveStateWork;
+            mStages.emplace_back("get-archive-state",
+                                 mGetHistoryArchiveStateWork);
             return State::WORK_RUNNING;
         }
         else if (mGetHistoryArchiveStateWork->getState() != State::WORK_SUCCESS)
@@ -414,6 +467,8 @@ CatchupWork::getAndMaybeSetBucketHistoryArchiveState(uint32_t applyBucketsAt)
             mGetBucketStateWork = addWork<GetHistoryArchiveStateWork>(
                 applyBucketsAt, mArchive, true);
             mCurrentWork = mGetBucketStateWork;
+            mStages.emplace_back("get-bucket-archive-state",
+                                 mGetBucketStateWork);
         }
         if (mGetBucketStateWork->getState() != State::WORK_SUCCESS)
         {
@@ -500,6 +555,8 @@ CatchupWork::runCatchupStep()
             {
                 mApplyBufferedLedgersWork = addWork<ApplyBufferedLedgersWork>();
                 mCurrentWork = mApplyBufferedLedgersWork;
+                mStages.emplace_back("apply-buffered-ledgers",
+                                     mApplyBufferedLedgersWork);
                 return State::WORK_RUNNING;
             }
 
@@ -672,6 +729,7 @@ void
 CatchupWork::onFailureRaise()
 {
     CLOG_WARNING(History, "Catchup failed");
+    CLOG_INFO(History, "Catchup report: {}", getReport().toStyledString());
     Work::onFailureRaise();
     if (mCatchupConfiguration.localBucketsOnly())
     {
@@ -683,6 +741,7 @@ void
 CatchupWork::onSuccess()
 {
     CLOG_INFO(History, "Catchup finished");
+    CLOG_INFO(History, "Catchup report: {}", getReport().toStyledString());
     Work::onSuccess();
 }
 }
@@ -8,10 +8,16 @@
 #include "catchup/VerifyLedgerChainWork.h"
 #include "history/HistoryArchive.h"
 #include "historywork/GetHistoryArchiveStateWork.h"
+#include "lib/json/json-forwards.h"
 #include "util/Thread.h"
 #include "work/Work.h"
 #include "work/WorkSequence.h"
 
+namespace medida
+{
+class Meter;
+}
+
 namespace stellar
 {
 
@@ -70,6 +76,10 @@ class CatchupWork : public Work
     virtual ~CatchupWork();
     std::string getStatus() const override;
 
+    // Durations, retries and states of the catchup stages started so far,
+    // and the bytes downloaded from history archives since catchup started
+    Json::Value getReport() const;
+
     CatchupConfiguration const&
     getCatchupConfiguration() const
     {
@@ -112,6 +122,11 @@ class CatchupWork : public Work
 
     std::shared_future<bool> mFatalFailureFuture;
 
+    // Works of the stages started so far, with their names in the report
+    std::vector<std::pair<std::string, std::shared_ptr<BasicWork>>> mStages;
+    medida::Meter& mDownloadedBytes;
+    uint64_t mDownloadedBytesAtStart{0};
+
     bool alreadyHaveBucketsHistoryArchiveState(uint32_t atCheckpoint) const;
     void assertBucketState();
 
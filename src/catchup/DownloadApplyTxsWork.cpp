@@ -14,6 +14,8 @@
 #include "work/WorkSequence.h"
 #include "work/WorkWithCallback.h"
 
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
 #include <Tracy.hpp>
 #include <fmt/format.h>
 
@@ -32,6 +34,10 @@ DownloadApplyTxsWork::DownloadApplyTxsWork(
           app.getHistoryManager().checkpointContainingLedger(range.mFirst))
     , mWaitForPublish(waitForPublish)
     , mArchive(archive)
+    , mWaitDownloadTimer(app.getMetrics().NewTimer(
+          {"history", "download-apply", "wait-download"}))
+    , mWaitApplyTimer(app.getMetrics().NewTimer(
+          {"history", "download-apply", "wait-apply"}))
 {
 }
 
@@ -79,6 +85,7 @@ DownloadApplyTxsWork::yieldMoreWork()
         mApp, mDownloadDir, LedgerRange::inclusive(low, high), cb);
 
     std::vector<std::shared_ptr<BasicWork>> seq{getAndUnzip};
+    auto times = std::make_shared<CheckpointTimes>();
 
     auto maybeWaitForMerges = [](Application& app) {
         if (app.getConfig().CATCHUP_WAIT_MERGES_TX_APPLY_FOR_TESTING)
@@ -96,14 +103,23 @@ DownloadApplyTxsWork::yieldMoreWork()
     if (mLastYieldedWork)
     {
         auto prev = mLastYieldedWork;
+        auto prevTimes = mLastYieldedTimes;
         bool pqFellBehind = false;
-        auto predicate = [prev, pqFellBehind, waitForPublish = mWaitForPublish,
-                          maybeWaitForMerges](Application& app) mutable {
+        auto predicate = [prev, prevTimes, times, pqFellBehind,
+                          waitForPublish = mWaitForPublish, maybeWaitForMerges,
+                          waitDownload = &mWaitDownloadTimer,
+                          waitApply = &mWaitApplyTimer](
+                             Application& app) mutable {
             if (!prev)
             {
                 throw std::runtime_error("Download and apply txs: related Work "
                                          "is destroyed unexpectedly");
             }
+            // Only checked once this checkpoint's download is done
+            if (!times->mDownloaded)
+            {
+                times->mDownloaded = app.getClock().now();
+            }
 
             // First, ensure download work is finished
             if (prev->getState() != State::WORK_SUCCESS)
@@ -127,7 +143,24 @@ DownloadApplyTxsWork::yieldMoreWork()
                 }
                 res = !pqFellBehind;
             }
-            return res && maybeWaitForMerges(app);
+            res = res && maybeWaitForMerges(app);
+
+            if (res && prevTimes->mApplied)
+            {
+                // Either applying sat idle until this download finished, or
+                // the download waited for earlier checkpoints to apply
+                if (*prevTimes->mApplied <= *times->mDownloaded)
+                {
+                    waitDownload->Update(*times->mDownloaded -
+                                         *prevTimes->mApplied);
+                }
+                else
+                {
+                    waitApply->Update(app.getClock().now() -
+                                      *times->mDownloaded);
+                }
+            }
+            return res;
         };
         seq.push_back(std::make_shared<ConditionalWork>(
             mApp, "conditional-" + apply->getName(), predicate, apply));
@@ -140,7 +173,8 @@ DownloadApplyTxsWork::yieldMoreWork()
 
     seq.push_back(std::make_shared<WorkWithCallback>(
         mApp, "delete-transactions-" + std::to_string(mCheckpointToQueue),
-        [ft](Application& app) {
+        [ft, times](Application& app) {
+            times->mApplied = app.getClock().now();
             try
             {
                 std::filesystem::remove(
@@ -162,6 +196,7 @@ DownloadApplyTxsWork::yieldMoreWork()
         BasicWork::RETRY_NEVER);
     mCheckpointToQueue += mApp.getHistoryManager().getCheckpointFrequency();
     mLastYieldedWork = nextWork;
+    mLastYieldedTimes = times;
     return nextWork;
 }
 
@@ -171,6 +206,7 @@ DownloadApplyTxsWork::resetIter()
     mCheckpointToQueue =
         mApp.getHistoryManager().checkpointContainingLedger(mRange.mFirst);
     mLastYieldedWork.reset();
+    mLastYieldedTimes.reset();
     mLastApplied = mApp.getLedgerManager().getLastClosedLedgerHeader();
 }
 
@@ -192,6 +228,13 @@ DownloadApplyTxsWork::onSuccess()
     mLastApplied = mApp.getLedgerManager().getLastClosedLedgerHeader();
 }
 
+size_t
+DownloadApplyTxsWork::getMaxBatchSize() const
+{
+    auto n = mApp.getConfig().CATCHUP_DOWNLOAD_AHEAD_CHECKPOINTS;
+    return n == 0 ? BatchWork::getMaxBatchSize() : n;
+}
+
 std::string
 DownloadApplyTxsWork::getStatus() const
 {
@@ -5,13 +5,17 @@
 #pragma once
 
 #include "ledger/LedgerRange.h"
+#include "util/Timer.h"
 #include "util/XDRStream.h"
 #include "work/BatchWork.h"
 #include "xdr/Stellar-ledger.h"
 
+#include <optional>
+
 namespace medida
 {
 class Meter;
+class Timer;
 }
 
 namespace stellar
@@ -21,15 +25,29 @@ class TmpDir;
 class HistoryArchive;
 struct LedgerHeaderHistoryEntry;
 
+// Replays checkpoints as a pipeline: up to getMaxBatchSize() of them are in
+// flight at once, each downloading as soon as it's yielded and then waiting
+// for the one before it to finish applying.
 class DownloadApplyTxsWork : public BatchWork
 {
+    // When a checkpoint finished downloading and applying, to tell which
+    // side of the pipeline the next one waited on
+    struct CheckpointTimes
+    {
+        std::optional<VirtualClock::time_point> mDownloaded;
+        std::optional<VirtualClock::time_point> mApplied;
+    };
+
     LedgerRange const mRange;
     TmpDir const& mDownloadDir;
     LedgerHeaderHistoryEntry& mLastApplied;
     uint32_t mCheckpointToQueue;
     std::shared_ptr<BasicWork> mLastYieldedWork;
+    std::shared_ptr<CheckpointTimes> mLastYieldedTimes;
     bool const mWaitForPublish;
     std::shared_ptr<HistoryArchive> mArchive;
+    medida::Timer& mWaitDownloadTimer;
+    medida::Timer& mWaitApplyTimer;
 
   public:
     DownloadApplyTxsWork(Application& app, TmpDir const& downloadDir,
@@ -45,5 +63,6 @@ class DownloadApplyTxsWork : public BatchWork
     std::shared_ptr<BasicWork> yieldMoreWork() override;
     void resetIter() override;
     void onSuccess() override;
+    size_t getMaxBatchSize() const override;
 };
 }
\ No newline at end of file
@@ -3,20 +3,33 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "IndexBucketsWork.h"
+#include "bucket/Bucket.h"
 #include "bucket/BucketIndex.h"
 #include "bucket/BucketManager.h"
+#include "main/Application.h"
+#include "main/Config.h"
 #include "util/HashOfHash.h"
 #include "util/UnorderedSet.h"
 #include "util/XDRStream.h"
 #include "util/types.h"
 #include "work/WorkWithCallback.h"
+
+#include "medida/counter.h"
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
+
 #include <Tracy.hpp>
+#include <algorithm>
+#include <chrono>
 
 namespace stellar
 {
 IndexBucketsWork::IndexWork::IndexWork(Application& app,
-                                       std::shared_ptr<Bucket> b)
-    : BasicWork(app, "index-work", BasicWork::RETRY_NEVER), mBucket(b)
+                                       std::shared_ptr<Bucket> b,
+                                       medida::Timer& indexTimer)
+    : BasicWork(app, "index-work", BasicWork::RETRY_NEVER)
+    , mBucket(b)
+    , mIndexTimer(indexTimer)
 {
 }
 
@@ -53,6 +66,7 @@ IndexBucketsWork::IndexWork::postWork()
                 return;
             }
 
+            auto start = std::chrono::steady_clock::now();
             auto& bm = app.getBucketManager();
             auto indexFilename =
                 bm.bucketIndexFilename(self->mBucket->getHash());
@@ -84,12 +98,14 @@ IndexBucketsWork::IndexWork::postWork()
                     bm, self->mBucket->getFilename(), self->mBucket->getHash());
             }
 
+            auto duration = std::chrono::steady_clock::now() - start;
             app.postOnMainThread(
-                [weak]() {
+                [weak, duration]() {
                     auto self = weak.lock();
                     if (self)
                     {
                         self->mDone = true;
+                        self->mIndexTimer.Update(duration);
                         if (!self->isAborting())
                         {
                             self->mApp.getBucketManager().maybeSetIndex(
@@ -100,37 +116,81 @@ IndexBucketsWork::IndexWork::postWork()
                 },
                 "IndexWork: finished");
         },
-        "IndexWork: starting in background");
+        "IndexWork: starting in background",
+        WorkerPriority::BULK);
 }
 
 IndexBucketsWork::IndexBucketsWork(
     Application& app, std::vector<std::shared_ptr<Bucket>> const& buckets)
-    : Work(app, "index-bucketList", BasicWork::RETRY_NEVER), mBuckets(buckets)
+    : Work(app, "index-bucketList", BasicWork::RETRY_NEVER)
+    , mBuckets(buckets)
+    , mIndexTimer(app.getMetrics().NewTimer({"bucketlistDB", "index", "time"}))
+    , mPendingCounter(
+          app.getMetrics().NewCounter({"bucketlistDB", "index", "pending"}))
 {
 }
 
 BasicWork::State
 IndexBucketsWork::doWork()
 {
+    ZoneScoped;
     if (!mWorkSpawned)
     {
-        spawnWork();
+        collectBuckets();
+    }
+
+    if (anyChildRaiseFailure())
+    {
+        return State::WORK_FAILURE;
+    }
+
+    // Release the memory budget of finished index work
+    for (auto it = mInFlight.begin(); it != mInFlight.end();)
+    {
+        if (it->first->getState() == State::WORK_SUCCESS)
+        {
+            mInFlightMemory -= it->second;
+            mPendingCounter.dec();
+            it = mInFlight.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    spawnMoreWork();
+
+    if (mNextToIndex == mToIndex.size() && allChildrenSuccessful())
+    {
+        return State::WORK_SUCCESS;
+    }
+
+    if (!anyChildRunning())
+    {
+        return State::WORK_WAITING;
     }
 
-    return checkChildrenStatus();
+    return State::WORK_RUNNING;
 }
 
 void
 IndexBucketsWork::doReset()
 {
     mWorkSpawned = false;
+    mToIndex.clear();
+    mNextToIndex = 0;
+    mInFlight.clear();
+    mInFlightMemory = 0;
+    mPendingCounter.clear();
 }
 
 void
-IndexBucketsWork::spawnWork()
+IndexBucketsWork::collectBuckets()
 {
     UnorderedSet<Hash> indexedBuckets;
-    auto spawnIndexWork = [&](std::shared_ptr<Bucket> const& b) {
+    for (auto const& b : mBuckets)
+    {
         // Don't index empty bucket or buckets that are already being
         // indexed. Sometimes one level's snap bucket may be another
         // level's future bucket. The indexing job may have started but
@@ -140,17 +200,50 @@ IndexBucketsWork::spawnWork()
         if (b->isEmpty() || b->isIndexed() ||
             !indexedBuckets.insert(b->getHash()).second)
         {
-            return;
+            continue;
         }
 
-        addWork<IndexWork>(b);
-    };
-
-    for (auto const& b : mBuckets)
-    {
-        spawnIndexWork(b);
+        mToIndex.emplace_back(b);
     }
 
+    // The largest buckets dominate total indexing time, so start them first to
+    // avoid one large bucket running alone at the end
+    std::stable_sort(mToIndex.begin(), mToIndex.end(),
+                     [](auto const& lhs, auto const& rhs) {
+                         return lhs->getSize() > rhs->getSize();
+                     });
+
+    mPendingCounter.set_count(mToIndex.size());
     mWorkSpawned = true;
 }
-}
\ No newline at end of file
+
+void
+IndexBucketsWork::spawnMoreWork()
+{
+    auto const& cfg = mApp.getConfig();
+    size_t const maxInFlight = std::max(cfg.WORKER_THREADS, 1);
+
+    // Convert cfg param from MB to bytes
+    size_t const memoryLimit =
+        cfg.BUCKETLIST_DB_INDEX_BUILD_MEMORY_LIMIT * 1000000;
+
+    while (mNextToIndex < mToIndex.size() && mInFlight.size() < maxInFlight)
+    {
+        auto const& b = mToIndex.at(mNextToIndex);
+        auto memory = BucketIndex::estimateMemoryUsage(cfg, b->getSize());
+
+        // Always allow at least one index in flight so that a bucket larger
+        // than the budget can still make progress
+        if (memoryLimit != 0 && !mInFlight.empty() &&
+            mInFlightMemory + memory > memoryLimit)
+        {
+            break;
+        }
+
+        auto w = addWork<IndexWork>(b, mIndexTimer);
+        mInFlight.emplace_back(w, memory);
+        mInFlightMemory += memory;
+        ++mNextToIndex;
+    }
+}
+}
@@ -7,6 +7,12 @@
 #include "work/Work.h"
 #include <memory>
 
+namespace medida
+{
+class Counter;
+class Timer;
+}
+
 namespace stellar
 {
 
@@ -14,18 +20,25 @@ class Bucket;
 class BucketIndex;
 class BucketManager;
 
+// Indexes all given buckets that are not already indexed. Index construction
+// is spread across the worker thread pool, largest buckets first, with at most
+// WORKER_THREADS indexes in flight. If BUCKETLIST_DB_INDEX_BUILD_MEMORY_LIMIT
+// is set, the estimated memory of in-flight indexes is also kept under that
+// budget.
 class IndexBucketsWork : public Work
 {
     class IndexWork : public BasicWork
     {
         std::shared_ptr<Bucket> mBucket;
         std::unique_ptr<BucketIndex const> mIndex;
+        medida::Timer& mIndexTimer;
         bool mDone{false};
 
         void postWork();
 
       public:
-        IndexWork(Application& app, std::shared_ptr<Bucket> b);
+        IndexWork(Application& app, std::shared_ptr<Bucket> b,
+                  medida::Timer& indexTimer);
 
       protected:
         State onRun() override;
@@ -34,8 +47,20 @@ class IndexBucketsWork : public Work
 
     std::vector<std::shared_ptr<Bucket>> const& mBuckets;
 
+    // Buckets that need indexing, sorted from largest to smallest
+    std::vector<std::shared_ptr<Bucket>> mToIndex;
+    size_t mNextToIndex{0};
+
+    // In-flight index work and its estimated memory usage
+    std::vector<std::pair<std::shared_ptr<BasicWork>, size_t>> mInFlight;
+    size_t mInFlightMemory{0};
+
+    medida::Timer& mIndexTimer;
+    medida::Counter& mPendingCounter;
+
     bool mWorkSpawned{false};
-    void spawnWork();
+    void collectBuckets();
+    void spawnMoreWork();
 
   public:
     IndexBucketsWork(Application& app,
@@ -14,6 +14,8 @@
 #include "util/DebugMetaUtils.h"
 #include "util/GlobalChecks.h"
 #include "util/XDRStream.h"
+#include <algorithm>
+#include <optional>
 #include <regex>
 
 namespace stellar
@@ -27,15 +29,18 @@ class ApplyLedgersFromMetaWork : public Work
     bool mFileOpen{false};
     std::shared_ptr<ApplyLedgerWork> mApplyLedgerWork;
     uint32_t const mTargetLedger;
+    std::optional<metautils::MetaDebugIndex> const mIndex;
 
   public:
     ApplyLedgersFromMetaWork(Application& app,
                              std::filesystem::path const& unzippedMetaFile,
-                             uint32_t targetLedger)
+                             uint32_t targetLedger,
+                             std::optional<metautils::MetaDebugIndex> index)
         : Work(app, fmt::format("apply-ledgers-from-{}", unzippedMetaFile),
                BasicWork::RETRY_NEVER)
         , mFilename(unzippedMetaFile)
         , mTargetLedger(targetLedger)
+        , mIndex(std::move(index))
     {
     }
 
@@ -57,6 +62,22 @@ class ApplyLedgersFromMetaWork : public Work
         {
             mMetaIn.open(mFilename.string());
             mFileOpen = true;
+
+            // Go straight to the first ledger past LCL rather than reading
+            // through the ones before it
+            if (mIndex)
+            {
+                auto lcl = mApp.getLedgerManager().getLastClosedLedgerNum();
+                auto it = std::upper_bound(
+                    mIndex->begin(), mIndex->end(), lcl,
+                    [](uint32_t seq, auto const& e) { return seq < e.first; });
+                if (it != mIndex->end() && it->second != 0)
+                {
+                    CLOG_INFO(Work, "Skipping to ledger {} in {}", it->first,
+                              mFilename.string());
+                    mMetaIn.seek(it->second);
+                }
+            }
         }
 
         if (mApplyLedgerWork)
@@ -216,6 +237,19 @@ ReplayDebugMetaWork::doWork()
 
     auto zipped = metautils::getMetaDebugDirPath(mMetaDir) / filename;
 
+    // The index of a rotated segment tells which ledgers it holds, so that it
+    // does not need to be unzipped if they have all been applied already
+    auto index =
+        metautils::readMetaDebugIndex(metautils::getMetaDebugIndexPath(zipped));
+    auto lcl = mApp.getLedgerManager().getLastClosedLedgerNum();
+    if (index && index->back().first <= lcl)
+    {
+        CLOG_INFO(Work, "LCL {} is past the last ledger {} in {}, skipping",
+                  lcl, index->back().first, filename.string());
+        ++mNextToApply;
+        return BasicWork::State::WORK_RUNNING;
+    }
+
     std::filesystem::path unzipped = zipped;
     std::vector<std::shared_ptr<BasicWork>> seq;
 
@@ -227,8 +261,8 @@ ReplayDebugMetaWork::doWork()
         unzipped.replace_extension();
     }
 
-    seq.emplace_back(std::make_shared<ApplyLedgersFromMetaWork>(mApp, unzipped,
-                                                                mTargetLedger));
+    seq.emplace_back(std::make_shared<ApplyLedgersFromMetaWork>(
+        mApp, unzipped, mTargetLedger, std::move(index)));
     auto removeUnzipped = [isZipped, unzipped](Application& app) {
         if (isZipped)
         {
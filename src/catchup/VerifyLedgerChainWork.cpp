@@ -3,10 +3,12 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "catchup/VerifyLedgerChainWork.h"
+#include "crypto/SHA.h"
 #include "history/FileTransferInfo.h"
 #include "historywork/Progress.h"
 #include "ledger/LedgerManager.h"
 #include "main/Application.h"
+#include "main/Config.h"
 #include "main/ErrorMessages.h"
 #include "util/FileSystemException.h"
 #include "util/GlobalChecks.h"
@@ -14,6 +16,7 @@
 #include "util/XDRStream.h"
 #include "util/types.h"
 #include <Tracy.hpp>
+#include <algorithm>
 #include <fmt/format.h>
 #include <fstream>
 
@@ -38,12 +41,16 @@ verifyLedgerHistoryEntry(LedgerHeaderHistoryEntry const& hhe)
 }
 
 static HistoryManager::LedgerVerificationStatus
-verifyLedgerHistoryLink(Hash const& prev, LedgerHeaderHistoryEntry const& curr)
+verifyLedgerHistoryLink(Hash const& prev, LedgerHeaderHistoryEntry const& curr,
+                        bool hashed)
 {
-    auto entryResult = verifyLedgerHistoryEntry(curr);
-    if (entryResult != HistoryManager::VERIFY_STATUS_OK)
+    if (!hashed)
     {
-        return entryResult;
+        auto entryResult = verifyLedgerHistoryEntry(curr);
+        if (entryResult != HistoryManager::VERIFY_STATUS_OK)
+        {
+            return entryResult;
+        }
     }
     if (prev != curr.header.previousLedgerHash)
     {
@@ -84,6 +91,49 @@ verifyLastLedgerInCheckpoint(LedgerHeaderHistoryEntry const& ledger,
     return HistoryManager::VERIFY_STATUS_OK;
 }
 
+// Checks that every header in a checkpoint's file hashes to the hash it
+// claims, independently of any other checkpoint so it can run on a
+// background thread. Failing to read the file also returns false, leaving
+// verifyHistoryOfSingleCheckpoint to find and report what's wrong. Headers
+// are hashed in batches, which sha256Batch can hash several at a time.
+static bool
+hashLedgerHistoryFile(std::string const& path)
+{
+    ZoneScoped;
+    size_t const BATCH_SIZE = 64;
+    try
+    {
+        XDRInputFileStream hdrIn;
+        hdrIn.open(path);
+        std::vector<Hash> claimed;
+        std::vector<xdr::opaque_vec<>> headers;
+        std::vector<ByteSlice> slices;
+        LedgerHeaderHistoryEntry curr;
+        bool more = true;
+        while (more)
+        {
+            claimed.clear();
+            headers.clear();
+            while (headers.size() < BATCH_SIZE &&
+                   (more = hdrIn && hdrIn.readOne(curr)))
+            {
+                claimed.emplace_back(curr.hash);
+                headers.emplace_back(xdr::xdr_to_opaque(curr.header));
+            }
+            slices.assign(headers.begin(), headers.end());
+            if (sha256Batch(slices) != claimed)
+            {
+                return false;
+            }
+        }
+    }
+    catch (std::exception const&)
+    {
+        return false;
+    }
+    return true;
+}
+
 template <typename T>
 void
 trySetFuture(std::promise<T>& promise, T value)
@@ -154,10 +204,62 @@ VerifyLedgerChainWork::onReset()
                                 mRange.last());
     mChainDisagreesWithLocalState.reset();
     mHasTrustedHash = false;
+    mHashingCheckpoints.clear();
+    mHashedCheckpoints.clear();
+    ++mHashingGeneration;
+}
+
+void
+VerifyLedgerChainWork::startHashingCheckpoints()
+{
+    auto& hm = mApp.getHistoryManager();
+    auto minCheckpoint = hm.checkpointContainingLedger(mRange.mFirst);
+    auto freq = hm.getCheckpointFrequency();
+
+    // Keep about one checkpoint per worker thread hashed ahead of linking
+    auto ahead = std::max(mApp.getConfig().WORKER_THREADS, 1);
+    std::weak_ptr<VerifyLedgerChainWork> weak(
+        std::static_pointer_cast<VerifyLedgerChainWork>(shared_from_this()));
+    auto checkpoint = mCurrCheckpoint;
+    for (int i = 0; i < ahead; ++i)
+    {
+        if (mHashingCheckpoints.find(checkpoint) ==
+                mHashingCheckpoints.end() &&
+            mHashedCheckpoints.find(checkpoint) == mHashedCheckpoints.end())
+        {
+            FileTransferInfo ft(mDownloadDir, HISTORY_FILE_TYPE_LEDGER,
+                                checkpoint);
+            mHashingCheckpoints.emplace(checkpoint);
+            auto hash = [&app = mApp, weak, checkpoint,
+                         generation = mHashingGeneration,
+                         path = ft.localPath_nogz()]() {
+                bool hashed = hashLedgerHistoryFile(path);
+                app.postOnMainThread(
+                    [weak, checkpoint, generation, hashed]() {
+                        auto self = weak.lock();
+                        if (self && self->mHashingGeneration == generation)
+                        {
+                            self->mHashingCheckpoints.erase(checkpoint);
+                            self->mHashedCheckpoints[checkpoint] = hashed;
+                            self->wakeUp();
+                        }
+                    },
+                    "VerifyLedgerChain: hashed checkpoint");
+            };
+            mApp.postOnBackgroundThread(hash,
+                                        "VerifyLedgerChain: hash checkpoint",
+                                        WorkerPriority::BULK);
+        }
+        if (checkpoint < minCheckpoint + freq)
+        {
+            break;
+        }
+        checkpoint -= freq;
+    }
 }
 
 HistoryManager::LedgerVerificationStatus
-VerifyLedgerChainWork::verifyHistoryOfSingleCheckpoint()
+VerifyLedgerChainWork::verifyHistoryOfSingleCheckpoint(bool headersHashed)
 {
     ZoneScoped;
     // When verifying a checkpoint, we rely on the fact that the next checkpoint
@@ -213,7 +315,9 @@ VerifyLedgerChainWork::verifyHistoryOfSingleCheckpoint()
         // or if the archive is in a bad state (in which case, retry)
         if (curr.header.ledgerSeq == mLastClosed.first)
         {
-            if (sha256(xdr::xdr_to_opaque(curr.header)) != *mLastClosed.second)
+            auto hash = headersHashed ? curr.hash
+                                      : sha256(xdr::xdr_to_opaque(curr.header));
+            if (hash != *mLastClosed.second)
             {
                 CLOG_ERROR(History,
                            "Bad ledger-header history entry: claimed ledger {} "
@@ -228,7 +332,8 @@ VerifyLedgerChainWork::verifyHistoryOfSingleCheckpoint()
         // Verify LCL that is just before the first ledger in range
         else if (curr.header.ledgerSeq == mLastClosed.first + 1)
         {
-            auto lclResult = verifyLedgerHistoryLink(*mLastClosed.second, curr);
+            auto lclResult = verifyLedgerHistoryLink(*mLastClosed.second, curr,
+                                                     headersHashed);
             if (lclResult != HistoryManager::VERIFY_STATUS_OK)
             {
                 CLOG_ERROR(History,
@@ -246,10 +351,13 @@ VerifyLedgerChainWork::verifyHistoryOfSingleCheckpoint()
             // At the beginning of checkpoint, we can't verify the link with
             // previous ledger, so at least verify that header content hashes to
             // correct value
-            auto hashResult = verifyLedgerHistoryEntry(curr);
-            if (hashResult != HistoryManager::VERIFY_STATUS_OK)
+            if (!headersHashed)
             {
-                return hashResult;
+                auto hashResult = verifyLedgerHistoryEntry(curr);
+                if (hashResult != HistoryManager::VERIFY_STATUS_OK)
+                {
+                    return hashResult;
+                }
             }
 
             // Save first ledger in the checkpoint, in case we use it below in
@@ -277,7 +385,8 @@ VerifyLedgerChainWork::verifyHistoryOfSingleCheckpoint()
                            expectedSeq, curr.header.ledgerSeq);
                 return HistoryManager::VERIFY_STATUS_ERR_OVERSHOT;
             }
-            auto linkResult = verifyLedgerHistoryLink(prev.hash, curr);
+            auto linkResult =
+                verifyLedgerHistoryLink(prev.hash, curr, headersHashed);
             if (linkResult != HistoryManager::VERIFY_STATUS_OK)
             {
                 return linkResult;
@@ -439,12 +548,23 @@ VerifyLedgerChainWork::onRun()
             "Verification undershot first ledger in the range.");
     }
 
+    startHashingCheckpoints();
+    auto hashed = mHashedCheckpoints.find(mCurrCheckpoint);
+    if (hashed == mHashedCheckpoints.end())
+    {
+        return BasicWork::State::WORK_WAITING;
+    }
+    // A checkpoint that failed to hash is verified from scratch, to report
+    // the failure the same way as if it hadn't been hashed ahead
+    bool headersHashed = hashed->second;
+    mHashedCheckpoints.erase(hashed);
+
     HistoryManager::LedgerVerificationStatus result;
 
     // Catch FS-related errors to gracefully fail Work instead of crashing
     try
     {
-        result = verifyHistoryOfSingleCheckpoint();
+        result = verifyHistoryOfSingleCheckpoint(headersHashed);
     }
     catch (FileSystemException&)
     {
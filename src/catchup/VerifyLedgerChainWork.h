@@ -9,6 +9,8 @@
 #include "work/Work.h"
 #include <future>
 #include <iosfwd>
+#include <map>
+#include <set>
 #include <vector>
 
 namespace stellar
@@ -20,6 +22,9 @@ struct LedgerHeaderHistoryEntry;
 // This class verifies ledger chain of a given range by checking the hashes.
 // Note that verification is done starting with the latest checkpoint in the
 // range, and working its way backwards to the beginning of the range.
+// Hashing the headers of a checkpoint doesn't depend on any other checkpoint,
+// so it's done ahead of time on background threads for the next few
+// checkpoints, leaving only the linking of hashes to the main thread.
 class VerifyLedgerChainWork : public BasicWork
 {
     TmpDir const& mDownloadDir;
@@ -72,7 +77,20 @@ class VerifyLedgerChainWork : public BasicWork
     std::vector<LedgerNumHashPair> mVerifiedLedgers;
     std::shared_ptr<std::ofstream> mOutputStream;
 
-    HistoryManager::LedgerVerificationStatus verifyHistoryOfSingleCheckpoint();
+    // Checkpoints at or below mCurrCheckpoint whose headers are being hashed
+    // in the background, and those already hashed, with whether every header
+    // hashed to the hash it claims.
+    std::set<uint32_t> mHashingCheckpoints;
+    std::map<uint32_t, bool> mHashedCheckpoints;
+    // Bumped on reset, so hashes started before it are dropped
+    uint64_t mHashingGeneration{0};
+
+    void startHashingCheckpoints();
+
+    // If headersHashed, every header of the checkpoint is known to hash to
+    // the hash it claims and is not hashed again.
+    HistoryManager::LedgerVerificationStatus
+    verifyHistoryOfSingleCheckpoint(bool headersHashed);
 
   public:
     VerifyLedgerChainWork(
@@ -235,4 +235,56 @@ TEST_CASE("CatchupRange starting on checkpoint boundary still replays it",
     REQUIRE(crange2.getBucketApplyLedger() == 63);
     REQUIRE(crange2.getReplayFirst() == 64);
     REQUIRE(crange2.getReplayCount() == 3);
-}
\ No newline at end of file
+}
+TEST_CASE("split catchup into parallel parts", "[catchup]")
+{
+    VirtualClock clock;
+    auto app = createTestApplication(clock, getTestConfig());
+    auto& hm = app->getHistoryManager();
+    auto freq = hm.getCheckpointFrequency();
+    uint32_t const lcl = 1;
+
+    for (auto const& cfg : std::vector<CatchupConfiguration>{
+             {10 * freq + 5, maxCount,
+              CatchupConfiguration::Mode::OFFLINE_BASIC},
+             {10 * freq - 1, maxCount,
+              CatchupConfiguration::Mode::OFFLINE_BASIC},
+             {10 * freq + 5, 4 * freq,
+              CatchupConfiguration::Mode::OFFLINE_BASIC},
+             {10 * freq - 1, 0, CatchupConfiguration::Mode::OFFLINE_BASIC},
+             {freq / 2, maxCount, CatchupConfiguration::Mode::OFFLINE_BASIC}})
+    {
+        CatchupRange whole{lcl, cfg, hm};
+        for (uint32_t n : {1, 2, 3, 7, 100})
+        {
+            auto parts = splitCatchupConfiguration(cfg, n, freq);
+            REQUIRE(!parts.empty());
+            REQUIRE(parts.size() <= n);
+            REQUIRE(parts.back().toLedger() == cfg.toLedger());
+
+            CatchupRange first{lcl, parts.front(), hm};
+            REQUIRE(first.applyBuckets() == whole.applyBuckets());
+            if (whole.applyBuckets())
+            {
+                REQUIRE(first.getBucketApplyLedger() ==
+                        whole.getBucketApplyLedger());
+            }
+            if (whole.replayLedgers())
+            {
+                REQUIRE(first.getReplayFirst() == whole.getReplayFirst());
+            }
+
+            // Every later part starts from the state the one before ends at
+            for (size_t i = 1; i < parts.size(); ++i)
+            {
+                CatchupRange range{lcl, parts[i], hm};
+                REQUIRE(range.applyBuckets());
+                REQUIRE(range.getBucketApplyLedger() ==
+                        parts[i - 1].toLedger());
+                REQUIRE(range.getReplayFirst() ==
+                        parts[i - 1].toLedger() + 1);
+                REQUIRE(range.getReplayLimit() == parts[i].toLedger() + 1);
+            }
+        }
+    }
+}
@@ -51,8 +51,7 @@ uint256
 xdrBlake2(T const& t)
 {
     XDRBLAKE2 xb;
-    xdr::archive(xb, t);
-    xb.flush();
+    xb.hashXDR(t);
     return xb.state.finish();
 }
 }
@@ -8,6 +8,7 @@
 #include "util/HashOfHash.h"
 #include <Tracy.hpp>
 #include <functional>
+#include <sodium.h>
 
 #ifdef MSAN_ENABLED
 #include <sanitizer/msan_interface.h>
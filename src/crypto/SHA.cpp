@@ -6,24 +6,253 @@
 #include "crypto/ByteSlice.h"
 #include "crypto/CryptoError.h"
 #include "crypto/Curve25519.h"
+#include "crypto/SHA256Blocks.h"
 #include "util/NonCopyable.h"
 #include <Tracy.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <numeric>
 #include <sodium.h>
 
 namespace stellar
 {
 
+using namespace sha256blocks;
+
+namespace
+{
+std::atomic<CompressFn>&
+activeCompress()
+{
+    static std::atomic<CompressFn> compress{
+        supportedImplementations().front().mCompress};
+    return compress;
+}
+
+void
+storeDigest(uint32_t const state[STATE_WORDS], uint8_t* out)
+{
+    for (size_t i = 0; i < STATE_WORDS; ++i)
+    {
+        out[4 * i] = static_cast<uint8_t>(state[i] >> 24);
+        out[4 * i + 1] = static_cast<uint8_t>(state[i] >> 16);
+        out[4 * i + 2] = static_cast<uint8_t>(state[i] >> 8);
+        out[4 * i + 3] = static_cast<uint8_t>(state[i]);
+    }
+}
+
+// Writes the last, partial block of a message of `size` bytes followed by its
+// padding to `tail`, which must hold 2 blocks. Returns the number of blocks
+// written.
+size_t
+padTail(uint8_t const* partial, size_t partialSize, uint64_t size,
+        uint8_t* tail)
+{
+    size_t blocks = partialSize + 9 > BLOCK_SIZE ? 2 : 1;
+    std::memset(tail, 0, blocks * BLOCK_SIZE);
+    if (partialSize != 0)
+    {
+        std::memcpy(tail, partial, partialSize);
+    }
+    tail[partialSize] = 0x80;
+    uint64_t bits = size * 8;
+    for (size_t i = 0; i < 8; ++i)
+    {
+        tail[blocks * BLOCK_SIZE - 1 - i] = static_cast<uint8_t>(bits >> 8 * i);
+    }
+    return blocks;
+}
+
+// Hashes up to LANES messages together, one block of each per compression
+void
+hashLanes(CompressLanesFn compress, ByteSlice const* const bins[LANES],
+          uint256* const outs[LANES])
+{
+    alignas(32) uint32_t state[STATE_WORDS][LANES];
+    uint8_t tails[LANES][2 * BLOCK_SIZE];
+    static uint8_t const dummy[BLOCK_SIZE] = {};
+    size_t fullBlocks[LANES];
+    size_t totalBlocks[LANES];
+    size_t maxBlocks = 0;
+    for (size_t l = 0; l < LANES; ++l)
+    {
+        for (size_t w = 0; w < STATE_WORDS; ++w)
+        {
+            state[w][l] = INITIAL_STATE[w];
+        }
+        if (!bins[l])
+        {
+            fullBlocks[l] = totalBlocks[l] = 0;
+            continue;
+        }
+        auto size = bins[l]->size();
+        fullBlocks[l] = size / BLOCK_SIZE;
+        totalBlocks[l] =
+            fullBlocks[l] + padTail(bins[l]->data() + size - size % BLOCK_SIZE,
+                                    size % BLOCK_SIZE, size, tails[l]);
+        maxBlocks = std::max(maxBlocks, totalBlocks[l]);
+    }
+
+    uint8_t const* blocks[LANES];
+    for (size_t i = 0; i < maxBlocks; ++i)
+    {
+        for (size_t l = 0; l < LANES; ++l)
+        {
+            if (i < fullBlocks[l])
+            {
+                blocks[l] = bins[l]->data() + i * BLOCK_SIZE;
+            }
+            else if (i < totalBlocks[l])
+            {
+                blocks[l] = tails[l] + (i - fullBlocks[l]) * BLOCK_SIZE;
+            }
+            else
+            {
+                // Lane already finished, its digest is saved
+                blocks[l] = dummy;
+            }
+        }
+        compress(state, blocks);
+        for (size_t l = 0; l < LANES; ++l)
+        {
+            if (i + 1 == totalBlocks[l])
+            {
+                uint32_t laneState[STATE_WORDS];
+                for (size_t w = 0; w < STATE_WORDS; ++w)
+                {
+                    laneState[w] = state[w][l];
+                }
+                storeDigest(laneState, outs[l]->data());
+            }
+        }
+    }
+}
+
+// key.key zero-padded to a block and xored with pad
+void
+hmacKeyBlock(HmacSha256Key const& key, uint8_t pad, uint8_t* block)
+{
+    static_assert(sizeof(key.key) < BLOCK_SIZE, "HMAC key must be padded");
+    std::memset(block, pad, BLOCK_SIZE);
+    for (size_t i = 0; i < key.key.size(); ++i)
+    {
+        block[i] ^= key.key[i];
+    }
+}
+
+HmacSha256Mac
+hmacSha256(HmacSha256Key const& key, ByteSlice const* parts, size_t numParts)
+{
+    uint8_t block[BLOCK_SIZE];
+    SHA256 inner;
+    hmacKeyBlock(key, 0x36, block);
+    inner.add(ByteSlice(block, BLOCK_SIZE));
+    for (size_t i = 0; i < numParts; ++i)
+    {
+        inner.add(parts[i]);
+    }
+    auto innerHash = inner.finish();
+
+    SHA256 outer;
+    hmacKeyBlock(key, 0x5c, block);
+    outer.add(ByteSlice(block, BLOCK_SIZE));
+    outer.add(innerHash);
+    sodium_memzero(block, sizeof(block));
+
+    HmacSha256Mac out;
+    out.mac = outer.finish();
+    return out;
+}
+}
+
+std::string
+sha256Implementation()
+{
+    auto compress = activeCompress().load(std::memory_order_relaxed);
+    for (auto const& impl : supportedImplementations())
+    {
+        if (impl.mCompress == compress)
+        {
+            return impl.mName;
+        }
+    }
+    return "unknown";
+}
+
+#ifdef BUILD_TESTS
+std::vector<std::string>
+sha256SupportedImplementations()
+{
+    std::vector<std::string> res;
+    for (auto const& impl : supportedImplementations())
+    {
+        res.emplace_back(impl.mName);
+    }
+    return res;
+}
+
+void
+sha256UseImplementation(std::string const& name)
+{
+    for (auto const& impl : supportedImplementations())
+    {
+        if (name == impl.mName)
+        {
+            activeCompress().store(impl.mCompress, std::memory_order_relaxed);
+            return;
+        }
+    }
+    throw std::runtime_error("unsupported SHA256 implementation " + name);
+}
+#endif
+
 // Plain SHA256
 uint256
 sha256(ByteSlice const& bin)
 {
     ZoneScoped;
-    uint256 out;
-    if (crypto_hash_sha256(out.data(), bin.data(), bin.size()) != 0)
+    SHA256 state;
+    state.add(bin);
+    return state.finish();
+}
+
+std::vector<uint256>
+sha256Batch(std::vector<ByteSlice> const& bins)
+{
+    ZoneScoped;
+    std::vector<uint256> res(bins.size());
+    // Lanes only help over a scalar loop when that loop has no SHA extensions
+    auto lanes = compressLanes();
+    if (!lanes || activeCompress().load(std::memory_order_relaxed) !=
+                      supportedImplementations().back().mCompress)
     {
-        throw CryptoError("error from crypto_hash_sha256");
+        for (size_t i = 0; i < bins.size(); ++i)
+        {
+            res[i] = sha256(bins[i]);
+        }
+        return res;
     }
-    return out;
+
+    // Messages of similar length go in the same group, so that few lanes idle
+    // while the longest message of the group is still being hashed
+    std::vector<size_t> order(bins.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return bins[a].size() < bins[b].size();
+    });
+    for (size_t i = 0; i < order.size(); i += LANES)
+    {
+        ByteSlice const* group[LANES] = {};
+        uint256* outs[LANES] = {};
+        for (size_t l = 0; l < LANES && i + l < order.size(); ++l)
+        {
+            group[l] = &bins[order[i + l]];
+            outs[l] = &res[order[i + l]];
+        }
+        hashLanes(lanes, group, outs);
+    }
+    return res;
 }
 
 SHA256::SHA256()
@@ -34,10 +263,8 @@ SHA256::SHA256()
 void
 SHA256::reset()
 {
-    if (crypto_hash_sha256_init(&mState) != 0)
-    {
-        throw CryptoError("error from crypto_hash_sha256_init");
-    }
+    std::memcpy(mState, INITIAL_STATE, sizeof(mState));
+    mSize = 0;
     mFinished = false;
 }
 
@@ -49,26 +276,47 @@ SHA256::add(ByteSlice const& bin)
     {
         throw std::runtime_error("adding bytes to finished SHA256");
     }
-    if (crypto_hash_sha256_update(&mState, bin.data(), bin.size()) != 0)
+    auto data = bin.data();
+    size_t size = bin.size();
+    size_t buffered = mSize % BLOCK_SIZE;
+    mSize += size;
+    auto compress = activeCompress().load(std::memory_order_relaxed);
+    if (buffered != 0)
     {
-        throw CryptoError("error from crypto_hash_sha256_update");
+        size_t n = std::min(size, BLOCK_SIZE - buffered);
+        std::memcpy(mBuffer + buffered, data, n);
+        data += n;
+        size -= n;
+        if (buffered + n < BLOCK_SIZE)
+        {
+            return;
+        }
+        compress(mState, mBuffer, 1);
+    }
+    if (size >= BLOCK_SIZE)
+    {
+        compress(mState, data, size / BLOCK_SIZE);
+        data += size - size % BLOCK_SIZE;
+        size %= BLOCK_SIZE;
+    }
+    if (size != 0)
+    {
+        std::memcpy(mBuffer, data, size);
     }
 }
 
 uint256
 SHA256::finish()
 {
-    uint256 out;
-    static_assert(sizeof(out) == crypto_hash_sha256_BYTES,
-                  "unexpected crypto_hash_sha256_BYTES");
     if (mFinished)
     {
         throw std::runtime_error("finishing already-finished SHA256");
     }
-    if (crypto_hash_sha256_final(&mState, out.data()) != 0)
-    {
-        throw CryptoError("error from crypto_hash_sha256_final");
-    }
+    uint8_t tail[2 * BLOCK_SIZE];
+    auto blocks = padTail(mBuffer, mSize % BLOCK_SIZE, mSize, tail);
+    activeCompress().load(std::memory_order_relaxed)(mState, tail, blocks);
+    uint256 out;
+    storeDigest(mState, out.data());
     mFinished = true;
     return out;
 }
@@ -78,13 +326,16 @@ HmacSha256Mac
 hmacSha256(HmacSha256Key const& key, ByteSlice const& bin)
 {
     ZoneScoped;
-    HmacSha256Mac out;
-    if (crypto_auth_hmacsha256(out.mac.data(), bin.data(), bin.size(),
-                               key.key.data()) != 0)
-    {
-        throw CryptoError("error from crypto_auto_hmacsha256");
-    }
-    return out;
+    return hmacSha256(key, &bin, 1);
+}
+
+HmacSha256Mac
+hmacSha256(HmacSha256Key const& key, ByteSlice const& first,
+           ByteSlice const& second)
+{
+    ZoneScoped;
+    ByteSlice parts[] = {first, second};
+    return hmacSha256(key, parts, 2);
 }
 
 bool
@@ -92,8 +343,8 @@ hmacSha256Verify(HmacSha256Mac const& hmac, HmacSha256Key const& key,
                  ByteSlice const& bin)
 {
     ZoneScoped;
-    return 0 == crypto_auth_hmacsha256_verify(hmac.mac.data(), bin.data(),
-                                              bin.size(), key.key.data());
+    auto expected = hmacSha256(key, bin);
+    return 0 == crypto_verify_32(hmac.mac.data(), expected.mac.data());
 }
 
 // Unsalted HKDF-extract(bytes) == HMAC(<zero>,bytes)
@@ -6,20 +6,40 @@
 
 #include "crypto/ByteSlice.h"
 #include "crypto/XDRHasher.h"
-#include "sodium/crypto_hash_sha256.h"
 #include "xdr/Stellar-types.h"
+#include <cstdint>
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace stellar
 {
 
+// All SHA256 hashing, including HMAC, runs on the fastest implementation the
+// CPU supports, picked at first use: the x86 SHA extensions (SHA-NI), the
+// ARMv8 SHA-256 instructions, or portable C++.
+std::string sha256Implementation();
+#ifdef BUILD_TESTS
+// Names of the implementations this CPU supports, and switching to one
+std::vector<std::string> sha256SupportedImplementations();
+void sha256UseImplementation(std::string const& name);
+#endif
+
 // Plain SHA256
 uint256 sha256(ByteSlice const& bin);
 
+// SHA256 of each of many independent inputs, such as the headers of a
+// checkpoint. Without SHA extensions but with AVX2, eight inputs at a time
+// are hashed together in SIMD lanes, which is much faster than one by one.
+std::vector<uint256> sha256Batch(std::vector<ByteSlice> const& bins);
+
 // SHA256 in incremental mode, for large inputs.
 class SHA256
 {
-    crypto_hash_sha256_state mState;
+    uint32_t mState[8];
+    uint8_t mBuffer[64];
+    // Bytes added so far; those after the last full block are in mBuffer
+    uint64_t mSize{0};
     bool mFinished{false};
 
   public:
@@ -51,14 +71,18 @@ uint256
 xdrSha256(T const& t)
 {
     XDRSHA256 xs;
-    xdr::archive(xs, t);
-    xs.flush();
+    xs.hashXDR(t);
     return xs.state.finish();
 }
 
 // HMAC-SHA256 (keyed)
 HmacSha256Mac hmacSha256(HmacSha256Key const& key, ByteSlice const& bin);
 
+// HMAC-SHA256 of the concatenation of first and second, without copying them
+// into one buffer
+HmacSha256Mac hmacSha256(HmacSha256Key const& key, ByteSlice const& first,
+                         ByteSlice const& second);
+
 // Use this rather than HMAC-output ==, to avoid timing leaks.
 bool hmacSha256Verify(HmacSha256Mac const& hmac, HmacSha256Key const& key,
                       ByteSlice const& bin);
@@ -0,0 +1,405 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "crypto/SHA256Blocks.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define STELLAR_SHA256_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#elif defined(__aarch64__) &&                                                  \
+    (defined(__ARM_FEATURE_SHA2) || defined(__ARM_FEATURE_CRYPTO))
+// The ARMv8 SHA-256 instructions are only used when the compiler targets
+// them, as it does on Apple silicon or with -march=armv8-a+crypto
+#define STELLAR_SHA256_ARM 1
+#include <arm_neon.h>
+#endif
+
+// Lets one function use instructions the rest of the build does not assume.
+// MSVC needs no such attribute to use intrinsics.
+#if defined(__GNUC__) || defined(__clang__)
+#define STELLAR_TARGET(x) __attribute__((target(x)))
+#else
+#define STELLAR_TARGET(x)
+#endif
+
+namespace stellar
+{
+namespace sha256blocks
+{
+
+uint32_t const INITIAL_STATE[STATE_WORDS] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372,
+                                             0xa54ff53a, 0x510e527f, 0x9b05688c,
+                                             0x1f83d9ab, 0x5be0cd19};
+
+namespace
+{
+alignas(16) uint32_t const K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+inline uint32_t
+loadBE32(uint8_t const* p)
+{
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) |
+           (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+inline uint32_t
+rotr(uint32_t x, int n)
+{
+    return (x >> n) | (x << (32 - n));
+}
+
+void
+compressPortable(uint32_t state[STATE_WORDS], uint8_t const* data,
+                 size_t numBlocks)
+{
+    for (; numBlocks > 0; --numBlocks, data += BLOCK_SIZE)
+    {
+        uint32_t w[64];
+        for (int t = 0; t < 16; ++t)
+        {
+            w[t] = loadBE32(data + 4 * t);
+        }
+        for (int t = 16; t < 64; ++t)
+        {
+            uint32_t s0 =
+                rotr(w[t - 15], 7) ^ rotr(w[t - 15], 18) ^ (w[t - 15] >> 3);
+            uint32_t s1 =
+                rotr(w[t - 2], 17) ^ rotr(w[t - 2], 19) ^ (w[t - 2] >> 10);
+            w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3],
+                 e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int t = 0; t < 64; ++t)
+        {
+            uint32_t s1 = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
+            uint32_t ch = (e & f) ^ (~e & g);
+            uint32_t t1 = h + s1 + ch + K[t] + w[t];
+            uint32_t s0 = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
+            uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+            uint32_t t2 = s0 + maj;
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+}
+
+#ifdef STELLAR_SHA256_X86
+struct CpuFeatures
+{
+    bool mSHA{false};
+    bool mAVX2{false};
+};
+
+void
+cpuid(uint32_t leaf, uint32_t subleaf, uint32_t regs[4])
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    int r[4];
+    __cpuidex(r, static_cast<int>(leaf), static_cast<int>(subleaf));
+    for (int i = 0; i < 4; ++i)
+    {
+        regs[i] = static_cast<uint32_t>(r[i]);
+    }
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+CpuFeatures
+detectCpuFeatures()
+{
+    CpuFeatures res;
+    uint32_t regs[4];
+    cpuid(0, 0, regs);
+    if (regs[0] < 7)
+    {
+        return res;
+    }
+    cpuid(1, 0, regs);
+    bool ssse3 = (regs[2] & (1u << 9)) != 0;
+    bool sse41 = (regs[2] & (1u << 19)) != 0;
+    bool osxsave = (regs[2] & (1u << 27)) != 0;
+    bool avx = (regs[2] & (1u << 28)) != 0;
+    // AVX registers are only usable if the OS saves them on context switches
+    bool osAVX = false;
+    if (osxsave && avx)
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        osAVX = (_xgetbv(0) & 6) == 6;
+#else
+        uint32_t lo, hi;
+        __asm__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+        osAVX = (lo & 6) == 6;
+#endif
+    }
+    cpuid(7, 0, regs);
+    res.mSHA = ssse3 && sse41 && (regs[1] & (1u << 29)) != 0;
+    res.mAVX2 = osAVX && (regs[1] & (1u << 5)) != 0;
+    return res;
+}
+
+CpuFeatures const&
+cpuFeatures()
+{
+    static CpuFeatures const features = detectCpuFeatures();
+    return features;
+}
+
+// Intel SHA extensions. The state is kept as ABEF and CDGH, the layout
+// sha256rnds2 works on, and each iteration does four rounds.
+STELLAR_TARGET("sha,sse4.1,ssse3")
+void
+compressSHANI(uint32_t state[STATE_WORDS], uint8_t const* data,
+              size_t numBlocks)
+{
+    __m128i const byteSwap =
+        _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    __m128i tmp = _mm_loadu_si128(reinterpret_cast<__m128i const*>(state));
+    __m128i state1 =
+        _mm_loadu_si128(reinterpret_cast<__m128i const*>(state + 4));
+    tmp = _mm_shuffle_epi32(tmp, 0xB1);       // CDAB
+    state1 = _mm_shuffle_epi32(state1, 0x1B); // EFGH
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8); // ABEF
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);      // CDGH
+
+    for (; numBlocks > 0; --numBlocks, data += BLOCK_SIZE)
+    {
+        __m128i const abefSave = state0;
+        __m128i const cdghSave = state1;
+        __m128i m[4];
+        for (int i = 0; i < 4; ++i)
+        {
+            m[i] = _mm_shuffle_epi8(
+                _mm_loadu_si128(
+                    reinterpret_cast<__m128i const*>(data + 16 * i)),
+                byteSwap);
+        }
+        for (int i = 0; i < 16; ++i)
+        {
+            __m128i msg = _mm_add_epi32(
+                m[i % 4],
+                _mm_load_si128(reinterpret_cast<__m128i const*>(K + 4 * i)));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+            msg = _mm_shuffle_epi32(msg, 0x0E);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+            if (i < 12)
+            {
+                // Next four message words from the last sixteen
+                __m128i w7 =
+                    _mm_alignr_epi8(m[(i + 3) % 4], m[(i + 2) % 4], 4);
+                m[i % 4] = _mm_sha256msg2_epu32(
+                    _mm_add_epi32(
+                        _mm_sha256msg1_epu32(m[i % 4], m[(i + 1) % 4]), w7),
+                    m[(i + 3) % 4]);
+            }
+        }
+        state0 = _mm_add_epi32(state0, abefSave);
+        state1 = _mm_add_epi32(state1, cdghSave);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);       // FEBA
+    state1 = _mm_shuffle_epi32(state1, 0xB1);    // DCHG
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0); // DCBA
+    state1 = _mm_alignr_epi8(state1, tmp, 8);    // HGFE
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state), state0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state + 4), state1);
+}
+
+#define STELLAR_ROTR8(x, n)                                                    \
+    _mm256_or_si256(_mm256_srli_epi32((x), (n)),                               \
+                    _mm256_slli_epi32((x), 32 - (n)))
+
+// Eight messages in the eight 32-bit lanes of AVX2 registers, so each
+// instruction does the same step of the portable code for all of them
+STELLAR_TARGET("avx2")
+void
+compressLanesAVX2(uint32_t state[STATE_WORDS][LANES],
+                  uint8_t const* const blocks[LANES])
+{
+    __m256i w[16];
+    for (int t = 0; t < 16; ++t)
+    {
+        w[t] = _mm256_setr_epi32(
+            static_cast<int>(loadBE32(blocks[0] + 4 * t)),
+            static_cast<int>(loadBE32(blocks[1] + 4 * t)),
+            static_cast<int>(loadBE32(blocks[2] + 4 * t)),
+            static_cast<int>(loadBE32(blocks[3] + 4 * t)),
+            static_cast<int>(loadBE32(blocks[4] + 4 * t)),
+            static_cast<int>(loadBE32(blocks[5] + 4 * t)),
+            static_cast<int>(loadBE32(blocks[6] + 4 * t)),
+            static_cast<int>(loadBE32(blocks[7] + 4 * t)));
+    }
+
+    __m256i s[STATE_WORDS];
+    for (size_t i = 0; i < STATE_WORDS; ++i)
+    {
+        s[i] = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(state[i]));
+    }
+    __m256i a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5],
+            g = s[6], h = s[7];
+
+    for (int t = 0; t < 64; ++t)
+    {
+        if (t >= 16)
+        {
+            __m256i w15 = w[(t - 15) & 15];
+            __m256i w2 = w[(t - 2) & 15];
+            __m256i s0 = _mm256_xor_si256(
+                _mm256_xor_si256(STELLAR_ROTR8(w15, 7), STELLAR_ROTR8(w15, 18)),
+                _mm256_srli_epi32(w15, 3));
+            __m256i s1 = _mm256_xor_si256(
+                _mm256_xor_si256(STELLAR_ROTR8(w2, 17), STELLAR_ROTR8(w2, 19)),
+                _mm256_srli_epi32(w2, 10));
+            w[t & 15] = _mm256_add_epi32(
+                _mm256_add_epi32(w[t & 15], s0),
+                _mm256_add_epi32(w[(t - 7) & 15], s1));
+        }
+        __m256i s1 = _mm256_xor_si256(
+            _mm256_xor_si256(STELLAR_ROTR8(e, 6), STELLAR_ROTR8(e, 11)),
+            STELLAR_ROTR8(e, 25));
+        __m256i ch = _mm256_xor_si256(_mm256_and_si256(e, f),
+                                      _mm256_andnot_si256(e, g));
+        __m256i t1 = _mm256_add_epi32(
+            _mm256_add_epi32(_mm256_add_epi32(h, s1), ch),
+            _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(K[t])),
+                             w[t & 15]));
+        __m256i s0 = _mm256_xor_si256(
+            _mm256_xor_si256(STELLAR_ROTR8(a, 2), STELLAR_ROTR8(a, 13)),
+            STELLAR_ROTR8(a, 22));
+        __m256i maj = _mm256_or_si256(
+            _mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)));
+        __m256i t2 = _mm256_add_epi32(s0, maj);
+        h = g;
+        g = f;
+        f = e;
+        e = _mm256_add_epi32(d, t1);
+        d = c;
+        c = b;
+        b = a;
+        a = _mm256_add_epi32(t1, t2);
+    }
+
+    __m256i const out[STATE_WORDS] = {a, b, c, d, e, f, g, h};
+    for (size_t i = 0; i < STATE_WORDS; ++i)
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(state[i]),
+                            _mm256_add_epi32(s[i], out[i]));
+    }
+}
+#undef STELLAR_ROTR8
+#endif
+
+#ifdef STELLAR_SHA256_ARM
+// ARMv8 SHA-256 instructions. The state is kept as ABCD and EFGH, and each
+// iteration does four rounds.
+void
+compressARMv8(uint32_t state[STATE_WORDS], uint8_t const* data,
+              size_t numBlocks)
+{
+    uint32x4_t state0 = vld1q_u32(state);
+    uint32x4_t state1 = vld1q_u32(state + 4);
+
+    for (; numBlocks > 0; --numBlocks, data += BLOCK_SIZE)
+    {
+        uint32x4_t const abcdSave = state0;
+        uint32x4_t const efghSave = state1;
+        uint32x4_t m[4];
+        for (int i = 0; i < 4; ++i)
+        {
+            m[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16 * i)));
+        }
+        for (int i = 0; i < 16; ++i)
+        {
+            uint32x4_t wk = vaddq_u32(m[i % 4], vld1q_u32(K + 4 * i));
+            if (i < 12)
+            {
+                // Next four message words from the last sixteen
+                m[i % 4] = vsha256su1q_u32(
+                    vsha256su0q_u32(m[i % 4], m[(i + 1) % 4]), m[(i + 2) % 4],
+                    m[(i + 3) % 4]);
+            }
+            uint32x4_t abcd = state0;
+            state0 = vsha256hq_u32(state0, state1, wk);
+            state1 = vsha256h2q_u32(state1, abcd, wk);
+        }
+        state0 = vaddq_u32(state0, abcdSave);
+        state1 = vaddq_u32(state1, efghSave);
+    }
+
+    vst1q_u32(state, state0);
+    vst1q_u32(state + 4, state1);
+}
+#endif
+
+std::vector<Implementation>
+detectImplementations()
+{
+    std::vector<Implementation> res;
+#ifdef STELLAR_SHA256_X86
+    if (cpuFeatures().mSHA)
+    {
+        res.push_back({"sha-ni", &compressSHANI});
+    }
+#endif
+#ifdef STELLAR_SHA256_ARM
+    res.push_back({"armv8", &compressARMv8});
+#endif
+    res.push_back({"portable", &compressPortable});
+    return res;
+}
+}
+
+std::vector<Implementation> const&
+supportedImplementations()
+{
+    static std::vector<Implementation> const implementations =
+        detectImplementations();
+    return implementations;
+}
+
+CompressLanesFn
+compressLanes()
+{
+#ifdef STELLAR_SHA256_X86
+    if (cpuFeatures().mAVX2)
+    {
+        return &compressLanesAVX2;
+    }
+#endif
+    return nullptr;
+}
+}
+}
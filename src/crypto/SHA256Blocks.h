@@ -0,0 +1,49 @@
+#pragma once
+
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// SHA-256 compression functions, used by crypto/SHA.cpp. Each one applies the
+// compression function for a run of 64-byte blocks to a state of eight words;
+// padding and buffering are left to the caller.
+
+namespace stellar
+{
+namespace sha256blocks
+{
+
+constexpr size_t BLOCK_SIZE = 64;
+constexpr size_t STATE_WORDS = 8;
+constexpr size_t LANES = 8;
+
+extern uint32_t const INITIAL_STATE[STATE_WORDS];
+
+using CompressFn = void (*)(uint32_t state[STATE_WORDS], uint8_t const* data,
+                            size_t numBlocks);
+
+// Compresses one block per lane for LANES independent messages at once.
+// `state[w][l]` is word w of lane l's state.
+using CompressLanesFn = void (*)(uint32_t state[STATE_WORDS][LANES],
+                                 uint8_t const* const blocks[LANES]);
+
+struct Implementation
+{
+    char const* mName;
+    CompressFn mCompress;
+};
+
+// Implementations this CPU supports, fastest first. The last one is portable
+// C++ and always supported.
+std::vector<Implementation> const& supportedImplementations();
+
+// Compression of LANES messages at once in SIMD registers, or nullptr if the
+// CPU has no vector unit for that. SHA extensions hashing one message at a
+// time are faster still, so this is only worth using without them.
+CompressLanesFn compressLanes();
+}
+}
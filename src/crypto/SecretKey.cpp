@@ -12,16 +12,20 @@
 #include "crypto/StrKey.h"
 #include "main/Config.h"
 #include "transactions/SignatureUtils.h"
+#include "util/ConcurrentRandomEvictionCache.h"
 #include "util/GlobalChecks.h"
 #include "util/HashOfHash.h"
 #include "util/Math.h"
-#include "util/RandomEvictionCache.h"
 #include <Tracy.hpp>
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <sodium.h>
 #include <type_traits>
+#include <vector>
 
 #ifdef MSAN_ENABLED
 #include <sanitizer/msan_interface.h>
@@ -40,12 +44,18 @@ namespace stellar
 // to the state of the process; caching its results centrally
 // makes all signature-verification in the program faster and
 // has no effect on correctness.
-
-static std::mutex gVerifySigCacheMutex;
-static RandomEvictionCache<Hash, bool> gVerifySigCache(0xffff,
-                                                       /* separatePRNG */ true);
-static uint64_t gVerifyCacheHit = 0;
-static uint64_t gVerifyCacheMiss = 0;
+//
+// The cache is split into independently locked shards, so that the overlay
+// background threads and the main thread rarely contend for the same lock.
+
+using VerifySigCache =
+    ConcurrentRandomEvictionCache<Hash, bool,
+                                  PubKeyUtils::VERIFY_SIG_CACHE_SHARDS>;
+static VerifySigCache
+    gVerifySigCache(PubKeyUtils::DEFAULT_VERIFY_SIG_CACHE_SIZE,
+                    /* separatePRNG */ true);
+static std::atomic<uint64_t> gVerifyCacheHit{0};
+static std::atomic<uint64_t> gVerifyCacheMiss{0};
 
 static Hash
 verifySigCacheKey(PublicKey const& key, Signature const& signature,
@@ -317,25 +327,43 @@ SecretKey::fromStrKeySeed(std::string const& strKeySeed)
 void
 PubKeyUtils::clearVerifySigCache()
 {
-    std::lock_guard<std::mutex> guard(gVerifySigCacheMutex);
     gVerifySigCache.clear();
 }
 
 void
 PubKeyUtils::maybeSeedVerifySigCache(unsigned int seed)
 {
-    std::lock_guard<std::mutex> guard(gVerifySigCacheMutex);
     gVerifySigCache.maybeSeed(seed);
 }
 
+void
+PubKeyUtils::setVerifySigCacheSize(size_t size)
+{
+    releaseAssert(size >= VERIFY_SIG_CACHE_SHARDS);
+    gVerifySigCache.setMaxSize(size);
+}
+
+size_t
+PubKeyUtils::getVerifySigCacheSize()
+{
+    return gVerifySigCache.maxSize();
+}
+
+size_t
+PubKeyUtils::getVerifySigCacheMemoryUsage()
+{
+    // Each entry has a map node, with its key, value and access time, and a
+    // pointer to it for random eviction
+    size_t const entrySize =
+        sizeof(Hash) + sizeof(bool) + sizeof(uint64_t) + 4 * sizeof(void*);
+    return gVerifySigCache.size() * entrySize;
+}
+
 void
 PubKeyUtils::flushVerifySigCacheCounts(uint64_t& hits, uint64_t& misses)
 {
-    std::lock_guard<std::mutex> guard(gVerifySigCacheMutex);
-    hits = gVerifyCacheHit;
-    misses = gVerifyCacheMiss;
-    gVerifyCacheHit = 0;
-    gVerifyCacheMiss = 0;
+    hits = gVerifyCacheHit.exchange(0);
+    misses = gVerifyCacheMiss.exchange(0);
 }
 
 std::string
@@ -444,16 +472,12 @@ PubKeyUtils::verifySig(PublicKey const& key, Signature const& signature,
     }
 
     auto cacheKey = verifySigCacheKey(key, signature, bin);
-
+    if (auto cached = gVerifySigCache.maybeGet(cacheKey))
     {
-        std::lock_guard<std::mutex> guard(gVerifySigCacheMutex);
-        if (gVerifySigCache.exists(cacheKey))
-        {
-            ++gVerifyCacheHit;
-            std::string hitStr("hit");
-            ZoneText(hitStr.c_str(), hitStr.size());
-            return gVerifySigCache.get(cacheKey);
-        }
+        ++gVerifyCacheHit;
+        std::string hitStr("hit");
+        ZoneText(hitStr.c_str(), hitStr.size());
+        return *cached;
     }
 
     std::string missStr("miss");
@@ -461,12 +485,92 @@ PubKeyUtils::verifySig(PublicKey const& key, Signature const& signature,
     bool ok =
         (crypto_sign_verify_detached(signature.data(), bin.data(), bin.size(),
                                      key.ed25519().data()) == 0);
-    std::lock_guard<std::mutex> guard(gVerifySigCacheMutex);
     ++gVerifyCacheMiss;
     gVerifySigCache.put(cacheKey, ok);
     return ok;
 }
 
+std::vector<bool>
+PubKeyUtils::verifySigs(std::vector<SignatureToVerify> const& sigs)
+{
+    ZoneScoped;
+    std::vector<bool> res(sigs.size(), false);
+    std::vector<std::optional<Hash>> cacheKeys(sigs.size());
+    for (size_t i = 0; i < sigs.size(); ++i)
+    {
+        auto const& sig = sigs[i];
+        releaseAssert(sig.mKey.type() == PUBLIC_KEY_TYPE_ED25519);
+        if (sig.mSignature->size() == 64)
+        {
+            cacheKeys[i] =
+                verifySigCacheKey(sig.mKey, *sig.mSignature, *sig.mHash);
+        }
+    }
+
+    // Each shard is locked once for all the signatures that map to it
+    std::array<std::vector<size_t>, VERIFY_SIG_CACHE_SHARDS> byShard;
+    for (size_t i = 0; i < sigs.size(); ++i)
+    {
+        if (cacheKeys[i])
+        {
+            byShard[VerifySigCache::shardIndex(*cacheKeys[i])].emplace_back(i);
+        }
+    }
+    auto forEachShard = [&](auto f) {
+        for (size_t s = 0; s < byShard.size(); ++s)
+        {
+            if (byShard[s].empty())
+            {
+                continue;
+            }
+            gVerifySigCache.withShard(s, [&](VerifySigCache::Cache& cache) {
+                for (auto i : byShard[s])
+                {
+                    if (cacheKeys[i])
+                    {
+                        f(cache, i);
+                    }
+                }
+            });
+        }
+    };
+
+    size_t hits = 0;
+    forEachShard([&](VerifySigCache::Cache& cache, size_t i) {
+        if (cache.exists(*cacheKeys[i]))
+        {
+            ++hits;
+            res[i] = cache.get(*cacheKeys[i]);
+            cacheKeys[i].reset();
+        }
+    });
+    gVerifyCacheHit += hits;
+
+    // Whatever still has a cache key has to be verified
+    size_t verified = 0;
+    for (size_t i = 0; i < sigs.size(); ++i)
+    {
+        if (cacheKeys[i])
+        {
+            auto const& sig = sigs[i];
+            res[i] = crypto_sign_verify_detached(
+                         sig.mSignature->data(), sig.mHash->data(),
+                         sig.mHash->size(), sig.mKey.ed25519().data()) == 0;
+            ++verified;
+        }
+    }
+    if (verified == 0)
+    {
+        return res;
+    }
+
+    gVerifyCacheMiss += verified;
+    forEachShard([&](VerifySigCache::Cache& cache, size_t i) {
+        cache.put(*cacheKeys[i], res[i]);
+    });
+    return res;
+}
+
 PublicKey
 PubKeyUtils::random()
 {
@@ -11,6 +11,7 @@
 #include <array>
 #include <functional>
 #include <ostream>
+#include <vector>
 
 namespace stellar
 {
@@ -133,14 +134,42 @@ template <> struct KeyFunctions<PublicKey>
 };
 
 // public key utility functions
+// A signature with the key it may have been made with, for batches of
+// signatures to verify. The signature and the hash it signs are not copied
+// and have to outlive the verification.
+struct SignatureToVerify
+{
+    PublicKey mKey;
+    Signature const* mSignature;
+    Hash const* mHash;
+};
+
 namespace PubKeyUtils
 {
 // Return true iff `signature` is valid for `bin` under `key`.
 bool verifySig(PublicKey const& key, Signature const& signature,
                ByteSlice const& bin);
 
+// Same as calling verifySig on each of sigs, returning the results in order,
+// but each verify cache shard is locked once to look up all of them and once
+// to store the results of the ones that had to be verified, instead of once
+// or twice per signature.
+std::vector<bool> verifySigs(std::vector<SignatureToVerify> const& sigs);
+
+// The verify cache is process-wide and split into VERIFY_SIG_CACHE_SHARDS
+// independently locked shards of equal size.
+static constexpr size_t VERIFY_SIG_CACHE_SHARDS = 16;
+static constexpr size_t DEFAULT_VERIFY_SIG_CACHE_SIZE = 0x10000;
+
 void clearVerifySigCache();
 void maybeSeedVerifySigCache(unsigned int seed);
+// Resizes the verify cache to hold about size entries (rounded down to a
+// multiple of VERIFY_SIG_CACHE_SHARDS), dropping its contents if the size
+// changes. size must be at least VERIFY_SIG_CACHE_SHARDS.
+void setVerifySigCacheSize(size_t size);
+size_t getVerifySigCacheSize();
+// Approximate memory held by the entries of the cache
+size_t getVerifySigCacheMemoryUsage();
 void flushVerifySigCacheCounts(uint64_t& hits, uint64_t& misses);
 
 PublicKey random();
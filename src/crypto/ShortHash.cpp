@@ -4,6 +4,9 @@
 
 #include "ShortHash.h"
 #include "fmt/format.h"
+#include "util/wyhash.h"
+#include <atomic>
+#include <cstring>
 #include <mutex>
 #include <sodium.h>
 
@@ -13,16 +16,40 @@ namespace shortHash
 {
 static unsigned char gKey[crypto_shorthash_KEYBYTES];
 static std::mutex gKeyMutex;
-static bool gHaveHashed{false};
+static std::atomic<bool> gHaveHashed{false};
+// Derived from gKey whenever it changes, and read without gKeyMutex
+static std::atomic<uint64_t> gFastHashSeed{0};
 #ifdef BUILD_TESTS
 static unsigned int gExplicitSeed{0};
 #endif
 
+// Called with gKeyMutex held
+static void
+updateFastHashSeed()
+{
+    uint64_t s;
+    static_assert(sizeof(s) <= crypto_shorthash_KEYBYTES, "key too short");
+    std::memcpy(&s, gKey, sizeof(s));
+    gFastHashSeed.store(s, std::memory_order_relaxed);
+}
+
+static void
+markHashed()
+{
+    // Checked first, so that hashing from many threads doesn't keep writing
+    // to the same cache line
+    if (!gHaveHashed.load(std::memory_order_relaxed))
+    {
+        gHaveHashed.store(true, std::memory_order_relaxed);
+    }
+}
+
 void
 initialize()
 {
     std::lock_guard<std::mutex> guard(gKeyMutex);
     crypto_shorthash_keygen(gKey);
+    updateFastHashSeed();
 }
 
 std::array<unsigned char, crypto_shorthash_KEYBYTES>
@@ -56,6 +83,7 @@ seed(unsigned int s)
         size_t shift = i % sizeof(unsigned int);
         gKey[i] = static_cast<unsigned char>(s >> shift);
     }
+    updateFastHashSeed();
 }
 #endif
 uint64_t
@@ -71,6 +99,14 @@ computeHash(stellar::ByteSlice const& b)
     return res;
 }
 
+uint64_t
+computeFastHash(stellar::ByteSlice const& b)
+{
+    markHashed();
+    return wyhash::hash(b.data(), b.size(),
+                        gFastHashSeed.load(std::memory_order_relaxed));
+}
+
 XDRShortHasher::XDRShortHasher() : state(gKey)
 {
     std::lock_guard<std::mutex> guard(gKeyMutex);
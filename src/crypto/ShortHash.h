@@ -25,6 +25,13 @@ void seed(unsigned int);
 #endif
 uint64_t computeHash(stellar::ByteSlice const& b);
 
+// A much cheaper (wyhash) keyed hash for in-memory containers, seeded from the
+// same per-process key as `computeHash`. It is not a PRF like SipHash, so it
+// is only meant for keys that are short or already high-entropy (hashes and
+// public keys, hashed to index a container), not for arbitrary peer data.
+// Unlike `computeHash` it takes no lock.
+uint64_t computeFastHash(stellar::ByteSlice const& b);
+
 struct XDRShortHasher : XDRHasher<XDRShortHasher>
 {
     SipHash24 state;
@@ -49,8 +56,7 @@ uint64_t
 xdrComputeHash(T const& t)
 {
     XDRShortHasher xsh;
-    xdr::archive(xsh, t);
-    xsh.flush();
+    xsh.hashXDR(t);
     return xsh.state.digest();
 }
 }
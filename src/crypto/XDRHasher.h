@@ -15,8 +15,9 @@ namespace stellar
 // size_t)` member.
 template <typename Derived> struct XDRHasher
 {
-    // Buffer and batch calls to underlying hasher a _little_ bit.
-    unsigned char mBuf[256] = {0};
+    // Buffer and batch calls to underlying hasher a _little_ bit. Aligned so
+    // `hashXDR` can serialize into it with xdr_put.
+    alignas(8) unsigned char mBuf[256] = {0};
     size_t mLen = 0;
     size_t
     available() const
@@ -101,5 +102,46 @@ template <typename Derived> struct XDRHasher
     {
         xdr::xdr_traits<T>::save(*this, t);
     }
+
+    // Hashes the XDR of t and flushes. Types whose encoding has a size fixed
+    // at compile time skip the field-by-field path through queueOrHash:
+    // fixed-length opaque (hashes, keys) is hashed in place, and anything
+    // else that fits is serialized into mBuf in one pass.
+    template <typename T>
+    void
+    hashXDR(T const& t)
+    {
+        using traits = xdr::xdr_traits<T>;
+        if constexpr (traits::is_bytes)
+        {
+            if constexpr (!traits::variable_nelem)
+            {
+                if (t.size() % 4 == 0)
+                {
+                    flush();
+                    static_cast<Derived*>(this)->hashBytes(
+                        reinterpret_cast<unsigned char const*>(t.data()),
+                        t.size());
+                    return;
+                }
+            }
+        }
+        if constexpr (traits::has_fixed_size &&
+                      traits::fixed_size <= sizeof(mBuf))
+        {
+            if (traits::fixed_size > available() || (mLen & 3) != 0)
+            {
+                flush();
+            }
+            xdr::xdr_put p(mBuf + mLen, mBuf + mLen + traits::fixed_size);
+            xdr::archive(p, t);
+            mLen += traits::fixed_size;
+        }
+        else
+        {
+            xdr::archive(*this, t);
+        }
+        flush();
+    }
 };
 }
@@ -15,12 +15,17 @@
 #include "lib/catch.hpp"
 #include "test/test.h"
 #include "util/Logging.h"
+#include "util/Math.h"
 #include "xdr/Stellar-types.h"
+#include <algorithm>
+#include <atomic>
 #include <autocheck/autocheck.hpp>
+#include <xdrpp/autocheck.h>
 #include <map>
 #include <regex>
 #include <sodium.h>
 #include <stdexcept>
+#include <thread>
 
 using namespace stellar;
 
@@ -109,6 +114,56 @@ TEST_CASE("Stateful SHA256 tests", "[crypto]")
     }
 }
 
+TEST_CASE("SHA256 implementations agree with libsodium", "[crypto]")
+{
+    auto active = sha256Implementation();
+    std::vector<std::vector<uint8_t>> inputs;
+    for (size_t size = 0; size < 300; ++size)
+    {
+        inputs.emplace_back(randomBytes(size));
+    }
+    inputs.emplace_back(randomBytes(10000));
+
+    for (auto const& impl : sha256SupportedImplementations())
+    {
+        SECTION(impl)
+        {
+            sha256UseImplementation(impl);
+            REQUIRE(sha256Implementation() == impl);
+            for (auto const& pair : sha256TestVectors)
+            {
+                CHECK(binToHex(sha256(pair.first)) == pair.second);
+            }
+            for (auto const& in : inputs)
+            {
+                uint256 expected;
+                crypto_hash_sha256(expected.data(), in.data(), in.size());
+                CHECK(sha256(in) == expected);
+
+                // Same, added in pieces that straddle block boundaries
+                SHA256 h;
+                for (size_t i = 0; i < in.size(); i += 37)
+                {
+                    h.add(ByteSlice(in.data() + i,
+                                    std::min<size_t>(37, in.size() - i)));
+                }
+                CHECK(h.finish() == expected);
+            }
+
+            std::vector<ByteSlice> slices(inputs.begin(), inputs.end());
+            std::shuffle(slices.begin(), slices.end(), gRandomEngine);
+            auto hashes = sha256Batch(slices);
+            REQUIRE(hashes.size() == slices.size());
+            for (size_t i = 0; i < slices.size(); ++i)
+            {
+                CHECK(hashes[i] == sha256(slices[i]));
+            }
+            CHECK(sha256Batch({}).empty());
+        }
+    }
+    sha256UseImplementation(active);
+}
+
 TEST_CASE("XDRSHA256 is identical to byte SHA256", "[crypto]")
 {
     for (size_t i = 0; i < 1000; ++i)
@@ -120,6 +175,31 @@ TEST_CASE("XDRSHA256 is identical to byte SHA256", "[crypto]")
     }
 }
 
+TEST_CASE("XDR hashing of fixed-size types", "[crypto]")
+{
+    shortHash::initialize();
+    autocheck::generator<Hash> hashGen;
+    autocheck::generator<Price> priceGen;
+    autocheck::generator<TimeBounds> boundsGen;
+    for (size_t i = 0; i < 100; ++i)
+    {
+        // Hashed in place
+        auto h = hashGen(10);
+        CHECK(xdrSha256(h) == sha256(xdr::xdr_to_opaque(h)));
+        CHECK(xdrBlake2(h) == blake2(xdr::xdr_to_opaque(h)));
+        CHECK(shortHash::xdrComputeHash(h) ==
+              shortHash::computeHash(xdr::xdr_to_opaque(h)));
+
+        // Serialized in one pass
+        auto p = priceGen(10);
+        CHECK(xdrSha256(p) == sha256(xdr::xdr_to_opaque(p)));
+        auto tb = boundsGen(10);
+        CHECK(xdrBlake2(tb) == blake2(xdr::xdr_to_opaque(tb)));
+        CHECK(shortHash::xdrComputeHash(tb) ==
+              shortHash::computeHash(xdr::xdr_to_opaque(tb)));
+    }
+}
+
 TEST_CASE("SHA256 bytes bench", "[!hide][sha-bytes-bench]")
 {
     shortHash::initialize();
@@ -139,6 +219,23 @@ TEST_CASE("SHA256 bytes bench", "[!hide][sha-bytes-bench]")
     }
 }
 
+TEST_CASE("SHA256 batch bench", "[!hide][sha-batch-bench]")
+{
+    shortHash::initialize();
+    autocheck::rng().seed(11111);
+    std::vector<xdr::opaque_vec<>> entries;
+    for (size_t i = 0; i < 1000; ++i)
+    {
+        entries.emplace_back(xdr::xdr_to_opaque(
+            LedgerTestUtils::generateValidLedgerEntry(1000)));
+    }
+    std::vector<ByteSlice> slices(entries.begin(), entries.end());
+    for (size_t i = 0; i < 10000; ++i)
+    {
+        sha256Batch(slices);
+    }
+}
+
 TEST_CASE("SHA256 XDR bench", "[!hide][sha-xdr-bench]")
 {
     shortHash::initialize();
@@ -296,6 +393,112 @@ TEST_CASE("sign tests", "[crypto]")
     CHECK(!PubKeyUtils::verifySig(pk, sig, msg));
 }
 
+TEST_CASE("batch verify", "[crypto]")
+{
+    PubKeyUtils::clearVerifySigCache();
+    uint64_t hits = 0, misses = 0;
+    PubKeyUtils::flushVerifySigCacheCounts(hits, misses);
+
+    auto sk = SecretKey::pseudoRandomForTesting();
+    auto other = SecretKey::pseudoRandomForTesting();
+    std::vector<Hash> hashes;
+    for (int i = 0; i < 10; ++i)
+    {
+        hashes.emplace_back(sha256(std::to_string(i)));
+    }
+    std::vector<Signature> signatures;
+    for (auto const& h : hashes)
+    {
+        signatures.emplace_back(sk.sign(h));
+    }
+    Signature shortSig = signatures[0];
+    shortSig.resize(32);
+
+    std::vector<SignatureToVerify> sigs;
+    std::vector<bool> expected;
+    for (size_t i = 0; i < hashes.size(); ++i)
+    {
+        sigs.push_back({sk.getPublicKey(), &signatures[i], &hashes[i]});
+        expected.push_back(true);
+        // Wrong key, wrong message, malformed signature
+        sigs.push_back({other.getPublicKey(), &signatures[i], &hashes[i]});
+        expected.push_back(false);
+        sigs.push_back(
+            {sk.getPublicKey(), &signatures[i], &hashes[(i + 1) % 10]});
+        expected.push_back(false);
+    }
+    sigs.push_back({sk.getPublicKey(), &shortSig, &hashes[0]});
+    expected.push_back(false);
+
+    REQUIRE(PubKeyUtils::verifySigs(sigs) == expected);
+    PubKeyUtils::flushVerifySigCacheCounts(hits, misses);
+    REQUIRE(hits == 0);
+    REQUIRE(misses == sigs.size() - 1);
+
+    // Results are cached, and shared with verifySig
+    REQUIRE(PubKeyUtils::verifySigs(sigs) == expected);
+    for (size_t i = 0; i + 1 < sigs.size(); ++i)
+    {
+        REQUIRE(PubKeyUtils::verifySig(sigs[i].mKey, *sigs[i].mSignature,
+                                       *sigs[i].mHash) == expected[i]);
+    }
+    PubKeyUtils::flushVerifySigCacheCounts(hits, misses);
+    REQUIRE(hits == 2 * (sigs.size() - 1));
+    REQUIRE(misses == 0);
+}
+
+TEST_CASE("verify cache size", "[crypto]")
+{
+    auto defaultSize = PubKeyUtils::getVerifySigCacheSize();
+    REQUIRE(defaultSize == PubKeyUtils::DEFAULT_VERIFY_SIG_CACHE_SIZE);
+
+    // Rounded down to a multiple of the number of shards
+    size_t smallSize = PubKeyUtils::VERIFY_SIG_CACHE_SHARDS * 4;
+    PubKeyUtils::setVerifySigCacheSize(smallSize + 3);
+    REQUIRE(PubKeyUtils::getVerifySigCacheSize() == smallSize);
+
+    // Verify many more signatures than fit in the cache from several threads
+    // at once; entries are evicted but results stay correct
+    auto sk = SecretKey::pseudoRandomForTesting();
+    std::vector<Hash> hashes;
+    std::vector<Signature> signatures;
+    for (int i = 0; i < 500; ++i)
+    {
+        hashes.emplace_back(sha256(std::to_string(i)));
+        signatures.emplace_back(sk.sign(hashes.back()));
+    }
+    uint64_t hits = 0, misses = 0;
+    PubKeyUtils::flushVerifySigCacheCounts(hits, misses);
+    std::vector<std::thread> threads;
+    std::atomic<bool> ok{true};
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&]() {
+            for (size_t i = 0; i < hashes.size(); ++i)
+            {
+                if (!PubKeyUtils::verifySig(sk.getPublicKey(), signatures[i],
+                                            hashes[i]) ||
+                    PubKeyUtils::verifySig(sk.getPublicKey(), signatures[i],
+                                           hashes[(i + 1) % hashes.size()]))
+                {
+                    ok = false;
+                }
+            }
+        });
+    }
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+    REQUIRE(ok);
+    PubKeyUtils::flushVerifySigCacheCounts(hits, misses);
+    REQUIRE(hits + misses == 4 * 2 * hashes.size());
+    REQUIRE(misses >= 2 * hashes.size());
+
+    PubKeyUtils::setVerifySigCacheSize(defaultSize);
+    REQUIRE(PubKeyUtils::getVerifySigCacheSize() == defaultSize);
+}
+
 TEST_CASE("sign and verify benchmarking", "[crypto-bench][bench][!hide]")
 {
     size_t signPerSec = 0, verifyPerSec = 0;
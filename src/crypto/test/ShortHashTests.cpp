@@ -4,9 +4,14 @@
 
 #include "crypto/Random.h"
 #include "crypto/ShortHash.h"
+#include "ledger/LedgerHashUtils.h"
 #include "ledger/test/LedgerTestUtils.h"
 #include "lib/catch.hpp"
+#include "util/Logging.h"
+#include "util/wyhash.h"
 #include <autocheck/generator.hpp>
+#include <chrono>
+#include <cstring>
 
 // Confirms that the incremental, non-allocating `xdrComputeHash(...)` produces
 // the same output as `computeHash(xdr_to_opaque(...))`.
@@ -61,3 +66,94 @@ TEST_CASE("shorthash XDR bench", "[!hide][sh-xdr-bench]")
         }
     }
 }
+
+TEST_CASE("fast shortHash matches wyhash reference", "[shorthash][crypto]")
+{
+    // Test vectors of the reference implementation, hashing message i with
+    // seed i
+    std::vector<std::pair<std::string, uint64_t>> const vectors{
+        {"", 0x93228a4de0eec5a2ULL},
+        {"a", 0xc5bac3db178713c4ULL},
+        {"abc", 0xa97f2f7b1d9b3314ULL},
+        {"message digest", 0x786d1f1df3801df4ULL},
+        {"abcdefghijklmnopqrstuvwxyz", 0xdca5a8138ad37c87ULL},
+        {"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789",
+         0xb9e734f117cfaf70ULL},
+        {"123456789012345678901234567890123456789012345678901234567890123456"
+         "78901234567890",
+         0x6cc5eab49a92d617ULL}};
+    for (size_t i = 0; i < vectors.size(); ++i)
+    {
+        auto const& msg = vectors[i].first;
+        CHECK(wyhash::hash(msg.data(), msg.size(), i) == vectors[i].second);
+    }
+
+    shortHash::initialize();
+    uint256 a, b;
+    a.fill(1);
+    b = a;
+    REQUIRE(shortHash::computeFastHash(a) == shortHash::computeFastHash(b));
+    b[31] = 2;
+    REQUIRE(shortHash::computeFastHash(a) != shortHash::computeFastHash(b));
+}
+
+TEST_CASE("shorthash ledger key bench", "[!hide][sh-key-bench]")
+{
+    shortHash::initialize();
+    autocheck::rng().seed(11111);
+    auto keys =
+        LedgerTestUtils::generateValidUniqueLedgerEntryKeysWithExclusions(
+            {CONFIG_SETTING}, 10000);
+    size_t const rounds = 1000;
+
+    // What hashing the keys cost with SipHash for every component, against
+    // the std::hash<LedgerKey> that UnorderedMap<LedgerKey, ...> uses
+    size_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < rounds; ++i)
+    {
+        for (auto const& k : keys)
+        {
+            sink += shortHash::xdrComputeHash(k);
+        }
+    }
+    auto sip = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < rounds; ++i)
+    {
+        for (auto const& k : keys)
+        {
+            sink += std::hash<LedgerKey>()(k);
+        }
+    }
+    auto fast = std::chrono::steady_clock::now() - start;
+
+    uint256 h;
+    h.fill(7);
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < rounds * keys.size(); ++i)
+    {
+        std::memcpy(h.data(), &i, sizeof(i));
+        sink += shortHash::computeHash(ByteSlice(h.data(), 8));
+    }
+    auto sipHash = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < rounds * keys.size(); ++i)
+    {
+        std::memcpy(h.data(), &i, sizeof(i));
+        sink += std::hash<uint256>()(h);
+    }
+    auto fastHash = std::chrono::steady_clock::now() - start;
+
+    auto perCall = [&](auto d) {
+        return std::chrono::duration<double, std::nano>(d).count() /
+               (rounds * keys.size());
+    };
+    LOG_INFO(DEFAULT_LOG,
+             "LedgerKey: {:.1f} ns SipHash XDR, {:.1f} ns std::hash; uint256: "
+             "{:.1f} ns SipHash, {:.1f} ns std::hash ({})",
+             perCall(sip), perCall(fast), perCall(sipHash), perCall(fastHash),
+             sink);
+}
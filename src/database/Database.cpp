@@ -130,9 +130,11 @@ Database::registerDrivers()
 class DatabaseConfigureSessionOp : public DatabaseTypeSpecificOperation<void>
 {
     soci::session& mSession;
+    Config const& mConfig;
 
   public:
-    DatabaseConfigureSessionOp(soci::session& sess) : mSession(sess)
+    DatabaseConfigureSessionOp(soci::session& sess, Config const& cfg)
+        : mSession(sess), mConfig(cfg)
     {
     }
     void
@@ -145,9 +147,6 @@ class DatabaseConfigureSessionOp : public DatabaseTypeSpecificOperation<void>
         }
 
         mSession << "PRAGMA journal_mode = WAL";
-        // FULL is needed as to ensure durability
-        // NORMAL is enough for non validating nodes
-        // mSession << "PRAGMA synchronous = NORMAL";
 
         // number of pages in WAL file
         mSession << "PRAGMA wal_autocheckpoint=10000";
@@ -156,11 +155,28 @@ class DatabaseConfigureSessionOp : public DatabaseTypeSpecificOperation<void>
         // that may lock the database for some time
         mSession << "PRAGMA busy_timeout = 10000";
 
-        // adjust caches
-        // 20000 pages
-        mSession << "PRAGMA cache_size=-20000";
-        // 100 MB map
-        mSession << "PRAGMA mmap_size=104857600";
+        if (mConfig.SQLITE_PROFILE == "FAST")
+        {
+            // NORMAL is enough for non validating nodes: a power loss may
+            // roll back the last commits, but never corrupts the database
+            mSession << "PRAGMA synchronous = NORMAL";
+            // truncate the WAL file back to 64 MB after checkpoints
+            mSession << "PRAGMA journal_size_limit=67108864";
+            // 256 MB cache
+            mSession << "PRAGMA cache_size=-262144";
+            // 1 GB map
+            mSession << "PRAGMA mmap_size=1073741824";
+        }
+        else
+        {
+            // FULL is needed as to ensure durability
+            mSession << "PRAGMA synchronous = FULL";
+            // adjust caches
+            // 20000 pages
+            mSession << "PRAGMA cache_size=-20000";
+            // 100 MB map
+            mSession << "PRAGMA mmap_size=104857600";
+        }
 
         // Register the sqlite carray() extension we use for bulk operations.
         sqlite3_carray_init(sq->conn_, nullptr, nullptr);
@@ -200,7 +216,7 @@ void
 Database::open()
 {
     mSession.open(mApp.getConfig().DATABASE.value);
-    DatabaseConfigureSessionOp op(mSession);
+    DatabaseConfigureSessionOp op(mSession, mApp.getConfig());
     doDatabaseTypeSpecificOperation(op);
 }
 
@@ -428,8 +444,8 @@ Database::clearPreparedStatementCache()
     {
         st.second->clean_up(true);
     }
+    mStatementsSize.dec(mStatements.size());
     mStatements.clear();
-    mStatementsSize.set_count(mStatements.size());
 }
 
 void
@@ -497,6 +513,7 @@ Database::getSession()
 soci::connection_pool&
 Database::getPool()
 {
+    std::lock_guard<std::mutex> lock(mPoolMutex);
     if (!mPool)
     {
         auto const& c = mApp.getConfig().DATABASE;
@@ -515,9 +532,10 @@ Database::getPool()
             LOG_DEBUG(DEFAULT_LOG, "Opening pool entry {}", i);
             soci::session& sess = mPool->at(i);
             sess.open(c.value);
-            DatabaseConfigureSessionOp op(sess);
+            DatabaseConfigureSessionOp op(sess, mApp.getConfig());
             stellar::doDatabaseTypeSpecificOperation(sess, op);
         }
+        mPoolStatements.resize(n);
     }
     releaseAssert(mPool);
     return *mPool;
@@ -562,15 +580,22 @@ class SQLLogContext : NonCopyable
 StatementContext
 Database::getPreparedStatement(std::string const& query)
 {
-    auto i = mStatements.find(query);
+    return getPreparedStatement(mStatements, mSession, query);
+}
+
+StatementContext
+Database::getPreparedStatement(StatementCache& cache, soci::session& session,
+                               std::string const& query)
+{
+    auto i = cache.find(query);
     std::shared_ptr<soci::statement> p;
-    if (i == mStatements.end())
+    if (i == cache.end())
     {
-        p = std::make_shared<soci::statement>(mSession);
+        p = std::make_shared<soci::statement>(session);
         p->alloc();
         p->prepare(query);
-        mStatements.insert(std::make_pair(query, p));
-        mStatementsSize.set_count(mStatements.size());
+        cache.insert(std::make_pair(query, p));
+        mStatementsSize.inc();
     }
     else
     {
@@ -580,6 +605,55 @@ Database::getPreparedStatement(std::string const& query)
     return sc;
 }
 
+namespace
+{
+struct ThreadLease
+{
+    size_t mPosition;
+    size_t mDepth;
+};
+// Pool positions leased by the current thread, by Database
+thread_local std::map<Database const*, ThreadLease> gThreadLeases;
+}
+
+PooledSession::PooledSession(Database& db) : mDatabase(db)
+{
+    auto& pool = mDatabase.getPool();
+    auto it = gThreadLeases.find(&mDatabase);
+    if (it == gThreadLeases.end())
+    {
+        it = gThreadLeases.emplace(&mDatabase, ThreadLease{pool.lease(), 0})
+                 .first;
+    }
+    ++it->second.mDepth;
+    mPosition = it->second.mPosition;
+    mSession = &pool.at(mPosition);
+}
+
+PooledSession::~PooledSession()
+{
+    auto it = gThreadLeases.find(&mDatabase);
+    releaseAssert(it != gThreadLeases.end());
+    if (--it->second.mDepth == 0)
+    {
+        gThreadLeases.erase(it);
+        mDatabase.getPool().give_back(mPosition);
+    }
+}
+
+soci::session&
+PooledSession::session()
+{
+    return *mSession;
+}
+
+StatementContext
+PooledSession::getPreparedStatement(std::string const& query)
+{
+    return mDatabase.getPreparedStatement(
+        mDatabase.mPoolStatements.at(mPosition), *mSession, query);
+}
+
 std::shared_ptr<SQLLogContext>
 Database::captureAndLogSQL(std::string contextName)
 {
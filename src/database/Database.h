@@ -11,9 +11,12 @@
 #include "util/NonCopyable.h"
 #include "util/Timer.h"
 #include <functional>
+#include <map>
+#include <mutex>
 #include <set>
 #include <soci.h>
 #include <string>
+#include <vector>
 #include <xdrpp/marshal.h>
 
 namespace medida
@@ -25,6 +28,7 @@ class Counter;
 namespace stellar
 {
 class Application;
+class PooledSession;
 class SQLLogContext;
 
 /**
@@ -89,9 +93,15 @@ class Database : NonMovableOrCopyable
     Application& mApp;
     medida::Meter& mQueryMeter;
     soci::session mSession;
+    std::mutex mPoolMutex;
     std::unique_ptr<soci::connection_pool> mPool;
 
-    std::map<std::string, std::shared_ptr<soci::statement>> mStatements;
+    using StatementCache =
+        std::map<std::string, std::shared_ptr<soci::statement>>;
+    StatementCache mStatements;
+    // Prepared statements of each session in mPool, by position. A position
+    // is only used by the thread leasing it, so these need no lock.
+    std::vector<StatementCache> mPoolStatements;
     medida::Counter& mStatementsSize;
 
     std::set<std::string> mEntityTypes;
@@ -100,6 +110,11 @@ class Database : NonMovableOrCopyable
     static void registerDrivers();
     void applySchemaUpgrade(unsigned long vers);
     void open();
+    StatementContext getPreparedStatement(StatementCache& cache,
+                                          soci::session& session,
+                                          std::string const& query);
+
+    friend class PooledSession;
 
   public:
     // Instantiate object and connect to app.getConfig().DATABASE;
@@ -121,8 +136,8 @@ class Database : NonMovableOrCopyable
     // when the statement context is destroyed.
     StatementContext getPreparedStatement(std::string const& query);
 
-    // Purge all cached prepared statements, closing their handles with the
-    // database.
+    // Purge all cached prepared statements of the main session, closing
+    // their handles with the database.
     void clearPreparedStatementCache();
 
     // Return metric-gathering timers for various families of SQL operation.
@@ -179,10 +194,36 @@ class Database : NonMovableOrCopyable
     soci::session& getSession();
 
     // Access the optional SOCI connection pool available for worker
-    // threads. Throws an error if !canUsePool().
+    // threads, creating it on first use from any thread. Throws an error if
+    // !canUsePool(). Prefer leasing its sessions through PooledSession.
     soci::connection_pool& getPool();
 };
 
+/**
+ * Lease of one of a Database's pool sessions to the current thread for the
+ * lifetime of this object, with the prepared statements cached for that
+ * session. Leases nest: while a thread holds one, leasing from the same
+ * Database again on that thread shares its session instead of taking (and
+ * maybe waiting for) another, so each thread uses at most one connection and
+ * the caches stay warm across the leases of worker threads.
+ */
+class PooledSession : NonMovableOrCopyable
+{
+    Database& mDatabase;
+    size_t mPosition;
+    soci::session* mSession;
+
+  public:
+    // Throws an error if !db.canUsePool()
+    explicit PooledSession(Database& db);
+    ~PooledSession();
+
+    soci::session& session();
+
+    // As Database::getPreparedStatement, for this session
+    StatementContext getPreparedStatement(std::string const& query);
+};
+
 template <typename T>
 T
 doDatabaseTypeSpecificOperation(soci::session& session,
@@ -12,16 +12,22 @@
 #include "lib/util/stdrandom.h"
 #include "main/Application.h"
 #include "main/Config.h"
+#include "test/TestAccount.h"
 #include "test/TestUtils.h"
+#include "test/TxTests.h"
 #include "test/test.h"
 #include "util/Decoder.h"
 #include "util/Logging.h"
 #include "util/Math.h"
 #include "util/Timer.h"
 #include "util/TmpDir.h"
+#include "medida/counter.h"
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
 #include <algorithm>
 #include <optional>
 #include <random>
+#include <thread>
 
 using namespace stellar;
 
@@ -88,6 +94,62 @@ TEST_CASE("database on-disk smoketest", "[db]")
     transactionTest(app);
 }
 
+TEST_CASE("pooled session leases", "[db]")
+{
+    Config const& cfg = getTestConfig(0, Config::TESTDB_ON_DISK_SQLITE);
+
+    VirtualClock clock;
+    Application::pointer app = createTestApplication(clock, cfg, true, false);
+    auto& db = app->getDatabase();
+    auto& statements =
+        app->getMetrics().NewCounter({"database", "memory", "statements"});
+
+    PooledSession outer(db);
+    SECTION("nested leases on one thread share a session")
+    {
+        PooledSession inner(db);
+        REQUIRE(&inner.session() == &outer.session());
+    }
+    // The pool has a session per hardware thread
+    if (std::thread::hardware_concurrency() > 1)
+    {
+        SECTION("other threads lease other sessions")
+        {
+            soci::session* other = nullptr;
+            std::thread t([&]() {
+                PooledSession sess(db);
+                other = &sess.session();
+            });
+            t.join();
+            REQUIRE(other != &outer.session());
+        }
+    }
+    SECTION("prepared statements are cached per session")
+    {
+        auto before = statements.count();
+        int x = 0;
+        for (int i = 0; i < 3; ++i)
+        {
+            auto prep = outer.getPreparedStatement("SELECT 1");
+            auto& st = prep.statement();
+            st.exchange(soci::into(x));
+            st.define_and_bind();
+            st.execute(true);
+            REQUIRE(x == 1);
+        }
+        REQUIRE(statements.count() == before + 1);
+
+        {
+            PooledSession inner(db);
+            inner.getPreparedStatement("SELECT 1");
+        }
+        REQUIRE(statements.count() == before + 1);
+
+        db.getPreparedStatement("SELECT 1");
+        REQUIRE(statements.count() == before + 2);
+    }
+}
+
 void
 checkMVCCIsolation(Application::pointer app)
 {
@@ -347,6 +409,42 @@ TEST_CASE("postgres performance", "[db][pgperf][!hide]")
 
 #endif
 
+TEST_CASE("sqlite profile performance", "[db][sqliteperf][!hide]")
+{
+    auto timeLedgerCloses = [](std::string const& profile) {
+        Config cfg(getTestConfig(0, Config::TESTDB_ON_DISK_SQLITE));
+        cfg.SQLITE_PROFILE = profile;
+        VirtualClock clock;
+        Application::pointer app = createTestApplication(clock, cfg);
+
+        auto root = TestAccount::createRoot(*app);
+        auto minBalance = app->getLedgerManager().getLastMinBalance(0);
+        std::vector<Operation> creates, payments;
+        for (int i = 0; i < 100; ++i)
+        {
+            auto key = txtest::getAccount(fmt::format("acc{}", i));
+            creates.emplace_back(
+                txtest::createAccount(key.getPublicKey(), minBalance * 10));
+            payments.emplace_back(txtest::payment(key.getPublicKey(), 1));
+        }
+        closeLedger(*app, {root.tx(creates)});
+
+        auto& close = app->getMetrics().NewTimer({"ledger", "ledger", "close"});
+        close.Clear();
+        for (int i = 0; i < 100; ++i)
+        {
+            closeLedger(*app, {root.tx(payments)});
+        }
+        LOG_INFO(DEFAULT_LOG,
+                 "SQLITE_PROFILE={}: {} ledgers of 100 payments, mean close "
+                 "{:.2f} ms, p99 {:.2f} ms",
+                 profile, close.count(), close.mean(),
+                 close.GetSnapshot().get99thPercentile());
+    };
+    timeLedgerCloses("DURABLE");
+    timeLedgerCloses("FAST");
+}
+
 TEST_CASE("schema test", "[db]")
 {
     Config const& cfg = getTestConfig(0, Config::TESTDB_IN_MEMORY_SQLITE);
@@ -133,6 +133,11 @@ class Herder
 
     // We are learning about a new envelope.
     virtual EnvelopeStatus recvSCPEnvelope(SCPEnvelope const& envelope) = 0;
+    // Same, for an envelope whose signature was already checked (on an
+    // overlay thread): signatureValid is the result, and the signature is
+    // not verified again.
+    virtual EnvelopeStatus recvSCPEnvelope(SCPEnvelope const& envelope,
+                                           bool signatureValid) = 0;
 
     virtual bool isTracking() const = 0;
 
@@ -34,11 +34,15 @@
 #include "util/Timer.h"
 
 #include "medida/counter.h"
+#include "medida/histogram.h"
 #include "medida/meter.h"
 #include "medida/metrics_registry.h"
 #include "util/Decoder.h"
 #include "util/XDRStream.h"
 #include "xdr/Stellar-internal.h"
+#ifdef BUILD_TESTS
+#include "simulation/LoadGenerator.h"
+#endif
 #include "xdrpp/marshal.h"
 #include "xdrpp/types.h"
 #include <Tracy.hpp>
@@ -90,6 +94,7 @@ HerderImpl::HerderImpl(Application& app)
     , mTriggerTimer(app)
     , mOutOfSyncTimer(app)
     , mTxSetGarbageCollectTimer(app)
+    , mTxSetCandidateTimer(app)
     , mApp(app)
     , mLedgerManager(app.getLedgerManager())
     , mSCPMetrics(app)
@@ -275,6 +280,11 @@ HerderImpl::shutdown()
                    "Shutdown interrupting quorum transitive closure analysis.");
         mLastQuorumMapIntersectionState.mInterruptFlag = true;
     }
+    if (mStarted && mApp.getConfig().EXPERIMENTAL_PERSIST_TX_QUEUE)
+    {
+        persistTransactionQueues();
+    }
+    mStarted = false;
     mTransactionQueue.shutdown();
     if (mSorobanTransactionQueue)
     {
@@ -282,6 +292,7 @@ HerderImpl::shutdown()
     }
 
     mTxSetGarbageCollectTimer.cancel();
+    mTxSetCandidateTimer.cancel();
 }
 
 void
@@ -586,6 +597,7 @@ HerderImpl::recvTransaction(TransactionFrameBasePtr tx, bool submittedFromSelf)
         CLOG_TRACE(Herder, "recv transaction {} for {}",
                    hexAbbrev(tx->getFullHash()),
                    KeyUtils::toShortString(tx->getSourceID()));
+        scheduleTxSetCandidateRefresh();
     }
     return result;
 }
@@ -711,6 +723,19 @@ HerderImpl::getMinLedgerSeqToRemember() const
 
 Herder::EnvelopeStatus
 HerderImpl::recvSCPEnvelope(SCPEnvelope const& envelope)
+{
+    return recvSCPEnvelopeImpl(envelope, std::nullopt);
+}
+
+Herder::EnvelopeStatus
+HerderImpl::recvSCPEnvelope(SCPEnvelope const& envelope, bool signatureValid)
+{
+    return recvSCPEnvelopeImpl(envelope, signatureValid);
+}
+
+Herder::EnvelopeStatus
+HerderImpl::recvSCPEnvelopeImpl(SCPEnvelope const& envelope,
+                                std::optional<bool> signatureValid)
 {
     ZoneScoped;
     if (mApp.getConfig().MANUAL_CLOSE)
@@ -781,7 +806,8 @@ HerderImpl::recvSCPEnvelope(SCPEnvelope const& envelope)
     }
 
     // **** from this point, we have to check signatures
-    if (!verifyEnvelope(envelope))
+    if (!(signatureValid ? recordEnvelopeSignature(*signatureValid)
+                         : verifyEnvelope(envelope)))
     {
         std::string txt("DISCARDED - bad envelope");
         ZoneText(txt.c_str(), txt.size());
@@ -1011,7 +1037,10 @@ HerderImpl::processSCPQueueUpToIndex(uint64 slotIndex)
         SCPEnvelopeWrapperPtr envW = mPendingEnvelopes.pop(slotIndex);
         if (envW)
         {
+            mHerderSCPDriver.setProcessingEnvelopeFrom(
+                envW->getStatement().nodeID);
             auto r = getSCP().receiveEnvelope(envW);
+            mHerderSCPDriver.setProcessingEnvelopeFrom(std::nullopt);
             if (r == SCP::EnvelopeState::VALID)
             {
                 auto const& env = envW->getEnvelope();
@@ -1110,6 +1139,58 @@ HerderImpl::lastClosedLedgerIncreased(bool latest)
     }
 }
 
+std::chrono::milliseconds
+HerderImpl::computeTriggerAdvance(uint64_t lastIndex)
+{
+    using namespace std::chrono;
+    auto const& cfg = mApp.getConfig();
+    milliseconds maxAdvance(cfg.EXPERIMENTAL_ADAPTIVE_TRIGGER_MAX_ADVANCE_MS);
+    if (maxAdvance == milliseconds::zero())
+    {
+        return milliseconds::zero();
+    }
+
+    // Ledgers are EXP_LEDGER_TIMESPAN_SECONDS apart from one ballot protocol
+    // start to the next, plus the time nomination takes. Triggering earlier
+    // by the time nomination is expected to take keeps ledgers closing at
+    // the expected close time.
+    auto nominationStart = mHerderSCPDriver.getNominationStart(lastIndex);
+    auto prepareStart = mHerderSCPDriver.getPrepareStart(lastIndex);
+    if (nominationStart && prepareStart && *prepareStart >= *nominationStart)
+    {
+        auto latency =
+            duration_cast<milliseconds>(*prepareStart - *nominationStart);
+        // Exponentially weighted, so that a single slow round only moves
+        // the trigger a little
+        mNominationLatencyEstimate =
+            mNominationLatencyEstimate
+                ? (*mNominationLatencyEstimate * 3 + latency) / 4
+                : latency;
+        mApp.getMetrics()
+            .NewCounter({"herder", "trigger", "nomination-estimate"})
+            .set_count(mNominationLatencyEstimate->count());
+    }
+
+    // Empty ledgers don't confirm anything sooner when closed early.
+    // A slow apply needs no special handling: it delays this call, and the
+    // trigger never fires before now anyway.
+    bool hasQueuedTxs =
+        mTransactionQueue.size() > 0 ||
+        (mSorobanTransactionQueue && mSorobanTransactionQueue->size() > 0);
+    auto advance = milliseconds::zero();
+    if (hasQueuedTxs && mNominationLatencyEstimate)
+    {
+        auto cap = std::min(
+            maxAdvance,
+            duration_cast<milliseconds>(cfg.getExpectedLedgerCloseTime()) / 2);
+        advance = std::min(*mNominationLatencyEstimate, cap);
+    }
+    mApp.getMetrics()
+        .NewHistogram({"herder", "trigger", "advance"})
+        .Update(advance.count());
+    return advance;
+}
+
 void
 HerderImpl::setupTriggerNextLedger()
 {
@@ -1143,7 +1224,8 @@ HerderImpl::setupTriggerNextLedger()
 
     // Adjust trigger time in case node's clock has drifted.
     // This ensures that next value to nominate is valid
-    auto triggerTime = lastBallotStart + seconds;
+    auto triggerTime =
+        lastBallotStart + seconds - computeTriggerAdvance(lastIndex);
 
     if (triggerTime < now)
     {
@@ -1302,19 +1384,7 @@ HerderImpl::triggerNextLedger(uint32_t ledgerSeqToTrigger,
         return;
     }
 
-    // our first choice for this round's set is all the tx we have collected
-    // during last few ledger closes
     auto const& lcl = mLedgerManager.getLastClosedLedgerHeader();
-    TxSetPhaseTransactions txPhases;
-    txPhases.emplace_back(mTransactionQueue.getTransactions(lcl.header));
-
-    if (protocolVersionStartsFrom(lcl.header.ledgerVersion,
-                                  SOROBAN_PROTOCOL_VERSION))
-    {
-        releaseAssert(mSorobanTransactionQueue);
-        txPhases.emplace_back(
-            mSorobanTransactionQueue->getTransactions(lcl.header));
-    }
 
     // We pick as next close time the current time unless it's before the last
     // close time. We don't know how much time it will take to reach consensus
@@ -1347,23 +1417,8 @@ HerderImpl::triggerNextLedger(uint32_t ledgerSeqToTrigger,
     upperBoundCloseTimeOffset = nextCloseTime - lcl.header.scpValue.closeTime;
     lowerBoundCloseTimeOffset = upperBoundCloseTimeOffset;
 
-    TxSetPhaseTransactions invalidTxPhases;
-    invalidTxPhases.resize(txPhases.size());
-
-    auto [proposedSet, applicableProposedSet] =
-        makeTxSetFromTransactions(txPhases, mApp, lowerBoundCloseTimeOffset,
-                                  upperBoundCloseTimeOffset, invalidTxPhases);
-
-    if (protocolVersionStartsFrom(lcl.header.ledgerVersion,
-                                  SOROBAN_PROTOCOL_VERSION))
-    {
-        releaseAssert(mSorobanTransactionQueue);
-        mSorobanTransactionQueue->ban(
-            invalidTxPhases[static_cast<size_t>(TxSetPhase::SOROBAN)]);
-    }
-
-    mTransactionQueue.ban(
-        invalidTxPhases[static_cast<size_t>(TxSetPhase::CLASSIC)]);
+    auto proposedSet = makeTxSetToNominate(lcl, lowerBoundCloseTimeOffset,
+                                           upperBoundCloseTimeOffset);
 
     auto txSetHash = proposedSet->getContentsHash();
 
@@ -1424,6 +1479,128 @@ HerderImpl::triggerNextLedger(uint32_t ledgerSeqToTrigger,
                               lcl.header.scpValue);
 }
 
+TxSetXDRFrameConstPtr
+HerderImpl::makeTxSetToNominate(LedgerHeaderHistoryEntry const& lcl,
+                                TimePoint lowerBoundCloseTimeOffset,
+                                TimePoint upperBoundCloseTimeOffset)
+{
+    ZoneScoped;
+    auto sorobanQueueVersion =
+        mSorobanTransactionQueue
+            ? mSorobanTransactionQueue->getContentsVersion()
+            : 0;
+    if (mTxSetCandidate && mTxSetCandidate->mPreviousLedgerHash == lcl.hash &&
+        mTxSetCandidate->mClassicQueueVersion ==
+            mTransactionQueue.getContentsVersion() &&
+        mTxSetCandidate->mSorobanQueueVersion == sorobanQueueVersion &&
+        mTxSetCandidate->mLowerBoundCloseTimeOffset <=
+            lowerBoundCloseTimeOffset &&
+        mTxSetCandidate->mUpperBoundCloseTimeOffset >=
+            upperBoundCloseTimeOffset)
+    {
+        mApp.getMetrics()
+            .NewMeter({"herder", "tx-set-candidate", "hit"}, "txset")
+            .Mark();
+        return mTxSetCandidate->mTxSet;
+    }
+    if (mTxSetCandidate)
+    {
+        mApp.getMetrics()
+            .NewMeter({"herder", "tx-set-candidate", "miss"}, "txset")
+            .Mark();
+    }
+
+    // our first choice for this round's set is all the tx we have collected
+    // during last few ledger closes
+    TxSetPhaseTransactions txPhases;
+    txPhases.emplace_back(mTransactionQueue.getTransactions(lcl.header));
+
+    if (protocolVersionStartsFrom(lcl.header.ledgerVersion,
+                                  SOROBAN_PROTOCOL_VERSION))
+    {
+        releaseAssert(mSorobanTransactionQueue);
+        txPhases.emplace_back(
+            mSorobanTransactionQueue->getTransactions(lcl.header));
+    }
+
+    TxSetPhaseTransactions invalidTxPhases;
+    invalidTxPhases.resize(txPhases.size());
+
+    auto [proposedSet, applicableProposedSet] =
+        makeTxSetFromTransactions(txPhases, mApp, lowerBoundCloseTimeOffset,
+                                  upperBoundCloseTimeOffset, invalidTxPhases);
+
+    if (protocolVersionStartsFrom(lcl.header.ledgerVersion,
+                                  SOROBAN_PROTOCOL_VERSION))
+    {
+        releaseAssert(mSorobanTransactionQueue);
+        mSorobanTransactionQueue->ban(
+            invalidTxPhases[static_cast<size_t>(TxSetPhase::SOROBAN)]);
+    }
+
+    mTransactionQueue.ban(
+        invalidTxPhases[static_cast<size_t>(TxSetPhase::CLASSIC)]);
+
+    return proposedSet;
+}
+
+void
+HerderImpl::scheduleTxSetCandidateRefresh()
+{
+    auto refreshMs = mApp.getConfig().EXPERIMENTAL_TX_SET_CANDIDATE_REFRESH_MS;
+    if (refreshMs == 0 || mTxSetCandidateRefreshPending)
+    {
+        return;
+    }
+    mTxSetCandidateRefreshPending = true;
+    mTxSetCandidateTimer.expires_from_now(
+        std::chrono::milliseconds(refreshMs));
+    mTxSetCandidateTimer.async_wait(
+        [this]() {
+            mTxSetCandidateRefreshPending = false;
+            refreshTxSetCandidate();
+        },
+        [this](asio::error_code const&) {
+            mTxSetCandidateRefreshPending = false;
+        });
+}
+
+void
+HerderImpl::refreshTxSetCandidate()
+{
+    ZoneScoped;
+    mTxSetCandidate.reset();
+    if (!isTracking() || !mLedgerManager.isSynced())
+    {
+        return;
+    }
+
+    // Build for any close time from now until the latest one transactions
+    // are admitted to the queue for, so that nomination in that window can
+    // use the candidate
+    auto const& lcl = mLedgerManager.getLastClosedLedgerHeader();
+    auto lastCloseTime = lcl.header.scpValue.closeTime;
+    uint64_t now = VirtualClock::to_time_t(mApp.getClock().system_now());
+    TimePoint lowerBoundCloseTimeOffset =
+        now <= lastCloseTime ? 1 : now - lastCloseTime;
+    TimePoint upperBoundCloseTimeOffset =
+        std::max(lowerBoundCloseTimeOffset,
+                 getUpperBoundCloseTimeOffset(mApp, lastCloseTime));
+
+    auto txSet = makeTxSetToNominate(lcl, lowerBoundCloseTimeOffset,
+                                     upperBoundCloseTimeOffset);
+    // Versions are taken after the invalid transactions have been banned
+    mTxSetCandidate = TxSetCandidate{
+        lcl.hash,
+        mTransactionQueue.getContentsVersion(),
+        mSorobanTransactionQueue
+            ? mSorobanTransactionQueue->getContentsVersion()
+            : 0,
+        lowerBoundCloseTimeOffset,
+        upperBoundCloseTimeOffset,
+        txSet};
+}
+
 void
 HerderImpl::setUpgrades(Upgrades::UpgradeParameters const& upgrades)
 {
@@ -1509,6 +1686,7 @@ HerderImpl::getJsonInfo(size_t limit, bool fullKeys)
         mApp.getConfig().NODE_SEED.getPublicKey(), fullKeys);
 
     ret["scp"] = getSCP().getJsonInfo(limit, fullKeys);
+    ret["phases"] = mHerderSCPDriver.getJsonPhaseInfo(limit, fullKeys);
     ret["queue"] = mPendingEnvelopes.getJsonInfo(limit);
     return ret;
 }
@@ -1842,7 +2020,8 @@ HerderImpl::checkAndMaybeReanalyzeQuorumMap()
                     "QuorumIntersectionChecker interrupted");
             }
         };
-        mApp.postOnBackgroundThread(worker, "QuorumIntersectionChecker");
+        mApp.postOnBackgroundThread(worker, "QuorumIntersectionChecker",
+                                    WorkerPriority::BULK);
     }
 }
 
@@ -1896,10 +2075,8 @@ HerderImpl::persistSCPState(uint64 slot)
     std::unordered_map<Hash, std::string> txSetsToPersist;
     for (auto it : txSets)
     {
-        StoredTransactionSet tempTxSet;
-        it.second->storeXDR(tempTxSet);
         txSetsToPersist.emplace(
-            it.first, decoder::encode_b64(xdr::xdr_to_opaque(tempTxSet)));
+            it.first, decoder::encode_b64(it.second->encodeStoredXDR()));
     }
 
     latestSCPData = xdr::xdr_to_opaque(scpState);
@@ -2018,6 +2195,92 @@ HerderImpl::restoreUpgrades()
     }
 }
 
+void
+HerderImpl::persistTransactionQueues()
+{
+    ZoneScoped;
+    auto const& lcl = mLedgerManager.getLastClosedLedgerHeader().header;
+    xdr::xvector<TransactionEnvelope> envs;
+    for (auto const& tx : mTransactionQueue.getTransactions(lcl))
+    {
+        envs.emplace_back(tx->getEnvelope());
+    }
+    if (mSorobanTransactionQueue)
+    {
+        for (auto const& tx : mSorobanTransactionQueue->getTransactions(lcl))
+        {
+            envs.emplace_back(tx->getEnvelope());
+        }
+    }
+
+    CLOG_INFO(Herder, "Saving {} queued transactions", envs.size());
+    mApp.getPersistentState().setState(
+        PersistentState::kTxQueue,
+        decoder::encode_b64(xdr::xdr_to_opaque(envs)));
+}
+
+void
+HerderImpl::restoreTransactionQueues()
+{
+    ZoneScoped;
+    auto& ps = mApp.getPersistentState();
+    std::string s = ps.getState(PersistentState::kTxQueue);
+    if (s.empty())
+    {
+        return;
+    }
+    // The saved transactions are only queued again on the first start after
+    // they were saved
+    ps.setState(PersistentState::kTxQueue, "");
+
+    // Decoding the transactions is done in the background, queueing them
+    // (which checks them against the last closed ledger) on the main thread
+    mApp.postOnBackgroundThread(
+        [&app = mApp, s = std::move(s)]() {
+            std::vector<TransactionFrameBasePtr> txs;
+            try
+            {
+                std::vector<uint8_t> buffer;
+                decoder::decode_b64(s, buffer);
+                xdr::xvector<TransactionEnvelope> envs;
+                xdr::xdr_from_opaque(buffer, envs);
+                txs.reserve(envs.size());
+                for (auto const& env : envs)
+                {
+                    txs.emplace_back(
+                        TransactionFrameBase::makeTransactionFromWire(
+                            app.getNetworkID(), env));
+                    txs.back()->getFullHash();
+                }
+            }
+            catch (std::exception& e)
+            {
+                CLOG_INFO(Herder,
+                          "Error while restoring queued transactions, "
+                          "proceeding without them : {}",
+                          e.what());
+                return;
+            }
+
+            app.postOnMainThread(
+                [&app, txs = std::move(txs)]() {
+                    size_t queued = 0;
+                    for (auto const& tx : txs)
+                    {
+                        if (app.getHerder().recvTransaction(tx, false) ==
+                            TransactionQueue::AddResult::ADD_STATUS_PENDING)
+                        {
+                            ++queued;
+                        }
+                    }
+                    CLOG_INFO(Herder, "Queued {} of {} saved transactions",
+                              queued, txs.size());
+                },
+                "HerderImpl: restore queued transactions");
+        },
+        "HerderImpl: decode queued transactions");
+}
+
 void
 HerderImpl::maybeHandleUpgrade()
 {
@@ -2136,7 +2399,12 @@ HerderImpl::start()
     }
 
     restoreUpgrades();
+    if (mApp.getConfig().EXPERIMENTAL_PERSIST_TX_QUEUE)
+    {
+        restoreTransactionQueues();
+    }
     startTxSetGCTimer();
+    mStarted = true;
 }
 
 void
@@ -2220,13 +2488,17 @@ HerderImpl::updateTransactionQueue(TxSetXDRFrameConstPtr externalizedTxSet)
     auto txsPerPhase =
         externalizedTxSet->createTransactionFrames(mApp.getNetworkID());
 
+#ifdef BUILD_TESTS
+    if (mApp.getConfig().ARTIFICIALLY_GENERATE_LOAD_FOR_TESTING)
+    {
+        mApp.getLoadGenerator().txsExternalized(txsPerPhase);
+    }
+#endif
+
     auto lhhe = mLedgerManager.getLastClosedLedgerHeader();
 
     auto updateQueue = [&](auto& queue, auto const& applied) {
-        queue.removeApplied(applied);
-        queue.shift();
-
-        auto txs = queue.getTransactions(lhhe.header);
+        auto txs = queue.removeAppliedAndShift(applied, lhhe.header);
 
         auto invalidTxs = TxSetUtils::getInvalidTxList(
             txs, mApp, 0,
@@ -2234,7 +2506,7 @@ HerderImpl::updateTransactionQueue(TxSetXDRFrameConstPtr externalizedTxSet)
             false);
         queue.ban(invalidTxs);
 
-        queue.rebroadcast();
+        queue.rebroadcastMarked();
     };
     if (txsPerPhase.size() > static_cast<size_t>(TxSetPhase::CLASSIC))
     {
@@ -2251,6 +2523,7 @@ HerderImpl::updateTransactionQueue(TxSetXDRFrameConstPtr externalizedTxSet)
         updateQueue(*mSorobanTransactionQueue,
                     txsPerPhase[static_cast<size_t>(TxSetPhase::SOROBAN)]);
     }
+    scheduleTxSetCandidateRefresh();
 }
 
 void
@@ -2300,7 +2573,13 @@ HerderImpl::verifyEnvelope(SCPEnvelope const& envelope)
         envelope.statement.nodeID, envelope.signature,
         xdr::xdr_to_opaque(mApp.getNetworkID(), ENVELOPE_TYPE_SCP,
                            envelope.statement));
-    if (b)
+    return recordEnvelopeSignature(b);
+}
+
+bool
+HerderImpl::recordEnvelopeSignature(bool valid)
+{
+    if (valid)
     {
         mSCPMetrics.mEnvelopeValidSig.Mark();
     }
@@ -2308,8 +2587,7 @@ HerderImpl::verifyEnvelope(SCPEnvelope const& envelope)
     {
         mSCPMetrics.mEnvelopeInvalidSig.Mark();
     }
-
-    return b;
+    return valid;
 }
 void
 HerderImpl::signEnvelope(SecretKey const& s, SCPEnvelope& envelope)
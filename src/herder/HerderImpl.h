@@ -14,6 +14,7 @@
 #include "util/XDROperators.h"
 #include <deque>
 #include <memory>
+#include <optional>
 #include <vector>
 
 namespace medida
@@ -99,6 +100,8 @@ class HerderImpl : public Herder
                     bool submittedFromSelf) override;
 
     EnvelopeStatus recvSCPEnvelope(SCPEnvelope const& envelope) override;
+    EnvelopeStatus recvSCPEnvelope(SCPEnvelope const& envelope,
+                                   bool signatureValid) override;
 #ifdef BUILD_TESTS
     EnvelopeStatus recvSCPEnvelope(SCPEnvelope const& envelope,
                                    const SCPQuorumSet& qset,
@@ -227,6 +230,18 @@ class HerderImpl : public Herder
                                       std::chrono::milliseconds::zero());
 
     void setupTriggerNextLedger();
+    // How far ahead of the expected close time to trigger the next ledger,
+    // see EXPERIMENTAL_ADAPTIVE_TRIGGER_MAX_ADVANCE_MS. Updates the estimate
+    // of the nomination latency from slot lastIndex.
+    std::chrono::milliseconds computeTriggerAdvance(uint64_t lastIndex);
+    std::optional<std::chrono::milliseconds> mNominationLatencyEstimate;
+
+    // signatureValid is the result of verifying the envelope's signature if
+    // that was already done, otherwise it is verified here when needed
+    EnvelopeStatus recvSCPEnvelopeImpl(SCPEnvelope const& envelope,
+                                       std::optional<bool> signatureValid);
+    // marks the metrics for an envelope signature check and returns valid
+    bool recordEnvelopeSignature(bool valid);
 
     void startOutOfSyncTimer();
     void outOfSyncRecovery();
@@ -242,6 +257,19 @@ class HerderImpl : public Herder
     std::unique_ptr<SorobanTransactionQueue> mSorobanTransactionQueue;
 
     void updateTransactionQueue(TxSetXDRFrameConstPtr txSet);
+
+    // Builds the tx set to nominate on top of `lcl` from the queued
+    // transactions and bans the ones that are invalid. Returns the candidate
+    // instead when it was built from the same queue contents and for a close
+    // time range that includes the requested one.
+    TxSetXDRFrameConstPtr
+    makeTxSetToNominate(LedgerHeaderHistoryEntry const& lcl,
+                        TimePoint lowerBoundCloseTimeOffset,
+                        TimePoint upperBoundCloseTimeOffset);
+    // Rebuilds the candidate once EXPERIMENTAL_TX_SET_CANDIDATE_REFRESH_MS
+    // have passed, if it is enabled
+    void scheduleTxSetCandidateRefresh();
+    void refreshTxSetCandidate();
     void maybeSetupSorobanQueue(uint32_t protocolVersion);
 
     PendingEnvelopes mPendingEnvelopes;
@@ -272,6 +300,13 @@ class HerderImpl : public Herder
     void persistUpgrades();
     void restoreUpgrades();
 
+    // saves the transactions that are still queued, see
+    // EXPERIMENTAL_PERSIST_TX_QUEUE
+    void persistTransactionQueues();
+    // queues the saved transactions again that are still valid
+    void restoreTransactionQueues();
+    bool mStarted{false};
+
     // called every time we get ledger externalized
     // ensures that if we don't hear from the network, we throw the herder into
     // indeterminate mode
@@ -283,6 +318,20 @@ class HerderImpl : public Herder
 
     VirtualTimer mTxSetGarbageCollectTimer;
 
+    // Tx set built ahead of nomination, with the state it was built from
+    struct TxSetCandidate
+    {
+        Hash mPreviousLedgerHash;
+        uint64_t mClassicQueueVersion{0};
+        uint64_t mSorobanQueueVersion{0};
+        TimePoint mLowerBoundCloseTimeOffset{0};
+        TimePoint mUpperBoundCloseTimeOffset{0};
+        TxSetXDRFrameConstPtr mTxSet;
+    };
+    std::optional<TxSetCandidate> mTxSetCandidate;
+    VirtualTimer mTxSetCandidateTimer;
+    bool mTxSetCandidateRefreshPending{false};
+
     Application& mApp;
     LedgerManager& mLedgerManager;
 
@@ -12,6 +12,9 @@
 #include "util/Decoder.h"
 #include "util/XDRStream.h"
 #include <Tracy.hpp>
+#include <medida/meter.h>
+#include <medida/metrics_registry.h>
+#include <medida/timer.h>
 
 #include <optional>
 #include <soci.h>
@@ -26,7 +29,10 @@ HerderPersistence::create(Application& app)
     return std::make_unique<HerderPersistenceImpl>(app);
 }
 
-HerderPersistenceImpl::HerderPersistenceImpl(Application& app) : mApp(app)
+HerderPersistenceImpl::HerderPersistenceImpl(Application& app)
+    : mApp(app)
+    , mSaveTimer(app.getMetrics().NewTimer({"scp", "history", "save"}))
+    , mSavedRows(app.getMetrics().NewMeter({"scp", "history", "rows"}, "row"))
 {
 }
 
@@ -45,6 +51,7 @@ HerderPersistenceImpl::saveSCPHistory(uint32_t seq,
         return;
     }
 
+    auto timer = mSaveTimer.TimeScope();
     auto usedQSets = UnorderedMap<Hash, SCPQuorumSetPtr>{};
     auto& db = mApp.getDatabase();
 
@@ -108,7 +115,9 @@ HerderPersistenceImpl::saveSCPHistory(uint32_t seq,
         }
     }
 
-    // save quorum information
+    // save quorum information, replacing each node's previous qset
+    std::vector<std::string> qNodeIDs;
+    std::vector<std::string> qNodeQSetHashes;
     for (auto const& p : qmap)
     {
         auto const& nodeID = p.first;
@@ -120,107 +129,65 @@ HerderPersistenceImpl::saveSCPHistory(uint32_t seq,
         auto qSetH = xdrSha256(*(p.second.mQuorumSet));
         usedQSets.insert(std::make_pair(qSetH, p.second.mQuorumSet));
 
-        std::string nodeIDStrKey = KeyUtils::toStrKey(nodeID);
-        std::string qSetHHex(binToHex(qSetH));
-
+        qNodeIDs.emplace_back(KeyUtils::toStrKey(nodeID));
+        qNodeQSetHashes.emplace_back(binToHex(qSetH));
+    }
+    if (!qNodeIDs.empty())
+    {
         auto prep = db.getPreparedStatement(
-            "UPDATE quoruminfo SET qsethash = :h WHERE nodeid = :id");
+            "INSERT INTO quoruminfo (nodeid, qsethash) VALUES (:id, :h) "
+            "ON CONFLICT (nodeid) DO UPDATE SET qsethash = excluded.qsethash");
         auto& st = prep.statement();
-        st.exchange(soci::use(qSetHHex));
-        st.exchange(soci::use(nodeIDStrKey));
+        st.exchange(soci::use(qNodeIDs, "id"));
+        st.exchange(soci::use(qNodeQSetHashes, "h"));
         st.define_and_bind();
         {
-            ZoneNamedN(updateQsetZone, "update quoruminfo", true);
+            ZoneNamedN(upsertQsetZone, "upsert quoruminfo", true);
             st.execute(true);
         }
-        if (st.get_affected_rows() != 1)
+        if (static_cast<size_t>(st.get_affected_rows()) != qNodeIDs.size())
         {
-            auto prepI = db.getPreparedStatement(
-                "INSERT INTO quoruminfo (nodeid, qsethash) VALUES (:id, :h)");
-            auto& stI = prepI.statement();
-            stI.exchange(soci::use(nodeIDStrKey));
-            stI.exchange(soci::use(qSetHHex));
-            stI.define_and_bind();
-            {
-                ZoneNamedN(insertQsetZone, "insert quoruminfo", true);
-                stI.execute(true);
-            }
-            if (stI.get_affected_rows() != 1)
-            {
-                throw std::runtime_error("Could not update data in SQL");
-            }
+            throw std::runtime_error("Could not update data in SQL");
         }
     }
-    // save quorum sets
+
+    // save quorum sets, moving lastledgerseq of known ones forward only
+    std::vector<std::string> qSetHashes;
+    std::vector<uint32_t> qSetSeqs;
+    std::vector<std::string> qSetsEncoded;
     for (auto const& p : usedQSets)
     {
-        std::string qSetH = binToHex(p.first);
-
-        uint32_t lastSeenSeq;
-        auto prepSelQSet = db.getPreparedStatement(
-            "SELECT lastledgerseq FROM scpquorums WHERE qsethash = :h");
-        auto& stSel = prepSelQSet.statement();
-        stSel.exchange(soci::into(lastSeenSeq));
-        stSel.exchange(soci::use(qSetH));
-        stSel.define_and_bind();
-        {
-            ZoneNamedN(selectSCPQuorumsZone, "select scpquorums", true);
-            stSel.execute(true);
-        }
-
-        if (stSel.got_data())
+        qSetHashes.emplace_back(binToHex(p.first));
+        qSetSeqs.emplace_back(seq);
+        qSetsEncoded.emplace_back(
+            decoder::encode_b64(xdr::xdr_to_opaque(*p.second)));
+    }
+    if (!qSetHashes.empty())
+    {
+        auto prep = db.getPreparedStatement(
+            "INSERT INTO scpquorums (qsethash, lastledgerseq, qset) VALUES "
+            "(:h, :l, :v) ON CONFLICT (qsethash) DO UPDATE SET "
+            "lastledgerseq = excluded.lastledgerseq "
+            "WHERE scpquorums.lastledgerseq < excluded.lastledgerseq");
+        auto& st = prep.statement();
+        st.exchange(soci::use(qSetHashes, "h"));
+        st.exchange(soci::use(qSetSeqs, "l"));
+        st.exchange(soci::use(qSetsEncoded, "v"));
+        st.define_and_bind();
         {
-            if (lastSeenSeq >= seq)
-            {
-                continue;
-            }
-
-            auto prepUpQSet = db.getPreparedStatement(
-                "UPDATE scpquorums SET "
-                "lastledgerseq = :l WHERE qsethash = :h");
-
-            auto& stUp = prepUpQSet.statement();
-            stUp.exchange(soci::use(seq));
-            stUp.exchange(soci::use(qSetH));
-            stUp.define_and_bind();
-            {
-                ZoneNamedN(updateSCPQuorumsZone, "update scpquorums", true);
-                stUp.execute(true);
-            }
-            if (stUp.get_affected_rows() != 1)
-            {
-                throw std::runtime_error("Could not update data in SQL");
-            }
+            ZoneNamedN(upsertSCPQuorumsZone, "upsert scpquorums", true);
+            st.execute(true);
         }
-        else
+        // rows already at a later ledger are left alone, so fewer rows may
+        // have been affected
+        if (static_cast<size_t>(st.get_affected_rows()) > qSetHashes.size())
         {
-            auto qSetBytes(xdr::xdr_to_opaque(*p.second));
-
-            std::string qSetEncoded;
-            qSetEncoded = decoder::encode_b64(qSetBytes);
-
-            auto prepInsQSet = db.getPreparedStatement(
-                "INSERT INTO scpquorums "
-                "(qsethash, lastledgerseq, qset) VALUES "
-                "(:h, :l, :v);");
-
-            auto& stIns = prepInsQSet.statement();
-            stIns.exchange(soci::use(qSetH));
-            stIns.exchange(soci::use(seq));
-            stIns.exchange(soci::use(qSetEncoded));
-            stIns.define_and_bind();
-            {
-                ZoneNamedN(insertSCPQuorumsZone, "insert scpquorums", true);
-                stIns.execute(true);
-            }
-            if (stIns.get_affected_rows() != 1)
-            {
-                throw std::runtime_error("Could not update data in SQL");
-            }
+            throw std::runtime_error("Could not update data in SQL");
         }
     }
 
     txscope.commit();
+    mSavedRows.Mark(envs.size() + qNodeIDs.size() + qSetHashes.size());
 }
 
 size_t
@@ -407,14 +374,14 @@ HerderPersistence::createQuorumTrackingTable(soci::session& sess)
 }
 
 void
-HerderPersistence::deleteOldEntries(Database& db, uint32_t ledgerSeq,
+HerderPersistence::deleteOldEntries(soci::session& sess, uint32_t ledgerSeq,
                                     uint32_t count)
 {
     ZoneScoped;
-    DatabaseUtils::deleteOldEntriesHelper(db.getSession(), ledgerSeq, count,
-                                          "scphistory", "ledgerseq");
-    DatabaseUtils::deleteOldEntriesHelper(db.getSession(), ledgerSeq, count,
-                                          "scpquorums", "lastledgerseq");
+    DatabaseUtils::deleteOldEntriesHelper(sess, ledgerSeq, count, "scphistory",
+                                          "ledgerseq");
+    DatabaseUtils::deleteOldEntriesHelper(sess, ledgerSeq, count, "scpquorums",
+                                          "lastledgerseq");
 }
 
 void
@@ -6,6 +6,12 @@
 
 #include "herder/HerderPersistence.h"
 
+namespace medida
+{
+class Meter;
+class Timer;
+}
+
 namespace stellar
 {
 class Application;
@@ -22,5 +28,8 @@ class HerderPersistenceImpl : public HerderPersistence
 
   private:
     Application& mApp;
+
+    medida::Timer& mSaveTimer;
+    medida::Meter& mSavedRows;
 };
 }
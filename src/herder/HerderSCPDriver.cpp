@@ -17,6 +17,7 @@
 #include "overlay/SurveyManager.h"
 #include "scp/SCP.h"
 #include "scp/Slot.h"
+#include "util/FlightRecorder.h"
 #include "util/Logging.h"
 #include "util/Math.h"
 #include "util/ProtocolVersion.h"
@@ -36,6 +37,7 @@ namespace stellar
 {
 
 uint32_t const TXSETVALID_CACHE_SIZE = 1000;
+uint32_t const VALUEVALID_CACHE_SIZE = 1000;
 
 Hash
 HerderSCPDriver::getHashOf(std::vector<xdr::opaque_vec<>> const& vals) const
@@ -54,12 +56,20 @@ HerderSCPDriver::SCPMetrics::SCPMetrics(Application& app)
     , mValueValid(app.getMetrics().NewMeter({"scp", "value", "valid"}, "value"))
     , mValueInvalid(
           app.getMetrics().NewMeter({"scp", "value", "invalid"}, "value"))
+    , mValueCacheHit(
+          app.getMetrics().NewMeter({"scp", "value", "cache-hit"}, "value"))
     , mCombinedCandidates(app.getMetrics().NewMeter(
           {"scp", "nomination", "combinecandidates"}, "value"))
     , mNominateToPrepare(
           app.getMetrics().NewTimer({"scp", "timing", "nominated"}))
     , mPrepareToExternalize(
           app.getMetrics().NewTimer({"scp", "timing", "externalized"}))
+    , mNominateToCandidate(
+          app.getMetrics().NewTimer({"scp", "timing", "first-candidate"}))
+    , mPrepareToConfirm(
+          app.getMetrics().NewTimer({"scp", "timing", "confirmed-prepared"}))
+    , mConfirmToExternalize(app.getMetrics().NewTimer(
+          {"scp", "timing", "confirmed-to-externalized"}))
     , mFirstToSelfExternalizeLag(app.getMetrics().NewTimer(
           {"scp", "timing", "first-to-self-externalize-lag"}))
     , mSelfToOthersExternalizeLag(app.getMetrics().NewTimer(
@@ -86,6 +96,7 @@ HerderSCPDriver::HerderSCPDriver(Application& app, HerderImpl& herder,
           {"scp", "slot", "values-referenced"})}
     , mLedgerSeqNominating(0)
     , mTxSetValidCache(TXSETVALID_CACHE_SIZE)
+    , mValueValidCache(VALUEVALID_CACHE_SIZE)
 {
 }
 
@@ -343,6 +354,20 @@ HerderSCPDriver::validateValue(uint64_t slotIndex, Value const& value,
                                bool nomination)
 {
     ZoneScoped;
+    auto const& lclHash = mLedgerManager.getLastClosedLedgerHeader().hash;
+    if (mValueValidCacheLCL != lclHash)
+    {
+        mValueValidCache.clear();
+        mValueValidCacheLCL = lclHash;
+    }
+    auto cacheKey = ValueValidityKey{slotIndex, sha256(value), nomination};
+    if (mValueValidCache.exists(cacheKey))
+    {
+        mSCPMetrics.mValueCacheHit.Mark();
+        mSCPMetrics.mValueValid.Mark();
+        return SCPDriver::kFullyValidatedValue;
+    }
+
     StellarValue b;
     try
     {
@@ -390,6 +415,16 @@ HerderSCPDriver::validateValue(uint64_t slotIndex, Value const& value,
         }
     }
 
+    // Only full validity is cached: other results can change for the same
+    // LCL, as the tx set is fetched or the clock reaches the close time. Nor
+    // are nominated upgrades, whose validity depends on the upgrade
+    // parameters and time.
+    if (res == SCPDriver::kFullyValidatedValue &&
+        !(nomination && !b.upgrades.empty()))
+    {
+        mValueValidCache.put(cacheKey, true);
+    }
+
     if (res)
     {
         mSCPMetrics.mValueValid.Mark();
@@ -764,6 +799,8 @@ void
 HerderSCPDriver::valueExternalized(uint64_t slotIndex, Value const& value)
 {
     ZoneScoped;
+    mApp.getFlightRecorder().instant("externalize", "scp",
+                                     static_cast<uint32_t>(slotIndex));
     auto it = mSCPTimers.begin(); // cancel all timers below this slot
     while (it != mSCPTimers.end() && it->first <= slotIndex)
     {
@@ -824,6 +861,7 @@ HerderSCPDriver::valueExternalized(uint64_t slotIndex, Value const& value)
 
         // record lag
         recordSCPExternalizeEvent(slotIndex, mSCP.getLocalNodeID(), false);
+        recordSCPPhase(mSCPExecutionTimes[slotIndex].mExternalize);
 
         recordSCPExecutionMetrics(slotIndex);
 
@@ -876,6 +914,8 @@ HerderSCPDriver::nominate(uint64_t slotIndex, StellarValue const& value,
                           StellarValue const& previousValue)
 {
     ZoneScoped;
+    mApp.getFlightRecorder().instant("nominate", "scp",
+                                     static_cast<uint32_t>(slotIndex));
     mCurrentValue = wrapStellarValue(value);
     mLedgerSeqNominating = static_cast<uint32_t>(slotIndex);
 
@@ -912,29 +952,80 @@ HerderSCPDriver::nominatingValue(uint64_t slotIndex, Value const& value)
 void
 HerderSCPDriver::updatedCandidateValue(uint64_t slotIndex, Value const& value)
 {
+    mApp.getFlightRecorder().instant("candidate", "scp",
+                                     static_cast<uint32_t>(slotIndex));
+    recordSCPPhase(mSCPExecutionTimes[slotIndex].mFirstCandidate);
 }
 
 void
 HerderSCPDriver::startedBallotProtocol(uint64_t slotIndex,
                                        SCPBallot const& ballot)
 {
+    mApp.getFlightRecorder().instant("ballot start", "scp",
+                                     static_cast<uint32_t>(slotIndex));
     recordSCPEvent(slotIndex, false);
+    recordSCPPhase(mSCPExecutionTimes[slotIndex].mBallotStart);
+    startSpeculativeTxSetPreparation(slotIndex, ballot.value);
 }
 void
 HerderSCPDriver::acceptedBallotPrepared(uint64_t slotIndex,
                                         SCPBallot const& ballot)
 {
+    startSpeculativeTxSetPreparation(slotIndex, ballot.value);
+}
+
+void
+HerderSCPDriver::startSpeculativeTxSetPreparation(uint64_t slotIndex,
+                                                  Value const& value)
+{
+    if (!mApp.getConfig().EXPERIMENTAL_SPECULATIVE_TX_SET_PREPARATION ||
+        slotIndex != mLedgerManager.getLastClosedLedgerNum() + 1)
+    {
+        return;
+    }
+
+    StellarValue sv;
+    if (toStellarValue(value, sv))
+    {
+        if (auto txSet = mPendingEnvelopes.getTxSet(sv.txSetHash))
+        {
+            mLedgerManager.startSpeculativeTxSetPreparation(txSet);
+        }
+    }
 }
 
 void
 HerderSCPDriver::confirmedBallotPrepared(uint64_t slotIndex,
                                          SCPBallot const& ballot)
 {
+    mApp.getFlightRecorder().instant("confirm prepared", "scp",
+                                     static_cast<uint32_t>(slotIndex));
+    recordSCPPhase(mSCPExecutionTimes[slotIndex].mConfirmPrepared);
+
+    // Once a ballot is confirmed prepared its value is very likely to be
+    // externalized, so start loading what its tx set needs for apply
+    if (!mApp.getConfig().EXPERIMENTAL_LOOKAHEAD_PREFETCH ||
+        slotIndex != mLedgerManager.getLastClosedLedgerNum() + 1)
+    {
+        return;
+    }
+
+    StellarValue sv;
+    if (toStellarValue(ballot.value, sv))
+    {
+        if (auto txSet = mPendingEnvelopes.getTxSet(sv.txSetHash))
+        {
+            mLedgerManager.startLookaheadPrefetch(txSet);
+        }
+    }
 }
 
 void
 HerderSCPDriver::acceptedCommit(uint64_t slotIndex, SCPBallot const& ballot)
 {
+    mApp.getFlightRecorder().instant("accept commit", "scp",
+                                     static_cast<uint32_t>(slotIndex));
+    recordSCPPhase(mSCPExecutionTimes[slotIndex].mAcceptCommit);
 }
 
 std::optional<VirtualClock::time_point>
@@ -949,6 +1040,18 @@ HerderSCPDriver::getPrepareStart(uint64_t slotIndex)
     return res;
 }
 
+std::optional<VirtualClock::time_point>
+HerderSCPDriver::getNominationStart(uint64_t slotIndex)
+{
+    std::optional<VirtualClock::time_point> res;
+    auto it = mSCPExecutionTimes.find(slotIndex);
+    if (it != mSCPExecutionTimes.end())
+    {
+        res = it->second.mNominationStart;
+    }
+    return res;
+}
+
 Json::Value
 HerderSCPDriver::getQsetLagInfo(bool summary, bool fullKeys)
 {
@@ -1015,6 +1118,80 @@ HerderSCPDriver::recordSCPEvent(uint64_t slotIndex, bool isNomination)
     }
 }
 
+void
+HerderSCPDriver::setProcessingEnvelopeFrom(std::optional<NodeID> sender)
+{
+    mProcessingEnvelopeFrom = std::move(sender);
+}
+
+void
+HerderSCPDriver::recordSCPPhase(std::optional<SCPPhase>& phase)
+{
+    if (!phase)
+    {
+        phase = SCPPhase{mApp.getClock().now(), mProcessingEnvelopeFrom};
+    }
+}
+
+Json::Value
+HerderSCPDriver::getJsonPhaseInfo(size_t limit, bool fullKeys) const
+{
+    Json::Value ret(Json::objectValue);
+    auto it = mSCPExecutionTimes.rbegin();
+    for (; it != mSCPExecutionTimes.rend() && limit-- != 0; ++it)
+    {
+        auto const& timing = it->second;
+        if (!timing.mNominationStart && !timing.mFirstCandidate &&
+            !timing.mBallotStart)
+        {
+            continue;
+        }
+        // Offsets are from nomination start, or from the first phase seen
+        // when the node did not nominate for the slot
+        std::optional<VirtualClock::time_point> origin =
+            timing.mNominationStart;
+        for (auto const* p :
+             {&timing.mFirstCandidate, &timing.mBallotStart,
+              &timing.mConfirmPrepared, &timing.mAcceptCommit,
+              &timing.mExternalize})
+        {
+            if (*p && (!origin || (*p)->mWhen < *origin))
+            {
+                origin = (*p)->mWhen;
+            }
+        }
+
+        auto& slot = ret[std::to_string(it->first)];
+        slot["nominated"] = timing.mNominationStart.has_value();
+        auto addPhase = [&](char const* name,
+                            std::optional<SCPPhase> const& phase) {
+            if (!phase)
+            {
+                return;
+            }
+            auto& p = slot[name];
+            p["ms"] = static_cast<Json::Int64>(
+                std::chrono::duration_cast<std::chrono::milliseconds>(
+                    phase->mWhen - *origin)
+                    .count());
+            if (phase->mCompletedBy)
+            {
+                p["by"] = toStrKey(*phase->mCompletedBy, fullKeys);
+            }
+        };
+        addPhase("first_candidate", timing.mFirstCandidate);
+        addPhase("prepare", timing.mBallotStart);
+        addPhase("confirm_prepared", timing.mConfirmPrepared);
+        addPhase("accept_commit", timing.mAcceptCommit);
+        addPhase("externalize", timing.mExternalize);
+        slot["nomination_timeouts"] =
+            static_cast<Json::Int64>(timing.mNominationTimeoutCount);
+        slot["prepare_timeouts"] =
+            static_cast<Json::Int64>(timing.mPrepareTimeoutCount);
+    }
+    return ret;
+}
+
 void
 HerderSCPDriver::recordSCPExternalizeEvent(uint64_t slotIndex, NodeID const& id,
                                            bool forceUpdateSelf)
@@ -1154,6 +1331,28 @@ HerderSCPDriver::recordSCPExecutionMetrics(uint64_t slotIndex)
                         mSCPMetrics.mPrepareToExternalize, "Prepare", threshold,
                         slotIndex);
     }
+
+    // Same filtering for the steps in between
+    if (SCPTiming.mNominationStart && SCPTiming.mFirstCandidate)
+    {
+        recordLogTiming(*SCPTiming.mNominationStart,
+                        SCPTiming.mFirstCandidate->mWhen,
+                        mSCPMetrics.mNominateToCandidate, "First candidate",
+                        threshold, slotIndex);
+    }
+    if (SCPTiming.mPrepareStart && SCPTiming.mConfirmPrepared)
+    {
+        recordLogTiming(*SCPTiming.mPrepareStart,
+                        SCPTiming.mConfirmPrepared->mWhen,
+                        mSCPMetrics.mPrepareToConfirm, "Confirm prepared",
+                        threshold, slotIndex);
+    }
+    if (SCPTiming.mConfirmPrepared)
+    {
+        recordLogTiming(SCPTiming.mConfirmPrepared->mWhen, externalizeStart,
+                        mSCPMetrics.mConfirmToExternalize,
+                        "Confirmed to externalize", threshold, slotIndex);
+    }
 }
 
 void
@@ -1285,4 +1484,14 @@ HerderSCPDriver::TxSetValidityKeyHash::operator()(
     hashMix(res, std::get<3>(key));
     return res;
 }
+
+size_t
+HerderSCPDriver::ValueValidityKeyHash::operator()(
+    ValueValidityKey const& key) const
+{
+    size_t res = std::hash<uint64_t>()(std::get<0>(key));
+    hashMix(res, std::hash<Hash>()(std::get<1>(key)));
+    hashMix(res, std::get<2>(key));
+    return res;
+}
 }
@@ -54,6 +54,13 @@ class HerderSCPDriver : public SCPDriver
     void recordSCPExternalizeEvent(uint64_t slotIndex, NodeID const& id,
                                    bool forceUpdateSelf);
 
+    // Phases SCP reaches while processing an envelope received from `sender`
+    // are attributed to it; pass nullopt once the envelope is processed
+    void setProcessingEnvelopeFrom(std::optional<NodeID> sender);
+    // When the last `limit` slots reached each phase, relative to nomination
+    // start, and which validator's envelope got them there
+    Json::Value getJsonPhaseInfo(size_t limit, bool fullKeys) const;
+
     // envelope handling
     SCPEnvelopeWrapperPtr wrapEnvelope(SCPEnvelope const& envelope) override;
     void signEnvelope(SCPEnvelope& envelope) override;
@@ -108,6 +115,8 @@ class HerderSCPDriver : public SCPDriver
     void acceptedCommit(uint64_t slotIndex, SCPBallot const& ballot) override;
 
     std::optional<VirtualClock::time_point> getPrepareStart(uint64_t slotIndex);
+    std::optional<VirtualClock::time_point>
+    getNominationStart(uint64_t slotIndex);
 
     // converts a Value into a StellarValue
     // returns false on error
@@ -143,6 +152,7 @@ class HerderSCPDriver : public SCPDriver
 
         medida::Meter& mValueValid;
         medida::Meter& mValueInvalid;
+        medida::Meter& mValueCacheHit;
 
         // listeners
         medida::Meter& mCombinedCandidates;
@@ -150,6 +160,10 @@ class HerderSCPDriver : public SCPDriver
         // Timers for nomination and ballot protocols
         medida::Timer& mNominateToPrepare;
         medida::Timer& mPrepareToExternalize;
+        // Finer grained steps of the above
+        medida::Timer& mNominateToCandidate;
+        medida::Timer& mPrepareToConfirm;
+        medida::Timer& mConfirmToExternalize;
 
         // Timers tracking externalize messages
         medida::Timer& mFirstToSelfExternalizeLag;
@@ -170,11 +184,26 @@ class HerderSCPDriver : public SCPDriver
     // Externalize lag tracking for nodes in qset
     UnorderedMap<NodeID, medida::Timer> mQSetLag;
 
+    // When a slot first reached a phase, and the validator whose envelope
+    // completed the quorum threshold for it (none for the local node's own
+    // actions, like timeouts and nominating)
+    struct SCPPhase
+    {
+        VirtualClock::time_point mWhen;
+        std::optional<NodeID> mCompletedBy;
+    };
+
     struct SCPTiming
     {
         std::optional<VirtualClock::time_point> mNominationStart;
         std::optional<VirtualClock::time_point> mPrepareStart;
 
+        std::optional<SCPPhase> mFirstCandidate;
+        std::optional<SCPPhase> mBallotStart;
+        std::optional<SCPPhase> mConfirmPrepared;
+        std::optional<SCPPhase> mAcceptCommit;
+        std::optional<SCPPhase> mExternalize;
+
         // Nomination timeouts before first prepare
         int64_t mNominationTimeoutCount{0};
         // Prepare timeouts before externalize
@@ -190,6 +219,10 @@ class HerderSCPDriver : public SCPDriver
     // * first prepare to externalize
     std::map<uint64_t, SCPTiming> mSCPExecutionTimes;
 
+    // sender of the envelope SCP is processing, if any
+    std::optional<NodeID> mProcessingEnvelopeFrom;
+    void recordSCPPhase(std::optional<SCPPhase>& phase);
+
     uint32_t mLedgerSeqNominating;
     ValueWrapperPtr mCurrentValue;
 
@@ -209,12 +242,32 @@ class HerderSCPDriver : public SCPDriver
     mutable RandomEvictionCache<TxSetValidityKey, bool, TxSetValidityKeyHash>
         mTxSetValidCache;
 
+    // For caching the values found fully valid for the next ledger, as the
+    // same value comes back in the nominations and ballots of every
+    // validator. Consist of {slotIndex, value hash, nomination}; the cache is
+    // cleared whenever the LCL (mValueValidCacheLCL) changes.
+    using ValueValidityKey = std::tuple<uint64_t, Hash, bool>;
+
+    class ValueValidityKeyHash
+    {
+      public:
+        size_t operator()(ValueValidityKey const& key) const;
+    };
+    RandomEvictionCache<ValueValidityKey, bool, ValueValidityKeyHash>
+        mValueValidCache;
+    Hash mValueValidCacheLCL;
+
     SCPDriver::ValidationLevel validateValueHelper(uint64_t slotIndex,
                                                    StellarValue const& sv,
                                                    bool nomination) const;
 
     void logQuorumInformationAndUpdateMetrics(uint64_t index);
 
+    // Passes the tx set of value to LedgerManager to be prepared for apply
+    // ahead of externalization, if it is for the next ledger
+    void startSpeculativeTxSetPreparation(uint64_t slotIndex,
+                                          Value const& value);
+
     void clearSCPExecutionEvents();
 
     void timerCallbackWrapper(uint64_t slotIndex, int timerID,
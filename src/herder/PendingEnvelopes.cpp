@@ -36,6 +36,9 @@ PendingEnvelopes::PendingEnvelopes(Application& app, HerderImpl& herder)
     , mValueSizeCache(TXSET_CACHE_SIZE + QSET_CACHE_SIZE)
     , mRebuildQuorum(true)
     , mQuorumTracker(mApp.getConfig().NODE_SEED.getPublicKey())
+    , mMemoryLimit(static_cast<size_t>(
+                       mApp.getConfig().PENDING_ENVELOPES_MEMORY_LIMIT_MB) *
+                   1024 * 1024)
     , mProcessedCount(
           app.getMetrics().NewCounter({"scp", "pending", "processed"}))
     , mDiscardedCount(
@@ -46,7 +49,18 @@ PendingEnvelopes::PendingEnvelopes(Application& app, HerderImpl& herder)
     , mFetchDuration(app.getMetrics().NewTimer({"scp", "fetch", "envelope"}))
     , mFetchTxSetTimer(app.getMetrics().NewTimer({"overlay", "fetch", "txset"}))
     , mFetchQsetTimer(app.getMetrics().NewTimer({"overlay", "fetch", "qset"}))
+    , mFetchedTxSetTxs(app.getMetrics().NewMeter(
+          {"overlay", "fetch", "txset-tx"}, "transaction"))
+    , mFetchedTxSetKnownTxs(app.getMetrics().NewMeter(
+          {"overlay", "fetch", "txset-known-tx"}, "transaction"))
+    , mFetchedTxSetBytes(app.getMetrics().NewMeter(
+          {"overlay", "fetch", "txset-tx-byte"}, "byte"))
+    , mFetchedTxSetKnownBytes(app.getMetrics().NewMeter(
+          {"overlay", "fetch", "txset-known-tx-byte"}, "byte"))
     , mCostPerSlot(app.getMetrics().NewHistogram({"scp", "cost", "per-slot"}))
+    , mHeldBytes(app.getMetrics().NewCounter({"scp", "pending", "held-bytes"}))
+    , mEvictedSlots(
+          app.getMetrics().NewMeter({"scp", "pending", "evicted-slot"}, "slot"))
 {
 }
 
@@ -178,6 +192,136 @@ PendingEnvelopes::updateMetrics()
     mDiscardedCount.set_count(discarded);
     mFetchingCount.set_count(fetching);
     mReadyCount.set_count(ready);
+    mHeldBytes.set_count(static_cast<int64>(getEnvelopeBytes() + mTxSetBytes));
+}
+
+size_t
+PendingEnvelopes::getEnvelopeBytes() const
+{
+    size_t res = 0;
+    for (auto const& s : mEnvelopes)
+    {
+        res += s.second.mEnvelopeBytes;
+    }
+    return res;
+}
+
+void
+PendingEnvelopes::scheduleMemoryLimitCheck(bool txSetAdded)
+{
+    if (mMemoryLimit == 0 || mMemoryLimitCheckScheduled)
+    {
+        return;
+    }
+    if (!txSetAdded && getEnvelopeBytes() + mTxSetBytes <= mMemoryLimit)
+    {
+        return;
+    }
+    // evicting touches the fetchers, so like stopFetchingBelow only do it
+    // from the top of the stack
+    mMemoryLimitCheckScheduled = true;
+    mApp.postOnMainThread(
+        [this]() {
+            mMemoryLimitCheckScheduled = false;
+            enforceMemoryLimit();
+        },
+        "PendingEnvelopes: enforceMemoryLimit");
+}
+
+void
+PendingEnvelopes::enforceMemoryLimit()
+{
+    ZoneScoped;
+    if (mMemoryLimit == 0)
+    {
+        return;
+    }
+
+    // Tx sets count towards the last slot they were seen in
+    std::map<uint64, size_t> txSetBytes;
+    size_t total = 0;
+    mTxSetCache.for_each([&](TxSetFramCacheItem const& i) {
+        auto size = i.second->encodedSize();
+        txSetBytes[i.first] += size;
+        total += size;
+    });
+    mTxSetBytes = total;
+    std::map<uint64, size_t> heldBytes;
+    for (auto const& s : mEnvelopes)
+    {
+        heldBytes[s.first] += s.second.mEnvelopeBytes;
+        total += s.second.mEnvelopeBytes;
+    }
+    for (auto const& s : txSetBytes)
+    {
+        heldBytes[s.first] += s.second;
+    }
+
+    // Consensus works on the next ledger when tracking; otherwise the newest
+    // slot is the one most likely to get us back in sync. The checkpoint
+    // slot is kept for early catchup, and 0 holds data of unknown slot.
+    uint64 reference = 0;
+    if (mHerder.isTracking())
+    {
+        reference = mHerder.nextConsensusLedgerIndex();
+    }
+    else if (!heldBytes.empty())
+    {
+        reference = heldBytes.rbegin()->first;
+    }
+    uint64 checkpoint = mHerder.getMostRecentCheckpointSeq();
+    while (total > mMemoryLimit)
+    {
+        std::optional<uint64> victim;
+        uint64 victimDistance = 0;
+        for (auto const& s : heldBytes)
+        {
+            if (s.first == reference || s.first == checkpoint || s.first == 0)
+            {
+                continue;
+            }
+            auto distance = s.first > reference ? s.first - reference
+                                                : reference - s.first;
+            // on ties, older slots go first
+            if (!victim || distance > victimDistance)
+            {
+                victim = s.first;
+                victimDistance = distance;
+            }
+        }
+        if (!victim)
+        {
+            break;
+        }
+        CLOG_INFO(Herder,
+                  "Dropping pending SCP state for slot {} ({} bytes) to stay "
+                  "under PENDING_ENVELOPES_MEMORY_LIMIT_MB",
+                  *victim, heldBytes[*victim]);
+        total -= heldBytes[*victim];
+        mTxSetBytes -= txSetBytes[*victim];
+        heldBytes.erase(*victim);
+        evictSlot(*victim);
+    }
+
+    cleanKnownData();
+    updateMetrics();
+}
+
+void
+PendingEnvelopes::evictSlot(uint64 slotIndex)
+{
+    auto it = mEnvelopes.find(slotIndex);
+    if (it != mEnvelopes.end())
+    {
+        for (auto const& env : it->second.mFetchingEnvelopes)
+        {
+            stopFetch(env.second.mEnvelope);
+        }
+        mEnvelopes.erase(it);
+    }
+    mTxSetCache.erase_if(
+        [&](TxSetFramCacheItem const& i) { return i.first == slotIndex; });
+    mEvictedSlots.Mark();
 }
 
 TxSetXDRFrameConstPtr
@@ -235,6 +379,7 @@ PendingEnvelopes::addTxSet(Hash const& hash, uint64 lastSeenSlotIndex,
 
     putTxSet(hash, lastSeenSlotIndex, txset);
     mTxSetFetcher.recv(hash, mFetchTxSetTimer);
+    scheduleMemoryLimitCheck(true);
 }
 
 bool
@@ -249,10 +394,35 @@ PendingEnvelopes::recvTxSet(Hash const& hash, TxSetXDRFrameConstPtr txset)
         return false;
     }
 
+    recordFetchedTxSetOverlap(*txset);
     addTxSet(hash, lastSeenSlotIndex, txset);
     return true;
 }
 
+// Measures how much of a fetched txset this node already had in its
+// transaction queue. This is the part of the download a compact txset relay
+// (short ids resolved against the local queue) would save.
+void
+PendingEnvelopes::recordFetchedTxSetOverlap(TxSetXDRFrame const& txSet)
+{
+    ZoneScoped;
+    auto phases = txSet.createTransactionFrames(mApp.getNetworkID());
+    for (auto const& phase : phases)
+    {
+        for (auto const& tx : phase)
+        {
+            auto size = xdr::xdr_size(tx->getEnvelope());
+            mFetchedTxSetTxs.Mark();
+            mFetchedTxSetBytes.Mark(size);
+            if (mHerder.getTx(tx->getFullHash()))
+            {
+                mFetchedTxSetKnownTxs.Mark();
+                mFetchedTxSetKnownBytes.Mark(size);
+            }
+        }
+    }
+}
+
 bool
 PendingEnvelopes::isNodeDefinitelyInQuorum(NodeID const& node)
 {
@@ -308,28 +478,31 @@ PendingEnvelopes::recvSCPEnvelope(SCPEnvelope const& envelope)
 
     try
     {
-        if (isDiscarded(envelope))
+        auto envHash = xdrSha256(envelope);
+        auto slotIndex = envelope.statement.slotIndex;
+        if (isDiscarded(slotIndex, envHash))
         {
             return Herder::ENVELOPE_STATUS_DISCARDED;
         }
 
         touchFetchCache(envelope);
 
-        auto& envs = mEnvelopes[envelope.statement.slotIndex];
-        auto& fetching = envs.mFetchingEnvelopes;
-        auto& processed = envs.mProcessedEnvelopes;
+        auto& envs = mEnvelopes[slotIndex];
+        VirtualClock::time_point startedAt;
 
-        auto fetchIt = fetching.find(envelope);
-
-        if (fetchIt == fetching.end())
+        auto fetchIt = envs.mFetchingEnvelopes.find(envHash);
+        if (fetchIt == envs.mFetchingEnvelopes.end())
         { // we aren't fetching this envelope
-            if (processed.find(envelope) == processed.end())
+            if (!envs.mProcessedEnvelopes.contains(envHash))
             { // we haven't seen this envelope before
                 // insert it into the fetching set
-                fetchIt =
-                    fetching.emplace(envelope, mApp.getClock().now()).first;
+                startedAt = mApp.getClock().now();
+                envs.mFetchingEnvelopes.emplace(
+                    envHash, FetchingEnvelope{envelope, startedAt});
+                envs.mEnvelopeBytes += xdr::xdr_argpack_size(envelope);
                 startFetch(envelope);
                 updateMetrics();
+                scheduleMemoryLimitCheck(false);
             }
             else
             {
@@ -337,28 +510,32 @@ PendingEnvelopes::recvSCPEnvelope(SCPEnvelope const& envelope)
                 return Herder::ENVELOPE_STATUS_PROCESSED;
             }
         }
+        else
+        {
+            startedAt = fetchIt->second.mStartedAt;
+        }
 
         // we are fetching this envelope
         // check if we are done fetching it
         if (isFullyFetched(envelope))
         {
             std::chrono::nanoseconds durationNano =
-                mApp.getClock().now() - fetchIt->second;
+                mApp.getClock().now() - startedAt;
             mFetchDuration.Update(durationNano);
             Hash h = Slot::getCompanionQuorumSetHashFromStatement(
                 envelope.statement);
             CLOG_TRACE(Perf,
                        "Herder fetched for envelope {} with txsets {} and "
                        "qset {} in {} seconds",
-                       hexAbbrev(xdrSha256(envelope)), txSetsToStr(envelope),
+                       hexAbbrev(envHash), txSetsToStr(envelope),
                        hexAbbrev(h),
                        std::chrono::duration<double>(durationNano).count());
 
             // move the item from fetching to processed
-            processed.emplace(envelope);
-            fetching.erase(fetchIt);
+            envs.mProcessedEnvelopes.insert(envHash);
+            envs.mFetchingEnvelopes.erase(envHash);
 
-            envelopeReady(envelope);
+            envelopeReady(envelope, envHash);
             updateMetrics();
             return Herder::ENVELOPE_STATUS_READY;
         }
@@ -385,16 +562,17 @@ PendingEnvelopes::discardSCPEnvelope(SCPEnvelope const& envelope)
 {
     try
     {
+        auto envHash = xdrSha256(envelope);
         auto& envs = mEnvelopes[envelope.statement.slotIndex];
-        auto& discardedSet = envs.mDiscardedEnvelopes;
-        auto r = discardedSet.insert(envelope);
-
-        if (!r.second)
+        if (!envs.mDiscardedEnvelopes.insert(envHash))
         {
             return;
         }
 
-        envs.mFetchingEnvelopes.erase(envelope);
+        if (envs.mFetchingEnvelopes.erase(envHash) != 0)
+        {
+            envs.mEnvelopeBytes -= xdr::xdr_argpack_size(envelope);
+        }
 
         stopFetch(envelope);
     }
@@ -409,17 +587,14 @@ PendingEnvelopes::discardSCPEnvelope(SCPEnvelope const& envelope)
 }
 
 bool
-PendingEnvelopes::isDiscarded(SCPEnvelope const& envelope) const
+PendingEnvelopes::isDiscarded(uint64 slotIndex, Hash const& envHash) const
 {
-    auto envelopes = mEnvelopes.find(envelope.statement.slotIndex);
+    auto envelopes = mEnvelopes.find(slotIndex);
     if (envelopes == mEnvelopes.end())
     {
         return false;
     }
-
-    auto& discardedSet = envelopes->second.mDiscardedEnvelopes;
-    auto discarded = discardedSet.find(envelope);
-    return discarded != discardedSet.end();
+    return envelopes->second.mDiscardedEnvelopes.contains(envHash);
 }
 
 void
@@ -458,6 +633,13 @@ PendingEnvelopes::clearQSetCache()
     mQsetCache.clear();
     mKnownQSets.clear();
 }
+
+void
+PendingEnvelopes::setMemoryLimitForTesting(size_t bytes)
+{
+    mMemoryLimit = bytes;
+    enforceMemoryLimit();
+}
 #endif
 
 void
@@ -526,12 +708,12 @@ PendingEnvelopes::recordReceivedCost(SCPEnvelope const& env)
 }
 
 void
-PendingEnvelopes::envelopeReady(SCPEnvelope const& envelope)
+PendingEnvelopes::envelopeReady(SCPEnvelope const& envelope,
+                                Hash const& envHash)
 {
     ZoneScoped;
     auto slot = envelope.statement.slotIndex;
-    CLOG_TRACE(Herder, "Envelope ready {} i:{} t:{}",
-               hexAbbrev(xdrSha256(envelope)), slot,
+    CLOG_TRACE(Herder, "Envelope ready {} i:{} t:{}", hexAbbrev(envHash), slot,
                envelope.statement.pledges.type());
 
     // envelope has been fetched completely, but SCP has not done
@@ -636,6 +818,8 @@ PendingEnvelopes::pop(uint64 slotIndex)
         {
             auto ret = v.back();
             v.pop_back();
+            it->second.mEnvelopeBytes -=
+                xdr::xdr_argpack_size(ret->getEnvelope());
 
             updateMetrics();
             return ret;
@@ -708,7 +892,7 @@ PendingEnvelopes::stopAllBelow(uint64 slotIndex, uint64 slotToKeep)
         auto& envs = it->second;
         for (auto const& env : envs.mFetchingEnvelopes)
         {
-            recordReceivedCost(env.first);
+            recordReceivedCost(env.second.mEnvelope);
         }
     }
     mTxSetFetcher.stopFetchingBelow(slotIndex, slotToKeep);
@@ -772,7 +956,7 @@ PendingEnvelopes::getJsonInfo(size_t limit)
                 Json::Value& slot = ret[std::to_string(it->first)]["fetching"];
                 for (auto const& kv : it->second.mFetchingEnvelopes)
                 {
-                    slot.append(scp.envToStr(kv.first));
+                    slot.append(scp.envToStr(kv.second.mEnvelope));
                 }
             }
             if (it->second.mReadyEnvelopes.size() != 0)
@@ -5,6 +5,7 @@
 #include "lib/json/json.h"
 #include "overlay/ItemFetcher.h"
 #include "util/RandomEvictionCache.h"
+#include "util/TxHashIndex.h"
 #include <autocheck/function.hpp>
 #include <chrono>
 #include <map>
@@ -23,18 +24,31 @@ namespace stellar
 
 class HerderImpl;
 
+struct FetchingEnvelope
+{
+    SCPEnvelope mEnvelope;
+    VirtualClock::time_point mStartedAt;
+};
+
+// Envelopes are tracked by their hash: only envelopes still being fetched
+// have a copy here. Once ready, an envelope lives on in the single wrapper
+// handed to SCP, which the slot's statement history shares.
 struct SlotEnvelopes
 {
-    // envelopes we have discarded
-    std::set<SCPEnvelope> mDiscardedEnvelopes;
-    // envelopes we have processed already
-    std::set<SCPEnvelope> mProcessedEnvelopes;
+    // hashes of envelopes we have discarded
+    TxHashSet mDiscardedEnvelopes;
+    // hashes of envelopes we have processed already
+    TxHashSet mProcessedEnvelopes;
     // envelopes we are fetching right now
-    std::map<SCPEnvelope, VirtualClock::time_point> mFetchingEnvelopes;
+    TxHashMap<FetchingEnvelope> mFetchingEnvelopes;
 
     // list of ready envelopes that haven't been sent to SCP yet
     std::vector<SCPEnvelopeWrapperPtr> mReadyEnvelopes;
 
+    // encoded size of the envelopes in mFetchingEnvelopes and
+    // mReadyEnvelopes
+    size_t mEnvelopeBytes{0};
+
     // track cost per validator in local qset
     // cost includes sizes of:
     //   * envelopes
@@ -72,6 +86,12 @@ class PendingEnvelopes
     bool mRebuildQuorum;
     QuorumTracker mQuorumTracker;
 
+    // PENDING_ENVELOPES_MEMORY_LIMIT_MB in bytes, 0 if there is no limit
+    size_t mMemoryLimit;
+    // tx set bytes in mTxSetCache as of the last enforceMemoryLimit
+    size_t mTxSetBytes{0};
+    bool mMemoryLimitCheckScheduled{false};
+
     medida::Counter& mProcessedCount;
     medida::Counter& mDiscardedCount;
     medida::Counter& mFetchingCount;
@@ -79,8 +99,16 @@ class PendingEnvelopes
     medida::Timer& mFetchDuration;
     medida::Timer& mFetchTxSetTimer;
     medida::Timer& mFetchQsetTimer;
+    // Transactions (and their bytes) in fetched txsets, and how many of them
+    // were already in the transaction queue when the txset arrived
+    medida::Meter& mFetchedTxSetTxs;
+    medida::Meter& mFetchedTxSetKnownTxs;
+    medida::Meter& mFetchedTxSetBytes;
+    medida::Meter& mFetchedTxSetKnownBytes;
     // Tracked cost per slot
     medida::Histogram& mCostPerSlot;
+    medida::Counter& mHeldBytes;
+    medida::Meter& mEvictedSlots;
 
     // discards all SCP envelopes that use QSet with a given hash,
     // as it is not sane QSet
@@ -88,13 +116,24 @@ class PendingEnvelopes
 
     void updateMetrics();
 
-    void envelopeReady(SCPEnvelope const& envelope);
+    size_t getEnvelopeBytes() const;
+    // Schedules enforceMemoryLimit from the top of the stack if the memory
+    // held may be over the limit: when a tx set was just added, or when the
+    // envelopes alone would put the last tx set estimate over it
+    void scheduleMemoryLimitCheck(bool txSetAdded);
+    // Drops whole slots, furthest from the slot consensus works on first,
+    // until the envelopes and tx sets held fit in mMemoryLimit
+    void enforceMemoryLimit();
+    void evictSlot(uint64 slotIndex);
+    void recordFetchedTxSetOverlap(TxSetXDRFrame const& txSet);
+
+    void envelopeReady(SCPEnvelope const& envelope, Hash const& envHash);
     void discardSCPEnvelope(SCPEnvelope const& envelope);
     bool isFullyFetched(SCPEnvelope const& envelope);
     void startFetch(SCPEnvelope const& envelope);
     void stopFetch(SCPEnvelope const& envelope);
     void touchFetchCache(SCPEnvelope const& envelope);
-    bool isDiscarded(SCPEnvelope const& envelope) const;
+    bool isDiscarded(uint64 slotIndex, Hash const& envHash) const;
 
     SCPQuorumSetPtr putQSet(Hash const& qSetHash, SCPQuorumSet const& qSet);
     // tries to find a qset in memory, setting touch also touches the LRU,
@@ -122,6 +161,8 @@ class PendingEnvelopes
 
 #ifdef BUILD_TESTS
     void clearQSetCache();
+    // sets the memory limit in bytes and enforces it right away
+    void setMemoryLimitForTesting(size_t bytes);
 #endif
 
     /**
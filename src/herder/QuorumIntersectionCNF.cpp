@@ -0,0 +1,260 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "herder/QuorumIntersectionCNF.h"
+#include "crypto/KeyUtils.h"
+#include "crypto/SHA.h"
+#include "crypto/SecretKey.h"
+#include "main/Config.h"
+#include "util/GlobalChecks.h"
+#include "util/XDROperators.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace stellar
+{
+
+namespace
+{
+// Number of subsets of size k of a set of size n, or limit + 1 if that's
+// more than limit
+size_t
+countSubsets(size_t n, size_t k, size_t limit)
+{
+    k = std::min(k, n - k);
+    size_t res = 1;
+    for (size_t i = 1; i <= k; ++i)
+    {
+        res = res * (n - k + i) / i;
+        if (res > limit)
+        {
+            return limit + 1;
+        }
+    }
+    return res;
+}
+}
+
+QuorumIntersectionCNF::QuorumIntersectionCNF(
+    QuorumIntersectionChecker::QuorumSetMap const& qmap)
+{
+    for (auto const& p : qmap)
+    {
+        if (p.second)
+        {
+            mNodes.emplace_back(p.first);
+        }
+    }
+    std::sort(mNodes.begin(), mNodes.end());
+    for (size_t i = 0; i < mNodes.size(); ++i)
+    {
+        mNodeIndexes.emplace(mNodes[i], i);
+    }
+    mNextVariable = static_cast<Literal>(2 * mNodes.size() + 1);
+
+    for (size_t copy = 0; copy < 2; ++copy)
+    {
+        for (size_t i = 0; i < mNodes.size(); ++i)
+        {
+            encodeQSet(getNodeVariable(i, copy), *qmap.at(mNodes[i]), copy);
+        }
+    }
+
+    Clause nonEmpty[2];
+    for (size_t i = 0; i < mNodes.size(); ++i)
+    {
+        auto a = getNodeVariable(i, 0);
+        auto b = getNodeVariable(i, 1);
+        mClauses.emplace_back(Clause{-a, -b});
+        nonEmpty[0].emplace_back(a);
+        nonEmpty[1].emplace_back(b);
+    }
+    mClauses.emplace_back(std::move(nonEmpty[0]));
+    mClauses.emplace_back(std::move(nonEmpty[1]));
+}
+
+QuorumIntersectionCNF::Literal
+QuorumIntersectionCNF::getNodeVariable(size_t node, size_t copy) const
+{
+    releaseAssert(node < mNodes.size() && copy < 2);
+    return static_cast<Literal>(copy * mNodes.size() + node + 1);
+}
+
+QuorumIntersectionCNF::Literal
+QuorumIntersectionCNF::newVariable()
+{
+    return mNextVariable++;
+}
+
+void
+QuorumIntersectionCNF::encodeQSet(Literal cond, SCPQuorumSet const& qset,
+                                  size_t copy)
+{
+    std::vector<Literal> literals;
+    for (auto const& v : qset.validators)
+    {
+        // Validators without a qset can't be in a quorum
+        auto it = mNodeIndexes.find(v);
+        if (it != mNodeIndexes.end())
+        {
+            literals.emplace_back(getNodeVariable(it->second, copy));
+        }
+    }
+    for (auto const& inner : qset.innerSets)
+    {
+        literals.emplace_back(getInnerSetVariable(inner, copy));
+    }
+    encodeAtLeast(cond, literals, qset.threshold);
+}
+
+QuorumIntersectionCNF::Literal
+QuorumIntersectionCNF::getInnerSetVariable(SCPQuorumSet const& qset,
+                                           size_t copy)
+{
+    auto hash = xdrSha256(qset);
+    auto it = mInnerSets[copy].find(hash);
+    if (it != mInnerSets[copy].end())
+    {
+        return it->second;
+    }
+    auto var = newVariable();
+    mInnerSets[copy].emplace(hash, var);
+    encodeQSet(var, qset, copy);
+    return var;
+}
+
+void
+QuorumIntersectionCNF::encodeAtLeast(Literal cond,
+                                     std::vector<Literal> const& literals,
+                                     uint32_t threshold)
+{
+    if (threshold == 0)
+    {
+        return;
+    }
+    size_t n = literals.size();
+    if (threshold > n)
+    {
+        mClauses.emplace_back(Clause{-cond});
+        return;
+    }
+
+    // At least threshold are true if and only if every subset of
+    // n - threshold + 1 literals has a true one
+    size_t m = n - threshold + 1;
+    if (countSubsets(n, m, MAX_SUBSET_CLAUSES) <= MAX_SUBSET_CLAUSES)
+    {
+        std::vector<size_t> subset(m);
+        std::iota(subset.begin(), subset.end(), 0);
+        while (true)
+        {
+            Clause c{-cond};
+            for (auto i : subset)
+            {
+                c.emplace_back(literals[i]);
+            }
+            mClauses.emplace_back(std::move(c));
+
+            // Next subset in lexicographic order
+            size_t i = m;
+            while (i > 0 && subset[i - 1] == n - m + i - 1)
+            {
+                --i;
+            }
+            if (i == 0)
+            {
+                break;
+            }
+            ++subset[i - 1];
+            for (size_t j = i; j < m; ++j)
+            {
+                subset[j] = subset[j - 1] + 1;
+            }
+        }
+        return;
+    }
+
+    // Otherwise count: counter[j][k - 1] implies that at least k of the first
+    // j literals are true, so it requires that either at least k of the
+    // first j - 1 are, or literal j is and at least k - 1 of the first j - 1
+    // are.
+    std::vector<std::vector<Literal>> counter(n + 1);
+    for (size_t j = 1; j <= n; ++j)
+    {
+        for (size_t k = 1; k <= std::min<size_t>(j, threshold); ++k)
+        {
+            counter[j].emplace_back(newVariable());
+        }
+    }
+    for (size_t j = 1; j <= n; ++j)
+    {
+        for (size_t k = 1; k <= std::min<size_t>(j, threshold); ++k)
+        {
+            auto atLeast = counter[j][k - 1];
+            Clause withLiteral{-atLeast, literals[j - 1]};
+            if (k < j)
+            {
+                withLiteral.emplace_back(counter[j - 1][k - 1]);
+            }
+            mClauses.emplace_back(std::move(withLiteral));
+            if (k > 1)
+            {
+                Clause withFewer{-atLeast, counter[j - 1][k - 2]};
+                if (k < j)
+                {
+                    withFewer.emplace_back(counter[j - 1][k - 1]);
+                }
+                mClauses.emplace_back(std::move(withFewer));
+            }
+        }
+    }
+    mClauses.emplace_back(Clause{-cond, counter[n][threshold - 1]});
+}
+
+void
+QuorumIntersectionCNF::writeDimacs(std::ostream& out,
+                                   std::optional<Config> const& cfg) const
+{
+    out << "c satisfiable if and only if there are two disjoint quorums\n";
+    for (size_t i = 0; i < mNodes.size(); ++i)
+    {
+        out << "c node " << KeyUtils::toStrKey(mNodes[i]);
+        if (cfg)
+        {
+            out << " (" << cfg->toShortString(mNodes[i]) << ")";
+        }
+        out << " A " << getNodeVariable(i, 0) << " B "
+            << getNodeVariable(i, 1) << "\n";
+    }
+    out << "p cnf " << getNumVariables() << " " << mClauses.size() << "\n";
+    for (auto const& c : mClauses)
+    {
+        for (auto l : c)
+        {
+            out << l << " ";
+        }
+        out << "0\n";
+    }
+}
+
+std::pair<std::vector<NodeID>, std::vector<NodeID>>
+QuorumIntersectionCNF::getSplit(std::vector<bool> const& model) const
+{
+    releaseAssert(model.size() > getNumVariables());
+    std::pair<std::vector<NodeID>, std::vector<NodeID>> res;
+    for (size_t i = 0; i < mNodes.size(); ++i)
+    {
+        if (model[getNodeVariable(i, 0)])
+        {
+            res.first.emplace_back(mNodes[i]);
+        }
+        if (model[getNodeVariable(i, 1)])
+        {
+            res.second.emplace_back(mNodes[i]);
+        }
+    }
+    return res;
+}
+}
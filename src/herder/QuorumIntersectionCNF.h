@@ -0,0 +1,97 @@
+#pragma once
+
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "herder/QuorumIntersectionChecker.h"
+#include "xdr/Stellar-SCP.h"
+#include "xdr/Stellar-types.h"
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+namespace stellar
+{
+
+class Config;
+
+// Encoding of "the network has two disjoint quorums" as a propositional
+// formula in conjunctive normal form, to decide with an external SAT solver
+// instead of QuorumIntersectionChecker's enumeration: the formula is
+// satisfiable exactly when the network does not enjoy quorum intersection,
+// and then every model names a pair of disjoint quorums.
+//
+// Every node with a qset has a variable in each of two copies A and B of the
+// network, true when the node is in that copy's quorum. Nodes without a qset
+// are treated as dead, like QuorumIntersectionChecker does. In each copy, a
+// node implies that its qset's threshold is met in that copy, and each
+// distinct inner qset has one more variable that implies the same for it.
+// Thresholds are written out as one clause per subset of the qset that would
+// have to be missed entirely to fall short, or as a sequential counter when
+// that takes too many clauses. Lastly, no node is in both copies and each
+// copy has at least one node.
+class QuorumIntersectionCNF
+{
+  public:
+    // As in DIMACS: variable v > 0 is the literal v, its negation -v
+    using Literal = int32_t;
+    using Clause = std::vector<Literal>;
+
+    explicit QuorumIntersectionCNF(
+        QuorumIntersectionChecker::QuorumSetMap const& qmap);
+
+    size_t
+    getNumVariables() const
+    {
+        return static_cast<size_t>(mNextVariable - 1);
+    }
+
+    std::vector<Clause> const&
+    getClauses() const
+    {
+        return mClauses;
+    }
+
+    // Writes the formula in the DIMACS CNF format, starting with comment
+    // lines giving the variable of each node in each copy. Node names come
+    // from cfg if it has a value.
+    void writeDimacs(std::ostream& out,
+                     std::optional<Config> const& cfg) const;
+
+    // The two disjoint quorums in a model of the formula, where model[v] is
+    // the value of variable v (and model[0] is unused)
+    std::pair<std::vector<NodeID>, std::vector<NodeID>>
+    getSplit(std::vector<bool> const& model) const;
+
+  private:
+    // Above this many clauses for a threshold, a counter is used instead
+    static constexpr size_t MAX_SUBSET_CLAUSES = 4096;
+
+    // Nodes with a qset, in order: the variable of nodes[i] is i + 1 in copy
+    // A and nodes.size() + i + 1 in copy B
+    std::vector<NodeID> mNodes;
+    std::map<NodeID, size_t> mNodeIndexes;
+    // Variables of the inner qsets already encoded, by copy and hash
+    std::map<Hash, Literal> mInnerSets[2];
+    Literal mNextVariable{1};
+    std::vector<Clause> mClauses;
+
+    Literal getNodeVariable(size_t node, size_t copy) const;
+    Literal newVariable();
+
+    // Adds clauses implying that, if cond is true, threshold of qset's
+    // members are in the quorum of copy
+    void encodeQSet(Literal cond, SCPQuorumSet const& qset, size_t copy);
+    // Returns the variable for a copy's inner qset, encoding it if needed
+    Literal getInnerSetVariable(SCPQuorumSet const& qset, size_t copy);
+    // Adds clauses implying that, if cond is true, at least threshold of
+    // literals are true
+    void encodeAtLeast(Literal cond, std::vector<Literal> const& literals,
+                       uint32_t threshold);
+};
+}
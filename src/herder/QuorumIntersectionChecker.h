@@ -42,6 +42,12 @@ class QuorumIntersectionChecker
         std::atomic<bool>& interruptFlag,
         stellar_default_random_engine::result_type seed);
 
+#ifdef BUILD_TESTS
+    // Checkers reuse the results of earlier checks of the same part of the
+    // network, shared process-wide. This forgets them.
+    static void clearCachedResults();
+#endif
+
     virtual ~QuorumIntersectionChecker(){};
     virtual bool networkEnjoysQuorumIntersection() const = 0;
     virtual size_t getMaxQuorumsFound() const = 0;
@@ -5,9 +5,17 @@
 #include "QuorumIntersectionCheckerImpl.h"
 #include "QuorumIntersectionChecker.h"
 
+#include "crypto/SHA.h"
 #include "util/GlobalChecks.h"
+#include "util/HashOfHash.h"
 #include "util/Logging.h"
 #include "util/Math.h"
+#include "util/XDROperators.h"
+#include "xdrpp/marshal.h"
+
+#include <algorithm>
+#include <exception>
+#include <thread>
 
 namespace
 {
@@ -61,7 +69,7 @@ size_t
 MinQuorumEnumerator::pickSplitNode(
     stellar::stellar_default_random_engine& randEngine) const
 {
-    std::vector<size_t>& inDegrees = mQic.mInDegrees;
+    std::vector<size_t>& inDegrees = mState.mInDegrees;
     inDegrees.assign(mQic.mGraph.size(), 0);
     releaseAssert(!mRemaining.empty());
     size_t maxNode = mRemaining.max();
@@ -112,12 +120,16 @@ MinQuorumEnumerator::maxCommit() const
 
 MinQuorumEnumerator::MinQuorumEnumerator(
     BitSet const& committed, BitSet const& remaining, BitSet const& scanSCC,
-    QuorumIntersectionCheckerImpl const& qic)
+    QuorumIntersectionCheckerImpl const& qic, SearchState& state,
+    std::vector<std::pair<BitSet, BitSet>>* subproblems, size_t depth)
     : mCommitted(committed)
     , mRemaining(remaining)
     , mPerimeter(committed | remaining)
     , mScanSCC(scanSCC)
     , mQic(qic)
+    , mState(state)
+    , mSubproblems(subproblems)
+    , mDepth(depth)
 {
 }
 
@@ -129,12 +141,19 @@ MinQuorumEnumerator::anyMinQuorumHasDisjointQuorum()
         throw QuorumIntersectionChecker::InterruptedException();
     }
 
-    mQic.mStats.mCallsStarted++;
+    // Another thread found a split (or failed), the overall result doesn't
+    // depend on this part of the powerset anymore.
+    if (mQic.mStopSearch)
+    {
+        return false;
+    }
+
+    mState.mStats.mCallsStarted++;
 
     // Emit a progress meter every million calls.
-    if ((mQic.mStats.mCallsStarted & 0xfffff) == 0)
+    if ((mState.mStats.mCallsStarted & 0xfffff) == 0)
     {
-        mQic.mStats.log();
+        mState.mStats.log();
     }
     if (mQic.mLogTrace)
     {
@@ -148,7 +167,7 @@ MinQuorumEnumerator::anyMinQuorumHasDisjointQuorum()
     // min-quorum they find (if they find any).
     if (mCommitted.count() > maxCommit())
     {
-        mQic.mStats.mEarlyExit1s++;
+        mState.mStats.mEarlyExit1s++;
         if (mQic.mLogTrace)
         {
             CLOG_TRACE(SCP, "early exit 1, with committed={}", mCommitted);
@@ -165,10 +184,10 @@ MinQuorumEnumerator::anyMinQuorumHasDisjointQuorum()
     {
         CLOG_TRACE(SCP, "checking for quorum in committed={}", mCommitted);
     }
-    auto committedQuorum = mQic.contractToMaximalQuorum(mCommitted);
+    auto committedQuorum = mQic.contractToMaximalQuorum(mCommitted, mState);
     if (!committedQuorum.empty())
     {
-        if (mQic.isMinimalQuorum(committedQuorum))
+        if (mQic.isMinimalQuorum(committedQuorum, mState))
         {
             // Found a min-quorum. Examine it to see if
             // there's a disjoint quorum.
@@ -177,7 +196,7 @@ MinQuorumEnumerator::anyMinQuorumHasDisjointQuorum()
                 CLOG_TRACE(SCP, "early exit 3.1: minimal quorum={}",
                            committedQuorum);
             }
-            mQic.mStats.mEarlyExit31s++;
+            mState.mStats.mEarlyExit31s++;
             return hasDisjointQuorum(committedQuorum);
         }
         if (mQic.mLogTrace)
@@ -185,7 +204,7 @@ MinQuorumEnumerator::anyMinQuorumHasDisjointQuorum()
             CLOG_TRACE(SCP, "early exit 3.2: non-minimal quorum={}",
                        committedQuorum);
         }
-        mQic.mStats.mEarlyExit32s++;
+        mState.mStats.mEarlyExit32s++;
         return false;
     }
 
@@ -196,7 +215,7 @@ MinQuorumEnumerator::anyMinQuorumHasDisjointQuorum()
     {
         CLOG_TRACE(SCP, "checking for quorum in perimeter={}", mPerimeter);
     }
-    auto extensionQuorum = mQic.contractToMaximalQuorum(mPerimeter);
+    auto extensionQuorum = mQic.contractToMaximalQuorum(mPerimeter, mState);
     if (!extensionQuorum.empty())
     {
         if (!mCommitted.isSubsetEq(extensionQuorum))
@@ -209,7 +228,7 @@ MinQuorumEnumerator::anyMinQuorumHasDisjointQuorum()
                     "does not extend committed={}",
                     extensionQuorum, mPerimeter, mCommitted);
             }
-            mQic.mStats.mEarlyExit22s++;
+            mState.mStats.mEarlyExit22s++;
             return false;
         }
     }
@@ -221,14 +240,14 @@ MinQuorumEnumerator::anyMinQuorumHasDisjointQuorum()
                        "early exit 2.1: no extension quorum in perimeter={}",
                        mPerimeter);
         }
-        mQic.mStats.mEarlyExit21s++;
+        mState.mStats.mEarlyExit21s++;
         return false;
     }
 
     // Principal termination condition: stop when remainder is empty.
     if (mRemaining.empty())
     {
-        mQic.mStats.mTerminations++;
+        mState.mStats.mTerminations++;
         if (mQic.mLogTrace)
         {
             CLOG_TRACE(SCP, "remainder exhausted");
@@ -236,16 +255,26 @@ MinQuorumEnumerator::anyMinQuorumHasDisjointQuorum()
         return false;
     }
 
+    // When splitting the search across threads, leave the rest of this
+    // branch to a worker once deep enough.
+    if (mSubproblems && mDepth == 0)
+    {
+        mSubproblems->emplace_back(mCommitted, mRemaining);
+        return false;
+    }
+    size_t childDepth = mSubproblems ? mDepth - 1 : 0;
+
     // Phase two: recurse into subproblems.
-    size_t split = pickSplitNode(mQic.mRand);
+    size_t split = pickSplitNode(mState.mRand);
     if (mQic.mLogTrace)
     {
         CLOG_TRACE(SCP, "recursing into subproblems, split={}", split);
     }
     mRemaining.unset(split);
     MinQuorumEnumerator childExcludingSplit(mCommitted, mRemaining, mScanSCC,
-                                            mQic);
-    mQic.mStats.mFirstRecursionsTaken++;
+                                            mQic, mState, mSubproblems,
+                                            childDepth);
+    mState.mStats.mFirstRecursionsTaken++;
     if (childExcludingSplit.anyMinQuorumHasDisjointQuorum())
     {
         if (mQic.mLogTrace)
@@ -257,8 +286,9 @@ MinQuorumEnumerator::anyMinQuorumHasDisjointQuorum()
     }
     mCommitted.set(split);
     MinQuorumEnumerator childIncludingSplit(mCommitted, mRemaining, mScanSCC,
-                                            mQic);
-    mQic.mStats.mSecondRecursionsTaken++;
+                                            mQic, mState, mSubproblems,
+                                            childDepth);
+    mState.mStats.mSecondRecursionsTaken++;
     return childIncludingSplit.anyMinQuorumHasDisjointQuorum();
 }
 
@@ -271,12 +301,12 @@ QuorumIntersectionCheckerImpl::QuorumIntersectionCheckerImpl(
     std::optional<Config> const& cfg, std::atomic<bool>& interruptFlag,
     stellar_default_random_engine::result_type seed, bool quiet)
     : mCfg(cfg)
+    , mState(seed)
     , mLogTrace(Logging::logTrace("SCP"))
     , mQuiet(quiet)
+    , mNumThreads(cfg ? cfg->QUORUM_INTERSECTION_CHECKER_THREADS : 1)
     , mTSC()
     , mInterruptFlag(interruptFlag)
-    , mCachedQuorums(MAX_CACHED_QUORUMS_SIZE)
-    , mRand(seed)
 {
     buildGraph(qmap);
     // Awkwardly, the graph size is zero when we initialize mTSC. Update it
@@ -293,11 +323,35 @@ QuorumIntersectionCheckerImpl::getPotentialSplit() const
 size_t
 QuorumIntersectionCheckerImpl::getMaxQuorumsFound() const
 {
-    return mStats.mMaxQuorumsSeen;
+    return mState.mStats.mMaxQuorumsSeen;
+}
+
+SearchState::SearchState(stellar_default_random_engine::result_type seed)
+    // Worker threads can't share gRandomEngine for evictions
+    : mCachedQuorums(MAX_CACHED_QUORUMS_SIZE, /* separatePRNG */ true)
+    , mRand(seed)
+{
+    mCachedQuorums.maybeSeed(static_cast<unsigned int>(seed));
+}
+
+void
+SearchStats::add(SearchStats const& other)
+{
+    mCallsStarted += other.mCallsStarted;
+    mFirstRecursionsTaken += other.mFirstRecursionsTaken;
+    mSecondRecursionsTaken += other.mSecondRecursionsTaken;
+    mMaxQuorumsSeen += other.mMaxQuorumsSeen;
+    mMinQuorumsSeen += other.mMinQuorumsSeen;
+    mTerminations += other.mTerminations;
+    mEarlyExit1s += other.mEarlyExit1s;
+    mEarlyExit21s += other.mEarlyExit21s;
+    mEarlyExit22s += other.mEarlyExit22s;
+    mEarlyExit31s += other.mEarlyExit31s;
+    mEarlyExit32s += other.mEarlyExit32s;
 }
 
 void
-QuorumIntersectionCheckerImpl::Stats::log() const
+SearchStats::log() const
 {
     CLOG_DEBUG(SCP, "Quorum intersection checker stats:");
     size_t exits = (mEarlyExit1s + mEarlyExit21s + mEarlyExit22s +
@@ -391,13 +445,14 @@ QuorumIntersectionCheckerImpl::containsQuorumSliceForNode(BitSet const& bs,
 }
 
 bool
-QuorumIntersectionCheckerImpl::isAQuorum(BitSet const& nodes) const
+QuorumIntersectionCheckerImpl::isAQuorum(BitSet const& nodes,
+                                         SearchState& state) const
 {
-    bool* pRes = mCachedQuorums.maybeGet(nodes);
+    bool* pRes = state.mCachedQuorums.maybeGet(nodes);
     if (pRes == nullptr)
     {
-        bool result = !contractToMaximalQuorum(nodes).empty();
-        mCachedQuorums.put(nodes, result);
+        bool result = !contractToMaximalQuorum(nodes, state).empty();
+        state.mCachedQuorums.put(nodes, result);
         return result;
     }
     else
@@ -407,7 +462,8 @@ QuorumIntersectionCheckerImpl::isAQuorum(BitSet const& nodes) const
 }
 
 BitSet
-QuorumIntersectionCheckerImpl::contractToMaximalQuorum(BitSet nodes) const
+QuorumIntersectionCheckerImpl::contractToMaximalQuorum(
+    BitSet nodes, SearchState& state) const
 {
     // Find greatest fixpoint of f(X) = {n ∈ X | containsQuorumSliceForNode(X,
     // n)}
@@ -444,7 +500,7 @@ QuorumIntersectionCheckerImpl::contractToMaximalQuorum(BitSet nodes) const
             }
             if (!filtered.empty())
             {
-                ++mStats.mMaxQuorumsSeen;
+                ++state.mStats.mMaxQuorumsSeen;
             }
             return filtered;
         }
@@ -453,12 +509,13 @@ QuorumIntersectionCheckerImpl::contractToMaximalQuorum(BitSet nodes) const
 }
 
 bool
-QuorumIntersectionCheckerImpl::isMinimalQuorum(BitSet const& nodes) const
+QuorumIntersectionCheckerImpl::isMinimalQuorum(BitSet const& nodes,
+                                               SearchState& state) const
 {
 #ifndef NDEBUG
     // We should only be called with a quorum, such that contracting to its
     // maximum doesn't do anything. This is a slightly expensive check.
-    releaseAssert(contractToMaximalQuorum(nodes) == nodes);
+    releaseAssert(contractToMaximalQuorum(nodes, state) == nodes);
 #endif
 
     BitSet minQ = nodes;
@@ -470,7 +527,7 @@ QuorumIntersectionCheckerImpl::isMinimalQuorum(BitSet const& nodes) const
     for (size_t i = 0; nodes.nextSet(i); ++i)
     {
         minQ.unset(i);
-        if (isAQuorum(minQ))
+        if (isAQuorum(minQ, state))
         {
             // There's a subquorum with i removed: nodes isn't a minq.
             return false;
@@ -480,7 +537,7 @@ QuorumIntersectionCheckerImpl::isMinimalQuorum(BitSet const& nodes) const
     }
     // Tried every possible one-node-less subset, found no subquorums: this one
     // is minimal.
-    mStats.mMinQuorumsSeen++;
+    state.mStats.mMinQuorumsSeen++;
     return true;
 }
 
@@ -488,6 +545,7 @@ void
 QuorumIntersectionCheckerImpl::noteFoundDisjointQuorums(
     BitSet const& nodes, BitSet const& disj) const
 {
+    std::lock_guard<std::mutex> lock(mPotentialSplitMutex);
     mPotentialSplit.first.clear();
     mPotentialSplit.second.clear();
 
@@ -515,7 +573,7 @@ QuorumIntersectionCheckerImpl::noteFoundDisjointQuorums(
 bool
 MinQuorumEnumerator::hasDisjointQuorum(BitSet const& nodes) const
 {
-    BitSet disj = mQic.contractToMaximalQuorum(mScanSCC - nodes);
+    BitSet disj = mQic.contractToMaximalQuorum(mScanSCC - nodes, mState);
     if (!disj.empty())
     {
         mQic.noteFoundDisjointQuorums(nodes, disj);
@@ -547,6 +605,51 @@ toShortString(std::optional<Config> const& cfg, NodeID const& id)
     }
 }
 
+std::string
+nodesString(std::optional<Config> const& cfg, std::vector<NodeID> const& nodes)
+{
+    std::ostringstream out;
+    out << '{';
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        if (i != 0)
+        {
+            out << ", ";
+        }
+        out << toShortString(cfg, nodes[i]);
+    }
+    out << '}';
+    return out.str();
+}
+
+// Results of earlier second stage scans, shared by all checkers in the
+// process, by QuorumIntersectionCheckerImpl::getScanSCCHash
+struct ScanResult
+{
+    bool mFoundDisjoint;
+    std::pair<std::vector<NodeID>, std::vector<NodeID>> mPotentialSplit;
+};
+
+size_t const MAX_CACHED_SCAN_RESULTS = 0x400;
+std::mutex gScanResultsMutex;
+RandomEvictionCache<Hash, ScanResult> gScanResults(MAX_CACHED_SCAN_RESULTS,
+                                                   /* separatePRNG */ true);
+
+std::optional<ScanResult>
+getCachedScanResult(Hash const& key)
+{
+    std::lock_guard<std::mutex> lock(gScanResultsMutex);
+    auto res = gScanResults.maybeGet(key);
+    return res ? std::make_optional(*res) : std::nullopt;
+}
+
+void
+cacheScanResult(Hash const& key, ScanResult const& result)
+{
+    std::lock_guard<std::mutex> lock(gScanResultsMutex);
+    gScanResults.put(key, result);
+}
+
 QBitSet
 QuorumIntersectionCheckerImpl::convertSCPQuorumSet(SCPQuorumSet const& sqs)
 {
@@ -604,6 +707,7 @@ QuorumIntersectionCheckerImpl::buildGraph(
 {
     mPubKeyBitNums.clear();
     mBitNumPubKeys.clear();
+    mBitNumQSets.clear();
     mGraph.clear();
 
     for (auto const& pair : qmap)
@@ -613,6 +717,7 @@ QuorumIntersectionCheckerImpl::buildGraph(
             size_t n = mBitNumPubKeys.size();
             mPubKeyBitNums.insert(std::make_pair(pair.first, n));
             mBitNumPubKeys.emplace_back(pair.first);
+            mBitNumQSets.emplace_back(pair.second);
         }
         else
         {
@@ -634,7 +739,7 @@ QuorumIntersectionCheckerImpl::buildGraph(
             mGraph.emplace_back(qb);
         }
     }
-    mStats.mTotalNodes = mPubKeyBitNums.size();
+    mState.mStats.mTotalNodes = mPubKeyBitNums.size();
 }
 
 void
@@ -646,7 +751,7 @@ QuorumIntersectionCheckerImpl::buildSCCs()
         // winds up returning a dangling reference at its site of use.
         return this->mGraph.at(i).mAllSuccessors;
     });
-    mStats.mNumSCCs = mTSC.mSCCs.size();
+    mState.mStats.mNumSCCs = mTSC.mSCCs.size();
 }
 
 std::string
@@ -673,7 +778,7 @@ QuorumIntersectionCheckerImpl::networkEnjoysQuorumIntersection() const
     BitSet scanSCC;
     for (auto const& scc : mTSC.mSCCs)
     {
-        auto q = contractToMaximalQuorum(scc);
+        auto q = contractToMaximalQuorum(scc, mState);
         if (!q.empty())
         {
             if (scanSCC.empty())
@@ -681,7 +786,7 @@ QuorumIntersectionCheckerImpl::networkEnjoysQuorumIntersection() const
                 // This is the first SCC with a quorum, we'll make it the
                 // scan SCC.
                 scanSCC = scc;
-                mStats.mScanSCCSize = scanSCC.count();
+                mState.mStats.mScanSCCSize = scanSCC.count();
                 CLOG_DEBUG(SCP, "Found scan SCC: {}", scc);
                 CLOG_DEBUG(SCP, "Containing quorum: {}", q);
                 for (size_t i = 0; scanSCC.nextSet(i); ++i)
@@ -693,7 +798,8 @@ QuorumIntersectionCheckerImpl::networkEnjoysQuorumIntersection() const
             {
                 CLOG_DEBUG(SCP, "Found extra SCC: {}", scc);
                 CLOG_DEBUG(SCP, "Containing quorum: {}", q);
-                noteFoundDisjointQuorums(contractToMaximalQuorum(scanSCC), q);
+                noteFoundDisjointQuorums(
+                    contractToMaximalQuorum(scanSCC, mState), q);
                 foundDisjoint = true;
                 break;
             }
@@ -721,18 +827,146 @@ QuorumIntersectionCheckerImpl::networkEnjoysQuorumIntersection() const
         return true;
     }
 
-    // Second stage: scan the scan-SCC powerset, potentially expensive.
+    // Second stage: scan the scan-SCC powerset, potentially expensive, unless
+    // this same scan-SCC was scanned before.
     if (!foundDisjoint)
     {
-        BitSet committed;
-        BitSet remaining = scanSCC;
-        MinQuorumEnumerator mqe(committed, remaining, scanSCC, *this);
-        foundDisjoint = mqe.anyMinQuorumHasDisjointQuorum();
-        mStats.log();
+        auto key = getScanSCCHash(scanSCC);
+        if (auto cached = getCachedScanResult(key))
+        {
+            CLOG_DEBUG(SCP, "Reusing earlier scan of the same SCC");
+            foundDisjoint = cached->mFoundDisjoint;
+            if (foundDisjoint)
+            {
+                std::lock_guard<std::mutex> lock(mPotentialSplitMutex);
+                mPotentialSplit = cached->mPotentialSplit;
+                if (!mQuiet)
+                {
+                    CLOG_ERROR(SCP,
+                               "Found potential disjoint quorums: {} vs. {}",
+                               nodesString(mCfg, mPotentialSplit.first),
+                               nodesString(mCfg, mPotentialSplit.second));
+                }
+            }
+        }
+        else
+        {
+            foundDisjoint = anyMinQuorumHasDisjointQuorum(scanSCC);
+            mState.mStats.log();
+            std::lock_guard<std::mutex> lock(mPotentialSplitMutex);
+            cacheScanResult(key, {foundDisjoint, mPotentialSplit});
+        }
     }
     return !foundDisjoint;
 }
 
+bool
+QuorumIntersectionCheckerImpl::anyMinQuorumHasDisjointQuorum(
+    BitSet const& scanSCC) const
+{
+    BitSet committed;
+    BitSet remaining = scanSCC;
+    if (mNumThreads <= 1)
+    {
+        MinQuorumEnumerator mqe(committed, remaining, scanSCC, *this, mState);
+        return mqe.anyMinQuorumHasDisjointQuorum();
+    }
+
+    // Expand the top of the search tree on this thread, deep enough to have
+    // several subproblems per thread (the early exits may prune some).
+    size_t depth = 0;
+    while ((size_t(1) << depth) < mNumThreads * 8)
+    {
+        ++depth;
+    }
+    std::vector<std::pair<BitSet, BitSet>> subproblems;
+    MinQuorumEnumerator root(committed, remaining, scanSCC, *this, mState,
+                             &subproblems, depth);
+    if (root.anyMinQuorumHasDisjointQuorum())
+    {
+        return true;
+    }
+    CLOG_DEBUG(SCP, "Scanning {} subproblems on {} threads",
+               subproblems.size(), mNumThreads);
+
+    // Each worker takes the next unexplored subproblem until there are none
+    // left or one of them finds a split.
+    mStopSearch = false;
+    std::atomic<size_t> next{0};
+    std::atomic<bool> found{false};
+    std::vector<std::unique_ptr<SearchState>> states;
+    std::vector<std::exception_ptr> errors(mNumThreads);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < mNumThreads; ++i)
+    {
+        states.emplace_back(std::make_unique<SearchState>(mState.mRand()));
+    }
+    for (size_t i = 0; i < mNumThreads; ++i)
+    {
+        threads.emplace_back([&, i]() {
+            try
+            {
+                size_t k;
+                while (!mStopSearch && (k = next++) < subproblems.size())
+                {
+                    auto const& sub = subproblems[k];
+                    MinQuorumEnumerator mqe(sub.first, sub.second, scanSCC,
+                                            *this, *states[i]);
+                    if (mqe.anyMinQuorumHasDisjointQuorum())
+                    {
+                        found = true;
+                        mStopSearch = true;
+                    }
+                }
+            }
+            catch (...)
+            {
+                errors[i] = std::current_exception();
+                mStopSearch = true;
+            }
+        });
+    }
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+    for (auto const& state : states)
+    {
+        mState.mStats.add(state->mStats);
+    }
+    for (auto const& e : errors)
+    {
+        if (e)
+        {
+            std::rethrow_exception(e);
+        }
+    }
+    return found;
+}
+
+Hash
+QuorumIntersectionCheckerImpl::getScanSCCHash(BitSet const& scanSCC) const
+{
+    // The second stage only ever looks at subsets of the scan-SCC, so its
+    // result is determined by the scan-SCC's nodes and their qsets. Hash
+    // them in node ID order, as node numbers depend on the map's order.
+    std::vector<size_t> nodes;
+    for (size_t i = 0; scanSCC.nextSet(i); ++i)
+    {
+        nodes.emplace_back(i);
+    }
+    std::sort(nodes.begin(), nodes.end(), [this](size_t a, size_t b) {
+        return mBitNumPubKeys.at(a) < mBitNumPubKeys.at(b);
+    });
+    SHA256 hasher;
+    for (auto i : nodes)
+    {
+        hasher.add(xdr::xdr_to_opaque(mBitNumPubKeys.at(i)));
+        hasher.add(xdr::xdr_to_opaque(*mBitNumQSets.at(i)));
+    }
+    return hasher.finish();
+}
+
 bool
 pointsToCandidate(SCPQuorumSet const& p, NodeID const& candidate)
 {
@@ -836,6 +1070,15 @@ QuorumIntersectionChecker::create(
         qmap, cfg, interruptFlag, seed, quiet);
 }
 
+#ifdef BUILD_TESTS
+void
+QuorumIntersectionChecker::clearCachedResults()
+{
+    std::lock_guard<std::mutex> lock(gScanResultsMutex);
+    gScanResults.clear();
+}
+#endif
+
 std::set<std::set<NodeID>>
 QuorumIntersectionChecker::getIntersectionCriticalGroups(
     QuorumTracker::QuorumMap const& qmap, std::optional<Config> const& cfg,
@@ -337,6 +337,25 @@
 //        the graph. This typically excludes lots of nodes.
 //
 //
+// Postscript: parallel search and reusing results
+// ===============================================
+//
+// The two branches of each split in the enumeration are independent: each
+// covers its own part of the powerset and the answer is just whether either
+// of them finds a min-quorum with a disjoint quorum. So with
+// QUORUM_INTERSECTION_CHECKER_THREADS > 1, we run the enumeration down to a
+// fixed depth on the calling thread, collect the (C, R) pairs there instead
+// of recursing into them, and let worker threads take them off a shared list
+// one at a time until one finds a split. There are several pairs per thread
+// so that threads finishing easy parts of the tree pick up more work.
+//
+// The result of the enumeration also only depends on the nodes of the
+// scan-SCC and their qsets. It's kept in a small process-wide cache keyed by
+// a hash of those, so a rerun after a qset change outside the scan-SCC (or a
+// criticality check of a group outside it) only repeats the cheap first
+// stage.
+//
+//
 // Coda: micro-optimizations
 // =========================
 //
@@ -358,6 +377,7 @@
 #include "xdr/Stellar-SCP.h"
 #include "xdr/Stellar-types.h"
 #include <functional>
+#include <mutex>
 #include <optional>
 
 namespace
@@ -394,6 +414,52 @@ struct QBitSet
     static BitSet getSuccessors(BitSet const& nodes, QGraph const& inner);
 };
 
+struct SearchStats
+{
+    size_t mTotalNodes = {0};
+    size_t mNumSCCs = {0};
+    size_t mScanSCCSize = {0};
+    size_t mCallsStarted = {0};
+    size_t mFirstRecursionsTaken = {0};
+    size_t mSecondRecursionsTaken = {0};
+    size_t mMaxQuorumsSeen = {0};
+    size_t mMinQuorumsSeen = {0};
+    size_t mTerminations = {0};
+    size_t mEarlyExit1s = {0};
+    size_t mEarlyExit21s = {0};
+    size_t mEarlyExit22s = {0};
+    size_t mEarlyExit31s = {0};
+    size_t mEarlyExit32s = {0};
+    void log() const;
+    // Adds the search counters of other (from a worker thread)
+    void add(SearchStats const& other);
+};
+
+// The mutable state of a search on one thread. All the MinQuorumEnumerators
+// running on a thread share it and use it without locking.
+struct SearchState
+{
+    // We use our own stats and a local cached flag to control tracing because
+    // using the global metrics and log-partition lookups at a fine grain
+    // actually becomes problematic CPU-wise.
+    SearchStats mStats;
+
+    // This is a temporary structure that's reused very often within the
+    // MinQuorumEnumerators, but never reentrantly / simultaneously. So we
+    // allocate it once here and let the MQEs use it to avoid hammering
+    // on malloc.
+    std::vector<size_t> mInDegrees;
+
+    static constexpr size_t MAX_CACHED_QUORUMS_SIZE = 0xffff;
+    stellar::RandomEvictionCache<BitSet, bool, BitSet::HashFunction>
+        mCachedQuorums;
+
+    stellar::stellar_default_random_engine mRand;
+
+    explicit SearchState(
+        stellar::stellar_default_random_engine::result_type seed);
+};
+
 // A MinQuorumEnumerator is responsible to scanning the powerset of the SCC
 // we're considering, in a recursive bottom-up order, with a lot of early exits
 // described above. Each instance of MinQuorumEnumerator represents one call in
@@ -423,9 +489,18 @@ class MinQuorumEnumerator
     // the overall SCC we're considering subsets of.
     BitSet const& mScanSCC;
 
-    // Checker that owns us, contains state of stats, graph, etc.
+    // Checker that owns us, contains the graph, etc.
     QuorumIntersectionCheckerImpl const& mQic;
 
+    // State of the search on this thread, contains stats, etc.
+    SearchState& mState;
+
+    // When splitting the search across threads: after mDepth more splits,
+    // the (committed, remaining) pairs this enumerator would recurse into are
+    // added to mSubproblems instead, to be explored by the workers.
+    std::vector<std::pair<BitSet, BitSet>>* mSubproblems;
+    size_t mDepth;
+
     // Select the next node in mRemaining to split recursive cases between.
     size_t
     pickSplitNode(stellar::stellar_default_random_engine& randEngine) const;
@@ -434,9 +509,12 @@ class MinQuorumEnumerator
     size_t maxCommit() const;
 
   public:
-    MinQuorumEnumerator(BitSet const& committed, BitSet const& remaining,
-                        BitSet const& scanSCC,
-                        QuorumIntersectionCheckerImpl const& qic);
+    MinQuorumEnumerator(
+        BitSet const& committed, BitSet const& remaining,
+        BitSet const& scanSCC, QuorumIntersectionCheckerImpl const& qic,
+        SearchState& state,
+        std::vector<std::pair<BitSet, BitSet>>* subproblems = nullptr,
+        size_t depth = 0);
 
     bool hasDisjointQuorum(BitSet const& nodes) const;
     bool anyMinQuorumHasDisjointQuorum();
@@ -452,52 +530,37 @@ class QuorumIntersectionCheckerImpl : public stellar::QuorumIntersectionChecker
 
     std::optional<stellar::Config> const mCfg;
 
-    struct Stats
-    {
-        size_t mTotalNodes = {0};
-        size_t mNumSCCs = {0};
-        size_t mScanSCCSize = {0};
-        size_t mCallsStarted = {0};
-        size_t mFirstRecursionsTaken = {0};
-        size_t mSecondRecursionsTaken = {0};
-        size_t mMaxQuorumsSeen = {0};
-        size_t mMinQuorumsSeen = {0};
-        size_t mTerminations = {0};
-        size_t mEarlyExit1s = {0};
-        size_t mEarlyExit21s = {0};
-        size_t mEarlyExit22s = {0};
-        size_t mEarlyExit31s = {0};
-        size_t mEarlyExit32s = {0};
-        void log() const;
-    };
-
-    // We use our own stats and a local cached flag to control tracing because
-    // using the global metrics and log-partition lookups at a fine grain
-    // actually becomes problematic CPU-wise.
-    mutable Stats mStats;
+    // Search state of the calling thread. Worker threads have their own,
+    // whose stats are added to this one's once they're done.
+    mutable SearchState mState;
     bool mLogTrace;
 
     // When run as a subroutine of criticality-checking, we inhibit
     // INFO/ERROR/WARNING level messages.
     bool mQuiet;
 
+    // Number of threads scanning the powerset, see
+    // QUORUM_INTERSECTION_CHECKER_THREADS
+    size_t const mNumThreads;
+
     // State to capture a counterexample found during search, for later
-    // reporting.
+    // reporting. Worker threads lock mPotentialSplitMutex to update it.
     mutable std::pair<std::vector<stellar::NodeID>,
                       std::vector<stellar::NodeID>>
         mPotentialSplit;
+    mutable std::mutex mPotentialSplitMutex;
+
+    // Set once a worker thread found a split (or failed), making the others
+    // stop exploring their part of the powerset.
+    mutable std::atomic<bool> mStopSearch{false};
 
     // These are the key state of the checker: the mapping from node public keys
     // to graph node numbers, and the graph of QBitSets itself.
     std::vector<stellar::NodeID> mBitNumPubKeys;
     std::unordered_map<stellar::NodeID, size_t> mPubKeyBitNums;
     QGraph mGraph;
-
-    // This is a temporary structure that's reused very often within the
-    // MinQuorumEnumerators, but never reentrantly / simultaneously. So we
-    // allocate it once here and let the MQEs use it to avoid hammering
-    // on malloc.
-    mutable std::vector<size_t> mInDegrees;
+    // The qsets the graph was built from, by node number
+    std::vector<stellar::SCPQuorumSetPtr> mBitNumQSets;
 
     // This just calculates SCCs, from which we extract the first one found with
     // a quorum, which (assuming no other SCCs have quorums) we'll use for the
@@ -515,20 +578,20 @@ class QuorumIntersectionCheckerImpl : public stellar::QuorumIntersectionChecker
 
     bool containsQuorumSlice(BitSet const& bs, QBitSet const& qbs) const;
     bool containsQuorumSliceForNode(BitSet const& bs, size_t node) const;
-    BitSet contractToMaximalQuorum(BitSet nodes) const;
+    BitSet contractToMaximalQuorum(BitSet nodes, SearchState& state) const;
 
-    const int MAX_CACHED_QUORUMS_SIZE = 0xffff;
-    mutable stellar::RandomEvictionCache<BitSet, bool, BitSet::HashFunction>
-        mCachedQuorums;
-    bool isAQuorum(BitSet const& nodes) const;
-    bool isMinimalQuorum(BitSet const& nodes) const;
+    bool isAQuorum(BitSet const& nodes, SearchState& state) const;
+    bool isMinimalQuorum(BitSet const& nodes, SearchState& state) const;
     void noteFoundDisjointQuorums(BitSet const& nodes,
                                   BitSet const& disj) const;
     std::string nodeName(size_t node) const;
 
-    friend class MinQuorumEnumerator;
+    // Second stage: scans the powerset of scanSCC, on mNumThreads threads
+    bool anyMinQuorumHasDisjointQuorum(BitSet const& scanSCC) const;
+    // Key of the result of scanning scanSCC in the process-wide cache
+    stellar::Hash getScanSCCHash(BitSet const& scanSCC) const;
 
-    mutable stellar::stellar_default_random_engine mRand;
+    friend class MinQuorumEnumerator;
 
   public:
     QuorumIntersectionCheckerImpl(
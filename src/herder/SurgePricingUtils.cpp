@@ -8,7 +8,10 @@
 #include "util/numeric128.h"
 #include "util/types.h"
 #include <Tracy.hpp>
+#include <algorithm>
+#include <limits>
 #include <numeric>
+#include <queue>
 
 namespace stellar
 {
@@ -24,6 +27,40 @@ feeRate3WayCompare(TransactionFrameBase const& l, TransactionFrameBase const& r)
         r.getNumOperations());
 }
 
+// Per-unit weights of every resource for
+// `getMostTopTxsByScarcityWithinLimits`: the demand for a resource relative
+// to its limit, divided by the limit again so that the weighted sum over a
+// transaction's resources adds up the fractions of every limit it takes,
+// scaled by scarcity.
+std::vector<double>
+computeScarcityWeights(std::vector<TxStackPtr> const& txStacks,
+                       SurgePricingLaneConfig& laneConfig)
+{
+    auto const& limit =
+        laneConfig.getLaneLimits()[SurgePricingPriorityQueue::GENERIC_LANE];
+    std::vector<double> weights(limit.size(), 0.0);
+    for (auto const& txStack : txStacks)
+    {
+        if (txStack->empty())
+        {
+            continue;
+        }
+        auto res = laneConfig.getTxResources(*txStack->getTopTx());
+        for (size_t i = 0; i < weights.size(); ++i)
+        {
+            weights[i] += static_cast<double>(
+                res.getVal(static_cast<Resource::Type>(i)));
+        }
+    }
+    for (size_t i = 0; i < weights.size(); ++i)
+    {
+        auto l = static_cast<double>(
+            limit.getVal(static_cast<Resource::Type>(i)));
+        weights[i] = l > 0 ? weights[i] / (l * l) : 0.0;
+    }
+    return weights;
+}
+
 } // namespace
 
 int
@@ -40,6 +77,17 @@ feeRate3WayCompare(int64_t lFeeBid, uint32_t lNbOps, int64_t rFeeBid,
     //               f1 / n1 < f2 / n2
     //  == f1 * n1 * n2 / n1 < f2 * n1 * n2 / n2
     //  == f1 *      n2      < f2 * n1
+    //
+    // Fee bids of nearly all transactions fit into 32 bits, in which case
+    // the products fit into 64 bits.
+    constexpr int64_t maxNarrowFee = std::numeric_limits<uint32_t>::max();
+    if (lFeeBid >= 0 && rFeeBid >= 0 && lFeeBid <= maxNarrowFee &&
+        rFeeBid <= maxNarrowFee)
+    {
+        auto n1 = static_cast<uint64_t>(lFeeBid) * rNbOps;
+        auto n2 = static_cast<uint64_t>(rFeeBid) * lNbOps;
+        return n1 < n2 ? -1 : (n1 > n2 ? 1 : 0);
+    }
     auto v1 = bigMultiply(lFeeBid, rNbOps);
     auto v2 = bigMultiply(rFeeBid, lNbOps);
     if (v1 < v2)
@@ -76,11 +124,36 @@ SurgePricingPriorityQueue::TxStackComparator::TxStackComparator(bool isGreater,
 {
 }
 
+SurgePricingPriorityQueue::TxStackKey
+SurgePricingPriorityQueue::TxStackComparator::makeKey(
+    TxStack const& txStack) const
+{
+    auto tx = txStack.getTopTx();
+    // Ties are broken with pointer arithmetic
+    return TxStackKey{tx->getInclusionFee(), tx->getNumOperations(),
+                      reinterpret_cast<size_t>(tx.get()) ^ mSeed};
+}
+
 bool
 SurgePricingPriorityQueue::TxStackComparator::operator()(
-    TxStackPtr const& txStack1, TxStackPtr const& txStack2) const
+    TxStackKey const& key1, TxStackKey const& key2) const
 {
-    return txStackLessThan(*txStack1, *txStack2) ^ mIsGreater;
+    auto const& l = mIsGreater ? key2 : key1;
+    auto const& r = mIsGreater ? key1 : key2;
+    int cmp3;
+    if (l.mNbOps == r.mNbOps)
+    {
+        cmp3 = l.mFeeBid < r.mFeeBid ? -1 : (l.mFeeBid > r.mFeeBid ? 1 : 0);
+    }
+    else
+    {
+        cmp3 = feeRate3WayCompare(l.mFeeBid, l.mNbOps, r.mFeeBid, r.mNbOps);
+    }
+    if (cmp3 != 0)
+    {
+        return cmp3 < 0;
+    }
+    return l.mTieBreaker < r.mTieBreaker;
 }
 
 bool
@@ -105,36 +178,109 @@ SurgePricingPriorityQueue::TxStackComparator::isGreater() const
     return mIsGreater;
 }
 
+SurgePricingPriorityQueue::LaneHeap::LaneHeap(
+    TxStackComparator const& comparator)
+    : mComparator(comparator)
+{
+}
+
 bool
-SurgePricingPriorityQueue::TxStackComparator::txStackLessThan(
-    TxStack const& txStack1, TxStack const& txStack2) const
+SurgePricingPriorityQueue::LaneHeap::insert(TxStackKey const& key,
+                                            TxStackPtr txStack)
+{
+    auto inserted = mPositions.emplace(txStack.get(), mEntries.size()).second;
+    if (inserted)
+    {
+        mEntries.emplace_back(Entry{key, std::move(txStack)});
+        siftUp(mEntries.size() - 1);
+    }
+    return inserted;
+}
+
+size_t
+SurgePricingPriorityQueue::LaneHeap::find(TxStack const* txStack) const
 {
-    if (txStack1.empty())
+    auto it = mPositions.find(txStack);
+    return it == mPositions.end() ? mEntries.size() : it->second;
+}
+
+void
+SurgePricingPriorityQueue::LaneHeap::eraseAt(size_t pos)
+{
+    releaseAssert(pos < mEntries.size());
+    mPositions.erase(mEntries[pos].mTxStack.get());
+    auto last = mEntries.size() - 1;
+    if (pos != last)
     {
-        return !txStack2.empty();
+        place(pos, std::move(mEntries[last]));
+        mEntries.pop_back();
+        if (pos > 0 && isBefore(pos, (pos - 1) / ARITY))
+        {
+            siftUp(pos);
+        }
+        else
+        {
+            siftDown(pos);
+        }
     }
-    if (txStack2.empty())
+    else
     {
-        return false;
+        mEntries.pop_back();
     }
-    return txLessThan(txStack1.getTopTx(), txStack2.getTopTx(), true);
 }
 
-bool
-SurgePricingPriorityQueue::TxStackComparator::txLessThan(
-    TransactionFrameBaseConstPtr const& tx1,
-    TransactionFrameBaseConstPtr const& tx2, bool breakTiesWithHash) const
+void
+SurgePricingPriorityQueue::LaneHeap::place(size_t pos, Entry&& entry)
 {
-    auto cmp3 = feeRate3WayCompare(*tx1, *tx2);
+    mPositions[entry.mTxStack.get()] = pos;
+    mEntries[pos] = std::move(entry);
+}
 
-    if (cmp3 != 0 || !breakTiesWithHash)
+void
+SurgePricingPriorityQueue::LaneHeap::siftUp(size_t pos)
+{
+    auto entry = std::move(mEntries[pos]);
+    while (pos > 0)
     {
-        return cmp3 < 0;
+        auto parent = (pos - 1) / ARITY;
+        if (!mComparator(entry.mKey, mEntries[parent].mKey))
+        {
+            break;
+        }
+        place(pos, std::move(mEntries[parent]));
+        pos = parent;
+    }
+    place(pos, std::move(entry));
+}
+
+void
+SurgePricingPriorityQueue::LaneHeap::siftDown(size_t pos)
+{
+    auto entry = std::move(mEntries[pos]);
+    while (true)
+    {
+        auto first = pos * ARITY + 1;
+        if (first >= mEntries.size())
+        {
+            break;
+        }
+        auto best = first;
+        auto end = std::min(first + ARITY, mEntries.size());
+        for (auto child = first + 1; child < end; ++child)
+        {
+            if (mComparator(mEntries[child].mKey, mEntries[best].mKey))
+            {
+                best = child;
+            }
+        }
+        if (!mComparator(mEntries[best].mKey, entry.mKey))
+        {
+            break;
+        }
+        place(pos, std::move(mEntries[best]));
+        pos = best;
     }
-    // break tie with pointer arithmetic
-    auto lx = reinterpret_cast<size_t>(tx1.get()) ^ mSeed;
-    auto rx = reinterpret_cast<size_t>(tx2.get()) ^ mSeed;
-    return lx < rx;
+    place(pos, std::move(entry));
 }
 
 SurgePricingPriorityQueue::SurgePricingPriorityQueue(
@@ -143,7 +289,7 @@ SurgePricingPriorityQueue::SurgePricingPriorityQueue(
     : mComparator(isHighestPriority, comparisonSeed)
     , mLaneConfig(settings)
     , mLaneLimits(mLaneConfig->getLaneLimits())
-    , mTxStackSets(mLaneLimits.size(), TxStackSet(mComparator))
+    , mLaneHeaps(mLaneLimits.size(), LaneHeap(mComparator))
 {
     releaseAssert(!mLaneLimits.empty());
     mLaneCurrentCount = std::vector<Resource>(
@@ -177,6 +323,102 @@ SurgePricingPriorityQueue::getMostTopTxsWithinLimits(
     return txs;
 }
 
+std::vector<TransactionFrameBasePtr>
+SurgePricingPriorityQueue::getMostTopTxsByScarcityWithinLimits(
+    std::vector<TxStackPtr> const& txStacks,
+    std::shared_ptr<SurgePricingLaneConfig> laneConfig,
+    std::vector<bool>& hadTxNotFittingLane)
+{
+    ZoneScoped;
+
+    auto weights = computeScarcityWeights(txStacks, *laneConfig);
+    auto seed =
+        stellar::rand_uniform<size_t>(0, std::numeric_limits<size_t>::max());
+
+    struct Candidate
+    {
+        double mScore;
+        size_t mTieBreaker;
+        size_t mStack;
+
+        bool
+        operator<(Candidate const& other) const
+        {
+            if (mScore != other.mScore)
+            {
+                return mScore < other.mScore;
+            }
+            return mTieBreaker < other.mTieBreaker;
+        }
+    };
+    auto makeCandidate = [&](size_t stack, Resource const& res) {
+        auto tx = txStacks[stack]->getTopTx();
+        double size = 0.0;
+        for (size_t i = 0; i < weights.size(); ++i)
+        {
+            auto v = res.getVal(static_cast<Resource::Type>(i));
+            size += weights[i] * static_cast<double>(v);
+        }
+        auto fee = static_cast<double>(tx->getInclusionFee());
+        double score =
+            size > 0.0 ? fee / size : std::numeric_limits<double>::max();
+        // Ties are broken with pointer arithmetic, like in TxStackComparator
+        return Candidate{score, reinterpret_cast<size_t>(tx.get()) ^ seed,
+                         stack};
+    };
+
+    std::vector<Candidate> candidates;
+    candidates.reserve(txStacks.size());
+    for (size_t i = 0; i < txStacks.size(); ++i)
+    {
+        if (!txStacks[i]->empty())
+        {
+            candidates.emplace_back(makeCandidate(
+                i, laneConfig->getTxResources(*txStacks[i]->getTopTx())));
+        }
+    }
+    std::priority_queue<Candidate> queue(std::less<Candidate>(),
+                                         std::move(candidates));
+
+    auto laneLeftUntilLimit = laneConfig->getLaneLimits();
+    hadTxNotFittingLane.assign(laneLeftUntilLimit.size(), false);
+    std::vector<TransactionFrameBasePtr> txs;
+    while (!queue.empty())
+    {
+        auto top = queue.top();
+        queue.pop();
+        auto& txStack = *txStacks[top.mStack];
+        auto tx = txStack.getTopTx();
+        auto res = laneConfig->getTxResources(*tx);
+        auto lane = laneConfig->getLane(*tx);
+        // Like with gaps allowed in `popTopTxs`, a transaction that does not
+        // fit drops the rest of its stack
+        if (anyGreater(res, laneLeftUntilLimit[lane]))
+        {
+            hadTxNotFittingLane[lane] = true;
+            continue;
+        }
+        if (anyGreater(res, laneLeftUntilLimit[GENERIC_LANE]))
+        {
+            hadTxNotFittingLane[GENERIC_LANE] = true;
+            continue;
+        }
+        laneLeftUntilLimit[GENERIC_LANE] -= res;
+        if (lane != GENERIC_LANE)
+        {
+            laneLeftUntilLimit[lane] -= res;
+        }
+        txs.emplace_back(tx);
+        txStack.popTopTx();
+        if (!txStack.empty())
+        {
+            queue.push(makeCandidate(
+                top.mStack, laneConfig->getTxResources(*txStack.getTopTx())));
+        }
+    }
+    return txs;
+}
+
 void
 SurgePricingPriorityQueue::visitTopTxs(
     std::vector<TxStackPtr> const& txStacks,
@@ -199,10 +441,11 @@ SurgePricingPriorityQueue::add(TxStackPtr txStack)
 {
     releaseAssert(txStack != nullptr);
     auto lane = mLaneConfig->getLane(*txStack->getTopTx());
-    bool inserted = mTxStackSets[lane].insert(txStack).second;
-    if (inserted)
+    auto key = mComparator.makeKey(*txStack);
+    auto res = txStack->getResources();
+    if (mLaneHeaps[lane].insert(key, std::move(txStack)))
     {
-        mLaneCurrentCount[lane] += txStack->getResources();
+        mLaneCurrentCount[lane] += res;
     }
 }
 
@@ -211,10 +454,10 @@ SurgePricingPriorityQueue::erase(TxStackPtr txStack)
 {
     releaseAssert(txStack != nullptr);
     auto lane = mLaneConfig->getLane(*txStack->getTopTx());
-    auto it = mTxStackSets[lane].find(txStack);
-    if (it != mTxStackSets[lane].end())
+    auto pos = mLaneHeaps[lane].find(txStack.get());
+    if (pos != mLaneHeaps[lane].size())
     {
-        erase(lane, it);
+        erase(lane, pos);
     }
 }
 
@@ -226,13 +469,12 @@ SurgePricingPriorityQueue::erase(Iterator const& it)
 }
 
 void
-SurgePricingPriorityQueue::erase(
-    size_t lane, SurgePricingPriorityQueue::TxStackSet::iterator iter)
+SurgePricingPriorityQueue::erase(size_t lane, size_t pos)
 {
-    auto res = (*iter)->getResources();
+    auto res = mLaneHeaps[lane].at(pos).mTxStack->getResources();
     releaseAssert(res <= mLaneCurrentCount[lane]);
     mLaneCurrentCount[lane] -= res;
-    mTxStackSets[lane].erase(iter);
+    mLaneHeaps[lane].eraseAt(pos);
 }
 
 void
@@ -497,17 +739,15 @@ SurgePricingPriorityQueue::canFitWithEviction(
 SurgePricingPriorityQueue::Iterator
 SurgePricingPriorityQueue::getTop() const
 {
-    std::vector<LaneIter> iters;
-    for (size_t lane = 0; lane < mTxStackSets.size(); ++lane)
+    std::vector<size_t> lanes;
+    for (size_t lane = 0; lane < mLaneHeaps.size(); ++lane)
     {
-        auto const& txStackSet = mTxStackSets[lane];
-        if (txStackSet.empty())
+        if (!mLaneHeaps[lane].empty())
         {
-            continue;
+            lanes.emplace_back(lane);
         }
-        iters.emplace_back(lane, txStackSet.begin());
     }
-    return SurgePricingPriorityQueue::Iterator(*this, iters);
+    return SurgePricingPriorityQueue::Iterator(*this, lanes);
 }
 
 Resource
@@ -540,23 +780,29 @@ SurgePricingPriorityQueue::popTopTx(SurgePricingPriorityQueue::Iterator iter)
 }
 
 SurgePricingPriorityQueue::Iterator::Iterator(
-    SurgePricingPriorityQueue const& parent, std::vector<LaneIter> const& iters)
-    : mParent(parent), mIters(iters)
+    SurgePricingPriorityQueue const& parent, std::vector<size_t> const& lanes)
+    : mParent(parent)
 {
+    for (auto lane : lanes)
+    {
+        mCursors.emplace_back(LaneCursor{lane, {0}});
+    }
 }
 
-std::vector<SurgePricingPriorityQueue::LaneIter>::iterator
+std::vector<SurgePricingPriorityQueue::Iterator::LaneCursor>::iterator
 SurgePricingPriorityQueue::Iterator::getMutableInnerIter() const
 {
     releaseAssert(!isEnd());
-    auto best = mIters.begin();
-    for (auto groupIt = std::next(mIters.begin()); groupIt != mIters.end();
-         ++groupIt)
+    auto best = mCursors.begin();
+    for (auto it = std::next(mCursors.begin()); it != mCursors.end(); ++it)
     {
-        auto& [group, it] = *groupIt;
-        if (mParent.mComparator(*it, *best->second))
+        auto const& bestEntry =
+            mParent.mLaneHeaps[best->mLane].at(best->mFrontier.front());
+        auto const& entry =
+            mParent.mLaneHeaps[it->mLane].at(it->mFrontier.front());
+        if (mParent.mComparator(entry.mKey, bestEntry.mKey))
         {
-            best = groupIt;
+            best = it;
         }
     }
     return best;
@@ -565,36 +811,54 @@ SurgePricingPriorityQueue::Iterator::getMutableInnerIter() const
 TxStackPtr
 SurgePricingPriorityQueue::Iterator::operator*() const
 {
-    return *getMutableInnerIter()->second;
+    auto const& [lane, pos] = getInnerIter();
+    return mParent.mLaneHeaps[lane].at(pos).mTxStack;
 }
 
 SurgePricingPriorityQueue::LaneIter
 SurgePricingPriorityQueue::Iterator::getInnerIter() const
 {
-    return *getMutableInnerIter();
+    auto it = getMutableInnerIter();
+    return std::make_pair(it->mLane, it->mFrontier.front());
 }
 
 bool
 SurgePricingPriorityQueue::Iterator::isEnd() const
 {
-    return mIters.empty();
+    return mCursors.empty();
 }
 
 void
 SurgePricingPriorityQueue::Iterator::advance()
 {
     auto it = getMutableInnerIter();
-    ++it->second;
-    if (it->second == mParent.mTxStackSets[it->first].end())
+    auto const& heap = mParent.mLaneHeaps[it->mLane];
+    auto& frontier = it->mFrontier;
+    // `std::push_heap` keeps the greatest element in front, so invert the
+    // heap order to have the next position to visit there
+    auto cmp = [&heap](size_t pos1, size_t pos2) {
+        return heap.isBefore(pos2, pos1);
+    };
+    auto pos = frontier.front();
+    std::pop_heap(frontier.begin(), frontier.end(), cmp);
+    frontier.pop_back();
+    auto first = pos * LaneHeap::ARITY + 1;
+    auto end = std::min(first + LaneHeap::ARITY, heap.size());
+    for (auto child = first; child < end; ++child)
+    {
+        frontier.push_back(child);
+        std::push_heap(frontier.begin(), frontier.end(), cmp);
+    }
+    if (frontier.empty())
     {
-        mIters.erase(it);
+        mCursors.erase(it);
     }
 }
 
 void
 SurgePricingPriorityQueue::Iterator::dropLane()
 {
-    mIters.erase(getMutableInnerIter());
+    mCursors.erase(getMutableInnerIter());
 }
 
 DexLimitingLaneConfig::DexLimitingLaneConfig(Resource Limit,
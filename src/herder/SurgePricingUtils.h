@@ -4,9 +4,10 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
-#include <set>
-
 #include "transactions/TransactionFrameBase.h"
+#include "util/UnorderedMap.h"
+
+#include <vector>
 
 namespace stellar
 {
@@ -149,6 +150,21 @@ class SurgePricingPriorityQueue
         std::shared_ptr<SurgePricingLaneConfig> laneConfig,
         std::vector<bool>& hadTxNotFittingLane);
 
+    // Same as `getMostTopTxsWithinLimits`, but rather than by fee rate the
+    // transactions are ordered by their inclusion fee per unit of scarce
+    // resources. Every resource is weighted by how many times the top
+    // transactions of all the stacks together would fill the 'generic' lane
+    // limit for it, so that when one resource (e.g. write bytes) is the
+    // bottleneck, transactions that use little of it are picked first.
+    // This packs multi-dimensional limits better than the fee rate order,
+    // but does not guarantee that every transaction left out has a lower fee
+    // rate than the ones included.
+    static std::vector<TransactionFrameBasePtr>
+    getMostTopTxsByScarcityWithinLimits(
+        std::vector<TxStackPtr> const& txStacks,
+        std::shared_ptr<SurgePricingLaneConfig> laneConfig,
+        std::vector<bool>& hadTxNotFittingLane);
+
     // Returns total number of resources in all the stacks in this queue.
     Resource totalResources() const;
 
@@ -217,13 +233,26 @@ class SurgePricingPriorityQueue
         std::vector<std::pair<TxStackPtr, bool>>& txStacksToEvict) const;
 
   private:
+    // Fee rate and tie breaker of the top transaction of a stack, captured
+    // when the stack is added to the queue, so that comparisons don't need to
+    // go through the stack and the transaction.
+    struct TxStackKey
+    {
+        int64_t mFeeBid;
+        uint32_t mNbOps;
+        size_t mTieBreaker;
+    };
+
     class TxStackComparator
     {
       public:
         TxStackComparator(bool isGreater, size_t seed);
 
-        bool operator()(TxStackPtr const& txStack1,
-                        TxStackPtr const& txStack2) const;
+        TxStackKey makeKey(TxStack const& txStack) const;
+
+        // Returns whether `key1` is closer to the top of the queue than
+        // `key2`.
+        bool operator()(TxStackKey const& key1, TxStackKey const& key2) const;
 
         bool compareFeeOnly(TransactionFrameBase const& tx1,
                             TransactionFrameBase const& tx2) const;
@@ -232,32 +261,86 @@ class SurgePricingPriorityQueue
         bool isGreater() const;
 
       private:
-        bool txStackLessThan(TxStack const& txStack1,
-                             TxStack const& txStack2) const;
-
-        bool txLessThan(TransactionFrameBaseConstPtr const& tx1,
-                        TransactionFrameBaseConstPtr const& tx2,
-                        bool breakTiesWithHash) const;
-
         bool const mIsGreater;
         size_t mSeed;
     };
 
-    using TxStackSet = std::set<TxStackPtr, TxStackComparator>;
-    using LaneIter = std::pair<size_t, TxStackSet::iterator>;
+    // Indexed 4-ary heap of the stacks in a lane, with the top of the queue
+    // at position 0. The position of every stack is tracked, so that any
+    // stack can be erased in logarithmic time.
+    class LaneHeap
+    {
+      public:
+        static constexpr size_t ARITY = 4;
+
+        struct Entry
+        {
+            TxStackKey mKey;
+            TxStackPtr mTxStack;
+        };
+
+        explicit LaneHeap(TxStackComparator const& comparator);
+
+        bool
+        empty() const
+        {
+            return mEntries.empty();
+        }
+
+        size_t
+        size() const
+        {
+            return mEntries.size();
+        }
+
+        Entry const&
+        at(size_t pos) const
+        {
+            return mEntries[pos];
+        }
+
+        // Returns whether the stack at `pos1` is closer to the top than the
+        // stack at `pos2`.
+        bool
+        isBefore(size_t pos1, size_t pos2) const
+        {
+            return mComparator(mEntries[pos1].mKey, mEntries[pos2].mKey);
+        }
+
+        // Returns `false` if the stack is already in the heap.
+        bool insert(TxStackKey const& key, TxStackPtr txStack);
+        // Returns the position of `txStack`, or `size()` if it's not in the
+        // heap.
+        size_t find(TxStack const* txStack) const;
+        void eraseAt(size_t pos);
+
+      private:
+        void place(size_t pos, Entry&& entry);
+        void siftUp(size_t pos);
+        void siftDown(size_t pos);
+
+        TxStackComparator const mComparator;
+        std::vector<Entry> mEntries;
+        UnorderedMap<TxStack const*, size_t> mPositions;
+    };
+
+    // Lane and position in that lane's heap.
+    using LaneIter = std::pair<size_t, size_t>;
 
     // Iterator for walking the queue from top to bottom, possibly restricted
     // only to some lanes. The actual ordering is defined by
     // `isHighestPriority`.
+    // Lane heaps are walked in order by keeping the positions whose parent
+    // has already been visited in a small heap of their own, so walking `k`
+    // stacks takes O(k log k) regardless of the size of the queue.
     class Iterator
     {
       public:
         Iterator(SurgePricingPriorityQueue const& parent,
-                 std::vector<LaneIter> const& iters);
+                 std::vector<size_t> const& lanes);
 
         TxStackPtr operator*() const;
-        // Gets the iterator of the `TxStackSet` corresponding to the current
-        // value.
+        // Gets the lane and heap position corresponding to the current value.
         LaneIter getInnerIter() const;
         bool isEnd() const;
         // Advances this iterator to the next value.
@@ -266,10 +349,18 @@ class SurgePricingPriorityQueue
         void dropLane();
 
       private:
-        std::vector<LaneIter>::iterator getMutableInnerIter() const;
+        struct LaneCursor
+        {
+            size_t mLane;
+            // Heap positions that can be visited next, with the next one at
+            // the front.
+            std::vector<size_t> mFrontier;
+        };
+
+        std::vector<LaneCursor>::iterator getMutableInnerIter() const;
 
         SurgePricingPriorityQueue const& mParent;
-        std::vector<LaneIter> mutable mIters;
+        std::vector<LaneCursor> mutable mCursors;
     };
 
     // Generalized method for visiting and popping the top transactions in the
@@ -283,8 +374,7 @@ class SurgePricingPriorityQueue
               std::vector<bool>& hadTxNotFittingLane);
 
     void erase(Iterator const& it);
-    void erase(size_t lane,
-               SurgePricingPriorityQueue::TxStackSet::iterator iter);
+    void erase(size_t lane, size_t pos);
     void popTopTx(Iterator iter);
 
     Iterator getTop() const;
@@ -295,7 +385,7 @@ class SurgePricingPriorityQueue
 
     std::vector<Resource> mLaneCurrentCount;
 
-    std::vector<TxStackSet> mTxStackSets;
+    std::vector<LaneHeap> mLaneHeaps;
 };
 
 } // namespace stellar
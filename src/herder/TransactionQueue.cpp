@@ -28,6 +28,7 @@
 
 #include <Tracy.hpp>
 #include <algorithm>
+#include <array>
 #include <fmt/format.h>
 #include <functional>
 #include <limits>
@@ -37,11 +38,22 @@
 #include <numeric>
 #include <optional>
 #include <random>
+#include <xdrpp/marshal.h>
 
 namespace stellar
 {
 const uint64_t TransactionQueue::FEE_MULTIPLIER = 10;
 
+namespace
+{
+// Most of what a queued transaction holds is its envelope
+size_t
+txMemoryUsage(TransactionFrameBase const& tx)
+{
+    return xdr::xdr_size(tx.getEnvelope());
+}
+}
+
 std::array<const char*,
            static_cast<int>(TransactionQueue::AddResult::ADD_STATUS_COUNT)>
     TX_STATUS_STRING = std::array{"PENDING", "DUPLICATE", "ERROR",
@@ -86,7 +98,9 @@ ClassicTransactionQueue::ClassicTransactionQueue(Application& app,
         sizeByAge,
         app.getMetrics().NewCounter({"herder", "pending-txs", "banned"}),
         app.getMetrics().NewTimer({"herder", "pending-txs", "delay"}),
-        app.getMetrics().NewTimer({"herder", "pending-txs", "self-delay"}));
+        app.getMetrics().NewTimer({"herder", "pending-txs", "self-delay"}),
+        app.getMetrics().NewCounter(
+            {"herder", "memory", "pending-txs-bytes"}));
     mBroadcastOpCarryover.resize(1,
                                  Resource::makeEmpty(NUM_CLASSIC_TX_RESOURCES));
 }
@@ -396,8 +410,11 @@ void
 TransactionQueue::prepareDropTransaction(AccountState& as)
 {
     releaseAssert(as.mTransaction);
+    ++mContentsVersion;
     mTxQueueLimiter->removeTransaction(as.mTransaction->mTx);
     mKnownTxHashes.erase(as.mTransaction->mTx->getFullHash());
+    mKnownTxBytes -= txMemoryUsage(*as.mTransaction->mTx);
+    mQueueMetrics->mMemoryBytes.set_count(static_cast<int64_t>(mKnownTxBytes));
     CLOG_DEBUG(Tx, "Dropping {} transaction",
                hexAbbrev(as.mTransaction->mTx->getFullHash()));
     releaseFeeMaybeEraseAccountState(as.mTransaction->mTx);
@@ -424,10 +441,136 @@ TransactionQueue::prepareDropTransaction(AccountState& as)
 // "real" traffic -- but it does cover the case of zero-risk (fee-only)
 // instantaneous-arbitrage attempts, which users are (at the time of
 // writing) flooding the network with.
+namespace
+{
+// A path payment names at most 7 assets, so the graph of nearly every
+// transaction fits in this many nodes
+size_t const MAX_SMALL_PAYMENT_GRAPH_ASSETS = 32;
+
+// Finds the same edges as findAllAssetPairsInvolvedInPaymentLoops without
+// allocating (unless there is a loop to return), keeping the graph in fixed
+// arrays of bit masks: an edge u->v is in a loop exactly when v reaches u
+// (or, for u == u, when u's SCC has another node), which the transitive
+// closure of so few nodes tells directly. Returns false, leaving ret empty,
+// if the transaction names more assets than that.
+bool
+findPaymentLoopsInSmallGraph(TransactionFrameBasePtr const& tx,
+                             std::vector<AssetPair>& ret)
+{
+    std::array<Asset const*, MAX_SMALL_PAYMENT_GRAPH_ASSETS> numToAsset;
+    std::array<uint32_t, MAX_SMALL_PAYMENT_GRAPH_ASSETS> graph{};
+    size_t numAssets = 0;
+    bool tooMany = false;
+
+    auto internAsset = [&](Asset const& a) -> size_t {
+        for (size_t i = 0; i < numAssets; ++i)
+        {
+            if (*numToAsset[i] == a)
+            {
+                return i;
+            }
+        }
+        if (numAssets == MAX_SMALL_PAYMENT_GRAPH_ASSETS)
+        {
+            tooMany = true;
+            return 0;
+        }
+        numToAsset[numAssets] = &a;
+        return numAssets++;
+    };
+
+    auto internSegment = [&](Asset const& src, Asset const& dst,
+                             std::vector<Asset> const& path) {
+        size_t prev = internAsset(src);
+        for (auto const& a : path)
+        {
+            size_t next = internAsset(a);
+            graph[prev] |= 1u << next;
+            prev = next;
+        }
+        graph[prev] |= 1u << internAsset(dst);
+    };
+
+    for (auto const& op : tx->getRawOperations())
+    {
+        switch (op.body.type())
+        {
+        case PATH_PAYMENT_STRICT_RECEIVE:
+        {
+            auto const& pop = op.body.pathPaymentStrictReceiveOp();
+            internSegment(pop.sendAsset, pop.destAsset, pop.path);
+        }
+        break;
+        case PATH_PAYMENT_STRICT_SEND:
+        {
+            auto const& pop = op.body.pathPaymentStrictSendOp();
+            internSegment(pop.sendAsset, pop.destAsset, pop.path);
+        }
+        break;
+        default:
+            continue;
+        }
+        if (tooMany)
+        {
+            return false;
+        }
+    }
+
+    // reach[i] has the nodes reachable from i by one or more edges
+    auto reach = graph;
+    for (size_t k = 0; k < numAssets; ++k)
+    {
+        for (size_t i = 0; i < numAssets; ++i)
+        {
+            if (reach[i] & (1u << k))
+            {
+                reach[i] |= reach[k];
+            }
+        }
+    }
+
+    for (size_t src = 0; src < numAssets; ++src)
+    {
+        // The other nodes in src's SCC
+        uint32_t sccMates = 0;
+        for (size_t other = 0; other < numAssets; ++other)
+        {
+            if (other != src && (reach[src] & (1u << other)) &&
+                (reach[other] & (1u << src)))
+            {
+                sccMates |= 1u << other;
+            }
+        }
+        if (sccMates == 0)
+        {
+            continue;
+        }
+        for (size_t dst = 0; dst < numAssets; ++dst)
+        {
+            if ((graph[src] & (1u << dst)) &&
+                (dst == src || (sccMates & (1u << dst))))
+            {
+                ret.emplace_back(
+                    AssetPair{*numToAsset[src], *numToAsset[dst]});
+            }
+        }
+    }
+    return true;
+}
+}
+
 std::vector<AssetPair>
 TransactionQueue::findAllAssetPairsInvolvedInPaymentLoops(
     TransactionFrameBasePtr tx)
 {
+    {
+        std::vector<AssetPair> ret;
+        if (findPaymentLoopsInSmallGraph(tx, ret))
+        {
+            return ret;
+        }
+    }
+
     std::map<Asset, size_t> assetToNum;
     std::vector<Asset> numToAsset;
     std::vector<BitSet> graph;
@@ -577,6 +720,9 @@ TransactionQueue::tryAdd(TransactionFrameBasePtr tx, bool submittedFromSelf)
         [&](TransactionFrameBasePtr const& txToEvict) { ban({txToEvict}); });
     mTxQueueLimiter->addTransaction(tx);
     mKnownTxHashes[tx->getFullHash()] = tx;
+    mKnownTxBytes += txMemoryUsage(*tx);
+    mQueueMetrics->mMemoryBytes.set_count(static_cast<int64_t>(mKnownTxBytes));
+    ++mContentsVersion;
 
     broadcast(false);
 
@@ -616,63 +762,100 @@ TransactionQueue::removeApplied(Transactions const& appliedTxs)
 {
     ZoneScoped;
 
-    auto now = mApp.getClock().now();
+    // Visit the applied transactions grouped by source account and in
+    // sequence number order, so that every account is looked up once no
+    // matter how many of its transactions were applied
+    std::vector<std::pair<AccountID, TransactionFrameBase const*>> sorted;
+    sorted.reserve(appliedTxs.size());
     for (auto const& appliedTx : appliedTxs)
     {
+        sorted.emplace_back(appliedTx->getSourceID(), appliedTx.get());
+    }
+    std::sort(sorted.begin(), sorted.end(), [](auto const& l, auto const& r) {
+        if (!(l.first == r.first))
+        {
+            return l.first < r.first;
+        }
+        return l.second->getSeqNum() < r.second->getSeqNum();
+    });
+
+    auto now = mApp.getClock().now();
+    auto& bannedFront = mBannedTransactions.front();
+    for (auto groupBegin = sorted.begin(); groupBegin != sorted.end();)
+    {
+        auto const& accountID = groupBegin->first;
+        auto groupEnd =
+            std::find_if(groupBegin, sorted.end(), [&](auto const& p) {
+                return !(p.first == accountID);
+            });
+
         // If the source account is not in mAccountStates, then it has no
         // transactions in the queue so there is nothing to do
-        auto stateIter = mAccountStates.find(appliedTx->getSourceID());
-        if (stateIter != mAccountStates.end())
+        auto stateIter = mAccountStates.find(accountID);
+        // If there are no transactions in the queue for this source
+        // account, then there is nothing to do
+        if (stateIter != mAccountStates.end() &&
+            stateIter->second.mTransaction)
         {
-            // If there are no transactions in the queue for this source
-            // account, then there is nothing to do
             auto const& transaction = stateIter->second.mTransaction;
-            if (transaction)
+            // We care about matching the sequence number rather than the
+            // hash, because any transaction with a sequence number
+            // less-than-or-equal to the highest applied sequence number for
+            // this source account has either (1) been applied, or (2) become
+            // invalid.
+            auto const* lastApplied = std::prev(groupEnd)->second;
+            if (transaction->mTx->getSeqNum() <= lastApplied->getSeqNum())
             {
-                // We care about matching the sequence number rather than
-                // the hash, because any transaction with a sequence number
-                // less-than-or-equal to the highest applied sequence number
-                // for this source account has either (1) been applied, or
-                // (2) become invalid.
-                if (transaction->mTx->getSeqNum() <= appliedTx->getSeqNum())
+                auto& age = stateIter->second.mAge;
+                mQueueMetrics->mSizeByAge[age]->dec();
+                age = 0;
+
+                // update the metric for the time spent for applied
+                // transactions using exact match
+                auto const& queuedHash = transaction->mTx->getFullHash();
+                if (std::any_of(groupBegin, groupEnd, [&](auto const& p) {
+                        return p.second->getFullHash() == queuedHash;
+                    }))
                 {
-                    auto& age = stateIter->second.mAge;
-                    mQueueMetrics->mSizeByAge[age]->dec();
-                    age = 0;
-
-                    // update the metric for the time spent for applied
-                    // transactions using exact match
-                    if (transaction->mTx->getFullHash() ==
-                        appliedTx->getFullHash())
+                    auto elapsed = now - transaction->mInsertionTime;
+                    mQueueMetrics->mTransactionsDelay.Update(elapsed);
+                    if (transaction->mSubmittedFromSelf)
                     {
-                        auto elapsed = now - transaction->mInsertionTime;
-                        mQueueMetrics->mTransactionsDelay.Update(elapsed);
-                        if (transaction->mSubmittedFromSelf)
-                        {
-                            mQueueMetrics->mTransactionsSelfDelay.Update(
-                                elapsed);
-                        }
+                        mQueueMetrics->mTransactionsSelfDelay.Update(elapsed);
                     }
-
-                    // WARNING: stateIter and everything that references it
-                    // may be invalid from this point onward and should not
-                    // be used.
-                    dropTransaction(stateIter);
                 }
+
+                // WARNING: stateIter and everything that references it may
+                // be invalid from this point onward and should not be used.
+                dropTransaction(stateIter);
             }
         }
 
-        // Ban applied tx
-        auto& bannedFront = mBannedTransactions.front();
-        bannedFront.emplace(appliedTx->getFullHash());
-        CLOG_DEBUG(Tx, "Ban applied transaction {}",
-                   hexAbbrev(appliedTx->getFullHash()));
-
+        // Ban applied txs
+        for (auto it = groupBegin; it != groupEnd; ++it)
+        {
+            bannedFront.insert(it->second->getFullHash());
+            CLOG_DEBUG(Tx, "Ban applied transaction {}",
+                       hexAbbrev(it->second->getFullHash()));
+        }
         // do not mark metric for banning as this is the result of normal
         // flow of operations
+
+        groupBegin = groupEnd;
     }
 }
 
+TxSetTransactions
+TransactionQueue::removeAppliedAndShift(Transactions const& appliedTxs,
+                                        LedgerHeader const& lcl)
+{
+    ZoneScoped;
+    removeApplied(appliedTxs);
+    TxSetTransactions remaining;
+    shift(&remaining, getStartingSequenceNumber(lcl.ledgerSeq + 1));
+    return remaining;
+}
+
 void
 TransactionQueue::ban(Transactions const& banTxs)
 {
@@ -688,7 +871,7 @@ TransactionQueue::ban(Transactions const& banTxs)
         releaseAssert(
             transactionsByAccount.emplace(tx->getSourceID(), tx).second);
         CLOG_DEBUG(Tx, "Ban transaction {}", hexAbbrev(tx->getFullHash()));
-        if (bannedFront.emplace(tx->getFullHash()).second)
+        if (bannedFront.insert(tx->getFullHash()))
         {
             mQueueMetrics->mBannedTransactionsCounter.inc();
         }
@@ -739,11 +922,25 @@ TransactionQueue::countBanned(int index) const
 
 void
 TransactionQueue::shift()
+{
+    shift(nullptr, 0);
+}
+
+void
+TransactionQueue::shift(TxSetTransactions* remaining, int64_t startingSeq)
 {
     ZoneScoped;
+    // Freeing the oldest ban set and the flood damping state is left to a
+    // later scheduler slot, so that it does not delay the next round
+    auto expired = std::make_shared<
+        std::pair<TxHashSet, decltype(mArbitrageFloodDamping)>>(
+        std::move(mBannedTransactions.back()),
+        std::move(mArbitrageFloodDamping));
     mBannedTransactions.pop_back();
     mBannedTransactions.emplace_front();
     mArbitrageFloodDamping.clear();
+    mApp.postOnMainThread([expired]() mutable { expired.reset(); },
+                          "TransactionQueue: free expired state");
 
     auto sizes = std::vector<int64_t>{};
     sizes.resize(mPendingDepth);
@@ -788,8 +985,16 @@ TransactionQueue::shift()
         }
         else
         {
-            sizes[it->second.mAge] +=
-                static_cast<int>(it->second.mTransaction.has_value());
+            auto& transaction = it->second.mTransaction;
+            sizes[it->second.mAge] += static_cast<int>(transaction.has_value());
+            if (remaining && transaction)
+            {
+                transaction->mBroadcasted = false;
+                if (transaction->mTx->getSeqNum() != startingSeq)
+                {
+                    remaining->emplace_back(transaction->mTx);
+                }
+            }
             ++it;
         }
     }
@@ -809,8 +1014,8 @@ TransactionQueue::isBanned(Hash const& hash) const
 {
     return std::any_of(
         std::begin(mBannedTransactions), std::end(mBannedTransactions),
-        [&](UnorderedSet<Hash> const& transactions) {
-            return transactions.find(hash) != std::end(transactions);
+        [&](TxHashSet const& transactions) {
+            return transactions.contains(hash);
         });
 }
 
@@ -852,6 +1057,7 @@ TransactionQueue::getTx(Hash const& hash) const
 void
 TransactionQueue::clearAll()
 {
+    ++mContentsVersion;
     mAccountStates.clear();
     for (auto& b : mBannedTransactions)
     {
@@ -862,6 +1068,8 @@ TransactionQueue::clearAll()
                   TransactionMode::READ_ONLY_WITHOUT_SQL_TXN);
     mTxQueueLimiter->reset(ltx.loadHeader().current().ledgerVersion);
     mKnownTxHashes.clear();
+    mKnownTxBytes = 0;
+    mQueueMetrics->mMemoryBytes.set_count(0);
 }
 
 std::pair<Resource, std::optional<Resource>>
@@ -1018,7 +1226,9 @@ SorobanTransactionQueue::SorobanTransactionQueue(Application& app,
             {"herder", "pending-soroban-txs", "banned"}),
         app.getMetrics().NewTimer({"herder", "pending-soroban-txs", "delay"}),
         app.getMetrics().NewTimer(
-            {"herder", "pending-soroban-txs", "self-delay"}));
+            {"herder", "pending-soroban-txs", "self-delay"}),
+        app.getMetrics().NewCounter(
+            {"herder", "memory", "pending-soroban-txs-bytes"}));
     mBroadcastOpCarryover.resize(1, Resource::makeEmptySoroban());
 }
 
@@ -1243,6 +1453,12 @@ TransactionQueue::rebroadcast()
     broadcast(false);
 }
 
+void
+TransactionQueue::rebroadcastMarked()
+{
+    broadcast(false);
+}
+
 void
 TransactionQueue::shutdown()
 {
@@ -11,6 +11,7 @@
 #include "transactions/TransactionFrame.h"
 #include "util/HashOfHash.h"
 #include "util/Timer.h"
+#include "util/TxHashIndex.h"
 #include "util/XDROperators.h"
 #include "xdr/Stellar-transaction.h"
 
@@ -121,11 +122,35 @@ class TransactionQueue
      */
     void shift();
     void rebroadcast();
+
+    /**
+     * removeApplied followed by shift, done in a single walk over the queued
+     * accounts. That walk also collects the transactions left in the queue,
+     * like getTransactions(lcl), and marks them for rebroadcast. Once the ones
+     * that are no longer valid are banned, rebroadcastMarked broadcasts the
+     * rest.
+     */
+    TxSetTransactions removeAppliedAndShift(Transactions const& appliedTxs,
+                                            LedgerHeader const& lcl);
+    void rebroadcastMarked();
     void shutdown();
 
     bool isBanned(Hash const& hash) const;
     TransactionFrameBaseConstPtr getTx(Hash const& hash) const;
+    // Number of transactions in the queue
+    size_t
+    size() const
+    {
+        return mKnownTxHashes.size();
+    }
     TxSetTransactions getTransactions(LedgerHeader const& lcl) const;
+    // Incremented every time a transaction is added to or dropped from the
+    // queue
+    uint64_t
+    getContentsVersion() const
+    {
+        return mContentsVersion;
+    }
     bool sourceAccountPending(AccountID const& accountID) const;
 
     virtual size_t getMaxQueueSizeOps() const = 0;
@@ -150,7 +175,7 @@ class TransactionQueue
      * Banned transactions are stored in deque of depth banDepth, so it is easy
      * to unban all transactions that were banned for long enough.
      */
-    using BannedTransactions = std::deque<UnorderedSet<Hash>>;
+    using BannedTransactions = std::deque<TxHashSet>;
 
     Application& mApp;
     uint32 const mPendingDepth;
@@ -164,17 +189,20 @@ class TransactionQueue
         QueueMetrics(std::vector<medida::Counter*> sizeByAge,
                      medida::Counter& bannedTransactionsCounter,
                      medida::Timer& transactionsDelay,
-                     medida::Timer& transactionsSelfDelay)
+                     medida::Timer& transactionsSelfDelay,
+                     medida::Counter& memoryBytes)
             : mSizeByAge(std::move(sizeByAge))
             , mBannedTransactionsCounter(bannedTransactionsCounter)
             , mTransactionsDelay(transactionsDelay)
             , mTransactionsSelfDelay(transactionsSelfDelay)
+            , mMemoryBytes(memoryBytes)
         {
         }
         std::vector<medida::Counter*> mSizeByAge;
         medida::Counter& mBannedTransactionsCounter;
         medida::Timer& mTransactionsDelay;
         medida::Timer& mTransactionsSelfDelay;
+        medida::Counter& mMemoryBytes;
     };
 
     std::unique_ptr<QueueMetrics> mQueueMetrics;
@@ -192,6 +220,8 @@ class TransactionQueue
     virtual bool allowTxBroadcast(TimestampedTx const& tx) = 0;
 
     void broadcast(bool fromCallback);
+    // See removeAppliedAndShift, remaining is only filled in if not null
+    void shift(TxSetTransactions* remaining, int64_t startingSeq);
     // broadcasts a single transaction
     enum class BroadcastStatus
     {
@@ -216,7 +246,10 @@ class TransactionQueue
     std::unique_ptr<TxQueueLimiter> mTxQueueLimiter;
     UnorderedMap<AssetPair, uint32_t, AssetPairHash> mArbitrageFloodDamping;
 
-    UnorderedMap<Hash, TransactionFrameBasePtr> mKnownTxHashes;
+    TxHashMap<TransactionFrameBasePtr> mKnownTxHashes;
+    // Approximate memory held by the transactions of mKnownTxHashes
+    size_t mKnownTxBytes{0};
+    uint64_t mContentsVersion{0};
 
     size_t mBroadcastSeed;
 
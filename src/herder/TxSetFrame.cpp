@@ -226,15 +226,15 @@ transactionsToGeneralizedTransactionSetXDR(
 
 TxSetXDRFrame::TxSetXDRFrame(TransactionSet const& xdrTxSet)
     : mXDRTxSet(xdrTxSet)
-    , mEncodedSize(xdr::xdr_argpack_size(xdrTxSet))
+    , mEncoded(xdr::xdr_to_opaque(xdrTxSet))
     , mHash(computeNonGenericTxSetContentsHash(xdrTxSet))
 {
 }
 
 TxSetXDRFrame::TxSetXDRFrame(GeneralizedTransactionSet const& xdrTxSet)
     : mXDRTxSet(xdrTxSet)
-    , mEncodedSize(xdr::xdr_argpack_size(xdrTxSet))
-    , mHash(xdrSha256(xdrTxSet))
+    , mEncoded(xdr::xdr_to_opaque(xdrTxSet))
+    , mHash(sha256(mEncoded))
 {
 }
 
@@ -471,18 +471,7 @@ makeTxSetFromTransactions(TxSetTransactions txs, Application& app,
 StellarMessage
 TxSetXDRFrame::toStellarMessage() const
 {
-    StellarMessage newMsg;
-    if (isGeneralizedTxSet())
-    {
-        newMsg.type(GENERALIZED_TX_SET);
-        toXDR(newMsg.generalizedTxSet());
-    }
-    else
-    {
-        newMsg.type(TX_SET);
-        toXDR(newMsg.txSet());
-    }
-    return newMsg;
+    return *getStellarMessage();
 }
 
 #endif
@@ -699,7 +688,7 @@ TxSetXDRFrame::createTransactionFrames(Hash const& networkID) const
 size_t
 TxSetXDRFrame::encodedSize() const
 {
-    return mEncodedSize;
+    return mEncoded.size();
 }
 
 void
@@ -732,6 +721,41 @@ TxSetXDRFrame::storeXDR(StoredTransactionSet& txSet) const
     }
 }
 
+xdr::opaque_vec<>
+TxSetXDRFrame::encodeStoredXDR() const
+{
+    ZoneScoped;
+    // StoredTransactionSet is encoded as its discriminant followed by the
+    // encoding of the tx set
+    int32_t v = isGeneralizedTxSet() ? 1 : 0;
+    auto res = xdr::xdr_to_opaque(v);
+    res.insert(res.end(), mEncoded.begin(), mEncoded.end());
+    return res;
+}
+
+std::shared_ptr<StellarMessage const>
+TxSetXDRFrame::getStellarMessage() const
+{
+    std::lock_guard<std::mutex> lock(mStellarMessageMutex);
+    if (!mStellarMessage)
+    {
+        ZoneScoped;
+        auto msg = std::make_shared<StellarMessage>();
+        if (isGeneralizedTxSet())
+        {
+            msg->type(GENERALIZED_TX_SET);
+            toXDR(msg->generalizedTxSet());
+        }
+        else
+        {
+            msg->type(TX_SET);
+            toXDR(msg->txSet());
+        }
+        mStellarMessage = msg;
+    }
+    return mStellarMessage;
+}
+
 ApplicableTxSetFrame::ApplicableTxSetFrame(Application& app, bool isGeneralized,
                                            Hash const& previousLedgerHash,
                                            TxSetPhaseTransactions const& txs,
@@ -1463,11 +1487,17 @@ ApplicableTxSetFrame::applySurgePricing(Application& app)
                 std::make_shared<SorobanGenericLaneConfig>(limits);
 
             std::vector<bool> hadTxNotFittingLane;
+            std::vector<TxStackPtr> txStacks(actTxQueues.begin(),
+                                             actTxQueues.end());
             auto includedTxs =
-                SurgePricingPriorityQueue::getMostTopTxsWithinLimits(
-                    std::vector<TxStackPtr>(actTxQueues.begin(),
-                                            actTxQueues.end()),
-                    surgePricingLaneConfig, hadTxNotFittingLane);
+                app.getConfig().EXPERIMENTAL_SOROBAN_SCARCITY_PACKING
+                    ? SurgePricingPriorityQueue::
+                          getMostTopTxsByScarcityWithinLimits(
+                              txStacks, surgePricingLaneConfig,
+                              hadTxNotFittingLane)
+                    : SurgePricingPriorityQueue::getMostTopTxsWithinLimits(
+                          txStacks, surgePricingLaneConfig,
+                          hadTxNotFittingLane);
 
             size_t laneCount = surgePricingLaneConfig->getLaneLimits().size();
             std::vector<int64_t> lowestLaneFee(
@@ -13,6 +13,7 @@
 
 #include <deque>
 #include <functional>
+#include <mutex>
 #include <optional>
 #include <unordered_map>
 #include <variant>
@@ -129,6 +130,13 @@ class TxSetXDRFrame : public NonMovableOrCopyable
     void toXDR(TransactionSet& set) const;
     void toXDR(GeneralizedTransactionSet& generalizedTxSet) const;
     void storeXDR(StoredTransactionSet& txSet) const;
+    // Returns the XDR encoding of `storeXDR`'s output, built from the cached
+    // encoding of the tx set
+    xdr::opaque_vec<> encodeStoredXDR() const;
+
+    // Returns the message to send this tx set to peers. The message is built
+    // on the first call and shared by all the following ones.
+    std::shared_ptr<StellarMessage const> getStellarMessage() const;
 
     ~TxSetXDRFrame() = default;
 
@@ -167,8 +175,9 @@ class TxSetXDRFrame : public NonMovableOrCopyable
 
     // Creates transaction frames for all the transactions in the set, grouped
     // by phase.
-    // This is only necessary to serve a very specific use case of updating
-    // the transaction queue with wired tx sets. Otherwise, use
+    // This is only necessary to serve the very specific use cases of updating
+    // the transaction queue with wired tx sets and of measuring how much of a
+    // fetched tx set was already queued. Otherwise, use
     // getTransactionsForPhase() in `ApplicableTxSetFrame`.
     TxSetPhaseTransactions createTransactionFrames(Hash const& networkID) const;
 
@@ -183,8 +192,13 @@ class TxSetXDRFrame : public NonMovableOrCopyable
     TxSetXDRFrame(GeneralizedTransactionSet const& xdrTxSet);
 
     std::variant<TransactionSet, GeneralizedTransactionSet> mXDRTxSet;
-    size_t mEncodedSize{};
+    // Canonical XDR encoding of mXDRTxSet, computed once. The contents hash
+    // of generalized tx sets is computed from it.
+    xdr::opaque_vec<> const mEncoded;
     Hash mHash;
+
+    mutable std::mutex mStellarMessageMutex;
+    mutable std::shared_ptr<StellarMessage const> mStellarMessage;
 };
 
 // Transaction set that is suitable for being applied to the ledger.
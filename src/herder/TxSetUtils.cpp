@@ -7,11 +7,13 @@
 #include "crypto/Hex.h"
 #include "crypto/Random.h"
 #include "crypto/SHA.h"
+#include "crypto/SecretKey.h"
 #include "database/Database.h"
 #include "ledger/LedgerManager.h"
 #include "ledger/LedgerTxn.h"
 #include "ledger/LedgerTxnEntry.h"
 #include "ledger/LedgerTxnHeader.h"
+#include "ledger/LedgerTypeUtils.h"
 #include "main/Application.h"
 #include "main/Config.h"
 #include "transactions/TransactionUtils.h"
@@ -25,13 +27,109 @@
 
 #include <Tracy.hpp>
 #include <algorithm>
+#include <future>
 #include <list>
 #include <numeric>
+#include <optional>
 
 namespace stellar
 {
 namespace
 {
+// Smallest number of signatures worth verifying on a worker thread
+size_t const MIN_SIGNATURES_PER_VERIFY_TASK = 128;
+
+// Verifies the signatures of all the transactions of `accountTxQueues`, so
+// that checkValid finds them in the signature cache. The signatures are
+// partitioned on source account and, when called from the main thread with
+// enough of them, the partitions are verified on the worker threads while
+// the main thread verifies the first one. Signature checks of different
+// accounts are independent, so this doesn't change any validation result.
+void
+verifyTxSignatures(
+    Application& app, AbstractLedgerTxn& ltx,
+    std::vector<std::shared_ptr<AccountTransactionQueue>> const&
+        accountTxQueues)
+{
+    ZoneScoped;
+    std::vector<SignatureToVerify> sigs;
+    std::vector<size_t> accountEnds;
+    for (auto const& accountQueue : accountTxQueues)
+    {
+        for (auto const& tx : accountQueue->mTxs)
+        {
+            tx->insertSignaturesToVerify(ltx, sigs);
+        }
+        accountEnds.emplace_back(sigs.size());
+    }
+
+    size_t numTasks = 1;
+    if (threadIsMain())
+    {
+        numTasks = std::min<size_t>(app.getConfig().WORKER_THREADS + 1,
+                                    sigs.size() /
+                                        MIN_SIGNATURES_PER_VERIFY_TASK);
+    }
+    if (numTasks <= 1)
+    {
+        PubKeyUtils::verifySigs(sigs);
+        return;
+    }
+
+    // Cut the signatures into partitions of about the same size, only
+    // between accounts
+    std::vector<std::vector<SignatureToVerify>> partitions;
+    auto partitionSize = (sigs.size() + numTasks - 1) / numTasks;
+    size_t begin = 0;
+    for (auto end : accountEnds)
+    {
+        if (end - begin >= partitionSize ||
+            (end == sigs.size() && end > begin))
+        {
+            partitions.emplace_back(sigs.begin() + begin, sigs.begin() + end);
+            begin = end;
+        }
+    }
+
+    using task_t = std::packaged_task<void()>;
+    std::vector<std::future<void>> futures;
+    for (size_t i = 1; i < partitions.size(); ++i)
+    {
+        auto task = std::make_shared<task_t>([&partition = partitions[i]] {
+            PubKeyUtils::verifySigs(partition);
+        });
+        futures.emplace_back(task->get_future());
+        app.postOnBackgroundThread([task] { (*task)(); },
+                                   "TxSetUtils: verify signatures",
+                                   WorkerPriority::CRITICAL);
+    }
+
+    std::exception_ptr inlineError;
+    try
+    {
+        PubKeyUtils::verifySigs(partitions.front());
+    }
+    catch (...)
+    {
+        inlineError = std::current_exception();
+    }
+
+    // Tasks reference the partitions, so wait for all of them before
+    // returning, even on error
+    for (auto& f : futures)
+    {
+        f.wait();
+    }
+    if (inlineError)
+    {
+        std::rethrow_exception(inlineError);
+    }
+    for (auto& f : futures)
+    {
+        f.get();
+    }
+}
+
 // Target use case is to remove a subset of invalid transactions from a TxSet.
 // I.e. txSet.size() >= txsToRemove.size()
 TxSetTransactions
@@ -154,6 +252,116 @@ TxSetUtils::buildAccountTxQueues(TxSetTransactions const& txs)
     return queues;
 }
 
+std::vector<TxSetTransactions>
+TxSetUtils::buildSorobanApplyClusters(TxSetTransactions const& txs)
+{
+    ZoneScoped;
+
+    // Union-find over the positions of txs, the root of a set is always its
+    // first transaction
+    std::vector<size_t> parent(txs.size());
+    std::iota(parent.begin(), parent.end(), 0);
+    auto find = [&](size_t i) {
+        while (parent[i] != i)
+        {
+            parent[i] = parent[parent[i]];
+            i = parent[i];
+        }
+        return i;
+    };
+    auto unite = [&](size_t a, size_t b) {
+        a = find(a);
+        b = find(b);
+        if (a != b)
+        {
+            parent[std::max(a, b)] = std::min(a, b);
+        }
+    };
+
+    // For every key, a transaction that wrote it and all transactions that
+    // read it since. Readers only conflict with writers, so they are merged
+    // into the writer's cluster on the next write.
+    struct KeyAccess
+    {
+        std::optional<size_t> mWriter;
+        std::vector<size_t> mReaders;
+    };
+    UnorderedMap<LedgerKey, KeyAccess> accesses;
+
+    for (size_t i = 0; i < txs.size(); ++i)
+    {
+        auto const& tx = txs[i];
+        releaseAssert(tx->isSoroban());
+
+        UnorderedSet<LedgerKey> writes;
+        tx->insertKeysForFeeProcessing(writes);
+        tx->insertKeysForTxApply(writes);
+        writes.emplace(accountKey(tx->getSourceID()));
+
+        auto const& footprint = tx->sorobanResources().footprint;
+        for (auto const& key : footprint.readWrite)
+        {
+            writes.emplace(key);
+            if (isSorobanEntry(key))
+            {
+                writes.emplace(getTTLKey(key));
+            }
+        }
+        for (auto const& key : footprint.readOnly)
+        {
+            if (isSorobanEntry(key))
+            {
+                writes.emplace(getTTLKey(key));
+            }
+        }
+
+        for (auto const& key : writes)
+        {
+            auto& access = accesses[key];
+            if (access.mWriter)
+            {
+                unite(*access.mWriter, i);
+            }
+            for (auto reader : access.mReaders)
+            {
+                unite(reader, i);
+            }
+            access.mReaders.clear();
+            access.mWriter = i;
+        }
+
+        for (auto const& key : footprint.readOnly)
+        {
+            if (writes.find(key) != writes.end())
+            {
+                continue;
+            }
+            auto& access = accesses[key];
+            if (access.mWriter)
+            {
+                unite(*access.mWriter, i);
+            }
+            else
+            {
+                access.mReaders.emplace_back(i);
+            }
+        }
+    }
+
+    std::vector<TxSetTransactions> clusters;
+    UnorderedMap<size_t, size_t> clusterIndex;
+    for (size_t i = 0; i < txs.size(); ++i)
+    {
+        auto it = clusterIndex.emplace(find(i), clusters.size()).first;
+        if (it->second == clusters.size())
+        {
+            clusters.emplace_back();
+        }
+        clusters[it->second].emplace_back(txs[i]);
+    }
+    return clusters;
+}
+
 TxSetTransactions
 TxSetUtils::getInvalidTxList(TxSetTransactions const& txs, Application& app,
                              uint64_t lowerBoundCloseTimeOffset,
@@ -172,10 +380,12 @@ TxSetUtils::getInvalidTxList(TxSetTransactions const& txs, Application& app,
             app.getLedgerManager().getLastClosedLedgerNum() + 1;
     }
 
+    auto accountTxQueues = buildAccountTxQueues(txs);
+    verifyTxSignatures(app, ltx, accountTxQueues);
+
     UnorderedMap<AccountID, int64_t> accountFeeMap;
     TxSetTransactions invalidTxs;
 
-    auto accountTxQueues = buildAccountTxQueues(txs);
     for (auto& accountQueue : accountTxQueues)
     {
         int64_t lastSeq = 0;
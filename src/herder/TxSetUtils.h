@@ -43,6 +43,18 @@ class TxSetUtils
     static std::vector<std::shared_ptr<AccountTransactionQueue>>
     buildAccountTxQueues(TxSetTransactions const& txs);
 
+    // Partitions Soroban transactions, given in apply order, into clusters
+    // such that no two transactions in different clusters access the same
+    // ledger entry unless both only read it. Entries are taken from the
+    // declared footprints plus the accounts each transaction touches. The
+    // TTL entries of read-only footprint entries are treated as written,
+    // since extending them is order dependent. Clusters are ordered by their
+    // first transaction and each keeps the apply order, so applying clusters
+    // one after the other, or independently of each other, gives the same
+    // result as applying txs in order.
+    static std::vector<TxSetTransactions>
+    buildSorobanApplyClusters(TxSetTransactions const& txs);
+
     // Returns transactions from a TxSet that are invalid. If
     // returnEarlyOnFirstInvalidTx is true, return immediately if an invalid
     // transaction is found (instead of finding all of them), this is useful for
@@ -773,10 +773,11 @@ Upgrades::storeUpgradeHistory(Database& db, uint32_t ledgerSeq,
 }
 
 void
-Upgrades::deleteOldEntries(Database& db, uint32_t ledgerSeq, uint32_t count)
+Upgrades::deleteOldEntries(soci::session& sess, uint32_t ledgerSeq,
+                           uint32_t count)
 {
     ZoneScoped;
-    DatabaseUtils::deleteOldEntriesHelper(db.getSession(), ledgerSeq, count,
+    DatabaseUtils::deleteOldEntriesHelper(sess, ledgerSeq, count,
                                           "upgradehistory", "ledgerseq");
 }
 
@@ -3,6 +3,7 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "herder/HerderImpl.h"
+#include "herder/HerderPersistence.h"
 #include "herder/LedgerCloseData.h"
 #include "herder/test/TestTxSetUtils.h"
 #include "main/Application.h"
@@ -17,6 +18,7 @@
 #include "history/test/HistoryTestsUtils.h"
 
 #include "catchup/CatchupManagerImpl.h"
+#include "crypto/KeyUtils.h"
 #include "crypto/SHA.h"
 #include "database/Database.h"
 #include "herder/HerderUtils.h"
@@ -26,6 +28,9 @@
 #include "ledger/LedgerTxnHeader.h"
 #include "lib/catch.hpp"
 #include "main/CommandHandler.h"
+#include "main/PersistentState.h"
+#include "medida/histogram.h"
+#include "medida/metrics_registry.h"
 #include "overlay/OverlayManager.h"
 #include "overlay/OverlayMetrics.h"
 #include "test/TxTests.h"
@@ -47,6 +52,7 @@
 #include <fmt/format.h>
 #include <numeric>
 #include <optional>
+#include <set>
 
 using namespace stellar;
 using namespace stellar::txbridge;
@@ -2644,6 +2650,14 @@ testSCPDriver(uint32 protocolVersion, uint32_t maxTxSetSize, size_t expectedOps)
             auto balV = makeTxPair(herder, txSet0, ct);
             REQUIRE(scp.validateValue(seq, balV.first, false) ==
                     SCPDriver::kFullyValidatedValue);
+
+            // the same value seen again is answered from the cache
+            auto& cacheHits = app->getMetrics().NewMeter(
+                {"scp", "value", "cache-hit"}, "value");
+            auto hits = cacheHits.count();
+            REQUIRE(scp.validateValue(seq, balV.first, false) ==
+                    SCPDriver::kFullyValidatedValue);
+            REQUIRE(cacheHits.count() == hits + 1);
         }
         SECTION("invalid")
         {
@@ -3555,6 +3569,122 @@ TEST_CASE("tx queue source account limit", "[herder][transactionqueue]")
     }
 }
 
+TEST_CASE("tx set candidate", "[herder][txset]")
+{
+    SIMULATION_CREATE_NODE(0);
+
+    Config cfg(getTestConfig(0, Config::TESTDB_DEFAULT));
+    cfg.MANUAL_CLOSE = false;
+    cfg.NODE_SEED = v0SecretKey;
+    cfg.QUORUM_SET.threshold = 1;
+    cfg.QUORUM_SET.validators.clear();
+    cfg.QUORUM_SET.validators.push_back(v0NodeID);
+    cfg.EXPERIMENTAL_TX_SET_CANDIDATE_REFRESH_MS = 100;
+
+    VirtualClock clock;
+    Application::pointer app = createTestApplication(clock, cfg);
+    auto root = TestAccount::createRoot(*app);
+    auto a1 = TestAccount{*app, getAccount("A")};
+    auto& hits = app->getMetrics().NewMeter(
+        {"herder", "tx-set-candidate", "hit"}, "txset");
+
+    auto closeLedgers = [&](uint32_t count) {
+        auto target = app->getLedgerManager().getLastClosedLedgerNum() + count;
+        auto deadline = clock.now() + (count + 1) *
+                                          Herder::EXP_LEDGER_TIMESPAN_SECONDS;
+        while (app->getLedgerManager().getLastClosedLedgerNum() < target &&
+               clock.now() < deadline)
+        {
+            clock.crank(true);
+        }
+        REQUIRE(app->getLedgerManager().getLastClosedLedgerNum() >= target);
+    };
+
+    closeLedgers(1);
+    auto tx = root.tx({createAccount(
+        a1, app->getLedgerManager().getLastMinBalance(0))});
+    REQUIRE(app->getHerder().recvTransaction(tx, false) ==
+            TransactionQueue::AddResult::ADD_STATUS_PENDING);
+
+    // The candidate built after the tx was received is nominated as is
+    auto hitsBefore = hits.count();
+    closeLedgers(1);
+    REQUIRE(hits.count() > hitsBefore);
+    REQUIRE(a1.exists());
+}
+
+TEST_CASE("transaction queue is restored after restart", "[herder][txqueue]")
+{
+    Config cfg(getTestConfig(0, Config::TESTDB_ON_DISK_SQLITE));
+    cfg.EXPERIMENTAL_PERSIST_TX_QUEUE = true;
+
+    TransactionFrameBasePtr tx;
+    {
+        VirtualClock clock;
+        auto app = createTestApplication(clock, cfg);
+        auto root = TestAccount::createRoot(*app);
+        auto minBalance = app->getLedgerManager().getLastMinBalance(0);
+        tx = root.tx({createAccount(getAccount("A"), minBalance)});
+        REQUIRE(app->getHerder().recvTransaction(tx, false) ==
+                TransactionQueue::AddResult::ADD_STATUS_PENDING);
+        app->gracefulStop();
+    }
+
+    VirtualClock clock;
+    auto app = createTestApplication(clock, cfg, /* newDB */ false);
+    REQUIRE(app->getPersistentState()
+                .getState(PersistentState::kTxQueue)
+                .empty());
+    testutil::crankFor(clock, std::chrono::seconds(1));
+    REQUIRE(app->getHerder().getTx(tx->getFullHash()));
+}
+
+TEST_CASE("adaptive ledger trigger", "[herder]")
+{
+    SIMULATION_CREATE_NODE(0);
+
+    Config cfg(getTestConfig(0, Config::TESTDB_DEFAULT));
+    cfg.MANUAL_CLOSE = false;
+    cfg.NODE_SEED = v0SecretKey;
+    cfg.QUORUM_SET.threshold = 1;
+    cfg.QUORUM_SET.validators.clear();
+    cfg.QUORUM_SET.validators.push_back(v0NodeID);
+    cfg.EXPERIMENTAL_ADAPTIVE_TRIGGER_MAX_ADVANCE_MS = 1000;
+
+    VirtualClock clock;
+    Application::pointer app = createTestApplication(clock, cfg);
+    auto root = TestAccount::createRoot(*app);
+    auto& advance =
+        app->getMetrics().NewHistogram({"herder", "trigger", "advance"});
+
+    auto closeLedger = [&]() {
+        auto target = app->getLedgerManager().getLastClosedLedgerNum() + 1;
+        auto deadline = clock.now() + 2 * Herder::EXP_LEDGER_TIMESPAN_SECONDS;
+        while (app->getLedgerManager().getLastClosedLedgerNum() < target &&
+               clock.now() < deadline)
+        {
+            clock.crank(true);
+        }
+        REQUIRE(app->getLedgerManager().getLastClosedLedgerNum() >= target);
+    };
+
+    closeLedger();
+    auto triggers = advance.count();
+    for (int i = 0; i < 3; ++i)
+    {
+        auto a = TestAccount{*app, getAccount(fmt::format("A{}", i))};
+        auto tx = root.tx({createAccount(
+            a, app->getLedgerManager().getLastMinBalance(0))});
+        REQUIRE(app->getHerder().recvTransaction(tx, false) ==
+                TransactionQueue::AddResult::ADD_STATUS_PENDING);
+        closeLedger();
+        REQUIRE(a.exists());
+    }
+    // Every trigger was recorded, and none moved by more than the limit
+    REQUIRE(advance.count() > triggers);
+    REQUIRE(advance.max() <= 1000);
+}
+
 TEST_CASE("soroban txs each parameter surge priced", "[soroban][herder]")
 {
     auto networkID = sha256(getTestConfig().NETWORK_PASSPHRASE);
@@ -6064,4 +6194,98 @@ TEST_CASE("SCP message capture from previous ledger", "[herder]")
     // check ensures that C does not double count messages from ledger 2 when
     // closing ledger 3.
     REQUIRE(checkSCPHistoryEntries(C, 2, expectedTypes));
-}
\ No newline at end of file
+}
+TEST_CASE("save SCP history upserts quorum information", "[herder]")
+{
+    VirtualClock clock;
+    auto app = createTestApplication(clock, getTestConfig());
+    auto& herder = static_cast<HerderImpl&>(app->getHerder());
+    auto& db = app->getDatabase();
+    auto& persistence = app->getHerderPersistence();
+
+    auto const& nodeID = herder.getSCP().getLocalNodeID();
+    auto localQSet =
+        std::make_shared<SCPQuorumSet>(herder.getSCP().getLocalQuorumSet());
+    auto localQSetHash = xdrSha256(*localQSet);
+    auto otherQSet = std::make_shared<SCPQuorumSet>(*localQSet);
+    otherQSet->validators.emplace_back(
+        SecretKey::pseudoRandomForTesting().getPublicKey());
+    auto otherQSetHash = xdrSha256(*otherQSet);
+
+    SCPEnvelope env;
+    env.statement.nodeID = nodeID;
+    env.statement.pledges.type(SCP_ST_EXTERNALIZE);
+    env.statement.pledges.externalize().commitQuorumSetHash = localQSetHash;
+
+    auto lastSeen = [&](Hash const& qSetHash) {
+        uint32_t seq = 0;
+        std::string qSetHashHex = binToHex(qSetHash);
+        db.getSession()
+            << "SELECT lastledgerseq FROM scpquorums WHERE qsethash = :h",
+            soci::into(seq), soci::use(qSetHashHex);
+        return seq;
+    };
+    auto nodeQSet = [&]() {
+        return HerderPersistence::getNodeQuorumSet(db, db.getSession(),
+                                                   nodeID);
+    };
+
+    QuorumTracker::QuorumMap qmap;
+    qmap[nodeID] = QuorumTracker::NodeInfo{localQSet, 0};
+    persistence.saveSCPHistory(5, {env}, qmap);
+    REQUIRE(lastSeen(localQSetHash) == 5);
+    REQUIRE(nodeQSet() == std::make_optional(localQSetHash));
+
+    // the node's qset is replaced, quorum sets only move forward
+    qmap[nodeID] = QuorumTracker::NodeInfo{otherQSet, 0};
+    persistence.saveSCPHistory(3, {env}, qmap);
+    REQUIRE(nodeQSet() == std::make_optional(otherQSetHash));
+    REQUIRE(lastSeen(localQSetHash) == 5);
+    REQUIRE(lastSeen(otherQSetHash) == 3);
+
+    persistence.saveSCPHistory(7, {env}, QuorumTracker::QuorumMap());
+    REQUIRE(lastSeen(localQSetHash) == 7);
+    REQUIRE(lastSeen(otherQSetHash) == 3);
+    REQUIRE(nodeQSet() == std::make_optional(otherQSetHash));
+}
+
+TEST_CASE("SCP phases are attributed to validators", "[herder]")
+{
+    auto networkID = sha256(getTestConfig().NETWORK_PASSPHRASE);
+    auto simulation = Topologies::core(4, 0.75, Simulation::OVER_LOOPBACK,
+                                       networkID, [](int i) {
+                                           return getTestConfig(i);
+                                       });
+    simulation->startAllNodes();
+    simulation->crankUntil(
+        [&]() { return simulation->haveAllExternalized(3, 1); },
+        5 * Herder::EXP_LEDGER_TIMESPAN_SECONDS, false);
+
+    auto node = simulation->getNodes()[0];
+    auto& herder = static_cast<HerderImpl&>(node->getHerder());
+    std::set<std::string> others;
+    for (auto const& n : simulation->getNodes())
+    {
+        if (n != node)
+        {
+            others.insert(
+                KeyUtils::toStrKey(n->getConfig().NODE_SEED.getPublicKey()));
+        }
+    }
+
+    auto phases = herder.getJsonInfo(5, true)["phases"];
+    auto slot = phases[std::to_string(
+        node->getLedgerManager().getLastClosedLedgerNum())];
+    REQUIRE(slot["nominated"].asBool());
+    for (auto const& name :
+         {"first_candidate", "prepare", "confirm_prepared", "externalize"})
+    {
+        REQUIRE(slot.isMember(name));
+    }
+    REQUIRE(slot["first_candidate"]["ms"].asInt64() >= 0);
+    REQUIRE(slot["externalize"]["ms"].asInt64() >=
+            slot["confirm_prepared"]["ms"].asInt64());
+    // thresholds need other validators, so their messages complete them
+    REQUIRE(slot["externalize"].isMember("by"));
+    REQUIRE(others.count(slot["externalize"]["by"].asString()) == 1);
+}
@@ -157,6 +157,14 @@ TEST_CASE("PendingEnvelopes recvSCPEnvelope", "[herder]")
 
             REQUIRE(pendingEnvelopes.recvSCPEnvelope(saneEnvelope) ==
                     Herder::ENVELOPE_STATUS_PROCESSED);
+
+            // envelopes are told apart by hash, signature included
+            auto resigned = saneEnvelope;
+            resigned.signature.back() ^= 1;
+            REQUIRE(pendingEnvelopes.recvSCPEnvelope(resigned) ==
+                    Herder::ENVELOPE_STATUS_READY);
+            REQUIRE(pendingEnvelopes.recvSCPEnvelope(resigned) ==
+                    Herder::ENVELOPE_STATUS_PROCESSED);
         }
 
         SECTION("process when all data came (tx set first)")
@@ -189,6 +197,33 @@ TEST_CASE("PendingEnvelopes recvSCPEnvelope", "[herder]")
         }
     }
 
+    SECTION("measure fetched txset overlap with the transaction queue")
+    {
+        auto& fetched = app->getMetrics().NewMeter(
+            {"overlay", "fetch", "txset-tx"}, "transaction");
+        auto& known = app->getMetrics().NewMeter(
+            {"overlay", "fetch", "txset-known-tx"}, "transaction");
+        auto& fetchedBytes = app->getMetrics().NewMeter(
+            {"overlay", "fetch", "txset-tx-byte"}, "byte");
+        auto fetchedBefore = fetched.count();
+        auto knownBefore = known.count();
+        auto bytesBefore = fetchedBytes.count();
+
+        REQUIRE(pendingEnvelopes.recvSCPEnvelope(saneEnvelope) ==
+                Herder::ENVELOPE_STATUS_FETCHING);
+        REQUIRE(pendingEnvelopes.recvTxSet(p.second->getContentsHash(),
+                                           p.second));
+        // None of the transactions were submitted to this node
+        REQUIRE(fetched.count() == fetchedBefore + numAccounts);
+        REQUIRE(known.count() == knownBefore);
+        REQUIRE(fetchedBytes.count() > bytesBefore);
+
+        // Txsets that were not fetched are not counted
+        REQUIRE(!pendingEnvelopes.recvTxSet(p.second->getContentsHash(),
+                                            p.second));
+        REQUIRE(fetched.count() == fetchedBefore + numAccounts);
+    }
+
     SECTION("process when data added manually")
     {
         SECTION("as not-removable")
@@ -330,6 +365,39 @@ TEST_CASE("PendingEnvelopes recvSCPEnvelope", "[herder]")
         }
     }
 
+    SECTION("drop slots furthest from consensus over the memory limit")
+    {
+        auto first = lcl.header.ledgerSeq + 1;
+        for (uint64_t slot = first; slot < first + 3; ++slot)
+        {
+            REQUIRE(pendingEnvelopes.recvSCPEnvelope(makeEnvelope(
+                        p, saneQSetHash, slot)) ==
+                    Herder::ENVELOPE_STATUS_FETCHING);
+        }
+        auto& evicted = app->getMetrics().NewMeter(
+            {"scp", "pending", "evicted-slot"}, "slot");
+        auto evictedBefore = evicted.count();
+
+        pendingEnvelopes.setMemoryLimitForTesting(1);
+
+        // only the slot consensus works on (or the newest one when not
+        // tracking) is left
+        auto kept = herder.isTracking() ? first : first + 2;
+        auto info = pendingEnvelopes.getJsonInfo(10);
+        REQUIRE(info.size() == 1);
+        REQUIRE(info.isMember(std::to_string(kept)));
+        REQUIRE(evicted.count() >= evictedBefore + 2);
+
+        // an evicted slot's envelopes are fetched again when they come back
+        auto dropped = herder.isTracking() ? first + 2 : first;
+        pendingEnvelopes.setMemoryLimitForTesting(0);
+        REQUIRE(pendingEnvelopes.recvSCPEnvelope(makeEnvelope(
+                    p, saneQSetHash, dropped)) ==
+                Herder::ENVELOPE_STATUS_FETCHING);
+        REQUIRE(pendingEnvelopes.getJsonInfo(10).isMember(
+            std::to_string(dropped)));
+    }
+
     SECTION("do not fetch if txsets are not signed")
     {
         auto p2 = makeTxPair(txSet, 10, STELLAR_VALUE_BASIC);
@@ -4,6 +4,7 @@
 
 #include "crypto/Hex.h"
 #include "crypto/SHA.h"
+#include "herder/QuorumIntersectionCNF.h"
 #include "herder/QuorumIntersectionChecker.h"
 #include "lib/catch.hpp"
 #include "main/Config.h"
@@ -12,8 +13,12 @@
 #include "util/Logging.h"
 #include "util/Math.h"
 #include "xdrpp/marshal.h"
+#include <algorithm>
 #include <fmt/format.h>
+#include <functional>
 #include <lib/json/json.h>
+#include <optional>
+#include <sstream>
 #include <thread>
 #include <xdrpp/autocheck.h>
 
@@ -903,6 +908,94 @@ TEST_CASE("quorum intersection interruption", "[herder][quorumintersection]")
     canceller2.join();
 }
 
+TEST_CASE("quorum intersection on several threads",
+          "[herder][quorumintersection]")
+{
+    QuorumIntersectionChecker::clearCachedResults();
+    auto orgs = generateOrgs(8, {3, 3, 3, 3, 2, 2, 2, 2});
+    std::vector<std::pair<size_t, size_t>> edges = {
+        {0, 1}, {0, 2}, {0, 3}, {1, 2}, {1, 3}, {2, 3}};
+    Config cfg(getTestConfig());
+    cfg = configureShortNames(cfg, orgs);
+    cfg.QUORUM_INTERSECTION_CHECKER_THREADS = 4;
+    std::atomic<bool> flag{false};
+
+    SECTION("balanced core-and-periphery")
+    {
+        edges.insert(edges.end(), {{0, 4},
+                                   {1, 4},
+                                   {1, 5},
+                                   {3, 5},
+                                   {2, 6},
+                                   {0, 6},
+                                   {3, 7},
+                                   {2, 7}});
+        auto qm = interconnectOrgsBidir(orgs, edges);
+        auto qic =
+            QuorumIntersectionChecker::create(qm, cfg, flag, gRandomEngine());
+        REQUIRE(qic->networkEnjoysQuorumIntersection());
+        REQUIRE(qic->getMaxQuorumsFound() != 0);
+    }
+    SECTION("unbalanced core-and-periphery")
+    {
+        edges.insert(edges.end(), {{0, 4},
+                                   {1, 4},
+                                   {0, 5},
+                                   {1, 5},
+                                   {2, 6},
+                                   {3, 6},
+                                   {2, 7},
+                                   {3, 7}});
+        auto qm = interconnectOrgsBidir(orgs, edges);
+        auto qic =
+            QuorumIntersectionChecker::create(qm, cfg, flag, gRandomEngine());
+        REQUIRE(!qic->networkEnjoysQuorumIntersection());
+        auto split = qic->getPotentialSplit();
+        REQUIRE(!split.first.empty());
+        REQUIRE(!split.second.empty());
+        for (auto const& n : split.first)
+        {
+            REQUIRE(std::find(split.second.begin(), split.second.end(), n) ==
+                    split.second.end());
+        }
+    }
+}
+
+TEST_CASE("quorum intersection reuses results for the same scan SCC",
+          "[herder][quorumintersection]")
+{
+    QuorumIntersectionChecker::clearCachedResults();
+    auto orgs = generateOrgs(8, {3, 3, 3, 3, 2, 2, 2, 2});
+    auto qm = interconnectOrgsBidir(orgs, {{0, 1},
+                                           {0, 2},
+                                           {0, 3},
+                                           {1, 2},
+                                           {1, 3},
+                                           {2, 3},
+                                           {0, 4},
+                                           {1, 5},
+                                           {2, 6},
+                                           {3, 7}});
+    Config cfg(getTestConfig());
+    cfg = configureShortNames(cfg, orgs);
+    std::atomic<bool> flag{false};
+    auto first =
+        QuorumIntersectionChecker::create(qm, cfg, flag, gRandomEngine());
+    REQUIRE(!first->networkEnjoysQuorumIntersection());
+    auto scanned = first->getMaxQuorumsFound();
+
+    // A node that isn't part of the network's SCCs with quorums doesn't
+    // change the result, nor require scanning again
+    PublicKey outsider = SecretKey::pseudoRandomForTesting().getPublicKey();
+    qm[outsider] = QuorumTracker::NodeInfo{
+        make_shared<QS>(1, VK({orgs[0][0]}), VQ{}), 0};
+    auto second =
+        QuorumIntersectionChecker::create(qm, cfg, flag, gRandomEngine());
+    REQUIRE(!second->networkEnjoysQuorumIntersection());
+    REQUIRE(second->getPotentialSplit() == first->getPotentialSplit());
+    REQUIRE(second->getMaxQuorumsFound() < scanned);
+}
+
 static void
 debugQmap(Config const& cfg, QuorumTracker::QuorumMap const& qm)
 {
@@ -1051,3 +1144,187 @@ TEST_CASE("quorum intersection finds smaller SCC with quorums",
     REQUIRE(qic->networkEnjoysQuorumIntersection());
     REQUIRE(qic->getMaxQuorumsFound() != 0);
 }
+
+// Small DPLL solver for the formulas of QuorumIntersectionCNF: returns a model
+// (indexed by variable) if the clauses are satisfiable.
+static std::optional<std::vector<bool>>
+solveCNF(size_t numVariables,
+         std::vector<QuorumIntersectionCNF::Clause> const& clauses)
+{
+    // 0 is unassigned, 1 true, -1 false
+    std::vector<int> values(numVariables + 1, 0);
+    auto valueOf = [&](QuorumIntersectionCNF::Literal l) {
+        return l > 0 ? values[l] : -values[-l];
+    };
+    std::function<bool()> search = [&]() {
+        std::vector<QuorumIntersectionCNF::Literal> assigned;
+        auto undo = [&]() {
+            for (auto v : assigned)
+            {
+                values[v] = 0;
+            }
+            return false;
+        };
+        // Unit propagation
+        bool changed = true;
+        while (changed)
+        {
+            changed = false;
+            for (auto const& c : clauses)
+            {
+                size_t unassigned = 0;
+                QuorumIntersectionCNF::Literal last = 0;
+                bool satisfied = false;
+                for (auto l : c)
+                {
+                    auto v = valueOf(l);
+                    if (v > 0)
+                    {
+                        satisfied = true;
+                        break;
+                    }
+                    if (v == 0)
+                    {
+                        ++unassigned;
+                        last = l;
+                    }
+                }
+                if (satisfied)
+                {
+                    continue;
+                }
+                if (unassigned == 0)
+                {
+                    return undo();
+                }
+                if (unassigned == 1)
+                {
+                    values[std::abs(last)] = last > 0 ? 1 : -1;
+                    assigned.emplace_back(std::abs(last));
+                    changed = true;
+                }
+            }
+        }
+        auto it = std::find(values.begin() + 1, values.end(), 0);
+        if (it == values.end())
+        {
+            return true;
+        }
+        auto var = it - values.begin();
+        for (int value : {-1, 1})
+        {
+            values[var] = value;
+            if (search())
+            {
+                return true;
+            }
+        }
+        values[var] = 0;
+        return undo();
+    };
+    if (!search())
+    {
+        return std::nullopt;
+    }
+    std::vector<bool> model(numVariables + 1, false);
+    for (size_t v = 1; v <= numVariables; ++v)
+    {
+        model[v] = values[v] > 0;
+    }
+    return model;
+}
+
+static void
+checkCNFAgreesWithChecker(QuorumTracker::QuorumMap const& qm)
+{
+    QuorumIntersectionChecker::QuorumSetMap qmap;
+    for (auto const& p : qm)
+    {
+        qmap.emplace(p.first, p.second.mQuorumSet);
+    }
+    QuorumIntersectionCNF cnf(qmap);
+
+    Config cfg(getTestConfig());
+    std::atomic<bool> flag{false};
+    auto qic =
+        QuorumIntersectionChecker::create(qm, cfg, flag, gRandomEngine());
+    bool intersects = qic->networkEnjoysQuorumIntersection();
+
+    auto model = solveCNF(cnf.getNumVariables(), cnf.getClauses());
+    REQUIRE(model.has_value() == !intersects);
+    if (model)
+    {
+        auto split = cnf.getSplit(*model);
+        auto isQuorum = [&](std::vector<NodeID> const& nodes) {
+            if (nodes.empty())
+            {
+                return false;
+            }
+            for (auto const& n : nodes)
+            {
+                if (!LocalNode::isQuorumSlice(*qmap.at(n), nodes))
+                {
+                    return false;
+                }
+            }
+            return true;
+        };
+        REQUIRE(isQuorum(split.first));
+        REQUIRE(isQuorum(split.second));
+        for (auto const& n : split.first)
+        {
+            REQUIRE(std::find(split.second.begin(), split.second.end(), n) ==
+                    split.second.end());
+        }
+    }
+
+    std::ostringstream out;
+    cnf.writeDimacs(out, std::nullopt);
+    REQUIRE(out.str().find(fmt::format("p cnf {} {}\n", cnf.getNumVariables(),
+                                       cnf.getClauses().size())) !=
+            std::string::npos);
+}
+
+TEST_CASE("quorum intersection as CNF formula", "[herder][quorumintersection]")
+{
+    SECTION("flat 4-node")
+    {
+        for (uint32_t threshold : {1, 2, 3})
+        {
+            QuorumTracker::QuorumMap qm;
+            VK keys;
+            for (size_t i = 0; i < 4; ++i)
+            {
+                keys.emplace_back(
+                    SecretKey::pseudoRandomForTesting().getPublicKey());
+            }
+            for (auto const& k : keys)
+            {
+                VK others;
+                std::copy_if(keys.begin(), keys.end(),
+                             std::back_inserter(others),
+                             [&](PublicKey const& o) { return !(o == k); });
+                qm[k] = QuorumTracker::NodeInfo{
+                    make_shared<QS>(threshold, others, VQ{}), 0};
+            }
+            checkCNFAgreesWithChecker(qm);
+        }
+    }
+    SECTION("3-org open line")
+    {
+        checkCNFAgreesWithChecker(
+            interconnectOrgsBidir(generateOrgs(3, {3}), {{0, 1}, {1, 2}}));
+        checkCNFAgreesWithChecker(
+            interconnectOrgsBidir(generateOrgs(3, {2}), {{0, 1}, {1, 2}}));
+    }
+    SECTION("3-org closed ring")
+    {
+        checkCNFAgreesWithChecker(interconnectOrgsBidir(
+            generateOrgs(3, {3}), {{0, 1}, {1, 2}, {0, 2}}));
+    }
+    SECTION("3-org 2-node closed one-way ring")
+    {
+        checkCNFAgreesWithChecker(interconnectOrgsUnidir(
+            generateOrgs(3, {2}), {{0, 1}, {1, 2}, {2, 0}}));
+    }
+}
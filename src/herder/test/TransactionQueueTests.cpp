@@ -2,6 +2,7 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
+#include "crypto/Random.h"
 #include "crypto/SecretKey.h"
 #include "herder/Herder.h"
 #include "herder/HerderImpl.h"
@@ -11,6 +12,8 @@
 #include "herder/TxSetFrame.h"
 #include "herder/TxSetUtils.h"
 #include "ledger/LedgerHashUtils.h"
+#include "medida/counter.h"
+#include "medida/metrics_registry.h"
 #include "test/TestAccount.h"
 #include "test/TestUtils.h"
 #include "test/TxTests.h"
@@ -1073,6 +1076,249 @@ TEST_CASE("TxQueueLimiter with limited source accounts",
     }
 }
 
+TEST_CASE("SurgePricingPriorityQueue ordering", "[herder][transactionqueue]")
+{
+    VirtualClock clock;
+    auto app = createTestApplication(clock, getTestConfig());
+    auto root = TestAccount::createRoot(*app);
+
+    std::vector<TxStackPtr> txStacks;
+    int64_t totalOps = 0;
+    for (int i = 1; i <= 300; ++i)
+    {
+        auto nbOps = rand_uniform<int>(1, 3);
+        auto fee = rand_uniform<uint32_t>(100, 300) * nbOps;
+        txStacks.emplace_back(std::make_shared<SingleTxStack>(
+            transaction(*app, root, i, 1, fee, nbOps)));
+        totalOps += nbOps;
+    }
+    // The queue is full, so adding anything requires evictions
+    auto laneConfig = std::make_shared<DexLimitingLaneConfig>(
+        Resource(totalOps), std::nullopt);
+
+    auto checkOrder = [](std::vector<TransactionFrameBasePtr> const& txs,
+                         bool highestFirst) {
+        for (size_t i = 1; i < txs.size(); ++i)
+        {
+            auto cmp = feeRate3WayCompare(
+                txs[i - 1]->getInclusionFee(), txs[i - 1]->getNumOperations(),
+                txs[i]->getInclusionFee(), txs[i]->getNumOperations());
+            REQUIRE((highestFirst ? cmp >= 0 : cmp <= 0));
+        }
+    };
+
+    SECTION("visit after erase")
+    {
+        SurgePricingPriorityQueue queue(/* isHighestPriority */ true,
+                                        laneConfig, 1);
+        for (auto const& txStack : txStacks)
+        {
+            queue.add(txStack);
+        }
+        size_t erased = 0;
+        for (size_t i = 0; i < txStacks.size(); i += 3)
+        {
+            queue.erase(txStacks[i]);
+            totalOps -= txStacks[i]->getTopTx()->getNumOperations();
+            ++erased;
+        }
+        REQUIRE(queue.totalResources() == Resource(totalOps));
+
+        std::vector<TransactionFrameBasePtr> visited;
+        std::vector<Resource> laneLeft;
+        queue.visitTopTxs(
+            {},
+            [&](TxStack const& txStack) {
+                visited.emplace_back(txStack.getTopTx());
+                return SurgePricingPriorityQueue::VisitTxStackResult::
+                    TX_SKIPPED;
+            },
+            laneLeft);
+        REQUIRE(visited.size() == txStacks.size() - erased);
+        checkOrder(visited, true);
+    }
+    SECTION("eviction walks lowest fee rate first")
+    {
+        SurgePricingPriorityQueue queue(/* isHighestPriority */ false,
+                                        laneConfig, 1);
+        for (auto const& txStack : txStacks)
+        {
+            queue.add(txStack);
+        }
+        auto account =
+            root.create("a1", app->getLedgerManager().getLastMinBalance(2));
+        auto tx = transaction(*app, account, 1, 1, 100000, 100);
+        std::vector<std::pair<TxStackPtr, bool>> toEvict;
+        REQUIRE(queue.canFitWithEviction(*tx, std::nullopt, toEvict).first);
+
+        std::vector<TransactionFrameBasePtr> evicted;
+        for (auto const& [txStack, dueToLane] : toEvict)
+        {
+            REQUIRE(!dueToLane);
+            evicted.emplace_back(txStack->getTopTx());
+        }
+        checkOrder(evicted, false);
+        REQUIRE(!evicted.empty());
+        REQUIRE(evicted.size() < txStacks.size());
+    }
+}
+
+// Single lane config with resources set by the test for every transaction
+class MappedResourcesLaneConfigForTesting : public SurgePricingLaneConfig
+{
+  public:
+    MappedResourcesLaneConfigForTesting(Resource limit) : mLaneLimits({limit})
+    {
+    }
+
+    size_t
+    getLane(TransactionFrameBase const& tx) const override
+    {
+        return SurgePricingPriorityQueue::GENERIC_LANE;
+    }
+    std::vector<Resource> const&
+    getLaneLimits() const override
+    {
+        return mLaneLimits;
+    }
+    virtual void
+    updateGenericLaneLimit(Resource const& limit) override
+    {
+        mLaneLimits[0] = limit;
+    }
+    virtual Resource
+    getTxResources(TransactionFrameBase const& tx) override
+    {
+        return mResources.at(tx.getFullHash());
+    }
+
+    UnorderedMap<Hash, Resource> mResources;
+
+  private:
+    std::vector<Resource> mLaneLimits;
+};
+
+namespace
+{
+struct PackingStats
+{
+    std::vector<int64_t> mUsed;
+    int64_t mTotalFee{0};
+};
+
+PackingStats
+getPackingStats(std::vector<TransactionFrameBasePtr> const& txs,
+                MappedResourcesLaneConfigForTesting& laneConfig)
+{
+    PackingStats stats;
+    auto used = Resource::makeEmpty(laneConfig.getLaneLimits()[0].size());
+    for (auto const& tx : txs)
+    {
+        used += laneConfig.getTxResources(*tx);
+        stats.mTotalFee += tx->getInclusionFee();
+    }
+    REQUIRE(used <= laneConfig.getLaneLimits()[0]);
+    for (size_t i = 0; i < used.size(); ++i)
+    {
+        stats.mUsed.emplace_back(used.getVal(static_cast<Resource::Type>(i)));
+    }
+    return stats;
+}
+
+std::vector<TxStackPtr>
+makeSingleTxStacks(std::vector<TransactionFrameBasePtr> const& txs)
+{
+    std::vector<TxStackPtr> txStacks;
+    for (auto const& tx : txs)
+    {
+        txStacks.emplace_back(std::make_shared<SingleTxStack>(tx));
+    }
+    return txStacks;
+}
+}
+
+TEST_CASE("SurgePricingPriorityQueue scarcity packing",
+          "[herder][transactionqueue]")
+{
+    VirtualClock clock;
+    auto app = createTestApplication(clock, getTestConfig());
+    auto root = TestAccount::createRoot(*app);
+
+    // At most 100 transactions and 1000 bytes. Heavy transactions bid more,
+    // but two of them use up all the bytes.
+    auto laneConfig = std::make_shared<MappedResourcesLaneConfigForTesting>(
+        Resource({100, 1000}));
+    std::vector<TransactionFrameBasePtr> txs;
+    for (int i = 1; i <= 110; ++i)
+    {
+        bool heavy = i <= 10;
+        auto tx = transaction(*app, root, i, 1, heavy ? 1000 : 900);
+        laneConfig->mResources.emplace(tx->getFullHash(),
+                                       Resource({1, heavy ? 500 : 5}));
+        txs.emplace_back(tx);
+    }
+
+    std::vector<bool> hadTxNotFittingLane;
+    auto greedy = getPackingStats(
+        SurgePricingPriorityQueue::getMostTopTxsWithinLimits(
+            makeSingleTxStacks(txs), laneConfig, hadTxNotFittingLane),
+        *laneConfig);
+    REQUIRE(hadTxNotFittingLane[0]);
+    REQUIRE(greedy.mUsed == std::vector<int64_t>{2, 1000});
+
+    auto byScarcity = getPackingStats(
+        SurgePricingPriorityQueue::getMostTopTxsByScarcityWithinLimits(
+            makeSingleTxStacks(txs), laneConfig, hadTxNotFittingLane),
+        *laneConfig);
+    REQUIRE(hadTxNotFittingLane[0]);
+    REQUIRE(byScarcity.mUsed == std::vector<int64_t>{100, 500});
+    REQUIRE(byScarcity.mTotalFee == 100 * 900);
+}
+
+TEST_CASE("SurgePricingPriorityQueue scarcity packing benchmark",
+          "[herder][transactionqueue][bench][!hide]")
+{
+    // Compares how much of the limits and how much of the fees greedy fee
+    // rate selection and selection by scarcity get out of random candidates
+    // that are bottlenecked on their second resource, and how long each takes.
+    VirtualClock clock;
+    auto app = createTestApplication(clock, getTestConfig());
+    auto root = TestAccount::createRoot(*app);
+
+    int64_t const byteLimit = 200'000;
+    auto laneConfig = std::make_shared<MappedResourcesLaneConfigForTesting>(
+        Resource({1000, byteLimit}));
+    std::vector<TransactionFrameBasePtr> txs;
+    for (int i = 1; i <= 5000; ++i)
+    {
+        auto tx =
+            transaction(*app, root, i, 1, rand_uniform<uint32_t>(100, 10000));
+        auto bytes =
+            rand_uniform<int64_t>(1, 10) * rand_uniform<int64_t>(1, 100);
+        laneConfig->mResources.emplace(tx->getFullHash(),
+                                       Resource({1, bytes}));
+        txs.emplace_back(tx);
+    }
+
+    namespace ch = std::chrono;
+    auto run = [&](char const* name, auto selector) {
+        auto txStacks = makeSingleTxStacks(txs);
+        std::vector<bool> hadTxNotFittingLane;
+        auto start = ch::steady_clock::now();
+        auto selected = selector(txStacks, laneConfig, hadTxNotFittingLane);
+        auto end = ch::steady_clock::now();
+        auto stats = getPackingStats(selected, *laneConfig);
+        LOG_INFO(DEFAULT_LOG, "{}: {} txs, {}/{} bytes, total fee {} in {}",
+                 name, stats.mUsed[0], stats.mUsed[1], byteLimit,
+                 stats.mTotalFee,
+                 ch::duration_cast<ch::microseconds>(end - start));
+    };
+    run("fee rate",
+        &SurgePricingPriorityQueue::getMostTopTxsWithinLimits);
+    run("scarcity",
+        &SurgePricingPriorityQueue::getMostTopTxsByScarcityWithinLimits);
+}
+
 class SorobanLimitingLaneConfigForTesting : public SurgePricingLaneConfig
 {
   public:
@@ -2594,6 +2840,14 @@ TEST_CASE("remove applied", "[herder][transactionqueue]")
     herder.recvTransaction(tx2, false);
     herder.recvTransaction(tx3, false);
 
+    auto& queueBytes = app->getMetrics().NewCounter(
+        {"herder", "memory", "pending-txs-bytes"});
+    auto envelopeBytes = [](TransactionFrameBasePtr const& tx) {
+        return static_cast<int64_t>(xdr::xdr_size(tx->getEnvelope()));
+    };
+    REQUIRE(queueBytes.count() ==
+            envelopeBytes(tx1a) + envelopeBytes(tx2) + envelopeBytes(tx3));
+
     {
         auto const& lcl = lm.getLastClosedLedgerHeader();
         auto ledgerSeq = lcl.header.ledgerSeq + 1;
@@ -2612,9 +2866,51 @@ TEST_CASE("remove applied", "[herder][transactionqueue]")
     }
 
     REQUIRE(tq.getTransactions({}).size() == 1);
+    REQUIRE(queueBytes.count() == envelopeBytes(tx3));
     REQUIRE(herder.recvTransaction(tx4, false) ==
             TransactionQueue::AddResult::ADD_STATUS_PENDING);
     REQUIRE(tq.getTransactions({}).size() == 2);
+    REQUIRE(queueBytes.count() == envelopeBytes(tx3) + envelopeBytes(tx4));
+}
+
+TEST_CASE("remove applied and shift", "[herder][transactionqueue]")
+{
+    VirtualClock clock;
+    auto cfg = getTestConfig();
+    auto app = createTestApplication(clock, cfg);
+
+    auto& lm = app->getLedgerManager();
+    auto& herder = static_cast<HerderImpl&>(app->getHerder());
+    auto& tq = herder.getTransactionQueue();
+
+    auto root = TestAccount::createRoot(*app);
+    auto acc = root.create("A", lm.getLastMinBalance(2));
+    auto acc2 = root.create("B", lm.getLastMinBalance(2));
+
+    auto tx1 = root.tx({payment(root, 1)});
+    auto tx2a = acc.tx({payment(root, 1)});
+    auto tx2b = acc.tx({payment(root, 2)});
+    auto tx3 = acc2.tx({payment(root, 1)});
+    REQUIRE(herder.recvTransaction(tx1, false) ==
+            TransactionQueue::AddResult::ADD_STATUS_PENDING);
+    REQUIRE(herder.recvTransaction(tx2a, false) ==
+            TransactionQueue::AddResult::ADD_STATUS_PENDING);
+    REQUIRE(herder.recvTransaction(tx3, false) ==
+            TransactionQueue::AddResult::ADD_STATUS_PENDING);
+
+    // acc's queued transaction was applied along with the next one
+    auto remaining = tq.removeAppliedAndShift(
+        {tx2b, tx3, tx2a}, lm.getLastClosedLedgerHeader().header);
+    REQUIRE(remaining.size() == 1);
+    REQUIRE(remaining[0]->getFullHash() == tx1->getFullHash());
+    REQUIRE(remaining == tq.getTransactions({}));
+
+    REQUIRE(tq.isBanned(tx2a->getFullHash()));
+    REQUIRE(tq.isBanned(tx2b->getFullHash()));
+    REQUIRE(tq.isBanned(tx3->getFullHash()));
+    REQUIRE(!tq.sourceAccountPending(acc.getPublicKey()));
+    REQUIRE(!tq.sourceAccountPending(acc2.getPublicKey()));
+    REQUIRE(tq.getAccountTransactionQueueInfo(root.getPublicKey()).mAge == 1);
 }
 
 static UnorderedSet<AssetPair, AssetPairHash>
@@ -2778,6 +3074,34 @@ TEST_CASE("arbitrage tx identification",
     REQUIRE(
         apVecToSet(TransactionQueue::findAllAssetPairsInvolvedInPaymentLoops(
             tx7f)) == UnorderedSet<AssetPair, AssetPairHash>{});
+
+    // Tx8 is a 40 asset loop, one op per step, followed by a 40 asset chain,
+    // too many assets for the fixed-size graph
+    TransactionEnvelope tx8;
+    tx8.type(ENVELOPE_TYPE_TX);
+    UnorderedSet<AssetPair, AssetPairHash> tx8Loop;
+    std::vector<Asset> loopAssets;
+    for (size_t i = 0; i < 80; ++i)
+    {
+        loopAssets.emplace_back(
+            txtest::makeAsset(carolSec, fmt::format("L{}", i)));
+    }
+    for (size_t i = 0; i < 79; ++i)
+    {
+        auto const& next = i == 39 ? loopAssets[0] : loopAssets[i + 1];
+        tx8.v1().tx.operations.emplace_back(
+            txtest::pathPayment(bobPub, loopAssets[i], 100, next, 100, {}));
+        if (i < 40)
+        {
+            tx8Loop.emplace(AssetPair{loopAssets[i], next});
+        }
+    }
+    auto tx8f = std::make_shared<TransactionFrame>(Hash(), tx8);
+
+    LOG_TRACE(DEFAULT_LOG, "Tx8 - 79 op / 80 asset loop and chain");
+    REQUIRE(apVecToSet(
+                TransactionQueue::findAllAssetPairsInvolvedInPaymentLoops(
+                    tx8f)) == tx8Loop);
 }
 
 TEST_CASE("arbitrage tx identification benchmark",
@@ -2,7 +2,9 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
+#include "crypto/SHA.h"
 #include "herder/TxSetFrame.h"
+#include "herder/TxSetUtils.h"
 #include "herder/test/TestTxSetUtils.h"
 #include "ledger/LedgerManager.h"
 #include "lib/catch.hpp"
@@ -12,6 +14,9 @@
 #include "test/TestUtils.h"
 #include "test/TxTests.h"
 #include "test/test.h"
+#include "transactions/TransactionBridge.h"
+#include "transactions/TransactionFrame.h"
+#include "transactions/TransactionUtils.h"
 #include "util/ProtocolVersion.h"
 
 namespace stellar
@@ -527,6 +532,16 @@ TEST_CASE("generalized tx set XDR conversion", "[txset]")
         GeneralizedTransactionSet newXdr;
         applicableFrame->toWireTxSetFrame()->toXDR(newXdr);
         REQUIRE(newXdr == txSetXdr);
+
+        // The cached encoding is what encoding the XDR again produces
+        REQUIRE(txSetFrame->encodedSize() == xdr::xdr_argpack_size(txSetXdr));
+        REQUIRE(txSetFrame->getContentsHash() == xdrSha256(txSetXdr));
+        StoredTransactionSet storedXdr;
+        txSetFrame->storeXDR(storedXdr);
+        REQUIRE(txSetFrame->encodeStoredXDR() == xdr::xdr_to_opaque(storedXdr));
+        auto msg = txSetFrame->getStellarMessage();
+        REQUIRE(msg == txSetFrame->getStellarMessage());
+        REQUIRE(msg->generalizedTxSet() == txSetXdr);
     };
 
     SECTION("empty set")
@@ -978,5 +993,125 @@ TEST_CASE("generalized tx set fees", "[txset][soroban]")
     }
 }
 
+TEST_CASE("soroban apply clusters", "[txset][soroban]")
+{
+    VirtualClock clock;
+    auto cfg = getTestConfig();
+    cfg.LEDGER_PROTOCOL_VERSION =
+        static_cast<uint32_t>(SOROBAN_PROTOCOL_VERSION);
+    cfg.TESTING_UPGRADE_LEDGER_PROTOCOL_VERSION =
+        static_cast<uint32_t>(SOROBAN_PROTOCOL_VERSION);
+
+    Application::pointer app = createTestApplication(clock, cfg);
+    overrideSorobanNetworkConfigForTest(*app);
+    auto root = TestAccount::createRoot(*app);
+    int accountId = 1;
+
+    auto codeKey = [](std::string const& name) {
+        return contractCodeKey(sha256(name));
+    };
+    auto sharedAccount = accountKey(getAccount("shared").getPublicKey());
+
+    auto createTx = [&](xdr::xvector<LedgerKey> const& readOnly,
+                        xdr::xvector<LedgerKey> const& readWrite) {
+        auto source = root.create("unique " + std::to_string(accountId++),
+                                  app->getLedgerManager().getLastMinBalance(2));
+        SorobanResources resources;
+        resources.instructions = 800'000;
+        resources.readBytes = 1000;
+        resources.writeBytes = 1000;
+        resources.footprint.readOnly = readOnly;
+        resources.footprint.readWrite = readWrite;
+        auto resourceFee = sorobanResourceFee(*app, resources, 5000, 40);
+        return createUploadWasmTx(*app, source, 100, resourceFee, resources);
+    };
+
+    SECTION("independent writes")
+    {
+        TxSetTransactions txs{createTx({}, {codeKey("a")}),
+                              createTx({}, {codeKey("b")}),
+                              createTx({}, {codeKey("c")})};
+        auto clusters = TxSetUtils::buildSorobanApplyClusters(txs);
+        REQUIRE(clusters.size() == 3);
+        for (size_t i = 0; i < txs.size(); ++i)
+        {
+            REQUIRE(clusters[i] == TxSetTransactions{txs[i]});
+        }
+    }
+    SECTION("shared reads do not conflict")
+    {
+        TxSetTransactions txs{createTx({sharedAccount}, {codeKey("a")}),
+                              createTx({sharedAccount}, {codeKey("b")})};
+        REQUIRE(TxSetUtils::buildSorobanApplyClusters(txs).size() == 2);
+    }
+    SECTION("read-only soroban entries conflict through their TTL")
+    {
+        TxSetTransactions txs{createTx({codeKey("shared")}, {codeKey("a")}),
+                              createTx({codeKey("shared")}, {codeKey("b")})};
+        REQUIRE(TxSetUtils::buildSorobanApplyClusters(txs).size() == 1);
+    }
+    SECTION("conflicts are transitive and keep apply order")
+    {
+        auto a1 = createTx({}, {codeKey("a")});
+        auto r1 = createTx({sharedAccount}, {codeKey("b")});
+        auto r2 = createTx({sharedAccount}, {codeKey("c")});
+        auto w = createTx({}, {sharedAccount});
+        auto a2 = createTx({codeKey("d")}, {codeKey("a")});
+        auto other = createTx({}, {codeKey("e")});
+        auto r3 = createTx({sharedAccount}, {codeKey("f")});
+        TxSetTransactions txs{a1, r1, r2, w, a2, other, r3};
+
+        auto clusters = TxSetUtils::buildSorobanApplyClusters(txs);
+        REQUIRE(clusters.size() == 3);
+        REQUIRE(clusters[0] == TxSetTransactions{a1, a2});
+        REQUIRE(clusters[1] == TxSetTransactions{r1, r2, w, r3});
+        REQUIRE(clusters[2] == TxSetTransactions{other});
+    }
+}
+
+TEST_CASE("tx set validation with parallel signature verification",
+          "[txset]")
+{
+    VirtualClock clock;
+    auto cfg = getTestConfig();
+    cfg.WORKER_THREADS = 4;
+    Application::pointer app = createTestApplication(clock, cfg);
+    auto root = TestAccount::createRoot(*app);
+
+    // Enough signatures to be verified by several worker threads
+    TxSetTransactions txs;
+    for (int i = 0; i < 600; ++i)
+    {
+        auto account =
+            root.create("account " + std::to_string(i),
+                        app->getLedgerManager().getLastMinBalance(2));
+        txs.emplace_back(account.tx({payment(root, 1)}));
+    }
+
+    SECTION("all valid")
+    {
+        REQUIRE(TxSetUtils::getInvalidTxList(txs, *app, 0, 0, false).empty());
+    }
+    SECTION("bad signatures")
+    {
+        TxSetTransactions expectedInvalid;
+        for (size_t i = 0; i < txs.size(); i += 97)
+        {
+            auto tx = std::static_pointer_cast<TransactionFrame>(txs[i]);
+            txbridge::setMaxTime(tx, UINT64_MAX);
+            tx->clearCached();
+            expectedInvalid.emplace_back(tx);
+        }
+        auto invalid = TxSetUtils::getInvalidTxList(txs, *app, 0, 0, false);
+        auto byHash = [](TransactionFrameBasePtr const& l,
+                         TransactionFrameBasePtr const& r) {
+            return l->getFullHash() < r->getFullHash();
+        };
+        std::sort(invalid.begin(), invalid.end(), byHash);
+        std::sort(expectedInvalid.begin(), expectedInvalid.end(), byHash);
+        REQUIRE(invalid == expectedInvalid);
+    }
+}
+
 } // namespace
 } // namespace stellar
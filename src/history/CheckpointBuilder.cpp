@@ -0,0 +1,389 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "history/CheckpointBuilder.h"
+#include "crypto/SHA.h"
+#include "herder/TxSetFrame.h"
+#include "history/FileTransferInfo.h"
+#include "history/HistoryManager.h"
+#include "main/Application.h"
+#include "main/Config.h"
+#include "util/Fs.h"
+#include "util/Logging.h"
+#include "util/XDRStream.h"
+#include <Tracy.hpp>
+#include <functional>
+#include <regex>
+#include <set>
+
+namespace stellar
+{
+
+namespace
+{
+char const* const FILE_TYPES[] = {HISTORY_FILE_TYPE_LEDGER,
+                                  HISTORY_FILE_TYPE_TRANSACTIONS,
+                                  HISTORY_FILE_TYPE_RESULTS};
+
+std::string
+completedPath(Config const& cfg, char const* type, uint32_t checkpoint)
+{
+    return CheckpointBuilder::checkpointDir(cfg) + "/" +
+           fs::baseName(type, fs::hexStr(checkpoint), "xdr");
+}
+
+std::string
+dirtyPath(Config const& cfg, char const* type, uint32_t checkpoint)
+{
+    return completedPath(cfg, type, checkpoint) + ".dirty";
+}
+
+// Reads the entries of path for ledgers before `end`
+template <typename T>
+std::vector<T>
+readEntriesBefore(std::string const& path, uint32_t end,
+                  std::function<uint32_t(T const&)> ledgerOf)
+{
+    std::vector<T> res;
+    XDRInputFileStream in;
+    in.open(path);
+    T entry;
+    while (in && in.readOne(entry))
+    {
+        if (ledgerOf(entry) < end)
+        {
+            res.emplace_back(entry);
+        }
+    }
+    return res;
+}
+}
+
+CheckpointBuilder::CheckpointBuilder(Application& app) : mApp(app)
+{
+}
+
+// Dirty files still open are kept, for the next run to resume
+CheckpointBuilder::~CheckpointBuilder() = default;
+
+std::string
+CheckpointBuilder::checkpointDir(Config const& cfg)
+{
+    return cfg.BUCKET_DIR_PATH + "/checkpoints";
+}
+
+void
+CheckpointBuilder::open(uint32_t checkpoint)
+{
+    auto const& cfg = mApp.getConfig();
+    auto dir = checkpointDir(cfg);
+    if (!fs::exists(dir) && !fs::mkpath(dir))
+    {
+        throw std::runtime_error("Unable to create checkpoint directory: " +
+                                 dir);
+    }
+    bool doFsync = !cfg.DISABLE_XDR_FSYNC;
+    auto& ctx = mApp.getClock().getIOContext();
+    mCheckpoint = checkpoint;
+    mLedgerOut = std::make_unique<XDROutputFileStream>(ctx, doFsync);
+    mLedgerOut->open(dirtyPath(cfg, HISTORY_FILE_TYPE_LEDGER, checkpoint));
+    mTxOut = std::make_unique<XDROutputFileStream>(ctx, doFsync);
+    mTxOut->open(dirtyPath(cfg, HISTORY_FILE_TYPE_TRANSACTIONS, checkpoint));
+    mResultsOut = std::make_unique<XDROutputFileStream>(ctx, doFsync);
+    mResultsOut->open(dirtyPath(cfg, HISTORY_FILE_TYPE_RESULTS, checkpoint));
+}
+
+void
+CheckpointBuilder::abandon()
+{
+    mLedgerOut.reset();
+    mTxOut.reset();
+    mResultsOut.reset();
+    if (mCheckpoint != 0)
+    {
+        CLOG_INFO(History,
+                  "Not building checkpoint {} at ledger close, publishing "
+                  "will read it from the database",
+                  mCheckpoint);
+        auto const& cfg = mApp.getConfig();
+        for (auto type : FILE_TYPES)
+        {
+            std::remove(dirtyPath(cfg, type, mCheckpoint).c_str());
+        }
+    }
+    mCheckpoint = 0;
+    mNextLedger = 0;
+}
+
+void
+CheckpointBuilder::finish()
+{
+    ZoneScoped;
+    mLedgerOut->close();
+    mTxOut->close();
+    mResultsOut->close();
+    mLedgerOut.reset();
+    mTxOut.reset();
+    mResultsOut.reset();
+
+    auto const& cfg = mApp.getConfig();
+    for (auto type : FILE_TYPES)
+    {
+        if (!fs::durableRename(dirtyPath(cfg, type, mCheckpoint),
+                               completedPath(cfg, type, mCheckpoint),
+                               checkpointDir(cfg)))
+        {
+            throw std::runtime_error("Failed to rename checkpoint file");
+        }
+    }
+    CLOG_DEBUG(History, "Built checkpoint {} at ledger close", mCheckpoint);
+    mCheckpoint = 0;
+    mNextLedger = 0;
+}
+
+void
+CheckpointBuilder::removeStaleFiles(uint32_t checkpoint)
+{
+    auto const& cfg = mApp.getConfig();
+    auto dir = checkpointDir(cfg);
+    if (!fs::exists(dir))
+    {
+        return;
+    }
+    std::set<uint32_t> queued;
+    for (auto const& has : mApp.getHistoryManager().getPublishQueueStates())
+    {
+        queued.insert(has.currentLedger);
+    }
+
+    // Completed files are kept until their checkpoint is published, and
+    // dirty files only if they may be resumed
+    static std::regex const re(
+        "^(ledger|transactions|results)-([0-9a-f]{8})\\.xdr(\\.dirty)?$");
+    for (auto const& f : fs::findfiles(dir, [](std::string const& name) {
+             return std::regex_match(name, re);
+         }))
+    {
+        std::smatch m;
+        std::regex_match(f, m, re);
+        auto fileCheckpoint =
+            static_cast<uint32_t>(std::stoul(m[2].str(), nullptr, 16));
+        bool keep = m[3].matched ? fileCheckpoint == checkpoint
+                                 : queued.count(fileCheckpoint) != 0;
+        if (!keep)
+        {
+            std::remove((dir + "/" + f).c_str());
+        }
+    }
+}
+
+void
+CheckpointBuilder::resume(uint32_t ledgerSeq)
+{
+    ZoneScoped;
+    auto const& cfg = mApp.getConfig();
+    auto& hm = mApp.getHistoryManager();
+    auto checkpoint = hm.checkpointContainingLedger(ledgerSeq);
+    auto first = hm.firstLedgerInCheckpointContaining(ledgerSeq);
+    if (!fs::exists(dirtyPath(cfg, HISTORY_FILE_TYPE_LEDGER, checkpoint)))
+    {
+        return;
+    }
+
+    std::vector<LedgerHeaderHistoryEntry> headers;
+    std::vector<TransactionHistoryEntry> txs;
+    std::vector<TransactionHistoryResultEntry> results;
+    try
+    {
+        headers = readEntriesBefore<LedgerHeaderHistoryEntry>(
+            dirtyPath(cfg, HISTORY_FILE_TYPE_LEDGER, checkpoint), ledgerSeq,
+            [](LedgerHeaderHistoryEntry const& e) {
+                return e.header.ledgerSeq;
+            });
+        txs = readEntriesBefore<TransactionHistoryEntry>(
+            dirtyPath(cfg, HISTORY_FILE_TYPE_TRANSACTIONS, checkpoint),
+            ledgerSeq,
+            [](TransactionHistoryEntry const& e) { return e.ledgerSeq; });
+        results = readEntriesBefore<TransactionHistoryResultEntry>(
+            dirtyPath(cfg, HISTORY_FILE_TYPE_RESULTS, checkpoint), ledgerSeq,
+            [](TransactionHistoryResultEntry const& e) {
+                return e.ledgerSeq;
+            });
+    }
+    catch (std::exception const& e)
+    {
+        CLOG_WARNING(History, "Can't resume checkpoint {}: {}", checkpoint,
+                     e.what());
+        mCheckpoint = checkpoint;
+        abandon();
+        return;
+    }
+
+    // Every ledger before ledgerSeq must be there, with the results its
+    // header commits to and the tx set those results are for
+    bool complete = headers.size() == ledgerSeq - first &&
+                    txs.size() == results.size();
+    auto const emptyResultsHash = xdrSha256(TransactionResultSet{});
+    size_t r = 0;
+    for (size_t i = 0; complete && i < headers.size(); ++i)
+    {
+        auto const& header = headers[i].header;
+        complete = header.ledgerSeq == first + i;
+        if (r < results.size() && results[r].ledgerSeq == header.ledgerSeq)
+        {
+            complete = complete && txs[r].ledgerSeq == header.ledgerSeq &&
+                       xdrSha256(results[r].txResultSet) ==
+                           header.txSetResultHash;
+            ++r;
+        }
+        else
+        {
+            complete = complete && header.txSetResultHash == emptyResultsHash;
+        }
+    }
+    if (!complete || r != results.size())
+    {
+        mCheckpoint = checkpoint;
+        abandon();
+        return;
+    }
+
+    // Rewrite the files without whatever was appended past the LCL
+    open(checkpoint);
+    for (auto const& h : headers)
+    {
+        mLedgerOut->writeOne(h);
+    }
+    for (size_t i = 0; i < txs.size(); ++i)
+    {
+        mTxOut->writeOne(txs[i]);
+        mResultsOut->writeOne(results[i]);
+    }
+    mNextLedger = ledgerSeq;
+    CLOG_INFO(History, "Resuming checkpoint {} at ledger {}", checkpoint,
+              ledgerSeq);
+}
+
+void
+CheckpointBuilder::appendLedger(LedgerHeaderHistoryEntry const& header,
+                                TxSetXDRFrame const& txSet,
+                                std::vector<TransactionFrameBasePtr> const& txs,
+                                TransactionResultSet const& results)
+{
+    ZoneScoped;
+    auto& hm = mApp.getHistoryManager();
+    auto ledgerSeq = header.header.ledgerSeq;
+    try
+    {
+        if (!mStarted)
+        {
+            mStarted = true;
+            auto checkpoint = hm.checkpointContainingLedger(ledgerSeq);
+            // A crash may have come after completing the checkpoint, but
+            // before its last ledger committed
+            removeCompleted(mApp.getConfig(), checkpoint);
+            removeStaleFiles(checkpoint);
+            if (!hm.isFirstLedgerInCheckpoint(ledgerSeq))
+            {
+                resume(ledgerSeq);
+            }
+        }
+
+        if (hm.isFirstLedgerInCheckpoint(ledgerSeq))
+        {
+            abandon();
+            open(hm.checkpointContainingLedger(ledgerSeq));
+            mNextLedger = ledgerSeq;
+        }
+        else if (ledgerSeq != mNextLedger)
+        {
+            // Ledgers were skipped, by catchup or after a restart
+            abandon();
+            return;
+        }
+
+        // As when written from the database, ledgers without transactions
+        // have no entries in the transactions and results files
+        if (!txs.empty())
+        {
+            TransactionHistoryEntry hist;
+            hist.ledgerSeq = ledgerSeq;
+            if (txSet.isGeneralizedTxSet())
+            {
+                hist.ext.v(1);
+                txSet.toXDR(hist.ext.generalizedTxSet());
+            }
+            else
+            {
+                // Legacy tx sets are written in apply order
+                TxSetXDRFrame::makeFromHistoryTransactions(
+                    txSet.previousLedgerHash(), txs)
+                    ->toXDR(hist.txSet);
+            }
+            TransactionHistoryResultEntry res;
+            res.ledgerSeq = ledgerSeq;
+            res.txResultSet = results;
+            mTxOut->writeOne(hist);
+            mResultsOut->writeOne(res);
+            mTxOut->flush();
+            mResultsOut->flush();
+        }
+        mLedgerOut->writeOne(header);
+        mLedgerOut->flush();
+        ++mNextLedger;
+
+        if (hm.isLastLedgerInCheckpoint(ledgerSeq))
+        {
+            finish();
+        }
+    }
+    catch (std::exception const& e)
+    {
+        CLOG_ERROR(History, "Failed to write ledger {} to checkpoint: {}",
+                   ledgerSeq, e.what());
+        abandon();
+    }
+}
+
+bool
+CheckpointBuilder::linkCompleted(Config const& cfg, uint32_t checkpoint,
+                                 FileTransferInfo const& ledger,
+                                 FileTransferInfo const& transactions,
+                                 FileTransferInfo const& results)
+{
+    ZoneScoped;
+    FileTransferInfo const* dsts[] = {&ledger, &transactions, &results};
+    for (size_t i = 0; i < 3; ++i)
+    {
+        if (!fs::exists(completedPath(cfg, FILE_TYPES[i], checkpoint)))
+        {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < 3; ++i)
+    {
+        auto dst = dsts[i]->localPath_nogz();
+        std::remove(dst.c_str());
+        if (!fs::linkOrCopy(completedPath(cfg, FILE_TYPES[i], checkpoint),
+                            dst))
+        {
+            for (size_t j = 0; j <= i; ++j)
+            {
+                std::remove(dsts[j]->localPath_nogz().c_str());
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+void
+CheckpointBuilder::removeCompleted(Config const& cfg, uint32_t checkpoint)
+{
+    for (auto type : FILE_TYPES)
+    {
+        std::remove(completedPath(cfg, type, checkpoint).c_str());
+    }
+}
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "transactions/TransactionFrameBase.h"
+#include "xdr/Stellar-ledger.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace stellar
+{
+
+class Application;
+class Config;
+class FileTransferInfo;
+class TxSetXDRFrame;
+class XDROutputFileStream;
+
+// Writes the ledger headers, transactions and results files of the current
+// checkpoint as each of its ledgers closes, so that publishing only has to
+// link them into its snapshot, compress and upload them, rather than read the
+// whole checkpoint back from the history tables and re-encode it at once.
+//
+// The files are built in checkpointDir(), named `<file>.dirty` while the
+// checkpoint is in progress and renamed to `<file>` once it is complete.
+// Ledgers are appended before their close commits, so after a crash the dirty
+// files may hold ledgers past the LCL, or have lost their tail: the first
+// append after a restart drops the former and checks what is left against the
+// headers. A checkpoint that can't be built completely -- because the node
+// started, or caught up, in its middle, or its files were damaged -- is
+// abandoned, and publishing reads it from the database as before.
+class CheckpointBuilder
+{
+    Application& mApp;
+    std::unique_ptr<XDROutputFileStream> mLedgerOut;
+    std::unique_ptr<XDROutputFileStream> mTxOut;
+    std::unique_ptr<XDROutputFileStream> mResultsOut;
+    // Checkpoint the open files are for, and the ledger they expect next, 0
+    // if no files are open
+    uint32_t mCheckpoint{0};
+    uint32_t mNextLedger{0};
+    bool mStarted{false};
+
+    void open(uint32_t checkpoint);
+    void abandon();
+    void finish();
+    void removeStaleFiles(uint32_t checkpoint);
+    void resume(uint32_t ledgerSeq);
+
+  public:
+    explicit CheckpointBuilder(Application& app);
+    ~CheckpointBuilder();
+
+    static std::string checkpointDir(Config const& cfg);
+
+    // Appends a ledger that just closed, its tx set with txs in apply order
+    // and their results, completing the checkpoint if it is its last ledger.
+    // Failing to write abandons the checkpoint but doesn't throw.
+    void appendLedger(LedgerHeaderHistoryEntry const& header,
+                      TxSetXDRFrame const& txSet,
+                      std::vector<TransactionFrameBasePtr> const& txs,
+                      TransactionResultSet const& results);
+
+    // Links the completed files of checkpoint to the local paths of ledger,
+    // transactions and results. Returns false, linking nothing, if the
+    // checkpoint wasn't built. Can be called from any thread.
+    static bool linkCompleted(Config const& cfg, uint32_t checkpoint,
+                              FileTransferInfo const& ledger,
+                              FileTransferInfo const& transactions,
+                              FileTransferInfo const& results);
+
+    // Deletes the completed files of checkpoint, once it is published
+    static void removeCompleted(Config const& cfg, uint32_t checkpoint);
+};
+}
@@ -460,7 +460,13 @@ HistoryArchive::~HistoryArchive()
 bool
 HistoryArchive::hasGetCmd() const
 {
-    return !mConfig.mGetCmd.empty();
+    return !mConfig.mGetCmd.empty() || hasGetUrl();
+}
+
+bool
+HistoryArchive::hasGetUrl() const
+{
+    return !mConfig.mGetUrl.empty();
 }
 
 bool
@@ -490,6 +496,15 @@ HistoryArchive::getFileCmd(std::string const& remote,
     return formatString(mConfig.mGetCmd, remote, local);
 }
 
+std::string
+HistoryArchive::getFileUrl(std::string const& remote) const
+{
+    if (mConfig.mGetUrl.empty())
+        return "";
+    auto const& base = mConfig.mGetUrl;
+    return base.back() == '/' ? base + remote : base + "/" + remote;
+}
+
 std::string
 HistoryArchive::putFileCmd(std::string const& local,
                            std::string const& remote) const
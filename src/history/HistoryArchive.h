@@ -155,13 +155,17 @@ class HistoryArchive : public std::enable_shared_from_this<HistoryArchive>
     explicit HistoryArchive(Application& app,
                             HistoryArchiveConfiguration const& config);
     ~HistoryArchive();
+    // Whether files can be downloaded from the archive, by running its `get`
+    // command or from its url
     bool hasGetCmd() const;
+    bool hasGetUrl() const;
     bool hasPutCmd() const;
     bool hasMkdirCmd() const;
     std::string const& getName() const;
 
     std::string getFileCmd(std::string const& remote,
                            std::string const& local) const;
+    std::string getFileUrl(std::string const& remote) const;
     std::string putFileCmd(std::string const& local,
                            std::string const& remote) const;
     std::string mkdirCmd(std::string const& remoteDir) const;
@@ -0,0 +1,628 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "history/HistoryArchiveHttpClient.h"
+#include "main/Application.h"
+#include "util/GlobalChecks.h"
+#include "util/Logging.h"
+#include "util/Timer.h"
+
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include <Tracy.hpp>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <optional>
+#include <sstream>
+
+namespace stellar
+{
+
+namespace
+{
+std::string
+toLower(std::string s)
+{
+    std::transform(s.begin(), s.end(), s.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    return s;
+}
+
+std::string
+trim(std::string const& s)
+{
+    auto begin = s.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos)
+    {
+        return "";
+    }
+    auto end = s.find_last_not_of(" \t\r\n");
+    return s.substr(begin, end - begin + 1);
+}
+}
+
+// One download, on a connection of its own until it ends. Every step runs on
+// the main thread, and does nothing once the request is done (finished or
+// cancelled), so late completions of cancelled operations are harmless.
+class HistoryArchiveHttpClient::Request
+    : public std::enable_shared_from_this<Request>
+{
+  public:
+    Request(HistoryArchiveHttpClient& client, std::string const& host,
+            std::string const& port, std::string const& path,
+            std::string const& local, Handler handler)
+        : mClient(client)
+        , mHost(host)
+        , mPort(port)
+        , mPath(path)
+        , mHostPort(host + ":" + port)
+        , mLocal(local)
+        , mHandler(std::move(handler))
+        , mResolver(client.mApp.getClock().getIOContext())
+        , mTimer(client.mApp)
+        , mRequestText(fmt::format(FMT_STRING("GET {} HTTP/1.1\r\n"
+                                              "Host: {}\r\n"
+                                              "Accept: */*\r\n"
+                                              "Connection: keep-alive\r\n"
+                                              "\r\n"),
+                                   path, host))
+    {
+    }
+
+    void
+    start()
+    {
+        mOut.open(mLocal, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!mOut)
+        {
+            // Don't call back from inside get()
+            std::weak_ptr<Request> weak = shared_from_this();
+            mClient.mApp.postOnMainThread(
+                [weak]() {
+                    auto self = weak.lock();
+                    if (self)
+                    {
+                        self->finish(std::make_error_code(std::errc::io_error));
+                    }
+                },
+                "HistoryArchiveHttpClient: open failed");
+            return;
+        }
+        connect();
+    }
+
+    void
+    cancel()
+    {
+        mHandler = nullptr;
+        if (!mDone)
+        {
+            mDone = true;
+            mTimer.cancel();
+            mResolver.cancel();
+            closeSocket();
+        }
+    }
+
+  private:
+    HistoryArchiveHttpClient& mClient;
+    std::string const mHost;
+    std::string const mPort;
+    std::string const mPath;
+    std::string const mHostPort;
+    std::string const mLocal;
+    Handler mHandler;
+    asio::ip::tcp::resolver mResolver;
+    VirtualTimer mTimer;
+    std::string const mRequestText;
+    std::unique_ptr<Socket> mSocket;
+    asio::streambuf mBuf;
+    std::ofstream mOut;
+    bool mDone{false};
+    // Whether the connection came from the pool and no response has been read
+    // on it yet: the server may have closed it while it was idle, so failing
+    // then is retried on another connection.
+    bool mRetryable{false};
+    bool mKeepAlive{true};
+    // Body bytes left to read, of the whole body or of the current chunk
+    size_t mRemaining{0};
+
+    void
+    connect()
+    {
+        mBuf.consume(mBuf.size());
+        mSocket = mClient.takeIdleConnection(mHostPort);
+        if (mSocket)
+        {
+            mRetryable = true;
+            mClient.mConnectionsReused.Mark();
+            sendRequest();
+            return;
+        }
+
+        mRetryable = false;
+        mSocket =
+            std::make_unique<Socket>(mClient.mApp.getClock().getIOContext());
+        armTimer();
+        auto self = shared_from_this();
+        mResolver.async_resolve(
+            mHost, mPort,
+            [self](asio::error_code const& ec,
+                   asio::ip::tcp::resolver::results_type results) {
+                if (self->mDone)
+                {
+                    return;
+                }
+                if (ec)
+                {
+                    self->finish(ec);
+                    return;
+                }
+                asio::async_connect(
+                    *self->mSocket, results,
+                    [self](asio::error_code const& ec,
+                           asio::ip::tcp::endpoint const&) {
+                        if (self->mDone)
+                        {
+                            return;
+                        }
+                        if (ec)
+                        {
+                            self->finish(ec);
+                            return;
+                        }
+                        self->mClient.mConnectionsOpened.Mark();
+                        self->sendRequest();
+                    });
+            });
+    }
+
+    void
+    retryOrFinish(asio::error_code const& ec)
+    {
+        if (mRetryable)
+        {
+            CLOG_DEBUG(History, "Idle connection to {} went away, reconnecting",
+                       mHostPort);
+            closeSocket();
+            connect();
+        }
+        else
+        {
+            finish(ec);
+        }
+    }
+
+    void
+    sendRequest()
+    {
+        armTimer();
+        auto self = shared_from_this();
+        asio::async_write(*mSocket, asio::buffer(mRequestText),
+                          [self](asio::error_code const& ec, size_t) {
+                              if (self->mDone)
+                              {
+                                  return;
+                              }
+                              if (ec)
+                              {
+                                  self->retryOrFinish(ec);
+                                  return;
+                              }
+                              self->readHeaders();
+                          });
+    }
+
+    void
+    readHeaders()
+    {
+        armTimer();
+        auto self = shared_from_this();
+        asio::async_read_until(
+            *mSocket, mBuf, "\r\n\r\n",
+            [self](asio::error_code const& ec, size_t n) {
+                if (self->mDone)
+                {
+                    return;
+                }
+                if (ec)
+                {
+                    self->retryOrFinish(ec);
+                    return;
+                }
+                self->onHeaders(self->takeLine(n));
+            });
+    }
+
+    void
+    onHeaders(std::string const& head)
+    {
+        ZoneScoped;
+        mRetryable = false;
+        std::istringstream in(head);
+        std::string version;
+        unsigned int status = 0;
+        in >> version >> status;
+        if (!in || version.compare(0, 5, "HTTP/") != 0)
+        {
+            finish(std::make_error_code(std::errc::protocol_error));
+            return;
+        }
+        mKeepAlive = version != "HTTP/1.0";
+
+        std::optional<size_t> length;
+        bool chunked = false;
+        std::string line;
+        std::getline(in, line);
+        while (std::getline(in, line))
+        {
+            auto colon = line.find(':');
+            if (colon == std::string::npos)
+            {
+                continue;
+            }
+            auto name = toLower(trim(line.substr(0, colon)));
+            auto value = toLower(trim(line.substr(colon + 1)));
+            if (name == "content-length")
+            {
+                try
+                {
+                    length = std::stoull(value);
+                }
+                catch (std::exception&)
+                {
+                    finish(std::make_error_code(std::errc::protocol_error));
+                    return;
+                }
+            }
+            else if (name == "transfer-encoding")
+            {
+                chunked = value.find("chunked") != std::string::npos;
+            }
+            else if (name == "connection")
+            {
+                mKeepAlive = value == "keep-alive" ||
+                             (mKeepAlive && value != "close");
+            }
+        }
+
+        if (status != 200)
+        {
+            CLOG_DEBUG(History, "GET {} from {} returned status {}", mPath,
+                       mHostPort, status);
+            // Don't bother reading the error body to reuse the connection
+            mKeepAlive = false;
+            finish(std::make_error_code(std::errc::protocol_error));
+        }
+        else if (chunked)
+        {
+            readChunkSize();
+        }
+        else if (length)
+        {
+            mRemaining = *length;
+            readBodyBytes([](Request& self) { self.finish({}); });
+        }
+        else
+        {
+            // The body ends with the connection
+            mKeepAlive = false;
+            readToEnd();
+        }
+    }
+
+    // Reads mRemaining bytes of body into the file, then calls next
+    void
+    readBodyBytes(std::function<void(Request&)> next)
+    {
+        auto n = std::min(mBuf.size(), mRemaining);
+        writeBody(n);
+        mRemaining -= n;
+        if (mRemaining == 0)
+        {
+            next(*this);
+            return;
+        }
+        armTimer();
+        auto self = shared_from_this();
+        asio::async_read(*mSocket, mBuf, asio::transfer_at_least(1),
+                         [self, next](asio::error_code const& ec, size_t) {
+                             if (self->mDone)
+                             {
+                                 return;
+                             }
+                             if (ec)
+                             {
+                                 self->finish(ec);
+                                 return;
+                             }
+                             self->readBodyBytes(next);
+                         });
+    }
+
+    void
+    readToEnd()
+    {
+        writeBody(mBuf.size());
+        armTimer();
+        auto self = shared_from_this();
+        asio::async_read(*mSocket, mBuf, asio::transfer_at_least(1),
+                         [self](asio::error_code const& ec, size_t) {
+                             if (self->mDone)
+                             {
+                                 return;
+                             }
+                             if (ec == asio::error::eof)
+                             {
+                                 self->writeBody(self->mBuf.size());
+                                 self->finish({});
+                             }
+                             else if (ec)
+                             {
+                                 self->finish(ec);
+                             }
+                             else
+                             {
+                                 self->readToEnd();
+                             }
+                         });
+    }
+
+    // Calls next with the line read (without its CRLF)
+    void
+    readLine(std::function<void(Request&, std::string const&)> next)
+    {
+        armTimer();
+        auto self = shared_from_this();
+        asio::async_read_until(
+            *mSocket, mBuf, "\r\n",
+            [self, next](asio::error_code const& ec, size_t n) {
+                if (self->mDone)
+                {
+                    return;
+                }
+                if (ec)
+                {
+                    self->finish(ec);
+                    return;
+                }
+                auto line = self->takeLine(n);
+                next(*self, line.substr(0, line.size() - 2));
+            });
+    }
+
+    void
+    readChunkSize()
+    {
+        readLine([](Request& self, std::string const& line) {
+            size_t size = 0;
+            try
+            {
+                // Ignoring any chunk extensions after a ';'
+                size = std::stoull(line.substr(0, line.find(';')), nullptr, 16);
+            }
+            catch (std::exception&)
+            {
+                self.finish(std::make_error_code(std::errc::protocol_error));
+                return;
+            }
+            if (size == 0)
+            {
+                self.readTrailers();
+                return;
+            }
+            self.mRemaining = size;
+            self.readBodyBytes([](Request& r) {
+                // Each chunk ends with an empty line
+                r.readLine([](Request& req, std::string const&) {
+                    req.readChunkSize();
+                });
+            });
+        });
+    }
+
+    void
+    readTrailers()
+    {
+        readLine([](Request& self, std::string const& line) {
+            if (line.empty())
+            {
+                self.finish({});
+            }
+            else
+            {
+                self.readTrailers();
+            }
+        });
+    }
+
+    std::string
+    takeLine(size_t n)
+    {
+        auto begin = asio::buffers_begin(mBuf.data());
+        std::string line(begin, begin + n);
+        mBuf.consume(n);
+        return line;
+    }
+
+    void
+    writeBody(size_t n)
+    {
+        if (n > 0)
+        {
+            mOut.write(static_cast<char const*>(mBuf.data().data()), n);
+            mBuf.consume(n);
+        }
+    }
+
+    void
+    armTimer()
+    {
+        mTimer.expires_from_now(REQUEST_IDLE_TIMEOUT);
+        std::weak_ptr<Request> weak = shared_from_this();
+        mTimer.async_wait(
+            [weak]() {
+                auto self = weak.lock();
+                if (self && !self->mDone)
+                {
+                    self->finish(std::make_error_code(std::errc::timed_out));
+                }
+            },
+            &VirtualTimer::onFailureNoop);
+    }
+
+    void
+    closeSocket()
+    {
+        if (mSocket)
+        {
+            asio::error_code ignored;
+            mSocket->close(ignored);
+            mSocket.reset();
+        }
+    }
+
+    void
+    finish(asio::error_code ec)
+    {
+        if (mDone)
+        {
+            return;
+        }
+        mDone = true;
+        mTimer.cancel();
+        mOut.close();
+        if (!ec && mOut.fail())
+        {
+            ec = std::make_error_code(std::errc::io_error);
+        }
+        // A response we read to its end leaves nothing else on the wire
+        if (!ec && mKeepAlive && mBuf.size() == 0)
+        {
+            mClient.returnIdleConnection(mHostPort, std::move(mSocket));
+        }
+        else
+        {
+            closeSocket();
+        }
+        auto handler = std::move(mHandler);
+        mHandler = nullptr;
+        if (handler)
+        {
+            handler(ec);
+        }
+    }
+};
+
+HistoryArchiveHttpClient::HistoryArchiveHttpClient(Application& app)
+    : mApp(app)
+    , mConnectionsOpened(app.getMetrics().NewMeter(
+          {"history", "get", "connection-opened"}, "connection"))
+    , mConnectionsReused(app.getMetrics().NewMeter(
+          {"history", "get", "connection-reused"}, "connection"))
+{
+}
+
+HistoryArchiveHttpClient::~HistoryArchiveHttpClient()
+{
+    for (auto const& weak : mRequests)
+    {
+        auto req = weak.lock();
+        if (req)
+        {
+            req->cancel();
+        }
+    }
+}
+
+std::shared_ptr<HistoryArchiveHttpClient::Request>
+HistoryArchiveHttpClient::get(std::string const& url, std::string const& local,
+                              Handler handler)
+{
+    std::string host, port, path;
+    releaseAssert(parseUrl(url, host, port, path));
+
+    mRequests.erase(std::remove_if(mRequests.begin(), mRequests.end(),
+                                   [](std::weak_ptr<Request> const& r) {
+                                       return r.expired();
+                                   }),
+                    mRequests.end());
+    auto req = std::make_shared<Request>(*this, host, port, path, local,
+                                         std::move(handler));
+    mRequests.emplace_back(req);
+    req->start();
+    return req;
+}
+
+void
+HistoryArchiveHttpClient::cancel(std::shared_ptr<Request> const& req)
+{
+    req->cancel();
+}
+
+bool
+HistoryArchiveHttpClient::parseUrl(std::string const& url, std::string& host,
+                                   std::string& port, std::string& path)
+{
+    std::string const scheme = "http://";
+    if (toLower(url.substr(0, scheme.size())) != scheme)
+    {
+        return false;
+    }
+    auto slash = url.find('/', scheme.size());
+    auto authority = url.substr(scheme.size(), slash - scheme.size());
+    path = slash == std::string::npos ? "/" : url.substr(slash);
+
+    auto colon = authority.rfind(':');
+    if (colon == std::string::npos)
+    {
+        host = authority;
+        port = "80";
+    }
+    else
+    {
+        host = authority.substr(0, colon);
+        port = authority.substr(colon + 1);
+        if (port.empty() ||
+            !std::all_of(port.begin(), port.end(),
+                         [](unsigned char c) { return std::isdigit(c); }))
+        {
+            return false;
+        }
+    }
+    return !host.empty();
+}
+
+std::unique_ptr<HistoryArchiveHttpClient::Socket>
+HistoryArchiveHttpClient::takeIdleConnection(std::string const& hostPort)
+{
+    auto it = mIdleConnections.find(hostPort);
+    if (it == mIdleConnections.end() || it->second.empty())
+    {
+        return nullptr;
+    }
+    auto socket = std::move(it->second.back());
+    it->second.pop_back();
+    return socket;
+}
+
+void
+HistoryArchiveHttpClient::returnIdleConnection(std::string const& hostPort,
+                                               std::unique_ptr<Socket> socket)
+{
+    auto& idle = mIdleConnections[hostPort];
+    if (idle.size() < MAX_IDLE_CONNECTIONS_PER_HOST)
+    {
+        idle.emplace_back(std::move(socket));
+    }
+    else
+    {
+        asio::error_code ignored;
+        socket->close(ignored);
+    }
+}
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/NonCopyable.h"
+#include "util/asio.h"
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace medida
+{
+class Meter;
+}
+
+namespace stellar
+{
+class Application;
+
+// Downloads files from history archives configured with a plain http:// url,
+// on the main IO context instead of in a `get` subprocess per file. Each
+// host keeps a pool of idle HTTP/1.1 keep-alive connections that later
+// downloads reuse, so catching up through thousands of small files pays for
+// neither a fork/exec nor a TCP handshake per file. Retries and their backoff
+// are left to the work doing the download.
+class HistoryArchiveHttpClient : private NonMovableOrCopyable
+{
+  public:
+    // Called on the main thread when a download ends; ec is set if it failed,
+    // including when the server does not answer 200
+    using Handler = std::function<void(asio::error_code const& ec)>;
+
+    class Request;
+    using Socket = asio::ip::tcp::socket;
+
+    explicit HistoryArchiveHttpClient(Application& app);
+    ~HistoryArchiveHttpClient();
+
+    // Starts downloading url into the file local, replacing it. Once
+    // cancel()ed, the returned request never calls handler.
+    std::shared_ptr<Request> get(std::string const& url,
+                                 std::string const& local, Handler handler);
+    void cancel(std::shared_ptr<Request> const& req);
+
+    // Splits an http://host[:port][/path] url, returning false if it's not
+    // one. The port defaults to 80 and the path to "/".
+    static bool parseUrl(std::string const& url, std::string& host,
+                         std::string& port, std::string& path);
+
+  private:
+    // Above this many, idle connections to a host are closed instead
+    static constexpr size_t MAX_IDLE_CONNECTIONS_PER_HOST = 16;
+    // A download fails after this long without any progress
+    static constexpr std::chrono::seconds REQUEST_IDLE_TIMEOUT{60};
+
+    friend class Request;
+
+    Application& mApp;
+    // By "host:port"
+    std::map<std::string, std::vector<std::unique_ptr<Socket>>>
+        mIdleConnections;
+    medida::Meter& mConnectionsOpened;
+    medida::Meter& mConnectionsReused;
+    // Downloads in progress, cancelled if this client goes away first
+    std::vector<std::weak_ptr<Request>> mRequests;
+
+    std::unique_ptr<Socket> takeIdleConnection(std::string const& hostPort);
+    void returnIdleConnection(std::string const& hostPort,
+                              std::unique_ptr<Socket> socket);
+};
+}
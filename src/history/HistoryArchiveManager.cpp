@@ -4,6 +4,7 @@
 
 #include "history/HistoryArchiveManager.h"
 #include "history/HistoryArchive.h"
+#include "history/HistoryArchiveHttpClient.h"
 #include "history/HistoryArchiveReportWork.h"
 #include "historywork/CheckSingleLedgerHeaderWork.h"
 #include "historywork/GetHistoryArchiveStateWork.h"
@@ -28,6 +29,10 @@ HistoryArchiveManager::HistoryArchiveManager(Application& app) : mApp{app}
             std::make_shared<HistoryArchive>(app, archiveConfiguration.second));
 }
 
+HistoryArchiveManager::~HistoryArchiveManager()
+{
+}
+
 bool
 HistoryArchiveManager::checkSensibleConfig() const
 {
@@ -268,4 +273,14 @@ HistoryArchiveManager::getWritableHistoryArchives() const
                  });
     return result;
 }
+
+HistoryArchiveHttpClient&
+HistoryArchiveManager::getHttpClient()
+{
+    if (!mHttpClient)
+    {
+        mHttpClient = std::make_unique<HistoryArchiveHttpClient>(mApp);
+    }
+    return *mHttpClient;
+}
 }
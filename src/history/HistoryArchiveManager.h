@@ -13,6 +13,7 @@ namespace stellar
 class Application;
 class Config;
 class HistoryArchive;
+class HistoryArchiveHttpClient;
 
 class BasicWork;
 struct LedgerHeaderHistoryEntry;
@@ -21,6 +22,7 @@ class HistoryArchiveManager
 {
   public:
     explicit HistoryArchiveManager(Application& app);
+    ~HistoryArchiveManager();
 
     // Check that config settings are at least somewhat reasonable.
     bool checkSensibleConfig() const;
@@ -54,8 +56,13 @@ class HistoryArchiveManager
     std::vector<std::shared_ptr<HistoryArchive>>
     getWritableHistoryArchives() const;
 
+    // Returns the client downloading from archives configured with a url,
+    // shared so that they reuse each other's connections.
+    HistoryArchiveHttpClient& getHttpClient();
+
   private:
     Application& mApp;
     std::vector<std::shared_ptr<HistoryArchive>> mArchives;
+    std::unique_ptr<HistoryArchiveHttpClient> mHttpClient;
 };
 }
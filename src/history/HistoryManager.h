@@ -9,6 +9,7 @@
 #include "util/GlobalChecks.h"
 #include <functional>
 #include <memory>
+#include <vector>
 
 /**
  * The history module is responsible for storing and retrieving "historical
@@ -184,6 +185,8 @@ class BucketList;
 class Config;
 class Database;
 class HistoryArchive;
+class TransactionFrameBase;
+class TxSetXDRFrame;
 struct StateSnapshot;
 
 class HistoryManager
@@ -214,6 +217,9 @@ class HistoryManager
     // may be different (see ARTIFICIALLY_ACCELERATE_TIME_FOR_TESTING).
     virtual uint32_t getCheckpointFrequency() const = 0;
 
+    // The checkpoint frequency of an application running with cfg
+    static uint32_t getCheckpointFrequency(Config const& cfg);
+
     // Return checkpoint that contains given ledger. Checkpoint is identified
     // by last ledger in range. This does not consult the network nor take
     // account of manual checkpoints.
@@ -319,6 +325,16 @@ class HistoryManager
     // (typically after commit) with a call to publishQueuedHistory.
     virtual void queueCurrentHistory() = 0;
 
+    // Append a ledger that is closing -- its header, tx set with the txs in
+    // apply order, and their results -- to the files of the checkpoint being
+    // built, if any archive is writable, so that publishing doesn't have to
+    // read the checkpoint back from the database. Call before the ledger
+    // commits, and before maybeQueueHistoryCheckpoint.
+    virtual void appendLedgerToCheckpoint(
+        LedgerHeaderHistoryEntry const& header, TxSetXDRFrame const& txSet,
+        std::vector<std::shared_ptr<TransactionFrameBase>> const& txs,
+        TransactionResultSet const& results) = 0;
+
     // Return the youngest ledger still in the outgoing publish queue;
     // returns 0 if the publish queue has nothing in it.
     virtual uint32_t getMinLedgerQueuedToPublish() = 0;
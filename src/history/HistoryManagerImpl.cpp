@@ -12,6 +12,7 @@
 #include "crypto/Hex.h"
 #include "crypto/SHA.h"
 #include "herder/HerderImpl.h"
+#include "history/CheckpointBuilder.h"
 #include "history/HistoryArchive.h"
 #include "history/HistoryArchiveManager.h"
 #include "history/HistoryManagerImpl.h"
@@ -24,6 +25,7 @@
 #include "ledger/LedgerManager.h"
 #include "main/Application.h"
 #include "main/Config.h"
+#include "medida/counter.h"
 #include "medida/meter.h"
 #include "medida/metrics_registry.h"
 #include "overlay/StellarXDR.h"
@@ -76,6 +78,10 @@ HistoryManagerImpl::HistoryManagerImpl(Application& app)
           app.getMetrics().NewMeter({"history", "publish", "failure"}, "event"))
     , mEnqueueToPublishTimer(
           app.getMetrics().NewTimer({"history", "publish", "time"}))
+    , mPublishQueueLength(app.getMetrics().NewCounter(
+          {"history", "publish", "queue-length"}))
+    , mPublishBacklog(
+          app.getMetrics().NewCounter({"history", "publish", "backlog"}))
 {
 }
 
@@ -86,7 +92,13 @@ HistoryManagerImpl::~HistoryManagerImpl()
 uint32_t
 HistoryManagerImpl::getCheckpointFrequency() const
 {
-    if (mApp.getConfig().ARTIFICIALLY_ACCELERATE_TIME_FOR_TESTING)
+    return HistoryManager::getCheckpointFrequency(mApp.getConfig());
+}
+
+uint32_t
+HistoryManager::getCheckpointFrequency(Config const& cfg)
+{
+    if (cfg.ARTIFICIALLY_ACCELERATE_TIME_FOR_TESTING)
     {
         return 8;
     }
@@ -99,6 +111,15 @@ HistoryManagerImpl::getCheckpointFrequency() const
 void
 HistoryManagerImpl::logAndUpdatePublishStatus()
 {
+    // Checkpoints waiting to be published, and how many ledgers publishing
+    // lags behind the LCL
+    mPublishQueueLength.set_count(publishQueueLength());
+    auto minQueued = getMinLedgerQueuedToPublish();
+    auto lcl = mApp.getLedgerManager().getLastClosedLedgerNum();
+    mPublishBacklog.set_count(minQueued == 0 || minQueued > lcl
+                                  ? 0
+                                  : lcl - minQueued);
+
     std::stringstream stateStr;
     if (mPublishWork)
     {
@@ -256,6 +277,24 @@ HistoryManagerImpl::queueCurrentHistory()
     mPublishQueueBuckets.addBuckets(has.allBuckets());
 }
 
+void
+HistoryManagerImpl::appendLedgerToCheckpoint(
+    LedgerHeaderHistoryEntry const& header, TxSetXDRFrame const& txSet,
+    std::vector<std::shared_ptr<TransactionFrameBase>> const& txs,
+    TransactionResultSet const& results)
+{
+    ZoneScoped;
+    if (!mApp.getHistoryArchiveManager().hasAnyWritableHistoryArchive())
+    {
+        return;
+    }
+    if (!mCheckpointBuilder)
+    {
+        mCheckpointBuilder = std::make_unique<CheckpointBuilder>(mApp);
+    }
+    mCheckpointBuilder->appendLedger(header, txSet, txs, results);
+}
+
 void
 HistoryManagerImpl::takeSnapshotAndPublish(HistoryArchiveState const& has)
 {
@@ -451,6 +490,7 @@ HistoryManagerImpl::historyPublished(
         }
 
         mPublishQueueBuckets.removeBuckets(originalBuckets);
+        CheckpointBuilder::removeCompleted(mApp.getConfig(), ledgerSeq);
     }
     else
     {
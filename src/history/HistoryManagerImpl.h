@@ -12,6 +12,7 @@
 
 namespace medida
 {
+class Counter;
 class Meter;
 }
 
@@ -19,6 +20,7 @@ namespace stellar
 {
 
 class Application;
+class CheckpointBuilder;
 class Work;
 
 class HistoryManagerImpl : public HistoryManager
@@ -26,6 +28,7 @@ class HistoryManagerImpl : public HistoryManager
     Application& mApp;
     std::unique_ptr<TmpDir> mWorkDir;
     std::shared_ptr<BasicWork> mPublishWork;
+    std::unique_ptr<CheckpointBuilder> mCheckpointBuilder;
 
     PublishQueueBuckets mPublishQueueBuckets;
     bool mPublishQueueBucketsFilled{false};
@@ -35,6 +38,8 @@ class HistoryManagerImpl : public HistoryManager
     medida::Meter& mPublishFailure;
 
     medida::Timer& mEnqueueToPublishTimer;
+    medida::Counter& mPublishQueueLength;
+    medida::Counter& mPublishBacklog;
     UnorderedMap<uint32_t, std::chrono::steady_clock::time_point> mEnqueueTimes;
 
     PublishQueueBuckets::BucketCount loadBucketsReferencedByPublishQueue();
@@ -56,6 +61,11 @@ class HistoryManagerImpl : public HistoryManager
 
     void queueCurrentHistory() override;
 
+    void appendLedgerToCheckpoint(
+        LedgerHeaderHistoryEntry const& header, TxSetXDRFrame const& txSet,
+        std::vector<std::shared_ptr<TransactionFrameBase>> const& txs,
+        TransactionResultSet const& results) override;
+
     void takeSnapshotAndPublish(HistoryArchiveState const& has);
 
     uint32_t getMinLedgerQueuedToPublish() override;
@@ -9,6 +9,7 @@
 #include "crypto/Hex.h"
 #include "database/Database.h"
 #include "herder/HerderPersistence.h"
+#include "history/CheckpointBuilder.h"
 #include "history/FileTransferInfo.h"
 #include "history/HistoryArchive.h"
 #include "history/HistoryManager.h"
@@ -51,47 +52,66 @@ bool
 StateSnapshot::writeHistoryBlocks() const
 {
     ZoneScoped;
-    std::unique_ptr<soci::session> snapSess(
+    std::unique_ptr<PooledSession> snapSess(
         mApp.getDatabase().canUsePool()
-            ? std::make_unique<soci::session>(mApp.getDatabase().getPool())
+            ? std::make_unique<PooledSession>(mApp.getDatabase())
             : nullptr);
-    soci::session& sess(snapSess ? *snapSess : mApp.getDatabase().getSession());
+    soci::session& sess(snapSess ? snapSess->session()
+                                 : mApp.getDatabase().getSession());
     soci::transaction tx(sess);
 
     // The current "history block" is stored in _four_ files, one just ledger
     // headers, one TransactionHistoryEntry (which contain txSets),
     // one TransactionHistoryResultEntry containing transaction set results and
     // one (optional) SCPHistoryEntry containing the SCP messages used to close.
-    // All files are streamed out of the database, entry-by-entry.
+    // The first three are normally written as the ledgers of the checkpoint
+    // close, by the CheckpointBuilder; only when it couldn't build them are
+    // they streamed out of the database, entry-by-entry, like the SCP
+    // messages always are.
     size_t nbSCPMessages;
     uint32_t begin, count;
     size_t nHeaders;
     {
+        auto& hm = mApp.getHistoryManager();
+        begin = hm.firstLedgerInCheckpointContaining(mLocalState.currentLedger);
+        count = hm.sizeOfCheckpointContaining(mLocalState.currentLedger);
+
         bool doFsync = !mApp.getConfig().DISABLE_XDR_FSYNC;
         asio::io_context& ctx = mApp.getClock().getIOContext();
-        XDROutputFileStream ledgerOut(ctx, doFsync), txOut(ctx, doFsync),
-            txResultOut(ctx, doFsync), scpHistory(ctx, doFsync);
-        ledgerOut.open(mLedgerSnapFile->localPath_nogz());
-        txOut.open(mTransactionSnapFile->localPath_nogz());
-        txResultOut.open(mTransactionResultSnapFile->localPath_nogz());
+        XDROutputFileStream scpHistory(ctx, doFsync);
         scpHistory.open(mSCPHistorySnapFile->localPath_nogz());
 
-        auto& hm = mApp.getHistoryManager();
-        begin = hm.firstLedgerInCheckpointContaining(mLocalState.currentLedger);
-        count = hm.sizeOfCheckpointContaining(mLocalState.currentLedger);
-        CLOG_DEBUG(History, "Streaming {} ledgers worth of history, from {}",
-                   count, begin);
-
-        nHeaders = LedgerHeaderUtils::copyToStream(mApp.getDatabase(), sess,
-                                                   begin, count, ledgerOut);
-
-        size_t nTxs = copyTransactionsToStream(mApp, sess, begin, count, txOut,
-                                               txResultOut);
-        CLOG_DEBUG(History, "Wrote {} ledger headers to {}", nHeaders,
-                   mLedgerSnapFile->localPath_nogz());
-        CLOG_DEBUG(History, "Wrote {} transactions to {} and {}", nTxs,
-                   mTransactionSnapFile->localPath_nogz(),
-                   mTransactionResultSnapFile->localPath_nogz());
+        if (CheckpointBuilder::linkCompleted(
+                mApp.getConfig(), mLocalState.currentLedger, *mLedgerSnapFile,
+                *mTransactionSnapFile, *mTransactionResultSnapFile))
+        {
+            CLOG_DEBUG(History, "Using checkpoint {} built at ledger close",
+                       mLocalState.currentLedger);
+            nHeaders = count;
+        }
+        else
+        {
+            XDROutputFileStream ledgerOut(ctx, doFsync), txOut(ctx, doFsync),
+                txResultOut(ctx, doFsync);
+            ledgerOut.open(mLedgerSnapFile->localPath_nogz());
+            txOut.open(mTransactionSnapFile->localPath_nogz());
+            txResultOut.open(mTransactionResultSnapFile->localPath_nogz());
+
+            CLOG_DEBUG(History,
+                       "Streaming {} ledgers worth of history, from {}", count,
+                       begin);
+
+            nHeaders = LedgerHeaderUtils::copyToStream(
+                mApp.getDatabase(), sess, begin, count, ledgerOut);
+
+            size_t nTxs = copyTransactionsToStream(mApp, sess, begin, count,
+                                                   txOut, txResultOut);
+            CLOG_DEBUG(History, "Wrote {} ledger headers to {}", nHeaders,
+                       mLedgerSnapFile->localPath_nogz());
+            CLOG_DEBUG(History, "Wrote {} transactions to {} and {}", nTxs,
+                       mTransactionSnapFile->localPath_nogz(),
+                       mTransactionResultSnapFile->localPath_nogz());
+        }
 
         nbSCPMessages = HerderPersistence::copySCPHistoryToStream(
             mApp.getDatabase(), sess, begin, count, scpHistory);
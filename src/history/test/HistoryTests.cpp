@@ -6,7 +6,9 @@
 #include "bucket/test/BucketTestUtils.h"
 #include "catchup/CatchupManagerImpl.h"
 #include "catchup/test/CatchupWorkTests.h"
+#include "history/CheckpointBuilder.h"
 #include "history/FileTransferInfo.h"
+#include "history/HistoryArchiveHttpClient.h"
 #include "history/HistoryArchiveManager.h"
 #include "history/HistoryManager.h"
 #include "history/test/HistoryTestsUtils.h"
@@ -14,6 +16,7 @@
 #include "historywork/GunzipFileWork.h"
 #include "historywork/GzipFileWork.h"
 #include "historywork/PutHistoryArchiveStateWork.h"
+#include "ledger/LedgerHeaderUtils.h"
 #include "ledger/LedgerManager.h"
 #include "main/ExternalQueue.h"
 #include "main/PersistentState.h"
@@ -22,16 +25,21 @@
 #include "test/TestUtils.h"
 #include "test/TxTests.h"
 #include "test/test.h"
+#include "transactions/TransactionSQL.h"
 #include "util/Fs.h"
 #include "util/Logging.h"
+#include "util/XDRStream.h"
 #include "work/WorkScheduler.h"
 
 #include "historywork/BatchDownloadWork.h"
 #include "historywork/DownloadBucketsWork.h"
 #include "historywork/DownloadVerifyTxResultsWork.h"
 #include "historywork/VerifyTxResultsWork.h"
+#include "lib/http/server.hpp"
 #include <fmt/format.h>
+#include <fstream>
 #include <lib/catch.hpp>
+#include <optional>
 
 using namespace stellar;
 using namespace historytestutils;
@@ -104,6 +112,69 @@ TEST_CASE("HistoryManager compress", "[history]")
     REQUIRE(!fs::exists(compressed));
 }
 
+TEST_CASE("HistoryArchiveHttpClient", "[history]")
+{
+    std::string host, port, path;
+    SECTION("parse urls")
+    {
+        REQUIRE(HistoryArchiveHttpClient::parseUrl(
+            "http://history.stellar.org/prd/core-live", host, port, path));
+        REQUIRE(host == "history.stellar.org");
+        REQUIRE(port == "80");
+        REQUIRE(path == "/prd/core-live");
+        REQUIRE(HistoryArchiveHttpClient::parseUrl("http://127.0.0.1:8000",
+                                                   host, port, path));
+        REQUIRE(host == "127.0.0.1");
+        REQUIRE(port == "8000");
+        REQUIRE(path == "/");
+        REQUIRE(!HistoryArchiveHttpClient::parseUrl("https://example.com/",
+                                                    host, port, path));
+        REQUIRE(!HistoryArchiveHttpClient::parseUrl("http://example.com:x/",
+                                                    host, port, path));
+        REQUIRE(!HistoryArchiveHttpClient::parseUrl("http:///path", host,
+                                                    port, path));
+    }
+
+    SECTION("download")
+    {
+        VirtualClock clock(VirtualClock::REAL_TIME);
+        auto cfg = getTestConfig();
+        auto serverPort = cfg.HTTP_PORT;
+        cfg.HTTP_PORT = 0;
+        auto app = createTestApplication(clock, cfg);
+
+        std::string const content(100000, 'x');
+        http::server::server server(clock.getIOContext(), "127.0.0.1",
+                                    serverPort, 4);
+        server.addRoute("file", [&](std::string const&, std::string& ret) {
+            ret = content;
+        });
+        auto dir = app->getTmpDirManager().tmpDir("http-client-test");
+        auto local = dir.getName() + "/file";
+        auto base = fmt::format("http://127.0.0.1:{}/", serverPort);
+
+        auto& client = app->getHistoryArchiveManager().getHttpClient();
+        auto download = [&](std::string const& name) {
+            std::optional<asio::error_code> res;
+            client.get(base + name, local,
+                       [&](asio::error_code const& ec) { res = ec; });
+            while (!res)
+            {
+                clock.crank(true);
+            }
+            return *res;
+        };
+
+        REQUIRE(!download("file"));
+        std::ifstream in(local, std::ios::binary);
+        std::string got((std::istreambuf_iterator<char>(in)),
+                        std::istreambuf_iterator<char>());
+        REQUIRE(got == content);
+
+        REQUIRE(download("missing"));
+    }
+}
+
 TEST_CASE("HistoryArchiveState get_put", "[history]")
 {
     CatchupSimulation catchupSimulation{};
@@ -495,6 +566,90 @@ TEST_CASE("History publish to multiple archives", "[history]")
     REQUIRE(catchupSimulation.catchupOffline(catchupApp, checkpointLedger));
 }
 
+TEST_CASE("checkpoint files built at ledger close", "[history][publish]")
+{
+    VirtualClock clock;
+    TmpDirHistoryConfigurator tcfg;
+    Config cfg(getTestConfig());
+    cfg.ARTIFICIALLY_ACCELERATE_TIME_FOR_TESTING = true;
+    tcfg.configure(cfg, true);
+    auto app = createTestApplication(clock, cfg);
+    REQUIRE(app->getHistoryArchiveManager().initializeHistoryArchive(
+        tcfg.getArchiveDirName()));
+    auto& hm = app->getHistoryManager();
+    hm.setPublicationEnabled(false);
+
+    auto root = TestAccount::createRoot(*app);
+    auto a1 = root.create("a1", app->getLedgerManager().getLastMinBalance(2));
+    // Through the second checkpoint, with a transaction in every other ledger
+    uint32_t const checkpoint = 2 * hm.getCheckpointFrequency() - 1;
+    auto& lm = app->getLedgerManager();
+    while (lm.getLastClosedLedgerNum() < checkpoint)
+    {
+        std::vector<TransactionFrameBasePtr> txs;
+        if (lm.getLastClosedLedgerNum() % 2 == 0)
+        {
+            txs.emplace_back(root.tx({payment(a1, 100)}));
+        }
+        closeLedger(*app, txs);
+    }
+
+    auto snapDir = app->getTmpDirManager().tmpDir("checkpoints");
+    auto link = [&](uint32_t cp, TmpDir const& dir) {
+        return CheckpointBuilder::linkCompleted(
+            app->getConfig(), cp,
+            FileTransferInfo(dir, HISTORY_FILE_TYPE_LEDGER, cp),
+            FileTransferInfo(dir, HISTORY_FILE_TYPE_TRANSACTIONS, cp),
+            FileTransferInfo(dir, HISTORY_FILE_TYPE_RESULTS, cp));
+    };
+    // The genesis ledger isn't closed, so the first checkpoint isn't built
+    REQUIRE(!link(hm.getCheckpointFrequency() - 1, snapDir));
+    REQUIRE(link(checkpoint, snapDir));
+
+    // The files are identical to those written from the database
+    auto sqlDir = app->getTmpDirManager().tmpDir("sql");
+    {
+        auto& ctx = clock.getIOContext();
+        XDROutputFileStream ledgerOut(ctx, false), txOut(ctx, false),
+            resultsOut(ctx, false);
+        ledgerOut.open(
+            FileTransferInfo(sqlDir, HISTORY_FILE_TYPE_LEDGER, checkpoint)
+                .localPath_nogz());
+        txOut.open(
+            FileTransferInfo(sqlDir, HISTORY_FILE_TYPE_TRANSACTIONS, checkpoint)
+                .localPath_nogz());
+        resultsOut.open(
+            FileTransferInfo(sqlDir, HISTORY_FILE_TYPE_RESULTS, checkpoint)
+                .localPath_nogz());
+        auto& sess = app->getDatabase().getSession();
+        auto first = hm.firstLedgerInCheckpointContaining(checkpoint);
+        auto count = hm.sizeOfCheckpointContaining(checkpoint);
+        REQUIRE(LedgerHeaderUtils::copyToStream(app->getDatabase(), sess,
+                                                first, count,
+                                                ledgerOut) == count);
+        REQUIRE(copyTransactionsToStream(*app, sess, first, count, txOut,
+                                         resultsOut) == count / 2);
+    }
+    auto contents = [](std::string const& path) {
+        std::ifstream in(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), {});
+    };
+    for (auto type : {HISTORY_FILE_TYPE_LEDGER, HISTORY_FILE_TYPE_TRANSACTIONS,
+                      HISTORY_FILE_TYPE_RESULTS})
+    {
+        auto built = contents(
+            FileTransferInfo(snapDir, type, checkpoint).localPath_nogz());
+        auto fromSql = contents(
+            FileTransferInfo(sqlDir, type, checkpoint).localPath_nogz());
+        CHECK(!built.empty());
+        CHECK(built == fromSql);
+    }
+
+    // Published checkpoints are removed
+    hm.historyPublished(checkpoint, {}, true);
+    REQUIRE(!link(checkpoint, snapDir));
+}
+
 TEST_CASE("History catchup with extra validation", "[history][publish]")
 {
     CatchupSimulation catchupSimulation{};
@@ -507,6 +662,38 @@ TEST_CASE("History catchup with extra validation", "[history][publish]")
     REQUIRE(catchupSimulation.catchupOffline(app, checkpointLedger, true));
 }
 
+TEST_CASE("Catchup report", "[history][catchup]")
+{
+    CatchupSimulation catchupSimulation{};
+    auto checkpointLedger = catchupSimulation.getLastCheckpointLedger(2);
+    catchupSimulation.ensureOfflineCatchupPossible(checkpointLedger);
+
+    auto app = catchupSimulation.createCatchupApplication(
+        64, Config::TESTDB_IN_MEMORY_SQLITE, "app");
+    REQUIRE(app->getCatchupManager().getCatchupReport().isNull());
+    REQUIRE(catchupSimulation.catchupOffline(app, checkpointLedger));
+
+    auto report = app->getCatchupManager().getCatchupReport();
+    REQUIRE(report["state"].asString() == "WORK_SUCCESS");
+    REQUIRE(report["downloaded_bytes"].asUInt64() > 0);
+    REQUIRE(report["counts"]["ledgers_verified"].asUInt64() > 0);
+
+    std::set<std::string> names;
+    for (auto const& stage : report["stages"])
+    {
+        names.emplace(stage["name"].asString());
+        REQUIRE(stage["state"].asString() == "WORK_SUCCESS");
+    }
+    REQUIRE(names.count("get-archive-state") == 1);
+    REQUIRE(names.count("download-ledgers") == 1);
+    REQUIRE(names.count("verify-ledger-chain") == 1);
+    REQUIRE(names.count("download-verify-buckets") == 1);
+    REQUIRE(names.count("apply-buckets") == 1);
+    REQUIRE(names.count("download-apply-ledgers") == 1);
+
+    REQUIRE(app->getJsonInfo(false)["info"]["catchup"] == report);
+}
+
 TEST_CASE("Publish works correctly post shadow removal", "[history]")
 {
     // Given a HAS, verify that appropriate levels have "next" cleared, while
@@ -3,19 +3,50 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "historywork/DownloadBucketsWork.h"
+#include "bucket/BucketIndex.h"
 #include "bucket/BucketManager.h"
 #include "catchup/CatchupManager.h"
+#include "crypto/Hex.h"
+#include "crypto/Random.h"
 #include "history/FileTransferInfo.h"
 #include "history/HistoryArchive.h"
 #include "historywork/GetAndUnzipRemoteFileWork.h"
 #include "historywork/VerifyBucketWork.h"
+#include "main/Config.h"
+#include "util/Fs.h"
+#include "util/Logging.h"
 #include "work/WorkWithCallback.h"
 #include <Tracy.hpp>
+#include <filesystem>
 #include <fmt/format.h>
 
 namespace stellar
 {
 
+namespace
+{
+// Links or copies a verified bucket into the cache, through a temporary name
+// so that other nodes sharing the cache never see a partial file
+void
+addToBucketCache(std::string const& bucket, std::string const& cached)
+{
+    if (fs::exists(cached))
+    {
+        return;
+    }
+    fs::mkpath(std::filesystem::path(cached).parent_path().string());
+    auto tmp = cached + ".tmp-" + binToHex(randomBytes(8));
+    if (fs::linkOrCopy(bucket, tmp) &&
+        std::rename(tmp.c_str(), cached.c_str()) == 0)
+    {
+        CLOG_DEBUG(History, "Added {} to bucket cache", cached);
+        return;
+    }
+    CLOG_WARNING(History, "Failed to add {} to bucket cache", cached);
+    std::remove(tmp.c_str());
+}
+}
+
 DownloadBucketsWork::DownloadBucketsWork(
     Application& app, std::map<std::string, std::shared_ptr<Bucket>>& buckets,
     std::vector<std::string> hashes, TmpDir const& downloadDir,
@@ -72,7 +103,14 @@ DownloadBucketsWork::yieldMoreWork()
 
     auto hash = *mNextBucketIter;
     FileTransferInfo ft(mDownloadDir, HISTORY_FILE_TYPE_BUCKET, hash);
-    auto w1 = std::make_shared<GetAndUnzipRemoteFileWork>(mApp, ft, mArchive);
+    auto const& cacheDir = mApp.getConfig().BUCKET_CACHE_DIR_PATH;
+    std::string cached;
+    if (!cacheDir.empty())
+    {
+        cached = cacheDir + "/" + ft.baseName_nogz();
+    }
+    auto w1 = std::make_shared<GetAndUnzipRemoteFileWork>(
+        mApp, ft, mArchive, BasicWork::RETRY_A_LOT, cached);
 
     auto getFileWeak = std::weak_ptr<GetAndUnzipRemoteFileWork>(w1);
     OnFailureCallback failureCb = [getFileWeak, hash]() {
@@ -89,21 +127,33 @@ DownloadBucketsWork::yieldMoreWork()
     };
     std::weak_ptr<DownloadBucketsWork> weak(
         std::static_pointer_cast<DownloadBucketsWork>(shared_from_this()));
-    auto successCb = [weak, ft, hash](Application& app) -> bool {
+    auto successCb = [weak, ft, hash, cached](Application& app) -> bool {
         auto self = weak.lock();
         if (self)
         {
             auto bucketPath = ft.localPath_nogz();
+            std::unique_ptr<BucketIndex const> index;
+            if (auto it = self->mIndexes.find(hash);
+                it != self->mIndexes.end())
+            {
+                index = std::move(it->second);
+                self->mIndexes.erase(it);
+            }
             auto b = app.getBucketManager().adoptFileAsBucket(
                 bucketPath, hexToBin256(hash),
-                /*mergeKey=*/nullptr,
-                /*index=*/nullptr);
+                /*mergeKey=*/nullptr, std::move(index),
+                /*inMemoryEntries=*/nullptr);
             self->mBuckets[hash] = b;
+            if (!cached.empty() && !app.getConfig().BUCKET_CACHE_READ_ONLY)
+            {
+                addToBucketCache(b->getFilename().string(), cached);
+            }
         }
         return true;
     };
-    auto w2 = std::make_shared<VerifyBucketWork>(mApp, ft.localPath_nogz(),
-                                                 hexToBin256(hash), failureCb);
+    auto w2 = std::make_shared<VerifyBucketWork>(
+        mApp, ft.localPath_nogz(), hexToBin256(hash), failureCb,
+        &mIndexes[hash]);
     auto w3 = std::make_shared<WorkWithCallback>(mApp, "adopt-verified-bucket",
                                                  successCb);
     std::vector<std::shared_ptr<BasicWork>> seq{w1, w2, w3};
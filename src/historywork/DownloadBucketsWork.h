@@ -23,6 +23,10 @@ class DownloadBucketsWork : public BatchWork
     TmpDir const& mDownloadDir;
     std::shared_ptr<HistoryArchive> mArchive;
 
+    // Indexes built while verifying downloaded buckets, by bucket hash, until
+    // the bucket is adopted
+    std::map<std::string, std::unique_ptr<BucketIndex const>> mIndexes;
+
   public:
     DownloadBucketsWork(Application& app,
                         std::map<std::string, std::shared_ptr<Bucket>>& buckets,
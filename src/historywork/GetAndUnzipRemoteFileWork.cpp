@@ -17,11 +17,13 @@ namespace stellar
 
 GetAndUnzipRemoteFileWork::GetAndUnzipRemoteFileWork(
     Application& app, FileTransferInfo ft,
-    std::shared_ptr<HistoryArchive> archive, size_t retry)
+    std::shared_ptr<HistoryArchive> archive, size_t retry,
+    std::string localCopy)
     : Work(app, std::string("get-and-unzip-remote-file ") + ft.remoteName(),
            retry)
     , mFt(std::move(ft))
     , mArchive(archive)
+    , mLocalCopy(std::move(localCopy))
 {
 }
 
@@ -105,6 +107,17 @@ GetAndUnzipRemoteFileWork::doWork()
     }
     else
     {
+        if (!mLocalCopy.empty() && !mTriedLocalCopy)
+        {
+            mTriedLocalCopy = true;
+            if (fs::exists(mLocalCopy) &&
+                fs::linkOrCopy(mLocalCopy, mFt.localPath_nogz()))
+            {
+                CLOG_DEBUG(History, "Using {} instead of downloading {}",
+                           mLocalCopy, mFt.remoteName());
+                return State::WORK_SUCCESS;
+            }
+        }
         CLOG_DEBUG(History, "Downloading and unzipping {}", mFt.remoteName());
         mGetRemoteFileWork =
             addWork<GetRemoteFileWork>(mFt.remoteName(), mFt.localPath_gz_tmp(),
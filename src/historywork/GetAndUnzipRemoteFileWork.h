@@ -20,6 +20,8 @@ class GetAndUnzipRemoteFileWork : public Work
 
     FileTransferInfo mFt;
     std::shared_ptr<HistoryArchive> const mArchive;
+    std::string const mLocalCopy;
+    bool mTriedLocalCopy{false};
 
     bool validateFile();
 
@@ -27,9 +29,15 @@ class GetAndUnzipRemoteFileWork : public Work
     // Passing `nullptr` for the archive argument will cause the work to
     // select a new readable history archive at random each time it runs /
     // retries.
+    //
+    // If `localCopy` names an existing file, the first run links or copies it
+    // to the .xdr path instead of downloading, and retries download as usual.
+    // This is for files verified afterwards, whose retries start with a
+    // failed verification.
     GetAndUnzipRemoteFileWork(Application& app, FileTransferInfo ft,
                               std::shared_ptr<HistoryArchive> archive = nullptr,
-                              size_t retry = BasicWork::RETRY_A_LOT);
+                              size_t retry = BasicWork::RETRY_A_LOT,
+                              std::string localCopy = "");
     ~GetAndUnzipRemoteFileWork() = default;
     std::string getStatus() const override;
     std::shared_ptr<HistoryArchive> getArchive() const;
@@ -30,8 +30,8 @@ GetRemoteFileWork::GetRemoteFileWork(Application& app,
 {
 }
 
-CommandInfo
-GetRemoteFileWork::getCommand()
+void
+GetRemoteFileWork::selectArchive()
 {
     mCurrentArchive = mArchive;
     if (!mCurrentArchive)
@@ -41,14 +41,75 @@ GetRemoteFileWork::getCommand()
     }
     releaseAssert(mCurrentArchive);
     releaseAssert(mCurrentArchive->hasGetCmd());
+    mSelectedArchive = true;
+}
+
+CommandInfo
+GetRemoteFileWork::getCommand()
+{
+    releaseAssert(mSelectedArchive);
     auto cmdLine = mCurrentArchive->getFileCmd(mRemote, mLocal);
 
     return CommandInfo{cmdLine, std::string()};
 }
 
+BasicWork::State
+GetRemoteFileWork::onRun()
+{
+    if (!mSelectedArchive)
+    {
+        selectArchive();
+    }
+    if (!mCurrentArchive->hasGetUrl())
+    {
+        return RunCommandWork::onRun();
+    }
+
+    if (mHttpDone)
+    {
+        return mHttpEc ? State::WORK_FAILURE : State::WORK_SUCCESS;
+    }
+    if (!mHttpRequest)
+    {
+        std::weak_ptr<GetRemoteFileWork> weak(
+            std::static_pointer_cast<GetRemoteFileWork>(shared_from_this()));
+        mHttpRequest = mApp.getHistoryArchiveManager().getHttpClient().get(
+            mCurrentArchive->getFileUrl(mRemote), mLocal,
+            [weak](asio::error_code const& ec) {
+                auto self = weak.lock();
+                if (self && !self->isDone())
+                {
+                    self->mHttpEc = ec;
+                    self->mHttpDone = true;
+                    self->wakeUp();
+                }
+            });
+    }
+    return State::WORK_WAITING;
+}
+
+bool
+GetRemoteFileWork::onAbort()
+{
+    if (mHttpRequest)
+    {
+        mApp.getHistoryArchiveManager().getHttpClient().cancel(mHttpRequest);
+        return true;
+    }
+    return RunCommandWork::onAbort();
+}
+
 void
 GetRemoteFileWork::onReset()
 {
+    if (mHttpRequest)
+    {
+        mApp.getHistoryArchiveManager().getHttpClient().cancel(mHttpRequest);
+        mHttpRequest.reset();
+    }
+    mHttpDone = false;
+    mHttpEc = asio::error_code();
+    mSelectedArchive = false;
     std::remove(mLocal.c_str());
     RunCommandWork::onReset();
 }
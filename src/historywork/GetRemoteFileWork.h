@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include "history/HistoryArchiveHttpClient.h"
 #include "historywork/RunCommandWork.h"
 #include "medida/medida.h"
 
@@ -12,13 +13,21 @@ namespace stellar
 
 class HistoryArchive;
 
+// Downloads a file by running the archive's `get` command or, for archives
+// configured with a url, in process through the HistoryArchiveHttpClient.
 class GetRemoteFileWork : public RunCommandWork
 {
     std::string const mRemote;
     std::string const mLocal;
     std::shared_ptr<HistoryArchive> const mArchive;
     std::shared_ptr<HistoryArchive> mCurrentArchive;
+    // Whether mCurrentArchive was selected for the current attempt
+    bool mSelectedArchive{false};
+    std::shared_ptr<HistoryArchiveHttpClient::Request> mHttpRequest;
+    bool mHttpDone{false};
+    asio::error_code mHttpEc;
     CommandInfo getCommand() override;
+    void selectArchive();
     medida::Meter& mFailuresPerSecond;
     medida::Meter& mBytesPerSecond;
 
@@ -34,6 +43,8 @@ class GetRemoteFileWork : public RunCommandWork
     std::shared_ptr<HistoryArchive> getCurrentArchive() const;
 
   protected:
+    BasicWork::State onRun() override;
+    bool onAbort() override;
     void onReset() override;
     void onSuccess() override;
     void onFailureRaise() override;
@@ -3,6 +3,8 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "historywork/GzipFileWork.h"
+#include "main/Application.h"
+#include "main/Config.h"
 #include "util/Fs.h"
 
 namespace stellar
@@ -28,7 +30,7 @@ GzipFileWork::onReset()
 CommandInfo
 GzipFileWork::getCommand()
 {
-    std::string cmdLine = "gzip ";
+    std::string cmdLine = mApp.getConfig().GZIP_COMMAND + " ";
     std::string outFile;
     if (mKeepExisting)
     {
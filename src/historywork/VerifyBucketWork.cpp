@@ -3,12 +3,17 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "historywork/VerifyBucketWork.h"
+#include "bucket/BucketIndex.h"
+#include "bucket/BucketManager.h"
 #include "crypto/Hex.h"
 #include "crypto/SHA.h"
 #include "main/Application.h"
+#include "main/Config.h"
 #include "main/ErrorMessages.h"
 #include "util/Fs.h"
 #include "util/Logging.h"
+#include "util/RateLimiter.h"
+#include "util/XDRStream.h"
 #include <fmt/format.h>
 
 #include <Tracy.hpp>
@@ -20,13 +25,71 @@
 namespace stellar
 {
 
+namespace
+{
+// Splits the bytes of a bucket file, fed in arbitrarily sized chunks, into
+// XDR records and adds each record to an index builder
+class StreamingIndexer
+{
+    BucketIndexBuilder& mBuilder;
+
+    // Bytes of the record that was cut off at the end of the previous chunk
+    std::vector<char> mPending;
+
+    // File offset of mPending[0]
+    std::streamoff mPendingOffset{0};
+
+  public:
+    explicit StreamingIndexer(BucketIndexBuilder& builder) : mBuilder(builder)
+    {
+    }
+
+    void
+    add(char const* data, size_t size)
+    {
+        mPending.insert(mPending.end(), data, data + size);
+
+        size_t pos = 0;
+        while (mPending.size() - pos >= 4)
+        {
+            auto sz = XDRInputFileStream::getXDRSize(mPending.data() + pos);
+            if (mPending.size() - pos - 4 < sz)
+            {
+                break;
+            }
+
+            BucketEntry be;
+            xdr::xdr_get g(mPending.data() + pos + 4,
+                           mPending.data() + pos + 4 + sz);
+            xdr::xdr_argpack_archive(g, be);
+            mBuilder.add(be, mPendingOffset + pos);
+            pos += 4 + sz;
+        }
+
+        mPending.erase(mPending.begin(), mPending.begin() + pos);
+        mPendingOffset += pos;
+    }
+
+    // True if the input so far ends on a record boundary
+    bool
+    complete() const
+    {
+        return mPending.empty();
+    }
+};
+}
+
 VerifyBucketWork::VerifyBucketWork(Application& app,
                                    std::string const& bucketFile,
                                    uint256 const& hash,
-                                   OnFailureCallback failureCb)
+                                   OnFailureCallback failureCb,
+                                   std::unique_ptr<BucketIndex const>* index,
+                                   std::shared_ptr<RateLimiter> readLimiter)
     : BasicWork(app, "verify-bucket-hash-" + bucketFile, BasicWork::RETRY_NEVER)
     , mBucketFile(bucketFile)
     , mHash(hash)
+    , mIndex(index)
+    , mReadLimiter(readLimiter)
     , mOnFailure(failureCb)
 {
 }
@@ -54,13 +117,18 @@ VerifyBucketWork::spawnVerifier()
     std::string filename = mBucketFile;
     uint256 hash = mHash;
     Application& app = this->mApp;
+    bool buildIndex = mIndex && app.getConfig().isUsingBucketListDB();
+    auto readLimiter = mReadLimiter;
     std::weak_ptr<VerifyBucketWork> weak(
         std::static_pointer_cast<VerifyBucketWork>(shared_from_this()));
     app.postOnBackgroundThread(
-        [&app, filename, weak, hash]() {
+        [&app, filename, weak, hash, buildIndex, readLimiter]() {
             SHA256 hasher;
             asio::error_code ec;
 
+            // Shared so the main thread callback below stays copyable
+            auto index = std::make_shared<std::unique_ptr<BucketIndex const>>();
+
             // No point in verifying buckets if things are shutting down
             auto self = weak.lock();
             if (!self || self->isAborting())
@@ -82,17 +150,53 @@ VerifyBucketWork::spawnVerifier()
                         FMT_STRING("Error opening file {}"), filename));
                 }
                 in.exceptions(std::ios::badbit);
-                char buf[4096];
+
+                std::unique_ptr<BucketIndexBuilder> builder;
+                std::unique_ptr<StreamingIndexer> indexer;
+                size_t fileSize = 0;
+                if (buildIndex)
+                {
+                    fileSize = fs::size(filename);
+                    builder = BucketIndex::createBuilder(app.getBucketManager(),
+                                                         fileSize);
+                    indexer = std::make_unique<StreamingIndexer>(*builder);
+                }
+
+                std::vector<char> buf(fs::bufsz());
                 while (in)
                 {
-                    in.read(buf, sizeof(buf));
-                    hasher.add(ByteSlice(buf, in.gcount()));
+                    in.read(buf.data(), buf.size());
+                    if (readLimiter)
+                    {
+                        readLimiter->acquire(in.gcount());
+                    }
+                    hasher.add(ByteSlice(buf.data(), in.gcount()));
+                    if (indexer)
+                    {
+                        try
+                        {
+                            indexer->add(buf.data(), in.gcount());
+                        }
+                        catch (xdr::xdr_runtime_error const& e)
+                        {
+                            // Leave this to the hash check and to indexing on
+                            // adoption, as before
+                            CLOG_DEBUG(History,
+                                       "Not indexing {} while verifying: {}",
+                                       filename, e.what());
+                            indexer.reset();
+                        }
+                    }
                 }
                 uint256 vHash = hasher.finish();
                 if (vHash == hash)
                 {
                     CLOG_DEBUG(History, "Verified hash ({}) for {}",
                                hexAbbrev(hash), filename);
+                    if (indexer && indexer->complete())
+                    {
+                        *index = builder->finish(hash, fileSize);
+                    }
                 }
                 else
                 {
@@ -114,18 +218,23 @@ VerifyBucketWork::spawnVerifier()
             // main thread, since BasicWork's state is not thread-safe. This is
             // a temporary workaround, as a cleaner solution is needed.
             app.postOnMainThread(
-                [weak, ec]() {
+                [weak, ec, index]() {
                     auto self = weak.lock();
                     if (self)
                     {
                         self->mEc = ec;
                         self->mDone = true;
+                        if (self->mIndex && !ec)
+                        {
+                            *self->mIndex = std::move(*index);
+                        }
                         self->wakeUp();
                     }
                 },
                 "VerifyBucket: finish");
         },
-        "VerifyBucket: start in background");
+        "VerifyBucket: start in background",
+        WorkerPriority::BULK);
 }
 
 void
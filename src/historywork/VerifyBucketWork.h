@@ -7,6 +7,8 @@
 #include "work/Work.h"
 #include "xdr/Stellar-types.h"
 
+#include <memory>
+
 namespace medida
 {
 class Meter;
@@ -16,13 +18,23 @@ namespace stellar
 {
 
 class Bucket;
-
+class BucketIndex;
+class RateLimiter;
+
+// Verifies that the hash of bucketFile matches hash. If index is not null and
+// BucketListDB is enabled, the bucket's index is built in the same pass over
+// the file and stored in *index on success, so that adopting the verified
+// bucket does not need to read it again. *index is left null if the index
+// could not be built in that pass. If readLimiter is not null, reading the
+// file is paced by it.
 class VerifyBucketWork : public BasicWork
 {
     std::string mBucketFile;
     uint256 mHash;
     bool mDone{false};
     std::error_code mEc;
+    std::unique_ptr<BucketIndex const>* mIndex;
+    std::shared_ptr<RateLimiter> mReadLimiter;
 
     void spawnVerifier();
 
@@ -30,7 +42,9 @@ class VerifyBucketWork : public BasicWork
 
   public:
     VerifyBucketWork(Application& app, std::string const& bucketFile,
-                     uint256 const& hash, OnFailureCallback failureCb);
+                     uint256 const& hash, OnFailureCallback failureCb,
+                     std::unique_ptr<BucketIndex const>* index = nullptr,
+                     std::shared_ptr<RateLimiter> readLimiter = nullptr);
     ~VerifyBucketWork() = default;
 
   protected:
@@ -0,0 +1,84 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "historywork/VerifyBucketsWork.h"
+#include "historywork/VerifyBucketWork.h"
+#include "util/GlobalChecks.h"
+#include "util/Logging.h"
+#include "util/RateLimiter.h"
+#include <Tracy.hpp>
+#include <fmt/format.h>
+
+namespace stellar
+{
+
+VerifyBucketsWork::VerifyBucketsWork(
+    Application& app, std::vector<std::pair<std::string, uint256>> buckets,
+    size_t maxConcurrent, uint64_t maxReadBytesPerSecond)
+    : BatchWork{app, "verify-buckets"}
+    , mBuckets{std::move(buckets)}
+    , mNextBucket{mBuckets.begin()}
+    , mMaxConcurrent{maxConcurrent}
+    , mReadLimiter{std::make_shared<RateLimiter>(maxReadBytesPerSecond)}
+{
+    releaseAssert(mMaxConcurrent > 0);
+}
+
+std::string
+VerifyBucketsWork::getStatus() const
+{
+    if (!isDone() && !isAborting() && !mBuckets.empty())
+    {
+        size_t numStarted = std::distance(mBuckets.cbegin(), mNextBucket);
+        auto numDone = numStarted - getNumWorksInBatch();
+        auto total = mBuckets.size();
+        auto pct = (100 * numDone) / total;
+        return fmt::format(FMT_STRING("verifying buckets: {:d}/{:d} ({:d}%)"),
+                           numDone, total, pct);
+    }
+    return Work::getStatus();
+}
+
+bool
+VerifyBucketsWork::hasNext() const
+{
+    return mNextBucket != mBuckets.end();
+}
+
+void
+VerifyBucketsWork::resetIter()
+{
+    mNextBucket = mBuckets.begin();
+}
+
+size_t
+VerifyBucketsWork::getMaxBatchSize() const
+{
+    return mMaxConcurrent;
+}
+
+std::shared_ptr<BasicWork>
+VerifyBucketsWork::yieldMoreWork()
+{
+    ZoneScoped;
+    if (!hasNext())
+    {
+        throw std::runtime_error("Nothing to iterate over!");
+    }
+
+    // Past the first batch, a bucket only starts when another one is done,
+    // so this is also where progress gets reported
+    if (static_cast<size_t>(std::distance(mBuckets.cbegin(), mNextBucket)) >=
+        mMaxConcurrent)
+    {
+        CLOG_INFO(History, "{}", getStatus());
+    }
+
+    auto const& bucket = *mNextBucket;
+    auto w = std::make_shared<VerifyBucketWork>(
+        mApp, bucket.first, bucket.second, nullptr, nullptr, mReadLimiter);
+    ++mNextBucket;
+    return w;
+}
+}
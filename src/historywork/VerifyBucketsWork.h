@@ -0,0 +1,44 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+#pragma once
+
+#include "work/BatchWork.h"
+#include "xdr/Stellar-types.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace stellar
+{
+
+class RateLimiter;
+
+// Verifies the hashes of a set of local bucket files, up to maxConcurrent at
+// once, with reads from all of them paced to at most maxReadBytesPerSecond
+// (0 for no limit) so that checking a large BucketList does not starve other
+// users of the disk.
+class VerifyBucketsWork : public BatchWork
+{
+    // Bucket files and their expected hashes
+    std::vector<std::pair<std::string, uint256>> mBuckets;
+    std::vector<std::pair<std::string, uint256>>::const_iterator mNextBucket;
+    size_t const mMaxConcurrent;
+    std::shared_ptr<RateLimiter> mReadLimiter;
+
+  public:
+    VerifyBucketsWork(Application& app,
+                      std::vector<std::pair<std::string, uint256>> buckets,
+                      size_t maxConcurrent, uint64_t maxReadBytesPerSecond);
+    ~VerifyBucketsWork() = default;
+    std::string getStatus() const override;
+
+  protected:
+    bool hasNext() const override;
+    std::shared_ptr<BasicWork> yieldMoreWork() override;
+    void resetIter() override;
+    size_t getMaxBatchSize() const override;
+};
+}
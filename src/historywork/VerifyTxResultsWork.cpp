@@ -79,7 +79,8 @@ VerifyTxResultsWork::onRun()
         }
     };
 
-    mApp.postOnBackgroundThread(verify, "VerifyTxResults: start in background");
+    mApp.postOnBackgroundThread(verify, "VerifyTxResults: start in background",
+                                WorkerPriority::BULK);
     return State::WORK_WAITING;
 }
 
@@ -6,6 +6,7 @@
 #include "bucket/Bucket.h"
 #include "bucket/BucketInputIterator.h"
 #include "bucket/BucketManager.h"
+#include "bucket/LedgerCmp.h"
 #include "crypto/Hex.h"
 #include "history/HistoryArchive.h"
 #include "invariant/InvariantManager.h"
@@ -15,12 +16,17 @@
 #include "ledger/LedgerTxnEntry.h"
 #include "main/Application.h"
 #include "main/PersistentState.h"
-#include "medida/timer.h"
+#include "util/UnorderedSet.h"
 #include "util/XDRCereal.h"
+#include "util/types.h"
+#include <algorithm>
 #include <chrono>
 #include <fmt/chrono.h>
 #include <fmt/format.h>
+#include <limits>
 #include <map>
+#include <optional>
+#include <vector>
 
 namespace stellar
 {
@@ -180,76 +186,269 @@ struct EntryCounts
     }
 };
 
+namespace
+{
+// Streams the newest version of every live entry in a BucketList in key
+// order, by merging iterators over all of its buckets. Unlike
+// BucketManager::loadCompleteLedgerState, this holds one entry per bucket
+// rather than the whole ledger in memory. With offersOnly, each bucket is
+// only read over its offer range.
+class NewestLiveEntries
+{
+    // Newest first, so that the first of equal keys wins
+    std::vector<std::unique_ptr<BucketInputIterator>> mIters;
+    std::vector<std::streamoff> mUpperBounds;
+
+    bool
+    isValid(size_t i)
+    {
+        return *mIters[i] && mIters[i]->pos() <= mUpperBounds[i];
+    }
+
+  public:
+    NewestLiveEntries(std::vector<std::shared_ptr<Bucket const>> const& buckets,
+                      bool offersOnly)
+    {
+        for (auto const& b : buckets)
+        {
+            auto iter = std::make_unique<BucketInputIterator>(b);
+            auto upperBound = std::numeric_limits<std::streamoff>::max();
+            if (offersOnly)
+            {
+                auto range = b->getOfferRange();
+                if (!range)
+                {
+                    continue;
+                }
+                // As in BucketApplicator, pos() is the offset at the end of
+                // the current entry, inclusive of the upper bound
+                iter->seek(range->first);
+                upperBound = range->second;
+            }
+            mIters.emplace_back(std::move(iter));
+            mUpperBounds.emplace_back(upperBound);
+        }
+    }
+
+    // Returns false once every entry has been streamed
+    bool
+    next(LedgerEntry& entry)
+    {
+        BucketEntryIdCmp cmp;
+        while (true)
+        {
+            std::optional<size_t> newest;
+            for (size_t i = 0; i < mIters.size(); ++i)
+            {
+                if (!isValid(i))
+                {
+                    continue;
+                }
+                if (!newest || cmp(**mIters[i], **mIters[*newest]))
+                {
+                    newest = i;
+                }
+            }
+            if (!newest)
+            {
+                return false;
+            }
+
+            BucketEntry be = **mIters[*newest];
+            for (size_t i = 0; i < mIters.size(); ++i)
+            {
+                if (isValid(i) && !cmp(be, **mIters[i]))
+                {
+                    ++*mIters[i];
+                }
+            }
+            if (be.type() == LIVEENTRY || be.type() == INITENTRY)
+            {
+                entry = be.liveEntry();
+                return true;
+            }
+        }
+    }
+};
+
+// Logs progress of the full check every 2^19 entries, with its throughput
+class CheckProgress
+{
+    std::chrono::steady_clock::time_point const mStart{
+        std::chrono::steady_clock::now()};
+    uint64_t mChecked{0};
+
+  public:
+    void
+    add(uint64_t n)
+    {
+        auto before = mChecked;
+        mChecked += n;
+        if ((before >> 19) != (mChecked >> 19))
+        {
+            log();
+        }
+    }
+
+    void
+    log() const
+    {
+        using namespace std::chrono;
+        auto elapsed =
+            duration_cast<milliseconds>(steady_clock::now() - mStart);
+        CLOG_INFO(Ledger,
+                  "Checked bucket-vs-DB consistency for {} entries in {} "
+                  "({} entries/s)",
+                  mChecked, elapsed,
+                  mChecked * 1000 / (1 + elapsed.count()));
+    }
+};
+}
+
 void
 BucketListIsConsistentWithDatabase::checkEntireBucketlist()
 {
     auto& lm = mApp.getLedgerManager();
     auto& bm = mApp.getBucketManager();
+    auto const& cfg = mApp.getConfig();
     HistoryArchiveState has = lm.getLastClosedLedgerHAS();
-    std::map<LedgerKey, LedgerEntry> bucketLedgerMap =
-        bm.loadCompleteLedgerState(has);
-    EntryCounts counts;
-    medida::Timer timer(std::chrono::microseconds(1));
 
+    std::vector<std::shared_ptr<Bucket const>> buckets;
+    for (auto const& hsb : has.currentBuckets)
     {
-        LedgerTxn ltx(mApp.getLedgerTxnRoot());
-        for (auto const& pair : bucketLedgerMap)
+        for (auto const& hash : {hsb.curr, hsb.snap})
         {
-            // Don't check entry types in BucketListDB when enabled
-            if (mApp.getConfig().isUsingBucketListDB() &&
-                !BucketIndex::typeNotSupported(pair.first.type()))
+            auto h = hexToBin256(hash);
+            if (isZero(h))
             {
                 continue;
             }
+            auto b = bm.getBucketByHash(h);
+            if (!b)
+            {
+                throw std::runtime_error(std::string("missing bucket: ") +
+                                         hash);
+            }
+            buckets.emplace_back(b);
+        }
+    }
 
-            counts.countLiveEntry(pair.second);
-            std::string s;
-            timer.Time([&]() { s = checkAgainstDatabase(ltx, pair.second); });
-            if (!s.empty())
+    // If BucketListDB enabled, only types not supported by BucketListDB
+    // should be in SQL DB
+    auto inDatabase = [&cfg](LedgerEntryType t) {
+        return !cfg.isUsingBucketListDBForType(t);
+    };
+
+    CheckProgress progress;
+    if (cfg.isUsingBucketListDB())
+    {
+        // At most the offers are in SQL: compare them in key order against
+        // the offer ranges of the buckets, which also finds offers that are
+        // only in the database
+        if (inDatabase(OFFER))
+        {
+            std::map<LedgerKey, LedgerEntry, LedgerEntryIdCmp> fromDb;
+            for (auto& kv : mApp.getLedgerTxnRoot().getAllOffers())
             {
-                throw std::runtime_error(s);
+                fromDb.emplace(kv.first, std::move(kv.second));
+            }
+
+            NewestLiveEntries live(buckets, true);
+            auto dbIter = fromDb.begin();
+            LedgerEntry entry;
+            LedgerEntryIdCmp cmp;
+            while (live.next(entry))
+            {
+                if (entry.data.type() != OFFER)
+                {
+                    continue;
+                }
+                if (dbIter != fromDb.end() && cmp(dbIter->second, entry))
+                {
+                    std::string s{"Inconsistent state between objects (not "
+                                  "found in bucket list): "};
+                    s += xdrToCerealString(dbIter->second, "db");
+                    throw std::runtime_error(s);
+                }
+                if (dbIter == fromDb.end() || cmp(entry, dbIter->second))
+                {
+                    std::string s{"Inconsistent state between objects (not "
+                                  "found in database): "};
+                    s += xdrToCerealString(entry, "live");
+                    throw std::runtime_error(s);
+                }
+                if (!(dbIter->second == entry))
+                {
+                    std::string s{"Inconsistent state between objects: "};
+                    s += xdrToCerealString(dbIter->second, "db");
+                    s += xdrToCerealString(entry, "live");
+                    throw std::runtime_error(s);
+                }
+                ++dbIter;
+                progress.add(1);
             }
-            auto i = counts.totalEntries();
-            if ((i & 0x7ffff) == 0)
+            if (dbIter != fromDb.end())
             {
-                using namespace std::chrono;
-                nanoseconds ns = timer.duration_unit() *
-                                 static_cast<nanoseconds::rep>(timer.mean());
-                microseconds us = duration_cast<microseconds>(ns);
-                CLOG_INFO(Ledger,
-                          "Checked bucket-vs-DB consistency for "
-                          "{} entries (mean {}/entry)",
-                          i, us);
+                std::string s{"Inconsistent state between objects (not found "
+                              "in bucket list): "};
+                s += xdrToCerealString(dbIter->second, "db");
+                throw std::runtime_error(s);
             }
         }
     }
-
-    // Count functionality does not support in-memory LedgerTxn
-    if (!mApp.getConfig().isInMemoryMode())
+    else
     {
-        auto range = LedgerRange::inclusive(LedgerManager::GENESIS_LEDGER_SEQ,
-                                            has.currentLedger);
+        // Compare in batches, each loaded from the database by one query per
+        // table rather than one per entry
+        EntryCounts counts;
+        NewestLiveEntries live(buckets, false);
+        LedgerTxn ltx(mApp.getLedgerTxnRoot());
+        auto batchSize = std::max<size_t>(cfg.PREFETCH_BATCH_SIZE, 1);
+        std::vector<LedgerEntry> batch;
+        UnorderedSet<LedgerKey> keys;
+        auto checkBatch = [&]() {
+            ltx.prefetch(keys);
+            for (auto const& e : batch)
+            {
+                auto s = checkAgainstDatabase(ltx, e);
+                if (!s.empty())
+                {
+                    throw std::runtime_error(s);
+                }
+            }
+            progress.add(batch.size());
+            batch.clear();
+            keys.clear();
+        };
 
-        // If BucketListDB enabled, only types not supported by BucketListDB
-        // should be in SQL DB
-        std::function<bool(LedgerEntryType)> filter;
-        if (mApp.getConfig().isUsingBucketListDB())
+        LedgerEntry entry;
+        while (live.next(entry))
         {
-            filter = BucketIndex::typeNotSupported;
-        }
-        else
-        {
-            filter = [](LedgerEntryType) { return true; };
+            counts.countLiveEntry(entry);
+            keys.emplace(LedgerEntryKey(entry));
+            batch.emplace_back(std::move(entry));
+            if (batch.size() >= batchSize)
+            {
+                checkBatch();
+            }
         }
+        checkBatch();
 
-        auto s = counts.checkDbEntryCounts(mApp, range, filter);
-        if (!s.empty())
+        // Count functionality does not support in-memory LedgerTxn
+        if (!cfg.isInMemoryMode())
         {
-            throw std::runtime_error(s);
+            auto range = LedgerRange::inclusive(
+                LedgerManager::GENESIS_LEDGER_SEQ, has.currentLedger);
+            auto s = counts.checkDbEntryCounts(mApp, range, inDatabase);
+            if (!s.empty())
+            {
+                throw std::runtime_error(s);
+            }
         }
     }
+    progress.log();
 
-    if (mApp.getConfig().isUsingBucketListDB() &&
+    if (cfg.isUsingBucketListDB() &&
         mApp.getPersistentState().getState(PersistentState::kDBBackend) !=
             BucketIndex::DB_BACKEND_STATE)
     {
@@ -267,6 +466,40 @@ BucketListIsConsistentWithDatabase::checkOnBucketApply(
     {
         LedgerTxn ltx(mApp.getLedgerTxnRoot());
 
+        // Check entries in batches, each loaded from the database by one
+        // query per table. With BucketListDB, prefetching reads from the
+        // BucketList instead, so entries are loaded one by one.
+        bool const prefetch = !mApp.getConfig().isUsingBucketListDB();
+        auto batchSize =
+            std::max<size_t>(mApp.getConfig().PREFETCH_BATCH_SIZE, 1);
+        std::vector<BucketEntry> batch;
+        UnorderedSet<LedgerKey> keys;
+        auto checkBatch = [&]() {
+            if (prefetch)
+            {
+                ltx.prefetch(keys);
+            }
+            std::string s;
+            for (auto const& be : batch)
+            {
+                s = be.type() == DEADENTRY
+                        ? checkAgainstDatabase(ltx, be.deadEntry())
+                        : checkAgainstDatabase(ltx, be.liveEntry());
+                if (!s.empty())
+                {
+                    break;
+                }
+            }
+            batch.clear();
+            keys.clear();
+            return s;
+        };
+        auto addToBatch = [&](BucketEntry const& be, LedgerKey const& key) {
+            batch.emplace_back(be);
+            keys.emplace(key);
+            return batch.size() >= batchSize ? checkBatch() : std::string{};
+        };
+
         bool hasPreviousEntry = false;
         BucketEntry previousEntry;
         for (BucketInputIterator iter(bucket); iter; ++iter)
@@ -306,7 +539,7 @@ BucketListIsConsistentWithDatabase::checkOnBucketApply(
                 if (entryTypeFilter(e.liveEntry().data.type()))
                 {
                     counts.countLiveEntry(e.liveEntry());
-                    auto s = checkAgainstDatabase(ltx, e.liveEntry());
+                    auto s = addToBatch(e, LedgerEntryKey(e.liveEntry()));
                     if (!s.empty())
                     {
                         return s;
@@ -317,7 +550,7 @@ BucketListIsConsistentWithDatabase::checkOnBucketApply(
             {
                 if (entryTypeFilter(e.deadEntry().type()))
                 {
-                    auto s = checkAgainstDatabase(ltx, e.deadEntry());
+                    auto s = addToBatch(e, e.deadEntry());
                     if (!s.empty())
                     {
                         return s;
@@ -325,6 +558,12 @@ BucketListIsConsistentWithDatabase::checkOnBucketApply(
                 }
             }
         }
+
+        auto s = checkBatch();
+        if (!s.empty())
+        {
+            return s;
+        }
     }
 
     auto range = LedgerRange::inclusive(oldestLedger, newestLedger);
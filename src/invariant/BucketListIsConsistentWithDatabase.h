@@ -40,6 +40,9 @@ class BucketListIsConsistentWithDatabase : public Invariant
 
     // Secondary entrypoint to database-vs-bucket consistency checking, designed
     // to be run offline via self-check. Throws an exception on any error.
+    // Streams the newest entries of the BucketList in key order rather than
+    // loading the whole ledger, and compares them to the database in batches,
+    // logging its throughput as it goes.
     void checkEntireBucketlist();
 
   private:
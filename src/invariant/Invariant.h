@@ -12,6 +12,7 @@
 namespace stellar
 {
 
+class AbstractLedgerTxn;
 class Bucket;
 enum LedgerEntryType : std::int32_t;
 struct LedgerTxnDelta;
@@ -42,6 +43,14 @@ class Invariant
         return mStrict;
     }
 
+    // Invariants keeping state across operations must be shown every one of
+    // them, in order, so they are never sampled or checked in the background
+    virtual bool
+    isStateful() const
+    {
+        return false;
+    }
+
     virtual std::string
     checkOnBucketApply(std::shared_ptr<Bucket const> bucket,
                        uint32_t oldestLedger, uint32_t newestLedger,
@@ -58,6 +67,27 @@ class Invariant
         return std::string{};
     }
 
+    // The operations of a transaction are applied, and checked, in a child of
+    // ltx that is only committed if the transaction succeeds. An invariant
+    // keeping state should drop what it learnt from the operations checked
+    // since the last onTransactionStart if onTransactionCommit wasn't called.
+    virtual void
+    onTransactionStart(AbstractLedgerTxn& ltx)
+    {
+    }
+
+    virtual void
+    onTransactionCommit()
+    {
+    }
+
+    // The ledger changed without going through operations, by applying
+    // buckets or an upgrade, so any state kept across operations is stale
+    virtual void
+    resetState()
+    {
+    }
+
 #ifdef BUILD_TESTS
     virtual void
     snapshotForFuzzer()
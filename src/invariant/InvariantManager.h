@@ -11,6 +11,7 @@
 namespace stellar
 {
 
+class AbstractLedgerTxn;
 class Application;
 class Bucket;
 class Invariant;
@@ -44,6 +45,14 @@ class InvariantManager
                                        OperationResult const& opres,
                                        LedgerTxnDelta const& ltxDelta) = 0;
 
+    // Bracket the operations of a transaction applied in a child of ltx, with
+    // the commit only reached if the transaction succeeded
+    virtual void onTransactionStart(AbstractLedgerTxn& ltx) = 0;
+    virtual void onTransactionCommit() = 0;
+
+    // Called once an upgrade has been applied to the ledger
+    virtual void onUpgradeApply() = 0;
+
     virtual void registerInvariant(std::shared_ptr<Invariant> invariant) = 0;
 
     virtual void enableInvariant(std::string const& name) = 0;
@@ -11,14 +11,18 @@
 #include "invariant/InvariantManagerImpl.h"
 #include "ledger/LedgerTxn.h"
 #include "main/Application.h"
+#include "main/Config.h"
 #include "main/ErrorMessages.h"
 #include "util/Logging.h"
+#include "util/Math.h"
 #include "util/ProtocolVersion.h"
 #include "util/XDRCereal.h"
 #include <fmt/format.h>
 
 #include "medida/counter.h"
+#include "medida/meter.h"
 #include "medida/metrics_registry.h"
+#include "medida/timer.h"
 
 #include <memory>
 #include <numeric>
@@ -30,12 +34,16 @@ namespace stellar
 std::unique_ptr<InvariantManager>
 InvariantManager::create(Application& app)
 {
-    return std::make_unique<InvariantManagerImpl>(app.getMetrics());
+    return std::make_unique<InvariantManagerImpl>(app);
 }
 
-InvariantManagerImpl::InvariantManagerImpl(medida::MetricsRegistry& registry)
-    : mInvariantFailureCount(
-          registry.NewCounter({"ledger", "invariant", "failure"}))
+InvariantManagerImpl::InvariantManagerImpl(Application& app)
+    : mApp(app)
+    , mInvariantFailureCount(
+          app.getMetrics().NewCounter({"ledger", "invariant", "failure"}))
+    , mCheckInBackground(app.getConfig().INVARIANT_CHECKS_IN_BACKGROUND)
+    , mPendingChecksCount(
+          app.getMetrics().NewCounter({"invariant", "background", "pending"}))
 {
 }
 
@@ -82,6 +90,7 @@ InvariantManagerImpl::checkOnBucketApply(
                                     : BucketList::sizeOfSnap(ledger, level));
     for (auto invariant : mEnabled)
     {
+        invariant->resetState();
         auto result = invariant->checkOnBucketApply(
             bucket, oldestLedger, newestLedger, entryTypeFilter);
         if (result.empty())
@@ -109,24 +118,150 @@ InvariantManagerImpl::checkOnOperationApply(Operation const& operation,
         return;
     }
 
-    for (auto invariant : mEnabled)
+    auto ledger = ltxDelta.header.current.ledgerSeq;
+    std::vector<OperationCheck> inBackground;
+    for (auto const& check : mOperationChecks)
     {
-        auto result =
-            invariant->checkOnOperationApply(operation, opres, ltxDelta);
-        if (result.empty())
+        if (check.sampleRate < 1.0 && rand_fraction() >= check.sampleRate)
+        {
+            check.skipped.Mark();
+            continue;
+        }
+        if (mCheckInBackground && !check.invariant->isStrict() &&
+            !check.invariant->isStateful())
         {
+            inBackground.emplace_back(check);
             continue;
         }
 
-        auto message = fmt::format(
-            FMT_STRING(R"(Invariant "{}" does not hold on operation: {}{}{})"),
-            invariant->getName(), result, "\n",
-            xdrToCerealString(operation, "Operation"));
-        onInvariantFailure(invariant, message,
-                           ltxDelta.header.current.ledgerSeq);
+        std::string result;
+        {
+            auto timer = check.checkTime.TimeScope();
+            result = check.invariant->checkOnOperationApply(operation, opres,
+                                                            ltxDelta);
+        }
+        if (!result.empty())
+        {
+            onOperationCheckFailure(check.invariant, result, operation, ledger);
+        }
+    }
+
+    if (inBackground.empty())
+    {
+        return;
+    }
+
+    // The delta only holds pointers to entries that can no longer change, so
+    // the copy is cheap and stays valid once the operation is committed
+    queueBackgroundCheck([this, checks = std::move(inBackground), operation,
+                          opres, ltxDelta, ledger]() {
+        for (auto const& check : checks)
+        {
+            std::string result;
+            {
+                auto timer = check.checkTime.TimeScope();
+                result = check.invariant->checkOnOperationApply(
+                    operation, opres, ltxDelta);
+            }
+            if (!result.empty())
+            {
+                mApp.postOnMainThread(
+                    [this, invariant = check.invariant, result, operation,
+                     ledger]() {
+                        onOperationCheckFailure(invariant, result, operation,
+                                                ledger);
+                    },
+                    "invariant failure");
+            }
+        }
+    });
+}
+
+void
+InvariantManagerImpl::onTransactionStart(AbstractLedgerTxn& ltx)
+{
+    // Operations of these protocols are not checked, so what they change is
+    // as unknown to invariants keeping state as an upgrade
+    bool checked = !protocolVersionIsBefore(
+        ltx.getHeader().ledgerVersion, ProtocolVersion::V_8);
+    for (auto const& invariant : mEnabled)
+    {
+        if (checked)
+        {
+            invariant->onTransactionStart(ltx);
+        }
+        else
+        {
+            invariant->resetState();
+        }
     }
 }
 
+void
+InvariantManagerImpl::onTransactionCommit()
+{
+    for (auto const& invariant : mEnabled)
+    {
+        invariant->onTransactionCommit();
+    }
+}
+
+void
+InvariantManagerImpl::onUpgradeApply()
+{
+    for (auto const& invariant : mEnabled)
+    {
+        invariant->resetState();
+    }
+}
+
+void
+InvariantManagerImpl::queueBackgroundCheck(std::function<void()> check)
+{
+    std::lock_guard<std::mutex> guard(mPendingChecksMutex);
+    mPendingChecks.emplace_back(std::move(check));
+    mPendingChecksCount.inc();
+    if (!mBackgroundCheckerRunning)
+    {
+        mBackgroundCheckerRunning = true;
+        mApp.postOnBackgroundThread([this]() { runBackgroundChecks(); },
+                                    "invariant checks");
+    }
+}
+
+void
+InvariantManagerImpl::runBackgroundChecks()
+{
+    while (true)
+    {
+        std::function<void()> check;
+        {
+            std::lock_guard<std::mutex> guard(mPendingChecksMutex);
+            if (mPendingChecks.empty())
+            {
+                mBackgroundCheckerRunning = false;
+                return;
+            }
+            check = std::move(mPendingChecks.front());
+            mPendingChecks.pop_front();
+            mPendingChecksCount.dec();
+        }
+        check();
+    }
+}
+
+void
+InvariantManagerImpl::onOperationCheckFailure(
+    std::shared_ptr<Invariant> invariant, std::string const& result,
+    Operation const& operation, uint32_t ledger)
+{
+    auto message = fmt::format(
+        FMT_STRING(R"(Invariant "{}" does not hold on operation: {}{}{})"),
+        invariant->getName(), result, "\n",
+        xdrToCerealString(operation, "Operation"));
+    onInvariantFailure(invariant, message, ledger);
+}
+
 void
 InvariantManagerImpl::registerInvariant(std::shared_ptr<Invariant> invariant)
 {
@@ -172,8 +307,24 @@ InvariantManagerImpl::enableInvariant(std::string const& invPattern)
             auto iter = std::find(mEnabled.begin(), mEnabled.end(), inv.second);
             if (iter == mEnabled.end())
             {
+                auto const& rates =
+                    mApp.getConfig().INVARIANT_CHECK_SAMPLE_RATES;
+                auto rate = rates.find(name);
+                if (rate != rates.end() && inv.second->isStateful())
+                {
+                    throw std::invalid_argument(fmt::format(
+                        FMT_STRING("Invariant {} keeps state across "
+                                   "operations and can't be sampled"),
+                        name));
+                }
+                auto& metrics = mApp.getMetrics();
                 enabledSome = true;
                 mEnabled.push_back(inv.second);
+                mOperationChecks.push_back(
+                    {inv.second, rate == rates.end() ? 1.0 : rate->second,
+                     metrics.NewTimer({"invariant", "check", name}),
+                     metrics.NewMeter({"invariant", "skip", name},
+                                      "operation")});
                 CLOG_INFO(Invariant, "Enabled invariant '{}'", name);
             }
             else
@@ -5,13 +5,16 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "invariant/InvariantManager.h"
+#include <deque>
 #include <map>
+#include <mutex>
 #include <vector>
 
 namespace medida
 {
-class MetricsRegistry;
 class Counter;
+class Meter;
+class Timer;
 }
 
 namespace stellar
@@ -19,10 +22,32 @@ namespace stellar
 
 class InvariantManagerImpl : public InvariantManager
 {
+    Application& mApp;
     std::map<std::string, std::shared_ptr<Invariant>> mInvariants;
     std::vector<std::shared_ptr<Invariant>> mEnabled;
     medida::Counter& mInvariantFailureCount;
 
+    // How checkOnOperationApply runs each invariant of mEnabled, in the same
+    // order: only for a random sampleRate of the operations, with the cost
+    // of the checks done and the number skipped recorded
+    struct OperationCheck
+    {
+        std::shared_ptr<Invariant> invariant;
+        double sampleRate;
+        medida::Timer& checkTime;
+        medida::Meter& skipped;
+    };
+    std::vector<OperationCheck> mOperationChecks;
+
+    // With INVARIANT_CHECKS_IN_BACKGROUND, operation checks of invariants
+    // that are not strict are queued with a copy of the operation and its
+    // delta, and run in order by a single background job at a time
+    bool const mCheckInBackground;
+    std::mutex mPendingChecksMutex;
+    std::deque<std::function<void()>> mPendingChecks;
+    bool mBackgroundCheckerRunning{false};
+    medida::Counter& mPendingChecksCount;
+
     struct InvariantFailureInformation
     {
         uint32_t lastFailedOnLedger;
@@ -31,7 +56,7 @@ class InvariantManagerImpl : public InvariantManager
     std::map<std::string, InvariantFailureInformation> mFailureInformation;
 
   public:
-    InvariantManagerImpl(medida::MetricsRegistry& registry);
+    explicit InvariantManagerImpl(Application& app);
 
     virtual Json::Value getJsonInfo() override;
 
@@ -41,6 +66,10 @@ class InvariantManagerImpl : public InvariantManager
                                        OperationResult const& opres,
                                        LedgerTxnDelta const& ltxDelta) override;
 
+    virtual void onTransactionStart(AbstractLedgerTxn& ltx) override;
+    virtual void onTransactionCommit() override;
+    virtual void onUpgradeApply() override;
+
     virtual void checkOnBucketApply(
         std::shared_ptr<Bucket const> bucket, uint32_t ledger, uint32_t level,
         bool isCurr,
@@ -57,6 +86,12 @@ class InvariantManagerImpl : public InvariantManager
 #endif // BUILD_TESTS
 
   private:
+    void queueBackgroundCheck(std::function<void()> check);
+    void runBackgroundChecks();
+
+    void onOperationCheckFailure(std::shared_ptr<Invariant> invariant,
+                                 std::string const& result,
+                                 Operation const& operation, uint32_t ledger);
     void onInvariantFailure(std::shared_ptr<Invariant> invariant,
                             std::string const& message, uint32_t ledger);
 
@@ -1,4 +1,3 @@
-#ifdef BUILD_TESTS
 // Copyright 2021 Stellar Development Foundation and contributors. Licensed
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
@@ -12,6 +11,7 @@
 #include "util/Logging.h"
 #include "util/XDROperators.h"
 #include "xdr/Stellar-ledger-entries.h"
+#include <Tracy.hpp>
 #include <fmt/format.h>
 #include <functional>
 #include <xdrpp/printer.h>
@@ -133,6 +133,47 @@ OrderBookIsNotCrossed::OfferEntryCmp::operator()(OfferEntry const& a,
     return false;
 }
 
+OrderBookIsNotCrossed::OrderBookIsNotCrossed(Application& app)
+    : Invariant(true), mApp(app)
+{
+}
+
+void
+OrderBookIsNotCrossed::sync(AbstractLedgerTxnParent& ltx)
+{
+    ZoneScoped;
+    mOrderBook.clear();
+    for (auto const& kv : ltx.getAllOffers())
+    {
+        auto const& oe = kv.second.data.offer();
+        mOrderBook[{oe.selling, oe.buying}].emplace(oe);
+    }
+    mTxChanges.clear();
+    mSynced = true;
+#ifdef BUILD_TESTS
+    mRestoreBeforeNextUpdate = false;
+#endif // BUILD_TESTS
+}
+
+void
+OrderBookIsNotCrossed::rollbackTransaction()
+{
+    for (auto iter = mTxChanges.rbegin(); iter != mTxChanges.rend(); ++iter)
+    {
+        if (iter->current)
+        {
+            auto const& oe = iter->current->ledgerEntry().data.offer();
+            mOrderBook[{oe.selling, oe.buying}].erase(oe);
+        }
+        if (iter->previous)
+        {
+            auto const& oe = iter->previous->ledgerEntry().data.offer();
+            mOrderBook[{oe.selling, oe.buying}].emplace(oe);
+        }
+    }
+    mTxChanges.clear();
+}
+
 void
 OrderBookIsNotCrossed::updateOrderBook(LedgerTxnDelta const& ltxd)
 {
@@ -145,11 +186,13 @@ OrderBookIsNotCrossed::updateOrderBook(LedgerTxnDelta const& ltxd)
         if (entry.first.type() == InternalLedgerEntryType::LEDGER_ENTRY &&
             entry.first.ledgerKey().type() == OFFER)
         {
+#ifdef BUILD_TESTS
             if (mRestoreBeforeNextUpdate)
             {
                 mOrderBook = mOrderBookSnapshot;
                 mRestoreBeforeNextUpdate = false;
             }
+#endif // BUILD_TESTS
             if (entry.second.previous)
             {
                 auto const& oe =
@@ -162,6 +205,10 @@ OrderBookIsNotCrossed::updateOrderBook(LedgerTxnDelta const& ltxd)
                     entry.second.current->ledgerEntry().data.offer();
                 mOrderBook[{oe.selling, oe.buying}].emplace(oe);
             }
+            if (mInTransaction)
+            {
+                mTxChanges.emplace_back(entry.second);
+            }
         }
     }
 }
@@ -169,7 +216,9 @@ OrderBookIsNotCrossed::updateOrderBook(LedgerTxnDelta const& ltxd)
 std::string
 OrderBookIsNotCrossed::check(AssetPairSet const& assetPairs)
 {
+#ifdef BUILD_TESTS
     releaseAssert(!mRestoreBeforeNextUpdate);
+#endif // BUILD_TESTS
     for (auto const& assetPair : assetPairs)
     {
         auto checkCrossedResult =
@@ -184,12 +233,10 @@ OrderBookIsNotCrossed::check(AssetPairSet const& assetPairs)
 }
 
 std::shared_ptr<Invariant>
-OrderBookIsNotCrossed::registerAndEnableInvariant(Application& app)
+OrderBookIsNotCrossed::registerInvariant(Application& app)
 {
-    auto invariant =
-        app.getInvariantManager().registerInvariant<OrderBookIsNotCrossed>();
-    app.getInvariantManager().enableInvariant(invariant->getName());
-    return invariant;
+    return app.getInvariantManager().registerInvariant<OrderBookIsNotCrossed>(
+        app);
 }
 
 std::string
@@ -203,11 +250,53 @@ OrderBookIsNotCrossed::checkOnOperationApply(Operation const& operation,
                                              OperationResult const& result,
                                              LedgerTxnDelta const& ltxDelta)
 {
-    updateOrderBook(ltxDelta);
     auto assetPairs = extractAssetPairs(ltxDelta);
+    if (assetPairs.empty() && !mSynced)
+    {
+        return std::string{};
+    }
+    if (!mSynced)
+    {
+        // Only when checking an operation outside of a transaction, as
+        // tests do: the last closed ledger is the best we can load from
+        sync(mApp.getLedgerTxnRoot());
+    }
+    updateOrderBook(ltxDelta);
     return assetPairs.size() > 0 ? check(assetPairs) : std::string{};
 }
 
+void
+OrderBookIsNotCrossed::onTransactionStart(AbstractLedgerTxn& ltx)
+{
+    if (!mSynced)
+    {
+        sync(ltx);
+    }
+    else
+    {
+        // The changes of a transaction that never committed were rolled back
+        rollbackTransaction();
+    }
+    mInTransaction = true;
+}
+
+void
+OrderBookIsNotCrossed::onTransactionCommit()
+{
+    mTxChanges.clear();
+    mInTransaction = false;
+}
+
+void
+OrderBookIsNotCrossed::resetState()
+{
+    mOrderBook.clear();
+    mTxChanges.clear();
+    mInTransaction = false;
+    mSynced = false;
+}
+
+#ifdef BUILD_TESTS
 void
 OrderBookIsNotCrossed::snapshotForFuzzer()
 {
@@ -225,7 +314,9 @@ OrderBookIsNotCrossed::resetForFuzzer()
     // matter if `mOrderBook` were stale.  Therefore, we defer copying the map
     // until we need it to be up to date.
     mOrderBook.clear();
+    mTxChanges.clear();
+    mInTransaction = false;
     mRestoreBeforeNextUpdate = true;
 }
-}
 #endif // BUILD_TESTS
+}
@@ -1,4 +1,3 @@
-#ifdef BUILD_TESTS
 #pragma once
 
 // Copyright 2021 Stellar Development Foundation and contributors. Licensed
@@ -8,19 +7,33 @@
 #include "invariant/Invariant.h"
 #include "ledger/LedgerHashUtils.h"
 #include "ledger/LedgerTxn.h"
-#include "main/Application.h"
 #include "xdr/Stellar-ledger-entries.h"
 #include "xdr/Stellar-ledger.h"
 
 #include <set>
 #include <unordered_map>
+#include <vector>
 
 namespace stellar
 {
-// compare two OfferEntry's by price
+
+class Application;
+
+// This Invariant is used to validate that no operation leaves the order book
+// of an asset pair it changed crossed: the lowest ask must be above the
+// highest bid, or equal to it when all the offers at that price on one side
+// are passive.
+//
+// It keeps the whole order book in memory, so that an operation only costs
+// updating the offers it changed and looking at the top of the books of the
+// asset pairs they are in. The order book is loaded from the ledger the first
+// transaction after startup applies to, which for the LedgerTxnRoot comes
+// from the offer range of each bucket, and again after anything changed the
+// ledger without the invariant seeing it: applying buckets or an upgrade.
 class OrderBookIsNotCrossed : public Invariant
 {
   public:
+    // compare two OfferEntry's by price
     struct OfferEntryCmp
     {
         bool operator()(OfferEntry const& a, OfferEntry const& b) const;
@@ -30,50 +43,56 @@ class OrderBookIsNotCrossed : public Invariant
     using OrderBook = std::unordered_map<AssetPair, Orders, AssetPairHash>;
     using AssetPairSet = std::set<std::pair<Asset, Asset>>;
 
-    explicit OrderBookIsNotCrossed()
-        : Invariant(true), mRestoreBeforeNextUpdate(false)
-    {
-    }
+    explicit OrderBookIsNotCrossed(Application& app);
 
-    // The order-book-not-crossed invariant relies on maintaining state across
-    // checkOnOperationApply() calls, and there is no general mechanism in the
-    // InvariantManager to notify an invariant if an operation was later rolled
-    // back.  Therefore, we can reliably check the order-book-not-crossed
-    // invariant only when either the calling code uses the
-    // snapshotForFuzzer()/resetForFuzzer() mechanism, which currently only the
-    // fuzzer does, or in a test specifically of the OrderBookIsNotCrossed
-    // invariant, which is aware of its maintaining state.  Therefore, we
-    // register and enable the invariant only explicitly, from those places:
-    // fuzzing and the invariant's own tests.
-    static std::shared_ptr<Invariant>
-    registerAndEnableInvariant(Application& app);
+    static std::shared_ptr<Invariant> registerInvariant(Application& app);
 
     virtual std::string getName() const override;
 
+    virtual bool
+    isStateful() const override
+    {
+        return true;
+    }
+
     virtual std::string
     checkOnOperationApply(Operation const& operation,
                           OperationResult const& result,
                           LedgerTxnDelta const& ltxDelta) override;
 
+    virtual void onTransactionStart(AbstractLedgerTxn& ltx) override;
+    virtual void onTransactionCommit() override;
+    virtual void resetState() override;
+
     OrderBook const&
     getOrderBook() const
     {
         return mOrderBook;
     }
 
+#ifdef BUILD_TESTS
     void snapshotForFuzzer() override;
     void resetForFuzzer() override;
+#endif // BUILD_TESTS
 
   private:
-    // as of right now, since this is only used in fuzzing, the mOrderBook will
-    // be empty to start. If used in production, since invariants are
-    // configurable, it is likely that this invariant will be enabled with
-    // pre-existing ledger and thus the mOrderBook will need a way to sync
+    Application& mApp;
     OrderBook mOrderBook;
+    bool mSynced{false};
+
+    // Offer changes of the operations of the transaction being applied, to
+    // undo if it does not commit
+    std::vector<LedgerTxnDelta::EntryDelta> mTxChanges;
+    bool mInTransaction{false};
+
+#ifdef BUILD_TESTS
     OrderBook mOrderBookSnapshot;
-    bool mRestoreBeforeNextUpdate;
+    bool mRestoreBeforeNextUpdate{false};
+#endif // BUILD_TESTS
+
+    void sync(AbstractLedgerTxnParent& ltx);
+    void rollbackTransaction();
     void updateOrderBook(LedgerTxnDelta const& ltxd);
     std::string check(AssetPairSet const& assetPairs);
 };
 }
-#endif // BUILD_TESTS
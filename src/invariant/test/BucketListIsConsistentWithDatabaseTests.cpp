@@ -6,6 +6,8 @@
 #include "bucket/BucketManager.h"
 #include "bucket/BucketOutputIterator.h"
 #include "catchup/ApplyBucketsWork.h"
+#include "database/Database.h"
+#include "invariant/BucketListIsConsistentWithDatabase.h"
 #include "ledger/LedgerHashUtils.h"
 #include "ledger/LedgerTxn.h"
 #include "ledger/LedgerTxnEntry.h"
@@ -14,7 +16,9 @@
 #include "lib/catch.hpp"
 #include "lib/util/stdrandom.h"
 #include "main/Application.h"
+#include "test/TestAccount.h"
 #include "test/TestUtils.h"
+#include "test/TxTests.h"
 #include "test/test.h"
 #include "transactions/TransactionUtils.h"
 #include "util/Decoder.h"
@@ -992,3 +996,39 @@ TEST_CASE("BucketListIsConsistentWithDatabase merged LIVEENTRY and DEADENTRY",
         }
     }
 }
+
+TEST_CASE("BucketListIsConsistentWithDatabase full check of offers",
+          "[invariant][bucketlistconsistent]")
+{
+    VirtualClock clock;
+    Config cfg = getTestConfig();
+    cfg.DEPRECATED_SQL_LEDGER_STATE = false;
+    auto app = createTestApplication(clock, cfg);
+
+    auto root = TestAccount::createRoot(*app);
+    auto native = txtest::makeNativeAsset();
+    auto cur1 = txtest::makeAsset(root, "CUR1");
+    auto a1 = root.create("a1", app->getLedgerManager().getLastMinBalance(10));
+    a1.changeTrust(cur1, 100);
+    root.pay(a1, cur1, 10);
+    for (int i = 1; i <= 5; ++i)
+    {
+        a1.manageOffer(0, cur1, native, Price{i, 1}, 1, MANAGE_OFFER_CREATED);
+    }
+
+    BucketListIsConsistentWithDatabase blc(*app);
+    REQUIRE_NOTHROW(blc.checkEntireBucketlist());
+
+    SECTION("modified offer")
+    {
+        app->getDatabase().getSession()
+            << "UPDATE offers SET amount = amount + 1 WHERE offerid = 3";
+        REQUIRE_THROWS_AS(blc.checkEntireBucketlist(), std::runtime_error);
+    }
+    SECTION("offer missing from the database")
+    {
+        app->getDatabase().getSession()
+            << "DELETE FROM offers WHERE offerid = 5";
+        REQUIRE_THROWS_AS(blc.checkEntireBucketlist(), std::runtime_error);
+    }
+}
@@ -17,6 +17,11 @@
 #include "test/TestUtils.h"
 #include "test/test.h"
 
+#include "medida/counter.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
+#include <chrono>
 #include <fmt/format.h>
 
 using namespace stellar;
@@ -27,8 +32,8 @@ namespace InvariantTests
 class TestInvariant : public Invariant
 {
   public:
-    TestInvariant(int id, bool shouldFail)
-        : Invariant(true), mInvariantID(id), mShouldFail(shouldFail)
+    TestInvariant(int id, bool shouldFail, bool strict = true)
+        : Invariant(strict), mInvariantID(id), mShouldFail(shouldFail)
     {
     }
 
@@ -216,3 +221,90 @@ TEST_CASE("onOperationApply fail succeed", "[invariant]")
             {}, res, ltx.getDelta()));
     }
 }
+
+TEST_CASE("onOperationApply sampled", "[invariant]")
+{
+    VirtualClock clock;
+    Config cfg = getTestConfig();
+    cfg.INVARIANT_CHECKS = {"ConservationOfLumens"};
+    cfg.INVARIANT_CHECK_SAMPLE_RATES["ConservationOfLumens"] = 0.5;
+    Application::pointer app = createTestApplication(clock, cfg);
+
+    OperationResult res;
+    size_t const n = 200;
+    for (size_t i = 0; i < n; ++i)
+    {
+        LedgerTxn ltx(app->getLedgerTxnRoot());
+        app->getInvariantManager().checkOnOperationApply({}, res,
+                                                         ltx.getDelta());
+    }
+
+    auto checked = app->getMetrics()
+                       .NewTimer({"invariant", "check", "ConservationOfLumens"})
+                       .count();
+    auto skipped =
+        app->getMetrics()
+            .NewMeter({"invariant", "skip", "ConservationOfLumens"},
+                      "operation")
+            .count();
+    REQUIRE(checked > 0);
+    REQUIRE(skipped > 0);
+    REQUIRE(checked + skipped == n);
+}
+
+TEST_CASE("only enabled invariants can be sampled", "[invariant]")
+{
+    VirtualClock clock;
+    Config cfg = getTestConfig();
+    cfg.INVARIANT_CHECKS = {"ConservationOfLumens"};
+    cfg.INVARIANT_CHECK_SAMPLE_RATES["LiabilitiesMatchOffers"] = 0.5;
+    REQUIRE_THROWS_AS(createTestApplication(clock, cfg), std::runtime_error);
+}
+
+TEST_CASE("onOperationApply in background", "[invariant]")
+{
+    VirtualClock clock;
+    Config cfg = getTestConfig();
+    cfg.INVARIANT_CHECKS = {};
+    cfg.INVARIANT_CHECKS_IN_BACKGROUND = true;
+    Application::pointer app = createTestApplication(clock, cfg);
+
+    OperationResult res;
+    SECTION("strict invariants are still checked in place")
+    {
+        app->getInvariantManager().registerInvariant<TestInvariant>(0, true);
+        app->getInvariantManager().enableInvariant(
+            TestInvariant::toString(0, true));
+
+        LedgerTxn ltx(app->getLedgerTxnRoot());
+        REQUIRE_THROWS_AS(app->getInvariantManager().checkOnOperationApply(
+                              {}, res, ltx.getDelta()),
+                          InvariantDoesNotHold);
+    }
+    SECTION("others fail on the main thread later")
+    {
+        app->getInvariantManager().registerInvariant<TestInvariant>(0, true,
+                                                                    false);
+        app->getInvariantManager().enableInvariant(
+            TestInvariant::toString(0, true));
+
+        {
+            LedgerTxn ltx(app->getLedgerTxnRoot());
+            REQUIRE_NOTHROW(app->getInvariantManager().checkOnOperationApply(
+                {}, res, ltx.getDelta()));
+        }
+        auto deadline =
+            std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        REQUIRE_THROWS_AS(
+            [&]() {
+                while (std::chrono::steady_clock::now() < deadline)
+                {
+                    clock.crank(false);
+                }
+            }(),
+            InvariantDoesNotHold);
+        REQUIRE(app->getMetrics()
+                    .NewCounter({"invariant", "background", "pending"})
+                    .count() == 0);
+    }
+}
@@ -110,11 +110,9 @@ TEST_CASE("OrderBookIsNotCrossed in-memory order book is consistent with "
 {
     VirtualClock clock;
     auto cfg = getTestConfig(0);
-    // When testing the order book not crossed invariant, enable it and no other
-    // invariants (these tests do things which violate other invariants).
+    // These tests do things which violate other invariants
     cfg.INVARIANT_CHECKS = {};
     auto app = createTestApplication(clock, cfg);
-    OrderBookIsNotCrossed::registerAndEnableInvariant(*app);
 
     auto root = TestAccount::createRoot(*app);
 
@@ -123,7 +121,7 @@ TEST_CASE("OrderBookIsNotCrossed in-memory order book is consistent with "
 
     LedgerTxn ltxOuter{app->getLedgerTxnRoot()};
 
-    auto const invariant = std::make_shared<OrderBookIsNotCrossed>();
+    auto const invariant = std::make_shared<OrderBookIsNotCrossed>(*app);
     auto offer = InvariantTestUtils::generateOffer(cur1, cur2, 3, Price{3, 2});
 
     // create
@@ -180,6 +178,96 @@ TEST_CASE("OrderBookIsNotCrossed in-memory order book is consistent with "
     }
 }
 
+TEST_CASE("OrderBookIsNotCrossed follows transactions and loads existing "
+          "offers",
+          "[invariant][OrderBookIsNotCrossed]")
+{
+    VirtualClock clock;
+    auto cfg = getTestConfig(0);
+    cfg.INVARIANT_CHECKS = {};
+    auto app = createTestApplication(clock, cfg);
+
+    auto root = TestAccount::createRoot(*app);
+    auto const cur1 = root.asset("CUR1");
+    auto const cur2 = root.asset("CUR2");
+
+    LedgerTxn ltxOuter{app->getLedgerTxnRoot()};
+    auto const existing = createOffer(cur1, cur2, 3, Price{3, 2});
+    ltxOuter.create(existing);
+
+    auto const invariant = std::make_shared<OrderBookIsNotCrossed>(*app);
+    invariant->onTransactionStart(ltxOuter);
+    REQUIRE(invariant->getOrderBook().at({cur1, cur2}).size() == 1);
+
+    auto applyOffer = [&](LedgerEntry const& offer, bool commit) {
+        std::string res;
+        {
+            LedgerTxn ltx{ltxOuter};
+            ltx.create(offer);
+            res = invariant->checkOnOperationApply({}, OperationResult{},
+                                                   ltx.getDelta());
+            if (commit)
+            {
+                ltx.commit();
+                invariant->onTransactionCommit();
+            }
+        }
+        invariant->onTransactionStart(ltxOuter);
+        return res;
+    };
+
+    // Crosses the offer that was there before the invariant started
+    REQUIRE(!applyOffer(createOffer(cur2, cur1, 1, Price{2, 3}), false)
+                 .empty());
+
+    SECTION("rolled back offers are dropped")
+    {
+        REQUIRE(invariant->getOrderBook().count({cur2, cur1}) == 0 ||
+                invariant->getOrderBook().at({cur2, cur1}).empty());
+        REQUIRE(applyOffer(createOffer(cur2, cur1, 1, Price{1, 1}), true)
+                    .empty());
+        REQUIRE(invariant->getOrderBook().at({cur2, cur1}).size() == 1);
+    }
+
+    SECTION("offers are loaded again after a reset")
+    {
+        auto const other = createOffer(cur1, cur2, 2, Price{5, 3});
+        ltxOuter.create(other);
+        invariant->resetState();
+        invariant->onTransactionStart(ltxOuter);
+        REQUIRE(invariant->getOrderBook().at({cur1, cur2}).size() == 2);
+    }
+}
+
+TEST_CASE("OrderBookIsNotCrossed ignores offers of failed transactions",
+          "[invariant][OrderBookIsNotCrossed]")
+{
+    VirtualClock clock;
+    auto cfg = getTestConfig(0);
+    cfg.INVARIANT_CHECKS = {"OrderBookIsNotCrossed"};
+    auto app = createTestApplication(clock, cfg);
+
+    auto root = TestAccount::createRoot(*app);
+    auto const minBalance = app->getLedgerManager().getLastMinBalance(3);
+    auto issuer = root.create("issuer", minBalance);
+    auto const cur1 = issuer.asset("CUR1");
+    auto seller = root.create("seller", minBalance);
+    auto buyer = root.create("buyer", minBalance * 10);
+    seller.changeTrust(cur1, INT64_MAX);
+    buyer.changeTrust(cur1, INT64_MAX);
+    issuer.pay(seller, cur1, 1000);
+
+    // The offer is created, then rolled back by the payment failing
+    auto tx =
+        seller.tx({txtest::manageOffer(0, cur1, Asset{}, Price{1, 1}, 100),
+                   txtest::payment(root, minBalance * 10)});
+    closeLedger(*app, {tx});
+    REQUIRE(tx->getResultCode() == txFAILED);
+
+    // Would cross the offer if it had been kept
+    REQUIRE_NOTHROW(buyer.manageOffer(0, Asset{}, cur1, Price{1, 1}, 100));
+}
+
 TEST_CASE("OrderBookIsNotCrossed properly throws if order book is crossed",
           "[invariant][OrderBookIsNotCrossed]")
 {
@@ -188,9 +276,8 @@ TEST_CASE("OrderBookIsNotCrossed properly throws if order book is crossed",
     auto cfg = getTestConfig(0);
     // When testing the order book not crossed invariant, enable it and no other
     // invariants (these tests do things which violate other invariants).
-    cfg.INVARIANT_CHECKS = {};
+    cfg.INVARIANT_CHECKS = {"OrderBookIsNotCrossed"};
     auto app = createTestApplication(clock, cfg);
-    OrderBookIsNotCrossed::registerAndEnableInvariant(*app);
 
     auto root = TestAccount::createRoot(*app);
 
@@ -0,0 +1,174 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "ledger/CompactLedgerEntryIndex.h"
+#include "ledger/LedgerHashUtils.h"
+#include "util/GlobalChecks.h"
+#include "xdrpp/marshal.h"
+#include <cstring>
+
+namespace stellar
+{
+
+namespace
+{
+std::vector<uint8_t>
+toBytes(LedgerKey const& key)
+{
+    std::vector<uint8_t> res(xdr::xdr_size(key));
+    xdr::xdr_put p(res.data(), res.data() + res.size());
+    xdr::xdr_argpack_archive(p, key);
+    return res;
+}
+
+uint32_t
+readU32(uint8_t const* p)
+{
+    uint32_t res;
+    std::memcpy(&res, p, sizeof(res));
+    return res;
+}
+
+uint64_t
+readU64(uint8_t const* p)
+{
+    uint64_t res;
+    std::memcpy(&res, p, sizeof(res));
+    return res;
+}
+}
+
+uint8_t const*
+CompactLedgerEntryIndex::recordAt(uint64_t loc) const
+{
+    return mChunks[loc >> 32].data() + (loc & 0xffffffff);
+}
+
+uint64_t
+CompactLedgerEntryIndex::find(uint64_t hash,
+                              std::vector<uint8_t> const& keyBytes) const
+{
+    auto it = mIndex.find(hash);
+    if (it == mIndex.end())
+    {
+        return NO_RECORD;
+    }
+    for (auto loc = it->second; loc != NO_RECORD;)
+    {
+        auto rec = recordAt(loc);
+        auto keySize = readU32(rec + 8);
+        if (keySize == keyBytes.size() &&
+            std::memcmp(rec + HEADER_SIZE, keyBytes.data(), keySize) == 0)
+        {
+            return loc;
+        }
+        loc = readU64(rec);
+    }
+    return NO_RECORD;
+}
+
+bool
+CompactLedgerEntryIndex::addIfNew(LedgerKey const& key,
+                                  LedgerEntry const* entry)
+{
+    uint64_t hash = std::hash<LedgerKey>()(key);
+    auto keyBytes = toBytes(key);
+    if (find(hash, keyBytes) != NO_RECORD)
+    {
+        return false;
+    }
+
+    uint32_t entrySize =
+        entry ? static_cast<uint32_t>(xdr::xdr_size(*entry)) : 0;
+    size_t recordSize = HEADER_SIZE + keyBytes.size() + entrySize;
+    releaseAssert(recordSize <= CHUNK_SIZE);
+    if (mChunks.empty() ||
+        mChunks.back().capacity() - mChunks.back().size() < recordSize)
+    {
+        mChunks.emplace_back();
+        mChunks.back().reserve(CHUNK_SIZE);
+    }
+
+    // Push the new record to the front of the chain for hash
+    auto& chunk = mChunks.back();
+    uint64_t loc = (static_cast<uint64_t>(mChunks.size() - 1) << 32) |
+                   static_cast<uint64_t>(chunk.size());
+    auto it = mIndex.find(hash);
+    uint64_t next = it == mIndex.end() ? NO_RECORD : it->second;
+    uint32_t keySize = static_cast<uint32_t>(keyBytes.size());
+
+    size_t start = chunk.size();
+    chunk.resize(start + recordSize);
+    auto rec = chunk.data() + start;
+    std::memcpy(rec, &next, sizeof(next));
+    std::memcpy(rec + 8, &keySize, sizeof(keySize));
+    std::memcpy(rec + 12, &entrySize, sizeof(entrySize));
+    std::memcpy(rec + HEADER_SIZE, keyBytes.data(), keySize);
+    if (entry)
+    {
+        auto entryStart = rec + HEADER_SIZE + keySize;
+        xdr::xdr_put p(entryStart, entryStart + entrySize);
+        xdr::xdr_argpack_archive(p, *entry);
+        ++mLiveEntries;
+    }
+
+    if (it == mIndex.end())
+    {
+        mIndex.emplace(hash, loc);
+    }
+    else
+    {
+        it->second = loc;
+    }
+    ++mRecords;
+    return true;
+}
+
+bool
+CompactLedgerEntryIndex::load(LedgerKey const& key, LedgerEntry& entry) const
+{
+    auto loc = find(std::hash<LedgerKey>()(key), toBytes(key));
+    if (loc == NO_RECORD)
+    {
+        return false;
+    }
+
+    auto rec = recordAt(loc);
+    auto keySize = readU32(rec + 8);
+    auto entrySize = readU32(rec + 12);
+    if (entrySize == 0)
+    {
+        return false;
+    }
+
+    auto entryStart = rec + HEADER_SIZE + keySize;
+    xdr::xdr_get g(entryStart, entryStart + entrySize);
+    xdr::xdr_argpack_archive(g, entry);
+    g.done();
+    return true;
+}
+
+size_t
+CompactLedgerEntryIndex::size() const
+{
+    return mRecords;
+}
+
+size_t
+CompactLedgerEntryIndex::liveEntries() const
+{
+    return mLiveEntries;
+}
+
+size_t
+CompactLedgerEntryIndex::memoryUsage() const
+{
+    size_t res = mIndex.size() * (sizeof(uint64_t) * 3 + 1);
+    for (auto const& chunk : mChunks)
+    {
+        res += chunk.capacity();
+    }
+    return res;
+}
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/FlatHashMap.h"
+#include "util/NonCopyable.h"
+#include "xdr/Stellar-ledger-entries.h"
+#include <cstdint>
+#include <vector>
+
+namespace stellar
+{
+
+// A map from LedgerKey to LedgerEntry that is built once, by adding the newest
+// version of every key first, and is read-only afterwards. Keys and entries are
+// kept as XDR in a few large chunks of memory rather than as one heap
+// allocation per entry, so that a ledger of mainnet size fits in the memory of
+// a single machine. Each record is laid out as
+//
+//     [u64 next record][u32 key size][u32 entry size][key XDR][entry XDR]
+//
+// and the hash index maps the hash of a key to the first record with that
+// hash. Records with the same hash are chained through "next" and told apart
+// by their key bytes. An entry size of 0 records a key that has no entry in
+// the index, because its newest version is dead or is held somewhere else.
+class CompactLedgerEntryIndex : public NonMovableOrCopyable
+{
+    static constexpr size_t CHUNK_SIZE = 64 * 1024 * 1024;
+    static constexpr size_t HEADER_SIZE = 16;
+    static constexpr uint64_t NO_RECORD = UINT64_MAX;
+
+    std::vector<std::vector<uint8_t>> mChunks;
+    FlatHashMap<uint64_t, uint64_t> mIndex;
+    size_t mRecords{0};
+    size_t mLiveEntries{0};
+
+    // Record locations are the chunk number in the upper 32 bits and the
+    // offset into that chunk in the lower 32 bits
+    uint8_t const* recordAt(uint64_t loc) const;
+    uint64_t find(uint64_t hash, std::vector<uint8_t> const& keyBytes) const;
+
+  public:
+    CompactLedgerEntryIndex() = default;
+
+    // Records entry as the newest version of key, unless key has been added
+    // before, in which case the index does not change and false is returned.
+    // A null entry records that the index holds no entry for key.
+    bool addIfNew(LedgerKey const& key, LedgerEntry const* entry);
+
+    // Decodes the entry for key into entry and returns true, or returns false
+    // if key was never added or was added without an entry
+    bool load(LedgerKey const& key, LedgerEntry& entry) const;
+
+    // Number of keys added, with or without an entry
+    size_t size() const;
+    size_t liveEntries() const;
+    size_t memoryUsage() const;
+};
+}
@@ -20,10 +20,12 @@ using namespace metautils;
 
 FlushAndRotateMetaDebugWork::FlushAndRotateMetaDebugWork(
     Application& app, std::filesystem::path const& metaDebugPath,
-    std::unique_ptr<XDROutputFileStream> metaDebugFile, uint32_t ledgersToKeep)
+    std::unique_ptr<XDROutputFileStream> metaDebugFile, MetaDebugIndex index,
+    uint32_t ledgersToKeep)
     : Work(app, "flush and rotate meta-debug", BasicWork::RETRY_NEVER)
     , mMetaDebugPath(metaDebugPath)
     , mMetaDebugFile(std::move(metaDebugFile))
+    , mIndex(std::move(index))
     , mLedgersToKeep(ledgersToKeep)
 {
 }
@@ -74,6 +76,24 @@ FlushAndRotateMetaDebugWork::doWork()
                                  e.what());
                 }
 
+                // Then write the index that lets replay skip or seek into the
+                // segment, which is only worth having once it is complete.
+                if (!self->mIndex.empty())
+                {
+                    try
+                    {
+                        writeMetaDebugIndex(
+                            getMetaDebugIndexPath(self->mMetaDebugPath),
+                            self->mIndex);
+                    }
+                    catch (std::runtime_error& e)
+                    {
+                        CLOG_WARNING(Ledger,
+                                     "Failed to write debug metadata index: {}",
+                                     e.what());
+                    }
+                }
+
                 // Then post back to main thread.
                 self->mApp.postOnMainThread(
                     [weak]() {
@@ -85,7 +105,8 @@ FlushAndRotateMetaDebugWork::doWork()
                     },
                     "wake up gzip and rotate meta-debug");
             },
-            "close and fsync meta-debug");
+            "close and fsync meta-debug",
+            WorkerPriority::BULK);
         return BasicWork::State::WORK_WAITING;
     }
 
@@ -136,6 +157,7 @@ FlushAndRotateMetaDebugWork::doWork()
             CLOG_DEBUG(Ledger, "trimming old meta-debug file {}", f.string());
             std::error_code ec;
             std::filesystem::remove(f, ec);
+            std::filesystem::remove(getMetaDebugIndexPath(f), ec);
             // Ignore errors: there's nothing we can do to "try harder" and
             // failing the work is not helpful. We'll just try again.
         }
@@ -5,6 +5,7 @@
 #pragma once
 
 #include "historywork/GzipFileWork.h"
+#include "util/DebugMetaUtils.h"
 #include "util/XDRStream.h"
 #include <filesystem>
 
@@ -15,6 +16,7 @@ class FlushAndRotateMetaDebugWork : public Work
 {
     std::filesystem::path mMetaDebugPath;
     std::unique_ptr<XDROutputFileStream> mMetaDebugFile;
+    metautils::MetaDebugIndex const mIndex;
     std::shared_ptr<GzipFileWork> mGzipFileWork;
     uint32_t mLedgersToKeep;
 
@@ -22,7 +24,7 @@ class FlushAndRotateMetaDebugWork : public Work
     FlushAndRotateMetaDebugWork(
         Application& app, std::filesystem::path const& metaDebugPath,
         std::unique_ptr<XDROutputFileStream> metaDebugFile,
-        uint32_t ledgersToKeep);
+        metautils::MetaDebugIndex index, uint32_t ledgersToKeep);
     ~FlushAndRotateMetaDebugWork() = default;
 
   protected:
@@ -66,6 +66,12 @@ InMemoryLedgerTxn::FilteredEntryIteratorImpl::key() const
     return mIter.key();
 }
 
+size_t
+InMemoryLedgerTxn::FilteredEntryIteratorImpl::keyHash() const
+{
+    return mIter.keyHash();
+}
+
 std::unique_ptr<EntryIterator::AbstractImpl>
 InMemoryLedgerTxn::FilteredEntryIteratorImpl::clone() const
 {
@@ -91,7 +97,7 @@ InMemoryLedgerTxn::addChild(AbstractLedgerTxn& child, TransactionMode mode)
             "Adding child to already-open InMemoryLedgerTxn");
     }
     LedgerTxn::addChild(child, mode);
-    if (mode == TransactionMode::READ_WRITE_WITH_SQL_TXN)
+    if (mode != TransactionMode::READ_ONLY_WITHOUT_SQL_TXN)
     {
         mTransaction = std::make_unique<soci::transaction>(mDb.getSession());
     }
@@ -69,6 +69,8 @@ class InMemoryLedgerTxn : public LedgerTxn
 
         InternalLedgerKey const& key() const override;
 
+        size_t keyHash() const override;
+
         std::unique_ptr<EntryIterator::AbstractImpl> clone() const override;
     };
 
@@ -3,13 +3,17 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "ledger/InMemoryLedgerTxnRoot.h"
+#include "bucket/Bucket.h"
+#include "bucket/BucketInputIterator.h"
 #include "ledger/LedgerRange.h"
 #include "ledger/LedgerTxn.h"
+#include "util/Logging.h"
 #include "util/XDROperators.h"
 #include "util/XDRStream.h"
 #include "util/types.h"
 #include "xdr/Stellar-ledger-entries.h"
 #include "xdrpp/marshal.h"
+#include <Tracy.hpp>
 #include <algorithm>
 
 namespace stellar
@@ -27,6 +31,60 @@ InMemoryLedgerTxnRoot::InMemoryLedgerTxnRoot(
 {
 }
 
+std::vector<LedgerEntry>
+InMemoryLedgerTxnRoot::seedFromBuckets(
+    std::vector<std::shared_ptr<Bucket const>> const& buckets)
+{
+    ZoneScoped;
+    mIndex = std::make_unique<CompactLedgerEntryIndex>();
+    std::vector<LedgerEntry> kept;
+
+    auto isKeptInLedgerTxn = [](LedgerKey const& key) {
+        return key.type() == OFFER ||
+               (key.type() == TRUSTLINE &&
+                key.trustLine().asset.type() == ASSET_TYPE_POOL_SHARE);
+    };
+
+    // Only the first version of a key seen is recorded, and older versions
+    // are skipped. Keys kept in the LedgerTxn are recorded without an entry
+    // so that older versions of them are skipped as well.
+    for (auto const& bucket : buckets)
+    {
+        for (BucketInputIterator iter(bucket, /* streamingIO */ true); iter;
+             ++iter)
+        {
+            BucketEntry const& be = *iter;
+            if (be.type() == DEADENTRY)
+            {
+                mIndex->addIfNew(be.deadEntry(), nullptr);
+                continue;
+            }
+
+            releaseAssert(be.type() == LIVEENTRY || be.type() == INITENTRY);
+            auto const& le = be.liveEntry();
+            auto key = LedgerEntryKey(le);
+            if (isKeptInLedgerTxn(key))
+            {
+                if (mIndex->addIfNew(key, nullptr))
+                {
+                    kept.emplace_back(le);
+                }
+            }
+            else
+            {
+                mIndex->addIfNew(key, &le);
+            }
+        }
+    }
+
+    CLOG_INFO(Ledger,
+              "Seeded in-memory ledger with {} entries ({} MB), keeping {} "
+              "offers and pool share trustlines in the LedgerTxn",
+              mIndex->liveEntries(), mIndex->memoryUsage() / (1024 * 1024),
+              kept.size());
+    return kept;
+}
+
 void
 InMemoryLedgerTxnRoot::addChild(AbstractLedgerTxn& child, TransactionMode mode)
 {
@@ -93,7 +151,18 @@ InMemoryLedgerTxnRoot::getInflationWinners(size_t maxWinners,
 std::shared_ptr<InternalLedgerEntry const>
 InMemoryLedgerTxnRoot::getNewestVersion(InternalLedgerKey const& key) const
 {
-    return nullptr;
+    if (!mIndex || key.type() != InternalLedgerEntryType::LEDGER_ENTRY)
+    {
+        return nullptr;
+    }
+
+    auto res = std::make_shared<InternalLedgerEntry>(
+        InternalLedgerEntryType::LEDGER_ENTRY);
+    if (!mIndex->load(key.ledgerKey(), res->ledgerEntry()))
+    {
+        return nullptr;
+    }
+    return res;
 }
 
 uint64_t
@@ -177,6 +246,13 @@ InMemoryLedgerTxnRoot::prefetch(UnorderedSet<LedgerKey> const&)
     return 0;
 }
 
+uint32_t
+InMemoryLedgerTxnRoot::prefetchLoaded(LedgerKeySet const&,
+                                      std::vector<LedgerEntry> const&, uint32_t)
+{
+    return 0;
+}
+
 void InMemoryLedgerTxnRoot::prepareNewObjects(size_t)
 {
 }
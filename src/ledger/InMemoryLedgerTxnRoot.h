@@ -4,6 +4,7 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
+#include "ledger/CompactLedgerEntryIndex.h"
 #include "ledger/InternalLedgerEntry.h"
 #include "ledger/LedgerTxn.h"
 #include "ledger/LedgerTxnImpl.h"
@@ -19,13 +20,21 @@
 //
 // This is used to anchor a live-but-never-committed LedgerTxn when doing
 // strictly-in-memory fast history replay.
+//
+// It can also be seeded with the state of a bucket list, in which case
+// getNewestVersion answers from a CompactLedgerEntryIndex of the newest version
+// of every entry. This lets in-memory mode start from a ledger of mainnet size
+// without holding every entry in the LedgerTxn above it.
 
 namespace stellar
 {
 
+class Bucket;
+
 class InMemoryLedgerTxnRoot : public AbstractLedgerTxnParent
 {
     std::unique_ptr<LedgerHeader> mHeader;
+    std::unique_ptr<CompactLedgerEntryIndex> mIndex;
 
 #ifdef BEST_OFFER_DEBUGGING
     bool const mBestOfferDebuggingEnabled;
@@ -37,6 +46,15 @@ class InMemoryLedgerTxnRoot : public AbstractLedgerTxnParent
         bool bestOfferDebuggingEnabled
 #endif
     );
+
+    // Replaces the contents of the index with the newest version of every
+    // entry in buckets, which must be ordered from newest to oldest. Offers
+    // and pool share trustlines are not indexed but returned, since the order
+    // book and the queries by account are answered by the InMemoryLedgerTxn
+    // above this root.
+    std::vector<LedgerEntry>
+    seedFromBuckets(std::vector<std::shared_ptr<Bucket const>> const& buckets);
+
     void addChild(AbstractLedgerTxn& child, TransactionMode mode) override;
     void commitChild(EntryIterator iter,
                      LedgerTxnConsistency cons) noexcept override;
@@ -82,6 +100,9 @@ class InMemoryLedgerTxnRoot : public AbstractLedgerTxnParent
     void dropTTL(bool rebuild) override;
     double getPrefetchHitRate() const override;
     uint32_t prefetch(UnorderedSet<LedgerKey> const& keys) override;
+    uint32_t prefetchLoaded(LedgerKeySet const& keys,
+                            std::vector<LedgerEntry> const& entries,
+                            uint32_t ledgerSeq) override;
     void prepareNewObjects(size_t s) override;
 
 #ifdef BUILD_TESTS
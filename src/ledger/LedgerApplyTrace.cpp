@@ -0,0 +1,171 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "ledger/LedgerApplyTrace.h"
+#include "lib/json/json.h"
+#include "util/GlobalChecks.h"
+#include "xdr/Stellar-ledger-entries.h"
+
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+
+namespace stellar
+{
+
+namespace
+{
+thread_local LedgerApplyTrace* gActiveApplyTrace = nullptr;
+
+uint64_t
+sumCounts(std::vector<medida::Meter const*> const& meters)
+{
+    uint64_t res = 0;
+    for (auto const* m : meters)
+    {
+        res += m->count();
+    }
+    return res;
+}
+}
+
+LedgerApplyTrace::Scope::Scope(char const* name, char const* category)
+    : mTrace(gActiveApplyTrace)
+{
+    if (mTrace)
+    {
+        mEvent = mTrace->beginEvent(name, category);
+    }
+}
+
+LedgerApplyTrace::Scope::~Scope()
+{
+    if (mTrace)
+    {
+        mTrace->endEvent(mEvent);
+    }
+}
+
+void
+LedgerApplyTrace::Scope::setDetail(std::string detail)
+{
+    if (mTrace)
+    {
+        mTrace->mEvents[mEvent].mDetail = std::move(detail);
+    }
+}
+
+void
+LedgerApplyTrace::Scope::setSuccess(bool success)
+{
+    if (mTrace)
+    {
+        mTrace->mEvents[mEvent].mSuccess = success;
+    }
+}
+
+LedgerApplyTrace::Activation::Activation(LedgerApplyTrace* trace)
+    : mPrevious(gActiveApplyTrace)
+{
+    gActiveApplyTrace = trace;
+}
+
+LedgerApplyTrace::Activation::~Activation()
+{
+    gActiveApplyTrace = mPrevious;
+}
+
+LedgerApplyTrace::LedgerApplyTrace(medida::MetricsRegistry& metrics,
+                                   uint32_t ledgerSeq)
+    : mLedgerSeq(ledgerSeq)
+    , mStart(std::chrono::steady_clock::now())
+    , mReadBytesMeter(metrics.NewMeter(
+          {"soroban", "host-fn-op", "read-ledger-byte"}, "byte"))
+{
+    // Same meters LedgerTxnRoot marks on each lookup
+    for (auto let : xdr::xdr_traits<LedgerEntryType>::enum_values())
+    {
+        auto const& label = xdr::xdr_traits<LedgerEntryType>::enum_name(
+            static_cast<LedgerEntryType>(let));
+        mEntryCacheHitMeters.emplace_back(&metrics.NewMeter(
+            {"ledger", "entry-cache", "hit", label}, "entry"));
+        mEntryCacheMissMeters.emplace_back(&metrics.NewMeter(
+            {"ledger", "entry-cache", "miss", label}, "entry"));
+    }
+}
+
+LedgerApplyTrace::Counters
+LedgerApplyTrace::readCounters() const
+{
+    Counters res;
+    res.mEntryCacheHits = sumCounts(mEntryCacheHitMeters);
+    res.mEntryCacheMisses = sumCounts(mEntryCacheMissMeters);
+    res.mReadBytes = mReadBytesMeter.count();
+    return res;
+}
+
+size_t
+LedgerApplyTrace::beginEvent(char const* name, char const* category)
+{
+    Event e;
+    e.mName = name;
+    e.mCategory = category;
+    e.mCounters = readCounters();
+    e.mStart = std::chrono::steady_clock::now() - mStart;
+    mEvents.emplace_back(std::move(e));
+    return mEvents.size() - 1;
+}
+
+void
+LedgerApplyTrace::endEvent(size_t event)
+{
+    releaseAssert(event < mEvents.size());
+    auto end = std::chrono::steady_clock::now() - mStart;
+    auto counters = readCounters();
+    auto& e = mEvents[event];
+    e.mDuration = end - e.mStart;
+    e.mCounters.mEntryCacheHits =
+        counters.mEntryCacheHits - e.mCounters.mEntryCacheHits;
+    e.mCounters.mEntryCacheMisses =
+        counters.mEntryCacheMisses - e.mCounters.mEntryCacheMisses;
+    e.mCounters.mReadBytes = counters.mReadBytes - e.mCounters.mReadBytes;
+}
+
+std::string
+LedgerApplyTrace::toChromeTrace() const
+{
+    // Complete ("X") events on a single thread; viewers nest them by time
+    Json::Value root;
+    auto& events = root["traceEvents"];
+    events = Json::Value(Json::arrayValue);
+    for (auto const& e : mEvents)
+    {
+        Json::Value ev;
+        ev["name"] = e.mName;
+        ev["cat"] = e.mCategory;
+        ev["ph"] = "X";
+        ev["pid"] = 0;
+        ev["tid"] = 0;
+        ev["ts"] = static_cast<double>(e.mStart.count()) / 1000.0;
+        ev["dur"] = static_cast<double>(e.mDuration.count()) / 1000.0;
+        auto& args = ev["args"];
+        args["entry-cache-hits"] =
+            static_cast<Json::UInt64>(e.mCounters.mEntryCacheHits);
+        args["entry-cache-misses"] =
+            static_cast<Json::UInt64>(e.mCounters.mEntryCacheMisses);
+        args["read-bytes"] = static_cast<Json::UInt64>(e.mCounters.mReadBytes);
+        if (!e.mDetail.empty())
+        {
+            args["detail"] = e.mDetail;
+        }
+        if (e.mSuccess)
+        {
+            args["success"] = *e.mSuccess;
+        }
+        events.append(ev);
+    }
+    root["displayTimeUnit"] = "ns";
+    root["otherData"]["ledgerSeq"] = mLedgerSeq;
+    return root.toStyledString();
+}
+}
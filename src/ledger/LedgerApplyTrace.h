@@ -0,0 +1,116 @@
+#pragma once
+
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/NonCopyable.h"
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace medida
+{
+class Meter;
+class MetricsRegistry;
+}
+
+namespace stellar
+{
+
+// Wall-clock trace of how one ledger was applied, broken down into the fee
+// processing, each transaction and each of its operations. Every event also
+// records how many entries it found in the LedgerTxnRoot entry cache, how
+// many it had to load from storage and how many ledger bytes Soroban host
+// functions read during it, taken from the corresponding metrics.
+//
+// This is meant for finding out which transactions dominated a slow ledger
+// when Tracy is not attached. The trace is written in the Chrome trace event
+// format, which chrome://tracing, Perfetto and speedscope display as a
+// flamegraph.
+class LedgerApplyTrace : public NonMovableOrCopyable
+{
+  public:
+    struct Counters
+    {
+        uint64_t mEntryCacheHits{0};
+        uint64_t mEntryCacheMisses{0};
+        uint64_t mReadBytes{0};
+    };
+
+    // Records the code it encloses as one event of the trace active on the
+    // calling thread. Does nothing if there is none.
+    class Scope : public NonMovableOrCopyable
+    {
+        LedgerApplyTrace* const mTrace;
+        size_t mEvent{0};
+
+      public:
+        Scope(char const* name, char const* category);
+        ~Scope();
+
+        bool
+        active() const
+        {
+            return mTrace != nullptr;
+        }
+
+        // Free-form details shown with the event, like a transaction hash
+        void setDetail(std::string detail);
+        void setSuccess(bool success);
+    };
+
+    // Makes trace the one Scopes on the calling thread record into for the
+    // lifetime of the Activation. trace may be null.
+    class Activation : public NonMovableOrCopyable
+    {
+        LedgerApplyTrace* const mPrevious;
+
+      public:
+        explicit Activation(LedgerApplyTrace* trace);
+        ~Activation();
+    };
+
+    LedgerApplyTrace(medida::MetricsRegistry& metrics, uint32_t ledgerSeq);
+
+    uint32_t
+    getLedgerSeq() const
+    {
+        return mLedgerSeq;
+    }
+
+    size_t
+    size() const
+    {
+        return mEvents.size();
+    }
+
+    std::string toChromeTrace() const;
+
+  private:
+    struct Event
+    {
+        char const* mName;
+        char const* mCategory;
+        std::chrono::nanoseconds mStart;
+        std::chrono::nanoseconds mDuration{0};
+        Counters mCounters;
+        std::string mDetail;
+        std::optional<bool> mSuccess;
+    };
+
+    uint32_t const mLedgerSeq;
+    std::chrono::steady_clock::time_point const mStart;
+    std::vector<medida::Meter const*> mEntryCacheHitMeters;
+    std::vector<medida::Meter const*> mEntryCacheMissMeters;
+    medida::Meter const& mReadBytesMeter;
+    std::vector<Event> mEvents;
+
+    Counters readCounters() const;
+    size_t beginEvent(char const* name, char const* category);
+    void endEvent(size_t event);
+};
+}
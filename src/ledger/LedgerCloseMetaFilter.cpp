@@ -0,0 +1,241 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "ledger/LedgerCloseMetaFilter.h"
+#include "util/GlobalChecks.h"
+#include <Tracy.hpp>
+#include <fmt/format.h>
+
+namespace stellar
+{
+
+namespace
+{
+template <typename T>
+void
+validateQuery(xdrquery::XDRMatcher& matcher, char const* name)
+{
+    // The matcher parses its query and validates its fields on first use
+    try
+    {
+        matcher.matchXDR(T{});
+    }
+    catch (std::exception const& e)
+    {
+        throw std::invalid_argument(fmt::format(
+            FMT_STRING("invalid meta stream {} query: {}"), name, e.what()));
+    }
+}
+
+// Copies the parts of meta that are filtered the same way in every version
+// of LedgerCloseMeta into res
+template <typename Meta, typename FilterChanges, typename FilterTxMeta>
+void
+filterLedgerCloseMeta(Meta const& meta, Meta& res, FilterChanges filterChanges,
+                      FilterTxMeta filterTxMeta)
+{
+    res.ledgerHeader = meta.ledgerHeader;
+    for (auto const& txp : meta.txProcessing)
+    {
+        TransactionResultMeta filtered;
+        filtered.feeProcessing = filterChanges(txp.feeProcessing);
+        filtered.txApplyProcessing = txp.txApplyProcessing;
+        bool keep = filterTxMeta(filtered.txApplyProcessing);
+        if (keep || !filtered.feeProcessing.empty())
+        {
+            filtered.result = txp.result;
+            res.txProcessing.emplace_back(std::move(filtered));
+        }
+    }
+
+    for (auto const& upgrade : meta.upgradesProcessing)
+    {
+        auto& filtered = res.upgradesProcessing.emplace_back();
+        filtered.upgrade = upgrade.upgrade;
+        filtered.changes = filterChanges(upgrade.changes);
+    }
+}
+}
+
+LedgerCloseMetaFilter::LedgerCloseMetaFilter(std::string const& entryQuery,
+                                             std::string const& eventQuery)
+{
+    if (!entryQuery.empty())
+    {
+        mEntryMatcher.emplace(entryQuery);
+        validateQuery<LedgerEntry>(*mEntryMatcher, "entry");
+    }
+    if (!eventQuery.empty())
+    {
+        mEventMatcher.emplace(eventQuery);
+        validateQuery<ContractEvent>(*mEventMatcher, "event");
+    }
+}
+
+bool
+LedgerCloseMetaFilter::matches(LedgerEntry const& entry)
+{
+    return mEntryMatcher && mEntryMatcher->matchXDR(entry);
+}
+
+LedgerEntryChanges
+LedgerCloseMetaFilter::filterChanges(LedgerEntryChanges const& changes)
+{
+    LedgerEntryChanges res;
+    if (!mEntryMatcher)
+    {
+        return res;
+    }
+
+    for (size_t i = 0; i < changes.size(); ++i)
+    {
+        auto const& change = changes[i];
+        LedgerEntryChange const* next = nullptr;
+        if (change.type() == LEDGER_ENTRY_STATE && i + 1 < changes.size() &&
+            (changes[i + 1].type() == LEDGER_ENTRY_UPDATED ||
+             changes[i + 1].type() == LEDGER_ENTRY_REMOVED))
+        {
+            next = &changes[++i];
+        }
+
+        bool keep = false;
+        switch (change.type())
+        {
+        case LEDGER_ENTRY_CREATED:
+            keep = matches(change.created());
+            break;
+        case LEDGER_ENTRY_UPDATED:
+            keep = matches(change.updated());
+            break;
+        case LEDGER_ENTRY_STATE:
+            keep = matches(change.state()) ||
+                   (next && next->type() == LEDGER_ENTRY_UPDATED &&
+                    matches(next->updated()));
+            break;
+        case LEDGER_ENTRY_REMOVED:
+            // Only a key, which the entry query can't be matched against
+            break;
+        default:
+            releaseAssert(false);
+        }
+
+        if (keep)
+        {
+            res.emplace_back(change);
+            if (next)
+            {
+                res.emplace_back(*next);
+            }
+        }
+    }
+    return res;
+}
+
+bool
+LedgerCloseMetaFilter::filterTxMeta(TransactionMeta& meta)
+{
+    bool keep = false;
+    auto filter = [&](LedgerEntryChanges& changes) {
+        changes = filterChanges(changes);
+        keep = keep || !changes.empty();
+    };
+    auto filterOps = [&](xdr::xvector<OperationMeta>& operations) {
+        for (auto& op : operations)
+        {
+            filter(op.changes);
+        }
+    };
+
+    switch (meta.v())
+    {
+    case 0:
+        filterOps(meta.operations());
+        break;
+    case 1:
+        filter(meta.v1().txChanges);
+        filterOps(meta.v1().operations);
+        break;
+    case 2:
+        filter(meta.v2().txChangesBefore);
+        filterOps(meta.v2().operations);
+        filter(meta.v2().txChangesAfter);
+        break;
+    case 3:
+    {
+        auto& v3 = meta.v3();
+        filter(v3.txChangesBefore);
+        filterOps(v3.operations);
+        filter(v3.txChangesAfter);
+        if (v3.sorobanMeta)
+        {
+            v3.sorobanMeta->diagnosticEvents.clear();
+            xdr::xvector<ContractEvent> events;
+            if (mEventMatcher)
+            {
+                for (auto& event : v3.sorobanMeta->events)
+                {
+                    if (mEventMatcher->matchXDR(event))
+                    {
+                        events.emplace_back(std::move(event));
+                    }
+                }
+            }
+            v3.sorobanMeta->events = std::move(events);
+            keep = keep || !v3.sorobanMeta->events.empty();
+        }
+        break;
+    }
+    default:
+        releaseAssert(false);
+    }
+    return keep;
+}
+
+LedgerCloseMeta
+LedgerCloseMetaFilter::filter(LedgerCloseMeta const& meta)
+{
+    ZoneScoped;
+    LedgerCloseMeta res;
+    res.v(meta.v());
+    auto filterChangesFn = [this](LedgerEntryChanges const& changes) {
+        return filterChanges(changes);
+    };
+    auto filterTxMetaFn = [this](TransactionMeta& txMeta) {
+        return filterTxMeta(txMeta);
+    };
+
+    switch (meta.v())
+    {
+    case 0:
+    {
+        auto& v0 = res.v0();
+        v0.txSet.previousLedgerHash = meta.v0().txSet.previousLedgerHash;
+        filterLedgerCloseMeta(meta.v0(), v0, filterChangesFn, filterTxMetaFn);
+        break;
+    }
+    case 1:
+    {
+        auto const& in = meta.v1();
+        auto& v1 = res.v1();
+        v1.ext = in.ext;
+        v1.txSet.v(in.txSet.v());
+        v1.txSet.v1TxSet().previousLedgerHash =
+            in.txSet.v1TxSet().previousLedgerHash;
+        filterLedgerCloseMeta(in, v1, filterChangesFn, filterTxMetaFn);
+        v1.totalByteSizeOfBucketList = in.totalByteSizeOfBucketList;
+        for (auto const& entry : in.evictedPersistentLedgerEntries)
+        {
+            if (matches(entry))
+            {
+                v1.evictedPersistentLedgerEntries.emplace_back(entry);
+            }
+        }
+        break;
+    }
+    default:
+        releaseAssert(false);
+    }
+    return res;
+}
+}
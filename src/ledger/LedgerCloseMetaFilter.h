@@ -0,0 +1,51 @@
+#pragma once
+
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/NonCopyable.h"
+#include "util/xdrquery/XDRQuery.h"
+#include "xdr/Stellar-ledger.h"
+
+#include <optional>
+#include <string>
+
+namespace stellar
+{
+
+// Prunes LedgerCloseMeta down to the ledger entry changes and contract events
+// that match a pair of XDR queries (see util/xdrquery), for meta streams whose
+// consumers only need a slice of the full meta.
+//
+// The filtered meta is still a LedgerCloseMeta of the same version, holding:
+// - the ledger header,
+// - the transaction results and meta, entry changes that don't match the
+//   entry query and contract events that don't match the event query left
+//   out; transactions left with neither are dropped altogether,
+// - the upgrades, with their entry changes filtered the same way,
+// - the evicted persistent entries that match the entry query.
+// The transaction set, the SCP messages, evicted temporary keys and
+// diagnostic events are always left out. A STATE change and the UPDATED or
+// REMOVED change that follows it are kept or dropped together, if either
+// entry matches.
+class LedgerCloseMetaFilter : public NonMovableOrCopyable
+{
+    // Unset queries match nothing
+    std::optional<xdrquery::XDRMatcher> mEntryMatcher;
+    std::optional<xdrquery::XDRMatcher> mEventMatcher;
+
+    bool matches(LedgerEntry const& entry);
+    LedgerEntryChanges filterChanges(LedgerEntryChanges const& changes);
+    bool filterTxMeta(TransactionMeta& meta);
+
+  public:
+    // entryQuery is matched against LedgerEntry and eventQuery against
+    // ContractEvent. Throws std::invalid_argument if either is malformed.
+    LedgerCloseMetaFilter(std::string const& entryQuery,
+                          std::string const& eventQuery);
+
+    // Not thread-safe: each filter must only be used by one thread at a time
+    LedgerCloseMeta filter(LedgerCloseMeta const& meta);
+};
+}
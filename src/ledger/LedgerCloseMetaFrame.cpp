@@ -8,6 +8,9 @@
 #include "transactions/TransactionMetaFrame.h"
 #include "util/GlobalChecks.h"
 #include "util/ProtocolVersion.h"
+#include <Tracy.hpp>
+
+#include <algorithm>
 
 namespace stellar
 {
@@ -73,15 +76,17 @@ LedgerCloseMetaFrame::pushTxProcessingEntry()
 
 void
 LedgerCloseMetaFrame::setLastTxProcessingFeeProcessingChanges(
-    LedgerEntryChanges const& changes)
+    LedgerEntryChanges&& changes)
 {
     switch (mVersion)
     {
     case 0:
-        mLedgerCloseMeta.v0().txProcessing.back().feeProcessing = changes;
+        mLedgerCloseMeta.v0().txProcessing.back().feeProcessing =
+            std::move(changes);
         break;
     case 1:
-        mLedgerCloseMeta.v1().txProcessing.back().feeProcessing = changes;
+        mLedgerCloseMeta.v1().txProcessing.back().feeProcessing =
+            std::move(changes);
         break;
     default:
         releaseAssert(false);
@@ -90,27 +95,29 @@ LedgerCloseMetaFrame::setLastTxProcessingFeeProcessingChanges(
 
 void
 LedgerCloseMetaFrame::setTxProcessingMetaAndResultPair(
-    TransactionMeta const& tm, TransactionResultPair&& rp, int index)
+    TransactionMeta const& tm, TransactionResultPair const& rp, int index)
 {
-    switch (mVersion)
-    {
-    case 0:
-    {
-        auto& txp = mLedgerCloseMeta.v0().txProcessing.at(index);
-        txp.txApplyProcessing = tm;
-        txp.result = std::move(rp);
-    }
-    break;
-    case 1:
-    {
-        auto& txp = mLedgerCloseMeta.v1().txProcessing.at(index);
-        txp.txApplyProcessing = tm;
-        txp.result = std::move(rp);
-    }
-    break;
-    default:
-        releaseAssert(false);
-    }
+    ZoneScoped;
+    auto& txp = txProcessing();
+    releaseAssert(index >= 0 && static_cast<size_t>(index) < txp.size());
+    releaseAssert(static_cast<size_t>(index) == mEncodedTxCount);
+
+    // Same encoding as TransactionResultMeta{rp, feeProcessing, tm}, without
+    // copying tm into the XDR object first
+    auto& feeProcessing = txp[index].feeProcessing;
+    auto sz = xdr::xdr_size(rp) + xdr::xdr_size(feeProcessing) +
+              xdr::xdr_size(tm);
+    auto offset = mEncodedTxProcessing.size();
+    mEncodedTxProcessing.resize(offset + sz);
+    xdr::xdr_put p(mEncodedTxProcessing.data() + offset,
+                   mEncodedTxProcessing.data() + offset + sz);
+    xdr::xdr_argpack_archive(p, rp);
+    xdr::xdr_argpack_archive(p, feeProcessing);
+    xdr::xdr_argpack_archive(p, tm);
+    ++mEncodedTxCount;
+
+    // Free the fee changes, the placeholder is not encoded
+    LedgerEntryChanges().swap(feeProcessing);
 }
 
 xdr::xvector<UpgradeEntryMeta>&
@@ -186,9 +193,60 @@ LedgerCloseMetaFrame::setNetworkConfiguration(
     }
 }
 
-LedgerCloseMeta const&
-LedgerCloseMetaFrame::getXDR() const
+xdr::xvector<TransactionResultMeta>&
+LedgerCloseMetaFrame::txProcessing()
 {
-    return mLedgerCloseMeta;
+    switch (mVersion)
+    {
+    case 0:
+        return mLedgerCloseMeta.v0().txProcessing;
+    case 1:
+        return mLedgerCloseMeta.v1().txProcessing;
+    default:
+        releaseAssert(false);
+    }
+}
+
+void
+LedgerCloseMetaFrame::serialize(std::vector<char>& out)
+{
+    ZoneScoped;
+
+    // Encode everything else with an empty txProcessing, then make room for
+    // the encoded entries right after the length of that empty vector, which
+    // comes after the union discriminant and the fields preceding it
+    size_t lengthOffset = 4;
+    switch (mVersion)
+    {
+    case 0:
+        lengthOffset += xdr::xdr_size(mLedgerCloseMeta.v0().ledgerHeader) +
+                        xdr::xdr_size(mLedgerCloseMeta.v0().txSet);
+        break;
+    case 1:
+        lengthOffset += xdr::xdr_size(mLedgerCloseMeta.v1().ext) +
+                        xdr::xdr_size(mLedgerCloseMeta.v1().ledgerHeader) +
+                        xdr::xdr_size(mLedgerCloseMeta.v1().txSet);
+        break;
+    default:
+        releaseAssert(false);
+    }
+
+    xdr::xvector<TransactionResultMeta> placeholders;
+    placeholders.swap(txProcessing());
+    releaseAssert(placeholders.size() == mEncodedTxCount);
+    size_t restSize = xdr::xdr_size(mLedgerCloseMeta);
+    out.resize(restSize + mEncodedTxProcessing.size());
+    xdr::xdr_put p(out.data(), out.data() + restSize);
+    xdr::xdr_argpack_archive(p, mLedgerCloseMeta);
+    placeholders.swap(txProcessing());
+
+    auto length = out.begin() + lengthOffset;
+    releaseAssert(std::all_of(length, length + 4,
+                              [](char c) { return c == 0; }));
+    std::copy_backward(length + 4, out.begin() + restSize, out.end());
+    xdr::xdr_put lp(&*length, &*length + 4);
+    xdr::xdr_argpack_archive(lp, static_cast<uint32_t>(mEncodedTxCount));
+    std::copy(mEncodedTxProcessing.begin(), mEncodedTxProcessing.end(),
+              length + 4);
 }
 }
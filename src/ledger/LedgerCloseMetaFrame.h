@@ -7,11 +7,18 @@
 #include "herder/TxSetFrame.h"
 #include "xdr/Stellar-ledger.h"
 
+#include <vector>
+
 namespace stellar
 {
 
 // Wrapper around LedgerCloseMeta XDR that provides mutable access to fields
 // in the proper version of meta.
+//
+// Transaction meta, which makes up most of a large ledger's meta, is not kept
+// in the XDR object: setTxProcessingMetaAndResultPair encodes each
+// transaction's entry to a buffer right away, and serialize splices the
+// buffer into the encoding of the rest of the meta.
 class LedgerCloseMetaFrame
 {
   public:
@@ -20,10 +27,11 @@ class LedgerCloseMetaFrame
     LedgerHeaderHistoryEntry& ledgerHeader();
     void reserveTxProcessing(size_t n);
     void pushTxProcessingEntry();
-    void
-    setLastTxProcessingFeeProcessingChanges(LedgerEntryChanges const& changes);
+    void setLastTxProcessingFeeProcessingChanges(LedgerEntryChanges&& changes);
+    // Meta and result have to be set in order of index, after the fee
+    // processing changes of that entry
     void setTxProcessingMetaAndResultPair(TransactionMeta const& tm,
-                                          TransactionResultPair&& rp,
+                                          TransactionResultPair const& rp,
                                           int index);
 
     xdr::xvector<UpgradeEntryMeta>& upgradesProcessing();
@@ -35,11 +43,21 @@ class LedgerCloseMetaFrame
     void setNetworkConfiguration(SorobanNetworkConfig const& networkConfig,
                                  bool emitExtV1);
 
-    LedgerCloseMeta const& getXDR() const;
+    // Replaces the contents of out with the XDR encoding of the
+    // LedgerCloseMeta, so that out can be reused from one ledger to the next
+    void serialize(std::vector<char>& out);
 
   private:
     LedgerCloseMeta mLedgerCloseMeta;
     int mVersion;
+
+    // txProcessing only holds the entries whose meta has not been set yet,
+    // and empty placeholders for the others. Those are encoded one after the
+    // other in mEncodedTxProcessing.
+    std::vector<char> mEncodedTxProcessing;
+    size_t mEncodedTxCount{0};
+
+    xdr::xvector<TransactionResultMeta>& txProcessing();
 };
 
 }
@@ -0,0 +1,155 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "ledger/LedgerCloseMetaStreamWriter.h"
+#include "util/GlobalChecks.h"
+#include "util/Logging.h"
+#include "util/XDRStream.h"
+#include <Tracy.hpp>
+
+#include "medida/counter.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
+
+namespace stellar
+{
+
+LedgerCloseMetaStreamWriter::LedgerCloseMetaStreamWriter(
+    XDROutputFileStream& stream, size_t maxLag,
+    medida::MetricsRegistry& metrics)
+    : mStream(stream)
+    , mMaxLag(maxLag)
+    , mBytes(metrics.NewMeter({"ledger", "metastream", "bytes"}, "byte"))
+    , mWrite(
+          metrics.NewTimer({"ledger", "metastream", "background-write"}))
+    , mBackpressure(
+          metrics.NewTimer({"ledger", "metastream", "backpressure"}))
+    , mLag(metrics.NewCounter({"ledger", "metastream", "lag"}))
+{
+    releaseAssert(mMaxLag > 0);
+    mThread = std::thread{[this]() { run(); }};
+}
+
+LedgerCloseMetaStreamWriter::~LedgerCloseMetaStreamWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mCV.notify_all();
+    mThread.join();
+    if (mError)
+    {
+        try
+        {
+            std::rethrow_exception(mError);
+        }
+        catch (std::exception const& e)
+        {
+            CLOG_ERROR(Ledger, "Meta stream writer failed: {}", e.what());
+        }
+    }
+}
+
+void
+LedgerCloseMetaStreamWriter::rethrowIfFailed(
+    std::unique_lock<std::mutex> const& lock)
+{
+    releaseAssert(lock.owns_lock());
+    if (mError)
+    {
+        std::rethrow_exception(mError);
+    }
+}
+
+void
+LedgerCloseMetaStreamWriter::enqueue(char const* data, size_t size)
+{
+    ZoneScoped;
+    std::unique_lock<std::mutex> lock(mMutex);
+    rethrowIfFailed(lock);
+    if (mPending >= mMaxLag)
+    {
+        CLOG_DEBUG(Ledger, "Meta stream is {} ledgers behind, waiting",
+                   mPending);
+        auto waitTime = mBackpressure.TimeScope();
+        mCV.wait(lock, [&] { return mPending < mMaxLag || mError; });
+        rethrowIfFailed(lock);
+    }
+
+    releaseAssertOrThrow(size < 0x80000000);
+    mFront.mData.insert(mFront.mData.end(), data, data + size);
+    mFront.mRecordSizes.emplace_back(static_cast<uint32_t>(size));
+
+    ++mPending;
+    mLag.set_count(mPending);
+    lock.unlock();
+    mCV.notify_all();
+}
+
+void
+LedgerCloseMetaStreamWriter::drain()
+{
+    ZoneScoped;
+    std::unique_lock<std::mutex> lock(mMutex);
+    mCV.wait(lock, [&] { return mPending == 0 || mError; });
+    rethrowIfFailed(lock);
+}
+
+void
+LedgerCloseMetaStreamWriter::writeBack()
+{
+    ZoneScoped;
+    auto writeTime = mWrite.TimeScope();
+    size_t offset = 0;
+    for (auto sz : mBack.mRecordSizes)
+    {
+        size_t written = 0;
+        mStream.writeRaw(mBack.mData.data() + offset, sz, nullptr, &written);
+        mBytes.Mark(written);
+        offset += sz;
+    }
+    mStream.flush();
+}
+
+void
+LedgerCloseMetaStreamWriter::run()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true)
+    {
+        mCV.wait(lock, [&] {
+            return !mFront.mRecordSizes.empty() || mStopping;
+        });
+        if (mFront.mRecordSizes.empty())
+        {
+            // Stopping with nothing left to write
+            return;
+        }
+
+        std::swap(mFront, mBack);
+        auto batch = mBack.mRecordSizes.size();
+        lock.unlock();
+        try
+        {
+            writeBack();
+        }
+        catch (...)
+        {
+            lock.lock();
+            mError = std::current_exception();
+            mCV.notify_all();
+            return;
+        }
+        mBack.mData.clear();
+        mBack.mRecordSizes.clear();
+        lock.lock();
+
+        mPending -= batch;
+        mLag.set_count(mPending);
+        mCV.notify_all();
+    }
+}
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/NonCopyable.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace medida
+{
+class Counter;
+class Meter;
+class MetricsRegistry;
+class Timer;
+}
+
+namespace stellar
+{
+class XDROutputFileStream;
+
+// Writes LedgerCloseMeta to a meta stream on a background thread, so that a
+// slow reader on the other end of the stream does not hold up ledger close.
+//
+// Encoded meta is copied on the calling thread into the front one of two
+// buffers while the writer thread writes the back one out to the stream; the
+// buffers are swapped whenever the writer is done, so once both have grown to
+// the size of a typical batch no more allocations are needed. At most maxLag
+// ledgers can be waiting to be written: enqueuing another one blocks until
+// the writer catches up, so a reader that stays slow eventually slows down
+// ledger close, rather than memory growing without bound.
+//
+// The stream must outlive the writer and must not be used by anything else
+// while the writer exists.
+class LedgerCloseMetaStreamWriter : public NonMovableOrCopyable
+{
+    struct Buffer
+    {
+        std::vector<char> mData;
+        // Size of each serialized LedgerCloseMeta in mData, in order
+        std::vector<uint32_t> mRecordSizes;
+    };
+
+    XDROutputFileStream& mStream;
+    size_t const mMaxLag;
+    medida::Meter& mBytes;
+    medida::Timer& mWrite;
+    medida::Timer& mBackpressure;
+    medida::Counter& mLag;
+
+    std::mutex mMutex;
+    std::condition_variable mCV;
+    // Filled by enqueue, guarded by mMutex
+    Buffer mFront;
+    // Owned by the writer thread between swaps
+    Buffer mBack;
+    // Ledgers enqueued and not fully written yet, guarded by mMutex
+    size_t mPending{0};
+    bool mStopping{false};
+    // First error hit by the writer thread, rethrown on the calling thread
+    std::exception_ptr mError;
+    std::thread mThread;
+
+    void run();
+    void writeBack();
+    void rethrowIfFailed(std::unique_lock<std::mutex> const& lock);
+
+  public:
+    LedgerCloseMetaStreamWriter(XDROutputFileStream& stream, size_t maxLag,
+                                medida::MetricsRegistry& metrics);
+
+    // Writes out everything still pending before returning
+    ~LedgerCloseMetaStreamWriter();
+
+    // Queues the XDR encoding of a LedgerCloseMeta to be written, blocking
+    // while maxLag ledgers are already pending. Throws the error the writer
+    // thread failed with, if any; meta is not written anymore after such a
+    // failure.
+    void enqueue(char const* data, size_t size);
+
+    // Blocks until everything enqueued so far has been written and flushed,
+    // throws like enqueue
+    void drain();
+};
+}
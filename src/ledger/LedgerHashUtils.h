@@ -51,7 +51,7 @@ getAssetHash(T const& asset)
     {
         auto& a4 = asset.alphaNum4();
         hashMix(res, std::hash<stellar::uint256>()(a4.issuer.ed25519()));
-        hashMix(res, stellar::shortHash::computeHash(stellar::ByteSlice(
+        hashMix(res, stellar::shortHash::computeFastHash(stellar::ByteSlice(
                          a4.assetCode.data(), a4.assetCode.size())));
         break;
     }
@@ -59,7 +59,7 @@ getAssetHash(T const& asset)
     {
         auto& a12 = asset.alphaNum12();
         hashMix(res, std::hash<stellar::uint256>()(a12.issuer.ed25519()));
-        hashMix(res, stellar::shortHash::computeHash(stellar::ByteSlice(
+        hashMix(res, stellar::shortHash::computeFastHash(stellar::ByteSlice(
                          a12.assetCode.data(), a12.assetCode.size())));
         break;
     }
@@ -125,12 +125,12 @@ template <> class hash<stellar::LedgerKey>
                                       lk.data().accountID.ed25519()));
             stellar::hashMix(
                 res,
-                stellar::shortHash::computeHash(stellar::ByteSlice(
+                stellar::shortHash::computeFastHash(stellar::ByteSlice(
                     lk.data().dataName.data(), lk.data().dataName.size())));
             break;
         case stellar::OFFER:
             stellar::hashMix(
-                res, stellar::shortHash::computeHash(stellar::ByteSlice(
+                res, stellar::shortHash::computeFastHash(stellar::ByteSlice(
                          &lk.offer().offerID, sizeof(lk.offer().offerID))));
             break;
         case stellar::CLAIMABLE_BALANCE:
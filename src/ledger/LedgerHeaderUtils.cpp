@@ -168,10 +168,10 @@ loadBySequence(Database& db, soci::session& sess, uint32_t seq)
 }
 
 void
-deleteOldEntries(Database& db, uint32_t ledgerSeq, uint32_t count)
+deleteOldEntries(soci::session& sess, uint32_t ledgerSeq, uint32_t count)
 {
     ZoneScoped;
-    DatabaseUtils::deleteOldEntriesHelper(db.getSession(), ledgerSeq, count,
+    DatabaseUtils::deleteOldEntriesHelper(sess, ledgerSeq, count,
                                           "ledgerheaders", "ledgerseq");
 }
 
@@ -27,7 +27,7 @@ std::shared_ptr<LedgerHeader> loadByHash(Database& db, Hash const& hash);
 std::shared_ptr<LedgerHeader> loadBySequence(Database& db, soci::session& sess,
                                              uint32_t seq);
 
-void deleteOldEntries(Database& db, uint32_t ledgerSeq, uint32_t count);
+void deleteOldEntries(soci::session& sess, uint32_t ledgerSeq, uint32_t count);
 void deleteNewerEntries(Database& db, uint32_t ledgerSeq);
 
 size_t copyToStream(Database& db, soci::session& sess, uint32_t ledgerSeq,
@@ -7,14 +7,26 @@
 #include "catchup/CatchupManager.h"
 #include "history/HistoryManager.h"
 #include "ledger/NetworkConfig.h"
+#include <chrono>
+#include <functional>
+#include <map>
 #include <memory>
+#include <optional>
+#include <string>
+
+namespace soci
+{
+class session;
+}
 
 namespace stellar
 {
 
 class LedgerCloseData;
 class Database;
+class TxSetXDRFrame;
 class SorobanMetrics;
+class TxValidityCache;
 
 /**
  * LedgerManager maintains, in memory, a logical pair of ledgers:
@@ -92,6 +104,51 @@ class LedgerManager
     // `ledgerData`.
     virtual void valueExternalized(LedgerCloseData const& ledgerData) = 0;
 
+    // Called by Herder when txSet is likely to be applied to the next ledger,
+    // before consensus is final. If EXPERIMENTAL_LOOKAHEAD_PREFETCH is set and
+    // txSet builds on the LCL, the entries its transactions will load are read
+    // from the BucketList on a background thread and added to the entry cache
+    // of the LedgerTxnRoot. Results only get cached if the LCL did not change
+    // in the meantime. Purely advisory, calling it for a tx set that ends up
+    // not being applied is harmless.
+    virtual void
+    startLookaheadPrefetch(std::shared_ptr<TxSetXDRFrame const> txSet) = 0;
+
+    // Called by Herder when the balloting phase settles on txSet for the next
+    // ledger. If EXPERIMENTAL_SPECULATIVE_TX_SET_PREPARATION is set and txSet
+    // builds on the LCL, it is prepared for apply and kept, and the
+    // signatures of its transactions are verified on background threads so
+    // that their results are in the signature cache. The prepared tx set is
+    // used by the next ledger close if txSet is externalized, and dropped
+    // otherwise. Like startLookaheadPrefetch, this is purely advisory.
+    virtual void startSpeculativeTxSetPreparation(
+        std::shared_ptr<TxSetXDRFrame const> txSet) = 0;
+
+    // Returns the apply trace of ledgerSeq, or of the last ledger traced if
+    // ledgerSeq is not set, in the Chrome trace event format (see
+    // LedgerApplyTrace). Traces are only recorded for the last
+    // APPLY_TRACE_LEDGERS ledgers closed.
+    virtual std::optional<std::string>
+    getApplyTrace(std::optional<uint32_t> ledgerSeq) const = 0;
+
+    // What closing one ledger spent applying its transactions
+    struct ApplyStats
+    {
+        uint32_t mLedgerSeq{0};
+        size_t mTxCount{0};
+        size_t mOpCount{0};
+        // Charging fees and sequence numbers and applying the transactions,
+        // but none of the rest of closeLedger (upgrades, buckets, commit)
+        std::chrono::nanoseconds mApplyTime{0};
+        std::map<OperationType, size_t> mOpTypeCounts;
+    };
+    using ApplyStatsCallback = std::function<void(ApplyStats const&)>;
+
+    // Calls cb with the ApplyStats of every ledger closed from now on, or
+    // stops if cb is null. Meant for benchmarking (see `bench-apply`), since
+    // counting operation types costs a pass over the tx set.
+    virtual void setApplyStatsCallback(ApplyStatsCallback cb) = 0;
+
     // Return the LCL header and (complete, immutable) hash.
     virtual LedgerHeaderHistoryEntry const&
     getLastClosedLedgerHeader() const = 0;
@@ -131,6 +188,10 @@ class LedgerManager
     virtual SorobanNetworkConfig const& getSorobanNetworkConfig() = 0;
     virtual bool hasSorobanNetworkConfig() const = 0;
 
+    // Cache of checkValid successes, shared by the transaction queue, tx set
+    // building and tx set validation
+    virtual TxValidityCache& getTxValidityCache() = 0;
+
 #ifdef BUILD_TESTS
     virtual SorobanNetworkConfig& getMutableSorobanNetworkConfig() = 0;
 #endif
@@ -182,6 +243,11 @@ class LedgerManager
     virtual void deleteOldEntries(Database& db, uint32_t ledgerSeq,
                                   uint32_t count) = 0;
 
+    // same as deleteOldEntries, in one transaction on sess, which can be a
+    // session of the database's pool owned by a worker thread
+    static void deleteOldEntriesInSession(soci::session& sess,
+                                          uint32_t ledgerSeq, uint32_t count);
+
     // cleans historical data newer than ledgerSeq
     // as this is used when applying buckets, the data is deleted such that:
     // ledgerheaders >= ledgerSeq
@@ -4,7 +4,9 @@
 
 #include "ledger/LedgerManagerImpl.h"
 #include "bucket/BucketList.h"
+#include "bucket/BucketListSnapshot.h"
 #include "bucket/BucketManager.h"
+#include "bucket/BucketSnapshotManager.h"
 #include "catchup/AssumeStateWork.h"
 #include "crypto/Hex.h"
 #include "crypto/KeyUtils.h"
@@ -15,14 +17,18 @@
 #include "herder/HerderPersistence.h"
 #include "herder/LedgerCloseData.h"
 #include "herder/TxSetFrame.h"
+#include "herder/TxSetUtils.h"
 #include "herder/Upgrades.h"
 #include "history/HistoryManager.h"
+#include "invariant/InvariantManager.h"
 #include "ledger/FlushAndRotateMetaDebugWork.h"
+#include "ledger/LedgerApplyTrace.h"
 #include "ledger/LedgerHeaderUtils.h"
 #include "ledger/LedgerRange.h"
 #include "ledger/LedgerTxn.h"
 #include "ledger/LedgerTxnEntry.h"
 #include "ledger/LedgerTxnHeader.h"
+#include "ledger/LedgerTypeUtils.h"
 #include "main/Application.h"
 #include "main/Config.h"
 #include "main/ErrorMessages.h"
@@ -33,20 +39,25 @@
 #include "transactions/TransactionSQL.h"
 #include "transactions/TransactionUtils.h"
 #include "util/DebugMetaUtils.h"
+#include "util/Decoder.h"
+#include "util/FlightRecorder.h"
 #include "util/Fs.h"
 #include "util/GlobalChecks.h"
 #include "util/LogSlowExecution.h"
 #include "util/Logging.h"
+#include "util/MemoryArenas.h"
 #include "util/ProtocolVersion.h"
 #include "util/XDRCereal.h"
 #include "util/XDROperators.h"
 #include "util/XDRStream.h"
 #include "work/WorkScheduler.h"
 
+#include <fmt/chrono.h>
 #include <fmt/format.h>
 
 #include "xdr/Stellar-ledger.h"
 #include "xdr/Stellar-transaction.h"
+#include "xdrpp/marshal.h"
 #include "xdrpp/types.h"
 
 #include "medida/buckets.h"
@@ -56,8 +67,13 @@
 #include "medida/timer.h"
 #include <Tracy.hpp>
 
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
 #include <numeric>
+#include <optional>
 #include <regex>
 #include <sstream>
 #include <stdexcept>
@@ -127,14 +143,25 @@ LedgerManager::ledgerAbbrev(LedgerHeaderHistoryEntry const& he)
 LedgerManagerImpl::LedgerManagerImpl(Application& app)
     : mApp(app)
     , mSorobanMetrics(app.getMetrics())
+    , mTxValidityCache(app.getMetrics())
     , mTransactionApply(
           app.getMetrics().NewTimer({"ledger", "transaction", "apply"}))
+    , mVerifySignatures(app.getMetrics().NewTimer(
+          {"ledger", "transaction", "verify-signatures"}))
     , mTransactionCount(
           app.getMetrics().NewHistogram({"ledger", "transaction", "count"}))
     , mOperationCount(
           app.getMetrics().NewHistogram({"ledger", "operation", "count"}))
     , mPrefetchHitRate(
           app.getMetrics().NewHistogram({"ledger", "prefetch", "hit-rate"}))
+    , mLookaheadPrefetch(
+          app.getMetrics().NewTimer({"ledger", "prefetch", "lookahead"}))
+    , mLookaheadPrefetchStale(app.getMetrics().NewMeter(
+          {"ledger", "prefetch", "lookahead-stale"}, "prefetch"))
+    , mSpeculativeTxSetHit(app.getMetrics().NewMeter(
+          {"ledger", "speculative", "hit"}, "txset"))
+    , mSpeculativeTxSetMiss(app.getMetrics().NewMeter(
+          {"ledger", "speculative", "miss"}, "txset"))
     , mLedgerClose(app.getMetrics().NewTimer({"ledger", "ledger", "close"}))
     , mLedgerAgeClosed(app.getMetrics().NewBuckets(
           {"ledger", "age", "closed"}, {5000.0, 7000.0, 10000.0, 20000.0}))
@@ -152,6 +179,8 @@ LedgerManagerImpl::LedgerManagerImpl(Application& app)
           app.getMetrics().NewMeter({"ledger", "metastream", "bytes"}, "byte"))
     , mMetaStreamWriteTime(
           app.getMetrics().NewTimer({"ledger", "metastream", "write"}))
+    , mFilteredMetaStreamBytes(app.getMetrics().NewMeter(
+          {"ledger", "metastream", "filtered-bytes"}, "byte"))
     , mLastClose(mApp.getClock().now())
     , mCatchupDuration(
           app.getMetrics().NewTimer({"ledger", "catchup", "duration"}))
@@ -274,6 +303,35 @@ LedgerManagerImpl::startNewLedger()
     startNewLedger(ledger);
 }
 
+std::shared_ptr<LedgerHeader>
+LedgerManagerImpl::loadLastClosedLedgerHeader(Hash const& hash)
+{
+    if (mApp.getConfig().MODE_STORES_HISTORY_LEDGERHEADERS)
+    {
+        return LedgerHeaderUtils::loadByHash(getDatabase(), hash);
+    }
+
+    // In metadata-only mode only the LCL header is kept, in the storestate
+    // table; a database last used in another mode still has it in the ledger
+    // headers table
+    auto state = mApp.getPersistentState().getState(
+        PersistentState::kLastClosedLedgerHeader);
+    if (state.empty())
+    {
+        return LedgerHeaderUtils::loadByHash(getDatabase(), hash);
+    }
+    std::vector<uint8_t> buffer;
+    decoder::decode_b64(state, buffer);
+    auto header = std::make_shared<LedgerHeader>();
+    xdr::xdr_from_opaque(buffer, *header);
+    if (xdrSha256(*header) != hash)
+    {
+        throw std::runtime_error("Invalid database state: last closed ledger "
+                                 "header does not match its hash");
+    }
+    return header;
+}
+
 static void
 setLedgerTxnHeader(LedgerHeader const& lh, Application& app)
 {
@@ -304,7 +362,8 @@ LedgerManagerImpl::loadLastKnownLedger(bool restoreBucketlist,
     // Step 2. Restore LedgerHeader from DB based on the ledger hash derived
     // earlier, or verify we're at genesis if in no-history mode
     std::optional<LedgerHeader> latestLedgerHeader;
-    if (mApp.getConfig().MODE_STORES_HISTORY_LEDGERHEADERS)
+    if (mApp.getConfig().MODE_STORES_HISTORY_LEDGERHEADERS ||
+        mApp.getConfig().EXPERIMENTAL_METADATA_ONLY_MODE)
     {
         if (mRebuildInMemoryState)
         {
@@ -317,8 +376,7 @@ LedgerManagerImpl::loadLastKnownLedger(bool restoreBucketlist,
         }
         else
         {
-            auto currentLedger =
-                LedgerHeaderUtils::loadByHash(getDatabase(), lastLedgerHash);
+            auto currentLedger = loadLastClosedLedgerHeader(lastLedgerHash);
             if (!currentLedger)
             {
                 throw std::runtime_error("Could not load ledger from database");
@@ -372,13 +430,17 @@ LedgerManagerImpl::loadLastKnownLedger(bool restoreBucketlist,
             // Only restart merges in full startup mode. Many modes in core
             // (standalone offline commands, in-memory setup) do not need to
             // spin up expensive merge processes.
+            auto start = std::chrono::steady_clock::now();
             auto assumeStateWork =
                 mApp.getWorkScheduler().executeWork<AssumeStateWork>(
                     has, latestLedgerHeader->ledgerVersion, restoreBucketlist);
             if (assumeStateWork->getState() == BasicWork::State::WORK_SUCCESS)
             {
-                CLOG_INFO(Ledger, "Assumed bucket-state for LCL: {}",
-                          ledgerAbbrev(*latestLedgerHeader));
+                CLOG_INFO(
+                    Ledger, "Assumed bucket-state for LCL: {} in {}",
+                    ledgerAbbrev(*latestLedgerHeader),
+                    std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::steady_clock::now() - start));
             }
             else
             {
@@ -566,6 +628,12 @@ LedgerManagerImpl::hasSorobanNetworkConfig() const
     return mSorobanNetworkConfig.has_value();
 }
 
+TxValidityCache&
+LedgerManagerImpl::getTxValidityCache()
+{
+    return mTxValidityCache;
+}
+
 #ifdef BUILD_TESTS
 SorobanNetworkConfig&
 LedgerManagerImpl::getMutableSorobanNetworkConfig()
@@ -677,6 +745,7 @@ LedgerManagerImpl::valueExternalized(LedgerCloseData const& ledgerData)
                    "LedgerManager::valueExternalized LCL advanced {} -> {}",
                    lcl, getLastClosedLedgerNum());
         mApp.getHerder().lastClosedLedgerIncreased(appliedLatest);
+        mApp.publishStatus();
     }
 }
 
@@ -758,29 +827,114 @@ LedgerManagerImpl::emitNextMeta()
     ZoneScoped;
 
     releaseAssert(mNextMetaToEmit);
-    releaseAssert(mMetaStream || mMetaDebugStream);
+    releaseAssert(isStreamingMeta());
+    FlightRecorder::Span span(
+        mApp.getFlightRecorder(), "emit meta", "ledger",
+        mNextMetaToEmit->ledgerHeader().header.ledgerSeq);
     auto timer = LogSlowExecution("MetaStream write",
                                   LogSlowExecution::Mode::AUTOMATIC_RAII,
                                   "took", std::chrono::milliseconds(100));
     auto streamWrite = mMetaStreamWriteTime.TimeScope();
-    if (mMetaStream)
+    mNextMetaToEmit->serialize(mMetaBuffer);
+    if (mMetaStreamWriter)
+    {
+        mMetaStreamWriter->enqueue(mMetaBuffer.data(), mMetaBuffer.size());
+    }
+    else if (mMetaStream)
     {
         size_t written = 0;
-        mMetaStream->writeOne(mNextMetaToEmit->getXDR(), nullptr, &written);
+        mMetaStream->writeRaw(mMetaBuffer.data(), mMetaBuffer.size(), nullptr,
+                              &written);
         mMetaStream->flush();
         mMetaStreamBytes.Mark(written);
     }
     if (mMetaDebugStream)
     {
-        mMetaDebugStream->writeOne(mNextMetaToEmit->getXDR());
+        mMetaDebugIndex.emplace_back(
+            mNextMetaToEmit->ledgerHeader().header.ledgerSeq, mMetaDebugBytes);
+        size_t written = 0;
+        mMetaDebugStream->writeRaw(mMetaBuffer.data(), mMetaBuffer.size(),
+                                   nullptr, &written);
+        mMetaDebugBytes += written;
         // Flush debug meta in case there's a crash later in commit (in which
         // case we'd lose the data in internal buffers). This way we preserve
         // the meta for problematic ledgers that is vital for diagnostics.
         mMetaDebugStream->flush();
     }
+    if (!mFilteredMetaStreams.empty())
+    {
+        emitFilteredMeta();
+    }
     mNextMetaToEmit.reset();
 }
 
+void
+LedgerManagerImpl::emitFilteredMeta()
+{
+    ZoneScoped;
+
+    // Decoded once for all the streams, which then filter and write it in
+    // parallel: each of the worker threads and this one takes a stream
+    LedgerCloseMeta meta;
+    {
+        xdr::xdr_get g(mMetaBuffer.data(),
+                       mMetaBuffer.data() + mMetaBuffer.size());
+        xdr::xdr_argpack_archive(g, meta);
+        g.done();
+    }
+
+    auto emit = [&meta, &bytes = mFilteredMetaStreamBytes](
+                    FilteredMetaStream& fs) {
+        auto filtered = fs.mFilter->filter(meta);
+        size_t written = 0;
+        fs.mStream->writeOne(filtered, nullptr, &written);
+        fs.mStream->flush();
+        bytes.Mark(written);
+    };
+
+    using task_t = std::packaged_task<void()>;
+    std::vector<std::future<void>> futures;
+    for (size_t i = 1; i < mFilteredMetaStreams.size(); ++i)
+    {
+        auto task = std::make_shared<task_t>(
+            [&emit, &fs = mFilteredMetaStreams[i]] { emit(fs); });
+        futures.emplace_back(task->get_future());
+        mApp.postOnBackgroundThread([task] { (*task)(); },
+                                    "LedgerManager: emit filtered meta");
+    }
+
+    std::exception_ptr inlineError;
+    try
+    {
+        emit(mFilteredMetaStreams.front());
+    }
+    catch (...)
+    {
+        inlineError = std::current_exception();
+    }
+
+    // Tasks reference meta and the streams, so wait for all of them before
+    // returning, even on error
+    for (auto& f : futures)
+    {
+        f.wait();
+    }
+    if (inlineError)
+    {
+        std::rethrow_exception(inlineError);
+    }
+    for (auto& f : futures)
+    {
+        f.get();
+    }
+}
+
+bool
+LedgerManagerImpl::isStreamingMeta() const
+{
+    return mMetaStream || mMetaDebugStream || !mFilteredMetaStreams.empty();
+}
+
 /*
     This is the main method that closes the current ledger based on
 the close context that was computed by SCP or by the historical module
@@ -796,6 +950,9 @@ LedgerManagerImpl::closeLedger(LedgerCloseData const& ledgerData)
                                      LogSlowExecution::Mode::MANUAL, "",
                                      std::chrono::milliseconds::max()};
 
+    runPendingPostCloseSteps();
+
+    MemoryArenaScope arenaScope(MemoryArena::LEDGER_CLOSE);
     LedgerTxn ltx(mApp.getLedgerTxnRoot());
     auto header = ltx.loadHeader();
     auto initialLedgerVers = header.current().ledgerVersion;
@@ -806,6 +963,14 @@ LedgerManagerImpl::closeLedger(LedgerCloseData const& ledgerData)
 
     ZoneValue(static_cast<int64_t>(header.current().ledgerSeq));
 
+    auto& recorder = mApp.getFlightRecorder();
+    auto const closingSeq = header.current().ledgerSeq;
+    // Ended before ledgerClosed is reported, so that a dump covers it
+    std::optional<FlightRecorder::Span> closeSpan;
+    closeSpan.emplace(recorder, "closeLedger", "ledger", closingSeq);
+    recorder.counter("scheduler queue", closingSeq,
+                     mApp.getClock().getActionQueueSize());
+
     auto now = mApp.getClock().now();
     mLedgerAgeClosed.Update(now - mLastClose);
     mLastClose = now;
@@ -855,7 +1020,12 @@ LedgerManagerImpl::closeLedger(LedgerCloseData const& ledgerData)
     header.current().scpValue = sv;
 
     maybeResetLedgerCloseMetaDebugStream(header.current().ledgerSeq);
-    auto applicableTxSet = txSet->prepareForApply(mApp);
+    ApplicableTxSetFrameConstPtr applicableTxSet;
+    {
+        FlightRecorder::Span span(recorder, "prepare tx set", "ledger",
+                                  closingSeq);
+        applicableTxSet = prepareTxSetForApply(*txSet);
+    }
 
     if (applicableTxSet == nullptr)
     {
@@ -873,7 +1043,7 @@ LedgerManagerImpl::closeLedger(LedgerCloseData const& ledgerData)
     // the ledger entries modified by each tx during tx processing in a
     // LedgerCloseMeta, for streaming to attached clients (typically: horizon).
     std::unique_ptr<LedgerCloseMetaFrame> ledgerCloseMeta;
-    if (mMetaStream || mMetaDebugStream)
+    if (isStreamingMeta())
     {
         if (mNextMetaToEmit)
         {
@@ -891,19 +1061,62 @@ LedgerManagerImpl::closeLedger(LedgerCloseData const& ledgerData)
         ledgerCloseMeta->populateTxSet(*txSet);
     }
 
+    std::unique_ptr<LedgerApplyTrace> applyTrace;
+    if (mApp.getConfig().APPLY_TRACE_LEDGERS > 0)
+    {
+        applyTrace = std::make_unique<LedgerApplyTrace>(
+            mApp.getMetrics(), header.current().ledgerSeq);
+    }
+
     // the transaction set that was agreed upon by consensus
     // was sorted by hash; we reorder it so that transactions are
     // sorted such that sequence numbers are respected
     std::vector<TransactionFrameBasePtr> const txs =
         applicableTxSet->getTxsInApplyOrder();
 
-    // first, prefetch source accounts for txset, then charge fees
-    prefetchTxSourceIds(txs);
-    processFeesSeqNums(txs, ltx, *applicableTxSet, ledgerCloseMeta);
-
     TransactionResultSet txResultSet;
     txResultSet.results.reserve(txs.size());
-    applyTransactions(*applicableTxSet, txs, ltx, txResultSet, ledgerCloseMeta);
+    auto applyStart = std::chrono::steady_clock::now();
+    {
+        LedgerApplyTrace::Activation activeTrace(applyTrace.get());
+        LedgerApplyTrace::Scope ledgerScope("ledger", "ledger");
+        {
+            LedgerApplyTrace::Scope feesScope("fees", "ledger");
+            FlightRecorder::Span span(recorder, "fees", "ledger", closingSeq);
+            // first, prefetch source accounts for txset, then charge fees
+            prefetchTxSourceIds(txs);
+            processFeesSeqNums(txs, ltx, *applicableTxSet, ledgerCloseMeta);
+        }
+
+        FlightRecorder::Span span(recorder, "apply transactions", "ledger",
+                                  closingSeq);
+        applyTransactions(*applicableTxSet, txs, ltx, txResultSet,
+                          ledgerCloseMeta);
+    }
+    if (mApplyStatsCallback)
+    {
+        ApplyStats stats;
+        stats.mLedgerSeq = ledgerData.getLedgerSeq();
+        stats.mTxCount = txs.size();
+        stats.mOpCount = applicableTxSet->sizeOpTotal();
+        stats.mApplyTime = std::chrono::steady_clock::now() - applyStart;
+        for (auto const& tx : txs)
+        {
+            for (auto const& op : tx->getRawOperations())
+            {
+                ++stats.mOpTypeCounts[op.body.type()];
+            }
+        }
+        mApplyStatsCallback(stats);
+    }
+    if (applyTrace)
+    {
+        mApplyTraces.emplace_back(std::move(applyTrace));
+        while (mApplyTraces.size() > mApp.getConfig().APPLY_TRACE_LEDGERS)
+        {
+            mApplyTraces.pop_front();
+        }
+    }
     if (mApp.getConfig().MODE_STORES_HISTORY_MISC)
     {
         storeTxSet(mApp.getDatabase(), ltx.loadHeader().current().ledgerSeq,
@@ -915,6 +1128,7 @@ LedgerManagerImpl::closeLedger(LedgerCloseData const& ledgerData)
     // apply any upgrades that were decided during consensus
     // this must be done after applying transactions as the txset
     // was validated before upgrades
+    bool appliedUpgrade = false;
     for (size_t i = 0; i < sv.upgrades.size(); i++)
     {
         LedgerUpgrade lupgrade;
@@ -953,7 +1167,7 @@ LedgerManagerImpl::closeLedger(LedgerCloseData const& ledgerData)
                 uem.changes = changes;
             }
             // Note: Index from 1 rather than 0 to match the behavior of
-            // storeTransaction and storeTransactionFee.
+            // TransactionHistoryBatch.
             if (mApp.getConfig().MODE_STORES_HISTORY_MISC)
             {
                 Upgrades::storeUpgradeHistory(getDatabase(), ledgerSeq,
@@ -961,6 +1175,8 @@ LedgerManagerImpl::closeLedger(LedgerCloseData const& ledgerData)
                                               static_cast<int>(i + 1));
             }
             ltxUpgrade.commit();
+            mApp.getInvariantManager().onUpgradeApply();
+            appliedUpgrade = true;
         }
         catch (std::runtime_error& e)
         {
@@ -973,12 +1189,21 @@ LedgerManagerImpl::closeLedger(LedgerCloseData const& ledgerData)
     }
     auto maybeNewVersion = ltx.loadHeader().current().ledgerVersion;
     auto ledgerSeq = ltx.loadHeader().current().ledgerSeq;
-    if (protocolVersionStartsFrom(maybeNewVersion, SOROBAN_PROTOCOL_VERSION))
+    // Only upgrades change the settings: the bucket list size window and the
+    // eviction iterator, which every ledger advances, are written from the
+    // loaded config and kept up to date in it. So the config stays as
+    // loaded, cost params encoded and all, until the next upgrade.
+    if (protocolVersionStartsFrom(maybeNewVersion, SOROBAN_PROTOCOL_VERSION) &&
+        (appliedUpgrade || !mSorobanNetworkConfig))
     {
         updateNetworkConfig(ltx);
     }
 
-    ledgerClosed(ltx, ledgerCloseMeta, initialLedgerVers);
+    {
+        FlightRecorder::Span span(recorder, "ledgerClosed", "ledger",
+                                  closingSeq);
+        ledgerClosed(ltx, ledgerCloseMeta, initialLedgerVers);
+    }
 
     if (ledgerData.getExpectedHash() &&
         *ledgerData.getExpectedHash() != mLastClosedLedger.hash)
@@ -986,7 +1211,7 @@ LedgerManagerImpl::closeLedger(LedgerCloseData const& ledgerData)
         throw std::runtime_error("Local node's ledger corrupted during close");
     }
 
-    if (mMetaStream || mMetaDebugStream)
+    if (isStreamingMeta())
     {
         releaseAssert(ledgerCloseMeta);
         ledgerCloseMeta->ledgerHeader() = mLastClosedLedger;
@@ -1011,7 +1236,9 @@ LedgerManagerImpl::closeLedger(LedgerCloseData const& ledgerData)
     //
     // 1. Queue any history-checkpoint to the database, _within_ the current
     //    transaction. This way if there's a crash after commit and before
-    //    we've published successfully, we'll re-publish on restart.
+    //    we've published successfully, we'll re-publish on restart. Before
+    //    that, the ledger is appended to the checkpoint's files, which
+    //    completes them if it is the checkpoint's last ledger.
     //
     // 2. Commit the current transaction.
     //
@@ -1025,28 +1252,54 @@ LedgerManagerImpl::closeLedger(LedgerCloseData const& ledgerData)
     //    bucket refcounts are incremented for the duration of the publish).
     //
     // 5. GC unreferenced buckets. Only do this once publishes are in progress.
+    //
+    // Steps 3 to 5 only need to happen before the next ledger closes, so
+    // with EXPERIMENTAL_PIPELINED_LEDGER_CLOSE they are queued, letting the
+    // herder move on to the next ledger first.
 
     // step 1
     auto& hm = mApp.getHistoryManager();
+    hm.appendLedgerToCheckpoint(mLastClosedLedger, *txSet, txs, txResultSet);
     hm.maybeQueueHistoryCheckpoint();
 
     // step 2
-    ltx.commit();
-
-    // step 3
-    if (protocolVersionStartsFrom(initialLedgerVers,
-                                  SOROBAN_PROTOCOL_VERSION) &&
-        mApp.getConfig().EXPERIMENTAL_BACKGROUND_EVICTION_SCAN)
     {
-        mApp.getBucketManager().startBackgroundEvictionScan(ledgerSeq + 1);
+        FlightRecorder::Span span(recorder, "commit", "ledger", closingSeq);
+        ltx.commit();
     }
 
-    // step 4
-    hm.publishQueuedHistory();
-    hm.logAndUpdatePublishStatus();
+    auto postCloseSteps = [this, initialLedgerVers, ledgerSeq]() {
+        ZoneNamedN(postCloseZone, "post-close steps", true);
+        FlightRecorder::Span span(mApp.getFlightRecorder(), "post-close steps",
+                                  "ledger", ledgerSeq);
+        // step 3
+        if (protocolVersionStartsFrom(initialLedgerVers,
+                                      SOROBAN_PROTOCOL_VERSION) &&
+            mApp.getConfig().EXPERIMENTAL_BACKGROUND_EVICTION_SCAN)
+        {
+            mApp.getBucketManager().startBackgroundEvictionScan(ledgerSeq + 1);
+        }
+
+        // step 4
+        auto& hm = mApp.getHistoryManager();
+        hm.publishQueuedHistory();
+        hm.logAndUpdatePublishStatus();
 
-    // step 5
-    mApp.getBucketManager().forgetUnreferencedBuckets();
+        // step 5
+        mApp.getBucketManager().forgetUnreferencedBuckets();
+    };
+
+    if (mApp.getConfig().EXPERIMENTAL_PIPELINED_LEDGER_CLOSE)
+    {
+        releaseAssert(!mPendingPostCloseSteps);
+        mPendingPostCloseSteps = postCloseSteps;
+        mApp.postOnMainThread([this]() { runPendingPostCloseSteps(); },
+                              "LedgerManager: post-close steps");
+    }
+    else
+    {
+        postCloseSteps();
+    }
 
     if (!mApp.getConfig().OP_APPLY_SLEEP_TIME_WEIGHT_FOR_TESTING.empty())
     {
@@ -1076,21 +1329,47 @@ LedgerManagerImpl::closeLedger(LedgerCloseData const& ledgerData)
 
     std::chrono::duration<double> ledgerTimeSeconds = ledgerTime.Stop();
     CLOG_DEBUG(Perf, "Applied ledger in {} seconds", ledgerTimeSeconds.count());
+    closeSpan.reset();
+    recorder.ledgerClosed(closingSeq,
+                          std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              ledgerTimeSeconds));
+    updateMemoryArenaMetrics(mApp.getMetrics());
     FrameMark;
 }
 
+void
+LedgerManagerImpl::runPendingPostCloseSteps()
+{
+    if (mPendingPostCloseSteps)
+    {
+        // Clear before running, so that the steps are not run twice if they
+        // close a ledger themselves
+        auto steps = std::move(mPendingPostCloseSteps);
+        mPendingPostCloseSteps = nullptr;
+        steps();
+    }
+}
+
 void
 LedgerManagerImpl::deleteOldEntries(Database& db, uint32_t ledgerSeq,
                                     uint32_t count)
 {
     ZoneScoped;
-    soci::transaction txscope(db.getSession());
     db.clearPreparedStatementCache();
-    LedgerHeaderUtils::deleteOldEntries(db, ledgerSeq, count);
-    deleteOldTransactionHistoryEntries(db, ledgerSeq, count);
-    HerderPersistence::deleteOldEntries(db, ledgerSeq, count);
-    Upgrades::deleteOldEntries(db, ledgerSeq, count);
+    deleteOldEntriesInSession(db.getSession(), ledgerSeq, count);
     db.clearPreparedStatementCache();
+}
+
+void
+LedgerManager::deleteOldEntriesInSession(soci::session& sess,
+                                         uint32_t ledgerSeq, uint32_t count)
+{
+    ZoneScoped;
+    soci::transaction txscope(sess);
+    LedgerHeaderUtils::deleteOldEntries(sess, ledgerSeq, count);
+    deleteOldTransactionHistoryEntries(sess, ledgerSeq, count);
+    HerderPersistence::deleteOldEntries(sess, ledgerSeq, count);
+    Upgrades::deleteOldEntries(sess, ledgerSeq, count);
     txscope.commit();
 }
 
@@ -1118,6 +1397,7 @@ LedgerManagerImpl::setLastClosedLedger(
     LedgerHeaderHistoryEntry const& lastClosed, bool storeInDB)
 {
     ZoneScoped;
+    runPendingPostCloseSteps();
     LedgerTxn ltx(mApp.getLedgerTxnRoot());
     auto header = ltx.loadHeader();
     header.current() = lastClosed.header;
@@ -1159,26 +1439,51 @@ LedgerManagerImpl::setupLedgerCloseMetaStream()
     auto& cfg = mApp.getConfig();
     if (cfg.METADATA_OUTPUT_STREAM != "")
     {
-        // We can't be sure we're writing to a stream that supports fsync;
-        // pipes typically error when you try. So we don't do it.
-        mMetaStream = std::make_unique<XDROutputFileStream>(
-            mApp.getClock().getIOContext(),
-            /*fsyncOnClose=*/false);
-        std::regex fdrx("^fd:([0-9]+)$");
-        std::smatch sm;
-        if (std::regex_match(cfg.METADATA_OUTPUT_STREAM, sm, fdrx))
-        {
-            int fd = std::stoi(sm[1]);
-            CLOG_INFO(Ledger, "Streaming metadata to file descriptor {}", fd);
-            mMetaStream->fdopen(fd);
-        }
-        else
+        mMetaStream = openMetaStream(cfg.METADATA_OUTPUT_STREAM);
+        if (cfg.EXPERIMENTAL_ASYNC_META_STREAM_MAX_LAG != 0)
         {
-            CLOG_INFO(Ledger, "Streaming metadata to '{}'",
-                      cfg.METADATA_OUTPUT_STREAM);
-            mMetaStream->open(cfg.METADATA_OUTPUT_STREAM);
+            CLOG_INFO(Ledger,
+                      "Writing metadata in the background, at most {} "
+                      "ledgers behind",
+                      cfg.EXPERIMENTAL_ASYNC_META_STREAM_MAX_LAG);
+            mMetaStreamWriter = std::make_unique<LedgerCloseMetaStreamWriter>(
+                *mMetaStream, cfg.EXPERIMENTAL_ASYNC_META_STREAM_MAX_LAG,
+                mApp.getMetrics());
         }
     }
+
+    for (auto const& fs : cfg.METADATA_FILTERED_OUTPUT_STREAMS)
+    {
+        // Build the filter first, so bad queries fail before anything opens
+        auto filter = std::make_unique<LedgerCloseMetaFilter>(fs.mEntryQuery,
+                                                              fs.mEventQuery);
+        mFilteredMetaStreams.push_back(
+            {openMetaStream(fs.mDestination), std::move(filter)});
+    }
+}
+
+std::unique_ptr<XDROutputFileStream>
+LedgerManagerImpl::openMetaStream(std::string const& destination)
+{
+    // We can't be sure we're writing to a stream that supports fsync;
+    // pipes typically error when you try. So we don't do it.
+    auto stream = std::make_unique<XDROutputFileStream>(
+        mApp.getClock().getIOContext(),
+        /*fsyncOnClose=*/false);
+    std::regex fdrx("^fd:([0-9]+)$");
+    std::smatch sm;
+    if (std::regex_match(destination, sm, fdrx))
+    {
+        int fd = std::stoi(sm[1]);
+        CLOG_INFO(Ledger, "Streaming metadata to file descriptor {}", fd);
+        stream->fdopen(fd);
+    }
+    else
+    {
+        CLOG_INFO(Ledger, "Streaming metadata to '{}'", destination);
+        stream->open(destination);
+    }
+    return stream;
 }
 void
 LedgerManagerImpl::maybeResetLedgerCloseMetaDebugStream(uint32_t ledgerSeq)
@@ -1220,6 +1525,7 @@ LedgerManagerImpl::maybeResetLedgerCloseMetaDebugStream(uint32_t ledgerSeq)
                 mApp.getWorkScheduler()
                     .scheduleWork<FlushAndRotateMetaDebugWork>(
                         mMetaDebugPath, std::move(mMetaDebugStream),
+                        std::move(mMetaDebugIndex),
                         mApp.getConfig().METADATA_DEBUG_LEDGERS);
             mMetaDebugPath.clear();
         }
@@ -1259,6 +1565,8 @@ LedgerManagerImpl::maybeResetLedgerCloseMetaDebugStream(uint32_t ledgerSeq)
                     // If we get to this line, the stream is open.
                     mMetaDebugStream = std::move(tmpStream);
                     mMetaDebugPath = metaDebugPath;
+                    mMetaDebugIndex.clear();
+                    mMetaDebugBytes = 0;
                 }
             }
             else
@@ -1352,6 +1660,7 @@ LedgerManagerImpl::processFeesSeqNums(
         auto header = ltx.loadHeader().current();
         auto ledgerSeq = header.ledgerSeq;
         std::map<AccountID, SequenceNumber> accToMaxSeq;
+        TransactionHistoryBatch history(ledgerSeq, mApp.getConfig());
 
         bool mergeSeen = false;
         for (auto tx : txs)
@@ -1378,12 +1687,6 @@ LedgerManagerImpl::processFeesSeqNums(
             }
 
             LedgerEntryChanges changes = ltxTx.getChanges();
-            if (ledgerCloseMeta)
-            {
-                ledgerCloseMeta->pushTxProcessingEntry();
-                ledgerCloseMeta->setLastTxProcessingFeeProcessingChanges(
-                    changes);
-            }
             // Note to future: when we eliminate the txhistory and txfeehistory
             // tables, the following step can be removed.
             //
@@ -1393,8 +1696,14 @@ LedgerManagerImpl::processFeesSeqNums(
             ++index;
             if (mApp.getConfig().MODE_STORES_HISTORY_MISC)
             {
-                storeTransactionFee(mApp.getDatabase(), ledgerSeq, tx, changes,
-                                    index);
+                history.addTransactionFee(tx, changes, index);
+            }
+            // The meta is the last consumer of changes, so it takes them
+            if (ledgerCloseMeta)
+            {
+                ledgerCloseMeta->pushTxProcessingEntry();
+                ledgerCloseMeta->setLastTxProcessingFeeProcessingChanges(
+                    std::move(changes));
             }
             ltxTx.commit();
         }
@@ -1427,6 +1736,7 @@ LedgerManagerImpl::processFeesSeqNums(
             }
         }
 
+        history.store(mApp.getDatabase());
         ltx.commit();
     }
     catch (std::exception& e)
@@ -1454,6 +1764,209 @@ LedgerManagerImpl::prefetchTxSourceIds(
     }
 }
 
+void
+LedgerManagerImpl::startLookaheadPrefetch(
+    std::shared_ptr<TxSetXDRFrame const> txSet)
+{
+    ZoneScoped;
+    releaseAssert(threadIsMain());
+    if (!mApp.getConfig().EXPERIMENTAL_LOOKAHEAD_PREFETCH || !txSet ||
+        mApp.getConfig().PREFETCH_BATCH_SIZE == 0)
+    {
+        return;
+    }
+
+    // The entries can only be read ahead of time if txSet will be applied on
+    // top of the current state
+    if (txSet->previousLedgerHash() != getLastClosedLedgerHeader().hash ||
+        mLookaheadTxSetHash == txSet->getContentsHash())
+    {
+        return;
+    }
+    mLookaheadTxSetHash = txSet->getContentsHash();
+
+    auto applicableTxSet = txSet->prepareForApply(mApp);
+    if (!applicableTxSet)
+    {
+        return;
+    }
+
+    UnorderedSet<LedgerKey> txKeys;
+    for (size_t i = 0; i < static_cast<size_t>(TxSetPhase::PHASE_COUNT); ++i)
+    {
+        for (auto const& tx :
+             applicableTxSet->getTxsForPhase(static_cast<TxSetPhase>(i)))
+        {
+            tx->insertKeysForFeeProcessing(txKeys);
+            tx->insertKeysForTxApply(txKeys);
+        }
+    }
+
+    // Offers are always loaded from SQL, even with BucketListDB
+    auto keys = std::make_shared<LedgerKeySet>();
+    for (auto const& key : txKeys)
+    {
+        if (key.type() != OFFER)
+        {
+            keys->emplace(key);
+        }
+    }
+    if (keys->empty())
+    {
+        return;
+    }
+
+    auto& snapshotManager = mApp.getBucketManager().getBucketSnapshotManager();
+    mApp.postOnBackgroundThread(
+        [this, &snapshotManager, keys]() {
+            auto start = std::chrono::steady_clock::now();
+            auto snapshot = snapshotManager.getSearchableBucketListSnapshot();
+            auto entries = std::make_shared<std::vector<LedgerEntry>>(
+                snapshot->loadKeys(*keys));
+            auto ledgerSeq = snapshot->getLedgerSeq();
+            auto loadTime = std::chrono::steady_clock::now() - start;
+            mApp.postOnMainThread(
+                [this, keys, entries, ledgerSeq, loadTime]() {
+                    finishLookaheadPrefetch(*keys, *entries, ledgerSeq,
+                                            loadTime);
+                },
+                "finishLookaheadPrefetch");
+        },
+        "lookaheadPrefetch",
+        WorkerPriority::CRITICAL);
+}
+
+void
+LedgerManagerImpl::startSpeculativeTxSetPreparation(
+    std::shared_ptr<TxSetXDRFrame const> txSet)
+{
+    ZoneScoped;
+    releaseAssert(threadIsMain());
+    if (!mApp.getConfig().EXPERIMENTAL_SPECULATIVE_TX_SET_PREPARATION ||
+        !txSet)
+    {
+        return;
+    }
+
+    auto const& lclHash = getLastClosedLedgerHeader().hash;
+    if (txSet->previousLedgerHash() != lclHash ||
+        (mSpeculativeTxSet &&
+         mSpeculativeTxSet->mContentsHash == txSet->getContentsHash() &&
+         mSpeculativeTxSet->mPreviousLedgerHash == lclHash))
+    {
+        return;
+    }
+
+    // A different tx set was prepared for the same ledger, balloting moved
+    // on from it
+    if (mSpeculativeTxSet && mSpeculativeTxSet->mPreviousLedgerHash == lclHash)
+    {
+        mSpeculativeTxSetMiss.Mark();
+    }
+    mSpeculativeTxSet.reset();
+
+    auto applicableTxSet = txSet->prepareForApply(mApp);
+    if (!applicableTxSet)
+    {
+        return;
+    }
+    mSpeculativeTxSet = SpeculativeTxSet{txSet->getContentsHash(), lclHash,
+                                         applicableTxSet};
+
+    // Signers are read on the main thread, as during apply, but the
+    // verification itself is left to the worker threads. The results only
+    // end up in the process-wide signature cache, so they are correct
+    // whichever tx set is externalized.
+    auto sigs = std::make_shared<std::vector<SignatureToVerify>>();
+    {
+        LedgerTxn ltx(mApp.getLedgerTxnRoot(), false,
+                      TransactionMode::READ_ONLY_WITHOUT_SQL_TXN);
+        for (size_t i = 0; i < static_cast<size_t>(TxSetPhase::PHASE_COUNT);
+             ++i)
+        {
+            for (auto const& tx :
+                 applicableTxSet->getTxsForPhase(static_cast<TxSetPhase>(i)))
+            {
+                tx->insertSignaturesToVerify(ltx, *sigs);
+            }
+        }
+    }
+
+    // Signatures point into the transactions of applicableTxSet, which the
+    // background jobs keep alive
+    size_t constexpr BATCH_SIZE = 64;
+    for (size_t i = 0; i < sigs->size(); i += BATCH_SIZE)
+    {
+        auto end = std::min(i + BATCH_SIZE, sigs->size());
+        mApp.postOnBackgroundThread(
+            [sigs, applicableTxSet, i, end]() {
+                PubKeyUtils::verifySigs(std::vector<SignatureToVerify>(
+                    sigs->begin() + i, sigs->begin() + end));
+            },
+            "speculativeVerifySignatures",
+            WorkerPriority::CRITICAL);
+    }
+    CLOG_DEBUG(Ledger, "Speculatively prepared tx set {} for ledger {}",
+               hexAbbrev(txSet->getContentsHash()),
+               getLastClosedLedgerNum() + 1);
+}
+
+std::optional<std::string>
+LedgerManagerImpl::getApplyTrace(std::optional<uint32_t> ledgerSeq) const
+{
+    for (auto it = mApplyTraces.rbegin(); it != mApplyTraces.rend(); ++it)
+    {
+        if (!ledgerSeq || (*it)->getLedgerSeq() == *ledgerSeq)
+        {
+            return (*it)->toChromeTrace();
+        }
+    }
+    return std::nullopt;
+}
+
+void
+LedgerManagerImpl::setApplyStatsCallback(ApplyStatsCallback cb)
+{
+    mApplyStatsCallback = std::move(cb);
+}
+
+ApplicableTxSetFrameConstPtr
+LedgerManagerImpl::prepareTxSetForApply(TxSetXDRFrame const& txSet)
+{
+    std::optional<SpeculativeTxSet> speculative;
+    std::swap(speculative, mSpeculativeTxSet);
+    if (speculative &&
+        speculative->mPreviousLedgerHash == txSet.previousLedgerHash())
+    {
+        if (speculative->mContentsHash == txSet.getContentsHash())
+        {
+            mSpeculativeTxSetHit.Mark();
+            return speculative->mTxSet;
+        }
+        mSpeculativeTxSetMiss.Mark();
+    }
+    return txSet.prepareForApply(mApp);
+}
+
+void
+LedgerManagerImpl::finishLookaheadPrefetch(
+    LedgerKeySet const& keys, std::vector<LedgerEntry> const& entries,
+    uint32_t ledgerSeq, std::chrono::nanoseconds loadTime)
+{
+    ZoneScoped;
+    mLookaheadPrefetch.Update(loadTime);
+    if (ledgerSeq != getLastClosedLedgerNum())
+    {
+        mLookaheadPrefetchStale.Mark();
+        return;
+    }
+
+    auto cached =
+        mApp.getLedgerTxnRoot().prefetchLoaded(keys, entries, ledgerSeq);
+    CLOG_DEBUG(Ledger, "Lookahead prefetch cached {} of {} keys for ledger {}",
+               cached, keys.size(), ledgerSeq + 1);
+}
+
 void
 LedgerManagerImpl::prefetchTransactionData(
     std::vector<TransactionFrameBasePtr> const& txs)
@@ -1470,6 +1983,100 @@ LedgerManagerImpl::prefetchTransactionData(
     }
 }
 
+void
+LedgerManagerImpl::verifyTxSignatures(
+    std::vector<TransactionFrameBasePtr> const& txs, AbstractLedgerTxn& ltx)
+{
+    ZoneScoped;
+    if (!mApp.getConfig().EXPERIMENTAL_PARALLEL_SIGNATURE_VERIFICATION)
+    {
+        return;
+    }
+    auto timer = mVerifySignatures.TimeScope();
+
+    struct Batches
+    {
+        static constexpr size_t BATCH_SIZE = 64;
+        std::vector<std::vector<SignatureToVerify>> mBatches;
+        size_t mNumBatches{0};
+        std::atomic<size_t> mNext{0};
+        std::atomic<size_t> mDone{0};
+        std::mutex mMutex;
+        std::condition_variable mCV;
+    };
+    auto batches = std::make_shared<Batches>();
+    std::vector<SignatureToVerify> sigs;
+    for (auto const& tx : txs)
+    {
+        tx->insertSignaturesToVerify(ltx, sigs);
+    }
+    auto const numSigs = sigs.size();
+    for (size_t i = 0; i < numSigs; i += Batches::BATCH_SIZE)
+    {
+        auto end = sigs.begin() + std::min(i + Batches::BATCH_SIZE, numSigs);
+        batches->mBatches.emplace_back(sigs.begin() + i, end);
+    }
+    batches->mNumBatches = batches->mBatches.size();
+    if (batches->mNumBatches == 0)
+    {
+        return;
+    }
+
+    // The main thread takes batches as well, so this finishes even if all
+    // the worker threads are busy with something else. Workers that only get
+    // to run once all batches are taken return right away, without touching
+    // txs.
+    auto verify = [batches]() {
+        size_t b;
+        while ((b = batches->mNext++) < batches->mNumBatches)
+        {
+            PubKeyUtils::verifySigs(batches->mBatches[b]);
+            if (++batches->mDone == batches->mNumBatches)
+            {
+                std::lock_guard<std::mutex> lock(batches->mMutex);
+                batches->mCV.notify_all();
+            }
+        }
+    };
+    auto numWorkers = std::min<size_t>(batches->mNumBatches - 1,
+                                       mApp.getConfig().WORKER_THREADS);
+    for (size_t i = 0; i < numWorkers; ++i)
+    {
+        mApp.postOnBackgroundThread(verify, "verifyTxSignatures",
+                                    WorkerPriority::CRITICAL);
+    }
+    verify();
+
+    std::unique_lock<std::mutex> lock(batches->mMutex);
+    batches->mCV.wait(lock, [&] {
+        return batches->mDone == batches->mNumBatches;
+    });
+    CLOG_DEBUG(Ledger, "Verified {} signatures ahead of apply", numSigs);
+}
+
+void
+LedgerManagerImpl::recordSorobanApplyClusters(
+    std::vector<TransactionFrameBasePtr> const& txs)
+{
+    ZoneScoped;
+    TxSetTransactions sorobanTxs;
+    std::copy_if(txs.begin(), txs.end(), std::back_inserter(sorobanTxs),
+                 [](auto const& tx) { return tx->isSoroban(); });
+    if (sorobanTxs.empty())
+    {
+        return;
+    }
+
+    auto clusters = TxSetUtils::buildSorobanApplyClusters(sorobanTxs);
+    size_t largest = 0;
+    for (auto const& cluster : clusters)
+    {
+        largest = std::max(largest, cluster.size());
+    }
+    mSorobanMetrics.mLedgerApplyClusters.Update(clusters.size());
+    mSorobanMetrics.mLedgerLargestApplyCluster.Update(largest);
+}
+
 void
 LedgerManagerImpl::applyTransactions(
     ApplicableTxSetFrame const& txSet,
@@ -1495,6 +2102,8 @@ LedgerManagerImpl::applyTransactions(
     }
 
     prefetchTransactionData(txs);
+    verifyTxSignatures(txs, ltx);
+    recordSorobanApplyClusters(txs);
 
     Hash sorobanBasePrngSeed = txSet.getContentsHash();
     uint64_t txNum{0};
@@ -1502,10 +2111,17 @@ LedgerManagerImpl::applyTransactions(
     uint64_t txFailed{0};
     uint64_t sorobanTxSucceeded{0};
     uint64_t sorobanTxFailed{0};
+    TransactionHistoryBatch history(ltx.loadHeader().current().ledgerSeq,
+                                    mApp.getConfig());
     for (auto tx : txs)
     {
         ZoneNamedN(txZone, "applyTransaction", true);
         auto txTime = mTransactionApply.TimeScope();
+        LedgerApplyTrace::Scope txScope("tx", "tx");
+        if (txScope.active())
+        {
+            txScope.setDetail(binToHex(tx->getContentsHash()));
+        }
         TransactionMetaFrame tm(ltx.loadHeader().current().ledgerVersion);
         CLOG_DEBUG(Tx, " tx#{} = {} ops={} txseq={} (@ {})", index,
                    hexAbbrev(tx->getContentsHash()), tx->getNumOperations(),
@@ -1525,9 +2141,15 @@ LedgerManagerImpl::applyTransactions(
 
         tx->apply(mApp, ltx, tm, subSeed);
         tx->processPostApply(mApp, ltx, tm);
-        TransactionResultPair results;
+
+        // The result pair is built once, in the TxResultSet that is hashed
+        // into the ledger header, and only read from there by the meta and
+        // the txhistory table
+        auto& results = txResultSet.results.emplace_back();
         results.transactionHash = tx->getContentsHash();
         results.result = tx->getResult();
+        txScope.setSuccess(results.result.result.code() ==
+                           TransactionResultCode::txSUCCESS);
         if (results.result.result.code() == TransactionResultCode::txSUCCESS)
         {
             if (tx->isSoroban())
@@ -1545,16 +2167,12 @@ LedgerManagerImpl::applyTransactions(
             ++txFailed;
         }
 
-        // First gather the TransactionResultPair into the TxResultSet for
-        // hashing into the ledger header.
-        txResultSet.results.emplace_back(results);
-
-        // Then potentially add that TRP and its associated TransactionMeta
-        // into the associated slot of any LedgerCloseMeta we're collecting.
+        // Potentially add that TRP and its associated TransactionMeta into
+        // the associated slot of any LedgerCloseMeta we're collecting.
         if (ledgerCloseMeta)
         {
             ledgerCloseMeta->setTxProcessingMetaAndResultPair(
-                tm.getXDR(), std::move(results), index);
+                tm.getXDR(), results, index);
         }
 
         // Then finally store the results and meta into the txhistory table.
@@ -1569,11 +2187,12 @@ LedgerManagerImpl::applyTransactions(
         ++index;
         if (mApp.getConfig().MODE_STORES_HISTORY_MISC)
         {
-            auto ledgerSeq = ltx.loadHeader().current().ledgerSeq;
-            storeTransaction(mApp.getDatabase(), ledgerSeq, tx, tm.getXDR(),
-                             txResultSet, mApp.getConfig());
+            history.addTransaction(
+                tx, tm.getXDR(), txResultSet.results.back(),
+                static_cast<uint32_t>(txResultSet.results.size()));
         }
     }
+    history.store(mApp.getDatabase());
 
     mTransactionApplySucceeded.inc(txSucceeded);
     mTransactionApplyFailed.inc(txFailed);
@@ -1625,6 +2244,12 @@ LedgerManagerImpl::storeCurrentLedger(LedgerHeader const& header,
     {
         LedgerHeaderUtils::storeInDatabase(mApp.getDatabase(), header);
     }
+    else if (mApp.getConfig().EXPERIMENTAL_METADATA_ONLY_MODE)
+    {
+        mApp.getPersistentState().setState(
+            PersistentState::kLastClosedLedgerHeader,
+            decoder::encode_b64(xdr::xdr_to_opaque(header)));
+    }
 }
 
 // NB: This is a separate method so a testing subclass can override it.
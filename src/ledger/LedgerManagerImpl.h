@@ -5,16 +5,24 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 #include "util/asio.h"
 
+#include "herder/TxSetFrame.h"
 #include "history/HistoryManager.h"
+#include "ledger/LedgerApplyTrace.h"
+#include "ledger/LedgerCloseMetaFilter.h"
 #include "ledger/LedgerCloseMetaFrame.h"
+#include "ledger/LedgerCloseMetaStreamWriter.h"
 #include "ledger/LedgerManager.h"
 #include "ledger/NetworkConfig.h"
 #include "ledger/SorobanMetrics.h"
 #include "main/PersistentState.h"
 #include "transactions/TransactionFrame.h"
+#include "transactions/TxValidityCache.h"
+#include "util/DebugMetaUtils.h"
 #include "util/XDRStream.h"
 #include "xdr/Stellar-ledger.h"
+#include <deque>
 #include <filesystem>
+#include <functional>
 #include <string>
 
 /*
@@ -45,18 +53,39 @@ class LedgerManagerImpl : public LedgerManager
     Application& mApp;
     std::unique_ptr<XDROutputFileStream> mMetaStream;
     std::unique_ptr<XDROutputFileStream> mMetaDebugStream;
+    // Writes to mMetaStream in the background when
+    // EXPERIMENTAL_ASYNC_META_STREAM_MAX_LAG is set. Declared after
+    // mMetaStream so that it is done writing before the stream is closed.
+    std::unique_ptr<LedgerCloseMetaStreamWriter> mMetaStreamWriter;
+    // One per METADATA_FILTERED_OUTPUT_STREAMS entry
+    struct FilteredMetaStream
+    {
+        std::unique_ptr<XDROutputFileStream> mStream;
+        std::unique_ptr<LedgerCloseMetaFilter> mFilter;
+    };
+    std::vector<FilteredMetaStream> mFilteredMetaStreams;
     std::weak_ptr<BasicWork> mFlushAndRotateMetaDebugWork;
     std::filesystem::path mMetaDebugPath;
+    // Where the meta of each ledger starts in mMetaDebugStream, handed to
+    // FlushAndRotateMetaDebugWork along with the stream
+    metautils::MetaDebugIndex mMetaDebugIndex;
+    uint64_t mMetaDebugBytes{0};
 
   private:
     LedgerHeaderHistoryEntry mLastClosedLedger;
     std::optional<SorobanNetworkConfig> mSorobanNetworkConfig;
 
     SorobanMetrics mSorobanMetrics;
+    TxValidityCache mTxValidityCache;
     medida::Timer& mTransactionApply;
+    medida::Timer& mVerifySignatures;
     medida::Histogram& mTransactionCount;
     medida::Histogram& mOperationCount;
     medida::Histogram& mPrefetchHitRate;
+    medida::Timer& mLookaheadPrefetch;
+    medida::Meter& mLookaheadPrefetchStale;
+    medida::Meter& mSpeculativeTxSetHit;
+    medida::Meter& mSpeculativeTxSetMiss;
     medida::Timer& mLedgerClose;
     medida::Buckets& mLedgerAgeClosed;
     medida::Counter& mLedgerAge;
@@ -66,6 +95,7 @@ class LedgerManagerImpl : public LedgerManager
     medida::Counter& mSorobanTransactionApplyFailed;
     medida::Meter& mMetaStreamBytes;
     medida::Timer& mMetaStreamWriteTime;
+    medida::Meter& mFilteredMetaStreamBytes;
     VirtualClock::time_point mLastClose;
     bool mRebuildInMemoryState{false};
 
@@ -73,6 +103,39 @@ class LedgerManagerImpl : public LedgerManager
     medida::Timer& mCatchupDuration;
 
     std::unique_ptr<LedgerCloseMetaFrame> mNextMetaToEmit;
+    // Encoding of the last meta emitted, kept to reuse its allocation
+    std::vector<char> mMetaBuffer;
+
+    // With EXPERIMENTAL_PIPELINED_LEDGER_CLOSE, the steps of closeLedger that
+    // follow the commit are queued on the main thread instead of being run
+    // before closeLedger returns. They are run when they come up in the
+    // queue, or by anything that needs them to be done first, like the next
+    // ledger close, whichever happens first.
+    std::function<void()> mPendingPostCloseSteps;
+
+    // Contents hash of the last tx set passed to a lookahead prefetch, so that
+    // repeated notifications for the same tx set only load it once
+    std::optional<Hash> mLookaheadTxSetHash;
+
+    // Tx set prepared by startSpeculativeTxSetPreparation for the ledger
+    // after the LCL, along with the contents hash of the frame it came from
+    struct SpeculativeTxSet
+    {
+        Hash mContentsHash;
+        Hash mPreviousLedgerHash;
+        ApplicableTxSetFrameConstPtr mTxSet;
+    };
+    std::optional<SpeculativeTxSet> mSpeculativeTxSet;
+
+    // Apply traces of the last APPLY_TRACE_LEDGERS ledgers, oldest first
+    std::deque<std::unique_ptr<LedgerApplyTrace>> mApplyTraces;
+
+    ApplyStatsCallback mApplyStatsCallback;
+
+    // Returns txSet prepared for apply, reusing the speculatively prepared
+    // one if it matches
+    ApplicableTxSetFrameConstPtr
+    prepareTxSetForApply(TxSetXDRFrame const& txSet);
 
     void processFeesSeqNums(
         std::vector<TransactionFrameBasePtr> const& txs,
@@ -94,15 +157,38 @@ class LedgerManagerImpl : public LedgerManager
                  uint32_t initialLedgerVers);
 
     void storeCurrentLedger(LedgerHeader const& header, bool storeHeader);
+    std::shared_ptr<LedgerHeader> loadLastClosedLedgerHeader(Hash const& hash);
     void
     prefetchTransactionData(std::vector<TransactionFrameBasePtr> const& txs);
     void prefetchTxSourceIds(std::vector<TransactionFrameBasePtr> const& txs);
+
+    // With EXPERIMENTAL_PARALLEL_SIGNATURE_VERIFICATION, verifies all
+    // signatures of txs that apply is going to check, and returns when done
+    void verifyTxSignatures(std::vector<TransactionFrameBasePtr> const& txs,
+                            AbstractLedgerTxn& ltx);
+
+    // Records how many independent clusters the Soroban transactions of a
+    // ledger fall into, see TxSetUtils::buildSorobanApplyClusters
+    void
+    recordSorobanApplyClusters(std::vector<TransactionFrameBasePtr> const& txs);
+
+    // Caches the result of a background load started by
+    // startLookaheadPrefetch, on the main thread
+    void finishLookaheadPrefetch(LedgerKeySet const& keys,
+                                 std::vector<LedgerEntry> const& entries,
+                                 uint32_t ledgerSeq,
+                                 std::chrono::nanoseconds loadTime);
+
     void closeLedgerIf(LedgerCloseData const& ledgerData);
 
     State mState;
     void setState(State s);
 
     void emitNextMeta();
+    void emitFilteredMeta();
+    bool isStreamingMeta() const;
+
+    void runPendingPostCloseSteps();
 
     SorobanNetworkConfig& getSorobanNetworkConfigInternal();
 
@@ -139,6 +225,13 @@ class LedgerManagerImpl : public LedgerManager
     std::string getStateHuman() const override;
 
     void valueExternalized(LedgerCloseData const& ledgerData) override;
+    void startLookaheadPrefetch(
+        std::shared_ptr<TxSetXDRFrame const> txSet) override;
+    void startSpeculativeTxSetPreparation(
+        std::shared_ptr<TxSetXDRFrame const> txSet) override;
+    std::optional<std::string>
+    getApplyTrace(std::optional<uint32_t> ledgerSeq) const override;
+    void setApplyStatsCallback(ApplyStatsCallback cb) override;
 
     uint32_t getLastMaxTxSetSize() const override;
     uint32_t getLastMaxTxSetSizeOps() const override;
@@ -150,6 +243,7 @@ class LedgerManagerImpl : public LedgerManager
     uint32_t getLastClosedLedgerNum() const override;
     SorobanNetworkConfig const& getSorobanNetworkConfig() override;
     bool hasSorobanNetworkConfig() const override;
+    TxValidityCache& getTxValidityCache() override;
 
 #ifdef BUILD_TESTS
     SorobanNetworkConfig& getMutableSorobanNetworkConfig() override;
@@ -188,6 +282,8 @@ class LedgerManagerImpl : public LedgerManager
     void manuallyAdvanceLedgerHeader(LedgerHeader const& header) override;
 
     void setupLedgerCloseMetaStream();
+    std::unique_ptr<XDROutputFileStream>
+    openMetaStream(std::string const& destination);
     void maybeResetLedgerCloseMetaDebugStream(uint32_t ledgerSeq);
 
     SorobanMetrics& getSorobanMetrics() override;
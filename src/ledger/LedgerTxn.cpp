@@ -18,13 +18,18 @@
 #include "ledger/NonSociRelatedException.h"
 #include "main/Application.h"
 #include "transactions/TransactionUtils.h"
+#include "util/Fs.h"
 #include "util/GlobalChecks.h"
+#include "util/Logging.h"
 #include "util/XDROperators.h"
 #include "util/XDRStream.h"
 #include "util/types.h"
 #include "xdr/Stellar-ledger-entries.h"
 #include "xdrpp/marshal.h"
 #include <Tracy.hpp>
+#include <medida/counter.h>
+#include <medida/meter.h>
+#include <medida/metrics_registry.h>
 #include <soci.h>
 
 namespace stellar
@@ -225,6 +230,18 @@ AbstractLedgerTxnParent::~AbstractLedgerTxnParent()
 {
 }
 
+uint32_t
+AbstractLedgerTxnParent::getNewestVersionEncodedSize(
+    InternalLedgerKey const& key) const
+{
+    auto entry = getNewestVersion(key);
+    if (!entry || entry->type() != InternalLedgerEntryType::LEDGER_ENTRY)
+    {
+        return 0;
+    }
+    return static_cast<uint32_t>(xdr::xdr_size(entry->ledgerEntry()));
+}
+
 // Implementation of EntryIterator --------------------------------------------
 EntryIterator::EntryIterator(std::unique_ptr<AbstractImpl>&& impl)
     : mImpl(std::move(impl))
@@ -287,6 +304,12 @@ EntryIterator::key() const
     return getImpl()->key();
 }
 
+size_t
+EntryIterator::keyHash() const
+{
+    return getImpl()->keyHash();
+}
+
 // Implementation of AbstractLedgerTxn --------------------------------------
 AbstractLedgerTxn::~AbstractLedgerTxn()
 {
@@ -468,8 +491,11 @@ LedgerTxn::Impl::commitChild(EntryIterator iter,
     {
         for (; (bool)iter; ++iter)
         {
-            updateEntry(iter.key(), /* keyHint */ nullptr, iter.entryPtr(),
-                        /* effectiveActive */ false);
+            // The child's entry map uses the same hasher as mEntry
+            auto hash = iter.keyHash();
+            auto keyHint = mEntry.find(iter.key(), hash);
+            updateEntry(iter.key(), &keyHint, iter.entryPtr(),
+                        /* effectiveActive */ false, hash);
         }
 
         // We will show that the following update procedure leaves the self
@@ -1362,15 +1388,27 @@ LedgerTxn::Impl::getAllEntries(std::vector<LedgerEntry>& initEntries,
     resLive.reserve(mEntry.size());
     resDead.reserve(mEntry.size());
     maybeUpdateLastModifiedThenInvokeThenSeal([&](EntryMap const& entries) {
+        // Sort references to the entries rather than the results, so that
+        // every entry is copied exactly once
+        std::vector<EntryMap::value_type const*> sorted;
+        sorted.reserve(entries.size());
         for (auto const& kv : entries)
         {
-            auto const& key = kv.first;
-            auto const& entry = kv.second;
-
-            if (key.type() != InternalLedgerEntryType::LEDGER_ENTRY)
+            if (kv.first.type() == InternalLedgerEntryType::LEDGER_ENTRY)
             {
-                continue;
+                sorted.emplace_back(&kv);
             }
+        }
+        std::sort(sorted.begin(), sorted.end(),
+                  [](auto const* lhs, auto const* rhs) {
+                      return LedgerEntryIdCmp{}(lhs->first.ledgerKey(),
+                                                rhs->first.ledgerKey());
+                  });
+
+        for (auto const* kv : sorted)
+        {
+            auto const& key = kv->first;
+            auto const& entry = kv->second;
 
             if (entry.get())
             {
@@ -1434,6 +1472,30 @@ LedgerTxn::Impl::getNewestVersion(InternalLedgerKey const& key) const
     return mParent.getNewestVersion(key);
 }
 
+uint32_t
+LedgerTxn::getNewestVersionEncodedSize(InternalLedgerKey const& key) const
+{
+    return getImpl()->getNewestVersionEncodedSize(key);
+}
+
+uint32_t
+LedgerTxn::Impl::getNewestVersionEncodedSize(InternalLedgerKey const& key) const
+{
+    // Entries this LedgerTxn holds may have been modified through their
+    // handles at any point, so only the root's sizes can be relied on
+    auto iter = mEntry.find(key);
+    if (iter != mEntry.end())
+    {
+        auto entry = iter->second.get();
+        if (!entry || entry->type() != InternalLedgerEntryType::LEDGER_ENTRY)
+        {
+            return 0;
+        }
+        return static_cast<uint32_t>(xdr::xdr_size(entry->ledgerEntry()));
+    }
+    return mParent.getNewestVersionEncodedSize(key);
+}
+
 std::pair<std::shared_ptr<InternalLedgerEntry const>,
           LedgerTxn::Impl::EntryMap::iterator>
 LedgerTxn::Impl::getNewestVersionEntryMap(InternalLedgerKey const& key)
@@ -1578,6 +1640,14 @@ LedgerTxn::Impl::load(LedgerTxn& self, InternalLedgerKey const& key)
     {
         currentEntryPtr = std::optional<LedgerEntryPtr>(newest.second->second);
     }
+    else if (newest.first.use_count() == 1)
+    {
+        // Nothing else refers to the newest version (LedgerTxnRoot returns a
+        // fresh copy of every entry it loads), so take it over rather than
+        // copying it again
+        currentEntryPtr = LedgerEntryPtr::Live(
+            std::const_pointer_cast<InternalLedgerEntry>(newest.first));
+    }
     else
     {
         currentEntryPtr = LedgerEntryPtr::Live(
@@ -2037,6 +2107,22 @@ LedgerTxn::Impl::prefetch(UnorderedSet<LedgerKey> const& keys)
     return mParent.prefetch(keys);
 }
 
+uint32_t
+LedgerTxn::prefetchLoaded(LedgerKeySet const& keys,
+                          std::vector<LedgerEntry> const& entries,
+                          uint32_t ledgerSeq)
+{
+    return getImpl()->prefetchLoaded(keys, entries, ledgerSeq);
+}
+
+uint32_t
+LedgerTxn::Impl::prefetchLoaded(LedgerKeySet const& keys,
+                                std::vector<LedgerEntry> const& entries,
+                                uint32_t ledgerSeq)
+{
+    return mParent.prefetchLoaded(keys, entries, ledgerSeq);
+}
+
 void
 LedgerTxn::Impl::maybeUpdateLastModified() noexcept
 {
@@ -2155,8 +2241,8 @@ LedgerTxn::Impl::updateEntryIfRecorded(InternalLedgerKey const& key,
 void
 LedgerTxn::Impl::updateEntry(InternalLedgerKey const& key,
                              EntryMap::iterator const* keyHint,
-                             LedgerEntryPtr lePtr,
-                             bool effectiveActive) noexcept
+                             LedgerEntryPtr lePtr, bool effectiveActive,
+                             std::optional<size_t> keyHash) noexcept
 {
     auto recordEntry = [&]() {
         // First, try to insert the entry. If the entry doesn't already exist,
@@ -2168,7 +2254,8 @@ LedgerTxn::Impl::updateEntry(InternalLedgerKey const& key,
         EntryMap::iterator localIterDoNotUse;
         if (!keyHint || *keyHint == mEntry.end())
         {
-            std::tie(localIterDoNotUse, inserted) = mEntry.emplace(key, lePtr);
+            std::tie(localIterDoNotUse, inserted) = mEntry.emplaceWithHash(
+                keyHash ? *keyHash : mEntry.hashKey(key), key, lePtr);
             keyHint = &localIterDoNotUse;
         }
 
@@ -2391,6 +2478,12 @@ LedgerTxn::Impl::EntryIteratorImpl::key() const
     return mIter->first;
 }
 
+size_t
+LedgerTxn::Impl::EntryIteratorImpl::keyHash() const
+{
+    return mIter.hash();
+}
+
 std::unique_ptr<EntryIterator::AbstractImpl>
 LedgerTxn::Impl::EntryIteratorImpl::clone() const
 {
@@ -2399,6 +2492,8 @@ LedgerTxn::Impl::EntryIteratorImpl::clone() const
 
 // Implementation of LedgerTxnRoot ------------------------------------------
 size_t const LedgerTxnRoot::Impl::MIN_BEST_OFFERS_BATCH_SIZE = 5;
+size_t const LedgerTxnRoot::Impl::MIN_ENTRY_CACHE_SHARD_SIZE = 8192;
+size_t const LedgerTxnRoot::Impl::MAX_ENTRY_CACHE_SHARDS = 16;
 
 LedgerTxnRoot::LedgerTxnRoot(Application& app, size_t entryCacheSize,
                              size_t prefetchBatchSize
@@ -2428,13 +2523,35 @@ LedgerTxnRoot::Impl::Impl(Application& app, size_t entryCacheSize,
                    getMaxOffersToCross()))
     , mApp(app)
     , mHeader(std::make_unique<LedgerHeader>())
-    , mEntryCache(entryCacheSize)
+    , mEntryCache(entryCacheSize,
+                  std::clamp<size_t>(entryCacheSize / MIN_ENTRY_CACHE_SHARD_SIZE,
+                                     1, MAX_ENTRY_CACHE_SHARDS))
+    , mEntryCacheRejects(app.getMetrics().NewMeter(
+          {"ledger", "entry-cache", "rejected"}, "entry"))
+    , mEntryCacheBytes(app.getMetrics().NewCounter(
+          {"ledger", "memory", "entry-cache-bytes"}))
+    , mKeepEntryCacheKeys(app.getConfig().PERSIST_ENTRY_CACHE_KEYS)
+    , mOffersInBucketListDB(app.getConfig().isUsingBucketListDBForType(OFFER))
+    , mUseInMemoryOrderBook(app.getConfig().EXPERIMENTAL_IN_MEMORY_ORDERBOOK ||
+                            mOffersInBucketListDB)
     , mBulkLoadBatchSize(prefetchBatchSize)
     , mChild(nullptr)
 #ifdef BEST_OFFER_DEBUGGING
     , mBestOfferDebuggingEnabled(bestOfferDebuggingEnabled)
 #endif
 {
+    auto& metrics = app.getMetrics();
+    for (auto let : xdr::xdr_traits<LedgerEntryType>::enum_values())
+    {
+        auto t = static_cast<LedgerEntryType>(let);
+        auto const& label = xdr::xdr_traits<LedgerEntryType>::enum_name(t);
+        mEntryCacheMetrics.emplace(
+            t, EntryCacheMetrics{
+                   metrics.NewMeter({"ledger", "entry-cache", "hit", label},
+                                    "entry"),
+                   metrics.NewMeter({"ledger", "entry-cache", "miss", label},
+                                    "entry")});
+    }
 }
 
 LedgerTxnRoot::~LedgerTxnRoot()
@@ -2455,6 +2572,7 @@ LedgerTxnRoot::Impl::resetForFuzzer()
 {
     mBestOffers.clear();
     mEntryCache.clear();
+    mInMemoryOrderBook.reset();
 }
 
 void
@@ -2478,7 +2596,7 @@ LedgerTxnRoot::Impl::addChild(AbstractLedgerTxn& child, TransactionMode mode)
         throw std::runtime_error("LedgerTxnRoot already has child");
     }
 
-    if (mode == TransactionMode::READ_WRITE_WITH_SQL_TXN)
+    if (mode != TransactionMode::READ_ONLY_WITHOUT_SQL_TXN)
     {
         mTransaction = std::make_unique<soci::transaction>(
             mApp.getDatabase().getSession());
@@ -2491,6 +2609,7 @@ LedgerTxnRoot::Impl::addChild(AbstractLedgerTxn& child, TransactionMode mode)
     }
 
     mChild = &child;
+    mChildIsBulkLoad = mode == TransactionMode::BULK_LOAD_WITH_SQL_TXN;
 }
 
 void
@@ -2509,6 +2628,83 @@ LedgerTxnRoot::commitChild(EntryIterator iter,
     mImpl->commitChild(std::move(iter), cons);
 }
 
+#ifdef USE_POSTGRES
+void
+upsertWithPGCopy(Database& db, PGconn* conn, std::string const& table,
+                 std::vector<std::string> const& columns, size_t numKeyColumns,
+                 std::string const& rows, size_t numRows,
+                 std::string const& entityName)
+{
+    releaseAssert(numKeyColumns > 0 && numKeyColumns <= columns.size());
+    std::string columnList, keyList, updateList;
+    for (size_t i = 0; i < columns.size(); ++i)
+    {
+        columnList += (i > 0 ? ", " : "") + columns[i];
+        if (i < numKeyColumns)
+        {
+            keyList += (i > 0 ? ", " : "") + columns[i];
+        }
+        else
+        {
+            updateList += (i > numKeyColumns ? ", " : "") + columns[i] +
+                          " = excluded." + columns[i];
+        }
+    }
+    auto staging = "staging_" + table;
+    auto& session = db.getSession();
+
+    auto timer = db.getUpsertTimer(entityName);
+    // Temporary tables are private to the connection, and the staging table
+    // is emptied after every use so it can stay around for the next one
+    session << "CREATE TEMPORARY TABLE IF NOT EXISTS " << staging << " (LIKE "
+            << table << ")";
+
+    auto copySql = "COPY " + staging + " (" + columnList + ") FROM STDIN";
+    PGresult* res = PQexec(conn, copySql.c_str());
+    bool started = PQresultStatus(res) == PGRES_COPY_IN;
+    PQclear(res);
+    if (!started)
+    {
+        throw std::runtime_error("Could not start COPY into " + staging +
+                                 ": " + PQerrorMessage(conn));
+    }
+    // Sent in chunks, as a batch of large entries can be more than an int
+    size_t const CHUNK_SIZE = 1 << 20;
+    bool sent = true;
+    for (size_t pos = 0; sent && pos < rows.size(); pos += CHUNK_SIZE)
+    {
+        auto n = std::min(CHUNK_SIZE, rows.size() - pos);
+        sent = PQputCopyData(conn, rows.data() + pos, static_cast<int>(n)) == 1;
+    }
+    sent = PQputCopyEnd(conn, sent ? nullptr : "send failed") == 1 && sent;
+    bool copied = true;
+    while ((res = PQgetResult(conn)) != nullptr)
+    {
+        copied = copied && PQresultStatus(res) == PGRES_COMMAND_OK;
+        PQclear(res);
+    }
+    if (!sent || !copied)
+    {
+        throw std::runtime_error("Could not COPY into " + staging + ": " +
+                                 PQerrorMessage(conn));
+    }
+
+    std::string sql = "INSERT INTO " + table + " (" + columnList +
+                      ") SELECT " + columnList + " FROM " + staging +
+                      " ON CONFLICT (" + keyList + ") DO " +
+                      (updateList.empty() ? "NOTHING"
+                                          : "UPDATE SET " + updateList);
+    soci::statement st = (session.prepare << sql);
+    st.execute(true);
+    auto affected = static_cast<size_t>(st.get_affected_rows());
+    session << "TRUNCATE " << staging;
+    if (affected != numRows)
+    {
+        throw std::runtime_error("Could not update data in SQL");
+    }
+}
+#endif
+
 static void
 accum(EntryIterator const& iter, std::vector<EntryIterator>& upsertBuffer,
       std::vector<EntryIterator>& deleteBuffer)
@@ -2522,7 +2718,7 @@ accum(EntryIterator const& iter, std::vector<EntryIterator>& upsertBuffer,
 // Return true only if something is actually accumulated and not skipped over
 bool
 BulkLedgerEntryChangeAccumulator::accumulate(EntryIterator const& iter,
-                                             bool bucketListDBEnabled)
+                                             Config const& cfg)
 {
     // Right now, only LEDGER_ENTRY are recorded in the SQL database
     if (iter.key().type() != InternalLedgerEntryType::LEDGER_ENTRY)
@@ -2533,7 +2729,7 @@ BulkLedgerEntryChangeAccumulator::accumulate(EntryIterator const& iter,
     // Don't accumulate entry types that are supported by BucketListDB when it
     // is enabled
     auto type = iter.key().ledgerKey().type();
-    if (bucketListDBEnabled && !BucketIndex::typeNotSupported(type))
+    if (cfg.isUsingBucketListDBForType(type))
     {
         return false;
     }
@@ -2725,14 +2921,30 @@ LedgerTxnRoot::Impl::commitChild(EntryIterator iter,
     // guarantee, so use std::unique_ptr<...>::swap to achieve it
     auto childHeader = std::make_unique<LedgerHeader>(mChild->getHeader());
 
-    auto bucketListDBEnabled = mApp.getConfig().isUsingBucketListDB();
+    auto const& cfg = mApp.getConfig();
     auto bleca = BulkLedgerEntryChangeAccumulator();
     [[maybe_unused]] int64_t counter{0};
+
+    // Offer changes to apply to the in-memory order book once the database
+    // commit has succeeded, as offer ID and the new entry (null if erased)
+    std::vector<std::pair<int64_t, std::shared_ptr<LedgerEntry const>>>
+        offerChanges;
     try
     {
         while ((bool)iter)
         {
-            if (bleca.accumulate(iter, bucketListDBEnabled))
+            if (mInMemoryOrderBook &&
+                iter.key().type() == InternalLedgerEntryType::LEDGER_ENTRY &&
+                iter.key().ledgerKey().type() == OFFER)
+            {
+                offerChanges.emplace_back(
+                    iter.key().ledgerKey().offer().offerID,
+                    iter.entryExists() ? std::make_shared<LedgerEntry const>(
+                                             iter.entry().ledgerEntry())
+                                       : nullptr);
+            }
+
+            if (bleca.accumulate(iter, cfg))
             {
                 ++counter;
             }
@@ -2765,16 +2977,60 @@ LedgerTxnRoot::Impl::commitChild(EntryIterator iter,
             "unknown fatal error during commit to LedgerTxnRoot");
     }
 
+    // The cache is at its largest right before commits clear it
+    mEntryCacheBytes.set_count(
+        static_cast<int64_t>(getEntryCacheMemoryUsage()));
+    if (mKeepEntryCacheKeys)
+    {
+        try
+        {
+            mLastEntryCacheKeys.clear();
+            mEntryCache.forEachKey([&](InternalLedgerKey const& key) {
+                if (key.type() == InternalLedgerEntryType::LEDGER_ENTRY)
+                {
+                    mLastEntryCacheKeys.emplace_back(key.ledgerKey());
+                }
+            });
+        }
+        catch (...)
+        {
+            // The keys are only a hint for the next start
+            mLastEntryCacheKeys.clear();
+        }
+    }
+
     // Clearing the cache does not throw
     mBestOffers.clear();
     mEntryCache.clear();
 
+    // If the order book can not be updated it is dropped, and loaded from the
+    // database again the next time it is needed
+    if (mInMemoryOrderBook)
+    {
+        try
+        {
+            for (auto const& [offerID, le] : offerChanges)
+            {
+                mInMemoryOrderBook->erase(offerID);
+                if (le)
+                {
+                    mInMemoryOrderBook->insert(le);
+                }
+            }
+        }
+        catch (...)
+        {
+            mInMemoryOrderBook.reset();
+        }
+    }
+
     // std::unique_ptr<...>::reset does not throw
     mTransaction.reset();
 
     // std::unique_ptr<...>::swap does not throw
     mHeader.swap(childHeader);
     mChild = nullptr;
+    mChildIsBulkLoad = false;
 
     mPrefetchHits = 0;
     mPrefetchMisses = 0;
@@ -2867,6 +3123,7 @@ LedgerTxnRoot::Impl::deleteObjectsModifiedOnOrAfterLedger(uint32_t ledger) const
     throwIfChild();
     mEntryCache.clear();
     mBestOffers.clear();
+    mInMemoryOrderBook.reset();
 
     for (auto let : xdr::xdr_traits<LedgerEntryType>::enum_values())
     {
@@ -3092,6 +3349,37 @@ LedgerTxnRoot::Impl::prefetch(UnorderedSet<LedgerKey> const& keys)
     return total;
 }
 
+uint32_t
+LedgerTxnRoot::prefetchLoaded(LedgerKeySet const& keys,
+                              std::vector<LedgerEntry> const& entries,
+                              uint32_t ledgerSeq)
+{
+    return mImpl->prefetchLoaded(keys, entries, ledgerSeq);
+}
+
+uint32_t
+LedgerTxnRoot::Impl::prefetchLoaded(LedgerKeySet const& keys,
+                                    std::vector<LedgerEntry> const& entries,
+                                    uint32_t ledgerSeq)
+{
+    ZoneScoped;
+    if (ledgerSeq != mHeader->ledgerSeq)
+    {
+        return 0;
+    }
+
+    uint32_t total = 0;
+    for (auto const& item : populateLoadedEntries(keys, entries))
+    {
+        if (!mEntryCache.exists(item.first, false))
+        {
+            putInEntryCache(item.first, item.second, LoadType::PREFETCH);
+            ++total;
+        }
+    }
+    return total;
+}
+
 double
 LedgerTxnRoot::getPrefetchHitRate() const
 {
@@ -3109,6 +3397,76 @@ LedgerTxnRoot::Impl::getPrefetchHitRate() const
            (mPrefetchMisses + mPrefetchHits);
 }
 
+void
+LedgerTxnRoot::saveEntryCacheKeys(std::filesystem::path const& path) const
+{
+    mImpl->saveEntryCacheKeys(path);
+}
+
+void
+LedgerTxnRoot::Impl::saveEntryCacheKeys(std::filesystem::path const& path) const
+{
+    ZoneScoped;
+    releaseAssert(mKeepEntryCacheKeys);
+    auto tmpPath = path;
+    tmpPath += ".tmp";
+    {
+        XDROutputFileStream out(mApp.getClock().getIOContext(),
+                                /*fsyncOnClose=*/false);
+        out.open(tmpPath.string());
+        for (auto const& key : mLastEntryCacheKeys)
+        {
+            out.writeOne(key);
+        }
+    }
+    std::filesystem::rename(tmpPath, path);
+    CLOG_INFO(Ledger, "Saved {} entry cache keys to {}",
+              mLastEntryCacheKeys.size(), path);
+}
+
+uint32_t
+LedgerTxnRoot::warmEntryCache(std::filesystem::path const& path)
+{
+    return mImpl->warmEntryCache(path);
+}
+
+uint32_t
+LedgerTxnRoot::Impl::warmEntryCache(std::filesystem::path const& path)
+{
+    ZoneScoped;
+    throwIfChild();
+    if (!fs::exists(path.string()))
+    {
+        return 0;
+    }
+
+    UnorderedSet<LedgerKey> keys;
+    try
+    {
+        XDRInputFileStream in;
+        in.open(path.string());
+        LedgerKey key;
+        while (keys.size() < mEntryCache.maxSize() && in.readOne(key))
+        {
+            keys.emplace(key);
+        }
+    }
+    catch (std::exception& e)
+    {
+        // Like any prefetch this is only advisory, so a damaged file only
+        // leaves the cache cold
+        CLOG_WARNING(Ledger, "Ignoring entry cache keys in {}: {}", path,
+                     e.what());
+        keys.clear();
+    }
+    std::filesystem::remove(path);
+
+    auto res = prefetch(keys);
+    CLOG_INFO(Ledger, "Warmed entry cache with {} of {} saved keys", res,
+              keys.size());
+    return res;
+}
+
 void
 LedgerTxnRoot::prepareNewObjects(size_t s)
 {
@@ -3132,7 +3490,20 @@ LedgerTxnRoot::Impl::getAllOffers()
     std::vector<LedgerEntry> offers;
     try
     {
-        offers = loadAllOffers();
+        if (mOffersInBucketListDB)
+        {
+            for (auto const& seller : getInMemoryOrderBook().mOffersBySeller)
+            {
+                for (auto const& offer : seller.second)
+                {
+                    offers.emplace_back(*offer.second);
+                }
+            }
+        }
+        else
+        {
+            offers = loadAllOffers();
+        }
     }
     catch (std::exception& e)
     {
@@ -3309,6 +3680,20 @@ LedgerTxnRoot::Impl::loadNextBestOffersIntoCache(BestOffersEntryPtr cached,
     return iter;
 }
 
+static void
+insertSellerKeys(OfferEntry const& oe, UnorderedSet<LedgerKey>& keys)
+{
+    keys.emplace(accountKey(oe.sellerID));
+    if (oe.buying.type() != ASSET_TYPE_NATIVE)
+    {
+        keys.emplace(trustlineKey(oe.sellerID, oe.buying));
+    }
+    if (oe.selling.type() != ASSET_TYPE_NATIVE)
+    {
+        keys.emplace(trustlineKey(oe.sellerID, oe.selling));
+    }
+}
+
 void
 LedgerTxnRoot::Impl::populateEntryCacheFromBestOffers(
     std::deque<LedgerEntry>::const_iterator iter,
@@ -3317,16 +3702,7 @@ LedgerTxnRoot::Impl::populateEntryCacheFromBestOffers(
     UnorderedSet<LedgerKey> toPrefetch;
     for (; iter != end; ++iter)
     {
-        auto const& oe = iter->data.offer();
-        toPrefetch.emplace(accountKey(oe.sellerID));
-        if (oe.buying.type() != ASSET_TYPE_NATIVE)
-        {
-            toPrefetch.emplace(trustlineKey(oe.sellerID, oe.buying));
-        }
-        if (oe.selling.type() != ASSET_TYPE_NATIVE)
-        {
-            toPrefetch.emplace(trustlineKey(oe.sellerID, oe.selling));
-        }
+        insertSellerKeys(iter->data.offer(), toPrefetch);
     }
     prefetch(toPrefetch);
 }
@@ -3370,12 +3746,146 @@ LedgerTxnRoot::Impl::getSearchableBucketListSnapshot() const
     return *mSearchableBucketListSnapshot;
 }
 
+void
+LedgerTxnRoot::Impl::InMemoryOrderBook::insert(
+    std::shared_ptr<LedgerEntry const> const& le)
+{
+    auto const& oe = le->data.offer();
+    AssetPair assets{oe.buying, oe.selling};
+    OfferDescriptor desc{oe.price, oe.offerID};
+    auto [_, inserted] =
+        mOfferLocations.emplace(oe.offerID, std::make_pair(assets, desc));
+    releaseAssert(inserted);
+    try
+    {
+        mOffers[assets].emplace(desc, le);
+        mOffersBySeller[oe.sellerID].emplace(oe.offerID, le);
+    }
+    catch (...)
+    {
+        erase(oe.offerID);
+        throw;
+    }
+}
+
+void
+LedgerTxnRoot::Impl::InMemoryOrderBook::erase(int64_t offerID)
+{
+    auto loc = mOfferLocations.find(offerID);
+    if (loc == mOfferLocations.end())
+    {
+        return;
+    }
+
+    auto const& [assets, desc] = loc->second;
+    auto offers = mOffers.find(assets);
+    if (offers != mOffers.end())
+    {
+        auto offer = offers->second.find(desc);
+        if (offer != offers->second.end())
+        {
+            auto bySeller =
+                mOffersBySeller.find(offer->second->data.offer().sellerID);
+            if (bySeller != mOffersBySeller.end())
+            {
+                bySeller->second.erase(offerID);
+                if (bySeller->second.empty())
+                {
+                    mOffersBySeller.erase(bySeller);
+                }
+            }
+            offers->second.erase(offer);
+        }
+        if (offers->second.empty())
+        {
+            mOffers.erase(offers);
+        }
+    }
+    mOfferLocations.erase(loc);
+}
+
+LedgerTxnRoot::Impl::InMemoryOrderBook&
+LedgerTxnRoot::Impl::getInMemoryOrderBook()
+{
+    if (!mInMemoryOrderBook)
+    {
+        ZoneNamedN(loadZone, "load in-memory order book", true);
+        auto orderBook = std::make_unique<InMemoryOrderBook>();
+        try
+        {
+            auto offers =
+                mOffersInBucketListDB
+                    ? getSearchableBucketListSnapshot().loadAllOffers()
+                    : loadAllOffers();
+            for (auto const& le : offers)
+            {
+                orderBook->insert(std::make_shared<LedgerEntry const>(le));
+            }
+        }
+        catch (std::exception& e)
+        {
+            printErrorAndAbort(
+                "fatal error when loading order book from LedgerTxnRoot: ",
+                e.what());
+        }
+        catch (...)
+        {
+            printErrorAndAbort("unknown fatal error when loading order book "
+                               "from LedgerTxnRoot");
+        }
+        mInMemoryOrderBook = std::move(orderBook);
+    }
+    return *mInMemoryOrderBook;
+}
+
+std::shared_ptr<LedgerEntry const>
+LedgerTxnRoot::Impl::getBestOfferFromInMemoryOrderBook(
+    Asset const& buying, Asset const& selling,
+    OfferDescriptor const* worseThan)
+{
+    auto& orderBook = getInMemoryOrderBook();
+    auto offersIter = orderBook.mOffers.find(AssetPair{buying, selling});
+    if (offersIter == orderBook.mOffers.end())
+    {
+        return nullptr;
+    }
+
+    auto const& offers = offersIter->second;
+    auto iter = worseThan ? offers.upper_bound(*worseThan) : offers.begin();
+    if (iter == offers.end())
+    {
+        return nullptr;
+    }
+
+    // As with offers loaded from the database, load the accounts and trust
+    // lines for this offer and the ones after it in one batch
+    auto const& le = iter->second;
+    if (areEntriesMissingInCacheForOffer(le->data.offer()))
+    {
+        UnorderedSet<LedgerKey> toPrefetch;
+        for (size_t i = 0; i < mMaxBestOffersBatchSize && iter != offers.end();
+             ++i, ++iter)
+        {
+            insertSellerKeys(iter->second->data.offer(), toPrefetch);
+        }
+        prefetch(toPrefetch);
+    }
+
+    putInEntryCache(LedgerEntryKey(*le), le, LoadType::IMMEDIATE);
+    return le;
+}
+
 std::shared_ptr<LedgerEntry const>
 LedgerTxnRoot::Impl::getBestOffer(Asset const& buying, Asset const& selling,
                                   OfferDescriptor const* worseThan)
 {
     ZoneScoped;
 
+    if (mUseInMemoryOrderBook)
+    {
+        return getBestOfferFromInMemoryOrderBook(buying, selling, worseThan);
+    }
+
     // Note: Elements of mBestOffers are properly sorted lists of the best
     // offers for a certain asset pair. This function maintaints the invariant
     // that the lists of best offers remain properly sorted. The sort order is
@@ -3449,7 +3959,26 @@ LedgerTxnRoot::Impl::getOffersByAccountAndAsset(AccountID const& account,
     std::vector<LedgerEntry> offers;
     try
     {
-        offers = loadOffersByAccountAndAsset(account, asset);
+        if (mOffersInBucketListDB)
+        {
+            auto const& bySeller = getInMemoryOrderBook().mOffersBySeller;
+            auto iter = bySeller.find(account);
+            if (iter != bySeller.end())
+            {
+                for (auto const& [_, le] : iter->second)
+                {
+                    auto const& oe = le->data.offer();
+                    if (oe.buying == asset || oe.selling == asset)
+                    {
+                        offers.emplace_back(*le);
+                    }
+                }
+            }
+        }
+        else
+        {
+            offers = loadOffersByAccountAndAsset(account, asset);
+        }
     }
     catch (std::exception& e)
     {
@@ -3607,23 +4136,26 @@ LedgerTxnRoot::Impl::getNewestVersion(InternalLedgerKey const& gkey) const
     }
     auto const& key = gkey.ledgerKey();
 
-    if (mEntryCache.exists(key))
+    auto& cacheMetrics = mEntryCacheMetrics.at(key.type());
+    if (mEntryCache.exists(gkey))
     {
         std::string zoneTxt("hit");
         ZoneText(zoneTxt.c_str(), zoneTxt.size());
-        return getFromEntryCache(key);
+        cacheMetrics.mHits.Mark();
+        return getFromEntryCache(gkey);
     }
     else
     {
         std::string zoneTxt("miss");
         ZoneText(zoneTxt.c_str(), zoneTxt.size());
+        cacheMetrics.mMisses.Mark();
         ++mPrefetchMisses;
     }
 
     std::shared_ptr<LedgerEntry const> entry;
     try
     {
-        if (mApp.getConfig().isUsingBucketListDB() && key.type() != OFFER)
+        if (mApp.getConfig().isUsingBucketListDBForType(key.type()))
         {
             entry = getSearchableBucketListSnapshot().getLedgerEntry(key);
         }
@@ -3682,10 +4214,11 @@ LedgerTxnRoot::Impl::getNewestVersion(InternalLedgerKey const& gkey) const
                            "LedgerTxnRoot");
     }
 
-    putInEntryCache(key, entry, LoadType::IMMEDIATE);
+    putInEntryCache(gkey, entry, LoadType::IMMEDIATE);
     if (entry)
     {
-        return std::make_shared<InternalLedgerEntry const>(*entry);
+        // Not created const, see AbstractLedgerTxnParent::getNewestVersion
+        return std::make_shared<InternalLedgerEntry>(*entry);
     }
     else
     {
@@ -3723,12 +4256,45 @@ LedgerTxnRoot::Impl::rollbackChild() noexcept
     }
 
     mChild = nullptr;
+    mChildIsBulkLoad = false;
     mPrefetchHits = 0;
     mPrefetchMisses = 0;
 }
 
+uint32_t
+LedgerTxnRoot::getNewestVersionEncodedSize(InternalLedgerKey const& key) const
+{
+    return mImpl->getNewestVersionEncodedSize(key);
+}
+
+uint32_t
+LedgerTxnRoot::Impl::getNewestVersionEncodedSize(
+    InternalLedgerKey const& gkey) const
+{
+    ZoneScoped;
+    if (gkey.type() != InternalLedgerEntryType::LEDGER_ENTRY)
+    {
+        return 0;
+    }
+
+    if (auto cached = mEntryCache.maybeGet(gkey))
+    {
+        return cached->size;
+    }
+
+    // Loading the entry puts it in the cache, along with its size, unless the
+    // cache rejects it
+    auto entry = getNewestVersion(gkey);
+    if (auto cached = mEntryCache.maybeGet(gkey))
+    {
+        return cached->size;
+    }
+    return entry ? static_cast<uint32_t>(xdr::xdr_size(entry->ledgerEntry()))
+                 : 0;
+}
+
 std::shared_ptr<InternalLedgerEntry const>
-LedgerTxnRoot::Impl::getFromEntryCache(LedgerKey const& key) const
+LedgerTxnRoot::Impl::getFromEntryCache(InternalLedgerKey const& key) const
 {
     try
     {
@@ -3740,7 +4306,7 @@ LedgerTxnRoot::Impl::getFromEntryCache(LedgerKey const& key) const
 
         if (cached.entry)
         {
-            return std::make_shared<InternalLedgerEntry const>(*cached.entry);
+            return std::make_shared<InternalLedgerEntry>(*cached.entry);
         }
         else
         {
@@ -3754,14 +4320,36 @@ LedgerTxnRoot::Impl::getFromEntryCache(LedgerKey const& key) const
     }
 }
 
+size_t
+LedgerTxnRoot::Impl::getEntryCacheMemoryUsage() const
+{
+    // Per entry, besides the LedgerEntry itself: the key, the cache value
+    // and the shared_ptr control block
+    size_t const overhead = sizeof(InternalLedgerKey) + sizeof(CacheEntry) +
+                            2 * sizeof(void*);
+    size_t const entrySize =
+        mEntryCachePuts == 0 ? 0 : mEntryCachePutBytes / mEntryCachePuts;
+    return mEntryCache.size() * (overhead + entrySize);
+}
+
 void
 LedgerTxnRoot::Impl::putInEntryCache(
-    LedgerKey const& key, std::shared_ptr<LedgerEntry const> const& entry,
-    LoadType type) const
+    InternalLedgerKey const& key,
+    std::shared_ptr<LedgerEntry const> const& entry, LoadType type) const
 {
     try
     {
-        mEntryCache.put(key, {entry, type});
+        uint32_t size =
+            entry ? static_cast<uint32_t>(xdr::xdr_size(*entry)) : 0;
+        if (!mEntryCache.put(key, {entry, type, size}))
+        {
+            mEntryCacheRejects.Mark();
+        }
+        else if (entry)
+        {
+            ++mEntryCachePuts;
+            mEntryCachePutBytes += size;
+        }
     }
     catch (...)
     {
@@ -11,6 +11,7 @@
 #include "util/UnorderedSet.h"
 #include "util/types.h"
 #include "xdr/Stellar-ledger.h"
+#include <filesystem>
 #include <functional>
 #include <ledger/LedgerHashUtils.h>
 #include <map>
@@ -262,10 +263,15 @@ enum class LedgerTxnConsistency
     EXTRA_DELETES
 };
 
+// BULK_LOAD_WITH_SQL_TXN is READ_WRITE_WITH_SQL_TXN for a child of
+// LedgerTxnRoot that writes many entries at once, such as a batch of bucket
+// entries being applied. On PostgreSQL, its upserts are streamed with COPY
+// into a staging table and merged into the ledger tables from there.
 enum class TransactionMode
 {
     READ_ONLY_WITHOUT_SQL_TXN,
-    READ_WRITE_WITH_SQL_TXN
+    READ_WRITE_WITH_SQL_TXN,
+    BULK_LOAD_WITH_SQL_TXN
 };
 
 class Application;
@@ -363,6 +369,10 @@ class EntryIterator
     bool entryExists() const;
 
     InternalLedgerKey const& key() const;
+
+    // The hash of key() in the map this iterator comes from, which can be
+    // passed to LedgerTxn entry maps to avoid hashing the key again
+    size_t keyHash() const;
 };
 
 void validateTrustLineKey(uint32_t ledgerVersion, LedgerKey const& key);
@@ -433,9 +443,20 @@ class AbstractLedgerTxnParent
     // version stored in this AbstractLedgerTxnParent, and if not recursively
     // invoking getNewestVersion on its parent. Returns nullptr if the key does
     // not exist or if the corresponding LedgerEntry has been erased.
+    // Implementations must not return an entry that was created const: if the
+    // caller holds the only reference to the result, it may take ownership of
+    // the entry and modify it instead of copying it.
     virtual std::shared_ptr<InternalLedgerEntry const>
     getNewestVersion(InternalLedgerKey const& key) const = 0;
 
+    // Encoded XDR size of the LedgerEntry getNewestVersion would return, or 0
+    // if there is none. Unlike loading the entry, this doesn't copy it, and
+    // LedgerTxnRoot answers from the size it recorded when it loaded an entry
+    // into its cache, so Soroban resource accounting doesn't re-encode large
+    // entries. The default encodes the newest version.
+    virtual uint32_t
+    getNewestVersionEncodedSize(InternalLedgerKey const& key) const;
+
     // Return the count of the number of ledger objects of type `let`. Will
     // throw when called on anything other than a (real or stub) root LedgerTxn.
     virtual uint64_t countObjects(LedgerEntryType let) const = 0;
@@ -502,6 +523,17 @@ class AbstractLedgerTxnParent
     // than a (real or stub) root LedgerTxn.
     virtual uint32_t prefetch(UnorderedSet<LedgerKey> const& keys) = 0;
 
+    // Add entries that were loaded for keys from a BucketList snapshot of
+    // ledgerSeq, for example by a background thread, to the prefetch cache.
+    // Keys that are not in entries are cached as not existing. Nothing is
+    // cached unless ledgerSeq is the ledger of the root, so results that were
+    // overtaken by a ledger close are dropped. Returns the number of keys
+    // added. Like prefetch, this is purely advisory. Will throw when called on
+    // anything other than a (real or stub) root LedgerTxn.
+    virtual uint32_t prefetchLoaded(LedgerKeySet const& keys,
+                                    std::vector<LedgerEntry> const& entries,
+                                    uint32_t ledgerSeq) = 0;
+
     // prepares to increase the capacity of pending changes by up to "s" changes
     virtual void prepareNewObjects(size_t s) = 0;
 
@@ -610,7 +642,9 @@ class AbstractLedgerTxn : public AbstractLedgerTxnParent
     // - getAllEntries
     //     extracts a list of keys that were created (init), updated (live) or
     //     deleted (dead) in this AbstractLedgerTxn. All these are to be
-    //     inserted into the BucketList.
+    //     inserted into the BucketList. Each list is sorted by
+    //     LedgerEntryIdCmp, so a fresh bucket can be written from them
+    //     without sorting.
     //
     // All of these functions throw if the AbstractLedgerTxn has a child.
     virtual LedgerEntryChanges getChanges() = 0;
@@ -753,6 +787,8 @@ class LedgerTxn : public AbstractLedgerTxn
 
     std::shared_ptr<InternalLedgerEntry const>
     getNewestVersion(InternalLedgerKey const& key) const override;
+    uint32_t
+    getNewestVersionEncodedSize(InternalLedgerKey const& key) const override;
 
     LedgerTxnEntry load(InternalLedgerKey const& key) override;
 
@@ -801,6 +837,9 @@ class LedgerTxn : public AbstractLedgerTxn
 
     double getPrefetchHitRate() const override;
     uint32_t prefetch(UnorderedSet<LedgerKey> const& keys) override;
+    uint32_t prefetchLoaded(LedgerKeySet const& keys,
+                            std::vector<LedgerEntry> const& entries,
+                            uint32_t ledgerSeq) override;
     void prepareNewObjects(size_t s) override;
 
     bool hasSponsorshipEntry() const override;
@@ -889,12 +928,26 @@ class LedgerTxnRoot : public AbstractLedgerTxnParent
 
     std::shared_ptr<InternalLedgerEntry const>
     getNewestVersion(InternalLedgerKey const& key) const override;
+    uint32_t
+    getNewestVersionEncodedSize(InternalLedgerKey const& key) const override;
 
     void rollbackChild() noexcept override;
 
     uint32_t prefetch(UnorderedSet<LedgerKey> const& keys) override;
+    uint32_t prefetchLoaded(LedgerKeySet const& keys,
+                            std::vector<LedgerEntry> const& entries,
+                            uint32_t ledgerSeq) override;
     double getPrefetchHitRate() const override;
 
+    // With PERSIST_ENTRY_CACHE_KEYS, the keys that were in the entry cache
+    // when the last child was committed are kept. This writes them to path,
+    // for warmEntryCache to prefetch when the node is restarted.
+    void saveEntryCacheKeys(std::filesystem::path const& path) const;
+
+    // Prefetches the keys saveEntryCacheKeys wrote to path, if it exists, then
+    // removes it. Returns the number of keys prefetched.
+    uint32_t warmEntryCache(std::filesystem::path const& path);
+
     void prepareNewObjects(size_t s) override;
 
 #ifdef BEST_OFFER_DEBUGGING
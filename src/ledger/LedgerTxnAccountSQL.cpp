@@ -134,6 +134,7 @@ LedgerTxnRoot::Impl::loadInflationWinners(size_t maxWinners,
 class BulkUpsertAccountsOperation : public DatabaseTypeSpecificOperation<void>
 {
     Database& mDB;
+    bool mUseCopy{false};
     std::vector<std::string> mAccountIDs;
     std::vector<int64_t> mBalances;
     std::vector<int64_t> mSeqNums;
@@ -152,8 +153,9 @@ class BulkUpsertAccountsOperation : public DatabaseTypeSpecificOperation<void>
 
   public:
     BulkUpsertAccountsOperation(Database& DB,
-                                std::vector<EntryIterator> const& entries)
-        : mDB(DB)
+                                std::vector<EntryIterator> const& entries,
+                                bool useCopy)
+        : mDB(DB), mUseCopy(useCopy)
     {
         mAccountIDs.reserve(entries.size());
         mBalances.reserve(entries.size());
@@ -286,6 +288,28 @@ class BulkUpsertAccountsOperation : public DatabaseTypeSpecificOperation<void>
     void
     doPostgresSpecificOperation(soci::postgresql_session_backend* pg) override
     {
+        if (mUseCopy)
+        {
+            upsertWithPGCopy(
+                mDB, pg->conn_, "accounts",
+                {"accountid", "balance", "seqnum", "numsubentries",
+                 "inflationdest", "homedomain", "thresholds", "signers",
+                 "flags", "lastmodified", "extension", "ledgerext"},
+                1,
+                marshalToPGCopyRows(
+                    mAccountIDs.size(), pgCopyColumn(mAccountIDs),
+                    pgCopyColumn(mBalances), pgCopyColumn(mSeqNums),
+                    pgCopyColumn(mSubEntryNums),
+                    pgCopyColumn(mInflationDests, &mInflationDestInds),
+                    pgCopyColumn(mHomeDomains), pgCopyColumn(mThresholds),
+                    pgCopyColumn(mSigners, &mSignerInds), pgCopyColumn(mFlags),
+                    pgCopyColumn(mLastModifieds),
+                    pgCopyColumn(mExtensions, &mExtensionInds),
+                    pgCopyColumn(mLedgerExtensions)),
+                mAccountIDs.size(), "account");
+            return;
+        }
+
         std::string strAccountIDs, strBalances, strSeqNums, strSubEntryNums,
             strInflationDests, strFlags, strHomeDomains, strThresholds,
             strSigners, strLastModifieds, strExtensions, strLedgerExtensions;
@@ -445,7 +469,8 @@ LedgerTxnRoot::Impl::bulkUpsertAccounts(
 {
     ZoneScoped;
     ZoneValue(static_cast<int64_t>(entries.size()));
-    BulkUpsertAccountsOperation op(mApp.getDatabase(), entries);
+    BulkUpsertAccountsOperation op(mApp.getDatabase(), entries,
+                                   mChildIsBulkLoad);
     mApp.getDatabase().doDatabaseTypeSpecificOperation(op);
 }
 
@@ -241,6 +241,7 @@ class BulkUpsertClaimableBalanceOperation
     : public DatabaseTypeSpecificOperation<void>
 {
     Database& mDb;
+    bool mUseCopy{false};
     std::vector<std::string> mBalanceIDs;
     std::vector<std::string> mClaimableBalanceEntrys;
     std::vector<int32_t> mLastModifieds;
@@ -258,8 +259,9 @@ class BulkUpsertClaimableBalanceOperation
 
   public:
     BulkUpsertClaimableBalanceOperation(
-        Database& Db, std::vector<EntryIterator> const& entryIter)
-        : mDb(Db)
+        Database& Db, std::vector<EntryIterator> const& entryIter,
+        bool useCopy)
+        : mDb(Db), mUseCopy(useCopy)
     {
         for (auto const& e : entryIter)
         {
@@ -306,6 +308,19 @@ class BulkUpsertClaimableBalanceOperation
     void
     doPostgresSpecificOperation(soci::postgresql_session_backend* pg) override
     {
+        if (mUseCopy)
+        {
+            upsertWithPGCopy(
+                mDb, pg->conn_, "claimablebalance",
+                {"balanceid", "ledgerentry", "lastmodified"}, 1,
+                marshalToPGCopyRows(mBalanceIDs.size(),
+                                    pgCopyColumn(mBalanceIDs),
+                                    pgCopyColumn(mClaimableBalanceEntrys),
+                                    pgCopyColumn(mLastModifieds)),
+                mBalanceIDs.size(), "claimablebalance");
+            return;
+        }
+
         std::string strBalanceIDs, strClaimableBalanceEntry, strLastModifieds;
 
         PGconn* conn = pg->conn_;
@@ -347,7 +362,8 @@ void
 LedgerTxnRoot::Impl::bulkUpsertClaimableBalance(
     std::vector<EntryIterator> const& entries)
 {
-    BulkUpsertClaimableBalanceOperation op(mApp.getDatabase(), entries);
+    BulkUpsertClaimableBalanceOperation op(mApp.getDatabase(), entries,
+                                           mChildIsBulkLoad);
     mApp.getDatabase().doDatabaseTypeSpecificOperation(op);
 }
 
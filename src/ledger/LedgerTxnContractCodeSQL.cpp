@@ -248,6 +248,7 @@ class BulkUpsertContractCodeOperation
     : public DatabaseTypeSpecificOperation<void>
 {
     Database& mDb;
+    bool mUseCopy{false};
     std::vector<std::string> mHashes;
     std::vector<std::string> mContractCodeEntries;
     std::vector<int32_t> mLastModifieds;
@@ -265,8 +266,9 @@ class BulkUpsertContractCodeOperation
 
   public:
     BulkUpsertContractCodeOperation(Database& Db,
-                                    std::vector<EntryIterator> const& entryIter)
-        : mDb(Db)
+                                    std::vector<EntryIterator> const& entryIter,
+                                    bool useCopy)
+        : mDb(Db), mUseCopy(useCopy)
     {
         for (auto const& e : entryIter)
         {
@@ -312,6 +314,18 @@ class BulkUpsertContractCodeOperation
     void
     doPostgresSpecificOperation(soci::postgresql_session_backend* pg) override
     {
+        if (mUseCopy)
+        {
+            upsertWithPGCopy(
+                mDb, pg->conn_, "contractcode",
+                {"hash", "ledgerentry", "lastmodified"}, 1,
+                marshalToPGCopyRows(mHashes.size(), pgCopyColumn(mHashes),
+                                    pgCopyColumn(mContractCodeEntries),
+                                    pgCopyColumn(mLastModifieds)),
+                mHashes.size(), "contractcode");
+            return;
+        }
+
         std::string strHashes, strContractCodeEntries, strLastModifieds;
 
         PGconn* conn = pg->conn_;
@@ -351,7 +365,8 @@ void
 LedgerTxnRoot::Impl::bulkUpsertContractCode(
     std::vector<EntryIterator> const& entries)
 {
-    BulkUpsertContractCodeOperation op(mApp.getDatabase(), entries);
+    BulkUpsertContractCodeOperation op(mApp.getDatabase(), entries,
+                                       mChildIsBulkLoad);
     mApp.getDatabase().doDatabaseTypeSpecificOperation(op);
 }
 
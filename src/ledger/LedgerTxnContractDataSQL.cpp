@@ -305,6 +305,7 @@ class BulkUpsertContractDataOperation
     : public DatabaseTypeSpecificOperation<void>
 {
     Database& mDb;
+    bool mUseCopy{false};
     std::vector<std::string> mContractIDs;
     std::vector<std::string> mKeys;
     std::vector<int32_t> mTypes;
@@ -327,8 +328,9 @@ class BulkUpsertContractDataOperation
 
   public:
     BulkUpsertContractDataOperation(Database& Db,
-                                    std::vector<EntryIterator> const& entryIter)
-        : mDb(Db)
+                                    std::vector<EntryIterator> const& entryIter,
+                                    bool useCopy)
+        : mDb(Db), mUseCopy(useCopy)
     {
         for (auto const& e : entryIter)
         {
@@ -376,6 +378,21 @@ class BulkUpsertContractDataOperation
     void
     doPostgresSpecificOperation(soci::postgresql_session_backend* pg) override
     {
+        if (mUseCopy)
+        {
+            upsertWithPGCopy(
+                mDb, pg->conn_, "contractdata",
+                {"contractid", "key", "type", "ledgerentry", "lastmodified"},
+                3,
+                marshalToPGCopyRows(
+                    mContractIDs.size(), pgCopyColumn(mContractIDs),
+                    pgCopyColumn(mKeys), pgCopyColumn(mTypes),
+                    pgCopyColumn(mContractDataEntries),
+                    pgCopyColumn(mLastModifieds)),
+                mContractIDs.size(), "contractdata");
+            return;
+        }
+
         std::string strContractIDs, strKeys, strTypes, strContractDataEntries,
             strLastModifieds;
 
@@ -421,7 +438,8 @@ void
 LedgerTxnRoot::Impl::bulkUpsertContractData(
     std::vector<EntryIterator> const& entries)
 {
-    BulkUpsertContractDataOperation op(mApp.getDatabase(), entries);
+    BulkUpsertContractDataOperation op(mApp.getDatabase(), entries,
+                                       mChildIsBulkLoad);
     mApp.getDatabase().doDatabaseTypeSpecificOperation(op);
 }
 
@@ -74,6 +74,7 @@ LedgerTxnRoot::Impl::loadData(LedgerKey const& key) const
 class BulkUpsertDataOperation : public DatabaseTypeSpecificOperation<void>
 {
     Database& mDB;
+    bool mUseCopy{false};
     std::vector<std::string> mAccountIDs;
     std::vector<std::string> mDataNames;
     std::vector<std::string> mDataValues;
@@ -109,8 +110,9 @@ class BulkUpsertDataOperation : public DatabaseTypeSpecificOperation<void>
     }
 
     BulkUpsertDataOperation(Database& DB,
-                            std::vector<EntryIterator> const& entryIter)
-        : mDB(DB)
+                            std::vector<EntryIterator> const& entryIter,
+                            bool useCopy)
+        : mDB(DB), mUseCopy(useCopy)
     {
         for (auto const& e : entryIter)
         {
@@ -163,6 +165,22 @@ class BulkUpsertDataOperation : public DatabaseTypeSpecificOperation<void>
     void
     doPostgresSpecificOperation(soci::postgresql_session_backend* pg) override
     {
+        if (mUseCopy)
+        {
+            upsertWithPGCopy(
+                mDB, pg->conn_, "accountdata",
+                {"accountid", "dataname", "datavalue", "lastmodified",
+                 "extension", "ledgerext"},
+                2,
+                marshalToPGCopyRows(
+                    mAccountIDs.size(), pgCopyColumn(mAccountIDs),
+                    pgCopyColumn(mDataNames), pgCopyColumn(mDataValues),
+                    pgCopyColumn(mLastModifieds), pgCopyColumn(mExtensions),
+                    pgCopyColumn(mLedgerExtensions)),
+                mAccountIDs.size(), "data");
+            return;
+        }
+
         std::string strAccountIDs, strDataNames, strDataValues,
             strLastModifieds, strExtensions, strLedgerExtensions;
 
@@ -303,7 +321,7 @@ LedgerTxnRoot::Impl::bulkUpsertAccountData(
 {
     ZoneScoped;
     ZoneValue(static_cast<int64_t>(entries.size()));
-    BulkUpsertDataOperation op(mApp.getDatabase(), entries);
+    BulkUpsertDataOperation op(mApp.getDatabase(), entries, mChildIsBulkLoad);
     mApp.getDatabase().doDatabaseTypeSpecificOperation(op);
 }
 
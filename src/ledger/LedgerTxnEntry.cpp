@@ -5,6 +5,7 @@
 #include "ledger/LedgerTxnEntry.h"
 #include "ledger/InternalLedgerEntry.h"
 #include "ledger/LedgerTxn.h"
+#include "util/FreeListAllocator.h"
 #include "util/XDROperators.h"
 #include "util/types.h"
 #include "xdr/Stellar-ledger-entries.h"
@@ -46,7 +47,7 @@ std::shared_ptr<LedgerTxnEntry::Impl>
 LedgerTxnEntry::makeSharedImpl(AbstractLedgerTxn& ltx,
                                InternalLedgerEntry& current)
 {
-    return std::make_shared<Impl>(ltx, current);
+    return std::allocate_shared<Impl>(FreeListAllocator<Impl>(), ltx, current);
 }
 
 std::shared_ptr<EntryImplBase>
@@ -256,7 +257,7 @@ std::shared_ptr<ConstLedgerTxnEntry::Impl>
 ConstLedgerTxnEntry::makeSharedImpl(AbstractLedgerTxn& ltx,
                                     InternalLedgerEntry const& current)
 {
-    return std::make_shared<Impl>(ltx, current);
+    return std::allocate_shared<Impl>(FreeListAllocator<Impl>(), ltx, current);
 }
 
 std::shared_ptr<EntryImplBase>
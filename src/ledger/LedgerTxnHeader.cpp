@@ -4,6 +4,7 @@
 
 #include "ledger/LedgerTxnHeader.h"
 #include "ledger/LedgerTxn.h"
+#include "util/FreeListAllocator.h"
 
 namespace stellar
 {
@@ -33,7 +34,7 @@ class LedgerTxnHeader::Impl
 std::shared_ptr<LedgerTxnHeader::Impl>
 LedgerTxnHeader::makeSharedImpl(AbstractLedgerTxn& ltx, LedgerHeader& current)
 {
-    return std::make_shared<Impl>(ltx, current);
+    return std::allocate_shared<Impl>(FreeListAllocator<Impl>(), ltx, current);
 }
 
 LedgerTxnHeader::LedgerTxnHeader(std::shared_ptr<Impl> const& impl)
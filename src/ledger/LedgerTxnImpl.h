@@ -7,7 +7,8 @@
 #include "bucket/BucketList.h"
 #include "database/Database.h"
 #include "ledger/LedgerTxn.h"
-#include "util/RandomEvictionCache.h"
+#include "util/FlatHashMap.h"
+#include "util/TinyLFUCache.h"
 #include <list>
 #include <optional>
 #ifdef USE_POSTGRES
@@ -17,9 +18,16 @@
 #include <sstream>
 #endif
 
+namespace medida
+{
+class Counter;
+class Meter;
+}
+
 namespace stellar
 {
 
+class Config;
 class SearchableBucketListSnapshot;
 
 class EntryIterator::AbstractImpl
@@ -41,6 +49,8 @@ class EntryIterator::AbstractImpl
 
     virtual InternalLedgerKey const& key() const = 0;
 
+    virtual size_t keyHash() const = 0;
+
     virtual std::unique_ptr<AbstractImpl> clone() const = 0;
 };
 
@@ -190,7 +200,7 @@ class BulkLedgerEntryChangeAccumulator
         return mTTLToDelete;
     }
 
-    bool accumulate(EntryIterator const& iter, bool bucketListDBEnabled);
+    bool accumulate(EntryIterator const& iter, Config const& cfg);
 };
 
 // Many functions in LedgerTxn::Impl provide a basic exception safety
@@ -207,7 +217,11 @@ class LedgerTxn::Impl
 {
     class EntryIteratorImpl;
 
-    typedef UnorderedMap<InternalLedgerKey, LedgerEntryPtr> EntryMap;
+    // A LedgerTxn is created, filled and committed for every operation, so its
+    // entries are kept in a flat map that stores key hashes. Committing to a
+    // parent LedgerTxn reuses the child's hashes instead of hashing every key
+    // again.
+    typedef FlatHashMap<InternalLedgerKey, LedgerEntryPtr> EntryMap;
 
     AbstractLedgerTxnParent& mParent;
     AbstractLedgerTxn* mChild;
@@ -433,9 +447,11 @@ class LedgerTxn::Impl
     // guarantee
     void updateEntryIfRecorded(InternalLedgerKey const& key,
                                bool effectiveActive);
+    // If keyHash is set, it must be the hash of key in mEntry
     void updateEntry(InternalLedgerKey const& key,
                      EntryMap::iterator const* keyHint, LedgerEntryPtr lePtr,
-                     bool effectiveActive) noexcept;
+                     bool effectiveActive,
+                     std::optional<size_t> keyHash = std::nullopt) noexcept;
 
     // updateWorstBestOffer has the strong exception safety guarantee
     void updateWorstBestOffer(AssetPair const& assets,
@@ -560,6 +576,7 @@ class LedgerTxn::Impl
     // - the entry cache may be, but is not guaranteed to be, cleared.
     std::shared_ptr<InternalLedgerEntry const>
     getNewestVersion(InternalLedgerKey const& key) const;
+    uint32_t getNewestVersionEncodedSize(InternalLedgerKey const& key) const;
 
     // load has the basic exception safety guarantee. If it throws an exception,
     // then
@@ -635,6 +652,10 @@ class LedgerTxn::Impl
 
     uint32_t prefetch(UnorderedSet<LedgerKey> const& keys);
 
+    uint32_t prefetchLoaded(LedgerKeySet const& keys,
+                            std::vector<LedgerEntry> const& entries,
+                            uint32_t ledgerSeq);
+
     double getPrefetchHitRate() const;
 
     void prepareNewObjects(size_t s);
@@ -685,6 +706,8 @@ class LedgerTxn::Impl::EntryIteratorImpl : public EntryIterator::AbstractImpl
 
     InternalLedgerKey const& key() const override;
 
+    size_t keyHash() const override;
+
     std::unique_ptr<EntryIterator::AbstractImpl> clone() const override;
 };
 
@@ -710,9 +733,25 @@ class LedgerTxnRoot::Impl
     {
         std::shared_ptr<LedgerEntry const> entry;
         LoadType type;
+        // Encoded size of entry, 0 if there is none
+        uint32_t size;
     };
 
-    typedef RandomEvictionCache<LedgerKey, CacheEntry> EntryCache;
+    // Keyed by InternalLedgerKey, which memoizes its hash, so that lookups
+    // from getNewestVersion reuse the hash computed by the LedgerTxn stack
+    // above instead of hashing the LedgerKey again for every probe
+    typedef TinyLFUCache<InternalLedgerKey, CacheEntry> EntryCache;
+
+    // Caches smaller than this are not sharded, so that their capacity is
+    // exact
+    static size_t const MIN_ENTRY_CACHE_SHARD_SIZE;
+    static size_t const MAX_ENTRY_CACHE_SHARDS;
+
+    struct EntryCacheMetrics
+    {
+        medida::Meter& mHits;
+        medida::Meter& mMisses;
+    };
 
     typedef AssetPair BestOffersKey;
 
@@ -726,13 +765,50 @@ class LedgerTxnRoot::Impl
     typedef UnorderedMap<BestOffersKey, BestOffersEntryPtr, AssetPairHash>
         BestOffers;
 
+    // With EXPERIMENTAL_IN_MEMORY_ORDERBOOK, every offer in the database is
+    // also held here, grouped by asset pair and sorted by the better offer
+    // relation, so that getBestOffer never queries the database. The order
+    // book is loaded from the database by the first getBestOffer and then
+    // kept in sync by commitChild. Anything else that writes offers to the
+    // database drops it, to be loaded again when it is next needed. With
+    // EXPERIMENTAL_OFFERS_IN_BUCKETLIST_DB it is loaded from the BucketList
+    // instead, and also answers the queries by seller.
+    struct InMemoryOrderBook
+    {
+        typedef std::map<OfferDescriptor, std::shared_ptr<LedgerEntry const>,
+                         IsBetterOfferComparator>
+            Offers;
+        UnorderedMap<AssetPair, Offers, AssetPairHash> mOffers;
+        UnorderedMap<int64_t, std::pair<AssetPair, OfferDescriptor>>
+            mOfferLocations;
+        UnorderedMap<AccountID,
+                     UnorderedMap<int64_t, std::shared_ptr<LedgerEntry const>>>
+            mOffersBySeller;
+
+        void insert(std::shared_ptr<LedgerEntry const> const& le);
+        void erase(int64_t offerID);
+    };
+
     static size_t const MIN_BEST_OFFERS_BATCH_SIZE;
     size_t const mMaxBestOffersBatchSize;
 
     Application& mApp;
     std::unique_ptr<LedgerHeader> mHeader;
     mutable EntryCache mEntryCache;
+    UnorderedMap<LedgerEntryType, EntryCacheMetrics> mEntryCacheMetrics;
+    medida::Meter& mEntryCacheRejects;
+    medida::Counter& mEntryCacheBytes;
+    // Of the entries put in the cache, to estimate its memory usage
+    mutable uint64_t mEntryCachePuts{0};
+    mutable uint64_t mEntryCachePutBytes{0};
+    // With PERSIST_ENTRY_CACHE_KEYS, the keys in the entry cache right before
+    // the last commit cleared it
+    bool const mKeepEntryCacheKeys;
+    std::vector<LedgerKey> mLastEntryCacheKeys;
     mutable BestOffers mBestOffers;
+    bool const mOffersInBucketListDB;
+    bool const mUseInMemoryOrderBook;
+    mutable std::unique_ptr<InMemoryOrderBook> mInMemoryOrderBook;
     mutable uint64_t mPrefetchHits{0};
     mutable uint64_t mPrefetchMisses{0};
     mutable std::shared_ptr<SearchableBucketListSnapshot>
@@ -741,6 +817,8 @@ class LedgerTxnRoot::Impl
     size_t mBulkLoadBatchSize;
     std::unique_ptr<soci::transaction> mTransaction;
     AbstractLedgerTxn* mChild;
+    // Whether mChild was added with TransactionMode::BULK_LOAD_WITH_SQL_TXN
+    bool mChildIsBulkLoad{false};
 
 #ifdef BEST_OFFER_DEBUGGING
     bool const mBestOfferDebuggingEnabled;
@@ -831,14 +909,22 @@ class LedgerTxnRoot::Impl
     //    database for the keyset that it has entries for. It's a precise
     //    image of a subset of the database.
     std::shared_ptr<InternalLedgerEntry const>
-    getFromEntryCache(LedgerKey const& key) const;
-    void putInEntryCache(LedgerKey const& key,
+    getFromEntryCache(InternalLedgerKey const& key) const;
+    // Approximate memory held by the entry cache: its current size times the
+    // average size of the entries put in it
+    size_t getEntryCacheMemoryUsage() const;
+    void putInEntryCache(InternalLedgerKey const& key,
                          std::shared_ptr<LedgerEntry const> const& entry,
                          LoadType type) const;
 
     BestOffersEntryPtr getFromBestOffers(Asset const& buying,
                                          Asset const& selling) const;
 
+    InMemoryOrderBook& getInMemoryOrderBook();
+    std::shared_ptr<LedgerEntry const>
+    getBestOfferFromInMemoryOrderBook(Asset const& buying, Asset const& selling,
+                                      OfferDescriptor const* worseThan);
+
     UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
     bulkLoadAccounts(UnorderedSet<LedgerKey> const& keys) const;
     UnorderedMap<LedgerKey, std::shared_ptr<LedgerEntry const>>
@@ -962,6 +1048,7 @@ class LedgerTxnRoot::Impl
     // - the entry cache may be, but is not guaranteed to be, cleared.
     std::shared_ptr<InternalLedgerEntry const>
     getNewestVersion(InternalLedgerKey const& key) const;
+    uint32_t getNewestVersionEncodedSize(InternalLedgerKey const& key) const;
 
     void rollbackChild() noexcept;
 
@@ -970,8 +1057,18 @@ class LedgerTxnRoot::Impl
     // prefetched.
     uint32_t prefetch(UnorderedSet<LedgerKey> const& keys);
 
+    // Cache the result of a BucketList load of keys from a snapshot of
+    // ledgerSeq, unless the root is no longer at ledgerSeq. Keys that are
+    // cached already are left alone since they are at least as recent.
+    uint32_t prefetchLoaded(LedgerKeySet const& keys,
+                            std::vector<LedgerEntry> const& entries,
+                            uint32_t ledgerSeq);
+
     double getPrefetchHitRate() const;
 
+    void saveEntryCacheKeys(std::filesystem::path const& path) const;
+    uint32_t warmEntryCache(std::filesystem::path const& path);
+
     void prepareNewObjects(size_t s);
 
 #ifdef BEST_OFFER_DEBUGGING
@@ -1060,5 +1157,96 @@ marshalToPGArray(PGconn* conn, std::string& out, const std::vector<T>& v,
     oss << '}';
     out = oss.str();
 }
+
+// One column of the rows passed to upsertWithPGCopy, with values null where
+// inds says so
+template <typename T> struct PGCopyColumn
+{
+    std::vector<T> const& mValues;
+    std::vector<soci::indicator> const* mInds;
+};
+
+template <typename T>
+inline PGCopyColumn<T>
+pgCopyColumn(std::vector<T> const& v,
+             std::vector<soci::indicator> const* ind = nullptr)
+{
+    return PGCopyColumn<T>{v, ind};
+}
+
+template <typename T>
+inline void
+marshalToPGCopyItem(std::ostringstream& oss, T const& item)
+{
+    // Same precision as marshalToPGArrayItem, for the same reason
+    oss << std::setprecision(std::numeric_limits<T>::max_digits10) << item;
+}
+
+template <>
+inline void
+marshalToPGCopyItem<std::string>(std::ostringstream& oss,
+                                 std::string const& item)
+{
+    for (char c : item)
+    {
+        switch (c)
+        {
+        case '\\':
+            oss << "\\\\";
+            break;
+        case '\t':
+            oss << "\\t";
+            break;
+        case '\n':
+            oss << "\\n";
+            break;
+        case '\r':
+            oss << "\\r";
+            break;
+        default:
+            oss << c;
+        }
+    }
+}
+
+// Marshals the first numRows values of columns into the text format of
+// COPY ... FROM STDIN, one line per row
+template <typename... T>
+inline std::string
+marshalToPGCopyRows(size_t numRows, PGCopyColumn<T> const&... columns)
+{
+    std::ostringstream oss;
+    for (size_t i = 0; i < numRows; ++i)
+    {
+        bool first = true;
+        auto marshalColumn = [&](auto const& col) {
+            if (!first)
+            {
+                oss << '\t';
+            }
+            first = false;
+            if (col.mInds && (*col.mInds)[i] == soci::i_null)
+            {
+                oss << "\\N";
+            }
+            else
+            {
+                marshalToPGCopyItem(oss, col.mValues[i]);
+            }
+        };
+        (marshalColumn(columns), ...);
+        oss << '\n';
+    }
+    return oss.str();
+}
+
+// Upserts numRows rows, marshaled by marshalToPGCopyRows, into table: they are
+// streamed with COPY into a temporary staging table like table, then merged
+// into it with a single INSERT ... ON CONFLICT. The first numKeyColumns of
+// columns are the conflict target, and the others are updated on conflict.
+void upsertWithPGCopy(Database& db, PGconn* conn, std::string const& table,
+                      std::vector<std::string> const& columns,
+                      size_t numKeyColumns, std::string const& rows,
+                      size_t numRows, std::string const& entityName);
 #endif
 }
@@ -260,6 +260,7 @@ class BulkUpsertLiquidityPoolOperation
     : public DatabaseTypeSpecificOperation<void>
 {
     Database& mDb;
+    bool mUseCopy{false};
     std::vector<std::string> mPoolAssets;
     std::vector<std::string> mAssetAs;
     std::vector<std::string> mAssetBs;
@@ -283,8 +284,9 @@ class BulkUpsertLiquidityPoolOperation
 
   public:
     BulkUpsertLiquidityPoolOperation(
-        Database& Db, std::vector<EntryIterator> const& entryIter)
-        : mDb(Db)
+        Database& Db, std::vector<EntryIterator> const& entryIter,
+        bool useCopy)
+        : mDb(Db), mUseCopy(useCopy)
     {
         for (auto const& e : entryIter)
         {
@@ -335,6 +337,22 @@ class BulkUpsertLiquidityPoolOperation
     void
     doPostgresSpecificOperation(soci::postgresql_session_backend* pg) override
     {
+        if (mUseCopy)
+        {
+            upsertWithPGCopy(
+                mDb, pg->conn_, "liquiditypool",
+                {"poolasset", "asseta", "assetb", "ledgerentry",
+                 "lastmodified"},
+                1,
+                marshalToPGCopyRows(
+                    mPoolAssets.size(), pgCopyColumn(mPoolAssets),
+                    pgCopyColumn(mAssetAs), pgCopyColumn(mAssetBs),
+                    pgCopyColumn(mLiquidityPoolEntries),
+                    pgCopyColumn(mLastModifieds)),
+                mPoolAssets.size(), "liquiditypool");
+            return;
+        }
+
         std::string strPoolAssets, strAssetAs, strAssetBs,
             strLiquidityPoolEntry, strLastModifieds;
 
@@ -383,7 +401,8 @@ void
 LedgerTxnRoot::Impl::bulkUpsertLiquidityPool(
     std::vector<EntryIterator> const& entries)
 {
-    BulkUpsertLiquidityPoolOperation op(mApp.getDatabase(), entries);
+    BulkUpsertLiquidityPoolOperation op(mApp.getDatabase(), entries,
+                                        mChildIsBulkLoad);
     mApp.getDatabase().doDatabaseTypeSpecificOperation(op);
 }
 
@@ -327,6 +327,7 @@ LedgerTxnRoot::Impl::loadOffers(StatementContext& prep) const
 class BulkUpsertOffersOperation : public DatabaseTypeSpecificOperation<void>
 {
     Database& mDB;
+    bool mUseCopy{false};
     std::vector<std::string> mSellerIDs;
     std::vector<int64_t> mOfferIDs;
     std::vector<std::string> mSellingAssets;
@@ -394,8 +395,9 @@ class BulkUpsertOffersOperation : public DatabaseTypeSpecificOperation<void>
     }
 
     BulkUpsertOffersOperation(Database& DB,
-                              std::vector<EntryIterator> const& entries)
-        : mDB(DB)
+                              std::vector<EntryIterator> const& entries,
+                              bool useCopy)
+        : mDB(DB), mUseCopy(useCopy)
     {
         mSellerIDs.reserve(entries.size());
         mOfferIDs.reserve(entries.size());
@@ -476,6 +478,26 @@ class BulkUpsertOffersOperation : public DatabaseTypeSpecificOperation<void>
     void
     doPostgresSpecificOperation(soci::postgresql_session_backend* pg) override
     {
+        if (mUseCopy)
+        {
+            upsertWithPGCopy(
+                mDB, pg->conn_, "offers",
+                {"offerid", "sellerid", "sellingasset", "buyingasset",
+                 "amount", "pricen", "priced", "price", "flags",
+                 "lastmodified", "extension", "ledgerext"},
+                1,
+                marshalToPGCopyRows(
+                    mOfferIDs.size(), pgCopyColumn(mOfferIDs),
+                    pgCopyColumn(mSellerIDs), pgCopyColumn(mSellingAssets),
+                    pgCopyColumn(mBuyingAssets), pgCopyColumn(mAmounts),
+                    pgCopyColumn(mPriceNs), pgCopyColumn(mPriceDs),
+                    pgCopyColumn(mPrices), pgCopyColumn(mFlags),
+                    pgCopyColumn(mLastModifieds), pgCopyColumn(mExtensions),
+                    pgCopyColumn(mLedgerExtensions)),
+                mOfferIDs.size(), "offer");
+            return;
+        }
+
 
         std::string strSellerIDs, strOfferIDs, strSellingAssets,
             strBuyingAssets, strAmounts, strPriceNs, strPriceDs, strPrices,
@@ -637,7 +659,8 @@ LedgerTxnRoot::Impl::bulkUpsertOffers(std::vector<EntryIterator> const& entries)
 {
     ZoneScoped;
     ZoneValue(static_cast<int64_t>(entries.size()));
-    BulkUpsertOffersOperation op(mApp.getDatabase(), entries);
+    BulkUpsertOffersOperation op(mApp.getDatabase(), entries,
+                                 mChildIsBulkLoad);
     mApp.getDatabase().doDatabaseTypeSpecificOperation(op);
 }
 
@@ -657,6 +680,7 @@ LedgerTxnRoot::Impl::dropOffers(bool rebuild)
     throwIfChild();
     mEntryCache.clear();
     mBestOffers.clear();
+    mInMemoryOrderBook.reset();
 
     mApp.getDatabase().getSession() << "DROP TABLE IF EXISTS offers;";
 
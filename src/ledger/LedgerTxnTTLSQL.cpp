@@ -244,6 +244,7 @@ LedgerTxnRoot::Impl::bulkDeleteTTL(std::vector<EntryIterator> const& entries,
 class BulkUpsertTTLOperation : public DatabaseTypeSpecificOperation<void>
 {
     Database& mDb;
+    bool mUseCopy{false};
     std::vector<std::string> mKeyHashes;
     std::vector<std::string> mTTLEntries;
     std::vector<int32_t> mLastModifieds;
@@ -261,8 +262,9 @@ class BulkUpsertTTLOperation : public DatabaseTypeSpecificOperation<void>
 
   public:
     BulkUpsertTTLOperation(Database& Db,
-                           std::vector<EntryIterator> const& entryIter)
-        : mDb(Db)
+                           std::vector<EntryIterator> const& entryIter,
+                           bool useCopy)
+        : mDb(Db), mUseCopy(useCopy)
     {
         for (auto const& e : entryIter)
         {
@@ -308,6 +310,18 @@ class BulkUpsertTTLOperation : public DatabaseTypeSpecificOperation<void>
     void
     doPostgresSpecificOperation(soci::postgresql_session_backend* pg) override
     {
+        if (mUseCopy)
+        {
+            upsertWithPGCopy(
+                mDb, pg->conn_, "ttl",
+                {"keyhash", "ledgerentry", "lastmodified"}, 1,
+                marshalToPGCopyRows(mKeyHashes.size(), pgCopyColumn(mKeyHashes),
+                                    pgCopyColumn(mTTLEntries),
+                                    pgCopyColumn(mLastModifieds)),
+                mKeyHashes.size(), "ttl");
+            return;
+        }
+
         std::string strKeyHashes, strTTLEntries, strLastModifieds;
 
         PGconn* conn = pg->conn_;
@@ -346,7 +360,7 @@ class BulkUpsertTTLOperation : public DatabaseTypeSpecificOperation<void>
 void
 LedgerTxnRoot::Impl::bulkUpsertTTL(std::vector<EntryIterator> const& entries)
 {
-    BulkUpsertTTLOperation op(mApp.getDatabase(), entries);
+    BulkUpsertTTLOperation op(mApp.getDatabase(), entries, mChildIsBulkLoad);
     mApp.getDatabase().doDatabaseTypeSpecificOperation(op);
 }
 
@@ -124,6 +124,7 @@ LedgerTxnRoot::Impl::loadPoolShareTrustLinesByAccountAndAsset(
 class BulkUpsertTrustLinesOperation : public DatabaseTypeSpecificOperation<void>
 {
     Database& mDB;
+    bool mUseCopy{false};
     std::vector<std::string> mAccountIDs;
     std::vector<std::string> mAssets;
     std::vector<std::string> mTrustLineEntries;
@@ -132,8 +133,8 @@ class BulkUpsertTrustLinesOperation : public DatabaseTypeSpecificOperation<void>
   public:
     BulkUpsertTrustLinesOperation(Database& DB,
                                   std::vector<EntryIterator> const& entries,
-                                  uint32_t ledgerVersion)
-        : mDB(DB)
+                                  uint32_t ledgerVersion, bool useCopy)
+        : mDB(DB), mUseCopy(useCopy)
     {
         mAccountIDs.reserve(entries.size());
         mAssets.reserve(entries.size());
@@ -197,6 +198,20 @@ class BulkUpsertTrustLinesOperation : public DatabaseTypeSpecificOperation<void>
     void
     doPostgresSpecificOperation(soci::postgresql_session_backend* pg) override
     {
+        if (mUseCopy)
+        {
+            upsertWithPGCopy(
+                mDB, pg->conn_, "trustlines",
+                {"accountid", "asset", "ledgerentry", "lastmodified"}, 2,
+                marshalToPGCopyRows(mAccountIDs.size(),
+                                    pgCopyColumn(mAccountIDs),
+                                    pgCopyColumn(mAssets),
+                                    pgCopyColumn(mTrustLineEntries),
+                                    pgCopyColumn(mLastModifieds)),
+                mAccountIDs.size(), "trustline");
+            return;
+        }
+
         PGconn* conn = pg->conn_;
 
         std::string strAccountIDs, strAssets, strTrustLineEntries,
@@ -333,7 +348,7 @@ LedgerTxnRoot::Impl::bulkUpsertTrustLines(
     ZoneScoped;
     ZoneValue(static_cast<int64_t>(entries.size()));
     BulkUpsertTrustLinesOperation op(mApp.getDatabase(), entries,
-                                     mHeader->ledgerVersion);
+                                     mHeader->ledgerVersion, mChildIsBulkLoad);
     mApp.getDatabase().doDatabaseTypeSpecificOperation(op);
 }
 
@@ -74,4 +74,23 @@ isPersistentEntry(T const& e)
            (e.type() == CONTRACT_DATA &&
             e.contractData().durability == PERSISTENT);
 }
-}
\ No newline at end of file
+
+// Adds the keys of a Soroban footprint to keys, along with the TTL key of
+// each contract data and code key, since applying loads both
+template <typename KeySetT>
+void
+insertFootprintKeys(LedgerFootprint const& footprint, KeySetT& keys)
+{
+    for (auto const* fpKeys : {&footprint.readOnly, &footprint.readWrite})
+    {
+        for (auto const& key : *fpKeys)
+        {
+            keys.emplace(key);
+            if (isSorobanEntry(key))
+            {
+                keys.emplace(getTTLKey(key));
+            }
+        }
+    }
+}
+}
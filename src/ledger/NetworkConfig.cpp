@@ -7,6 +7,7 @@
 #include "bucket/BucketManager.h"
 #include "main/Application.h"
 #include "util/ProtocolVersion.h"
+#include "xdrpp/marshal.h"
 #include <Tracy.hpp>
 
 #ifdef BUILD_TESTS
@@ -1090,6 +1091,7 @@ SorobanNetworkConfig::loadCpuCostParams(AbstractLedgerTxn& ltx)
         ConfigSettingID::CONFIG_SETTING_CONTRACT_COST_PARAMS_CPU_INSTRUCTIONS;
     auto le = ltx.loadWithoutRecord(key).current();
     mCpuCostParams = le.data.configSetting().contractCostParamsCpuInsns();
+    mCpuCostParamsXdr = xdr::xdr_to_opaque(mCpuCostParams);
 }
 
 void
@@ -1102,6 +1104,7 @@ SorobanNetworkConfig::loadMemCostParams(AbstractLedgerTxn& ltx)
         ConfigSettingID::CONFIG_SETTING_CONTRACT_COST_PARAMS_MEMORY_BYTES;
     auto le = ltx.loadWithoutRecord(key).current();
     mMemCostParams = le.data.configSetting().contractCostParamsMemBytes();
+    mMemCostParamsXdr = xdr::xdr_to_opaque(mMemCostParams);
 }
 
 void
@@ -1593,6 +1596,18 @@ SorobanNetworkConfig::memCostParams() const
     return mMemCostParams;
 }
 
+std::vector<uint8_t> const&
+SorobanNetworkConfig::cpuCostParamsXdr() const
+{
+    return mCpuCostParamsXdr;
+}
+
+std::vector<uint8_t> const&
+SorobanNetworkConfig::memCostParamsXdr() const
+{
+    return mMemCostParamsXdr;
+}
+
 StateArchivalSettings const&
 SorobanNetworkConfig::stateArchivalSettings() const
 {
@@ -311,6 +311,9 @@ class SorobanNetworkConfig
     // Cost model parameters of the Soroban host
     ContractCostParams const& cpuCostParams() const;
     ContractCostParams const& memCostParams() const;
+    // The same, XDR-encoded when loaded instead of for every invocation
+    std::vector<uint8_t> const& cpuCostParamsXdr() const;
+    std::vector<uint8_t> const& memCostParamsXdr() const;
 
     static bool isValidCostParams(ContractCostParams const& params,
                                   uint32_t ledgerVersion);
@@ -417,6 +420,8 @@ class SorobanNetworkConfig
     // Host cost params
     ContractCostParams mCpuCostParams{};
     ContractCostParams mMemCostParams{};
+    std::vector<uint8_t> mCpuCostParamsXdr;
+    std::vector<uint8_t> mMemCostParamsXdr;
 
     // State archival settings
     StateArchivalSettings mStateArchivalSettings{};
@@ -1,8 +1,11 @@
 #include "ledger/SorobanMetrics.h"
 
+#include "lib/json/json.h"
+#include "medida/histogram.h"
 #include "medida/meter.h"
 #include "medida/metrics_registry.h"
 #include "medida/timer.h"
+#include <algorithm>
 
 namespace stellar
 {
@@ -20,6 +23,12 @@ SorobanMetrics::SorobanMetrics(medida::MetricsRegistry& metrics)
           metrics.NewHistogram({"soroban", "ledger", "write-entry"}))
     , mLedgerWriteLedgerByte(
           metrics.NewHistogram({"soroban", "ledger", "write-ledger-byte"}))
+    , mLedgerApplyClusters(
+          metrics.NewHistogram({"soroban", "ledger", "apply-clusters"}))
+    , mLedgerLargestApplyCluster(
+          metrics.NewHistogram({"soroban", "ledger", "largest-apply-cluster"}))
+    , mLedgerTopContractCpuInsn(
+          metrics.NewHistogram({"soroban", "ledger", "top-contract-cpu-insn"}))
     /* tx-wide metrics */
     , mTxSizeByte(metrics.NewHistogram({"soroban", "tx", "size-byte"}))
     /* InvokeHostFunctionOp metrics */
@@ -75,6 +84,10 @@ SorobanMetrics::SorobanMetrics(medida::MetricsRegistry& metrics)
     , mHostFnOpFailure(
           metrics.NewMeter({"soroban", "host-fn-op", "failure"}, "call"))
     , mHostFnOpExec(metrics.NewTimer({"soroban", "host-fn-op", "exec"}))
+    , mHostFnOpModuleCacheHit(metrics.NewMeter(
+          {"soroban", "host-fn-op", "module-cache-hit"}, "entry"))
+    , mHostFnOpModuleCacheMiss(metrics.NewMeter(
+          {"soroban", "host-fn-op", "module-cache-miss"}, "entry"))
     /* ExtendFootprintTTLOp metrics */
     , mExtFpTtlOpReadLedgerByte(metrics.NewMeter(
           {"soroban", "ext-fprint-ttl-op", "read-ledger-byte"}, "byte"))
@@ -131,6 +144,81 @@ SorobanMetrics::SorobanMetrics(medida::MetricsRegistry& metrics)
 {
 }
 
+namespace
+{
+void
+addUsage(SorobanMetrics::ContractProfile& profile,
+         SorobanMetrics::ContractProfile const& usage)
+{
+    profile.mInvocations += usage.mInvocations;
+    profile.mCpuInsn += usage.mCpuInsn;
+    profile.mInvokeTimeNsecs += usage.mInvokeTimeNsecs;
+    profile.mReadEntry += usage.mReadEntry;
+    profile.mWriteEntry += usage.mWriteEntry;
+    profile.mReadByte += usage.mReadByte;
+    profile.mWriteByte += usage.mWriteByte;
+}
+
+void
+addToProfiles(UnorderedMap<std::string, SorobanMetrics::ContractProfile>&
+                  profiles,
+              std::string const& key,
+              SorobanMetrics::ContractProfile const& usage, size_t maxSize)
+{
+    auto it = profiles.find(key);
+    if (it == profiles.end())
+    {
+        SorobanMetrics::ContractProfile profile;
+        if (profiles.size() >= maxSize)
+        {
+            auto evicted = std::min_element(
+                profiles.begin(), profiles.end(),
+                [](auto const& lhs, auto const& rhs) {
+                    return lhs.second.mCpuInsn < rhs.second.mCpuInsn;
+                });
+            profile.mCpuInsn = evicted->second.mCpuInsn;
+            profile.mCpuInsnError = evicted->second.mCpuInsn;
+            profiles.erase(evicted);
+        }
+        it = profiles.emplace(key, profile).first;
+    }
+    addUsage(it->second, usage);
+}
+
+Json::Value
+profilesToJson(UnorderedMap<std::string, SorobanMetrics::ContractProfile> const&
+                   profiles,
+               char const* keyName, size_t limit)
+{
+    std::vector<std::pair<std::string, SorobanMetrics::ContractProfile>>
+        sorted(profiles.begin(), profiles.end());
+    std::sort(sorted.begin(), sorted.end(),
+              [](auto const& lhs, auto const& rhs) {
+                  return lhs.second.mCpuInsn > rhs.second.mCpuInsn;
+              });
+    sorted.resize(std::min(sorted.size(), limit));
+
+    Json::Value res(Json::arrayValue);
+    for (auto const& [key, profile] : sorted)
+    {
+        Json::Value p;
+        p[keyName] = key;
+        p["invocations"] = static_cast<Json::UInt64>(profile.mInvocations);
+        p["cpu_insn"] = static_cast<Json::UInt64>(profile.mCpuInsn);
+        p["cpu_insn_max_overestimate"] =
+            static_cast<Json::UInt64>(profile.mCpuInsnError);
+        p["invoke_time_nsecs"] =
+            static_cast<Json::UInt64>(profile.mInvokeTimeNsecs);
+        p["read_entry"] = static_cast<Json::UInt64>(profile.mReadEntry);
+        p["write_entry"] = static_cast<Json::UInt64>(profile.mWriteEntry);
+        p["read_byte"] = static_cast<Json::UInt64>(profile.mReadByte);
+        p["write_byte"] = static_cast<Json::UInt64>(profile.mWriteByte);
+        res.append(p);
+    }
+    return res;
+}
+}
+
 void
 SorobanMetrics::accumulateLedgerTxCount(uint64_t txCount)
 {
@@ -177,6 +265,15 @@ SorobanMetrics::publishAndResetLedgerWideMetrics()
     mLedgerReadLedgerByte.Update(mCounterLedgerReadByte);
     mLedgerWriteEntry.Update(mCounterLedgerWriteEntry);
     mLedgerWriteLedgerByte.Update(mCounterLedgerWriteByte);
+    if (!mLedgerContractCpuInsn.empty())
+    {
+        uint64_t top = 0;
+        for (auto const& [_, cpuInsn] : mLedgerContractCpuInsn)
+        {
+            top = std::max(top, cpuInsn);
+        }
+        mLedgerTopContractCpuInsn.Update(top);
+    }
 
     mCounterLedgerTxCount = 0;
     mCounterLedgerCpuInsn = 0;
@@ -185,5 +282,56 @@ SorobanMetrics::publishAndResetLedgerWideMetrics()
     mCounterLedgerReadByte = 0;
     mCounterLedgerWriteEntry = 0;
     mCounterLedgerWriteByte = 0;
+    mLedgerContractCpuInsn.clear();
+}
+
+void
+SorobanMetrics::noteContractCodeLive(Hash const& codeHash)
+{
+    mModuleCacheModel.put(codeHash, true);
+}
+
+void
+SorobanMetrics::noteContractCodeArchived(Hash const& codeHash)
+{
+    if (auto live = mModuleCacheModel.maybeGet(codeHash))
+    {
+        *live = false;
+    }
+}
+
+void
+SorobanMetrics::noteContractCodeInvoked(Hash const& codeHash)
+{
+    auto live = mModuleCacheModel.maybeGet(codeHash);
+    if (live && *live)
+    {
+        mHostFnOpModuleCacheHit.Mark();
+    }
+    else
+    {
+        mHostFnOpModuleCacheMiss.Mark();
+        mModuleCacheModel.put(codeHash, true);
+    }
+}
+
+void
+SorobanMetrics::noteContractInvocation(std::string const& contract,
+                                       std::string const& function,
+                                       ContractProfile const& usage)
+{
+    mLedgerContractCpuInsn[contract] += usage.mCpuInsn;
+    addToProfiles(mContractProfiles, contract, usage, CONTRACT_PROFILE_SIZE);
+    addToProfiles(mFunctionProfiles, contract + ":" + function, usage,
+                  CONTRACT_PROFILE_SIZE);
+}
+
+Json::Value
+SorobanMetrics::getContractProfilesJson(size_t limit) const
+{
+    Json::Value res;
+    res["contracts"] = profilesToJson(mContractProfiles, "contract", limit);
+    res["functions"] = profilesToJson(mFunctionProfiles, "function", limit);
+    return res;
+}
 }
-}
\ No newline at end of file
@@ -7,7 +7,13 @@
 // This class exists to cache soroban metrics: resource usage and network config
 // limits. It also performs aggregation of ledger-wide resource usage across
 // different operations.
+#include "lib/json/json-forwards.h"
+#include "util/HashOfHash.h"
+#include "util/RandomEvictionCache.h"
+#include "util/UnorderedMap.h"
+#include "xdr/Stellar-types.h"
 #include <cstdint>
+#include <string>
 
 namespace medida
 {
@@ -23,6 +29,23 @@ namespace stellar
 
 class SorobanMetrics
 {
+  public:
+    // Resources used by the invocations of a contract, or of one function of
+    // a contract
+    struct ContractProfile
+    {
+        uint64_t mInvocations{0};
+        uint64_t mCpuInsn{0};
+        // Instructions of the profiles this one evicted, which mCpuInsn
+        // overestimates its own by at most
+        uint64_t mCpuInsnError{0};
+        uint64_t mInvokeTimeNsecs{0};
+        uint64_t mReadEntry{0};
+        uint64_t mWriteEntry{0};
+        uint64_t mReadByte{0};
+        uint64_t mWriteByte{0};
+    };
+
   private:
     uint64_t mCounterLedgerTxCount{0};
     uint64_t mCounterLedgerCpuInsn{0};
@@ -32,6 +55,24 @@ class SorobanMetrics
     uint64_t mCounterLedgerWriteEntry{0};
     uint64_t mCounterLedgerWriteByte{0};
 
+    // Code hashes a cross-invocation module cache would hold, with whether
+    // the code entry is still live. The host parses and instantiates every
+    // module on each invocation, so this only tells how often a cache of
+    // this size, filled on upload, restore and first use and emptied on
+    // archival, would save that work.
+    static constexpr size_t MODULE_CACHE_MODEL_SIZE = 4096;
+    RandomEvictionCache<Hash, bool> mModuleCacheModel{MODULE_CACHE_MODEL_SIZE};
+
+    // Profiles of the contracts, and of the functions of contracts, using
+    // the most instructions since startup. A new contract evicts the one
+    // with the fewest instructions and inherits them as an overestimate
+    // ("space saving"), so any contract using more than 1/K of all
+    // instructions is sure to be tracked.
+    static constexpr size_t CONTRACT_PROFILE_SIZE = 100;
+    UnorderedMap<std::string, ContractProfile> mContractProfiles;
+    UnorderedMap<std::string, ContractProfile> mFunctionProfiles;
+    UnorderedMap<std::string, uint64_t> mLedgerContractCpuInsn;
+
   public:
     // ledger-wide metrics
     medida::Histogram& mLedgerTxCount;
@@ -41,6 +82,9 @@ class SorobanMetrics
     medida::Histogram& mLedgerReadLedgerByte;
     medida::Histogram& mLedgerWriteEntry;
     medida::Histogram& mLedgerWriteLedgerByte;
+    medida::Histogram& mLedgerApplyClusters;
+    medida::Histogram& mLedgerLargestApplyCluster;
+    medida::Histogram& mLedgerTopContractCpuInsn;
 
     // tx-wide metrics
     medida::Histogram& mTxSizeByte;
@@ -72,6 +116,8 @@ class SorobanMetrics
     medida::Meter& mHostFnOpSuccess;
     medida::Meter& mHostFnOpFailure;
     medida::Timer& mHostFnOpExec;
+    medida::Meter& mHostFnOpModuleCacheHit;
+    medida::Meter& mHostFnOpModuleCacheMiss;
 
     // `ExtendFootprintTTLOp` metrics
     medida::Meter& mExtFpTtlOpReadLedgerByte;
@@ -115,5 +161,22 @@ class SorobanMetrics
     void accumulateLedgerWriteByte(uint64_t writeByte);
 
     void publishAndResetLedgerWideMetrics();
+
+    // Updates the module cache model: a contract code entry was uploaded or
+    // restored, was found archived, or is loaded for an invocation (which
+    // marks a hit or a miss)
+    void noteContractCodeLive(Hash const& codeHash);
+    void noteContractCodeArchived(Hash const& codeHash);
+    void noteContractCodeInvoked(Hash const& codeHash);
+
+    // Adds the resources an invocation of `function` of `contract` used to
+    // their profiles
+    void noteContractInvocation(std::string const& contract,
+                                std::string const& function,
+                                ContractProfile const& usage);
+
+    // Profiles of the `limit` contracts and functions using the most
+    // instructions, most first
+    Json::Value getContractProfilesJson(size_t limit) const;
 };
 }
\ No newline at end of file
@@ -8,15 +8,23 @@
 #include "catchup/ReplayDebugMetaWork.h"
 #include "crypto/Hex.h"
 #include "crypto/Random.h"
+#include "crypto/SHA.h"
 #include "crypto/SecretKey.h"
+#include "database/Database.h"
 #include "history/HistoryArchiveManager.h"
 #include "history/test/HistoryTestsUtils.h"
 #include "ledger/FlushAndRotateMetaDebugWork.h"
+#include "ledger/LedgerCloseMetaFilter.h"
+#include "ledger/LedgerCloseMetaFrame.h"
+#include "ledger/LedgerCloseMetaStreamWriter.h"
 #include "ledger/LedgerTxn.h"
 #include "ledger/test/LedgerTestUtils.h"
 #include "lib/catch.hpp"
 #include "main/Application.h"
 #include "main/ApplicationUtils.h"
+#include "main/PersistentState.h"
+#include "medida/counter.h"
+#include "medida/metrics_registry.h"
 #include "simulation/Simulation.h"
 #include "test/TestUtils.h"
 #include "test/TxTests.h"
@@ -342,6 +350,235 @@ TEST_CASE("LedgerCloseMetaStream file descriptor - REPLAY_IN_MEMORY",
     }
 }
 
+TEST_CASE("LedgerCloseMetaFrame serialization", "[ledgerclosemetastream]")
+{
+    uint32_t const protocolVersion =
+        GENERATE(static_cast<uint32_t>(SOROBAN_PROTOCOL_VERSION) - 1,
+                 Config::CURRENT_LEDGER_PROTOCOL_VERSION);
+    size_t const numTxs = GENERATE(0, 1, 10);
+
+    LedgerCloseMetaFrame frame(protocolVersion);
+    LedgerCloseMeta expected;
+    bool const v1 =
+        protocolVersionStartsFrom(protocolVersion, SOROBAN_PROTOCOL_VERSION);
+    expected.v(v1 ? 1 : 0);
+    auto& expectedTxProcessing =
+        v1 ? expected.v1().txProcessing : expected.v0().txProcessing;
+
+    auto makeChanges = [](size_t n) {
+        LedgerEntryChanges changes;
+        for (auto const& le : LedgerTestUtils::generateValidLedgerEntries(n))
+        {
+            changes.emplace_back().type(LEDGER_ENTRY_STATE);
+            changes.back().state() = le;
+        }
+        return changes;
+    };
+
+    frame.reserveTxProcessing(numTxs);
+    for (size_t i = 0; i < numTxs; ++i)
+    {
+        auto feeChanges = makeChanges(2);
+        frame.pushTxProcessingEntry();
+        expectedTxProcessing.emplace_back().feeProcessing = feeChanges;
+        frame.setLastTxProcessingFeeProcessingChanges(std::move(feeChanges));
+    }
+    for (size_t i = 0; i < numTxs; ++i)
+    {
+        TransactionMeta tm;
+        tm.v(2);
+        tm.v2().txChangesBefore = makeChanges(i % 3);
+        tm.v2().operations.emplace_back().changes = makeChanges(1);
+        TransactionResultPair rp;
+        rp.transactionHash = sha256(std::to_string(i));
+        rp.result.feeCharged = i;
+
+        frame.setTxProcessingMetaAndResultPair(tm, rp, static_cast<int>(i));
+        expectedTxProcessing[i].txApplyProcessing = tm;
+        expectedTxProcessing[i].result = rp;
+    }
+
+    auto upgrade = [] {
+        UpgradeEntryMeta upgrade;
+        upgrade.upgrade.type(LEDGER_UPGRADE_BASE_FEE);
+        upgrade.upgrade.newBaseFee() = 123;
+        return upgrade;
+    };
+    frame.upgradesProcessing().emplace_back(upgrade());
+    frame.ledgerHeader().header.ledgerSeq = 42;
+    frame.ledgerHeader().hash = sha256("header");
+    auto& expectedHeader =
+        v1 ? expected.v1().ledgerHeader : expected.v0().ledgerHeader;
+    expectedHeader = frame.ledgerHeader();
+    (v1 ? expected.v1().upgradesProcessing : expected.v0().upgradesProcessing)
+        .emplace_back(upgrade());
+
+    // Serializing again into a reused buffer gives the same bytes
+    std::vector<char> buffer(1000, 'x');
+    for (int i = 0; i < 2; ++i)
+    {
+        frame.serialize(buffer);
+        auto expectedBytes = xdr::xdr_to_opaque(expected);
+        REQUIRE(std::vector<char>(expectedBytes.begin(),
+                                  expectedBytes.end()) == buffer);
+    }
+}
+
+TEST_CASE("LedgerCloseMetaStreamWriter", "[ledgerclosemetastream]")
+{
+    VirtualClock clock;
+    TmpDirManager tdm(std::string("streamtmp-") + binToHex(randomBytes(8)));
+    TmpDir td = tdm.tmpDir("streams");
+    std::string metaPath = td.getName() + "/stream.xdr";
+
+    auto makeMeta = [](uint32_t ledgerSeq) {
+        LedgerCloseMeta lcm;
+        lcm.v(0);
+        lcm.v0().ledgerHeader.header.ledgerSeq = ledgerSeq;
+        lcm.v0().ledgerHeader.hash = sha256(std::to_string(ledgerSeq));
+        return lcm;
+    };
+
+    medida::MetricsRegistry metrics;
+    size_t const maxLag = GENERATE(1, 4);
+    uint32_t const numLedgers = 100;
+    {
+        XDROutputFileStream out(clock.getIOContext(), /*fsyncOnClose=*/false);
+        out.open(metaPath);
+        LedgerCloseMetaStreamWriter writer(out, maxLag, metrics);
+        for (uint32_t i = 1; i <= numLedgers; ++i)
+        {
+            auto bytes = xdr::xdr_to_opaque(makeMeta(i));
+            writer.enqueue(reinterpret_cast<char const*>(bytes.data()),
+                           bytes.size());
+            REQUIRE(metrics.NewCounter({"ledger", "metastream", "lag"})
+                        .count() <= static_cast<int64_t>(maxLag));
+            if (i == numLedgers / 2)
+            {
+                writer.drain();
+                REQUIRE(metrics.NewCounter({"ledger", "metastream", "lag"})
+                            .count() == 0);
+            }
+        }
+        // The rest is written out when the writer is destroyed
+    }
+
+    XDRInputFileStream in;
+    in.open(metaPath);
+    LedgerCloseMeta lcm;
+    uint32_t expected = 1;
+    while (in && in.readOne(lcm))
+    {
+        REQUIRE(lcm == makeMeta(expected));
+        ++expected;
+    }
+    REQUIRE(expected == numLedgers + 1);
+}
+
+TEST_CASE("LedgerCloseMetaFilter", "[ledgerclosemetastream]")
+{
+    auto change = [](LedgerEntryChangeType type, LedgerEntry const& le) {
+        LedgerEntryChange c;
+        c.type(type);
+        if (type == LEDGER_ENTRY_STATE)
+        {
+            c.state() = le;
+        }
+        else if (type == LEDGER_ENTRY_UPDATED)
+        {
+            c.updated() = le;
+        }
+        else
+        {
+            c.created() = le;
+        }
+        return c;
+    };
+    auto account = LedgerTestUtils::generateValidLedgerEntryOfType(ACCOUNT);
+    auto trustLine =
+        LedgerTestUtils::generateValidLedgerEntryOfType(TRUSTLINE);
+
+    LedgerCloseMeta meta;
+    meta.v(1);
+    auto& v1 = meta.v1();
+    v1.ledgerHeader.header.ledgerSeq = 42;
+    v1.txSet.v(1);
+    v1.txSet.v1TxSet().phases.emplace_back();
+    v1.scpInfo.emplace_back();
+
+    // Fee changes to an account and a Soroban transaction creating a trust
+    // line, with an event of a contract and a system event
+    auto& tx1 = v1.txProcessing.emplace_back();
+    tx1.result.transactionHash = sha256("tx1");
+    tx1.feeProcessing = {change(LEDGER_ENTRY_STATE, account),
+                         change(LEDGER_ENTRY_UPDATED, account)};
+    tx1.txApplyProcessing.v(3);
+    auto& tm = tx1.txApplyProcessing.v3();
+    tm.operations.emplace_back().changes = {
+        change(LEDGER_ENTRY_CREATED, trustLine)};
+    auto& soroban = tm.sorobanMeta.activate();
+    soroban.events.emplace_back().contractID.activate() = sha256("contract");
+    soroban.events.emplace_back().type = ContractEventType::SYSTEM;
+    soroban.diagnosticEvents.emplace_back();
+
+    // A transaction only changing a trust line
+    auto& tx2 = v1.txProcessing.emplace_back();
+    tx2.result.transactionHash = sha256("tx2");
+    tx2.txApplyProcessing.v(2);
+    tx2.txApplyProcessing.v2().txChangesBefore = {
+        change(LEDGER_ENTRY_STATE, trustLine),
+        change(LEDGER_ENTRY_UPDATED, trustLine)};
+
+    SECTION("entry query")
+    {
+        LedgerCloseMetaFilter filter("data.type == 'ACCOUNT'", "");
+        auto res = filter.filter(meta);
+        REQUIRE(res.v1().ledgerHeader == v1.ledgerHeader);
+        REQUIRE(res.v1().txSet.v1TxSet().phases.empty());
+        REQUIRE(res.v1().scpInfo.empty());
+        REQUIRE(res.v1().txProcessing.size() == 1);
+
+        auto const& filtered = res.v1().txProcessing[0];
+        REQUIRE(filtered.result == tx1.result);
+        REQUIRE(filtered.feeProcessing == tx1.feeProcessing);
+        auto const& filteredMeta = filtered.txApplyProcessing.v3();
+        REQUIRE(filteredMeta.operations.size() == 1);
+        REQUIRE(filteredMeta.operations[0].changes.empty());
+        REQUIRE(filteredMeta.sorobanMeta->events.empty());
+        REQUIRE(filteredMeta.sorobanMeta->diagnosticEvents.empty());
+    }
+
+    SECTION("event query")
+    {
+        LedgerCloseMetaFilter filter("", "contractID != NULL");
+        auto res = filter.filter(meta);
+        REQUIRE(res.v1().txProcessing.size() == 1);
+        auto const& filtered = res.v1().txProcessing[0];
+        REQUIRE(filtered.feeProcessing.empty());
+        auto const& events =
+            filtered.txApplyProcessing.v3().sorobanMeta->events;
+        REQUIRE(events.size() == 1);
+        REQUIRE(events[0] == soroban.events[0]);
+    }
+
+    SECTION("state change is kept with the update that follows")
+    {
+        LedgerCloseMetaFilter filter("data.type == 'TRUSTLINE'", "");
+        auto res = filter.filter(meta);
+        REQUIRE(res.v1().txProcessing.size() == 2);
+        REQUIRE(res.v1().txProcessing[1].txApplyProcessing ==
+                tx2.txApplyProcessing);
+    }
+
+    SECTION("malformed query")
+    {
+        REQUIRE_THROWS_AS(LedgerCloseMetaFilter("data.nope == 1", ""),
+                          std::invalid_argument);
+        REQUIRE_THROWS_AS(LedgerCloseMetaFilter("", "contractID =="),
+                          std::invalid_argument);
+    }
+}
+
 TEST_CASE("EXPERIMENTAL_PRECAUTION_DELAY_META configuration",
           "[ledgerclosemetastreamlive][ledgerclosemetastreamreplay]")
 {
@@ -398,6 +635,58 @@ TEST_CASE("EXPERIMENTAL_PRECAUTION_DELAY_META configuration",
     }
 }
 
+TEST_CASE("EXPERIMENTAL_METADATA_ONLY_MODE only stores the last closed ledger",
+          "[ledgerclosemetastream]")
+{
+    TmpDirManager tdm(std::string("streamtmp-") + binToHex(randomBytes(8)));
+    TmpDir td = tdm.tmpDir("streams");
+    std::string metaPath = td.getName() + "/stream.xdr";
+
+    // A path rather than a file descriptor, as two applications open it
+    Config cfg = getTestConfig(0, Config::TESTDB_ON_DISK_SQLITE);
+    cfg.METADATA_OUTPUT_STREAM = metaPath;
+    cfg.setMetadataOnlyMode();
+
+    SECTION("requires a meta stream")
+    {
+        VirtualClock clock;
+        cfg.METADATA_OUTPUT_STREAM = "";
+        REQUIRE_THROWS_AS(createTestApplication(clock, cfg),
+                          std::invalid_argument);
+    }
+
+    SECTION("closes ledgers and restarts from the last one")
+    {
+        Hash lclHash;
+        {
+            VirtualClock clock;
+            auto app = createTestApplication(clock, cfg);
+            auto root = TestAccount::createRoot(*app);
+            auto tx = root.tx({txtest::createAccount(
+                SecretKey::pseudoRandomForTesting().getPublicKey(),
+                app->getLedgerManager().getLastMinBalance(0))});
+            closeLedger(*app, {tx});
+            closeLedger(*app);
+            lclHash = app->getLedgerManager().getLastClosedLedgerHeader().hash;
+
+            auto& sess = app->getDatabase().getSession();
+            int count = -1;
+            sess << "SELECT COUNT(*) FROM txhistory", soci::into(count);
+            REQUIRE(count == 0);
+            sess << "SELECT COUNT(*) FROM ledgerheaders", soci::into(count);
+            REQUIRE(count == 0);
+            REQUIRE(!app->getPersistentState()
+                         .getState(PersistentState::kLastClosedLedgerHeader)
+                         .empty());
+        }
+
+        VirtualClock clock;
+        auto app = createTestApplication(clock, cfg, /*newdb=*/false);
+        REQUIRE(app->getLedgerManager().getLastClosedLedgerHeader().hash ==
+                lclHash);
+    }
+}
+
 TEST_CASE("METADATA_DEBUG_LEDGERS works", "[metadebug]")
 {
     VirtualClock clock;
@@ -464,6 +753,19 @@ TEST_CASE("METADATA_DEBUG_LEDGERS works", "[metadebug]")
         }
         REQUIRE(sts.ledgerSeq == lm.getLastClosedLedgerNum());
 
+        // Every rotated segment has an index of the ledgers in it
+        for (auto const& file : metautils::listMetaDebugFiles(bucketDir))
+        {
+            if (std::regex_match(file.string(),
+                                 metautils::META_DEBUG_ZIP_FILE_REGEX))
+            {
+                auto index = metautils::readMetaDebugIndex(
+                    metautils::getMetaDebugIndexPath(debugFilePath / file));
+                REQUIRE(index);
+                REQUIRE(index->front().second == 0);
+            }
+        }
+
         // Now test replay from meta
         VirtualClock clock2;
         Config cfg2 = getTestConfig(1);
@@ -479,6 +781,40 @@ TEST_CASE("METADATA_DEBUG_LEDGERS works", "[metadebug]")
     }
 }
 
+TEST_CASE("meta-debug index", "[metadebug]")
+{
+    TmpDirManager tdm(std::string("metaindex-") + binToHex(randomBytes(8)));
+    TmpDir td = tdm.tmpDir("index");
+    std::filesystem::path segment =
+        std::filesystem::path(td.getName()) / "meta-debug-00000100-ab.xdr";
+    auto indexPath = metautils::getMetaDebugIndexPath(segment);
+    REQUIRE(indexPath == metautils::getMetaDebugIndexPath(
+                             std::filesystem::path(segment) += ".gz"));
+
+    REQUIRE(!metautils::readMetaDebugIndex(indexPath));
+
+    metautils::MetaDebugIndex index{{257, 0}, {258, 1000}, {259, 1500}};
+    metautils::writeMetaDebugIndex(indexPath, index);
+    REQUIRE(metautils::readMetaDebugIndex(indexPath) == index);
+    // The index is not mistaken for a segment
+    REQUIRE(!std::regex_match(indexPath.filename().string(),
+                              metautils::META_DEBUG_FILE_REGEX));
+
+    SECTION("out of order entries are rejected")
+    {
+        metautils::writeMetaDebugIndex(indexPath, {{257, 0}, {257, 1000}});
+        REQUIRE(!metautils::readMetaDebugIndex(indexPath));
+    }
+    SECTION("truncated index is rejected")
+    {
+        {
+            std::ofstream out(indexPath, std::ios::app);
+            out << "260";
+        }
+        REQUIRE(!metautils::readMetaDebugIndex(indexPath));
+    }
+}
+
 TEST_CASE_VERSIONS("meta stream contains reasonable meta", "[ledgerclosemeta]")
 {
     auto test = [&](Config cfg, bool isSoroban) {
@@ -3,12 +3,21 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "herder/Herder.h"
+#include "herder/TxSetFrame.h"
+#include "lib/json/json.h"
 #include "ledger/LedgerManager.h"
 #include "ledger/LedgerTxn.h"
 #include "main/Application.h"
+#include "crypto/SecretKey.h"
+#include "test/TestAccount.h"
+#include "test/TestUtils.h"
+#include "test/TxTests.h"
 #include "test/test.h"
 
 #include <lib/catch.hpp>
+#include <map>
+#include <medida/meter.h>
+#include <medida/metrics_registry.h>
 
 using namespace stellar;
 
@@ -45,3 +54,223 @@ TEST_CASE("cannot close ledger with unsupported ledger version", "[ledger]")
     }
     REQUIRE_THROWS_AS(applyEmptyLedger(), std::runtime_error);
 }
+
+TEST_CASE("pipelined ledger close", "[ledger]")
+{
+    VirtualClock clock;
+    auto cfg = getTestConfig(0);
+    auto pipelinedCfg = getTestConfig(1);
+    pipelinedCfg.EXPERIMENTAL_PIPELINED_LEDGER_CLOSE = true;
+    Application::pointer app = createTestApplication(clock, cfg);
+    Application::pointer pipelinedApp =
+        createTestApplication(clock, pipelinedCfg);
+
+    // Closing back to back without cranking has to run the post-close steps
+    // of the previous ledger first
+    for (int i = 0; i < 20; ++i)
+    {
+        txtest::closeLedger(*app);
+        txtest::closeLedger(*pipelinedApp);
+        if (i % 4 == 0)
+        {
+            clock.crank(false);
+        }
+    }
+
+    auto const& lcl = app->getLedgerManager().getLastClosedLedgerHeader();
+    auto const& pipelinedLcl =
+        pipelinedApp->getLedgerManager().getLastClosedLedgerHeader();
+    REQUIRE(lcl.header.ledgerSeq == pipelinedLcl.header.ledgerSeq);
+    REQUIRE(lcl.header.bucketListHash == pipelinedLcl.header.bucketListHash);
+}
+
+TEST_CASE("parallel signature verification", "[ledger]")
+{
+    VirtualClock clock;
+    auto cfg = getTestConfig(0);
+    cfg.EXPERIMENTAL_PARALLEL_SIGNATURE_VERIFICATION = true;
+    Application::pointer app = createTestApplication(clock, cfg);
+
+    using namespace txtest;
+    auto root = TestAccount::createRoot(*app);
+    auto minBalance = app->getLedgerManager().getLastMinBalance(0) * 10;
+    auto a1 = root.create("a1", minBalance);
+    auto a2 = root.create("a2", minBalance);
+
+    std::vector<TransactionFrameBasePtr> txs;
+    for (int i = 0; i < 100; ++i)
+    {
+        txs.emplace_back(a1.tx({payment(a2, 1)}));
+    }
+    txs.emplace_back(feeBump(*app, a2, root.tx({payment(a1, 1)}), 1000));
+
+    PubKeyUtils::clearVerifySigCache();
+    uint64_t hits = 0, misses = 0;
+    PubKeyUtils::flushVerifySigCacheCounts(hits, misses);
+
+    auto results = closeLedger(*app, txs, /* strictOrder */ true);
+    REQUIRE(results.size() == txs.size());
+    for (auto const& [result, fees] : results)
+    {
+        REQUIRE(result.result.result.code() == txSUCCESS);
+    }
+
+    // Every signature was verified ahead of apply, and apply found the
+    // cached results
+    PubKeyUtils::flushVerifySigCacheCounts(hits, misses);
+    REQUIRE(misses >= txs.size() + 1);
+    REQUIRE(hits >= txs.size() + 1);
+}
+
+TEST_CASE("speculative tx set preparation", "[ledger]")
+{
+    VirtualClock clock;
+    auto cfg = getTestConfig(0);
+    cfg.EXPERIMENTAL_SPECULATIVE_TX_SET_PREPARATION = true;
+    Application::pointer app = createTestApplication(clock, cfg);
+    auto& lm = app->getLedgerManager();
+    auto& hit = app->getMetrics().NewMeter({"ledger", "speculative", "hit"},
+                                           "txset");
+    auto& miss = app->getMetrics().NewMeter({"ledger", "speculative", "miss"},
+                                            "txset");
+
+    using namespace txtest;
+    auto root = TestAccount::createRoot(*app);
+    auto minBalance = app->getLedgerManager().getLastMinBalance(0) * 10;
+    auto a1 = root.create("a1", minBalance);
+    auto a2 = root.create("a2", minBalance);
+
+    TxSetTransactions txs;
+    for (int i = 0; i < 20; ++i)
+    {
+        txs.emplace_back(a1.tx({payment(a2, 1)}));
+    }
+    auto txSet = makeTxSetFromTransactions(txs, *app, 0, 0).first;
+    auto otherTxSet =
+        makeTxSetFromTransactions(
+            TxSetTransactions(txs.begin(), txs.begin() + 5), *app, 0, 0)
+            .first;
+
+    // Balloting switching between tx sets drops the earlier one
+    lm.startSpeculativeTxSetPreparation(otherTxSet);
+    lm.startSpeculativeTxSetPreparation(txSet);
+    lm.startSpeculativeTxSetPreparation(txSet);
+    REQUIRE(miss.count() == 1);
+    REQUIRE(hit.count() == 0);
+
+    auto results = closeLedger(*app, txSet);
+    REQUIRE(results.size() == txs.size());
+    for (auto const& [result, fees] : results)
+    {
+        REQUIRE(result.result.result.code() == txSUCCESS);
+    }
+    REQUIRE(hit.count() == 1);
+    REQUIRE(miss.count() == 1);
+
+    // Tx sets that do not build on the LCL are ignored
+    lm.startSpeculativeTxSetPreparation(otherTxSet);
+    closeLedger(*app);
+    REQUIRE(hit.count() == 1);
+    REQUIRE(miss.count() == 1);
+
+    // Externalizing a different tx set than the prepared one
+    TxSetTransactions nextTxs{a1.tx({payment(a2, 1)})};
+    auto next = makeTxSetFromTransactions(nextTxs, *app, 0, 0).first;
+    lm.startSpeculativeTxSetPreparation(next);
+    closeLedger(*app);
+    REQUIRE(hit.count() == 1);
+    REQUIRE(miss.count() == 2);
+}
+
+TEST_CASE("ledger apply trace", "[ledger]")
+{
+    VirtualClock clock;
+    auto cfg = getTestConfig(0);
+    cfg.APPLY_TRACE_LEDGERS = 2;
+    Application::pointer app = createTestApplication(clock, cfg);
+    auto& lm = app->getLedgerManager();
+
+    using namespace txtest;
+    auto root = TestAccount::createRoot(*app);
+    auto minBalance = lm.getLastMinBalance(0) * 10;
+    auto a1 = root.create("a1", minBalance);
+    auto a2 = root.create("a2", minBalance);
+
+    std::vector<TransactionFrameBasePtr> txs;
+    for (int i = 0; i < 5; ++i)
+    {
+        txs.emplace_back(a1.tx({payment(a2, 1), payment(root, 1)}));
+    }
+    closeLedger(*app, txs);
+    auto ledgerSeq = lm.getLastClosedLedgerNum();
+
+    auto trace = lm.getApplyTrace(std::nullopt);
+    REQUIRE(trace);
+    REQUIRE(trace == lm.getApplyTrace(ledgerSeq));
+
+    Json::Value json;
+    REQUIRE(Json::Reader().parse(*trace, json));
+    REQUIRE(json["otherData"]["ledgerSeq"].asUInt() == ledgerSeq);
+    auto const& events = json["traceEvents"];
+    std::map<std::string, size_t> counts;
+    for (auto const& e : events)
+    {
+        ++counts[e["name"].asString()];
+        REQUIRE(e["ph"].asString() == "X");
+        REQUIRE(e["dur"].asDouble() >= 0);
+        if (e["name"].asString() == "tx")
+        {
+            REQUIRE(e["args"]["success"].asBool());
+            REQUIRE(e["args"]["detail"].asString().size() == 64);
+        }
+    }
+    REQUIRE(counts["ledger"] == 1);
+    REQUIRE(counts["fees"] == 1);
+    REQUIRE(counts["tx"] == txs.size());
+    REQUIRE(counts["PAYMENT"] == 2 * txs.size());
+
+    // Only the last APPLY_TRACE_LEDGERS ledgers are kept
+    closeLedger(*app);
+    closeLedger(*app);
+    REQUIRE(!lm.getApplyTrace(ledgerSeq));
+    REQUIRE(lm.getApplyTrace(ledgerSeq + 2));
+}
+
+TEST_CASE("ledger apply stats", "[ledger]")
+{
+    VirtualClock clock;
+    Application::pointer app = createTestApplication(clock, getTestConfig(0));
+    auto& lm = app->getLedgerManager();
+
+    using namespace txtest;
+    auto root = TestAccount::createRoot(*app);
+    auto minBalance = lm.getLastMinBalance(0) * 10;
+    auto a1 = root.create("a1", minBalance);
+    auto a2 = root.create("a2", minBalance);
+
+    std::vector<LedgerManager::ApplyStats> stats;
+    lm.setApplyStatsCallback(
+        [&](LedgerManager::ApplyStats const& s) { stats.emplace_back(s); });
+
+    std::vector<TransactionFrameBasePtr> txs;
+    for (int i = 0; i < 3; ++i)
+    {
+        txs.emplace_back(a1.tx({payment(a2, 1), bumpSequence(0)}));
+    }
+    closeLedger(*app, txs);
+    closeLedger(*app);
+
+    REQUIRE(stats.size() == 2);
+    REQUIRE(stats[0].mLedgerSeq + 1 == lm.getLastClosedLedgerNum());
+    REQUIRE(stats[0].mTxCount == 3);
+    REQUIRE(stats[0].mOpCount == 6);
+    REQUIRE(stats[0].mApplyTime.count() > 0);
+    REQUIRE(stats[0].mOpTypeCounts ==
+            std::map<OperationType, size_t>{{PAYMENT, 3}, {BUMP_SEQUENCE, 3}});
+    REQUIRE(stats[1].mTxCount == 0);
+    REQUIRE(stats[1].mOpTypeCounts.empty());
+
+    lm.setApplyStatsCallback(nullptr);
+    closeLedger(*app);
+    REQUIRE(stats.size() == 2);
+}
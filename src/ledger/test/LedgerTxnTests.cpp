@@ -2,6 +2,11 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
+#include "bucket/Bucket.h"
+#include "bucket/BucketListSnapshot.h"
+#include "bucket/BucketManager.h"
+#include "bucket/test/BucketTestUtils.h"
+#include "ledger/CompactLedgerEntryIndex.h"
 #include "ledger/LedgerTxn.h"
 #include "ledger/LedgerTxnEntry.h"
 #include "ledger/LedgerTxnHeader.h"
@@ -15,6 +20,7 @@
 #include "test/TxTests.h"
 #include "test/test.h"
 #include "transactions/TransactionUtils.h"
+#include "util/Fs.h"
 #include "util/Math.h"
 #include "util/XDROperators.h"
 #include <algorithm>
@@ -422,7 +428,8 @@ TEST_CASE("LedgerTxn round trip", "[ledgertxn]")
         }
     };
 
-    auto runTest = [&](AbstractLedgerTxnParent& ltxParent) {
+    auto runTest = [&](AbstractLedgerTxnParent& ltxParent,
+                       TransactionMode txMode) {
         UnorderedMap<LedgerKey, LedgerEntry> entries;
         UnorderedSet<LedgerKey> dead;
         size_t const NUM_BATCHES = 10;
@@ -432,7 +439,7 @@ TEST_CASE("LedgerTxn round trip", "[ledgertxn]")
 
             UnorderedMap<LedgerKey, LedgerEntry> updatedEntries = entries;
             UnorderedSet<LedgerKey> updatedDead = dead;
-            LedgerTxn ltx1(ltxParent);
+            LedgerTxn ltx1(ltxParent, true, txMode);
             generateNew(ltx1, updatedEntries);
             generateModify(ltx1, updatedEntries);
             generateErase(ltx1, updatedEntries, updatedDead);
@@ -453,7 +460,7 @@ TEST_CASE("LedgerTxn round trip", "[ledgertxn]")
             auto app = createTestApplication(clock, getTestConfig(0, mode));
 
             LedgerTxn ltx1(app->getLedgerTxnRoot());
-            runTest(ltx1);
+            runTest(ltx1, TransactionMode::READ_WRITE_WITH_SQL_TXN);
         }
 
         SECTION("round trip to LedgerTxnRoot")
@@ -463,7 +470,8 @@ TEST_CASE("LedgerTxn round trip", "[ledgertxn]")
                 VirtualClock clock;
                 auto app = createTestApplication(clock, getTestConfig(0, mode));
 
-                runTest(app->getLedgerTxnRoot());
+                runTest(app->getLedgerTxnRoot(),
+                        TransactionMode::READ_WRITE_WITH_SQL_TXN);
             }
 
             SECTION("with no cache")
@@ -473,7 +481,17 @@ TEST_CASE("LedgerTxn round trip", "[ledgertxn]")
                 cfg.ENTRY_CACHE_SIZE = 0;
                 auto app = createTestApplication(clock, cfg);
 
-                runTest(app->getLedgerTxnRoot());
+                runTest(app->getLedgerTxnRoot(),
+                        TransactionMode::READ_WRITE_WITH_SQL_TXN);
+            }
+
+            SECTION("with bulk loads")
+            {
+                VirtualClock clock;
+                auto app = createTestApplication(clock, getTestConfig(0, mode));
+
+                runTest(app->getLedgerTxnRoot(),
+                        TransactionMode::BULK_LOAD_WITH_SQL_TXN);
             }
         }
     };
@@ -1558,6 +1576,62 @@ TEST_CASE("LedgerTxn loadWithoutRecord", "[ledgertxn]")
     }
 }
 
+TEST_CASE("LedgerTxn getNewestVersionEncodedSize", "[ledgertxn]")
+{
+    VirtualClock clock;
+    auto app = createTestApplication(clock, getTestConfig());
+
+    LedgerEntry le = LedgerTestUtils::generateValidLedgerEntryWithExclusions(
+        {CONFIG_SETTING});
+    le.lastModifiedLedgerSeq = 1;
+    LedgerKey key = LedgerEntryKey(le);
+    auto size = static_cast<uint32_t>(xdr::xdr_size(le));
+
+    SECTION("when key does not exist")
+    {
+        REQUIRE(app->getLedgerTxnRoot().getNewestVersionEncodedSize(key) ==
+                0);
+        LedgerTxn ltx1(app->getLedgerTxnRoot());
+        REQUIRE(ltx1.getNewestVersionEncodedSize(key) == 0);
+    }
+
+    SECTION("when key exists in parent")
+    {
+        LedgerTxn ltx1(app->getLedgerTxnRoot());
+        REQUIRE(ltx1.create(le));
+        REQUIRE(ltx1.getNewestVersionEncodedSize(key) == size);
+
+        LedgerTxn ltx2(ltx1);
+        REQUIRE(ltx2.getNewestVersionEncodedSize(key) == size);
+        validate(ltx2, {});
+    }
+
+    SECTION("when key is modified in child")
+    {
+        LedgerTxn ltx1(app->getLedgerTxnRoot());
+        REQUIRE(ltx1.create(le));
+
+        LedgerTxn ltx2(ltx1);
+        auto ltxe = ltx2.load(key);
+        ltxe.current().ext.v(le.ext.v() == 0 ? 1 : 0);
+        auto newSize = static_cast<uint32_t>(xdr::xdr_size(ltxe.current()));
+        REQUIRE(newSize != size);
+        REQUIRE(ltx2.getNewestVersionEncodedSize(key) == newSize);
+    }
+
+    SECTION("when key is erased in parent")
+    {
+        LedgerTxn ltx1(app->getLedgerTxnRoot());
+        REQUIRE(ltx1.create(le));
+
+        LedgerTxn ltx2(ltx1);
+        REQUIRE_NOTHROW(ltx2.erase(key));
+
+        LedgerTxn ltx3(ltx2);
+        REQUIRE(ltx3.getNewestVersionEncodedSize(key) == 0);
+    }
+}
+
 static void
 applyLedgerTxnUpdates(
     AbstractLedgerTxn& ltx,
@@ -1964,6 +2038,19 @@ testBestOffer(
         testAtRoot(*app);
     }
 
+    // first changes are in LedgerTxnRoot with an in-memory order book that
+    // was loaded before they were committed
+    if (updates.size() > 1)
+    {
+        VirtualClock clock;
+        auto cfg = getTestConfig(0, mode);
+        cfg.EXPERIMENTAL_IN_MEMORY_ORDERBOOK = true;
+        auto app = createTestApplication(clock, cfg);
+
+        REQUIRE(!app->getLedgerTxnRoot().getBestOffer(buying, selling));
+        testAtRoot(*app);
+    }
+
     // first changes are in child of LedgerTxnRoot
     {
         VirtualClock clock;
@@ -2507,6 +2594,51 @@ TEST_CASE("LedgerTxn unsealHeader", "[ledgertxn]")
     }
 }
 
+TEST_CASE("LedgerTxn getAllEntries is sorted", "[ledgertxn]")
+{
+    VirtualClock clock;
+    auto app = createTestApplication(clock, getTestConfig());
+
+    auto entries = LedgerTestUtils::generateValidUniqueLedgerEntriesWithTypes(
+        {ACCOUNT, TRUSTLINE, DATA, CLAIMABLE_BALANCE, CONTRACT_DATA}, 150);
+    LedgerTxn ltx(app->getLedgerTxnRoot());
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        switch (i % 3)
+        {
+        case 0:
+            ltx.createWithoutLoading(entries[i]);
+            break;
+        case 1:
+            ltx.updateWithoutLoading(entries[i]);
+            break;
+        default:
+            ltx.eraseWithoutLoading(LedgerEntryKey(entries[i]));
+        }
+    }
+
+    std::vector<LedgerEntry> init, live;
+    std::vector<LedgerKey> dead;
+    ltx.getAllEntries(init, live, dead);
+    REQUIRE(init.size() == 50);
+    REQUIRE(live.size() == 50);
+    REQUIRE(dead.size() == 50);
+
+    LedgerEntryIdCmp cmp;
+    auto entryCmp = [&cmp](LedgerEntry const& a, LedgerEntry const& b) {
+        return !cmp(a.data, b.data);
+    };
+    auto keyCmp = [&cmp](LedgerKey const& a, LedgerKey const& b) {
+        return !cmp(a, b);
+    };
+    REQUIRE(std::adjacent_find(init.begin(), init.end(), entryCmp) ==
+            init.end());
+    REQUIRE(std::adjacent_find(live.begin(), live.end(), entryCmp) ==
+            live.end());
+    REQUIRE(std::adjacent_find(dead.begin(), dead.end(), keyCmp) ==
+            dead.end());
+}
+
 TEST_CASE("LedgerTxnEntry and LedgerTxnHeader move assignment", "[ledgertxn]")
 {
     VirtualClock clock;
@@ -2662,6 +2794,48 @@ TEST_CASE("LedgerTxnRoot prefetch", "[ledgertxn]")
             REQUIRE(root.prefetch(keysToPrefetch) == keysToPrefetch.size());
             ltx2.commit();
         }
+        SECTION("prefetch loaded entries")
+        {
+            LedgerKeySet smallSet;
+            std::vector<LedgerEntry> loaded;
+            for (auto const& e : entrySet)
+            {
+                smallSet.emplace(LedgerEntryKey(e));
+                loaded.emplace_back(e);
+                if (smallSet.size() > (cfg.ENTRY_CACHE_SIZE / 3))
+                {
+                    break;
+                }
+            }
+
+            // A missing key is cached as not existing
+            auto missing = LedgerTestUtils::generateValidLedgerEntry();
+            while (keysToPrefetch.count(LedgerEntryKey(missing)) != 0)
+            {
+                missing = LedgerTestUtils::generateValidLedgerEntry();
+            }
+            smallSet.emplace(LedgerEntryKey(missing));
+
+            auto ledgerSeq = app->getLedgerManager().getLastClosedLedgerNum();
+
+            // Results for any other ledger are dropped
+            REQUIRE(root.prefetchLoaded(smallSet, loaded, ledgerSeq + 1) == 0);
+            REQUIRE(root.prefetchLoaded(smallSet, loaded, ledgerSeq) ==
+                    smallSet.size());
+
+            // Keys that are cached already are left alone
+            REQUIRE(root.prefetchLoaded(smallSet, loaded, ledgerSeq) == 0);
+
+            LedgerTxn ltx2(root);
+            for (auto const& e : loaded)
+            {
+                auto txle = ltx2.load(LedgerEntryKey(e));
+                REQUIRE(txle);
+                REQUIRE(txle.current() == e);
+            }
+            REQUIRE(!ltx2.load(LedgerEntryKey(missing)));
+            REQUIRE(fabs(ltx2.getPrefetchHitRate() - 1.0f) < 0.0001f);
+        }
     };
 
     SECTION("default")
@@ -2677,6 +2851,52 @@ TEST_CASE("LedgerTxnRoot prefetch", "[ledgertxn]")
 #endif
 }
 
+TEST_CASE("LedgerTxnRoot entry cache keys persist across restarts",
+          "[ledgertxn]")
+{
+    VirtualClock clock;
+    auto cfg = getTestConfig();
+    cfg.PERSIST_ENTRY_CACHE_KEYS = true;
+    auto app = createTestApplication(clock, cfg);
+    auto& root = dynamic_cast<LedgerTxnRoot&>(app->getLedgerTxnRoot());
+
+    auto entries = LedgerTestUtils::generateValidUniqueLedgerEntries(10);
+    {
+        LedgerTxn ltx(root);
+        for (auto const& e : entries)
+        {
+            ltx.createWithoutLoading(e);
+        }
+        ltx.commit();
+    }
+
+    // Loading caches the entries, which are kept through the commit
+    {
+        LedgerTxn ltx(root);
+        for (auto const& e : entries)
+        {
+            REQUIRE(ltx.load(LedgerEntryKey(e)));
+        }
+        ltx.commit();
+    }
+
+    auto path =
+        std::filesystem::path(cfg.BUCKET_DIR_PATH) / "entry-cache-keys.xdr";
+    root.saveEntryCacheKeys(path);
+    REQUIRE(fs::exists(path.string()));
+
+    REQUIRE(root.warmEntryCache(path) == entries.size());
+    REQUIRE(!fs::exists(path.string()));
+    REQUIRE(root.warmEntryCache(path) == 0);
+
+    LedgerTxn ltx(root);
+    for (auto const& e : entries)
+    {
+        REQUIRE(ltx.load(LedgerEntryKey(e)));
+    }
+    REQUIRE(fabs(ltx.getPrefetchHitRate() - 1.0f) < 0.0001f);
+}
+
 TEST_CASE("Create performance benchmark", "[!hide][createbench]")
 {
     auto runTest = [&](Config::TestDbMode mode, bool loading) {
@@ -3888,6 +4108,121 @@ TEST_CASE("LedgerTxn best offers cache eviction", "[ledgertxn]")
     }
 }
 
+TEST_CASE("LedgerTxnRoot in-memory order book", "[ledgertxn]")
+{
+    VirtualClock clock;
+    auto cfg = getTestConfig(0);
+    cfg.EXPERIMENTAL_IN_MEMORY_ORDERBOOK = true;
+    auto app = createTestApplication(clock, cfg);
+    auto& root = app->getLedgerTxnRoot();
+
+    std::vector<Asset> assets;
+    while (assets.size() < 3)
+    {
+        auto asset = autocheck::generator<Asset>()(UINT32_MAX);
+        if (std::find(assets.begin(), assets.end(), asset) == assets.end())
+        {
+            assets.emplace_back(asset);
+        }
+    }
+
+    auto randomize = [&](OfferEntry& oe) {
+        oe.buying = rand_element(assets);
+        do
+        {
+            oe.selling = rand_element(assets);
+        } while (oe.selling == oe.buying);
+        oe.price =
+            Price{rand_uniform<int32_t>(1, 4), rand_uniform<int32_t>(1, 4)};
+    };
+
+    // Walk the best offers of every asset pair and compare them to all offers
+    // in the database, sorted
+    auto check = [&]() {
+        auto all = root.getAllOffers();
+        for (auto const& buying : assets)
+        {
+            for (auto const& selling : assets)
+            {
+                if (buying == selling)
+                {
+                    continue;
+                }
+
+                std::vector<LedgerEntry> expected;
+                for (auto const& kv : all)
+                {
+                    auto const& oe = kv.second.data.offer();
+                    if (oe.buying == buying && oe.selling == selling)
+                    {
+                        expected.emplace_back(kv.second);
+                    }
+                }
+                std::sort(expected.begin(), expected.end(),
+                          [](LedgerEntry const& lhs, LedgerEntry const& rhs) {
+                              return isBetterOffer(lhs, rhs);
+                          });
+
+                std::vector<LedgerEntry> actual;
+                for (auto le = root.getBestOffer(buying, selling); le;)
+                {
+                    actual.emplace_back(*le);
+                    auto const& oe = le->data.offer();
+                    le = root.getBestOffer(buying, selling,
+                                           {oe.price, oe.offerID});
+                }
+                REQUIRE(actual == expected);
+            }
+        }
+    };
+
+    check();
+
+    int64_t nextOfferID = 1;
+    for (size_t i = 0; i < 5; ++i)
+    {
+        auto existing = root.getAllOffers();
+        {
+            LedgerTxn ltx(root);
+            for (auto const& kv : existing)
+            {
+                auto ltxe = ltx.load(kv.first);
+                switch (rand_uniform(0, 3))
+                {
+                case 0:
+                    break;
+                case 1:
+                    ltxe.current().data.offer().price.n++;
+                    break;
+                case 2:
+                    randomize(ltxe.current().data.offer());
+                    break;
+                default:
+                    ltxe.erase();
+                }
+            }
+
+            for (size_t j = 0; j < 20; ++j)
+            {
+                LedgerEntry le;
+                le.data.type(OFFER);
+                auto& oe = le.data.offer();
+                oe = LedgerTestUtils::generateValidOfferEntry();
+                oe.offerID = nextOfferID++;
+                randomize(oe);
+                ltx.create(le);
+            }
+
+            // Changes that are rolled back do not reach the order book
+            if (i != 2)
+            {
+                ltx.commit();
+            }
+        }
+        check();
+    }
+}
+
 typedef std::map<std::tuple<AccountID, Asset, Asset>, int64_t> PoolShareUpdates;
 typedef std::map<std::pair<Asset, Asset>, int64_t> LiquidityPoolUpdates;
 
@@ -4258,6 +4593,69 @@ TEST_CASE("InMemoryLedgerTxn getOffersByAccountAndAsset", "[ledgertxn]")
     }
 }
 
+TEST_CASE("LedgerTxnRoot offers in BucketListDB", "[ledgertxn][bucketindex]")
+{
+    VirtualClock clock;
+    Config cfg = getTestConfig();
+    cfg.DEPRECATED_SQL_LEDGER_STATE = false;
+    cfg.EXPERIMENTAL_OFFERS_IN_BUCKETLIST_DB = true;
+
+    auto app = createTestApplication(clock, cfg);
+    auto& ltxRoot = app->getLedgerTxnRoot();
+
+    auto root = TestAccount::createRoot(*app);
+    auto const& lm = app->getLedgerManager();
+    auto const minBalance15 = lm.getLastMinBalance(15);
+
+    auto native = txtest::makeNativeAsset();
+    auto cur1 = txtest::makeAsset(root, "CUR1");
+    auto cur2 = txtest::makeAsset(root, "CUR2");
+
+    auto a1 = root.create("a1", minBalance15);
+    auto a2 = root.create("a2", minBalance15);
+
+    a1.changeTrust(cur1, 100);
+    a1.changeTrust(cur2, 100);
+    a2.changeTrust(cur1, 100);
+    a2.changeTrust(cur2, 100);
+
+    root.pay(a1, cur1, 10);
+    root.pay(a2, cur1, 10);
+
+    auto o1 = a1.manageOffer(0, cur1, native, Price{2, 1}, 1,
+                             MANAGE_OFFER_CREATED);
+    a1.manageOffer(0, cur1, cur2, Price{2, 1}, 1, MANAGE_OFFER_CREATED);
+    auto o3 = a2.manageOffer(0, cur1, native, Price{1, 1}, 1,
+                             MANAGE_OFFER_CREATED);
+    a2.manageOffer(0, cur1, cur2, Price{2, 1}, 1, MANAGE_OFFER_CREATED);
+    a2.manageOffer(o3, cur1, native, Price{3, 1}, 1, MANAGE_OFFER_UPDATED);
+    a1.manageOffer(o1, cur1, native, Price{2, 1}, 0, MANAGE_OFFER_DELETED);
+
+    auto check = [&]() {
+        REQUIRE(ltxRoot.getAllOffers().size() == 3);
+        REQUIRE(ltxRoot.getOffersByAccountAndAsset(a1, cur1).size() == 1);
+        REQUIRE(ltxRoot.getOffersByAccountAndAsset(a2, cur1).size() == 2);
+        REQUIRE(ltxRoot.getOffersByAccountAndAsset(a2, native).size() == 1);
+
+        auto best = ltxRoot.getBestOffer(native, cur1);
+        REQUIRE(best);
+        REQUIRE(best->data.offer().offerID == o3);
+        REQUIRE(best->data.offer().price == Price{3, 1});
+        REQUIRE(!ltxRoot.getBestOffer(native, cur1, {Price{3, 1}, o3}));
+    };
+
+    // The order book was kept up to date as ledgers closed
+    check();
+
+    // And is loaded from the BucketList again once dropped
+    ltxRoot.dropOffers(false);
+    auto searchableBL = app->getBucketManager()
+                            .getBucketSnapshotManager()
+                            .getSearchableBucketListSnapshot();
+    REQUIRE(searchableBL->loadAllOffers().size() == 3);
+    check();
+}
+
 TEST_CASE("InMemoryLedgerTxn getPoolShareTrustLinesByAccountAndAsset",
           "[ledgertxn]")
 {
@@ -4308,6 +4706,137 @@ TEST_CASE("InMemoryLedgerTxn getPoolShareTrustLinesByAccountAndAsset",
     }
 }
 
+TEST_CASE("CompactLedgerEntryIndex", "[ledgertxn]")
+{
+    auto entries = LedgerTestUtils::generateValidUniqueLedgerEntriesWithTypes(
+        {ACCOUNT, TRUSTLINE, OFFER, CONTRACT_DATA, CONTRACT_CODE}, 200);
+
+    CompactLedgerEntryIndex index;
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        auto const& le = entries[i];
+        REQUIRE(index.addIfNew(LedgerEntryKey(le), i % 4 == 0 ? nullptr : &le));
+    }
+    REQUIRE(index.size() == entries.size());
+    REQUIRE(index.liveEntries() == entries.size() * 3 / 4);
+
+    // Keys can only be added once, the first version wins
+    auto newer = entries[1];
+    newer.lastModifiedLedgerSeq++;
+    REQUIRE(!index.addIfNew(LedgerEntryKey(newer), &newer));
+    REQUIRE(!index.addIfNew(LedgerEntryKey(entries[2]), nullptr));
+    REQUIRE(index.size() == entries.size());
+
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        LedgerEntry le;
+        auto found = index.load(LedgerEntryKey(entries[i]), le);
+        REQUIRE(found == (i % 4 != 0));
+        if (found)
+        {
+            REQUIRE(le == entries[i]);
+        }
+    }
+
+    LedgerEntry le;
+    auto missing = LedgerTestUtils::generateValidLedgerEntryOfType(DATA);
+    REQUIRE(!index.load(LedgerEntryKey(missing), le));
+}
+
+TEST_CASE("InMemoryLedgerTxn seeded from buckets", "[ledgertxn]")
+{
+    VirtualClock clock;
+    Config cfg = getTestConfig();
+    cfg.MODE_USES_IN_MEMORY_LEDGER = true;
+    cfg.EXPERIMENTAL_IN_MEMORY_LEDGER_INDEX = true;
+
+    auto app = createTestApplication(clock, cfg);
+    auto& bm = app->getBucketManager();
+    auto version = BucketTestUtils::getAppLedgerVersion(app);
+
+    auto entries = LedgerTestUtils::generateValidUniqueLedgerEntriesWithTypes(
+        {ACCOUNT, TRUSTLINE, DATA, CONTRACT_DATA}, 100);
+    auto offer = LedgerTestUtils::generateValidLedgerEntryOfType(OFFER);
+    auto const& seller = offer.data.offer().sellerID;
+
+    // The newer bucket updates the first 10 entries, erases the next 10 and
+    // erases the offer
+    std::vector<LedgerEntry> updated(entries.begin(), entries.begin() + 10);
+    for (auto& le : updated)
+    {
+        le.lastModifiedLedgerSeq++;
+    }
+    std::vector<LedgerKey> erased;
+    for (size_t i = 10; i < 20; ++i)
+    {
+        erased.emplace_back(LedgerEntryKey(entries[i]));
+    }
+
+    auto olderEntries = entries;
+    olderEntries.emplace_back(offer);
+    auto older = Bucket::fresh(bm, version, olderEntries, {}, {},
+                               /*countMergeEvents=*/true, clock.getIOContext(),
+                               /*doFsync=*/true);
+
+    auto lcl = app->getLedgerManager().getLastClosedLedgerNum();
+    auto check = [&](bool offerErased) {
+        {
+            LedgerTxn ltx(app->getLedgerTxnRoot());
+            REQUIRE(ltx.loadHeader().current().ledgerSeq == lcl);
+            for (size_t i = 0; i < entries.size(); ++i)
+            {
+                auto ltxe = ltx.load(LedgerEntryKey(entries[i]));
+                if (i < 10)
+                {
+                    REQUIRE(ltxe.current() == updated[i]);
+                }
+                else if (i < 20)
+                {
+                    REQUIRE(!ltxe);
+                }
+                else
+                {
+                    REQUIRE(ltxe.current() == entries[i]);
+                }
+            }
+        }
+        auto offers = app->getLedgerTxnRoot().getOffersByAccountAndAsset(
+            seller, offer.data.offer().selling);
+        REQUIRE(offers.size() == (offerErased ? 0 : 1));
+    };
+
+    SECTION("offer is live")
+    {
+        auto newer = Bucket::fresh(bm, version, {}, updated, erased,
+                                   /*countMergeEvents=*/true,
+                                   clock.getIOContext(), /*doFsync=*/true);
+        app->seedInMemoryLedgerState({newer, older});
+        check(false);
+
+        SECTION("changes are served before the index")
+        {
+            {
+                LedgerTxn ltx(app->getLedgerTxnRoot());
+                ltx.erase(LedgerEntryKey(entries[0]));
+                ltx.commit();
+            }
+            LedgerTxn ltx(app->getLedgerTxnRoot());
+            REQUIRE(!ltx.load(LedgerEntryKey(entries[0])));
+            REQUIRE(ltx.load(LedgerEntryKey(entries[1])));
+        }
+    }
+
+    SECTION("offer is erased")
+    {
+        erased.emplace_back(LedgerEntryKey(offer));
+        auto newer = Bucket::fresh(bm, version, {}, updated, erased,
+                                   /*countMergeEvents=*/true,
+                                   clock.getIOContext(), /*doFsync=*/true);
+        app->seedInMemoryLedgerState({newer, older});
+        check(true);
+    }
+}
+
 TEST_CASE_VERSIONS("InMemoryLedgerTxn close multiple ledgers with merges",
                    "[ledgertxn]")
 {
@@ -5,12 +5,14 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "main/Config.h"
+#include "util/WorkerThreadPool.h"
 #include "xdr/Stellar-ledger-entries.h"
 #include "xdr/Stellar-types.h"
 #include <lib/json/json.h>
 #include <memory>
 #include <optional>
 #include <string>
+#include <vector>
 
 namespace asio
 {
@@ -42,8 +44,10 @@ class CommandHandler;
 class WorkScheduler;
 class BanManager;
 class StatusManager;
+class FlightRecorder;
 class AbstractLedgerTxnParent;
 class BasicWork;
+class Bucket;
 enum class LoadGenMode;
 struct GeneratedLoadConfig;
 
@@ -171,6 +175,12 @@ class Application
     // (to be used before applying buckets)
     virtual void resetLedgerState() = 0;
 
+    // In-memory mode with EXPERIMENTAL_IN_MEMORY_LEDGER_INDEX only: replace
+    // the ledger state with the entries of buckets, ordered from newest to
+    // oldest, keeping the current ledger header
+    virtual void seedInMemoryLedgerState(
+        std::vector<std::shared_ptr<Bucket const>> const& buckets) = 0;
+
     // Return the time in seconds since the POSIX epoch, according to the
     // VirtualClock this Application is bound to. Convenience method.
     virtual uint64_t timeNow() = 0;
@@ -199,6 +209,10 @@ class Application
     // Call syncOwnMetrics on self and syncMetrics all objects owned by App.
     virtual void syncAllMetrics() = 0;
 
+    // Republish the status the query server answers read-only HTTP routes
+    // from, if it runs. Called after each ledger close.
+    virtual void publishStatus() = 0;
+
     // Clear all metrics
     virtual void clearMetrics(std::string const& domain) = 0;
 
@@ -221,26 +235,38 @@ class Application
     virtual WorkScheduler& getWorkScheduler() = 0;
     virtual BanManager& getBanManager() = 0;
     virtual StatusManager& getStatusManager() = 0;
+    virtual FlightRecorder& getFlightRecorder() = 0;
 
-    // Get the worker IO service, served by background threads. Work posted to
-    // this io_context will execute in parallel with the calling thread, so use
-    // with caution.
+    // An io_context for asio objects that are used synchronously off the
+    // main thread, such as resolvers and file streams. Nothing runs it, so
+    // work must be posted with postOnBackgroundThread instead.
     virtual asio::io_context& getWorkerIOContext() = 0;
-    virtual asio::io_context& getEvictionIOContext() = 0;
-    virtual asio::io_context& getOverlayIOContext() = 0;
+    // Background overlay processing runs on
+    // EXPERIMENTAL_BACKGROUND_OVERLAY_THREADS threads, each with its own
+    // io_context. A peer's socket and all tasks posted for it use the same one.
+    virtual asio::io_context& getOverlayIOContext(size_t overlayThread = 0) = 0;
+    // Overlay thread the next connection is assigned to, round robin
+    virtual size_t pickOverlayThread() = 0;
 
     virtual void postOnMainThread(
         std::function<void()>&& f, std::string&& name,
         Scheduler::ActionType type = Scheduler::ActionType::NORMAL_ACTION) = 0;
 
-    // While both are lower priority than the main thread, eviction threads have
-    // more priority than regular worker background threads
-    virtual void postOnBackgroundThread(std::function<void()>&& f,
-                                        std::string jobName) = 0;
-    virtual void postOnEvictionBackgroundThread(std::function<void()>&& f,
-                                                std::string jobName) = 0;
+    // Runs f on the worker thread pool, which is lower priority than the main
+    // thread. Use CRITICAL for jobs ledger close waits on and BULK for long
+    // jobs nothing waits on soon, so neither delays the other.
+    virtual void postOnBackgroundThread(
+        std::function<void()>&& f, std::string jobName,
+        WorkerPriority priority = WorkerPriority::NORMAL) = 0;
+    // Runs f on a dedicated merge thread if BUCKET_MERGE_THREADS > 0, and on
+    // a regular worker background thread otherwise. Among pending merge jobs,
+    // those with the lowest priority value are started first.
+    virtual void postOnMergeBackgroundThread(std::function<void()>&& f,
+                                             std::string jobName,
+                                             uint32_t priority) = 0;
     virtual void postOnOverlayThread(std::function<void()>&& f,
-                                     std::string jobName) = 0;
+                                     std::string jobName,
+                                     size_t overlayThread = 0) = 0;
 
     // Perform actions necessary to transition from BOOTING_STATE to other
     // states. In particular: either reload or reinitialize the database, and
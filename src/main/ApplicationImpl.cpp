@@ -33,6 +33,7 @@
 #include "invariant/InvariantManager.h"
 #include "invariant/LedgerEntryIsValid.h"
 #include "invariant/LiabilitiesMatchOffers.h"
+#include "invariant/OrderBookIsNotCrossed.h"
 #include "invariant/SponsorshipCountIsValid.h"
 #include "ledger/InMemoryLedgerTxn.h"
 #include "ledger/InMemoryLedgerTxnRoot.h"
@@ -43,6 +44,7 @@
 #include "main/CommandHandler.h"
 #include "main/ExternalQueue.h"
 #include "main/Maintainer.h"
+#include "main/QueryServer.h"
 #include "main/StellarCoreVersion.h"
 #include "medida/counter.h"
 #include "medida/meter.h"
@@ -55,6 +57,8 @@
 #include "process/ProcessManager.h"
 #include "scp/LocalNode.h"
 #include "scp/QuorumSetUtils.h"
+#include "util/ContentionProfiler.h"
+#include "util/FlightRecorder.h"
 #include "util/GlobalChecks.h"
 #include "util/LogSlowExecution.h"
 #include "util/Logging.h"
@@ -69,6 +73,8 @@
 #endif
 
 #include <Tracy.hpp>
+#include <algorithm>
+#include <fmt/chrono.h>
 #include <fmt/format.h>
 #include <optional>
 #include <set>
@@ -79,29 +85,34 @@ static const int SHUTDOWN_DELAY_SECONDS = 1;
 namespace stellar
 {
 
+// One single-threaded io_context per overlay thread, so that everything done
+// for a peer, which is bound to one of them, runs on a single thread
+static std::vector<std::unique_ptr<asio::io_context>>
+makeOverlayIOContexts(Config const& cfg)
+{
+    std::vector<std::unique_ptr<asio::io_context>> res;
+    if (cfg.EXPERIMENTAL_BACKGROUND_OVERLAY_PROCESSING)
+    {
+        for (int i = 0; i < cfg.EXPERIMENTAL_BACKGROUND_OVERLAY_THREADS; ++i)
+        {
+            res.emplace_back(std::make_unique<asio::io_context>(1));
+        }
+    }
+    return res;
+}
+
 ApplicationImpl::ApplicationImpl(VirtualClock& clock, Config const& cfg)
     : mVirtualClock(clock)
     , mConfig(cfg)
-    // Allocate one worker to eviction when background eviction enabled
-    , mWorkerIOContext(mConfig.EXPERIMENTAL_BACKGROUND_EVICTION_SCAN
-                           ? mConfig.WORKER_THREADS - 1
-                           : mConfig.WORKER_THREADS)
-    , mEvictionIOContext(mConfig.EXPERIMENTAL_BACKGROUND_EVICTION_SCAN
-                             ? std::make_unique<asio::io_context>(1)
-                             : nullptr)
-    , mWork(std::make_unique<asio::io_context::work>(mWorkerIOContext))
-    , mEvictionWork(
-          mEvictionIOContext
-              ? std::make_unique<asio::io_context::work>(*mEvictionIOContext)
-              : nullptr)
-    , mOverlayIOContext(mConfig.EXPERIMENTAL_BACKGROUND_OVERLAY_PROCESSING
-                            ? std::make_optional<asio::io_context>(1)
-                            : std::nullopt)
-    , mOverlayWork(mOverlayIOContext ? std::make_unique<asio::io_context::work>(
-                                           *mOverlayIOContext)
-                                     : nullptr)
-    , mWorkerThreads()
-    , mEvictionThread()
+    , mWorkerIOContext(1)
+    , mMergeIOContext(mConfig.BUCKET_MERGE_THREADS > 0
+                          ? std::make_unique<asio::io_context>(
+                                mConfig.BUCKET_MERGE_THREADS)
+                          : nullptr)
+    , mMergeWork(mMergeIOContext ? std::make_unique<asio::io_context::work>(
+                                       *mMergeIOContext)
+                                 : nullptr)
+    , mOverlayIOContexts(makeOverlayIOContexts(mConfig))
     , mStopSignals(clock.getIOContext(), SIGINT)
     , mStarted(false)
     , mStopping(false)
@@ -127,6 +138,7 @@ ApplicationImpl::ApplicationImpl(VirtualClock& clock, Config const& cfg)
     std::srand(static_cast<uint32>(clock.now().time_since_epoch().count()));
 
     mNetworkID = sha256(mConfig.NETWORK_PASSPHRASE);
+    PubKeyUtils::setVerifySigCacheSize(mConfig.VERIFY_SIG_CACHE_SIZE);
 
     TracyAppInfo(STELLAR_CORE_VERSION.c_str(), STELLAR_CORE_VERSION.size());
     TracyAppInfo(mConfig.NETWORK_PASSPHRASE.c_str(),
@@ -153,37 +165,51 @@ ApplicationImpl::ApplicationImpl(VirtualClock& clock, Config const& cfg)
         }
     });
 
-    auto t = mConfig.WORKER_THREADS;
-    LOG_DEBUG(DEFAULT_LOG, "Application constructing (worker threads: {})", t);
-
+    // Eviction scans used to have threads of their own, one of them taken
+    // from WORKER_THREADS; they are CRITICAL jobs in the pool now, which keeps
+    // the extra scan threads
+    size_t t = mConfig.WORKER_THREADS;
     if (mConfig.EXPERIMENTAL_BACKGROUND_EVICTION_SCAN)
     {
-        releaseAssert(mConfig.WORKER_THREADS > 0);
-        releaseAssert(mEvictionIOContext);
-
-        // Allocate one thread for Eviction scan
-        mEvictionThread = std::thread{[this]() {
-            runCurrentThreadWithMediumPriority();
-            mEvictionIOContext->run();
-        }};
-
-        --t;
+        t += mConfig.EXPERIMENTAL_BACKGROUND_EVICTION_SCAN_THREADS - 1;
     }
+    LOG_DEBUG(DEFAULT_LOG, "Application constructing (worker threads: {})", t);
 
-    while (t--)
-    {
-        auto thread = std::thread{[this]() {
+    // Configured CPU lists were validated when the config was read
+    pinCurrentThreadToCpus(parseCpuList(mConfig.MAIN_THREAD_CPUS));
+    mWorkerThreads = std::make_unique<WorkerThreadPool>(
+        t, [cpus = parseCpuList(mConfig.WORKER_THREAD_CPUS)]() {
+            pinCurrentThreadToCpus(cpus);
             runCurrentThreadWithLowPriority();
-            mWorkerIOContext.run();
-        }};
-        mWorkerThreads.emplace_back(std::move(thread));
+        });
+
+    // Merge threads are not taken from WORKER_THREADS. They run at medium
+    // priority since ledger close may block on them.
+    auto mergeCpus = parseCpuList(mConfig.MERGE_THREAD_CPUS);
+    for (int i = 0; i < mConfig.BUCKET_MERGE_THREADS; ++i)
+    {
+        releaseAssert(mMergeIOContext);
+        mMergeThreads.emplace_back([this, mergeCpus]() {
+            pinCurrentThreadToCpus(mergeCpus);
+            runCurrentThreadWithMediumPriority();
+            mMergeIOContext->run();
+        });
     }
 
-    if (mConfig.EXPERIMENTAL_BACKGROUND_OVERLAY_PROCESSING)
+    // Keep priority unchanged as overlay processes time-sensitive tasks
+    auto overlayCpus = parseCpuList(mConfig.OVERLAY_THREAD_CPUS);
+    for (auto& ioContext : mOverlayIOContexts)
     {
-        // Keep priority unchanged as overlay processes time-sensitive tasks
-        mOverlayThread = std::thread{[this]() { mOverlayIOContext->run(); }};
+        mOverlayWork.emplace_back(
+            std::make_unique<asio::io_context::work>(*ioContext));
+        mOverlayThreads.emplace_back(
+            [ioContext = ioContext.get(), overlayCpus]() {
+                pinCurrentThreadToCpus(overlayCpus);
+                ioContext->run();
+            });
     }
+
+    setActionQueuePolicies();
 }
 
 static void
@@ -192,14 +218,19 @@ maybeRebuildLedger(Application& app, bool applyBuckets)
     std::set<LedgerEntryType> toDrop;
     std::set<LedgerEntryType> toRebuild;
     auto& ps = app.getPersistentState();
-    auto bucketListDBEnabled = app.getConfig().isUsingBucketListDB();
     for (auto let : xdr::xdr_traits<LedgerEntryType>::enum_values())
     {
-        // If BucketListDB is enabled, drop all tables except for offers
+        // If BucketListDB is enabled, drop all tables except for offers,
+        // unless those are in BucketListDB too
         LedgerEntryType t = static_cast<LedgerEntryType>(let);
-        if (let != OFFER && bucketListDBEnabled)
+        if (app.getConfig().isUsingBucketListDBForType(t))
         {
             toDrop.emplace(t);
+            if (t == OFFER)
+            {
+                // Rebuild the offers table if they ever leave BucketListDB
+                ps.setRebuildForType(t);
+            }
             continue;
         }
 
@@ -300,9 +331,55 @@ maybeRebuildLedger(Application& app, bool applyBuckets)
     }
 }
 
+namespace
+{
+// Times the steps of ApplicationImpl::start, logged together once it is done
+class StartupTimings
+{
+    using clock = std::chrono::steady_clock;
+    clock::time_point const mStart{clock::now()};
+    std::vector<std::string> mPhases;
+
+  public:
+    template <typename F>
+    void
+    run(char const* name, F&& f)
+    {
+        auto start = clock::now();
+        f();
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            clock::now() - start);
+        CLOG_INFO(Ledger, "Startup phase {} took {}", name, ms);
+        mPhases.emplace_back(fmt::format(FMT_STRING("{} {}"), name, ms));
+    }
+
+    void
+    log() const
+    {
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            clock::now() - mStart);
+        CLOG_INFO(Ledger, "Started up in {}: {}", ms,
+                  fmt::join(mPhases, ", "));
+    }
+};
+}
+
+// Where PERSIST_ENTRY_CACHE_KEYS keeps the entry cache keys across restarts
+static std::filesystem::path
+entryCacheKeysPath(Config const& cfg)
+{
+    return std::filesystem::path(cfg.BUCKET_DIR_PATH) / "entry-cache-keys.xdr";
+}
+
 void
 ApplicationImpl::initialize(bool createNewDB, bool forceRebuild)
 {
+    ContentionProfiler::setEnabled(mConfig.CONTENTION_PROFILING);
+    mFlightRecorder = std::make_unique<FlightRecorder>(
+        mConfig.FLIGHT_RECORDER_LEDGERS,
+        std::chrono::milliseconds(mConfig.FLIGHT_RECORDER_DUMP_THRESHOLD_MS),
+        std::filesystem::path(mConfig.BUCKET_DIR_PATH) / "flight-recorder");
+
     // Subtle: initialize the bucket manager first before initializing the
     // database. This is needed as some modes in core (such as in-memory) use a
     // small database inside the bucket directory.
@@ -358,6 +435,7 @@ ApplicationImpl::initialize(bool createNewDB, bool forceRebuild)
     ConservationOfLumens::registerInvariant(*this);
     LedgerEntryIsValid::registerInvariant(*this);
     LiabilitiesMatchOffers::registerInvariant(*this);
+    OrderBookIsNotCrossed::registerInvariant(*this);
     SponsorshipCountIsValid::registerInvariant(*this);
     ConstantProductInvariant::registerInvariant(*this);
     enableInvariantsFromConfig();
@@ -379,6 +457,15 @@ ApplicationImpl::initialize(bool createNewDB, bool forceRebuild)
     // After everything is initialized, start accepting HTTP commands
     mCommandHandler = std::make_unique<CommandHandler>(*this);
 
+    // validateAndLogConfig rejects HTTP_QUERY_PORT without BucketListDB
+    if (mConfig.HTTP_QUERY_PORT && mConfig.isUsingBucketListDB())
+    {
+        mQueryServer = std::make_unique<QueryServer>(
+            *this, mConfig.PUBLIC_HTTP_PORT ? "0.0.0.0" : "127.0.0.1",
+            mConfig.HTTP_QUERY_PORT, mConfig.HTTP_MAX_CLIENT,
+            mConfig.QUERY_THREAD_POOL_SIZE);
+    }
+
     LOG_DEBUG(DEFAULT_LOG, "Application constructed");
 }
 
@@ -403,6 +490,34 @@ ApplicationImpl::resetLedgerState()
     }
 }
 
+void
+ApplicationImpl::seedInMemoryLedgerState(
+    std::vector<std::shared_ptr<Bucket const>> const& buckets)
+{
+    ZoneScoped;
+    releaseAssert(mConfig.MODE_USES_IN_MEMORY_LEDGER &&
+                  mConfig.EXPERIMENTAL_IN_MEMORY_LEDGER_INDEX);
+
+    auto header = mNeverCommittingLedgerTxn->getHeader();
+    mNeverCommittingLedgerTxn.reset();
+    mInMemoryLedgerTxnRoot = std::make_unique<InMemoryLedgerTxnRoot>(
+#ifdef BEST_OFFER_DEBUGGING
+        mConfig.BEST_OFFER_DEBUGGING_ENABLED
+#endif
+    );
+    auto kept = mInMemoryLedgerTxnRoot->seedFromBuckets(buckets);
+    mNeverCommittingLedgerTxn = std::make_unique<InMemoryLedgerTxn>(
+        *mInMemoryLedgerTxnRoot, getDatabase());
+
+    LedgerTxn ltx(*mNeverCommittingLedgerTxn);
+    ltx.loadHeader().current() = header;
+    for (auto const& le : kept)
+    {
+        ltx.createWithoutLoading(le);
+    }
+    ltx.commit();
+}
+
 void
 ApplicationImpl::newDB()
 {
@@ -579,12 +694,37 @@ ApplicationImpl::getJsonInfo(bool verbose)
             getConfig().NODE_SEED.getPublicKey(), true, false, ledgerSeq);
     }
 
+    auto catchupReport = getCatchupManager().getCatchupReport();
+    if (!catchupReport.isNull())
+    {
+        info["catchup"] = catchupReport;
+    }
+
     auto invariantFailures = getInvariantManager().getJsonInfo();
     if (!invariantFailures.empty())
     {
         info["invariant_failures"] = invariantFailures;
     }
 
+    auto reportPlacement = [&](char const* threads, std::string const& list) {
+        if (list.empty())
+        {
+            return;
+        }
+        auto cpus = parseCpuList(list);
+        auto& placement = info["thread_placement"][threads];
+        placement["cpus"] = list;
+        placement["numa_nodes"] = Json::arrayValue;
+        for (auto node : numaNodesOfCpus(cpus))
+        {
+            placement["numa_nodes"].append(node);
+        }
+    };
+    reportPlacement("main", getConfig().MAIN_THREAD_CPUS);
+    reportPlacement("worker", getConfig().WORKER_THREAD_CPUS);
+    reportPlacement("merge", getConfig().MERGE_THREAD_CPUS);
+    reportPlacement("overlay", getConfig().OVERLAY_THREAD_CPUS);
+
     return root;
 }
 
@@ -666,8 +806,12 @@ ApplicationImpl::getNetworkID() const
 ApplicationImpl::~ApplicationImpl()
 {
     LOG_INFO(DEFAULT_LOG, "Application destructing");
+    // The clock may outlive this, and the policies refer to its metrics
+    mVirtualClock.clearActionQueuePolicies();
     try
     {
+        // Query threads read from BucketManager snapshots, so stop them first
+        mQueryServer.reset();
         shutdownWorkScheduler();
         if (mProcessManager)
         {
@@ -739,6 +883,14 @@ ApplicationImpl::validateAndLogConfig()
             "RUN_STANDALONE is not set");
     }
 
+    if (!mConfig.METADATA_FILTERED_OUTPUT_STREAMS.empty() &&
+        isNetworkedValidator)
+    {
+        throw std::invalid_argument(
+            "METADATA_FILTERED_OUTPUT_STREAMS is set, NODE_IS_VALIDATOR is "
+            "set, and RUN_STANDALONE is not set");
+    }
+
     // EXPERIMENTAL_PRECAUTION_DELAY_META is only meaningful when there's a
     // METADATA_OUTPUT_STREAM.  We only allow EXPERIMENTAL_PRECAUTION_DELAY_META
     // on a captive core, without a persistent database; old-style ingestion
@@ -846,6 +998,86 @@ ApplicationImpl::validateAndLogConfig()
         }
     }
 
+    if (mConfig.EXPERIMENTAL_BACKGROUND_OVERLAY_THREADS > 1 &&
+        !mConfig.EXPERIMENTAL_BACKGROUND_OVERLAY_PROCESSING)
+    {
+        throw std::invalid_argument(
+            "EXPERIMENTAL_BACKGROUND_OVERLAY_THREADS > 1 requires "
+            "EXPERIMENTAL_BACKGROUND_OVERLAY_PROCESSING");
+    }
+
+    if (mConfig.EXPERIMENTAL_BACKGROUND_TX_SIG_VERIFICATION)
+    {
+        if (!mConfig.EXPERIMENTAL_BACKGROUND_OVERLAY_PROCESSING)
+        {
+            throw std::invalid_argument(
+                "EXPERIMENTAL_BACKGROUND_TX_SIG_VERIFICATION requires "
+                "EXPERIMENTAL_BACKGROUND_OVERLAY_PROCESSING");
+        }
+
+        if (!mConfig.isUsingBucketListDB())
+        {
+            throw std::invalid_argument(
+                "DEPRECATED_SQL_LEDGER_STATE must be false to use "
+                "EXPERIMENTAL_BACKGROUND_TX_SIG_VERIFICATION");
+        }
+    }
+
+    if (mConfig.EXPERIMENTAL_LOOKAHEAD_PREFETCH)
+    {
+        if (!mConfig.isUsingBucketListDB())
+        {
+            throw std::invalid_argument(
+                "DEPRECATED_SQL_LEDGER_STATE must be false to use "
+                "EXPERIMENTAL_LOOKAHEAD_PREFETCH");
+        }
+
+        if (mConfig.PREFETCH_BATCH_SIZE == 0)
+        {
+            throw std::invalid_argument(
+                "EXPERIMENTAL_LOOKAHEAD_PREFETCH requires "
+                "PREFETCH_BATCH_SIZE > 0");
+        }
+    }
+
+    if (mConfig.EXPERIMENTAL_IN_MEMORY_LEDGER_INDEX &&
+        !mConfig.MODE_USES_IN_MEMORY_LEDGER)
+    {
+        throw std::invalid_argument(
+            "EXPERIMENTAL_IN_MEMORY_LEDGER_INDEX requires in-memory mode");
+    }
+
+    if (mConfig.HTTP_QUERY_PORT && !mConfig.isUsingBucketListDB())
+    {
+        throw std::invalid_argument(
+            "DEPRECATED_SQL_LEDGER_STATE must be false to use "
+            "HTTP_QUERY_PORT");
+    }
+
+    if (mConfig.EXPERIMENTAL_METADATA_ONLY_MODE)
+    {
+        if (mConfig.METADATA_OUTPUT_STREAM.empty() &&
+            mConfig.METADATA_FILTERED_OUTPUT_STREAMS.empty())
+        {
+            throw std::invalid_argument(
+                "EXPERIMENTAL_METADATA_ONLY_MODE requires "
+                "METADATA_OUTPUT_STREAM or METADATA_FILTERED_OUTPUT_STREAMS");
+        }
+        if (isNetworkedValidator)
+        {
+            throw std::invalid_argument(
+                "EXPERIMENTAL_METADATA_ONLY_MODE is set, NODE_IS_VALIDATOR is "
+                "set, and RUN_STANDALONE is not set");
+        }
+        if (!mConfig.isUsingBucketListDB())
+        {
+            throw std::invalid_argument(
+                "EXPERIMENTAL_METADATA_ONLY_MODE requires BucketListDB: "
+                "DEPRECATED_SQL_LEDGER_STATE must be false and in-memory mode "
+                "must not be set");
+        }
+    }
+
     if (isNetworkedValidator && mConfig.isInMemoryMode())
     {
         throw std::invalid_argument(
@@ -920,10 +1152,54 @@ ApplicationImpl::start()
 
     CLOG_INFO(Ledger, "Starting up application");
     mStarted = true;
+    StartupTimings timings;
 
-    mLedgerManager->loadLastKnownLedger(/* restoreBucketlist */ true,
-                                        /* isLedgerStateReady */ true);
-    startServices();
+    // Loading the last closed ledger mostly waits for buckets to be indexed
+    // in the background, so steps that don't need the ledger state start
+    // first and overlap with it. Peers of a watcher connecting meanwhile wait
+    // in the listen queue rather than being refused. Validators keep
+    // listening for when they can take part in consensus.
+    if (mConfig.MODE_AUTO_STARTS_OVERLAY && !mConfig.NODE_IS_VALIDATOR)
+    {
+        timings.run("listen", [&]() { mOverlayManager->listen(); });
+    }
+    auto& db = getDatabase();
+    if (!db.isSqlite() && db.canUsePool())
+    {
+        // The pool opens its connections one at a time, which adds up with
+        // many cores and a remote database
+        postOnBackgroundThread(
+            [&db]() {
+                try
+                {
+                    db.getPool();
+                }
+                catch (std::exception const& e)
+                {
+                    // Using the pool will fail again, where it is handled
+                    LOG_WARNING(DEFAULT_LOG,
+                                "Could not open database pool early: {}",
+                                e.what());
+                }
+            },
+            "open database pool");
+    }
+
+    timings.run("load-lcl", [&]() {
+        mLedgerManager->loadLastKnownLedger(/* restoreBucketlist */ true,
+                                            /* isLedgerStateReady */ true);
+    });
+    if (mConfig.PERSIST_ENTRY_CACHE_KEYS)
+    {
+        if (auto root = dynamic_cast<LedgerTxnRoot*>(mLedgerTxnRoot.get()))
+        {
+            timings.run("warm-entry-cache", [&]() {
+                root->warmEntryCache(entryCacheKeysPath(mConfig));
+            });
+        }
+    }
+    timings.run("start-services", [&]() { startServices(); });
+    timings.log();
 }
 
 void
@@ -944,6 +1220,21 @@ ApplicationImpl::gracefulStop()
     {
         mProcessManager->shutdown();
     }
+    if (mConfig.PERSIST_ENTRY_CACHE_KEYS && mStarted)
+    {
+        if (auto root = dynamic_cast<LedgerTxnRoot*>(mLedgerTxnRoot.get()))
+        {
+            try
+            {
+                root->saveEntryCacheKeys(entryCacheKeysPath(mConfig));
+            }
+            catch (std::exception& e)
+            {
+                CLOG_WARNING(Ledger, "Failed to save entry cache keys: {}",
+                             e.what());
+            }
+        }
+    }
     if (mBucketManager)
     {
         // This call happens in shutdown -- before destruction -- so that we can
@@ -983,42 +1274,39 @@ ApplicationImpl::shutdownWorkScheduler()
 void
 ApplicationImpl::joinAllThreads()
 {
-    // We never strictly stop the worker IO service, just release the work-lock
-    // that keeps the worker threads alive. This gives them the chance to finish
-    // any work that the main thread queued.
-    if (mWork)
-    {
-        mWork.reset();
-    }
-    if (mOverlayWork)
-    {
-        mOverlayWork.reset();
-    }
+    // Joining the worker pool lets it finish any work that the main thread
+    // queued.
+    mOverlayWork.clear();
 
-    LOG_INFO(DEFAULT_LOG, "Joining {} worker threads", mWorkerThreads.size());
-    for (auto& w : mWorkerThreads)
-    {
-        w.join();
-    }
+    auto numWorkerThreads = mWorkerThreads->size();
+    LOG_INFO(DEFAULT_LOG, "Joining {} worker threads", numWorkerThreads);
+    mWorkerThreads->join();
 
-    if (mEvictionWork)
+    if (mMergeWork)
     {
-        mEvictionWork.reset();
+        mMergeWork.reset();
     }
 
-    if (mEvictionThread)
+    if (!mMergeThreads.empty())
     {
-        LOG_INFO(DEFAULT_LOG, "Joining eviction thread");
-        mEvictionThread->join();
+        LOG_INFO(DEFAULT_LOG, "Joining {} merge threads", mMergeThreads.size());
+        for (auto& w : mMergeThreads)
+        {
+            w.join();
+        }
     }
 
-    if (mOverlayThread)
+    if (!mOverlayThreads.empty())
     {
-        LOG_INFO(DEFAULT_LOG, "Joining the overlay thread");
-        mOverlayThread->join();
+        LOG_INFO(DEFAULT_LOG, "Joining {} overlay threads",
+                 mOverlayThreads.size());
+        for (auto& w : mOverlayThreads)
+        {
+            w.join();
+        }
     }
 
-    LOG_INFO(DEFAULT_LOG, "Joined all {} threads", (mWorkerThreads.size() + 1));
+    LOG_INFO(DEFAULT_LOG, "Joined all {} threads", (numWorkerThreads + 1));
 }
 
 std::string
@@ -1328,6 +1616,9 @@ ApplicationImpl::syncOwnMetrics()
     mMetrics->NewMeter({"crypto", "verify", "miss"}, "signature").Mark(vmiss);
     mMetrics->NewMeter({"crypto", "verify", "total"}, "signature")
         .Mark(vhit + vmiss);
+    mMetrics->NewCounter({"crypto", "memory", "verify-sig-cache-bytes"})
+        .set_count(
+            static_cast<int64_t>(PubKeyUtils::getVerifySigCacheMemoryUsage()));
 
     // Similarly, flush global process-table stats.
     mMetrics->NewCounter({"process", "memory", "handles"})
@@ -1348,6 +1639,8 @@ ApplicationImpl::syncOwnMetrics()
     }
     mMetrics->NewCounter({"process", "file", "handles"})
         .set_count(fs::getOpenHandleCount());
+    mMetrics->NewCounter({"process", "log", "dropped"})
+        .set_count(static_cast<int64_t>(Logging::getDroppedMessages()));
 }
 
 void
@@ -1359,6 +1652,15 @@ ApplicationImpl::syncAllMetrics()
     syncOwnMetrics();
 }
 
+void
+ApplicationImpl::publishStatus()
+{
+    if (mQueryServer)
+    {
+        mQueryServer->publishStatus();
+    }
+}
+
 void
 ApplicationImpl::clearMetrics(std::string const& domain)
 {
@@ -1481,6 +1783,12 @@ ApplicationImpl::getStatusManager()
     return *mStatusManager;
 }
 
+FlightRecorder&
+ApplicationImpl::getFlightRecorder()
+{
+    return *mFlightRecorder;
+}
+
 asio::io_context&
 ApplicationImpl::getWorkerIOContext()
 {
@@ -1488,17 +1796,21 @@ ApplicationImpl::getWorkerIOContext()
 }
 
 asio::io_context&
-ApplicationImpl::getEvictionIOContext()
+ApplicationImpl::getOverlayIOContext(size_t overlayThread)
 {
-    releaseAssert(mEvictionIOContext);
-    return *mEvictionIOContext;
+    releaseAssert(overlayThread < mOverlayIOContexts.size());
+    return *mOverlayIOContexts[overlayThread];
 }
 
-asio::io_context&
-ApplicationImpl::getOverlayIOContext()
+size_t
+ApplicationImpl::pickOverlayThread()
 {
-    releaseAssert(mOverlayIOContext);
-    return *mOverlayIOContext;
+    releaseAssert(threadIsMain());
+    if (mOverlayIOContexts.empty())
+    {
+        return 0;
+    }
+    return mNextOverlayThread++ % mOverlayIOContexts.size();
 }
 
 void
@@ -1523,41 +1835,100 @@ ApplicationImpl::postOnMainThread(std::function<void()>&& f, std::string&& name,
 
 void
 ApplicationImpl::postOnBackgroundThread(std::function<void()>&& f,
-                                        std::string jobName)
+                                        std::string jobName,
+                                        WorkerPriority priority)
 {
     LogSlowExecution isSlow{std::move(jobName), LogSlowExecution::Mode::MANUAL,
                             "executed after"};
-    asio::post(getWorkerIOContext(), [this, f = std::move(f), isSlow]() {
-        mPostOnBackgroundThreadDelay.Update(isSlow.checkElapsedTime());
-        f();
-    });
+    mWorkerThreads->post(
+        [this, f = std::move(f), isSlow]() {
+            mPostOnBackgroundThreadDelay.Update(isSlow.checkElapsedTime());
+            f();
+        },
+        priority);
 }
 
 void
-ApplicationImpl::postOnEvictionBackgroundThread(std::function<void()>&& f,
-                                                std::string jobName)
+ApplicationImpl::postOnMergeBackgroundThread(std::function<void()>&& f,
+                                             std::string jobName,
+                                             uint32_t priority)
 {
+    if (!mMergeIOContext)
+    {
+        postOnBackgroundThread(std::move(f), std::move(jobName));
+        return;
+    }
+
     LogSlowExecution isSlow{std::move(jobName), LogSlowExecution::Mode::MANUAL,
                             "executed after"};
-    asio::post(getEvictionIOContext(), [this, f = std::move(f), isSlow]() {
+    auto job = [this, f = std::move(f), isSlow]() {
         mPostOnBackgroundThreadDelay.Update(isSlow.checkElapsedTime());
         f();
-    });
+    };
+
+    {
+        std::lock_guard<std::mutex> lock(mMergeQueueMutex);
+        mMergeQueue.push_back({priority, mMergeJobSeq++, std::move(job)});
+        std::push_heap(mMergeQueue.begin(), mMergeQueue.end());
+    }
+
+    // One handler per job, so every queued job eventually runs, but not
+    // necessarily the one that posted the handler.
+    asio::post(*mMergeIOContext, [this]() { runNextMergeJob(); });
+}
+
+void
+ApplicationImpl::runNextMergeJob()
+{
+    std::function<void()> f;
+    {
+        std::lock_guard<std::mutex> lock(mMergeQueueMutex);
+        releaseAssert(!mMergeQueue.empty());
+        std::pop_heap(mMergeQueue.begin(), mMergeQueue.end());
+        f = std::move(mMergeQueue.back().mFunc);
+        mMergeQueue.pop_back();
+    }
+    f();
 }
 
 void
 ApplicationImpl::postOnOverlayThread(std::function<void()>&& f,
-                                     std::string jobName)
+                                     std::string jobName, size_t overlayThread)
 {
-    releaseAssert(mOverlayIOContext);
+    auto& ioContext = getOverlayIOContext(overlayThread);
     LogSlowExecution isSlow{std::move(jobName), LogSlowExecution::Mode::MANUAL,
                             "executed after"};
-    asio::post(*mOverlayIOContext, [this, f = std::move(f), isSlow]() {
+    asio::post(ioContext, [this, f = std::move(f), isSlow]() {
         mPostOnOverlayThreadDelay.Update(isSlow.checkElapsedTime());
         f();
     });
 }
 
+void
+ApplicationImpl::setActionQueuePolicies()
+{
+    using Tier = Scheduler::ActionTier;
+    auto set = [&](std::string const& queue, Tier tier,
+                   std::chrono::nanoseconds deadline, std::string metric) {
+        mVirtualClock.setActionQueuePolicy(
+            queue, {tier, deadline,
+                    &mMetrics->NewTimer({"scheduler", "queue-delay", metric})});
+    };
+    auto const noDeadline = std::chrono::nanoseconds::zero();
+
+    // Message queues are named in Peer::recvAuthenticatedMessage. Externalizing
+    // comes first, then closing the externalized ledger, then admitting the
+    // transactions that flood in meanwhile; a tx that waited this long is shed.
+    set("SCP", Tier::CONSENSUS, noDeadline, "scp");
+    set("SCPQ", Tier::CONSENSUS, noDeadline, "scp-query");
+    set("processSCPQueueSomeMore", Tier::CONSENSUS, noDeadline, "herder-scp");
+    set("LedgerManager: post-close steps", Tier::LEDGER_CLOSE, noDeadline,
+        "post-close");
+    set("finishLookaheadPrefetch", Tier::LEDGER_CLOSE, noDeadline, "prefetch");
+    set("TX", Tier::TX_ADMISSION, std::chrono::seconds(2), "tx");
+    set("MISC", Tier::BACKGROUND, noDeadline, "misc");
+}
+
 void
 ApplicationImpl::enableInvariantsFromConfig()
 {
@@ -1565,6 +1936,20 @@ ApplicationImpl::enableInvariantsFromConfig()
     {
         mInvariantManager->enableInvariant(name);
     }
+
+    auto enabled = mInvariantManager->getEnabledInvariants();
+    for (auto const& rate : mConfig.INVARIANT_CHECK_SAMPLE_RATES)
+    {
+        if (std::find(enabled.begin(), enabled.end(), rate.first) ==
+            enabled.end())
+        {
+            throw std::runtime_error(fmt::format(
+                FMT_STRING("Invalid configuration: "
+                           "INVARIANT_CHECK_SAMPLE_RATES.{} is not an "
+                           "enabled invariant"),
+                rate.first));
+        }
+    }
 }
 
 std::unique_ptr<Herder>
@@ -11,8 +11,10 @@
 #include "util/MetricResetter.h"
 #include "util/Timer.h"
 #include "xdr/Stellar-ledger-entries.h"
+#include <mutex>
 #include <optional>
 #include <thread>
+#include <tuple>
 
 namespace medida
 {
@@ -29,6 +31,7 @@ class BucketManager;
 class HistoryManager;
 class ProcessManager;
 class CommandHandler;
+class QueryServer;
 class Database;
 class LedgerTxn;
 class LedgerTxnRoot;
@@ -46,6 +49,9 @@ class ApplicationImpl : public Application
 
     virtual void resetLedgerState() override;
 
+    virtual void seedInMemoryLedgerState(
+        std::vector<std::shared_ptr<Bucket const>> const& buckets) override;
+
     virtual uint64_t timeNow() override;
 
     virtual Config const& getConfig() override;
@@ -57,6 +63,7 @@ class ApplicationImpl : public Application
     virtual medida::MetricsRegistry& getMetrics() override;
     virtual void syncOwnMetrics() override;
     virtual void syncAllMetrics() override;
+    virtual void publishStatus() override;
     virtual void clearMetrics(std::string const& domain) override;
     virtual TmpDirManager& getTmpDirManager() override;
     virtual LedgerManager& getLedgerManager() override;
@@ -76,20 +83,25 @@ class ApplicationImpl : public Application
     virtual WorkScheduler& getWorkScheduler() override;
     virtual BanManager& getBanManager() override;
     virtual StatusManager& getStatusManager() override;
+    virtual FlightRecorder& getFlightRecorder() override;
 
     virtual asio::io_context& getWorkerIOContext() override;
-    virtual asio::io_context& getEvictionIOContext() override;
-    virtual asio::io_context& getOverlayIOContext() override;
+    virtual asio::io_context&
+    getOverlayIOContext(size_t overlayThread) override;
+    virtual size_t pickOverlayThread() override;
 
     virtual void postOnMainThread(std::function<void()>&& f, std::string&& name,
                                   Scheduler::ActionType type) override;
-    virtual void postOnBackgroundThread(std::function<void()>&& f,
-                                        std::string jobName) override;
-    virtual void postOnEvictionBackgroundThread(std::function<void()>&& f,
-                                                std::string jobName) override;
+    virtual void postOnBackgroundThread(
+        std::function<void()>&& f, std::string jobName,
+        WorkerPriority priority = WorkerPriority::NORMAL) override;
+    virtual void postOnMergeBackgroundThread(std::function<void()>&& f,
+                                             std::string jobName,
+                                             uint32_t priority) override;
 
     virtual void postOnOverlayThread(std::function<void()>&& f,
-                                     std::string jobName) override;
+                                     std::string jobName,
+                                     size_t overlayThread) override;
     virtual void start() override;
     void startServices();
 
@@ -148,14 +160,18 @@ class ApplicationImpl : public Application
     // threads must be joined and destroyed before we start tearing down
     // subsystems.
 
+    // Only for asio objects used synchronously off the main thread: no
+    // thread runs it, background jobs go to mWorkerThreads
     asio::io_context mWorkerIOContext;
-    std::unique_ptr<asio::io_context> mEvictionIOContext;
-    std::unique_ptr<asio::io_context::work> mWork;
-    std::unique_ptr<asio::io_context::work> mEvictionWork;
+    std::unique_ptr<asio::io_context> mMergeIOContext;
+    std::unique_ptr<asio::io_context::work> mMergeWork;
 
-    std::optional<asio::io_context> mOverlayIOContext;
-    std::unique_ptr<asio::io_context::work> mOverlayWork;
+    std::vector<std::unique_ptr<asio::io_context>> mOverlayIOContexts;
+    std::vector<std::unique_ptr<asio::io_context::work>> mOverlayWork;
+    size_t mNextOverlayThread{0};
 
+    // Before everything that records into it, so that it outlives them
+    std::unique_ptr<FlightRecorder> mFlightRecorder;
     std::unique_ptr<BucketManager> mBucketManager;
     std::unique_ptr<Database> mDatabase;
     std::unique_ptr<OverlayManager> mOverlayManager;
@@ -194,18 +210,39 @@ class ApplicationImpl : public Application
 
     std::unique_ptr<CommandHandler> mCommandHandler;
 
+    // Null unless HTTP_QUERY_PORT is set
+    std::unique_ptr<QueryServer> mQueryServer;
+
 #ifdef BUILD_TESTS
     std::unique_ptr<LoadGenerator> mLoadGenerator;
 #endif
 
-    std::vector<std::thread> mWorkerThreads;
-    std::optional<std::thread> mOverlayThread;
-
-    // Unlike mWorkerThreads (which are low priority), eviction scans require a
-    // medium priority thread. In the future, this may become a more general
-    // higher-priority worker thread type, but for now we only need a single
-    // thread for eviction scans.
-    std::optional<std::thread> mEvictionThread;
+    std::unique_ptr<WorkerThreadPool> mWorkerThreads;
+    std::vector<std::thread> mOverlayThreads;
+
+    // Dedicated merge threads, created when BUCKET_MERGE_THREADS > 0. asio
+    // has no notion of priority, so merge jobs wait in mMergeQueue (a heap
+    // ordered by priority, then submission order) and every handler posted to
+    // mMergeIOContext runs whichever queued job is most urgent at that time.
+    struct MergeJob
+    {
+        uint32_t mPriority;
+        uint64_t mSeq;
+        std::function<void()> mFunc;
+
+        // Heap order: a job compares less than the jobs that run before it
+        bool
+        operator<(MergeJob const& other) const
+        {
+            return std::tie(mPriority, mSeq) >
+                   std::tie(other.mPriority, other.mSeq);
+        }
+    };
+    std::vector<std::thread> mMergeThreads;
+    std::mutex mMergeQueueMutex;
+    std::vector<MergeJob> mMergeQueue;
+    uint64_t mMergeJobSeq{0};
+    void runNextMergeJob();
 
     asio::signal_set mStopSignals;
 
@@ -234,6 +271,8 @@ class ApplicationImpl : public Application
     void shutdownWorkScheduler();
 
     void enableInvariantsFromConfig();
+    // Places the main thread's known action queues in scheduler tiers
+    void setActionQueuePolicies();
 
     virtual std::unique_ptr<Herder> createHerder();
     virtual std::unique_ptr<InvariantManager> createInvariantManager();
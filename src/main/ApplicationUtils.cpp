@@ -6,11 +6,15 @@
 #include "bucket/Bucket.h"
 #include "bucket/BucketList.h"
 #include "bucket/BucketManager.h"
+#ifdef BUILD_TESTS
+#include "bucket/test/SyntheticBucketList.h"
+#endif
 #include "catchup/ApplyBucketsWork.h"
 #include "catchup/CatchupConfiguration.h"
 #include "crypto/Hex.h"
 #include "database/Database.h"
 #include "herder/Herder.h"
+#include "herder/QuorumIntersectionCNF.h"
 #include "herder/QuorumIntersectionChecker.h"
 #include "history/HistoryArchive.h"
 #include "history/HistoryArchiveManager.h"
@@ -33,13 +37,16 @@
 #include "util/xdrquery/XDRQuery.h"
 #include "work/WorkScheduler.h"
 
+#include <algorithm>
 #include <charconv>
 #include <filesystem>
 #include <lib/http/HttpClient.h>
 #include <locale>
 #include <map>
+#include <mutex>
 #include <optional>
 #include <regex>
+#include <thread>
 
 namespace stellar
 {
@@ -134,6 +141,7 @@ setupMinimalDBForInMemoryMode(Config const& cfg, uint32_t startAtLedger)
 
     auto cfgToCheckDB = cfg;
     cfgToCheckDB.METADATA_OUTPUT_STREAM = "";
+    cfgToCheckDB.METADATA_FILTERED_OUTPUT_STREAMS.clear();
 
     if (std::filesystem::exists(minimalDbPath(cfg)))
     {
@@ -458,16 +466,14 @@ selfCheck(Config cfg)
                                                 /* isLedgerStateReady */ true);
 
     // First we schedule the cheap, asynchronous "online" checks that get run by
-    // the HTTP "self-check" endpoint, and crank until they're done.
+    // the HTTP "self-check" endpoint. They mostly wait on the archives, so we
+    // scan all the buckets to check they have expected hashes meanwhile, and
+    // crank until both are done.
     LOG_INFO(DEFAULT_LOG, "Self-check phase 1: fast online checks");
     auto seq1 = app->scheduleSelfCheck(false);
-    while (clock.crank(true) && !seq1->isDone())
-        ;
-
-    // Then we scan all the buckets to check they have expected hashes.
     LOG_INFO(DEFAULT_LOG, "Self-check phase 2: bucket hash verification");
     auto seq2 = app->getBucketManager().scheduleVerifyReferencedBucketsWork();
-    while (clock.crank(true) && !seq2->isDone())
+    while (clock.crank(true) && !(seq1->isDone() && seq2->isDone()))
         ;
 
     // Then we load the entire BL ledger state into memory and check it against
@@ -479,7 +485,8 @@ selfCheck(Config cfg)
     //
     // What we do instead is register a background thread listening for
     // control-C so at least the user can interrupt this if they get impatient.
-    asio::signal_set stopSignals(app->getWorkerIOContext(), SIGINT);
+    asio::io_context signalContext;
+    asio::signal_set stopSignals(signalContext, SIGINT);
 #ifdef SIGQUIT
     stopSignals.add(SIGQUIT);
 #endif
@@ -493,6 +500,7 @@ selfCheck(Config cfg)
             exit(1);
         }
     });
+    std::thread signalThread([&signalContext]() { signalContext.run(); });
 
     LOG_INFO(DEFAULT_LOG, "Self-check phase 3: ledger consistency checks");
     BucketListIsConsistentWithDatabase blc(*app);
@@ -514,6 +522,9 @@ selfCheck(Config cfg)
     LOG_INFO(DEFAULT_LOG, "Benchmarked {} signatures / sec", signPerSec);
     LOG_INFO(DEFAULT_LOG, "Benchmarked {} verifications / sec", verifyPerSec);
 
+    stopSignals.cancel();
+    signalThread.join();
+
     if (seq1->getState() == BasicWork::State::WORK_SUCCESS &&
         seq2->getState() == BasicWork::State::WORK_SUCCESS && blcOk)
     {
@@ -742,12 +753,18 @@ dumpLedger(Config cfg, std::string const& outputFile,
            std::optional<std::string> filterQuery,
            std::optional<uint32_t> lastModifiedLedgerCount,
            std::optional<uint64_t> limit, std::optional<std::string> groupBy,
-           std::optional<std::string> aggregate)
+           std::optional<std::string> aggregate,
+           std::optional<std::string> columns, uint32_t numThreads)
 {
     if (groupBy && !aggregate)
     {
         LOG_FATAL(DEFAULT_LOG, "--group-by without --agg is not allowed.");
     }
+    if (columns && aggregate)
+    {
+        LOG_FATAL(DEFAULT_LOG, "--columns with --agg is not allowed.");
+        return 1;
+    }
 
     VirtualClock clock;
     cfg.setNoListen();
@@ -770,11 +787,53 @@ dumpLedger(Config cfg, std::string const& outputFile,
             minLedger = 0;
         }
     }
-    std::optional<xdrquery::XDRMatcher> matcher;
-    if (filterQuery)
+    // Per thread state of the dump. Matchers and extractors are not
+    // thread-safe, and entries are formatted into a buffer written out in
+    // large chunks.
+    struct DumpState
     {
-        matcher.emplace(*filterQuery);
+        std::optional<xdrquery::XDRMatcher> mMatcher;
+        std::optional<xdrquery::XDRFieldExtractor> mColumns;
+        std::string mOut;
+        uint64_t mCount{0};
+    };
+    // The parallel scan reads the whole bucket list twice, which only pays
+    // off for full state dumps: with --last-ledgers or --limit the sequential
+    // scan stops early, and aggregations can't be merged across threads.
+    bool const parallel =
+        numThreads > 1 && !aggregate && !lastModifiedLedgerCount && !limit;
+    std::vector<DumpState> states(parallel ? numThreads : 1);
+    for (auto& state : states)
+    {
+        if (filterQuery)
+        {
+            state.mMatcher.emplace(*filterQuery);
+        }
+        if (columns)
+        {
+            state.mColumns.emplace(*columns);
+        }
     }
+    size_t const OUTPUT_CHUNK_BYTES = 1024 * 1024;
+    std::mutex outMutex;
+    auto dumpEntry = [&](DumpState& state, LedgerEntry const& entry) {
+        if (state.mColumns)
+        {
+            for (auto const& field : state.mColumns->extractFields(entry))
+            {
+                if (field)
+                {
+                    state.mOut += xdrquery::resultToString(*field);
+                }
+                state.mOut += ',';
+            }
+        }
+        else
+        {
+            state.mOut += xdrToCerealString(entry, "entry", true);
+        }
+        state.mOut += '\n';
+    };
 
     std::optional<xdrquery::XDRFieldExtractor> groupByExtractor;
     if (groupBy)
@@ -786,46 +845,94 @@ dumpLedger(Config cfg, std::string const& outputFile,
         accumulators;
 
     std::ofstream ofs(outputFile);
+    auto flushOutput = [&](DumpState& state) {
+        std::lock_guard<std::mutex> guard(outMutex);
+        ofs << state.mOut;
+        state.mOut.clear();
+    };
 
     auto& bm = app->getBucketManager();
     uint64_t entryCount = 0;
     try
     {
-        bm.visitLedgerEntries(
-            has, minLedger,
-            [&](LedgerEntry const& entry) {
-                return !matcher || matcher->matchXDR(entry);
-            },
-            [&](LedgerEntry const& entry) {
-                if (aggregate)
-                {
-                    std::vector<xdrquery::ResultType> key;
-                    if (groupByExtractor)
+        if (columns)
+        {
+            // Field names are only known once the query is parsed, which
+            // extracting from any entry does
+            xdrquery::XDRFieldExtractor header(*columns);
+            header.extractFields(LedgerEntry{});
+            for (auto const& name : header.getFieldNames())
+            {
+                ofs << name << ",";
+            }
+            ofs << std::endl;
+        }
+        if (parallel)
+        {
+            LOG_INFO(DEFAULT_LOG, "Dumping ledger on {} threads", numThreads);
+            bm.visitLedgerEntriesInParallel(
+                has, numThreads, [&](size_t thread, LedgerEntry const& entry) {
+                    auto& state = states.at(thread);
+                    if (!state.mMatcher || state.mMatcher->matchXDR(entry))
                     {
-                        key = groupByExtractor->extractFields(entry);
+                        dumpEntry(state, entry);
+                        ++state.mCount;
+                        if (state.mOut.size() >= OUTPUT_CHUNK_BYTES)
+                        {
+                            flushOutput(state);
+                        }
                     }
-                    auto it = accumulators.find(key);
-                    if (it == accumulators.end())
+                    return true;
+                });
+        }
+        else
+        {
+            auto& state = states.front();
+            bm.visitLedgerEntries(
+                has, minLedger,
+                [&](LedgerEntry const& entry) {
+                    return !state.mMatcher || state.mMatcher->matchXDR(entry);
+                },
+                [&](LedgerEntry const& entry) {
+                    if (aggregate)
                     {
-                        it = accumulators
-                                 .emplace(key,
-                                          xdrquery::XDRAccumulator(*aggregate))
-                                 .first;
+                        std::vector<xdrquery::ResultType> key;
+                        if (groupByExtractor)
+                        {
+                            key = groupByExtractor->extractFields(entry);
+                        }
+                        auto it = accumulators.find(key);
+                        if (it == accumulators.end())
+                        {
+                            it = accumulators
+                                     .emplace(key, xdrquery::XDRAccumulator(
+                                                       *aggregate))
+                                     .first;
+                        }
+                        it->second.addEntry(entry);
                     }
-                    it->second.addEntry(entry);
-                }
-                else
-                {
-                    ofs << xdrToCerealString(entry, "entry", true) << std::endl;
-                }
-                ++entryCount;
-                return !limit || entryCount < *limit;
-            });
+                    else
+                    {
+                        dumpEntry(state, entry);
+                        if (state.mOut.size() >= OUTPUT_CHUNK_BYTES)
+                        {
+                            flushOutput(state);
+                        }
+                    }
+                    ++state.mCount;
+                    return !limit || state.mCount < *limit;
+                });
+        }
     }
     catch (xdrquery::XDRQueryError& e)
     {
         LOG_ERROR(DEFAULT_LOG, "Filter query error: {}", e.what());
     }
+    for (auto& state : states)
+    {
+        flushOutput(state);
+        entryCount += state.mCount;
+    }
 
     if (aggregate)
     {
@@ -871,9 +978,10 @@ showOfflineInfo(Config cfg, bool verbose)
     app->reportInfo(verbose);
 }
 
-bool
-checkQuorumIntersectionFromJson(std::string const& jsonPath,
-                                std::optional<Config> const& cfg)
+namespace
+{
+QuorumIntersectionChecker::QuorumSetMap
+loadQuorumSetMapFromJson(std::string const& jsonPath)
 {
     std::ifstream in(jsonPath);
     if (!in)
@@ -911,7 +1019,15 @@ checkQuorumIntersectionFromJson(std::string const& jsonPath,
                 "JSON contains multiple nodes with the same 'node' value");
         }
     }
+    return qmap;
+}
+}
 
+bool
+checkQuorumIntersectionFromJson(std::string const& jsonPath,
+                                std::optional<Config> const& cfg)
+{
+    auto qmap = loadQuorumSetMapFromJson(jsonPath);
     std::atomic<bool> interrupt(false);
     auto qicPtr =
         QuorumIntersectionChecker::create(qmap, cfg, interrupt, false);
@@ -919,6 +1035,27 @@ checkQuorumIntersectionFromJson(std::string const& jsonPath,
     return qicPtr->networkEnjoysQuorumIntersection();
 }
 
+void
+writeQuorumIntersectionCNFFromJson(std::string const& jsonPath,
+                                   std::string const& outputPath,
+                                   std::optional<Config> const& cfg)
+{
+    QuorumIntersectionCNF cnf(loadQuorumSetMapFromJson(jsonPath));
+    std::ofstream out(outputPath);
+    if (!out)
+    {
+        throw std::runtime_error("Could not open file '" + outputPath + "'");
+    }
+    cnf.writeDimacs(out, cfg);
+    out.close();
+    if (!out)
+    {
+        throw std::runtime_error("Could not write file '" + outputPath + "'");
+    }
+    CLOG_INFO(SCP, "Wrote {} variables and {} clauses to {}",
+              cnf.getNumVariables(), cnf.getClauses().size(), outputPath);
+}
+
 #ifdef BUILD_TESTS
 void
 loadXdr(Config cfg, std::string const& bucketFile)
@@ -944,6 +1081,29 @@ rebuildLedgerFromBuckets(Config cfg)
         ;
     return 1;
 }
+
+int
+generateBucketList(Config cfg, SyntheticBucketListConfig const& blCfg,
+                   std::string const& outputFile)
+{
+    VirtualClock clock;
+    cfg.setNoListen();
+    // Start from a genesis ledger at the configured protocol, with Soroban
+    // settings, rather than at protocol 0
+    cfg.USE_CONFIG_FOR_GENESIS = true;
+    Application::pointer app = Application::create(clock, cfg, true);
+
+    auto has = generateSyntheticBucketList(*app, blCfg);
+    LOG_INFO(DEFAULT_LOG, "Generated BucketList at ledger {} with hash {}",
+             has.currentLedger,
+             binToHex(app->getBucketManager().getBucketList().getHash()));
+    if (!outputFile.empty())
+    {
+        has.save(outputFile);
+        LOG_INFO(DEFAULT_LOG, "Wrote HAS to {}", outputFile);
+    }
+    return 0;
+}
 #endif
 
 int
@@ -1044,12 +1204,12 @@ writeCatchupInfo(Json::Value const& catchupInfo, std::string const& outputFile)
     }
 }
 
-int
-catchup(Application::pointer app, CatchupConfiguration cc,
-        Json::Value& catchupInfo, std::shared_ptr<HistoryArchive> archive)
+// catchup, for an app that was started already
+static int
+catchupStarted(Application::pointer app, CatchupConfiguration cc,
+               Json::Value& catchupInfo,
+               std::shared_ptr<HistoryArchive> archive)
 {
-    app->start();
-
     try
     {
         app->getLedgerManager().startCatchup(cc, archive, {});
@@ -1116,6 +1276,135 @@ catchup(Application::pointer app, CatchupConfiguration cc,
     return synced ? 0 : 3;
 }
 
+int
+catchup(Application::pointer app, CatchupConfiguration cc,
+        Json::Value& catchupInfo, std::shared_ptr<HistoryArchive> archive)
+{
+    app->start();
+    return catchupStarted(app, cc, catchupInfo, archive);
+}
+
+static Json::Value
+applyBenchReport(std::vector<LedgerManager::ApplyStats> const& stats)
+{
+    using namespace std::chrono;
+    auto toMs = [](nanoseconds d) {
+        return duration<double, std::milli>(d).count();
+    };
+
+    Json::Value res;
+    auto& ledgers = res["ledgers"];
+    ledgers = Json::arrayValue;
+    size_t txs = 0;
+    size_t ops = 0;
+    nanoseconds total{0};
+    std::vector<nanoseconds> times;
+    std::map<OperationType, size_t> opTypeCounts;
+    for (auto const& s : stats)
+    {
+        Json::Value l;
+        l["ledger"] = s.mLedgerSeq;
+        l["txs"] = static_cast<Json::UInt64>(s.mTxCount);
+        l["ops"] = static_cast<Json::UInt64>(s.mOpCount);
+        l["apply_ms"] = toMs(s.mApplyTime);
+        ledgers.append(l);
+
+        txs += s.mTxCount;
+        ops += s.mOpCount;
+        total += s.mApplyTime;
+        times.emplace_back(s.mApplyTime);
+        for (auto const& [type, count] : s.mOpTypeCounts)
+        {
+            opTypeCounts[type] += count;
+        }
+    }
+
+    auto& summary = res["summary"];
+    summary["ledgers"] = static_cast<Json::UInt64>(stats.size());
+    summary["txs"] = static_cast<Json::UInt64>(txs);
+    summary["ops"] = static_cast<Json::UInt64>(ops);
+    summary["apply_ms"] = toMs(total);
+    if (!times.empty())
+    {
+        std::sort(times.begin(), times.end());
+        auto pct = [&](double p) {
+            return toMs(times[static_cast<size_t>(p * (times.size() - 1))]);
+        };
+        summary["apply_ms_p50"] = pct(0.5);
+        summary["apply_ms_p99"] = pct(0.99);
+        summary["apply_ms_max"] = toMs(times.back());
+    }
+    if (total.count() > 0)
+    {
+        auto secs = duration<double>(total).count();
+        summary["txs_per_sec"] = txs / secs;
+        summary["ops_per_sec"] = ops / secs;
+    }
+
+    std::vector<std::pair<size_t, OperationType>> byCount;
+    for (auto const& [type, count] : opTypeCounts)
+    {
+        byCount.emplace_back(count, type);
+    }
+    std::sort(byCount.rbegin(), byCount.rend());
+    auto& top = summary["op_types"];
+    top = Json::arrayValue;
+    for (auto const& [count, type] : byCount)
+    {
+        Json::Value t;
+        t["type"] = xdr::xdr_traits<OperationType>::enum_name(type);
+        t["count"] = static_cast<Json::UInt64>(count);
+        top.append(t);
+    }
+    return res;
+}
+
+int
+benchApply(Application::pointer app, uint32_t count,
+           std::shared_ptr<HistoryArchive> archive,
+           std::string const& outputFile)
+{
+    app->start();
+    auto& lm = app->getLedgerManager();
+    auto lcl = lm.getLastClosedLedgerNum();
+    LOG_INFO(DEFAULT_LOG, "Benchmarking apply of ledgers {}-{}", lcl + 1,
+             lcl + count);
+
+    std::vector<LedgerManager::ApplyStats> stats;
+    stats.reserve(count);
+    lm.setApplyStatsCallback(
+        [&](LedgerManager::ApplyStats const& s) { stats.emplace_back(s); });
+
+    CatchupConfiguration cc(lcl + count, count,
+                            CatchupConfiguration::Mode::OFFLINE_BASIC);
+    Json::Value catchupInfo;
+    auto res = catchupStarted(app, cc, catchupInfo, archive);
+    lm.setApplyStatsCallback(nullptr);
+
+    auto report = applyBenchReport(stats);
+    auto const& summary = report["summary"];
+    LOG_INFO(DEFAULT_LOG,
+             "Applied {} ledgers, {} txs, {} ops in {:.1f} ms of apply time",
+             summary["ledgers"].asUInt64(), summary["txs"].asUInt64(),
+             summary["ops"].asUInt64(), summary["apply_ms"].asDouble());
+
+    auto content = report.toStyledString();
+    if (outputFile.empty() || outputFile == "-")
+    {
+        std::cout << content << std::endl;
+    }
+    else
+    {
+        std::ofstream out{};
+        out.exceptions(std::ios::failbit | std::ios::badbit);
+        out.open(outputFile);
+        out.write(content.c_str(), content.size());
+        out.close();
+        LOG_INFO(DEFAULT_LOG, "Wrote apply benchmark to {}", outputFile);
+    }
+    return res;
+}
+
 int
 publish(Application::pointer app)
 {
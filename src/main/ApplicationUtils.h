@@ -13,6 +13,7 @@ namespace stellar
 {
 
 class CatchupConfiguration;
+struct SyntheticBucketListConfig;
 
 // Create application and validate its configuration
 Application::pointer setupApp(Config& cfg, VirtualClock& clock,
@@ -34,7 +35,9 @@ int dumpLedger(Config cfg, std::string const& outputFile,
                std::optional<uint32_t> lastModifiedLedgerCount,
                std::optional<uint64_t> limit,
                std::optional<std::string> groupBy,
-               std::optional<std::string> aggregate);
+               std::optional<std::string> aggregate,
+               std::optional<std::string> columns = std::nullopt,
+               uint32_t numThreads = 1);
 void showOfflineInfo(Config cfg, bool verbose);
 int reportLastHistoryCheckpoint(Config cfg, std::string const& outputFile);
 
@@ -43,9 +46,20 @@ int reportLastHistoryCheckpoint(Config cfg, std::string const& outputFile);
 // malformed JSON input.
 bool checkQuorumIntersectionFromJson(std::string const& jsonPath,
                                      std::optional<Config> const& cfg);
+// Same input as checkQuorumIntersectionFromJson, writes the question of
+// whether the network has two disjoint quorums to `outputPath` for a SAT
+// solver instead, see QuorumIntersectionCNF.
+void writeQuorumIntersectionCNFFromJson(std::string const& jsonPath,
+                                        std::string const& outputPath,
+                                        std::optional<Config> const& cfg);
 #ifdef BUILD_TESTS
 void loadXdr(Config cfg, std::string const& bucketFile);
 int rebuildLedgerFromBuckets(Config cfg);
+// Resets the database to genesis, like new-db, then replaces the BucketList
+// with a synthetic one shaped by blCfg, see SyntheticBucketList.h, and writes
+// its HAS to outputFile (if not empty).
+int generateBucketList(Config cfg, SyntheticBucketListConfig const& blCfg,
+                       std::string const& outputFile);
 #endif
 void genSeed();
 int initializeHistories(Config cfg,
@@ -54,6 +68,12 @@ void writeCatchupInfo(Json::Value const& catchupInfo,
                       std::string const& outputFile);
 int catchup(Application::pointer app, CatchupConfiguration cc,
             Json::Value& catchupInfo, std::shared_ptr<HistoryArchive> archive);
+// Replays the count ledgers after the LCL from archive, timing only the apply
+// of each ledger's transactions, and writes per-ledger times, throughput and
+// the operation types applied to outputFile (stdout if empty) as JSON.
+int benchApply(Application::pointer app, uint32_t count,
+               std::shared_ptr<HistoryArchive> archive,
+               std::string const& outputFile);
 // Reduild ledger state based on the buckets. Ensure ledger state is properly
 // reset before calling this function.
 bool applyBucketsForLCL(Application& app);
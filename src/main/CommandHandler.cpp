@@ -3,8 +3,12 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "main/CommandHandler.h"
+#include "bucket/BucketListSnapshot.h"
+#include "bucket/BucketManager.h"
+#include "bucket/BucketSnapshotManager.h"
 #include "crypto/Hex.h"
 #include "crypto/KeyUtils.h"
+#include "crypto/SecretKey.h"
 #include "herder/Herder.h"
 #include "history/HistoryArchiveManager.h"
 #include "ledger/InternalLedgerEntry.h"
@@ -13,6 +17,7 @@
 #include "ledger/LedgerTxnEntry.h"
 #include "ledger/LedgerTxnImpl.h"
 #include "ledger/NetworkConfig.h"
+#include "ledger/SorobanMetrics.h"
 #include "lib/http/server.hpp"
 #include "lib/json/json.h"
 #include "main/Application.h"
@@ -24,6 +29,8 @@
 #include "transactions/InvokeHostFunctionOpFrame.h"
 #include "transactions/TransactionBridge.h"
 #include "transactions/TransactionUtils.h"
+#include "util/ContentionProfiler.h"
+#include "util/FlightRecorder.h"
 #include "util/Logging.h"
 #include "util/StatusManager.h"
 #include <Tracy.hpp>
@@ -44,6 +51,7 @@
 #include "test/TestAccount.h"
 #include "test/TxTests.h"
 #endif
+#include <future>
 #include <iterator>
 #include <optional>
 #include <regex>
@@ -112,13 +120,17 @@ CommandHandler::CommandHandler(Application& app) : mApp(app)
         addRoute("unban", &CommandHandler::unban);
     }
 
+    addRoute("applytrace", &CommandHandler::applyTrace);
     addRoute("clearmetrics", &CommandHandler::clearMetrics);
+    addRoute("contention", &CommandHandler::contention);
+    addRoute("flightrecorder", &CommandHandler::flightRecorder);
     addRoute("info", &CommandHandler::info);
     addRoute("ll", &CommandHandler::ll);
     addRoute("logrotate", &CommandHandler::logRotate);
     addRoute("manualclose", &CommandHandler::manualClose);
     addRoute("metrics", &CommandHandler::metrics);
     addRoute("tx", &CommandHandler::tx);
+    addRoute("txbatch", &CommandHandler::txBatch);
     addRoute("getledgerentry", &CommandHandler::getLedgerEntry);
     addRoute("upgrades", &CommandHandler::upgrades);
     addRoute("dumpproposedsettings", &CommandHandler::dumpProposedSettings);
@@ -754,16 +766,31 @@ CommandHandler::sorobanInfo(std::string const& params, std::string& retStr)
         std::map<std::string, std::string> retMap;
         http::server::server::parseParams(params, retMap);
 
-        // Format is the only acceptable param, but it is optional
-        if (retMap.count("format") != retMap.size())
+        auto format =
+            parseOptionalParamOrDefault<std::string>(retMap, "format", "basic");
+
+        // Format is the only acceptable param, but it is optional. The
+        // profile format also takes a limit.
+        size_t expectedParams = retMap.count("format");
+        if (format == "profile")
+        {
+            expectedParams += retMap.count("limit");
+        }
+        if (expectedParams != retMap.size())
         {
             retStr = "Invalid param";
             return;
         }
 
-        auto format =
-            parseOptionalParamOrDefault<std::string>(retMap, "format", "basic");
-        if (format == "basic")
+        if (format == "profile")
+        {
+            auto limit =
+                parseOptionalParamOrDefault<size_t>(retMap, "limit", 10);
+            retStr = lm.getSorobanMetrics()
+                         .getContractProfilesJson(limit)
+                         .toStyledString();
+        }
+        else if (format == "basic")
         {
             Json::Value res;
             auto const& conf = lm.getSorobanNetworkConfig();
@@ -1014,29 +1041,7 @@ CommandHandler::tx(std::string const& params, std::string& retStr)
             mApp.getNetworkID(), envelope);
         if (transaction)
         {
-            // Add it to our current set and make sure it is valid.
-            TransactionQueue::AddResult status =
-                mApp.getHerder().recvTransaction(transaction, true);
-
-            root["status"] = TX_STATUS_STRING[static_cast<int>(status)];
-            if (status == TransactionQueue::AddResult::ADD_STATUS_ERROR)
-            {
-                std::string resultBase64;
-                auto resultBin = xdr::xdr_to_opaque(transaction->getResult());
-                resultBase64.reserve(decoder::encoded_size64(resultBin.size()) +
-                                     1);
-                resultBase64 = decoder::encode_b64(resultBin);
-                root["error"] = resultBase64;
-                if (mApp.getConfig().ENABLE_DIAGNOSTICS_FOR_TX_SUBMISSION &&
-                    transaction->isSoroban() &&
-                    !transaction->getDiagnosticEvents().empty())
-                {
-                    auto diagsBin =
-                        xdr::xdr_to_opaque(transaction->getDiagnosticEvents());
-                    auto diagsBase64 = decoder::encode_b64(diagsBin);
-                    root["diagnostic_events"] = diagsBase64;
-                }
-            }
+            root = submitTx(transaction);
         }
     }
     else
@@ -1048,6 +1053,243 @@ CommandHandler::tx(std::string const& params, std::string& retStr)
     retStr = Json::FastWriter().write(root);
 }
 
+Json::Value
+CommandHandler::submitTx(TransactionFrameBasePtr transaction)
+{
+    Json::Value root;
+
+    // Add it to our current set and make sure it is valid.
+    TransactionQueue::AddResult status =
+        mApp.getHerder().recvTransaction(transaction, true);
+
+    root["status"] = TX_STATUS_STRING[static_cast<int>(status)];
+    if (status == TransactionQueue::AddResult::ADD_STATUS_ERROR)
+    {
+        std::string resultBase64;
+        auto resultBin = xdr::xdr_to_opaque(transaction->getResult());
+        resultBase64.reserve(decoder::encoded_size64(resultBin.size()) + 1);
+        resultBase64 = decoder::encode_b64(resultBin);
+        root["error"] = resultBase64;
+        if (mApp.getConfig().ENABLE_DIAGNOSTICS_FOR_TX_SUBMISSION &&
+            transaction->isSoroban() &&
+            !transaction->getDiagnosticEvents().empty())
+        {
+            auto diagsBin =
+                xdr::xdr_to_opaque(transaction->getDiagnosticEvents());
+            auto diagsBase64 = decoder::encode_b64(diagsBin);
+            root["diagnostic_events"] = diagsBase64;
+        }
+    }
+    return root;
+}
+
+namespace
+{
+// Largest number of transactions a txbatch request may carry
+size_t const MAX_TX_BATCH_SIZE = 1000;
+
+// Smallest number of transactions worth decoding on a worker thread
+size_t const MIN_TXS_PER_BATCH_TASK = 32;
+
+struct TxBatchEntry
+{
+    uint8_t const* mBegin;
+    uint8_t const* mEnd;
+    TransactionFrameBasePtr mTx;
+    std::string mError;
+};
+
+// Cuts a txbatch payload into its envelopes, each preceded by its length as
+// a 4 byte big-endian integer
+std::vector<TxBatchEntry>
+splitTxBatch(std::vector<uint8_t> const& bin)
+{
+    std::vector<TxBatchEntry> entries;
+    size_t pos = 0;
+    while (pos < bin.size())
+    {
+        if (entries.size() == MAX_TX_BATCH_SIZE)
+        {
+            throw std::invalid_argument(fmt::format(
+                FMT_STRING("txbatch takes at most {:d} transactions"),
+                MAX_TX_BATCH_SIZE));
+        }
+        if (bin.size() - pos < 4)
+        {
+            throw std::invalid_argument("txbatch blob: truncated length");
+        }
+        uint32_t len = (static_cast<uint32_t>(bin[pos]) << 24) |
+                       (static_cast<uint32_t>(bin[pos + 1]) << 16) |
+                       (static_cast<uint32_t>(bin[pos + 2]) << 8) |
+                       static_cast<uint32_t>(bin[pos + 3]);
+        pos += 4;
+        if (len > bin.size() - pos)
+        {
+            throw std::invalid_argument("txbatch blob: truncated envelope");
+        }
+        auto& entry = entries.emplace_back();
+        entry.mBegin = bin.data() + pos;
+        entry.mEnd = entry.mBegin + len;
+        pos += len;
+    }
+    return entries;
+}
+
+// Decodes the envelopes of entries [begin, end) and, with a snapshot to look
+// up signers in, verifies their signatures so that admission on the main
+// thread finds them in the signature cache. The snapshot may be behind the
+// ledger: this only warms up the cache, the transactions are still checked
+// in full when they are submitted.
+void
+decodeTxBatch(Hash const& networkID, bool convertForV13,
+              std::shared_ptr<SearchableBucketListSnapshot> snapshot,
+              std::vector<TxBatchEntry>& entries, size_t begin, size_t end)
+{
+    ZoneScoped;
+    std::vector<SignatureToVerify> sigs;
+    for (size_t i = begin; i < end; ++i)
+    {
+        auto& entry = entries[i];
+        try
+        {
+            TransactionEnvelope envelope;
+            xdr::xdr_get g(entry.mBegin, entry.mEnd);
+            xdr::xdr_argpack_archive(g, envelope);
+            g.done();
+            if (convertForV13)
+            {
+                envelope = txbridge::convertForV13(envelope);
+            }
+            entry.mTx = TransactionFrameBase::makeTransactionFromWire(
+                networkID, envelope);
+        }
+        catch (std::exception const& e)
+        {
+            entry.mError = e.what();
+            continue;
+        }
+
+        if (snapshot && entry.mTx)
+        {
+            entry.mTx->insertSignaturesToVerify(
+                [&](AccountID const& accountID) {
+                    auto le = snapshot->getLedgerEntry(accountKey(accountID));
+                    return le ? le->data.account().signers
+                              : xdr::xvector<Signer, MAX_SIGNERS>{};
+                },
+                sigs);
+        }
+    }
+    if (!sigs.empty())
+    {
+        PubKeyUtils::verifySigs(sigs);
+    }
+}
+}
+
+void
+CommandHandler::txBatch(std::string const& params, std::string& retStr)
+{
+    ZoneScoped;
+    std::map<std::string, std::string> paramMap;
+    http::server::server::parseParams(params, paramMap);
+    std::string const& blob = paramMap["blob"];
+    if (blob.empty())
+    {
+        throw std::invalid_argument(
+            "Must specify a tx batch blob: txbatch?blob=<length-prefixed txs "
+            "in xdr format>");
+    }
+
+    std::vector<uint8_t> binBlob;
+    decoder::decode_b64(blob, binBlob);
+    auto entries = splitTxBatch(binBlob);
+
+    auto lhhe = mApp.getLedgerManager().getLastClosedLedgerHeader();
+    bool convertForV13 = protocolVersionStartsFrom(lhhe.header.ledgerVersion,
+                                                   ProtocolVersion::V_13);
+    auto const& cfg = mApp.getConfig();
+    auto getSnapshot = [&]() {
+        std::shared_ptr<SearchableBucketListSnapshot> snapshot;
+        if (cfg.isUsingBucketListDB())
+        {
+            snapshot = mApp.getBucketManager()
+                           .getBucketSnapshotManager()
+                           .getSearchableBucketListSnapshot();
+        }
+        return snapshot;
+    };
+
+    // Decode the envelopes and verify their signatures on the worker threads,
+    // while the main thread does its own share
+    auto numTasks =
+        std::max<size_t>(1, std::min<size_t>(cfg.WORKER_THREADS + 1,
+                                             entries.size() /
+                                                 MIN_TXS_PER_BATCH_TASK));
+    auto taskSize = (entries.size() + numTasks - 1) / numTasks;
+    using task_t = std::packaged_task<void()>;
+    std::vector<std::future<void>> futures;
+    for (size_t begin = taskSize; begin < entries.size(); begin += taskSize)
+    {
+        auto end = std::min(begin + taskSize, entries.size());
+        auto task = std::make_shared<task_t>(
+            [&entries, networkID = mApp.getNetworkID(), convertForV13,
+             snapshot = getSnapshot(), begin, end] {
+                decodeTxBatch(networkID, convertForV13, snapshot, entries,
+                              begin, end);
+            });
+        futures.emplace_back(task->get_future());
+        mApp.postOnBackgroundThread([task] { (*task)(); },
+                                    "CommandHandler: decode tx batch");
+    }
+
+    std::exception_ptr inlineError;
+    try
+    {
+        decodeTxBatch(mApp.getNetworkID(), convertForV13, getSnapshot(),
+                      entries, 0, std::min(taskSize, entries.size()));
+    }
+    catch (...)
+    {
+        inlineError = std::current_exception();
+    }
+
+    // Tasks reference the entries, so wait for all of them before going on,
+    // even on error
+    for (auto& f : futures)
+    {
+        f.wait();
+    }
+    if (inlineError)
+    {
+        std::rethrow_exception(inlineError);
+    }
+    for (auto& f : futures)
+    {
+        f.get();
+    }
+
+    // Admission itself depends on the queue state, so it stays sequential on
+    // the main thread, in batch order
+    Json::Value root(Json::arrayValue);
+    for (auto& entry : entries)
+    {
+        if (entry.mTx)
+        {
+            root.append(submitTx(entry.mTx));
+        }
+        else
+        {
+            Json::Value res;
+            res["exception"] = entry.mError.empty() ? std::string("generic")
+                                                    : entry.mError;
+            root.append(res);
+        }
+    }
+
+    retStr = Json::FastWriter().write(root);
+}
+
 void
 CommandHandler::dropcursor(std::string const& params, std::string& retStr)
 {
@@ -1154,6 +1396,65 @@ CommandHandler::clearMetrics(std::string const& params, std::string& retStr)
     retStr = fmt::format(FMT_STRING("Cleared {} metrics!"), domain);
 }
 
+void
+CommandHandler::applyTrace(std::string const& params, std::string& retStr)
+{
+    ZoneScoped;
+    std::map<std::string, std::string> map;
+    http::server::server::parseParams(params, map);
+    auto ledgerSeq = parseOptionalParam<uint32_t>(map, "ledger");
+
+    auto trace = mApp.getLedgerManager().getApplyTrace(ledgerSeq);
+    if (!trace)
+    {
+        throw std::invalid_argument(
+            mApp.getConfig().APPLY_TRACE_LEDGERS == 0
+                ? "Apply tracing is disabled, set APPLY_TRACE_LEDGERS"
+                : "No apply trace for that ledger");
+    }
+    retStr = std::move(*trace);
+}
+
+void
+CommandHandler::flightRecorder(std::string const& params, std::string& retStr)
+{
+    ZoneScoped;
+    std::map<std::string, std::string> map;
+    http::server::server::parseParams(params, map);
+    auto ledgers = parseOptionalParam<uint32_t>(map, "ledgers");
+
+    auto& recorder = mApp.getFlightRecorder();
+    if (!recorder.enabled())
+    {
+        throw std::invalid_argument(
+            "Flight recorder is disabled, set FLIGHT_RECORDER_LEDGERS");
+    }
+    retStr = recorder.dump(ledgers.value_or(0));
+}
+
+void
+CommandHandler::contention(std::string const& params, std::string& retStr)
+{
+    ZoneScoped;
+    std::map<std::string, std::string> map;
+    http::server::server::parseParams(params, map);
+    auto enable = parseOptionalParam<std::string>(map, "enable");
+    if (enable && *enable != "true" && *enable != "false")
+    {
+        throw std::invalid_argument("enable must be true or false");
+    }
+
+    if (parseOptionalParamOrDefault<bool>(map, "reset", false))
+    {
+        ContentionProfiler::reset();
+    }
+    if (enable)
+    {
+        ContentionProfiler::setEnabled(*enable == "true");
+    }
+    retStr = ContentionProfiler::report().toStyledString();
+}
+
 void
 CommandHandler::checkBooted() const
 {
@@ -1327,6 +1628,8 @@ CommandHandler::generateLoad(std::string const& params, std::string& retStr)
             parseOptionalParam<uint32_t>(map, "maxfeerate");
         cfg.skipLowFeeTxs =
             parseOptionalParamOrDefault<bool>(map, "skiplowfeetxs", false);
+        cfg.openLoop =
+            parseOptionalParamOrDefault<bool>(map, "openloop", false);
 
         if (cfg.mode == LoadGenMode::MIXED_CLASSIC)
         {
@@ -1414,6 +1717,60 @@ CommandHandler::generateLoad(std::string const& params, std::string& retStr)
             }
         }
 
+        if (cfg.isDexSetup() || cfg.mode == LoadGenMode::DEX_STRESS)
+        {
+            auto& dexCfg = cfg.getMutDexStressConfig();
+            dexCfg.nAssets =
+                parseOptionalParamOrDefault<uint32_t>(map, "dexassets", 4);
+            dexCfg.bookDepth =
+                parseOptionalParamOrDefault<uint32_t>(map, "dexdepth", 10);
+            dexCfg.maxPathLength =
+                parseOptionalParamOrDefault<uint32_t>(map, "dexmaxpath", 3);
+            dexCfg.crossWeight =
+                parseOptionalParamOrDefault<uint32_t>(map, "crossweight", 1);
+            dexCfg.pathWeight =
+                parseOptionalParamOrDefault<uint32_t>(map, "pathweight", 1);
+            dexCfg.churnWeight =
+                parseOptionalParamOrDefault<uint32_t>(map, "churnweight", 1);
+            if (!(dexCfg.crossWeight || dexCfg.pathWeight ||
+                  dexCfg.churnWeight))
+            {
+                retStr = "At least one DEX weight must be non-zero";
+                return;
+            }
+        }
+
+        if (cfg.mode == LoadGenMode::SOROBAN_STATE)
+        {
+            auto& stateCfg = cfg.getMutSorobanStateConfig();
+            stateCfg.createWeight =
+                parseOptionalParamOrDefault<uint32_t>(map, "createweight", 1);
+            stateCfg.readWeight =
+                parseOptionalParamOrDefault<uint32_t>(map, "readweight", 1);
+            stateCfg.writeWeight =
+                parseOptionalParamOrDefault<uint32_t>(map, "writeweight", 1);
+            stateCfg.extendWeight =
+                parseOptionalParamOrDefault<uint32_t>(map, "extendweight", 1);
+            stateCfg.restoreWeight =
+                parseOptionalParamOrDefault<uint32_t>(map, "restoreweight", 1);
+            stateCfg.temporaryPercent =
+                parseOptionalParamOrDefault<uint32_t>(map, "temppercent", 0);
+            stateCfg.footprintEntries =
+                parseOptionalParamOrDefault<uint32_t>(map, "footprint", 10);
+            if (!(stateCfg.createWeight || stateCfg.readWeight ||
+                  stateCfg.writeWeight || stateCfg.extendWeight ||
+                  stateCfg.restoreWeight))
+            {
+                retStr = "At least one state weight must be non-zero";
+                return;
+            }
+            if (stateCfg.temporaryPercent > 100)
+            {
+                retStr = "temppercent must be <= 100";
+                return;
+            }
+        }
+
         if (cfg.maxGeneratedFeeRate)
         {
             auto baseFee = mApp.getLedgerManager().getLastTxFee();
@@ -1428,6 +1785,7 @@ CommandHandler::generateLoad(std::string const& params, std::string& retStr)
         Json::Value res;
         res["status"] = cfg.getStatus();
         mApp.generateLoad(cfg);
+        res["confirmation"] = mApp.getLoadGenerator().getConfirmationStatus();
 
         if (cfg.mode == LoadGenMode::SOROBAN_CREATE_UPGRADE)
         {
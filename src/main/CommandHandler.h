@@ -5,6 +5,8 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "lib/http/server.hpp"
+#include "lib/json/json.h"
+#include "transactions/TransactionFrameBase.h"
 #include "util/ProtocolVersion.h"
 #include <string>
 
@@ -35,6 +37,10 @@ class CommandHandler
     void ensureProtocolVersion(std::string const& errString,
                                ProtocolVersion minVer);
 
+    // Submits transaction to the herder and returns its status, as reported
+    // by the tx and txbatch routes
+    Json::Value submitTx(TransactionFrameBasePtr transaction);
+
   public:
     CommandHandler(Application& app);
 
@@ -53,6 +59,9 @@ class CommandHandler
     void manualClose(std::string const& params, std::string& retStr);
     void metrics(std::string const& params, std::string& retStr);
     void clearMetrics(std::string const& params, std::string& retStr);
+    void applyTrace(std::string const& params, std::string& retStr);
+    void flightRecorder(std::string const& params, std::string& retStr);
+    void contention(std::string const& params, std::string& retStr);
     void peers(std::string const& params, std::string& retStr);
     void selfCheck(std::string const&, std::string& retStr);
     void quorum(std::string const& params, std::string& retStr);
@@ -60,6 +69,7 @@ class CommandHandler
     void getcursor(std::string const& params, std::string& retStr);
     void scpInfo(std::string const& params, std::string& retStr);
     void tx(std::string const& params, std::string& retStr);
+    void txBatch(std::string const& params, std::string& retStr);
     void getLedgerEntry(std::string const& params, std::string& retStr);
     void unban(std::string const& params, std::string& retStr);
     void upgrades(std::string const& params, std::string& retStr);
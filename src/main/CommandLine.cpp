@@ -15,6 +15,7 @@
 #include "crypto/SHA.h"
 #include "herder/Herder.h"
 #include "history/HistoryArchiveManager.h"
+#include "history/HistoryManager.h"
 #include "historywork/BatchDownloadWork.h"
 #include "historywork/WriteVerifiedCheckpointHashesWork.h"
 #include "ledger/LedgerManager.h"
@@ -39,15 +40,18 @@
 #include <cereal/cereal.hpp>
 
 #ifdef BUILD_TESTS
+#include "bucket/test/SyntheticBucketList.h"
 #include "test/Fuzzer.h"
 #include "test/fuzz.h"
 #include "test/test.h"
 #endif
 
+#include <algorithm>
 #include <fmt/format.h>
 #include <iostream>
 #include <lib/clara.hpp>
 #include <optional>
+#include <thread>
 
 namespace stellar
 {
@@ -450,6 +454,25 @@ aggregateParser(std::optional<std::string>& aggregate)
         "comma-separated aggregate expressions");
 }
 
+clara::Opt
+columnsParser(std::optional<std::string>& columns)
+{
+    return clara::Opt{[&](std::string const& arg) { columns = arg; },
+                      "FIELDS-EXPR"}["--columns"](
+        "comma-separated fields to output as CSV columns instead of JSON");
+}
+
+clara::Opt
+threadsParser(uint32_t& numThreads)
+{
+    return clara::Opt{[&](std::string const& arg) {
+                          numThreads = static_cast<uint32_t>(std::stoul(arg));
+                      },
+                      "NUM"}["--threads"](
+        "number of threads reading the bucket list, defaults to the number of "
+        "cores");
+}
+
 clara::Opt
 limitParser(std::optional<std::uint64_t>& limit)
 {
@@ -583,6 +606,8 @@ CommandLine::ConfigOption::getConfig(bool logToFile) const
 
     if (logToFile)
     {
+        Logging::setAsyncLogging(config.LOG_ASYNC_QUEUE_SIZE,
+                                 config.LOG_ASYNC_DROP_OLDEST);
         if (!config.LOG_FILE_PATH.empty())
         {
             Logging::setLoggingToFile(config.LOG_FILE_PATH);
@@ -769,6 +794,48 @@ runReplayDebugMeta(CommandLineArgs const& args)
         });
 }
 
+int
+runBenchApply(CommandLineArgs const& args)
+{
+    CommandLine::ConfigOption configOption;
+    uint32_t count = 0;
+    std::string archive;
+    std::string outputFile;
+
+    auto validateCount = [&] {
+        return count == 0 ? std::string{"LEDGER-COUNT must be positive"}
+                          : std::string{};
+    };
+    auto countParser = ParserWithValidation{
+        clara::Arg(count, "LEDGER-COUNT").required(), validateCount};
+
+    return runWithHelp(
+        args,
+        {configurationParser(configOption), countParser,
+         historyArchiveParser(archive), outputFileParser(outputFile)},
+        [&] {
+            auto config = configOption.getConfig();
+            config.setNoListen();
+            config.RUN_STANDALONE = true;
+            config.MANUAL_CLOSE = true;
+            config.AUTOMATIC_SELF_CHECK_PERIOD = std::chrono::seconds::zero();
+            // Nothing but the apply itself should be measured
+            config.METADATA_OUTPUT_STREAM = "";
+            config.METADATA_FILTERED_OUTPUT_STREAMS.clear();
+            config.METADATA_DEBUG_LEDGERS = 0;
+
+            VirtualClock clock(VirtualClock::REAL_TIME);
+            auto app = Application::create(clock, config, false);
+            auto const& ham = app->getHistoryArchiveManager();
+            auto archivePtr = ham.getHistoryArchive(archive);
+            if (iequals(archive, "any"))
+            {
+                archivePtr = ham.selectRandomReadableHistoryArchive();
+            }
+            return benchApply(app, count, archivePtr, outputFile);
+        });
+}
+
 int
 runCatchup(CommandLineArgs const& args)
 {
@@ -976,6 +1043,70 @@ runCatchup(CommandLineArgs const& args)
         });
 }
 
+int
+runSplitCatchup(CommandLineArgs const& args)
+{
+    CommandLine::ConfigOption configOption;
+    std::string catchupString;
+    std::string hash;
+    uint32_t parts = 1;
+
+    auto validateCatchupString = [&] {
+        try
+        {
+            auto cc = parseCatchup(catchupString, hash, false);
+            if (cc.toLedger() == CatchupConfiguration::CURRENT)
+            {
+                return std::string{
+                    "Catchup error: destination ledger must be a number"};
+            }
+            return std::string{};
+        }
+        catch (std::runtime_error& e)
+        {
+            return std::string{e.what()};
+        }
+    };
+    auto catchupStringParser = ParserWithValidation{
+        clara::Arg(catchupString, "DESTINATION-LEDGER/LEDGER-COUNT").required(),
+        validateCatchupString};
+    auto partsParser = ParserWithValidation{
+        clara::Opt{parts, "PARTS"}["--parts"](
+            "most catchups to split the range into"),
+        [&] {
+            return parts > 0 ? std::string{}
+                             : std::string{"--parts must be positive"};
+        }};
+
+    return runWithHelp(
+        args,
+        {configurationParser(configOption), catchupStringParser, partsParser,
+         ledgerHashParser(hash)},
+        [&] {
+            auto config = configOption.getConfig();
+            auto cc = parseCatchup(catchupString, hash, false);
+            for (auto const& part : splitCatchupConfiguration(
+                     cc, parts, HistoryManager::getCheckpointFrequency(config)))
+            {
+                std::cout << part.toLedger() << "/";
+                if (part.count() == std::numeric_limits<uint32_t>::max())
+                {
+                    std::cout << "max";
+                }
+                else
+                {
+                    std::cout << part.count();
+                }
+                if (part.hash())
+                {
+                    std::cout << " --trusted-hash " << binToHex(*part.hash());
+                }
+                std::cout << std::endl;
+            }
+            return 0;
+        });
+}
+
 int
 runPublish(CommandLineArgs const& args)
 {
@@ -1058,10 +1189,22 @@ runDumpXDR(CommandLineArgs const& args)
 {
     std::string xdr;
     bool compact = false;
+    bool lines = false;
+    std::optional<std::string> filterQuery;
+    uint32_t numThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    auto linesParser = [](bool& lines) {
+        return clara::Opt{lines}["--lines"](
+            "stream one compact JSON object per line, decoding in parallel");
+    };
 
-    return runWithHelp(args, {compactParser(compact), fileNameParser(xdr)},
+    return runWithHelp(args,
+                       {compactParser(compact), linesParser(lines),
+                        filterQueryParser(filterQuery),
+                        threadsParser(numThreads), fileNameParser(xdr)},
                        [&] {
-                           dumpXdrStream(xdr, compact);
+                           dumpXdrStream(xdr, compact, lines, filterQuery,
+                                         numThreads);
                            return 0;
                        });
 }
@@ -1188,19 +1331,21 @@ runDumpLedger(CommandLineArgs const& args)
     std::optional<uint64_t> limit;
     std::optional<std::string> groupBy;
     std::optional<std::string> aggregate;
-    return runWithHelp(args,
-                       {configurationParser(configOption),
-                        outputFileParser(outputFile).required(),
-                        filterQueryParser(filterQuery),
-                        lastModifiedLedgerCountParser(lastModifiedLedgerCount),
-                        limitParser(limit), groupByParser(groupBy),
-                        aggregateParser(aggregate)},
-                       [&] {
-                           return dumpLedger(configOption.getConfig(),
-                                             outputFile, filterQuery,
-                                             lastModifiedLedgerCount, limit,
-                                             groupBy, aggregate);
-                       });
+    std::optional<std::string> columns;
+    uint32_t numThreads = std::max(1u, std::thread::hardware_concurrency());
+    return runWithHelp(
+        args,
+        {configurationParser(configOption),
+         outputFileParser(outputFile).required(),
+         filterQueryParser(filterQuery),
+         lastModifiedLedgerCountParser(lastModifiedLedgerCount),
+         limitParser(limit), groupByParser(groupBy), aggregateParser(aggregate),
+         columnsParser(columns), threadsParser(numThreads)},
+        [&] {
+            return dumpLedger(configOption.getConfig(), outputFile,
+                              filterQuery, lastModifiedLedgerCount, limit,
+                              groupBy, aggregate, columns, numThreads);
+        });
 }
 
 int
@@ -1376,10 +1521,14 @@ runCheckQuorumIntersection(CommandLineArgs const& args)
 {
     CommandLine::ConfigOption configOption;
     std::string jsonPath;
+    std::string cnfPath;
     return runWithHelp(
         args,
         {logLevelParser(configOption.mLogLevel), fileNameParser(jsonPath),
          consoleParser(configOption.mConsoleLog),
+         clara::Opt{cnfPath, "FILE-NAME"}["--cnf-output"](
+             "write the check as a DIMACS CNF formula for a SAT solver "
+             "instead of running it; satisfiable means no intersection"),
          clara::Opt{configOption.mConfigFile,
                     "FILE-NAME"}["--conf"](fmt::format(
              FMT_STRING("specify a config file to enable human readable "
@@ -1400,6 +1549,11 @@ runCheckQuorumIntersection(CommandLineArgs const& args)
                 {
                     cfg.emplace(configOption.getConfig(true));
                 }
+                if (!cnfPath.empty())
+                {
+                    writeQuorumIntersectionCNFFromJson(jsonPath, cnfPath, cfg);
+                    return 0;
+                }
                 if (checkQuorumIntersectionFromJson(jsonPath, cfg))
                 {
                     CLOG_INFO(SCP, "Network enjoys quorum intersection");
@@ -1739,6 +1893,60 @@ runRebuildLedgerFromBuckets(CommandLineArgs const& args)
     });
 }
 
+int
+runGenerateBucketList(CommandLineArgs const& args)
+{
+    CommandLine::ConfigOption configOption;
+    SyntheticBucketListConfig blCfg;
+    std::string mix;
+    std::string outputFile;
+
+    auto validateMix = [&] {
+        if (mix.empty())
+        {
+            return std::string{};
+        }
+        try
+        {
+            blCfg.parseEntryMix(mix);
+            return std::string{};
+        }
+        catch (std::invalid_argument const& e)
+        {
+            return std::string{e.what()};
+        }
+    };
+
+    return runWithHelp(
+        args,
+        {configurationParser(configOption),
+         clara::Opt{blCfg.mLedger, "LEDGER"}["--ledger"](
+             "ledger the BucketList is generated as of (default 1000000)"),
+         clara::Opt{blCfg.mEntriesPerLedger, "N"}["--entries-per-ledger"](
+             "entries each ledger adds to the buckets covering it (default "
+             "10)"),
+         clara::Opt{blCfg.mMaxBucketEntries, "N"}["--max-bucket-entries"](
+             "cap on the entries of any one bucket (default none)"),
+         {clara::Opt{mix, "MIX"}["--entry-mix"](
+              "weights of entry types, like account=40,trustline=25,offer=5,"
+              "data=2,persistent=20,temporary=6,code=2 (the default)"),
+          validateMix},
+         clara::Opt{blCfg.mUpdatePercent, "PERCENT"}["--update-percent"](
+             "entries that update older ones (default 60)"),
+         clara::Opt{blCfg.mDeletePercent, "PERCENT"}["--delete-percent"](
+             "entries that delete older ones (default 5)"),
+         clara::Opt{blCfg.mRecencyBias, "BIAS"}["--recency-bias"](
+             "1 to update and delete uniformly among older entries, more "
+             "to favor recent ones (default 1)"),
+         clara::Opt{blCfg.mExpiredPercent, "PERCENT"}["--expired-percent"](
+             "contract entries whose TTL has expired (default 10)"),
+         outputFileParser(outputFile)},
+        [&] {
+            return generateBucketList(configOption.getConfig(), blCfg,
+                                      outputFile);
+        });
+}
+
 ParserWithValidation
 fuzzerModeParser(std::string& fuzzerModeArg, FuzzerMode& fuzzerMode)
 {
@@ -1826,10 +2034,16 @@ int
 handleCommandLine(int argc, char* const* argv)
 {
     auto commandLine = CommandLine{
-        {{"catchup",
+        {{"bench-apply",
+          "replay ledgers after the LCL from history, timing their apply",
+          runBenchApply},
+         {"catchup",
           "execute catchup from history archives without connecting to "
           "network",
           runCatchup},
+         {"split-catchup",
+          "print the catchups that replay a range in parallel parts",
+          runSplitCatchup},
          {"replay-debug-meta", "apply ledgers from local debug metadata files",
           runReplayDebugMeta},
          {"verify-checkpoints", "write verified checkpoint ledger hashes",
@@ -1889,6 +2103,9 @@ handleCommandLine(int argc, char* const* argv)
          {"rebuild-ledger-from-buckets",
           "rebuild the current database ledger from the bucket list",
           runRebuildLedgerFromBuckets},
+         {"generate-bucketlist",
+          "reset the database to a synthetic bucket list, for benchmarks",
+          runGenerateBucketList},
          {"fuzz", "run a single fuzz input and exit", runFuzz},
          {"gen-fuzz", "generate a random fuzzer input file", runGenFuzz},
          {"test", "execute test suite", runTest},
@@ -7,8 +7,10 @@
 #include "bucket/BucketList.h"
 #include "crypto/Hex.h"
 #include "crypto/KeyUtils.h"
+#include "crypto/SecretKey.h"
 #include "herder/Herder.h"
 #include "history/HistoryArchive.h"
+#include "history/HistoryArchiveHttpClient.h"
 #include "ledger/LedgerManager.h"
 #include "main/ExternalQueue.h"
 #include "main/StellarCoreVersion.h"
@@ -17,6 +19,7 @@
 #include "util/Fs.h"
 #include "util/GlobalChecks.h"
 #include "util/Logging.h"
+#include "util/Thread.h"
 #include "util/XDROperators.h"
 #include "util/types.h"
 
@@ -161,13 +164,44 @@ Config::Config() : NODE_SEED(SecretKey::random())
     MANUAL_CLOSE = false;
     CATCHUP_COMPLETE = false;
     CATCHUP_RECENT = 0;
+    CATCHUP_DOWNLOAD_AHEAD_CHECKPOINTS = 0;
     EXPERIMENTAL_PRECAUTION_DELAY_META = false;
+    EXPERIMENTAL_ASYNC_META_STREAM_MAX_LAG = 0;
     EXPERIMENTAL_BACKGROUND_OVERLAY_PROCESSING = false;
+    EXPERIMENTAL_BACKGROUND_OVERLAY_THREADS = 1;
+    EXPERIMENTAL_BACKGROUND_TX_SIG_VERIFICATION = false;
     DEPRECATED_SQL_LEDGER_STATE = false;
     BUCKETLIST_DB_INDEX_PAGE_SIZE_EXPONENT = 14; // 2^14 == 16 kb
     BUCKETLIST_DB_INDEX_CUTOFF = 20;             // 20 mb
     BUCKETLIST_DB_PERSIST_INDEX = true;
+    BUCKETLIST_DB_MMAP_READS = false;
+    BUCKETLIST_DB_BLOCK_CACHE_SIZE = 0;
+    BUCKETLIST_DB_BLOCKED_BLOOM_FILTER = false;
+    BUCKETLIST_DB_PARALLEL_LOAD_THRESHOLD = 0;
+    BUCKETLIST_DB_INDEX_BUILD_MEMORY_LIMIT = 0;
     EXPERIMENTAL_BACKGROUND_EVICTION_SCAN = false;
+    EXPERIMENTAL_BACKGROUND_EVICTION_SCAN_THREADS = 1;
+    EXPERIMENTAL_LOOKAHEAD_PREFETCH = false;
+    EXPERIMENTAL_SPECULATIVE_TX_SET_PREPARATION = false;
+    EXPERIMENTAL_TX_SET_CANDIDATE_REFRESH_MS = 0;
+    EXPERIMENTAL_PERSIST_TX_QUEUE = false;
+    EXPERIMENTAL_SOROBAN_SCARCITY_PACKING = false;
+    EXPERIMENTAL_ADAPTIVE_TRIGGER_MAX_ADVANCE_MS = 0;
+    EXPERIMENTAL_IN_MEMORY_LEDGER_INDEX = false;
+    EXPERIMENTAL_IN_MEMORY_ORDERBOOK = false;
+    EXPERIMENTAL_OFFERS_IN_BUCKETLIST_DB = false;
+    EXPERIMENTAL_METADATA_ONLY_MODE = false;
+    EXPERIMENTAL_BUCKET_APPLY_WITH_COPY = false;
+    EXPERIMENTAL_PIPELINED_LEDGER_CLOSE = false;
+    EXPERIMENTAL_PARALLEL_SIGNATURE_VERIFICATION = false;
+    VERIFY_SIG_CACHE_SIZE = PubKeyUtils::DEFAULT_VERIFY_SIG_CACHE_SIZE;
+    APPLY_TRACE_LEDGERS = 0;
+    FLIGHT_RECORDER_LEDGERS = 10;
+    FLIGHT_RECORDER_DUMP_THRESHOLD_MS = 0;
+    CONTENTION_PROFILING = false;
+    BUCKET_MERGE_THREADS = 0;
+    BUCKET_MERGE_STREAMING_IO_THRESHOLD = 0;
+    BUCKET_IN_MEMORY_CUTOFF = 8; // 8 mb
     PUBLISH_TO_ARCHIVE_DELAY = std::chrono::seconds{0};
     // automatic maintenance settings:
     // short and prime with 1 hour which will cause automatic maintenance to
@@ -181,6 +215,8 @@ Config::Config() : NODE_SEED(SecretKey::random())
     AUTOMATIC_MAINTENANCE_COUNT = 400;
     // automatic self-check happens once every 3 hours
     AUTOMATIC_SELF_CHECK_PERIOD = std::chrono::seconds{3 * 60 * 60};
+    SELF_CHECK_MAX_CONCURRENT_BUCKETS = 4;
+    SELF_CHECK_MAX_READ_BYTES_PER_SECOND = 0;
     ARTIFICIALLY_GENERATE_LOAD_FOR_TESTING = false;
     ARTIFICIALLY_ACCELERATE_TIME_FOR_TESTING = false;
     ARTIFICIALLY_SET_CLOSE_TIME_FOR_TESTING = 0;
@@ -197,6 +233,7 @@ Config::Config() : NODE_SEED(SecretKey::random())
     DISABLE_BUCKET_GC = false;
     DISABLE_XDR_FSYNC = false;
     MAX_SLOTS_TO_REMEMBER = 12;
+    PENDING_ENVELOPES_MEMORY_LIMIT_MB = 0;
     // Configure MAXIMUM_LEDGER_CLOSETIME_DRIFT based on MAX_SLOTS_TO_REMEMBER
     // (plus a small buffer) to make sure we don't reject SCP state sent to us
     // by default. Limit allowed drift to 90 seconds as to not overwhelm the
@@ -213,8 +250,12 @@ Config::Config() : NODE_SEED(SecretKey::random())
 
     LOG_FILE_PATH = "stellar-core-{datetime:%Y-%m-%d_%H-%M-%S}.log";
     BUCKET_DIR_PATH = "buckets";
+    BUCKET_CACHE_DIR_PATH = "";
+    BUCKET_CACHE_READ_ONLY = false;
 
     LOG_COLOR = false;
+    LOG_ASYNC_QUEUE_SIZE = 8192;
+    LOG_ASYNC_DROP_OLDEST = false;
 
     TESTING_UPGRADE_LEDGER_PROTOCOL_VERSION = LEDGER_PROTOCOL_VERSION;
     TESTING_UPGRADE_DESIRED_FEE = LedgerManager::GENESIS_LEDGER_BASE_FEE;
@@ -225,6 +266,8 @@ Config::Config() : NODE_SEED(SecretKey::random())
     HTTP_PORT = DEFAULT_PEER_PORT + 1;
     PUBLIC_HTTP_PORT = false;
     HTTP_MAX_CLIENT = 128;
+    HTTP_QUERY_PORT = 0;
+    QUERY_THREAD_POOL_SIZE = 4;
     PEER_PORT = DEFAULT_PEER_PORT;
     TARGET_PEER_CONNECTIONS = 8;
     MAX_PENDING_CONNECTIONS = 500;
@@ -246,10 +289,13 @@ Config::Config() : NODE_SEED(SecretKey::random())
 
     FLOOD_DEMAND_PERIOD_MS = std::chrono::milliseconds(200);
     FLOOD_ADVERT_PERIOD_MS = std::chrono::milliseconds(100);
+    FLOOD_ADVERT_RELAY_FANOUT = 0;
+    FLOOD_ADVERT_RELAY_PREFER_FAST_PEERS = false;
     FLOOD_DEMAND_BACKOFF_DELAY_MS = std::chrono::milliseconds(500);
 
     MAX_BATCH_WRITE_COUNT = 1024;
     MAX_BATCH_WRITE_BYTES = 1 * 1024 * 1024;
+    PEER_FLOOD_WRITE_BACKLOG_BYTES = 0;
     PREFERRED_PEERS_ONLY = false;
 
     PEER_READING_CAPACITY = 200;
@@ -262,6 +308,7 @@ Config::Config() : NODE_SEED(SecretKey::random())
     FLOW_CONTROL_SEND_MORE_BATCH_SIZE_BYTES = 0;
     OUTBOUND_TX_QUEUE_BYTE_LIMIT = 1024 * 1024 * 3;
     ENABLE_FLOW_CONTROL_BYTES = true;
+    FLOW_CONTROL_TARGET_QUEUE_DELAY_MS = 200;
 
     // WORKER_THREADS: setting this too low risks a form of priority inversion
     // where a long-running background task occupies all worker threads and
@@ -275,11 +322,16 @@ Config::Config() : NODE_SEED(SecretKey::random())
     // Worst case = 10 concurrent merges + 1 quorum intersection calculation.
     WORKER_THREADS = 11;
     MAX_CONCURRENT_SUBPROCESSES = 16;
+    GZIP_COMMAND = "gzip";
     NODE_IS_VALIDATOR = false;
     QUORUM_INTERSECTION_CHECKER = true;
+    QUORUM_INTERSECTION_CHECKER_THREADS = 1;
     DATABASE = SecretValue{"sqlite3://:memory:"};
+    SQLITE_PROFILE = "DURABLE";
+    INVARIANT_CHECKS_IN_BACKGROUND = false;
 
     ENTRY_CACHE_SIZE = 100000;
+    PERSIST_ENTRY_CACHE_KEYS = false;
     PREFETCH_BATCH_SIZE = 1000;
 
     HISTOGRAM_WINDOW_SIZE = std::chrono::seconds(30);
@@ -350,6 +402,22 @@ readString(ConfigItem const& item)
     return item.second->as<std::string>()->get();
 }
 
+std::string
+readCpuList(ConfigItem const& item)
+{
+    auto list = readString(item);
+    try
+    {
+        parseCpuList(list);
+    }
+    catch (std::invalid_argument const&)
+    {
+        throw std::invalid_argument(
+            fmt::format(FMT_STRING("invalid CPU list in '{}'"), item.first));
+    }
+    return list;
+}
+
 template <typename T>
 std::vector<T>
 readArray(ConfigItem const& item)
@@ -549,10 +617,20 @@ Config::loadQset(std::shared_ptr<cpptoml::table> group, SCPQuorumSet& qset,
 
 void
 Config::addHistoryArchive(std::string const& name, std::string const& get,
-                          std::string const& put, std::string const& mkdir)
+                          std::string const& put, std::string const& mkdir,
+                          std::string const& url)
 {
+    std::string host, port, path;
+    if (!url.empty() &&
+        !HistoryArchiveHttpClient::parseUrl(url, host, port, path))
+    {
+        throw std::invalid_argument(fmt::format(
+            FMT_STRING("Archive '{}' url must be of the form "
+                       "http://host[:port][/path]"),
+            name));
+    }
     auto r = HISTORY.insert(std::make_pair(
-        name, HistoryArchiveConfiguration{name, get, put, mkdir}));
+        name, HistoryArchiveConfiguration{name, get, put, mkdir, url}));
     if (!r.second)
     {
         throw std::invalid_argument(
@@ -764,6 +842,58 @@ Config::parseDomainsQuality(std::shared_ptr<cpptoml::base> domainsQuality)
     return res;
 }
 
+void
+Config::parseFilteredMetaStreams(std::shared_ptr<cpptoml::base> streams)
+{
+    auto tarr = streams->as_table_array();
+    if (!tarr)
+    {
+        throw std::invalid_argument(
+            "malformed METADATA_FILTERED_OUTPUT_STREAMS");
+    }
+    METADATA_FILTERED_OUTPUT_STREAMS.clear();
+    for (auto const& streamRaw : *tarr)
+    {
+        auto stream = streamRaw->as_table();
+        if (!stream)
+        {
+            throw std::invalid_argument(
+                "malformed METADATA_FILTERED_OUTPUT_STREAMS");
+        }
+        FilteredMetaStream fs;
+        for (auto const& f : *stream)
+        {
+            if (f.first == "DESTINATION")
+            {
+                fs.mDestination = readString(f);
+            }
+            else if (f.first == "ENTRY_QUERY")
+            {
+                fs.mEntryQuery = readString(f);
+            }
+            else if (f.first == "EVENT_QUERY")
+            {
+                fs.mEventQuery = readString(f);
+            }
+            else
+            {
+                throw std::invalid_argument(fmt::format(
+                    FMT_STRING("Unknown field '{}' in "
+                               "METADATA_FILTERED_OUTPUT_STREAMS"),
+                    f.first));
+            }
+        }
+        if (fs.mDestination.empty() ||
+            (fs.mEntryQuery.empty() && fs.mEventQuery.empty()))
+        {
+            throw std::invalid_argument(
+                "METADATA_FILTERED_OUTPUT_STREAMS entries need a DESTINATION "
+                "and at least one of ENTRY_QUERY and EVENT_QUERY");
+        }
+        METADATA_FILTERED_OUTPUT_STREAMS.emplace_back(std::move(fs));
+    }
+}
+
 void
 Config::load(std::string const& filename)
 {
@@ -1039,6 +1169,10 @@ Config::processConfig(std::shared_ptr<cpptoml::table> t)
             {
                 OUTBOUND_TX_QUEUE_BYTE_LIMIT = readInt<uint32_t>(item, 1);
             }
+            else if (item.first == "FLOW_CONTROL_TARGET_QUEUE_DELAY_MS")
+            {
+                FLOW_CONTROL_TARGET_QUEUE_DELAY_MS = readInt<uint32_t>(item);
+            }
             else if (item.first == "PEER_PORT")
             {
                 PEER_PORT = readInt<unsigned short>(item, 1);
@@ -1055,6 +1189,14 @@ Config::processConfig(std::shared_ptr<cpptoml::table> t)
             {
                 PUBLIC_HTTP_PORT = readBool(item);
             }
+            else if (item.first == "HTTP_QUERY_PORT")
+            {
+                HTTP_QUERY_PORT = readInt<unsigned short>(item);
+            }
+            else if (item.first == "QUERY_THREAD_POOL_SIZE")
+            {
+                QUERY_THREAD_POOL_SIZE = readInt<size_t>(item, 1, 1000);
+            }
             else if (item.first == "FAILURE_SAFETY")
             {
                 FAILURE_SAFETY = readInt<int32_t>(item, -1, INT32_MAX - 1);
@@ -1071,18 +1213,133 @@ Config::processConfig(std::shared_ptr<cpptoml::table> t)
             {
                 METADATA_OUTPUT_STREAM = readString(item);
             }
+            else if (item.first == "METADATA_FILTERED_OUTPUT_STREAMS")
+            {
+                parseFilteredMetaStreams(item.second);
+            }
             else if (item.first == "EXPERIMENTAL_PRECAUTION_DELAY_META")
             {
                 EXPERIMENTAL_PRECAUTION_DELAY_META = readBool(item);
             }
+            else if (item.first == "EXPERIMENTAL_ASYNC_META_STREAM_MAX_LAG")
+            {
+                EXPERIMENTAL_ASYNC_META_STREAM_MAX_LAG =
+                    readInt<uint32_t>(item, 0, 1000);
+            }
             else if (item.first == "EXPERIMENTAL_BACKGROUND_OVERLAY_PROCESSING")
             {
                 EXPERIMENTAL_BACKGROUND_OVERLAY_PROCESSING = readBool(item);
             }
+            else if (item.first == "EXPERIMENTAL_BACKGROUND_OVERLAY_THREADS")
+            {
+                EXPERIMENTAL_BACKGROUND_OVERLAY_THREADS =
+                    readInt<int>(item, 1, 64);
+            }
+            else if (item.first ==
+                     "EXPERIMENTAL_BACKGROUND_TX_SIG_VERIFICATION")
+            {
+                EXPERIMENTAL_BACKGROUND_TX_SIG_VERIFICATION = readBool(item);
+            }
             else if (item.first == "EXPERIMENTAL_BACKGROUND_EVICTION_SCAN")
             {
                 EXPERIMENTAL_BACKGROUND_EVICTION_SCAN = readBool(item);
             }
+            else if (item.first ==
+                     "EXPERIMENTAL_BACKGROUND_EVICTION_SCAN_THREADS")
+            {
+                EXPERIMENTAL_BACKGROUND_EVICTION_SCAN_THREADS =
+                    readInt<int>(item, 1, 64);
+            }
+            else if (item.first == "EXPERIMENTAL_LOOKAHEAD_PREFETCH")
+            {
+                EXPERIMENTAL_LOOKAHEAD_PREFETCH = readBool(item);
+            }
+            else if (item.first ==
+                     "EXPERIMENTAL_SPECULATIVE_TX_SET_PREPARATION")
+            {
+                EXPERIMENTAL_SPECULATIVE_TX_SET_PREPARATION = readBool(item);
+            }
+            else if (item.first == "EXPERIMENTAL_TX_SET_CANDIDATE_REFRESH_MS")
+            {
+                EXPERIMENTAL_TX_SET_CANDIDATE_REFRESH_MS =
+                    readInt<uint32_t>(item, 0, 60000);
+            }
+            else if (item.first == "EXPERIMENTAL_PERSIST_TX_QUEUE")
+            {
+                EXPERIMENTAL_PERSIST_TX_QUEUE = readBool(item);
+            }
+            else if (item.first == "EXPERIMENTAL_SOROBAN_SCARCITY_PACKING")
+            {
+                EXPERIMENTAL_SOROBAN_SCARCITY_PACKING = readBool(item);
+            }
+            else if (item.first ==
+                     "EXPERIMENTAL_ADAPTIVE_TRIGGER_MAX_ADVANCE_MS")
+            {
+                EXPERIMENTAL_ADAPTIVE_TRIGGER_MAX_ADVANCE_MS =
+                    readInt<uint32_t>(item, 0, 5000);
+            }
+            else if (item.first == "EXPERIMENTAL_IN_MEMORY_LEDGER_INDEX")
+            {
+                EXPERIMENTAL_IN_MEMORY_LEDGER_INDEX = readBool(item);
+            }
+            else if (item.first == "EXPERIMENTAL_IN_MEMORY_ORDERBOOK")
+            {
+                EXPERIMENTAL_IN_MEMORY_ORDERBOOK = readBool(item);
+            }
+            else if (item.first == "EXPERIMENTAL_OFFERS_IN_BUCKETLIST_DB")
+            {
+                EXPERIMENTAL_OFFERS_IN_BUCKETLIST_DB = readBool(item);
+            }
+            else if (item.first == "EXPERIMENTAL_METADATA_ONLY_MODE")
+            {
+                EXPERIMENTAL_METADATA_ONLY_MODE = readBool(item);
+            }
+            else if (item.first == "EXPERIMENTAL_BUCKET_APPLY_WITH_COPY")
+            {
+                EXPERIMENTAL_BUCKET_APPLY_WITH_COPY = readBool(item);
+            }
+            else if (item.first == "EXPERIMENTAL_PIPELINED_LEDGER_CLOSE")
+            {
+                EXPERIMENTAL_PIPELINED_LEDGER_CLOSE = readBool(item);
+            }
+            else if (item.first ==
+                     "EXPERIMENTAL_PARALLEL_SIGNATURE_VERIFICATION")
+            {
+                EXPERIMENTAL_PARALLEL_SIGNATURE_VERIFICATION = readBool(item);
+            }
+            else if (item.first == "VERIFY_SIG_CACHE_SIZE")
+            {
+                VERIFY_SIG_CACHE_SIZE = readInt<size_t>(
+                    item, PubKeyUtils::VERIFY_SIG_CACHE_SHARDS);
+            }
+            else if (item.first == "APPLY_TRACE_LEDGERS")
+            {
+                APPLY_TRACE_LEDGERS = readInt<uint32_t>(item, 0, 100);
+            }
+            else if (item.first == "FLIGHT_RECORDER_LEDGERS")
+            {
+                FLIGHT_RECORDER_LEDGERS = readInt<uint32_t>(item, 0, 1000);
+            }
+            else if (item.first == "FLIGHT_RECORDER_DUMP_THRESHOLD_MS")
+            {
+                FLIGHT_RECORDER_DUMP_THRESHOLD_MS = readInt<uint32_t>(item);
+            }
+            else if (item.first == "CONTENTION_PROFILING")
+            {
+                CONTENTION_PROFILING = readBool(item);
+            }
+            else if (item.first == "BUCKET_MERGE_THREADS")
+            {
+                BUCKET_MERGE_THREADS = readInt<int>(item, 0, 1000);
+            }
+            else if (item.first == "BUCKET_MERGE_STREAMING_IO_THRESHOLD")
+            {
+                BUCKET_MERGE_STREAMING_IO_THRESHOLD = readInt<size_t>(item);
+            }
+            else if (item.first == "BUCKET_IN_MEMORY_CUTOFF")
+            {
+                BUCKET_IN_MEMORY_CUTOFF = readInt<size_t>(item);
+            }
             else if (item.first == "DEPRECATED_SQL_LEDGER_STATE")
             {
                 DEPRECATED_SQL_LEDGER_STATE = readBool(item);
@@ -1134,6 +1391,26 @@ Config::processConfig(std::shared_ptr<cpptoml::table> t)
             {
                 BUCKETLIST_DB_PERSIST_INDEX = readBool(item);
             }
+            else if (item.first == "BUCKETLIST_DB_MMAP_READS")
+            {
+                BUCKETLIST_DB_MMAP_READS = readBool(item);
+            }
+            else if (item.first == "BUCKETLIST_DB_BLOCK_CACHE_SIZE")
+            {
+                BUCKETLIST_DB_BLOCK_CACHE_SIZE = readInt<size_t>(item);
+            }
+            else if (item.first == "BUCKETLIST_DB_BLOCKED_BLOOM_FILTER")
+            {
+                BUCKETLIST_DB_BLOCKED_BLOOM_FILTER = readBool(item);
+            }
+            else if (item.first == "BUCKETLIST_DB_PARALLEL_LOAD_THRESHOLD")
+            {
+                BUCKETLIST_DB_PARALLEL_LOAD_THRESHOLD = readInt<size_t>(item);
+            }
+            else if (item.first == "BUCKETLIST_DB_INDEX_BUILD_MEMORY_LIMIT")
+            {
+                BUCKETLIST_DB_INDEX_BUILD_MEMORY_LIMIT = readInt<size_t>(item);
+            }
             else if (item.first == "METADATA_DEBUG_LEDGERS")
             {
                 METADATA_DEBUG_LEDGERS = readInt<uint32_t>(item);
@@ -1162,6 +1439,11 @@ Config::processConfig(std::shared_ptr<cpptoml::table> t)
             {
                 CATCHUP_RECENT = readInt<uint32_t>(item, 0, UINT32_MAX - 1);
             }
+            else if (item.first == "CATCHUP_DOWNLOAD_AHEAD_CHECKPOINTS")
+            {
+                CATCHUP_DOWNLOAD_AHEAD_CHECKPOINTS =
+                    readInt<uint32_t>(item, 0, 1024);
+            }
             else if (item.first == "ARTIFICIALLY_GENERATE_LOAD_FOR_TESTING")
             {
                 ARTIFICIALLY_GENERATE_LOAD_FOR_TESTING = readBool(item);
@@ -1179,6 +1461,10 @@ Config::processConfig(std::shared_ptr<cpptoml::table> t)
             {
                 MAX_SLOTS_TO_REMEMBER = readInt<uint32>(item);
             }
+            else if (item.first == "PENDING_ENVELOPES_MEMORY_LIMIT_MB")
+            {
+                PENDING_ENVELOPES_MEMORY_LIMIT_MB = readInt<uint32_t>(item);
+            }
             else if (item.first ==
                      "ARTIFICIALLY_REPLAY_WITH_NEWEST_BUCKET_LOGIC_FOR_TESTING")
             {
@@ -1214,6 +1500,15 @@ Config::processConfig(std::shared_ptr<cpptoml::table> t)
                 AUTOMATIC_SELF_CHECK_PERIOD =
                     std::chrono::seconds{readInt<uint32_t>(item)};
             }
+            else if (item.first == "SELF_CHECK_MAX_CONCURRENT_BUCKETS")
+            {
+                SELF_CHECK_MAX_CONCURRENT_BUCKETS = readInt<uint32_t>(item, 1);
+            }
+            else if (item.first == "SELF_CHECK_MAX_READ_BYTES_PER_SECOND")
+            {
+                SELF_CHECK_MAX_READ_BYTES_PER_SECOND =
+                    readInt<int64_t>(item, 0);
+            }
             else if (item.first == "MANUAL_CLOSE")
             {
                 MANUAL_CLOSE = readBool(item);
@@ -1226,10 +1521,26 @@ Config::processConfig(std::shared_ptr<cpptoml::table> t)
             {
                 LOG_COLOR = readBool(item);
             }
+            else if (item.first == "LOG_ASYNC_QUEUE_SIZE")
+            {
+                LOG_ASYNC_QUEUE_SIZE = readInt<uint32_t>(item, 0, 1 << 20);
+            }
+            else if (item.first == "LOG_ASYNC_DROP_OLDEST")
+            {
+                LOG_ASYNC_DROP_OLDEST = readBool(item);
+            }
             else if (item.first == "BUCKET_DIR_PATH")
             {
                 BUCKET_DIR_PATH = readString(item);
             }
+            else if (item.first == "BUCKET_CACHE_DIR_PATH")
+            {
+                BUCKET_CACHE_DIR_PATH = readString(item);
+            }
+            else if (item.first == "BUCKET_CACHE_READ_ONLY")
+            {
+                BUCKET_CACHE_READ_ONLY = readBool(item);
+            }
             else if (item.first == "NODE_NAMES")
             {
                 auto names = readArray<std::string>(item);
@@ -1289,6 +1600,10 @@ Config::processConfig(std::shared_ptr<cpptoml::table> t)
             {
                 MAX_BATCH_WRITE_BYTES = readInt<int>(item, 1);
             }
+            else if (item.first == "PEER_FLOOD_WRITE_BACKLOG_BYTES")
+            {
+                PEER_FLOOD_WRITE_BACKLOG_BYTES = readInt<int>(item, 0);
+            }
             else if (item.first == "FLOOD_OP_RATE_PER_LEDGER")
             {
                 FLOOD_OP_RATE_PER_LEDGER = readDouble(item);
@@ -1325,6 +1640,14 @@ Config::processConfig(std::shared_ptr<cpptoml::table> t)
                 FLOOD_ADVERT_PERIOD_MS =
                     std::chrono::milliseconds(readInt<int>(item, 1));
             }
+            else if (item.first == "FLOOD_ADVERT_RELAY_FANOUT")
+            {
+                FLOOD_ADVERT_RELAY_FANOUT = readInt<uint32_t>(item, 0, 1000);
+            }
+            else if (item.first == "FLOOD_ADVERT_RELAY_PREFER_FAST_PEERS")
+            {
+                FLOOD_ADVERT_RELAY_PREFER_FAST_PEERS = readBool(item);
+            }
             else if (item.first == "FLOOD_DEMAND_BACKOFF_DELAY_MS")
             {
                 FLOOD_DEMAND_BACKOFF_DELAY_MS =
@@ -1374,14 +1697,39 @@ Config::processConfig(std::shared_ptr<cpptoml::table> t)
             {
                 WORKER_THREADS = readInt<int>(item, 2, 1000);
             }
+            else if (item.first == "MAIN_THREAD_CPUS")
+            {
+                MAIN_THREAD_CPUS = readCpuList(item);
+            }
+            else if (item.first == "WORKER_THREAD_CPUS")
+            {
+                WORKER_THREAD_CPUS = readCpuList(item);
+            }
+            else if (item.first == "MERGE_THREAD_CPUS")
+            {
+                MERGE_THREAD_CPUS = readCpuList(item);
+            }
+            else if (item.first == "OVERLAY_THREAD_CPUS")
+            {
+                OVERLAY_THREAD_CPUS = readCpuList(item);
+            }
             else if (item.first == "MAX_CONCURRENT_SUBPROCESSES")
             {
                 MAX_CONCURRENT_SUBPROCESSES = readInt<size_t>(item, 1);
             }
+            else if (item.first == "GZIP_COMMAND")
+            {
+                GZIP_COMMAND = readString(item);
+            }
             else if (item.first == "QUORUM_INTERSECTION_CHECKER")
             {
                 QUORUM_INTERSECTION_CHECKER = readBool(item);
             }
+            else if (item.first == "QUORUM_INTERSECTION_CHECKER_THREADS")
+            {
+                QUORUM_INTERSECTION_CHECKER_THREADS =
+                    readInt<uint32_t>(item, 1, 64);
+            }
             else if (item.first == "HISTORY")
             {
                 auto hist = item.second->as_table();
@@ -1397,7 +1745,7 @@ Config::processConfig(std::shared_ptr<cpptoml::table> t)
                             throw std::invalid_argument(
                                 "malformed HISTORY config block");
                         }
-                        std::string get, put, mkdir;
+                        std::string get, put, mkdir, url;
                         for (auto const& c : *tab)
                         {
                             if (c.first == "get")
@@ -1412,6 +1760,10 @@ Config::processConfig(std::shared_ptr<cpptoml::table> t)
                             {
                                 mkdir = c.second->as<std::string>()->get();
                             }
+                            else if (c.first == "url")
+                            {
+                                url = c.second->as<std::string>()->get();
+                            }
                             else
                             {
                                 std::string err(
@@ -1422,7 +1774,8 @@ Config::processConfig(std::shared_ptr<cpptoml::table> t)
                                 throw std::invalid_argument(err);
                             }
                         }
-                        addHistoryArchive(archive.first, get, put, mkdir);
+                        addHistoryArchive(archive.first, get, put, mkdir,
+                                          url);
                     }
                 }
                 else
@@ -1434,6 +1787,14 @@ Config::processConfig(std::shared_ptr<cpptoml::table> t)
             {
                 DATABASE = SecretValue{readString(item)};
             }
+            else if (item.first == "SQLITE_PROFILE")
+            {
+                SQLITE_PROFILE = readString(item);
+                if (SQLITE_PROFILE != "DURABLE" && SQLITE_PROFILE != "FAST")
+                {
+                    throw std::invalid_argument("bad value for SQLITE_PROFILE");
+                }
+            }
             else if (item.first == "NETWORK_PASSPHRASE")
             {
                 NETWORK_PASSPHRASE = readString(item);
@@ -1442,10 +1803,39 @@ Config::processConfig(std::shared_ptr<cpptoml::table> t)
             {
                 INVARIANT_CHECKS = readArray<std::string>(item);
             }
+            else if (item.first == "INVARIANT_CHECK_SAMPLE_RATES")
+            {
+                auto rates = item.second->as_table();
+                if (!rates)
+                {
+                    throw std::invalid_argument(
+                        "malformed INVARIANT_CHECK_SAMPLE_RATES config block");
+                }
+                for (auto const& rate : *rates)
+                {
+                    auto value = rate.second->as<double>();
+                    if (!value || !(value->get() > 0.0 && value->get() <= 1.0))
+                    {
+                        throw std::invalid_argument(fmt::format(
+                            FMT_STRING("bad value for "
+                                       "INVARIANT_CHECK_SAMPLE_RATES.{}"),
+                            rate.first));
+                    }
+                    INVARIANT_CHECK_SAMPLE_RATES[rate.first] = value->get();
+                }
+            }
+            else if (item.first == "INVARIANT_CHECKS_IN_BACKGROUND")
+            {
+                INVARIANT_CHECKS_IN_BACKGROUND = readBool(item);
+            }
             else if (item.first == "ENTRY_CACHE_SIZE")
             {
                 ENTRY_CACHE_SIZE = readInt<uint32_t>(item);
             }
+            else if (item.first == "PERSIST_ENTRY_CACHE_KEYS")
+            {
+                PERSIST_ENTRY_CACHE_KEYS = readBool(item);
+            }
             else if (item.first == "PREFETCH_BATCH_SIZE")
             {
                 PREFETCH_BATCH_SIZE = readInt<uint32_t>(item);
@@ -1733,6 +2123,15 @@ Config::processConfig(std::shared_ptr<cpptoml::table> t)
         // Validators default to starting the network from local state
         FORCE_SCP = NODE_IS_VALIDATOR;
 
+        // A validator rolled back by a power loss could vote differently
+        // for a ledger than it already did
+        if (NODE_IS_VALIDATOR && SQLITE_PROFILE == "FAST")
+        {
+            std::string msg = "Invalid configuration: validators must use "
+                              "SQLITE_PROFILE=\"DURABLE\"";
+            throw std::runtime_error(msg);
+        }
+
         // Require either DEPRECATED_SQL_LEDGER_STATE or
         // EXPERIMENTAL_BUCKETLIST_DB to be backwards compatible with horizon
         // and RPC, but do not allow both.
@@ -1860,6 +2259,11 @@ Config::processConfig(std::shared_ptr<cpptoml::table> t)
                     : ValidationThresholdLevels::SIMPLE_MAJORITY;
         }
 
+        if (EXPERIMENTAL_METADATA_ONLY_MODE)
+        {
+            setMetadataOnlyMode();
+        }
+
         adjust();
         validateConfig(thresholdLevel);
     }
@@ -2022,6 +2426,10 @@ Config::logBasicInfo()
              "EXPERIMENTAL_BACKGROUND_OVERLAY_PROCESSING="
              "{}",
              EXPERIMENTAL_BACKGROUND_OVERLAY_PROCESSING ? "true" : "false");
+    LOG_INFO(DEFAULT_LOG, "EXPERIMENTAL_BACKGROUND_OVERLAY_THREADS={}",
+             EXPERIMENTAL_BACKGROUND_OVERLAY_THREADS);
+    LOG_INFO(DEFAULT_LOG, "EXPERIMENTAL_BACKGROUND_TX_SIG_VERIFICATION={}",
+             EXPERIMENTAL_BACKGROUND_TX_SIG_VERIFICATION ? "true" : "false");
 }
 
 void
@@ -2308,6 +2716,15 @@ Config::setInMemoryMode()
     MODE_ENABLES_BUCKETLIST = true;
 }
 
+void
+Config::setMetadataOnlyMode()
+{
+    EXPERIMENTAL_METADATA_ONLY_MODE = true;
+    MODE_STORES_HISTORY_MISC = false;
+    MODE_STORES_HISTORY_LEDGERHEADERS = false;
+    EXPERIMENTAL_OFFERS_IN_BUCKETLIST_DB = true;
+}
+
 bool
 Config::modeDoesCatchupWithBucketList() const
 {
@@ -2327,6 +2744,13 @@ Config::isUsingBucketListDB() const
            MODE_ENABLES_BUCKETLIST;
 }
 
+bool
+Config::isUsingBucketListDBForType(LedgerEntryType t) const
+{
+    return isUsingBucketListDB() &&
+           (t != OFFER || EXPERIMENTAL_OFFERS_IN_BUCKETLIST_DB);
+}
+
 bool
 Config::isPersistingBucketListDBIndexes() const
 {
@@ -2357,6 +2781,7 @@ Config::setNoListen()
     // prevent opening up a port for other peers
     RUN_STANDALONE = true;
     HTTP_PORT = 0;
+    HTTP_QUERY_PORT = 0;
     MANUAL_CLOSE = true;
 }
 
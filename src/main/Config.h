@@ -28,6 +28,9 @@ struct HistoryArchiveConfiguration
     std::string mGetCmd;
     std::string mPutCmd;
     std::string mMkdirCmd;
+    // Base http:// url that files are downloaded from in process, instead of
+    // running mGetCmd
+    std::string mGetUrl;
 };
 
 enum class ValidationThresholdLevels : int
@@ -74,7 +77,8 @@ class Config : public std::enable_shared_from_this<Config>
     void addValidatorName(std::string const& pubKeyStr,
                           std::string const& name);
     void addHistoryArchive(std::string const& name, std::string const& get,
-                           std::string const& put, std::string const& mkdir);
+                           std::string const& put, std::string const& mkdir,
+                           std::string const& url = "");
 
     std::string toString(ValidatorQuality q) const;
     ValidatorQuality parseQuality(std::string const& q) const;
@@ -86,6 +90,8 @@ class Config : public std::enable_shared_from_this<Config>
     UnorderedMap<std::string, ValidatorQuality>
     parseDomainsQuality(std::shared_ptr<cpptoml::base> domainsQuality);
 
+    void parseFilteredMetaStreams(std::shared_ptr<cpptoml::base> streams);
+
     static SCPQuorumSet
     generateQuorumSetHelper(std::vector<ValidatorEntry>::const_iterator begin,
                             std::vector<ValidatorEntry>::const_iterator end,
@@ -157,16 +163,26 @@ class Config : public std::enable_shared_from_this<Config>
     // If you want, say, a week of history, set this to 120000.
     uint32_t CATCHUP_RECENT;
 
+    // Number of checkpoints replay keeps in flight: while one applies, the
+    // following ones download and wait their turn. 0 (the default) means
+    // MAX_CONCURRENT_SUBPROCESSES.
+    uint32_t CATCHUP_DOWNLOAD_AHEAD_CHECKPOINTS;
+
     // Interval between automatic maintenance executions
     std::chrono::seconds AUTOMATIC_MAINTENANCE_PERIOD;
 
     // Number of unneeded rows in each table that will be removed during one
-    // maintenance run
+    // maintenance run, at most: see Maintainer
     uint32_t AUTOMATIC_MAINTENANCE_COUNT;
 
     // Interval between automatic invocations of self-check.
     std::chrono::seconds AUTOMATIC_SELF_CHECK_PERIOD;
 
+    // Most buckets the offline self-check verifies at once, and the most
+    // bytes per second it reads from them in total (0 for no limit).
+    uint32_t SELF_CHECK_MAX_CONCURRENT_BUCKETS;
+    int64_t SELF_CHECK_MAX_READ_BYTES_PER_SECOND;
+
     // A config parameter that enables synthetic load generation on demand,
     // using the `generateload` runtime command (see CommandHandler.cpp). This
     // option only exists for stress-testing and should not be enabled in
@@ -332,6 +348,13 @@ class Config : public std::enable_shared_from_this<Config>
     // Byte limit for outbound transaction queue.
     uint32_t OUTBOUND_TX_QUEUE_BYTE_LIMIT;
 
+    // Target for how long transaction flood messages read from peers wait
+    // for the main thread. Above it, or when the action queue is overloaded,
+    // only part of the flood capacity freed by processing is granted back to
+    // peers, so they send flood traffic more slowly until the delay recovers.
+    // 0 disables this.
+    uint32_t FLOW_CONTROL_TARGET_QUEUE_DELAY_MS;
+
     // A config parameter that allows a node to generate buckets. This should
     // be set to `false` only for testing purposes.
     bool MODE_ENABLES_BUCKETLIST;
@@ -346,6 +369,12 @@ class Config : public std::enable_shared_from_this<Config>
     // configuration) to delay emitting metadata by one ledger.
     bool EXPERIMENTAL_PRECAUTION_DELAY_META;
 
+    // When nonzero, metadata is written to METADATA_OUTPUT_STREAM on a
+    // background thread, which can fall behind ledger close by at most this
+    // many ledgers before ledger close waits for it. Zero writes metadata
+    // synchronously during ledger close.
+    uint32_t EXPERIMENTAL_ASYNC_META_STREAM_MAX_LAG;
+
     // A config parameter that when set uses SQL as the primary
     // key-value store for LedgerEntry lookups instead of BucketListDB.
     bool DEPRECATED_SQL_LEDGER_STATE;
@@ -366,6 +395,17 @@ class Config : public std::enable_shared_from_this<Config>
     // Enable parallel processing of overlay operations (experimental)
     bool EXPERIMENTAL_BACKGROUND_OVERLAY_PROCESSING;
 
+    // Number of threads background overlay processing runs on. Each peer is
+    // assigned to one of them, round robin, when it connects. Requires
+    // EXPERIMENTAL_BACKGROUND_OVERLAY_PROCESSING if above 1.
+    int EXPERIMENTAL_BACKGROUND_OVERLAY_THREADS;
+
+    // Verify signatures of flooded transactions on the overlay thread, with
+    // signers read from a BucketList snapshot, before handing them to the
+    // main thread (experimental). Requires
+    // EXPERIMENTAL_BACKGROUND_OVERLAY_PROCESSING and BucketListDB.
+    bool EXPERIMENTAL_BACKGROUND_TX_SIG_VERIFICATION;
+
     // When set to true, BucketListDB indexes are persisted on-disk so that the
     // BucketList does not need to be reindexed on startup. Defaults to true.
     // This should only be set to false for testing purposes
@@ -374,10 +414,158 @@ class Config : public std::enable_shared_from_this<Config>
     // persisted.
     bool BUCKETLIST_DB_PERSIST_INDEX;
 
+    // When set to true, BucketListDB point and bulk loads decode entries
+    // directly from memory mapped bucket files instead of going through a
+    // file stream seek and read for every key. Bucket files are immutable once
+    // written, so this is safe, but it increases the page cache footprint of
+    // the process.
+    bool BUCKETLIST_DB_MMAP_READS;
+
+    // Size, in MB, of the in-memory LRU cache of bucket file pages used by
+    // BucketListDB range index lookups. If set to 0, the cache is disabled
+    // and every page is read from disk.
+    size_t BUCKETLIST_DB_BLOCK_CACHE_SIZE;
+
+    // When set to true, range indexes use a cache-line blocked bloom filter
+    // instead of the classic bloom filter. Each negative lookup then touches
+    // a single cache line. Changing this flag invalidates persisted indexes.
+    bool BUCKETLIST_DB_BLOCKED_BLOOM_FILTER;
+
+    // Bulk loads issued from the main thread with at least this many keys
+    // probe every bucket in parallel on the worker thread pool, then resolve
+    // results newest bucket first. If set to 0, bulk loads always probe
+    // buckets sequentially.
+    size_t BUCKETLIST_DB_PARALLEL_LOAD_THRESHOLD;
+
+    // Budget, in MB, for the estimated memory of bucket indexes being built
+    // concurrently at startup and during catchup. If set to 0, only the
+    // number of worker threads bounds index construction.
+    size_t BUCKETLIST_DB_INDEX_BUILD_MEMORY_LIMIT;
+
+    // Number of dedicated threads for bucket merges. Merges queued on these
+    // threads run in order of how soon the BucketList needs their output, so
+    // shallow levels are never stuck behind deep level merges or unrelated
+    // background work. If set to 0, merges run on the generic worker threads.
+    int BUCKET_MERGE_THREADS;
+
+    // Merges whose inputs are at least this many MB in total read their
+    // inputs through a large buffer and drop their output from the page cache
+    // as it is written, so that deep level merges do not evict the pages of
+    // the shallow buckets that are queried on every ledger. If set to 0, all
+    // merges go through the page cache as usual.
+    size_t BUCKET_MERGE_STREAMING_IO_THRESHOLD;
+
+    // Buckets whose files are at most this many MB, which in practice are the
+    // shallowest levels, keep their entries in memory once written, so that
+    // their merges, lookups and index builds don't read the file back. The
+    // file is still written, for publishing and restarts. If set to 0, every
+    // bucket is read from its file.
+    size_t BUCKET_IN_MEMORY_CUTOFF;
+
     // When set to true, eviction scans occur on the background thread,
     // increasing performance. Requires EXPERIMENTAL_BUCKETLIST_DB.
     bool EXPERIMENTAL_BACKGROUND_EVICTION_SCAN;
 
+    // Number of threads used by the background eviction scan. The scan region
+    // is planned up front and its buckets are scanned concurrently on this
+    // many worker threads, then results are combined in scan order. Only used
+    // when EXPERIMENTAL_BACKGROUND_EVICTION_SCAN is set.
+    int EXPERIMENTAL_BACKGROUND_EVICTION_SCAN_THREADS;
+
+    // When set to true, the keys that the next ledger's tx set will load are
+    // read from the BucketList on a background thread as soon as the ballot
+    // for it is confirmed prepared, and the results are added to the entry
+    // cache before the ledger closes. Requires BucketListDB and
+    // PREFETCH_BATCH_SIZE > 0.
+    bool EXPERIMENTAL_LOOKAHEAD_PREFETCH;
+
+    // When set to true, the tx set of the ballot the node started or accepted
+    // as prepared is prepared for apply ahead of externalization, and the
+    // signatures of its transactions are verified on the worker threads. If
+    // that tx set is externalized, ledger close reuses the work.
+    bool EXPERIMENTAL_SPECULATIVE_TX_SET_PREPARATION;
+
+    // When non-zero, the herder rebuilds a candidate tx set for the next
+    // nomination at most this often (in milliseconds) while transactions
+    // are added to or removed from the queues. Nomination uses the candidate
+    // when the queues have not changed since it was built.
+    uint32_t EXPERIMENTAL_TX_SET_CANDIDATE_REFRESH_MS;
+
+    // When set, the transactions still queued at shutdown are saved to the
+    // database and queued again, after being revalidated against the last
+    // closed ledger, when the node starts.
+    bool EXPERIMENTAL_PERSIST_TX_QUEUE;
+
+    // When set, the Soroban phase of the tx sets this node nominates is
+    // filled by inclusion fee per unit of scarce resources instead of by fee
+    // rate, see SurgePricingPriorityQueue::getMostTopTxsByScarcityWithinLimits.
+    bool EXPERIMENTAL_SOROBAN_SCARCITY_PACKING;
+
+    // When non-zero, the next ledger is triggered earlier than the expected
+    // close time by the estimated nomination latency, by at most this many
+    // milliseconds and only while transactions are queued.
+    uint32_t EXPERIMENTAL_ADAPTIVE_TRIGGER_MAX_ADVANCE_MS;
+
+    // When set in in-memory mode, applying buckets seeds a compact index of
+    // the newest version of every entry under the in-memory LedgerTxn instead
+    // of creating every entry in it. Meant for load testing with ledgers of
+    // mainnet size.
+    bool EXPERIMENTAL_IN_MEMORY_LEDGER_INDEX;
+
+    // When set, all offers are also held in memory, sorted per asset pair, so
+    // that best offers are found without querying the database
+    bool EXPERIMENTAL_IN_MEMORY_ORDERBOOK;
+
+    // When set with BucketListDB, offers are no longer written to the offers
+    // table: they are read from the BucketList like every other entry type,
+    // and best offers come from the in-memory order book, which is built from
+    // the BucketList on first use.
+    bool EXPERIMENTAL_OFFERS_IN_BUCKETLIST_DB;
+
+    // For a node that only exists to emit METADATA_OUTPUT_STREAM: nothing
+    // but the last closed ledger is written to the database on each close.
+    // Transaction, SCP and upgrade history and ledger headers are not stored,
+    // and offers are kept in BucketListDB only (see setMetadataOnlyMode).
+    bool EXPERIMENTAL_METADATA_ONLY_MODE;
+
+    // When set, applying buckets to a PostgreSQL database (during catchup or
+    // a ledger rebuild) writes entries with COPY into staging tables, then
+    // merges each batch into the ledger tables with one statement
+    bool EXPERIMENTAL_BUCKET_APPLY_WITH_COPY;
+
+    // When set, the steps of closing a ledger that follow the database commit
+    // (starting the eviction scan, publishing history and forgetting unused
+    // buckets) are queued on the main thread rather than run before the
+    // close returns, and complete before the next ledger closes
+    bool EXPERIMENTAL_PIPELINED_LEDGER_CLOSE;
+
+    // When set, the signatures of all transactions in a ledger are verified
+    // on the worker threads before the transactions are applied, so that
+    // apply finds the results in the signature cache
+    bool EXPERIMENTAL_PARALLEL_SIGNATURE_VERIFICATION;
+
+    // Number of entries of the process-wide signature verification cache,
+    // split evenly between its lock-striped shards
+    size_t VERIFY_SIG_CACHE_SIZE;
+
+    // Number of most recent ledgers for which a trace of the wall time, entry
+    // loads and bytes read of each transaction and operation applied is kept,
+    // for the `applytrace` HTTP command. 0 disables tracing.
+    uint32_t APPLY_TRACE_LEDGERS;
+
+    // Number of most recent ledgers whose close stages, SCP events and
+    // scheduler queue depths the flight recorder keeps, for the
+    // `flightrecorder` HTTP command. 0 disables it.
+    uint32_t FLIGHT_RECORDER_LEDGERS;
+    // Closes taking longer than this write the flight recorder to the
+    // flight-recorder directory under BUCKET_DIR_PATH. 0 disables this.
+    uint32_t FLIGHT_RECORDER_DUMP_THRESHOLD_MS;
+
+    // Record time spent waiting for the profiled mutexes and in blocking
+    // file syncs, for the `contention` HTTP command. Can also be toggled at
+    // runtime by that command.
+    bool CONTENTION_PROFILING;
+
     // A config parameter that stores historical data, such as transactions,
     // fees, and scp history in the database
     bool MODE_STORES_HISTORY_MISC;
@@ -435,6 +623,12 @@ class Config : public std::enable_shared_from_this<Config>
     // approximately ~1 min of network activity.
     uint32 MAX_SLOTS_TO_REMEMBER;
 
+    // Upper bound, in megabytes, on the SCP envelopes and tx sets held for
+    // slots that SCP has not consumed or purged yet. Above it, whole slots
+    // furthest from the one consensus is working on are dropped. 0 means no
+    // bound.
+    uint32_t PENDING_ENVELOPES_MEMORY_LIMIT_MB;
+
     // A string specifying a stream to write fine-grained metadata to for each
     // ledger close while running. This will be opened at startup and
     // synchronously streamed-to during both catchup and live ledger-closing.
@@ -452,6 +646,19 @@ class Config : public std::enable_shared_from_this<Config>
     // in consensus, only a passive "watcher" node.
     std::string METADATA_OUTPUT_STREAM;
 
+    // Additional meta streams, each carrying only the ledger entry changes
+    // matching mEntryQuery and the contract events matching mEventQuery (both
+    // xdrquery expressions, empty matching nothing) of each LedgerCloseMeta.
+    // See LedgerCloseMetaFilter. mDestination takes the same forms as
+    // METADATA_OUTPUT_STREAM, and the same restrictions apply.
+    struct FilteredMetaStream
+    {
+        std::string mDestination;
+        std::string mEntryQuery;
+        std::string mEventQuery;
+    };
+    std::vector<FilteredMetaStream> METADATA_FILTERED_OUTPUT_STREAMS;
+
     // Number of ledgers worth of transaction metadata to preserve on disk for
     // debugging purposes. These records are automatically maintained and
     // rotated during processing, and are helpful for recovery in case of a
@@ -497,8 +704,22 @@ class Config : public std::enable_shared_from_this<Config>
     std::string VERSION_STR;
     std::string LOG_FILE_PATH;
     bool LOG_COLOR;
+
+    // Size in messages of the queue through which a background thread writes
+    // the log file, 0 to write it synchronously. When the queue is full,
+    // logging blocks, or overwrites the oldest queued message if
+    // LOG_ASYNC_DROP_OLDEST.
+    uint32_t LOG_ASYNC_QUEUE_SIZE;
+    bool LOG_ASYNC_DROP_OLDEST;
     std::string BUCKET_DIR_PATH;
 
+    // Directory of verified buckets, named like in BUCKET_DIR_PATH, that
+    // catchup takes buckets from before downloading them. Downloaded buckets
+    // are added to it unless BUCKET_CACHE_READ_ONLY, so that several nodes on
+    // a host can share it. Empty to not use one.
+    std::string BUCKET_CACHE_DIR_PATH;
+    bool BUCKET_CACHE_READ_ONLY;
+
     // Ledger protocol version for testing purposes. Defaulted to
     // LEDGER_PROTOCOL_VERSION. Used in the following scenarios: 1. to specify
     // the genesis ledger version (only when USE_CONFIG_FOR_GENESIS is true) 2.
@@ -512,6 +733,14 @@ class Config : public std::enable_shared_from_this<Config>
     unsigned short HTTP_PORT; // what port to listen for commands
     bool PUBLIC_HTTP_PORT;    // if you accept commands from not localhost
     int HTTP_MAX_CLIENT;      // maximum number of http clients, i.e backlog
+
+    // Port of the query server, which answers read-only ledger state queries
+    // on its own threads. Requires BucketListDB. If set to 0, the query server
+    // is disabled.
+    unsigned short HTTP_QUERY_PORT;
+
+    // Number of threads serving query server requests
+    size_t QUERY_THREAD_POOL_SIZE;
     std::string NETWORK_PASSPHRASE; // identifier for the network
 
     // overlay config
@@ -526,6 +755,10 @@ class Config : public std::enable_shared_from_this<Config>
     unsigned short PEER_STRAGGLER_TIMEOUT;
     int MAX_BATCH_WRITE_COUNT;
     int MAX_BATCH_WRITE_BYTES;
+    // Bytes a peer connection may have queued for writing before flood
+    // messages other than SCP are held in flow control, where SCP messages
+    // can still overtake them; 0 to never hold them
+    int PEER_FLOOD_WRITE_BACKLOG_BYTES;
     double FLOOD_OP_RATE_PER_LEDGER;
     int FLOOD_TX_PERIOD_MS;
     double FLOOD_SOROBAN_RATE_PER_LEDGER;
@@ -535,6 +768,14 @@ class Config : public std::enable_shared_from_this<Config>
 
     std::chrono::milliseconds FLOOD_DEMAND_PERIOD_MS;
     std::chrono::milliseconds FLOOD_ADVERT_PERIOD_MS;
+    // Number of randomly picked peers a transaction received from another
+    // peer is advertised to, 0 meaning all of them. Transactions this node
+    // submits are always advertised to every peer.
+    uint32_t FLOOD_ADVERT_RELAY_FANOUT;
+    // When FLOOD_ADVERT_RELAY_FANOUT is set, pick half of the fanout among the
+    // peers that answered our demands the fastest and sent us the fewest
+    // duplicates, instead of picking all of them at random
+    bool FLOOD_ADVERT_RELAY_PREFER_FAST_PEERS;
     std::chrono::milliseconds FLOOD_DEMAND_BACKOFF_DELAY_MS;
     static constexpr size_t const POSSIBLY_PREFERRED_EXTRA = 2;
     static constexpr size_t const REALLY_DEAD_NUM_FAILURES_CUTOFF = 120;
@@ -555,8 +796,18 @@ class Config : public std::enable_shared_from_this<Config>
     // thread-management config
     int WORKER_THREADS;
 
+    // CPUs to pin each class of thread to, as CPU lists like "0-3,8"; empty
+    // leaves the OS free to schedule them anywhere
+    std::string MAIN_THREAD_CPUS;
+    std::string WORKER_THREAD_CPUS;
+    std::string MERGE_THREAD_CPUS;
+    std::string OVERLAY_THREAD_CPUS;
+
     // process-management config
     size_t MAX_CONCURRENT_SUBPROCESSES;
+    // Command compressing history files before publishing, given the file to
+    // compress after its arguments; must behave like gzip
+    std::string GZIP_COMMAND;
 
     // SCP config
     SecretKey NODE_SEED;
@@ -567,9 +818,18 @@ class Config : public std::enable_shared_from_this<Config>
 
     // Whether to run online quorum intersection checks.
     bool QUORUM_INTERSECTION_CHECKER;
+    // Number of threads a quorum intersection check splits its search of
+    // the network across.
+    uint32_t QUORUM_INTERSECTION_CHECKER_THREADS;
 
     // Invariants
     std::vector<std::string> INVARIANT_CHECKS;
+    // The fraction of operations each named invariant is checked on, 1 for
+    // those not named
+    std::map<std::string, double> INVARIANT_CHECK_SAMPLE_RATES;
+    // Whether operation checks of invariants that are not strict run on a
+    // background thread, after the operation is applied
+    bool INVARIANT_CHECKS_IN_BACKGROUND;
 
     std::map<std::string, std::string> VALIDATOR_NAMES;
 
@@ -579,13 +839,21 @@ class Config : public std::enable_shared_from_this<Config>
     // Database config
     SecretValue DATABASE;
 
+    // Pragmas set on every SQLite connection: "DURABLE" (the default) syncs
+    // every commit to disk, "FAST" only syncs at WAL checkpoints and uses
+    // larger caches. Validators must use "DURABLE".
+    std::string SQLITE_PROFILE;
+
     std::vector<std::string> COMMANDS;
     std::vector<std::string> REPORT_METRICS;
 
     // Data layer cache configuration
     // - ENTRY_CACHE_SIZE controls the maximum number of LedgerEntry objects
     //   that will be stored in the cache
+    // - PERSIST_ENTRY_CACHE_KEYS saves the keys that were cached during the
+    //   last ledger on shutdown, to prefetch them on the next start
     size_t ENTRY_CACHE_SIZE;
+    bool PERSIST_ENTRY_CACHE_KEYS;
 
     // Data layer prefetcher configuration
     // - PREFETCH_BATCH_SIZE determines how many records we'll prefetch per
@@ -668,10 +936,14 @@ class Config : public std::enable_shared_from_this<Config>
     std::chrono::seconds getExpectedLedgerCloseTime() const;
 
     void setInMemoryMode();
+    void setMetadataOnlyMode();
     bool modeDoesCatchupWithBucketList() const;
     bool isInMemoryMode() const;
     bool isInMemoryModeWithoutMinimalDB() const;
     bool isUsingBucketListDB() const;
+    // Whether entries of type t are stored in the BucketList only, and not
+    // in SQL
+    bool isUsingBucketListDBForType(LedgerEntryType t) const;
     bool isPersistingBucketListDBIndexes() const;
     bool modeStoresAllHistory() const;
     bool modeStoresAnyHistory() const;
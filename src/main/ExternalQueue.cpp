@@ -161,6 +161,14 @@ ExternalQueue::deleteCursor(std::string const& resid)
 
 void
 ExternalQueue::deleteOldEntries(uint32 count)
+{
+    ZoneScoped;
+    mApp.getLedgerManager().deleteOldEntries(mApp.getDatabase(),
+                                             getMaxLedgerToTrim(), count);
+}
+
+uint32_t
+ExternalQueue::getMaxLedgerToTrim()
 {
     ZoneScoped;
     auto& db = mApp.getDatabase();
@@ -203,8 +211,7 @@ ExternalQueue::deleteOldEntries(uint32 count)
     CLOG_INFO(History,
               "Trimming history <= ledger {} (rmin={}, qmin={}, lmin={})", cmin,
               rmin, qmin, lmin);
-
-    mApp.getLedgerManager().deleteOldEntries(mApp.getDatabase(), cmin, count);
+    return cmin;
 }
 
 void
@@ -36,6 +36,10 @@ class ExternalQueue
     // safely delete data, maximum count entries from each table
     void deleteOldEntries(uint32 count);
 
+    // the last ledger whose data neither publishing nor any subscriber
+    // still needs
+    uint32_t getMaxLedgerToTrim();
+
   private:
     void checkID(std::string const& resid);
     std::string getCursor(std::string const& resid);
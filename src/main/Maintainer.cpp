@@ -3,6 +3,9 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "main/Maintainer.h"
+#include "database/Database.h"
+#include "ledger/LedgerManager.h"
+#include "main/Application.h"
 #include "main/Config.h"
 #include "main/ExternalQueue.h"
 #include "util/GlobalChecks.h"
@@ -10,14 +13,42 @@
 #include "util/Logging.h"
 #include "util/numeric.h"
 
+#include "medida/counter.h"
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
 #include <Tracy.hpp>
+#include <algorithm>
 #include <fmt/format.h>
 
 namespace stellar
 {
 
-Maintainer::Maintainer(Application& app) : mApp{app}, mTimer{mApp}
+namespace
 {
+// Ledgers closing, or automatic runs taking, longer than this share of the
+// expected ledger close time make the next runs smaller
+std::chrono::milliseconds
+getSlowThreshold(Config const& cfg)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               cfg.getExpectedLedgerCloseTime()) /
+           5;
+}
+}
+
+Maintainer::Maintainer(Application& app)
+    : mApp{app}
+    , mTimer{mApp}
+    , mBatchSize{std::max<uint32_t>(
+          mApp.getConfig().AUTOMATIC_MAINTENANCE_COUNT, 1)}
+    , mLedgerClose(mApp.getMetrics().NewTimer({"ledger", "ledger", "close"}))
+    , mDeleteTime(mApp.getMetrics().NewTimer({"maintenance", "delete", "time"}))
+    , mBatchSizeCounter(
+          mApp.getMetrics().NewCounter({"maintenance", "delete", "batch-size"}))
+    , mBacklog(
+          mApp.getMetrics().NewCounter({"maintenance", "delete", "backlog"}))
+{
+    mBatchSizeCounter.set_count(mBatchSize);
 }
 
 void
@@ -58,10 +89,101 @@ void
 Maintainer::tick()
 {
     ZoneScoped;
-    performMaintenance(mApp.getConfig().AUTOMATIC_MAINTENANCE_COUNT);
+    auto& db = mApp.getDatabase();
+    ExternalQueue ps{mApp};
+    auto maxLedger = ps.getMaxLedgerToTrim();
+    if (!db.isSqlite())
+    {
+        trimInBackground(maxLedger, mBatchSize);
+        return;
+    }
+
+    // A second connection writing to SQLite would only contend with the main
+    // one for the database lock, so delete right here
+    auto start = std::chrono::steady_clock::now();
+    mApp.getLedgerManager().deleteOldEntries(db, maxLedger, mBatchSize);
+    auto deleteTime = std::chrono::steady_clock::now() - start;
+    finishRun(deleteTime, getBacklog(db.getSession(), maxLedger));
+}
+
+void
+Maintainer::trimInBackground(uint32_t maxLedger, uint32_t count)
+{
+    ZoneScoped;
+    mApp.postOnBackgroundThread(
+        [this, maxLedger, count]() {
+            ZoneScoped;
+            auto start = std::chrono::steady_clock::now();
+            uint32_t backlog = 0;
+            try
+            {
+                PooledSession sess(mApp.getDatabase());
+                LedgerManager::deleteOldEntriesInSession(sess.session(),
+                                                         maxLedger, count);
+                backlog = getBacklog(sess.session(), maxLedger);
+            }
+            catch (std::exception const& e)
+            {
+                LOG_ERROR(DEFAULT_LOG, "Error during maintenance: {}",
+                          e.what());
+            }
+            auto deleteTime = std::chrono::steady_clock::now() - start;
+            mApp.postOnMainThread(
+                [this, deleteTime, backlog]() {
+                    finishRun(deleteTime, backlog);
+                },
+                "Maintainer: finished");
+        },
+        "Maintainer: delete old entries",
+        WorkerPriority::BULK);
+}
+
+void
+Maintainer::finishRun(std::chrono::nanoseconds deleteTime, uint32_t backlog)
+{
+    ZoneScoped;
+    mDeleteTime.Update(deleteTime);
+    mBacklog.set_count(backlog);
+
+    auto const& cfg = mApp.getConfig();
+    auto threshold = getSlowThreshold(cfg);
+    std::chrono::duration<double, std::milli> closeTime(
+        mLedgerClose.GetSnapshot().getMedian());
+    if (closeTime > threshold || deleteTime > threshold)
+    {
+        mBatchSize = std::max<uint32_t>(mBatchSize / 2, 1);
+    }
+    else
+    {
+        mBatchSize = static_cast<uint32_t>(std::min<uint64_t>(
+            uint64_t{mBatchSize} * 2, cfg.AUTOMATIC_MAINTENANCE_COUNT));
+    }
+    mBatchSizeCounter.set_count(mBatchSize);
+    CLOG_DEBUG(History,
+               "Maintenance took {} ms, {} ledgers left to trim, next run "
+               "trims {}",
+               std::chrono::duration_cast<std::chrono::milliseconds>(
+                   deleteTime)
+                   .count(),
+               backlog, mBatchSize);
     scheduleMaintenance();
 }
 
+uint32_t
+Maintainer::getBacklog(soci::session& sess, uint32_t maxLedger)
+{
+    ZoneScoped;
+    uint32_t minLedger = 0;
+    soci::indicator gotMin;
+    sess << "SELECT MIN(ledgerseq) FROM ledgerheaders",
+        soci::into(minLedger, gotMin);
+    if (gotMin != soci::i_ok || minLedger > maxLedger)
+    {
+        return 0;
+    }
+    return maxLedger - minLedger + 1;
+}
+
 void
 Maintainer::performMaintenance(uint32_t count)
 {
@@ -6,13 +6,32 @@
 
 #include "util/Timer.h"
 
+#include <chrono>
 #include <cstdint>
 
+namespace medida
+{
+class Counter;
+class Timer;
+}
+
+namespace soci
+{
+class session;
+}
+
 namespace stellar
 {
 
 class Application;
 
+// Trims history tables on a timer, AUTOMATIC_MAINTENANCE_COUNT ledgers at a
+// time at most. Unless the database is SQLite, automatic runs delete on a
+// worker thread through a connection of the database's pool, so the main
+// thread never waits on them. Either way, the number of ledgers per run is
+// halved whenever ledgers close or runs end slowly, and doubled back towards
+// AUTOMATIC_MAINTENANCE_COUNT once neither does.
+
 class Maintainer
 {
   public:
@@ -27,8 +46,22 @@ class Maintainer
   private:
     Application& mApp;
     VirtualTimer mTimer;
+    // Ledgers trimmed by the next automatic run
+    uint32_t mBatchSize;
+
+    medida::Timer& mLedgerClose;
+    medida::Timer& mDeleteTime;
+    medida::Counter& mBatchSizeCounter;
+    medida::Counter& mBacklog;
 
     void scheduleMaintenance();
     void tick();
+    void trimInBackground(uint32_t maxLedger, uint32_t count);
+    // Records a finished automatic run, adapts mBatchSize and schedules the
+    // next run
+    void finishRun(std::chrono::nanoseconds deleteTime, uint32_t backlog);
+
+    // Number of ledgers up to maxLedger still in ledgerheaders
+    static uint32_t getBacklog(soci::session& sess, uint32_t maxLedger);
 };
 }
@@ -22,7 +22,7 @@ std::string PersistentState::mapping[kLastEntry] = {
     "lastclosedledger", "historyarchivestate", "lastscpdata",
     "databaseschema",   "networkpassphrase",   "ledgerupgrades",
     "rebuildledger",    "lastscpdataxdr",      "txset",
-    "dbbackend"};
+    "dbbackend",        "txqueue",             "lastclosedledgerheader"};
 
 std::string PersistentState::kSQLCreateStatement =
     "CREATE TABLE IF NOT EXISTS storestate ("
@@ -159,6 +159,14 @@ void
 PersistentState::clearRebuildForType(LedgerEntryType let)
 {
     ZoneScoped;
+
+    // While offers are only in BucketListDB the offers table stays empty, so
+    // keep it marked for a rebuild in case they leave it
+    if (let == OFFER && mApp.getConfig().isUsingBucketListDBForType(let))
+    {
+        return;
+    }
+
     updateDb(getStoreStateName(kRebuildLedger, let), "");
 }
 
@@ -0,0 +1,282 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "main/QueryServer.h"
+#include "bucket/BucketListSnapshot.h"
+#include "bucket/BucketManager.h"
+#include "bucket/BucketSnapshotManager.h"
+#include "ledger/LedgerHashUtils.h"
+#include "ledger/LedgerTxnImpl.h"
+#include "lib/json/json.h"
+#include "main/Application.h"
+#include "main/CommandHandler.h"
+#include "util/Logging.h"
+#include "util/PrometheusReporter.h"
+#include "util/Thread.h"
+#include "util/UnorderedMap.h"
+#include <Tracy.hpp>
+#include <fmt/format.h>
+
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
+
+using std::placeholders::_1;
+using std::placeholders::_2;
+
+namespace stellar
+{
+
+std::chrono::seconds const QueryServer::STATUS_REFRESH_PERIOD(1);
+
+namespace
+{
+// Each query thread owns one snapshot, which it refreshes on every request
+thread_local std::shared_ptr<SearchableBucketListSnapshot> gThreadSnapshot;
+
+using StatusRoute = void (CommandHandler::*)(std::string const&, std::string&);
+
+// CommandHandler routes that only read state, served by the query threads
+std::vector<std::pair<std::string, StatusRoute>> const STATUS_ROUTES = {
+    {"info", &CommandHandler::info},
+    {"peers", &CommandHandler::peers},
+    {"quorum", &CommandHandler::quorum},
+    {"scp", &CommandHandler::scpInfo},
+    {"sorobaninfo", &CommandHandler::sorobanInfo}};
+
+// Unlike http::server::server::parseParams, keeps every value of a repeated
+// parameter and any '=' within a value, such as base64 padding
+std::vector<std::string>
+parseRepeatedParam(std::string const& params, std::string const& name)
+{
+    std::vector<std::string> values;
+    size_t start = (!params.empty() && params[0] == '?') ? 1 : 0;
+    while (start < params.size())
+    {
+        auto end = params.find('&', start);
+        if (end == std::string::npos)
+        {
+            end = params.size();
+        }
+
+        auto eq = params.find('=', start);
+        if (eq < end && params.compare(start, eq - start, name) == 0 &&
+            eq - start == name.size())
+        {
+            values.emplace_back(params.substr(eq + 1, end - eq - 1));
+        }
+        start = end + 1;
+    }
+    return values;
+}
+}
+
+QueryServer::QueryServer(Application& app, std::string const& address,
+                         unsigned short port, int maxClient,
+                         size_t threadPoolSize)
+    : mApp(app)
+    , mSnapshotManager(app.getBucketManager().getBucketSnapshotManager())
+    , mGetLedgerEntriesTimer(
+          app.getMetrics().NewTimer({"query", "getledgerentries", "latency"}))
+    , mStatusTimer(app)
+{
+    releaseAssert(threadPoolSize > 0);
+    LOG_INFO(DEFAULT_LOG, "Listening on {}:{} for HTTP queries", address,
+             port);
+
+    mServer = std::make_unique<http::server::server>(mIOContext, address, port,
+                                                     maxClient);
+    mServer->addRoute("getledgerentries",
+                      std::bind(&QueryServer::safeRouter, this,
+                                &QueryServer::getLedgerEntries, _1, _2));
+    mServer->addRoute("metrics",
+                      std::bind(&QueryServer::safeRouter, this,
+                                &QueryServer::metrics, _1, _2),
+                      PrometheusReporter::CONTENT_TYPE);
+    for (auto const& [name, route] : STATUS_ROUTES)
+    {
+        mServer->addRoute(name, [this, name = name](std::string const& params,
+                                                    std::string& retStr) {
+            safeRouter(
+                [&name](QueryServer* self, std::string const& p,
+                        std::string& r) { self->status(name, p, r); },
+                params, retStr);
+        });
+    }
+    scheduleStatusRefresh();
+
+    for (size_t i = 0; i < threadPoolSize; ++i)
+    {
+        mThreads.emplace_back([this]() {
+            runCurrentThreadWithLowPriority();
+            gThreadSnapshot =
+                mSnapshotManager.getSearchableBucketListSnapshot();
+            mIOContext.run();
+            gThreadSnapshot.reset();
+        });
+    }
+}
+
+QueryServer::~QueryServer()
+{
+    // Connections are only touched by the query threads, so they must be
+    // stopped before the server is destroyed on this thread
+    mIOContext.stop();
+    for (auto& t : mThreads)
+    {
+        t.join();
+    }
+    mServer.reset();
+}
+
+void
+QueryServer::safeRouter(
+    std::function<void(QueryServer*, std::string const&, std::string&)> route,
+    std::string const& params, std::string& retStr)
+{
+    try
+    {
+        ZoneNamedN(httpZone, "HTTP query handler", true);
+        route(this, params, retStr);
+    }
+    catch (std::exception const& e)
+    {
+        retStr = fmt::format(FMT_STRING(R"({{"exception": "{}"}})"), e.what());
+    }
+    catch (...)
+    {
+        retStr = R"({"exception": "generic"})";
+    }
+}
+
+void
+QueryServer::getLedgerEntries(std::string const& params, std::string& retStr)
+{
+    ZoneScoped;
+    auto timer = mGetLedgerEntriesTimer.TimeScope();
+
+    auto encodedKeys = parseRepeatedParam(params, "key");
+    if (encodedKeys.empty())
+    {
+        throw std::invalid_argument(
+            "Must specify ledger keys: getledgerentries?key=<LedgerKey in "
+            "base64 XDR format>&key=...");
+    }
+
+    std::vector<LedgerKey> orderedKeys;
+    LedgerKeySet keys;
+    for (auto const& encoded : encodedKeys)
+    {
+        LedgerKey k;
+        fromOpaqueBase64(k, encoded);
+        if (keys.emplace(k).second)
+        {
+            orderedKeys.emplace_back(k);
+        }
+    }
+
+    releaseAssert(gThreadSnapshot);
+    auto entries = gThreadSnapshot->loadKeys(keys);
+    UnorderedMap<LedgerKey, LedgerEntry const*> live;
+    for (auto const& le : entries)
+    {
+        live.emplace(LedgerEntryKey(le), &le);
+    }
+
+    Json::Value root;
+    root["ledger"] = gThreadSnapshot->getLedgerSeq();
+    auto& results = root["entries"];
+    for (auto const& k : orderedKeys)
+    {
+        Json::Value result;
+        result["key"] = toOpaqueBase64(k);
+        if (auto it = live.find(k); it != live.end())
+        {
+            result["state"] = "live";
+            result["entry"] = toOpaqueBase64(*it->second);
+        }
+        else
+        {
+            result["state"] = "dead";
+        }
+        results.append(result);
+    }
+    retStr = Json::FastWriter().write(root);
+}
+
+void
+QueryServer::metrics(std::string const& params, std::string& retStr)
+{
+    ZoneScoped;
+    retStr = PrometheusReporter().report(mApp.getMetrics());
+
+    // Syncing reads state owned by the main thread, so it has to run there.
+    // It is cheap, unlike serializing the registry, and can be skipped when
+    // the main thread is overloaded.
+    mApp.postOnMainThread([&app = mApp]() { app.syncAllMetrics(); },
+                          "QueryServer: sync metrics",
+                          Scheduler::ActionType::DROPPABLE_ACTION);
+}
+
+void
+QueryServer::status(std::string const& route, std::string const& params,
+                    std::string& retStr)
+{
+    ZoneScoped;
+    if (!params.empty() && params != "?")
+    {
+        throw std::invalid_argument(fmt::format(
+            FMT_STRING("the query server only serves {} without parameters"),
+            route));
+    }
+
+    std::shared_ptr<std::map<std::string, std::string> const> status;
+    {
+        std::lock_guard<std::mutex> guard(mStatusMutex);
+        status = mStatus;
+    }
+    if (!status)
+    {
+        throw std::runtime_error("status not published yet");
+    }
+    retStr = status->at(route);
+}
+
+void
+QueryServer::scheduleStatusRefresh()
+{
+    mStatusTimer.expires_from_now(STATUS_REFRESH_PERIOD);
+    mStatusTimer.async_wait([this]() { publishStatus(); },
+                            VirtualTimer::onFailureNoop);
+}
+
+void
+QueryServer::publishStatus()
+{
+    ZoneScoped;
+    releaseAssert(threadIsMain());
+    auto status = std::make_shared<std::map<std::string, std::string>>();
+    auto& ch = mApp.getCommandHandler();
+    for (auto const& [name, route] : STATUS_ROUTES)
+    {
+        auto& retStr = (*status)[name];
+        try
+        {
+            (ch.*route)("", retStr);
+        }
+        catch (std::exception const& e)
+        {
+            retStr =
+                fmt::format(FMT_STRING(R"({{"exception": "{}"}})"), e.what());
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(mStatusMutex);
+        mStatus = std::move(status);
+    }
+
+    // Restart the period, so that a ledger close pushes back the next refresh
+    scheduleStatusRefresh();
+}
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "lib/http/server.hpp"
+#include "util/NonCopyable.h"
+#include "util/Timer.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace medida
+{
+class Timer;
+}
+
+namespace stellar
+{
+class Application;
+class BucketSnapshotManager;
+
+// HTTP server for read-only ledger state queries, listening on
+// HTTP_QUERY_PORT. Unlike CommandHandler, requests are served by a pool of
+// QUERY_THREAD_POOL_SIZE dedicated threads, each of which answers from its own
+// BucketListDB snapshot, so query load never runs on or blocks the main thread.
+//
+// It also answers the read-only CommandHandler routes info, peers, quorum, scp
+// and sorobaninfo, with their default parameters, from replies the main thread
+// renders after each ledger close and every STATUS_REFRESH_PERIOD, so that
+// monitoring scrapes don't compete with ledger close.
+class QueryServer : NonMovableOrCopyable
+{
+    Application& mApp;
+    BucketSnapshotManager const& mSnapshotManager;
+    medida::Timer& mGetLedgerEntriesTimer;
+
+    // Replies of the status routes, by route, as of the last publishStatus.
+    // Replaced as a whole, so each reply is consistent with the others.
+    std::mutex mStatusMutex;
+    std::shared_ptr<std::map<std::string, std::string> const> mStatus;
+    VirtualTimer mStatusTimer;
+
+    asio::io_context mIOContext;
+    std::unique_ptr<http::server::server> mServer;
+    std::vector<std::thread> mThreads;
+
+    void safeRouter(
+        std::function<void(QueryServer*, std::string const&, std::string&)>
+            route,
+        std::string const& params, std::string& retStr);
+
+    void scheduleStatusRefresh();
+    void status(std::string const& route, std::string const& params,
+                std::string& retStr);
+
+  public:
+    static std::chrono::seconds const STATUS_REFRESH_PERIOD;
+    QueryServer(Application& app, std::string const& address,
+                unsigned short port, int maxClient, size_t threadPoolSize);
+
+    // Stops accepting requests and joins all query threads
+    ~QueryServer();
+
+    // Loads every key=<LedgerKey in base64 XDR> of params from a single
+    // snapshot. The response holds the ledger of that snapshot and, in request
+    // order, the state of each distinct key and its entry if it is live.
+    void getLedgerEntries(std::string const& params, std::string& retStr);
+
+    // All metrics, in the Prometheus text format. Metrics that are synced from
+    // the state of the main thread are as of its last sync, which each scrape
+    // requests for the next one: in practice, one scrape interval old.
+    void metrics(std::string const& params, std::string& retStr);
+
+    // Renders the replies of the status routes and publishes them to the query
+    // threads. Must be called on the main thread.
+    void publishStatus();
+};
+}
@@ -14,12 +14,16 @@
 #include "util/XDROperators.h"
 #include "util/XDRStream.h"
 #include "util/types.h"
+#include "util/xdrquery/XDRQuery.h"
 #include "xdr/Stellar-internal.h"
+#include <algorithm>
 #include <cereal/archives/json.hpp>
 #include <cereal/cereal.hpp>
+#include <exception>
 #include <fmt/format.h>
 #include <iostream>
 #include <regex>
+#include <thread>
 #include <xdrpp/printer.h>
 
 #if !defined(USE_TERMIOS) && !defined(_WIN32)
@@ -47,14 +51,137 @@ using namespace std::placeholders;
 namespace stellar
 {
 
+namespace
+{
+// Bytes of records handed to each thread of dumpLines per batch
+size_t const DUMP_LINES_CHUNK_BYTES = 4 * 1024 * 1024;
+
+// Streams the records of `in` to std::cout as one compact JSON object per
+// line, skipping records that don't match filterQuery. Records are read in
+// batches on the calling thread, and each batch is decoded, filtered and
+// formatted on numThreads threads, splitting it along the length-prefix
+// framing of the stream, then written out in file order.
 template <typename T>
 void
-dumpstream(XDRInputFileStream& in, bool compact)
+dumpLines(XDRInputFileStream& in, std::optional<std::string> const& filterQuery,
+          uint32_t numThreads)
 {
+    struct Chunk
+    {
+        std::vector<std::vector<char>> mRecords;
+        size_t mSize{0};
+        std::optional<xdrquery::XDRMatcher> mMatcher;
+        std::string mOut;
+        std::exception_ptr mError;
+    };
+    std::vector<Chunk> chunks(std::max<uint32_t>(numThreads, 1));
+    for (auto& chunk : chunks)
+    {
+        if (filterQuery)
+        {
+            chunk.mMatcher.emplace(*filterQuery);
+        }
+    }
+
+    auto process = [](Chunk& chunk) {
+        try
+        {
+            T tmp;
+            for (size_t i = 0; i < chunk.mSize; ++i)
+            {
+                auto const& rec = chunk.mRecords[i];
+                xdr::xdr_get g(rec.data(), rec.data() + rec.size());
+                xdr::xdr_argpack_archive(g, tmp);
+                if (chunk.mMatcher && !chunk.mMatcher->matchXDR(tmp))
+                {
+                    continue;
+                }
+                // Compact cereal output still breaks lines between fields,
+                // and JSON strings can't hold raw newlines
+                auto json = xdrToCerealString(tmp, "entry", true);
+                json.erase(std::remove(json.begin(), json.end(), '\n'),
+                           json.end());
+                chunk.mOut += json;
+                chunk.mOut += '\n';
+            }
+        }
+        catch (...)
+        {
+            chunk.mError = std::current_exception();
+        }
+    };
+
+    bool more = true;
+    while (more)
+    {
+        for (auto& chunk : chunks)
+        {
+            chunk.mSize = 0;
+            size_t bytes = 0;
+            while (more && bytes < DUMP_LINES_CHUNK_BYTES)
+            {
+                if (chunk.mSize == chunk.mRecords.size())
+                {
+                    chunk.mRecords.emplace_back();
+                }
+                more = in && in.readOneRaw(chunk.mRecords[chunk.mSize]);
+                if (more)
+                {
+                    bytes += chunk.mRecords[chunk.mSize].size();
+                    ++chunk.mSize;
+                }
+            }
+        }
+
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < chunks.size(); ++i)
+        {
+            if (chunks[i].mSize != 0)
+            {
+                threads.emplace_back(process, std::ref(chunks[i]));
+            }
+        }
+        process(chunks[0]);
+        for (auto& t : threads)
+        {
+            t.join();
+        }
+        for (auto& chunk : chunks)
+        {
+            if (chunk.mError)
+            {
+                std::rethrow_exception(chunk.mError);
+            }
+            std::cout << chunk.mOut;
+            chunk.mOut.clear();
+        }
+    }
+    std::cout.flush();
+}
+}
+
+struct DumpOptions
+{
+    bool mCompact;
+    bool mLines;
+    std::optional<std::string> mFilterQuery;
+    uint32_t mNumThreads;
+};
+
+template <typename T>
+void
+dumpstream(XDRInputFileStream& in, DumpOptions const& opts)
+{
+    if (opts.mLines || opts.mFilterQuery)
+    {
+        dumpLines<T>(in, opts.mFilterQuery, opts.mNumThreads);
+        return;
+    }
     T tmp;
     cereal::JSONOutputArchive archive(
-        std::cout, compact ? cereal::JSONOutputArchive::Options::NoIndent()
-                           : cereal::JSONOutputArchive::Options::Default());
+        std::cout, opts.mCompact
+                       ? cereal::JSONOutputArchive::Options::NoIndent()
+                       : cereal::JSONOutputArchive::Options::Default());
     archive.makeArray();
     while (in && in.readOne(tmp))
     {
@@ -63,7 +190,8 @@ dumpstream(XDRInputFileStream& in, bool compact)
 }
 
 void
-dumpXdrStream(std::string const& filename, bool compact)
+dumpXdrStream(std::string const& filename, bool compact, bool lines,
+              std::optional<std::string> filterQuery, uint32_t numThreads)
 {
     std::regex rx(
         R"(.*\b(debug-tx-set|(?:(ledger|bucket|transactions|results|meta-debug|scp)-.+))\.xdr$)");
@@ -71,38 +199,39 @@ dumpXdrStream(std::string const& filename, bool compact)
     if (std::regex_match(filename, sm, rx))
     {
         XDRInputFileStream in;
-        in.open(filename);
+        in.open(filename, fs::streamingBufsz());
+        DumpOptions const opts{compact, lines, filterQuery, numThreads};
 
         if (sm[1] == "debug-tx-set")
         {
-            dumpstream<StoredDebugTransactionSet>(in, compact);
+            dumpstream<StoredDebugTransactionSet>(in, opts);
         }
         else if (sm.size() == 3)
         {
             auto& m2 = sm[2];
             if (m2 == "ledger")
             {
-                dumpstream<LedgerHeaderHistoryEntry>(in, compact);
+                dumpstream<LedgerHeaderHistoryEntry>(in, opts);
             }
             else if (m2 == "bucket")
             {
-                dumpstream<BucketEntry>(in, compact);
+                dumpstream<BucketEntry>(in, opts);
             }
             else if (m2 == "transactions")
             {
-                dumpstream<TransactionHistoryEntry>(in, compact);
+                dumpstream<TransactionHistoryEntry>(in, opts);
             }
             else if (m2 == "results")
             {
-                dumpstream<TransactionHistoryResultEntry>(in, compact);
+                dumpstream<TransactionHistoryResultEntry>(in, opts);
             }
             else if (m2 == "meta-debug")
             {
-                dumpstream<LedgerCloseMeta>(in, compact);
+                dumpstream<LedgerCloseMeta>(in, opts);
             }
             else if (m2 == "scp")
             {
-                dumpstream<SCPHistoryEntry>(in, compact);
+                dumpstream<SCPHistoryEntry>(in, opts);
             }
             else
             {
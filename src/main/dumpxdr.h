@@ -6,11 +6,18 @@
 
 #include "overlay/StellarXDR.h"
 #include <functional>
+#include <optional>
 #include <vector>
 
 namespace stellar
 {
-void dumpXdrStream(std::string const& filename, bool json);
+// Dumps the XDR file as a JSON array, or with `lines` or a `filterQuery`, as
+// one compact JSON object per line, only for the records matching the query
+// and decoding them on `numThreads` threads.
+void dumpXdrStream(std::string const& filename, bool compact,
+                   bool lines = false,
+                   std::optional<std::string> filterQuery = std::nullopt,
+                   uint32_t numThreads = 1);
 void printXdr(std::string const& filename, std::string const& filetype,
               bool base64, bool compact, bool rawMode);
 void signtxns(std::vector<TransactionEnvelope>& txenvs, std::string netId,
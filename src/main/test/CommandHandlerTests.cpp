@@ -5,6 +5,7 @@
 #include "ledger/LedgerTxn.h"
 #include "ledger/test/LedgerTestUtils.h"
 #include "lib/catch.hpp"
+#include "lib/json/json.h"
 #include "main/Application.h"
 #include "main/CommandHandler.h"
 #include "test/TestAccount.h"
@@ -187,6 +188,81 @@ TEST_CASE_VERSIONS("transaction envelope bridge", "[commandhandler]")
     }
 }
 
+TEST_CASE("txbatch", "[commandhandler]")
+{
+    VirtualClock clock;
+    auto app = createTestApplication(clock, getTestConfig());
+    auto& ch = app->getCommandHandler();
+    auto root = TestAccount::createRoot(*app);
+
+    std::vector<uint8_t> batch;
+    auto append = [&](std::vector<uint8_t> const& bytes) {
+        auto len = static_cast<uint32_t>(bytes.size());
+        batch.insert(batch.end(),
+                     {static_cast<uint8_t>(len >> 24),
+                      static_cast<uint8_t>(len >> 16),
+                      static_cast<uint8_t>(len >> 8),
+                      static_cast<uint8_t>(len)});
+        batch.insert(batch.end(), bytes.begin(), bytes.end());
+    };
+    auto submit = [&]() {
+        std::string ret;
+        ch.txBatch("?blob=" + decoder::encode_b64(batch), ret);
+        Json::Value res;
+        REQUIRE(Json::Reader().parse(ret, res));
+        return res;
+    };
+
+    SECTION("results in batch order")
+    {
+        auto tx = root.tx({payment(root, 1)});
+        auto envelope = xdr::xdr_to_opaque(tx->getEnvelope());
+        append(envelope);
+        append(envelope);
+        append({1, 2, 3});
+
+        auto res = submit();
+        REQUIRE(res.isArray());
+        REQUIRE(res.size() == 3);
+        REQUIRE(res[0]["status"].asString() == "PENDING");
+        REQUIRE(res[1]["status"].asString() == "DUPLICATE");
+        REQUIRE(res[2].isMember("exception"));
+    }
+
+    SECTION("spread over the worker threads")
+    {
+        std::vector<TestAccount> accounts;
+        for (int i = 0; i < 100; ++i)
+        {
+            accounts.emplace_back(
+                root.create(fmt::format("a{}", i),
+                            app->getLedgerManager().getLastMinBalance(2)));
+        }
+        for (auto& account : accounts)
+        {
+            append(xdr::xdr_to_opaque(
+                account.tx({payment(root, 1)})->getEnvelope()));
+        }
+
+        auto res = submit();
+        REQUIRE(res.size() == accounts.size());
+        for (auto const& r : res)
+        {
+            REQUIRE(r["status"].asString() == "PENDING");
+        }
+    }
+
+    SECTION("truncated blob")
+    {
+        append(xdr::xdr_to_opaque(root.tx({payment(root, 1)})->getEnvelope()));
+        batch.pop_back();
+        std::string ret;
+        REQUIRE_THROWS_AS(
+            ch.txBatch("?blob=" + decoder::encode_b64(batch), ret),
+            std::invalid_argument);
+    }
+}
+
 TEST_CASE("manualclose", "[commandhandler]")
 {
     auto testManualCloseConfig = [](auto configure, auto issue) {
@@ -0,0 +1,122 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "crypto/SecretKey.h"
+#include "ledger/LedgerManager.h"
+#include "ledger/LedgerTxnImpl.h"
+#include "lib/catch.hpp"
+#include "lib/http/HttpClient.h"
+#include "lib/json/json.h"
+#include "main/Application.h"
+#include "test/TestUtils.h"
+#include "test/TxTests.h"
+#include "test/test.h"
+#include "transactions/TransactionUtils.h"
+#include <fmt/format.h>
+
+using namespace stellar;
+
+namespace
+{
+std::string
+urlEncode(std::string const& s)
+{
+    std::string out;
+    for (auto c : s)
+    {
+        if (std::isalnum(static_cast<unsigned char>(c)))
+        {
+            out += c;
+        }
+        else
+        {
+            out += fmt::format("%{:02X}", static_cast<unsigned char>(c));
+        }
+    }
+    return out;
+}
+}
+
+TEST_CASE("query server getledgerentries", "[queryserver]")
+{
+    VirtualClock clock;
+    Config cfg(getTestConfig(0, Config::TESTDB_IN_MEMORY_SQLITE));
+    cfg.DEPRECATED_SQL_LEDGER_STATE = false;
+    cfg.HTTP_QUERY_PORT = cfg.PEER_PORT + 1000;
+    cfg.QUERY_THREAD_POOL_SIZE = 2;
+    auto app = createTestApplication(clock, cfg);
+
+    auto rootKey =
+        accountKey(txtest::getRoot(app->getNetworkID()).getPublicKey());
+    auto missingKey =
+        accountKey(SecretKey::pseudoRandomForTesting().getPublicKey());
+
+    auto query = [&](std::vector<LedgerKey> const& keys) {
+        std::string path = "/getledgerentries?";
+        for (auto const& k : keys)
+        {
+            path += "key=" + urlEncode(toOpaqueBase64(k)) + "&";
+        }
+
+        std::string ret;
+        REQUIRE(http_request("127.0.0.1", path, cfg.HTTP_QUERY_PORT, ret) ==
+                200);
+        Json::Value root;
+        REQUIRE(Json::Reader().parse(ret, root));
+        return root;
+    };
+
+    // Duplicate keys are answered once, in order of first appearance
+    auto root = query({missingKey, rootKey, missingKey});
+    REQUIRE(root["ledger"].asUInt() ==
+            app->getLedgerManager().getLastClosedLedgerNum());
+    auto const& entries = root["entries"];
+    REQUIRE(entries.size() == 2);
+
+    REQUIRE(entries[0]["key"].asString() == toOpaqueBase64(missingKey));
+    REQUIRE(entries[0]["state"].asString() == "dead");
+
+    REQUIRE(entries[1]["key"].asString() == toOpaqueBase64(rootKey));
+    REQUIRE(entries[1]["state"].asString() == "live");
+    LedgerEntry le;
+    fromOpaqueBase64(le, entries[1]["entry"].asString());
+    REQUIRE(LedgerEntryKey(le) == rootKey);
+
+    SECTION("missing keys")
+    {
+        std::string ret;
+        REQUIRE(http_request("127.0.0.1", "/getledgerentries",
+                             cfg.HTTP_QUERY_PORT, ret) == 200);
+        REQUIRE(ret.find("exception") != std::string::npos);
+    }
+}
+
+TEST_CASE("query server status routes", "[queryserver]")
+{
+    VirtualClock clock;
+    Config cfg(getTestConfig(0, Config::TESTDB_IN_MEMORY_SQLITE));
+    cfg.DEPRECATED_SQL_LEDGER_STATE = false;
+    cfg.HTTP_QUERY_PORT = cfg.PEER_PORT + 1000;
+    cfg.QUERY_THREAD_POOL_SIZE = 2;
+    auto app = createTestApplication(clock, cfg);
+
+    auto query = [&](std::string const& path) {
+        std::string ret;
+        REQUIRE(http_request("127.0.0.1", path, cfg.HTTP_QUERY_PORT, ret) ==
+                200);
+        Json::Value root;
+        REQUIRE(Json::Reader().parse(ret, root));
+        return root;
+    };
+
+    // Each ledger close republishes the status
+    txtest::closeLedger(*app);
+    auto lcl = app->getLedgerManager().getLastClosedLedgerNum();
+    REQUIRE(query("/info")["info"]["ledger"]["num"].asUInt() == lcl);
+    txtest::closeLedger(*app);
+    REQUIRE(query("/info")["info"]["ledger"]["num"].asUInt() == lcl + 1);
+
+    REQUIRE(query("/quorum").isObject());
+    REQUIRE(query("/info?compact=false").isMember("exception"));
+}
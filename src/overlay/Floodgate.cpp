@@ -6,32 +6,167 @@
 #include "crypto/BLAKE2.h"
 #include "crypto/Hex.h"
 #include "herder/Herder.h"
+#include "lib/util/stdrandom.h"
 #include "main/Application.h"
 #include "medida/counter.h"
 #include "medida/metrics_registry.h"
+#include "medida/timer.h"
 #include "overlay/OverlayManager.h"
 #include "util/GlobalChecks.h"
 #include "util/Logging.h"
+#include "util/Math.h"
+#include "util/MemoryArenas.h"
 #include <Tracy.hpp>
+#include <algorithm>
+#include <bitset>
 #include <fmt/format.h>
+#include <functional>
+#include <limits>
+#include <vector>
 
 namespace stellar
 {
-Floodgate::FloodRecord::FloodRecord(uint32_t ledger, Peer::pointer peer)
-    : mLedgerSeq(ledger)
+namespace
 {
-    if (peer)
-        mPeersTold.insert(peer->toString());
+// Lower is better: the mean time it took the peer to answer our demands,
+// inflated by the share of flooded messages it sent us that we already had.
+// A peer that mostly sends duplicates sits on a redundant path, so it likely
+// hears about a transaction from someone else anyway. Peers we never pulled
+// from have no score yet.
+double
+relayScore(Peer const& peer)
+{
+    auto const& metrics = peer.getPeerMetrics();
+    if (metrics.mPullLatency.count() == 0)
+    {
+        return std::numeric_limits<double>::infinity();
+    }
+    double unique = static_cast<double>(metrics.mUniqueFloodMessageRecv);
+    double dup = static_cast<double>(metrics.mDuplicateFloodMessageRecv);
+    double dupRate = unique + dup > 0 ? dup / (unique + dup) : 0.0;
+    return metrics.mPullLatency.mean() * (1.0 + dupRate);
+}
+
+// Moves the `best` eligible peers with the lowest relay scores to the front
+// of `peers`, leaving the others in their (shuffled) order behind them
+template <typename IsTold>
+void
+preferFastPeers(std::vector<Peer::pointer>& peers, IsTold const& isTold,
+                size_t best, uint32_t minOverlayVersion)
+{
+    std::vector<std::pair<double, Peer::pointer>> scored;
+    for (auto const& peer : peers)
+    {
+        if (peer->getRemoteOverlayVersion() >= minOverlayVersion &&
+            !isTold(*peer))
+        {
+            scored.emplace_back(relayScore(*peer), peer);
+        }
+    }
+    best = std::min(best, scored.size());
+    std::partial_sort(
+        scored.begin(), scored.begin() + best, scored.end(),
+        [](auto const& l, auto const& r) { return l.first < r.first; });
+
+    std::vector<Peer::pointer> res;
+    res.reserve(peers.size());
+    for (size_t i = 0; i < best; ++i)
+    {
+        res.emplace_back(scored[i].second);
+    }
+    for (auto const& peer : peers)
+    {
+        if (std::find(res.begin(), res.begin() + best, peer) ==
+            res.begin() + best)
+        {
+            res.emplace_back(peer);
+        }
+    }
+    peers = std::move(res);
+}
+}
+
+bool
+Floodgate::PeerSet::insert(uint32_t index)
+{
+    size_t w = index / 64;
+    uint64_t bit = uint64_t(1) << (index % 64);
+    uint64_t* word;
+    if (w < INLINE_WORDS)
+    {
+        word = &mInline[w];
+    }
+    else
+    {
+        w -= INLINE_WORDS;
+        if (w >= mOverflow.size())
+        {
+            mOverflow.resize(w + 1, 0);
+        }
+        word = &mOverflow[w];
+    }
+    bool inserted = (*word & bit) == 0;
+    *word |= bit;
+    return inserted;
+}
+
+bool
+Floodgate::PeerSet::contains(uint32_t index) const
+{
+    size_t w = index / 64;
+    uint64_t bit = uint64_t(1) << (index % 64);
+    if (w < INLINE_WORDS)
+    {
+        return (mInline[w] & bit) != 0;
+    }
+    w -= INLINE_WORDS;
+    return w < mOverflow.size() && (mOverflow[w] & bit) != 0;
+}
+
+size_t
+Floodgate::PeerSet::size() const
+{
+    size_t res = 0;
+    for (auto w : mInline)
+    {
+        res += std::bitset<64>(w).count();
+    }
+    for (auto w : mOverflow)
+    {
+        res += std::bitset<64>(w).count();
+    }
+    return res;
+}
+
+void
+Floodgate::PeerSet::merge(PeerSet const& other)
+{
+    for (size_t i = 0; i < INLINE_WORDS; ++i)
+    {
+        mInline[i] |= other.mInline[i];
+    }
+    if (mOverflow.size() < other.mOverflow.size())
+    {
+        mOverflow.resize(other.mOverflow.size(), 0);
+    }
+    for (size_t i = 0; i < other.mOverflow.size(); ++i)
+    {
+        mOverflow[i] |= other.mOverflow[i];
+    }
 }
 
 Floodgate::Floodgate(Application& app)
     : mApp(app)
     , mFloodMapSize(
           app.getMetrics().NewCounter({"overlay", "memory", "flood-known"}))
+    , mFloodMapBytes(app.getMetrics().NewCounter(
+          {"overlay", "memory", "flood-known-bytes"}))
     , mSendFromBroadcast(app.getMetrics().NewMeter(
           {"overlay", "flood", "broadcast"}, "message"))
     , mMessagesAdvertised(app.getMetrics().NewMeter(
           {"overlay", "flood", "advertised"}, "message"))
+    , mAdvertsSkipped(app.getMetrics().NewMeter(
+          {"overlay", "flood", "advert-skipped"}, "message"))
     , mShuttingDown(false)
 {
 }
@@ -43,16 +178,81 @@ Floodgate::clearBelow(uint32_t maxLedger)
     ZoneScoped;
     for (auto it = mFloodMap.cbegin(); it != mFloodMap.cend();)
     {
-        if (it->second->mLedgerSeq < maxLedger)
+        if (it->second.mLedgerSeq < maxLedger)
         {
-            it = mFloodMap.erase(it);
+            // Erasing only invalidates the erased element
+            mFloodMap.erase(it++);
         }
         else
         {
             ++it;
         }
     }
+    releaseUnusedPeerIndexes();
+    updateFloodMapMetrics();
+}
+
+void
+Floodgate::updateFloodMapMetrics()
+{
     mFloodMapSize.set_count(mFloodMap.size());
+    // Peer sets that overflow their inline words are rare, so their
+    // allocations are left out
+    mFloodMapBytes.set_count(static_cast<int64_t>(mFloodMap.memoryUsage()));
+}
+
+uint32_t
+Floodgate::getPeerIndex(Peer const& peer)
+{
+    auto [it, inserted] = mPeerIndexes.emplace(peer.toString(), 0);
+    if (inserted)
+    {
+        if (mFreePeerIndexes.empty())
+        {
+            it->second = mNextPeerIndex++;
+        }
+        else
+        {
+            it->second = mFreePeerIndexes.back();
+            mFreePeerIndexes.pop_back();
+        }
+    }
+    return it->second;
+}
+
+bool
+Floodgate::isPeerTold(FloodRecord const& record, Peer const& peer) const
+{
+    auto it = mPeerIndexes.find(peer.toString());
+    return it != mPeerIndexes.end() && record.mPeersTold.contains(it->second);
+}
+
+// Gives back the indexes no remaining record refers to, so that indexes stay
+// small (and PeerSets stay inline) as peers come and go
+void
+Floodgate::releaseUnusedPeerIndexes()
+{
+    ZoneScoped;
+    PeerSet used;
+    for (auto const& record : mFloodMap)
+    {
+        used.merge(record.second.mPeersTold);
+    }
+    for (auto it = mPeerIndexes.begin(); it != mPeerIndexes.end();)
+    {
+        if (!used.contains(it->second))
+        {
+            mFreePeerIndexes.emplace_back(it->second);
+            it = mPeerIndexes.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    // Hand out low indexes first
+    std::sort(mFreePeerIndexes.begin(), mFreePeerIndexes.end(),
+              std::greater<uint32_t>());
 }
 
 bool
@@ -64,19 +264,24 @@ Floodgate::addRecord(StellarMessage const& msg, Peer::pointer peer, Hash& index)
     {
         return false;
     }
-    auto result = mFloodMap.find(index);
-    if (result == mFloodMap.end())
+    MemoryArenaScope arenaScope(MemoryArena::FLOOD);
+    auto [result, inserted] = mFloodMap.emplace(index);
+    if (inserted)
     { // we have never seen this message
-        mFloodMap[index] = std::make_shared<FloodRecord>(
-            mApp.getHerder().trackingConsensusLedgerIndex(), peer);
-        mFloodMapSize.set_count(mFloodMap.size());
+        result->second.mLedgerSeq =
+            mApp.getHerder().trackingConsensusLedgerIndex();
+        if (peer)
+        {
+            result->second.mPeersTold.insert(getPeerIndex(*peer));
+        }
+        updateFloodMapMetrics();
         TracyPlot("overlay.memory.flood-known",
                   static_cast<int64_t>(mFloodMap.size()));
         return true;
     }
     else
     {
-        result->second->mPeersTold.insert(peer->toString());
+        result->second.mPeersTold.insert(getPeerIndex(*peer));
         return false;
     }
 }
@@ -99,45 +304,79 @@ Floodgate::broadcast(std::shared_ptr<StellarMessage const> msg,
     }
     Hash index = xdrBlake2(*msg);
 
-    FloodRecord::pointer fr;
-    auto result = mFloodMap.find(index);
-    if (result == mFloodMap.end())
+    auto [result, inserted] = mFloodMap.emplace(index);
+    if (inserted)
     { // no one has sent us this message / start from scratch
-        fr = std::make_shared<FloodRecord>(
-            mApp.getHerder().trackingConsensusLedgerIndex(), Peer::pointer());
-        mFloodMap[index] = fr;
-        mFloodMapSize.set_count(mFloodMap.size());
+        result->second.mLedgerSeq =
+            mApp.getHerder().trackingConsensusLedgerIndex();
+        updateFloodMapMetrics();
     }
-    else
+    // send it to people that haven't sent it to us. Nothing below inserts
+    // into mFloodMap, so the reference stays valid
+    auto& record = result->second;
+    auto& peersTold = record.mPeersTold;
+
+    // make a copy, in case peers gets modified
+    auto authenticated = mApp.getOverlayManager().getAuthenticatedPeers();
+    std::vector<Peer::pointer> peers;
+    peers.reserve(authenticated.size());
+    for (auto const& peer : authenticated)
     {
-        fr = result->second;
+        peers.emplace_back(peer.second);
     }
-    // send it to people that haven't sent it to us
-    auto& peersTold = fr->mPeersTold;
 
-    // make a copy, in case peers gets modified
-    auto peers = mApp.getOverlayManager().getAuthenticatedPeers();
+    bool pullMode = msg->type() == TRANSACTION;
+
+    // Transactions we relay are only advertised to a few random peers, the
+    // ones that are not picked learn about them from the peers that are.
+    // Peers that are skipped stay out of `peersTold`, so that a rebroadcast
+    // can still advertise to them. Optionally half of the fanout goes to the
+    // best scoring peers, the other half stays random so that new peers get
+    // a chance to be scored and the relay paths do not all converge.
+    auto const& cfg = mApp.getConfig();
+    size_t fanout = cfg.FLOOD_ADVERT_RELAY_FANOUT;
+    bool limitFanout = pullMode && !inserted && fanout != 0;
+    if (limitFanout)
+    {
+        stellar::shuffle(peers.begin(), peers.end(), gRandomEngine);
+        if (cfg.FLOOD_ADVERT_RELAY_PREFER_FAST_PEERS)
+        {
+            preferFastPeers(
+                peers,
+                [&](Peer const& peer) { return isPeerTold(record, peer); },
+                (fanout + 1) / 2, minOverlayVersion);
+        }
+    }
+    size_t advertised = 0;
 
     bool broadcasted = false;
-    for (auto peer : peers)
+    for (auto const& peer : peers)
     {
         // Assert must hold since only main thread is allowed to modify
         // authenticated peers and peer state during drop
-        peer.second->assertAuthenticated();
-        if (peer.second->getRemoteOverlayVersion() < minOverlayVersion)
+        peer->assertAuthenticated();
+        if (peer->getRemoteOverlayVersion() < minOverlayVersion)
         {
             // Skip peers running overlay versions that are older than
             // `minOverlayVersion`.
             continue;
         }
 
-        bool pullMode = msg->type() == TRANSACTION;
+        if (limitFanout && advertised >= fanout)
+        {
+            if (!isPeerTold(record, *peer))
+            {
+                mAdvertsSkipped.Mark();
+            }
+            continue;
+        }
 
-        if (peersTold.insert(peer.second->toString()).second)
+        if (peersTold.insert(getPeerIndex(*peer)))
         {
             if (pullMode)
             {
-                if (peer.second->sendAdvert(hash.value()))
+                ++advertised;
+                if (peer->sendAdvert(hash.value()))
                 {
                     mMessagesAdvertised.Mark();
                 }
@@ -145,8 +384,7 @@ Floodgate::broadcast(std::shared_ptr<StellarMessage const> msg,
             else
             {
                 mSendFromBroadcast.Mark();
-                std::weak_ptr<Peer> weak(
-                    std::static_pointer_cast<Peer>(peer.second));
+                std::weak_ptr<Peer> weak(peer);
                 // This is an async operation, and peer might get dropped by the
                 // time we actually try to send the message. This is fine, as
                 // sendMessage will just be a no-op in that case
@@ -159,7 +397,7 @@ Floodgate::broadcast(std::shared_ptr<StellarMessage const> msg,
                         }
                     },
                     fmt::format(FMT_STRING("broadcast to {}"),
-                                peer.second->toString()));
+                                peer->toString()));
             }
             broadcasted = true;
         }
@@ -176,11 +414,10 @@ Floodgate::getPeersKnows(Hash const& h)
     auto record = mFloodMap.find(h);
     if (record != mFloodMap.end())
     {
-        auto& ids = record->second->mPeersTold;
         auto const& peers = mApp.getOverlayManager().getAuthenticatedPeers();
         for (auto& p : peers)
         {
-            if (ids.find(p.second->toString()) != ids.end())
+            if (isPeerTold(record->second, *p.second))
             {
                 res.insert(p.second);
             }
@@ -194,6 +431,9 @@ Floodgate::shutdown()
 {
     mShuttingDown = true;
     mFloodMap.clear();
+    mPeerIndexes.clear();
+    mFreePeerIndexes.clear();
+    mNextPeerIndex = 0;
 }
 
 void
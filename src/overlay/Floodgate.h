@@ -5,7 +5,12 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "overlay/Peer.h"
-#include <map>
+#include "util/TxHashIndex.h"
+#include "util/UnorderedMap.h"
+
+#include <array>
+#include <cstdint>
+#include <vector>
 
 /**
  * FloodGate keeps track of which peers have sent us which broadcast messages,
@@ -32,24 +37,49 @@ struct StellarMessage;
 
 class Floodgate
 {
-    class FloodRecord
+    // Set of the small indexes Floodgate gives to peers (see getPeerIndex).
+    // The first 128 indexes are kept inline, so a record needs no allocation
+    // of its own for usual peer counts.
+    class PeerSet
     {
-      public:
-        typedef std::shared_ptr<FloodRecord> pointer;
+        static constexpr size_t INLINE_WORDS = 2;
+        std::array<uint64_t, INLINE_WORDS> mInline{};
+        std::vector<uint64_t> mOverflow;
 
-        uint32_t mLedgerSeq;
-        std::set<std::string> mPeersTold;
+      public:
+        // Returns whether index was inserted, that is it was not in the set
+        bool insert(uint32_t index);
+        bool contains(uint32_t index) const;
+        size_t size() const;
+        void merge(PeerSet const& other);
+    };
 
-        FloodRecord(uint32_t ledger, Peer::pointer peer);
+    struct FloodRecord
+    {
+        uint32_t mLedgerSeq{0};
+        PeerSet mPeersTold;
     };
 
-    std::map<Hash, FloodRecord::pointer> mFloodMap;
+    // Records are stored in place, keyed by message hash
+    TxHashMap<FloodRecord> mFloodMap;
+    // Index of each peer (by `Peer::toString`) in the PeerSets of records.
+    // An index is only given back once no record refers to it anymore.
+    UnorderedMap<std::string, uint32_t> mPeerIndexes;
+    std::vector<uint32_t> mFreePeerIndexes;
+    uint32_t mNextPeerIndex{0};
     Application& mApp;
     medida::Counter& mFloodMapSize;
+    medida::Counter& mFloodMapBytes;
     medida::Meter& mSendFromBroadcast;
     medida::Meter& mMessagesAdvertised;
+    medida::Meter& mAdvertsSkipped;
     bool mShuttingDown;
 
+    uint32_t getPeerIndex(Peer const& peer);
+    bool isPeerTold(FloodRecord const& record, Peer const& peer) const;
+    void releaseUnusedPeerIndexes();
+    void updateFloodMapMetrics();
+
   public:
     Floodgate(Application& app);
     // forget data strictly older than `maxLedger`
@@ -11,6 +11,7 @@
 #include "overlay/OverlayMetrics.h"
 #include "util/Logging.h"
 #include <Tracy.hpp>
+#include <cmath>
 
 namespace stellar
 {
@@ -18,9 +19,35 @@ namespace stellar
 constexpr std::chrono::seconds const OUTBOUND_QUEUE_TIMEOUT =
     std::chrono::seconds(30);
 
+namespace
+{
+// Returns how much of `processed` capacity, plus the capacity `withheld`
+// earlier, to grant back to the peer: all of it if `fraction` is 1, and
+// otherwise `fraction` of `processed`, withholding the rest, but never so
+// that more than `maxWithheld` is withheld in total
+uint64_t
+grantCapacity(uint64_t processed, uint64_t& withheld, double fraction,
+              uint64_t maxWithheld)
+{
+    uint64_t total = processed + withheld;
+    uint64_t grant = total;
+    if (fraction < 1.0)
+    {
+        grant = static_cast<uint64_t>(
+            std::ceil(static_cast<double>(processed) * fraction));
+        if (total - grant > maxWithheld)
+        {
+            grant = total - maxWithheld;
+        }
+    }
+    withheld = total - grant;
+    return grant;
+}
+}
+
 size_t
 FlowControl::getOutboundQueueByteLimit(
-    std::lock_guard<std::mutex>& lockGuard) const
+    std::lock_guard<ProfiledMutex>& lockGuard) const
 {
 #ifdef BUILD_TESTS
     if (mOutboundQueueLimit)
@@ -45,8 +72,8 @@ FlowControl::FlowControl(OverlayAppConnector& connector,
 }
 
 bool
-FlowControl::hasOutboundCapacity(StellarMessage const& msg,
-                                 std::lock_guard<std::mutex>& lockGuard) const
+FlowControl::hasOutboundCapacity(
+    StellarMessage const& msg, std::lock_guard<ProfiledMutex>& lockGuard) const
 {
     releaseAssert(!threadIsMain() || !mUseBackgroundThread);
     releaseAssert(mFlowControlCapacity);
@@ -59,7 +86,7 @@ void
 FlowControl::start(NodeID const& peerID, std::optional<uint32_t> enableFCBytes)
 {
     releaseAssert(threadIsMain());
-    std::lock_guard<std::mutex> guard(mFlowControlMutex);
+    std::scoped_lock guard(mInboundMutex, mOutboundMutex);
     mNodeID = peerID;
 
     if (enableFCBytes)
@@ -74,7 +101,7 @@ FlowControl::maybeReleaseCapacity(StellarMessage const& msg)
 {
     ZoneScoped;
     releaseAssert(threadIsMain());
-    std::lock_guard<std::mutex> guard(mFlowControlMutex);
+    std::lock_guard<ProfiledMutex> guard(mOutboundMutex);
 
     if (msg.type() == SEND_MORE || msg.type() == SEND_MORE_EXTENDED)
     {
@@ -104,94 +131,129 @@ FlowControl::maybeReleaseCapacity(StellarMessage const& msg)
 }
 
 std::vector<std::shared_ptr<StellarMessage const>>
-FlowControl::getNextBatchToSend()
+FlowControl::getNextBatchToSend(uint64_t bulkByteBudget)
 {
     ZoneScoped;
     releaseAssert(!threadIsMain() || !mUseBackgroundThread);
 
-    std::lock_guard<std::mutex> guard(mFlowControlMutex);
     std::vector<std::shared_ptr<StellarMessage const>> batchToSend;
-
-    int sent = 0;
-    for (int i = 0; i < mOutboundQueues.size(); i++)
+    // Time each message spent in the queue, recorded once the lock is
+    // released since timers synchronize on their own
+    std::vector<std::pair<MessageType, VirtualClock::duration>> delays;
+    bool noCapacity = false;
     {
-        auto& queue = mOutboundQueues[i];
-        while (!queue.empty())
+        std::lock_guard<ProfiledMutex> guard(mOutboundMutex);
+        auto now = mAppConnector.now();
+        for (int i = 0; i < mOutboundQueues.size(); i++)
         {
-            auto& front = queue.front();
-            auto const& msg = *(front.mMessage);
-            // Can't send _current_ message
-            if (!hasOutboundCapacity(msg, guard))
-            {
-                CLOG_DEBUG(
-                    Overlay, "{}: No outbound capacity for peer {}",
-                    mAppConnector.getConfig().toShortString(
-                        mAppConnector.getConfig().NODE_SEED.getPublicKey()),
-                    mAppConnector.getConfig().toShortString(mNodeID));
-                // Start a timeout for SEND_MORE
-                mNoOutboundCapacity =
-                    std::make_optional<VirtualClock::time_point>(
-                        mAppConnector.now());
-                break;
-            }
-
-            batchToSend.push_back(front.mMessage);
-            ++sent;
-            auto& om = mOverlayMetrics;
-
-            auto const& diff = mAppConnector.now() - front.mTimeEmplaced;
-            mFlowControlCapacity->lockOutboundCapacity(msg);
-            if (mFlowControlBytesCapacity)
+            auto& queue = mOutboundQueues[i];
+            while (!queue.empty())
             {
-                mFlowControlBytesCapacity->lockOutboundCapacity(msg);
-            }
+                auto& front = queue.front();
+                auto const& msg = *(front.mMessage);
+                // Queue 0 holds SCP messages; the others wait for the
+                // transport to drain once their budget is used up
+                if (i != 0 && bulkByteBudget == 0)
+                {
+                    break;
+                }
+                // Can't send _current_ message
+                if (!hasOutboundCapacity(msg, guard))
+                {
+                    // Start a timeout for SEND_MORE
+                    mNoOutboundCapacity =
+                        std::make_optional<VirtualClock::time_point>(now);
+                    noCapacity = true;
+                    break;
+                }
 
-            switch (front.mMessage->type())
-            {
-            case TRANSACTION:
-            {
-                om.mOutboundQueueDelayTxs.Update(diff);
-                mMetrics.mOutboundQueueDelayTxs.Update(diff);
+                if (i != 0)
+                {
+                    bulkByteBudget -=
+                        std::min(bulkByteBudget,
+                                 FlowControlCapacity::msgBodySize(msg));
+                }
+                batchToSend.push_back(front.mMessage);
+                delays.emplace_back(msg.type(), now - front.mTimeEmplaced);
+                mFlowControlCapacity->lockOutboundCapacity(msg);
                 if (mFlowControlBytesCapacity)
                 {
-                    size_t s =
-                        mFlowControlBytesCapacity->getMsgResourceCount(msg);
-                    releaseAssert(mTxQueueByteCount >= s);
-                    mTxQueueByteCount -= s;
+                    mFlowControlBytesCapacity->lockOutboundCapacity(msg);
                 }
+
+                switch (msg.type())
+                {
+                case TRANSACTION:
+                {
+                    if (mFlowControlBytesCapacity)
+                    {
+                        size_t s =
+                            mFlowControlBytesCapacity->getMsgResourceCount(
+                                msg);
+                        releaseAssert(mTxQueueByteCount >= s);
+                        mTxQueueByteCount -= s;
+                    }
+                }
+                break;
+                case SCP_MESSAGE:
+                    break;
+                case FLOOD_DEMAND:
+                {
+                    size_t s = msg.floodDemand().txHashes.size();
+                    releaseAssert(mDemandQueueTxHashCount >= s);
+                    mDemandQueueTxHashCount -= s;
+                }
+                break;
+                case FLOOD_ADVERT:
+                {
+                    size_t s = msg.floodAdvert().txHashes.size();
+                    releaseAssert(mAdvertQueueTxHashCount >= s);
+                    mAdvertQueueTxHashCount -= s;
+                }
+                break;
+                default:
+                    abort();
+                }
+                queue.pop_front();
             }
+        }
+    }
+
+    auto& om = mOverlayMetrics;
+    for (auto const& [type, diff] : delays)
+    {
+        switch (type)
+        {
+        case TRANSACTION:
+            om.mOutboundQueueDelayTxs.Update(diff);
+            mMetrics.mOutboundQueueDelayTxs.Update(diff);
             break;
-            case SCP_MESSAGE:
-            {
-                om.mOutboundQueueDelaySCP.Update(diff);
-                mMetrics.mOutboundQueueDelaySCP.Update(diff);
-            }
+        case SCP_MESSAGE:
+            om.mOutboundQueueDelaySCP.Update(diff);
+            mMetrics.mOutboundQueueDelaySCP.Update(diff);
             break;
-            case FLOOD_DEMAND:
-            {
-                om.mOutboundQueueDelayDemand.Update(diff);
-                mMetrics.mOutboundQueueDelayDemand.Update(diff);
-                size_t s = front.mMessage->floodDemand().txHashes.size();
-                releaseAssert(mDemandQueueTxHashCount >= s);
-                mDemandQueueTxHashCount -= s;
-            }
+        case FLOOD_DEMAND:
+            om.mOutboundQueueDelayDemand.Update(diff);
+            mMetrics.mOutboundQueueDelayDemand.Update(diff);
             break;
-            case FLOOD_ADVERT:
-            {
-                om.mOutboundQueueDelayAdvert.Update(diff);
-                mMetrics.mOutboundQueueDelayAdvert.Update(diff);
-                size_t s = front.mMessage->floodAdvert().txHashes.size();
-                releaseAssert(mAdvertQueueTxHashCount >= s);
-                mAdvertQueueTxHashCount -= s;
-            }
+        case FLOOD_ADVERT:
+            om.mOutboundQueueDelayAdvert.Update(diff);
+            mMetrics.mOutboundQueueDelayAdvert.Update(diff);
             break;
-            default:
-                abort();
-            }
-            queue.pop_front();
+        default:
+            abort();
         }
     }
 
+    if (noCapacity)
+    {
+        CLOG_DEBUG(Overlay, "{}: No outbound capacity for peer {}",
+                   mAppConnector.getConfig().toShortString(
+                       mAppConnector.getConfig().NODE_SEED.getPublicKey()),
+                   mAppConnector.getConfig().toShortString(mNodeID));
+    }
+
+    auto sent = batchToSend.size();
     CLOG_TRACE(Overlay, "{} Peer {}: send next flood batch of {}",
                mAppConnector.getConfig().toShortString(
                    mAppConnector.getConfig().NODE_SEED.getPublicKey()),
@@ -204,7 +266,7 @@ FlowControl::handleTxSizeIncrease(uint32_t increase)
 {
     ZoneScoped;
     releaseAssert(threadIsMain());
-    std::lock_guard<std::mutex> guard(mFlowControlMutex);
+    std::lock_guard<ProfiledMutex> guard(mInboundMutex);
     if (mFlowControlBytesCapacity)
     {
         releaseAssert(increase > 0);
@@ -218,7 +280,7 @@ FlowControl::beginMessageProcessing(StellarMessage const& msg)
 {
     ZoneScoped;
     releaseAssert(!threadIsMain() || !mUseBackgroundThread);
-    std::lock_guard<std::mutex> guard(mFlowControlMutex);
+    std::lock_guard<ProfiledMutex> guard(mInboundMutex);
 
     return mFlowControlCapacity->lockLocalCapacity(msg) &&
            (!mFlowControlBytesCapacity ||
@@ -230,7 +292,7 @@ FlowControl::endMessageProcessing(StellarMessage const& msg)
 {
     ZoneScoped;
     releaseAssert(threadIsMain());
-    std::lock_guard<std::mutex> guard(mFlowControlMutex);
+    std::lock_guard<ProfiledMutex> guard(mInboundMutex);
 
     mFloodDataProcessed += mFlowControlCapacity->releaseLocalCapacity(msg);
     if (mFlowControlBytesCapacity)
@@ -256,11 +318,36 @@ FlowControl::endMessageProcessing(StellarMessage const& msg)
     SendMoreCapacity res{0, std::nullopt};
     if (shouldSendMore)
     {
-        // First save result to return
-        res.first = mFloodDataProcessed;
+        // First save result to return. While the main thread falls behind,
+        // only part of the processed capacity is granted back. The peer keeps
+        // at least a batch worth of capacity (and, for bytes, enough for a
+        // maximum size transaction on top), so that it can always send enough
+        // for us to reach the next SEND_MORE.
+        auto fraction =
+            mAppConnector.getOverlayManager().getFloodCapacityGrantFraction();
+        auto const& cfg = mAppConnector.getConfig();
+        auto maxWithheld =
+            mFlowControlCapacity->getCapacityLimits().mFloodCapacity -
+            cfg.FLOW_CONTROL_SEND_MORE_BATCH_SIZE;
+        res.first = grantCapacity(mFloodDataProcessed, mFloodDataWithheld,
+                                  fraction, maxWithheld);
+        if (res.first < mFloodDataProcessed)
+        {
+            mOverlayMetrics.mFloodCapacityWithheld.Mark(mFloodDataProcessed -
+                                                        res.first);
+        }
         if (mFlowControlBytesCapacity)
         {
-            res.second = mFloodDataProcessedBytes;
+            auto const limit =
+                mFlowControlBytesCapacity->getCapacityLimits().mFloodCapacity;
+            uint64_t const reserved =
+                mAppConnector.getOverlayManager()
+                    .getFlowControlBytesConfig()
+                    .mBatchSize +
+                mAppConnector.getHerder().getMaxTxSize();
+            res.second = grantCapacity(
+                mFloodDataProcessedBytes, mFloodDataWithheldBytes, fraction,
+                limit > reserved ? limit - reserved : 0);
         }
 
         // Reset counters
@@ -272,7 +359,7 @@ FlowControl::endMessageProcessing(StellarMessage const& msg)
 }
 
 bool
-FlowControl::canRead(std::lock_guard<std::mutex> const& guard) const
+FlowControl::canRead(std::lock_guard<ProfiledMutex> const& guard) const
 {
     bool canReadBytes =
         !mFlowControlBytesCapacity || mFlowControlBytesCapacity->canRead();
@@ -282,7 +369,7 @@ FlowControl::canRead(std::lock_guard<std::mutex> const& guard) const
 bool
 FlowControl::canRead() const
 {
-    std::lock_guard<std::mutex> guard(mFlowControlMutex);
+    std::lock_guard<ProfiledMutex> guard(mInboundMutex);
     return canRead(guard);
 }
 
@@ -298,7 +385,7 @@ FlowControl::isSendMoreValid(StellarMessage const& msg,
                              std::string& errorMsg) const
 {
     releaseAssert(threadIsMain());
-    std::lock_guard<std::mutex> guard(mFlowControlMutex);
+    std::lock_guard<ProfiledMutex> guard(mOutboundMutex);
 
     bool sendMoreExtendedType =
         mFlowControlBytesCapacity && msg.type() == SEND_MORE_EXTENDED;
@@ -358,12 +445,27 @@ FlowControl::addMsgAndMaybeTrimQueue(std::shared_ptr<StellarMessage const> msg)
 {
     ZoneScoped;
     releaseAssert(threadIsMain());
-    std::lock_guard<std::mutex> guard(mFlowControlMutex);
     releaseAssert(msg);
     auto type = msg->type();
     size_t msgQInd = 0;
     auto now = mAppConnector.now();
 
+    // Query the herder and ledger before taking the lock, to keep the overlay
+    // thread draining the queues waiting as little as possible
+    auto& herder = mAppConnector.getHerder();
+    uint32_t const limit =
+        mAppConnector.getLedgerManager().getLastMaxTxSetSizeOps();
+    uint32_t const maxTxSize = type == TRANSACTION ? herder.getMaxTxSize() : 0;
+    uint32_t minSlotToRemember = 0;
+    uint32_t checkpointSeq = 0;
+    if (type == SCP_MESSAGE)
+    {
+        minSlotToRemember = herder.getMinLedgerSeqToRemember();
+        checkpointSeq = herder.getMostRecentCheckpointSeq();
+    }
+
+    std::lock_guard<ProfiledMutex> guard(mOutboundMutex);
+
     switch (type)
     {
     case SCP_MESSAGE:
@@ -379,7 +481,7 @@ FlowControl::addMsgAndMaybeTrimQueue(std::shared_ptr<StellarMessage const> msg)
             auto bytes = mFlowControlBytesCapacity->getMsgResourceCount(*msg);
             // Don't accept transactions that are over allowed byte limit: those
             // won't be properly flooded anyways
-            if (bytes > mAppConnector.getHerder().getMaxTxSize())
+            if (bytes > maxTxSize)
             {
                 return;
             }
@@ -406,12 +508,10 @@ FlowControl::addMsgAndMaybeTrimQueue(std::shared_ptr<StellarMessage const> msg)
     }
     auto& queue = mOutboundQueues[msgQInd];
 
-    queue.emplace_back(QueuedOutboundMessage{msg, mAppConnector.now()});
+    queue.emplace_back(QueuedOutboundMessage{msg, now});
 
     size_t dropped = 0;
 
-    uint32_t const limit =
-        mAppConnector.getLedgerManager().getLastMaxTxSetSizeOps();
     auto& om = mOverlayMetrics;
     if (type == TRANSACTION)
     {
@@ -450,10 +550,6 @@ FlowControl::addMsgAndMaybeTrimQueue(std::shared_ptr<StellarMessage const> msg)
         // don't keep in-memory anymore, delete those. Otherwise, compare
         // messages for the same slot and validator against the latest SCP
         // message and drop
-        auto minSlotToRemember =
-            mAppConnector.getHerder().getMinLedgerSeqToRemember();
-        auto checkpointSeq =
-            mAppConnector.getHerder().getMostRecentCheckpointSeq();
         bool valueReplaced = false;
 
         for (auto it = queue.begin(); it != queue.end();)
@@ -465,7 +561,7 @@ FlowControl::addMsgAndMaybeTrimQueue(std::shared_ptr<StellarMessage const> msg)
                 dropped++;
             }
             else if (!valueReplaced && it != queue.end() - 1 &&
-                     mAppConnector.getHerder().isNewerNominationOrBallotSt(
+                     herder.isNewerNominationOrBallotSt(
                          it->mMessage->envelope().statement,
                          queue.back().mMessage->envelope().statement))
             {
@@ -521,7 +617,7 @@ Json::Value
 FlowControl::getFlowControlJsonInfo(bool compact) const
 {
     releaseAssert(threadIsMain());
-    std::lock_guard<std::mutex> guard(mFlowControlMutex);
+    std::scoped_lock guard(mInboundMutex, mOutboundMutex);
 
     Json::Value res;
     if (mFlowControlCapacity->getCapacity().mTotalCapacity)
@@ -533,6 +629,7 @@ FlowControl::getFlowControlJsonInfo(bool compact) const
         mFlowControlCapacity->getCapacity().mFloodCapacity);
     res["peer_capacity"] =
         static_cast<Json::UInt64>(mFlowControlCapacity->getOutboundCapacity());
+    res["withheld_capacity"] = static_cast<Json::UInt64>(mFloodDataWithheld);
     if (mFlowControlBytesCapacity)
     {
         if (mFlowControlBytesCapacity->getCapacity().mTotalCapacity)
@@ -544,6 +641,8 @@ FlowControl::getFlowControlJsonInfo(bool compact) const
             mFlowControlBytesCapacity->getCapacity().mFloodCapacity);
         res["peer_capacity_bytes"] = static_cast<Json::UInt64>(
             mFlowControlBytesCapacity->getOutboundCapacity());
+        res["withheld_capacity_bytes"] =
+            static_cast<Json::UInt64>(mFloodDataWithheldBytes);
     }
 
     if (!compact)
@@ -566,7 +665,7 @@ FlowControl::getFlowControlJsonInfo(bool compact) const
 bool
 FlowControl::maybeThrottleRead()
 {
-    std::lock_guard<std::mutex> guard(mFlowControlMutex);
+    std::lock_guard<ProfiledMutex> guard(mInboundMutex);
     if (!canRead(guard))
     {
         CLOG_DEBUG(Overlay, "Throttle reading from peer {}",
@@ -580,7 +679,7 @@ FlowControl::maybeThrottleRead()
 bool
 FlowControl::stopThrottling()
 {
-    std::lock_guard<std::mutex> guard(mFlowControlMutex);
+    std::lock_guard<ProfiledMutex> guard(mInboundMutex);
     releaseAssert(threadIsMain());
     if (mLastThrottle)
     {
@@ -597,7 +696,7 @@ FlowControl::stopThrottling()
 bool
 FlowControl::isThrottled() const
 {
-    std::lock_guard<std::mutex> guard(mFlowControlMutex);
+    std::lock_guard<ProfiledMutex> guard(mInboundMutex);
     return static_cast<bool>(mLastThrottle);
 }
 
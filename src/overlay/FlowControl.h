@@ -7,7 +7,9 @@
 #include "lib/json/json.h"
 #include "medida/timer.h"
 #include "overlay/FlowControlCapacity.h"
+#include "util/ContentionProfiler.h"
 #include "util/Timer.h"
+#include <mutex>
 #include <optional>
 
 namespace stellar
@@ -56,8 +58,14 @@ class FlowControl
     size_t mDemandQueueTxHashCount{0};
     size_t mTxQueueByteCount{0};
 
-    // Mutex to synchronize flow control state
-    std::mutex mutable mFlowControlMutex;
+    // Inbound state (local capacity, processed flood data and throttling) and
+    // outbound state (queues with their counters, and the peer's capacity)
+    // are synchronized separately, so that reading from the peer does not
+    // contend with queueing broadcasts to it. The two parts of the capacity
+    // objects are disjoint. Methods that need both take them together with
+    // std::scoped_lock.
+    ProfiledMutex mutable mInboundMutex{"FlowControl::mInboundMutex"};
+    ProfiledMutex mutable mOutboundMutex{"FlowControl::mOutboundMutex"};
     // Is this peer currently throttled due to lack of capacity
     std::optional<VirtualClock::time_point> mLastThrottle;
 
@@ -82,14 +90,18 @@ class FlowControl
     // How many bytes we received and processed since sending
     // SEND_MORE to this peer
     uint64_t mFloodDataProcessedBytes{0};
+    // Processed flood capacity not granted back to this peer yet, because
+    // the main thread was falling behind
+    uint64_t mFloodDataWithheld{0};
+    uint64_t mFloodDataWithheldBytes{0};
     std::optional<VirtualClock::time_point> mNoOutboundCapacity;
     FlowControlMetrics mMetrics;
 
     bool hasOutboundCapacity(StellarMessage const& msg,
-                             std::lock_guard<std::mutex>& lockGuard) const;
+                             std::lock_guard<ProfiledMutex>& lockGuard) const;
     virtual size_t
-    getOutboundQueueByteLimit(std::lock_guard<std::mutex>& lockGuard) const;
-    bool canRead(std::lock_guard<std::mutex> const& lockGuard) const;
+    getOutboundQueueByteLimit(std::lock_guard<ProfiledMutex>& lockGuard) const;
+    bool canRead(std::lock_guard<ProfiledMutex> const& lockGuard) const;
 
   public:
     FlowControl(OverlayAppConnector& connector, bool useBackgoundThread);
@@ -100,9 +112,13 @@ class FlowControl
     // This method adds a new message to the outbound queue, while shedding
     // obsolete load
     void addMsgAndMaybeTrimQueue(std::shared_ptr<StellarMessage const> msg);
-    // Return next batch of messages to send
+    // Return next batch of messages to send. SCP messages are always sent
+    // while there is capacity; the other queues only until the messages taken
+    // from them reach bulkByteBudget bytes, leaving the rest queued where
+    // later SCP messages can still overtake them.
     // NOTE: this methods _releases_ capacity and cleans up flow control queues
-    std::vector<std::shared_ptr<StellarMessage const>> getNextBatchToSend();
+    std::vector<std::shared_ptr<StellarMessage const>>
+    getNextBatchToSend(uint64_t bulkByteBudget = UINT64_MAX);
 
 #ifdef BUILD_TESTS
     std::shared_ptr<FlowControlCapacity>
@@ -143,7 +159,7 @@ class FlowControl
     size_t
     getOutboundQueueByteLimit() const
     {
-        std::lock_guard<std::mutex> lockGuard(mFlowControlMutex);
+        std::lock_guard<ProfiledMutex> lockGuard(mOutboundMutex);
         return getOutboundQueueByteLimit(lockGuard);
     }
 #endif
@@ -168,6 +184,7 @@ class FlowControl
     std::optional<VirtualClock::time_point>
     getOutboundCapacityTimestamp() const
     {
+        std::lock_guard<ProfiledMutex> guard(mOutboundMutex);
         return mNoOutboundCapacity;
     }
 
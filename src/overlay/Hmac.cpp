@@ -36,6 +36,16 @@ Hmac::setRecvMackey(HmacSha256Key const& key)
 bool
 Hmac::checkAuthenticatedMessage(AuthenticatedMessage const& msg,
                                 std::string& errorMsg)
+{
+    ZoneScoped;
+    auto macInput = xdr::xdr_to_opaque(msg.v0().sequence, msg.v0().message);
+    return checkAuthenticatedMessage(msg, macInput, errorMsg);
+}
+
+bool
+Hmac::checkAuthenticatedMessage(AuthenticatedMessage const& msg,
+                                ByteSlice const& macInput,
+                                std::string& errorMsg)
 {
     ZoneScoped;
     LOCK_GUARD(mMutex, guard);
@@ -50,9 +60,7 @@ Hmac::checkAuthenticatedMessage(AuthenticatedMessage const& msg,
         errorMsg = "receive mac key is zero";
         return false;
     }
-    if (!hmacSha256Verify(
-            msg.v0().mac, mRecvMacKey,
-            xdr::xdr_to_opaque(msg.v0().sequence, msg.v0().message)))
+    if (!hmacSha256Verify(msg.v0().mac, mRecvMacKey, macInput))
     {
         errorMsg = "unexpected MAC";
         return false;
@@ -79,6 +87,17 @@ Hmac::setAuthenticatedMessageBody(AuthenticatedMessage& aMsg,
     }
 }
 
+std::pair<uint64_t, HmacSha256Mac>
+Hmac::authenticateEncodedMessage(ByteSlice const& encodedMsg)
+{
+    ZoneScoped;
+    LOCK_GUARD(mMutex, guard);
+
+    auto seq = mSendMacSeq++;
+    auto mac = hmacSha256(mSendMacKey, xdr::xdr_to_opaque(seq), encodedMsg);
+    return {seq, mac};
+}
+
 #ifdef BUILD_TESTS
 void
 Hmac::damageRecvMacKey()
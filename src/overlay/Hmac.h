@@ -5,9 +5,11 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "Tracy.hpp"
+#include "crypto/ByteSlice.h"
 #include "xdr/Stellar-overlay.h"
 #include "xdr/Stellar-types.h"
 #include <mutex>
+#include <utility>
 
 using namespace stellar;
 
@@ -28,8 +30,18 @@ class Hmac
     bool setRecvMackey(HmacSha256Key const& key);
     bool checkAuthenticatedMessage(AuthenticatedMessage const& msg,
                                    std::string& errorMsg);
+    // Same as above, checking the MAC of msg against macInput, the XDR of its
+    // sequence number and message as received, instead of encoding them again
+    bool checkAuthenticatedMessage(AuthenticatedMessage const& msg,
+                                   ByteSlice const& macInput,
+                                   std::string& errorMsg);
     void setAuthenticatedMessageBody(AuthenticatedMessage& aMsg,
                                      StellarMessage const& msg);
+    // Same as setAuthenticatedMessageBody for a message (other than HELLO and
+    // ERROR_MSG) that is already XDR-encoded. Returns the sequence number
+    // assigned to it and its MAC.
+    std::pair<uint64_t, HmacSha256Mac>
+    authenticateEncodedMessage(ByteSlice const& encodedMsg);
 #ifdef BUILD_TESTS
     void damageRecvMacKey();
 #endif
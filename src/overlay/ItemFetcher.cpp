@@ -7,6 +7,9 @@
 #include "herder/Herder.h"
 #include "herder/TxSetFrame.h"
 #include "main/Application.h"
+#include "medida/histogram.h"
+#include "overlay/OverlayManager.h"
+#include "overlay/OverlayMetrics.h"
 #include "overlay/Tracker.h"
 #include "util/Logging.h"
 #include <Tracy.hpp>
@@ -150,6 +153,8 @@ ItemFetcher::recv(Hash itemHash, medida::Timer& timer)
                    tracker->size());
 
         timer.Update(tracker->getDuration());
+        mApp.getOverlayManager().getOverlayMetrics().mItemFetcherAsks.Update(
+            tracker->getNumAsks());
         while (!tracker->empty())
         {
             mApp.getHerder().recvSCPEnvelope(tracker->pop());
@@ -1,9 +1,12 @@
 #include "overlay/OverlayAppConnector.h"
+#include "bucket/BucketManager.h"
+#include "bucket/BucketSnapshotManager.h"
 #include "herder/Herder.h"
 #include "ledger/LedgerManager.h"
 #include "main/Application.h"
 #include "overlay/BanManager.h"
 #include "overlay/OverlayManager.h"
+#include "overlay/PeerAuth.h"
 #include "util/Timer.h"
 
 namespace stellar
@@ -52,9 +55,10 @@ OverlayAppConnector::postOnMainThread(std::function<void()>&& f,
 
 void
 OverlayAppConnector::postOnOverlayThread(std::function<void()>&& f,
-                                         std::string const& message)
+                                         std::string const& message,
+                                         size_t overlayThread)
 {
-    mApp.postOnOverlayThread(std::move(f), message);
+    mApp.postOnOverlayThread(std::move(f), message, overlayThread);
 }
 
 Config const&
@@ -69,12 +73,27 @@ OverlayAppConnector::overlayShuttingDown() const
     return mApp.getOverlayManager().isShuttingDown();
 }
 
+PeerAuth&
+OverlayAppConnector::getPeerAuth()
+{
+    return mApp.getOverlayManager().getPeerAuth();
+}
+
 VirtualClock::time_point
 OverlayAppConnector::now() const
 {
     return mApp.getClock().now();
 }
 
+std::shared_ptr<SearchableBucketListSnapshot>
+OverlayAppConnector::getSearchableBucketListSnapshot()
+{
+    releaseAssert(mConfig.isUsingBucketListDB());
+    return mApp.getBucketManager()
+        .getBucketSnapshotManager()
+        .getSearchableBucketListSnapshot();
+}
+
 bool
 OverlayAppConnector::shouldYield() const
 {
@@ -9,6 +9,8 @@ class OverlayManager;
 class LedgerManager;
 class Herder;
 class BanManager;
+class PeerAuth;
+class SearchableBucketListSnapshot;
 
 // Helper class to isolate access to Application; all function helpers must
 // either be called from main or be thread-sade
@@ -34,9 +36,16 @@ class OverlayAppConnector
         std::function<void()>&& f, std::string&& message,
         Scheduler::ActionType type = Scheduler::ActionType::NORMAL_ACTION);
     void postOnOverlayThread(std::function<void()>&& f,
-                             std::string const& message);
+                             std::string const& message,
+                             size_t overlayThread = 0);
     VirtualClock::time_point now() const;
     Config const& getConfig() const;
     bool overlayShuttingDown() const;
+    // PeerAuth methods other than getAuthCert are thread-safe
+    PeerAuth& getPeerAuth();
+    // New snapshot of the live BucketList, only valid when BucketListDB is
+    // enabled
+    std::shared_ptr<SearchableBucketListSnapshot>
+    getSearchableBucketListSnapshot();
 };
 }
\ No newline at end of file
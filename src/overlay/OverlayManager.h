@@ -198,6 +198,9 @@ class OverlayManager
 
     virtual SurveyManager& getSurveyManager() = 0;
 
+    // Starts listening for peers ahead of start(), which accepts them, so
+    // that peers connecting while the node starts up are not refused
+    virtual void listen() = 0;
     // start up all background tasks for overlay
     virtual void start() = 0;
     // drops all connections
@@ -208,6 +211,14 @@ class OverlayManager
     virtual void recordMessageMetric(StellarMessage const& stellarMsg,
                                      Peer::pointer peer) = 0;
     virtual AdjustedFlowControlConfig getFlowControlBytesConfig() const = 0;
+
+    // Records how long a transaction flood message read from a peer waited
+    // for the main thread
+    virtual void recordFloodQueueDelay(std::chrono::nanoseconds delay) = 0;
+    // Fraction of the flood reading capacity freed by processing that peers
+    // should be granted right away; below 1 while the main thread is
+    // falling behind (see FLOW_CONTROL_TARGET_QUEUE_DELAY_MS)
+    virtual double getFloodCapacityGrantFraction() const = 0;
     virtual ~OverlayManager()
     {
     }
@@ -46,6 +46,11 @@ constexpr std::chrono::seconds PEER_IP_RESOLVE_RETRY_DELAY(10);
 constexpr std::chrono::seconds OUT_OF_SYNC_RECONNECT_DELAY(60);
 constexpr uint32_t INITIAL_PEER_FLOOD_READING_CAPACITY_BYTES{300000};
 constexpr uint32_t INITIAL_FLOW_CONTROL_SEND_MORE_BATCH_SIZE_BYTES{100000};
+// Smallest fraction of freed flood capacity granted back to peers, when the
+// main thread is overloaded
+constexpr double MIN_FLOOD_CAPACITY_GRANT_FRACTION{0.1};
+// Weight of each new sample in the flood queue delay moving average
+constexpr int64_t FLOOD_QUEUE_DELAY_SMOOTHING{16};
 
 bool
 OverlayManagerImpl::canAcceptOutboundPeer(PeerBareAddress const& address) const
@@ -334,6 +339,12 @@ OverlayManagerImpl::~OverlayManagerImpl()
 {
 }
 
+void
+OverlayManagerImpl::listen()
+{
+    mDoor.listen();
+}
+
 void
 OverlayManagerImpl::start()
 {
@@ -356,6 +367,40 @@ OverlayManagerImpl::start()
     mTxDemandsManager.start();
 }
 
+void
+OverlayManagerImpl::recordFloodQueueDelay(std::chrono::nanoseconds delay)
+{
+    releaseAssert(threadIsMain());
+    mFloodQueueDelay +=
+        (delay - mFloodQueueDelay) / FLOOD_QUEUE_DELAY_SMOOTHING;
+    getOverlayMetrics().mFloodQueueDelay.set_count(
+        std::chrono::duration_cast<std::chrono::milliseconds>(mFloodQueueDelay)
+            .count());
+}
+
+double
+OverlayManagerImpl::getFloodCapacityGrantFraction() const
+{
+    releaseAssert(threadIsMain());
+    std::chrono::duration<double, std::milli> target(
+        mApp.getConfig().FLOW_CONTROL_TARGET_QUEUE_DELAY_MS);
+    if (target.count() == 0)
+    {
+        return 1.0;
+    }
+    if (mApp.getClock().actionQueueIsOverloaded())
+    {
+        return MIN_FLOOD_CAPACITY_GRANT_FRACTION;
+    }
+    if (mFloodQueueDelay <= target)
+    {
+        return 1.0;
+    }
+    return std::max(
+        MIN_FLOOD_CAPACITY_GRANT_FRACTION,
+        target / std::chrono::duration<double, std::milli>(mFloodQueueDelay));
+}
+
 OverlayManager::AdjustedFlowControlConfig
 OverlayManagerImpl::getFlowControlBytesConfig() const
 {
@@ -1280,6 +1325,7 @@ OverlayManagerImpl::shutdown()
     // Stop ticking and resolving peers
     mTimer.cancel();
     mPeerIPTimer.cancel();
+    mPeerManager.shutdown();
 }
 
 bool
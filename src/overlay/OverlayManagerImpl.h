@@ -95,6 +95,9 @@ class OverlayManagerImpl : public OverlayManager
     VirtualTimer mPeerIPTimer;
     std::optional<VirtualClock::time_point> mLastOutOfSyncReconnect;
 
+    // Moving average of recordFloodQueueDelay samples
+    std::chrono::nanoseconds mFloodQueueDelay{0};
+
     friend class OverlayManagerTests;
     friend class Simulation;
 
@@ -157,10 +160,14 @@ class OverlayManagerImpl : public OverlayManager
     OverlayMetrics& getOverlayMetrics() override;
     PeerAuth& getPeerAuth() override;
 
+    void recordFloodQueueDelay(std::chrono::nanoseconds delay) override;
+    double getFloodCapacityGrantFraction() const override;
+
     PeerManager& getPeerManager() override;
 
     SurveyManager& getSurveyManager() override;
 
+    void listen() override;
     void start() override;
     void shutdown() override;
 
@@ -20,6 +20,8 @@ OverlayMetrics::OverlayMetrics(Application& app)
     , mByteRead(app.getMetrics().NewMeter({"overlay", "byte", "read"}, "byte"))
     , mByteWrite(
           app.getMetrics().NewMeter({"overlay", "byte", "write"}, "byte"))
+    , mHmacVerifiedBytes(
+          app.getMetrics().NewMeter({"overlay", "hmac", "verify"}, "byte"))
     , mErrorRead(
           app.getMetrics().NewMeter({"overlay", "error", "read"}, "error"))
     , mErrorWrite(
@@ -37,6 +39,10 @@ OverlayMetrics::OverlayMetrics(Application& app)
 
     , mItemFetcherNextPeer(app.getMetrics().NewMeter(
           {"overlay", "item-fetcher", "next-peer"}, "item-fetcher"))
+    , mItemFetcherHedge(app.getMetrics().NewMeter(
+          {"overlay", "item-fetcher", "hedge"}, "item-fetcher"))
+    , mItemFetcherAsks(
+          app.getMetrics().NewHistogram({"overlay", "item-fetcher", "asks"}))
 
     , mRecvErrorTimer(app.getMetrics().NewTimer({"overlay", "recv", "error"}))
     , mRecvHelloTimer(app.getMetrics().NewTimer({"overlay", "recv", "hello"}))
@@ -51,6 +57,8 @@ OverlayMetrics::OverlayMetrics(Application& app)
     , mRecvTxSetTimer(app.getMetrics().NewTimer({"overlay", "recv", "txset"}))
     , mRecvTransactionTimer(
           app.getMetrics().NewTimer({"overlay", "recv", "transaction"}))
+    , mRecvTransactionSigVerifyTimer(app.getMetrics().NewTimer(
+          {"overlay", "recv", "transaction-sig-verify"}))
     , mRecvGetSCPQuorumSetTimer(
           app.getMetrics().NewTimer({"overlay", "recv", "get-scp-qset"}))
     , mRecvSCPQuorumSetTimer(
@@ -182,6 +190,10 @@ OverlayMetrics::OverlayMetrics(Application& app)
           {"overlay", "fetch", "unique-recv"}, "byte"))
     , mDuplicateFetchBytesRecv(app.getMetrics().NewMeter(
           {"overlay", "fetch", "duplicate-recv"}, "byte"))
+    , mFloodQueueDelay(app.getMetrics().NewCounter(
+          {"overlay", "flow-control", "queue-delay-ms"}))
+    , mFloodCapacityWithheld(app.getMetrics().NewMeter(
+          {"overlay", "flow-control", "withheld"}, "message"))
 {
 }
 }
@@ -12,6 +12,7 @@ namespace medida
 class Timer;
 class Meter;
 class Counter;
+class Histogram;
 }
 
 namespace stellar
@@ -29,6 +30,7 @@ struct OverlayMetrics
     medida::Meter& mAsyncWrite;
     medida::Meter& mByteRead;
     medida::Meter& mByteWrite;
+    medida::Meter& mHmacVerifiedBytes;
     medida::Meter& mErrorRead;
     medida::Meter& mErrorWrite;
     medida::Meter& mTimeoutIdle;
@@ -38,6 +40,8 @@ struct OverlayMetrics
     medida::Timer& mConnectionFloodThrottle;
 
     medida::Meter& mItemFetcherNextPeer;
+    medida::Meter& mItemFetcherHedge;
+    medida::Histogram& mItemFetcherAsks;
 
     medida::Timer& mRecvErrorTimer;
     medida::Timer& mRecvHelloTimer;
@@ -48,6 +52,7 @@ struct OverlayMetrics
     medida::Timer& mRecvGetTxSetTimer;
     medida::Timer& mRecvTxSetTimer;
     medida::Timer& mRecvTransactionTimer;
+    medida::Timer& mRecvTransactionSigVerifyTimer;
     medida::Timer& mRecvGetSCPQuorumSetTimer;
     medida::Timer& mRecvSCPQuorumSetTimer;
     medida::Timer& mRecvSCPMessageTimer;
@@ -123,5 +128,8 @@ struct OverlayMetrics
     medida::Meter& mDuplicateFloodBytesRecv;
     medida::Meter& mUniqueFetchBytesRecv;
     medida::Meter& mDuplicateFetchBytesRecv;
+
+    medida::Counter& mFloodQueueDelay;
+    medida::Meter& mFloodCapacityWithheld;
 };
 }
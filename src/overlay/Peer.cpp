@@ -5,6 +5,7 @@
 #include "overlay/Peer.h"
 
 #include "BanManager.h"
+#include "bucket/BucketListSnapshot.h"
 #include "crypto/CryptoError.h"
 #include "crypto/Hex.h"
 #include "crypto/KeyUtils.h"
@@ -24,6 +25,8 @@
 #include "overlay/SurveyDataManager.h"
 #include "overlay/SurveyManager.h"
 #include "overlay/TxAdverts.h"
+#include "transactions/TransactionFrameBase.h"
+#include "transactions/TransactionUtils.h"
 #include "util/GlobalChecks.h"
 #include "util/Logging.h"
 #include "util/ProtocolVersion.h"
@@ -35,8 +38,12 @@
 #include <fmt/format.h>
 
 #include <Tracy.hpp>
+#include <algorithm>
+#include <cstring>
+#include <mutex>
 #include <soci.h>
 #include <time.h>
+#include <unordered_map>
 
 // LATER: need to add some way of docking peers that are misbehaving by sending
 // you bad data
@@ -51,7 +58,131 @@ using namespace soci;
 static constexpr VirtualClock::time_point PING_NOT_SENT =
     VirtualClock::time_point::min();
 
-Peer::Peer(Application& app, PeerRole role)
+namespace
+{
+// Encodings of the flooded messages being sent, so that a message broadcast
+// to all peers is only encoded once. Entries are keyed by the address of the
+// message and hold a weak reference to it, which keeps its control block from
+// being reused: an entry is only used as long as it refers to the very same
+// message. Entries of messages that are gone are swept once the cache has
+// doubled in size.
+class SharedEncodingCache
+{
+    struct Entry
+    {
+        std::weak_ptr<StellarMessage const> mMessage;
+        std::shared_ptr<xdr::opaque_vec<> const> mEncoded;
+    };
+
+    static constexpr size_t MIN_SWEEP_SIZE = 64;
+
+    std::mutex mMutex;
+    std::unordered_map<StellarMessage const*, Entry> mEntries;
+    size_t mSweepSize{MIN_SWEEP_SIZE};
+
+    static bool
+    refersTo(Entry const& entry,
+             std::shared_ptr<StellarMessage const> const& msg)
+    {
+        return !entry.mMessage.owner_before(msg) &&
+               !msg.owner_before(entry.mMessage);
+    }
+
+  public:
+    std::shared_ptr<xdr::opaque_vec<> const>
+    get(std::shared_ptr<StellarMessage const> const& msg)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            auto it = mEntries.find(msg.get());
+            if (it != mEntries.end() && refersTo(it->second, msg))
+            {
+                return it->second.mEncoded;
+            }
+        }
+
+        std::shared_ptr<xdr::opaque_vec<> const> encoded;
+        {
+            ZoneNamedN(xdrZone, "XDR serialize", true);
+            encoded = std::make_shared<xdr::opaque_vec<> const>(
+                xdr::xdr_to_opaque(*msg));
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto& entry = mEntries[msg.get()];
+        if (!entry.mEncoded || !refersTo(entry, msg))
+        {
+            entry.mMessage = msg;
+            entry.mEncoded = encoded;
+        }
+        if (mEntries.size() >= mSweepSize)
+        {
+            for (auto it = mEntries.begin(); it != mEntries.end();)
+            {
+                if (it->second.mMessage.expired())
+                {
+                    it = mEntries.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+            mSweepSize = std::max(MIN_SWEEP_SIZE, 2 * mEntries.size());
+        }
+        return entry.mEncoded;
+    }
+};
+
+SharedEncodingCache gSharedEncodings;
+
+void
+putUint32(uint8_t* out, uint32_t v)
+{
+    for (int i = 3; i >= 0; --i)
+    {
+        out[i] = static_cast<uint8_t>(v);
+        v >>= 8;
+    }
+}
+}
+
+Peer::SharedBodyMessage::SharedBodyMessage(
+    uint64_t sequence, std::shared_ptr<xdr::opaque_vec<> const> body,
+    HmacSha256Mac const& mac)
+    : mBody(std::move(body)), mMac(mac)
+{
+    releaseAssert(mBody);
+    // XDR of AuthenticatedMessage v0: the union discriminant and the sequence
+    // number precede the message and the MAC follows it
+    auto length = size() - 4;
+    releaseAssert(length < 0x80000000);
+    putUint32(mHeader.data(), static_cast<uint32_t>(length) | 0x80000000);
+    putUint32(mHeader.data() + 4, 0);
+    putUint32(mHeader.data() + 8, static_cast<uint32_t>(sequence >> 32));
+    putUint32(mHeader.data() + 12, static_cast<uint32_t>(sequence));
+}
+
+size_t
+Peer::SharedBodyMessage::size() const
+{
+    return mHeader.size() + mBody->size() + mMac.mac.size();
+}
+
+xdr::msg_ptr
+Peer::SharedBodyMessage::toMsg() const
+{
+    auto res = xdr::message_t::alloc(size() - 4);
+    auto out = res->data();
+    std::memcpy(out, mHeader.data() + 4, mHeader.size() - 4);
+    out += mHeader.size() - 4;
+    std::memcpy(out, mBody->data(), mBody->size());
+    out += mBody->size();
+    std::memcpy(out, mMac.mac.data(), mMac.mac.size());
+    return res;
+}
+
+Peer::Peer(Application& app, PeerRole role, size_t overlayThread)
     : mAppConnector(app)
     , mNetworkID(app.getNetworkID())
     , mFlowControl(
@@ -60,6 +191,7 @@ Peer::Peer(Application& app, PeerRole role)
     , mLastWrite(app.getClock().now())
     , mEnqueueTimeOfLastWrite(app.getClock().now())
     , mRole(role)
+    , mOverlayThread(overlayThread)
     , mOverlayMetrics(app.getOverlayManager().getOverlayMetrics())
     , mPeerMetrics(app.getClock().now())
     , mState(role == WE_CALLED_REMOTE ? CONNECTING : CONNECTED)
@@ -78,8 +210,8 @@ Peer::Peer(Application& app, PeerRole role)
 }
 
 Peer::MsgCapacityTracker::MsgCapacityTracker(std::weak_ptr<Peer> peer,
-                                             StellarMessage const& msg)
-    : mWeakPeer(peer), mMsg(msg)
+                                             StellarMessage&& msg)
+    : mWeakPeer(peer), mMsg(std::move(msg))
 {
     auto self = mWeakPeer.lock();
     if (!self)
@@ -460,7 +592,8 @@ Peer::maybeExecuteInBackground(std::string const& jobName,
     if (useBackgroundThread() && threadIsMain())
     {
         mAppConnector.postOnOverlayThread(
-            [self = shared_from_this(), f]() { f(self); }, jobName);
+            [self = shared_from_this(), f]() { f(self); }, jobName,
+            mOverlayThread);
     }
     else
     {
@@ -782,14 +915,10 @@ Peer::sendMessage(std::shared_ptr<StellarMessage const> msg, bool log)
     if (OverlayManager::isFloodMessage(*msg))
     {
         mFlowControl->addMsgAndMaybeTrimQueue(msg);
-        maybeExecuteInBackground(
-            "Peer::sendMessage maybeSendNextBatch",
-            [](std::shared_ptr<Peer> self) {
-                for (auto const& m : self->mFlowControl->getNextBatchToSend())
-                {
-                    self->sendAuthenticatedMessage(m);
-                }
-            });
+        maybeExecuteInBackground("Peer::sendMessage maybeSendNextBatch",
+                                 [](std::shared_ptr<Peer> self) {
+                                     self->sendNextFlowControlBatch();
+                                 });
     }
     else
     {
@@ -818,6 +947,15 @@ Peer::sendAuthenticatedMessage(std::shared_ptr<StellarMessage const> msg)
         // Construct an authenticated message and place it in the queue
         // _synchronously_ This is important because we assign auth sequence to
         // each message, which must be ordered
+        if (OverlayManager::isFloodMessage(*msg))
+        {
+            // Flooded messages usually go to many peers: share their encoding
+            auto body = gSharedEncodings.get(msg);
+            auto [seq, mac] = self->mHmac.authenticateEncodedMessage(*body);
+            self->sendSharedBodyMessage(
+                SharedBodyMessage(seq, std::move(body), mac));
+            return;
+        }
         AuthenticatedMessage amsg;
         self->mHmac.setAuthenticatedMessageBody(amsg, *msg);
         xdr::msg_ptr xdrBytes;
@@ -833,6 +971,33 @@ Peer::sendAuthenticatedMessage(std::shared_ptr<StellarMessage const> msg)
     maybeExecuteInBackground("sendAuthenticatedMessage", cb);
 }
 
+void
+Peer::sendNextFlowControlBatch()
+{
+    releaseAssert(mFlowControl);
+    // Messages handed to the transport are out of reach of flow control's
+    // priorities, as they must go out in the order they were authenticated.
+    // Keeping that backlog short lets SCP messages overtake queued floods.
+    uint64_t budget = UINT64_MAX;
+    auto limit = static_cast<size_t>(
+        mAppConnector.getConfig().PEER_FLOOD_WRITE_BACKLOG_BYTES);
+    if (limit != 0)
+    {
+        auto backlog = getWriteBacklogBytes();
+        budget = backlog < limit ? limit - backlog : 0;
+    }
+    for (auto const& m : mFlowControl->getNextBatchToSend(budget))
+    {
+        sendAuthenticatedMessage(m);
+    }
+}
+
+void
+Peer::sendSharedBodyMessage(SharedBodyMessage&& msg)
+{
+    sendMessage(msg.toMsg());
+}
+
 bool
 Peer::isConnected(RecursiveLockGuard const& stateGuard) const
 {
@@ -881,7 +1046,8 @@ Peer::shouldAbort(RecursiveLockGuard const& stateGuard) const
 }
 
 bool
-Peer::recvAuthenticatedMessage(AuthenticatedMessage&& msg)
+Peer::recvAuthenticatedMessage(AuthenticatedMessage&& msg,
+                               std::optional<ByteSlice> const& encoded)
 {
     ZoneScoped;
     releaseAssert(!threadIsMain() || !useBackgroundThread());
@@ -895,7 +1061,35 @@ Peer::recvAuthenticatedMessage(AuthenticatedMessage&& msg)
     std::string errorMsg;
     if (getState(guard) >= GOT_HELLO && msg.v0().message.type() != ERROR_MSG)
     {
-        if (!mHmac.checkAuthenticatedMessage(msg, errorMsg))
+        bool authenticated;
+        // XDR of AuthenticatedMessage v0: the union discriminant, then the
+        // sequence number and message the MAC covers, then the MAC itself
+        constexpr size_t prefixSize = 4;
+        size_t const macSize = msg.v0().mac.mac.size();
+        if (encoded && encoded->size() >= prefixSize + 8 + macSize &&
+            std::equal(msg.v0().mac.mac.begin(), msg.v0().mac.mac.end(),
+                       encoded->end() - macSize))
+        {
+            auto macInputSize = encoded->size() - prefixSize - macSize;
+            authenticated = mHmac.checkAuthenticatedMessage(
+                msg, ByteSlice(encoded->data() + prefixSize, macInputSize),
+                errorMsg);
+            if (authenticated)
+            {
+                mOverlayMetrics.mHmacVerifiedBytes.Mark(macInputSize);
+            }
+        }
+        else
+        {
+            // No received bytes or trailing data after the MAC
+            authenticated = mHmac.checkAuthenticatedMessage(msg, errorMsg);
+            if (authenticated)
+            {
+                mOverlayMetrics.mHmacVerifiedBytes.Mark(
+                    xdr::xdr_size(msg.v0().message) + 8);
+            }
+        }
+        if (!authenticated)
         {
             if (!threadIsMain())
             {
@@ -913,22 +1107,49 @@ Peer::recvAuthenticatedMessage(AuthenticatedMessage&& msg)
         }
     }
 
-    // Verify SCP signatures when in the background
+    // Verify SCP signatures when in the background, so that the main thread
+    // only has to look at the result
+    std::optional<bool> scpSignatureValid;
     if (useBackgroundThread() && msg.v0().message.type() == SCP_MESSAGE)
     {
         auto& envelope = msg.v0().message.envelope();
-        PubKeyUtils::verifySig(envelope.statement.nodeID, envelope.signature,
-                               xdr::xdr_to_opaque(mNetworkID, ENVELOPE_TYPE_SCP,
-                                                  envelope.statement));
+        scpSignatureValid = PubKeyUtils::verifySig(
+            envelope.statement.nodeID, envelope.signature,
+            xdr::xdr_to_opaque(mNetworkID, ENVELOPE_TYPE_SCP,
+                               envelope.statement));
+    }
+
+    // Likewise do the handshake crypto of a HELLO: verifying the remote auth
+    // cert and deriving the shared key. PeerAuth caches both, so recvHello
+    // on the main thread only looks them up.
+    if (useBackgroundThread() && msg.v0().message.type() == HELLO)
+    {
+        auto const& hello = msg.v0().message.hello();
+        auto& peerAuth = mAppConnector.getPeerAuth();
+        if (peerAuth.verifyRemoteAuthCert(hello.peerID, hello.cert))
+        {
+            peerAuth.getSharedKey(hello.cert.pubkey, mRole);
+        }
     }
 
-    // NOTE: Additionally, we may use state snapshots to verify TRANSACTION type
-    // messages in the background.
+    if (useBackgroundThread() &&
+        mAppConnector.getConfig().EXPERIMENTAL_BACKGROUND_TX_SIG_VERIFICATION &&
+        msg.v0().message.type() == TRANSACTION)
+    {
+        verifyTransactionSignatures(msg.v0().message.transaction(), guard);
+    }
 
     // Start tracking capacity here, so read throttling is applied
-    // appropriately. Flow control might not be started at that time
-    auto msgTracker = std::make_shared<MsgCapacityTracker>(shared_from_this(),
-                                                           msg.v0().message);
+    // appropriately. Flow control might not be started at that time. The
+    // decoded message is moved into the tracker rather than copied, so its
+    // payload (like a transaction envelope) is only allocated once on its
+    // way to the main thread; `msg` must not be used past this point.
+    auto msgTracker = std::make_shared<MsgCapacityTracker>(
+        shared_from_this(), std::move(msg.v0().message));
+    if (scpSignatureValid)
+    {
+        msgTracker->setSCPSignatureValid(*scpSignatureValid);
+    }
 
     std::string cat;
     Scheduler::ActionType type = Scheduler::ActionType::NORMAL_ACTION;
@@ -983,13 +1204,26 @@ Peer::recvAuthenticatedMessage(AuthenticatedMessage&& msg)
     // scheduler queue
     auto queueName = isAuthenticated(guard) ? cat : AUTH_ACTION_QUEUE;
     type = isAuthenticated(guard) ? type : Scheduler::ActionType::NORMAL_ACTION;
+    // The wait of transaction flood traffic for the main thread drives how
+    // much flood capacity is granted back to peers
+    std::optional<VirtualClock::time_point> floodEnqueueTime;
+    if (queueName == "TX")
+    {
+        floodEnqueueTime = mAppConnector.now();
+    }
     // Subtle: move `msgTracker` shared_ptr into the lambda, to ensure
     // its destructor is invoked from main thread only. Note that we can't use
     // unique_ptr here, because std::function requires its callable
     // to be copyable (C++23 fixes this with std::move_only_function, but we're
     // not there yet)
     mAppConnector.postOnMainThread(
-        [self = shared_from_this(), t = std::move(msgTracker)]() {
+        [self = shared_from_this(), t = std::move(msgTracker),
+         floodEnqueueTime]() {
+            if (floodEnqueueTime)
+            {
+                self->mAppConnector.getOverlayManager().recordFloodQueueDelay(
+                    self->mAppConnector.now() - *floodEnqueueTime);
+            }
             self->recvMessage(t);
         },
         std::move(queueName), type);
@@ -1031,7 +1265,7 @@ Peer::recvMessage(std::shared_ptr<MsgCapacityTracker> msgTracker)
 
     try
     {
-        recvRawMessage(stellarMsg);
+        recvRawMessage(stellarMsg, msgTracker->getSCPSignatureValid());
     }
     catch (CryptoError const& e)
     {
@@ -1052,16 +1286,13 @@ Peer::recvSendMore(StellarMessage const& msg)
     mFlowControl->maybeReleaseCapacity(msg);
     maybeExecuteInBackground("Peer::recvSendMore maybeSendNextBatch",
                              [](std::shared_ptr<Peer> self) {
-                                 for (auto const& m :
-                                      self->mFlowControl->getNextBatchToSend())
-                                 {
-                                     self->sendAuthenticatedMessage(m);
-                                 }
+                                 self->sendNextFlowControlBatch();
                              });
 }
 
 void
-Peer::recvRawMessage(StellarMessage const& stellarMsg)
+Peer::recvRawMessage(StellarMessage const& stellarMsg,
+                     std::optional<bool> scpSignatureValid)
 {
     ZoneScoped;
     releaseAssert(threadIsMain());
@@ -1215,7 +1446,7 @@ Peer::recvRawMessage(StellarMessage const& stellarMsg)
     case SCP_MESSAGE:
     {
         auto t = mOverlayMetrics.mRecvSCPMessageTimer.TimeScope();
-        recvSCPMessage(stellarMsg);
+        recvSCPMessage(stellarMsg, scpSignatureValid);
     }
     break;
 
@@ -1274,19 +1505,7 @@ Peer::recvGetTxSet(StellarMessage const& msg)
     auto self = shared_from_this();
     if (auto txSet = mAppConnector.getHerder().getTxSet(msg.txSetHash()))
     {
-        auto newMsg = std::make_shared<StellarMessage>();
-        if (txSet->isGeneralizedTxSet())
-        {
-            newMsg->type(GENERALIZED_TX_SET);
-            txSet->toXDR(newMsg->generalizedTxSet());
-        }
-        else
-        {
-            newMsg->type(TX_SET);
-            txSet->toXDR(newMsg->txSet());
-        }
-
-        self->sendMessage(newMsg);
+        self->sendMessage(txSet->getStellarMessage());
     }
     else
     {
@@ -1323,6 +1542,35 @@ Peer::recvGeneralizedTxSet(StellarMessage const& msg)
     mAppConnector.getHerder().recvTxSet(frame->getContentsHash(), frame);
 }
 
+void
+Peer::verifyTransactionSignatures(TransactionEnvelope const& envelope,
+                                  RecursiveLockGuard const& stateGuard)
+{
+    ZoneScoped;
+    if (!mTxSignersSnapshot)
+    {
+        mTxSignersSnapshot = mAppConnector.getSearchableBucketListSnapshot();
+    }
+
+    // Only warms up the signature cache: the snapshot may be behind the
+    // ledger, so the main thread still checks the transaction in full
+    auto tx = TransactionFrameBase::makeTransactionFromWire(mNetworkID,
+                                                            envelope);
+    std::vector<SignatureToVerify> sigs;
+    tx->insertSignaturesToVerify(
+        [&](AccountID const& accountID) {
+            auto le = mTxSignersSnapshot->getLedgerEntry(accountKey(accountID));
+            return le ? le->data.account().signers
+                      : xdr::xvector<Signer, MAX_SIGNERS>{};
+        },
+        sigs);
+    if (!sigs.empty())
+    {
+        auto timer = mOverlayMetrics.mRecvTransactionSigVerifyTimer.TimeScope();
+        PubKeyUtils::verifySigs(sigs);
+    }
+}
+
 void
 Peer::recvTransaction(StellarMessage const& msg)
 {
@@ -1423,7 +1671,8 @@ Peer::recvSCPQuorumSet(StellarMessage const& msg)
 }
 
 void
-Peer::recvSCPMessage(StellarMessage const& msg)
+Peer::recvSCPMessage(StellarMessage const& msg,
+                     std::optional<bool> scpSignatureValid)
 {
     ZoneScoped;
     releaseAssert(threadIsMain());
@@ -1463,7 +1712,10 @@ Peer::recvSCPMessage(StellarMessage const& msg)
     mAppConnector.getOverlayManager().recvFloodedMsgID(msg, shared_from_this(),
                                                        msgID);
 
-    auto res = mAppConnector.getHerder().recvSCPEnvelope(envelope);
+    auto res = scpSignatureValid
+                   ? mAppConnector.getHerder().recvSCPEnvelope(
+                         envelope, *scpSignatureValid)
+                   : mAppConnector.getHerder().recvSCPEnvelope(envelope);
     if (res == Herder::ENVELOPE_STATUS_DISCARDED)
     {
         // the message was discarded, remove it from the floodmap as well
@@ -15,6 +15,9 @@
 #include "util/Timer.h"
 #include "xdrpp/message.h"
 
+#include <array>
+#include <optional>
+
 namespace stellar
 {
 
@@ -38,6 +41,7 @@ class LoopbackPeer;
 struct OverlayMetrics;
 class FlowControl;
 class TxAdverts;
+class SearchableBucketListSnapshot;
 
 // Peer class represents a connected peer (either inbound or outbound)
 //
@@ -153,6 +157,26 @@ class Peer : public std::enable_shared_from_this<Peer>,
         std::atomic<uint64_t> mUnknownMessageUnfulfilled;
     };
 
+    // AuthenticatedMessage whose StellarMessage is encoded once and shared by
+    // every peer it is sent to. Only the framing, which carries the sequence
+    // number, and the MAC are specific to the connection.
+    struct SharedBodyMessage
+    {
+        // XDR record mark, AuthenticatedMessage version and sequence number
+        std::array<uint8_t, 16> mHeader;
+        std::shared_ptr<xdr::opaque_vec<> const> mBody;
+        HmacSha256Mac mMac;
+
+        SharedBodyMessage(uint64_t sequence,
+                          std::shared_ptr<xdr::opaque_vec<> const> body,
+                          HmacSha256Mac const& mac);
+
+        // Size on the wire, including the record mark
+        size_t size() const;
+        // Copy of the whole message in a single buffer
+        xdr::msg_ptr toMsg() const;
+    };
+
     struct TimestampedMessage
     {
         VirtualClock::time_point mEnqueuedTime;
@@ -161,6 +185,9 @@ class Peer : public std::enable_shared_from_this<Peer>,
         void recordWriteTiming(OverlayMetrics& metrics,
                                PeerMetrics& peerMetrics);
         xdr::msg_ptr mMessage;
+        // Set instead of mMessage by transports that write the parts of a
+        // SharedBodyMessage without copying them
+        std::optional<SharedBodyMessage> mSharedBodyMessage;
     };
 
     // NB: all Peer's protected state should have some synchronization
@@ -174,10 +201,23 @@ class Peer : public std::enable_shared_from_this<Peer>,
     {
         std::weak_ptr<Peer> const mWeakPeer;
         StellarMessage const mMsg;
+        // Result of verifying the signature of an SCP envelope in the
+        // background, if that happened
+        std::optional<bool> mSCPSignatureValid;
 
       public:
-        MsgCapacityTracker(std::weak_ptr<Peer> peer, StellarMessage const& msg);
+        MsgCapacityTracker(std::weak_ptr<Peer> peer, StellarMessage&& msg);
         StellarMessage const& getMessage();
+        void
+        setSCPSignatureValid(bool valid)
+        {
+            mSCPSignatureValid = valid;
+        }
+        std::optional<bool>
+        getSCPSignatureValid() const
+        {
+            return mSCPSignatureValid;
+        }
         ~MsgCapacityTracker();
     };
 
@@ -190,6 +230,8 @@ class Peer : public std::enable_shared_from_this<Peer>,
     std::atomic<VirtualClock::time_point> mEnqueueTimeOfLastWrite;
 
     PeerRole const mRole;
+    // Index of the overlay thread this peer's background processing runs on
+    size_t const mOverlayThread;
     OverlayMetrics& mOverlayMetrics;
     PeerMetrics mPeerMetrics;
 
@@ -202,6 +244,9 @@ class Peer : public std::enable_shared_from_this<Peer>,
 #endif
 
     Hmac mHmac;
+    // Used to look up signers of flooded transactions off the main thread,
+    // created on first use. Protected by mStateMutex.
+    std::shared_ptr<SearchableBucketListSnapshot> mTxSignersSnapshot;
     // Does local node have capacity to read from this peer
     bool canRead() const;
     // helper method to acknowledge that some bytes were received
@@ -229,7 +274,11 @@ class Peer : public std::enable_shared_from_this<Peer>,
         return mState;
     }
 
-    bool recvAuthenticatedMessage(AuthenticatedMessage&& msg);
+    // encoded is the XDR msg was decoded from, if the transport has it: the
+    // MAC is then checked against it instead of msg being encoded again
+    bool recvAuthenticatedMessage(
+        AuthenticatedMessage&& msg,
+        std::optional<ByteSlice> const& encoded = std::nullopt);
     // These exist mostly to be overridden in TCPPeer and callable via
     // shared_ptr<Peer> as a captured shared_from_this().
     virtual void connectHandler(asio::error_code const& ec);
@@ -272,7 +321,9 @@ class Peer : public std::enable_shared_from_this<Peer>,
     VirtualClock::time_point mPingSentTime;
     std::chrono::milliseconds mLastPing;
 
-    void recvRawMessage(StellarMessage const& msg);
+    // scpSignatureValid: see recvSCPMessage
+    void recvRawMessage(StellarMessage const& msg,
+                        std::optional<bool> scpSignatureValid);
 
     virtual void recvError(StellarMessage const& msg);
     void updatePeerRecordAfterEcho();
@@ -292,9 +343,17 @@ class Peer : public std::enable_shared_from_this<Peer>,
     void recvTxSet(StellarMessage const& msg);
     void recvGeneralizedTxSet(StellarMessage const& msg);
     void recvTransaction(StellarMessage const& msg);
+    // Verifies the signatures of a flooded transaction against the signers
+    // in the latest BucketList snapshot, so that the results are already in
+    // the signature cache when the main thread checks the transaction
+    void verifyTransactionSignatures(TransactionEnvelope const& envelope,
+                                     RecursiveLockGuard const& stateGuard);
     void recvGetSCPQuorumSet(StellarMessage const& msg);
     void recvSCPQuorumSet(StellarMessage const& msg);
-    void recvSCPMessage(StellarMessage const& msg);
+    // scpSignatureValid is the result of verifying the envelope's signature
+    // on an overlay thread, if that was done
+    void recvSCPMessage(StellarMessage const& msg,
+                        std::optional<bool> scpSignatureValid);
     void recvGetSCPState(StellarMessage const& msg);
     void recvFloodAdvert(StellarMessage const& msg);
     void recvFloodDemand(StellarMessage const& msg);
@@ -316,6 +375,17 @@ class Peer : public std::enable_shared_from_this<Peer>,
     // messages somewhere else. The async write request will point _into_
     // this owned buffer. This is really the best we can do.
     virtual void sendMessage(xdr::msg_ptr&& xdrBytes) = 0;
+    // Transports that support scatter-gather writes override this to send
+    // msg without copying its shared body; by default it is copied into one
+    // buffer and passed to sendMessage above
+    virtual void sendSharedBodyMessage(SharedBodyMessage&& msg);
+    // Bytes of messages passed to sendMessage that the transport hasn't
+    // finished writing; called on the thread the peer writes from
+    virtual size_t
+    getWriteBacklogBytes()
+    {
+        return 0;
+    }
     virtual void scheduleRead() = 0;
     virtual void
     connected()
@@ -330,13 +400,16 @@ class Peer : public std::enable_shared_from_this<Peer>,
     std::chrono::seconds getIOTimeout() const;
 
     void sendAuthenticatedMessage(std::shared_ptr<StellarMessage const> msg);
+    // Sends what flow control lets through, holding back non-SCP messages
+    // while the write backlog exceeds PEER_FLOOD_WRITE_BACKLOG_BYTES
+    void sendNextFlowControlBatch();
     void beginMessageProcessing(StellarMessage const& msg);
     void endMessageProcessing(StellarMessage const& msg);
 
   public:
     /* The following functions must all be called from the main thread (they all
      * contain releaseAssert(threadIsMain())) */
-    Peer(Application& app, PeerRole role);
+    Peer(Application& app, PeerRole role, size_t overlayThread = 0);
 
     void cancelTimers();
 
@@ -3,6 +3,7 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "overlay/PeerAuth.h"
+#include "crypto/BLAKE2.h"
 #include "crypto/Curve25519.h"
 #include "crypto/Hex.h"
 #include "crypto/SHA.h"
@@ -39,6 +40,7 @@ PeerAuth::PeerAuth(Application& app)
     , mECDHPublicKey(curve25519DerivePublic(mECDHSecretKey))
     , mCert(makeAuthCert(app, mECDHPublicKey))
     , mSharedKeyCache(0xffff)
+    , mVerifiedCertCache(0xffff)
 {
 }
 
@@ -61,11 +63,26 @@ PeerAuth::verifyRemoteAuthCert(NodeID const& remoteNode, AuthCert const& cert)
                    cert.expiration, mApp.timeNow());
         return false;
     }
+
+    // The expiration is part of the key, so a cached cert was checked above
+    BLAKE2 hasher;
+    hasher.add(xdr::xdr_to_opaque(remoteNode, cert));
+    auto cacheKey = hasher.finish();
+    if (mVerifiedCertCache.exists(cacheKey))
+    {
+        return true;
+    }
+
     auto hash = sha256(xdr::xdr_to_opaque(
         mApp.getNetworkID(), ENVELOPE_TYPE_AUTH, cert.expiration, cert.pubkey));
 
     CLOG_DEBUG(Overlay, "PeerAuth verifying cert hash: {}", hexAbbrev(hash));
-    return PubKeyUtils::verifySig(remoteNode, cert.sig, hash);
+    if (!PubKeyUtils::verifySig(remoteNode, cert.sig, hash))
+    {
+        return false;
+    }
+    mVerifiedCertCache.put(cacheKey, true);
+    return true;
 }
 
 HmacSha256Key
@@ -73,10 +90,11 @@ PeerAuth::getSharedKey(Curve25519Public const& remotePublic,
                        Peer::PeerRole role)
 {
     auto key = PeerSharedKeyId{remotePublic, role};
-    if (mSharedKeyCache.exists(key))
+    if (auto cached = mSharedKeyCache.maybeGet(key))
     {
-        return mSharedKeyCache.get(key);
+        return *cached;
     }
+    // Two threads may both derive the same key, which is harmless
     auto value =
         curve25519DeriveSharedKey(mECDHSecretKey, mECDHPublicKey, remotePublic,
                                   role == Peer::WE_CALLED_REMOTE);
@@ -2,7 +2,7 @@
 
 #include "overlay/Peer.h"
 #include "overlay/PeerSharedKeyId.h"
-#include "util/RandomEvictionCache.h"
+#include "util/ConcurrentRandomEvictionCache.h"
 #include "xdr/Stellar-types.h"
 
 // Copyright 2015 Stellar Development Foundation and contributors. Licensed
@@ -23,22 +23,29 @@ class PeerAuth
     // HKDF_expand(K{us,them}, 0 || nonce_A || nonce_B) and
     // HKDF_expand(K{us,them}, 1 || nonce_B || nonce_A) for
     // use in a particular A-called-B p2p session.
+    //
+    // Everything but getAuthCert can be called from any thread, so that the
+    // overlay threads can do the handshake crypto of a HELLO before the main
+    // thread processes it; the main thread then finds the results cached.
 
     Application& mApp;
-    Curve25519Secret mECDHSecretKey;
-    Curve25519Public mECDHPublicKey;
+    Curve25519Secret const mECDHSecretKey;
+    Curve25519Public const mECDHPublicKey;
     AuthCert mCert;
 
-    RandomEvictionCache<PeerSharedKeyId, HmacSha256Key> mSharedKeyCache;
-
-    HmacSha256Key getSharedKey(Curve25519Public const& remotePublic,
-                               Peer::PeerRole role);
+    ConcurrentRandomEvictionCache<PeerSharedKeyId, HmacSha256Key, 4>
+        mSharedKeyCache;
+    // Remote certs that verified, by hash of the node ID and cert. An entry
+    // is only used until the cert expires.
+    ConcurrentRandomEvictionCache<Hash, bool, 4> mVerifiedCertCache;
 
   public:
     PeerAuth(Application& app);
 
     AuthCert getAuthCert();
     bool verifyRemoteAuthCert(NodeID const& remoteNode, AuthCert const& cert);
+    HmacSha256Key getSharedKey(Curve25519Public const& remotePublic,
+                               Peer::PeerRole role);
 
     HmacSha256Key getSendingMacKey(Curve25519Public const& remotePublic,
                                    uint256 const& localNonce,
@@ -24,11 +24,11 @@ PeerDoor::PeerDoor(Application& app)
 }
 
 void
-PeerDoor::start()
+PeerDoor::listen()
 {
     releaseAssert(threadIsMain());
 
-    if (!mApp.getConfig().RUN_STANDALONE)
+    if (!mApp.getConfig().RUN_STANDALONE && !mAcceptor.is_open())
     {
         tcp::endpoint endpoint(tcp::v4(), mApp.getConfig().PEER_PORT);
         CLOG_INFO(Overlay, "Binding to endpoint {}:{}",
@@ -37,6 +37,17 @@ PeerDoor::start()
         mAcceptor.set_option(asio::ip::tcp::acceptor::reuse_address(true));
         mAcceptor.bind(endpoint);
         mAcceptor.listen(LISTEN_QUEUE_LIMIT);
+    }
+}
+
+void
+PeerDoor::start()
+{
+    releaseAssert(threadIsMain());
+
+    if (!mApp.getConfig().RUN_STANDALONE)
+    {
+        listen();
         acceptNextPeer();
     }
 }
@@ -65,28 +76,31 @@ PeerDoor::acceptNextPeer()
     // io_context on main (as long as the socket is not accessed by multiple
     // threads simultaneously, or the caller manually synchronizes access to the
     // socket).
+    auto overlayThread = mApp.pickOverlayThread();
     auto& ioContext =
         mApp.getConfig().EXPERIMENTAL_BACKGROUND_OVERLAY_PROCESSING
-            ? mApp.getOverlayIOContext()
+            ? mApp.getOverlayIOContext(overlayThread)
             : mApp.getClock().getIOContext();
     auto sock = make_shared<TCPPeer::SocketType>(ioContext, TCPPeer::BUFSZ);
-    mAcceptor.async_accept(sock->next_layer(),
-                           [this, sock](asio::error_code const& ec) {
-                               releaseAssert(threadIsMain());
-                               if (ec)
-                                   this->acceptNextPeer();
-                               else
-                                   this->handleKnock(sock);
-                           });
+    mAcceptor.async_accept(
+        sock->next_layer(),
+        [this, sock, overlayThread](asio::error_code const& ec) {
+            releaseAssert(threadIsMain());
+            if (ec)
+                this->acceptNextPeer();
+            else
+                this->handleKnock(sock, overlayThread);
+        });
 }
 
 void
-PeerDoor::handleKnock(shared_ptr<TCPPeer::SocketType> socket)
+PeerDoor::handleKnock(shared_ptr<TCPPeer::SocketType> socket,
+                      size_t overlayThread)
 {
     releaseAssert(threadIsMain());
 
     CLOG_DEBUG(Overlay, "PeerDoor handleKnock()");
-    Peer::pointer peer = TCPPeer::accept(mApp, socket);
+    Peer::pointer peer = TCPPeer::accept(mApp, socket, overlayThread);
 
     // Still call addInboundConnection to update metrics
     mApp.getOverlayManager().maybeAddInboundConnection(peer);
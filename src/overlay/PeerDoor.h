@@ -27,7 +27,8 @@ class PeerDoor
     asio::ip::tcp::acceptor mAcceptor;
 
     virtual void acceptNextPeer();
-    virtual void handleKnock(std::shared_ptr<TCPPeer::SocketType> pSocket);
+    virtual void handleKnock(std::shared_ptr<TCPPeer::SocketType> pSocket,
+                             size_t overlayThread);
 
     friend PeerDoorStub;
 
@@ -36,6 +37,11 @@ class PeerDoor
 
     PeerDoor(Application&);
 
+    // Binds and listens on PEER_PORT without accepting yet, so that peers
+    // connecting before start() wait in the listen queue instead of being
+    // refused. Does nothing if already listening, or in standalone mode.
+    void listen();
+    // Listens, if not yet, and starts accepting peers
     void start();
     void close();
 };
@@ -85,9 +85,31 @@ PeerManager::PeerManager(Application& app)
           *this, RandomPeerSource::maxFailures(MAX_FAILURES, true)))
     , mInboundPeersToSend(std::make_unique<RandomPeerSource>(
           *this, RandomPeerSource::maxFailures(MAX_FAILURES, false)))
+    , mSnapshotTimer(app)
 {
 }
 
+std::chrono::seconds const PeerManager::PEER_SNAPSHOT_INTERVAL{60};
+
+std::map<PeerBareAddress, PeerRecord>&
+PeerManager::getPeers()
+{
+    releaseAssert(threadIsMain());
+    if (!mPeersLoaded)
+    {
+        // Loaded on first use rather than on construction, as the database
+        // may not be set up yet when the overlay is created
+        for (auto& peer : loadAllPeersFromDatabase())
+        {
+            mPeers.emplace(peer);
+        }
+        mPeersLoaded = true;
+        CLOG_DEBUG(Overlay, "Loaded {} peers from the database",
+                   mPeers.size());
+    }
+    return mPeers;
+}
+
 std::vector<PeerBareAddress>
 PeerManager::loadRandomPeers(PeerQuery const& query, size_t size)
 {
@@ -95,72 +117,39 @@ PeerManager::loadRandomPeers(PeerQuery const& query, size_t size)
     // BATCH_SIZE should always be bigger, so it should win anyway
     size = std::max(size, BATCH_SIZE);
 
-    // if we ever start removing peers from db, we may need to enable this
-    // soci::transaction sqltx(mApp.getDatabase().getSession());
-    // mApp.getDatabase().setCurrentTransactionReadOnly();
-
-    std::vector<std::string> conditions;
-    if (query.mUseNextAttempt)
-    {
-        conditions.push_back("nextattempt <= :nextattempt");
-    }
-    if (query.mMaxNumFailures.has_value())
-    {
-        conditions.push_back("numfailures <= :maxFailures");
-    }
-    if (query.mTypeFilter == PeerTypeFilter::ANY_OUTBOUND)
-    {
-        conditions.push_back("type != :inboundType");
-    }
-    else
-    {
-        conditions.push_back("type = :type");
-    }
-    releaseAssert(!conditions.empty());
-    std::string where = conditions[0];
-    for (size_t i = 1; i < conditions.size(); i++)
-    {
-        where += " AND " + conditions[i];
-    }
-
-    std::tm nextAttempt =
-        VirtualClock::systemPointToTm(mApp.getClock().system_now());
-    size_t maxNumFailures{0};
-    int exactType = static_cast<int>(query.mTypeFilter);
-    int inboundType = static_cast<int>(PeerType::INBOUND);
-
-    auto bindToStatement = [&](soci::statement& st) {
-        if (query.mUseNextAttempt)
+    auto now = mApp.getClock().system_now();
+    auto matches = [&](PeerRecord const& peer) {
+        if (query.mUseNextAttempt &&
+            VirtualClock::tmToSystemPoint(peer.mNextAttempt) > now)
         {
-            st.exchange(soci::use(nextAttempt));
+            return false;
         }
-        if (query.mMaxNumFailures.has_value())
+        if (query.mMaxNumFailures.has_value() &&
+            peer.mNumFailures > *query.mMaxNumFailures)
         {
-            maxNumFailures = *query.mMaxNumFailures;
-            st.exchange(soci::use(maxNumFailures));
+            return false;
         }
         if (query.mTypeFilter == PeerTypeFilter::ANY_OUTBOUND)
         {
-            st.exchange(soci::use(inboundType));
-        }
-        else
-        {
-            st.exchange(soci::use(exactType));
+            return peer.mType != static_cast<int>(PeerType::INBOUND);
         }
+        return peer.mType == static_cast<int>(query.mTypeFilter);
     };
 
     auto result = std::vector<PeerBareAddress>{};
-    size_t count = countPeers(where, bindToStatement);
-    if (count == 0)
+    for (auto const& [address, peer] : getPeers())
     {
-        return result;
+        if (matches(peer))
+        {
+            result.emplace_back(address);
+        }
     }
 
-    size_t maxOffset = count > size ? count - size : 0;
-    size_t offset = rand_uniform<size_t>(0, maxOffset);
-    result = loadPeers(size, offset, where, bindToStatement);
-
     stellar::shuffle(std::begin(result), std::end(result), gRandomEngine);
+    if (result.size() > size)
+    {
+        result.resize(size);
+    }
     return result;
 }
 
@@ -169,40 +158,24 @@ PeerManager::removePeersWithManyFailures(size_t minNumFailures,
                                          PeerBareAddress const* address)
 {
     ZoneScoped;
-    releaseAssert(threadIsMain());
-    try
+    auto& peers = getPeers();
+    for (auto it = peers.begin(); it != peers.end();)
     {
-        auto& db = mApp.getDatabase();
-        auto sql = std::string{
-            "DELETE FROM peers WHERE numfailures >= :minNumFailures"};
-        if (address)
+        if (it->second.mNumFailures >= minNumFailures &&
+            (!address || it->first.getIP() == address->getIP()))
         {
-            sql += " AND ip = :ip";
+            mChanged.erase(it->first);
+            mRemoved.insert(it->first);
+            it = peers.erase(it);
         }
-
-        auto prep = db.getPreparedStatement(sql);
-        auto& st = prep.statement();
-
-        st.exchange(use(minNumFailures));
-
-        std::string ip;
-        if (address)
-        {
-            ip = address->getIP();
-            st.exchange(use(ip));
-        }
-        st.define_and_bind();
-
+        else
         {
-            auto timer = db.getDeleteTimer("peer");
-            st.execute(true);
+            ++it;
         }
     }
-    catch (soci_error& err)
+    if (!mRemoved.empty())
     {
-        CLOG_ERROR(Overlay,
-                   "PeerManager::removePeersWithManyFailures error: {}",
-                   err.what());
+        scheduleSnapshot();
     }
 }
 
@@ -230,43 +203,18 @@ std::pair<PeerRecord, bool>
 PeerManager::load(PeerBareAddress const& address)
 {
     ZoneScoped;
-    auto result = PeerRecord{};
-    auto inDatabase = false;
-
-    try
+    auto& peers = getPeers();
+    auto it = peers.find(address);
+    if (it != peers.end())
     {
-        auto prep = mApp.getDatabase().getPreparedStatement(
-            "SELECT numfailures, nextattempt, type FROM peers "
-            "WHERE ip = :v1 AND port = :v2");
-        auto& st = prep.statement();
-        st.exchange(into(result.mNumFailures));
-        st.exchange(into(result.mNextAttempt));
-        st.exchange(into(result.mType));
-        std::string ip = address.getIP();
-        st.exchange(use(ip));
-        int port = address.getPort();
-        st.exchange(use(port));
-        st.define_and_bind();
-        {
-            auto timer = mApp.getDatabase().getSelectTimer("peer");
-            st.execute(true);
-            inDatabase = st.got_data();
-
-            if (!inDatabase)
-            {
-                result.mNextAttempt =
-                    VirtualClock::systemPointToTm(mApp.getClock().system_now());
-                result.mType = static_cast<int>(PeerType::INBOUND);
-            }
-        }
-    }
-    catch (soci_error& err)
-    {
-        CLOG_ERROR(Overlay, "PeerManager::load error: {} on {}", err.what(),
-                   address.toString());
+        return std::make_pair(it->second, true);
     }
 
-    return std::make_pair(result, inDatabase);
+    auto result = PeerRecord{};
+    result.mNextAttempt =
+        VirtualClock::systemPointToTm(mApp.getClock().system_now());
+    result.mType = static_cast<int>(PeerType::INBOUND);
+    return std::make_pair(result, false);
 }
 
 void
@@ -274,53 +222,99 @@ PeerManager::store(PeerBareAddress const& address, PeerRecord const& peerRecord,
                    bool inDatabase)
 {
     ZoneScoped;
-    std::string query;
+    getPeers()[address] = peerRecord;
+    mRemoved.erase(address);
+    mChanged.insert(address);
+    scheduleSnapshot();
+}
 
-    if (inDatabase)
+void
+PeerManager::scheduleSnapshot()
+{
+    if (mSnapshotScheduled || mShuttingDown)
     {
-        query = "UPDATE peers SET "
-                "nextattempt = :v1, "
-                "numfailures = :v2, "
-                "type = :v3 "
-                "WHERE ip = :v4 AND port = :v5";
+        return;
     }
-    else
+    mSnapshotScheduled = true;
+    mSnapshotTimer.expires_from_now(PEER_SNAPSHOT_INTERVAL);
+    mSnapshotTimer.async_wait([this]() { snapshot(); },
+                              VirtualTimer::onFailureNoop);
+}
+
+void
+PeerManager::snapshot()
+{
+    ZoneScoped;
+    releaseAssert(threadIsMain());
+    mSnapshotScheduled = false;
+    mSnapshotTimer.cancel();
+    if (mChanged.empty() && mRemoved.empty())
     {
-        query = "INSERT INTO peers "
-                "(nextattempt, numfailures, type, ip,  port) "
-                "VALUES "
-                "(:v1,         :v2,        :v3,  :v4, :v5)";
+        return;
     }
 
+    auto& db = mApp.getDatabase();
     try
     {
-        auto prep = mApp.getDatabase().getPreparedStatement(query);
-        auto& st = prep.statement();
-        st.exchange(use(peerRecord.mNextAttempt));
-        st.exchange(use(peerRecord.mNumFailures));
-        st.exchange(use(peerRecord.mType));
-        std::string ip = address.getIP();
-        st.exchange(use(ip));
-        int port = address.getPort();
-        st.exchange(use(port));
-        st.define_and_bind();
+        soci::transaction tx(db.getSession());
+        for (auto const& address : mRemoved)
         {
-            auto timer = mApp.getDatabase().getUpdateTimer("peer");
+            auto prep = db.getPreparedStatement(
+                "DELETE FROM peers WHERE ip = :v1 AND port = :v2");
+            auto& st = prep.statement();
+            std::string ip = address.getIP();
+            st.exchange(use(ip));
+            int port = address.getPort();
+            st.exchange(use(port));
+            st.define_and_bind();
+            auto timer = db.getDeleteTimer("peer");
+            st.execute(true);
+        }
+        for (auto const& address : mChanged)
+        {
+            auto const& peerRecord = mPeers.at(address);
+            auto prep = db.getPreparedStatement(
+                "INSERT INTO peers "
+                "(nextattempt, numfailures, type, ip,  port) "
+                "VALUES "
+                "(:v1,         :v2,        :v3,  :v4, :v5) "
+                "ON CONFLICT (ip, port) DO UPDATE SET "
+                "nextattempt = excluded.nextattempt, "
+                "numfailures = excluded.numfailures, "
+                "type = excluded.type");
+            auto& st = prep.statement();
+            st.exchange(use(peerRecord.mNextAttempt));
+            st.exchange(use(peerRecord.mNumFailures));
+            st.exchange(use(peerRecord.mType));
+            std::string ip = address.getIP();
+            st.exchange(use(ip));
+            int port = address.getPort();
+            st.exchange(use(port));
+            st.define_and_bind();
+            auto timer = db.getUpsertTimer("peer");
             st.execute(true);
-            if (st.get_affected_rows() != 1)
-            {
-                CLOG_ERROR(Overlay, "PeerManager::store failed on {}",
-                           address.toString());
-            }
         }
+        tx.commit();
+        CLOG_DEBUG(Overlay, "Snapshotted {} changed and {} removed peers",
+                   mChanged.size(), mRemoved.size());
+        mChanged.clear();
+        mRemoved.clear();
     }
     catch (soci_error& err)
     {
-        CLOG_ERROR(Overlay, "PeerManager::store error: {} on {}", err.what(),
-                   address.toString());
+        // Changes are kept, to be written by the next snapshot
+        CLOG_ERROR(Overlay, "PeerManager::snapshot error: {}", err.what());
+        scheduleSnapshot();
     }
 }
 
+void
+PeerManager::shutdown()
+{
+    mShuttingDown = true;
+    snapshot();
+}
+
 void
 PeerManager::update(PeerRecord& peer, TypeUpdate type)
 {
@@ -492,81 +486,6 @@ PeerManager::update(PeerBareAddress const& address, PeerType observedType,
     store(address, peer.first, peer.second);
 }
 
-size_t
-PeerManager::countPeers(std::string const& where,
-                        std::function<void(soci::statement&)> const& bind)
-{
-    ZoneScoped;
-    size_t count = 0;
-
-    try
-    {
-        std::string sql = "SELECT COUNT(*) FROM peers WHERE " + where;
-
-        auto prep = mApp.getDatabase().getPreparedStatement(sql);
-        auto& st = prep.statement();
-
-        bind(st);
-        st.exchange(into(count));
-
-        st.define_and_bind();
-        st.execute(true);
-    }
-    catch (soci_error& err)
-    {
-        CLOG_ERROR(Overlay, "countPeers error: {}", err.what());
-    }
-
-    return count;
-}
-
-std::vector<PeerBareAddress>
-PeerManager::loadPeers(size_t limit, size_t offset, std::string const& where,
-                       std::function<void(soci::statement&)> const& bind)
-{
-    ZoneScoped;
-    auto result = std::vector<PeerBareAddress>{};
-
-    try
-    {
-        std::string sql = "SELECT ip, port "
-                          "FROM peers WHERE " +
-                          where + " LIMIT :limit OFFSET :offset";
-
-        auto prep = mApp.getDatabase().getPreparedStatement(sql);
-        auto& st = prep.statement();
-
-        bind(st);
-        st.exchange(use(limit));
-        st.exchange(use(offset));
-
-        std::string ip;
-        int lport;
-        st.exchange(into(ip));
-        st.exchange(into(lport));
-
-        st.define_and_bind();
-        {
-            auto timer = mApp.getDatabase().getSelectTimer("peer");
-            st.execute(true);
-        }
-        while (st.got_data())
-        {
-            if (!ip.empty() && lport > 0)
-            {
-                result.emplace_back(ip, static_cast<unsigned short>(lport));
-            }
-            st.fetch();
-        }
-    }
-    catch (soci_error& err)
-    {
-        CLOG_ERROR(Overlay, "loadPeers error: {}", err.what());
-    }
-
-    return result;
-}
-
 void
 PeerManager::dropAll(Database& db)
 {
@@ -576,6 +495,14 @@ PeerManager::dropAll(Database& db)
 
 std::vector<std::pair<PeerBareAddress, PeerRecord>>
 PeerManager::loadAllPeers()
+{
+    ZoneScoped;
+    auto const& peers = getPeers();
+    return {peers.begin(), peers.end()};
+}
+
+std::vector<std::pair<PeerBareAddress, PeerRecord>>
+PeerManager::loadAllPeersFromDatabase()
 {
     ZoneScoped;
     std::vector<std::pair<PeerBareAddress, PeerRecord>> result;
@@ -621,12 +548,10 @@ void
 PeerManager::storePeers(
     std::vector<std::pair<PeerBareAddress, PeerRecord>> peers)
 {
-    soci::transaction tx(mApp.getDatabase().getSession());
     for (auto const& peer : peers)
     {
         store(peer.first, peer.second, /* inDatabase */ false);
     }
-    tx.commit();
 }
 
 const char* PeerManager::kSQLCreateStatement =
@@ -8,11 +8,8 @@
 #include "util/Timer.h"
 
 #include <functional>
-
-namespace soci
-{
-class statement;
-}
+#include <map>
+#include <set>
 
 namespace stellar
 {
@@ -57,7 +54,9 @@ struct PeerQuery
 PeerAddress toXdr(PeerBareAddress const& address);
 
 /**
- * Maintain list of know peers in database.
+ * Maintain list of known peers. Peers are kept in memory, loaded from the
+ * database's peers table on first use, and changes are written back to it
+ * as a periodic snapshot, so that connection management does no SQL.
  */
 class PeerManager
 {
@@ -107,21 +106,21 @@ class PeerManager
                 bool preferredTypeKnown, BackOffUpdate backOff);
 
     /**
-     * Load PeerRecord data for peer with given address. If not available in
-     * database, create default one. Second value in pair is true when data
-     * was loaded from database, false otherwise.
+     * Load PeerRecord data for peer with given address. If not known, create
+     * default one. Second value in pair is true when the peer was known,
+     * false otherwise.
      */
     std::pair<PeerRecord, bool> load(PeerBareAddress const& address);
 
     /**
-     * Store PeerRecord data into database. If inDatabase is true, uses UPDATE
-     * query, uses INSERT otherwise.
+     * Store PeerRecord data, to be written to the database by the next
+     * snapshot. inDatabase is the second value load returned for the peer.
      */
     void store(PeerBareAddress const& address, PeerRecord const& PeerRecord,
                bool inDatabase);
 
     /**
-     * Load size random peers matching query from database.
+     * Load size random peers matching query.
      */
     std::vector<PeerBareAddress> loadRandomPeers(PeerQuery const& query,
                                                  size_t size);
@@ -140,15 +139,27 @@ class PeerManager
                                                 PeerBareAddress const& address);
 
     /**
-     * Load all peers from the database.
+     * Load all peers.
      */
     std::vector<std::pair<PeerBareAddress, PeerRecord>> loadAllPeers();
 
     /**
-     * Store peers in the database.
+     * Store peers, writing all of them to the database with the next
+     * snapshot.
      */
     void storePeers(std::vector<std::pair<PeerBareAddress, PeerRecord>>);
 
+    /**
+     * Write the peers stored or removed since the last snapshot to the
+     * database. Runs PEER_SNAPSHOT_INTERVAL after the first change following
+     * a snapshot, and on shutdown.
+     */
+    void snapshot();
+
+    void shutdown();
+
+    static std::chrono::seconds const PEER_SNAPSHOT_INTERVAL;
+
   private:
     static const char* kSQLCreateStatement;
 
@@ -156,11 +167,19 @@ class PeerManager
     std::unique_ptr<RandomPeerSource> mOutboundPeersToSend;
     std::unique_ptr<RandomPeerSource> mInboundPeersToSend;
 
-    size_t countPeers(std::string const& where,
-                      std::function<void(soci::statement&)> const& bind);
-    std::vector<PeerBareAddress>
-    loadPeers(size_t limit, size_t offset, std::string const& where,
-              std::function<void(soci::statement&)> const& bind);
+    std::map<PeerBareAddress, PeerRecord> mPeers;
+    bool mPeersLoaded{false};
+    // Peers to write and to delete with the next snapshot
+    std::set<PeerBareAddress> mChanged;
+    std::set<PeerBareAddress> mRemoved;
+    VirtualTimer mSnapshotTimer;
+    bool mSnapshotScheduled{false};
+    bool mShuttingDown{false};
+
+    std::map<PeerBareAddress, PeerRecord>& getPeers();
+    void scheduleSnapshot();
+    std::vector<std::pair<PeerBareAddress, PeerRecord>>
+    loadAllPeersFromDatabase();
 
     void update(PeerRecord& peer, TypeUpdate type);
     void update(PeerRecord& peer, BackOffUpdate backOff, Application& app);
@@ -8,7 +8,6 @@
 namespace stellar
 {
 
-using namespace soci;
 PeerQuery
 RandomPeerSource::maxFailures(size_t maxFailures, bool requireOutobund)
 {
@@ -18,6 +18,9 @@ namespace stellar
 {
 
 uint32_t const SurveyManager::SURVEY_THROTTLE_TIMEOUT_MULT(3);
+std::chrono::milliseconds const SurveyManager::SURVEY_WORK_BUDGET_PER_LEDGER(
+    200);
+uint32_t const SurveyManager::MAX_PENDING_SURVEY_WORK(64);
 
 uint32_t constexpr TIME_SLICED_SURVEY_MIN_OVERLAY_PROTOCOL_VERSION = 34;
 
@@ -94,7 +97,8 @@ SurveyManager::SurveyManager(Application& app)
           6) // ~30 seconds ahead of or behind the current ledger
     , MAX_REQUEST_LIMIT_PER_LEDGER(10)
     , mMessageLimiter(app, NUM_LEDGERS_BEFORE_IGNORE,
-                      MAX_REQUEST_LIMIT_PER_LEDGER)
+                      MAX_REQUEST_LIMIT_PER_LEDGER,
+                      SURVEY_WORK_BUDGET_PER_LEDGER, MAX_PENDING_SURVEY_WORK)
     , SURVEY_THROTTLE_TIMEOUT_SEC(
           mApp.getConfig().getExpectedLedgerCloseTime() *
           SURVEY_THROTTLE_TIMEOUT_MULT)
@@ -102,6 +106,9 @@ SurveyManager::SurveyManager(Application& app)
           [this]() { return mApp.getClock().now(); },
           mApp.getMetrics().NewMeter({"scp", "sync", "lost"}, "sync"),
           mApp.getConfig())
+    , mWorkDropped(
+          app.getMetrics().NewMeter({"overlay", "survey", "work-dropped"},
+                                    "message"))
 {
 }
 
@@ -472,47 +479,111 @@ SurveyManager::relayOrProcessResponse(StellarMessage const& msg,
         if (mRunningSurveyReportingPhaseType &&
             *mRunningSurveyReportingPhaseType == response.commandType)
         {
+            decryptAndProcessResponse(msg.type(), response);
+        }
+    }
+    else
+    {
+        // messageLimiter guarantees we only flood the response if we've
+        // seen the request
+        broadcast(msg);
+    }
+}
+
+void
+SurveyManager::decryptAndProcessResponse(MessageType msgType,
+                                         SurveyResponseMessage const& response)
+{
+    if (!mMessageLimiter.startWork())
+    {
+        CLOG_DEBUG(Overlay, "Dropping survey response from {}: over budget",
+                   mApp.getConfig().toShortString(response.surveyedPeerID));
+        mWorkDropped.Mark();
+        return;
+    }
+
+    // Decrypt on a background thread, then record the result on the main
+    // thread, unless the survey was restarted (with a new key) meanwhile
+    std::weak_ptr<SurveyManager> weak = shared_from_this();
+    auto& app = mApp;
+    auto secretKey = mCurve25519SecretKey;
+    auto publicKey = mCurve25519PublicKey;
+    auto surveyedPeerID = response.surveyedPeerID;
+    auto encryptedBody = response.encryptedBody;
+    app.postOnBackgroundThread(
+        [weak, &app, secretKey, publicKey, surveyedPeerID, encryptedBody,
+         msgType]() {
+            auto start = std::chrono::steady_clock::now();
+            std::optional<SurveyResponseBody> body;
+            std::string error;
             try
             {
-                xdr::opaque_vec<> opaqueDecrypted = curve25519Decrypt(
-                    mCurve25519SecretKey, mCurve25519PublicKey,
-                    response.encryptedBody);
-
-                SurveyResponseBody body;
-                xdr::xdr_from_opaque(opaqueDecrypted, body);
-                switch (msg.type())
-                {
-                case SURVEY_RESPONSE:
-                {
-                    processOldStyleTopologyResponse(response.surveyedPeerID,
-                                                    body);
-                }
-                break;
-                case TIME_SLICED_SURVEY_RESPONSE:
-                {
-                    processTimeSlicedTopologyResponse(response.surveyedPeerID,
-                                                      body);
-                }
-                break;
-                default:
-                    releaseAssert(false);
-                }
+                xdr::opaque_vec<> opaqueDecrypted =
+                    curve25519Decrypt(secretKey, publicKey, encryptedBody);
+                body.emplace();
+                xdr::xdr_from_opaque(opaqueDecrypted, *body);
             }
             catch (std::exception const& e)
             {
-                CLOG_ERROR(Overlay, "processing survey response failed: {}",
-                           e.what());
-
-                mBadResponseNodes.emplace(response.surveyedPeerID);
-                return;
+                body.reset();
+                error = e.what();
             }
+            auto elapsed = std::chrono::steady_clock::now() - start;
+
+            app.postOnMainThread(
+                [weak, publicKey, surveyedPeerID, msgType, body, error,
+                 elapsed]() {
+                    auto self = weak.lock();
+                    if (!self)
+                    {
+                        return;
+                    }
+                    self->mMessageLimiter.finishWork(elapsed);
+                    if (publicKey != self->mCurve25519PublicKey ||
+                        !self->mRunningSurveyReportingPhaseType)
+                    {
+                        return;
+                    }
+                    self->processDecryptedResponse(msgType, surveyedPeerID,
+                                                   body, error);
+                },
+                "SurveyManager: process response");
+        },
+        "SurveyManager: decrypt response", WorkerPriority::BULK);
+}
+
+void
+SurveyManager::processDecryptedResponse(
+    MessageType msgType, NodeID const& surveyedPeerID,
+    std::optional<SurveyResponseBody> const& body, std::string const& error)
+{
+    try
+    {
+        if (!body)
+        {
+            throw std::runtime_error(error);
+        }
+        switch (msgType)
+        {
+        case SURVEY_RESPONSE:
+        {
+            processOldStyleTopologyResponse(surveyedPeerID, *body);
+        }
+        break;
+        case TIME_SLICED_SURVEY_RESPONSE:
+        {
+            processTimeSlicedTopologyResponse(surveyedPeerID, *body);
+        }
+        break;
+        default:
+            releaseAssert(false);
         }
     }
-    else
+    catch (std::exception const& e)
     {
-        // messageLimiter guarantees we only flood the response if we've
-        // seen the request
-        broadcast(msg);
+        CLOG_ERROR(Overlay, "processing survey response failed: {}", e.what());
+
+        mBadResponseNodes.emplace(surveyedPeerID);
     }
 }
 
@@ -748,11 +819,12 @@ SurveyManager::processTimeSlicedTopologyResponse(NodeID const& surveyedPeerID,
 bool
 SurveyManager::populateSurveyResponseMessage(
     SurveyRequestMessage const& request, SurveyMessageCommandType type,
-    SurveyResponseBody const& body, SurveyResponseMessage& response) const
+    SurveyResponseBody const& body, NodeID const& self,
+    SurveyResponseMessage& response)
 {
     response.ledgerNum = request.ledgerNum;
     response.surveyorPeerID = request.surveyorPeerID;
-    response.surveyedPeerID = mApp.getConfig().NODE_SEED.getPublicKey();
+    response.surveyedPeerID = self;
     response.commandType = type;
 
     try
@@ -770,16 +842,11 @@ SurveyManager::populateSurveyResponseMessage(
 
 void
 SurveyManager::processOldStyleTopologyRequest(
-    SurveyRequestMessage const& request) const
+    SurveyRequestMessage const& request)
 {
     CLOG_TRACE(Overlay, "Responding to Topology request from {}",
                mApp.getConfig().toShortString(request.surveyorPeerID));
 
-    StellarMessage newMsg;
-    newMsg.type(SURVEY_RESPONSE);
-
-    auto& signedResponse = newMsg.signedSurveyResponseMessage();
-
     SurveyResponseBody body;
     body.type(SURVEY_TOPOLOGY_RESPONSE_V1);
 
@@ -805,17 +872,7 @@ SurveyManager::processOldStyleTopologyRequest(
     topologyBody.maxOutboundPeerCount =
         mApp.getConfig().TARGET_PEER_CONNECTIONS;
 
-    auto& response = signedResponse.response;
-    if (!populateSurveyResponseMessage(request, SURVEY_TOPOLOGY, body,
-                                       response))
-    {
-        return;
-    }
-
-    auto sigBody = xdr::xdr_to_opaque(response);
-    signedResponse.responseSignature = mApp.getConfig().NODE_SEED.sign(sigBody);
-
-    broadcast(newMsg);
+    sendSurveyResponse(request, std::nullopt, std::move(body));
 }
 
 void
@@ -840,24 +897,86 @@ SurveyManager::processTimeSlicedTopologyRequest(
         return;
     }
 
-    StellarMessage newMsg;
-    newMsg.type(TIME_SLICED_SURVEY_RESPONSE);
-    auto& signedResponse = newMsg.signedTimeSlicedSurveyResponseMessage();
-
-    auto& outerResponse = signedResponse.response;
-    outerResponse.nonce = request.nonce;
+    sendSurveyResponse(request.request, request.nonce, std::move(body));
+}
 
-    auto& innerResponse = outerResponse.response;
-    if (!populateSurveyResponseMessage(
-            request.request, TIME_SLICED_SURVEY_TOPOLOGY, body, innerResponse))
+void
+SurveyManager::sendSurveyResponse(SurveyRequestMessage const& request,
+                                  std::optional<uint32_t> nonce,
+                                  SurveyResponseBody&& body)
+{
+    if (!mMessageLimiter.startWork())
     {
+        CLOG_DEBUG(Overlay, "Dropping survey response to {}: over budget",
+                   mApp.getConfig().toShortString(request.surveyorPeerID));
+        mWorkDropped.Mark();
         return;
     }
 
-    auto sigBody = xdr::xdr_to_opaque(outerResponse);
-    signedResponse.responseSignature = mApp.getConfig().NODE_SEED.sign(sigBody);
-
-    broadcast(newMsg);
+    // Encrypt and sign on a background thread, then broadcast the response
+    // from the main thread
+    std::weak_ptr<SurveyManager> weak = shared_from_this();
+    auto& app = mApp;
+    app.postOnBackgroundThread(
+        [weak, &app, request, nonce, body = std::move(body)]() {
+            auto start = std::chrono::steady_clock::now();
+            auto const& seed = app.getConfig().NODE_SEED;
+            std::optional<StellarMessage> newMsg;
+            newMsg.emplace();
+            if (nonce)
+            {
+                newMsg->type(TIME_SLICED_SURVEY_RESPONSE);
+                auto& signedResponse =
+                    newMsg->signedTimeSlicedSurveyResponseMessage();
+                auto& outerResponse = signedResponse.response;
+                outerResponse.nonce = *nonce;
+                if (populateSurveyResponseMessage(
+                        request, TIME_SLICED_SURVEY_TOPOLOGY, body,
+                        seed.getPublicKey(), outerResponse.response))
+                {
+                    signedResponse.responseSignature =
+                        seed.sign(xdr::xdr_to_opaque(outerResponse));
+                }
+                else
+                {
+                    newMsg.reset();
+                }
+            }
+            else
+            {
+                newMsg->type(SURVEY_RESPONSE);
+                auto& signedResponse = newMsg->signedSurveyResponseMessage();
+                auto& response = signedResponse.response;
+                if (populateSurveyResponseMessage(request, SURVEY_TOPOLOGY,
+                                                  body, seed.getPublicKey(),
+                                                  response))
+                {
+                    signedResponse.responseSignature =
+                        seed.sign(xdr::xdr_to_opaque(response));
+                }
+                else
+                {
+                    newMsg.reset();
+                }
+            }
+            auto elapsed = std::chrono::steady_clock::now() - start;
+
+            app.postOnMainThread(
+                [weak, newMsg, elapsed]() {
+                    auto self = weak.lock();
+                    if (!self)
+                    {
+                        return;
+                    }
+                    self->mMessageLimiter.finishWork(elapsed);
+                    if (newMsg)
+                    {
+                        self->broadcast(*newMsg);
+                    }
+                },
+                "SurveyManager: send response");
+        },
+        "SurveyManager: encrypt response", WorkerPriority::BULK);
 }
 
 void
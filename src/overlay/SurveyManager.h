@@ -28,6 +28,12 @@ class SurveyManager : public std::enable_shared_from_this<SurveyManager>,
   public:
     static uint32_t const SURVEY_THROTTLE_TIMEOUT_MULT;
 
+    // Survey response encryption, decryption and signing run on a background
+    // thread, with at most this much of it per ledger and this many jobs in
+    // flight. Responses beyond that are dropped.
+    static std::chrono::milliseconds const SURVEY_WORK_BUDGET_PER_LEDGER;
+    static uint32_t const MAX_PENDING_SURVEY_WORK;
+
     SurveyManager(Application& app);
 
     // Start/stop survey reporting. Must be called before/after gathering data
@@ -93,19 +99,34 @@ class SurveyManager : public std::enable_shared_from_this<SurveyManager>,
     void sendTopologyRequest(NodeID const& nodeToSurvey);
     void processOldStyleTopologyResponse(NodeID const& surveyedPeerID,
                                          SurveyResponseBody const& body);
-    void
-    processOldStyleTopologyRequest(SurveyRequestMessage const& request) const;
+    void processOldStyleTopologyRequest(SurveyRequestMessage const& request);
     void processTimeSlicedTopologyResponse(NodeID const& surveyedPeerID,
                                            SurveyResponseBody const& body);
     void processTimeSlicedTopologyRequest(
         TimeSlicedSurveyRequestMessage const& request);
 
-    // Populate `response` with the data from the other parameters.  Returns
-    // `false` on encryption failure.
-    bool populateSurveyResponseMessage(SurveyRequestMessage const& request,
-                                       SurveyMessageCommandType type,
-                                       SurveyResponseBody const& body,
-                                       SurveyResponseMessage& response) const;
+    // Populate `response` with the data from the other parameters, `self`
+    // being this node's ID. Returns `false` on encryption failure. Safe to
+    // call from any thread.
+    static bool populateSurveyResponseMessage(
+        SurveyRequestMessage const& request, SurveyMessageCommandType type,
+        SurveyResponseBody const& body, NodeID const& self,
+        SurveyResponseMessage& response);
+
+    // Encrypt, sign and broadcast the response to `request` (a time sliced
+    // one if `nonce` is set) in the background, within the work budget
+    void sendSurveyResponse(SurveyRequestMessage const& request,
+                            std::optional<uint32_t> nonce,
+                            SurveyResponseBody&& body);
+
+    // Decrypt a response to our survey in the background, within the work
+    // budget, and record it (or the error decrypting it) in the results
+    void decryptAndProcessResponse(MessageType msgType,
+                                   SurveyResponseMessage const& response);
+    void processDecryptedResponse(MessageType msgType,
+                                  NodeID const& surveyedPeerID,
+                                  std::optional<SurveyResponseBody> const& body,
+                                  std::string const& error);
 
     // Populate `request` with the data from the other parameters
     void populateSurveyRequestMessage(NodeID const& nodeToSurvey,
@@ -179,5 +200,7 @@ class SurveyManager : public std::enable_shared_from_this<SurveyManager>,
 
     // Manager for time-sliced survey data
     SurveyDataManager mSurveyDataManager;
+
+    medida::Meter& mWorkDropped;
 };
 }
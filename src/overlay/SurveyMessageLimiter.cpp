@@ -6,15 +6,20 @@
 #include "herder/Herder.h"
 #include "main/Application.h"
 #include "overlay/SurveyDataManager.h"
+#include "util/GlobalChecks.h"
 
 namespace stellar
 {
 
 SurveyMessageLimiter::SurveyMessageLimiter(Application& app,
                                            uint32_t numLedgersBeforeIgnore,
-                                           uint32_t maxRequestLimit)
+                                           uint32_t maxRequestLimit,
+                                           std::chrono::milliseconds workBudget,
+                                           uint32_t maxPendingWork)
     : mNumLedgersBeforeIgnore(numLedgersBeforeIgnore)
     , mMaxRequestLimit(maxRequestLimit)
+    , mWorkBudgetPerLedger(workBudget)
+    , mMaxPendingWork(maxPendingWork)
     , mApp(app)
 {
 }
@@ -198,6 +203,9 @@ SurveyMessageLimiter::surveyLedgerNumValid(uint32_t ledgerNum)
 void
 SurveyMessageLimiter::clearOldLedgers(uint32_t lastClosedledgerSeq)
 {
+    // Called on every ledger close, which starts a new work budget
+    mWorkSpent = std::chrono::nanoseconds(0);
+
     for (auto it = mRecordMap.cbegin(); it != mRecordMap.cend();)
     {
         // clean up saved requests
@@ -211,4 +219,23 @@ SurveyMessageLimiter::clearOldLedgers(uint32_t lastClosedledgerSeq)
         }
     }
 }
-}
\ No newline at end of file
+
+bool
+SurveyMessageLimiter::startWork()
+{
+    if (mWorkSpent >= mWorkBudgetPerLedger || mPendingWork >= mMaxPendingWork)
+    {
+        return false;
+    }
+    ++mPendingWork;
+    return true;
+}
+
+void
+SurveyMessageLimiter::finishWork(std::chrono::nanoseconds elapsed)
+{
+    releaseAssert(mPendingWork > 0);
+    --mPendingWork;
+    mWorkSpent += elapsed;
+}
+}
@@ -7,6 +7,7 @@
 #include "overlay/StellarXDR.h" // IWYU pragma: keep
 #include "overlay/SurveyDataManager.h"
 #include "util/UnorderedMap.h"
+#include <chrono>
 #include <functional>
 #include <map>
 
@@ -22,13 +23,17 @@ predefined ledger range to maintain relevance.
   * It enforces a cap on the number of survey requests a node can handle (via
 `mMaxRequestLimit`)
   * It implements duplication checks for `Surveyor-Surveyed` pairs
+  * It bounds the background work (response encryption, decryption and
+signing) spent on surveys per ledger (via `mWorkBudgetPerLedger`)
 */
 
 class SurveyMessageLimiter
 {
   public:
     SurveyMessageLimiter(Application& app, uint32_t numLedgersBeforeIgnore,
-                         uint32_t maxRequestLimit);
+                         uint32_t maxRequestLimit,
+                         std::chrono::milliseconds workBudgetPerLedger,
+                         uint32_t maxPendingWork);
 
     // we pass in validation functions that are run if the rate limiter
     // determines the message is valid. We do this so signatures (an expensive
@@ -40,6 +45,12 @@ class SurveyMessageLimiter
                                    std::function<bool()> onSuccessValidation);
     void clearOldLedgers(uint32_t lastClosedledgerSeq);
 
+    // Returns `false`, and the work should be dropped, if this ledger's work
+    // budget is spent or too much work is still pending. Otherwise records
+    // the work as pending until `finishWork` is called with the time it took.
+    bool startWork();
+    void finishWork(std::chrono::nanoseconds elapsed);
+
     bool validateStartSurveyCollecting(
         TimeSlicedSurveyStartCollectingMessage const& startSurvey,
         SurveyDataManager& surveyDataManager,
@@ -66,6 +77,13 @@ class SurveyMessageLimiter
     // start rate limiting
     uint32_t const mMaxRequestLimit;
 
+    // Background survey work allowed between two ledger closes, and the
+    // number of jobs allowed in flight at once
+    std::chrono::nanoseconds const mWorkBudgetPerLedger;
+    uint32_t const mMaxPendingWork;
+    std::chrono::nanoseconds mWorkSpent{0};
+    uint32_t mPendingWork{0};
+
     Application& mApp;
 };
 }
@@ -15,6 +15,7 @@
 #include "util/GlobalChecks.h"
 #include "util/LogSlowExecution.h"
 #include "util/Logging.h"
+#include "util/MemoryArenas.h"
 #include "xdrpp/marshal.h"
 #include <Tracy.hpp>
 #include <fmt/format.h>
@@ -32,8 +33,8 @@ using namespace std;
 
 TCPPeer::TCPPeer(Application& app, Peer::PeerRole role,
                  std::shared_ptr<TCPPeer::SocketType> socket,
-                 std::string address)
-    : Peer(app, role)
+                 std::string address, size_t overlayThread)
+    : Peer(app, role, overlayThread)
     , mThreadVars(useBackgroundThread())
     , mSocket(socket)
     , mIPAddress(std::move(address))
@@ -47,6 +48,28 @@ TCPPeer::TCPPeer(Application& app, Peer::PeerRole role,
     }
 }
 
+void
+TCPPeer::setSocketOptions(SocketType& socket, Config const& cfg,
+                          asio::error_code& ec, asio::error_code& lingerEc)
+{
+    asio::ip::tcp::no_delay nodelay(true);
+    asio::ip::tcp::socket::linger linger(false, 0);
+    std::ignore = socket.next_layer().set_option(nodelay, ec);
+    std::ignore = socket.next_layer().set_option(linger, lingerEc);
+#ifdef TCP_NOTSENT_LOWAT
+    // Also bound the bytes waiting in the kernel's send buffer, so that the
+    // write backlog PEER_FLOOD_WRITE_BACKLOG_BYTES limits reflects what is
+    // ahead of a new message. Best effort: failing is harmless.
+    if (cfg.PEER_FLOOD_WRITE_BACKLOG_BYTES != 0)
+    {
+        asio::detail::socket_option::integer<IPPROTO_TCP, TCP_NOTSENT_LOWAT>
+            lowat(cfg.PEER_FLOOD_WRITE_BACKLOG_BYTES);
+        asio::error_code lowatEc;
+        std::ignore = socket.next_layer().set_option(lowat, lowatEc);
+    }
+#endif
+}
+
 TCPPeer::pointer
 TCPPeer::initiate(Application& app, PeerBareAddress const& address)
 {
@@ -54,12 +77,13 @@ TCPPeer::initiate(Application& app, PeerBareAddress const& address)
     releaseAssert(address.getType() == PeerBareAddress::Type::IPv4);
 
     CLOG_DEBUG(Overlay, "TCPPeer:initiate to {}", address.toString());
+    auto overlayThread = app.pickOverlayThread();
     auto& ioContext = app.getConfig().EXPERIMENTAL_BACKGROUND_OVERLAY_PROCESSING
-                          ? app.getOverlayIOContext()
+                          ? app.getOverlayIOContext(overlayThread)
                           : app.getClock().getIOContext();
     auto socket = make_shared<SocketType>(ioContext, BUFSZ);
-    auto result =
-        make_shared<TCPPeer>(app, WE_CALLED_REMOTE, socket, address.toString());
+    auto result = make_shared<TCPPeer>(app, WE_CALLED_REMOTE, socket,
+                                       address.toString(), overlayThread);
     result->initialize(address);
     asio::ip::tcp::endpoint endpoint(
         asio::ip::address::from_string(address.getIP()), address.getPort());
@@ -90,12 +114,9 @@ TCPPeer::initiate(Application& app, PeerBareAddress const& address)
             asio::error_code lingerEc;
             if (!error)
             {
-                asio::ip::tcp::no_delay nodelay(true);
-                asio::ip::tcp::socket::linger linger(false, 0);
-                std::ignore =
-                    result->mSocket->next_layer().set_option(nodelay, ec);
-                std::ignore =
-                    result->mSocket->next_layer().set_option(linger, lingerEc);
+                setSocketOptions(*result->mSocket,
+                                 result->mAppConnector.getConfig(), ec,
+                                 lingerEc);
             }
             else
             {
@@ -109,7 +130,8 @@ TCPPeer::initiate(Application& app, PeerBareAddress const& address)
 }
 
 TCPPeer::pointer
-TCPPeer::accept(Application& app, shared_ptr<TCPPeer::SocketType> socket)
+TCPPeer::accept(Application& app, shared_ptr<TCPPeer::SocketType> socket,
+                size_t overlayThread)
 {
     releaseAssert(threadIsMain());
 
@@ -153,15 +175,13 @@ TCPPeer::accept(Application& app, shared_ptr<TCPPeer::SocketType> socket)
     asio::error_code ec;
     asio::error_code lingerEc;
 
-    asio::ip::tcp::no_delay nodelay(true);
-    asio::ip::tcp::socket::linger linger(false, 0);
-    std::ignore = socket->next_layer().set_option(nodelay, ec);
-    std::ignore = socket->next_layer().set_option(linger, lingerEc);
+    setSocketOptions(*socket, app.getConfig(), ec, lingerEc);
 
     if (!ec && !lingerEc)
     {
         CLOG_DEBUG(Overlay, "TCPPeer:accept");
-        result = make_shared<TCPPeer>(app, REMOTE_CALLED_US, socket, ip);
+        result = make_shared<TCPPeer>(app, REMOTE_CALLED_US, socket, ip,
+                                      overlayThread);
         result->initialize(PeerBareAddress{ip, 0});
 
         // Use weak_ptr here in case the peer is dropped before main thread
@@ -177,7 +197,7 @@ TCPPeer::accept(Application& app, shared_ptr<TCPPeer::SocketType> socket)
                         result->startRead();
                     }
                 },
-                "TCPPeer::accept startRead");
+                "TCPPeer::accept startRead", overlayThread);
         }
         else
         {
@@ -230,6 +250,37 @@ TCPPeer::sendMessage(xdr::msg_ptr&& xdrBytes)
     TimestampedMessage msg;
     msg.mEnqueuedTime = mAppConnector.now();
     msg.mMessage = std::move(xdrBytes);
+    enqueueWrite(std::move(msg));
+}
+
+void
+TCPPeer::sendSharedBodyMessage(SharedBodyMessage&& sharedMsg)
+{
+    releaseAssert(!threadIsMain() || !useBackgroundThread());
+
+    TimestampedMessage msg;
+    msg.mEnqueuedTime = mAppConnector.now();
+    msg.mSharedBodyMessage.emplace(std::move(sharedMsg));
+    enqueueWrite(std::move(msg));
+}
+
+size_t
+TCPPeer::writeSize(TimestampedMessage const& msg)
+{
+    return msg.mSharedBodyMessage ? msg.mSharedBodyMessage->size()
+                                  : msg.mMessage->raw_size();
+}
+
+size_t
+TCPPeer::getWriteBacklogBytes()
+{
+    return mThreadVars.getWriteQueueBytes();
+}
+
+void
+TCPPeer::enqueueWrite(TimestampedMessage&& msg)
+{
+    mThreadVars.getWriteQueueBytes() += writeSize(msg);
     mThreadVars.getWriteQueue().emplace_back(std::move(msg));
 
     if (!mThreadVars.isWriting())
@@ -308,20 +359,37 @@ TCPPeer::messageSender()
     // covers the whole snapshot. We'll get called back when the batch is
     // completed, at which point we'll clear mWriteBuffers and remove the entire
     // snapshot worth of corresponding messages from mWriteQueue (though it may
-    // have grown a bit in the meantime -- we remove only a prefix).
+    // have grown a bit in the meantime -- we remove only a prefix). Messages
+    // with a shared body take three buffers: their header, the body they share
+    // with other peers and their MAC.
     releaseAssert(mThreadVars.getWriteBuffers().empty());
     auto now = mAppConnector.now();
     size_t expected_length = 0;
+    size_t messages = 0;
     size_t maxQueueSize = mAppConnector.getConfig().MAX_BATCH_WRITE_COUNT;
     releaseAssert(maxQueueSize > 0);
     size_t const maxTotalBytes =
         mAppConnector.getConfig().MAX_BATCH_WRITE_BYTES;
+    auto& buffers = mThreadVars.getWriteBuffers();
     for (auto& tsm : mThreadVars.getWriteQueue())
     {
         tsm.mIssuedTime = now;
-        size_t sz = tsm.mMessage->raw_size();
-        mThreadVars.getWriteBuffers().emplace_back(tsm.mMessage->raw_data(),
-                                                   sz);
+        size_t sz;
+        if (tsm.mSharedBodyMessage)
+        {
+            auto const& shared = *tsm.mSharedBodyMessage;
+            sz = shared.size();
+            buffers.emplace_back(shared.mHeader.data(), shared.mHeader.size());
+            buffers.emplace_back(shared.mBody->data(), shared.mBody->size());
+            buffers.emplace_back(shared.mMac.mac.data(),
+                                 shared.mMac.mac.size());
+        }
+        else
+        {
+            sz = tsm.mMessage->raw_size();
+            buffers.emplace_back(tsm.mMessage->raw_data(), sz);
+        }
+        ++messages;
         expected_length += sz;
         mEnqueueTimeOfLastWrite = tsm.mEnqueuedTime;
         // check if we reached any limit
@@ -332,15 +400,14 @@ TCPPeer::messageSender()
     }
 
     CLOG_DEBUG(Overlay, "messageSender {} - b:{} n:{}/{}", mIPAddress,
-               expected_length, mThreadVars.getWriteBuffers().size(),
-               mThreadVars.getWriteQueue().size());
+               expected_length, messages, mThreadVars.getWriteQueue().size());
     mOverlayMetrics.mAsyncWrite.Mark();
     mPeerMetrics.mAsyncWrite++;
     auto self = static_pointer_cast<TCPPeer>(shared_from_this());
     asio::async_write(
         *(mSocket.get()), mThreadVars.getWriteBuffers(),
-        [self, expected_length](asio::error_code const& ec,
-                                std::size_t length) {
+        [self, expected_length, messages](asio::error_code const& ec,
+                                          std::size_t length) {
             releaseAssert(!threadIsMain() || !self->useBackgroundThread());
             if (expected_length != length)
             {
@@ -348,8 +415,7 @@ TCPPeer::messageSender()
                            Peer::DropDirection::WE_DROPPED_REMOTE);
                 return;
             }
-            self->writeHandler(ec, length,
-                               self->mThreadVars.getWriteBuffers().size());
+            self->writeHandler(ec, length, messages);
 
             // Walk through a _prefix_ of the write queue
             // _corresponding_ to the write buffers we just sent.
@@ -359,22 +425,30 @@ TCPPeer::messageSender()
             // queue.
             auto now = self->mAppConnector.now();
             auto i = self->mThreadVars.getWriteQueue().begin();
-            while (!self->mThreadVars.getWriteBuffers().empty())
+            auto& queueBytes = self->mThreadVars.getWriteQueueBytes();
+            for (size_t n = 0; n < messages; ++n)
             {
                 i->mCompletedTime = now;
                 i->recordWriteTiming(self->mOverlayMetrics, self->mPeerMetrics);
+                queueBytes -= writeSize(*i);
                 ++i;
-                self->mThreadVars.getWriteBuffers().pop_back();
             }
+            self->mThreadVars.getWriteBuffers().clear();
 
             // Erase the messages from the write queue that we
             // just forgot about the buffers for.
             self->mThreadVars.getWriteQueue().erase(
                 self->mThreadVars.getWriteQueue().begin(), i);
 
-            // continue processing the queue
+            // continue processing the queue, topping it up with the flood
+            // messages held back while it was full
             if (!ec)
             {
+                if (self->mAppConnector.getConfig()
+                        .PEER_FLOOD_WRITE_BACKLOG_BYTES != 0)
+                {
+                    self->sendNextFlowControlBatch();
+                }
                 self->messageSender();
             }
         });
@@ -514,7 +588,7 @@ TCPPeer::scheduleRead()
 
     if (useBackgroundThread())
     {
-        mAppConnector.postOnOverlayThread(cb, taskName);
+        mAppConnector.postOnOverlayThread(cb, taskName, mOverlayThread);
     }
     else
     {
@@ -760,13 +834,15 @@ TCPPeer::recvMessage()
 
     try
     {
-        xdr::xdr_get g(mThreadVars.getIncomingBody().data(),
-                       mThreadVars.getIncomingBody().data() +
-                           mThreadVars.getIncomingBody().size());
+        auto const& body = mThreadVars.getIncomingBody();
+        xdr::xdr_get g(body.data(), body.data() + body.size());
         AuthenticatedMessage am;
-        xdr::xdr_argpack_archive(g, am);
+        {
+            MemoryArenaScope arenaScope(MemoryArena::PEER_DECODE);
+            xdr::xdr_argpack_archive(g, am);
+        }
 
-        valid = Peer::recvAuthenticatedMessage(std::move(am));
+        valid = Peer::recvAuthenticatedMessage(std::move(am), ByteSlice(body));
     }
     catch (xdr::xdr_runtime_error& e)
     {
@@ -16,6 +16,8 @@ class Meter;
 namespace stellar
 {
 
+class Config;
+
 static auto const MAX_UNAUTH_MESSAGE_SIZE = 0x1000;
 
 // Peer that communicates via a TCP socket.
@@ -32,6 +34,8 @@ class TCPPeer : public Peer
     {
         std::deque<TimestampedMessage> mWriteQueue;
         std::vector<asio::const_buffer> mWriteBuffers;
+        // Bytes of the messages in mWriteQueue
+        size_t mWriteQueueBytes{0};
         bool const mUseBackgroundThread;
         bool mWriting{false};
         std::vector<uint8_t> mIncomingHeader;
@@ -54,6 +58,12 @@ class TCPPeer : public Peer
             releaseAssert(!threadIsMain() || !mUseBackgroundThread);
             return mWriteBuffers;
         }
+        size_t&
+        getWriteQueueBytes()
+        {
+            releaseAssert(!threadIsMain() || !mUseBackgroundThread);
+            return mWriteQueueBytes;
+        }
         std::vector<uint8_t>&
         getIncomingHeader()
         {
@@ -90,6 +100,13 @@ class TCPPeer : public Peer
 
     bool recvMessage();
     void sendMessage(xdr::msg_ptr&& xdrBytes) override;
+    void sendSharedBodyMessage(SharedBodyMessage&& msg) override;
+    void enqueueWrite(TimestampedMessage&& msg);
+    size_t getWriteBacklogBytes() override;
+    static size_t writeSize(TimestampedMessage const& msg);
+    static void setSocketOptions(SocketType& socket, Config const& cfg,
+                                 asio::error_code& ec,
+                                 asio::error_code& lingerEc);
 
     void messageSender();
 
@@ -143,14 +160,16 @@ class TCPPeer : public Peer
     typedef std::shared_ptr<TCPPeer> pointer;
 
     TCPPeer(Application& app, Peer::PeerRole role,
-            std::shared_ptr<SocketType> socket,
-            std::string address); // hollow
-                                  // constructor; use
-                                  // `initiate` or
-                                  // `accept` instead
+            std::shared_ptr<SocketType> socket, std::string address,
+            size_t overlayThread); // hollow
+                                   // constructor; use
+                                   // `initiate` or
+                                   // `accept` instead
 
     static pointer initiate(Application& app, PeerBareAddress const& address);
-    static pointer accept(Application& app, std::shared_ptr<SocketType> socket);
+    // socket must use the io_context of overlayThread
+    static pointer accept(Application& app, std::shared_ptr<SocketType> socket,
+                          size_t overlayThread);
 
     virtual ~TCPPeer();
 
@@ -21,15 +21,20 @@ namespace stellar
 
 std::chrono::milliseconds const Tracker::MS_TO_WAIT_FOR_FETCH_REPLY{1500};
 int const Tracker::MAX_REBUILD_FETCH_LIST = 10;
+std::chrono::milliseconds const Tracker::MIN_HEDGE_DELAY{100};
+std::chrono::milliseconds const Tracker::MAX_HEDGE_DELAY{500};
+int const Tracker::HEDGE_PING_MULTIPLIER = 3;
 
 Tracker::Tracker(Application& app, Hash const& hash, AskPeer& askPeer)
     : mAskPeer(askPeer)
     , mApp(app)
     , mNumListRebuild(0)
     , mTimer(app)
+    , mHedgeTimer(app)
     , mItemHash(hash)
     , mTryNextPeer(
           app.getOverlayManager().getOverlayMetrics().mItemFetcherNextPeer)
+    , mHedge(app.getOverlayManager().getOverlayMetrics().mItemFetcherHedge)
     , mFetchTime("fetch-" + hexAbbrev(hash), LogSlowExecution::Mode::MANUAL)
 {
     releaseAssert(mAskPeer);
@@ -72,7 +77,9 @@ Tracker::clearEnvelopesBelow(uint64 slotIndex, uint64 slotToKeep)
     }
 
     mTimer.cancel();
+    mHedgeTimer.cancel();
     mLastAskedPeer = nullptr;
+    mHedgedPeer = nullptr;
 
     return false;
 }
@@ -80,28 +87,22 @@ Tracker::clearEnvelopesBelow(uint64 slotIndex, uint64 slotToKeep)
 void
 Tracker::doesntHave(Peer::pointer peer)
 {
-    if (mLastAskedPeer == peer)
+    if (mHedgedPeer && mHedgedPeer == peer)
+    {
+        // the hedged request to mLastAskedPeer is still pending
+        mHedgedPeer.reset();
+    }
+    else if (mLastAskedPeer == peer)
     {
         CLOG_TRACE(Overlay, "Does not have {}", hexAbbrev(mItemHash));
         tryNextPeer();
     }
 }
 
-void
-Tracker::tryNextPeer()
+Peer::pointer
+Tracker::pickPeer(bool& withEnvelope)
 {
     ZoneScoped;
-    // will be called by some timer or when we get a
-    // response saying they don't have it
-    CLOG_TRACE(Overlay, "tryNextPeer {} last: {}", hexAbbrev(mItemHash),
-               (mLastAskedPeer ? mLastAskedPeer->toString() : "<none>"));
-
-    if (mLastAskedPeer)
-    {
-        mTryNextPeer.Mark();
-        mLastAskedPeer.reset();
-    }
-
     // canAskPeer is best effort and send happens asynchronously; in the worst
     // case, we'll place something in the queue that will subsequently be
     // discarded due to a peer drop.
@@ -165,8 +166,8 @@ Tracker::tryNextPeer()
         }
     }
 
-    bool peerWithEnvelopeSelected = !newPeersWithEnvelope.empty();
-    if (peerWithEnvelopeSelected)
+    withEnvelope = !newPeersWithEnvelope.empty();
+    if (withEnvelope)
     {
         procPeers(newPeersWithEnvelope, true);
     }
@@ -180,13 +181,61 @@ Tracker::tryNextPeer()
     }
 
     // pick a random element from the candidate list
-    if (!candidates.empty())
+    if (candidates.empty())
     {
-        mLastAskedPeer = rand_element(candidates);
+        return nullptr;
     }
+    return rand_element(candidates);
+}
 
-    std::chrono::milliseconds nextTry;
-    if (!mLastAskedPeer)
+void
+Tracker::ask(Peer::pointer const& peer, bool peerHas)
+{
+    mLastAskedPeer = peer;
+    mPeersAsked[peer] = peerHas;
+    ++mNumAsks;
+    CLOG_TRACE(Overlay, "Asking for {} to {}", hexAbbrev(mItemHash),
+               peer->toString());
+    mAskPeer(peer, mItemHash);
+
+    mTimer.expires_from_now(MS_TO_WAIT_FOR_FETCH_REPLY);
+    mTimer.async_wait([this]() { this->tryNextPeer(); },
+                      VirtualTimer::onFailureNoop);
+}
+
+std::chrono::milliseconds
+Tracker::hedgeDelay(Peer const& peer)
+{
+    // pings start out as a very high value until measured, which puts the
+    // delay at its maximum
+    auto ping = peer.getPing();
+    if (ping >= MAX_HEDGE_DELAY / HEDGE_PING_MULTIPLIER)
+    {
+        return MAX_HEDGE_DELAY;
+    }
+    return std::max(MIN_HEDGE_DELAY, ping * HEDGE_PING_MULTIPLIER);
+}
+
+void
+Tracker::tryNextPeer()
+{
+    ZoneScoped;
+    // will be called by some timer or when we get a
+    // response saying they don't have it
+    CLOG_TRACE(Overlay, "tryNextPeer {} last: {}", hexAbbrev(mItemHash),
+               (mLastAskedPeer ? mLastAskedPeer->toString() : "<none>"));
+
+    if (mLastAskedPeer)
+    {
+        mTryNextPeer.Mark();
+        mLastAskedPeer.reset();
+    }
+    mHedgedPeer.reset();
+    mHedgeTimer.cancel();
+
+    bool peerHas = false;
+    auto peer = pickPeer(peerHas);
+    if (!peer)
     {
         // we have asked all our peers, reset the list and try again after a
         // pause
@@ -196,21 +245,42 @@ Tracker::tryNextPeer()
         CLOG_TRACE(Overlay, "tryNextPeer {} restarting fetch #{}",
                    hexAbbrev(mItemHash), mNumListRebuild);
 
-        nextTry = MS_TO_WAIT_FOR_FETCH_REPLY *
-                  std::min(MAX_REBUILD_FETCH_LIST, mNumListRebuild);
+        mTimer.expires_from_now(MS_TO_WAIT_FOR_FETCH_REPLY *
+                                std::min(MAX_REBUILD_FETCH_LIST,
+                                         mNumListRebuild));
+        mTimer.async_wait([this]() { this->tryNextPeer(); },
+                          VirtualTimer::onFailureNoop);
+        return;
+    }
+
+    ask(peer, peerHas);
+    mHedgeTimer.expires_from_now(hedgeDelay(*peer));
+    mHedgeTimer.async_wait([this]() { this->hedge(); },
+                           VirtualTimer::onFailureNoop);
+}
+
+void
+Tracker::hedge()
+{
+    ZoneScoped;
+    if (!mLastAskedPeer)
+    {
+        return;
     }
-    else
+
+    // if there is no one else to ask, keep waiting for the peer we asked
+    bool peerHas = false;
+    auto peer = pickPeer(peerHas);
+    if (!peer)
     {
-        mPeersAsked[mLastAskedPeer] = peerWithEnvelopeSelected;
-        CLOG_TRACE(Overlay, "Asking for {} to {}", hexAbbrev(mItemHash),
-                   mLastAskedPeer->toString());
-        mAskPeer(mLastAskedPeer, mItemHash);
-        nextTry = MS_TO_WAIT_FOR_FETCH_REPLY;
+        return;
     }
 
-    mTimer.expires_from_now(nextTry);
-    mTimer.async_wait([this]() { this->tryNextPeer(); },
-                      VirtualTimer::onFailureNoop);
+    CLOG_TRACE(Overlay, "Hedging fetch of {} from {}", hexAbbrev(mItemHash),
+               mLastAskedPeer->toString());
+    mHedge.Mark();
+    mHedgedPeer = mLastAskedPeer;
+    ask(peer, peerHas);
 }
 
 static std::function<bool(std::pair<Hash, SCPEnvelope> const&)>
@@ -262,6 +332,7 @@ void
 Tracker::cancel()
 {
     mTimer.cancel();
+    mHedgeTimer.cancel();
     mLastSeenSlotIndex = 0;
 }
 
@@ -12,6 +12,11 @@
  * with new set of peers (possibly overlapping, as peers may learned about
  * this data set in meantime).
  *
+ * A peer that doesn't answer keeps the data waiting for the whole
+ * MS_TO_WAIT_FOR_FETCH_REPLY, so if it hasn't answered after a few times its
+ * ping, the request is hedged: another peer is asked as well, and whichever
+ * sends the data first wins.
+ *
  * For asking a AskPeer delegate is used.
  *
  * Tracker keeps list of envelopes that requires given data set to be
@@ -43,20 +48,39 @@ class Tracker
     AskPeer mAskPeer;
     Application& mApp;
     Peer::pointer mLastAskedPeer;
+    // Peer asked before mLastAskedPeer that may still answer, when the
+    // request to mLastAskedPeer is a hedge
+    Peer::pointer mHedgedPeer;
     int mNumListRebuild;
     // keep track of which peer we asked, and if we thought if it had the data
     // or not at the time
     std::map<Peer::pointer, bool> mPeersAsked;
     VirtualTimer mTimer;
+    VirtualTimer mHedgeTimer;
     std::vector<std::pair<Hash, SCPEnvelope>> mWaitingEnvelopes;
     Hash mItemHash;
     medida::Meter& mTryNextPeer;
+    medida::Meter& mHedge;
     uint64 mLastSeenSlotIndex{0};
+    int mNumAsks{0};
     LogSlowExecution mFetchTime;
 
+    // Picks the peer to ask next, setting withEnvelope if it knows the
+    // envelopes waiting for the data; nullptr if every peer was asked already
+    Peer::pointer pickPeer(bool& withEnvelope);
+    void ask(Peer::pointer const& peer, bool peerHas);
+    void hedge();
+
   public:
     static std::chrono::milliseconds const MS_TO_WAIT_FOR_FETCH_REPLY;
     static int const MAX_REBUILD_FETCH_LIST;
+    // Bounds on the time to wait for a peer before hedging, which is
+    // otherwise HEDGE_PING_MULTIPLIER times its ping
+    static std::chrono::milliseconds const MIN_HEDGE_DELAY;
+    static std::chrono::milliseconds const MAX_HEDGE_DELAY;
+    static int const HEDGE_PING_MULTIPLIER;
+
+    static std::chrono::milliseconds hedgeDelay(Peer const& peer);
     /**
      * Create Tracker that tracks data identified by @p hash. @p askPeer
      * delegate is used to fetch the data.
@@ -138,6 +162,15 @@ class Tracker
      */
     void tryNextPeer();
 
+    /**
+     * Return number of requests sent for the data so far.
+     */
+    int
+    getNumAsks() const
+    {
+        return mNumAsks;
+    }
+
     /**
      * Return biggest slot index seen since last reset.
      */
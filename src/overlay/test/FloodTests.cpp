@@ -399,6 +399,31 @@ TEST_CASE("Flooding", "[flood][overlay][acceptance]")
                     5, 10, Simulation::OVER_TCP, networkID, cfgGen2);
                 test(injectTransaction, ackedTransactions, true);
             }
+            SECTION("relay adverts to two peers")
+            {
+                auto cfgGenFanout = [&](int n) {
+                    auto cfg = cfgGen2(n);
+                    cfg.FLOOD_ADVERT_RELAY_FANOUT = 2;
+                    return cfg;
+                };
+                simulation = Topologies::hierarchicalQuorumSimplified(
+                    5, 10, Simulation::OVER_LOOPBACK, networkID,
+                    cfgGenFanout);
+                test(injectTransaction, ackedTransactions, true);
+            }
+            SECTION("relay adverts to two peers preferring fast ones")
+            {
+                auto cfgGenFanout = [&](int n) {
+                    auto cfg = cfgGen2(n);
+                    cfg.FLOOD_ADVERT_RELAY_FANOUT = 2;
+                    cfg.FLOOD_ADVERT_RELAY_PREFER_FAST_PEERS = true;
+                    return cfg;
+                };
+                simulation = Topologies::hierarchicalQuorumSimplified(
+                    5, 10, Simulation::OVER_LOOPBACK, networkID,
+                    cfgGenFanout);
+                test(injectTransaction, ackedTransactions, true);
+            }
         }
     }
 
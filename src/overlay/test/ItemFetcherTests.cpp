@@ -259,8 +259,9 @@ TEST_CASE("ItemFetcher fetches", "[overlay][ItemFetcher]")
                 // itemFetcher asked the first peer
                 REQUIRE(asked.size() == 1);
 
-                // wait enough time that item fetcher should be asking the other
-                // peer (but not too long as we don't want to retry)
+                // wait enough time that item fetcher should have hedged its
+                // request to the other peer (but not so long that the first
+                // request timed out and we retry)
                 auto crankFor = [&](std::chrono::milliseconds t) {
                     auto timeout = clock.now() + t;
                     while (clock.now() < timeout)
@@ -270,9 +271,14 @@ TEST_CASE("ItemFetcher fetches", "[overlay][ItemFetcher]")
                     }
                 };
 
-                crankFor(Tracker::MS_TO_WAIT_FOR_FETCH_REPLY * 2);
+                auto& hedges = app->getMetrics().NewMeter(
+                    {"overlay", "item-fetcher", "hedge"}, "item-fetcher");
+                auto hedgeCount = hedges.count();
+                crankFor(Tracker::MS_TO_WAIT_FOR_FETCH_REPLY);
 
                 REQUIRE(asked.size() == 2);
+                REQUIRE(hedges.count() == hedgeCount + 1);
+                REQUIRE(askedTP[1] - askedTP[0] <= Tracker::MAX_HEDGE_DELAY);
 
                 itemFetcher.recv(zero, timer);
 
@@ -340,8 +346,10 @@ TEST_CASE("ItemFetcher fetches", "[overlay][ItemFetcher]")
                         }
                         else
                         {
-                            REQUIRE(delta >=
-                                    Tracker::MS_TO_WAIT_FOR_FETCH_REPLY);
+                            // the second peer is asked when the request to
+                            // the first one is hedged
+                            REQUIRE(delta >= Tracker::MIN_HEDGE_DELAY);
+                            REQUIRE(delta <= Tracker::MAX_HEDGE_DELAY);
                         }
                         if (i > 0)
                         {
@@ -165,6 +165,8 @@ class OverlayManagerTests
             pm.storeConfigPeers();
         }
 
+        // Peers reach the database with the next snapshot
+        pm.getPeerManager().snapshot();
         rowset<row> rs = app->getDatabase().getSession().prepare
                          << "SELECT ip,port,type FROM peers ORDER BY ip, port";
 
@@ -213,6 +215,8 @@ class OverlayManagerTests
         pm.mResolvedPeers.wait();
         pm.tick();
 
+        // Peers reach the database with the next snapshot
+        pm.getPeerManager().snapshot();
         rowset<row> rs = app->getDatabase().getSession().prepare
                          << "SELECT ip,port,type FROM peers ORDER BY ip, port";
 
@@ -0,0 +1,355 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+// Benchmarks of the overlay on its own: a stream of StellarMessages is
+// replayed from one node to another over a single connection, without
+// consensus or ledger close running. The stream is read from the XDR file
+// named by STELLAR_OVERLAY_REPLAY_FILE (StellarMessages written with
+// XDROutputFileStream) or generated if that is not set.
+
+#include "crypto/SHA.h"
+#include "crypto/SecretKey.h"
+#include "lib/catch.hpp"
+#include "main/Application.h"
+#include "main/Config.h"
+#include "overlay/Hmac.h"
+#include "overlay/OverlayManager.h"
+#include "overlay/OverlayMetrics.h"
+#include "overlay/PeerBareAddress.h"
+#include "overlay/test/LoopbackPeer.h"
+#include "simulation/Simulation.h"
+#include "test/TestUtils.h"
+#include "test/test.h"
+#include "transactions/SignatureUtils.h"
+#include "transactions/TransactionUtils.h"
+#include "util/Logging.h"
+#include "util/Math.h"
+#include "util/XDRStream.h"
+
+#include "medida/meter.h"
+#include "medida/timer.h"
+#include <xdrpp/marshal.h>
+
+#include <chrono>
+#include <cstdlib>
+
+using namespace stellar;
+
+namespace
+{
+
+namespace ch = std::chrono;
+
+TransactionEnvelope
+makeReplayTransaction(SecretKey const& source, Hash const& networkID)
+{
+    TransactionEnvelope env;
+    env.type(ENVELOPE_TYPE_TX);
+    auto& tx = env.v1().tx;
+    tx.sourceAccount = toMuxedAccount(source.getPublicKey());
+    tx.fee = 100;
+    tx.seqNum = rand_uniform<int64_t>(1, INT32_MAX);
+    Operation op;
+    op.body.type(PAYMENT);
+    op.body.paymentOp().destination =
+        toMuxedAccount(PubKeyUtils::pseudoRandomForTesting());
+    op.body.paymentOp().asset.type(ASSET_TYPE_NATIVE);
+    op.body.paymentOp().amount = 1;
+    tx.operations.emplace_back(op);
+
+    auto hash = sha256(
+        xdr::xdr_to_opaque(networkID, ENVELOPE_TYPE_TX, env.v1().tx));
+    DecoratedSignature sig;
+    sig.hint = SignatureUtils::getHint(source.getPublicKey().ed25519());
+    sig.signature = source.sign(hash);
+    env.v1().signatures.emplace_back(sig);
+    return env;
+}
+
+// About the mix a validator receives while transactions are flooding: half
+// transactions, then adverts of up to a hundred hashes, demands and signed SCP
+// nominations
+std::vector<StellarMessage>
+makeSyntheticStream(Hash const& networkID, size_t size)
+{
+    std::vector<SecretKey> keys;
+    for (int i = 0; i < 20; ++i)
+    {
+        keys.emplace_back(SecretKey::pseudoRandomForTesting());
+    }
+    std::vector<StellarMessage> res;
+    res.reserve(size);
+    for (size_t i = 0; i < size; ++i)
+    {
+        auto const& key = keys[i % keys.size()];
+        StellarMessage msg;
+        auto kind = rand_uniform<int>(0, 99);
+        if (kind < 50)
+        {
+            msg.type(TRANSACTION);
+            msg.transaction() = makeReplayTransaction(key, networkID);
+        }
+        else if (kind < 75)
+        {
+            msg.type(FLOOD_ADVERT);
+            auto n = rand_uniform<size_t>(1, 100);
+            for (size_t j = 0; j < n; ++j)
+            {
+                msg.floodAdvert().txHashes.emplace_back(
+                    HashUtils::pseudoRandomForTesting());
+            }
+        }
+        else if (kind < 90)
+        {
+            msg.type(FLOOD_DEMAND);
+            auto n = rand_uniform<size_t>(1, 10);
+            for (size_t j = 0; j < n; ++j)
+            {
+                msg.floodDemand().txHashes.emplace_back(
+                    HashUtils::pseudoRandomForTesting());
+            }
+        }
+        else
+        {
+            msg.type(SCP_MESSAGE);
+            auto& env = msg.envelope();
+            env.statement.nodeID = key.getPublicKey();
+            env.statement.slotIndex = i;
+            env.statement.pledges.type(SCP_ST_NOMINATE);
+            auto& nom = env.statement.pledges.nominate();
+            nom.quorumSetHash = HashUtils::pseudoRandomForTesting();
+            auto value = HashUtils::pseudoRandomForTesting();
+            nom.votes.emplace_back(value.begin(), value.end());
+            env.signature = key.sign(xdr::xdr_to_opaque(
+                networkID, ENVELOPE_TYPE_SCP, env.statement));
+        }
+        res.emplace_back(std::move(msg));
+    }
+    return res;
+}
+
+std::vector<StellarMessage>
+loadReplayStream(Hash const& networkID)
+{
+    auto file = std::getenv("STELLAR_OVERLAY_REPLAY_FILE");
+    if (!file)
+    {
+        return makeSyntheticStream(networkID, 20000);
+    }
+    std::vector<StellarMessage> res;
+    XDRInputFileStream in;
+    in.open(file);
+    StellarMessage msg;
+    while (in.readOne(msg))
+    {
+        res.emplace_back(msg);
+    }
+    LOG_INFO(DEFAULT_LOG, "Replaying {} messages from {}", res.size(), file);
+    return res;
+}
+
+template <typename F>
+void
+timeStage(char const* name, size_t count, F f)
+{
+    auto start = ch::steady_clock::now();
+    f();
+    auto elapsed = ch::steady_clock::now() - start;
+    auto ns = ch::duration_cast<ch::nanoseconds>(elapsed).count();
+    LOG_INFO(DEFAULT_LOG, "{}: {} messages in {} ({} ns/message)", name, count,
+             ch::duration_cast<ch::microseconds>(elapsed),
+             count == 0 ? 0 : ns / static_cast<int64_t>(count));
+}
+
+void
+logTimer(char const* name, medida::Timer const& timer)
+{
+    LOG_INFO(DEFAULT_LOG, "  {}: {} events, mean {:.3f} ms, max {:.3f} ms",
+             name, timer.count(), timer.mean(), timer.max());
+}
+
+uint64_t
+outboundDrops(OverlayMetrics const& om)
+{
+    return om.mOutboundQueueDropSCP.count() +
+           om.mOutboundQueueDropTxs.count() +
+           om.mOutboundQueueDropAdvert.count() +
+           om.mOutboundQueueDropDemand.count();
+}
+
+// Sends `stream` from `sender` to `receiver`, calling `crank` until every
+// message that was not dropped from the outbound queues has been read, and
+// logs throughput and the receiver's per-stage metrics
+void
+replay(char const* name, std::vector<StellarMessage> const& stream,
+       Application& senderApp, Peer::pointer sender, Application& receiverApp,
+       Peer::pointer receiver, std::function<void()> const& crank)
+{
+    auto& senderMetrics = senderApp.getOverlayManager().getOverlayMetrics();
+    auto& om = receiverApp.getOverlayManager().getOverlayMetrics();
+    auto dropsBefore = outboundDrops(senderMetrics);
+    auto readBefore = receiver->getPeerMetrics().mMessageRead.load();
+    auto bytesBefore = receiver->getPeerMetrics().mByteRead.load();
+
+    std::vector<std::shared_ptr<StellarMessage const>> msgs;
+    msgs.reserve(stream.size());
+    for (auto const& m : stream)
+    {
+        msgs.emplace_back(std::make_shared<StellarMessage const>(m));
+    }
+
+    auto received = [&]() {
+        return receiver->getPeerMetrics().mMessageRead.load() - readBefore;
+    };
+    auto expected = [&]() {
+        return msgs.size() - (outboundDrops(senderMetrics) - dropsBefore);
+    };
+
+    auto start = ch::steady_clock::now();
+    auto deadline = start + ch::minutes(5);
+    for (auto const& msg : msgs)
+    {
+        sender->sendMessage(msg, false);
+    }
+    while (received() < expected() && ch::steady_clock::now() < deadline)
+    {
+        crank();
+    }
+    auto elapsed = ch::steady_clock::now() - start;
+
+    auto secs = ch::duration<double>(elapsed).count();
+    auto n = received();
+    auto bytes = receiver->getPeerMetrics().mByteRead.load() - bytesBefore;
+    LOG_INFO(DEFAULT_LOG,
+             "{}: {} of {} messages ({} bytes) received in {} ms, {:.0f} "
+             "messages/s, {} dropped from the outbound queues",
+             name, n, msgs.size(), bytes,
+             ch::duration_cast<ch::milliseconds>(elapsed).count(),
+             secs > 0 ? n / secs : 0.0,
+             outboundDrops(senderMetrics) - dropsBefore);
+    logTimer("write queue delay",
+             senderMetrics.mMessageDelayInWriteQueueTimer);
+    logTimer("async write delay",
+             senderMetrics.mMessageDelayInAsyncWriteTimer);
+    logTimer("read throttle", om.mConnectionReadThrottle);
+    logTimer("dispatch TRANSACTION", om.mRecvTransactionTimer);
+    logTimer("dispatch FLOOD_ADVERT", om.mRecvFloodAdvertTimer);
+    logTimer("dispatch FLOOD_DEMAND", om.mRecvFloodDemandTimer);
+    logTimer("dispatch SCP_MESSAGE", om.mRecvSCPMessageTimer);
+    logTimer("dispatch SEND_MORE", om.mRecvSendMoreTimer);
+}
+}
+
+TEST_CASE("overlay message stages", "[overlay][bench][!hide]")
+{
+    // Costs of the per-message stages on the receiving end, one at a time
+    auto networkID = sha256(getTestConfig().NETWORK_PASSPHRASE);
+    auto stream = loadReplayStream(networkID);
+
+    HmacSha256Key key;
+    key.key[0] = 1;
+    Hmac sender;
+    Hmac receiver;
+    REQUIRE(sender.setSendMackey(key));
+    REQUIRE(receiver.setRecvMackey(key));
+
+    std::vector<AuthenticatedMessage> authenticated(stream.size());
+    std::vector<xdr::msg_ptr> encoded(stream.size());
+    timeStage("authenticate", stream.size(), [&]() {
+        for (size_t i = 0; i < stream.size(); ++i)
+        {
+            sender.setAuthenticatedMessageBody(authenticated[i], stream[i]);
+        }
+    });
+    timeStage("encode", stream.size(), [&]() {
+        for (size_t i = 0; i < stream.size(); ++i)
+        {
+            encoded[i] = xdr::xdr_to_msg(authenticated[i]);
+        }
+    });
+
+    std::vector<AuthenticatedMessage> decoded(stream.size());
+    timeStage("decode", stream.size(), [&]() {
+        for (size_t i = 0; i < stream.size(); ++i)
+        {
+            xdr::xdr_get g(encoded[i]->data(), encoded[i]->end());
+            xdr::xdr_argpack_archive(g, decoded[i]);
+        }
+    });
+
+    bool allValid = true;
+    timeStage("verify MAC", stream.size(), [&]() {
+        std::string error;
+        for (size_t i = 0; i < stream.size(); ++i)
+        {
+            auto const& msg = decoded[i];
+            ByteSlice macInput(encoded[i]->data() + 4,
+                               encoded[i]->size() - 4 -
+                                   msg.v0().mac.mac.size());
+            allValid =
+                receiver.checkAuthenticatedMessage(msg, macInput, error) &&
+                allValid;
+        }
+    });
+    REQUIRE(allValid);
+}
+
+TEST_CASE("overlay message replay", "[overlay][bench][!hide]")
+{
+    auto networkID = sha256(getTestConfig().NETWORK_PASSPHRASE);
+    auto stream = loadReplayStream(networkID);
+
+    SECTION("loopback")
+    {
+        VirtualClock clock;
+        auto app1 = createTestApplication(clock, getTestConfig(0));
+        auto app2 = createTestApplication(clock, getTestConfig(1));
+
+        LoopbackPeerConnection conn(*app1, *app2);
+        testutil::crankSome(clock);
+        REQUIRE(conn.getInitiator()->isAuthenticatedForTesting());
+        REQUIRE(conn.getAcceptor()->isAuthenticatedForTesting());
+
+        replay("loopback", stream, *app1, conn.getInitiator(), *app2,
+               conn.getAcceptor(), [&]() { clock.crank(false); });
+
+        testutil::shutdownWorkScheduler(*app2);
+        testutil::shutdownWorkScheduler(*app1);
+    }
+    SECTION("tcp")
+    {
+        auto background = GENERATE(false, true);
+        auto s = std::make_shared<Simulation>(
+            Simulation::OVER_TCP, networkID, [&](int i) {
+                Config cfg = getTestConfig(i);
+                cfg.EXPERIMENTAL_BACKGROUND_OVERLAY_PROCESSING = background;
+                return cfg;
+            });
+
+        auto k0 = SecretKey::fromSeed(sha256("replay0"));
+        auto k1 = SecretKey::fromSeed(sha256("replay1"));
+        SCPQuorumSet qset;
+        qset.threshold = 1;
+        qset.validators.push_back(k0.getPublicKey());
+        auto n0 = s->addNode(k0, qset);
+        auto n1 = s->addNode(k1, qset);
+        s->addPendingConnection(k0.getPublicKey(), k1.getPublicKey());
+        s->startAllNodes();
+        s->crankForAtLeast(ch::seconds(1), false);
+        s->stopOverlayTick();
+
+        auto p0 = n0->getOverlayManager().getConnectedPeer(
+            PeerBareAddress{"127.0.0.1", n1->getConfig().PEER_PORT});
+        auto p1 = n1->getOverlayManager().getConnectedPeer(
+            PeerBareAddress{"127.0.0.1", n0->getConfig().PEER_PORT});
+        REQUIRE(p0);
+        REQUIRE(p1);
+        REQUIRE(p0->isAuthenticatedForTesting());
+        REQUIRE(p1->isAuthenticatedForTesting());
+
+        replay(background ? "tcp, background overlay" : "tcp, main thread",
+               stream, *n0, p0, *n1, p1, [&]() { s->crankAllNodes(); });
+        s->stopAllNodes();
+    }
+}
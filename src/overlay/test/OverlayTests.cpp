@@ -1153,6 +1153,33 @@ TEST_CASE("outbound queue filtering", "[overlay][connections]")
             }
         }
     }
+    SECTION("byte budget holds back non-SCP messages")
+    {
+        auto flowControl = peer->getFlowControl();
+        StellarMessage adv;
+        adv.type(FLOOD_ADVERT);
+        adv.floodAdvert().txHashes.push_back(Hash{});
+        flowControl->addToQueueAndMaybeTrimForTesting(
+            std::make_shared<StellarMessage const>(adv));
+        flowControl->addToQueueAndMaybeTrimForTesting(
+            std::make_shared<StellarMessage const>(adv));
+        flowControl->addToQueueAndMaybeTrimForTesting(constructSCPMsg(envs[0]));
+
+        // SCP messages don't count against the budget
+        auto batch = flowControl->getNextBatchToSend(0);
+        REQUIRE(batch.size() == 1);
+        REQUIRE(batch[0]->type() == SCP_MESSAGE);
+        REQUIRE(advertQueue.size() == 2);
+
+        // other messages are sent until the budget is used up
+        batch = flowControl->getNextBatchToSend(1);
+        REQUIRE(batch.size() == 1);
+        REQUIRE(advertQueue.size() == 1);
+
+        batch = flowControl->getNextBatchToSend();
+        REQUIRE(batch.size() == 1);
+        REQUIRE(advertQueue.empty());
+    }
 }
 
 TEST_CASE("reject non preferred peer", "[overlay][connections]")
@@ -1680,6 +1707,40 @@ TEST_CASE("reject peers with differing network passphrases",
     testutil::shutdownWorkScheduler(*app1);
 }
 
+TEST_CASE("peer auth handshake crypto", "[overlay][connections]")
+{
+    VirtualClock clock;
+    auto app1 = createTestApplication(clock, getTestConfig(0));
+    auto app2 = createTestApplication(clock, getTestConfig(1));
+    auto& auth1 = app1->getOverlayManager().getPeerAuth();
+    auto& auth2 = app2->getOverlayManager().getPeerAuth();
+    auto node1 = app1->getConfig().NODE_SEED.getPublicKey();
+    auto node2 = app2->getConfig().NODE_SEED.getPublicKey();
+    auto cert1 = auth1.getAuthCert();
+    auto cert2 = auth2.getAuthCert();
+
+    // Verification is cached, so check twice that the answer doesn't change
+    for (int i = 0; i < 2; ++i)
+    {
+        REQUIRE(auth1.verifyRemoteAuthCert(node2, cert2));
+        REQUIRE(!auth1.verifyRemoteAuthCert(node1, cert2));
+        auto damaged = cert2;
+        damaged.sig[0] ^= 1;
+        REQUIRE(!auth1.verifyRemoteAuthCert(node2, damaged));
+    }
+
+    // Both sides derive the same key, also when it comes from the cache
+    for (int i = 0; i < 2; ++i)
+    {
+        REQUIRE(auth1.getSharedKey(cert2.pubkey, Peer::WE_CALLED_REMOTE) ==
+                auth2.getSharedKey(cert1.pubkey, Peer::REMOTE_CALLED_US));
+    }
+
+    // A cached cert is no longer accepted once it expires
+    clock.setCurrentVirtualTime(clock.system_now() + std::chrono::hours(2));
+    REQUIRE(!auth1.verifyRemoteAuthCert(node2, cert2));
+}
+
 TEST_CASE("reject peers with invalid cert", "[overlay][connections]")
 {
     VirtualClock clock;
@@ -2137,6 +2198,34 @@ TEST_CASE("inbounds nodes can be promoted to ouboundvalid",
     simulation->crankForAtLeast(std::chrono::seconds{3}, true);
 }
 
+TEST_CASE("flood capacity grant follows main thread delay",
+          "[overlay][flowcontrol]")
+{
+    VirtualClock clock;
+    auto cfg = getTestConfig();
+    cfg.FLOW_CONTROL_TARGET_QUEUE_DELAY_MS = 100;
+    auto app = createTestApplication(clock, cfg);
+    auto& om = app->getOverlayManager();
+
+    REQUIRE(om.getFloodCapacityGrantFraction() == 1.0);
+
+    // Delays well above target reduce the grant, but never below the minimum
+    for (int i = 0; i < 200; ++i)
+    {
+        om.recordFloodQueueDelay(std::chrono::seconds(2));
+    }
+    auto fraction = om.getFloodCapacityGrantFraction();
+    REQUIRE(fraction < 0.2);
+    REQUIRE(fraction >= 0.1);
+
+    // And the grant recovers once the delay is back under target
+    for (int i = 0; i < 200; ++i)
+    {
+        om.recordFloodQueueDelay(std::chrono::milliseconds(1));
+    }
+    REQUIRE(om.getFloodCapacityGrantFraction() == 1.0);
+}
+
 TEST_CASE("flow control when out of sync", "[overlay][flowcontrol]")
 {
     auto networkID = sha256(getTestConfig().NETWORK_PASSPHRASE);
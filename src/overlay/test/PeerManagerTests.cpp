@@ -537,4 +537,45 @@ TEST_CASE("purge peer table", "[overlay][PeerManager]")
     peerManager.removePeersWithManyFailures(2, &localhost2);
     REQUIRE(!peerManager.load(localhost(2)).second);
 }
+
+TEST_CASE("peer snapshot", "[overlay][PeerManager]")
+{
+    VirtualClock clock;
+    auto app = createTestApplication(clock, getTestConfig());
+    auto& peerManager = app->getOverlayManager().getPeerManager();
+    auto now = VirtualClock::systemPointToTm(clock.system_now());
+    auto record = [&](size_t numFailures) {
+        return PeerRecord{now, numFailures,
+                          static_cast<int>(PeerType::INBOUND)};
+    };
+    auto loadFromDatabase = [&]() {
+        PeerManager fresh(*app);
+        return fresh.loadAllPeers();
+    };
+
+    peerManager.store(localhost(1), record(1), false);
+    peerManager.store(localhost(2), record(5), false);
+    REQUIRE(loadFromDatabase().empty());
+
+    SECTION("on demand")
+    {
+        peerManager.snapshot();
+    }
+    SECTION("periodically")
+    {
+        testutil::crankFor(clock, PeerManager::PEER_SNAPSHOT_INTERVAL +
+                                      std::chrono::seconds(1));
+    }
+    auto peers = loadFromDatabase();
+    REQUIRE(peers.size() == 2);
+    REQUIRE(peers[0].first == localhost(1));
+    REQUIRE(peers[0].second == record(1));
+
+    peerManager.removePeersWithManyFailures(3);
+    peerManager.update(localhost(1), PeerManager::BackOffUpdate::INCREASE);
+    peerManager.snapshot();
+    peers = loadFromDatabase();
+    REQUIRE(peers.size() == 1);
+    REQUIRE(peers[0].second.mNumFailures == 2);
+}
 }
@@ -31,7 +31,8 @@ TEST_CASE("messagelimiter", "[overlay][survey][messagelimiter]")
 
     const uint32_t ledgerNumWindow = 0;
     const uint32_t surveyorRequestLimit = 2;
-    SurveyMessageLimiter rm(*app, ledgerNumWindow, surveyorRequestLimit);
+    SurveyMessageLimiter rm(*app, ledgerNumWindow, surveyorRequestLimit,
+                            std::chrono::milliseconds(100), 2);
 
     auto ledgerNum = app->getHerder().trackingConsensusLedgerIndex();
     SurveyRequestMessage firstRequest(v0SecretKey.getPublicKey(),
@@ -171,4 +172,32 @@ TEST_CASE("messagelimiter", "[overlay][survey][messagelimiter]")
         ++request.ledgerNum;
         REQUIRE(rm.addAndValidateRequest(request, success));
     }
-}
\ No newline at end of file
+}
+TEST_CASE("messagelimiter work budget", "[overlay][survey][messagelimiter]")
+{
+    VirtualClock clock;
+    auto app = createTestApplication(clock, getTestConfig());
+    using namespace std::chrono;
+    SurveyMessageLimiter rm(*app, 0, 2, milliseconds(100), 2);
+
+    SECTION("pending work is capped")
+    {
+        REQUIRE(rm.startWork());
+        REQUIRE(rm.startWork());
+        REQUIRE(!rm.startWork());
+        rm.finishWork(milliseconds(1));
+        REQUIRE(rm.startWork());
+    }
+
+    SECTION("budget resets on ledger close")
+    {
+        REQUIRE(rm.startWork());
+        rm.finishWork(milliseconds(60));
+        REQUIRE(rm.startWork());
+        rm.finishWork(milliseconds(60));
+        REQUIRE(!rm.startWork());
+
+        rm.clearOldLedgers(app->getLedgerManager().getLastClosedLedgerNum());
+        REQUIRE(rm.startWork());
+    }
+}
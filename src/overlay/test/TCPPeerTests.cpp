@@ -14,6 +14,8 @@
 #include "util/Logging.h"
 #include "util/Timer.h"
 
+#include <cstring>
+
 namespace stellar
 {
 TEST_CASE("TCPPeer lifetime", "[overlay]")
@@ -96,6 +98,15 @@ TEST_CASE("TCPPeer can communicate", "[overlay]")
             return cfg;
         };
     }
+    SECTION("with several background overlay threads")
+    {
+        cfgGen = [](int i) {
+            Config cfg = getTestConfig(i);
+            cfg.EXPERIMENTAL_BACKGROUND_OVERLAY_PROCESSING = true;
+            cfg.EXPERIMENTAL_BACKGROUND_OVERLAY_THREADS = 3;
+            return cfg;
+        };
+    }
     SECTION("main thread only")
     {
         cfgGen = [](int i) {
@@ -280,4 +291,58 @@ TEST_CASE("TCPPeer read malformed messages", "[overlay]")
         crankAndValidateDrop("received corrupt XDR", true);
     }
 }
+
+TEST_CASE("shared body messages are framed like authenticated messages",
+          "[overlay]")
+{
+    HmacSha256Key key;
+    key.key[0] = 1;
+    Hmac sender;
+    Hmac encodedSender;
+    Hmac receiver;
+    Hmac encodedReceiver;
+    REQUIRE(sender.setSendMackey(key));
+    REQUIRE(encodedSender.setSendMackey(key));
+    REQUIRE(receiver.setRecvMackey(key));
+    REQUIRE(encodedReceiver.setRecvMackey(key));
+
+    auto msg = makeStellarMessage(100);
+    auto body =
+        std::make_shared<xdr::opaque_vec<> const>(xdr::xdr_to_opaque(*msg));
+    for (int i = 0; i < 3; ++i)
+    {
+        AuthenticatedMessage amsg;
+        sender.setAuthenticatedMessageBody(amsg, *msg);
+        auto expected = xdr::xdr_to_msg(amsg);
+
+        auto [seq, mac] = encodedSender.authenticateEncodedMessage(*body);
+        REQUIRE(seq == static_cast<uint64_t>(i));
+        Peer::SharedBodyMessage shared(seq, body, mac);
+        REQUIRE(shared.size() == expected->raw_size());
+        auto actual = shared.toMsg();
+        REQUIRE(std::memcmp(actual->raw_data(), expected->raw_data(),
+                            expected->raw_size()) == 0);
+        REQUIRE(std::memcmp(shared.mHeader.data(), expected->raw_data(),
+                            shared.mHeader.size()) == 0);
+
+        xdr::xdr_get g(actual->data(), actual->end());
+        AuthenticatedMessage received;
+        xdr::xdr_argpack_archive(g, received);
+        REQUIRE(received == amsg);
+        std::string error;
+        REQUIRE(receiver.checkAuthenticatedMessage(received, error));
+
+        // The MAC covers the received bytes between the union discriminant
+        // and the MAC itself
+        std::vector<uint8_t> macInput(
+            actual->data() + 4,
+            actual->end() - received.v0().mac.mac.size());
+        macInput.back() ^= 1;
+        REQUIRE(!encodedReceiver.checkAuthenticatedMessage(received, macInput,
+                                                           error));
+        macInput.back() ^= 1;
+        REQUIRE(encodedReceiver.checkAuthenticatedMessage(received, macInput,
+                                                          error));
+    }
+}
 }
@@ -59,6 +59,42 @@ PosixSpawnFileActions::addOpen(int fildes, std::string const& fileName,
     }
 }
 
+void
+PosixSpawnFileActions::addDup2(int fildes, int newFildes)
+{
+    initialize();
+
+    if (auto err =
+            posix_spawn_file_actions_adddup2(&mFileActions, fildes, newFildes))
+    {
+        CLOG_ERROR(Process, "posix_spawn_file_actions_adddup2() failed: {}",
+                   strerror(err));
+        throw std::runtime_error("posix_spawn_file_actions_adddup2() failed");
+    }
+}
+
+bool
+PosixSpawnFileActions::addCloseFrom(int lowFildes)
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 ||                                    \
+                           (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 34))
+    initialize();
+
+    if (auto err =
+            posix_spawn_file_actions_addclosefrom_np(&mFileActions, lowFildes))
+    {
+        CLOG_ERROR(Process,
+                   "posix_spawn_file_actions_addclosefrom_np() failed: {}",
+                   strerror(err));
+        throw std::runtime_error(
+            "posix_spawn_file_actions_addclosefrom_np() failed");
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
 PosixSpawnFileActions::operator posix_spawn_file_actions_t*()
 {
     return mInitialized ? &mFileActions : nullptr;
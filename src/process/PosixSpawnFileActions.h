@@ -22,6 +22,11 @@ class PosixSpawnFileActions
 
     void addOpen(int fildes, std::string const& fileName, int oflag,
                  mode_t mode);
+    void addDup2(int fildes, int newFildes);
+    // Closes every descriptor from lowFildes up in the child; returns false
+    // if the C library can't do that, leaving callers to make sure the child
+    // doesn't inherit descriptors some other way
+    bool addCloseFrom(int lowFildes);
 
     operator posix_spawn_file_actions_t*();
 
@@ -20,11 +20,15 @@ class RealTimer;
  * so we provide a little machinery for running subprocesses and waiting
  * on their results, intermixed with normal asio primitives.
  *
- * No facilities exist for reading or writing to the subprocess I/O ports. This
- * is strictly for "run a command, wait to see if it worked"; a glorified
- * asynchronous version of system().
+ * This is mostly for "run a command, wait to see if it worked"; a glorified
+ * asynchronous version of system(). The only I/O port facility is reading the
+ * subprocess' standard output, either into a file or, on POSIX, as a stream
+ * handed to the caller as it arrives.
  */
 
+// Called on the main thread with each chunk of a process' standard output
+using ProcessOutputHandler = std::function<void(char const* data, size_t size)>;
+
 // Wrap a platform-specific Impl strategy that monitors process-exits in a
 // helper simulating an event-notifier, via a general asio timer set to maximum
 // duration. Clients can register handlers on this and they are wrapped into
@@ -52,6 +56,16 @@ class ProcessManager : public std::enable_shared_from_this<ProcessManager>,
     virtual std::weak_ptr<ProcessExitEvent>
     runProcess(std::string const& cmdLine, std::string outputFile) = 0;
 
+    // Runs a process with its standard output read through a pipe and passed
+    // to onOutput, so that it can be consumed in-process without going
+    // through a file. The exit event fires after all output was handed over,
+    // unless the process is shut down first; onOutput is not called after
+    // that. Not supported on Windows, where the exit event fires with an
+    // error instead.
+    virtual std::weak_ptr<ProcessExitEvent>
+    runProcessStreaming(std::string const& cmdLine,
+                        ProcessOutputHandler onOutput) = 0;
+
     // Return the number or processes we started and have not yet seen exits
     // for, _excluding_ those we're attempting to shut down / are shortly
     // expecting to see an exit for (which are likely already dead, just not yet
@@ -25,6 +25,7 @@
 #include <functional>
 #include <iterator>
 #include <mutex>
+#include <optional>
 #include <regex>
 #include <string>
 #include <thread>
@@ -36,6 +37,7 @@
 #else
 #include <errno.h>
 #include <fcntl.h>
+#include <unistd.h>
 #endif
 
 #if defined(__APPLE__) || defined(__FreeBSD__)
@@ -134,22 +136,33 @@ class ProcessExitEvent::Impl
     std::string const mCmdLine;
     std::string const mOutFile;
     std::string const mTempFile;
+    ProcessOutputHandler const mOutputHandler;
     ProcessLifecycle mLifecycle{ProcessLifecycle::PENDING};
 #ifdef _WIN32
     asio::windows::object_handle mProcessHandle;
+#else
+    // Read end of the standard output pipe, until it's closed on the other
+    // side or the exit event fired
+    std::unique_ptr<asio::posix::stream_descriptor> mOutputPipe;
+    std::vector<char> mOutputBuffer;
+    // Exit status of a process that exited while its output was being read
+    std::optional<asio::error_code> mPendingExitEc;
 #endif
     std::weak_ptr<ProcessManagerImpl> mProcManagerImpl;
     int mProcessId{-1};
+    bool mEventFired{false};
 
     Impl(std::shared_ptr<RealTimer> const& outerTimer,
          std::shared_ptr<asio::error_code> const& outerEc,
          std::string const& cmdLine, std::string const& outFile,
-         std::string const& tempFile, std::weak_ptr<ProcessManagerImpl> pm)
+         std::string const& tempFile, ProcessOutputHandler const& onOutput,
+         std::weak_ptr<ProcessManagerImpl> pm)
         : mOuterTimer(outerTimer)
         , mOuterEc(outerEc)
         , mCmdLine(cmdLine)
         , mOutFile(outFile)
         , mTempFile(tempFile)
+        , mOutputHandler(onOutput)
 #ifdef _WIN32
         , mProcessHandle(outerTimer->get_executor())
 #endif
@@ -184,9 +197,29 @@ class ProcessExitEvent::Impl
     cancel(asio::error_code const& ec)
     {
         *mOuterEc = ec;
+        mEventFired = true;
         mOuterTimer->cancel();
     }
 
+    // Fires the exit event for a process that exited, once its output, if
+    // any, was all read
+    void
+    exited(asio::error_code const& ec)
+    {
+#ifndef _WIN32
+        if (mOutputPipe)
+        {
+            mPendingExitEc = ec;
+            return;
+        }
+#endif
+        cancel(ec);
+    }
+
+#ifndef _WIN32
+    void readOutput();
+#endif
+
     int
     getProcessId() const
     {
@@ -397,7 +430,7 @@ ProcessManagerImpl::handleProcessTermination(int pid, int status)
     // trigger the callback.
     maybeRunPendingProcesses();
 
-    impl->cancel(ec);
+    impl->exited(ec);
     return ec;
 }
 
@@ -499,6 +532,12 @@ ProcessExitEvent::Impl::run()
     PROCESS_INFORMATION pi;
     ZeroMemory(&pi, sizeof(pi));
 
+    if (mOutputHandler)
+    {
+        throw std::runtime_error(
+            "streaming process output is not supported on Windows");
+    }
+
     LPSTR cmd = (LPSTR)mCmdLine.data();
 
     InfoHelper iH;
@@ -770,7 +809,7 @@ static std::vector<std::string>
 split(std::string const& s)
 {
     std::vector<std::string> parts;
-    std::regex ws_re("\\s+");
+    static std::regex const ws_re("\\s+");
     std::copy(std::sregex_token_iterator(s.begin(), s.end(), ws_re, -1),
               std::sregex_token_iterator(), std::back_inserter(parts));
     return parts;
@@ -798,28 +837,67 @@ ProcessExitEvent::Impl::run()
     {
         fileActions.addOpen(1, mTempFile, O_RDWR | O_CREAT, 0600);
     }
-    // Iterate through all possibly open file descriptors except stdin, stdout,
-    // and stderr and set FD_CLOEXEC so the subprocess doesn't inherit them
-    const int maxFds = sysconf(_SC_OPEN_MAX);
-    // as the space of open file descriptors is arbitrary large
-    // we use as a heuristic the number of consecutive unused descriptors
-    // as an indication that we're past the range where descriptors are
-    // allocated
-    // a better way would be to enumerate the opened descriptors, but there
-    // doesn't seem to be a portable way to do this
-    const int maxGAP = 512;
-    for (int fd = 3, lastFd = 3; (fd < maxFds) && ((fd - lastFd) < maxGAP);
-         ++fd)
-    {
-        int flags = fcntl(fd, F_GETFD);
-        if (flags != -1)
-        {
-            // set if it was not already set
-            if ((flags & FD_CLOEXEC) == 0)
+
+    int outputPipe[2] = {-1, -1};
+    auto closePipe = [&]() {
+        for (auto& fd : outputPipe)
+        {
+            if (fd != -1)
+            {
+                close(fd);
+                fd = -1;
+            }
+        }
+    };
+    if (mOutputHandler)
+    {
+        if (pipe(outputPipe) != 0)
+        {
+            CLOG_ERROR(Process, "pipe() failed: {}", strerror(errno));
+            throw std::runtime_error("pipe() failed");
+        }
+        // Only the child's stdout, which dup2 leaves open, survives exec
+        fcntl(outputPipe[0], F_SETFD, FD_CLOEXEC);
+        fcntl(outputPipe[1], F_SETFD, FD_CLOEXEC);
+        try
+        {
+            fileActions.addDup2(outputPipe[1], 1);
+        }
+        catch (std::runtime_error&)
+        {
+            closePipe();
+            throw;
+        }
+    }
+
+    // Have the child close all descriptors but stdin, stdout and stderr when
+    // possible: it's much cheaper than probing them one by one here
+    if (!fileActions.addCloseFrom(3))
+    {
+        // Iterate through all possibly open file descriptors except stdin,
+        // stdout, and stderr and set FD_CLOEXEC so the subprocess doesn't
+        // inherit them
+        const int maxFds = sysconf(_SC_OPEN_MAX);
+        // as the space of open file descriptors is arbitrary large
+        // we use as a heuristic the number of consecutive unused descriptors
+        // as an indication that we're past the range where descriptors are
+        // allocated
+        // a better way would be to enumerate the opened descriptors, but there
+        // doesn't seem to be a portable way to do this
+        const int maxGAP = 512;
+        for (int fd = 3, lastFd = 3; (fd < maxFds) && ((fd - lastFd) < maxGAP);
+             ++fd)
+        {
+            int flags = fcntl(fd, F_GETFD);
+            if (flags != -1)
             {
-                fcntl(fd, F_SETFD, flags | FD_CLOEXEC);
+                // set if it was not already set
+                if ((flags & FD_CLOEXEC) == 0)
+                {
+                    fcntl(fd, F_SETFD, flags | FD_CLOEXEC);
+                }
+                lastFd = fd;
             }
-            lastFd = fd;
         }
     }
     err = posix_spawnp(&mProcessId, argv[0], fileActions,
@@ -827,17 +905,79 @@ ProcessExitEvent::Impl::run()
                        argv.data(), environ);
     if (err)
     {
+        closePipe();
         CLOG_ERROR(Process, "posix_spawn() failed: {}", strerror(err));
         throw std::runtime_error("posix_spawn() failed");
     }
 
+    if (mOutputHandler)
+    {
+        close(outputPipe[1]);
+        mOutputPipe = std::make_unique<asio::posix::stream_descriptor>(
+            mOuterTimer->get_executor(), outputPipe[0]);
+        mOutputBuffer.resize(64 * 1024);
+        readOutput();
+    }
     mLifecycle = ProcessLifecycle::RUNNING;
 }
 
+void
+ProcessExitEvent::Impl::readOutput()
+{
+    // Keeps the event alive until all output was read, as it may only fire
+    // then, when nothing else holds on to it
+    auto self = shared_from_this();
+    mOutputPipe->async_read_some(
+        asio::buffer(mOutputBuffer),
+        [self](asio::error_code const& ec, size_t bytes) {
+            if (!self->mOutputPipe)
+            {
+                return;
+            }
+            // Once the event fired, nobody is waiting for more output
+            if (bytes > 0 && !self->mEventFired)
+            {
+                self->mOutputHandler(self->mOutputBuffer.data(), bytes);
+            }
+            if (!ec && !self->mEventFired)
+            {
+                self->readOutput();
+                return;
+            }
+
+            if (ec && ec != asio::error::eof)
+            {
+                CLOG_WARNING(Process, "reading output of {} failed: {}",
+                             self->mCmdLine, ec.message());
+            }
+            self->mOutputPipe.reset();
+            if (self->mPendingExitEc)
+            {
+                self->cancel(*self->mPendingExitEc);
+            }
+        });
+}
+
 #endif
 
 std::weak_ptr<ProcessExitEvent>
 ProcessManagerImpl::runProcess(std::string const& cmdLine, std::string outFile)
+{
+    return addPendingProcess(cmdLine, std::move(outFile), nullptr);
+}
+
+std::weak_ptr<ProcessExitEvent>
+ProcessManagerImpl::runProcessStreaming(std::string const& cmdLine,
+                                        ProcessOutputHandler onOutput)
+{
+    releaseAssert(onOutput);
+    return addPendingProcess(cmdLine, "", std::move(onOutput));
+}
+
+std::weak_ptr<ProcessExitEvent>
+ProcessManagerImpl::addPendingProcess(std::string const& cmdLine,
+                                      std::string outFile,
+                                      ProcessOutputHandler onOutput)
 {
     ZoneScoped;
     std::lock_guard<std::recursive_mutex> guard(mProcessesMutex);
@@ -851,7 +991,7 @@ ProcessManagerImpl::runProcess(std::string const& cmdLine, std::string outFile)
         mTmpDir->getName() + "/temp-" + std::to_string(mTempFileCount++);
 
     pe->mImpl = std::make_shared<ProcessExitEvent::Impl>(
-        pe->mTimer, pe->mEc, cmdLine, outFile, tempFile, weakSelf);
+        pe->mTimer, pe->mEc, cmdLine, outFile, tempFile, onOutput, weakSelf);
     mPending.push_back(pe);
 
     maybeRunPendingProcesses();
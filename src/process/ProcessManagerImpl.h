@@ -34,6 +34,9 @@ class ProcessManagerImpl : public ProcessManager
     uint64_t mTempFileCount{0};
 
     std::deque<std::shared_ptr<ProcessExitEvent>> mPending;
+    std::weak_ptr<ProcessExitEvent>
+    addPendingProcess(std::string const& cmdLine, std::string outFile,
+                      ProcessOutputHandler onOutput);
     void maybeRunPendingProcesses();
     void checkInvariants();
 
@@ -51,6 +54,9 @@ class ProcessManagerImpl : public ProcessManager
     explicit ProcessManagerImpl(Application& app);
     std::weak_ptr<ProcessExitEvent> runProcess(std::string const& cmdLine,
                                                std::string outFile) override;
+    std::weak_ptr<ProcessExitEvent>
+    runProcessStreaming(std::string const& cmdLine,
+                        ProcessOutputHandler onOutput) override;
     size_t getNumRunningProcesses() override;
     size_t getNumRunningOrShuttingDownProcesses() override;
 
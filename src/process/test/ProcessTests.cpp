@@ -137,6 +137,48 @@ TEST_CASE("subprocess redirect to existing file", "[process]")
     CHECK(s == data);
 }
 
+#ifndef _WIN32
+TEST_CASE("subprocess output streaming", "[process]")
+{
+    VirtualClock clock;
+    Config const& cfg = getTestConfig();
+    Application::pointer app = createTestApplication(clock, cfg);
+
+    // Enough output to come in several chunks
+    std::string expected;
+    for (int i = 1; i <= 100000; ++i)
+    {
+        expected += fmt::format("{}\n", i);
+    }
+
+    std::string output;
+    size_t chunks = 0;
+    bool exited = false;
+    bool failed = false;
+    auto evt = app->getProcessManager()
+                   .runProcessStreaming("seq 1 100000",
+                                        [&](char const* data, size_t size) {
+                                            REQUIRE(!exited);
+                                            output.append(data, size);
+                                            ++chunks;
+                                        })
+                   .lock();
+    REQUIRE(evt);
+    evt->async_wait([&](asio::error_code ec) {
+        failed = !!ec;
+        exited = true;
+    });
+
+    while (!exited && !clock.getIOContext().stopped())
+    {
+        clock.crank(true);
+    }
+    REQUIRE(!failed);
+    REQUIRE(chunks > 1);
+    REQUIRE(output == expected);
+}
+#endif
+
 TEST_CASE("subprocess storm", "[process]")
 {
     VirtualClock clock;
@@ -144,9 +144,11 @@ BallotProtocol::recordEnvelope(SCPEnvelopeWrapperPtr env)
     }
     else
     {
+        mStatementIndex.remove(oldp->second->getStatement());
         oldp->second = env;
     }
-    mSlot.recordStatement(env->getStatement());
+    mStatementIndex.add(st);
+    mSlot.recordStatement(env);
 }
 
 SCP::EnvelopeState
@@ -728,59 +730,8 @@ BallotProtocol::getPrepareCandidates(SCPStatement const& hint)
         SCPBallot topVote = *last;
         hintBallots.erase(last);
 
-        auto const& val = topVote.value;
-
         // find candidates that may have been prepared
-        for (auto const& e : mLatestEnvelopes)
-        {
-            SCPStatement const& st = e.second->getStatement();
-            switch (st.pledges.type())
-            {
-            case SCP_ST_PREPARE:
-            {
-                auto const& prep = st.pledges.prepare();
-                if (areBallotsLessAndCompatible(prep.ballot, topVote))
-                {
-                    candidates.insert(prep.ballot);
-                }
-                if (prep.prepared &&
-                    areBallotsLessAndCompatible(*prep.prepared, topVote))
-                {
-                    candidates.insert(*prep.prepared);
-                }
-                if (prep.preparedPrime &&
-                    areBallotsLessAndCompatible(*prep.preparedPrime, topVote))
-                {
-                    candidates.insert(*prep.preparedPrime);
-                }
-            }
-            break;
-            case SCP_ST_CONFIRM:
-            {
-                auto const& con = st.pledges.confirm();
-                if (areBallotsCompatible(topVote, con.ballot))
-                {
-                    candidates.insert(topVote);
-                    if (con.nPrepared < topVote.counter)
-                    {
-                        candidates.insert(SCPBallot(con.nPrepared, val));
-                    }
-                }
-            }
-            break;
-            case SCP_ST_EXTERNALIZE:
-            {
-                auto const& ext = st.pledges.externalize();
-                if (areBallotsCompatible(topVote, ext.commit))
-                {
-                    candidates.insert(topVote);
-                }
-            }
-            break;
-            default:
-                abort();
-            }
-        }
+        mStatementIndex.addPrepareCandidates(topVote, candidates);
     }
 
     return candidates;
@@ -1131,48 +1082,155 @@ BallotProtocol::findExtendedInterval(Interval& candidate,
 std::set<uint32>
 BallotProtocol::getCommitBoundariesFromStatements(SCPBallot const& ballot)
 {
-    std::set<uint32> res;
-    for (auto const& env : mLatestEnvelopes)
-    {
-        auto const& pl = env.second->getStatement().pledges;
-        switch (pl.type())
+    return mStatementIndex.getCommitBoundaries(ballot.value);
+}
+
+bool
+BallotProtocol::StatementIndex::ValueBallots::empty() const
+{
+    return mPrepared.empty() && mConfirmPrepared.empty() &&
+           mExternalized == 0 && mCommitBoundaries.empty();
+}
+
+void
+BallotProtocol::StatementIndex::update(SCPStatement const& st, bool add)
+{
+    auto updateCount = [add](std::map<uint32, size_t>& counts, uint32 n) {
+        if (add)
         {
-        case SCP_ST_PREPARE:
+            ++counts[n];
+        }
+        else
         {
-            auto const& p = pl.prepare();
-            if (areBallotsCompatible(ballot, p.ballot))
+            auto it = counts.find(n);
+            releaseAssert(it != counts.end());
+            if (--it->second == 0)
             {
-                if (p.nC)
-                {
-                    res.emplace(p.nC);
-                    res.emplace(p.nH);
-                }
+                counts.erase(it);
             }
         }
-        break;
-        case SCP_ST_CONFIRM:
+    };
+    std::vector<Value const*> values;
+    auto getBallots = [&](Value const& v) -> ValueBallots& {
+        values.emplace_back(&v);
+        return mValues[v];
+    };
+
+    auto const& pl = st.pledges;
+    switch (pl.type())
+    {
+    case SCP_ST_PREPARE:
+    {
+        auto const& p = pl.prepare();
+        auto& vb = getBallots(p.ballot.value);
+        updateCount(vb.mPrepared, p.ballot.counter);
+        if (p.nC)
         {
-            auto const& c = pl.confirm();
-            if (areBallotsCompatible(ballot, c.ballot))
-            {
-                res.emplace(c.nCommit);
-                res.emplace(c.nH);
-            }
+            updateCount(vb.mCommitBoundaries, p.nC);
+            updateCount(vb.mCommitBoundaries, p.nH);
         }
-        break;
-        case SCP_ST_EXTERNALIZE:
+        if (p.prepared)
         {
-            auto const& e = pl.externalize();
-            if (areBallotsCompatible(ballot, e.commit))
+            updateCount(getBallots(p.prepared->value).mPrepared,
+                        p.prepared->counter);
+        }
+        if (p.preparedPrime)
+        {
+            updateCount(getBallots(p.preparedPrime->value).mPrepared,
+                        p.preparedPrime->counter);
+        }
+    }
+    break;
+    case SCP_ST_CONFIRM:
+    {
+        auto const& c = pl.confirm();
+        auto& vb = getBallots(c.ballot.value);
+        updateCount(vb.mConfirmPrepared, c.nPrepared);
+        updateCount(vb.mCommitBoundaries, c.nCommit);
+        updateCount(vb.mCommitBoundaries, c.nH);
+    }
+    break;
+    case SCP_ST_EXTERNALIZE:
+    {
+        auto const& e = pl.externalize();
+        auto& vb = getBallots(e.commit.value);
+        if (add)
+        {
+            ++vb.mExternalized;
+        }
+        else
+        {
+            releaseAssert(vb.mExternalized != 0);
+            --vb.mExternalized;
+        }
+        updateCount(vb.mCommitBoundaries, e.commit.counter);
+        updateCount(vb.mCommitBoundaries, e.nH);
+        updateCount(vb.mCommitBoundaries, UINT32_MAX);
+    }
+    break;
+    default:
+        dbgAbort();
+    }
+
+    if (!add)
+    {
+        for (auto v : values)
+        {
+            auto it = mValues.find(*v);
+            if (it != mValues.end() && it->second.empty())
             {
-                res.emplace(e.commit.counter);
-                res.emplace(e.nH);
-                res.emplace(UINT32_MAX);
+                mValues.erase(it);
             }
         }
-        break;
-        default:
-            dbgAbort();
+    }
+}
+
+void
+BallotProtocol::StatementIndex::addPrepareCandidates(
+    SCPBallot const& topVote, std::set<SCPBallot>& candidates) const
+{
+    auto it = mValues.find(topVote.value);
+    if (it == mValues.end())
+    {
+        return;
+    }
+    auto const& vb = it->second;
+
+    // PREPARE statements: b, p and p' that are less and compatible
+    for (auto p = vb.mPrepared.begin();
+         p != vb.mPrepared.end() && p->first <= topVote.counter; ++p)
+    {
+        candidates.insert(SCPBallot(p->first, topVote.value));
+    }
+
+    // CONFIRM statements: topVote and their (nPrepared, value) below it
+    if (!vb.mConfirmPrepared.empty())
+    {
+        candidates.insert(topVote);
+        for (auto p = vb.mConfirmPrepared.begin();
+             p != vb.mConfirmPrepared.end() && p->first < topVote.counter; ++p)
+        {
+            candidates.insert(SCPBallot(p->first, topVote.value));
+        }
+    }
+
+    // EXTERNALIZE statements: topVote
+    if (vb.mExternalized != 0)
+    {
+        candidates.insert(topVote);
+    }
+}
+
+std::set<uint32>
+BallotProtocol::StatementIndex::getCommitBoundaries(Value const& value) const
+{
+    std::set<uint32> res;
+    auto it = mValues.find(value);
+    if (it != mValues.end())
+    {
+        for (auto const& b : it->second.mCommitBoundaries)
+        {
+            res.emplace_hint(res.end(), b.first);
         }
     }
     return res;
@@ -8,6 +8,7 @@
 #include "scp/SCP.h"
 #include "util/GlobalChecks.h"
 #include <functional>
+#include <map>
 #include <memory>
 #include <set>
 #include <string>
@@ -81,6 +82,48 @@ class BallotProtocol
     SCPBallotWrapperUPtr mHighBallot;                         // h
     SCPBallotWrapperUPtr mCommit;                             // c
     std::map<NodeID, SCPEnvelopeWrapperPtr> mLatestEnvelopes; // M
+
+    // Ballots of the statements in M grouped by value, updated as envelopes
+    // are recorded, so that finding the prepare candidates and commit
+    // boundaries for a value doesn't require scanning M
+    class StatementIndex
+    {
+        struct ValueBallots
+        {
+            // counters of b, p and p' of PREPARE statements
+            std::map<uint32, size_t> mPrepared;
+            // nPrepared of CONFIRM statements
+            std::map<uint32, size_t> mConfirmPrepared;
+            size_t mExternalized{0};
+            // see getCommitBoundariesFromStatements
+            std::map<uint32, size_t> mCommitBoundaries;
+
+            bool empty() const;
+        };
+        std::map<Value, ValueBallots> mValues;
+
+        void update(SCPStatement const& st, bool add);
+
+      public:
+        void
+        add(SCPStatement const& st)
+        {
+            update(st, true);
+        }
+        void
+        remove(SCPStatement const& st)
+        {
+            update(st, false);
+        }
+
+        // adds the ballots that may have been prepared and are less than and
+        // compatible with topVote to candidates
+        void addPrepareCandidates(SCPBallot const& topVote,
+                                  std::set<SCPBallot>& candidates) const;
+        std::set<uint32> getCommitBoundaries(Value const& value) const;
+    };
+    StatementIndex mStatementIndex;
+
     SCPPhase mPhase;                                          // Phi
     ValueWrapperPtr mValueOverride;                           // z
 
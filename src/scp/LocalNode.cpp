@@ -8,6 +8,7 @@
 #include "crypto/SecretKey.h"
 #include "lib/json/json.h"
 #include "scp/QuorumSetUtils.h"
+#include "util/BitSet.h"
 #include "util/GlobalChecks.h"
 #include "util/Logging.h"
 #include "util/XDROperators.h"
@@ -16,9 +17,118 @@
 #include <Tracy.hpp>
 #include <algorithm>
 #include <functional>
+#include <optional>
 
 namespace stellar
 {
+namespace
+{
+// SCPQuorumSet over the positions of its validators in a sorted vector of
+// nodes, so that counting the validators in a subset of those nodes is a
+// bitset intersection rather than a search per validator. Validators that
+// are not in the vector just count towards mSize.
+struct IndexedQSet
+{
+    uint32 mThreshold;
+    size_t mSize;
+    BitSet mValidators;
+    std::vector<IndexedQSet> mInnerSets;
+};
+
+IndexedQSet
+indexQSet(SCPQuorumSet const& qSet, std::vector<NodeID> const& sortedNodes)
+{
+    IndexedQSet res{qSet.threshold,
+                    qSet.validators.size() + qSet.innerSets.size(),
+                    BitSet(sortedNodes.size()),
+                    {}};
+    for (auto const& validator : qSet.validators)
+    {
+        auto it =
+            std::lower_bound(sortedNodes.begin(), sortedNodes.end(), validator);
+        if (it != sortedNodes.end() && *it == validator)
+        {
+            res.mValidators.set(it - sortedNodes.begin());
+        }
+    }
+    res.mInnerSets.reserve(qSet.innerSets.size());
+    for (auto const& inner : qSet.innerSets)
+    {
+        res.mInnerSets.emplace_back(indexQSet(inner, sortedNodes));
+    }
+    return res;
+}
+
+// Same as LocalNode::isQuorumSliceInternal
+bool
+isIndexedQuorumSlice(IndexedQSet const& qSet, BitSet const& nodes)
+{
+    if (qSet.mThreshold == 0)
+    {
+        return false;
+    }
+    size_t count = qSet.mValidators.intersectionCount(nodes);
+    if (count >= qSet.mThreshold)
+    {
+        return true;
+    }
+    for (auto const& inner : qSet.mInnerSets)
+    {
+        if (isIndexedQuorumSlice(inner, nodes) && ++count >= qSet.mThreshold)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Same as LocalNode::isVBlockingInternal
+bool
+isIndexedVBlocking(IndexedQSet const& qSet, BitSet const& nodes)
+{
+    // There is no v-blocking set for {\empty}
+    if (qSet.mThreshold == 0)
+    {
+        return false;
+    }
+    int64_t left = static_cast<int64_t>(1 + qSet.mSize) - qSet.mThreshold;
+    size_t needed = left <= 0 ? 1 : static_cast<size_t>(left);
+    size_t count = qSet.mValidators.intersectionCount(nodes);
+    if (count >= needed)
+    {
+        return true;
+    }
+    for (auto const& inner : qSet.mInnerSets)
+    {
+        if (isIndexedVBlocking(inner, nodes) && ++count >= needed)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Keys of `map`, which are sorted, and the bitset of the ones that pass
+// `filter`
+std::pair<std::vector<NodeID>, BitSet>
+indexNodes(std::map<NodeID, SCPEnvelopeWrapperPtr> const& map,
+           std::function<bool(SCPStatement const&)> const& filter)
+{
+    std::vector<NodeID> nodes;
+    nodes.reserve(map.size());
+    BitSet passing(map.size());
+    for (auto const& it : map)
+    {
+        if (filter(it.second->getStatement()))
+        {
+            passing.set(nodes.size());
+        }
+        nodes.emplace_back(it.first);
+    }
+    return {std::move(nodes), std::move(passing)};
+}
+}
+
 LocalNode::LocalNode(NodeID const& nodeID, bool isValidator,
                      SCPQuorumSet const& qSet, SCPDriver& driver)
     : mNodeID(nodeID), mIsValidator(isValidator), mQSet(qSet), mDriver(driver)
@@ -227,16 +337,8 @@ LocalNode::isVBlocking(SCPQuorumSet const& qSet,
                        std::function<bool(SCPStatement const&)> const& filter)
 {
     ZoneScoped;
-    std::vector<NodeID> pNodes;
-    for (auto const& it : map)
-    {
-        if (filter(it.second->getStatement()))
-        {
-            pNodes.push_back(it.first);
-        }
-    }
-
-    return isVBlocking(qSet, pNodes);
+    auto [nodes, pNodes] = indexNodes(map, filter);
+    return isIndexedVBlocking(indexQSet(qSet, nodes), pNodes);
 }
 
 bool
@@ -247,38 +349,48 @@ LocalNode::isQuorum(
     std::function<bool(SCPStatement const&)> const& filter)
 {
     ZoneScoped;
-    std::vector<NodeID> pNodes;
+    auto [nodes, pNodes] = indexNodes(map, filter);
+
+    // Quorum sets of the filtered nodes, in the order of `nodes`. A node
+    // without one can't be part of the quorum.
+    std::vector<std::optional<IndexedQSet>> qSets(nodes.size());
+    size_t i = 0;
     for (auto const& it : map)
     {
-        if (filter(it.second->getStatement()))
+        if (pNodes.get(i))
         {
-            pNodes.push_back(it.first);
+            auto qSetPtr = qfun(it.second->getStatement());
+            if (qSetPtr)
+            {
+                qSets[i] = indexQSet(*qSetPtr, nodes);
+            }
+            else
+            {
+                pNodes.unset(i);
+            }
         }
+        ++i;
     }
 
-    size_t count = 0;
+    // Remove the nodes that don't have a slice in the remaining ones until
+    // none is removed. Removing a node as soon as it is found unsatisfied
+    // reaches the same (largest) quorum as checking all nodes against the
+    // same set in each round.
+    bool removed;
     do
     {
-        count = pNodes.size();
-        std::vector<NodeID> fNodes(pNodes.size());
-        auto quorumFilter = [&](NodeID nodeID) -> bool {
-            auto qSetPtr = qfun(map.find(nodeID)->second->getStatement());
-            if (qSetPtr)
-            {
-                return isQuorumSlice(*qSetPtr, pNodes);
-            }
-            else
+        removed = false;
+        for (size_t n = 0; pNodes.nextSet(n); ++n)
+        {
+            if (!isIndexedQuorumSlice(*qSets[n], pNodes))
             {
-                return false;
+                pNodes.unset(n);
+                removed = true;
             }
-        };
-        auto it = std::copy_if(pNodes.begin(), pNodes.end(), fNodes.begin(),
-                               quorumFilter);
-        fNodes.resize(std::distance(fNodes.begin(), it));
-        pNodes = fNodes;
-    } while (count != pNodes.size());
-
-    return isQuorumSlice(qSet, pNodes);
+        }
+    } while (removed);
+
+    return isIndexedQuorumSlice(indexQSet(qSet, nodes), pNodes);
 }
 
 std::vector<NodeID>
@@ -140,7 +140,7 @@ NominationProtocol::recordEnvelope(SCPEnvelopeWrapperPtr env)
     {
         oldp->second = env;
     }
-    mSlot.recordStatement(env->getStatement());
+    mSlot.recordStatement(env);
 }
 
 void
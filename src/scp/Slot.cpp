@@ -147,10 +147,11 @@ Slot::getExternalizingState() const
 }
 
 void
-Slot::recordStatement(SCPStatement const& st)
+Slot::recordStatement(SCPEnvelopeWrapperPtr env)
 {
+    auto const& st = env->getStatement();
     mStatementsHistory.emplace_back(
-        HistoricalStatement{std::time(nullptr), st, mFullyValidated});
+        HistoricalStatement{std::time(nullptr), env, mFullyValidated});
     CLOG_DEBUG(SCP, "new statement:  i: {} st: {} validated: {}",
                getSlotIndex(), mSCP.envToStr(st, false),
                (mFullyValidated ? "true" : "false"));
@@ -346,11 +347,11 @@ Slot::getJsonInfo(bool fullKeys)
     {
         Json::Value& v = ret["statements"][count++];
         v.append((Json::UInt64)item.mWhen);
-        v.append(mSCP.envToStr(item.mStatement, fullKeys));
+        auto const& st = item.mEnvelope->getStatement();
+        v.append(mSCP.envToStr(st, fullKeys));
         v.append(item.mValidated);
 
-        Hash const& qSetHash =
-            getCompanionQuorumSetHashFromStatement(item.mStatement);
+        Hash const& qSetHash = getCompanionQuorumSetHashFromStatement(st);
         auto qSet = getSCPDriver().getQSet(qSetHash);
         if (qSet)
         {
@@ -36,7 +36,8 @@ class Slot : public std::enable_shared_from_this<Slot>
     struct HistoricalStatement
     {
         time_t mWhen;
-        SCPStatement mStatement;
+        // shared with the protocols, rather than a copy of the statement
+        SCPEnvelopeWrapperPtr mEnvelope;
         bool mValidated;
     };
 
@@ -106,7 +107,7 @@ class Slot : public std::enable_shared_from_this<Slot>
     std::vector<SCPEnvelope> getExternalizingState() const;
 
     // records the statement in the historical record for this slot
-    void recordStatement(SCPStatement const& st);
+    void recordStatement(SCPEnvelopeWrapperPtr env);
 
     // Process a newly received envelope for this slot and update the state of
     // the slot accordingly.
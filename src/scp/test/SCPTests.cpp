@@ -476,6 +476,95 @@ TEST_CASE("vblocking and quorum", "[scp]")
     REQUIRE(LocalNode::isVBlocking(qSet, nodeSet) == true);
 }
 
+TEST_CASE("vblocking and quorum over envelope maps", "[scp]")
+{
+    // The map overloads must agree with the checks over node vectors, and
+    // isQuorum with the fixed point of removing unsatisfied nodes
+    int const numNodes = 12;
+    std::vector<NodeID> ids;
+    for (int i = 0; i < numNodes; ++i)
+    {
+        ids.emplace_back(
+            SecretKey::fromSeed(sha256(fmt::format("NODE_SEED_{}", i)))
+                .getPublicKey());
+    }
+    auto randomQSet = [&]() {
+        SCPQuorumSet qSet;
+        for (auto const& id : ids)
+        {
+            if (rand_flip())
+            {
+                qSet.validators.emplace_back(id);
+            }
+        }
+        if (rand_flip())
+        {
+            SCPQuorumSet inner;
+            inner.validators.emplace_back(ids[rand_uniform(0, numNodes - 1)]);
+            inner.threshold = 1;
+            qSet.innerSets.emplace_back(inner);
+        }
+        auto size = qSet.validators.size() + qSet.innerSets.size();
+        qSet.threshold =
+            size == 0 ? 0 : rand_uniform<uint32>(1, static_cast<uint32>(size));
+        return qSet;
+    };
+
+    for (int round = 0; round < 200; ++round)
+    {
+        std::map<NodeID, SCPQuorumSet> qSets;
+        std::map<NodeID, SCPEnvelopeWrapperPtr> envs;
+        for (auto const& id : ids)
+        {
+            if (rand_uniform(0, 3) == 0)
+            {
+                continue;
+            }
+            SCPEnvelope env;
+            env.statement.nodeID = id;
+            env.statement.slotIndex = rand_uniform(0, 1);
+            envs.emplace(id, std::make_shared<SCPEnvelopeWrapper>(env));
+            qSets.emplace(id, randomQSet());
+        }
+        auto filter = [](SCPStatement const& st) {
+            return st.slotIndex == 1;
+        };
+        auto qfun = [&](SCPStatement const& st) {
+            return std::make_shared<SCPQuorumSet>(qSets.at(st.nodeID));
+        };
+        auto qSet = randomQSet();
+
+        std::vector<NodeID> filtered;
+        for (auto const& e : envs)
+        {
+            if (filter(e.second->getStatement()))
+            {
+                filtered.emplace_back(e.first);
+            }
+        }
+        REQUIRE(LocalNode::isVBlocking(qSet, envs, filter) ==
+                LocalNode::isVBlocking(qSet, filtered));
+
+        bool removed;
+        do
+        {
+            removed = false;
+            std::vector<NodeID> next;
+            for (auto const& id : filtered)
+            {
+                if (LocalNode::isQuorumSlice(qSets.at(id), filtered))
+                {
+                    next.emplace_back(id);
+                }
+            }
+            removed = next.size() != filtered.size();
+            filtered = next;
+        } while (removed);
+        REQUIRE(LocalNode::isQuorum(qSet, envs, qfun, filter) ==
+                LocalNode::isQuorumSlice(qSet, filtered));
+    }
+}
+
 TEST_CASE("v blocking distance", "[scp]")
 {
     setupValues();
@@ -24,6 +24,8 @@
 #include "util/Math.h"
 #include "util/types.h"
 #include "xdrpp/autocheck.h"
+#include <algorithm>
+#include <ctime>
 #include <fmt/format.h>
 #include <sstream>
 
@@ -660,6 +662,92 @@ TEST_CASE("Branched cycle nodes vs network traffic", "[scalability][!hide]")
     });
 }
 
+// Runs empty ledgers on a core of validators with outer nodes around it, so
+// that closing a ledger costs next to nothing and what grows with the size of
+// the network is consensus itself. Reports, as seen from a core node, the SCP
+// envelopes received per slot and the time from nomination to externalizing,
+// along with the process CPU time spent per node and ledger (all nodes share
+// the main thread in loopback mode).
+static void
+scpScalingTest(std::string const& name,
+               std::function<int(int numNodes)> getCoreSize)
+{
+    ScaleReporter r({name + "nodes", "envelopes-per-slot",
+                     "cpu-ms-per-node-ledger", "nominate-ms",
+                     "externalize-ms"});
+
+    for (int numNodes : {10, 25, 50, 100, 250, 500})
+    {
+        int coreSize = getCoreSize(numNodes);
+        auto sim = Topologies::hierarchicalQuorumSimplified(
+            coreSize, numNodes - coreSize, Simulation::OVER_LOOPBACK,
+            sha256(fmt::format("scp-{:s}-{:d}", name, numNodes)),
+            [](int cfgCount) -> Config {
+                Config res = getTestConfig(cfgCount);
+                res.ARTIFICIALLY_ACCELERATE_TIME_FOR_TESTING = true;
+                res.TARGET_PEER_CONNECTIONS = 1000;
+                res.MAX_ADDITIONAL_PEER_CONNECTIONS = 1000;
+                return res;
+            });
+        sim->startAllNodes();
+
+        // Let the network settle before measuring
+        uint32_t const warmup = 3;
+        uint32_t const ledgers = 10;
+        sim->crankUntil([&]() { return sim->haveAllExternalized(warmup, 2); },
+                        2 * warmup * Herder::EXP_LEDGER_TIMESPAN_SECONDS,
+                        false);
+        REQUIRE(sim->haveAllExternalized(warmup, 2));
+
+        // Outer nodes also list themselves in their qset
+        auto nodes = sim->getNodes();
+        auto coreNode = std::find_if(nodes.begin(), nodes.end(), [&](auto n) {
+            return n->getConfig().QUORUM_SET.validators.size() ==
+                   static_cast<size_t>(coreSize);
+        });
+        REQUIRE(coreNode != nodes.end());
+        auto& app = **coreNode;
+        auto& envelopes = app.getMetrics().NewMeter(
+            {"scp", "envelope", "receive"}, "envelope");
+        auto& nominated =
+            app.getMetrics().NewTimer({"scp", "timing", "nominated"});
+        auto& externalized =
+            app.getMetrics().NewTimer({"scp", "timing", "externalized"});
+        auto startEnvelopes = envelopes.count();
+        nominated.Clear();
+        externalized.Clear();
+
+        auto startCPU = std::clock();
+        sim->crankUntil(
+            [&]() { return sim->haveAllExternalized(warmup + ledgers, 2); },
+            2 * ledgers * Herder::EXP_LEDGER_TIMESPAN_SECONDS, false);
+        auto cpu = std::clock() - startCPU;
+        REQUIRE(sim->haveAllExternalized(warmup + ledgers, 2));
+
+        double cpuMs = 1000.0 * static_cast<double>(cpu) / CLOCKS_PER_SEC;
+        r.write({(double)numNodes,
+                 (double)(envelopes.count() - startEnvelopes) / ledgers,
+                 cpuMs / numNodes / ledgers, nominated.mean(),
+                 externalized.mean()});
+    }
+}
+
+TEST_CASE("Validator count vs SCP cost", "[scalability][!hide]")
+{
+    SECTION("fixed core")
+    {
+        // Only the watchers grow: the qset stays the same
+        scpScalingTest("fixedcore", [](int) { return 7; });
+    }
+    SECTION("growing core")
+    {
+        // A tenth of the network validates, so the qset widens with it
+        scpScalingTest("growingcore", [](int numNodes) {
+            return std::max(4, numNodes / 10);
+        });
+    }
+}
+
 TEST_CASE("Bucket list entries vs write throughput", "[scalability][!hide]")
 {
     VirtualClock clock;
@@ -7,10 +7,12 @@
 #include "ledger/LedgerManager.h"
 #include "ledger/LedgerTxn.h"
 #include "ledger/LedgerTxnEntry.h"
+#include "ledger/TrustLineWrapper.h"
 #include "main/Config.h"
 #include "overlay/OverlayManager.h"
 #include "test/TestAccount.h"
 #include "test/TxTests.h"
+#include "transactions/OfferExchange.h"
 #include "transactions/TransactionBridge.h"
 #include "transactions/TransactionSQL.h"
 #include "transactions/TransactionUtils.h"
@@ -28,13 +30,17 @@
 
 #include "medida/meter.h"
 #include "medida/metrics_registry.h"
+#include "medida/timer.h"
 
 #include "ledger/test/LedgerTestUtils.h"
 #include <Tracy.hpp>
+#include <algorithm>
 #include <cmath>
 #include <crypto/SHA.h>
 #include <fmt/format.h>
 #include <iomanip>
+#include <numeric>
+#include <random>
 #include <set>
 
 namespace stellar
@@ -53,6 +59,33 @@ constexpr uint32_t DEFAULT_IO_KILOBYTES = 1;
 constexpr uint32_t DEFAULT_TX_SIZE_BYTES = 256;
 constexpr uint64_t DEFAULT_INSTRUCTIONS = 28'000'000;
 
+// DEX_STRESS books: price levels are 1/DEX_PRICE_DENOMINATOR apart, starting
+// just above 1 on both sides of every pair, so that no book crosses itself
+constexpr int32_t DEX_PRICE_DENOMINATOR = 100;
+constexpr int64_t DEX_OFFER_AMOUNT = 10'000'000'000;
+// Most a DEX_STRESS transaction trades, small enough for loadgen accounts
+constexpr int64_t DEX_TRADE_AMOUNT = 10'000'000;
+constexpr int64_t DEX_POOL_RESERVE = 1'000'000'000'000;
+constexpr int64_t DEX_MARKET_MAKER_BALANCE = 100 * DEX_POOL_RESERVE;
+constexpr uint32_t DEX_MAX_ASSETS = 20;
+// Longest path a path payment supports
+constexpr uint32_t DEX_MAX_PATH_LENGTH = 5;
+// Accounts churn their own resting offers on an asset once they have this many
+constexpr size_t DEX_MAX_CHURN_OFFERS = 4;
+
+// Upper bound on the size of a SOROBAN_STATE entry, and rough instruction
+// costs of its invocations
+constexpr uint32_t STATE_ENTRY_BYTES = 200;
+constexpr uint64_t STATE_BASE_INSTRUCTIONS = 2'000'000;
+constexpr uint64_t STATE_INSTRUCTIONS_PER_ENTRY = 50'000;
+
+Price
+dexPriceLevel(uint32_t level)
+{
+    return Price{DEX_PRICE_DENOMINATOR + static_cast<int32_t>(level),
+                 DEX_PRICE_DENOMINATOR};
+}
+
 // Sample from a discrete distribution of `values` with weights `weights`.
 // Returns `defaultValue` if `values` is empty.
 template <typename T>
@@ -100,6 +133,14 @@ LoadGenerator::LoadGenerator(Application& app)
           mApp.getMetrics().NewMeter({"loadgen", "run", "complete"}, "run"))
     , mLoadgenFail(
           mApp.getMetrics().NewMeter({"loadgen", "run", "failed"}, "run"))
+    , mConfirmationLatency(
+          mApp.getMetrics().NewTimer({"loadgen", "txn", "latency"}))
+    , mTxnConfirmed(
+          mApp.getMetrics().NewMeter({"loadgen", "txn", "confirmed"}, "txn"))
+    , mTxnUnconfirmed(
+          mApp.getMetrics().NewMeter({"loadgen", "txn", "unconfirmed"}, "txn"))
+    , mTxnDropped(
+          mApp.getMetrics().NewMeter({"loadgen", "txn", "dropped"}, "txn"))
     , mApplySorobanSuccess(
           mApp.getMetrics().NewCounter({"ledger", "apply-soroban", "success"}))
     , mApplySorobanFailure(
@@ -150,6 +191,22 @@ LoadGenerator::getMode(std::string const& mode)
     {
         return LoadGenMode::MIXED_CLASSIC_SOROBAN;
     }
+    else if (mode == "dex_stress_setup")
+    {
+        return LoadGenMode::DEX_STRESS_SETUP;
+    }
+    else if (mode == "dex_stress")
+    {
+        return LoadGenMode::DEX_STRESS;
+    }
+    else if (mode == "soroban_state_setup")
+    {
+        return LoadGenMode::SOROBAN_STATE_SETUP;
+    }
+    else if (mode == "soroban_state")
+    {
+        return LoadGenMode::SOROBAN_STATE;
+    }
     else
     {
         throw std::runtime_error(
@@ -243,6 +300,54 @@ LoadGenerator::getTxPerStep(uint32_t txRate, std::chrono::seconds spikeInterval,
     return txs - mTotalSubmitted;
 }
 
+// Open-loop arrivals are a Poisson process at txRate, plus spikeSize
+// transactions at the end of every spike interval. Arrivals are due whether
+// or not earlier ones made it in, so a slow step only makes the next one
+// bigger.
+std::vector<VirtualClock::time_point>
+LoadGenerator::getOpenLoopArrivals(GeneratedLoadConfig const& cfg)
+{
+    if (!mStartTime)
+    {
+        throw std::runtime_error("Load generation start time must be set");
+    }
+
+    auto& stepMeter =
+        mApp.getMetrics().NewMeter({"loadgen", "step", "count"}, "step");
+    stepMeter.Mark();
+
+    auto now = mApp.getClock().now();
+    std::vector<VirtualClock::time_point> arrivals;
+    if (cfg.spikeInterval.count() > 0)
+    {
+        auto spikes = (now - *mStartTime) / cfg.spikeInterval;
+        for (; mSpikesInjected < spikes; ++mSpikesInjected)
+        {
+            arrivals.insert(arrivals.end(), cfg.spikeSize,
+                            *mStartTime +
+                                cfg.spikeInterval * (mSpikesInjected + 1));
+        }
+    }
+
+    std::exponential_distribution<double> interArrival(cfg.txRate);
+    auto nextInterArrival = [&]() {
+        return std::chrono::duration_cast<VirtualClock::duration>(
+            std::chrono::duration<double>(interArrival(gRandomEngine)));
+    };
+    if (!mNextArrival)
+    {
+        mNextArrival = *mStartTime + nextInterArrival();
+    }
+    while (*mNextArrival <= now)
+    {
+        arrivals.emplace_back(*mNextArrival);
+        *mNextArrival += nextInterArrival();
+    }
+
+    std::sort(arrivals.begin(), arrivals.end());
+    return arrivals;
+}
+
 void
 LoadGenerator::cleanupAccounts()
 {
@@ -294,6 +399,10 @@ LoadGenerator::reset()
     mRoot.reset();
     mStartTime.reset();
     mTotalSubmitted = 0;
+    mNextArrival.reset();
+    mSpikesInjected = 0;
+    mDexMarketMaker.reset();
+    mDexSetupTxs.clear();
     mWaitTillCompleteForLedgers = 0;
     mSorobanWasmWaitTillLedgers = 0;
     mFailed = false;
@@ -310,6 +419,9 @@ LoadGenerator::resetSorobanState()
     mContractInstanceKeys.clear();
     mCodeKey.reset();
     mContactOverheadBytes = 0;
+    mStateContract = false;
+    mStatePersistentEntries = 0;
+    mStateTemporaryEntries = 0;
 }
 
 void
@@ -327,15 +439,30 @@ LoadGenerator::start(GeneratedLoadConfig& cfg)
         cfg.txRate = 1;
     }
 
+    if (cfg.openLoop)
+    {
+        if (cfg.isLoad())
+        {
+            // Like skipped txs, dropped ones leave the final seq nums
+            // unknown
+            cfg.skipLowFeeTxs = true;
+        }
+        else
+        {
+            cfg.openLoop = false;
+        }
+    }
+
     // Setup config for soroban modes
     if (cfg.isSoroban() && cfg.mode != LoadGenMode::SOROBAN_UPLOAD)
     {
         auto& sorobanLoadCfg = cfg.getMutSorobanConfig();
         sorobanLoadCfg.nWasms = 1;
 
-        if (cfg.mode == LoadGenMode::SOROBAN_UPGRADE_SETUP)
+        if (cfg.mode == LoadGenMode::SOROBAN_UPGRADE_SETUP ||
+            cfg.mode == LoadGenMode::SOROBAN_STATE_SETUP)
         {
-            // Only deploy single upgrade contract instance
+            // Only deploy single upgrade or state contract instance
             sorobanLoadCfg.nInstances = 1;
         }
 
@@ -373,6 +500,29 @@ LoadGenerator::start(GeneratedLoadConfig& cfg)
         }
     }
 
+    if (cfg.isDexSetup())
+    {
+        mDexAssets = 0;
+        mDexBookDepth = 0;
+        buildDexSetupTxs(cfg);
+        cfg.nTxs = static_cast<uint32_t>(mDexSetupTxs.size());
+
+        // Must include all TXs, which go out one at a time
+        cfg.skipLowFeeTxs = false;
+        cfg.spikeInterval = std::chrono::seconds(0);
+        cfg.spikeSize = 0;
+    }
+    else if (cfg.mode == LoadGenMode::DEX_STRESS)
+    {
+        auto& dexCfg = cfg.getMutDexStressConfig();
+        dexCfg.nAssets = mDexAssets;
+        dexCfg.bookDepth = mDexBookDepth;
+        dexCfg.maxPathLength =
+            std::clamp(dexCfg.maxPathLength, 1u,
+                       std::max(1u, std::min(dexCfg.nAssets,
+                                             DEX_MAX_PATH_LENGTH)));
+    }
+
     if (cfg.mode != LoadGenMode::CREATE)
     {
         // Mark all accounts "available" as source accounts
@@ -439,7 +589,8 @@ LoadGenerator::scheduleLoadGeneration(GeneratedLoadConfig cfg)
 
     // During load submission, we must have enough unique source accounts (with
     // a buffer) to accommodate the desired tx rate.
-    if (cfg.mode != LoadGenMode::CREATE && cfg.nTxs > cfg.nAccounts &&
+    if (cfg.mode != LoadGenMode::CREATE && !cfg.isDexSetup() &&
+        cfg.nTxs > cfg.nAccounts &&
         (cfg.txRate * Herder::EXP_LEDGER_TIMESPAN_SECONDS.count()) *
                 MIN_UNIQUE_ACCOUNT_MULTIPLIER >
             cfg.nAccounts)
@@ -465,7 +616,7 @@ LoadGenerator::scheduleLoadGeneration(GeneratedLoadConfig cfg)
         auto const& sorobanLoadCfg = cfg.getSorobanConfig();
         releaseAssertOrThrow(sorobanLoadCfg.nInstances != 0);
         if (mContractInstanceKeys.size() < sorobanLoadCfg.nInstances ||
-            !mCodeKey)
+            !mCodeKey || mStateContract)
         {
             errorMsg = "must run SOROBAN_INVOKE_SETUP with at least nInstances";
         }
@@ -518,7 +669,8 @@ LoadGenerator::scheduleLoadGeneration(GeneratedLoadConfig cfg)
 bool
 GeneratedLoadConfig::isDone() const
 {
-    return (isCreate() && nAccounts == 0) || (isLoad() && nTxs == 0) ||
+    return (isCreate() && nAccounts == 0) ||
+           ((isLoad() || isDexSetup()) && nTxs == 0) ||
            (isSorobanSetup() && getSorobanConfig().nInstances == 0);
 }
 
@@ -565,6 +717,18 @@ GeneratedLoadConfig::getStatus() const
     case LoadGenMode::MIXED_CLASSIC_SOROBAN:
         modeStr = "mixed_classic_soroban";
         break;
+    case LoadGenMode::DEX_STRESS_SETUP:
+        modeStr = "dex_stress_setup";
+        break;
+    case LoadGenMode::DEX_STRESS:
+        modeStr = "dex_stress";
+        break;
+    case LoadGenMode::SOROBAN_STATE_SETUP:
+        modeStr = "soroban_state_setup";
+        break;
+    case LoadGenMode::SOROBAN_STATE:
+        modeStr = "soroban_state";
+        break;
     }
 
     ret["mode"] = modeStr;
@@ -607,6 +771,36 @@ GeneratedLoadConfig::getStatus() const
         ret["min_soroban_percent_success"] = mMinSorobanPercentSuccess;
     }
 
+    if (isDexSetup())
+    {
+        ret["assets"] = getDexStressConfig().nAssets;
+        ret["book_depth"] = getDexStressConfig().bookDepth;
+    }
+    else if (mode == LoadGenMode::DEX_STRESS)
+    {
+        auto const& dexCfg = getDexStressConfig();
+        ret["max_path_length"] = dexCfg.maxPathLength;
+        ret["cross_weight"] = dexCfg.crossWeight;
+        ret["path_weight"] = dexCfg.pathWeight;
+        ret["churn_weight"] = dexCfg.churnWeight;
+    }
+    else if (mode == LoadGenMode::SOROBAN_STATE)
+    {
+        auto const& stateCfg = getSorobanStateConfig();
+        ret["create_weight"] = stateCfg.createWeight;
+        ret["read_weight"] = stateCfg.readWeight;
+        ret["write_weight"] = stateCfg.writeWeight;
+        ret["extend_weight"] = stateCfg.extendWeight;
+        ret["restore_weight"] = stateCfg.restoreWeight;
+        ret["temporary_percent"] = stateCfg.temporaryPercent;
+        ret["footprint_entries"] = stateCfg.footprintEntries;
+    }
+
+    if (openLoop)
+    {
+        ret["open_loop"] = true;
+    }
+
     return ret;
 }
 
@@ -621,6 +815,23 @@ LoadGenerator::generateLoad(GeneratedLoadConfig cfg)
 
     start(cfg);
 
+    if (auto errorMsg = checkDexConfig(cfg))
+    {
+        CLOG_ERROR(LoadGen, "{}", *errorMsg);
+        emitFailure(false);
+        return;
+    }
+
+    // Checked before the first step, which would otherwise pick entries of a
+    // contract that isn't there
+    if (cfg.mode == LoadGenMode::SOROBAN_STATE &&
+        (!mStateContract || mContractInstanceKeys.size() != 1 || !mCodeKey))
+    {
+        CLOG_ERROR(LoadGen, "must run SOROBAN_STATE_SETUP");
+        emitFailure(false);
+        return;
+    }
+
     // Finish if no more txs need to be created.
     if (!cfg.areTxsRemaining())
     {
@@ -641,7 +852,17 @@ LoadGenerator::generateLoad(GeneratedLoadConfig cfg)
 
     updateMinBalance();
 
-    auto txPerStep = getTxPerStep(cfg.txRate, cfg.spikeInterval, cfg.spikeSize);
+    std::vector<VirtualClock::time_point> arrivals;
+    int64_t txPerStep = 0;
+    if (cfg.openLoop)
+    {
+        arrivals = getOpenLoopArrivals(cfg);
+        txPerStep = static_cast<int64_t>(arrivals.size());
+    }
+    else
+    {
+        txPerStep = getTxPerStep(cfg.txRate, cfg.spikeInterval, cfg.spikeSize);
+    }
     if (cfg.mode == LoadGenMode::CREATE)
     {
         // Limit creation to the number of accounts we have. This is only the
@@ -664,6 +885,7 @@ LoadGenerator::generateLoad(GeneratedLoadConfig cfg)
     }
 
     uint32_t ledgerNum = mApp.getLedgerManager().getLastClosedLedgerNum() + 1;
+    auto stepStart = mApp.getClock().now();
 
     for (int64_t i = 0; i < txPerStep; ++i)
     {
@@ -672,8 +894,37 @@ LoadGenerator::generateLoad(GeneratedLoadConfig cfg)
             cfg.nAccounts =
                 submitCreationTx(cfg.nAccounts, cfg.offset, ledgerNum);
         }
+        else if (cfg.isDexSetup())
+        {
+            if (dexSetupPending())
+            {
+                // Each setup transaction depends on the previous one
+                break;
+            }
+            if (submitTx(
+                    cfg, [&]() { return dexSetupTransaction(cfg); },
+                    stepStart))
+            {
+                --cfg.nTxs;
+            }
+            else if (mFailed)
+            {
+                break;
+            }
+        }
         else
         {
+            if (mAccountsAvailable.empty() && cfg.openLoop)
+            {
+                // Every source account has a transaction in flight
+                mTxnDropped.Mark();
+                --cfg.nTxs;
+                if (!cfg.areTxsRemaining())
+                {
+                    break;
+                }
+                continue;
+            }
             if (mAccountsAvailable.empty())
             {
                 CLOG_WARNING(
@@ -745,6 +996,7 @@ LoadGenerator::generateLoad(GeneratedLoadConfig cfg)
             break;
             case LoadGenMode::SOROBAN_INVOKE_SETUP:
             case LoadGenMode::SOROBAN_UPGRADE_SETUP:
+            case LoadGenMode::SOROBAN_STATE_SETUP:
                 generateTx = [&] {
                     auto& sorobanCfg = cfg.getMutSorobanConfig();
                     if (sorobanCfg.nWasms != 0)
@@ -779,9 +1031,25 @@ LoadGenerator::generateLoad(GeneratedLoadConfig cfg)
                         ledgerNum, sourceAccountId, cfg);
                 };
                 break;
+            case LoadGenMode::DEX_STRESS_SETUP:
+                releaseAssert(false);
+                break;
+            case LoadGenMode::DEX_STRESS:
+                generateTx = [&]() {
+                    return dexStressTransaction(ledgerNum, sourceAccountId,
+                                                cfg);
+                };
+                break;
+            case LoadGenMode::SOROBAN_STATE:
+                generateTx = [&]() {
+                    return sorobanStateTransaction(ledgerNum, sourceAccountId,
+                                                   cfg);
+                };
+                break;
             }
 
-            if (submitTx(cfg, generateTx))
+            auto arrival = cfg.openLoop ? arrivals[i] : stepStart;
+            if (submitTx(cfg, generateTx, arrival))
             {
                 --cfg.nTxs;
             }
@@ -789,6 +1057,12 @@ LoadGenerator::generateLoad(GeneratedLoadConfig cfg)
             {
                 break;
             }
+            else if (cfg.openLoop)
+            {
+                // Arrivals the node pushed back on are not retried
+                mTxnDropped.Mark();
+                --cfg.nTxs;
+            }
         }
         if (cfg.nAccounts == 0 || !cfg.areTxsRemaining())
         {
@@ -861,7 +1135,8 @@ bool
 LoadGenerator::submitTx(GeneratedLoadConfig const& cfg,
                         std::function<std::pair<LoadGenerator::TestAccountPtr,
                                                 TransactionFramePtr>()>
-                            generateTx)
+                            generateTx,
+                        VirtualClock::time_point arrival)
 {
     auto [from, tx] = generateTx();
 
@@ -900,6 +1175,7 @@ LoadGenerator::submitTx(GeneratedLoadConfig const& cfg,
         std::tie(from, tx) = generateTx();
     }
 
+    mPendingConfirmation.emplace(tx->getFullHash(), arrival);
     return true;
 }
 
@@ -978,6 +1254,17 @@ LoadGenerator::logProgress(std::chrono::nanoseconds submitTimer,
                   etaMins);
     }
 
+    if (mTxnConfirmed.count() > 0)
+    {
+        auto snapshot = mConfirmationLatency.GetSnapshot();
+        CLOG_INFO(LoadGen,
+                  "Confirmed: {} tx/s (1m EWMA), latency {}ms p50, {}ms p99, "
+                  "{}ms p999. Dropped: {} txs.",
+                  mTxnConfirmed.one_minute_rate(), snapshot.getMedian(),
+                  snapshot.get99thPercentile(), snapshot.get999thPercentile(),
+                  mTxnDropped.count());
+    }
+
     CLOG_DEBUG(LoadGen, "Step timing: {}ms submit.", submitSteps);
 
     TxMetrics txm(mApp.getMetrics());
@@ -1185,8 +1472,20 @@ LoadGenerator::createUploadWasmTransaction(uint32_t ledgerNum,
 {
     releaseAssert(cfg.isSorobanSetup());
     releaseAssert(!mCodeKey);
-    auto wasm = cfg.modeSetsUpInvoke() ? rust_bridge::get_test_wasm_loadgen()
-                                       : rust_bridge::get_write_bytes();
+    mStateContract = cfg.mode == LoadGenMode::SOROBAN_STATE_SETUP;
+    RustBuf wasm;
+    if (cfg.modeSetsUpInvoke())
+    {
+        wasm = rust_bridge::get_test_wasm_loadgen();
+    }
+    else if (mStateContract)
+    {
+        wasm = rust_bridge::get_test_wasm_contract_data();
+    }
+    else
+    {
+        wasm = rust_bridge::get_write_bytes();
+    }
     auto account = findAccount(accountId, ledgerNum);
 
     SorobanResources uploadResources{};
@@ -1395,6 +1694,167 @@ LoadGenerator::invokeSorobanLoadTransaction(uint32_t ledgerNum,
     return std::make_pair(account, tx);
 }
 
+std::pair<LoadGenerator::TestAccountPtr, TransactionFramePtr>
+LoadGenerator::sorobanStateTransaction(uint32_t ledgerNum, uint64_t accountId,
+                                       GeneratedLoadConfig const& cfg)
+{
+    releaseAssert(mStateContract && mCodeKey);
+    releaseAssert(mContractInstanceKeys.size() == 1);
+    auto const& stateCfg = cfg.getSorobanStateConfig();
+    auto const& networkCfg = mApp.getLedgerManager().getSorobanNetworkConfig();
+    auto account = findAccount(accountId, ledgerNum);
+    auto const& instanceLK = *mContractInstanceKeys.begin();
+    auto const& contractID = instanceLK.contractData().contract;
+
+    auto persistentKey = [&](uint64_t i) {
+        return contractDataKey(contractID,
+                               makeSymbolSCVal(fmt::format("p{}", i)),
+                               ContractDataDurability::PERSISTENT);
+    };
+    // Distinct persistent entries among the first `limit` created, as many
+    // as fit in the footprint along with the contract
+    auto pickEntries = [&](uint64_t limit) {
+        uint64_t maxEntries =
+            std::min(networkCfg.txMaxReadLedgerEntries(),
+                     networkCfg.txMaxWriteLedgerEntries() + 2);
+        maxEntries = std::max<uint64_t>(maxEntries, 3) - 2;
+        auto n = std::min({limit, maxEntries,
+                           std::max<uint64_t>(stateCfg.footprintEntries, 1)});
+        std::set<uint64_t> picked;
+        while (picked.size() < n)
+        {
+            picked.emplace(rand_uniform<uint64_t>(0, limit - 1));
+        }
+        xdr::xvector<LedgerKey> keys;
+        for (auto i : picked)
+        {
+            keys.emplace_back(persistentKey(i));
+        }
+        return keys;
+    };
+
+    std::discrete_distribution<uint32_t> dist(
+        {stateCfg.createWeight, stateCfg.readWeight, stateCfg.writeWeight,
+         stateCfg.extendWeight, stateCfg.restoreWeight});
+    // Everything but creation needs entries to work on
+    auto kind = mStatePersistentEntries == 0 ? 0 : dist(gRandomEngine);
+
+    SorobanResources resources;
+    Operation op;
+    switch (kind)
+    {
+    case 0:
+    case 2:
+    {
+        // Create a new entry, or rewrite an existing persistent one
+        auto durability = ContractDataDurability::PERSISTENT;
+        std::string key;
+        if (kind == 2)
+        {
+            key = fmt::format(
+                "p{}", rand_uniform<uint64_t>(0, mStatePersistentEntries - 1));
+        }
+        else if (rand_uniform<uint32_t>(1, 100) <= stateCfg.temporaryPercent)
+        {
+            durability = ContractDataDurability::TEMPORARY;
+            key = fmt::format("t{}", mStateTemporaryEntries++);
+        }
+        else
+        {
+            key = fmt::format("p{}", mStatePersistentEntries++);
+        }
+
+        op.body.type(INVOKE_HOST_FUNCTION);
+        auto& ihf = op.body.invokeHostFunctionOp().hostFunction;
+        ihf.type(HOST_FUNCTION_TYPE_INVOKE_CONTRACT);
+        ihf.invokeContract().contractAddress = contractID;
+        ihf.invokeContract().functionName =
+            durability == ContractDataDurability::TEMPORARY ? "put_temporary"
+                                                            : "put_persistent";
+        ihf.invokeContract().args = {
+            makeSymbolSCVal(key),
+            makeU64(rand_uniform<uint64_t>(0, UINT64_MAX))};
+
+        resources.footprint.readOnly = {instanceLK, *mCodeKey};
+        resources.footprint.readWrite = {
+            contractDataKey(contractID, makeSymbolSCVal(key), durability)};
+        resources.instructions =
+            STATE_BASE_INSTRUCTIONS + STATE_INSTRUCTIONS_PER_ENTRY;
+        resources.readBytes = mContactOverheadBytes + STATE_ENTRY_BYTES;
+        resources.writeBytes = STATE_ENTRY_BYTES;
+        break;
+    }
+    case 1:
+    {
+        // Load a large footprint, although the contract only looks at one of
+        // its entries
+        auto keys = pickEntries(mStatePersistentEntries);
+        op.body.type(INVOKE_HOST_FUNCTION);
+        auto& ihf = op.body.invokeHostFunctionOp().hostFunction;
+        ihf.type(HOST_FUNCTION_TYPE_INVOKE_CONTRACT);
+        ihf.invokeContract().contractAddress = contractID;
+        ihf.invokeContract().functionName = "has_persistent";
+        ihf.invokeContract().args = {keys.front().contractData().key};
+
+        resources.footprint.readOnly = {instanceLK, *mCodeKey};
+        resources.footprint.readOnly.insert(resources.footprint.readOnly.end(),
+                                            keys.begin(), keys.end());
+        resources.instructions = STATE_BASE_INSTRUCTIONS +
+                                 STATE_INSTRUCTIONS_PER_ENTRY * keys.size();
+        resources.readBytes =
+            mContactOverheadBytes + STATE_ENTRY_BYTES * keys.size();
+        break;
+    }
+    case 3:
+    {
+        // Keeps the contract live too
+        auto keys = pickEntries(mStatePersistentEntries);
+        op.body.type(EXTEND_FOOTPRINT_TTL);
+        op.body.extendFootprintTTLOp().extendTo =
+            networkCfg.stateArchivalSettings().minPersistentTTL;
+        resources.footprint.readOnly = {instanceLK, *mCodeKey};
+        resources.footprint.readOnly.insert(resources.footprint.readOnly.end(),
+                                            keys.begin(), keys.end());
+        resources.readBytes =
+            mContactOverheadBytes + STATE_ENTRY_BYTES * keys.size();
+        break;
+    }
+    case 4:
+    {
+        // The oldest entries are the most likely to have been archived
+        op.body.type(RESTORE_FOOTPRINT);
+        resources.footprint.readWrite =
+            pickEntries((mStatePersistentEntries + 1) / 2);
+        resources.readBytes =
+            STATE_ENTRY_BYTES * resources.footprint.readWrite.size();
+        resources.writeBytes = resources.readBytes;
+        break;
+    }
+    default:
+        releaseAssert(false);
+    }
+
+    // Like in invokeSorobanLoadTransaction, slightly overestimate the tx size
+    // and leave room for rent
+    uint32_t constexpr baselineTxOverheadBytes = 260;
+    auto entries = resources.footprint.readOnly.size() +
+                   resources.footprint.readWrite.size();
+    auto resourceFee = sorobanResourceFee(
+        mApp, resources, baselineTxOverheadBytes + xdr::xdr_size(op) +
+                             xdr::xdr_size(resources),
+        40);
+    resourceFee += 1'000'000 + 100'000 * entries;
+
+    auto tx = std::dynamic_pointer_cast<TransactionFrame>(
+        sorobanTransactionFrameFromOps(
+            mApp.getNetworkID(), *account, {op}, {}, resources,
+            generateFee(cfg.maxGeneratedFeeRate, mApp,
+                        /* opsCnt */ 1),
+            resourceFee));
+
+    return std::make_pair(account, tx);
+}
+
 ConfigUpgradeSetKey
 LoadGenerator::getConfigUpgradeSetKey(GeneratedLoadConfig const& cfg) const
 {
@@ -1786,6 +2246,232 @@ LoadGenerator::createMixedClassicSorobanTransaction(
     }
 }
 
+Asset
+LoadGenerator::getDexAsset(uint32_t i) const
+{
+    if (i == 0)
+    {
+        return txtest::makeNativeAsset();
+    }
+    releaseAssert(mRoot);
+    return txtest::makeAsset(mRoot->getSecretKey(), fmt::format("DX{:02}", i));
+}
+
+std::optional<std::string>
+LoadGenerator::checkDexConfig(GeneratedLoadConfig const& cfg) const
+{
+    if (cfg.isDexSetup())
+    {
+        auto const& dexCfg = cfg.getDexStressConfig();
+        if (dexCfg.nAssets == 0 || dexCfg.nAssets > DEX_MAX_ASSETS)
+        {
+            return fmt::format("DEX_STRESS_SETUP needs 1 to {} assets",
+                               DEX_MAX_ASSETS);
+        }
+        // The root account holds every book offer
+        uint64_t pairs = dexCfg.nAssets * (dexCfg.nAssets + 1) / 2;
+        if (dexCfg.bookDepth == 0 ||
+            pairs * 2 * dexCfg.bookDepth > getAccountSubEntryLimit() / 2)
+        {
+            return "DEX_STRESS_SETUP book depth must be positive, and small "
+                   "enough for the root account to hold all book offers";
+        }
+    }
+    else if (cfg.mode == LoadGenMode::DEX_STRESS)
+    {
+        auto const& dexCfg = cfg.getDexStressConfig();
+        if (dexCfg.nAssets == 0)
+        {
+            return "must run DEX_STRESS_SETUP first";
+        }
+        if (dexCfg.crossWeight + dexCfg.pathWeight + dexCfg.churnWeight == 0)
+        {
+            return "at least one DEX_STRESS weight must be non-zero";
+        }
+    }
+    return std::nullopt;
+}
+
+// The root account issues the assets and makes the books, with offers at
+// bookDepth price levels on both sides of every pair. It can't fund pools
+// with its own assets though, so a market maker account does that.
+void
+LoadGenerator::buildDexSetupTxs(GeneratedLoadConfig const& cfg)
+{
+    auto const& dexCfg = cfg.getDexStressConfig();
+    mDexSetupTxs.clear();
+    mDexMarketMaker = std::make_shared<TestAccount>(
+        mApp, txtest::getAccount("DexMarketMaker"), 0);
+    auto native = getDexAsset(0);
+
+    std::vector<Operation> trustOps;
+    std::vector<Operation> fundOps;
+    std::vector<Operation> depositOps;
+    for (uint32_t i = 1; i <= dexCfg.nAssets; ++i)
+    {
+        auto asset = getDexAsset(i);
+        ChangeTrustAsset poolAsset;
+        poolAsset.type(ASSET_TYPE_POOL_SHARE);
+        auto& params = poolAsset.liquidityPool().constantProduct();
+        params.assetA = native;
+        params.assetB = asset;
+        params.fee = LIQUIDITY_POOL_FEE_V18;
+
+        trustOps.emplace_back(txtest::changeTrust(asset, INT64_MAX));
+        trustOps.emplace_back(txtest::changeTrust(poolAsset, INT64_MAX));
+        fundOps.emplace_back(txtest::payment(mDexMarketMaker->getPublicKey(),
+                                             asset, DEX_POOL_RESERVE));
+        depositOps.emplace_back(txtest::liquidityPoolDeposit(
+            getPoolID(native, asset, LIQUIDITY_POOL_FEE_V18), DEX_POOL_RESERVE,
+            DEX_POOL_RESERVE, Price{1, 1}, Price{1, 1}));
+    }
+
+    mDexSetupTxs.emplace_back(
+        mRoot, std::vector<Operation>{txtest::createAccount(
+                   mDexMarketMaker->getPublicKey(), DEX_MARKET_MAKER_BALANCE)});
+    mDexSetupTxs.emplace_back(mDexMarketMaker, trustOps);
+    mDexSetupTxs.emplace_back(mRoot, fundOps);
+    mDexSetupTxs.emplace_back(mDexMarketMaker, depositOps);
+
+    std::vector<Operation> offerOps;
+    for (uint32_t x = 0; x <= dexCfg.nAssets; ++x)
+    {
+        for (uint32_t y = x + 1; y <= dexCfg.nAssets; ++y)
+        {
+            auto assetX = getDexAsset(x);
+            auto assetY = getDexAsset(y);
+            for (uint32_t level = 1; level <= dexCfg.bookDepth; ++level)
+            {
+                offerOps.emplace_back(txtest::manageOffer(
+                    0, assetX, assetY, dexPriceLevel(level), DEX_OFFER_AMOUNT));
+                offerOps.emplace_back(txtest::manageOffer(
+                    0, assetY, assetX, dexPriceLevel(level), DEX_OFFER_AMOUNT));
+            }
+        }
+    }
+    for (size_t i = 0; i < offerOps.size(); i += MAX_OPS_PER_TX)
+    {
+        auto end = std::min(offerOps.size(), i + MAX_OPS_PER_TX);
+        mDexSetupTxs.emplace_back(
+            mRoot, std::vector<Operation>(offerOps.begin() + i,
+                                          offerOps.begin() + end));
+    }
+}
+
+bool
+LoadGenerator::dexSetupPending() const
+{
+    auto& herder = mApp.getHerder();
+    return herder.sourceAccountPending(mRoot->getPublicKey()) ||
+           herder.sourceAccountPending(mDexMarketMaker->getPublicKey());
+}
+
+std::pair<LoadGenerator::TestAccountPtr, TransactionFramePtr>
+LoadGenerator::dexSetupTransaction(GeneratedLoadConfig const& cfg)
+{
+    releaseAssert(cfg.nTxs > 0 && cfg.nTxs <= mDexSetupTxs.size());
+    auto const& [source, ops] = mDexSetupTxs[mDexSetupTxs.size() - cfg.nTxs];
+    if (source == mDexMarketMaker && !loadAccount(source, mApp))
+    {
+        throw std::runtime_error("DEX market maker account must exist");
+    }
+    return std::make_pair(
+        source, createTransactionFramePtr(
+                    source, ops, LoadGenMode::DEX_STRESS_SETUP, std::nullopt));
+}
+
+std::pair<LoadGenerator::TestAccountPtr, TransactionFramePtr>
+LoadGenerator::dexStressTransaction(uint32_t ledgerNum,
+                                    uint64_t sourceAccountId,
+                                    GeneratedLoadConfig const& cfg)
+{
+    auto const& dexCfg = cfg.getDexStressConfig();
+    auto [account, dest] =
+        pickAccountPair(cfg.nAccounts, cfg.offset, ledgerNum, sourceAccountId);
+    auto native = getDexAsset(0);
+    auto asset = getDexAsset(rand_uniform<uint32_t>(1, dexCfg.nAssets));
+
+    std::vector<Operation> ops;
+    LedgerTxn ltx(mApp.getLedgerTxnRoot());
+    // Accounts trust every asset before they first trade
+    for (uint32_t i = 1; i <= dexCfg.nAssets; ++i)
+    {
+        auto a = getDexAsset(i);
+        if (!loadTrustLineWithoutRecord(ltx, account->getPublicKey(), a))
+        {
+            ops.emplace_back(txtest::changeTrust(a, INT64_MAX));
+        }
+    }
+
+    std::discrete_distribution<uint32_t> dist(
+        {dexCfg.crossWeight, dexCfg.pathWeight, dexCfg.churnWeight});
+    switch (dist(gRandomEngine))
+    {
+    case 0:
+        // Buy across every level of the asks, and from the pool
+        ops.emplace_back(txtest::manageBuyOffer(
+            0, native, asset, dexPriceLevel(dexCfg.bookDepth + 1),
+            rand_uniform<int64_t>(1, DEX_TRADE_AMOUNT)));
+        break;
+    case 1:
+    {
+        // A round trip from native through other assets, to another account
+        std::vector<uint32_t> hops(dexCfg.nAssets);
+        std::iota(hops.begin(), hops.end(), 1);
+        std::shuffle(hops.begin(), hops.end(), gRandomEngine);
+        hops.resize(rand_uniform<uint32_t>(1, dexCfg.maxPathLength));
+        std::vector<Asset> path;
+        for (auto hop : hops)
+        {
+            path.emplace_back(getDexAsset(hop));
+        }
+        auto destAmount = rand_uniform<int64_t>(1, DEX_TRADE_AMOUNT);
+        ops.emplace_back(txtest::pathPayment(dest->getPublicKey(), native,
+                                             2 * destAmount, native,
+                                             destAmount, path));
+        break;
+    }
+    case 2:
+    {
+        // Rest bids among the levels of the book, moving or cancelling one
+        // now and then
+        std::vector<int64_t> offerIDs;
+        for (auto const& entry :
+             ltx.loadOffersByAccountAndAsset(account->getPublicKey(), asset))
+        {
+            auto const& offer = entry.current().data.offer();
+            if (offer.selling == native)
+            {
+                offerIDs.emplace_back(offer.offerID);
+            }
+        }
+        auto price =
+            dexPriceLevel(rand_uniform<uint32_t>(1, dexCfg.bookDepth));
+        if (!offerIDs.empty() &&
+            (offerIDs.size() >= DEX_MAX_CHURN_OFFERS || rand_flip()))
+        {
+            int64_t amount =
+                rand_flip() ? 0 : rand_uniform<int64_t>(1, DEX_TRADE_AMOUNT);
+            ops.emplace_back(txtest::manageOffer(rand_element(offerIDs), native,
+                                                 asset, price, amount));
+        }
+        else
+        {
+            ops.emplace_back(txtest::manageOffer(
+                0, native, asset, price,
+                rand_uniform<int64_t>(1, DEX_TRADE_AMOUNT)));
+        }
+        break;
+    }
+    default:
+        releaseAssert(false);
+    }
+
+    return std::make_pair(account, createTransactionFramePtr(
+                                       account, ops, LoadGenMode::DEX_STRESS,
+                                       cfg.maxGeneratedFeeRate));
+}
+
 void
 LoadGenerator::maybeHandleFailedTx(TransactionFramePtr tx,
                                    TestAccountPtr sourceAccount,
@@ -1922,6 +2608,12 @@ LoadGenerator::waitTillComplete(GeneratedLoadConfig cfg)
     }
     vector<TestAccountPtr> inconsistencies;
     inconsistencies = checkAccountSynced(mApp, cfg.isCreate());
+    if (cfg.isDexSetup() && dexSetupPending())
+    {
+        // Setup txs come from accounts that aren't cached, so wait for the
+        // last one explicitly
+        inconsistencies.emplace_back(mRoot);
+    }
     auto sorobanInconsistencies = checkSorobanStateSynced(mApp, cfg);
 
     // If there are no inconsistencies and we have generated all load, finish
@@ -1931,6 +2623,11 @@ LoadGenerator::waitTillComplete(GeneratedLoadConfig cfg)
         // Check whether run met the minimum success rate for soroban invoke
         if (checkMinimumSorobanSuccess(cfg))
         {
+            if (cfg.isDexSetup())
+            {
+                mDexAssets = cfg.getDexStressConfig().nAssets;
+                mDexBookDepth = cfg.getDexStressConfig().bookDepth;
+            }
             CLOG_INFO(LoadGen, "Load generation complete.");
             mLoadgenComplete.Mark();
             reset();
@@ -2017,6 +2714,64 @@ LoadGenerator::waitTillCompleteWithoutChecks()
                            &VirtualTimer::onFailureNoop);
 }
 
+void
+LoadGenerator::txsExternalized(TxSetPhaseTransactions const& txsPerPhase)
+{
+    ZoneScoped;
+    if (mPendingConfirmation.empty())
+    {
+        return;
+    }
+
+    auto now = mApp.getClock().now();
+    for (auto const& phase : txsPerPhase)
+    {
+        for (auto const& tx : phase)
+        {
+            auto it = mPendingConfirmation.find(tx->getFullHash());
+            if (it != mPendingConfirmation.end())
+            {
+                mConfirmationLatency.Update(now - it->second);
+                mTxnConfirmed.Mark();
+                mPendingConfirmation.erase(it);
+            }
+        }
+    }
+
+    // Stop waiting for transactions that were evicted or banned along the way
+    auto timeout =
+        mApp.getConfig().getExpectedLedgerCloseTime() * TIMEOUT_NUM_LEDGERS;
+    for (auto it = mPendingConfirmation.begin();
+         it != mPendingConfirmation.end();)
+    {
+        if (now - it->second > timeout)
+        {
+            mTxnUnconfirmed.Mark();
+            it = mPendingConfirmation.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+Json::Value
+LoadGenerator::getConfirmationStatus() const
+{
+    Json::Value ret;
+    auto snapshot = mConfirmationLatency.GetSnapshot();
+    ret["confirmed"] = static_cast<Json::UInt64>(mTxnConfirmed.count());
+    ret["pending"] = static_cast<Json::UInt64>(mPendingConfirmation.size());
+    ret["unconfirmed"] = static_cast<Json::UInt64>(mTxnUnconfirmed.count());
+    ret["dropped"] = static_cast<Json::UInt64>(mTxnDropped.count());
+    ret["tx_per_sec"] = mTxnConfirmed.one_minute_rate();
+    ret["latency_ms"]["p50"] = snapshot.getMedian();
+    ret["latency_ms"]["p99"] = snapshot.get99thPercentile();
+    ret["latency_ms"]["p999"] = snapshot.get999thPercentile();
+    return ret;
+}
+
 LoadGenerator::TxMetrics::TxMetrics(medida::MetricsRegistry& m)
     : mAccountCreated(m.NewMeter({"loadgen", "account", "created"}, "account"))
     , mNativePayment(m.NewMeter({"loadgen", "payment", "submitted"}, "op"))
@@ -2030,6 +2785,11 @@ LoadGenerator::TxMetrics::TxMetrics(medida::MetricsRegistry& m)
     , mSorobanInvokeTxs(m.NewMeter({"loadgen", "soroban", "invoke"}, "txn"))
     , mSorobanCreateUpgradeTxs(
           m.NewMeter({"loadgen", "soroban", "create_upgrade"}, "txn"))
+    , mDexSetupTxs(m.NewMeter({"loadgen", "dex", "setup"}, "txn"))
+    , mDexStressOps(m.NewMeter({"loadgen", "dex", "submitted"}, "op"))
+    , mSorobanSetupStateTxs(
+          m.NewMeter({"loadgen", "soroban", "setup_state"}, "txn"))
+    , mSorobanStateTxs(m.NewMeter({"loadgen", "soroban", "state"}, "txn"))
     , mTxnAttempted(m.NewMeter({"loadgen", "txn", "attempted"}, "txn"))
     , mTxnRejected(m.NewMeter({"loadgen", "txn", "rejected"}, "txn"))
     , mTxnBytes(m.NewMeter({"loadgen", "txn", "bytes"}, "txn"))
@@ -2041,17 +2801,21 @@ LoadGenerator::TxMetrics::report()
 {
     CLOG_DEBUG(LoadGen,
                "Counts: {} tx, {} rj, {} by, {} ac, {} na, {} pr, {} dex, {} "
-               "su, {} ssi, {} ssu, {} si, {} scu",
+               "su, {} ssi, {} ssu, {} si, {} scu, {} dxs, {} dx, {} sss, {} "
+               "sst",
                mTxnAttempted.count(), mTxnRejected.count(), mTxnBytes.count(),
                mAccountCreated.count(), mNativePayment.count(),
                mPretendOps.count(), mManageOfferOps.count(),
                mSorobanUploadTxs.count(), mSorobanSetupInvokeTxs.count(),
                mSorobanSetupUpgradeTxs.count(), mSorobanInvokeTxs.count(),
-               mSorobanCreateUpgradeTxs.count());
+               mSorobanCreateUpgradeTxs.count(), mDexSetupTxs.count(),
+               mDexStressOps.count(), mSorobanSetupStateTxs.count(),
+               mSorobanStateTxs.count());
 
     CLOG_DEBUG(LoadGen,
                "Rates/sec (1m EWMA): {} tx, {} rj, {} by, {} ac, {} na, {} pr, "
-               "{} dex, {} su, {} ssi, {} ssu, {} si, {} scu",
+               "{} dex, {} su, {} ssi, {} ssu, {} si, {} scu, {} dxs, {} dx, "
+               "{} sss, {} sst",
                mTxnAttempted.one_minute_rate(), mTxnRejected.one_minute_rate(),
                mTxnBytes.one_minute_rate(), mAccountCreated.one_minute_rate(),
                mNativePayment.one_minute_rate(), mPretendOps.one_minute_rate(),
@@ -2060,7 +2824,10 @@ LoadGenerator::TxMetrics::report()
                mSorobanSetupInvokeTxs.one_minute_rate(),
                mSorobanSetupUpgradeTxs.one_minute_rate(),
                mSorobanInvokeTxs.one_minute_rate(),
-               mSorobanCreateUpgradeTxs.one_minute_rate());
+               mSorobanCreateUpgradeTxs.one_minute_rate(),
+               mDexSetupTxs.one_minute_rate(), mDexStressOps.one_minute_rate(),
+               mSorobanSetupStateTxs.one_minute_rate(),
+               mSorobanStateTxs.one_minute_rate());
 }
 
 TransactionFramePtr
@@ -2130,6 +2897,18 @@ LoadGenerator::execute(TransactionFramePtr& txf, LoadGenMode mode,
     case LoadGenMode::SOROBAN_CREATE_UPGRADE:
         txm.mSorobanCreateUpgradeTxs.Mark();
         break;
+    case LoadGenMode::DEX_STRESS_SETUP:
+        txm.mDexSetupTxs.Mark();
+        break;
+    case LoadGenMode::DEX_STRESS:
+        txm.mDexStressOps.Mark(txf->getNumOperations());
+        break;
+    case LoadGenMode::SOROBAN_STATE_SETUP:
+        txm.mSorobanSetupStateTxs.Mark();
+        break;
+    case LoadGenMode::SOROBAN_STATE:
+        txm.mSorobanStateTxs.Mark();
+        break;
     case LoadGenMode::MIXED_CLASSIC_SOROBAN:
         switch (mLastMixedMode)
         {
@@ -2210,6 +2989,29 @@ GeneratedLoadConfig::createSorobanUpgradeSetupLoad()
     return cfg;
 }
 
+GeneratedLoadConfig
+GeneratedLoadConfig::createSorobanStateSetupLoad()
+{
+    GeneratedLoadConfig cfg;
+    cfg.mode = LoadGenMode::SOROBAN_STATE_SETUP;
+    cfg.nAccounts = 1;
+    cfg.getMutSorobanConfig().nInstances = 1;
+    cfg.txRate = 1;
+    return cfg;
+}
+
+GeneratedLoadConfig
+GeneratedLoadConfig::createDexStressSetupLoad(uint32_t nAssets,
+                                              uint32_t bookDepth)
+{
+    GeneratedLoadConfig cfg;
+    cfg.mode = LoadGenMode::DEX_STRESS_SETUP;
+    cfg.getMutDexStressConfig().nAssets = nAssets;
+    cfg.getMutDexStressConfig().bookDepth = bookDepth;
+    cfg.txRate = 1;
+    return cfg;
+}
+
 GeneratedLoadConfig
 GeneratedLoadConfig::txLoad(LoadGenMode mode, uint32_t nAccounts, uint32_t nTxs,
                             uint32_t txRate, uint32_t offset,
@@ -2267,6 +3069,34 @@ GeneratedLoadConfig::getMixClassicSorobanConfig() const
     return mixClassicSorobanConfig;
 }
 
+GeneratedLoadConfig::DexStressConfig&
+GeneratedLoadConfig::getMutDexStressConfig()
+{
+    releaseAssert(isDexSetup() || mode == LoadGenMode::DEX_STRESS);
+    return dexStressConfig;
+}
+
+GeneratedLoadConfig::DexStressConfig const&
+GeneratedLoadConfig::getDexStressConfig() const
+{
+    releaseAssert(isDexSetup() || mode == LoadGenMode::DEX_STRESS);
+    return dexStressConfig;
+}
+
+GeneratedLoadConfig::SorobanStateConfig&
+GeneratedLoadConfig::getMutSorobanStateConfig()
+{
+    releaseAssert(mode == LoadGenMode::SOROBAN_STATE);
+    return sorobanStateConfig;
+}
+
+GeneratedLoadConfig::SorobanStateConfig const&
+GeneratedLoadConfig::getSorobanStateConfig() const
+{
+    releaseAssert(mode == LoadGenMode::SOROBAN_STATE);
+    return sorobanStateConfig;
+}
+
 uint32_t&
 GeneratedLoadConfig::getMutDexTxPercent()
 {
@@ -2313,14 +3143,17 @@ GeneratedLoadConfig::isSoroban() const
            mode == LoadGenMode::SOROBAN_UPLOAD ||
            mode == LoadGenMode::SOROBAN_UPGRADE_SETUP ||
            mode == LoadGenMode::SOROBAN_CREATE_UPGRADE ||
-           mode == LoadGenMode::MIXED_CLASSIC_SOROBAN;
+           mode == LoadGenMode::MIXED_CLASSIC_SOROBAN ||
+           mode == LoadGenMode::SOROBAN_STATE_SETUP ||
+           mode == LoadGenMode::SOROBAN_STATE;
 }
 
 bool
 GeneratedLoadConfig::isSorobanSetup() const
 {
     return mode == LoadGenMode::SOROBAN_INVOKE_SETUP ||
-           mode == LoadGenMode::SOROBAN_UPGRADE_SETUP;
+           mode == LoadGenMode::SOROBAN_UPGRADE_SETUP ||
+           mode == LoadGenMode::SOROBAN_STATE_SETUP;
 }
 
 bool
@@ -2331,7 +3164,15 @@ GeneratedLoadConfig::isLoad() const
            mode == LoadGenMode::SOROBAN_UPLOAD ||
            mode == LoadGenMode::SOROBAN_INVOKE ||
            mode == LoadGenMode::SOROBAN_CREATE_UPGRADE ||
-           mode == LoadGenMode::MIXED_CLASSIC_SOROBAN;
+           mode == LoadGenMode::MIXED_CLASSIC_SOROBAN ||
+           mode == LoadGenMode::DEX_STRESS ||
+           mode == LoadGenMode::SOROBAN_STATE;
+}
+
+bool
+GeneratedLoadConfig::isDexSetup() const
+{
+    return mode == LoadGenMode::DEX_STRESS_SETUP;
 }
 
 bool
@@ -6,10 +6,13 @@
 
 #include "crypto/SecretKey.h"
 #include "herder/Herder.h"
+#include "herder/TxSetFrame.h"
 #include "main/Application.h"
 #include "test/TestAccount.h"
 #include "test/TxTests.h"
+#include "util/HashOfHash.h"
 #include "xdr/Stellar-types.h"
+#include <optional>
 #include <vector>
 
 namespace medida
@@ -44,7 +47,17 @@ enum class LoadGenMode
     // Create upgrade entry
     SOROBAN_CREATE_UPGRADE,
     // Blend classic and soroban transactions. Mix of pay, upload, and invoke.
-    MIXED_CLASSIC_SOROBAN
+    MIXED_CLASSIC_SOROBAN,
+    // Issue assets and build orderbooks and liquidity pools for DEX_STRESS
+    DEX_STRESS_SETUP,
+    // Crossing offers, multi-hop path payments and offer churn against the
+    // books built by DEX_STRESS_SETUP, which must be run first
+    DEX_STRESS,
+    // Deploy the contract storing the entries of SOROBAN_STATE
+    SOROBAN_STATE_SETUP,
+    // Grow contract state and read, rewrite, extend and restore it, must run
+    // SOROBAN_STATE_SETUP first
+    SOROBAN_STATE
 };
 
 struct GeneratedLoadConfig
@@ -107,6 +120,43 @@ struct GeneratedLoadConfig
         double sorobanInvokeWeight = 0;
     };
 
+    // Config settings for DEX_STRESS_SETUP and DEX_STRESS
+    struct DexStressConfig
+    {
+        // Number of assets traded against each other and the native asset.
+        // DEX_STRESS uses the assets of the last DEX_STRESS_SETUP run.
+        uint32_t nAssets = 4;
+        // Number of price levels on each side of every pair's orderbook
+        uint32_t bookDepth = 10;
+        // Maximum number of intermediate assets of path payments
+        uint32_t maxPathLength = 3;
+
+        // Weights determining the distribution of crossing offers, path
+        // payments and offer churn
+        uint32_t crossWeight = 1;
+        uint32_t pathWeight = 1;
+        uint32_t churnWeight = 1;
+    };
+
+    // Config settings for SOROBAN_STATE
+    struct SorobanStateConfig
+    {
+        // Weights determining the distribution of transactions creating new
+        // entries, reading entries, rewriting them, and extending and
+        // restoring their TTLs
+        uint32_t createWeight = 1;
+        uint32_t readWeight = 1;
+        uint32_t writeWeight = 1;
+        uint32_t extendWeight = 1;
+        uint32_t restoreWeight = 1;
+        // Percentage (from 0 to 100) of new entries that are temporary, and
+        // so are evicted once they expire rather than archived
+        uint32_t temporaryPercent = 0;
+        // Number of entries in the footprint of reads, extensions and
+        // restores
+        uint32_t footprintEntries = 10;
+    };
+
     static GeneratedLoadConfig createAccountsLoad(uint32_t nAccounts,
                                                   uint32_t txRate);
 
@@ -116,6 +166,11 @@ struct GeneratedLoadConfig
 
     static GeneratedLoadConfig createSorobanUpgradeSetupLoad();
 
+    static GeneratedLoadConfig createSorobanStateSetupLoad();
+
+    static GeneratedLoadConfig createDexStressSetupLoad(uint32_t nAssets,
+                                                        uint32_t bookDepth);
+
     static GeneratedLoadConfig
     txLoad(LoadGenMode mode, uint32_t nAccounts, uint32_t nTxs, uint32_t txRate,
            uint32_t offset = 0, std::optional<uint32_t> maxFee = std::nullopt);
@@ -126,6 +181,10 @@ struct GeneratedLoadConfig
     SorobanUpgradeConfig const& getSorobanUpgradeConfig() const;
     MixClassicSorobanConfig& getMutMixClassicSorobanConfig();
     MixClassicSorobanConfig const& getMixClassicSorobanConfig() const;
+    DexStressConfig& getMutDexStressConfig();
+    DexStressConfig const& getDexStressConfig() const;
+    SorobanStateConfig& getMutSorobanStateConfig();
+    SorobanStateConfig const& getSorobanStateConfig() const;
     uint32_t& getMutDexTxPercent();
     uint32_t const& getDexTxPercent() const;
     uint32_t getMinSorobanPercentSuccess() const;
@@ -134,6 +193,7 @@ struct GeneratedLoadConfig
     bool isCreate() const;
     bool isSoroban() const;
     bool isSorobanSetup() const;
+    bool isDexSetup() const;
     bool isLoad() const;
 
     // True iff mode generates SOROBAN_INVOKE load
@@ -170,11 +230,19 @@ struct GeneratedLoadConfig
     // the load generation will fail after a couple of retries.
     // Does not affect account creation.
     bool skipLowFeeTxs = false;
+    // When true, transactions arrive as a Poisson process at txRate (plus any
+    // spikes) whether or not the node keeps up with them: arrivals that can't
+    // be submitted, because the node pushes back or no source account is
+    // free, are dropped and counted instead of being retried or failing the
+    // run. Implies skipLowFeeTxs, and only affects load modes.
+    bool openLoop = false;
 
   private:
     SorobanConfig sorobanConfig;
     SorobanUpgradeConfig sorobanUpgradeConfig;
     MixClassicSorobanConfig mixClassicSorobanConfig;
+    DexStressConfig dexStressConfig;
+    SorobanStateConfig sorobanStateConfig;
 
     // Percentage (from 0 to 100) of DEX transactions
     uint32_t dexTxPercent = 0;
@@ -214,6 +282,13 @@ class LoadGenerator
     ConfigUpgradeSetKey
     getConfigUpgradeSetKey(GeneratedLoadConfig const& cfg) const;
 
+    // Called with the transactions of every externalized tx set, to record
+    // how long the generated ones took to get there
+    void txsExternalized(TxSetPhaseTransactions const& txsPerPhase);
+
+    // Confirmation latency percentiles and throughput of the generated load
+    Json::Value getConfirmationStatus() const;
+
     // Verify cached accounts are properly reflected in the database
     // return any accounts that are inconsistent.
     std::vector<TestAccountPtr> checkAccountSynced(Application& app,
@@ -246,6 +321,12 @@ class LoadGenerator
         return mContactOverheadBytes;
     }
 
+    uint64_t
+    getStatePersistentEntriesForTesting() const
+    {
+        return mStatePersistentEntries;
+    }
+
   private:
     struct TxMetrics
     {
@@ -258,6 +339,10 @@ class LoadGenerator
         medida::Meter& mSorobanSetupUpgradeTxs;
         medida::Meter& mSorobanInvokeTxs;
         medida::Meter& mSorobanCreateUpgradeTxs;
+        medida::Meter& mDexSetupTxs;
+        medida::Meter& mDexStressOps;
+        medida::Meter& mSorobanSetupStateTxs;
+        medida::Meter& mSorobanStateTxs;
         medida::Meter& mTxnAttempted;
         medida::Meter& mTxnRejected;
         medida::Meter& mTxnBytes;
@@ -316,6 +401,20 @@ class LoadGenerator
     medida::Meter& mLoadgenComplete;
     medida::Meter& mLoadgenFail;
 
+    // Submitted transactions not yet seen in an externalized tx set, by full
+    // hash, with the time each one arrived. Kept across runs, as the last
+    // transactions of a run may be confirmed after it completes.
+    UnorderedMap<Hash, VirtualClock::time_point> mPendingConfirmation;
+    medida::Timer& mConfirmationLatency;
+    medida::Meter& mTxnConfirmed;
+    medida::Meter& mTxnUnconfirmed;
+    medida::Meter& mTxnDropped;
+
+    // Open-loop load: when the next Poisson arrival is due, and the number
+    // of spikes injected so far
+    std::optional<VirtualClock::time_point> mNextArrival;
+    int64_t mSpikesInjected{0};
+
     // Counts of soroban transactions that succeeded or failed at apply time
     medida::Counter const& mApplySorobanSuccess;
     medida::Counter const& mApplySorobanFailure;
@@ -340,6 +439,24 @@ class LoadGenerator
     inline static std::optional<LedgerKey> mCodeKey = std::nullopt;
     inline static uint64_t mContactOverheadBytes = 0;
 
+    // Whether the contract set up last is SOROBAN_STATE's, and the number of
+    // persistent and temporary entries SOROBAN_STATE has created in it (or
+    // tried to, as some of the transactions may have failed)
+    inline static bool mStateContract = false;
+    inline static uint64_t mStatePersistentEntries = 0;
+    inline static uint64_t mStateTemporaryEntries = 0;
+
+    // Shape of the books built by the last successful DEX_STRESS_SETUP run,
+    // for DEX_STRESS runs to trade against
+    inline static uint32_t mDexAssets = 0;
+    inline static uint32_t mDexBookDepth = 0;
+
+    // DEX_STRESS_SETUP: the account funding the liquidity pools, and the
+    // setup transactions, which have to be applied one after the other
+    TestAccountPtr mDexMarketMaker;
+    std::vector<std::pair<TestAccountPtr, std::vector<Operation>>>
+        mDexSetupTxs;
+
     // Maps account ID to it's contract instance, where each account has a
     // unique instance
     UnorderedMap<uint64_t, ContractInstance> mContractInstances;
@@ -352,6 +469,9 @@ class LoadGenerator
     void createRootAccount();
     int64_t getTxPerStep(uint32_t txRate, std::chrono::seconds spikeInterval,
                          uint32_t spikeSize);
+    // Arrival times of the open-loop transactions due by now
+    std::vector<VirtualClock::time_point>
+    getOpenLoopArrivals(GeneratedLoadConfig const& cfg);
 
     // Schedule a callback to generateLoad() STEP_MSECS milliseconds from now.
     void scheduleLoadGeneration(GeneratedLoadConfig cfg);
@@ -398,9 +518,26 @@ class LoadGenerator
                                           uint64_t accountId,
                                           GeneratedLoadConfig const& cfg);
     std::pair<LoadGenerator::TestAccountPtr, TransactionFramePtr>
+    sorobanStateTransaction(uint32_t ledgerNum, uint64_t accountId,
+                            GeneratedLoadConfig const& cfg);
+    std::pair<LoadGenerator::TestAccountPtr, TransactionFramePtr>
     sorobanRandomWasmTransaction(uint32_t ledgerNum, uint64_t accountId,
                                  uint32_t inclusionFee);
 
+    // Asset i of DEX_STRESS, issued by the root account; 0 is native
+    Asset getDexAsset(uint32_t i) const;
+    void buildDexSetupTxs(GeneratedLoadConfig const& cfg);
+    // The reason DEX load can't run with cfg, if any
+    std::optional<std::string>
+    checkDexConfig(GeneratedLoadConfig const& cfg) const;
+    // True while the previous DEX_STRESS_SETUP transaction is pending
+    bool dexSetupPending() const;
+    std::pair<LoadGenerator::TestAccountPtr, TransactionFramePtr>
+    dexSetupTransaction(GeneratedLoadConfig const& cfg);
+    std::pair<LoadGenerator::TestAccountPtr, TransactionFramePtr>
+    dexStressTransaction(uint32_t ledgerNum, uint64_t sourceAccountId,
+                         GeneratedLoadConfig const& cfg);
+
     // Create a transaction in MIXED_CLASSIC_SOROBAN mode
     std::pair<LoadGenerator::TestAccountPtr, TransactionFramePtr>
     createMixedClassicSorobanTransaction(uint32_t ledgerNum,
@@ -422,10 +559,13 @@ class LoadGenerator
 
     uint32_t submitCreationTx(uint32_t nAccounts, uint32_t offset,
                               uint32_t ledgerNum);
+    // Submits a transaction that arrived at `arrival`, tracking it until it's
+    // externalized
     bool submitTx(GeneratedLoadConfig const& cfg,
                   std::function<std::pair<LoadGenerator::TestAccountPtr,
                                           TransactionFramePtr>()>
-                      generateTx);
+                      generateTx,
+                  VirtualClock::time_point arrival);
     void waitTillComplete(GeneratedLoadConfig cfg);
     void waitTillCompleteWithoutChecks();
 
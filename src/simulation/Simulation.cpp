@@ -43,6 +43,10 @@ Simulation::Simulation(Mode mode, Hash const& networkID, ConfigGen confGen,
     auto cfg = newConfig();
     auto& parallel = cfg.EXPERIMENTAL_BACKGROUND_OVERLAY_PROCESSING;
     parallel = parallel && mVirtualClockMode == VirtualClock::REAL_TIME;
+    if (!parallel)
+    {
+        cfg.EXPERIMENTAL_BACKGROUND_OVERLAY_THREADS = 1;
+    }
     mIdleApp = Application::create(mClock, cfg);
     mPeerMap.emplace(mIdleApp->getConfig().PEER_PORT, mIdleApp);
 }
@@ -101,6 +105,10 @@ Simulation::addNode(SecretKey nodeKey, SCPQuorumSet qSet, Config const* cfg2,
     cfg->MANUAL_CLOSE = false;
     auto& parallel = cfg->EXPERIMENTAL_BACKGROUND_OVERLAY_PROCESSING;
     parallel = parallel && mVirtualClockMode == VirtualClock::REAL_TIME;
+    if (!parallel)
+    {
+        cfg->EXPERIMENTAL_BACKGROUND_OVERLAY_THREADS = 1;
+    }
 
     if (mQuorumSetAdjuster)
     {
@@ -9,7 +9,10 @@
 #include "scp/QuorumSetUtils.h"
 #include "simulation/LoadGenerator.h"
 #include "simulation/Topologies.h"
+#include "test/TxTests.h"
 #include "test/test.h"
+#include "transactions/OfferExchange.h"
+#include "transactions/TransactionUtils.h"
 #include "transactions/test/SorobanTxTestUtils.h"
 #include "util/Math.h"
 #include <fmt/format.h>
@@ -91,6 +94,143 @@ TEST_CASE("generate load with unique accounts", "[loadgen]")
     }
 }
 
+TEST_CASE("generate open loop load", "[loadgen]")
+{
+    Hash networkID = sha256(getTestConfig().NETWORK_PASSPHRASE);
+    Simulation::pointer simulation =
+        Topologies::pair(Simulation::OVER_LOOPBACK, networkID, [](int i) {
+            auto cfg = getTestConfig(i);
+            cfg.TESTING_UPGRADE_MAX_TX_SET_SIZE = 5000;
+            return cfg;
+        });
+
+    simulation->startAllNodes();
+    simulation->crankUntil(
+        [&]() { return simulation->haveAllExternalized(3, 1); },
+        2 * Herder::EXP_LEDGER_TIMESPAN_SECONDS, false);
+
+    auto nodes = simulation->getNodes();
+    auto& app = *nodes[0];
+    auto& loadGen = app.getLoadGenerator();
+    auto& complete =
+        app.getMetrics().NewMeter({"loadgen", "run", "complete"}, "run");
+
+    loadGen.generateLoad(GeneratedLoadConfig::createAccountsLoad(
+        /* nAccounts */ 1000,
+        /* txRate */ 1));
+    simulation->crankUntil([&]() { return complete.count() == 1; },
+                           100 * Herder::EXP_LEDGER_TIMESPAN_SECONDS, false);
+
+    uint32_t const nTxs = 500;
+    auto cfg = GeneratedLoadConfig::txLoad(LoadGenMode::PAY,
+                                           /* nAccounts */ 1000, nTxs,
+                                           /* txRate */ 20);
+    cfg.openLoop = true;
+    REQUIRE(cfg.getStatus()["open_loop"].asBool());
+    loadGen.generateLoad(cfg);
+    simulation->crankUntil([&]() { return complete.count() == 2; },
+                           100 * Herder::EXP_LEDGER_TIMESPAN_SECONDS, false);
+
+    // Every arrival is accounted for, and nearly all of them made it
+    auto status = loadGen.getConfirmationStatus();
+    auto confirmed = status["confirmed"].asUInt64();
+    REQUIRE(confirmed + status["pending"].asUInt64() +
+                status["unconfirmed"].asUInt64() +
+                status["dropped"].asUInt64() ==
+            nTxs);
+    REQUIRE(confirmed >= nTxs * 9 / 10);
+    REQUIRE(app.getMetrics().NewTimer({"loadgen", "txn", "latency"}).count() ==
+            confirmed);
+
+    // Confirming takes at least part of a ledger, but not many of them
+    auto p50 = status["latency_ms"]["p50"].asDouble();
+    REQUIRE(p50 > 0);
+    REQUIRE(status["latency_ms"]["p999"].asDouble() >= p50);
+    REQUIRE(p50 < 5 * std::chrono::duration_cast<std::chrono::milliseconds>(
+                          Herder::EXP_LEDGER_TIMESPAN_SECONDS)
+                          .count());
+}
+
+TEST_CASE("generate dex stress load", "[loadgen][dex]")
+{
+    Hash networkID = sha256(getTestConfig().NETWORK_PASSPHRASE);
+    Simulation::pointer simulation =
+        Topologies::pair(Simulation::OVER_LOOPBACK, networkID, [](int i) {
+            auto cfg = getTestConfig(i);
+            cfg.TESTING_UPGRADE_MAX_TX_SET_SIZE = 5000;
+            return cfg;
+        });
+
+    simulation->startAllNodes();
+    simulation->crankUntil(
+        [&]() { return simulation->haveAllExternalized(3, 1); },
+        2 * Herder::EXP_LEDGER_TIMESPAN_SECONDS, false);
+
+    auto nodes = simulation->getNodes();
+    auto& app = *nodes[0];
+    auto& loadGen = app.getLoadGenerator();
+    auto& complete =
+        app.getMetrics().NewMeter({"loadgen", "run", "complete"}, "run");
+
+    uint32_t const nAccounts = 1000;
+    loadGen.generateLoad(
+        GeneratedLoadConfig::createAccountsLoad(nAccounts, /* txRate */ 1));
+    simulation->crankUntil([&]() { return complete.count() == 1; },
+                           100 * Herder::EXP_LEDGER_TIMESPAN_SECONDS, false);
+
+    uint32_t const nAssets = 3;
+    loadGen.generateLoad(GeneratedLoadConfig::createDexStressSetupLoad(
+        nAssets, /* bookDepth */ 5));
+    simulation->crankUntil([&]() { return complete.count() == 2; },
+                           50 * Herder::EXP_LEDGER_TIMESPAN_SECONDS, false);
+
+    auto root = txtest::getRoot(app.getNetworkID());
+    auto native = txtest::makeNativeAsset();
+    auto poolReserves = [&]() {
+        std::vector<int64_t> reserves;
+        LedgerTxn ltx(app.getLedgerTxnRoot());
+        for (uint32_t i = 1; i <= nAssets; ++i)
+        {
+            auto asset = txtest::makeAsset(root, fmt::format("DX{:02}", i));
+            auto pool = loadLiquidityPool(
+                ltx, getPoolID(native, asset, LIQUIDITY_POOL_FEE_V18));
+            REQUIRE(pool);
+            auto const& cp =
+                pool.current().data.liquidityPool().body.constantProduct();
+            reserves.emplace_back(cp.reserveA);
+            reserves.emplace_back(cp.reserveB);
+        }
+        return reserves;
+    };
+    // Books on both sides of every pair
+    {
+        LedgerTxn ltx(app.getLedgerTxnRoot());
+        auto rootOffers = ltx.loadOffersByAccountAndAsset(
+            root.getPublicKey(), txtest::makeAsset(root, "DX01"));
+        REQUIRE(rootOffers.size() == nAssets * 2 * 5);
+    }
+    auto initialReserves = poolReserves();
+
+    auto cfg = GeneratedLoadConfig::txLoad(LoadGenMode::DEX_STRESS, nAccounts,
+                                           /* nTxs */ 300, /* txRate */ 10);
+    auto& dexCfg = cfg.getMutDexStressConfig();
+    dexCfg.crossWeight = 1;
+    dexCfg.pathWeight = 2;
+    dexCfg.churnWeight = 1;
+    loadGen.generateLoad(cfg);
+    simulation->crankUntil([&]() { return complete.count() == 3; },
+                           100 * Herder::EXP_LEDGER_TIMESPAN_SECONDS, false);
+    REQUIRE(app.getMetrics()
+                .NewMeter({"loadgen", "run", "failed"}, "run")
+                .count() == 0);
+    REQUIRE(app.getMetrics()
+                .NewMeter({"loadgen", "dex", "submitted"}, "op")
+                .count() >= 300);
+
+    // Path payments and crossings traded with the pools
+    REQUIRE(poolReserves() != initialReserves);
+}
+
 TEST_CASE("generate soroban load", "[loadgen][soroban]")
 {
     uint32_t const numDataEntries = 5;
@@ -573,6 +713,83 @@ TEST_CASE("generate soroban load", "[loadgen][soroban]")
     }
 }
 
+TEST_CASE("generate soroban state load", "[loadgen][soroban]")
+{
+    Hash networkID = sha256(getTestConfig().NETWORK_PASSPHRASE);
+    Simulation::pointer simulation =
+        Topologies::pair(Simulation::OVER_LOOPBACK, networkID, [](int i) {
+            auto cfg = getTestConfig(i);
+            cfg.TESTING_UPGRADE_MAX_TX_SET_SIZE = 5000;
+            return cfg;
+        });
+
+    simulation->startAllNodes();
+    simulation->crankUntil(
+        [&]() { return simulation->haveAllExternalized(3, 1); },
+        2 * Herder::EXP_LEDGER_TIMESPAN_SECONDS, false);
+
+    auto nodes = simulation->getNodes();
+    for (auto node : nodes)
+    {
+        overrideSorobanNetworkConfigForTest(*node);
+    }
+
+    auto& app = *nodes[0];
+    auto& loadGen = app.getLoadGenerator();
+    auto& complete =
+        app.getMetrics().NewMeter({"loadgen", "run", "complete"}, "run");
+
+    uint32_t const nAccounts = 20;
+    loadGen.generateLoad(
+        GeneratedLoadConfig::createAccountsLoad(nAccounts, /* txRate */ 1));
+    simulation->crankUntil([&]() { return complete.count() == 1; },
+                           100 * Herder::EXP_LEDGER_TIMESPAN_SECONDS, false);
+
+    // Can't run before the state contract is deployed
+    auto& failed =
+        app.getMetrics().NewMeter({"loadgen", "run", "failed"}, "run");
+    auto stateCfg = GeneratedLoadConfig::txLoad(
+        LoadGenMode::SOROBAN_STATE, nAccounts, /* nTxs */ 100, /* txRate */ 1);
+    loadGen.generateLoad(stateCfg);
+    REQUIRE(failed.count() == 1);
+
+    loadGen.generateLoad(GeneratedLoadConfig::createSorobanStateSetupLoad());
+    simulation->crankUntil([&]() { return complete.count() == 2; },
+                           100 * Herder::EXP_LEDGER_TIMESPAN_SECONDS, false);
+    REQUIRE(loadGen.getContractInstanceKeysForTesting().size() == 1);
+
+    for (auto node : nodes)
+    {
+        modifySorobanNetworkConfig(*node, [](SorobanNetworkConfig& cfg) {
+            // Entries expire during the run, so that there is something to
+            // restore and evict
+            cfg.mStateArchivalSettings.minPersistentTTL = 16;
+            cfg.mStateArchivalSettings.minTemporaryTTL = 16;
+        });
+    }
+
+    auto& mix = stateCfg.getMutSorobanStateConfig();
+    mix.createWeight = 3;
+    mix.temporaryPercent = 20;
+    mix.footprintEntries = 5;
+    loadGen.generateLoad(stateCfg);
+    simulation->crankUntil([&]() { return complete.count() == 3; },
+                           300 * Herder::EXP_LEDGER_TIMESPAN_SECONDS, false);
+    REQUIRE(failed.count() == 1);
+    REQUIRE(app.getMetrics()
+                .NewMeter({"loadgen", "soroban", "state"}, "txn")
+                .count() == 100);
+
+    // State grew, and the first entry made it to the ledger
+    REQUIRE(loadGen.getStatePersistentEntriesForTesting() > 0);
+    auto const& instanceKey =
+        *loadGen.getContractInstanceKeysForTesting().begin();
+    LedgerTxn ltx(app.getLedgerTxnRoot());
+    REQUIRE(ltx.load(contractDataKey(instanceKey.contractData().contract,
+                                     makeSymbolSCVal("p0"),
+                                     ContractDataDurability::PERSISTENT)));
+}
+
 TEST_CASE("Multi-op pretend transactions are valid", "[loadgen]")
 {
     Hash networkID = sha256(getTestConfig().NETWORK_PASSPHRASE);
@@ -0,0 +1,209 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "test/Benchmark.h"
+#include "main/StellarCoreVersion.h"
+#include "util/GlobalChecks.h"
+#include "util/Logging.h"
+#include <ctime>
+#include <fmt/format.h>
+#include <fstream>
+#include <json/json.h>
+#include <map>
+#include <stdexcept>
+#include <thread>
+
+namespace stellar
+{
+
+namespace
+{
+struct BenchmarkResult
+{
+    size_t mIterations{0};
+    // Per iteration
+    double mRealTimeNs{0};
+    double mCpuTimeNs{0};
+};
+
+// Ordered, so that output is stable
+std::map<std::string, BenchmarkResult> gBenchmarks;
+
+double
+toNanoseconds(Json::Value const& v, std::string const& unit)
+{
+    auto t = v.asDouble();
+    if (unit == "us")
+    {
+        return t * 1e3;
+    }
+    else if (unit == "ms")
+    {
+        return t * 1e6;
+    }
+    else if (unit == "s")
+    {
+        return t * 1e9;
+    }
+    return t;
+}
+}
+
+std::chrono::nanoseconds
+benchmarkCpuTime()
+{
+    return std::chrono::nanoseconds(static_cast<int64_t>(
+        static_cast<double>(std::clock()) * 1e9 / CLOCKS_PER_SEC));
+}
+
+void
+recordBenchmark(std::string const& name, size_t iterations,
+                std::chrono::nanoseconds realTime,
+                std::chrono::nanoseconds cpuTime)
+{
+    releaseAssert(iterations > 0);
+    BenchmarkResult res;
+    res.mIterations = iterations;
+    res.mRealTimeNs = static_cast<double>(realTime.count()) / iterations;
+    res.mCpuTimeNs = static_cast<double>(cpuTime.count()) / iterations;
+    if (!gBenchmarks.emplace(name, res).second)
+    {
+        throw std::runtime_error(
+            fmt::format("Duplicate benchmark name: {}", name));
+    }
+    LOG_INFO(DEFAULT_LOG, "Benchmark {}: {} iterations, {:.0f} ns/iter",
+             name, iterations, res.mRealTimeNs);
+}
+
+void
+benchmark(std::string const& name, size_t iterations,
+          std::function<void()> const& f)
+{
+    f();
+    auto cpuStart = benchmarkCpuTime();
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        f();
+    }
+    auto real = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start);
+    recordBenchmark(name, iterations, real, benchmarkCpuTime() - cpuStart);
+}
+
+bool
+haveBenchmarks()
+{
+    return !gBenchmarks.empty();
+}
+
+void
+saveBenchmarks(std::string const& path)
+{
+    Json::Value root;
+    auto& context = root["context"];
+    char date[32];
+    auto now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z",
+                  std::localtime(&now));
+    context["date"] = date;
+    context["executable"] = "stellar-core";
+    context["stellar_core_version"] = STELLAR_CORE_VERSION;
+    context["num_cpus"] = std::thread::hardware_concurrency();
+#ifdef NDEBUG
+    context["library_build_type"] = "release";
+#else
+    context["library_build_type"] = "debug";
+#endif
+
+    auto& benchmarks = root["benchmarks"];
+    benchmarks = Json::Value(Json::arrayValue);
+    for (auto const& [name, res] : gBenchmarks)
+    {
+        Json::Value b;
+        b["name"] = name;
+        b["run_name"] = name;
+        b["run_type"] = "iteration";
+        b["repetitions"] = 1;
+        b["repetition_index"] = 0;
+        b["threads"] = 1;
+        b["iterations"] = static_cast<Json::UInt64>(res.mIterations);
+        b["real_time"] = res.mRealTimeNs;
+        b["cpu_time"] = res.mCpuTimeNs;
+        b["time_unit"] = "ns";
+        benchmarks.append(b);
+    }
+
+    std::ofstream out(path, std::ios_base::trunc);
+    if (!out)
+    {
+        throw std::runtime_error(fmt::format("Failed to open {}", path));
+    }
+    out.exceptions(std::ios::failbit | std::ios::badbit);
+    out << root;
+    LOG_INFO(DEFAULT_LOG, "Wrote {} benchmark results to {}",
+             gBenchmarks.size(), path);
+}
+
+size_t
+checkBenchmarks(std::string const& path, double thresholdPercent)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        throw std::runtime_error(fmt::format("Failed to open {}", path));
+    }
+    in.exceptions(std::ios::failbit | std::ios::badbit);
+    Json::Value root;
+    in >> root;
+
+    std::map<std::string, double> baseline;
+    for (auto const& b : root["benchmarks"])
+    {
+        // Aggregates of repeated runs have the same name as their runs
+        if (b["run_type"].asString() == "aggregate")
+        {
+            continue;
+        }
+        baseline[b["name"].asString()] =
+            toNanoseconds(b["real_time"], b["time_unit"].asString());
+    }
+
+    size_t regressions = 0;
+    for (auto const& [name, res] : gBenchmarks)
+    {
+        auto it = baseline.find(name);
+        if (it == baseline.end())
+        {
+            LOG_WARNING(DEFAULT_LOG, "Benchmark {} has no baseline in {}",
+                        name, path);
+            continue;
+        }
+        auto change = (res.mRealTimeNs / it->second - 1) * 100;
+        if (change > thresholdPercent)
+        {
+            LOG_ERROR(DEFAULT_LOG,
+                      "Benchmark {} regressed: {:.0f} ns/iter against {:.0f} "
+                      "in baseline ({:+.1f}%, threshold {}%)",
+                      name, res.mRealTimeNs, it->second, change,
+                      thresholdPercent);
+            ++regressions;
+        }
+        else
+        {
+            LOG_INFO(DEFAULT_LOG,
+                     "Benchmark {}: {:.0f} ns/iter against {:.0f} in "
+                     "baseline ({:+.1f}%)",
+                     name, res.mRealTimeNs, it->second, change);
+        }
+        baseline.erase(it);
+    }
+    for (auto const& b : baseline)
+    {
+        LOG_WARNING(DEFAULT_LOG, "Baseline benchmark {} did not run",
+                    b.first);
+    }
+    return regressions;
+}
+}
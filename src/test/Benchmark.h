@@ -0,0 +1,45 @@
+#pragma once
+
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <string>
+
+namespace stellar
+{
+
+// Benchmarks of the `[perf]` test cases. Results are collected for the whole
+// test run and, with --benchmark-out, written as JSON in the format of Google
+// Benchmark, so that its tools (`compare.py` and the like) work on them. With
+// --benchmark-baseline, they are checked against such a file recorded earlier,
+// and the run fails if any got slower by more than --benchmark-threshold
+// percent.
+
+// Runs f once to warm up, then `iterations` more times, and records the mean
+// wall clock and CPU time of those under `name`. Names must be unique within
+// a run, and stay the same across runs for baselines to match.
+void benchmark(std::string const& name, size_t iterations,
+               std::function<void()> const& f);
+
+// Records a benchmark timed by the caller, for code that needs setup between
+// iterations
+void recordBenchmark(std::string const& name, size_t iterations,
+                     std::chrono::nanoseconds realTime,
+                     std::chrono::nanoseconds cpuTime);
+
+// Process CPU time so far, for use with recordBenchmark
+std::chrono::nanoseconds benchmarkCpuTime();
+
+void saveBenchmarks(std::string const& path);
+
+// Returns the number of benchmarks whose wall clock time regressed by more
+// than thresholdPercent against the baseline at path. Benchmarks missing from
+// either side are reported, but don't count as regressions.
+size_t checkBenchmarks(std::string const& path, double thresholdPercent);
+
+bool haveBenchmarks();
+}
@@ -0,0 +1,227 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+// The `[perf]` benchmarks: one per hot path, sized to run in seconds, and
+// named so that their results can be compared across runs with
+// --benchmark-out and --benchmark-baseline. Run them all with
+// `stellar-core test [perf] --benchmark-out results.json`.
+
+#include "bucket/Bucket.h"
+#include "bucket/BucketIndex.h"
+#include "bucket/BucketManager.h"
+#include "bucket/test/BucketTestUtils.h"
+#include "crypto/SecretKey.h"
+#include "herder/TxSetFrame.h"
+#include "ledger/LedgerManager.h"
+#include "ledger/LedgerTxn.h"
+#include "ledger/test/LedgerTestUtils.h"
+#include "lib/catch.hpp"
+#include "main/Application.h"
+#include "overlay/StellarXDR.h"
+#include "test/Benchmark.h"
+#include "test/TestAccount.h"
+#include "test/TestUtils.h"
+#include "test/TxTests.h"
+#include "test/test.h"
+#include "transactions/TransactionUtils.h"
+#include "util/Math.h"
+#include <xdrpp/marshal.h>
+
+using namespace stellar;
+using namespace stellar::BucketTestUtils;
+
+namespace
+{
+std::vector<LedgerEntry>
+generateAccounts(size_t n)
+{
+    std::vector<LedgerEntry> entries(n);
+    for (auto& e : entries)
+    {
+        e.data.type(ACCOUNT);
+        e.data.account() = LedgerTestUtils::generateValidAccountEntry(5);
+    }
+    return entries;
+}
+}
+
+TEST_CASE("bucket merge benchmark", "[perf][!hide]")
+{
+    VirtualClock clock;
+    auto app = createTestApplication(clock, getTestConfig());
+    auto& bm = app->getBucketManager();
+    auto vers = getAppLedgerVersion(app);
+
+    auto oldEntries = generateAccounts(50'000);
+    // Updates to a fifth of the old entries, and as many new ones
+    auto newEntries = generateAccounts(10'000);
+    for (size_t i = 0; i < 10'000; ++i)
+    {
+        auto e = oldEntries[i * 5];
+        e.data.account().balance += 1;
+        newEntries.emplace_back(e);
+    }
+    auto oldBucket = Bucket::fresh(bm, vers, {}, oldEntries, {},
+                                   /* countMergeEvents */ false,
+                                   clock.getIOContext(), /* doFsync */ false);
+    auto newBucket = Bucket::fresh(bm, vers, {}, newEntries, {},
+                                   /* countMergeEvents */ false,
+                                   clock.getIOContext(), /* doFsync */ false);
+
+    benchmark("bucket/merge/50000+20000", 5, [&]() {
+        auto merged =
+            Bucket::merge(bm, vers, oldBucket, newBucket, /* shadows */ {},
+                          /* keepDeadEntries */ true,
+                          /* countMergeEvents */ false, clock.getIOContext(),
+                          /* doFsync */ false);
+        REQUIRE(merged->getSize() > oldBucket->getSize());
+    });
+}
+
+TEST_CASE("bucket index lookup benchmark", "[perf][!hide]")
+{
+    VirtualClock clock;
+    auto cfg = getTestConfig();
+    cfg.DEPRECATED_SQL_LEDGER_STATE = false;
+    auto app = createTestApplication(clock, cfg);
+
+    auto entries = generateAccounts(100'000);
+    auto bucket = Bucket::fresh(app->getBucketManager(),
+                                getAppLedgerVersion(app), {}, entries, {},
+                                /* countMergeEvents */ false,
+                                clock.getIOContext(), /* doFsync */ false);
+    REQUIRE(bucket->isIndexed());
+
+    std::vector<LedgerKey> keys;
+    for (auto const& e : entries)
+    {
+        keys.emplace_back(LedgerEntryKey(e));
+    }
+    std::shuffle(keys.begin(), keys.end(), gRandomEngine);
+
+    auto const& index = bucket->getIndexForTesting();
+    size_t found = 0;
+    benchmark("bucket/index-lookup/100000", 5, [&]() {
+        for (auto const& k : keys)
+        {
+            found += index.lookup(k).has_value();
+        }
+    });
+    REQUIRE(found == keys.size() * 6);
+}
+
+TEST_CASE("LedgerTxn load and commit benchmark", "[perf][!hide]")
+{
+    VirtualClock clock;
+    auto app = createTestApplication(clock, getTestConfig());
+
+    size_t const iterations = 10;
+    size_t const batchSize = 1'000;
+    std::vector<std::vector<LedgerEntry>> batches;
+    for (size_t i = 0; i <= iterations; ++i)
+    {
+        batches.emplace_back(generateAccounts(batchSize));
+    }
+
+    size_t next = 0;
+    benchmark("ledgertxn/create-commit/1000", iterations, [&]() {
+        LedgerTxn ltx(app->getLedgerTxnRoot());
+        for (auto const& e : batches.at(next))
+        {
+            ltx.create(e);
+        }
+        ltx.commit();
+        ++next;
+    });
+
+    next = 0;
+    size_t found = 0;
+    benchmark("ledgertxn/load/1000", iterations, [&]() {
+        LedgerTxn ltx(app->getLedgerTxnRoot());
+        for (auto const& e : batches.at(next))
+        {
+            auto entry = ltx.loadWithoutRecord(LedgerEntryKey(e));
+            found += static_cast<bool>(entry);
+        }
+        ++next;
+    });
+    REQUIRE(found == batchSize * (iterations + 1));
+}
+
+TEST_CASE("tx set building benchmark", "[perf][!hide]")
+{
+    VirtualClock clock;
+    auto app = createTestApplication(clock, getTestConfig());
+    auto root = TestAccount::createRoot(*app);
+
+    size_t const nAccounts = 100;
+    size_t const txsPerAccount = 10;
+    auto balance = app->getLedgerManager().getLastMinBalance(0) * 100;
+    TxSetTransactions txs;
+    for (size_t i = 0; i < nAccounts; ++i)
+    {
+        auto account = root.create(fmt::format("bench {}", i), balance);
+        for (size_t j = 0; j < txsPerAccount; ++j)
+        {
+            txs.emplace_back(
+                account.tx({txtest::payment(root.getPublicKey(), 1)}));
+        }
+    }
+
+    benchmark("herder/txset-build/1000", 10, [&]() {
+        auto txSet = makeTxSetFromTransactions(txs, *app, 0, 0).second;
+        REQUIRE(txSet->sizeTxTotal() > 0);
+    });
+}
+
+TEST_CASE("signature verification benchmark", "[perf][!hide]")
+{
+    size_t const n = 1'000;
+    std::vector<PublicKey> keys;
+    std::vector<Signature> sigs;
+    std::vector<std::string> messages;
+    for (size_t i = 0; i < n; ++i)
+    {
+        auto sk = SecretKey::pseudoRandomForTesting();
+        messages.emplace_back(fmt::format("benchmark message {}", i));
+        keys.emplace_back(sk.getPublicKey());
+        sigs.emplace_back(sk.sign(messages.back()));
+    }
+
+    // Misses the cache every time, as happens for new transactions
+    size_t verified = 0;
+    benchmark("crypto/verify-sig/1000", 10, [&]() {
+        PubKeyUtils::clearVerifySigCache();
+        for (size_t i = 0; i < n; ++i)
+        {
+            verified += PubKeyUtils::verifySig(keys[i], sigs[i], messages[i]);
+        }
+    });
+    REQUIRE(verified == n * 11);
+}
+
+TEST_CASE("overlay message decode benchmark", "[perf][!hide]")
+{
+    VirtualClock clock;
+    auto app = createTestApplication(clock, getTestConfig());
+    auto root = TestAccount::createRoot(*app);
+
+    std::vector<xdr::opaque_vec<>> messages;
+    for (size_t i = 0; i < 1'000; ++i)
+    {
+        auto tx = root.tx({txtest::payment(root.getPublicKey(), 1)});
+        messages.emplace_back(xdr::xdr_to_opaque(*tx->toStellarMessage()));
+    }
+
+    size_t decoded = 0;
+    benchmark("overlay/decode-tx/1000", 100, [&]() {
+        for (auto const& bytes : messages)
+        {
+            StellarMessage msg;
+            xdr::xdr_from_opaque(bytes, msg);
+            decoded += msg.type() == TRANSACTION;
+        }
+    });
+    REQUIRE(decoded == messages.size() * 101);
+}
@@ -3,7 +3,7 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "test/FuzzerImpl.h"
-#include "invariant/OrderBookIsNotCrossed.h"
+#include "invariant/InvariantManager.h"
 #include "ledger/LedgerTxn.h"
 #include "ledger/TrustLineWrapper.h"
 #include "ledger/test/LedgerTestUtils.h"
@@ -1482,12 +1482,13 @@ TransactionFuzzer::initialize()
 {
     reinitializeAllGlobalStateWithSeed(1);
     mApp = createTestApplication(mClock, getFuzzConfig(0));
-    OrderBookIsNotCrossed::registerAndEnableInvariant(*mApp);
+    mApp->getInvariantManager().enableInvariant("OrderBookIsNotCrossed");
     auto root = TestAccount::createRoot(*mApp);
     mSourceAccountID = root.getPublicKey();
 
     resetTxInternalState(*mApp);
-    LedgerTxn ltxOuter(mApp->getLedgerTxnRoot());
+    mSeedLtx = std::make_unique<LedgerTxn>(mApp->getLedgerTxnRoot());
+    auto& ltxOuter = *mSeedLtx;
 
     initializeAccounts(ltxOuter);
 
@@ -1507,9 +1508,8 @@ TransactionFuzzer::initialize()
 
     storeSetupLedgerKeysAndPoolIDs(ltxOuter);
 
-    // commit this to the ledger so that we have a starting, persistent
-    // state to fuzz test against
-    ltxOuter.commit();
+    // ltxOuter is kept open, rather than committed, as the starting state to
+    // fuzz test against, see mSeedLtx
 
 #ifdef BUILD_TESTS
     mApp->getInvariantManager().snapshotForFuzzer();
@@ -1972,7 +1972,7 @@ TransactionFuzzer::inject(std::string const& filename)
     LOG_TRACE(DEFAULT_LOG, "{}",
               xdrToCerealString(ops, fmt::format("Fuzz ops ({})", ops.size())));
 
-    LedgerTxn ltx(mApp->getLedgerTxnRoot());
+    LedgerTxn ltx(*mSeedLtx);
     applyFuzzOperations(ltx, mSourceAccountID, ops.begin(), ops.end(), *mApp);
 }
 
@@ -58,6 +58,11 @@ class TransactionFuzzer : public Fuzzer
     void reduceTrustLineLimitsAfterSetup(AbstractLedgerTxn& ltxOuter);
     VirtualClock mClock;
     std::shared_ptr<Application> mApp;
+    // The accounts, trustlines, offers and pools set up by initialize(),
+    // held in memory above the root rather than committed. Each input is
+    // applied in a child that is rolled back, so restoring the state costs
+    // only the entries the input modified and never reloads the seeded ones.
+    std::unique_ptr<LedgerTxn> mSeedLtx;
     PublicKey mSourceAccountID;
     FuzzUtils::StoredLedgerKeys mStoredLedgerKeys;
     FuzzUtils::StoredPoolIDs mStoredPoolIDs;
@@ -139,8 +139,8 @@ BucketListDepthModifier::~BucketListDepthModifier()
 }
 }
 
-TestInvariantManager::TestInvariantManager(medida::MetricsRegistry& registry)
-    : InvariantManagerImpl(registry)
+TestInvariantManager::TestInvariantManager(Application& app)
+    : InvariantManagerImpl(app)
 {
 }
 
@@ -160,7 +160,7 @@ TestApplication::TestApplication(VirtualClock& clock, Config const& cfg)
 std::unique_ptr<InvariantManager>
 TestApplication::createInvariantManager()
 {
-    return std::make_unique<TestInvariantManager>(getMetrics());
+    return std::make_unique<TestInvariantManager>(*this);
 }
 
 TimePoint
@@ -53,7 +53,7 @@ testBucketMetadata(uint32_t protocolVersion)
 class TestInvariantManager : public InvariantManagerImpl
 {
   public:
-    TestInvariantManager(medida::MetricsRegistry& registry);
+    explicit TestInvariantManager(Application& app);
 
   private:
     virtual void
@@ -99,14 +99,12 @@ ExtendFootprintTTLOpFrame::doApply(Application& app, AbstractLedgerTxn& ltx,
             }
         }
 
-        // Load the ContractCode/ContractData entry for fee calculation.
-        auto entryLtxe = ltx.loadWithoutRecord(lk);
+        // Get the size of the ContractCode/ContractData entry for fee
+        // calculation, without loading a copy of it
+        uint32_t entrySize = ltx.getNewestVersionEncodedSize(lk);
 
         // We checked for TTLEntry existence above
-        releaseAssertOrThrow(entryLtxe);
-
-        uint32_t entrySize =
-            static_cast<uint32>(xdr::xdr_size(entryLtxe.current()));
+        releaseAssertOrThrow(entrySize != 0);
         metrics.mLedgerReadByte += entrySize;
 
         if (!validateContractLedgerEntry(lk, entrySize, sorobanConfig,
@@ -217,6 +215,7 @@ void
 ExtendFootprintTTLOpFrame::insertLedgerKeysToPrefetch(
     UnorderedSet<LedgerKey>& keys) const
 {
+    insertFootprintKeys(mParentTx.sorobanResources().footprint, keys);
 }
 
 bool
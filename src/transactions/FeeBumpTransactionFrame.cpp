@@ -516,6 +516,17 @@ FeeBumpTransactionFrame::insertKeysForTxApply(
     mInnerTx->insertKeysForTxApply(keys);
 }
 
+void
+FeeBumpTransactionFrame::insertSignaturesToVerify(
+    AccountSignersLoader const& loadSigners,
+    std::vector<SignatureToVerify>& sigs) const
+{
+    insertAccountSignaturesToVerify(loadSigners, getFeeSourceID(),
+                                    mEnvelope.feeBump().signatures,
+                                    getContentsHash(), sigs);
+    mInnerTx->insertSignaturesToVerify(loadSigners, sigs);
+}
+
 void
 FeeBumpTransactionFrame::processFeeSeqNum(AbstractLedgerTxn& ltx,
                                           std::optional<int64_t> baseFee)
@@ -99,6 +99,10 @@ class FeeBumpTransactionFrame : public TransactionFrameBase
     void
     insertKeysForFeeProcessing(UnorderedSet<LedgerKey>& keys) const override;
     void insertKeysForTxApply(UnorderedSet<LedgerKey>& keys) const override;
+    using TransactionFrameBase::insertSignaturesToVerify;
+    void insertSignaturesToVerify(
+        AccountSignersLoader const& loadSigners,
+        std::vector<SignatureToVerify>& sigs) const override;
 
     void processFeeSeqNum(AbstractLedgerTxn& ltx,
                           std::optional<int64_t> baseFee) override;
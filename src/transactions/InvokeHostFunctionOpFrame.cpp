@@ -15,6 +15,8 @@
 #include "rust/RustVecXdrMarshal.h"
 // clang-format on
 
+#include "crypto/KeyUtils.h"
+#include "crypto/StrKey.h"
 #include "ledger/LedgerTxnImpl.h"
 #include "rust/CppShims.h"
 #include "xdr/Stellar-transaction.h"
@@ -71,11 +73,12 @@ getLedgerInfo(AbstractLedgerTxn& ltx, Application& app,
         sorobanConfig.stateArchivalSettings().minTemporaryTTL;
     info.max_entry_ttl = sorobanConfig.stateArchivalSettings().maxEntryTTL;
 
-    auto cpu = sorobanConfig.cpuCostParams();
-    auto mem = sorobanConfig.memCostParams();
-
-    info.cpu_cost_params = toCxxBuf(cpu);
-    info.mem_cost_params = toCxxBuf(mem);
+    // The bridge takes ownership of these buffers, so they can only be
+    // copied from the config's encoding, but that is a plain byte copy
+    info.cpu_cost_params = CxxBuf{std::make_unique<std::vector<uint8_t>>(
+        sorobanConfig.cpuCostParamsXdr())};
+    info.mem_cost_params = CxxBuf{std::make_unique<std::vector<uint8_t>>(
+        sorobanConfig.memCostParamsXdr())};
 
     auto& networkID = app.getNetworkID();
     info.network_id.reserve(networkID.size());
@@ -140,10 +143,38 @@ struct HostFunctionMetrics
 
     bool mSuccess{false};
 
+    // contract and function invoked, for their profiles, and the wall time
+    // spent in the host
+    std::string mContract;
+    std::string mFunction;
+    uint64_t mInvokeWallNsecs{0};
+
     HostFunctionMetrics(SorobanMetrics& metrics) : mMetrics(metrics)
     {
     }
 
+    void
+    setInvokedContract(HostFunction const& hostFunction)
+    {
+        if (hostFunction.type() != HOST_FUNCTION_TYPE_INVOKE_CONTRACT)
+        {
+            return;
+        }
+        auto const& args = hostFunction.invokeContract();
+        if (args.contractAddress.type() == SC_ADDRESS_TYPE_CONTRACT)
+        {
+            mContract =
+                strKey::toStrKey(strKey::STRKEY_CONTRACT,
+                                 args.contractAddress.contractId())
+                    .value;
+        }
+        else
+        {
+            mContract = KeyUtils::toStrKey(args.contractAddress.accountId());
+        }
+        mFunction = args.functionName;
+    }
+
     void
     noteReadEntry(bool isCodeEntry, uint32_t keySize, uint32_t entrySize)
     {
@@ -226,6 +257,19 @@ struct HostFunctionMetrics
         {
             mMetrics.mHostFnOpFailure.Mark();
         }
+
+        if (!mContract.empty())
+        {
+            SorobanMetrics::ContractProfile usage;
+            usage.mInvocations = 1;
+            usage.mCpuInsn = mCpuInsn;
+            usage.mInvokeTimeNsecs = mInvokeWallNsecs;
+            usage.mReadEntry = mReadEntry;
+            usage.mWriteEntry = mWriteEntry;
+            usage.mReadByte = mLedgerReadByte;
+            usage.mWriteByte = mLedgerWriteByte;
+            mMetrics.noteContractInvocation(mContract, mFunction, usage);
+        }
     }
     medida::TimerContext
     getExecTimer()
@@ -330,6 +374,7 @@ InvokeHostFunctionOpFrame::doApply(Application& app, AbstractLedgerTxn& ltx,
 
     Config const& appConfig = app.getConfig();
     HostFunctionMetrics metrics(app.getLedgerManager().getSorobanMetrics());
+    metrics.setInvokedContract(mInvokeHostFunction.hostFunction);
     auto timeScope = metrics.getExecTimer();
     auto const& sorobanConfig =
         app.getLedgerManager().getSorobanNetworkConfig();
@@ -371,6 +416,8 @@ InvokeHostFunctionOpFrame::doApply(Application& app, AbstractLedgerTxn& ltx,
                         {
                             if (lk.type() == CONTRACT_CODE)
                             {
+                                metrics.mMetrics.noteContractCodeArchived(
+                                    lk.contractCode().hash);
                                 mParentTx.pushApplyTimeDiagnosticError(
                                     appConfig, SCE_VALUE, SCEC_INVALID_INPUT,
                                     "trying to access an archived contract "
@@ -409,6 +456,11 @@ InvokeHostFunctionOpFrame::doApply(Application& app, AbstractLedgerTxn& ltx,
                 auto ltxe = ltx.loadWithoutRecord(lk);
                 if (ltxe)
                 {
+                    if (lk.type() == CONTRACT_CODE)
+                    {
+                        metrics.mMetrics.noteContractCodeInvoked(
+                            lk.contractCode().hash);
+                    }
                     auto leBuf = toCxxBuf(ltxe.current());
                     entrySize = static_cast<uint32_t>(leBuf.data->size());
 
@@ -483,6 +535,7 @@ InvokeHostFunctionOpFrame::doApply(Application& app, AbstractLedgerTxn& ltx,
         basePrngSeedBuf.data->assign(sorobanBasePrngSeed.begin(),
                                      sorobanBasePrngSeed.end());
 
+        auto invokeStart = std::chrono::steady_clock::now();
         out = rust_bridge::invoke_host_function(
             appConfig.CURRENT_LEDGER_PROTOCOL_VERSION,
             appConfig.ENABLE_SOROBAN_DIAGNOSTIC_EVENTS, resources.instructions,
@@ -491,6 +544,10 @@ InvokeHostFunctionOpFrame::doApply(Application& app, AbstractLedgerTxn& ltx,
             getLedgerInfo(ltx, app, sorobanConfig), ledgerEntryCxxBufs,
             ttlEntryCxxBufs, basePrngSeedBuf,
             sorobanConfig.rustBridgeRentFeeConfiguration());
+        metrics.mInvokeWallNsecs =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - invokeStart)
+                .count();
         metrics.mCpuInsn = out.cpu_insns;
         metrics.mMemByte = out.mem_bytes;
         metrics.mInvokeTimeNsecs = out.time_nsecs;
@@ -547,16 +604,18 @@ InvokeHostFunctionOpFrame::doApply(Application& app, AbstractLedgerTxn& ltx,
     UnorderedSet<LedgerKey> createdKeys;
     for (auto const& buf : out.modified_ledger_entries)
     {
+        // Entries are decoded straight out of the host's buffers, and then
+        // moved into the ledger when they replace an existing entry
         LedgerEntry le;
         xdr::xdr_from_opaque(buf.data, le);
-        if (!validateContractLedgerEntry(LedgerEntryKey(le), buf.data.size(),
-                                         sorobanConfig, appConfig, mParentTx))
+        auto lk = LedgerEntryKey(le);
+        if (!validateContractLedgerEntry(lk, buf.data.size(), sorobanConfig,
+                                         appConfig, mParentTx))
         {
             innerResult().code(INVOKE_HOST_FUNCTION_RESOURCE_LIMIT_EXCEEDED);
             return false;
         }
 
-        auto lk = LedgerEntryKey(le);
         createdAndModifiedKeys.insert(lk);
 
         uint32_t keySize = static_cast<uint32_t>(xdr::xdr_size(lk));
@@ -583,12 +642,16 @@ InvokeHostFunctionOpFrame::doApply(Application& app, AbstractLedgerTxn& ltx,
         auto ltxe = ltx.load(lk);
         if (ltxe)
         {
-            ltxe.current() = le;
+            ltxe.current() = std::move(le);
         }
         else
         {
             ltx.create(le);
             createdKeys.insert(lk);
+            if (lk.type() == CONTRACT_CODE)
+            {
+                metrics.mMetrics.noteContractCodeLive(lk.contractCode().hash);
+            }
         }
     }
 
@@ -732,6 +795,7 @@ void
 InvokeHostFunctionOpFrame::insertLedgerKeysToPrefetch(
     UnorderedSet<LedgerKey>& keys) const
 {
+    insertFootprintKeys(mParentTx.sorobanResources().footprint, keys);
 }
 
 bool
@@ -1110,6 +1110,7 @@ crossOfferV10(AbstractLedgerTxn& ltx, LedgerTxnEntry& sellingWheatOffer,
     releaseAssertOrThrow(maxWheatReceived > 0);
     releaseAssertOrThrow(maxSheepSend > 0);
     auto header = ltx.loadHeader();
+    auto const ledgerVersion = header.current().ledgerVersion;
 
     auto& offer = sellingWheatOffer.current().data.offer();
     Asset sheep = offer.buying;
@@ -1227,9 +1228,9 @@ crossOfferV10(AbstractLedgerTxn& ltx, LedgerTxnEntry& sellingWheatOffer,
     // deactivated at this point. Specifically, you cannot use sellingWheatOffer
     // or offer (which is a reference) since it is not active (and may have been
     // erased) at this point.
-    offerTrail.emplace_back(
-        makeClaimAtom(ltx.loadHeader().current().ledgerVersion, accountBID,
-                      offerID, wheat, numWheatReceived, sheep, numSheepSend));
+    offerTrail.emplace_back(makeClaimAtom(ledgerVersion, accountBID, offerID,
+                                          wheat, numWheatReceived, sheep,
+                                          numSheepSend));
     return res;
 }
 
@@ -1500,10 +1501,13 @@ convertWithOffers(
     sheepSend = 0;
     wheatReceived = 0;
 
+    // Crossing offers doesn't change the header, so this is read once instead
+    // of once per offer crossed
+    auto const ledgerVersion = ltxOuter.loadHeader().current().ledgerVersion;
+
     bool needMore = (maxWheatReceive > 0 && maxSheepSend > 0);
     if (needMore && maxOffersToCross == 0 &&
-        protocolVersionStartsFrom(ltxOuter.loadHeader().current().ledgerVersion,
-                                  ProtocolVersion::V_18))
+        protocolVersionStartsFrom(ledgerVersion, ProtocolVersion::V_18))
     {
         // offerTrail is going to be too long, fast fail
         // note that this condition can only happen in path payment when
@@ -1558,8 +1562,7 @@ convertWithOffers(
         int64_t numWheatReceived;
         int64_t numSheepSend;
         CrossOfferResult cor;
-        if (protocolVersionStartsFrom(ltx.loadHeader().current().ledgerVersion,
-                                      ProtocolVersion::V_10))
+        if (protocolVersionStartsFrom(ledgerVersion, ProtocolVersion::V_10))
         {
             bool wheatStays;
             cor = crossOfferV10(ltx, wheatOffer, maxWheatReceive,
@@ -1601,8 +1604,7 @@ convertWithOffers(
             return ConvertResult::ePartial;
         }
     }
-    if (protocolVersionIsBefore(ltxOuter.loadHeader().current().ledgerVersion,
-                                ProtocolVersion::V_10) ||
+    if (protocolVersionIsBefore(ledgerVersion, ProtocolVersion::V_10) ||
         !needMore)
     {
         return ConvertResult::eOK;
@@ -47,6 +47,14 @@ PaymentOpFrame::doApply(AbstractLedgerTxn& ltx)
         return true;
     }
 
+    // Before protocol 11, a destination balance overflow is reported in a way
+    // only the path payment handles
+    if (mPayment.asset.type() == ASSET_TYPE_NATIVE &&
+        protocolVersionStartsFrom(ledgerVersion, ProtocolVersion::V_11))
+    {
+        return doApplyNative(ltx, destID);
+    }
+
     // build a pathPaymentOp
     Operation op;
     op.sourceAccount = mOperation.sourceAccount;
@@ -118,6 +126,45 @@ PaymentOpFrame::doApply(AbstractLedgerTxn& ltx)
     return true;
 }
 
+bool
+PaymentOpFrame::doApplyNative(AbstractLedgerTxn& ltx, AccountID const& destID)
+{
+    // Same checks, in the same order, as the path payment makes for a native
+    // asset with an empty path: the destination, then its balance, then the
+    // source's available balance
+    if (!stellar::loadAccountWithoutRecord(ltx, destID))
+    {
+        innerResult().code(PAYMENT_NO_DESTINATION);
+        return false;
+    }
+
+    auto header = ltx.loadHeader();
+    {
+        auto destination = stellar::loadAccount(ltx, destID);
+        if (!addBalance(header, destination, mPayment.amount))
+        {
+            innerResult().code(PAYMENT_LINE_FULL);
+            return false;
+        }
+    }
+
+    auto sourceAccount = stellar::loadAccount(ltx, getSourceID());
+    if (!sourceAccount)
+    {
+        throw std::runtime_error("Payment source account does not exist");
+    }
+    if (mPayment.amount > getAvailableBalance(header, sourceAccount))
+    {
+        innerResult().code(PAYMENT_UNDERFUNDED);
+        return false;
+    }
+    auto ok = addBalance(header, sourceAccount, -mPayment.amount);
+    releaseAssertOrThrow(ok);
+
+    innerResult().code(PAYMENT_SUCCESS);
+    return true;
+}
+
 bool
 PaymentOpFrame::doCheckValid(uint32_t ledgerVersion)
 {
@@ -19,6 +19,10 @@ class PaymentOpFrame : public OperationFrame
     }
     PaymentOp const& mPayment;
 
+    // Native payments between two accounts, done directly on the accounts
+    // instead of through an equivalent PathPaymentStrictReceiveOpFrame
+    bool doApplyNative(AbstractLedgerTxn& ltx, AccountID const& destID);
+
   public:
     PaymentOpFrame(Operation const& op, OperationResult& res,
                    TransactionFrame& parentTx);
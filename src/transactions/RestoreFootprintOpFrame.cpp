@@ -89,15 +89,12 @@ RestoreFootprintOpFrame::doApply(Application& app, AbstractLedgerTxn& ltx,
             }
         }
 
-        // We must load the ContractCode/ContractData entry for fee purposes, as
-        // restore is considered a write
-        auto constEntryLtxe = ltx.loadWithoutRecord(lk);
+        // We must read the ContractCode/ContractData entry size for fee
+        // purposes, as restore is considered a write
+        uint32_t entrySize = ltx.getNewestVersionEncodedSize(lk);
 
         // We checked for TTLEntry existence above
-        releaseAssertOrThrow(constEntryLtxe);
-
-        uint32_t entrySize =
-            static_cast<uint32>(xdr::xdr_size(constEntryLtxe.current()));
+        releaseAssertOrThrow(entrySize != 0);
         metrics.mLedgerReadByte += entrySize;
         if (resources.readBytes < metrics.mLedgerReadByte)
         {
@@ -146,6 +143,10 @@ RestoreFootprintOpFrame::doApply(Application& app, AbstractLedgerTxn& ltx,
         auto ttlLtxe = ltx.load(ttlKey);
         ttlLtxe.current().data.ttl().liveUntilLedgerSeq =
             restoredLiveUntilLedger;
+        if (lk.type() == CONTRACT_CODE)
+        {
+            metrics.mMetrics.noteContractCodeLive(lk.contractCode().hash);
+        }
     }
     uint32_t ledgerVersion = ltx.loadHeader().current().ledgerVersion;
     int64_t rentFee = rust_bridge::compute_rent_fee(
@@ -208,6 +209,7 @@ void
 RestoreFootprintOpFrame::insertLedgerKeysToPrefetch(
     UnorderedSet<LedgerKey>& keys) const
 {
+    insertFootprintKeys(mParentTx.sorobanResources().footprint, keys);
 }
 
 bool
@@ -9,7 +9,6 @@
 #include "crypto/SecretKey.h"
 #include "crypto/SignerKey.h"
 #include "transactions/SignatureUtils.h"
-#include "util/Algorithm.h"
 #include "util/ProtocolVersion.h"
 #include "util/XDROperators.h"
 #include <Tracy.hpp>
@@ -40,8 +39,22 @@ SignatureChecker::checkSignature(std::vector<Signer> const& signersV,
         return true;
     }
 
-    auto signers =
-        split(signersV, [](const Signer& s) { return s.key.type(); });
+    // Signers are walked in place, by key type, instead of being copied into
+    // a vector per type: a signer that matched a signature is marked in
+    // usedSigners rather than erased, so each one counts at most once and
+    // the order signers are tried in is unchanged
+    std::vector<bool> usedSigners(signersV.size());
+
+    auto signerWeight = [&](Signer const& signerKey) -> uint32_t {
+        auto w = signerKey.weight;
+        if (protocolVersionStartsFrom(mProtocolVersion,
+                                      ProtocolVersion::V_10) &&
+            w > UINT8_MAX)
+        {
+            w = UINT8_MAX;
+        }
+        return w;
+    };
 
     // calculate the weight of the signatures
     int totalWeight = 0;
@@ -51,18 +64,12 @@ SignatureChecker::checkSignature(std::vector<Signer> const& signersV,
     // current transaction hash is not stored in getEnvelope().signatures - it
     // is
     // computed with getContentsHash() method
-    for (auto const& signerKey : signers[SIGNER_KEY_TYPE_PRE_AUTH_TX])
+    for (auto const& signerKey : signersV)
     {
-        if (signerKey.key.preAuthTx() == mContentsHash)
+        if (signerKey.key.type() == SIGNER_KEY_TYPE_PRE_AUTH_TX &&
+            signerKey.key.preAuthTx() == mContentsHash)
         {
-            auto w = signerKey.weight;
-            if (protocolVersionStartsFrom(mProtocolVersion,
-                                          ProtocolVersion::V_10) &&
-                w > UINT8_MAX)
-            {
-                w = UINT8_MAX;
-            }
-            totalWeight += w;
+            totalWeight += signerWeight(signerKey);
             if (totalWeight >= neededWeight)
                 return true;
         }
@@ -70,29 +77,26 @@ SignatureChecker::checkSignature(std::vector<Signer> const& signersV,
 
     using VerifyT =
         std::function<bool(DecoratedSignature const&, Signer const&)>;
-    auto verifyAll = [&](std::vector<Signer>& signers, VerifyT verify) {
+    auto verifyAll = [&](SignerKeyType type, VerifyT verify) {
         for (size_t i = 0; i < mSignatures.size(); i++)
         {
             auto const& sig = mSignatures[i];
 
-            for (auto it = signers.begin(); it != signers.end(); ++it)
+            for (size_t j = 0; j < signersV.size(); ++j)
             {
-                auto& signerKey = *it;
+                auto const& signerKey = signersV[j];
+                if (usedSigners[j] || signerKey.key.type() != type)
+                {
+                    continue;
+                }
                 if (verify(sig, signerKey))
                 {
                     mUsedSignatures[i] = true;
-                    auto w = signerKey.weight;
-                    if (protocolVersionStartsFrom(mProtocolVersion,
-                                                  ProtocolVersion::V_10) &&
-                        w > UINT8_MAX)
-                    {
-                        w = UINT8_MAX;
-                    }
-                    totalWeight += w;
+                    totalWeight += signerWeight(signerKey);
                     if (totalWeight >= neededWeight)
                         return true;
 
-                    signers.erase(it);
+                    usedSigners[j] = true;
                     break;
                 }
             }
@@ -102,7 +106,7 @@ SignatureChecker::checkSignature(std::vector<Signer> const& signersV,
     };
 
     auto verified =
-        verifyAll(signers[SIGNER_KEY_TYPE_HASH_X],
+        verifyAll(SIGNER_KEY_TYPE_HASH_X,
                   [&](DecoratedSignature const& sig, Signer const& signerKey) {
                       return SignatureUtils::verifyHashX(sig, signerKey.key);
                   });
@@ -112,7 +116,7 @@ SignatureChecker::checkSignature(std::vector<Signer> const& signersV,
     }
 
     verified = verifyAll(
-        signers[SIGNER_KEY_TYPE_ED25519],
+        SIGNER_KEY_TYPE_ED25519,
         [&](DecoratedSignature const& sig, Signer const& signerKey) {
             return SignatureUtils::verify(sig, signerKey.key, mContentsHash);
         });
@@ -122,7 +126,7 @@ SignatureChecker::checkSignature(std::vector<Signer> const& signersV,
     }
 
     verified =
-        verifyAll(signers[SIGNER_KEY_TYPE_ED25519_SIGNED_PAYLOAD],
+        verifyAll(SIGNER_KEY_TYPE_ED25519_SIGNED_PAYLOAD,
                   [&](DecoratedSignature const& sig, Signer const& signerKey) {
                       return SignatureUtils::verifyEd25519SignedPayload(
                           sig, signerKey.key);
@@ -14,6 +14,7 @@
 #include "herder/TxSetFrame.h"
 #include "invariant/InvariantDoesNotHold.h"
 #include "invariant/InvariantManager.h"
+#include "ledger/LedgerApplyTrace.h"
 #include "ledger/LedgerHeaderUtils.h"
 #include "ledger/LedgerTxn.h"
 #include "ledger/LedgerTxnEntry.h"
@@ -26,6 +27,7 @@
 #include "transactions/TransactionBridge.h"
 #include "transactions/TransactionMetaFrame.h"
 #include "transactions/TransactionUtils.h"
+#include "transactions/TxValidityCache.h"
 #include "util/Decoder.h"
 #include "util/GlobalChecks.h"
 #include "util/Logging.h"
@@ -1343,6 +1345,68 @@ TransactionFrame::isBadSeq(LedgerTxnHeader const& header, int64_t seqNum) const
     return seqNum == INT64_MAX || seqNum + 1 != getSeqNum();
 }
 
+// Key of the TxValidityCache entry for checking this transaction against ltx:
+// a hash of the envelope and of everything else checkValid depends on, apart
+// from the close time offsets. That is the header, whether the fee is charged,
+// the sequence number the transaction must follow and the source accounts of
+// the transaction and its operations, which hold the signers, thresholds,
+// sequence number and balance checked. Soroban transactions, whose checks also
+// depend on the network config, and protocols before 10, where checkValid
+// caches the source account, are not cached.
+std::optional<Hash>
+TransactionFrame::validityCacheKey(AbstractLedgerTxn& ltx,
+                                   SequenceNumber current,
+                                   bool chargeFee) const
+{
+    ZoneScoped;
+    if (isSoroban())
+    {
+        return std::nullopt;
+    }
+
+    XDRSHA256 hasher;
+    {
+        auto header = ltx.loadHeader();
+        if (protocolVersionIsBefore(header.current().ledgerVersion,
+                                    ProtocolVersion::V_10))
+        {
+            return std::nullopt;
+        }
+        hasher.hashXDR(header.current());
+    }
+    hasher.hashXDR(mNetworkID);
+    hasher.hashXDR(mEnvelope);
+    hasher.hashXDR(chargeFee);
+
+    {
+        auto sourceAccount = ltx.loadWithoutRecord(accountKey(getSourceID()));
+        if (!sourceAccount)
+        {
+            return std::nullopt;
+        }
+        auto const& le = sourceAccount.current();
+        hasher.hashXDR(le);
+        // The queue passes 0 for "follows the account's sequence number",
+        // which tx set validation passes explicitly
+        hasher.hashXDR(current == 0 ? le.data.account().seqNum : current);
+    }
+    for (auto const& op : mOperations)
+    {
+        if (op->getSourceID() == getSourceID())
+        {
+            continue;
+        }
+        auto opSourceAccount =
+            ltx.loadWithoutRecord(accountKey(op->getSourceID()));
+        hasher.hashXDR(static_cast<bool>(opSourceAccount));
+        if (opSourceAccount)
+        {
+            hasher.hashXDR(opSourceAccount.current());
+        }
+    }
+    return hasher.state.finish();
+}
+
 TransactionFrame::ValidationType
 TransactionFrame::commonValid(Application& app,
                               SignatureChecker& signatureChecker,
@@ -1552,6 +1616,24 @@ TransactionFrame::checkValidWithOptionallyChargedFee(
 {
     ZoneScoped;
     mCachedAccount.reset();
+    bool res = checkValidAgainstLedger(app, ltxOuter, current, chargeFee,
+                                       lowerBoundCloseTimeOffset,
+                                       upperBoundCloseTimeOffset);
+    // The cached source account only saves loads within a single call, while
+    // frames that passed validation can wait in the transaction queue for
+    // many ledgers: don't keep a copy of the account alive with each of them
+    mCachedAccount.reset();
+    return res;
+}
+
+bool
+TransactionFrame::checkValidAgainstLedger(Application& app,
+                                          AbstractLedgerTxn& ltxOuter,
+                                          SequenceNumber current,
+                                          bool chargeFee,
+                                          uint64_t lowerBoundCloseTimeOffset,
+                                          uint64_t upperBoundCloseTimeOffset)
+{
 
     if (!XDRProvidesValidFee())
     {
@@ -1568,6 +1650,34 @@ TransactionFrame::checkValidWithOptionallyChargedFee(
 
     resetResults(ltx.loadHeader().current(), minBaseFee, false);
 
+    // If this transaction already passed these checks against the same ledger
+    // state, only the close time bounds, which callers check with different
+    // offsets, are left to check
+    auto& validityCache = app.getLedgerManager().getTxValidityCache();
+    auto cacheKey = validityCacheKey(ltx, current, chargeFee);
+    if (cacheKey && validityCache.isKnownValid(*cacheKey))
+    {
+        auto header = ltx.loadHeader();
+        if (isTooEarly(header, lowerBoundCloseTimeOffset))
+        {
+            getResult().result.code(txTOO_EARLY);
+            return false;
+        }
+        if (isTooLate(header, upperBoundCloseTimeOffset))
+        {
+            getResult().result.code(txTOO_LATE);
+            return false;
+        }
+        auto sourceAccount = loadSourceAccount(ltx, header);
+        if (isTooEarlyForAccount(header, sourceAccount,
+                                 lowerBoundCloseTimeOffset))
+        {
+            getResult().result.code(txBAD_MIN_SEQ_AGE_OR_GAP);
+            return false;
+        }
+        return true;
+    }
+
     SignatureChecker signatureChecker{ltx.loadHeader().current().ledgerVersion,
                                       getContentsHash(),
                                       getSignatures(mEnvelope)};
@@ -1604,6 +1714,10 @@ TransactionFrame::checkValidWithOptionallyChargedFee(
             getResult().result.code(txBAD_AUTH_EXTRA);
         }
     }
+    if (res && cacheKey)
+    {
+        validityCache.addValid(*cacheKey);
+    }
     return res;
 }
 
@@ -1653,6 +1767,26 @@ TransactionFrame::insertKeysForTxApply(UnorderedSet<LedgerKey>& keys) const
     }
 }
 
+void
+TransactionFrame::insertSignaturesToVerify(
+    AccountSignersLoader const& loadSigners,
+    std::vector<SignatureToVerify>& sigs) const
+{
+    UnorderedSet<AccountID> accounts{getSourceID()};
+    for (auto const& op : mOperations)
+    {
+        accounts.emplace(op->getSourceID());
+    }
+    auto const& signatures =
+        mEnvelope.type() == ENVELOPE_TYPE_TX_V0 ? mEnvelope.v0().signatures
+                                                : mEnvelope.v1().signatures;
+    for (auto const& id : accounts)
+    {
+        insertAccountSignaturesToVerify(loadSigners, id, signatures,
+                                        getContentsHash(), sigs);
+    }
+}
+
 void
 TransactionFrame::markResultFailed()
 {
@@ -1689,6 +1823,7 @@ TransactionFrame::applyOperations(SignatureChecker& signatureChecker,
         operationMetas.reserve(getNumOperations());
 
         // shield outer scope of any side effects with LedgerTxn
+        app.getInvariantManager().onTransactionStart(ltx);
         LedgerTxn ltxTx(ltx);
         uint32_t ledgerVersion = ltxTx.loadHeader().current().ledgerVersion;
         // We do not want to increase the internal-error metric count for
@@ -1704,6 +1839,10 @@ TransactionFrame::applyOperations(SignatureChecker& signatureChecker,
         for (auto& op : mOperations)
         {
             auto time = opTimer.TimeScope();
+            LedgerApplyTrace::Scope opScope(
+                xdr::xdr_traits<OperationType>::enum_name(
+                    op->getOperation().body.type()),
+                "op");
             LedgerTxn ltxOp(ltxTx);
 
             Hash subSeed = sorobanBasePrngSeed;
@@ -1718,6 +1857,7 @@ TransactionFrame::applyOperations(SignatureChecker& signatureChecker,
             ++opNum;
 
             bool txRes = op->apply(app, signatureChecker, ltxOp, subSeed);
+            opScope.setSuccess(txRes);
 
             if (!txRes)
             {
@@ -1771,6 +1911,7 @@ TransactionFrame::applyOperations(SignatureChecker& signatureChecker,
             }
 
             ltxTx.commit();
+            app.getInvariantManager().onTransactionCommit();
             // commit -> propagate the meta to the outer scope
             outerMeta.pushOperationMetas(std::move(operationMetas));
             outerMeta.pushTxChangesAfter(std::move(changesAfter));
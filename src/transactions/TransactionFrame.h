@@ -82,6 +82,11 @@ class TransactionFrame : public TransactionFrameBase
     LedgerTxnEntry loadSourceAccount(AbstractLedgerTxn& ltx,
                                      LedgerTxnHeader const& header);
 
+    bool checkValidAgainstLedger(Application& app, AbstractLedgerTxn& ltxOuter,
+                                 SequenceNumber current, bool chargeFee,
+                                 uint64_t lowerBoundCloseTimeOffset,
+                                 uint64_t upperBoundCloseTimeOffset);
+
     enum ValidationType
     {
         kInvalid,             // transaction is not valid at all
@@ -109,6 +114,10 @@ class TransactionFrame : public TransactionFrameBase
 
     virtual bool isBadSeq(LedgerTxnHeader const& header, int64_t seqNum) const;
 
+    std::optional<Hash> validityCacheKey(AbstractLedgerTxn& ltx,
+                                         SequenceNumber current,
+                                         bool chargeFee) const;
+
     ValidationType commonValid(Application& app,
                                SignatureChecker& signatureChecker,
                                AbstractLedgerTxn& ltxOuter,
@@ -265,6 +274,10 @@ class TransactionFrame : public TransactionFrameBase
     void
     insertKeysForFeeProcessing(UnorderedSet<LedgerKey>& keys) const override;
     void insertKeysForTxApply(UnorderedSet<LedgerKey>& keys) const override;
+    using TransactionFrameBase::insertSignaturesToVerify;
+    void insertSignaturesToVerify(
+        AccountSignersLoader const& loadSigners,
+        std::vector<SignatureToVerify>& sigs) const override;
 
     // collect fee, consume sequence number
     void processFeeSeqNum(AbstractLedgerTxn& ltx,
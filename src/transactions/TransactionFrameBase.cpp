@@ -3,8 +3,11 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "transactions/TransactionFrameBase.h"
+#include "ledger/LedgerTxn.h"
+#include "ledger/LedgerTxnEntry.h"
 #include "transactions/FeeBumpTransactionFrame.h"
 #include "transactions/TransactionFrame.h"
+#include "transactions/TransactionUtils.h"
 
 namespace stellar
 {
@@ -24,4 +27,20 @@ TransactionFrameBase::makeTransactionFromWire(Hash const& networkID,
         abort();
     }
 }
+
+void
+TransactionFrameBase::insertSignaturesToVerify(
+    AbstractLedgerTxn& ltx, std::vector<SignatureToVerify>& sigs) const
+{
+    insertSignaturesToVerify(
+        [&](AccountID const& id) {
+            xdr::xvector<Signer, MAX_SIGNERS> res;
+            if (auto account = loadAccountWithoutRecord(ltx, id))
+            {
+                res = account.current().data.account().signers;
+            }
+            return res;
+        },
+        sigs);
+}
 }
@@ -6,11 +6,13 @@
 
 #include <optional>
 
+#include "crypto/SecretKey.h"
 #include "ledger/LedgerHashUtils.h"
 #include "ledger/NetworkConfig.h"
 #include "main/Config.h"
 #include "overlay/StellarXDR.h"
 #include "transactions/TransactionMetaFrame.h"
+#include "transactions/TransactionUtils.h"
 #include "util/TxResource.h"
 #include "util/UnorderedSet.h"
 #include "util/types.h"
@@ -79,6 +81,16 @@ class TransactionFrameBase
     virtual void
     insertKeysForFeeProcessing(UnorderedSet<LedgerKey>& keys) const = 0;
     virtual void insertKeysForTxApply(UnorderedSet<LedgerKey>& keys) const = 0;
+    // Adds every signature of the transaction along with the keys of the
+    // involved accounts, with signers as returned by loadSigners, whose hint
+    // it matches. Verifying these ahead of time populates the signature cache
+    // for when the transaction is validated or applied.
+    virtual void
+    insertSignaturesToVerify(AccountSignersLoader const& loadSigners,
+                             std::vector<SignatureToVerify>& sigs) const = 0;
+    // Same, with the signers of the accounts as of ltx
+    void insertSignaturesToVerify(AbstractLedgerTxn& ltx,
+                                  std::vector<SignatureToVerify>& sigs) const;
 
     virtual void processFeeSeqNum(AbstractLedgerTxn& ltx,
                                   std::optional<int64_t> baseFee) = 0;
@@ -48,7 +48,7 @@ TransactionMetaFrame::getNumChangesBefore() const
     }
 }
 
-LedgerEntryChanges
+LedgerEntryChanges const&
 TransactionMetaFrame::getChangesBefore() const
 {
     switch (mTransactionMeta.v())
@@ -62,7 +62,7 @@ TransactionMetaFrame::getChangesBefore() const
     }
 }
 
-LedgerEntryChanges
+LedgerEntryChanges const&
 TransactionMetaFrame::getChangesAfter() const
 {
     switch (mTransactionMeta.v())
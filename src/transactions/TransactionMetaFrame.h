@@ -18,8 +18,8 @@ class TransactionMetaFrame
 
     void pushTxChangesBefore(LedgerEntryChanges&& changes);
     size_t getNumChangesBefore() const;
-    LedgerEntryChanges getChangesBefore() const;
-    LedgerEntryChanges getChangesAfter() const;
+    LedgerEntryChanges const& getChangesBefore() const;
+    LedgerEntryChanges const& getChangesAfter() const;
     void clearOperationMetas();
     void pushOperationMetas(xdr::xvector<OperationMeta>&& opMetas);
     size_t getNumOperations() const;
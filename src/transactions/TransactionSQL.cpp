@@ -8,13 +8,16 @@
 #include "database/DatabaseUtils.h"
 #include "herder/TxSetFrame.h"
 #include "ledger/LedgerHeaderUtils.h"
+#include "ledger/LedgerTxnImpl.h"
 #include "main/Application.h"
 #include "util/Decoder.h"
 #include "util/GlobalChecks.h"
 #include "util/XDRStream.h"
+#include "util/types.h"
 #include "xdrpp/marshal.h"
 #include "xdrpp/message.h"
 #include <Tracy.hpp>
+#include <functional>
 
 namespace stellar
 {
@@ -345,60 +348,195 @@ writeTxSetToStream(
     }
 }
 
-} // namespace
-
-void
-storeTransaction(Database& db, uint32_t ledgerSeq,
-                 TransactionFrameBasePtr const& tx, TransactionMeta const& tm,
-                 TransactionResultSet const& resultSet, Config const& cfg)
+// Inserts the rows of a TransactionHistoryBatch into txhistory or
+// txfeehistory with one statement
+class BulkInsertTxHistoryOperation : public DatabaseTypeSpecificOperation<void>
 {
-    ZoneScoped;
-    std::string txBody =
-        decoder::encode_b64(xdr::xdr_to_opaque(tx->getEnvelope()));
-    std::string txResult =
-        decoder::encode_b64(xdr::xdr_to_opaque(resultSet.results.back()));
-    std::string meta = decoder::encode_b64(xdr::xdr_to_opaque(tm));
+    Database& mDb;
+    std::string const mTable;
+    std::vector<std::string> const mColumnNames;
+    TransactionHistoryBatch::Rows& mRows;
 
-    std::string txIDString = binToHex(tx->getContentsHash());
-    uint32_t txIndex = static_cast<uint32_t>(resultSet.results.size());
+    std::string
+    columnList() const
+    {
+        std::string cols = "txid, ledgerseq, txindex";
+        for (auto const& c : mColumnNames)
+        {
+            cols += ", " + c;
+        }
+        return cols;
+    }
 
-    std::string sqlStr;
-    if (cfg.isUsingBucketListDB())
+    void
+    execute(std::string const& sql,
+            std::function<void(soci::statement&)> const& bind)
     {
-        sqlStr = "INSERT INTO txhistory "
-                 "( txid, ledgerseq, txindex,  txbody, txresult) VALUES "
-                 "(:id,  :seq,      :txindex, :txb,   :txres)";
+        auto prep = mDb.getPreparedStatement(sql);
+        soci::statement& st = prep.statement();
+        bind(st);
+        st.define_and_bind();
+        {
+            auto timer = mDb.getInsertTimer(mTable);
+            st.execute(true);
+        }
+        if (static_cast<size_t>(st.get_affected_rows()) !=
+            mRows.mTxIDs.size())
+        {
+            throw std::runtime_error("Could not update data in SQL");
+        }
     }
-    else
+
+  public:
+    BulkInsertTxHistoryOperation(Database& db, std::string table,
+                                 std::vector<std::string> columnNames,
+                                 TransactionHistoryBatch::Rows& rows)
+        : mDb(db)
+        , mTable(std::move(table))
+        , mColumnNames(std::move(columnNames))
+        , mRows(rows)
     {
-        sqlStr =
-            "INSERT INTO txhistory "
-            "( txid, ledgerseq, txindex,  txbody, txresult, txmeta) VALUES "
-            "(:id,  :seq,      :txindex, :txb,   :txres,   :meta)";
+        releaseAssert(mRows.mColumns.size() == mColumnNames.size());
     }
 
-    auto prep = db.getPreparedStatement(sqlStr);
-    auto& st = prep.statement();
-    st.exchange(soci::use(txIDString));
-    st.exchange(soci::use(ledgerSeq));
-    st.exchange(soci::use(txIndex));
-    st.exchange(soci::use(txBody));
-    st.exchange(soci::use(txResult));
+    void
+    doSqliteSpecificOperation(soci::sqlite3_session_backend* sq) override
+    {
+        std::string values = ":id, :seq, :txindex";
+        for (size_t i = 0; i < mColumnNames.size(); ++i)
+        {
+            values += ", :v" + std::to_string(i);
+        }
+        execute("INSERT INTO " + mTable + " (" + columnList() + ") VALUES (" +
+                    values + ")",
+                [&](soci::statement& st) {
+                    st.exchange(soci::use(mRows.mTxIDs));
+                    st.exchange(soci::use(mRows.mLedgerSeqs));
+                    st.exchange(soci::use(mRows.mTxIndexes));
+                    for (auto& c : mRows.mColumns)
+                    {
+                        st.exchange(soci::use(c));
+                    }
+                });
+    }
+
+#ifdef USE_POSTGRES
+    void
+    doPostgresSpecificOperation(soci::postgresql_session_backend* pg) override
+    {
+        PGconn* conn = pg->conn_;
+        std::string strTxIDs, strLedgerSeqs, strTxIndexes;
+        marshalToPGArray(conn, strTxIDs, mRows.mTxIDs);
+        marshalToPGArray(conn, strLedgerSeqs, mRows.mLedgerSeqs);
+        marshalToPGArray(conn, strTxIndexes, mRows.mTxIndexes);
+        std::vector<std::string> strColumns(mRows.mColumns.size());
+        std::string values = "unnest(:id::TEXT[]), unnest(:seq::INT[]), "
+                             "unnest(:txindex::INT[])";
+        for (size_t i = 0; i < mRows.mColumns.size(); ++i)
+        {
+            marshalToPGArray(conn, strColumns[i], mRows.mColumns[i]);
+            values += ", unnest(:v" + std::to_string(i) + "::TEXT[])";
+        }
+        execute("WITH r AS (SELECT " + values + ") INSERT INTO " + mTable +
+                    " (" + columnList() + ") SELECT * FROM r",
+                [&](soci::statement& st) {
+                    st.exchange(soci::use(strTxIDs));
+                    st.exchange(soci::use(strLedgerSeqs));
+                    st.exchange(soci::use(strTxIndexes));
+                    for (auto& c : strColumns)
+                    {
+                        st.exchange(soci::use(c));
+                    }
+                });
+    }
+#endif
+};
 
-    if (!cfg.isUsingBucketListDB())
+void
+clearRows(TransactionHistoryBatch::Rows& rows)
+{
+    rows.mTxIDs.clear();
+    rows.mLedgerSeqs.clear();
+    rows.mTxIndexes.clear();
+    for (auto& c : rows.mColumns)
     {
-        st.exchange(soci::use(meta));
+        c.clear();
     }
+}
 
-    st.define_and_bind();
-    {
-        auto timer = db.getInsertTimer("txhistory");
-        st.execute(true);
+void
+appendRow(TransactionHistoryBatch::Rows& rows,
+          TransactionFrameBasePtr const& tx, int32_t ledgerSeq,
+          uint32_t txIndex)
+{
+    rows.mTxIDs.emplace_back(binToHex(tx->getContentsHash()));
+    rows.mLedgerSeqs.emplace_back(ledgerSeq);
+    rows.mTxIndexes.emplace_back(unsignedToSigned(txIndex));
+}
+} // namespace
+
+TransactionHistoryBatch::TransactionHistoryBatch(uint32_t ledgerSeq,
+                                                 Config const& cfg)
+    : mLedgerSeq(unsignedToSigned(ledgerSeq))
+    , mStoreMeta(!cfg.isUsingBucketListDB())
+{
+    mTxs.mColumns.resize(mStoreMeta ? 3 : 2);
+    mFees.mColumns.resize(1);
+}
+
+void
+TransactionHistoryBatch::addTransaction(TransactionFrameBasePtr const& tx,
+                                        TransactionMeta const& tm,
+                                        TransactionResultPair const& result,
+                                        uint32_t txIndex)
+{
+    ZoneScoped;
+    appendRow(mTxs, tx, mLedgerSeq, txIndex);
+    mTxs.mColumns[0].emplace_back(
+        decoder::encode_b64(xdr::xdr_to_opaque(tx->getEnvelope())));
+    mTxs.mColumns[1].emplace_back(
+        decoder::encode_b64(xdr::xdr_to_opaque(result)));
+    // Meta is by far the largest part of the row, so it is not encoded
+    // unless needed
+    if (mStoreMeta)
+    {
+        mTxs.mColumns[2].emplace_back(
+            decoder::encode_b64(xdr::xdr_to_opaque(tm)));
     }
+}
 
-    if (st.get_affected_rows() != 1)
+void
+TransactionHistoryBatch::addTransactionFee(TransactionFrameBasePtr const& tx,
+                                           LedgerEntryChanges const& changes,
+                                           uint32_t txIndex)
+{
+    ZoneScoped;
+    appendRow(mFees, tx, mLedgerSeq, txIndex);
+    mFees.mColumns[0].emplace_back(
+        decoder::encode_b64(xdr::xdr_to_opaque(changes)));
+}
+
+void
+TransactionHistoryBatch::store(Database& db)
+{
+    ZoneScoped;
+    if (!mTxs.mTxIDs.empty())
     {
-        throw std::runtime_error("Could not update data in SQL");
+        std::vector<std::string> columns{"txbody", "txresult"};
+        if (mStoreMeta)
+        {
+            columns.emplace_back("txmeta");
+        }
+        BulkInsertTxHistoryOperation op(db, "txhistory", columns, mTxs);
+        db.doDatabaseTypeSpecificOperation(op);
+        clearRows(mTxs);
+    }
+    if (!mFees.mTxIDs.empty())
+    {
+        BulkInsertTxHistoryOperation op(db, "txfeehistory", {"txchanges"},
+                                        mFees);
+        db.doDatabaseTypeSpecificOperation(op);
+        clearRows(mFees);
     }
 }
 
@@ -435,38 +573,6 @@ storeTxSet(Database& db, uint32_t ledgerSeq, TxSetXDRFrame const& txSet)
     }
 }
 
-void
-storeTransactionFee(Database& db, uint32_t ledgerSeq,
-                    TransactionFrameBasePtr const& tx,
-                    LedgerEntryChanges const& changes, uint32_t txIndex)
-{
-    ZoneScoped;
-    std::string txChanges = decoder::encode_b64(xdr::xdr_to_opaque(changes));
-
-    std::string txIDString = binToHex(tx->getContentsHash());
-
-    auto prep = db.getPreparedStatement(
-        "INSERT INTO txfeehistory "
-        "( txid, ledgerseq, txindex,  txchanges) VALUES "
-        "(:id,  :seq,      :txindex, :txchanges)");
-
-    auto& st = prep.statement();
-    st.exchange(soci::use(txIDString));
-    st.exchange(soci::use(ledgerSeq));
-    st.exchange(soci::use(txIndex));
-    st.exchange(soci::use(txChanges));
-    st.define_and_bind();
-    {
-        auto timer = db.getInsertTimer("txfeehistory");
-        st.execute(true);
-    }
-
-    if (st.get_affected_rows() != 1)
-    {
-        throw std::runtime_error("Could not update data in SQL");
-    }
-}
-
 TransactionResultSet
 getTransactionHistoryResults(Database& db, uint32 ledgerSeq)
 {
@@ -667,15 +773,15 @@ dropTransactionHistory(Database& db, Config const& cfg)
 }
 
 void
-deleteOldTransactionHistoryEntries(Database& db, uint32_t ledgerSeq,
-                                   uint32_t count)
+deleteOldTransactionHistoryEntries(soci::session& sess,
+                                   uint32_t ledgerSeq, uint32_t count)
 {
     ZoneScoped;
-    DatabaseUtils::deleteOldEntriesHelper(db.getSession(), ledgerSeq, count,
-                                          "txhistory", "ledgerseq");
-    DatabaseUtils::deleteOldEntriesHelper(db.getSession(), ledgerSeq, count,
+    DatabaseUtils::deleteOldEntriesHelper(sess, ledgerSeq, count, "txhistory",
+                                          "ledgerseq");
+    DatabaseUtils::deleteOldEntriesHelper(sess, ledgerSeq, count,
                                           "txsethistory", "ledgerseq");
-    DatabaseUtils::deleteOldEntriesHelper(db.getSession(), ledgerSeq, count,
+    DatabaseUtils::deleteOldEntriesHelper(sess, ledgerSeq, count,
                                           "txfeehistory", "ledgerseq");
 }
 
@@ -14,16 +14,43 @@ namespace stellar
 class Application;
 class XDROutputFileStream;
 
-void storeTransaction(Database& db, uint32_t ledgerSeq,
-                      TransactionFrameBasePtr const& tx,
-                      TransactionMeta const& tm,
-                      TransactionResultSet const& resultSet, Config const& cfg);
+// Rows of the txhistory and txfeehistory tables for the transactions of one
+// ledger, encoded as they are added and inserted by store() with a single
+// statement per table, instead of one per row.
+class TransactionHistoryBatch
+{
+  public:
+    TransactionHistoryBatch(uint32_t ledgerSeq, Config const& cfg);
 
-void storeTxSet(Database& db, uint32_t ledgerSeq, TxSetXDRFrame const& txSet);
+    // txIndex of both counts from 1
+    void addTransaction(TransactionFrameBasePtr const& tx,
+                        TransactionMeta const& tm,
+                        TransactionResultPair const& result, uint32_t txIndex);
+    void addTransactionFee(TransactionFrameBasePtr const& tx,
+                           LedgerEntryChanges const& changes,
+                           uint32_t txIndex);
+
+    // Inserts the rows added since the last call
+    void store(Database& db);
 
-void storeTransactionFee(Database& db, uint32_t ledgerSeq,
-                         TransactionFrameBasePtr const& tx,
-                         LedgerEntryChanges const& changes, uint32_t txIndex);
+    struct Rows
+    {
+        std::vector<std::string> mTxIDs;
+        std::vector<int32_t> mLedgerSeqs;
+        std::vector<int32_t> mTxIndexes;
+        // Body, result and meta in txhistory; changes in txfeehistory
+        std::vector<std::vector<std::string>> mColumns;
+    };
+
+  private:
+    int32_t const mLedgerSeq;
+    // Meta is only stored without BucketListDB
+    bool const mStoreMeta;
+    Rows mTxs;
+    Rows mFees;
+};
+
+void storeTxSet(Database& db, uint32_t ledgerSeq, TxSetXDRFrame const& txSet);
 
 TransactionResultSet getTransactionHistoryResults(Database& db,
                                                   uint32 ledgerSeq);
@@ -40,8 +67,8 @@ void createTxSetHistoryTable(Database& db);
 
 void dropTransactionHistory(Database& db, Config const& cfg);
 
-void deleteOldTransactionHistoryEntries(Database& db, uint32_t ledgerSeq,
-                                        uint32_t count);
+void deleteOldTransactionHistoryEntries(soci::session& sess,
+                                        uint32_t ledgerSeq, uint32_t count);
 
 void deleteNewerTransactionHistoryEntries(Database& db, uint32_t ledgerSeq);
 }
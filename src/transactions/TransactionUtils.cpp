@@ -3,6 +3,7 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "transactions/TransactionUtils.h"
+#include "crypto/KeyUtils.h"
 #include "crypto/SHA.h"
 #include "crypto/SecretKey.h"
 #include "ledger/InternalLedgerEntry.h"
@@ -11,7 +12,9 @@
 #include "ledger/LedgerTxnHeader.h"
 #include "ledger/TrustLineWrapper.h"
 #include "transactions/OfferExchange.h"
+#include "transactions/SignatureUtils.h"
 #include "transactions/SponsorshipUtils.h"
+#include "transactions/TransactionFrameBase.h"
 #include "util/ProtocolVersion.h"
 #include "util/XDROperators.h"
 #include "util/types.h"
@@ -332,6 +335,32 @@ loadAccountWithoutRecord(AbstractLedgerTxn& ltx, AccountID const& accountID)
     return ltx.loadWithoutRecord(accountKey(accountID));
 }
 
+void
+insertAccountSignaturesToVerify(
+    AccountSignersLoader const& loadSigners, AccountID const& accountID,
+    xdr::xvector<DecoratedSignature, 20> const& signatures, Hash const& hash,
+    std::vector<SignatureToVerify>& sigs)
+{
+    std::vector<PublicKey> keys{accountID};
+    for (auto const& signer : loadSigners(accountID))
+    {
+        if (signer.key.type() == SIGNER_KEY_TYPE_ED25519)
+        {
+            keys.emplace_back(KeyUtils::convertKey<PublicKey>(signer.key));
+        }
+    }
+    for (auto const& sig : signatures)
+    {
+        for (auto const& key : keys)
+        {
+            if (SignatureUtils::doesHintMatch(key.ed25519(), sig.hint))
+            {
+                sigs.push_back({key, &sig.signature, &hash});
+            }
+        }
+    }
+}
+
 LedgerTxnEntry
 loadData(AbstractLedgerTxn& ltx, AccountID const& accountID,
          std::string const& dataName)
@@ -11,6 +11,7 @@
 #include "xdr/Stellar-transaction.h"
 
 #include <algorithm>
+#include <functional>
 #include <optional>
 
 namespace stellar
@@ -33,6 +34,11 @@ struct LedgerHeader;
 struct LedgerKey;
 struct TransactionEnvelope;
 struct MuxedAccount;
+struct SignatureToVerify;
+
+// Returns the signers of an account, or none if the account does not exist
+using AccountSignersLoader =
+    std::function<xdr::xvector<Signer, MAX_SIGNERS>(AccountID const&)>;
 
 template <typename IterType>
 std::pair<IterType, bool>
@@ -107,6 +113,14 @@ LedgerTxnEntry loadAccount(AbstractLedgerTxn& ltx, AccountID const& accountID);
 ConstLedgerTxnEntry loadAccountWithoutRecord(AbstractLedgerTxn& ltx,
                                              AccountID const& accountID);
 
+// Adds each of signatures with each ed25519 key of accountID (its master key
+// and its ed25519 signers, as returned by loadSigners) whose hint it matches,
+// see TransactionFrameBase::insertSignaturesToVerify
+void insertAccountSignaturesToVerify(
+    AccountSignersLoader const& loadSigners, AccountID const& accountID,
+    xdr::xvector<DecoratedSignature, 20> const& signatures, Hash const& hash,
+    std::vector<SignatureToVerify>& sigs);
+
 LedgerTxnEntry loadData(AbstractLedgerTxn& ltx, AccountID const& accountID,
                         std::string const& dataName);
 
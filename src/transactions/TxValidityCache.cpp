@@ -0,0 +1,44 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "transactions/TxValidityCache.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+
+namespace stellar
+{
+
+TxValidityCache::TxValidityCache(medida::MetricsRegistry& metrics)
+    : mCache(CACHE_SIZE)
+    , mHit(metrics.NewMeter({"ledger", "transaction", "validity-cache-hit"},
+                            "transaction"))
+    , mMiss(metrics.NewMeter({"ledger", "transaction", "validity-cache-miss"},
+                             "transaction"))
+{
+}
+
+bool
+TxValidityCache::isKnownValid(Hash const& key)
+{
+    if (mCache.exists(key))
+    {
+        mHit.Mark();
+        return true;
+    }
+    mMiss.Mark();
+    return false;
+}
+
+void
+TxValidityCache::addValid(Hash const& key)
+{
+    mCache.put(key, true);
+}
+
+void
+TxValidityCache::clear()
+{
+    mCache.clear();
+}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/ConcurrentRandomEvictionCache.h"
+#include "util/HashOfHash.h"
+#include "util/NonCopyable.h"
+#include "xdr/Stellar-types.h"
+
+namespace medida
+{
+class MetricsRegistry;
+class Meter;
+}
+
+namespace stellar
+{
+
+// Remembers which transactions passed checkValid, so that a transaction
+// checked when it enters the queue, again when it is nominated and again when
+// the tx set it is in is validated, only goes through the full checks (and
+// their signature verification) once per ledger.
+//
+// Entries are keyed by a hash of the transaction together with everything in
+// the ledger checkValid reads, apart from the close time (see
+// TransactionFrame::checkValidWithOptionallyChargedFee), so an entry can't be
+// hit once anything it depended on changed, and needs no invalidation: entries
+// of past ledgers simply age out. Only successes are remembered.
+class TxValidityCache : public NonMovableOrCopyable
+{
+    ConcurrentRandomEvictionCache<Hash, bool, 4> mCache;
+    medida::Meter& mHit;
+    medida::Meter& mMiss;
+
+  public:
+    static constexpr size_t CACHE_SIZE = 32768;
+
+    explicit TxValidityCache(medida::MetricsRegistry& metrics);
+
+    bool isKnownValid(Hash const& key);
+    void addValid(Hash const& key);
+    void clear();
+};
+}
@@ -14,8 +14,10 @@
 #include "ledger/LedgerManager.h"
 #include "ledger/LedgerTxn.h"
 #include "ledger/LedgerTypeUtils.h"
+#include "ledger/SorobanMetrics.h"
 #include "ledger/test/LedgerTestUtils.h"
 #include "lib/catch.hpp"
+#include "lib/json/json.h"
 #include "main/Application.h"
 #include "main/CommandHandler.h"
 #include "main/SettingsUpgradeUtils.h"
@@ -652,6 +654,111 @@ TEST_CASE("basic contract invocation", "[tx][soroban]")
     }
 }
 
+TEST_CASE("module cache model counts repeated invocations", "[tx][soroban]")
+{
+    SorobanTest test;
+    TestContract& addContract =
+        test.deployWasmContract(rust_bridge::get_test_wasm_add_i32());
+    auto& hitMeter = test.getApp().getMetrics().NewMeter(
+        {"soroban", "host-fn-op", "module-cache-hit"}, "entry");
+    auto& missMeter = test.getApp().getMetrics().NewMeter(
+        {"soroban", "host-fn-op", "module-cache-miss"}, "entry");
+
+    // The code was uploaded while deploying, so no invocation misses it
+    auto hitsBefore = hitMeter.count();
+    auto missesBefore = missMeter.count();
+    auto spec =
+        SorobanInvocationSpec().setInstructions(2'000'000).setReadBytes(2000);
+    for (int i = 0; i < 2; ++i)
+    {
+        auto invocation = addContract.prepareInvocation(
+            "add", {makeI32(7), makeI32(16)}, spec);
+        REQUIRE(invocation.invoke());
+    }
+    REQUIRE(hitMeter.count() == hitsBefore + 2);
+    REQUIRE(missMeter.count() == missesBefore);
+}
+
+TEST_CASE("contract profiles track invocations", "[tx][soroban]")
+{
+    SorobanTest test;
+    TestContract& addContract =
+        test.deployWasmContract(rust_bridge::get_test_wasm_add_i32());
+    auto spec =
+        SorobanInvocationSpec().setInstructions(2'000'000).setReadBytes(2000);
+    for (int i = 0; i < 2; ++i)
+    {
+        auto invocation = addContract.prepareInvocation(
+            "add", {makeI32(7), makeI32(16)}, spec);
+        REQUIRE(invocation.invoke());
+    }
+
+    auto profiles = test.getApp()
+                        .getLedgerManager()
+                        .getSorobanMetrics()
+                        .getContractProfilesJson(10);
+    REQUIRE(profiles["contracts"].size() == 1);
+    auto const& contract = profiles["contracts"][0];
+    REQUIRE(contract["invocations"].asUInt64() == 2);
+    REQUIRE(contract["cpu_insn"].asUInt64() > 0);
+    REQUIRE(contract["cpu_insn_max_overestimate"].asUInt64() == 0);
+    REQUIRE(contract["read_entry"].asUInt64() > 0);
+    REQUIRE(profiles["functions"].size() == 1);
+    REQUIRE(profiles["functions"][0]["function"].asString() ==
+            contract["contract"].asString() + ":add");
+
+    SECTION("profiles are bounded")
+    {
+        SorobanMetrics metrics(test.getApp().getMetrics());
+        SorobanMetrics::ContractProfile usage;
+        usage.mInvocations = 1;
+        for (uint64_t i = 1; i <= 100; ++i)
+        {
+            usage.mCpuInsn = i * 10;
+            metrics.noteContractInvocation(std::to_string(i), "f", usage);
+        }
+        // Evicts the contract with 10 instructions
+        usage.mCpuInsn = 5;
+        metrics.noteContractInvocation("new", "f", usage);
+
+        auto bounded = metrics.getContractProfilesJson(1000);
+        REQUIRE(bounded["contracts"].size() == 100);
+        REQUIRE(bounded["contracts"][0]["contract"].asString() == "100");
+        auto const& last = bounded["contracts"][99];
+        REQUIRE(last["contract"].asString() == "new");
+        REQUIRE(last["cpu_insn"].asUInt64() == 15);
+        REQUIRE(last["cpu_insn_max_overestimate"].asUInt64() == 10);
+        REQUIRE(metrics.getContractProfilesJson(3)["functions"].size() == 3);
+    }
+}
+
+TEST_CASE("Soroban footprint and TTL keys are prefetched", "[tx][soroban]")
+{
+    SorobanTest test;
+    TestContract& addContract =
+        test.deployWasmContract(rust_bridge::get_test_wasm_add_i32());
+    auto invocation = addContract.prepareInvocation(
+        "add", {makeI32(7), makeI32(16)},
+        SorobanInvocationSpec().setInstructions(2'000'000).setReadBytes(2000));
+    auto tx = invocation.createTx();
+
+    UnorderedSet<LedgerKey> keys;
+    tx->insertKeysForTxApply(keys);
+    auto const& footprint = tx->sorobanResources().footprint;
+    REQUIRE(!footprint.readOnly.empty());
+    for (auto const* fpKeys : {&footprint.readOnly, &footprint.readWrite})
+    {
+        for (auto const& key : *fpKeys)
+        {
+            REQUIRE(keys.count(key) == 1);
+            if (isSorobanEntry(key))
+            {
+                REQUIRE(keys.count(getTTLKey(key)) == 1);
+            }
+        }
+    }
+}
+
 TEST_CASE("version test", "[tx][soroban]")
 {
     // This test is only valid from SOROBAN_PROTOCOL_VERSION + 1, and
@@ -0,0 +1,107 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "ledger/LedgerManager.h"
+#include "ledger/LedgerTxn.h"
+#include "lib/catch.hpp"
+#include "main/Application.h"
+#include "test/TestAccount.h"
+#include "test/TestUtils.h"
+#include "test/TxTests.h"
+#include "test/test.h"
+#include "transactions/TransactionBridge.h"
+#include "transactions/TransactionFrame.h"
+#include "transactions/TxValidityCache.h"
+
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+
+using namespace stellar;
+using namespace stellar::txbridge;
+using namespace stellar::txtest;
+
+TEST_CASE("transaction validity cache", "[tx][validitycache]")
+{
+    VirtualClock clock;
+    auto app = createTestApplication(clock, getTestConfig());
+    auto& lm = app->getLedgerManager();
+
+    auto root = TestAccount::createRoot(*app);
+    auto a1 = root.create("A1", lm.getLastMinBalance(0) + 10000);
+
+    auto& hits = app->getMetrics().NewMeter(
+        {"ledger", "transaction", "validity-cache-hit"}, "transaction");
+    auto& misses = app->getMetrics().NewMeter(
+        {"ledger", "transaction", "validity-cache-miss"}, "transaction");
+
+    auto closeTime = lm.getLastClosedLedgerHeader().header.scpValue.closeTime;
+    auto tx = a1.tx({payment(root, 100)});
+    setMaxTime(tx, closeTime + 100);
+    getSignatures(tx).clear();
+    tx->addSignature(a1);
+
+    auto check = [&](SequenceNumber current, uint64_t upperBoundOffset) {
+        LedgerTxn ltx(app->getLedgerTxnRoot());
+        return tx->checkValid(*app, ltx, current, 0, upperBoundOffset);
+    };
+
+    REQUIRE(check(0, 0));
+    auto hitCount = hits.count();
+    auto missCount = misses.count();
+
+    SECTION("same state hits")
+    {
+        REQUIRE(check(0, 0));
+        REQUIRE(hits.count() == hitCount + 1);
+
+        // Tx set validation passes the sequence number the tx follows
+        auto seq = a1.loadSequenceNumber();
+        REQUIRE(check(seq, 0));
+        REQUIRE(hits.count() == hitCount + 2);
+        REQUIRE(misses.count() == missCount);
+    }
+
+    SECTION("close time bounds are checked on hits")
+    {
+        REQUIRE(!check(0, 1000));
+        REQUIRE(tx->getResultCode() == txTOO_LATE);
+        REQUIRE(hits.count() == hitCount + 1);
+        REQUIRE(check(0, 0));
+    }
+
+    SECTION("different sequence number misses")
+    {
+        auto seq = a1.loadSequenceNumber();
+        REQUIRE(!check(seq + 1, 0));
+        REQUIRE(tx->getResultCode() == txBAD_SEQ);
+        REQUIRE(misses.count() == missCount + 1);
+    }
+
+    SECTION("source account change misses")
+    {
+        root.pay(a1, 1000);
+        REQUIRE(check(0, 0));
+        REQUIRE(misses.count() == missCount + 1);
+
+        a1.pay(root, 1000);
+        REQUIRE(!check(0, 0));
+        REQUIRE(tx->getResultCode() == txBAD_SEQ);
+    }
+
+    SECTION("new ledger misses")
+    {
+        closeLedger(*app);
+        REQUIRE(check(0, 0));
+        REQUIRE(misses.count() == missCount + 1);
+    }
+
+    SECTION("failures are not cached")
+    {
+        getSignatures(tx).clear();
+        REQUIRE(!check(0, 0));
+        REQUIRE(tx->getResultCode() == txBAD_AUTH);
+        REQUIRE(!check(0, 0));
+        REQUIRE(hits.count() == hitCount);
+    }
+}
@@ -0,0 +1,194 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/BlockedBloomFilter.h"
+#include "util/Fs.h"
+#include "util/GlobalChecks.h"
+#include "util/siphash.h"
+
+#include <Tracy.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fmt/format.h>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+namespace stellar
+{
+
+namespace
+{
+// splitmix64 finalizer, used to derive in-block bit positions from the key
+// hash independently of the block selection bits
+uint64_t
+mix64(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+// Advances state with a 64 bit LCG step and returns its top 9 bits as a bit
+// position within a block. The top bits of an LCG are well distributed, unlike
+// double hashing modulo a power of two, which clusters bit positions and
+// roughly doubles the false positive rate.
+uint32_t
+nextBit(uint64_t& state)
+{
+    state = state * 0x9e3779b97f4a7c15ULL + 1;
+    return static_cast<uint32_t>(state >> 55);
+}
+
+// Tables start at a multiple of the block size in their file, so that mapped
+// blocks are cache line aligned like heap ones
+std::streamoff
+alignTableStart(std::streamoff pos)
+{
+    std::streamoff const align = 64;
+    return (pos + align - 1) / align * align;
+}
+}
+
+BlockedBloomFilter::BlockedBloomFilter(uint64_t expectedElements,
+                                       double falsePositiveProbability,
+                                       Seed const& seed)
+    : mSeed(seed)
+{
+    releaseAssert(falsePositiveProbability > 0 &&
+                  falsePositiveProbability < 1);
+    double const ln2 = std::log(2.0);
+    double const bitsPerKey =
+        -std::log(falsePositiveProbability) / (ln2 * ln2);
+
+    // Blocking concentrates keys unevenly across blocks, so the optimal hash
+    // count is lower than the classic k = bitsPerKey * ln2
+    mNumHashes = std::clamp<uint32_t>(
+        static_cast<uint32_t>(std::lround(bitsPerKey * ln2 * 0.9)), 1, 16);
+
+    uint64_t const totalBits = static_cast<uint64_t>(
+        std::ceil(std::max<uint64_t>(expectedElements, 1) * bitsPerKey));
+    uint64_t const numBlocks = (totalBits + BITS_PER_BLOCK - 1) / BITS_PER_BLOCK;
+    releaseAssert(numBlocks <= std::numeric_limits<uint32_t>::max());
+    mWords.resize(numBlocks * WORDS_PER_BLOCK, 0);
+    mNumWords = mWords.size();
+}
+
+void
+BlockedBloomFilter::writeTable(std::ostream& out) const
+{
+    ZoneScoped;
+    auto pos = static_cast<std::streamoff>(out.tellp());
+    static char const zeros[64] = {};
+    out.write(zeros, alignTableStart(pos) - pos);
+    // Index files are only read by the node that wrote them, so the table is
+    // written in native byte order
+    out.write(reinterpret_cast<char const*>(words()),
+              static_cast<std::streamsize>(size()));
+}
+
+void
+BlockedBloomFilter::attachTable(std::string const& path,
+                                std::streamoff tableStart)
+{
+    ZoneScoped;
+    releaseAssert(mWords.empty() && !mMapping);
+    auto start = alignTableStart(tableStart);
+    auto tooShort = [&]() {
+        return std::runtime_error(fmt::format(
+            FMT_STRING("bloom filter table missing from {}"), path));
+    };
+
+#ifdef _WIN32
+    std::ifstream in(path, std::ios::binary);
+    in.seekg(start);
+    mWords.resize(mNumWords);
+    in.read(reinterpret_cast<char*>(mWords.data()),
+            static_cast<std::streamsize>(size()));
+    if (!in)
+    {
+        mWords.clear();
+        throw tooShort();
+    }
+#else
+    auto mapping = std::make_shared<fs::ReadOnlyMappedFile const>(path);
+    if (mapping->size() < static_cast<size_t>(start) + size())
+    {
+        throw tooShort();
+    }
+    mMappedWords = reinterpret_cast<uint64_t const*>(mapping->data() + start);
+    mMapping = std::move(mapping);
+#endif
+}
+
+bool
+BlockedBloomFilter::operator==(BlockedBloomFilter const& other) const
+{
+    return mNumHashes == other.mNumHashes && mSeed == other.mSeed &&
+           mNumWords == other.mNumWords &&
+           (mNumWords == 0 ||
+            std::memcmp(words(), other.words(), size()) == 0);
+}
+
+uint64_t
+BlockedBloomFilter::hashKey(unsigned char const* key, size_t length) const
+{
+    SipHash24 sh(mSeed.data());
+    sh.update(key, length);
+    return sh.digest();
+}
+
+size_t
+BlockedBloomFilter::getBlock(uint64_t hash) const
+{
+    // Map the upper 32 bits of the hash onto [0, numBlocks) without a modulo
+    uint64_t const numBlocks = mNumWords / WORDS_PER_BLOCK;
+    return static_cast<size_t>(((hash >> 32) * numBlocks) >> 32) *
+           WORDS_PER_BLOCK;
+}
+
+void
+BlockedBloomFilter::insert(unsigned char const* key, size_t length)
+{
+    releaseAssert(!mWords.empty());
+    auto const hash = hashKey(key, length);
+    auto* block = mWords.data() + getBlock(hash);
+
+    auto bitHash = mix64(hash);
+    for (uint32_t i = 0; i < mNumHashes; ++i)
+    {
+        auto const bit = nextBit(bitHash);
+        block[bit / 64] |= uint64_t(1) << (bit % 64);
+    }
+}
+
+bool
+BlockedBloomFilter::contains(unsigned char const* key, size_t length) const
+{
+    ZoneScoped;
+    if (mNumWords == 0)
+    {
+        return false;
+    }
+
+    auto const hash = hashKey(key, length);
+    auto const* block = words() + getBlock(hash);
+
+    auto bitHash = mix64(hash);
+    for (uint32_t i = 0; i < mNumHashes; ++i)
+    {
+        auto const bit = nextBit(bitHash);
+        if (!(block[bit / 64] & (uint64_t(1) << (bit % 64))))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+}
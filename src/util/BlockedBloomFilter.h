@@ -0,0 +1,128 @@
+#pragma once
+
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <cereal/archives/binary.hpp>
+#include <cereal/types/array.hpp>
+#include <sodium.h>
+
+namespace stellar
+{
+
+namespace fs
+{
+class ReadOnlyMappedFile;
+}
+
+// Cache-line blocked bloom filter. Each key hashes to a single 512 bit block
+// and all of its bits are set and tested within that block, so a lookup costs
+// one hash computation and touches one cache line regardless of the number of
+// hash functions. The tradeoff is a somewhat higher false positive rate than a
+// classic bloom filter of the same size: when sized with the same number of
+// bits as a classic filter targeting rate p, the blocked filter achieves
+// roughly 2p.
+class BlockedBloomFilter
+{
+  public:
+    using Seed = std::array<unsigned char, crypto_shorthash_KEYBYTES>;
+
+  private:
+    static constexpr size_t WORDS_PER_BLOCK = 8;
+    static constexpr uint32_t BITS_PER_BLOCK = WORDS_PER_BLOCK * 64;
+
+    // The table is either owned in mWords or, once attached by mapTable,
+    // used in place from a mapping of the file it was written to
+    std::vector<uint64_t> mWords;
+    std::shared_ptr<fs::ReadOnlyMappedFile const> mMapping;
+    uint64_t const* mMappedWords{nullptr};
+    size_t mNumWords{0};
+    uint32_t mNumHashes{0};
+    Seed mSeed{};
+
+    uint64_t const*
+    words() const
+    {
+        return mMapping ? mMappedWords : mWords.data();
+    }
+
+    // Returns index of first word of the block for the given key hash
+    size_t getBlock(uint64_t hash) const;
+
+    uint64_t hashKey(unsigned char const* key, size_t length) const;
+
+  public:
+    BlockedBloomFilter() = default;
+
+    // Sizes the filter for expectedElements keys using the same number of bits
+    // a classic bloom filter would need for falsePositiveProbability.
+    BlockedBloomFilter(uint64_t expectedElements,
+                       double falsePositiveProbability, Seed const& seed);
+
+    void insert(unsigned char const* key, size_t length);
+    bool contains(unsigned char const* key, size_t length) const;
+
+    // Size of the filter table, in bytes
+    size_t
+    size() const
+    {
+        return mNumWords * sizeof(uint64_t);
+    }
+
+    // Whether the table is used in place from a mapped file rather than held
+    // on the heap
+    bool
+    isMapped() const
+    {
+        return static_cast<bool>(mMapping);
+    }
+
+    // Writes the table to out after the serialized fields, padded so that it
+    // starts at a multiple of its block size in the file
+    void writeTable(std::ostream& out) const;
+
+    // Attaches the table that writeTable wrote to the file at path, whose
+    // serialized fields end at offset tableStart, to a filter that was just
+    // loaded. The table is mapped and used in place, without being read,
+    // except on Windows where a mapped file can't be replaced or deleted, and
+    // it is read instead. Throws if the file is too short.
+    void attachTable(std::string const& path, std::streamoff tableStart);
+
+    bool operator==(BlockedBloomFilter const& other) const;
+
+    bool
+    operator!=(BlockedBloomFilter const& other) const
+    {
+        return !(*this == other);
+    }
+
+    // The table itself is not serialized, see writeTable and attachTable
+    template <class Archive>
+    void
+    save(Archive& ar) const
+    {
+        ar(static_cast<uint64_t>(mNumWords), mNumHashes, mSeed);
+    }
+
+    template <class Archive>
+    void
+    load(Archive& ar)
+    {
+        uint64_t numWords;
+        ar(numWords, mNumHashes, mSeed);
+        mNumWords = static_cast<size_t>(numWords);
+        mWords.clear();
+        mMapping.reset();
+        mMappedWords = nullptr;
+    }
+};
+}
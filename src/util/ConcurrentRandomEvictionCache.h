@@ -0,0 +1,262 @@
+#pragma once
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/ContentionProfiler.h"
+#include "util/GlobalChecks.h"
+#include "util/NonCopyable.h"
+#include "util/RandomEvictionCache.h"
+
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+
+namespace stellar
+{
+
+// A RandomEvictionCache that can be used from any thread. Keys are split
+// across Shards independent caches by hash, each behind its own lock, so that
+// threads only contend when they hit the same shard; each shard holds (about)
+// 1/Shards of the entries and evicts among its own.
+//
+// Values are returned by copy, since nothing can refer into a shard once its
+// lock is released. Callers that need to do several things under one lock,
+// or with one lock per shard for a batch of keys, can use `withShard`.
+template <typename K, typename V, size_t Shards = 16,
+          typename Hash = std::hash<K>>
+class ConcurrentRandomEvictionCache : public NonMovableOrCopyable
+{
+    static_assert(Shards > 0, "need at least one shard");
+
+  public:
+    using Cache = RandomEvictionCache<K, V, Hash>;
+    using Counters = typename Cache::Counters;
+
+  private:
+    struct Shard
+    {
+        mutable ProfiledMutex mMutex{"ConcurrentRandomEvictionCache"};
+        std::unique_ptr<Cache> mCache;
+    };
+    std::array<Shard, Shards> mShards;
+    bool const mSeparatePRNG;
+    // Kept to seed shards that are replaced by `setMaxSize`
+    std::optional<unsigned int> mSeed;
+    std::mutex mSeedMutex;
+
+    static size_t
+    shardMaxSize(size_t maxSize)
+    {
+        return std::max<size_t>(1, (maxSize + Shards - 1) / Shards);
+    }
+
+    template <typename F>
+    auto
+    locked(K const& k, F&& f)
+    {
+        auto& shard = mShards[shardIndex(k)];
+        std::lock_guard<ProfiledMutex> guard(shard.mMutex);
+        return f(*shard.mCache);
+    }
+
+  public:
+    explicit ConcurrentRandomEvictionCache(size_t maxSize,
+                                           bool separatePRNG = false)
+        : mSeparatePRNG(separatePRNG)
+    {
+        for (auto& shard : mShards)
+        {
+            shard.mCache =
+                std::make_unique<Cache>(shardMaxSize(maxSize), separatePRNG);
+        }
+    }
+
+    // The shard k belongs to. The hash is mixed so that its low bits, which
+    // pick the shard, don't also pick the bucket within it.
+    static size_t
+    shardIndex(K const& k)
+    {
+        uint64_t h = static_cast<uint64_t>(Hash{}(k));
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return static_cast<size_t>(h % Shards);
+    }
+
+    // Calls f with the cache of shard i, under its lock
+    template <typename F>
+    auto
+    withShard(size_t i, F&& f)
+    {
+        releaseAssert(i < Shards);
+        auto& shard = mShards[i];
+        std::lock_guard<ProfiledMutex> guard(shard.mMutex);
+        return f(*shard.mCache);
+    }
+
+    // Seeds shard i with seed + i
+    void
+    maybeSeed(unsigned int seed)
+    {
+        std::lock_guard<std::mutex> seedGuard(mSeedMutex);
+        mSeed = seed;
+        for (size_t i = 0; i < Shards; ++i)
+        {
+            std::lock_guard<ProfiledMutex> guard(mShards[i].mMutex);
+            mShards[i].mCache->maybeSeed(seed + static_cast<unsigned int>(i));
+        }
+    }
+
+    // Resizes the cache, dropping its contents if that changes the size of
+    // its shards
+    void
+    setMaxSize(size_t maxSize)
+    {
+        std::lock_guard<std::mutex> seedGuard(mSeedMutex);
+        auto perShard = shardMaxSize(maxSize);
+        for (size_t i = 0; i < Shards; ++i)
+        {
+            auto& shard = mShards[i];
+            std::lock_guard<ProfiledMutex> guard(shard.mMutex);
+            if (shard.mCache->maxSize() == perShard)
+            {
+                continue;
+            }
+            shard.mCache = std::make_unique<Cache>(perShard, mSeparatePRNG);
+            if (mSeed)
+            {
+                shard.mCache->maybeSeed(*mSeed + static_cast<unsigned int>(i));
+            }
+        }
+    }
+
+    size_t
+    maxSize() const
+    {
+        size_t res = 0;
+        for (auto const& shard : mShards)
+        {
+            std::lock_guard<ProfiledMutex> guard(shard.mMutex);
+            res += shard.mCache->maxSize();
+        }
+        return res;
+    }
+
+    // Shards are counted one at a time, so this is only a snapshot if nothing
+    // else is using the cache
+    size_t
+    size() const
+    {
+        size_t res = 0;
+        for (auto const& shard : mShards)
+        {
+            std::lock_guard<ProfiledMutex> guard(shard.mMutex);
+            res += shard.mCache->size();
+        }
+        return res;
+    }
+
+    // Sum of the counters of all shards, with the same caveat as `size`
+    Counters
+    getCounters() const
+    {
+        Counters res;
+        for (auto const& shard : mShards)
+        {
+            std::lock_guard<ProfiledMutex> guard(shard.mMutex);
+            auto const& c = shard.mCache->getCounters();
+            res.mHits += c.mHits;
+            res.mMisses += c.mMisses;
+            res.mInserts += c.mInserts;
+            res.mUpdates += c.mUpdates;
+            res.mEvicts += c.mEvicts;
+            res.mRejects += c.mRejects;
+        }
+        return res;
+    }
+
+    void
+    put(K const& k, V const& v)
+    {
+        locked(k, [&](Cache& c) { c.put(k, v); });
+    }
+
+    // As RandomEvictionCache::putIfAdmitted; admit is called under the lock
+    // of k's shard, with the key that would be evicted from it
+    template <typename Admit>
+    bool
+    putIfAdmitted(K const& k, V const& v, Admit&& admit)
+    {
+        return locked(k, [&](Cache& c) {
+            return c.putIfAdmitted(k, v, std::forward<Admit>(admit));
+        });
+    }
+
+    bool
+    exists(K const& k, bool countMisses = true)
+    {
+        return locked(k, [&](Cache& c) { return c.exists(k, countMisses); });
+    }
+
+    void
+    clear()
+    {
+        for (auto& shard : mShards)
+        {
+            std::lock_guard<ProfiledMutex> guard(shard.mMutex);
+            shard.mCache->clear();
+        }
+    }
+
+    void
+    erase_if(std::function<bool(V const&)> const& f)
+    {
+        for (auto& shard : mShards)
+        {
+            std::lock_guard<ProfiledMutex> guard(shard.mMutex);
+            shard.mCache->erase_if(f);
+        }
+    }
+
+    // Calls `f` on every value, one shard at a time, under its lock
+    void
+    for_each(std::function<void(V const&)> const& f) const
+    {
+        for (auto const& shard : mShards)
+        {
+            std::lock_guard<ProfiledMutex> guard(shard.mMutex);
+            shard.mCache->for_each(f);
+        }
+    }
+
+    // Returns a copy of the value if the key exists
+    std::optional<V>
+    maybeGet(K const& k)
+    {
+        return locked(k, [&](Cache& c) -> std::optional<V> {
+            auto v = c.maybeGet(k);
+            if (v)
+            {
+                return *v;
+            }
+            return std::nullopt;
+        });
+    }
+
+    V
+    get(K const& k)
+    {
+        auto res = maybeGet(k);
+        if (!res)
+        {
+            throw std::range_error("There is no such key in cache");
+        }
+        return *res;
+    }
+};
+}
@@ -0,0 +1,200 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/ContentionProfiler.h"
+#include "lib/json/json.h"
+#include "util/GlobalChecks.h"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace stellar
+{
+
+std::atomic<bool> ContentionProfiler::gEnabled{false};
+
+namespace
+{
+struct Registry
+{
+    std::mutex mMutex;
+    std::map<std::string, std::unique_ptr<ContentionProfiler::Site>> mSites;
+};
+
+// Created on first use, so that mutexes with static storage, like the log
+// mutex, can register during static initialization, and never destroyed, so
+// that they can still be locked during static destruction
+Registry&
+getRegistry()
+{
+    static Registry* registry = new Registry();
+    return *registry;
+}
+
+size_t
+bucketOf(std::chrono::nanoseconds wait)
+{
+    auto us = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(wait).count());
+    size_t b = 0;
+    while (us != 0 && b + 1 < ContentionProfiler::NUM_BUCKETS)
+    {
+        us >>= 1;
+        ++b;
+    }
+    return b;
+}
+
+Json::Value
+statsToJson(ContentionProfiler::Stats const& s)
+{
+    Json::Value res;
+    res["count"] = static_cast<Json::UInt64>(s.mCount.load());
+    res["waits"] = static_cast<Json::UInt64>(s.mWaits.load());
+    res["wait_ms"] = static_cast<double>(s.mWaitNs.load()) / 1e6;
+    res["max_wait_ms"] = static_cast<double>(s.mMaxWaitNs.load()) / 1e6;
+    // Keyed by the upper bound of each bucket, in microseconds
+    auto& hist = res["histogram_us"];
+    hist = Json::Value(Json::objectValue);
+    for (size_t i = 0; i < ContentionProfiler::NUM_BUCKETS; ++i)
+    {
+        auto n = s.mBuckets[i].load();
+        if (n != 0)
+        {
+            auto bound = i + 1 == ContentionProfiler::NUM_BUCKETS
+                             ? std::string("inf")
+                             : std::to_string(uint64_t(1) << i);
+            hist[bound] = static_cast<Json::UInt64>(n);
+        }
+    }
+    return res;
+}
+
+void
+resetStats(ContentionProfiler::Stats& s)
+{
+    s.mCount = 0;
+    s.mWaits = 0;
+    s.mWaitNs = 0;
+    s.mMaxWaitNs = 0;
+    for (auto& b : s.mBuckets)
+    {
+        b = 0;
+    }
+}
+}
+
+ContentionProfiler::Site&
+ContentionProfiler::getSite(char const* name, char const* kind)
+{
+    auto& registry = getRegistry();
+    std::lock_guard<std::mutex> guard(registry.mMutex);
+    auto& site = registry.mSites[name];
+    if (!site)
+    {
+        site = std::make_unique<Site>(name, kind);
+    }
+    return *site;
+}
+
+void
+ContentionProfiler::setEnabled(bool enabled)
+{
+    gEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+void
+ContentionProfiler::record(Site& site, std::chrono::nanoseconds wait)
+{
+    auto& s = threadIsMain() ? site.mMain : site.mOther;
+    s.mCount.fetch_add(1, std::memory_order_relaxed);
+    if (wait.count() <= 0)
+    {
+        return;
+    }
+    auto ns = static_cast<uint64_t>(wait.count());
+    s.mWaits.fetch_add(1, std::memory_order_relaxed);
+    s.mWaitNs.fetch_add(ns, std::memory_order_relaxed);
+    s.mBuckets[bucketOf(wait)].fetch_add(1, std::memory_order_relaxed);
+    auto max = s.mMaxWaitNs.load(std::memory_order_relaxed);
+    while (ns > max && !s.mMaxWaitNs.compare_exchange_weak(
+                           max, ns, std::memory_order_relaxed))
+    {
+    }
+}
+
+Json::Value
+ContentionProfiler::report()
+{
+    auto& registry = getRegistry();
+    std::vector<Site const*> sites;
+    {
+        std::lock_guard<std::mutex> guard(registry.mMutex);
+        for (auto const& kv : registry.mSites)
+        {
+            sites.emplace_back(kv.second.get());
+        }
+    }
+    std::stable_sort(sites.begin(), sites.end(),
+                     [](Site const* a, Site const* b) {
+                         return a->mMain.mWaitNs.load() >
+                                b->mMain.mWaitNs.load();
+                     });
+
+    Json::Value res;
+    res["enabled"] = enabled();
+    auto& sitesJson = res["sites"];
+    sitesJson = Json::Value(Json::arrayValue);
+    for (auto const* site : sites)
+    {
+        if (site->mMain.mCount.load() == 0 && site->mOther.mCount.load() == 0)
+        {
+            continue;
+        }
+        Json::Value s;
+        s["name"] = site->mName;
+        s["kind"] = site->mKind;
+        s["main"] = statsToJson(site->mMain);
+        s["other"] = statsToJson(site->mOther);
+        sitesJson.append(s);
+    }
+    return res;
+}
+
+void
+ContentionProfiler::reset()
+{
+    auto& registry = getRegistry();
+    std::lock_guard<std::mutex> guard(registry.mMutex);
+    for (auto& kv : registry.mSites)
+    {
+        resetStats(kv.second->mMain);
+        resetStats(kv.second->mOther);
+    }
+}
+
+BlockingIOScope::BlockingIOScope(char const* site)
+{
+    if (ContentionProfiler::enabled())
+    {
+        mSite = &ContentionProfiler::getSite(site, "io");
+        mStart = std::chrono::steady_clock::now();
+    }
+}
+
+BlockingIOScope::~BlockingIOScope()
+{
+    if (mSite)
+    {
+        // Any I/O blocks, so its whole duration counts as a wait
+        auto wait = std::chrono::steady_clock::now() - mStart;
+        ContentionProfiler::record(*mSite,
+                                   std::max<std::chrono::nanoseconds>(
+                                       wait, std::chrono::nanoseconds(1)));
+    }
+}
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/NonCopyable.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+namespace Json
+{
+class Value;
+}
+
+namespace stellar
+{
+
+// Process-wide record of the time threads spend blocked: waiting for a
+// ProfiledMutex held by another thread, or in a BlockingIOScope. Waits are
+// accumulated per site (a mutex or I/O call site, by name) into a histogram,
+// separately for the main thread and for other threads, so that what blocks
+// the main thread shows up in production, where off-CPU profiles can't say
+// which lock or file operation it was.
+//
+// Profiling is off until enabled, by CONTENTION_PROFILING or the
+// `contention` HTTP command. When off, a ProfiledMutex costs one relaxed
+// atomic load per lock.
+class ContentionProfiler
+{
+  public:
+    // Waits under 1us, 2us, 4us, ... 2^(NUM_BUCKETS - 2)us, and longer
+    static size_t const NUM_BUCKETS = 24;
+
+    struct Stats
+    {
+        // Lock acquisitions or I/O operations, waits meaning acquisitions that
+        // found the mutex held
+        std::atomic<uint64_t> mCount{0};
+        std::atomic<uint64_t> mWaits{0};
+        std::atomic<uint64_t> mWaitNs{0};
+        std::atomic<uint64_t> mMaxWaitNs{0};
+        std::array<std::atomic<uint64_t>, NUM_BUCKETS> mBuckets{};
+    };
+
+    struct Site : public NonMovableOrCopyable
+    {
+        char const* const mName;
+        char const* const mKind;
+        Stats mMain;
+        Stats mOther;
+
+        Site(char const* name, char const* kind) : mName(name), mKind(kind)
+        {
+        }
+    };
+
+    // Returns the site named name, registering it on first use. Sites are
+    // never freed, the returned reference stays valid for the whole process.
+    static Site& getSite(char const* name, char const* kind);
+
+    static bool
+    enabled()
+    {
+        return gEnabled.load(std::memory_order_relaxed);
+    }
+    static void setEnabled(bool enabled);
+
+    // Records an acquisition or operation at site that blocked for `wait`,
+    // which is 0 if it did not block
+    static void record(Site& site, std::chrono::nanoseconds wait);
+
+    // Per site, the stats of the main and of other threads, sites with the
+    // longest total main thread wait first
+    static Json::Value report();
+    static void reset();
+
+  private:
+    static std::atomic<bool> gEnabled;
+};
+
+// Drop-in replacement for std::mutex or std::recursive_mutex that records
+// contention into the ContentionProfiler under its site name. Instances with
+// the same name share a site, so name them by class and member.
+template <class MutexT> class BasicProfiledMutex : public NonMovableOrCopyable
+{
+    MutexT mMutex;
+    ContentionProfiler::Site& mSite;
+
+  public:
+    explicit BasicProfiledMutex(char const* site)
+        : mSite(ContentionProfiler::getSite(site, "mutex"))
+    {
+    }
+
+    void
+    lock()
+    {
+        if (!ContentionProfiler::enabled())
+        {
+            mMutex.lock();
+            return;
+        }
+        if (mMutex.try_lock())
+        {
+            ContentionProfiler::record(mSite, std::chrono::nanoseconds(0));
+            return;
+        }
+        auto start = std::chrono::steady_clock::now();
+        mMutex.lock();
+        ContentionProfiler::record(mSite,
+                                   std::chrono::steady_clock::now() - start);
+    }
+
+    bool
+    try_lock()
+    {
+        return mMutex.try_lock();
+    }
+
+    void
+    unlock()
+    {
+        mMutex.unlock();
+    }
+};
+
+using ProfiledMutex = BasicProfiledMutex<std::mutex>;
+using ProfiledRecursiveMutex = BasicProfiledMutex<std::recursive_mutex>;
+
+// Records the time the enclosing blocking I/O takes, if profiling is enabled
+class BlockingIOScope : public NonMovableOrCopyable
+{
+    ContentionProfiler::Site* mSite{nullptr};
+    std::chrono::steady_clock::time_point mStart;
+
+  public:
+    // site must be a string literal
+    explicit BlockingIOScope(char const* site);
+    ~BlockingIOScope();
+};
+}
@@ -7,6 +7,9 @@
 #include "crypto/Random.h"
 #include "util/Fs.h"
 #include <fmt/format.h>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
 
 namespace stellar
 {
@@ -68,5 +71,74 @@ getDebugMetaRegexForLedger(uint32_t ledgerSeq)
     return std::regex{regexStr};
 }
 
+std::filesystem::path
+getMetaDebugIndexPath(std::filesystem::path const& segmentPath)
+{
+    auto path = segmentPath;
+    if (path.extension() == ".gz")
+    {
+        path.replace_extension();
+    }
+    path += META_DEBUG_INDEX_EXTENSION;
+    return path;
+}
+
+void
+writeMetaDebugIndex(std::filesystem::path const& path,
+                    MetaDebugIndex const& index)
+{
+    auto tmp = path;
+    tmp += ".tmp";
+    {
+        std::ofstream out(tmp);
+        for (auto const& [ledgerSeq, offset] : index)
+        {
+            out << ledgerSeq << ' ' << offset << '\n';
+        }
+        out.close();
+        if (!out)
+        {
+            throw std::runtime_error(fmt::format(
+                "failed to write meta-debug index {}", tmp.string()));
+        }
+    }
+    std::filesystem::rename(tmp, path);
+}
+
+std::optional<MetaDebugIndex>
+readMetaDebugIndex(std::filesystem::path const& path)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        return std::nullopt;
+    }
+    MetaDebugIndex index;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        std::istringstream entry(line);
+        uint32_t ledgerSeq;
+        uint64_t offset;
+        if (!(entry >> ledgerSeq >> offset) || !(entry >> std::ws).eof())
+        {
+            return std::nullopt;
+        }
+        // Ledgers and offsets both have to be increasing, anything else means
+        // the index does not describe the segment
+        if (!index.empty() && (ledgerSeq <= index.back().first ||
+                               offset <= index.back().second))
+        {
+            return std::nullopt;
+        }
+        index.emplace_back(ledgerSeq, offset);
+    }
+    if (index.empty())
+    {
+        return std::nullopt;
+    }
+    return index;
+}
+
 }
 }
\ No newline at end of file
@@ -4,8 +4,12 @@
 
 #pragma once
 
+#include <cstdint>
 #include <filesystem>
+#include <optional>
 #include <regex>
+#include <utility>
+#include <vector>
 
 namespace stellar
 {
@@ -20,6 +24,7 @@ const std::regex META_DEBUG_FILE_REGEX{
     "meta-debug-[[:xdigit:]]+-[[:xdigit:]]+\\.xdr(\\.gz)?"};
 const std::regex META_DEBUG_ZIP_FILE_REGEX{
     "meta-debug-[[:xdigit:]]+-[[:xdigit:]]+\\.xdr\\.gz?"};
+const std::string META_DEBUG_INDEX_EXTENSION{".idx"};
 
 // This number can be changed in the future without any coordination,
 // it just controls the granularity of new meta-debug XDR segments.
@@ -45,5 +50,23 @@ bool isDebugSegmentBoundary(uint32_t ledgerSeq);
 size_t getNumberOfDebugFilesToKeep(uint32_t ledgersToKeep);
 
 std::regex getDebugMetaRegexForLedger(uint32_t ledgerSeq);
+
+// Sequence number of every ledger in a meta-debug segment, in order, with the
+// offset of its meta in the uncompressed segment
+using MetaDebugIndex = std::vector<std::pair<uint32_t, uint64_t>>;
+
+// Index of a segment, written next to it when the segment is rotated. The
+// same index file is used for the segment before and after it is gzipped.
+std::filesystem::path
+getMetaDebugIndexPath(std::filesystem::path const& segmentPath);
+
+// Writes index to path, atomically replacing any existing file
+void writeMetaDebugIndex(std::filesystem::path const& path,
+                         MetaDebugIndex const& index);
+
+// Returns nullopt if there is no readable, well-formed index at path, in
+// which case the segment has to be read from the start
+std::optional<MetaDebugIndex>
+readMetaDebugIndex(std::filesystem::path const& path);
 }
 }
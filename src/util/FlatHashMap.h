@@ -0,0 +1,588 @@
+#pragma once
+
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/GlobalChecks.h"
+#include "util/RandHasher.h"
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace stellar
+{
+
+// An open-addressing hash map for maps that are built, probed and then merged
+// into another map, like the entries of a LedgerTxn.
+//
+// All elements live in a single slot array next to the full hash of their key,
+// and a parallel array of control bytes holds 7 bits of that hash for each full
+// slot (or marks the slot empty or deleted), so probing only compares keys
+// when those bits match. Because hashes are stored, growing the table never
+// calls the hasher, and find and emplaceWithHash accept a precomputed hash so
+// that an element can be moved into another map with the same hasher without
+// hashing its key again (see iterator::hash).
+//
+// Unlike std::unordered_map:
+// - any insertion may invalidate all iterators, pointers and references into
+//   the map (erase only invalidates the erased element), and
+// - elements are std::pair<Key, T> rather than std::pair<Key const, T>, so
+//   that growing the table can move keys. Keys must not be modified through
+//   an iterator.
+template <class Key, class T, class Hasher = RandHasher<Key>,
+          class KeyEqual = std::equal_to<Key>>
+class FlatHashMap
+{
+  public:
+    using key_type = Key;
+    using mapped_type = T;
+    using value_type = std::pair<Key, T>;
+    using size_type = size_t;
+
+  private:
+    static constexpr uint8_t EMPTY = 0x80;
+    static constexpr uint8_t DELETED = 0xFE;
+    static constexpr size_t MIN_CAPACITY = 16;
+
+    struct Slot
+    {
+        size_t hash;
+        alignas(value_type) unsigned char storage[sizeof(value_type)];
+
+        value_type*
+        value()
+        {
+            return std::launder(reinterpret_cast<value_type*>(storage));
+        }
+
+        value_type const*
+        value() const
+        {
+            return std::launder(reinterpret_cast<value_type const*>(storage));
+        }
+    };
+
+    std::unique_ptr<uint8_t[]> mCtrl;
+    std::unique_ptr<Slot[]> mSlots;
+    // Zero or a power of 2
+    size_t mCapacity{0};
+    size_t mSize{0};
+    size_t mDeleted{0};
+    Hasher mHasher;
+    KeyEqual mKeyEqual;
+
+    static bool
+    isFull(uint8_t ctrl)
+    {
+        return (ctrl & 0x80) == 0;
+    }
+
+    static uint8_t
+    tag(size_t hash)
+    {
+        return static_cast<uint8_t>(hash & 0x7F);
+    }
+
+    size_t
+    firstProbe(size_t hash) const
+    {
+        return (hash >> 7) & (mCapacity - 1);
+    }
+
+    size_t
+    nextProbe(size_t i) const
+    {
+        return (i + 1) & (mCapacity - 1);
+    }
+
+    // Tables are kept at most 7/8 full, counting deleted slots, so probing
+    // always reaches an empty slot
+    static bool
+    overLoaded(size_t used, size_t capacity)
+    {
+        return used * 8 > capacity * 7;
+    }
+
+    static std::unique_ptr<Slot[]>
+    allocateSlots(size_t capacity)
+    {
+        // Slots are constructed in place as they are filled
+        return std::unique_ptr<Slot[]>(new Slot[capacity]);
+    }
+
+    void
+    rehash(size_t minSize)
+    {
+        if (minSize > (std::numeric_limits<size_t>::max() >> 5))
+        {
+            throw std::length_error("FlatHashMap size is too large");
+        }
+
+        // Leave room for the table to double in size before the next rehash
+        size_t newCapacity = MIN_CAPACITY;
+        while (overLoaded(minSize * 2, newCapacity))
+        {
+            newCapacity *= 2;
+        }
+
+        auto newCtrl = std::make_unique<uint8_t[]>(newCapacity);
+        auto newSlots = allocateSlots(newCapacity);
+        std::fill(newCtrl.get(), newCtrl.get() + newCapacity, EMPTY);
+
+        for (size_t i = 0; i < mCapacity; ++i)
+        {
+            if (!isFull(mCtrl[i]))
+            {
+                continue;
+            }
+            auto& slot = mSlots[i];
+            size_t j = (slot.hash >> 7) & (newCapacity - 1);
+            while (newCtrl[j] != EMPTY)
+            {
+                j = (j + 1) & (newCapacity - 1);
+            }
+            new (newSlots[j].storage) value_type(std::move(*slot.value()));
+            newSlots[j].hash = slot.hash;
+            newCtrl[j] = mCtrl[i];
+            slot.value()->~value_type();
+        }
+
+        mCtrl = std::move(newCtrl);
+        mSlots = std::move(newSlots);
+        mCapacity = newCapacity;
+        mDeleted = 0;
+    }
+
+    void
+    destroyAll() noexcept
+    {
+        for (size_t i = 0; i < mCapacity; ++i)
+        {
+            if (isFull(mCtrl[i]))
+            {
+                mSlots[i].value()->~value_type();
+            }
+        }
+    }
+
+    template <bool IsConst> class Iterator
+    {
+        using MapPtr =
+            std::conditional_t<IsConst, FlatHashMap const*, FlatHashMap*>;
+
+        MapPtr mMap{nullptr};
+        size_t mIndex{0};
+
+        void
+        skipToFull()
+        {
+            while (mIndex < mMap->mCapacity && !isFull(mMap->mCtrl[mIndex]))
+            {
+                ++mIndex;
+            }
+        }
+
+        friend class FlatHashMap;
+
+        Iterator(MapPtr map, size_t index) : mMap(map), mIndex(index)
+        {
+        }
+
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = FlatHashMap::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer =
+            std::conditional_t<IsConst, value_type const*, value_type*>;
+        using reference =
+            std::conditional_t<IsConst, value_type const&, value_type&>;
+
+        Iterator() = default;
+
+        // Allow iterator -> const_iterator
+        template <bool WasConst, class = std::enable_if_t<IsConst && !WasConst>>
+        Iterator(Iterator<WasConst> const& other)
+            : mMap(other.mMap), mIndex(other.mIndex)
+        {
+        }
+
+        reference
+        operator*() const
+        {
+            return *mMap->mSlots[mIndex].value();
+        }
+
+        pointer
+        operator->() const
+        {
+            return mMap->mSlots[mIndex].value();
+        }
+
+        Iterator&
+        operator++()
+        {
+            ++mIndex;
+            skipToFull();
+            return *this;
+        }
+
+        Iterator
+        operator++(int)
+        {
+            auto res = *this;
+            ++*this;
+            return res;
+        }
+
+        // The hash of this element's key, for use with find(key, hash) and
+        // emplaceWithHash
+        size_t
+        hash() const
+        {
+            return mMap->mSlots[mIndex].hash;
+        }
+
+        bool
+        operator==(Iterator const& other) const
+        {
+            return mMap == other.mMap && mIndex == other.mIndex;
+        }
+
+        bool
+        operator!=(Iterator const& other) const
+        {
+            return !(*this == other);
+        }
+
+        template <bool> friend class Iterator;
+    };
+
+  public:
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    FlatHashMap() = default;
+
+    FlatHashMap(FlatHashMap const& other)
+        : mHasher(other.mHasher), mKeyEqual(other.mKeyEqual)
+    {
+        if (other.mSize == 0)
+        {
+            return;
+        }
+
+        auto ctrl = std::make_unique<uint8_t[]>(other.mCapacity);
+        auto slots = allocateSlots(other.mCapacity);
+        std::fill(ctrl.get(), ctrl.get() + other.mCapacity, EMPTY);
+        try
+        {
+            for (size_t i = 0; i < other.mCapacity; ++i)
+            {
+                if (isFull(other.mCtrl[i]))
+                {
+                    new (slots[i].storage)
+                        value_type(*other.mSlots[i].value());
+                    slots[i].hash = other.mSlots[i].hash;
+                    ctrl[i] = other.mCtrl[i];
+                }
+            }
+        }
+        catch (...)
+        {
+            for (size_t i = 0; i < other.mCapacity; ++i)
+            {
+                if (isFull(ctrl[i]))
+                {
+                    slots[i].value()->~value_type();
+                }
+            }
+            throw;
+        }
+
+        // Deleted slots are kept so that probe sequences stay intact
+        for (size_t i = 0; i < other.mCapacity; ++i)
+        {
+            if (other.mCtrl[i] == DELETED)
+            {
+                ctrl[i] = DELETED;
+            }
+        }
+        mCtrl = std::move(ctrl);
+        mSlots = std::move(slots);
+        mCapacity = other.mCapacity;
+        mSize = other.mSize;
+        mDeleted = other.mDeleted;
+    }
+
+    FlatHashMap(FlatHashMap&& other) noexcept
+    {
+        swap(other);
+    }
+
+    FlatHashMap&
+    operator=(FlatHashMap const& other)
+    {
+        if (this != &other)
+        {
+            FlatHashMap copy(other);
+            swap(copy);
+        }
+        return *this;
+    }
+
+    FlatHashMap&
+    operator=(FlatHashMap&& other) noexcept
+    {
+        if (this != &other)
+        {
+            FlatHashMap empty;
+            swap(empty);
+            swap(other);
+        }
+        return *this;
+    }
+
+    ~FlatHashMap()
+    {
+        destroyAll();
+    }
+
+    void
+    swap(FlatHashMap& other) noexcept
+    {
+        using std::swap;
+        swap(mCtrl, other.mCtrl);
+        swap(mSlots, other.mSlots);
+        swap(mCapacity, other.mCapacity);
+        swap(mSize, other.mSize);
+        swap(mDeleted, other.mDeleted);
+        swap(mHasher, other.mHasher);
+        swap(mKeyEqual, other.mKeyEqual);
+    }
+
+    iterator
+    begin()
+    {
+        iterator it(this, 0);
+        if (mCapacity > 0)
+        {
+            it.skipToFull();
+        }
+        return it;
+    }
+
+    const_iterator
+    begin() const
+    {
+        const_iterator it(this, 0);
+        if (mCapacity > 0)
+        {
+            it.skipToFull();
+        }
+        return it;
+    }
+
+    const_iterator
+    cbegin() const
+    {
+        return begin();
+    }
+
+    iterator
+    end()
+    {
+        return iterator(this, mCapacity);
+    }
+
+    const_iterator
+    end() const
+    {
+        return const_iterator(this, mCapacity);
+    }
+
+    const_iterator
+    cend() const
+    {
+        return end();
+    }
+
+    size_t
+    size() const
+    {
+        return mSize;
+    }
+
+    bool
+    empty() const
+    {
+        return mSize == 0;
+    }
+
+    // Bytes allocated for slots, which hold the elements in place
+    size_t
+    memoryUsage() const
+    {
+        return mCapacity * (sizeof(Slot) + sizeof(uint8_t));
+    }
+
+    size_t
+    hashKey(Key const& key) const
+    {
+        return mHasher(key);
+    }
+
+    // Finds key, whose hash must be hash (as returned by hashKey or
+    // iterator::hash), without calling the hasher
+    iterator
+    find(Key const& key, size_t hash)
+    {
+        if (mSize == 0)
+        {
+            return end();
+        }
+
+        auto t = tag(hash);
+        for (size_t i = firstProbe(hash);; i = nextProbe(i))
+        {
+            auto ctrl = mCtrl[i];
+            if (ctrl == EMPTY)
+            {
+                return end();
+            }
+            if (ctrl == t && mSlots[i].hash == hash &&
+                mKeyEqual(mSlots[i].value()->first, key))
+            {
+                return iterator(this, i);
+            }
+        }
+    }
+
+    const_iterator
+    find(Key const& key, size_t hash) const
+    {
+        return const_cast<FlatHashMap*>(this)->find(key, hash);
+    }
+
+    iterator
+    find(Key const& key)
+    {
+        return find(key, hashKey(key));
+    }
+
+    const_iterator
+    find(Key const& key) const
+    {
+        return find(key, hashKey(key));
+    }
+
+    size_t
+    count(Key const& key) const
+    {
+        return find(key) != end() ? 1 : 0;
+    }
+
+    // Inserts (key, T(args...)) if key, whose hash must be hash, is not in the
+    // map. Returns an iterator to the element with key and whether it was
+    // inserted. Provides the strong exception safety guarantee.
+    template <class K, class... Args>
+    std::pair<iterator, bool>
+    emplaceWithHash(size_t hash, K&& key, Args&&... args)
+    {
+        auto it = find(key, hash);
+        if (it != end())
+        {
+            return {it, false};
+        }
+
+        if (mCapacity == 0 || overLoaded(mSize + mDeleted + 1, mCapacity))
+        {
+            rehash(mSize + 1);
+        }
+
+        size_t i = firstProbe(hash);
+        while (isFull(mCtrl[i]))
+        {
+            i = nextProbe(i);
+        }
+
+        new (mSlots[i].storage) value_type(
+            std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)),
+            std::forward_as_tuple(std::forward<Args>(args)...));
+        mSlots[i].hash = hash;
+        if (mCtrl[i] == DELETED)
+        {
+            --mDeleted;
+        }
+        mCtrl[i] = tag(hash);
+        ++mSize;
+        return {iterator(this, i), true};
+    }
+
+    template <class... Args>
+    std::pair<iterator, bool>
+    emplace(Key const& key, Args&&... args)
+    {
+        return emplaceWithHash(hashKey(key), key,
+                               std::forward<Args>(args)...);
+    }
+
+    T&
+    operator[](Key const& key)
+    {
+        return emplace(key).first->second;
+    }
+
+    void
+    erase(const_iterator pos) noexcept
+    {
+        releaseAssert(pos.mMap == this && pos.mIndex < mCapacity &&
+                      isFull(mCtrl[pos.mIndex]));
+        mSlots[pos.mIndex].value()->~value_type();
+        mCtrl[pos.mIndex] = DELETED;
+        --mSize;
+        ++mDeleted;
+    }
+
+    size_t
+    erase(Key const& key) noexcept
+    {
+        auto it = find(key);
+        if (it == end())
+        {
+            return 0;
+        }
+        erase(it);
+        return 1;
+    }
+
+    void
+    clear() noexcept
+    {
+        destroyAll();
+        mCtrl.reset();
+        mSlots.reset();
+        mCapacity = 0;
+        mSize = 0;
+        mDeleted = 0;
+    }
+
+    // Makes room for n elements without further rehashing
+    void
+    reserve(size_t n)
+    {
+        if (mCapacity == 0 || overLoaded(n + mDeleted, mCapacity))
+        {
+            rehash(n);
+        }
+    }
+};
+}
@@ -0,0 +1,229 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/FlightRecorder.h"
+#include "lib/json/json.h"
+#include "util/Fs.h"
+#include "util/Logging.h"
+
+#include <algorithm>
+#include <fmt/format.h>
+#include <fstream>
+
+namespace stellar
+{
+
+namespace
+{
+std::string const DUMP_PREFIX{"flight-recorder-"};
+}
+
+FlightRecorder::Span::Span(FlightRecorder& recorder, char const* name,
+                           char const* category, uint32_t ledger)
+    : mRecorder(recorder), mName(name), mCategory(category), mLedger(ledger)
+{
+    if (mRecorder.enabled())
+    {
+        mStart = std::chrono::steady_clock::now();
+    }
+}
+
+FlightRecorder::Span::~Span()
+{
+    if (mRecorder.enabled())
+    {
+        Event e;
+        e.mName = mName;
+        e.mCategory = mCategory;
+        e.mTime = mStart - mRecorder.mStart;
+        e.mDuration = std::chrono::steady_clock::now() - mStart;
+        e.mLedger = mLedger;
+        e.mType = EventType::SPAN;
+        mRecorder.record(std::move(e));
+    }
+}
+
+FlightRecorder::FlightRecorder(uint32_t ledgers,
+                               std::chrono::milliseconds dumpThreshold,
+                               std::filesystem::path dumpDir)
+    : mLedgers(ledgers)
+    , mDumpThreshold(dumpThreshold)
+    , mDumpDir(std::move(dumpDir))
+    , mStart(std::chrono::steady_clock::now())
+    , mCapacity(static_cast<size_t>(mLedgers) * EVENTS_PER_LEDGER)
+{
+    mEvents.reserve(mCapacity);
+}
+
+void
+FlightRecorder::record(Event&& e)
+{
+    std::lock_guard<std::mutex> guard(mMutex);
+    mMaxLedger = std::max(mMaxLedger, e.mLedger);
+    if (mEvents.size() < mCapacity)
+    {
+        mEvents.emplace_back(std::move(e));
+    }
+    else
+    {
+        mEvents[mNext] = std::move(e);
+        mNext = (mNext + 1) % mEvents.size();
+    }
+}
+
+void
+FlightRecorder::instant(char const* name, char const* category,
+                        uint32_t ledger)
+{
+    if (!enabled())
+    {
+        return;
+    }
+    Event e;
+    e.mName = name;
+    e.mCategory = category;
+    e.mTime = std::chrono::steady_clock::now() - mStart;
+    e.mLedger = ledger;
+    e.mType = EventType::INSTANT;
+    record(std::move(e));
+}
+
+void
+FlightRecorder::counter(char const* name, uint32_t ledger, int64_t value)
+{
+    if (!enabled())
+    {
+        return;
+    }
+    Event e;
+    e.mName = name;
+    e.mCategory = "counter";
+    e.mTime = std::chrono::steady_clock::now() - mStart;
+    e.mValue = value;
+    e.mLedger = ledger;
+    e.mType = EventType::COUNTER;
+    record(std::move(e));
+}
+
+std::string
+FlightRecorder::dump(uint32_t ledgers) const
+{
+    Json::Value root;
+    auto& events = root["traceEvents"];
+    events = Json::Value(Json::arrayValue);
+
+    std::lock_guard<std::mutex> guard(mMutex);
+    uint32_t minLedger = 0;
+    if (ledgers != 0 && mMaxLedger >= ledgers)
+    {
+        minLedger = mMaxLedger - ledgers + 1;
+    }
+    // Oldest first
+    for (size_t i = 0; i < mEvents.size(); ++i)
+    {
+        auto const& e = mEvents[(mNext + i) % mEvents.size()];
+        if (e.mLedger < minLedger)
+        {
+            continue;
+        }
+        Json::Value ev;
+        ev["name"] = e.mName;
+        ev["cat"] = e.mCategory;
+        ev["pid"] = 0;
+        ev["tid"] = 0;
+        ev["ts"] = static_cast<double>(e.mTime.count()) / 1000.0;
+        switch (e.mType)
+        {
+        case EventType::SPAN:
+            ev["ph"] = "X";
+            ev["dur"] = static_cast<double>(e.mDuration.count()) / 1000.0;
+            ev["args"]["ledger"] = e.mLedger;
+            break;
+        case EventType::INSTANT:
+            ev["ph"] = "i";
+            ev["s"] = "g";
+            ev["args"]["ledger"] = e.mLedger;
+            break;
+        case EventType::COUNTER:
+            ev["ph"] = "C";
+            ev["args"][e.mName] = static_cast<Json::Int64>(e.mValue);
+            break;
+        }
+        events.append(ev);
+    }
+    root["displayTimeUnit"] = "ms";
+    root["otherData"]["lastLedger"] = mMaxLedger;
+    return root.toStyledString();
+}
+
+std::filesystem::path
+FlightRecorder::ledgerClosed(uint32_t ledger,
+                             std::chrono::nanoseconds closeTime)
+{
+    if (!enabled() || mDumpThreshold.count() == 0 ||
+        closeTime <= mDumpThreshold)
+    {
+        return {};
+    }
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+        if (mLastDumpedLedger != 0 && ledger < mLastDumpedLedger + mLedgers)
+        {
+            return {};
+        }
+        mLastDumpedLedger = ledger;
+    }
+
+    if (!fs::mkpath(mDumpDir.string()))
+    {
+        CLOG_ERROR(Perf, "Failed to create flight recorder directory {}",
+                   mDumpDir.string());
+        return {};
+    }
+    auto path = mDumpDir / fmt::format("{}{:010}.json", DUMP_PREFIX, ledger);
+    std::ofstream out(path, std::ios_base::trunc);
+    out << dump();
+    if (!out)
+    {
+        CLOG_ERROR(Perf, "Failed to write flight recorder dump {}",
+                   path.string());
+        return {};
+    }
+    CLOG_WARNING(Perf,
+                 "Ledger {} took {} ms to close, wrote the last {} ledgers "
+                 "of the flight recorder to {}",
+                 ledger,
+                 std::chrono::duration_cast<std::chrono::milliseconds>(
+                     closeTime)
+                     .count(),
+                 mLedgers, path.string());
+    removeOldDumps();
+    return path;
+}
+
+void
+FlightRecorder::removeOldDumps() const
+{
+    std::vector<std::filesystem::path> dumps;
+    std::error_code ec;
+    for (auto const& entry :
+         std::filesystem::directory_iterator(mDumpDir, ec))
+    {
+        if (entry.path().filename().string().rfind(DUMP_PREFIX, 0) == 0)
+        {
+            dumps.emplace_back(entry.path());
+        }
+    }
+    if (dumps.size() <= MAX_DUMPS)
+    {
+        return;
+    }
+    // Names have zero-padded ledger numbers, so sort oldest first
+    std::sort(dumps.begin(), dumps.end());
+    for (size_t i = 0; i + MAX_DUMPS < dumps.size(); ++i)
+    {
+        std::filesystem::remove(dumps[i], ec);
+    }
+}
+}
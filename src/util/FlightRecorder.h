@@ -0,0 +1,119 @@
+#pragma once
+
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/NonCopyable.h"
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace stellar
+{
+
+// Always-on record of the last few ledgers: spans of the main ledger close
+// stages, SCP events and scheduler queue depths, each tagged with the ledger
+// it belongs to. Events go into a fixed-size ring buffer, so recording costs
+// two clock reads and an uncontended lock, and the oldest ledgers are
+// overwritten as new ones come in.
+//
+// This is for slow closes in production, where Tracy is not attached and the
+// close can't be reproduced: the record of the last ledgers can be fetched
+// with the `flightrecorder` HTTP command, and is written out automatically
+// when a close takes longer than a threshold. Both use the Chrome trace event
+// format, which chrome://tracing, Perfetto and speedscope display.
+class FlightRecorder : public NonMovableOrCopyable
+{
+  public:
+    // Records the code it encloses as a span of `ledger`. name and category
+    // must be string literals.
+    class Span : public NonMovableOrCopyable
+    {
+        FlightRecorder& mRecorder;
+        char const* const mName;
+        char const* const mCategory;
+        uint32_t const mLedger;
+        std::chrono::steady_clock::time_point mStart;
+
+      public:
+        Span(FlightRecorder& recorder, char const* name, char const* category,
+             uint32_t ledger);
+        ~Span();
+    };
+
+    // Events the ring buffer has room for, per ledger kept
+    static size_t const EVENTS_PER_LEDGER = 256;
+    // Automatic dumps kept in the dump directory, older ones being removed
+    static size_t const MAX_DUMPS = 10;
+
+    // Keeps events of the last `ledgers` ledgers; 0 disables recording.
+    // Closes slower than dumpThreshold (if non-zero) are written to dumpDir.
+    FlightRecorder(uint32_t ledgers, std::chrono::milliseconds dumpThreshold,
+                   std::filesystem::path dumpDir);
+
+    bool
+    enabled() const
+    {
+        return mLedgers != 0;
+    }
+
+    // A point event, like an SCP phase being reached
+    void instant(char const* name, char const* category, uint32_t ledger);
+
+    // A sampled value, like the size of a queue
+    void counter(char const* name, uint32_t ledger, int64_t value);
+
+    // To be called when `ledger` has closed, taking closeTime. Writes the
+    // record of the last ledgers to dumpDir if closeTime is over the
+    // threshold, and no automatic dump since the last `ledgers` ledgers has
+    // covered this one. Returns the file written, if any.
+    std::filesystem::path ledgerClosed(uint32_t ledger,
+                                       std::chrono::nanoseconds closeTime);
+
+    // Events of the last `ledgers` ledgers (all kept if 0) in the Chrome
+    // trace event format
+    std::string dump(uint32_t ledgers = 0) const;
+
+  private:
+    enum class EventType : uint8_t
+    {
+        SPAN,
+        INSTANT,
+        COUNTER
+    };
+
+    struct Event
+    {
+        char const* mName{nullptr};
+        char const* mCategory{nullptr};
+        // Since mStart
+        std::chrono::nanoseconds mTime{0};
+        std::chrono::nanoseconds mDuration{0};
+        int64_t mValue{0};
+        uint32_t mLedger{0};
+        EventType mType{EventType::INSTANT};
+    };
+
+    uint32_t const mLedgers;
+    std::chrono::milliseconds const mDumpThreshold;
+    std::filesystem::path const mDumpDir;
+    std::chrono::steady_clock::time_point const mStart;
+    size_t const mCapacity;
+
+    mutable std::mutex mMutex;
+    std::vector<Event> mEvents;
+    // Where the next event goes; events before it (wrapping around) are the
+    // most recent
+    size_t mNext{0};
+    uint32_t mMaxLedger{0};
+    uint32_t mLastDumpedLedger{0};
+
+    void record(Event&& e);
+    void removeOldDumps() const;
+};
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include <cstddef>
+#include <new>
+
+namespace stellar
+{
+
+// Blocks of Size bytes that were freed on this thread, kept for reuse instead
+// of being returned to the heap. At most MAX_BLOCKS are kept, the rest are
+// freed as usual. A block may be freed on a different thread than the one that
+// allocated it; it then simply moves to the free list of that thread.
+template <size_t Size> class ThreadLocalFreeList
+{
+    static_assert(Size >= sizeof(void*));
+
+    struct Block
+    {
+        Block* mNext;
+    };
+
+    Block* mHead{nullptr};
+    size_t mSize{0};
+
+    ThreadLocalFreeList() = default;
+
+  public:
+    static constexpr size_t MAX_BLOCKS = 4096;
+
+    ThreadLocalFreeList(ThreadLocalFreeList const&) = delete;
+    ThreadLocalFreeList& operator=(ThreadLocalFreeList const&) = delete;
+
+    ~ThreadLocalFreeList()
+    {
+        while (mHead)
+        {
+            auto next = mHead->mNext;
+            ::operator delete(mHead);
+            mHead = next;
+        }
+    }
+
+    static ThreadLocalFreeList&
+    get()
+    {
+        static thread_local ThreadLocalFreeList list;
+        return list;
+    }
+
+    void*
+    allocate()
+    {
+        if (!mHead)
+        {
+            return ::operator new(Size);
+        }
+        auto res = mHead;
+        mHead = mHead->mNext;
+        --mSize;
+        return res;
+    }
+
+    void
+    deallocate(void* p) noexcept
+    {
+        if (mSize >= MAX_BLOCKS)
+        {
+            ::operator delete(p);
+            return;
+        }
+        mHead = new (p) Block{mHead};
+        ++mSize;
+    }
+
+    size_t
+    size() const
+    {
+        return mSize;
+    }
+};
+
+// Allocator for std::allocate_shared of objects that are created and
+// destroyed at a high rate, such as the handles returned by LedgerTxn loads.
+// The object and its control block come from a thread-local free list, so
+// that in steady state creating a handle does not touch the heap.
+template <typename T> class FreeListAllocator
+{
+  public:
+    using value_type = T;
+
+    static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+
+    FreeListAllocator() noexcept = default;
+
+    template <typename U>
+    FreeListAllocator(FreeListAllocator<U> const&) noexcept
+    {
+    }
+
+    T*
+    allocate(size_t n)
+    {
+        if (n != 1)
+        {
+            return static_cast<T*>(::operator new(n * sizeof(T)));
+        }
+        return static_cast<T*>(freeList().allocate());
+    }
+
+    void
+    deallocate(T* p, size_t n) noexcept
+    {
+        if (n != 1)
+        {
+            ::operator delete(p);
+            return;
+        }
+        freeList().deallocate(p);
+    }
+
+    static constexpr size_t BLOCK_SIZE =
+        sizeof(T) < sizeof(void*) ? sizeof(void*) : sizeof(T);
+
+    static ThreadLocalFreeList<BLOCK_SIZE>&
+    freeList()
+    {
+        return ThreadLocalFreeList<BLOCK_SIZE>::get();
+    }
+};
+
+template <typename T, typename U>
+bool
+operator==(FreeListAllocator<T> const&, FreeListAllocator<U> const&) noexcept
+{
+    return true;
+}
+
+template <typename T, typename U>
+bool
+operator!=(FreeListAllocator<T> const&, FreeListAllocator<U> const&) noexcept
+{
+    return false;
+}
+}
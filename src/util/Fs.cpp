@@ -4,6 +4,7 @@
 
 #include "util/Fs.h"
 #include "crypto/Hex.h"
+#include "util/ContentionProfiler.h"
 #include "util/FileSystemException.h"
 #include "util/GlobalChecks.h"
 #include "util/Logging.h"
@@ -32,6 +33,8 @@
 #include <io.h>
 #else
 #include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/resource.h>
 #include <sys/stat.h>
 #endif
@@ -98,6 +101,7 @@ void
 flushFileChanges(native_handle_t fh)
 {
     ZoneScoped;
+    BlockingIOScope io("fs::flushFileChanges");
     if (FlushFileBuffers(fh) == FALSE)
     {
         FileSystemException::failWithGetLastError(
@@ -105,6 +109,11 @@ flushFileChanges(native_handle_t fh)
     }
 }
 
+void
+dropFileCache(native_handle_t fh, uint64_t offset, uint64_t length)
+{
+}
+
 native_handle_t
 openFileToWrite(std::string const& path)
 {
@@ -153,6 +162,7 @@ durableRename(std::string const& src, std::string const& dst,
               std::string const& dir)
 {
     ZoneScoped;
+    BlockingIOScope io("fs::durableRename");
     if (MoveFileExA(src.c_str(), dst.c_str(), MOVEFILE_WRITE_THROUGH) == 0)
     {
         FileSystemException::failWithGetLastError(
@@ -223,6 +233,7 @@ void
 flushFileChanges(native_handle_t fd)
 {
     ZoneScoped;
+    BlockingIOScope io("fs::flushFileChanges");
     while (fsync(fd) == -1)
     {
         if (errno == EINTR)
@@ -234,6 +245,18 @@ flushFileChanges(native_handle_t fd)
     }
 }
 
+void
+dropFileCache(native_handle_t fd, uint64_t offset, uint64_t length)
+{
+    ZoneScoped;
+#ifdef POSIX_FADV_DONTNEED
+    // posix_fadvise returns the error rather than setting errno, and a failed
+    // hint is harmless, so the result is intentionally ignored.
+    (void)posix_fadvise(fd, static_cast<off_t>(offset),
+                        static_cast<off_t>(length), POSIX_FADV_DONTNEED);
+#endif
+}
+
 native_handle_t
 openFileToWrite(std::string const& path)
 {
@@ -257,6 +280,7 @@ durableRename(std::string const& src, std::string const& dst,
               std::string const& dir)
 {
     ZoneScoped;
+    BlockingIOScope io("fs::durableRename");
     if (rename(src.c_str(), dst.c_str()) != 0)
     {
         return false;
@@ -302,6 +326,27 @@ exists(std::string const& name)
     return stdfs::exists(stdfs::path(name));
 }
 
+bool
+linkOrCopy(std::string const& src, std::string const& dst)
+{
+    ZoneScoped;
+    std::error_code ec;
+    stdfs::create_hard_link(stdfs::path(src), stdfs::path(dst), ec);
+    if (ec)
+    {
+        ec.clear();
+        stdfs::copy_file(stdfs::path(src), stdfs::path(dst),
+                         stdfs::copy_options::overwrite_existing, ec);
+    }
+    if (ec)
+    {
+        CLOG_DEBUG(Fs, "failed to link or copy {} to {}: {}", src, dst,
+                   ec.message());
+        return false;
+    }
+    return true;
+}
+
 bool
 mkdir(std::string const& name)
 {
@@ -500,5 +545,165 @@ getOpenHandleCount()
 }
 #endif
 
+#ifdef _WIN32
+ReadOnlyMappedFile::ReadOnlyMappedFile(std::string const& path)
+{
+    ZoneScoped;
+    HANDLE h = ::CreateFile(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (h == INVALID_HANDLE_VALUE)
+    {
+        throw FileSystemException("unable to open file for mapping: " + path);
+    }
+
+    LARGE_INTEGER sz;
+    if (!GetFileSizeEx(h, &sz))
+    {
+        CloseHandle(h);
+        throw FileSystemException("unable to get size of file: " + path);
+    }
+
+    mSize = static_cast<size_t>(sz.QuadPart);
+    if (mSize != 0)
+    {
+        mMapping = CreateFileMapping(h, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mMapping != NULL)
+        {
+            mData = static_cast<char const*>(
+                MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+        }
+    }
+    CloseHandle(h);
+
+    if (mSize != 0 && mData == nullptr)
+    {
+        if (mMapping != NULL)
+        {
+            CloseHandle(mMapping);
+        }
+        throw FileSystemException("unable to map file: " + path);
+    }
+}
+
+ReadOnlyMappedFile::~ReadOnlyMappedFile()
+{
+    if (mData)
+    {
+        UnmapViewOfFile(mData);
+    }
+    if (mMapping != NULL)
+    {
+        CloseHandle(mMapping);
+    }
+}
+#else
+ReadOnlyMappedFile::ReadOnlyMappedFile(std::string const& path)
+{
+    ZoneScoped;
+    int fd;
+    while ((fd = ::open(path.c_str(), O_RDONLY)) == -1)
+    {
+        if (errno == EINTR)
+        {
+            continue;
+        }
+        FileSystemException::failWithErrno(
+            std::string("fs::ReadOnlyMappedFile(\"") + path +
+            "\") failed to open: ");
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        FileSystemException::failWithErrno(
+            std::string("fs::ReadOnlyMappedFile(\"") + path +
+            "\") failed to stat: ");
+    }
+
+    mSize = static_cast<size_t>(st.st_size);
+    if (mSize != 0)
+    {
+        void* addr = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED)
+        {
+            close(fd);
+            FileSystemException::failWithErrno(
+                std::string("fs::ReadOnlyMappedFile(\"") + path +
+                "\") failed to map: ");
+        }
+
+        // Point lookups jump around the file, so readahead mostly wastes page
+        // cache
+        madvise(addr, mSize, MADV_RANDOM);
+        mData = static_cast<char const*>(addr);
+    }
+
+    // The mapping keeps its own reference to the file
+    close(fd);
+}
+
+ReadOnlyMappedFile::~ReadOnlyMappedFile()
+{
+    if (mData)
+    {
+        munmap(const_cast<char*>(mData), mSize);
+    }
+}
+#endif
+
+#ifdef _WIN32
+FileReadAhead::FileReadAhead(std::string const& path, uint64_t window)
+    : mWindow(window)
+{
+}
+
+FileReadAhead::~FileReadAhead()
+{
+}
+
+void
+FileReadAhead::advance(uint64_t pos)
+{
+}
+#else
+FileReadAhead::FileReadAhead(std::string const& path, uint64_t window)
+    : mWindow(window)
+{
+    releaseAssert(window != 0);
+    // The page cache is shared by every open file description of the file,
+    // so hints on this fd help reads through any other
+    while ((mFd = ::open(path.c_str(), O_RDONLY)) == -1 && errno == EINTR)
+    {
+    }
+}
+
+FileReadAhead::~FileReadAhead()
+{
+    if (mFd != -1)
+    {
+        close(mFd);
+    }
+}
+
+void
+FileReadAhead::advance(uint64_t pos)
+{
+    if (mFd == -1 || pos + mWindow / 2 < mRequestedEnd)
+    {
+        return;
+    }
+    ZoneScoped;
+    auto start = std::max(pos, mRequestedEnd);
+    auto end = pos + mWindow;
+#ifdef POSIX_FADV_WILLNEED
+    // Returns the error rather than setting errno; see dropFileCache
+    (void)posix_fadvise(mFd, static_cast<off_t>(start),
+                        static_cast<off_t>(end - start), POSIX_FADV_WILLNEED);
+#endif
+    mRequestedEnd = end;
+}
+#endif
+
 }
 }
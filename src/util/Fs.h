@@ -4,6 +4,7 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
+#include "util/NonCopyable.h"
 #include "util/asio.h"
 
 #include <filesystem>
@@ -24,6 +25,14 @@ bufsz()
     return 0x40000;
 }
 
+// Buffer size for long sequential reads that would otherwise issue many small
+// reads, such as the inputs of a large bucket merge.
+inline constexpr size_t
+streamingBufsz()
+{
+    return 0x400000;
+}
+
 // Platform-specific synchronous stream type.
 #ifdef _WIN32
 using stream_t = asio::windows::stream_handle;
@@ -47,6 +56,13 @@ void unlockFile(std::string const& path);
 // Call fsync() on POSIX or FlushFileBuffers() on Win32.
 void flushFileChanges(native_handle_t h);
 
+// Advise the OS that the cached pages of h in [offset, offset + length) will
+// not be needed again. Dirty pages are written back first where the platform
+// supports it. A length of 0 covers everything from offset to the end of the
+// file. This is purely advisory: it does nothing on Win32 and errors are
+// ignored.
+void dropFileCache(native_handle_t h, uint64_t offset, uint64_t length);
+
 // Open a native handle (fd or HANDLE) for writing.
 native_handle_t openFileToWrite(std::string const& path);
 
@@ -62,6 +78,10 @@ bool durableRename(std::string const& src, std::string const& dst,
 // Return whether a path exists.
 bool exists(std::string const& path);
 
+// Make dst a hard link to src, or a copy of it if they can't be linked (e.g.
+// on different filesystems). Returns false if neither worked.
+bool linkOrCopy(std::string const& src, std::string const& dst);
+
 // Delete a path and everything inside it (if a dir).
 void deltree(std::string const& path);
 
@@ -115,5 +135,55 @@ int64_t getMaxHandles();
 // process handle count. On other unixes return 0.
 int64_t getOpenHandleCount();
 
+// Read-only memory mapping of an entire file. The file must not be modified
+// while mapped, so this should only be used for immutable files (i.e.
+// buckets). Throws FileSystemException if the file cannot be mapped. An empty
+// file produces a mapping with data() == nullptr and size() == 0.
+class ReadOnlyMappedFile : public NonMovableOrCopyable
+{
+    char const* mData{nullptr};
+    size_t mSize{0};
+#ifdef _WIN32
+    HANDLE mMapping{NULL};
+#endif
+
+  public:
+    explicit ReadOnlyMappedFile(std::string const& path);
+    ~ReadOnlyMappedFile();
+
+    char const*
+    data() const
+    {
+        return mData;
+    }
+
+    size_t
+    size() const
+    {
+        return mSize;
+    }
+};
+
+// Keeps the OS reading a file ahead of a sequential reader, so that its reads
+// are served from the page cache rather than waiting on the disk: whenever
+// `advance(pos)` gets within half a window of what was requested so far, the
+// next window past pos is requested to be read in the background. Like
+// dropFileCache this is purely advisory, and does nothing on Win32 or if the
+// file can't be opened.
+class FileReadAhead : public NonMovableOrCopyable
+{
+#ifndef _WIN32
+    int mFd{-1};
+#endif
+    uint64_t const mWindow;
+    uint64_t mRequestedEnd{0};
+
+  public:
+    FileReadAhead(std::string const& path, uint64_t window);
+    ~FileReadAhead();
+
+    void advance(uint64_t pos);
+};
+
 }
 }
@@ -12,7 +12,7 @@ size_t
 hash<stellar::uint256>::operator()(stellar::uint256 const& x) const noexcept
 {
     size_t res =
-        stellar::shortHash::computeHash(stellar::ByteSlice(x.data(), 8));
+        stellar::shortHash::computeFastHash(stellar::ByteSlice(x.data(), 8));
 
     return res;
 }
@@ -10,6 +10,7 @@
 #include <chrono>
 #include <fmt/chrono.h>
 #include <fstream>
+#include <spdlog/async.h>
 #include <spdlog/sinks/basic_file_sink.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/sinks/stdout_sinks.h>
@@ -36,6 +37,10 @@ bool Logging::mColor = false;
 std::string Logging::mLastPattern;
 std::string Logging::mLastFilenamePattern;
 bool Logging::mLogToConsole = true;
+size_t Logging::mAsyncQueueSize = 0;
+bool Logging::mAsyncDropOldest = false;
+std::shared_ptr<spdlog::details::thread_pool> Logging::mThreadPool;
+uint64_t Logging::mDroppedMessages = 0;
 #endif
 
 // Right now this is hard-coded to log messages at least as important as INFO
@@ -87,7 +92,7 @@ void
 Logging::init(bool truncate)
 {
 #if defined(USE_SPDLOG)
-    std::lock_guard<std::recursive_mutex> guard(mLogMutex);
+    std::lock_guard<ProfiledRecursiveMutex> guard(mLogMutex);
     if (!mInitialized)
     {
         using namespace spdlog::sinks;
@@ -166,10 +171,32 @@ Logging::init(bool truncate)
                 make_shared<basic_file_sink_mt>(filename, /*truncate=*/false));
         }
 
+        // Console-only logging stays synchronous: it is what tests and
+        // short-lived commands use, and they want the output in order with
+        // what they print themselves.
+        bool async = mAsyncQueueSize != 0 && !mLastFilenamePattern.empty();
+        if (async && !mThreadPool)
+        {
+            mThreadPool = make_shared<spdlog::details::thread_pool>(
+                mAsyncQueueSize, 1);
+        }
+        auto policy = mAsyncDropOldest
+                          ? spdlog::async_overflow_policy::overrun_oldest
+                          : spdlog::async_overflow_policy::block;
+
         auto makeLogger =
             [&](std::string const& name) -> shared_ptr<spdlog::logger> {
-            auto logger =
-                make_shared<spdlog::logger>(name, sinks.begin(), sinks.end());
+            shared_ptr<spdlog::logger> logger;
+            if (async)
+            {
+                logger = make_shared<spdlog::async_logger>(
+                    name, sinks.begin(), sinks.end(), mThreadPool, policy);
+            }
+            else
+            {
+                logger = make_shared<spdlog::logger>(name, sinks.begin(),
+                                                     sinks.end());
+            }
             spdlog::register_logger(logger);
             return logger;
         };
@@ -203,7 +230,7 @@ void
 Logging::deinit()
 {
 #if defined(USE_SPDLOG)
-    std::lock_guard<std::recursive_mutex> guard(mLogMutex);
+    std::lock_guard<ProfiledRecursiveMutex> guard(mLogMutex);
     if (mInitialized)
     {
 #define LOG_PARTITION(name) Logging::name##LogPtr = nullptr;
@@ -221,7 +248,7 @@ Logging::setFmt(std::string const& peerID, bool timestamps)
 #if defined(USE_SPDLOG)
     auto pattern =
         fmt::format("%Y-%m-%dT%H:%M:%S.%e {} [%^%n %l%$] %v", peerID);
-    std::lock_guard<std::recursive_mutex> guard(mLogMutex);
+    std::lock_guard<ProfiledRecursiveMutex> guard(mLogMutex);
     if (pattern != mLastPattern)
     {
         init();
@@ -235,7 +262,7 @@ void
 Logging::setLoggingToConsole(bool console)
 {
 #if defined(USE_SPDLOG)
-    std::lock_guard<std::recursive_mutex> guard(mLogMutex);
+    std::lock_guard<ProfiledRecursiveMutex> guard(mLogMutex);
     mLogToConsole = console;
     deinit();
     init();
@@ -246,7 +273,7 @@ void
 Logging::setLoggingToFile(std::string const& filename)
 {
 #if defined(USE_SPDLOG)
-    std::lock_guard<std::recursive_mutex> guard(mLogMutex);
+    std::lock_guard<ProfiledRecursiveMutex> guard(mLogMutex);
     mLastFilenamePattern = filename;
     deinit();
     try
@@ -270,17 +297,52 @@ void
 Logging::setLoggingColor(bool color)
 {
 #if defined(USE_SPDLOG)
-    std::lock_guard<std::recursive_mutex> guard(mLogMutex);
+    std::lock_guard<ProfiledRecursiveMutex> guard(mLogMutex);
     mColor = true;
     deinit();
     init();
 #endif
 }
 
+void
+Logging::setAsyncLogging(size_t queueSize, bool dropOldest)
+{
+#if defined(USE_SPDLOG)
+    std::lock_guard<ProfiledRecursiveMutex> guard(mLogMutex);
+    if (queueSize == mAsyncQueueSize && dropOldest == mAsyncDropOldest)
+    {
+        return;
+    }
+    deinit();
+    if (mThreadPool)
+    {
+        // Destroying the pool writes out what is still queued
+        mDroppedMessages += mThreadPool->overrun_counter();
+        mThreadPool.reset();
+    }
+    mAsyncQueueSize = queueSize;
+    mAsyncDropOldest = dropOldest;
+    init();
+#endif
+}
+
+uint64_t
+Logging::getDroppedMessages()
+{
+#if defined(USE_SPDLOG)
+    std::lock_guard<ProfiledRecursiveMutex> guard(mLogMutex);
+    return mDroppedMessages +
+           (mThreadPool ? static_cast<uint64_t>(mThreadPool->overrun_counter())
+                        : 0);
+#else
+    return 0;
+#endif
+}
+
 void
 Logging::setLogLevel(LogLevel level, const char* partition)
 {
-    std::lock_guard<std::recursive_mutex> guard(mLogMutex);
+    std::lock_guard<ProfiledRecursiveMutex> guard(mLogMutex);
     if (partition)
     {
         mPartitionLogLevels[partition] = level;
@@ -339,7 +401,7 @@ Logging::getLLfromString(std::string const& levelName)
 LogLevel
 Logging::getLogLevel(std::string const& partition)
 {
-    std::lock_guard<std::recursive_mutex> guard(mLogMutex);
+    std::lock_guard<ProfiledRecursiveMutex> guard(mLogMutex);
     auto p = mPartitionLogLevels.find(partition);
     if (p != mPartitionLogLevels.end())
     {
@@ -384,7 +446,7 @@ Logging::logTrace(std::string const& partition)
 bool
 Logging::isLogLevelAtLeast(std::string const& partition, LogLevel level)
 {
-    std::lock_guard<std::recursive_mutex> guard(mLogMutex);
+    std::lock_guard<ProfiledRecursiveMutex> guard(mLogMutex);
     auto it = mPartitionLogLevels.find(partition);
     if (it != mPartitionLogLevels.end())
     {
@@ -396,7 +458,7 @@ Logging::isLogLevelAtLeast(std::string const& partition, LogLevel level)
 void
 Logging::rotate()
 {
-    std::lock_guard<std::recursive_mutex> guard(mLogMutex);
+    std::lock_guard<ProfiledRecursiveMutex> guard(mLogMutex);
     deinit();
     init(/*truncate=*/true);
 }
@@ -415,14 +477,14 @@ Logging::normalizePartition(std::string const& partition)
     throw std::invalid_argument("not a valid partition");
 }
 
-std::recursive_mutex Logging::mLogMutex;
+ProfiledRecursiveMutex Logging::mLogMutex{"Logging::mLogMutex"};
 
 #if defined(USE_SPDLOG)
 #define LOG_PARTITION(name) \
     LogPtr Logging::name##LogPtr = nullptr; \
     LogPtr Logging::get##name##LogPtr() \
     { \
-        std::lock_guard<std::recursive_mutex> guard(mLogMutex); \
+        std::lock_guard<ProfiledRecursiveMutex> guard(mLogMutex); \
         if (!name##LogPtr) \
         { \
             name##LogPtr = spdlog::get(#name); \
@@ -4,6 +4,7 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
+#include "util/ContentionProfiler.h"
 #include "xdrpp/types.h"
 #include <array>
 #include <filesystem>
@@ -77,6 +78,10 @@
 
 #define GET_LOG(name) spdlog::get(name)
 #define DEFAULT_LOG spdlog::default_logger()
+namespace spdlog::details
+{
+class thread_pool;
+}
 namespace stellar
 {
 typedef std::shared_ptr<spdlog::logger> LogPtr;
@@ -161,13 +166,18 @@ class Logging
 {
     static LogLevel mGlobalLogLevel;
     static std::map<std::string, LogLevel> mPartitionLogLevels;
-    static std::recursive_mutex mLogMutex;
+    static ProfiledRecursiveMutex mLogMutex;
     static bool mInitialized;
 #if defined(USE_SPDLOG)
     static bool mColor;
     static std::string mLastPattern;
     static std::string mLastFilenamePattern;
     static bool mLogToConsole;
+    static size_t mAsyncQueueSize;
+    static bool mAsyncDropOldest;
+    static std::shared_ptr<spdlog::details::thread_pool> mThreadPool;
+    // Messages dropped by thread pools that were since replaced
+    static uint64_t mDroppedMessages;
 #define LOG_PARTITION(name) static LogPtr name##LogPtr;
 #include "util/LogPartitions.def"
 #undef LOG_PARTITION
@@ -180,6 +190,13 @@ class Logging
     static void setLoggingToFile(std::string const& filename);
     static void setLoggingToConsole(bool console);
     static void setLoggingColor(bool color);
+    // When logging to a file, hands messages to a background thread through
+    // a queue of queueSize messages instead of writing them on the logging
+    // thread, 0 meaning synchronous logging. A full queue blocks the logging
+    // thread, or if dropOldest, overwrites the oldest queued message.
+    static void setAsyncLogging(size_t queueSize, bool dropOldest);
+    // Total messages overwritten in a full async logging queue
+    static uint64_t getDroppedMessages();
     static void setLogLevel(LogLevel level, const char* partition);
     static LogLevel getLLfromString(std::string const& levelName);
     static LogLevel getLogLevel(std::string const& partition);
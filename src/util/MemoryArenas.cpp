@@ -0,0 +1,179 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/MemoryArenas.h"
+#include "util/GlobalChecks.h"
+#include "util/Logging.h"
+#include <medida/counter.h>
+#include <medida/metrics_registry.h>
+#include <string>
+
+#ifdef USE_JEMALLOC
+#include <array>
+#include <jemalloc/jemalloc.h>
+#include <mutex>
+#endif
+
+namespace stellar
+{
+
+namespace
+{
+constexpr size_t NUM_ARENAS = static_cast<size_t>(MemoryArena::NUM_ARENAS);
+
+#ifdef USE_JEMALLOC
+// jemalloc arena index of each MemoryArena, or 0 -- the default arena -- if
+// it couldn't be created
+struct Arenas
+{
+    std::array<unsigned, NUM_ARENAS> mIndex{};
+    // MIB of "thread.arena", saving a name lookup on every scope
+    size_t mThreadArenaMib[2];
+    size_t mThreadArenaMibLen{2};
+    bool mHaveThreadArenaMib{false};
+
+    Arenas()
+    {
+        mHaveThreadArenaMib = mallctlnametomib("thread.arena", mThreadArenaMib,
+                                               &mThreadArenaMibLen) == 0;
+        for (size_t i = 0; i < NUM_ARENAS; ++i)
+        {
+            unsigned index = 0;
+            size_t len = sizeof(index);
+            if (mallctl("arenas.create", &index, &len, nullptr, 0) == 0)
+            {
+                mIndex[i] = index;
+            }
+            else
+            {
+                LOG_WARNING(DEFAULT_LOG, "Unable to create {} memory arena",
+                            memoryArenaName(static_cast<MemoryArena>(i)));
+            }
+        }
+    }
+
+    static Arenas&
+    get()
+    {
+        static Arenas arenas;
+        return arenas;
+    }
+};
+
+uint64_t
+readArenaStat(unsigned index, char const* stat)
+{
+    auto name = "stats.arenas." + std::to_string(index) + "." + stat;
+    size_t value = 0;
+    size_t len = sizeof(value);
+    if (mallctl(name.c_str(), &value, &len, nullptr, 0) != 0)
+    {
+        return 0;
+    }
+    return value;
+}
+#endif
+}
+
+char const*
+memoryArenaName(MemoryArena arena)
+{
+    switch (arena)
+    {
+    case MemoryArena::LEDGER_CLOSE:
+        return "ledger-close";
+    case MemoryArena::PEER_DECODE:
+        return "peer-decode";
+    case MemoryArena::FLOOD:
+        return "flood";
+    case MemoryArena::BUCKET_MERGE:
+        return "bucket-merge";
+    default:
+        releaseAssert(false);
+    }
+}
+
+#ifdef USE_JEMALLOC
+
+MemoryArenaScope::MemoryArenaScope(MemoryArena arena)
+{
+    auto& arenas = Arenas::get();
+    unsigned index = arenas.mIndex[static_cast<size_t>(arena)];
+    if (index == 0 || !arenas.mHaveThreadArenaMib)
+    {
+        return;
+    }
+    size_t len = sizeof(mPrevious);
+    mActive = mallctlbymib(arenas.mThreadArenaMib, arenas.mThreadArenaMibLen,
+                           &mPrevious, &len, &index, sizeof(index)) == 0;
+}
+
+MemoryArenaScope::~MemoryArenaScope()
+{
+    if (mActive)
+    {
+        auto& arenas = Arenas::get();
+        mallctlbymib(arenas.mThreadArenaMib, arenas.mThreadArenaMibLen,
+                     nullptr, nullptr, &mPrevious, sizeof(mPrevious));
+    }
+}
+
+std::optional<MemoryArenaStats>
+getMemoryArenaStats(MemoryArena arena)
+{
+    unsigned index = Arenas::get().mIndex[static_cast<size_t>(arena)];
+    if (index == 0)
+    {
+        return std::nullopt;
+    }
+
+    // Stats are a snapshot, refreshed by advancing the epoch
+    uint64_t epoch = 1;
+    size_t len = sizeof(epoch);
+    mallctl("epoch", &epoch, &len, &epoch, len);
+
+    MemoryArenaStats stats;
+    stats.mAllocated = readArenaStat(index, "small.allocated") +
+                       readArenaStat(index, "large.allocated");
+    stats.mResident = readArenaStat(index, "resident");
+    return stats;
+}
+
+#else
+
+MemoryArenaScope::MemoryArenaScope(MemoryArena)
+{
+}
+
+MemoryArenaScope::~MemoryArenaScope()
+{
+}
+
+std::optional<MemoryArenaStats>
+getMemoryArenaStats(MemoryArena)
+{
+    return std::nullopt;
+}
+
+#endif
+
+void
+updateMemoryArenaMetrics(medida::MetricsRegistry& registry)
+{
+    for (size_t i = 0; i < NUM_ARENAS; ++i)
+    {
+        auto arena = static_cast<MemoryArena>(i);
+        auto stats = getMemoryArenaStats(arena);
+        if (!stats)
+        {
+            continue;
+        }
+        std::string name = memoryArenaName(arena);
+        registry.NewCounter({"process", "memory", name + "-allocated-bytes"})
+            .set_count(stats->mAllocated);
+        registry.NewCounter({"process", "memory", name + "-resident-bytes"})
+            .set_count(stats->mResident);
+    }
+}
+}
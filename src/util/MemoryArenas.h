@@ -0,0 +1,68 @@
+#pragma once
+
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/NonCopyable.h"
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+namespace medida
+{
+class MetricsRegistry;
+}
+
+namespace stellar
+{
+
+// Subsystems that allocate heavily, each with a heap of its own when
+// stellar-core is built with --enable-jemalloc. Keeping such churn apart from
+// the long-lived state of the rest of the process limits how much it
+// fragments the heap, and lets the memory of each be tracked separately.
+enum class MemoryArena
+{
+    // Applying a ledger: LedgerTxn maps, entries and meta
+    LEDGER_CLOSE,
+    // Decoding messages received from peers, tx envelopes among them
+    PEER_DECODE,
+    // Floodgate records of flooded messages
+    FLOOD,
+    // Bucket merge buffers and entries
+    BUCKET_MERGE,
+    NUM_ARENAS
+};
+
+// While in scope, allocations of the current thread come from arena. Memory
+// freed later, on any thread, goes back to the arena it came from. Scopes may
+// nest; without jemalloc they do nothing.
+class MemoryArenaScope : public NonMovableOrCopyable
+{
+#ifdef USE_JEMALLOC
+    unsigned mPrevious;
+    bool mActive{false};
+#endif
+
+  public:
+    explicit MemoryArenaScope(MemoryArena arena);
+    ~MemoryArenaScope();
+};
+
+struct MemoryArenaStats
+{
+    // Bytes in allocations the arena handed out and that are still live
+    uint64_t mAllocated{0};
+    // Bytes of the pages the arena maps in, including their fragmentation
+    uint64_t mResident{0};
+};
+
+// Current stats of arena, or nullopt without jemalloc
+std::optional<MemoryArenaStats> getMemoryArenaStats(MemoryArena arena);
+
+char const* memoryArenaName(MemoryArena arena);
+
+// Sets the process.memory.<arena>-allocated-bytes and -resident-bytes
+// counters from the current stats of each arena
+void updateMemoryArenaMetrics(medida::MetricsRegistry& registry);
+}
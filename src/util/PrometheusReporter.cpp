@@ -0,0 +1,138 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/PrometheusReporter.h"
+
+#include "medida/buckets.h"
+#include "medida/counter.h"
+#include "medida/histogram.h"
+#include "medida/meter.h"
+#include "medida/stats/snapshot.h"
+#include "medida/timer.h"
+
+#include <cctype>
+#include <cmath>
+#include <fmt/format.h>
+#include <limits>
+
+namespace stellar
+{
+
+namespace
+{
+double const QUANTILES[] = {0.5, 0.75, 0.95, 0.99};
+
+double
+toSeconds(std::chrono::nanoseconds unit)
+{
+    return static_cast<double>(unit.count()) / 1e9;
+}
+
+void
+writeSummary(std::ostringstream& out, std::string const& name,
+             medida::stats::Snapshot const& snapshot, uint64_t count,
+             double mean, double scale)
+{
+    out << "# TYPE " << name << " summary\n";
+    for (auto q : QUANTILES)
+    {
+        out << fmt::format("{}{{quantile=\"{}\"}} {}\n", name, q,
+                           snapshot.getValue(q) * scale);
+    }
+    out << fmt::format("{}_sum {}\n", name, mean * count * scale);
+    out << fmt::format("{}_count {}\n", name, count);
+}
+}
+
+char const* const PrometheusReporter::CONTENT_TYPE =
+    "text/plain; version=0.0.4; charset=utf-8";
+
+std::string
+PrometheusReporter::metricName(medida::MetricName const& name)
+{
+    auto res = fmt::format("stellar_core_{}_{}_{}", name.domain(), name.type(),
+                           name.name());
+    for (auto& c : res)
+    {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_')
+        {
+            c = '_';
+        }
+    }
+    return res;
+}
+
+std::string
+PrometheusReporter::report(medida::MetricsRegistry& registry)
+{
+    mOut.str("");
+    mNames.clear();
+    for (auto const& kv : registry.GetAllMetrics())
+    {
+        mName = metricName(kv.first);
+        // Names that only differ in characters replaced by '_' would make
+        // the whole exposition invalid, so keep the first of them
+        if (mNames.insert(mName).second)
+        {
+            kv.second->Process(*this);
+        }
+    }
+    return mOut.str();
+}
+
+void
+PrometheusReporter::Process(medida::Counter& counter)
+{
+    mOut << "# TYPE " << mName << " gauge\n";
+    mOut << fmt::format("{} {}\n", mName, counter.count());
+}
+
+void
+PrometheusReporter::Process(medida::Meter& meter)
+{
+    auto name = mName + "_total";
+    mOut << "# TYPE " << name << " counter\n";
+    mOut << fmt::format("{} {}\n", name, meter.count());
+}
+
+void
+PrometheusReporter::Process(medida::Histogram& histogram)
+{
+    writeSummary(mOut, mName, histogram.GetSnapshot(), histogram.count(),
+                 histogram.mean(), 1.0);
+}
+
+void
+PrometheusReporter::Process(medida::Timer& timer)
+{
+    writeSummary(mOut, mName + "_seconds", timer.GetSnapshot(), timer.count(),
+                 timer.mean(), toSeconds(timer.duration_unit()));
+}
+
+void
+PrometheusReporter::Process(medida::Buckets& buckets)
+{
+    auto name = mName + "_seconds";
+    auto scale = toSeconds(buckets.boundary_unit());
+    mOut << "# TYPE " << name << " histogram\n";
+    uint64_t cumulative = 0;
+    double sum = 0;
+    for (auto const& [boundary, timer] : buckets.getBuckets())
+    {
+        cumulative += timer->count();
+        sum += timer->mean() * timer->count() *
+               toSeconds(timer->duration_unit());
+        // The catch-all bucket is the +Inf one written below
+        if (!std::isinf(boundary) &&
+            boundary != std::numeric_limits<double>::max())
+        {
+            mOut << fmt::format("{}_bucket{{le=\"{}\"}} {}\n", name,
+                                boundary * scale, cumulative);
+        }
+    }
+    mOut << fmt::format("{}_bucket{{le=\"+Inf\"}} {}\n", name, cumulative);
+    mOut << fmt::format("{}_sum {}\n", name, sum);
+    mOut << fmt::format("{}_count {}\n", name, cumulative);
+}
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "medida/metrics_registry.h"
+
+#include <set>
+#include <sstream>
+#include <string>
+
+namespace stellar
+{
+
+// Writes metrics in the Prometheus text exposition format (version 0.0.4).
+// Each metric is named stellar_core_<domain>_<type>_<name>, with characters
+// Prometheus does not allow replaced by '_':
+//   - counters, which medida lets go down, are gauges
+//   - meters are counters of their events, Prometheus computing rates itself
+//   - timers and histograms are summaries of the quantiles of their sample
+//     window, timers in seconds
+//   - buckets are histograms with their boundaries as buckets, in seconds
+//
+// Reading medida metrics is thread-safe, so this can run off the main thread.
+class PrometheusReporter : public medida::MetricProcessor
+{
+    std::ostringstream mOut;
+    std::set<std::string> mNames;
+    std::string mName;
+
+  public:
+    static char const* const CONTENT_TYPE;
+
+    PrometheusReporter() = default;
+    ~PrometheusReporter() override = default;
+
+    std::string report(medida::MetricsRegistry& registry);
+
+    void Process(medida::Counter& counter) override;
+    void Process(medida::Meter& meter) override;
+    void Process(medida::Histogram& histogram) override;
+    void Process(medida::Timer& timer) override;
+    void Process(medida::Buckets& buckets) override;
+
+    // Name of the metric for `name`, without the suffix of its type
+    static std::string metricName(medida::MetricName const& name);
+};
+}
@@ -36,17 +36,32 @@ enum class ProtocolVersion : uint32_t
     V_21
 };
 
+// These are defined here rather than out of line since they are called all
+// over the transaction apply paths: inlined, each check is a single compare,
+// and folds away entirely where the version is known at compile time.
+
 // Checks whether provided protocolVersion is before (i.e. strictly lower than)
 // beforeVersion.
-bool protocolVersionIsBefore(uint32_t protocolVersion,
-                             ProtocolVersion beforeVersion);
+constexpr bool
+protocolVersionIsBefore(uint32_t protocolVersion, ProtocolVersion beforeVersion)
+{
+    return protocolVersion < static_cast<uint32_t>(beforeVersion);
+}
+
 // Checks whether provided protocolVersion starts from (i.e. is greater than or
 // equal to) fromVersion.
-bool protocolVersionStartsFrom(uint32_t protocolVersion,
-                               ProtocolVersion fromVersion);
+constexpr bool
+protocolVersionStartsFrom(uint32_t protocolVersion, ProtocolVersion fromVersion)
+{
+    return protocolVersion >= static_cast<uint32_t>(fromVersion);
+}
+
 // Checks whether provided protocolVersion is exactly equalsVersion.
-bool protocolVersionEquals(uint32_t protocolVersion,
-                           ProtocolVersion equalsVersion);
+constexpr bool
+protocolVersionEquals(uint32_t protocolVersion, ProtocolVersion equalsVersion)
+{
+    return protocolVersion == static_cast<uint32_t>(equalsVersion);
+}
 
 constexpr ProtocolVersion SOROBAN_PROTOCOL_VERSION = ProtocolVersion::V_20;
 }
@@ -28,6 +28,7 @@ class RandomEvictionCache : public NonMovableOrCopyable
         uint64_t mInserts{0};
         uint64_t mUpdates{0};
         uint64_t mEvicts{0};
+        uint64_t mRejects{0};
     };
 
   private:
@@ -61,15 +62,12 @@ class RandomEvictionCache : public NonMovableOrCopyable
     bool const mSeparatePRNG{false};
     stellar_default_random_engine mRandEngine;
 
-    // Randomly pick two elements and evict the less-recently-used one.
-    void
-    evictOne()
+    // Randomly pick two elements and return the less-recently-used one. The
+    // cache must not be empty.
+    MapValueType*&
+    pickVictim()
     {
         size_t sz = mValuePtrs.size();
-        if (sz == 0)
-        {
-            return;
-        }
         auto getRandIndex = [&]() {
             if (mSeparatePRNG)
             {
@@ -79,14 +77,30 @@ class RandomEvictionCache : public NonMovableOrCopyable
         };
         MapValueType*& vp1 = mValuePtrs.at(getRandIndex());
         MapValueType*& vp2 = mValuePtrs.at(getRandIndex());
-        MapValueType*& victim =
-            (vp1->second.mLastAccess < vp2->second.mLastAccess ? vp1 : vp2);
+        return (vp1->second.mLastAccess < vp2->second.mLastAccess ? vp1
+                                                                   : vp2);
+    }
+
+    void
+    evict(MapValueType*& victim)
+    {
         mValueMap.erase(victim->first);
         std::swap(victim, mValuePtrs.back());
         mValuePtrs.pop_back();
         ++mCounters.mEvicts;
     }
 
+    // Randomly pick two elements and evict the less-recently-used one.
+    void
+    evictOne()
+    {
+        if (mValuePtrs.empty())
+        {
+            return;
+        }
+        evict(pickVictim());
+    }
+
   public:
     explicit RandomEvictionCache(size_t maxSize)
         : mMaxSize(maxSize), mSeparatePRNG(false)
@@ -162,6 +176,29 @@ class RandomEvictionCache : public NonMovableOrCopyable
         }
     }
 
+    // Like `put`, but if inserting k would require an eviction, calls
+    // admit(victimKey) with the key that would be evicted, and leaves the
+    // cache unchanged if it returns false. Returns whether k is now cached.
+    // Same exception safety as `put`.
+    template <typename Admit>
+    bool
+    putIfAdmitted(K const& k, V const& v, Admit&& admit)
+    {
+        if (!mValuePtrs.empty() && mValuePtrs.size() >= mMaxSize &&
+            mValueMap.find(k) == mValueMap.end())
+        {
+            MapValueType*& victim = pickVictim();
+            if (!admit(static_cast<K const&>(victim->first)))
+            {
+                ++mCounters.mRejects;
+                return false;
+            }
+            evict(victim);
+        }
+        put(k, v);
+        return true;
+    }
+
     // `exists` offers strong exception safety guarantee.
     bool
     exists(K const& k, bool countMisses = true)
@@ -210,6 +247,26 @@ class RandomEvictionCache : public NonMovableOrCopyable
         }
     }
 
+    // Calls `f` on every value, without touching or counting anything.
+    void
+    for_each(std::function<void(V const&)> const& f) const
+    {
+        for (auto const* vp : mValuePtrs)
+        {
+            f(vp->second.mValue);
+        }
+    }
+
+    // Calls `f` on every key, without touching or counting anything.
+    void
+    for_each_key(std::function<void(K const&)> const& f) const
+    {
+        for (auto const* vp : mValuePtrs)
+        {
+            f(vp->first);
+        }
+    }
+
     // `maybeGet` offers basic exception safety guarantee.
     // Returns a pointer to the value if the key exists,
     // and returns a nullptr otherwise.
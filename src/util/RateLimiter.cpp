@@ -0,0 +1,38 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/RateLimiter.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace stellar
+{
+
+RateLimiter::RateLimiter(uint64_t perSecond)
+    : mPerSecond(perSecond), mNext(std::chrono::steady_clock::now())
+{
+}
+
+void
+RateLimiter::acquire(uint64_t n)
+{
+    if (mPerSecond == 0)
+    {
+        return;
+    }
+
+    std::chrono::steady_clock::time_point start;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        // Don't bank unused time, or an idle limiter would let a burst through
+        start = std::max(mNext, std::chrono::steady_clock::now());
+        mNext = start + std::chrono::duration_cast<
+                            std::chrono::steady_clock::duration>(
+                            std::chrono::duration<double>(
+                                static_cast<double>(n) / mPerSecond));
+    }
+    std::this_thread::sleep_until(start);
+}
+}
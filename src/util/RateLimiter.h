@@ -0,0 +1,33 @@
+#pragma once
+
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/NonCopyable.h"
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+namespace stellar
+{
+
+// Paces a quantity, such as bytes read, shared by any number of threads to at
+// most a given rate in real time. Threads that get ahead of the rate sleep in
+// acquire(), so this is only meant for background threads doing bulk work.
+class RateLimiter : private NonMovableOrCopyable
+{
+    uint64_t const mPerSecond;
+    std::mutex mMutex;
+    // When everything acquired so far will have been paid for
+    std::chrono::steady_clock::time_point mNext;
+
+  public:
+    // A rate of 0 does not limit anything
+    explicit RateLimiter(uint64_t perSecond);
+
+    // Blocks until n more units fit within the rate
+    void acquire(uint64_t n);
+};
+}
@@ -6,6 +6,7 @@
 #include "lib/util/finally.h"
 #include "util/GlobalChecks.h"
 #include "util/Timer.h"
+#include "medida/timer.h"
 #include <Tracy.hpp>
 
 namespace stellar
@@ -27,6 +28,7 @@ class Scheduler::ActionQueue
 
     std::string mName;
     ActionType mType;
+    QueuePolicy mPolicy;
     nsecs mTotalService{0};
     std::chrono::steady_clock::time_point mLastService;
     std::deque<Element> mActions;
@@ -85,6 +87,25 @@ class Scheduler::ActionQueue
         return mType;
     }
 
+    ActionTier
+    tier() const
+    {
+        return mPolicy.mTier;
+    }
+
+    // Only while not in the runnable queue, since that's ordered by tier
+    void
+    setPolicy(QueuePolicy const& policy)
+    {
+        mPolicy = policy;
+    }
+
+    void
+    clearDelayTimer()
+    {
+        mPolicy.mDelayTimer = nullptr;
+    }
+
     nsecs
     totalService() const
     {
@@ -114,8 +135,11 @@ class Scheduler::ActionQueue
     {
         if (!mActions.empty())
         {
+            auto deadline = mPolicy.mDeadline.count() > 0
+                                ? std::min(mPolicy.mDeadline, latencyWindow)
+                                : latencyWindow;
             auto timeInQueue = now - mActions.front().mEnqueueTime;
-            return timeInQueue > latencyWindow;
+            return timeInQueue > deadline;
         }
         return false;
     }
@@ -146,6 +170,10 @@ class Scheduler::ActionQueue
         ZoneScoped;
         ZoneText(mName.c_str(), mName.size());
         auto before = clock.now();
+        if (mPolicy.mDelayTimer)
+        {
+            mPolicy.mDelayTimer->Update(before - mActions.front().mEnqueueTime);
+        }
         Action action = std::move(mActions.front().mAction);
         mActions.pop_front();
 
@@ -163,6 +191,10 @@ class Scheduler::ActionQueue
 Scheduler::Scheduler(VirtualClock& clock,
                      std::chrono::nanoseconds latencyWindow)
     : mRunnableActionQueues([](Qptr a, Qptr b) -> bool {
+        if (a->tier() != b->tier())
+        {
+            return a->tier() > b->tier();
+        }
         return a->totalService() > b->totalService();
     })
     , mClock(clock)
@@ -179,6 +211,44 @@ Scheduler::trimSingleActionQueue(Qptr q, VirtualClock::time_point now)
     mSize -= trimmed;
 }
 
+void
+Scheduler::trimLowerTierActionQueues(ActionTier tier,
+                                     VirtualClock::time_point now)
+{
+    for (auto const& qp : mAllActionQueues)
+    {
+        if (qp.second->type() == ActionType::DROPPABLE_ACTION &&
+            qp.second->tier() > tier)
+        {
+            trimSingleActionQueue(qp.second, now);
+        }
+    }
+}
+
+Scheduler::QueuePolicy
+Scheduler::getPolicy(std::string const& name) const
+{
+    auto it = mQueuePolicies.find(name);
+    return it == mQueuePolicies.end() ? QueuePolicy{} : it->second;
+}
+
+void
+Scheduler::setQueuePolicy(std::string const& name, QueuePolicy const& policy)
+{
+    mQueuePolicies[name] = policy;
+}
+
+void
+Scheduler::clearQueuePolicies()
+{
+    mQueuePolicies.clear();
+    // Timers may go away with whoever set them
+    for (auto const& qp : mAllActionQueues)
+    {
+        qp.second->clearDelayTimer();
+    }
+}
+
 void
 Scheduler::trimIdleActionQueues(VirtualClock::time_point now)
 {
@@ -236,6 +306,7 @@ Scheduler::enqueue(std::string&& name, Action&& action, ActionType type)
     {
         mStats.mQueuesActivatedFromFresh++;
         auto q = std::make_shared<ActionQueue>(name, type, mIdleActionQueues);
+        q->setPolicy(getPolicy(name));
         qi = mAllActionQueues.emplace(key, q).first;
         mRunnableActionQueues.push(qi->second);
     }
@@ -246,6 +317,7 @@ Scheduler::enqueue(std::string&& name, Action&& action, ActionType type)
             releaseAssert(qi->second->isEmpty());
             mStats.mQueuesActivatedFromIdle++;
             qi->second->removeFromIdleList();
+            qi->second->setPolicy(getPolicy(name));
             mRunnableActionQueues.push(qi->second);
         }
     }
@@ -269,10 +341,26 @@ Scheduler::runOne()
         auto q = mRunnableActionQueues.top();
         mRunnableActionQueues.pop();
         trimSingleActionQueue(q, start);
+        if (mOverloadedStart < std::chrono::steady_clock::time_point::max())
+        {
+            trimLowerTierActionQueues(q->tier(), start);
+        }
 
         auto putQueueBackInIdleOrActive = gsl::finally([&]() {
             auto now = mClock.now();
-            if (q->isOverloaded(mLatencyWindow, now))
+            auto isOverloaded = [&](auto const& qp) {
+                return qp.second->isOverloaded(mLatencyWindow, now);
+            };
+            // Queues of lower tiers may be starved rather than run, so they
+            // are looked at too
+            if (q->isOverloaded(mLatencyWindow, now) ||
+                (mOverloadedStart ==
+                     std::chrono::steady_clock::time_point::max() &&
+                 std::any_of(mAllActionQueues.begin(), mAllActionQueues.end(),
+                             [&](auto const& qp) {
+                                 return qp.second->tier() > q->tier() &&
+                                        isOverloaded(qp);
+                             })))
             {
                 if (mOverloadedStart ==
                     std::chrono::steady_clock::time_point::max())
@@ -284,12 +372,9 @@ Scheduler::runOne()
                      std::chrono::steady_clock::time_point::max())
             {
                 // see if we're not overloaded anymore
-                bool overloaded = std::any_of(
-                    mAllActionQueues.begin(), mAllActionQueues.end(),
-                    [&](std::pair<std::pair<std::string, ActionType>,
-                                  Qptr> const& qp) {
-                        return qp.second->isOverloaded(mLatencyWindow, now);
-                    });
+                bool overloaded =
+                    std::any_of(mAllActionQueues.begin(),
+                                mAllActionQueues.end(), isOverloaded);
                 if (!overloaded)
                 {
                     setOverloaded(false);
@@ -99,6 +99,22 @@
 //
 //   - We record the enqueue time and "droppability" of an action, to allow us
 //     to measure load level and perform load shedding.
+//
+//   - Queues can be given a policy by name, placing them in a tier. A queue
+//     only runs when no queue of a more important tier is runnable, and the
+//     algorithm above runs among the queues of a tier. This relaxes
+//     non-starvation across tiers, so only queues whose load is bounded by
+//     the protocol (such as consensus messages) belong in the upper ones.
+//
+//   - A policy can also give a queue a deadline shorter than the latency
+//     window, past which its actions count as overloaded. While overloaded, we
+//     also shed overdue droppable actions from the queues of the tiers below
+//     the queue that runs next, since those may not run for a while.
+
+namespace medida
+{
+class Timer;
+}
 
 namespace stellar
 {
@@ -115,6 +131,26 @@ class Scheduler
         DROPPABLE_ACTION
     };
 
+    // Most important first
+    enum class ActionTier
+    {
+        CONSENSUS,
+        LEDGER_CLOSE,
+        TX_ADMISSION,
+        NORMAL,
+        BACKGROUND
+    };
+
+    struct QueuePolicy
+    {
+        ActionTier mTier{ActionTier::NORMAL};
+        // How long an action may wait before the queue is overloaded and, if
+        // droppable, the action is shed; 0 means the latency window
+        std::chrono::nanoseconds mDeadline{0};
+        // If set, records how long each action of the queue waited to run
+        medida::Timer* mDelayTimer{nullptr};
+    };
+
     struct Stats
     {
         size_t mActionsEnqueued{0};
@@ -132,10 +168,13 @@ class Scheduler
     // Stores all ActionQueues by name+type, either runnable or idle.
     std::map<std::pair<std::string, ActionType>, Qptr> mAllActionQueues;
 
-    // Stores the Runnable ActionQueues, with top() being the ActionQueue with
-    // the least total service time. An ActionQueue is "runnable" if it is
-    // nonempty; empty ActionQueues are considered "idle" and are tracked
-    // in the mIdleActionQueues member below.
+    // Policies by queue name, for queues of either type
+    std::map<std::string, QueuePolicy> mQueuePolicies;
+
+    // Stores the Runnable ActionQueues, with top() being the ActionQueue of
+    // the most important tier with the least total service time. An
+    // ActionQueue is "runnable" if it is nonempty; empty ActionQueues are
+    // considered "idle" and are tracked in the mIdleActionQueues member below.
     std::priority_queue<Qptr, std::vector<Qptr>,
                         std::function<bool(Qptr, Qptr)>>
         mRunnableActionQueues;
@@ -188,6 +227,9 @@ class Scheduler
     void trimSingleActionQueue(Qptr q,
                                std::chrono::steady_clock::time_point now);
     void trimIdleActionQueues(std::chrono::steady_clock::time_point now);
+    void trimLowerTierActionQueues(ActionTier tier,
+                                   std::chrono::steady_clock::time_point now);
+    QueuePolicy getPolicy(std::string const& name) const;
 
     // List of ActionQueues that are currently idle. Idle ActionQueues maintain
     // a list<Qptr>::iterator pointing to their own position in this list, which
@@ -213,6 +255,11 @@ class Scheduler
     // Adds an action to the named ActionQueue with a given type.
     void enqueue(std::string&& name, Action&& action, ActionType type);
 
+    // Sets the policy of the queues with a given name. It applies to a queue
+    // the next time it becomes runnable after being idle or forgotten.
+    void setQueuePolicy(std::string const& name, QueuePolicy const& policy);
+    void clearQueuePolicies();
+
     // Runs 0 or 1 action from the next ActionQueue in the queue-of-queues.
     size_t runOne();
 
@@ -4,19 +4,175 @@
 
 #include "util/Thread.h"
 #include "util/Logging.h"
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
 
 #ifdef _WIN32
 #include <Windows.h>
 #else
 #include <unistd.h>
 #endif
-#if defined(__APPLE__)
+#if defined(__APPLE__) || defined(__linux__)
 #include <pthread.h>
 #endif
+#if defined(__linux__)
+#include <sched.h>
+#endif
 
 namespace stellar
 {
 
+std::vector<int>
+parseCpuList(std::string const& list)
+{
+    std::vector<int> cpus;
+    auto readCpu = [&](std::string const& s) {
+        if (s.empty() ||
+            !std::all_of(s.begin(), s.end(), [](char c) {
+                return c >= '0' && c <= '9';
+            }) ||
+            s.size() > 6)
+        {
+            throw std::invalid_argument("invalid CPU list: " + list);
+        }
+        return std::stoi(s);
+    };
+
+    size_t start = 0;
+    while (start < list.size())
+    {
+        auto end = list.find(',', start);
+        if (end == std::string::npos)
+        {
+            end = list.size();
+        }
+        auto range = list.substr(start, end - start);
+        auto dash = range.find('-');
+        int first = readCpu(range.substr(0, dash));
+        int last = dash == std::string::npos ? first
+                                             : readCpu(range.substr(dash + 1));
+        if (last < first)
+        {
+            throw std::invalid_argument("invalid CPU list: " + list);
+        }
+        for (int cpu = first; cpu <= last; ++cpu)
+        {
+            cpus.emplace_back(cpu);
+        }
+        start = end + 1;
+        if (end + 1 == list.size())
+        {
+            throw std::invalid_argument("invalid CPU list: " + list);
+        }
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+std::set<int>
+numaNodesOfCpus(std::vector<int> const& cpus)
+{
+    std::set<int> nodes;
+#if defined(__linux__)
+    // Each CPU's sysfs directory links to the node it belongs to
+    for (auto cpu : cpus)
+    {
+        std::error_code ec;
+        std::filesystem::directory_iterator it(
+            "/sys/devices/system/cpu/cpu" + std::to_string(cpu), ec);
+        for (; !ec && it != std::filesystem::directory_iterator();
+             it.increment(ec))
+        {
+            auto name = it->path().filename().string();
+            if (name.size() > 4 && name.compare(0, 4, "node") == 0 &&
+                std::all_of(name.begin() + 4, name.end(),
+                            [](char c) { return c >= '0' && c <= '9'; }))
+            {
+                nodes.emplace(std::stoi(name.substr(4)));
+            }
+        }
+    }
+#endif
+    return nodes;
+}
+
+#if defined(_WIN32)
+
+bool
+pinCurrentThreadToCpus(std::vector<int> const& cpus)
+{
+    if (cpus.empty())
+    {
+        return true;
+    }
+    // Without processor groups a thread can only be pinned within the first
+    // 64 CPUs
+    DWORD_PTR mask = 0;
+    for (auto cpu : cpus)
+    {
+        if (cpu >= static_cast<int>(sizeof(mask) * 8))
+        {
+            LOG_WARNING(DEFAULT_LOG, "Unable to pin thread to CPU {}", cpu);
+            return false;
+        }
+        mask |= DWORD_PTR(1) << cpu;
+    }
+    if (::SetThreadAffinityMask(::GetCurrentThread(), mask) == 0)
+    {
+        LOG_WARNING(DEFAULT_LOG, "Unable to set thread affinity: {}",
+                    ::GetLastError());
+        return false;
+    }
+    return true;
+}
+
+#elif defined(__linux__)
+
+bool
+pinCurrentThreadToCpus(std::vector<int> const& cpus)
+{
+    if (cpus.empty())
+    {
+        return true;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (auto cpu : cpus)
+    {
+        if (cpu >= CPU_SETSIZE)
+        {
+            LOG_WARNING(DEFAULT_LOG, "Unable to pin thread to CPU {}", cpu);
+            return false;
+        }
+        CPU_SET(cpu, &set);
+    }
+    int ret = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (ret != 0)
+    {
+        LOG_WARNING(DEFAULT_LOG, "Unable to set thread affinity: {}", ret);
+        return false;
+    }
+    return true;
+}
+
+#else
+
+bool
+pinCurrentThreadToCpus(std::vector<int> const& cpus)
+{
+    if (cpus.empty())
+    {
+        return true;
+    }
+    LOG_WARNING(DEFAULT_LOG,
+                "Thread affinity is not supported on this platform");
+    return false;
+}
+
+#endif
+
 #if defined(_WIN32)
 
 static void
@@ -6,7 +6,10 @@
 
 #include <chrono>
 #include <future>
+#include <set>
+#include <string>
 #include <thread>
+#include <vector>
 
 namespace stellar
 {
@@ -14,6 +17,20 @@ namespace stellar
 void runCurrentThreadWithLowPriority();
 void runCurrentThreadWithMediumPriority();
 
+// Parses a CPU list in the format of Linux's cpusets and taskset -c, such as
+// "0-3,8,10-11", into sorted, distinct CPU numbers. An empty list gives no
+// CPUs; a malformed one throws std::invalid_argument.
+std::vector<int> parseCpuList(std::string const& list);
+
+// Restricts the current thread to run on cpus. Returns false, logging why, if
+// that isn't supported on this platform or the OS refused; empty cpus leave
+// the thread as it is. Memory the thread touches first is then allocated on
+// the NUMA nodes of those CPUs under the default Linux policy.
+bool pinCurrentThreadToCpus(std::vector<int> const& cpus);
+
+// NUMA nodes the given CPUs belong to, as far as the OS reports them
+std::set<int> numaNodesOfCpus(std::vector<int> const& cpus);
+
 template <typename T>
 bool
 futureIsReady(std::future<T> const& fut)
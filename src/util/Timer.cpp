@@ -8,6 +8,7 @@
 #include "util/Logging.h"
 #include "util/Scheduler.h"
 #include <Tracy.hpp>
+#include <algorithm>
 #include <chrono>
 #include <cstdio>
 #include <thread>
@@ -21,10 +22,29 @@ static const std::chrono::milliseconds CRANK_TIME_SLICE(500);
 static const size_t CRANK_EVENT_SLICE = 100;
 const std::chrono::seconds SCHEDULER_LATENCY_WINDOW(5);
 
+// Takes references to events just removed from a TimerWheel, with their
+// generations, before any of their callbacks can drop them
+static vector<pair<shared_ptr<VirtualClockEvent>, uint64_t>>
+toEvents(vector<TimerWheel::Entry*> const& entries)
+{
+    vector<pair<shared_ptr<VirtualClockEvent>, uint64_t>> events;
+    events.reserve(entries.size());
+    for (auto e : entries)
+    {
+        auto ev = static_cast<VirtualClockEvent*>(e)->shared_from_this();
+        auto generation = ev->mGeneration;
+        events.emplace_back(std::move(ev), generation);
+    }
+    return events;
+}
+
 VirtualClock::VirtualClock(Mode mode)
     : mMode(mode)
     , mActionScheduler(
           std::make_unique<Scheduler>(*this, SCHEDULER_LATENCY_WINDOW))
+    , mTimerWheel(mode == REAL_TIME ? std::make_unique<TimerWheel>(
+                                          std::chrono::steady_clock::now())
+                                    : nullptr)
     , mRealTimer(mIOContext)
 {
 }
@@ -92,6 +112,10 @@ VirtualClock::time_point
 VirtualClock::next() const
 {
     releaseAssert(threadIsMain());
+    if (mTimerWheel)
+    {
+        return mTimerWheel->next();
+    }
     VirtualClock::time_point least = time_point::max();
     if (!mEvents.empty())
     {
@@ -197,15 +221,32 @@ VirtualClock::enqueue(shared_ptr<VirtualClockEvent> ve)
         return;
     }
     releaseAssert(threadIsMain());
-    mEvents.emplace(ve);
+    if (mTimerWheel)
+    {
+        mTimerWheel->insert(*ve);
+    }
+    else
+    {
+        mEvents.emplace(ve);
+    }
     maybeSetRealtimer();
 }
 
+void
+VirtualClock::dequeue(VirtualClockEvent& ve)
+{
+    if (mTimerWheel && !mDestructing)
+    {
+        releaseAssert(threadIsMain());
+        mTimerWheel->remove(ve);
+    }
+}
+
 void
 VirtualClock::flushCancelledEvents()
 {
     ZoneScoped;
-    if (mDestructing)
+    if (mDestructing || mTimerWheel)
     {
         return;
     }
@@ -244,6 +285,18 @@ VirtualClock::cancelAllEvents()
     ZoneScoped;
     releaseAssert(threadIsMain());
 
+    if (mTimerWheel)
+    {
+        std::vector<TimerWheel::Entry*> entries;
+        mTimerWheel->removeAll(entries);
+        auto events = toEvents(entries);
+        for (auto const& ev : events)
+        {
+            ev.first->cancel();
+        }
+        return !events.empty();
+    }
+
     bool wasEmpty = mEvents.empty();
     while (!mEvents.empty())
     {
@@ -466,6 +519,19 @@ VirtualClock::postAction(std::function<void()>&& f, std::string&& name,
     }
 }
 
+void
+VirtualClock::setActionQueuePolicy(std::string const& name,
+                                   Scheduler::QueuePolicy const& policy)
+{
+    mActionScheduler->setQueuePolicy(name, policy);
+}
+
+void
+VirtualClock::clearActionQueuePolicies()
+{
+    mActionScheduler->clearQueuePolicies();
+}
+
 size_t
 VirtualClock::getActionQueueSize() const
 {
@@ -512,6 +578,28 @@ VirtualClock::advanceToNow()
     releaseAssert(threadIsMain());
 
     auto n = now();
+    if (mTimerWheel)
+    {
+        std::vector<TimerWheel::Entry*> entries;
+        mTimerWheel->advance(n, entries);
+        // The wheel only orders events to the tick
+        auto events = toEvents(entries);
+        std::sort(events.begin(), events.end(),
+                  [](auto const& a, auto const& b) {
+                      return *b.first < *a.first;
+                  });
+        for (auto const& ev : events)
+        {
+            // Skip events re-armed by an earlier callback
+            if (ev.first->mGeneration == ev.second)
+            {
+                ev.first->trigger();
+            }
+        }
+        maybeSetRealtimer();
+        return events.size();
+    }
+
     vector<shared_ptr<VirtualClockEvent>> toDispatch;
     while (!mEvents.empty())
     {
@@ -557,8 +645,21 @@ VirtualClock::advanceToNext()
 VirtualClockEvent::VirtualClockEvent(
     VirtualClock::time_point when, size_t seq,
     std::function<void(asio::error_code)> callback)
-    : mCallback(callback), mTriggered(false), mWhen(when), mSeq(seq)
+    : mCallback(callback), mTriggered(false), mSeq(seq)
+{
+    mWhen = when;
+}
+
+void
+VirtualClockEvent::reset(VirtualClock::time_point when, size_t seq,
+                         std::function<void(asio::error_code)> callback)
 {
+    releaseAssert(mTriggered && !isScheduled());
+    mCallback = callback;
+    mTriggered = false;
+    mWhen = when;
+    mSeq = seq;
+    ++mGeneration;
 }
 
 bool
@@ -571,9 +672,11 @@ VirtualClockEvent::trigger()
 {
     if (!mTriggered)
     {
+        // Moved out first, since the callback may reset() this event
         mTriggered = true;
-        mCallback(asio::error_code());
+        auto cb = std::move(mCallback);
         mCallback = nullptr;
+        cb(asio::error_code());
     }
 }
 
@@ -583,8 +686,9 @@ VirtualClockEvent::cancel()
     if (!mTriggered)
     {
         mTriggered = true;
-        mCallback(asio::error::operation_aborted);
+        auto cb = std::move(mCallback);
         mCallback = nullptr;
+        cb(asio::error::operation_aborted);
     }
 }
 
@@ -628,9 +732,15 @@ VirtualTimer::cancel()
         mCancelled = true;
         for (auto ev : mEvents)
         {
+            mClock.dequeue(*ev);
             ev->cancel();
         }
         mClock.flushCancelledEvents();
+        if (!mEvents.empty() && mClock.usesTimerWheel() &&
+            !mEvents.back()->isScheduled())
+        {
+            mSpareEvent = std::move(mEvents.back());
+        }
         mEvents.clear();
     }
 }
@@ -676,7 +786,16 @@ VirtualTimer::async_wait(function<void(asio::error_code)> const& fn)
     if (!mCancelled)
     {
         releaseAssert(!mDeleting);
-        auto ve = make_shared<VirtualClockEvent>(mExpiryTime, seq(), fn);
+        std::shared_ptr<VirtualClockEvent> ve;
+        if (mSpareEvent && mEvents.empty())
+        {
+            ve = std::move(mSpareEvent);
+            ve->reset(mExpiryTime, seq(), fn);
+        }
+        else
+        {
+            ve = make_shared<VirtualClockEvent>(mExpiryTime, seq(), fn);
+        }
         mClock.enqueue(ve);
         mEvents.push_back(ve);
     }
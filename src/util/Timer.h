@@ -10,6 +10,7 @@
 #include "util/asio.h"
 #include "util/NonCopyable.h"
 #include "util/Scheduler.h"
+#include "util/TimerWheel.h"
 
 #include <chrono>
 #include <ctime>
@@ -150,7 +151,11 @@ class VirtualClock
     //
     // The third is a priority queue of VirtualClockEvents, which is the part of
     // the VirtualClock that manages the progress of virtual time and the
-    // dispatch of timers as virtual time advances past them.
+    // dispatch of timers as virtual time advances past them. In REAL_TIME
+    // mode, a TimerWheel takes its place: there are many more timers there,
+    // mostly per-peer ones that are re-armed or cancelled long before they
+    // expire, and the wheel drops those immediately, where the heap keeps
+    // cancelled events until they are flushed.
     std::chrono::steady_clock::time_point mLastDispatchStart;
     std::unique_ptr<Scheduler> mActionScheduler;
 
@@ -165,6 +170,8 @@ class VirtualClock
                             VirtualClockEventCompare>;
     PrQueue mEvents;
     size_t mFlushesIgnored = 0;
+    // Set in REAL_TIME mode only, instead of mEvents
+    std::unique_ptr<TimerWheel> mTimerWheel;
 
     bool mDestructing{false};
 
@@ -198,7 +205,15 @@ class VirtualClock
     system_time_point system_now() const noexcept;
 
     void enqueue(std::shared_ptr<VirtualClockEvent> ve);
+    // Removes a cancelled event right away if possible, it's otherwise
+    // dropped by a later flushCancelledEvents()
+    void dequeue(VirtualClockEvent& ve);
     void flushCancelledEvents();
+    bool
+    usesTimerWheel() const
+    {
+        return mTimerWheel != nullptr;
+    }
     bool cancelAllEvents();
 
     // Only valid with VIRTUAL_TIME: sets the current value of the
@@ -217,21 +232,34 @@ class VirtualClock
     void postAction(std::function<void()>&& f, std::string&& name,
                     Scheduler::ActionType type);
 
+    // See Scheduler::setQueuePolicy
+    void setActionQueuePolicy(std::string const& name,
+                              Scheduler::QueuePolicy const& policy);
+    void clearActionQueuePolicies();
+
     size_t getActionQueueSize() const;
     bool actionQueueIsOverloaded() const;
     Scheduler::ActionType currentSchedulerActionType() const;
 };
 
-class VirtualClockEvent : public NonMovableOrCopyable
+class VirtualClockEvent
+    : public NonMovableOrCopyable,
+      public TimerWheel::Entry,
+      public std::enable_shared_from_this<VirtualClockEvent>
 {
     std::function<void(asio::error_code)> mCallback;
     bool mTriggered;
 
   public:
-    VirtualClock::time_point mWhen;
     size_t mSeq;
+    // Bumped by reset(), so that a dispatch already holding the event can
+    // tell it was re-armed meanwhile
+    uint64_t mGeneration{0};
     VirtualClockEvent(VirtualClock::time_point when, size_t seq,
                       std::function<void(asio::error_code)> callback);
+    // For reuse once triggered and out of the clock
+    void reset(VirtualClock::time_point when, size_t seq,
+               std::function<void(asio::error_code)> callback);
     bool getTriggered();
     void trigger();
     void cancel();
@@ -248,6 +276,9 @@ class VirtualTimer : private NonMovableOrCopyable
     VirtualClock& mClock;
     VirtualClock::time_point mExpiryTime;
     std::vector<std::shared_ptr<VirtualClockEvent>> mEvents;
+    // The last event, kept for the next async_wait once it's out of the
+    // clock's TimerWheel, so that re-arming a timer does not allocate
+    std::shared_ptr<VirtualClockEvent> mSpareEvent;
     bool mCancelled;
     bool mDeleting;
 
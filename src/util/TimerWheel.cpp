@@ -0,0 +1,244 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/TimerWheel.h"
+#include "util/GlobalChecks.h"
+
+#include <algorithm>
+
+namespace stellar
+{
+
+TimerWheel::TimerWheel(time_point now) : mCurrentTick(toTick(now))
+{
+}
+
+TimerWheel::~TimerWheel()
+{
+    releaseAssert(mSize == 0);
+}
+
+uint64_t
+TimerWheel::toTick(time_point t)
+{
+    auto ticks = std::chrono::duration_cast<Tick>(t.time_since_epoch());
+    return ticks.count() < 0 ? 0 : static_cast<uint64_t>(ticks.count());
+}
+
+TimerWheel::time_point
+TimerWheel::fromTick(uint64_t tick)
+{
+    if (tick >= toTick(time_point::max()))
+    {
+        return time_point::max();
+    }
+    return time_point(std::chrono::duration_cast<time_point::duration>(
+        Tick(static_cast<Tick::rep>(tick))));
+}
+
+void
+TimerWheel::link(Entry& e, size_t level, size_t slot)
+{
+    auto& head = mSlots[level][slot];
+    e.mPrev = nullptr;
+    e.mNext = head;
+    if (head)
+    {
+        head->mPrev = &e;
+    }
+    head = &e;
+    mOccupied[level].set(slot);
+    e.mWheel = this;
+    e.mLevel = static_cast<uint8_t>(level);
+    e.mSlot = static_cast<uint8_t>(slot);
+    ++mSize;
+}
+
+void
+TimerWheel::unlink(Entry& e)
+{
+    auto& head = mSlots[e.mLevel][e.mSlot];
+    if (e.mPrev)
+    {
+        e.mPrev->mNext = e.mNext;
+    }
+    else
+    {
+        head = e.mNext;
+    }
+    if (e.mNext)
+    {
+        e.mNext->mPrev = e.mPrev;
+    }
+    if (!head)
+    {
+        mOccupied[e.mLevel].reset(e.mSlot);
+    }
+    e.mPrev = e.mNext = nullptr;
+    e.mWheel = nullptr;
+    --mSize;
+}
+
+void
+TimerWheel::insert(Entry& e)
+{
+    releaseAssert(!e.isScheduled());
+    auto tick = std::max(toTick(e.mWhen), mCurrentTick);
+    auto delta = tick - mCurrentTick;
+
+    // The lowest level whose slots, counted from the current one, reach the
+    // tick; beyond the top level, entries wait in its furthest slot and are
+    // placed again when it's reached
+    size_t level = 0;
+    while (level + 1 < LEVELS &&
+           delta >= (uint64_t(1) << (SLOT_BITS * (level + 1))))
+    {
+        ++level;
+    }
+    auto span = uint64_t(1) << (SLOT_BITS * LEVELS);
+    if (delta >= span)
+    {
+        tick = mCurrentTick + span - 1;
+    }
+    link(e, level, (tick >> (SLOT_BITS * level)) & (SLOTS - 1));
+}
+
+void
+TimerWheel::remove(Entry& e)
+{
+    if (e.mWheel == this)
+    {
+        unlink(e);
+    }
+}
+
+void
+TimerWheel::cascade()
+{
+    // From the top, so that entries can move down more than one level
+    for (size_t level = LEVELS - 1; level > 0; --level)
+    {
+        auto shift = SLOT_BITS * level;
+        if ((mCurrentTick & ((uint64_t(1) << shift) - 1)) != 0)
+        {
+            continue;
+        }
+        auto slot = (mCurrentTick >> shift) & (SLOTS - 1);
+        while (auto e = mSlots[level][slot])
+        {
+            unlink(*e);
+            insert(*e);
+        }
+    }
+}
+
+void
+TimerWheel::advance(time_point now, std::vector<Entry*>& due)
+{
+    auto target = toTick(now);
+    while (mSize > 0)
+    {
+        // Before the target tick, everything in the slot has expired
+        auto slot = mCurrentTick & (SLOTS - 1);
+        auto e = mSlots[0][slot];
+        while (e)
+        {
+            auto next = e->mNext;
+            if (mCurrentTick < target || e->mWhen <= now)
+            {
+                unlink(*e);
+                due.emplace_back(e);
+            }
+            e = next;
+        }
+        if (mCurrentTick >= target)
+        {
+            return;
+        }
+
+        // Below the lowest occupied level, nothing expires or moves down
+        // until that level's next span starts
+        size_t level = 0;
+        while (mOccupied[level].none())
+        {
+            ++level;
+        }
+        if (level == 0)
+        {
+            ++mCurrentTick;
+        }
+        else
+        {
+            auto span = uint64_t(1) << (SLOT_BITS * level);
+            auto nextSpan = (mCurrentTick / span + 1) * span;
+            if (nextSpan > target)
+            {
+                mCurrentTick = target;
+                continue;
+            }
+            mCurrentTick = nextSpan;
+        }
+        cascade();
+    }
+    // Nothing to cascade
+    mCurrentTick = std::max(mCurrentTick, target);
+}
+
+void
+TimerWheel::removeAll(std::vector<Entry*>& out)
+{
+    for (size_t level = 0; level < LEVELS; ++level)
+    {
+        for (size_t slot = 0; slot < SLOTS; ++slot)
+        {
+            while (auto e = mSlots[level][slot])
+            {
+                unlink(*e);
+                out.emplace_back(e);
+            }
+        }
+    }
+}
+
+TimerWheel::time_point
+TimerWheel::next() const
+{
+    auto res = time_point::max();
+    if (mSize == 0)
+    {
+        return res;
+    }
+
+    // The first occupied slot of the lowest level holds its earliest entries
+    for (size_t i = 0; i < SLOTS; ++i)
+    {
+        auto slot = (mCurrentTick + i) & (SLOTS - 1);
+        if (mOccupied[0].test(slot))
+        {
+            for (auto e = mSlots[0][slot]; e; e = e->mNext)
+            {
+                res = std::min(res, e->mWhen);
+            }
+            break;
+        }
+    }
+
+    // The span of the current slot of a higher level has started already, so
+    // its entries are for the span that reuses the slot
+    for (size_t level = 1; level < LEVELS; ++level)
+    {
+        auto shift = SLOT_BITS * level;
+        auto base = mCurrentTick >> shift;
+        for (uint64_t i = 1; i <= SLOTS; ++i)
+        {
+            if (mOccupied[level].test((base + i) & (SLOTS - 1)))
+            {
+                res = std::min(res, fromTick((base + i) << shift));
+                break;
+            }
+        }
+    }
+    return res;
+}
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/NonCopyable.h"
+
+#include <bitset>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace stellar
+{
+
+// A hierarchical timer wheel: entries are kept in intrusive lists, one per
+// slot of LEVELS wheels of SLOTS slots each, where a slot of level k spans
+// SLOTS^k ticks of TICK. Inserting and removing an entry is O(1) and never
+// allocates. Advancing the wheel drains the slot of every tick passed, and at
+// the start of each span of a level moves the entries of that span's slot
+// down to where they now belong, so every entry moves at most LEVELS times.
+//
+// Entries are only ordered to the tick, and the wheel does not own them: an
+// entry must be removed before it is destroyed.
+class TimerWheel : private NonMovableOrCopyable
+{
+  public:
+    using time_point = std::chrono::steady_clock::time_point;
+    using Tick = std::chrono::milliseconds;
+
+    class Entry
+    {
+        friend class TimerWheel;
+        Entry* mPrev{nullptr};
+        Entry* mNext{nullptr};
+        // Non-null while in a wheel
+        TimerWheel* mWheel{nullptr};
+        uint8_t mLevel{0};
+        uint8_t mSlot{0};
+
+      public:
+        time_point mWhen;
+
+        bool
+        isScheduled() const
+        {
+            return mWheel != nullptr;
+        }
+    };
+
+    explicit TimerWheel(time_point now);
+    ~TimerWheel();
+
+    // Adds e, which must not be in a wheel, to expire at e.mWhen
+    void insert(Entry& e);
+    // Removes e if it's in this wheel
+    void remove(Entry& e);
+
+    // Removes the entries that expire at or before now, appending them to due
+    void advance(time_point now, std::vector<Entry*>& due);
+    // Removes all entries, appending them to out
+    void removeAll(std::vector<Entry*>& out);
+
+    // No later than the earliest expiry of an entry, or max() if empty.
+    // Entries above the lowest level are only known to the start of their
+    // slot's span, which is returned if that comes first.
+    time_point next() const;
+
+    size_t
+    size() const
+    {
+        return mSize;
+    }
+
+  private:
+    static constexpr size_t LEVELS = 4;
+    static constexpr size_t SLOT_BITS = 8;
+    static constexpr size_t SLOTS = size_t(1) << SLOT_BITS;
+
+    Entry* mSlots[LEVELS][SLOTS]{};
+    std::bitset<SLOTS> mOccupied[LEVELS];
+    // The earliest tick whose slot may still hold entries
+    uint64_t mCurrentTick;
+    size_t mSize{0};
+
+    static uint64_t toTick(time_point t);
+    static time_point fromTick(uint64_t tick);
+
+    void link(Entry& e, size_t level, size_t slot);
+    void unlink(Entry& e);
+    // Moves the entries of the slots whose span starts at mCurrentTick down
+    void cascade();
+};
+}
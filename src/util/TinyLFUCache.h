@@ -0,0 +1,256 @@
+#pragma once
+
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/GlobalChecks.h"
+#include "util/NonCopyable.h"
+#include "util/RandomEvictionCache.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+namespace stellar
+{
+
+// Approximate recent access counts for keys, identified by their hash, kept in
+// a count-min sketch of counters that saturate at 15. Once the sketch has
+// recorded ten accesses per counter in a row, every counter is halved so
+// that estimates follow changes in popularity (the "reset" of TinyLFU).
+class FrequencySketch
+{
+    static constexpr uint8_t MAX_COUNT = 15;
+    static constexpr std::array<uint64_t, 4> SEEDS = {
+        0xc3a5c85c97cb3127ULL, 0xb492b66fbe98f273ULL, 0x9ae16a3b2f90404fULL,
+        0xcbf29ce484222325ULL};
+
+    size_t mWidth;
+    std::vector<uint8_t> mCounters;
+    size_t mAdditions{0};
+
+    size_t
+    index(size_t hash, size_t row) const
+    {
+        uint64_t h = (static_cast<uint64_t>(hash) + SEEDS[row]) * SEEDS[row];
+        h ^= h >> 32;
+        return row * mWidth + (h & (mWidth - 1));
+    }
+
+    void
+    reset()
+    {
+        for (auto& c : mCounters)
+        {
+            c >>= 1;
+        }
+        mAdditions = 0;
+    }
+
+  public:
+    // Sized for about four times as many distinct keys as the cache holds,
+    // to keep collisions with keys that are not cached down
+    explicit FrequencySketch(size_t expectedSize) : mWidth(16)
+    {
+        while (mWidth < expectedSize * 4)
+        {
+            mWidth *= 2;
+        }
+        mCounters.resize(mWidth * SEEDS.size(), 0);
+    }
+
+    void
+    record(size_t hash)
+    {
+        for (size_t row = 0; row < SEEDS.size(); ++row)
+        {
+            auto& c = mCounters[index(hash, row)];
+            if (c < MAX_COUNT)
+            {
+                ++c;
+            }
+        }
+        if (++mAdditions >= mWidth * 10)
+        {
+            reset();
+        }
+    }
+
+    uint8_t
+    estimate(size_t hash) const
+    {
+        uint8_t res = MAX_COUNT;
+        for (size_t row = 0; row < SEEDS.size(); ++row)
+        {
+            res = std::min(res, mCounters[index(hash, row)]);
+        }
+        return res;
+    }
+};
+
+// Thread-safe cache split into independently locked RandomEvictionCache
+// shards. Each shard keeps a FrequencySketch of the keys looked up in it, and
+// once the shard is full a new key is only admitted if it has been looked up
+// at least as often as the entry it would evict (TinyLFU admission). A burst
+// of keys that are seen once, like a large prefetch of cold entries, can
+// therefore not flush entries that are used all the time. The sketch survives
+// clear(), so popularity carries over when the cache is emptied.
+template <typename K, typename V, typename Hash = std::hash<K>>
+class TinyLFUCache : public NonMovableOrCopyable
+{
+  public:
+    using Counters = typename RandomEvictionCache<K, V, Hash>::Counters;
+
+  private:
+    struct Shard
+    {
+        std::mutex mMutex;
+        RandomEvictionCache<K, V, Hash> mCache;
+        FrequencySketch mSketch;
+
+        Shard(size_t maxSize, unsigned int seed)
+            : mCache(maxSize, /* separatePRNG */ true), mSketch(maxSize)
+        {
+            mCache.maybeSeed(seed);
+        }
+    };
+
+    size_t const mMaxSize;
+    std::vector<std::unique_ptr<Shard>> mShards;
+    Hash mHasher;
+
+    Shard&
+    getShard(size_t hash)
+    {
+        return *mShards[hash % mShards.size()];
+    }
+
+  public:
+    TinyLFUCache(size_t maxSize, size_t numShards) : mMaxSize(maxSize)
+    {
+        releaseAssert(numShards > 0);
+        size_t perShard = (maxSize + numShards - 1) / numShards;
+        for (size_t i = 0; i < numShards; ++i)
+        {
+            mShards.emplace_back(
+                std::make_unique<Shard>(perShard, static_cast<unsigned>(i)));
+        }
+    }
+
+    size_t
+    maxSize() const
+    {
+        return mMaxSize;
+    }
+
+    size_t
+    size()
+    {
+        size_t res = 0;
+        for (auto& shard : mShards)
+        {
+            std::lock_guard<std::mutex> lock(shard->mMutex);
+            res += shard->mCache.size();
+        }
+        return res;
+    }
+
+    Counters
+    getCounters()
+    {
+        Counters res;
+        for (auto& shard : mShards)
+        {
+            std::lock_guard<std::mutex> lock(shard->mMutex);
+            auto const& c = shard->mCache.getCounters();
+            res.mHits += c.mHits;
+            res.mMisses += c.mMisses;
+            res.mInserts += c.mInserts;
+            res.mUpdates += c.mUpdates;
+            res.mEvicts += c.mEvicts;
+            res.mRejects += c.mRejects;
+        }
+        return res;
+    }
+
+    // Inserts or updates k unless the admission policy rejects it. Returns
+    // whether k is now cached. Same exception safety as
+    // RandomEvictionCache::put.
+    bool
+    put(K const& k, V const& v)
+    {
+        auto hash = mHasher(k);
+        auto& shard = getShard(hash);
+        std::lock_guard<std::mutex> lock(shard.mMutex);
+        return shard.mCache.putIfAdmitted(k, v, [&](K const& victim) {
+            return shard.mSketch.estimate(hash) >=
+                   shard.mSketch.estimate(mHasher(victim));
+        });
+    }
+
+    // All lookups count towards the frequency of k, see
+    // RandomEvictionCache::exists for countMisses
+    bool
+    exists(K const& k, bool countMisses = true)
+    {
+        auto hash = mHasher(k);
+        auto& shard = getShard(hash);
+        std::lock_guard<std::mutex> lock(shard.mMutex);
+        shard.mSketch.record(hash);
+        return shard.mCache.exists(k, countMisses);
+    }
+
+    std::optional<V>
+    maybeGet(K const& k)
+    {
+        auto hash = mHasher(k);
+        auto& shard = getShard(hash);
+        std::lock_guard<std::mutex> lock(shard.mMutex);
+        shard.mSketch.record(hash);
+        auto res = shard.mCache.maybeGet(k);
+        return res ? std::make_optional(*res) : std::nullopt;
+    }
+
+    // Throws std::range_error if k is not cached
+    V
+    get(K const& k)
+    {
+        auto res = maybeGet(k);
+        if (!res)
+        {
+            throw std::range_error("There is no such key in cache");
+        }
+        return *res;
+    }
+
+    // Calls f on the key of every cached entry, shard by shard, without
+    // affecting the frequency of any. f must not call into the cache.
+    void
+    forEachKey(std::function<void(K const&)> const& f)
+    {
+        for (auto& shard : mShards)
+        {
+            std::lock_guard<std::mutex> lock(shard->mMutex);
+            shard->mCache.for_each_key(f);
+        }
+    }
+
+    // `clear` does not throw
+    void
+    clear()
+    {
+        for (auto& shard : mShards)
+        {
+            std::lock_guard<std::mutex> lock(shard->mMutex);
+            shard->mCache.clear();
+        }
+    }
+};
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/FlatHashMap.h"
+#include "util/RandHasher.h"
+#include "xdr/Stellar-types.h"
+
+#include <cstdint>
+#include <cstring>
+
+namespace stellar
+{
+
+// Hasher for keys that are themselves SHA-256 hashes, like transaction and
+// flooded message hashes. Their first 8 bytes are already uniformly
+// distributed, so they are only mixed with the process-wide random seed
+// (keeping peers from choosing hashes that collide in the table) instead of
+// being hashed again. Lookups still compare the full 32 bytes.
+struct HashPrefixHasher
+{
+    size_t
+    operator()(Hash const& h) const noexcept
+    {
+        releaseAssert(randHash::gHaveInitialized);
+        uint64_t prefix;
+        std::memcpy(&prefix, h.data(), sizeof(prefix));
+        prefix ^= randHash::gMixer;
+        prefix *= 0x9e3779b97f4a7c15ULL;
+        return static_cast<size_t>(prefix ^ (prefix >> 32));
+    }
+};
+
+// Flat maps and sets of transaction hashes: every element lives in a single
+// slot array next to its hash, instead of in its own heap node
+template <class T> using TxHashMap = FlatHashMap<Hash, T, HashPrefixHasher>;
+
+class TxHashSet
+{
+    struct Empty
+    {
+    };
+
+    FlatHashMap<Hash, Empty, HashPrefixHasher> mHashes;
+
+  public:
+    // Returns whether h was inserted, that is it was not in the set yet
+    bool
+    insert(Hash const& h)
+    {
+        return mHashes.emplace(h).second;
+    }
+
+    bool
+    contains(Hash const& h) const
+    {
+        return mHashes.find(h) != mHashes.end();
+    }
+
+    // Returns whether h was in the set
+    bool
+    erase(Hash const& h)
+    {
+        return mHashes.erase(h) == 1;
+    }
+
+    size_t
+    size() const
+    {
+        return mHashes.size();
+    }
+
+    bool
+    empty() const
+    {
+        return mHashes.empty();
+    }
+
+    void
+    clear()
+    {
+        mHashes.clear();
+    }
+};
+}
@@ -0,0 +1,167 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/WorkerThreadPool.h"
+#include "util/GlobalChecks.h"
+
+namespace stellar
+{
+
+namespace
+{
+// The pool the current thread belongs to, if any, and its index there
+thread_local WorkerThreadPool const* tPool = nullptr;
+thread_local size_t tIndex = 0;
+
+size_t constexpr BULK = static_cast<size_t>(WorkerPriority::BULK);
+}
+
+WorkerThreadPool::WorkerThreadPool(size_t numThreads,
+                                   std::function<void()> threadInit)
+    : mMaxRunningBulk(numThreads > 1 ? numThreads - 1 : 1)
+{
+    releaseAssert(numThreads > 0);
+    for (size_t i = 0; i < numThreads; ++i)
+    {
+        mQueues.emplace_back(std::make_unique<ThreadQueues>());
+    }
+    for (size_t i = 0; i < numThreads; ++i)
+    {
+        mThreads.emplace_back([this, i, threadInit]() { run(i, threadInit); });
+    }
+}
+
+WorkerThreadPool::~WorkerThreadPool()
+{
+    join();
+}
+
+void
+WorkerThreadPool::post(std::function<void()>&& f, WorkerPriority priority)
+{
+    auto p = static_cast<size_t>(priority);
+    auto index = tPool == this ? tIndex : mNextQueue++ % mQueues.size();
+    {
+        auto& q = mQueues[index]->mQueues[p];
+        std::lock_guard<std::mutex> guard(q.mMutex);
+        q.mJobs.emplace_back(std::move(f));
+    }
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+        ++mPending[p];
+    }
+    mCV.notify_one();
+}
+
+void
+WorkerThreadPool::join()
+{
+    if (mThreads.empty())
+    {
+        return;
+    }
+    releaseAssert(tPool != this);
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+        mStopping = true;
+    }
+    mCV.notify_all();
+    for (auto& t : mThreads)
+    {
+        t.join();
+    }
+    mThreads.clear();
+}
+
+void
+WorkerThreadPool::run(size_t index, std::function<void()> const& threadInit)
+{
+    tPool = this;
+    tIndex = index;
+    if (threadInit)
+    {
+        threadInit();
+    }
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true)
+    {
+        size_t p = NUM_PRIORITIES;
+        mCV.wait(lock, [&]() {
+            bool anyPending = false;
+            for (p = 0; p < NUM_PRIORITIES; ++p)
+            {
+                if (mPending[p] > 0)
+                {
+                    anyPending = true;
+                    if (p != BULK || mRunningBulk < mMaxRunningBulk)
+                    {
+                        return true;
+                    }
+                }
+            }
+            return mStopping && !anyPending;
+        });
+        if (p == NUM_PRIORITIES)
+        {
+            return;
+        }
+
+        --mPending[p];
+        if (p == BULK)
+        {
+            ++mRunningBulk;
+        }
+        if (mStopping)
+        {
+            // Threads waiting for the last jobs to be claimed can exit now
+            mCV.notify_all();
+        }
+        lock.unlock();
+
+        auto job = takeJob(index, p);
+        job();
+        job = nullptr;
+
+        lock.lock();
+        if (p == BULK)
+        {
+            --mRunningBulk;
+            mCV.notify_one();
+        }
+    }
+}
+
+std::function<void()>
+WorkerThreadPool::takeJob(size_t index, size_t priority)
+{
+    // The claimed job is in some deque, but another thread may take the one
+    // seen here first and leave this one to find a job posted since
+    while (true)
+    {
+        for (size_t i = 0; i < mQueues.size(); ++i)
+        {
+            auto& q = mQueues[(index + i) % mQueues.size()]->mQueues[priority];
+            std::lock_guard<std::mutex> guard(q.mMutex);
+            if (q.mJobs.empty())
+            {
+                continue;
+            }
+            std::function<void()> job;
+            if (i == 0)
+            {
+                job = std::move(q.mJobs.front());
+                q.mJobs.pop_front();
+            }
+            else
+            {
+                job = std::move(q.mJobs.back());
+                q.mJobs.pop_back();
+            }
+            return job;
+        }
+        std::this_thread::yield();
+    }
+}
+}
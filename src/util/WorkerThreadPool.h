@@ -0,0 +1,95 @@
+#pragma once
+
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/NonCopyable.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace stellar
+{
+
+// Classes of background jobs, most urgent first
+enum class WorkerPriority
+{
+    // Jobs ledger close waits on, such as eviction scans, prefetches and
+    // signature verification
+    CRITICAL = 0,
+    NORMAL,
+    // Long running jobs nothing waits on soon, such as bucket indexing and
+    // verification or history archive work
+    BULK
+};
+
+// A fixed set of threads running posted jobs, replacing a single io_context
+// shared by all of them so that urgent jobs do not queue behind bulk ones.
+//
+// Every thread has a deque of jobs per priority. Jobs posted from one of the
+// pool's threads go to that thread's deque, others are spread round robin.
+// A thread that is free takes the most urgent priority with jobs pending,
+// then the oldest job of that priority in its own deque, or steals the
+// newest one from another thread's. At most size() - 1 BULK jobs run at a
+// time, so that a thread is always left for the other priorities. Jobs of
+// the same priority are otherwise not ordered.
+class WorkerThreadPool : private NonMovableOrCopyable
+{
+  public:
+    // Starts numThreads threads, each calling threadInit first if set
+    WorkerThreadPool(size_t numThreads,
+                     std::function<void()> threadInit = nullptr);
+    // Joins the threads if join() was not called
+    ~WorkerThreadPool();
+
+    void post(std::function<void()>&& f, WorkerPriority priority);
+
+    // Waits for every job posted so far, and any they post in turn, to run,
+    // then stops the threads. Must not be called from one of them.
+    void join();
+
+    size_t
+    size() const
+    {
+        return mThreads.size();
+    }
+
+  private:
+    static constexpr size_t NUM_PRIORITIES = 3;
+
+    struct JobQueue
+    {
+        std::mutex mMutex;
+        std::deque<std::function<void()>> mJobs;
+    };
+    struct ThreadQueues
+    {
+        JobQueue mQueues[NUM_PRIORITIES];
+    };
+
+    std::vector<std::unique_ptr<ThreadQueues>> mQueues;
+    std::vector<std::thread> mThreads;
+    size_t const mMaxRunningBulk;
+    std::atomic<size_t> mNextQueue{0};
+
+    // Guards the counts below: a job is counted as pending once it's in a
+    // deque, and a thread claims one of a priority before looking for it, so
+    // a claimed job is always in some deque
+    std::mutex mMutex;
+    std::condition_variable mCV;
+    size_t mPending[NUM_PRIORITIES]{};
+    size_t mRunningBulk{0};
+    bool mStopping{false};
+
+    void run(size_t index, std::function<void()> const& threadInit);
+    std::function<void()> takeJob(size_t index, size_t priority);
+};
+}
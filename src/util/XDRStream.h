@@ -10,12 +10,15 @@
 #include "util/Fs.h"
 #include "util/GlobalChecks.h"
 #include "util/Logging.h"
+#include "util/NonCopyable.h"
 #include "util/types.h"
 #include "xdrpp/marshal.h"
 #include <Tracy.hpp>
 
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
+#include <memory>
 #include <string>
 #include <vector>
 #ifdef _WIN32
@@ -33,8 +36,23 @@ class XDRInputFileStream
 {
     std::ifstream mIn;
     std::vector<char> mBuf;
+    std::vector<char> mReadBuf;
     size_t mSizeLimit;
     size_t mSize;
+    // Only set up for streams opened with a read buffer, see `open`
+    std::unique_ptr<fs::FileReadAhead> mReadAhead;
+    // Tracked here, since asking mIn costs a syscall
+    uint64_t mReadPos{0};
+
+    void
+    consumed(size_t n)
+    {
+        mReadPos += n;
+        if (mReadAhead)
+        {
+            mReadAhead->advance(mReadPos);
+        }
+    }
 
   public:
     XDRInputFileStream(unsigned int sizeLimit = 0)
@@ -47,12 +65,28 @@ class XDRInputFileStream
     {
         ZoneScoped;
         mIn.close();
+        mReadAhead.reset();
     }
 
+    // Number of read buffers worth of file that streams opened with one keep
+    // the OS reading ahead of them
+    static constexpr size_t READ_AHEAD_BUFFERS = 4;
+
+    // If readBufferSize is nonzero, the stream reads through a buffer of that
+    // size instead of the (small) default one of std::ifstream, and is
+    // expected to be read mostly sequentially: the OS is asked to read
+    // READ_AHEAD_BUFFERS buffers past the current position in the background,
+    // so that refilling the buffer rarely waits on the disk.
     void
-    open(std::string const& filename)
+    open(std::string const& filename, size_t readBufferSize = 0)
     {
         ZoneScoped;
+        if (readBufferSize != 0)
+        {
+            // std::filebuf only honors setbuf before the file is opened
+            mReadBuf.resize(readBufferSize);
+            mIn.rdbuf()->pubsetbuf(mReadBuf.data(), mReadBuf.size());
+        }
         mIn.open(filename, std::ifstream::binary);
         if (!mIn)
         {
@@ -65,12 +99,19 @@ class XDRInputFileStream
         }
         mIn.exceptions(std::ios::badbit);
         mSize = fs::size(mIn);
+        mReadPos = 0;
+        if (readBufferSize != 0)
+        {
+            mReadAhead = std::make_unique<fs::FileReadAhead>(
+                filename, READ_AHEAD_BUFFERS * readBufferSize);
+            mReadAhead->advance(0);
+        }
     }
 
     void
-    open(std::filesystem::path const& filename)
+    open(std::filesystem::path const& filename, size_t readBufferSize = 0)
     {
-        open(filename.string());
+        open(filename.string(), readBufferSize);
     }
 
     operator bool() const
@@ -96,10 +137,12 @@ class XDRInputFileStream
     {
         releaseAssertOrThrow(!mIn.fail());
         mIn.seekg(pos);
+        mReadPos = pos;
+        consumed(0);
     }
 
     static inline uint32_t
-    getXDRSize(char* buf)
+    getXDRSize(char const* buf)
     {
         // Read 4 bytes of size, big-endian, with XDR 'continuation' bit cleared
         // (high bit of high byte).
@@ -114,9 +157,11 @@ class XDRInputFileStream
         return sz;
     }
 
-    template <typename T>
+    // Reads the next record into buf without decoding it, resizing buf to the
+    // record size. Returns false at end of stream or if the record exceeds
+    // the size limit.
     bool
-    readOne(T& out)
+    readOneRaw(std::vector<char>& buf)
     {
         ZoneScoped;
         char szBuf[4];
@@ -139,17 +184,28 @@ class XDRInputFileStream
         {
             return false;
         }
-        if (sz > mBuf.size())
-        {
-            mBuf.resize(sz);
-        }
-        if (!mIn.read(mBuf.data(), sz))
+        buf.resize(sz);
+        if (!mIn.read(buf.data(), sz))
         {
             throw xdr::xdr_runtime_error(
                 "malformed XDR file or IO failure in readOne");
         }
 
-        xdr::xdr_get g(mBuf.data(), mBuf.data() + sz);
+        consumed(4 + sz);
+        return true;
+    }
+
+    template <typename T>
+    bool
+    readOne(T& out)
+    {
+        ZoneScoped;
+        if (!readOneRaw(mBuf))
+        {
+            return false;
+        }
+
+        xdr::xdr_get g(mBuf.data(), mBuf.data() + mBuf.size());
         xdr::xdr_argpack_archive(g, out);
         return true;
     }
@@ -183,6 +239,7 @@ class XDRInputFileStream
                 throw xdr::xdr_runtime_error("IO failure in readPage");
             }
         }
+        consumed(mBuf.size());
 
         size_t xdrStart = 0;
         while (xdrStart + 4 <= mBuf.size())
@@ -205,6 +262,7 @@ class XDRInputFileStream
                     throw xdr::xdr_runtime_error(
                         "malformed XDR file or IO failure in readPage");
                 }
+                consumed(extraSz);
             }
 
             ZoneNamedN(__unpack, "xdr_unpack_entry", true);
@@ -222,6 +280,191 @@ class XDRInputFileStream
 
         return false;
     }
+
+    // Reads the page starting at the current position into buf. Unlike
+    // readPage, the full page is always read, including the remainder of any
+    // record that starts within the page but extends past its end, so that buf
+    // can later be searched with findInPage without touching the file again.
+    void
+    readPageBytes(std::vector<char>& buf, size_t pageSize)
+    {
+        ZoneScoped;
+        buf.resize(pageSize);
+        if (!mIn.read(buf.data(), pageSize))
+        {
+            if (mIn.eof())
+            {
+                buf.resize(mIn.gcount());
+                mIn.clear(std::ios_base::eofbit);
+            }
+            else
+            {
+                throw xdr::xdr_runtime_error("IO failure in readPageBytes");
+            }
+        }
+        consumed(buf.size());
+
+        size_t xdrStart = 0;
+        while (xdrStart + 4 <= buf.size())
+        {
+            size_t const xdrEnd =
+                xdrStart + 4 + getXDRSize(buf.data() + xdrStart);
+            if (xdrEnd > buf.size())
+            {
+                size_t const extraStart = buf.size();
+                buf.resize(xdrEnd);
+                if (!mIn.read(buf.data() + extraStart, xdrEnd - extraStart))
+                {
+                    throw xdr::xdr_runtime_error(
+                        "malformed XDR file or IO failure in readPageBytes");
+                }
+                consumed(xdrEnd - extraStart);
+            }
+
+            xdrStart = xdrEnd;
+        }
+    }
+
+    // Searches the page starting at byte pageStart of a buffer previously
+    // loaded by readPageBytes for a record whose key matches `key`, with the
+    // same semantics as readPage. pageStart must be a record boundary.
+    template <typename T>
+    static bool
+    findInPage(std::vector<char> const& buf, size_t pageStart,
+               size_t pageSize, LedgerKey const& key, T& out)
+    {
+        ZoneScoped;
+        size_t const limit = std::min(pageStart + pageSize, buf.size());
+        size_t xdrStart = pageStart;
+        while (xdrStart + 4 <= limit)
+        {
+            size_t const xdrEnd =
+                xdrStart + 4 + getXDRSize(buf.data() + xdrStart);
+            releaseAssert(xdrEnd <= buf.size());
+
+            ZoneNamedN(__unpack, "xdr_unpack_entry", true);
+            xdr::xdr_get g(buf.data() + xdrStart + 4, buf.data() + xdrEnd);
+            xdr::xdr_argpack_archive(g, out);
+            if (getBucketLedgerKey(out) == key)
+            {
+                return true;
+            }
+
+            xdrStart = xdrEnd;
+        }
+
+        return false;
+    }
+};
+
+/**
+ * Read-only, memory mapped counterpart of XDRInputFileStream. Records are
+ * decoded directly from the mapped pages, avoiding a syscall and buffer copy
+ * per read. The underlying file must be immutable (i.e. a bucket file).
+ */
+class XDRInputMappedFile : public NonMovableOrCopyable
+{
+    std::unique_ptr<fs::ReadOnlyMappedFile const> mFile;
+    size_t mPos{0};
+
+    template <typename T>
+    void
+    decode(size_t xdrStart, size_t xdrEnd, T& out) const
+    {
+        if (xdrEnd > mFile->size())
+        {
+            throw xdr::xdr_runtime_error("malformed XDR file in mapped read");
+        }
+
+        ZoneNamedN(__unpack, "xdr_unpack_entry", true);
+        xdr::xdr_get g(mFile->data() + xdrStart, mFile->data() + xdrEnd);
+        xdr::xdr_argpack_archive(g, out);
+    }
+
+  public:
+    void
+    open(std::string const& filename)
+    {
+        ZoneScoped;
+        mFile = std::make_unique<fs::ReadOnlyMappedFile const>(filename);
+        mPos = 0;
+    }
+
+    void
+    open(std::filesystem::path const& filename)
+    {
+        open(filename.string());
+    }
+
+    size_t
+    size() const
+    {
+        releaseAssertOrThrow(mFile);
+        return mFile->size();
+    }
+
+    std::streamoff
+    pos() const
+    {
+        return static_cast<std::streamoff>(mPos);
+    }
+
+    void
+    seek(size_t pos)
+    {
+        releaseAssertOrThrow(mFile);
+        releaseAssertOrThrow(pos <= mFile->size());
+        mPos = pos;
+    }
+
+    template <typename T>
+    bool
+    readOne(T& out)
+    {
+        ZoneScoped;
+        releaseAssertOrThrow(mFile);
+        if (mPos == mFile->size())
+        {
+            return false;
+        }
+        if (mPos + 4 > mFile->size())
+        {
+            throw xdr::xdr_runtime_error("IO failure in readOne");
+        }
+
+        size_t const xdrStart = mPos + 4;
+        size_t const xdrEnd =
+            xdrStart + XDRInputFileStream::getXDRSize(mFile->data() + mPos);
+        decode(xdrStart, xdrEnd, out);
+        mPos = xdrEnd;
+        return true;
+    }
+
+    // Same semantics as XDRInputFileStream::readPage: scans records starting
+    // within [pos, pos + pageSize) until one matches key. The last record may
+    // extend past the end of the page.
+    template <typename T>
+    bool
+    readPage(T& out, LedgerKey const& key, size_t pageSize)
+    {
+        ZoneScoped;
+        releaseAssertOrThrow(mFile);
+        size_t const pageEnd = std::min(mPos + pageSize, mFile->size());
+        while (mPos + 4 <= pageEnd)
+        {
+            size_t const xdrStart = mPos + 4;
+            size_t const xdrEnd =
+                xdrStart + XDRInputFileStream::getXDRSize(mFile->data() + mPos);
+            decode(xdrStart, xdrEnd, out);
+            mPos = xdrEnd;
+            if (getBucketLedgerKey(out) == key)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
 };
 
 // XDROutputFileStream needs access to a file descriptor to do fsync, so we use
@@ -231,6 +474,12 @@ class XDROutputFileStream
     std::vector<char> mBuf;
     const bool mFsyncOnClose;
 
+    // When nonzero, written data is dropped from the page cache every
+    // mDropCacheInterval bytes, see dropCacheWhileWriting
+    size_t mDropCacheInterval{0};
+    size_t mBytesWritten{0};
+    size_t mBytesDropped{0};
+
 #ifdef WIN32
     // Windows implementation assumes calls can't get interrupted
     fs::native_handle_t mHandle;
@@ -291,6 +540,10 @@ class XDROutputFileStream
         {
             fs::flushFileChanges(getHandle());
         }
+        if (mDropCacheInterval != 0)
+        {
+            fs::dropFileCache(getHandle(), mBytesDropped, 0);
+        }
 #ifdef WIN32
         fclose(mOut);
         mOut = nullptr;
@@ -377,6 +630,18 @@ class XDROutputFileStream
         return isOpen();
     }
 
+    // For large files that are written once and not read back soon: every
+    // interval bytes, the data written so far is flushed (and fsynced if the
+    // stream fsyncs on close) and then dropped from the page cache, so that
+    // writing the file does not evict hotter pages or build up a large backlog
+    // of dirty pages that the final fsync has to wait on.
+    void
+    dropCacheWhileWriting(size_t interval)
+    {
+        releaseAssert(interval != 0);
+        mDropCacheInterval = interval;
+    }
+
     template <typename T>
     void
     writeOne(T const& t, SHA256* hasher = nullptr, size_t* bytesPut = nullptr)
@@ -390,7 +655,38 @@ class XDROutputFileStream
 
         uint32_t sz = (uint32_t)xdr::xdr_size(t);
         releaseAssertOrThrow(sz < 0x80000000);
+        prepareRecord(sz);
+        xdr::xdr_put p(mBuf.data() + 4, mBuf.data() + 4 + sz);
+        xdr_argpack_archive(p, t);
+        writeRecord(sz, hasher, bytesPut);
+    }
 
+    // Writes a record whose XDR encoding is already in data, as produced by
+    // XDRInputFileStream::readOneRaw. The output is byte for byte identical
+    // to writeOne of the decoded value.
+    void
+    writeRaw(char const* data, size_t size, SHA256* hasher = nullptr,
+             size_t* bytesPut = nullptr)
+    {
+        ZoneScoped;
+        if (!isOpen())
+        {
+            FileSystemException::failWith(
+                "XDROutputFileStream::writeRaw() on non-open stream");
+        }
+
+        releaseAssertOrThrow(size < 0x80000000);
+        auto sz = static_cast<uint32_t>(size);
+        prepareRecord(sz);
+        std::copy(data, data + sz, mBuf.data() + 4);
+        writeRecord(sz, hasher, bytesPut);
+    }
+
+  private:
+    // Sizes mBuf for a record of sz bytes and writes the record mark
+    void
+    prepareRecord(uint32_t sz)
+    {
         if (mBuf.size() < sz + 4)
         {
             mBuf.resize(sz + 4);
@@ -402,9 +698,12 @@ class XDROutputFileStream
         mBuf[1] = static_cast<char>((sz >> 16) & 0xFF);
         mBuf[2] = static_cast<char>((sz >> 8) & 0xFF);
         mBuf[3] = static_cast<char>(sz & 0xFF);
-        xdr::xdr_put p(mBuf.data() + 4, mBuf.data() + 4 + sz);
-        xdr_argpack_archive(p, t);
+    }
 
+    // Writes the record mark and sz bytes of record body in mBuf
+    void
+    writeRecord(uint32_t sz, SHA256* hasher, size_t* bytesPut)
+    {
         size_t const to_write = sz + 4;
         size_t written = 0;
         while (written < to_write)
@@ -445,6 +744,20 @@ class XDROutputFileStream
         {
             *bytesPut += (sz + 4);
         }
+
+        mBytesWritten += to_write;
+        if (mDropCacheInterval != 0 &&
+            mBytesWritten - mBytesDropped >= mDropCacheInterval)
+        {
+            flush();
+            if (mFsyncOnClose)
+            {
+                fs::flushFileChanges(getHandle());
+            }
+            fs::dropFileCache(getHandle(), mBytesDropped,
+                              mBytesWritten - mBytesDropped);
+            mBytesDropped = mBytesWritten;
+        }
     }
 };
 }
@@ -6,7 +6,10 @@
 #include "util/BitSet.h"
 #include "util/Math.h"
 #include "util/UnorderedSet.h"
+#include <chrono>
+#include <random>
 #include <set>
+#include <vector>
 
 using namespace stellar;
 
@@ -202,4 +205,89 @@ TEST_CASE("BitSet large bitsets", "[bitset]")
         bs.set(i);
     }
     REQUIRE(bs.count() == 10000);
-}
\ No newline at end of file
+}
+namespace
+{
+std::vector<uint64_t>
+randomWords(std::mt19937_64& gen, size_t n)
+{
+    std::vector<uint64_t> words(n);
+    for (auto& w : words)
+    {
+        w = gen();
+    }
+    return words;
+}
+
+std::vector<bitset_popcount_op_t> const allOps{
+    BITSET_POPCOUNT_A, BITSET_POPCOUNT_AND, BITSET_POPCOUNT_OR,
+    BITSET_POPCOUNT_ANDNOT, BITSET_POPCOUNT_XOR};
+}
+
+TEST_CASE("BitSet popcount kernels agree", "[bitset]")
+{
+    std::mt19937_64 gen(1234);
+    for (size_t n = 0; n < 80; ++n)
+    {
+        auto a = randomWords(gen, n);
+        auto b = randomWords(gen, n);
+        for (auto op : allOps)
+        {
+            auto expected = bitset_popcount_words(BITSET_KERNEL_PORTABLE,
+                                                  a.data(), b.data(), n, op);
+            for (auto kernel : {BITSET_KERNEL_POPCNT, BITSET_KERNEL_AVX2})
+            {
+                REQUIRE(bitset_popcount_words(kernel, a.data(), b.data(), n,
+                                              op) == expected);
+            }
+        }
+    }
+
+    // The counts BitSet exposes, on sets of different lengths
+    BitSet big, small;
+    for (size_t i = 0; i < 5000; i += 3)
+    {
+        big.set(i);
+    }
+    for (size_t i = 0; i < 700; i += 2)
+    {
+        small.set(i);
+    }
+    REQUIRE(big.intersectionCount(small) == (big & small).count());
+    REQUIRE(big.unionCount(small) == (big | small).count());
+    REQUIRE(small.unionCount(big) == (big | small).count());
+    REQUIRE(big.differenceCount(small) == (big - small).count());
+    REQUIRE(small.differenceCount(big) == (small - big).count());
+    REQUIRE(big.symmetricDifferenceCount(small) ==
+            big.symmetricDifference(small).count());
+}
+
+TEST_CASE("BitSet popcount kernels bench", "[bitset][bench][!hide]")
+{
+    std::mt19937_64 gen(1234);
+    size_t const totalWords = 100000000;
+    for (size_t n : {1, 4, 16, 64, 1024})
+    {
+        auto a = randomWords(gen, n);
+        auto b = randomWords(gen, n);
+        for (auto kernel : {BITSET_KERNEL_PORTABLE, BITSET_KERNEL_POPCNT,
+                            BITSET_KERNEL_AVX2})
+        {
+            size_t sink = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < totalWords / n; ++i)
+            {
+                sink += bitset_popcount_words(kernel, a.data(), b.data(), n,
+                                              BITSET_POPCOUNT_AND);
+            }
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            LOG_INFO(DEFAULT_LOG,
+                     "{} words, kernel {} (best {}): {:.2f} ns/word ({})", n,
+                     static_cast<int>(kernel),
+                     static_cast<int>(bitset_best_kernel()),
+                     std::chrono::duration<double, std::nano>(elapsed).count() /
+                         totalWords,
+                     sink);
+        }
+    }
+}
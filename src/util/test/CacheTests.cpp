@@ -3,9 +3,14 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "lib/catch.hpp"
+#include "util/ConcurrentRandomEvictionCache.h"
 #include "util/RandomEvictionCache.h"
+#include "util/TinyLFUCache.h"
+#include <atomic>
 #include <ctime>
 #include <map>
+#include <thread>
+#include <vector>
 
 using namespace stellar;
 
@@ -319,3 +324,148 @@ TEMPLATE_TEST_CASE("cache erase_if removes all nodes", "[cache][template]",
     REQUIRE(!c.exists(3));
     REQUIRE(!c.exists(4));
 }
+
+TEST_CASE("RandomEvictionCache admission", "[randomevictioncache]")
+{
+    RandomEvictionCache<int, int> cache(2);
+    cache.put(0, 0);
+    cache.put(1, 1);
+
+    // Not full yet for an update
+    REQUIRE(cache.putIfAdmitted(1, 2, [](int) { return false; }));
+    REQUIRE(cache.get(1) == 2);
+
+    REQUIRE(!cache.putIfAdmitted(2, 2, [](int) { return false; }));
+    REQUIRE(!cache.exists(2));
+    REQUIRE(cache.size() == 2);
+    REQUIRE(cache.getCounters().mRejects == 1);
+
+    int evicted = -1;
+    REQUIRE(cache.putIfAdmitted(2, 2, [&](int victim) {
+        evicted = victim;
+        return true;
+    }));
+    REQUIRE(cache.exists(2));
+    REQUIRE(!cache.exists(evicted));
+    REQUIRE(cache.size() == 2);
+}
+
+TEST_CASE("TinyLFUCache keeps frequently used entries", "[tinylfucache]")
+{
+    size_t const sz = 1000;
+    int const numHot = 500;
+    for (size_t shards : {1, 4})
+    {
+        TinyLFUCache<int, int> cache(sz, shards);
+        auto access = [&](int k) {
+            if (!cache.exists(k))
+            {
+                cache.put(k, k);
+            }
+        };
+
+        for (int round = 0; round < 5; ++round)
+        {
+            for (int i = 0; i < numHot; ++i)
+            {
+                access(i);
+            }
+        }
+
+        // A scan of 3000 keys that are each seen once, with the hot keys
+        // still in use
+        for (int i = 0; i < 3000; ++i)
+        {
+            access(numHot + i);
+            if (i % 10 == 0)
+            {
+                access(i % numHot);
+            }
+        }
+
+        for (int i = 0; i < numHot; ++i)
+        {
+            REQUIRE(cache.exists(i));
+            REQUIRE(cache.get(i) == i);
+        }
+        REQUIRE(cache.size() <= sz);
+        REQUIRE(cache.getCounters().mRejects > 0);
+
+        cache.clear();
+        REQUIRE(cache.size() == 0);
+        REQUIRE(!cache.maybeGet(0));
+    }
+}
+
+TEST_CASE("ConcurrentRandomEvictionCache", "[randomevictioncache]")
+{
+    size_t const sz = 1024;
+    ConcurrentRandomEvictionCache<size_t, size_t, 8> cache(sz);
+    REQUIRE(cache.maxSize() == sz);
+
+    SECTION("works as a cache")
+    {
+        for (size_t i = 0; i < sz / 2; ++i)
+        {
+            cache.put(i, i * 100);
+        }
+        for (size_t i = 0; i < sz / 2; ++i)
+        {
+            REQUIRE(cache.get(i) == i * 100);
+        }
+        REQUIRE(!cache.maybeGet(sz));
+        REQUIRE_THROWS_AS(cache.get(sz), std::range_error);
+        REQUIRE(cache.size() == sz / 2);
+
+        auto ctrs = cache.getCounters();
+        REQUIRE(ctrs.mInserts == sz / 2);
+        REQUIRE(ctrs.mHits == sz / 2);
+        REQUIRE(ctrs.mMisses == 2);
+
+        cache.erase_if([](size_t v) { return v % 200 == 0; });
+        REQUIRE(cache.size() == sz / 4);
+        REQUIRE(!cache.exists(0, false));
+        REQUIRE(cache.exists(1));
+    }
+
+    SECTION("resizing drops contents")
+    {
+        cache.put(1, 1);
+        cache.setMaxSize(sz);
+        REQUIRE(cache.exists(1));
+        cache.setMaxSize(2 * sz);
+        REQUIRE(cache.maxSize() == 2 * sz);
+        REQUIRE(cache.size() == 0);
+    }
+
+    SECTION("used from many threads")
+    {
+        std::atomic<size_t> wrong{0};
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < 4; ++t)
+        {
+            threads.emplace_back([&cache, &wrong, t]() {
+                for (size_t i = 0; i < 10000; ++i)
+                {
+                    size_t k = (i * 7 + t) % 4096;
+                    if (auto v = cache.maybeGet(k))
+                    {
+                        wrong += *v != k + 1;
+                    }
+                    else
+                    {
+                        cache.put(k, k + 1);
+                    }
+                }
+            });
+        }
+        for (auto& t : threads)
+        {
+            t.join();
+        }
+        REQUIRE(wrong == 0);
+        REQUIRE(cache.size() <= cache.maxSize());
+        auto ctrs = cache.getCounters();
+        REQUIRE(ctrs.mHits + ctrs.mMisses == 40000);
+    }
+}
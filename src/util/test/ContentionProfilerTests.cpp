@@ -0,0 +1,92 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "lib/catch.hpp"
+#include "lib/json/json.h"
+#include "util/ContentionProfiler.h"
+
+#include <atomic>
+#include <thread>
+
+using namespace stellar;
+
+namespace
+{
+Json::Value
+findSite(std::string const& name)
+{
+    auto report = ContentionProfiler::report();
+    for (auto const& site : report["sites"])
+    {
+        if (site["name"].asString() == name)
+        {
+            return site;
+        }
+    }
+    return Json::Value();
+}
+}
+
+TEST_CASE("contention profiler", "[contention]")
+{
+    ProfiledMutex mutex("ContentionProfilerTests::mutex");
+    ContentionProfiler::reset();
+
+    SECTION("disabled records nothing")
+    {
+        ContentionProfiler::setEnabled(false);
+        {
+            std::lock_guard<ProfiledMutex> guard(mutex);
+        }
+        BlockingIOScope io("ContentionProfilerTests::io");
+        REQUIRE(findSite("ContentionProfilerTests::mutex").isNull());
+    }
+
+    SECTION("enabled records waits")
+    {
+        ContentionProfiler::setEnabled(true);
+        {
+            std::lock_guard<ProfiledMutex> guard(mutex);
+        }
+        auto site = findSite("ContentionProfilerTests::mutex");
+        REQUIRE(site["kind"].asString() == "mutex");
+        REQUIRE(site["main"]["count"].asUInt64() == 1);
+        REQUIRE(site["main"]["waits"].asUInt64() == 0);
+
+        std::atomic<bool> locked{false};
+        std::thread holder([&]() {
+            std::lock_guard<ProfiledMutex> guard(mutex);
+            locked = true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        });
+        while (!locked)
+        {
+            std::this_thread::yield();
+        }
+        {
+            std::lock_guard<ProfiledMutex> guard(mutex);
+        }
+        holder.join();
+
+        site = findSite("ContentionProfilerTests::mutex");
+        REQUIRE(site["main"]["count"].asUInt64() == 2);
+        REQUIRE(site["main"]["waits"].asUInt64() == 1);
+        REQUIRE(site["main"]["max_wait_ms"].asDouble() > 0);
+        REQUIRE(site["main"]["histogram_us"].size() == 1);
+        REQUIRE(site["other"]["count"].asUInt64() == 1);
+
+        {
+            BlockingIOScope io("ContentionProfilerTests::io");
+        }
+        site = findSite("ContentionProfilerTests::io");
+        REQUIRE(site["kind"].asString() == "io");
+        REQUIRE(site["main"]["waits"].asUInt64() == 1);
+
+        ContentionProfiler::reset();
+        REQUIRE(findSite("ContentionProfilerTests::mutex").isNull());
+        REQUIRE(findSite("ContentionProfilerTests::io").isNull());
+    }
+
+    ContentionProfiler::setEnabled(false);
+}
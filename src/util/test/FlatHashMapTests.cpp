@@ -0,0 +1,154 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "lib/catch.hpp"
+#include "util/FlatHashMap.h"
+#include "util/Math.h"
+#include "util/TxHashIndex.h"
+#include "util/UnorderedMap.h"
+#include <string>
+#include <vector>
+
+using namespace stellar;
+
+namespace
+{
+template <class M>
+UnorderedMap<int, std::string>
+contents(M const& m)
+{
+    UnorderedMap<int, std::string> res;
+    for (auto const& kv : m)
+    {
+        REQUIRE(res.emplace(kv.first, kv.second).second);
+    }
+    return res;
+}
+}
+
+TEST_CASE("FlatHashMap matches UnorderedMap", "[flathashmap]")
+{
+    FlatHashMap<int, std::string> flat;
+    UnorderedMap<int, std::string> ref;
+
+    for (size_t i = 0; i < 20000; ++i)
+    {
+        int key = rand_uniform<int>(0, 1000);
+        switch (rand_uniform<int>(0, 3))
+        {
+        case 0:
+        case 1:
+        {
+            auto val = std::to_string(i);
+            auto res = flat.emplace(key, val);
+            REQUIRE(res.second == ref.emplace(key, val).second);
+            REQUIRE(res.first->first == key);
+            REQUIRE(res.first->second == ref.at(key));
+            break;
+        }
+        case 2:
+        {
+            auto it = flat.find(key);
+            bool found = it != flat.end();
+            REQUIRE(found == (ref.erase(key) == 1));
+            if (found)
+            {
+                flat.erase(it);
+            }
+            break;
+        }
+        case 3:
+        {
+            auto it = flat.find(key);
+            auto refIt = ref.find(key);
+            REQUIRE((it == flat.end()) == (refIt == ref.end()));
+            if (it != flat.end())
+            {
+                it->second += "x";
+                refIt->second += "x";
+            }
+            break;
+        }
+        }
+        REQUIRE(flat.size() == ref.size());
+    }
+    REQUIRE(contents(flat) == ref);
+
+    SECTION("copies keep entries past deleted slots")
+    {
+        auto copy = flat;
+        REQUIRE(contents(copy) == ref);
+        for (auto const& kv : ref)
+        {
+            REQUIRE(copy.find(kv.first) != copy.end());
+        }
+    }
+
+    SECTION("swap and clear")
+    {
+        FlatHashMap<int, std::string> other;
+        other.swap(flat);
+        REQUIRE(flat.empty());
+        REQUIRE(flat.begin() == flat.end());
+        REQUIRE(contents(other) == ref);
+        other.clear();
+        REQUIRE(other.empty());
+        REQUIRE(other.find(0) == other.end());
+    }
+}
+
+TEST_CASE("FlatHashMap reuses stored hashes", "[flathashmap]")
+{
+    FlatHashMap<int, int> src;
+    for (int i = 0; i < 1000; ++i)
+    {
+        src.emplace(i, i * 2);
+    }
+
+    FlatHashMap<int, int> dst;
+    dst.reserve(src.size());
+    for (auto it = src.begin(); it != src.end(); ++it)
+    {
+        REQUIRE(it.hash() == src.hashKey(it->first));
+        REQUIRE(dst.find(it->first, it.hash()) == dst.end());
+        REQUIRE(dst.emplaceWithHash(it.hash(), it->first, it->second).second);
+        REQUIRE(dst.find(it->first, it.hash())->second == it->first * 2);
+    }
+    REQUIRE(dst.size() == src.size());
+    for (int i = 0; i < 1000; ++i)
+    {
+        REQUIRE(dst.find(i)->second == i * 2);
+    }
+}
+
+TEST_CASE("TxHashSet compares full hashes", "[flathashmap]")
+{
+    // Hashes sharing the prefix the hasher looks at land in the same bucket
+    // but must still be told apart
+    std::vector<Hash> hashes(100);
+    for (size_t i = 0; i < hashes.size(); ++i)
+    {
+        hashes[i][31] = static_cast<uint8_t>(i);
+    }
+
+    TxHashSet set;
+    for (auto const& h : hashes)
+    {
+        REQUIRE(set.insert(h));
+        REQUIRE(!set.insert(h));
+    }
+    REQUIRE(set.size() == hashes.size());
+    for (size_t i = 0; i < hashes.size(); i += 2)
+    {
+        REQUIRE(set.erase(hashes[i]));
+        REQUIRE(!set.erase(hashes[i]));
+    }
+    for (size_t i = 0; i < hashes.size(); ++i)
+    {
+        REQUIRE(set.contains(hashes[i]) == (i % 2 == 1));
+    }
+    set.clear();
+    REQUIRE(set.empty());
+    REQUIRE(!set.contains(hashes[1]));
+}
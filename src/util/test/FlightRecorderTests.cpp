@@ -0,0 +1,119 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "lib/catch.hpp"
+#include "lib/json/json.h"
+#include "util/FlightRecorder.h"
+#include "util/TmpDir.h"
+
+#include <filesystem>
+
+using namespace stellar;
+
+namespace
+{
+Json::Value
+parseDump(FlightRecorder const& recorder, uint32_t ledgers = 0)
+{
+    Json::Value root;
+    Json::Reader reader;
+    REQUIRE(reader.parse(recorder.dump(ledgers), root));
+    return root["traceEvents"];
+}
+
+size_t
+countFiles(std::filesystem::path const& dir)
+{
+    size_t n = 0;
+    for (auto const& entry : std::filesystem::directory_iterator(dir))
+    {
+        n += entry.is_regular_file();
+    }
+    return n;
+}
+}
+
+TEST_CASE("flight recorder keeps recent ledgers", "[flightrecorder]")
+{
+    using namespace std::chrono;
+    TmpDir tmp("flightrecorder");
+    std::filesystem::path dir(tmp.getName());
+
+    SECTION("disabled")
+    {
+        FlightRecorder recorder(0, milliseconds(1), dir);
+        REQUIRE(!recorder.enabled());
+        {
+            FlightRecorder::Span span(recorder, "close", "ledger", 2);
+        }
+        recorder.instant("externalize", "scp", 2);
+        REQUIRE(parseDump(recorder).size() == 0);
+        REQUIRE(recorder.ledgerClosed(2, seconds(1)).empty());
+    }
+
+    SECTION("events and filtering by ledger")
+    {
+        FlightRecorder recorder(10, milliseconds(0), dir);
+        for (uint32_t ledger = 2; ledger < 6; ++ledger)
+        {
+            FlightRecorder::Span span(recorder, "close", "ledger", ledger);
+            recorder.instant("externalize", "scp", ledger);
+            recorder.counter("queue", ledger, ledger * 10);
+        }
+        auto events = parseDump(recorder);
+        REQUIRE(events.size() == 12);
+        // Spans are recorded when they end, after what they enclose
+        REQUIRE(events[0]["ph"].asString() == "i");
+        REQUIRE(events[0]["args"]["ledger"].asUInt() == 2);
+        REQUIRE(events[1]["ph"].asString() == "C");
+        REQUIRE(events[1]["args"]["queue"].asInt64() == 20);
+        REQUIRE(events[2]["ph"].asString() == "X");
+        REQUIRE(events[2]["name"].asString() == "close");
+        REQUIRE(events[2]["ts"].asDouble() <= events[0]["ts"].asDouble());
+
+        auto last = parseDump(recorder, 2);
+        REQUIRE(last.size() == 6);
+        REQUIRE(last[0]["args"]["ledger"].asUInt() == 4);
+        REQUIRE(recorder.ledgerClosed(5, seconds(10)).empty());
+    }
+
+    SECTION("oldest events are overwritten")
+    {
+        FlightRecorder recorder(1, milliseconds(0), dir);
+        auto total = FlightRecorder::EVENTS_PER_LEDGER + 10;
+        for (uint32_t i = 0; i < total; ++i)
+        {
+            recorder.counter("queue", 2, i);
+        }
+        auto events = parseDump(recorder);
+        REQUIRE(events.size() == FlightRecorder::EVENTS_PER_LEDGER);
+        REQUIRE(events[0]["args"]["queue"].asInt64() == 10);
+        REQUIRE(events[events.size() - 1]["args"]["queue"].asInt64() ==
+                total - 1);
+    }
+
+    SECTION("slow closes are dumped")
+    {
+        FlightRecorder recorder(2, milliseconds(100), dir / "dumps");
+        recorder.instant("externalize", "scp", 5);
+        REQUIRE(recorder.ledgerClosed(5, milliseconds(50)).empty());
+
+        auto path = recorder.ledgerClosed(6, milliseconds(150));
+        REQUIRE(std::filesystem::exists(path));
+        REQUIRE(path.filename() == "flight-recorder-0000000006.json");
+
+        // Ledger 7 is already covered by the dump of ledger 6
+        REQUIRE(recorder.ledgerClosed(7, milliseconds(150)).empty());
+        REQUIRE(!recorder.ledgerClosed(8, milliseconds(150)).empty());
+
+        for (uint32_t ledger = 10; ledger < 40; ledger += 2)
+        {
+            REQUIRE(!recorder.ledgerClosed(ledger, seconds(1)).empty());
+        }
+        REQUIRE(countFiles(dir / "dumps") == FlightRecorder::MAX_DUMPS);
+        REQUIRE(std::filesystem::exists(dir / "dumps" /
+                                        "flight-recorder-0000000038.json"));
+        REQUIRE(!std::filesystem::exists(path));
+    }
+}
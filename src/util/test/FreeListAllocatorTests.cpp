@@ -0,0 +1,71 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "lib/catch.hpp"
+#include "util/FreeListAllocator.h"
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+using namespace stellar;
+
+namespace
+{
+struct Payload
+{
+    std::array<uint64_t, 5> mData;
+    explicit Payload(uint64_t v)
+    {
+        mData.fill(v);
+    }
+};
+
+std::shared_ptr<Payload>
+makePayload(uint64_t v)
+{
+    return std::allocate_shared<Payload>(FreeListAllocator<Payload>(), v);
+}
+}
+
+TEST_CASE("FreeListAllocator reuses freed blocks", "[freelistallocator]")
+{
+    auto first = makePayload(1);
+    auto firstAddr = first.get();
+    std::weak_ptr<Payload> weak = first;
+    first.reset();
+
+    // The block stays allocated while a weak_ptr refers to the control block
+    auto second = makePayload(2);
+    REQUIRE(second.get() != firstAddr);
+    weak.reset();
+
+    auto third = makePayload(3);
+    REQUIRE(third.get() == firstAddr);
+    REQUIRE(third->mData[0] == 3);
+    REQUIRE(second->mData[4] == 2);
+}
+
+TEST_CASE("ThreadLocalFreeList keeps a bounded number of blocks",
+          "[freelistallocator]")
+{
+    auto& list = ThreadLocalFreeList<48>::get();
+    size_t const count = ThreadLocalFreeList<48>::MAX_BLOCKS + 100;
+
+    std::vector<void*> blocks;
+    for (size_t i = 0; i < count; ++i)
+    {
+        blocks.emplace_back(list.allocate());
+    }
+    for (auto p : blocks)
+    {
+        list.deallocate(p);
+    }
+    REQUIRE(list.size() == ThreadLocalFreeList<48>::MAX_BLOCKS);
+
+    auto p = list.allocate();
+    REQUIRE(p == blocks[ThreadLocalFreeList<48>::MAX_BLOCKS - 1]);
+    REQUIRE(list.size() == ThreadLocalFreeList<48>::MAX_BLOCKS - 1);
+    list.deallocate(p);
+}
@@ -43,6 +43,26 @@ TEST_CASE("filesystem durable rename", "[fs]")
     REQUIRE(fs::exists(fileB.string()));
 }
 
+TEST_CASE("filesystem linkOrCopy", "[fs]")
+{
+    TmpDir tmp("fstests");
+    stdfs::path root(tmp.getName());
+    stdfs::path fileA = root / "fileA.txt";
+    stdfs::path fileB = root / "fileB.txt";
+    {
+        std::ofstream out(fileA.string());
+        out << "hi";
+    }
+    REQUIRE(fs::linkOrCopy(fileA.string(), fileB.string()));
+    REQUIRE(fs::exists(fileA.string()));
+    std::ifstream in(fileB.string());
+    std::string contents;
+    in >> contents;
+    REQUIRE(contents == "hi");
+    REQUIRE(!fs::linkOrCopy((root / "missing.txt").string(),
+                            (root / "fileC.txt").string()));
+}
+
 TEST_CASE("filesystem findfiles", "[fs]")
 {
     TmpDir tmp("fstests");
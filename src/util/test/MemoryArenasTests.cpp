@@ -0,0 +1,49 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "lib/catch.hpp"
+#include "util/MemoryArenas.h"
+#include <memory>
+#include <vector>
+
+using namespace stellar;
+
+TEST_CASE("memory arenas", "[memoryarenas]")
+{
+    auto before = getMemoryArenaStats(MemoryArena::BUCKET_MERGE);
+#ifdef USE_JEMALLOC
+    REQUIRE(before);
+#else
+    REQUIRE(!before);
+#endif
+
+    std::vector<std::unique_ptr<char[]>> blocks;
+    {
+        MemoryArenaScope scope(MemoryArena::BUCKET_MERGE);
+        // Scopes nest, restoring the outer arena when they end
+        {
+            MemoryArenaScope inner(MemoryArena::FLOOD);
+        }
+        for (size_t i = 0; i < 64; ++i)
+        {
+            blocks.emplace_back(std::make_unique<char[]>(64 * 1024));
+        }
+    }
+
+    auto during = getMemoryArenaStats(MemoryArena::BUCKET_MERGE);
+    if (before)
+    {
+        REQUIRE(during);
+        REQUIRE(during->mAllocated >= before->mAllocated + 64 * 64 * 1024);
+        REQUIRE(during->mResident >= during->mAllocated);
+    }
+
+    // Memory freed outside the scope still goes back to the arena
+    blocks.clear();
+    auto after = getMemoryArenaStats(MemoryArena::BUCKET_MERGE);
+    if (before)
+    {
+        REQUIRE(after->mAllocated < during->mAllocated);
+    }
+}
@@ -0,0 +1,54 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "lib/catch.hpp"
+#include "util/PrometheusReporter.h"
+
+#include "medida/buckets.h"
+#include "medida/counter.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
+
+using namespace stellar;
+
+TEST_CASE("prometheus reporter", "[prometheus]")
+{
+    using namespace std::chrono;
+    medida::MetricsRegistry registry;
+    registry.NewCounter({"ledger", "age", "current-seconds"}).set_count(7);
+    registry.NewMeter({"overlay", "byte", "read"}, "byte").Mark(100);
+    auto& timer = registry.NewTimer({"ledger", "ledger", "close"});
+    timer.Update(milliseconds(100));
+    timer.Update(milliseconds(300));
+    auto& buckets = registry.NewBuckets({"ledger", "age", "closed"},
+                                        {5000.0, 7000.0, 10000.0});
+    buckets.Update(milliseconds(4000));
+    buckets.Update(milliseconds(6000));
+    buckets.Update(milliseconds(20000));
+
+    auto text = PrometheusReporter().report(registry);
+    auto has = [&](std::string const& line) {
+        return text.find(line + "\n") != std::string::npos;
+    };
+
+    REQUIRE(has("# TYPE stellar_core_ledger_age_current_seconds gauge"));
+    REQUIRE(has("stellar_core_ledger_age_current_seconds 7"));
+    REQUIRE(has("# TYPE stellar_core_overlay_byte_read_total counter"));
+    REQUIRE(has("stellar_core_overlay_byte_read_total 100"));
+
+    REQUIRE(has("# TYPE stellar_core_ledger_ledger_close_seconds summary"));
+    REQUIRE(has("stellar_core_ledger_ledger_close_seconds_count 2"));
+    REQUIRE(has("stellar_core_ledger_ledger_close_seconds_sum 0.4"));
+    REQUIRE(text.find("stellar_core_ledger_ledger_close_seconds{quantile=") !=
+            std::string::npos);
+
+    REQUIRE(has("# TYPE stellar_core_ledger_age_closed_seconds histogram"));
+    REQUIRE(has("stellar_core_ledger_age_closed_seconds_bucket{le=\"5\"} 1"));
+    REQUIRE(has("stellar_core_ledger_age_closed_seconds_bucket{le=\"7\"} 2"));
+    REQUIRE(has("stellar_core_ledger_age_closed_seconds_bucket{le=\"10\"} 2"));
+    REQUIRE(
+        has("stellar_core_ledger_age_closed_seconds_bucket{le=\"+Inf\"} 3"));
+    REQUIRE(has("stellar_core_ledger_age_closed_seconds_count 3"));
+}
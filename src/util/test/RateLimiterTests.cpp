@@ -0,0 +1,45 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "lib/catch.hpp"
+#include "util/RateLimiter.h"
+
+#include <thread>
+#include <vector>
+
+using namespace stellar;
+
+TEST_CASE("rate limiter paces shared use", "[ratelimiter]")
+{
+    using namespace std::chrono;
+
+    SECTION("unlimited")
+    {
+        RateLimiter limiter(0);
+        auto start = steady_clock::now();
+        for (int i = 0; i < 1000; ++i)
+        {
+            limiter.acquire(1000000);
+        }
+        REQUIRE(steady_clock::now() - start < seconds(1));
+    }
+
+    SECTION("limited across threads")
+    {
+        // 4 threads taking 50 each at 1000 per second: the first 50 are free,
+        // the other 150 take at least 150ms
+        RateLimiter limiter(1000);
+        auto start = steady_clock::now();
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 4; ++i)
+        {
+            threads.emplace_back([&limiter]() { limiter.acquire(50); });
+        }
+        for (auto& t : threads)
+        {
+            t.join();
+        }
+        REQUIRE(steady_clock::now() - start >= milliseconds(150));
+    }
+}
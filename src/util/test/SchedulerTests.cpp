@@ -5,9 +5,12 @@
 #include "util/Scheduler.h"
 
 #include "lib/catch.hpp"
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
 #include "util/Logging.h"
 #include "util/Timer.h"
 #include <chrono>
+#include <vector>
 
 using namespace stellar;
 
@@ -125,3 +128,59 @@ TEST_CASE("scheduler load shedding -- overload", "[scheduler]")
                sched.stats().mActionsDroppedDueToOverload;
     CHECK(sched.stats().mActionsEnqueued == tot);
 }
+
+TEST_CASE("scheduler tiers and deadlines", "[scheduler]")
+{
+    std::chrono::seconds window(10);
+    VirtualClock clock;
+    Scheduler sched(clock, window);
+    medida::MetricsRegistry metrics;
+    auto& scpDelay = metrics.NewTimer({"scheduler", "queue-delay", "scp"});
+
+    using Tier = Scheduler::ActionTier;
+    sched.setQueuePolicy("scp", {Tier::CONSENSUS, {}, &scpDelay});
+    sched.setQueuePolicy("misc", {Tier::BACKGROUND, {}, nullptr});
+    sched.setQueuePolicy(
+        "tx", {Tier::TX_ADMISSION, std::chrono::microseconds(100), nullptr});
+
+    std::vector<std::string> ran;
+    auto record = [&](std::string name) {
+        return [&ran, name] { ran.emplace_back(name); };
+    };
+
+    SECTION("more important tiers run first")
+    {
+        for (auto name : {"misc", "a", "tx", "scp"})
+        {
+            sched.enqueue(name, record(name),
+                          Scheduler::ActionType::NORMAL_ACTION);
+        }
+        while (sched.size() != 0)
+        {
+            sched.runOne();
+        }
+        CHECK(ran == std::vector<std::string>{"scp", "tx", "a", "misc"});
+        CHECK(scpDelay.count() == 1);
+    }
+
+    SECTION("overdue droppable actions of lower tiers are shed")
+    {
+        for (size_t i = 0; i < 10; ++i)
+        {
+            sched.enqueue("tx", record("tx"),
+                          Scheduler::ActionType::DROPPABLE_ACTION);
+        }
+        sched.enqueue("scp", [&] { clock.sleep_for(window / 2); },
+                      Scheduler::ActionType::NORMAL_ACTION);
+        sched.enqueue("scp", record("scp"),
+                      Scheduler::ActionType::NORMAL_ACTION);
+
+        // The tx queue is past its deadline once the first scp action ran,
+        // and is shed as soon as the second one runs
+        sched.runOne();
+        sched.runOne();
+        CHECK(sched.stats().mActionsDroppedDueToOverload == 10);
+        CHECK(sched.size() == 0);
+        CHECK(ran == std::vector<std::string>{"scp"});
+    }
+}
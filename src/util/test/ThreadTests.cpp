@@ -0,0 +1,58 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "lib/catch.hpp"
+#include "util/Thread.h"
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+using namespace stellar;
+
+TEST_CASE("parse CPU lists", "[thread]")
+{
+    REQUIRE(parseCpuList("").empty());
+    REQUIRE(parseCpuList("3") == std::vector<int>{3});
+    REQUIRE(parseCpuList("0-3,8,10-11") ==
+            std::vector<int>{0, 1, 2, 3, 8, 10, 11});
+    REQUIRE(parseCpuList("5,1-2,2") == std::vector<int>{1, 2, 5});
+
+    for (auto bad : {",", "1,", ",1", "1,,2", "3-1", "a", "-1", "1-", "1 2",
+                     "1234567"})
+    {
+        INFO(bad);
+        REQUIRE_THROWS_AS(parseCpuList(bad), std::invalid_argument);
+    }
+}
+
+TEST_CASE("pin thread to CPUs", "[thread]")
+{
+    REQUIRE(pinCurrentThreadToCpus({}));
+#ifdef __linux__
+    // Pinning a fresh thread to every CPU it may already use only checks
+    // that the call goes through without restricting anything
+    bool pinned = false;
+    std::thread t([&pinned]() {
+        cpu_set_t set;
+        if (sched_getaffinity(0, sizeof(set), &set) != 0)
+        {
+            return;
+        }
+        std::vector<int> cpus;
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        {
+            if (CPU_ISSET(cpu, &set))
+            {
+                cpus.emplace_back(cpu);
+            }
+        }
+        pinned = pinCurrentThreadToCpus(cpus);
+    });
+    t.join();
+    REQUIRE(pinned);
+#endif
+}
@@ -0,0 +1,141 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "lib/catch.hpp"
+#include "util/Timer.h"
+#include "util/TimerWheel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+using namespace stellar;
+using namespace std::chrono;
+
+TEST_CASE("timer wheel expires entries in time", "[timer][timerwheel]")
+{
+    TimerWheel::time_point start(hours(1));
+    TimerWheel wheel(start);
+
+    // Spread across all levels, including past the top one
+    std::vector<milliseconds> offsets{
+        milliseconds(0),       milliseconds(1),      milliseconds(255),
+        milliseconds(256),     milliseconds(1000),   seconds(65),
+        minutes(90),           hours(24 * 60),       milliseconds(70000),
+        microseconds(1500000), milliseconds(65536),  milliseconds(16777216)};
+    std::vector<TimerWheel::Entry> entries(offsets.size());
+    for (size_t i = 0; i < offsets.size(); ++i)
+    {
+        entries[i].mWhen = start + offsets[i];
+        wheel.insert(entries[i]);
+    }
+    REQUIRE(wheel.size() == offsets.size());
+
+    // Removed entries never expire
+    TimerWheel::Entry removed;
+    removed.mWhen = start + seconds(5);
+    wheel.insert(removed);
+    wheel.remove(removed);
+    REQUIRE(!removed.isScheduled());
+
+    auto now = start;
+    std::vector<TimerWheel::Entry*> due;
+    while (wheel.size() > 0)
+    {
+        auto next = wheel.next();
+        REQUIRE(next >= now);
+        // Jump like a real timer would, or creep along where it's close
+        now = std::max(next, now + milliseconds(1));
+        due.clear();
+        wheel.advance(now, due);
+        for (auto e : due)
+        {
+            REQUIRE(e->mWhen <= now);
+            REQUIRE(e->mWhen > now - milliseconds(2));
+            REQUIRE(!e->isScheduled());
+        }
+    }
+}
+
+TEST_CASE("timer wheel matches sorted expiries", "[timer][timerwheel]")
+{
+    TimerWheel::time_point start(seconds(12345));
+    TimerWheel wheel(start);
+    std::default_random_engine gen(1234);
+    std::uniform_int_distribution<int64_t> dist(0, 5 * 60 * 1000);
+
+    std::vector<TimerWheel::Entry> entries(2000);
+    std::vector<TimerWheel::time_point> expected;
+    for (auto& e : entries)
+    {
+        e.mWhen = start + milliseconds(dist(gen));
+        wheel.insert(e);
+    }
+    // Drop every other one again
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        if (i % 2 == 0)
+        {
+            wheel.remove(entries[i]);
+        }
+        else
+        {
+            expected.emplace_back(entries[i].mWhen);
+        }
+    }
+    std::sort(expected.begin(), expected.end());
+
+    std::vector<TimerWheel::time_point> expired;
+    std::vector<TimerWheel::Entry*> due;
+    for (auto now = start; wheel.size() > 0; now += milliseconds(7))
+    {
+        due.clear();
+        wheel.advance(now, due);
+        std::vector<TimerWheel::time_point> batch;
+        for (auto e : due)
+        {
+            batch.emplace_back(e->mWhen);
+        }
+        std::sort(batch.begin(), batch.end());
+        expired.insert(expired.end(), batch.begin(), batch.end());
+    }
+    REQUIRE(expired == expected);
+}
+
+TEST_CASE("real time timers re-armed from their callback",
+          "[timer][timerwheel]")
+{
+    VirtualClock clock(VirtualClock::REAL_TIME);
+    VirtualTimer timer(clock);
+    int fired = 0;
+    std::function<void()> rearm = [&]() {
+        if (++fired < 5)
+        {
+            timer.expires_from_now(milliseconds(1));
+            timer.async_wait(rearm, VirtualTimer::onFailureNoop);
+        }
+    };
+    timer.expires_from_now(milliseconds(1));
+    timer.async_wait(rearm, VirtualTimer::onFailureNoop);
+
+    auto deadline = steady_clock::now() + seconds(10);
+    while (fired < 5 && steady_clock::now() < deadline)
+    {
+        clock.crank(false);
+    }
+    REQUIRE(fired == 5);
+
+    // Cancelling an armed timer removes it from the clock right away
+    bool aborted = false;
+    timer.expires_from_now(hours(1));
+    timer.async_wait([]() {},
+                     [&](asio::error_code const& ec) {
+                         aborted = ec == asio::error::operation_aborted;
+                     });
+    REQUIRE(clock.next() <= steady_clock::now() + hours(1));
+    timer.cancel();
+    REQUIRE(aborted);
+    REQUIRE(clock.next() == VirtualClock::time_point::max());
+}
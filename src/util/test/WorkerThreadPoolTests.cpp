@@ -0,0 +1,89 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "lib/catch.hpp"
+#include "util/WorkerThreadPool.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace stellar;
+
+TEST_CASE("worker thread pool", "[workerthreadpool]")
+{
+    SECTION("join runs all jobs, including ones posted by jobs")
+    {
+        std::atomic<int> ran{0};
+        WorkerThreadPool pool(4);
+        for (int i = 0; i < 100; ++i)
+        {
+            pool.post(
+                [&]() {
+                    ++ran;
+                    pool.post([&]() { ++ran; }, WorkerPriority::BULK);
+                },
+                WorkerPriority::NORMAL);
+        }
+        pool.join();
+        REQUIRE(ran == 200);
+    }
+
+    SECTION("most urgent priority runs first")
+    {
+        std::promise<void> release;
+        auto released = release.get_future().share();
+        std::mutex mutex;
+        std::vector<WorkerPriority> order;
+
+        WorkerThreadPool pool(1);
+        pool.post([released]() { released.wait(); }, WorkerPriority::NORMAL);
+        for (auto p : {WorkerPriority::BULK, WorkerPriority::NORMAL,
+                       WorkerPriority::CRITICAL})
+        {
+            pool.post(
+                [&, p]() {
+                    std::lock_guard<std::mutex> guard(mutex);
+                    order.emplace_back(p);
+                },
+                p);
+        }
+        release.set_value();
+        pool.join();
+        REQUIRE(order ==
+                std::vector<WorkerPriority>{WorkerPriority::CRITICAL,
+                                            WorkerPriority::NORMAL,
+                                            WorkerPriority::BULK});
+    }
+
+    SECTION("bulk jobs leave a thread for critical ones")
+    {
+        std::promise<void> release;
+        auto released = release.get_future().share();
+        std::atomic<int> bulkRan{0};
+        std::promise<void> critical;
+
+        WorkerThreadPool pool(3);
+        for (int i = 0; i < 10; ++i)
+        {
+            pool.post(
+                [&, released]() {
+                    released.wait();
+                    ++bulkRan;
+                },
+                WorkerPriority::BULK);
+        }
+        pool.post([&]() { critical.set_value(); }, WorkerPriority::CRITICAL);
+
+        auto status = critical.get_future().wait_for(std::chrono::seconds(10));
+        REQUIRE(status == std::future_status::ready);
+        REQUIRE(bulkRan == 0);
+        release.set_value();
+        pool.join();
+        REQUIRE(bulkRan == 10);
+    }
+}
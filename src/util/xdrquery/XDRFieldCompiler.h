@@ -0,0 +1,447 @@
+// Copyright 2024 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#pragma once
+
+#include "util/xdrquery/XDRFieldResolver.h"
+
+#include <cstring>
+#include <optional>
+#include <typeindex>
+#include <utility>
+
+namespace xdrquery
+{
+// Getter of the field at a given path, compiled for one XDR type. Takes a
+// pointer to a value of that type.
+using FieldAccessor = std::function<ResultType(void const*)>;
+
+namespace internal
+{
+using namespace xdr;
+using namespace stellar;
+
+using PathIter = std::vector<std::string>::const_iterator;
+
+template <typename T>
+FieldAccessor compileField(T const& sample,
+                           std::vector<std::string> const& path, PathIter it);
+
+// Types `getXDRField` returns the value of, rather than descending into.
+template <typename T>
+struct IsLeafField
+    : std::bool_constant<xdr_traits<T>::is_numeric || xdr_traits<T>::is_enum ||
+                         std::is_same_v<PublicKey, T> ||
+                         std::is_same_v<SCAddress, T>>
+{
+};
+
+template <uint32_t N> struct IsLeafField<xstring<N>> : std::true_type
+{
+};
+
+template <uint32_t N> struct IsLeafField<opaque_vec<N>> : std::true_type
+{
+};
+
+template <uint32_t N> struct IsLeafField<opaque_array<N>> : std::true_type
+{
+};
+
+template <typename T> struct IsPointerField : std::false_type
+{
+};
+
+template <typename T> struct IsPointerField<pointer<T>> : std::true_type
+{
+};
+
+// Same representation of the leaf fields as XDRFieldResolver.
+template <uint32_t N>
+ResultType
+leafValue(xstring<N> const& t)
+{
+    return std::string(t);
+}
+
+template <uint32_t N>
+ResultType
+leafValue(opaque_vec<N> const& v)
+{
+    return binToHex(ByteSlice(v.data(), v.size()));
+}
+
+template <uint32_t N>
+ResultType
+leafValue(opaque_array<N> const& v)
+{
+    return binToHex(ByteSlice(v.data(), v.size()));
+}
+
+template <typename T>
+ResultType
+leafValue(T const& t)
+{
+    if constexpr (xdr_traits<T>::is_enum)
+    {
+        return std::string(xdr_traits<T>::enum_name(t));
+    }
+    else if constexpr (std::is_same_v<PublicKey, T>)
+    {
+        return stellar::KeyUtils::toStrKey(t);
+    }
+    else if constexpr (std::is_same_v<SCAddress, T>)
+    {
+        switch (t.type())
+        {
+        case SC_ADDRESS_TYPE_CONTRACT:
+            return stellar::strKey::toStrKey(stellar::strKey::STRKEY_CONTRACT,
+                                             t.contractId())
+                .value;
+        case SC_ADDRESS_TYPE_ACCOUNT:
+            return stellar::KeyUtils::toStrKey(t.accountId());
+        default:
+            return std::string("UNKNOWN");
+        }
+    }
+    else
+    {
+        return t;
+    }
+}
+
+inline XDRQueryError
+invalidPathError(std::vector<std::string> const& path)
+{
+    return XDRQueryError(fmt::format(FMT_STRING("Invalid field path: '{}'."),
+                                     fmt::join(path, ".")));
+}
+
+// Archive locating the field named `*mIter` among the fields of a struct or
+// union and compiling the accessor of the rest of the path for its type.
+struct FieldFinder
+{
+    FieldFinder(std::vector<std::string> const& path, PathIter it)
+        : mPath(path), mIter(it)
+    {
+    }
+
+    template <typename T>
+    void
+    operator()(T const& t, char const* fieldName)
+    {
+        size_t index = mIndex++;
+        if (!mFoundIndex && fieldName != nullptr && *mIter == fieldName)
+        {
+            mFoundIndex = index;
+            mAccessor = compileField(t, mPath, std::next(mIter));
+        }
+    }
+
+    std::vector<std::string> const& mPath;
+    PathIter const mIter;
+    size_t mIndex = 0;
+    std::optional<size_t> mFoundIndex;
+    FieldAccessor mAccessor;
+};
+
+// Archive passing the field at `mTarget` among the fields of a struct or
+// union to its accessor. Skipping the other fields only costs counting them.
+struct FieldGetter
+{
+    FieldGetter(size_t target, FieldAccessor const& accessor)
+        : mTarget(target), mAccessor(accessor)
+    {
+    }
+
+    template <typename T>
+    void
+    operator()(T const& t, char const*)
+    {
+        if (mIndex++ == mTarget)
+        {
+            mResult = mAccessor(&t);
+        }
+    }
+
+    size_t const mTarget;
+    FieldAccessor const& mAccessor;
+    size_t mIndex = 0;
+    ResultType mResult;
+};
+
+template <typename T>
+FieldAccessor
+indexedFieldAccessor(size_t index, FieldAccessor&& accessor)
+{
+    return [index, accessor = std::move(accessor)](void const* p) {
+        FieldGetter getter(index, accessor);
+        xdr_traits<T>::save(getter, *static_cast<T const*>(p));
+        return getter.mResult;
+    };
+}
+
+template <typename T>
+FieldAccessor
+compileAsset(std::vector<std::string> const& path, PathIter it)
+{
+    if (it == path.end())
+    {
+        // If non-leaf field is requested, then we must be looking for
+        // non-native asset.
+        return [](void const* p) -> ResultType {
+            if (static_cast<T const*>(p)->type() == ASSET_TYPE_NATIVE)
+            {
+                return std::string("NATIVE");
+            }
+            return std::nullopt;
+        };
+    }
+    bool isPoolField = false;
+    if constexpr (std::is_same_v<TrustLineAsset, T>)
+    {
+        isPoolField = *it == "liquidityPoolID";
+    }
+    if (!isPoolField && *it != "assetCode" && *it != "issuer")
+    {
+        throw invalidPathError(path);
+    }
+    if (std::next(it) != path.end())
+    {
+        throw XDRQueryError(
+            fmt::format(FMT_STRING("Encountered leaf field in the middle "
+                                   "of the field path: '{}'."),
+                        *it));
+    }
+
+    if (isPoolField)
+    {
+        return [](void const* p) -> ResultType {
+            auto const& asset = *static_cast<T const*>(p);
+            if constexpr (std::is_same_v<TrustLineAsset, T>)
+            {
+                if (asset.type() == ASSET_TYPE_POOL_SHARE)
+                {
+                    return leafValue(asset.liquidityPoolID());
+                }
+            }
+            return std::nullopt;
+        };
+    }
+    bool isCode = *it == "assetCode";
+    return [isCode](void const* p) -> ResultType {
+        auto const& asset = *static_cast<T const*>(p);
+        if (asset.type() != ASSET_TYPE_CREDIT_ALPHANUM4 &&
+            asset.type() != ASSET_TYPE_CREDIT_ALPHANUM12)
+        {
+            return std::nullopt;
+        }
+        if (!isCode)
+        {
+            return stellar::KeyUtils::toStrKey(stellar::getIssuer(asset));
+        }
+        std::string code;
+        if (asset.type() == ASSET_TYPE_CREDIT_ALPHANUM4)
+        {
+            stellar::assetCodeToStr(asset.alphaNum4().assetCode, code);
+        }
+        else
+        {
+            stellar::assetCodeToStr(asset.alphaNum12().assetCode, code);
+        }
+        return code;
+    };
+}
+
+template <typename T>
+FieldAccessor
+compileUnion(T const& sample, std::vector<std::string> const& path,
+             PathIter it)
+{
+    // The discriminant is always archived first, followed by the selected
+    // arm, if it isn't void.
+    FieldFinder finder(path, it);
+    xdr_traits<T>::save(finder, sample);
+    if (finder.mFoundIndex == size_t{0})
+    {
+        return indexedFieldAccessor<T>(0, std::move(finder.mAccessor));
+    }
+    for (auto const c : sample._xdr_case_values())
+    {
+        char const* armName = xdr_traits<T>::union_field_name(c);
+        if (armName == nullptr || *it != armName)
+        {
+            continue;
+        }
+        auto armSample = sample;
+        armSample._xdr_discriminant(c, false);
+        FieldFinder armFinder(path, it);
+        xdr_traits<T>::save(armFinder, armSample);
+        releaseAssert(armFinder.mFoundIndex == size_t{1});
+        auto getArm =
+            indexedFieldAccessor<T>(1, std::move(armFinder.mAccessor));
+        return [armName, getArm = std::move(getArm)](void const* p) {
+            auto const& u = *static_cast<T const*>(p);
+            char const* selected =
+                xdr_traits<T>::union_field_name(u._xdr_discriminant());
+            if (selected == nullptr || std::strcmp(selected, armName) != 0)
+            {
+                return ResultType();
+            }
+            return getArm(p);
+        };
+    }
+    throw invalidPathError(path);
+}
+
+// Resolves the rest of the path starting at `it` against the type of
+// `sample`, which is only used to find its fields, and returns the accessor
+// of the field the path ends at. Throws XDRQueryError in the same cases as
+// `getXDRFieldValidated`.
+template <typename T>
+FieldAccessor
+compileField(T const& sample, std::vector<std::string> const& path,
+             PathIter it)
+{
+    if constexpr (IsLeafField<T>::value)
+    {
+        if (it != path.end())
+        {
+            throw XDRQueryError(
+                fmt::format(FMT_STRING("Encountered leaf field in the middle "
+                                       "of the field path: '{}'."),
+                            *std::prev(it)));
+        }
+        return [](void const* p) {
+            return leafValue(*static_cast<T const*>(p));
+        };
+    }
+    else if constexpr (std::is_same_v<Asset, T> ||
+                       std::is_same_v<TrustLineAsset, T>)
+    {
+        return compileAsset<T>(path, it);
+    }
+    else if constexpr (IsPointerField<T>::value)
+    {
+        using ValueT = typename T::element_type;
+        auto getValue = sample ? compileField(*sample, path, it)
+                               : compileField(ValueT(), path, it);
+        bool isLeaf = it == path.end();
+        return [isLeaf, getValue = std::move(getValue)](void const* p) {
+            auto const& ptr = *static_cast<T const*>(p);
+            if (ptr)
+            {
+                return getValue(ptr.get());
+            }
+            return isLeaf ? ResultType(NullField()) : ResultType();
+        };
+    }
+    else if constexpr (xdr_traits<T>::is_container)
+    {
+        throw XDRQueryError(
+            fmt::format(FMT_STRING("Array fields are not supported: '{}'."),
+                        *std::prev(it)));
+    }
+    else
+    {
+        if (it == path.end())
+        {
+            throw XDRQueryError("Field path must end with a primitive field.");
+        }
+        if constexpr (xdr_traits<T>::is_union)
+        {
+            return compileUnion(sample, path, it);
+        }
+        else
+        {
+            FieldFinder finder(path, it);
+            xdr_traits<T>::save(finder, sample);
+            if (!finder.mFoundIndex)
+            {
+                throw invalidPathError(path);
+            }
+            return indexedFieldAccessor<T>(*finder.mFoundIndex,
+                                           std::move(finder.mAccessor));
+        }
+    }
+}
+} // namespace internal
+
+// Compiles the path to a field of T into its accessor, so that getting the
+// field from a message only goes over the fields on the path, instead of
+// matching every field of the message by name as `getXDRField` does. Throws
+// XDRQueryError if the path is invalid for T.
+template <typename T>
+FieldAccessor
+compileXDRField(std::vector<std::string> const& fieldPath)
+{
+    return internal::compileField(T(), fieldPath, fieldPath.begin());
+}
+
+// Accessors of the fields of a query, compiled for the XDR type it is
+// evaluated against the first time each field is resolved. The eval nodes of
+// the query own the field paths, so accessors are keyed by their address.
+class CompiledFieldResolver
+{
+  public:
+    template <typename T>
+    FieldResolver
+    resolve(T const& xdrMessage)
+    {
+        if (mType != std::type_index(typeid(T)))
+        {
+            mType.emplace(typeid(T));
+            mAccessors.clear();
+        }
+        return [this, &xdrMessage](std::vector<std::string> const& fieldPath) {
+            return getAccessor<T>(fieldPath)(&xdrMessage);
+        };
+    }
+
+  private:
+    template <typename T>
+    FieldAccessor const&
+    getAccessor(std::vector<std::string> const& fieldPath)
+    {
+        for (auto const& [path, accessor] : mAccessors)
+        {
+            if (path == &fieldPath)
+            {
+                return accessor;
+            }
+        }
+        return mAccessors
+            .emplace_back(&fieldPath, compileXDRField<T>(fieldPath))
+            .second;
+    }
+
+    std::optional<std::type_index> mType;
+    std::vector<std::pair<std::vector<std::string> const*, FieldAccessor>>
+        mAccessors;
+};
+
+} // namespace xdrquery
+
+namespace xdr
+{
+template <> struct archive_adapter<xdrquery::internal::FieldFinder>
+{
+    template <typename T>
+    static void
+    apply(xdrquery::internal::FieldFinder& ar, T&& t, char const* fieldName)
+    {
+        ar(std::forward<T>(t), fieldName);
+    }
+};
+
+template <> struct archive_adapter<xdrquery::internal::FieldGetter>
+{
+    template <typename T>
+    static void
+    apply(xdrquery::internal::FieldGetter& ar, T&& t, char const* fieldName)
+    {
+        ar(std::forward<T>(t), fieldName);
+    }
+};
+}
@@ -4,7 +4,7 @@
 
 #pragma once
 
-#include "util/xdrquery/XDRFieldResolver.h"
+#include "util/xdrquery/XDRFieldCompiler.h"
 #include "util/xdrquery/XDRQueryEval.h"
 #include "util/xdrquery/XDRQueryParser.h"
 
@@ -14,25 +14,15 @@
 namespace xdrquery
 {
 
-template <typename T>
-FieldResolver
-createFieldResolver(T const& xdrMessage, bool validate)
-{
-    return [&xdrMessage, validate](std::vector<std::string> const& fieldPath) {
-        if (validate)
-        {
-            return getXDRFieldValidated(xdrMessage, fieldPath);
-        }
-        return getXDRField(xdrMessage, fieldPath);
-    };
-}
-
 // Helper to match multiple XDR messages of the same type using the provided
 // query.
 // Queries may consist of literals, XDR fields, comparisons and boolean
 // operations, e.g.
 // `data.account.balance >= 100000 || data.trustLine.balance < 5000`
 // See more examples in `XDRQueryTests`.
+// Each field is compiled into an accessor for the message type when it is
+// first evaluated, and `&&`/`||` don't evaluate their right operand when the
+// left one decides the result.
 class XDRMatcher
 {
   public:
@@ -45,10 +35,8 @@ class XDRMatcher
         // Lazily parse the query in order to simplify exception handling as we
         // might throw XDRQueryError both during query parsing and query
         // execution against XDR.
-        bool firstEval = false;
         if (mEvalRoot == nullptr)
         {
-            firstEval = true;
             auto statement = parseXDRQuery(mQuery);
             if (!std::holds_alternative<std::shared_ptr<BoolEvalNode>>(
                     statement))
@@ -57,12 +45,13 @@ class XDRMatcher
             }
             mEvalRoot = std::get<std::shared_ptr<BoolEvalNode>>(statement);
         }
-        return mEvalRoot->evalBool(createFieldResolver(xdrMessage, firstEval));
+        return mEvalRoot->evalBool(mFields.resolve(xdrMessage));
     }
 
   private:
     std::string const mQuery;
     std::shared_ptr<BoolEvalNode> mEvalRoot;
+    CompiledFieldResolver mFields;
 };
 
 // Helper to extract leaf fields from multiple XDR messages using the provided
@@ -81,10 +70,8 @@ class XDRFieldExtractor
         // Lazily parse the query in order to simplify exception handling as we
         // might throw XDRQueryError both during query parsing and query
         // execution against XDR.
-        bool firstEval = false;
         if (mFieldList == nullptr)
         {
-            firstEval = true;
             auto statement = parseXDRQuery(mQuery);
             if (!std::holds_alternative<std::shared_ptr<FieldList>>(statement))
             {
@@ -93,8 +80,7 @@ class XDRFieldExtractor
             }
             mFieldList = std::get<std::shared_ptr<FieldList>>(statement);
         }
-        return mFieldList->getValues(
-            createFieldResolver(xdrMessage, firstEval));
+        return mFieldList->getValues(mFields.resolve(xdrMessage));
     }
 
     // Gets names of the fields from the query.
@@ -103,6 +89,7 @@ class XDRFieldExtractor
   private:
     std::string mQuery;
     std::shared_ptr<FieldList> mFieldList;
+    CompiledFieldResolver mFields;
 };
 
 // Helper that allows aggregating values of fields in multiple XDR messages
@@ -123,10 +110,8 @@ class XDRAccumulator
         // Lazily parse the query in order to simplify exception handling as we
         // might throw XDRQueryError both during query parsing and query
         // execution against XDR.
-        bool firstEval = false;
         if (mAccumulatorList == nullptr)
         {
-            firstEval = true;
             auto statement = parseXDRQuery(mQuery);
             if (!std::holds_alternative<std::shared_ptr<AccumulatorList>>(
                     statement))
@@ -137,7 +122,7 @@ class XDRAccumulator
             mAccumulatorList =
                 std::get<std::shared_ptr<AccumulatorList>>(statement);
         }
-        mAccumulatorList->addEntry(createFieldResolver(xdrMessage, firstEval));
+        mAccumulatorList->addEntry(mFields.resolve(xdrMessage));
     }
 
     // Gets the accumulators with aggregated values of each field.
@@ -146,5 +131,6 @@ class XDRAccumulator
   private:
     std::string mQuery;
     std::shared_ptr<AccumulatorList> mAccumulatorList;
+    CompiledFieldResolver mFields;
 };
 } // namespace xdrquery
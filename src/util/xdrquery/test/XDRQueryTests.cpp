@@ -295,6 +295,85 @@ TEST_CASE("XDR field resolver", "[xdrquery]")
     }
 }
 
+TEST_CASE("XDR field compiler", "[xdrquery]")
+{
+    LedgerEntry nullDest = makeAccountEntry(5);
+    nullDest.data.account().inflationDest.reset();
+    std::vector<LedgerEntry> entries = {makeAccountEntry(-100), nullDest,
+                                        makeOfferEntry("USD"),
+                                        makeOfferEntry("USD123")};
+    entries.emplace_back().data.type(TRUSTLINE);
+    entries.back().data.trustLine().asset.type(ASSET_TYPE_POOL_SHARE);
+    entries.back().data.trustLine().asset.liquidityPoolID()[1] = 7;
+
+    SECTION("accessors match the field resolver")
+    {
+        std::vector<std::vector<std::string>> paths = {
+            {"lastModifiedLedgerSeq"},
+            {"data", "type"},
+            {"data", "account", "accountID"},
+            {"data", "account", "balance"},
+            {"data", "account", "inflationDest"},
+            {"data", "account", "homeDomain"},
+            {"data", "account", "thresholds"},
+            {"data", "account", "ext", "v1", "ext", "v2", "ext", "v3",
+             "seqTime"},
+            {"data", "offer", "selling"},
+            {"data", "offer", "selling", "assetCode"},
+            {"data", "offer", "selling", "issuer"},
+            {"data", "trustLine", "asset", "liquidityPoolID"},
+            {"data", "trustLine", "asset"}};
+        for (auto const& path : paths)
+        {
+            auto accessor = compileXDRField<LedgerEntry>(path);
+            for (auto const& entry : entries)
+            {
+                auto expected = getXDRField(entry, path);
+                auto actual = accessor(&entry);
+                REQUIRE(actual.has_value() == expected.has_value());
+                if (expected)
+                {
+                    compareVariants(*actual, *expected);
+                }
+            }
+        }
+    }
+
+    SECTION("bad paths throw exception")
+    {
+        for (std::vector<std::string> const& path :
+             std::vector<std::vector<std::string>>{
+                 {"data", "account", "noSuchField"},
+                 {"data2", "account", "balance"},
+                 {"data", "account2", "balance"},
+                 {"data", "account", "balance", "balance2"},
+                 {"data", "account"},
+                 {"data", "account", "signers"},
+                 {"data", "offer", "selling", "liquidityPoolID"}})
+        {
+            REQUIRE_THROWS_AS(compileXDRField<LedgerEntry>(path),
+                              XDRQueryError);
+        }
+    }
+
+    SECTION("matcher compiles once per type")
+    {
+        XDRMatcher matcher("data.account.balance < 0 || "
+                           "data.offer.selling.assetCode == \"USD\"");
+        std::vector<bool> matches;
+        for (auto const& entry : entries)
+        {
+            matches.push_back(matcher.matchXDR(entry));
+        }
+        REQUIRE(matches ==
+                std::vector<bool>{true, false, true, false, false});
+
+        LedgerKey key;
+        key.type(OFFER);
+        REQUIRE_THROWS_AS(matcher.matchXDR(key), XDRQueryError);
+    }
+}
+
 TEST_CASE("XDR matcher", "[xdrquery]")
 {
     std::vector<LedgerEntry> entries = {
@@ -157,10 +157,14 @@ BasicWork::reset()
 }
 
 void
-BasicWork::startWork(std::function<void()> notificationCallback)
+BasicWork::startWork(std::function<void()> notificationCallback,
+                     StateChangeCallback stateChangeCallback)
 {
     CLOG_TRACE(Work, "Starting {}", getName());
 
+    // Set first, so that the restart below is reported too
+    mStateChangeCallback = stateChangeCallback;
+
     if (mState != InternalState::PENDING)
     {
         // Only restart if work is in terminal state
@@ -251,6 +255,23 @@ BasicWork::getState() const
     }
 }
 
+std::string
+BasicWork::getStateName() const
+{
+    return stateName(mState);
+}
+
+std::chrono::nanoseconds
+BasicWork::getRunningDuration() const
+{
+    if (!mStartedAt)
+    {
+        return std::chrono::nanoseconds::zero();
+    }
+    auto end = mFinishedAt ? *mFinishedAt : mApp.getClock().now();
+    return end - *mStartedAt;
+}
+
 void
 BasicWork::setState(InternalState st)
 {
@@ -264,6 +285,8 @@ BasicWork::setState(InternalState st)
     {
         reset();
         mRetries = 0;
+        mStartedAt = mApp.getClock().now();
+        mFinishedAt.reset();
     }
 
     // Perform necessary action *before* changing state (in case shutdown was
@@ -271,9 +294,11 @@ BasicWork::setState(InternalState st)
     switch (st)
     {
     case InternalState::SUCCESS:
+        mFinishedAt = mApp.getClock().now();
         onSuccess();
         break;
     case InternalState::FAILURE:
+        mFinishedAt = mApp.getClock().now();
         onFailureRaise();
         reset();
         break;
@@ -282,6 +307,7 @@ BasicWork::setState(InternalState st)
         reset();
         break;
     case InternalState::ABORTED:
+        mFinishedAt = mApp.getClock().now();
         reset();
         break;
     default:
@@ -292,7 +318,13 @@ BasicWork::setState(InternalState st)
     {
         CLOG_DEBUG(Work, "work {} : {} -> {}", getName(), stateName(mState),
                    stateName(st));
+        auto from = getState();
         mState = st;
+        auto to = getState();
+        if (mStateChangeCallback && from != to)
+        {
+            mStateChangeCallback(from, to);
+        }
     }
 
     if (mState == InternalState::RETRYING)
@@ -4,6 +4,8 @@
 #pragma once
 
 #include "main/Application.h"
+#include "util/Timer.h"
+#include <optional>
 #include <set>
 
 namespace stellar
@@ -140,15 +142,33 @@ class BasicWork : public std::enable_shared_from_this<BasicWork>,
     State getState() const;
     bool isDone() const;
 
+    // How long the work has run since it last started, until it finished if
+    // it did, retries included; zero if it never started
+    std::chrono::nanoseconds getRunningDuration() const;
+    // Internal state, e.g. "WORK_PENDING" before it starts
+    std::string getStateName() const;
+    // Retries made since the work last started
+    size_t
+    getNumRetries() const
+    {
+        return mRetries;
+    }
+
     // Main method for state transition, mostly dictated by `onRun`
     void crankWork();
 
+    // Called with the old and new state whenever the state `getState` returns
+    // changes
+    using StateChangeCallback = std::function<void(State from, State to)>;
+
     // Reset work to its initial state (only if work is in terminal state)
     // Additionally, assign a notification callback to be used once work
     // makes important state transitions. For example, in the context of `Work`,
     // such callback should be passed into child, so that it can wake its parent
-    // up once finished.
-    void startWork(std::function<void()> notificationCallback);
+    // up once finished. The optional state change callback lets a parent keep
+    // track of its children without polling them.
+    void startWork(std::function<void()> notificationCallback,
+                   StateChangeCallback stateChangeCallback = nullptr);
 
     // Prepare work for destruction. Implementers overriding this method
     // are expected to call it on all work they might have created.
@@ -245,6 +265,7 @@ class BasicWork : public std::enable_shared_from_this<BasicWork>,
     void resetWaitingTimer();
 
     std::function<void()> mNotifyCallback;
+    StateChangeCallback mStateChangeCallback;
     std::string const mName;
     std::unique_ptr<VirtualTimer> mRetryTimer;
     std::unique_ptr<VirtualTimer> mWaitingTimer;
@@ -252,6 +273,8 @@ class BasicWork : public std::enable_shared_from_this<BasicWork>,
     std::atomic<InternalState> mState{InternalState::PENDING};
     size_t mRetries{0};
     size_t const mMaxRetries{RETRY_A_FEW};
+    std::optional<VirtualClock::time_point> mStartedAt;
+    std::optional<VirtualClock::time_point> mFinishedAt;
 
     // Legal and allowed state transitions in work state machine
     static std::set<Transition> const ALLOWED_TRANSITIONS;
@@ -70,7 +70,7 @@ BatchWork::addMoreWorkIfNeeded()
         throw std::runtime_error(getName() + " is being aborted!");
     }
 
-    size_t nChildren = mApp.getConfig().MAX_CONCURRENT_SUBPROCESSES;
+    size_t nChildren = getMaxBatchSize();
     while (mBatch.size() < nChildren && hasNext())
     {
         auto w = yieldMoreWork();
@@ -83,4 +83,10 @@ BatchWork::addMoreWorkIfNeeded()
         mBatch.insert(std::make_pair(w->getName(), w));
     }
 }
+
+size_t
+BatchWork::getMaxBatchSize() const
+{
+    return mApp.getConfig().MAX_CONCURRENT_SUBPROCESSES;
+}
 }
@@ -41,5 +41,8 @@ class BatchWork : public Work
     virtual bool hasNext() const = 0;
     virtual std::shared_ptr<BasicWork> yieldMoreWork() = 0;
     virtual void resetIter() = 0;
+
+    // Most children to run at once, MAX_CONCURRENT_SUBPROCESSES by default
+    virtual size_t getMaxBatchSize() const;
 };
 }
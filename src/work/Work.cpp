@@ -12,7 +12,7 @@ namespace stellar
 {
 
 Work::Work(Application& app, std::string name, size_t maxRetries)
-    : BasicWork(app, std::move(name), maxRetries), mNextChild(mChildren.begin())
+    : BasicWork(app, std::move(name), maxRetries)
 {
 }
 
@@ -70,8 +70,11 @@ Work::onRun()
         {
             releaseAssert(allChildrenSuccessful());
             clearChildren();
+            return state;
         }
-        else if (state == State::WORK_FAILURE && !allChildrenDone())
+
+        dropFinishedChildren();
+        if (state == State::WORK_FAILURE && !allChildrenDone())
         {
             CLOG_DEBUG(Work,
                        "A child of {} failed: aborting remaining children "
@@ -99,6 +102,7 @@ Work::onAbort()
     else
     {
         CLOG_TRACE(Work, "{}: waiting for children to abort.", getName());
+        dropFinishedChildren();
         return allChildrenDone();
     }
 }
@@ -119,9 +123,9 @@ Work::shutdownChildren()
     // Shutdown any children that are still running
     for (auto const& c : mChildren)
     {
-        if (!c->isDone())
+        if (!c.second->isDone())
         {
-            c->shutdown();
+            c.second->shutdown();
         }
     }
 }
@@ -147,39 +151,119 @@ Work::clearChildren()
     releaseAssert(allChildrenDone());
     mDoneChildren += mChildren.size();
     mChildren.clear();
-    mNextChild = mChildren.begin();
+    mChildIds.clear();
+    mRunningChildren.clear();
+    mNextRunningChild = 0;
+    mFinishedChildren.clear();
+    mChildStateCounts.clear();
 }
 
 void
 Work::addChild(std::shared_ptr<BasicWork> child)
 {
-    bool resetIter = !hasChildren();
-    mChildren.push_back(child);
+    auto id = mNextChildId++;
+    auto state = child->getState();
+    mChildren.emplace(id, child);
+    mChildIds.emplace(child.get(), id);
+    ++mChildStateCounts[state];
+    if (state == State::WORK_RUNNING)
+    {
+        mRunningChildren.emplace(id);
+    }
+    else if (child->isDone())
+    {
+        mFinishedChildren.emplace_back(id);
+    }
     mTotalChildren += 1;
-    if (resetIter)
+}
+
+BasicWork::StateChangeCallback
+Work::childStateChangeCallback(BasicWork const& child)
+{
+    std::weak_ptr<BasicWork> weak = shared_from_this();
+    auto childPtr = &child;
+    return [weak, childPtr](State from, State to) {
+        auto self = weak.lock();
+        if (self)
+        {
+            std::static_pointer_cast<Work>(self)->onChildStateChange(
+                *childPtr, from, to);
+        }
+    };
+}
+
+void
+Work::onChildStateChange(BasicWork const& child, State from, State to)
+{
+    auto it = mChildIds.find(&child);
+    if (it == mChildIds.end())
     {
-        mNextChild = mChildren.begin();
+        // Dropped already
+        return;
+    }
+    auto id = it->second;
+    releaseAssert(mChildStateCounts[from] > 0);
+    --mChildStateCounts[from];
+    ++mChildStateCounts[to];
+    if (to == State::WORK_RUNNING)
+    {
+        mRunningChildren.emplace(id);
+    }
+    else if (from == State::WORK_RUNNING)
+    {
+        mRunningChildren.erase(id);
+    }
+    if (child.isDone())
+    {
+        mFinishedChildren.emplace_back(id);
     }
 }
 
+size_t
+Work::countChildren(State state) const
+{
+    auto it = mChildStateCounts.find(state);
+    return it == mChildStateCounts.end() ? 0 : it->second;
+}
+
+void
+Work::dropFinishedChildren()
+{
+    for (auto id : mFinishedChildren)
+    {
+        auto it = mChildren.find(id);
+        // Children may be restarted, or be reported as finished twice
+        if (it == mChildren.end() || !it->second->isDone())
+        {
+            continue;
+        }
+        --mChildStateCounts[it->second->getState()];
+        mChildIds.erase(it->second.get());
+        mChildren.erase(it);
+        mDoneChildren += 1;
+    }
+    mFinishedChildren.clear();
+}
+
 bool
 Work::allChildrenSuccessful() const
 {
-    return WorkUtils::allSuccessful(mChildren);
+    return countChildren(State::WORK_SUCCESS) == mChildren.size();
 }
 
 bool
 Work::allChildrenDone() const
 {
-    return std::all_of(
-        mChildren.begin(), mChildren.end(),
-        [](std::shared_ptr<BasicWork> const& w) { return w->isDone(); });
+    return countChildren(State::WORK_SUCCESS) +
+               countChildren(State::WORK_FAILURE) +
+               countChildren(State::WORK_ABORTED) ==
+           mChildren.size();
 }
 
 bool
 Work::anyChildRunning() const
 {
-    return WorkUtils::anyRunning(mChildren);
+    return !mRunningChildren.empty();
 }
 
 bool
@@ -191,38 +275,41 @@ Work::hasChildren() const
 bool
 Work::anyChildRaiseFailure() const
 {
-    return WorkUtils::anyFailed(mChildren);
+    return countChildren(State::WORK_FAILURE) > 0;
 }
 
 BasicWork::State
 Work::checkChildrenStatus() const
 {
-    return WorkUtils::getWorkStatus(mChildren);
+    if (allChildrenSuccessful())
+    {
+        return State::WORK_SUCCESS;
+    }
+    else if (anyChildRaiseFailure())
+    {
+        return State::WORK_FAILURE;
+    }
+    else if (!anyChildRunning())
+    {
+        return State::WORK_WAITING;
+    }
+    return State::WORK_RUNNING;
 }
 
 std::shared_ptr<BasicWork>
 Work::yieldNextRunningChild()
 {
-    while (mNextChild != mChildren.end())
+    auto it = mRunningChildren.lower_bound(mNextRunningChild);
+    if (it == mRunningChildren.end())
     {
-        auto next = mNextChild;
-        mNextChild++;
-        releaseAssert(*next);
-        auto state = (*next)->getState();
-        if (state == State::WORK_RUNNING)
-        {
-            return *next;
-        }
-        else if ((*next)->isDone())
-        {
-            mNextChild = mChildren.erase(next);
-            mDoneChildren += 1;
-        }
+        mNextRunningChild = 0;
+        return nullptr;
     }
 
-    mNextChild = mChildren.begin();
-
-    return nullptr;
+    mNextRunningChild = *it + 1;
+    auto const& child = mChildren.at(*it);
+    releaseAssert(child->getState() == State::WORK_RUNNING);
+    return child;
 }
 
 namespace WorkUtils
@@ -9,7 +9,10 @@
 #include <list>
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace stellar
 {
@@ -29,7 +32,9 @@ class Application;
  *  It's worth noting that now since crank calls are propagated down the
  *  tree from the work scheduler, implementations should aim to create
  *  flatter structures for better efficiency; they can use WorkSequence
- *  if a long serial order needs to be enforced.
+ *  if a long serial order needs to be enforced. Children that are waiting
+ *  cost nothing to crank past: they report their state changes to their
+ *  parent, which only ever cranks its running children.
  */
 
 // Helper lambda that parent work can pass to children
@@ -99,7 +104,7 @@ class Work : public BasicWork
     {
         addChild(child);
         auto wakeSelf = wakeSelfUpCallback(cb);
-        child->startWork(wakeSelf);
+        child->startWork(wakeSelf, childStateChangeCallback(*child));
         wakeSelf();
     }
 
@@ -124,14 +129,32 @@ class Work : public BasicWork
     virtual void doReset();
 
   private:
-    std::list<std::shared_ptr<BasicWork>> mChildren;
-    std::list<std::shared_ptr<BasicWork>>::const_iterator mNextChild;
+    // Children keep their state up to date here as it changes, so that
+    // cranking and status checks cost as much as the children that are running
+    // rather than all of them: large fan-outs are mostly waiting.
+    //
+    // Children by id, in the order they were added
+    std::map<uint64_t, std::shared_ptr<BasicWork>> mChildren;
+    std::unordered_map<BasicWork const*, uint64_t> mChildIds;
+    uint64_t mNextChildId{0};
+    // Ids of the running children, cranked in round-robin order starting at
+    // the first id no lower than mNextRunningChild
+    std::set<uint64_t> mRunningChildren;
+    uint64_t mNextRunningChild{0};
+    // Ids of children that finished, dropped once `doWork` has seen them
+    std::vector<uint64_t> mFinishedChildren;
+    std::map<State, size_t> mChildStateCounts;
 
     size_t mDoneChildren{0};
     size_t mTotalChildren{0};
 
     std::shared_ptr<BasicWork> yieldNextRunningChild();
     void addChild(std::shared_ptr<BasicWork> child);
+    BasicWork::StateChangeCallback
+    childStateChangeCallback(BasicWork const& child);
+    void onChildStateChange(BasicWork const& child, State from, State to);
+    size_t countChildren(State state) const;
+    void dropFinishedChildren();
     void clearChildren();
     void shutdownChildren();
 
@@ -8,13 +8,8 @@
 
 namespace stellar
 {
-// WorkScheduler performs a crank every TRIGGER_PERIOD
-// it should be set small enough that work gets executed fast enough
-// but not too small as to take over execution in the main thread
-std::chrono::milliseconds const WorkScheduler::TRIGGER_PERIOD(50);
-
 WorkScheduler::WorkScheduler(Application& app)
-    : Work(app, "work-scheduler", BasicWork::RETRY_NEVER), mTriggerTimer(app)
+    : Work(app, "work-scheduler", BasicWork::RETRY_NEVER)
 {
 }
 
@@ -15,14 +15,14 @@ namespace stellar
  * with a `scheduleOne` callback.
  *
  * WorkScheduler attempts fair scheduling by doing round-robin among
- * works that wish to execute.
+ * works that wish to execute. It only cranks while some work is running, and
+ * is otherwise woken up by a work that is, so a tree that is waiting costs
+ * nothing to keep around.
  */
 class WorkScheduler : public Work
 {
     explicit WorkScheduler(Application& app);
     bool mScheduled{false};
-    VirtualTimer mTriggerTimer;
-    static std::chrono::milliseconds const TRIGGER_PERIOD;
 
   public:
     virtual ~WorkScheduler();
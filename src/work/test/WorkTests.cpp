@@ -416,6 +416,77 @@ TEST_CASE("work with children", "[work]")
     }
 }
 
+// Waits after its first run until told it's done and woken up
+class TestIdleWork : public TestBasicWork
+{
+  public:
+    bool mDone{false};
+
+    TestIdleWork(Application& app, std::string name)
+        : TestBasicWork(app, std::move(name))
+    {
+    }
+
+  protected:
+    BasicWork::State
+    onRun() override
+    {
+        ++mRunningCount;
+        return mDone ? State::WORK_SUCCESS : State::WORK_WAITING;
+    }
+};
+
+TEST_CASE("work with many waiting children", "[work]")
+{
+    VirtualClock clock;
+    Config const& cfg = getTestConfig();
+    Application::pointer appPtr = createTestApplication(clock, cfg);
+    auto& wm = appPtr->getWorkScheduler();
+
+    auto w = wm.scheduleWork<TestWork>("fan-out-work");
+    std::vector<std::shared_ptr<TestIdleWork>> idle;
+    for (int i = 0; i < 1000; ++i)
+    {
+        idle.emplace_back(
+            w->addTestWork<TestIdleWork>(fmt::format("idle-work-{}", i)));
+    }
+    auto busy = w->addTestWork<TestBasicWork>("busy-work", false, 100);
+    while (busy->getState() != TestBasicWork::State::WORK_SUCCESS)
+    {
+        clock.crank();
+    }
+
+    // Waiting children ran once and were left alone after that
+    for (auto const& c : idle)
+    {
+        REQUIRE(c->mRunningCount == 1);
+    }
+    REQUIRE(!w->anyChildRunning());
+    REQUIRE(w->getState() == TestBasicWork::State::WORK_WAITING);
+
+    // Waking one up gets only that one cranked again
+    idle[0]->mDone = true;
+    idle[0]->forceWakeUp();
+    while (idle[0]->getState() != TestBasicWork::State::WORK_SUCCESS)
+    {
+        clock.crank();
+    }
+    REQUIRE(idle[0]->mRunningCount == 2);
+    REQUIRE(idle[1]->mRunningCount == 1);
+
+    for (auto const& c : idle)
+    {
+        c->mDone = true;
+        c->forceWakeUp();
+    }
+    while (w->getState() != TestBasicWork::State::WORK_SUCCESS)
+    {
+        clock.crank();
+    }
+    REQUIRE(w->allChildrenSuccessful());
+    REQUIRE(!w->hasChildren());
+}
+
 TEST_CASE("work scheduling and run count", "[work]")
 {
     VirtualClock clock;